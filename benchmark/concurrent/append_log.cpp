@@ -0,0 +1,57 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+
+// Every thread appends to a shared log, either through an `atom` of a
+// vector, that copies the tail and retries under contention, or
+// through an `append_log`, that claims slots in its leaves.
+
+#include "harness.hpp"
+
+#include <immer/append_log.hpp>
+#include <immer/atom.hpp>
+#include <immer/vector.hpp>
+
+#include <memory>
+
+namespace {
+
+auto bench_atom()
+{
+    using vector_t = immer::vector<std::size_t>;
+    using atom_t   = immer::atom<vector_t>;
+    return [] {
+        auto a = std::make_shared<atom_t>();
+        return [=](unsigned) {
+            return [=](std::size_t i) {
+                a->update([&](const vector_t& v) { return v.push_back(i); });
+            };
+        };
+    };
+}
+
+auto bench_append_log()
+{
+    using log_t = immer::append_log<std::size_t>;
+    return [] {
+        auto l = std::make_shared<log_t>();
+        return [=](unsigned) {
+            return [=](std::size_t i) { l->push(i); };
+        };
+    };
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    auto n = parse_ops(argc, argv);
+    report_header();
+    sweep("atom", n, bench_atom());
+    sweep("append_log", n, bench_append_log());
+}
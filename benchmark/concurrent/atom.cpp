@@ -0,0 +1,79 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include "harness.hpp"
+
+#include <immer/atom.hpp>
+
+#include <memory>
+
+namespace {
+
+template <typename ReclamationPolicy>
+using atom_t =
+    immer::atom<int, immer::default_memory_policy, ReclamationPolicy>;
+
+template <typename ReclamationPolicy>
+auto bench_load()
+{
+    return [] {
+        auto x = std::make_shared<atom_t<ReclamationPolicy>>(42);
+        return [x](unsigned) {
+            return [x](std::size_t) { keep(*x->load()); };
+        };
+    };
+}
+
+template <typename ReclamationPolicy>
+auto bench_update()
+{
+    return [] {
+        auto x = std::make_shared<atom_t<ReclamationPolicy>>(0);
+        return [x](unsigned) {
+            return [x](std::size_t) {
+                x->update([](int v) { return v + 1; });
+            };
+        };
+    };
+}
+
+// one in eight threads writes, the rest read
+template <typename ReclamationPolicy>
+auto bench_mixed()
+{
+    return [] {
+        auto x = std::make_shared<atom_t<ReclamationPolicy>>(0);
+        return [x](unsigned t) {
+            return [x, t](std::size_t) {
+                if (t % 8 == 0)
+                    x->update([](int v) { return v + 1; });
+                else
+                    keep(*x->load());
+            };
+        };
+    };
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    using immer::hazard_pointer_reclamation_policy;
+    using immer::lock_reclamation_policy;
+
+    auto n = parse_ops(argc, argv);
+    report_header();
+    sweep("load/lock", n, bench_load<lock_reclamation_policy>());
+    sweep("load/hazard", n, bench_load<hazard_pointer_reclamation_policy>());
+    sweep("update/lock", n, bench_update<lock_reclamation_policy>());
+    sweep("update/hazard",
+          n,
+          bench_update<hazard_pointer_reclamation_policy>());
+    sweep("mixed/lock", n, bench_mixed<lock_reclamation_policy>());
+    sweep("mixed/hazard", n, bench_mixed<hazard_pointer_reclamation_policy>());
+}
@@ -0,0 +1,67 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+// Every thread increments counters on a handful of hot keys, either
+// publishing every increment through an `atom` of a map, or through
+// the locals of a `counter_map` that publish them in batches.
+
+#include "harness.hpp"
+
+#include <immer/atom.hpp>
+#include <immer/counter_map.hpp>
+#include <immer/map.hpp>
+
+#include <cstdint>
+#include <memory>
+
+namespace {
+
+constexpr auto hot_keys = 16u;
+
+auto bench_atom()
+{
+    using map_t  = immer::map<unsigned, std::int64_t>;
+    using atom_t = immer::atom<map_t>;
+    return [] {
+        auto a = std::make_shared<atom_t>();
+        return [=](unsigned t) {
+            return [=](std::size_t i) {
+                auto k = static_cast<unsigned>(i + t) % hot_keys;
+                a->update([&](const map_t& m) {
+                    return m.update(k, [](std::int64_t x) { return x + 1; });
+                });
+            };
+        };
+    };
+}
+
+auto bench_counter_map(std::size_t max_pending)
+{
+    using counters_t = immer::counter_map<unsigned>;
+    return [=] {
+        auto c = std::make_shared<counters_t>(counters_t::map_type{},
+                                              max_pending);
+        return [=](unsigned t) {
+            auto l = std::make_shared<counters_t::local_type>(c->local());
+            return [=](std::size_t i) {
+                l->add(static_cast<unsigned>(i + t) % hot_keys);
+            };
+        };
+    };
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    auto n = parse_ops(argc, argv);
+    report_header();
+    sweep("atom", n, bench_atom());
+    sweep("counter_map/64", n, bench_counter_map(64));
+    sweep("counter_map/1024", n, bench_counter_map(1024));
+}
@@ -0,0 +1,161 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+// A small harness for the benchmarks that run on several threads at
+// once.  Nonius measures the duration of a whole run, which hides what
+// matters under contention, so these report the throughput over all
+// the threads and the median and 99th percentile of the latency of the
+// single operations, for every thread count in a sweep:
+//
+//     benchmark                   threads       ops/s   p50 (ns)  p99 (ns)
+//     update/lock                       1    41234567         21        30
+//     ...
+//
+// The latencies include the cost of reading the clock twice, a few
+// tens of nanoseconds, that is the same for all the benchmarks.  The
+// programs accept `-p N:<ops>` for the number of operations per thread
+// and ignore the other options of the nonius runner, so that they can
+// run as part of the `check` target with the rest.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+inline std::size_t parse_ops(int argc, char** argv)
+{
+    auto n = std::size_t{1000};
+    for (auto i = 1; i + 1 < argc; ++i)
+        if (std::strcmp(argv[i], "-p") == 0 &&
+            std::strncmp(argv[i + 1], "N:", 2) == 0)
+            n = std::stoul(argv[i + 1] + 2);
+    return n;
+}
+
+// powers of two up to the concurrency of the machine, and the
+// concurrency itself, with at least two threads
+inline std::vector<unsigned> thread_counts()
+{
+    auto hw = std::max(2u, std::thread::hardware_concurrency());
+    auto r  = std::vector<unsigned>{};
+    for (auto t = 1u; t < hw; t *= 2)
+        r.push_back(t);
+    r.push_back(hw);
+    return r;
+}
+
+// keeps the compiler from dropping the computation of `x`
+template <typename T>
+void keep(const T& x)
+{
+    volatile auto r = x;
+    (void) r;
+}
+
+struct result
+{
+    unsigned threads;
+    double throughput;
+    std::int64_t p50;
+    std::int64_t p99;
+};
+
+// Runs `n` operations in each of `threads` threads, all started at the
+// same time.  `make(t)` is called in the thread `t` before the start,
+// and returns the operation that it runs, which takes the index of the
+// operation.
+template <typename Make>
+result run(unsigned threads, std::size_t n, Make& make)
+{
+    using clock_t = std::chrono::steady_clock;
+
+    auto latencies = std::vector<std::vector<std::int64_t>>(threads);
+    auto workers   = std::vector<std::thread>{};
+    std::atomic<unsigned> ready{0};
+    std::atomic<bool> go{false};
+    for (auto t = 0u; t < threads; ++t)
+        workers.emplace_back([&, t] {
+            auto op   = make(t);
+            auto& lat = latencies[t];
+            lat.resize(n);
+            ++ready;
+            while (!go.load(std::memory_order_acquire))
+                std::this_thread::yield();
+            for (auto i = std::size_t{}; i < n; ++i) {
+                auto start = clock_t::now();
+                op(i);
+                lat[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             clock_t::now() - start)
+                             .count();
+            }
+        });
+    while (ready.load() < threads)
+        std::this_thread::yield();
+    auto start = clock_t::now();
+    go.store(true, std::memory_order_release);
+    for (auto& w : workers)
+        w.join();
+    auto elapsed = std::chrono::duration<double>(clock_t::now() - start);
+
+    auto all = std::vector<std::int64_t>{};
+    all.reserve(n * threads);
+    for (auto& lat : latencies)
+        all.insert(all.end(), lat.begin(), lat.end());
+    auto percentile = [&](std::size_t p) {
+        auto it = all.begin() + (all.size() - 1) * p / 100;
+        std::nth_element(all.begin(), it, all.end());
+        return *it;
+    };
+    auto total = static_cast<double>(n) * threads;
+    return {threads, total / elapsed.count(), percentile(50), percentile(99)};
+}
+
+inline void report_header()
+{
+    std::printf("%-32s %7s %14s %10s %10s\n",
+                "benchmark",
+                "threads",
+                "ops/s",
+                "p50 (ns)",
+                "p99 (ns)");
+}
+
+inline void report(const char* name, const result& r)
+{
+    std::printf("%-32s %7u %14.0f %10lld %10lld\n",
+                name,
+                r.threads,
+                r.throughput,
+                static_cast<long long>(r.p50),
+                static_cast<long long>(r.p99));
+    std::fflush(stdout);
+}
+
+// Runs the benchmark for every thread count.  `setup()` is called at
+// the start of every run to build the state that the threads share,
+// and returns the `make` function for `run`.
+template <typename Setup>
+void sweep(const char* name, std::size_t n, Setup setup)
+{
+    for (auto threads : thread_counts()) {
+        auto make = setup();
+        report(name, run(threads, n, make));
+    }
+}
+
+} // namespace
@@ -0,0 +1,117 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+// Allocation of nodes from many threads with the heaps that a memory
+// policy can use: the default `free_list_heap_policy`, that puts a
+// `thread_local_free_list_heap` in front of a global `free_list_heap`,
+// the global free list alone, and no free list at all.
+//
+// The `local` benchmarks free the nodes in the thread that allocated
+// them.  In the `handoff` ones every thread passes its containers to
+// the next one, that frees them, like a producer and a consumer do,
+// which moves nodes from the thread local lists of some threads to
+// those of others.
+
+#include "harness.hpp"
+
+#include <immer/atom.hpp>
+#include <immer/heap/cpp_heap.hpp>
+#include <immer/heap/free_list_heap.hpp>
+#include <immer/heap/heap_policy.hpp>
+#include <immer/heap/split_heap.hpp>
+#include <immer/memory_policy.hpp>
+#include <immer/vector.hpp>
+
+#include <memory>
+
+namespace {
+
+constexpr auto container_size = 64u;
+
+template <typename Heap, std::size_t Limit = immer::default_free_list_size>
+struct global_free_list_heap_policy
+{
+    using type = immer::debug_size_heap<Heap>;
+
+    template <std::size_t Size>
+    struct optimized
+    {
+        using type = immer::split_heap<
+            Size,
+            immer::with_free_list_node<
+                immer::free_list_heap<Size,
+                                      Limit,
+                                      immer::debug_size_heap<Heap>>>,
+            immer::debug_size_heap<Heap>>;
+    };
+};
+
+template <typename HeapPolicy>
+using memory_t = immer::memory_policy<HeapPolicy,
+                                      immer::refcount_policy,
+                                      immer::default_lock_policy>;
+
+using thread_local_memory =
+    memory_t<immer::free_list_heap_policy<immer::cpp_heap>>;
+using global_memory = memory_t<global_free_list_heap_policy<immer::cpp_heap>>;
+using no_free_list_memory = memory_t<immer::heap_policy<immer::cpp_heap>>;
+
+template <typename Memory>
+using vector_t = immer::vector<unsigned, Memory>;
+
+template <typename Memory>
+vector_t<Memory> make_vector(std::size_t i)
+{
+    auto v = vector_t<Memory>{};
+    for (auto k = 0u; k < container_size; ++k)
+        v = std::move(v).push_back(static_cast<unsigned>(i + k));
+    return v;
+}
+
+template <typename Memory>
+auto bench_local()
+{
+    return [] {
+        return [](unsigned) {
+            return [](std::size_t i) { keep(make_vector<Memory>(i).size()); };
+        };
+    };
+}
+
+// as `sweep`, with a slot for the containers of every thread
+template <typename Memory>
+void sweep_handoff(const char* name, std::size_t n)
+{
+    using slot_t = immer::atom<vector_t<Memory>>;
+    for (auto threads : thread_counts()) {
+        auto slots = std::make_shared<std::vector<std::unique_ptr<slot_t>>>();
+        for (auto t = 0u; t < threads; ++t)
+            slots->push_back(std::make_unique<slot_t>());
+        auto make = [slots](unsigned t) {
+            return [slots, t](std::size_t i) {
+                auto& next = *(*slots)[(t + 1) % slots->size()];
+                keep(next.exchange(make_vector<Memory>(i))->size());
+            };
+        };
+        report(name, run(threads, n, make));
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    auto n = parse_ops(argc, argv);
+    report_header();
+    sweep("local/thread_local", n, bench_local<thread_local_memory>());
+    sweep("local/global", n, bench_local<global_memory>());
+    sweep("local/no_free_list", n, bench_local<no_free_list_memory>());
+    sweep_handoff<thread_local_memory>("handoff/thread_local", n);
+    sweep_handoff<global_memory>("handoff/global", n);
+    sweep_handoff<no_free_list_memory>("handoff/no_free_list", n);
+}
@@ -0,0 +1,89 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+// Mixed workloads on a `kv_store`.  Readers take a snapshot and look up
+// a few keys, writers run a transaction that moves one unit between two
+// keys.  The `reads-N` benchmarks make N percent of the operations
+// reads, on a store with many keys, where transactions rarely conflict,
+// and the `hot` ones run the writes on a handful of keys, where most of
+// them do and have to start over.
+
+#include "harness.hpp"
+
+#include <immer/kv_store.hpp>
+#include <immer/map_transient.hpp>
+
+#include <cstdint>
+#include <memory>
+
+namespace {
+
+using store_t = immer::kv_store<unsigned, std::uint64_t>;
+
+struct xorshift
+{
+    std::uint64_t state;
+
+    unsigned operator()(unsigned n)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return static_cast<unsigned>(state % n);
+    }
+};
+
+auto make_store(unsigned keys)
+{
+    auto m = store_t::map_type{}.transient();
+    for (auto i = 0u; i < keys; ++i)
+        m.set(i, 1000);
+    return std::make_shared<store_t>(m.persistent());
+}
+
+auto bench_mixed(unsigned keys, unsigned read_percent)
+{
+    return [=] {
+        auto s = make_store(keys);
+        return [=](unsigned t) {
+            auto seed = 0x9e3779b97f4a7c15ull * (t + 1);
+            auto rnd  = std::make_shared<xorshift>(xorshift{seed});
+            return [=](std::size_t) {
+                if ((*rnd)(100) < read_percent) {
+                    auto snap = s->snapshot();
+                    auto sum  = std::uint64_t{};
+                    for (auto i = 0; i < 4; ++i)
+                        if (auto v = snap.find((*rnd)(keys)))
+                            sum += *v;
+                    keep(sum);
+                } else {
+                    auto from = (*rnd)(keys);
+                    auto to   = (*rnd)(keys);
+                    s->transact([&](auto& tx) {
+                        tx.set(from, *tx.find(from) - 1);
+                        tx.set(to, *tx.find(to) + 1);
+                    });
+                }
+            };
+        };
+    };
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    auto n = parse_ops(argc, argv);
+    report_header();
+    sweep("reads-99", n, bench_mixed(100000, 99));
+    sweep("reads-90", n, bench_mixed(100000, 90));
+    sweep("reads-50", n, bench_mixed(100000, 50));
+    sweep("reads-0", n, bench_mixed(100000, 0));
+    sweep("hot/reads-90", n, bench_mixed(16, 90));
+    sweep("hot/reads-0", n, bench_mixed(16, 0));
+}
@@ -0,0 +1,123 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+// Contention on the reference counts of the nodes shared between
+// threads.  The `shared` benchmarks copy and update one container from
+// all the threads, so that they all touch the counts of the same
+// nodes, and the `private` ones give every thread its own copy of it,
+// which is the baseline without contention.
+
+#include "harness.hpp"
+
+#include <immer/map.hpp>
+#include <immer/map_transient.hpp>
+#include <immer/vector.hpp>
+#include <immer/vector_transient.hpp>
+
+#include <memory>
+
+namespace {
+
+constexpr auto container_size = 1000u;
+
+using vector_t = immer::vector<unsigned>;
+using map_t    = immer::map<unsigned, unsigned>;
+
+auto make_vector()
+{
+    auto v = vector_t{}.transient();
+    for (auto i = 0u; i < container_size; ++i)
+        v.push_back(i);
+    return v.persistent();
+}
+
+auto make_map()
+{
+    auto m = map_t{}.transient();
+    for (auto i = 0u; i < container_size; ++i)
+        m.set(i, i);
+    return m.persistent();
+}
+
+// `op(c, i)` is run with the container, shared or per thread
+template <typename Make, typename Op>
+auto bench(bool shared, Make make_container, Op op)
+{
+    using container_t = decltype(make_container());
+    return [=] {
+        auto c = std::make_shared<container_t>(make_container());
+        return [=](unsigned) {
+            auto own =
+                shared ? c : std::make_shared<container_t>(make_container());
+            return [=](std::size_t i) { op(*own, i); };
+        };
+    };
+}
+
+// copies the container and drops the copy
+struct copy_op
+{
+    template <typename C>
+    void operator()(const C& c, std::size_t) const
+    {
+        auto x = c;
+        keep(x.size());
+    }
+};
+
+// updates an element, that copies the path to it and increments the
+// counts of the nodes next to the path, and drops the result
+struct vector_set_op
+{
+    void operator()(const vector_t& v, std::size_t i) const
+    {
+        keep(v.set(i % container_size, 0u).size());
+    }
+};
+
+struct vector_push_op
+{
+    void operator()(const vector_t& v, std::size_t i) const
+    {
+        keep(v.push_back(static_cast<unsigned>(i)).size());
+    }
+};
+
+struct map_set_op
+{
+    void operator()(const map_t& m, std::size_t i) const
+    {
+        keep(m.set(static_cast<unsigned>(i % container_size), 0u).size());
+    }
+};
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    auto n = parse_ops(argc, argv);
+    report_header();
+    for (auto shared : {true, false}) {
+        auto name = [&](const char* op) {
+            return std::string{shared ? "shared/" : "private/"} + op;
+        };
+        sweep(name("vector/copy").c_str(),
+              n,
+              bench(shared, make_vector, copy_op{}));
+        sweep(name("vector/set").c_str(),
+              n,
+              bench(shared, make_vector, vector_set_op{}));
+        sweep(name("vector/push_back").c_str(),
+              n,
+              bench(shared, make_vector, vector_push_op{}));
+        sweep(name("map/copy").c_str(), n, bench(shared, make_map, copy_op{}));
+        sweep(name("map/set").c_str(),
+              n,
+              bench(shared, make_map, map_set_op{}));
+    }
+}
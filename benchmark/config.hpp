@@ -10,6 +10,8 @@
 
 #include <nonius.h++>
 
+#include "benchmark/report.hpp"
+
 #include <immer/heap/gc_heap.hpp>
 #include <immer/memory_policy.hpp>
 
@@ -42,9 +44,25 @@ template <typename Meter, typename Fn>
 void measure(Meter& m, Fn&& fn)
 {
     gc_disable guard;
+#if IMMER_BENCHMARK_PERF_COUNTERS
+    perf_scope perf{m.runs()};
+#endif
     return m.measure(std::forward<Fn>(fn));
 }
 
+// Runs one operation of the loop of a benchmark, that is timed on its
+// own with the `BENCHMARK_LATENCY` option, see
+// `benchmark/latency.hpp`.
+template <typename Fn>
+void measure_op(Fn&& fn)
+{
+#if IMMER_BENCHMARK_LATENCY
+    latency_record(std::forward<Fn>(fn));
+#else
+    std::forward<Fn>(fn)();
+#endif
+}
+
 using def_memory   = immer::default_memory_policy;
 using gc_memory    = immer::memory_policy<immer::heap_policy<immer::gc_heap>,
                                        immer::no_refcount_policy,
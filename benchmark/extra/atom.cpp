@@ -0,0 +1,101 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/atom.hpp>
+
+#include "benchmark/report.hpp"
+
+#include <nonius.h++>
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+NONIUS_PARAM(N, std::size_t{1000})
+
+namespace {
+
+// runs `fn(i)` on as many threads as the machine has, `n` times in
+// every thread, so that they all contend on the same atom
+template <typename Fn>
+void contend(std::size_t n, Fn fn)
+{
+    auto threads = std::max(2u, std::thread::hardware_concurrency());
+    auto workers = std::vector<std::thread>{};
+    for (auto t = 0u; t < threads; ++t)
+        workers.emplace_back([=] {
+            for (auto i = std::size_t{}; i < n; ++i)
+                fn(t);
+        });
+    for (auto& w : workers)
+        w.join();
+}
+
+template <typename ReclamationPolicy>
+using atom_t =
+    immer::atom<int, immer::default_memory_policy, ReclamationPolicy>;
+
+template <typename ReclamationPolicy>
+auto benchmark_load()
+{
+    return [](nonius::parameters params) {
+        auto n = params.get<N>();
+        return [=] {
+            atom_t<ReclamationPolicy> x{42};
+            contend(n, [&](unsigned) { return x.load(); });
+        };
+    };
+}
+
+template <typename ReclamationPolicy>
+auto benchmark_update()
+{
+    return [](nonius::parameters params) {
+        auto n = params.get<N>();
+        return [=] {
+            atom_t<ReclamationPolicy> x{0};
+            contend(n, [&](unsigned) {
+                return x.update([](int v) { return v + 1; });
+            });
+        };
+    };
+}
+
+// one in eight threads writes, the rest read
+template <typename ReclamationPolicy>
+auto benchmark_mixed()
+{
+    return [](nonius::parameters params) {
+        auto n = params.get<N>();
+        return [=] {
+            atom_t<ReclamationPolicy> x{0};
+            contend(n, [&](unsigned t) {
+                if (t % 8 == 0)
+                    x.update([](int v) { return v + 1; });
+                else
+                    (void) x.load();
+            });
+        };
+    };
+}
+
+} // namespace
+
+NONIUS_BENCHMARK("load/lock",
+                 benchmark_load<immer::lock_reclamation_policy>())
+NONIUS_BENCHMARK("load/hazard",
+                 benchmark_load<immer::hazard_pointer_reclamation_policy>())
+NONIUS_BENCHMARK("update/lock",
+                 benchmark_update<immer::lock_reclamation_policy>())
+NONIUS_BENCHMARK("update/hazard",
+                 benchmark_update<immer::hazard_pointer_reclamation_policy>())
+NONIUS_BENCHMARK("mixed/lock",
+                 benchmark_mixed<immer::lock_reclamation_policy>())
+NONIUS_BENCHMARK("mixed/hazard",
+                 benchmark_mixed<immer::hazard_pointer_reclamation_policy>())
@@ -8,6 +8,8 @@
 
 #include <immer/detail/ref_count_base.hpp>
 
+#include "benchmark/report.hpp"
+
 #include <nonius.h++>
 #include <boost/intrusive_ptr.hpp>
 
@@ -0,0 +1,160 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+// Latencies of the single operations of the benchmarks, enabled with
+// the `BENCHMARK_LATENCY` CMake option.  The benchmarks wrap the
+// operations of their loops in `measure_op()`, see
+// `benchmark/config.hpp`, which reads the time stamp counter before
+// and after every one of them and records the difference in the
+// histogram of the benchmark that is running.  The reporters of
+// `benchmark/report.hpp` write its percentiles, in nanoseconds, in
+// their JSON file and in the output:
+//
+//     "latency": {"count": 20000, "p50": 21.3, "p90": 25.1,
+//                 "p99": 88.0, "p999": 412.5, "max": 3520.2}
+//
+// The histograms are like those of HdrHistogram: the values below 256
+// ticks are counted exactly, and every power of two above is split in
+// 128 buckets, so the percentiles are off by less than 1%, and a
+// histogram takes the same 58 KiB for any number of values.  The
+// latencies include the cost of reading the counter, that is not
+// serialized, and the runs that nonius does to plan the samples.
+// Timing every operation slows down the loops, hence the report
+// directory of such a build has its own `_lat` suffix.
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+// the cheapest clock that there is, in ticks of unknown length
+inline std::uint64_t latency_ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+// the length of a tick, measured once against the steady clock
+inline double latency_ns_per_tick()
+{
+    static const auto r = [] {
+        using clock_t = std::chrono::steady_clock;
+
+        auto t0       = clock_t::now();
+        auto c0       = latency_ticks();
+        auto deadline = t0 + std::chrono::milliseconds{20};
+        auto t1       = t0;
+        while ((t1 = clock_t::now()) < deadline)
+            ;
+        auto c1 = latency_ticks();
+        auto ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+        return c1 > c0 ? ns / double(c1 - c0) : 1.0;
+    }();
+    return r;
+}
+
+/*!
+ * Counts of values in buckets whose width grows with the values, to
+ * keep their relative error bounded.
+ */
+class latency_histogram
+{
+public:
+    static constexpr unsigned sub_bits  = 8;
+    static constexpr std::uint64_t sub  = std::uint64_t{1} << sub_bits;
+    static constexpr std::uint64_t half = sub / 2;
+
+    void record(std::uint64_t v)
+    {
+        ++counts_[index(v)];
+        ++count_;
+        max_ = std::max(max_, v);
+    }
+
+    std::uint64_t count() const { return count_; }
+    std::uint64_t max() const { return max_; }
+
+    // the highest value of the bucket of the value with rank
+    // `p * count()`, which is not more than the maximum
+    std::uint64_t percentile(double p) const
+    {
+        if (!count_)
+            return 0;
+        auto rank = std::max<std::uint64_t>(
+            1, static_cast<std::uint64_t>(p * double(count_) + 0.5));
+        auto seen = std::uint64_t{};
+        for (auto i = std::size_t{}; i < counts_.size(); ++i)
+            if ((seen += counts_[i]) >= rank)
+                return std::min(highest(i), max_);
+        return max_;
+    }
+
+private:
+    static std::size_t index(std::uint64_t v)
+    {
+        if (v < sub)
+            return static_cast<std::size_t>(v);
+        auto msb   = 63u - static_cast<unsigned>(__builtin_clzll(v));
+        auto shift = msb - sub_bits + 1;
+        return static_cast<std::size_t>(sub + (shift - 1) * half +
+                                        ((v >> shift) - half));
+    }
+
+    static std::uint64_t highest(std::size_t i)
+    {
+        if (i < sub)
+            return i;
+        auto shift = (i - sub) / half + 1;
+        auto mant  = (i - sub) % half + half;
+        return ((mant + 1) << shift) - 1;
+    }
+
+    std::vector<std::uint64_t> counts_ =
+        std::vector<std::uint64_t>(sub + (64 - sub_bits) * half);
+    std::uint64_t count_ = 0;
+    std::uint64_t max_   = 0;
+};
+
+// where the latencies of the benchmark that is running go, set by the
+// reporter
+inline latency_histogram*& latency_current()
+{
+    static latency_histogram* current = nullptr;
+    return current;
+}
+
+/*!
+ * Runs `fn` and records how long it took in the histogram of the
+ * benchmark that is running, if any.
+ */
+template <typename Fn>
+void latency_record(Fn&& fn)
+{
+    auto h = latency_current();
+    if (!h)
+        return (void) std::forward<Fn>(fn)();
+    auto start = latency_ticks();
+    std::forward<Fn>(fn)();
+    h->record(latency_ticks() - start);
+}
+
+} // anonymous namespace
@@ -0,0 +1,31 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include "benchmark/map/erase.hpp"
+
+#ifndef GENERATOR_T
+#error "you must define a GENERATOR_T"
+#endif
+
+using generator__ = GENERATOR_T;
+using t__         = typename decltype(generator__{}(0))::value_type;
+
+NONIUS_BENCHMARK("3B", benchmark_erase<generator__, immer::map<t__, unsigned, std::hash<t__>,std::equal_to<t__>,def_memory,3>>())
+NONIUS_BENCHMARK("4B", benchmark_erase<generator__, immer::map<t__, unsigned, std::hash<t__>,std::equal_to<t__>,def_memory,4>>())
+NONIUS_BENCHMARK("5B", benchmark_erase<generator__, immer::map<t__, unsigned, std::hash<t__>,std::equal_to<t__>,def_memory,5>>())
+NONIUS_BENCHMARK("6B", benchmark_erase<generator__, immer::map<t__, unsigned, std::hash<t__>,std::equal_to<t__>,def_memory,6>>())
+
+NONIUS_BENCHMARK("move/3B", benchmark_erase_move<generator__, immer::map<t__, unsigned, std::hash<t__>,std::equal_to<t__>,def_memory,3>>())
+NONIUS_BENCHMARK("move/4B", benchmark_erase_move<generator__, immer::map<t__, unsigned, std::hash<t__>,std::equal_to<t__>,def_memory,4>>())
+NONIUS_BENCHMARK("move/5B", benchmark_erase_move<generator__, immer::map<t__, unsigned, std::hash<t__>,std::equal_to<t__>,def_memory,5>>())
+NONIUS_BENCHMARK("move/6B", benchmark_erase_move<generator__, immer::map<t__, unsigned, std::hash<t__>,std::equal_to<t__>,def_memory,6>>())
+
+NONIUS_BENCHMARK("tran/3B", benchmark_erase_mut<generator__, immer::map<t__, unsigned, std::hash<t__>,std::equal_to<t__>,def_memory,3>>())
+NONIUS_BENCHMARK("tran/4B", benchmark_erase_mut<generator__, immer::map<t__, unsigned, std::hash<t__>,std::equal_to<t__>,def_memory,4>>())
+NONIUS_BENCHMARK("tran/5B", benchmark_erase_mut<generator__, immer::map<t__, unsigned, std::hash<t__>,std::equal_to<t__>,def_memory,5>>())
+NONIUS_BENCHMARK("tran/6B", benchmark_erase_mut<generator__, immer::map<t__, unsigned, std::hash<t__>,std::equal_to<t__>,def_memory,6>>())
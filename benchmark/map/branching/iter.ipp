@@ -0,0 +1,26 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include "benchmark/map/iter.hpp"
+
+#ifndef GENERATOR_T
+#error "you must define a GENERATOR_T"
+#endif
+
+using generator__ = GENERATOR_T;
+using t__         = typename decltype(generator__{}(0))::value_type;
+
+NONIUS_BENCHMARK("iter/3B", benchmark_access_iter<generator__, immer::map<t__, unsigned, std::hash<t__>,std::equal_to<t__>,def_memory,3>>())
+NONIUS_BENCHMARK("iter/4B", benchmark_access_iter<generator__, immer::map<t__, unsigned, std::hash<t__>,std::equal_to<t__>,def_memory,4>>())
+NONIUS_BENCHMARK("iter/5B", benchmark_access_iter<generator__, immer::map<t__, unsigned, std::hash<t__>,std::equal_to<t__>,def_memory,5>>())
+NONIUS_BENCHMARK("iter/6B", benchmark_access_iter<generator__, immer::map<t__, unsigned, std::hash<t__>,std::equal_to<t__>,def_memory,6>>())
+
+NONIUS_BENCHMARK("reduce/3B", benchmark_access_reduce<generator__, immer::map<t__, unsigned, std::hash<t__>,std::equal_to<t__>,def_memory,3>>())
+NONIUS_BENCHMARK("reduce/4B", benchmark_access_reduce<generator__, immer::map<t__, unsigned, std::hash<t__>,std::equal_to<t__>,def_memory,4>>())
+NONIUS_BENCHMARK("reduce/5B", benchmark_access_reduce<generator__, immer::map<t__, unsigned, std::hash<t__>,std::equal_to<t__>,def_memory,5>>())
+NONIUS_BENCHMARK("reduce/6B", benchmark_access_reduce<generator__, immer::map<t__, unsigned, std::hash<t__>,std::equal_to<t__>,def_memory,6>>())
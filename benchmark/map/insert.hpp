@@ -0,0 +1,85 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include "benchmark/config.hpp"
+
+#include <boost/container/flat_map.hpp>
+#include <immer/map.hpp>
+#include <immer/map_transient.hpp>
+#include <map>
+#include <unordered_map>
+
+namespace {
+
+template <typename Generator, typename Map>
+auto benchmark_insert_mut_std()
+{
+    return [](nonius::chronometer meter) {
+        auto n = meter.param<N>();
+        auto g = Generator{}(n);
+
+        measure(meter, [&] {
+            auto v = Map{};
+            for (auto i = 0u; i < n; ++i)
+                measure_op([&] { v[g[i]] = i; });
+            return v;
+        });
+    };
+}
+
+template <typename Generator, typename Map>
+auto benchmark_insert_mut()
+{
+    return [](nonius::chronometer meter) {
+        auto n = meter.param<N>();
+        auto g = Generator{}(n);
+
+        measure(meter, [&] {
+            auto v = Map{};
+            for (auto i = 0u; i < n; ++i)
+                measure_op([&] { v.set(g[i], i); });
+            return v;
+        });
+    };
+}
+
+template <typename Generator, typename Map>
+auto benchmark_insert()
+{
+    return [](nonius::chronometer meter) {
+        auto n = meter.param<N>();
+        auto g = Generator{}(n);
+
+        measure(meter, [&] {
+            auto v = Map{};
+            for (auto i = 0u; i < n; ++i)
+                measure_op([&] { v = v.set(g[i], i); });
+            return v;
+        });
+    };
+}
+
+template <typename Generator, typename Map>
+auto benchmark_insert_move()
+{
+    return [](nonius::chronometer meter) {
+        auto n = meter.param<N>();
+        auto g = Generator{}(n);
+
+        measure(meter, [&] {
+            auto v = Map{};
+            for (auto i = 0u; i < n; ++i)
+                measure_op([&] { v = std::move(v).set(g[i], i); });
+            return v;
+        });
+    };
+}
+
+} // namespace
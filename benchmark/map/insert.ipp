@@ -0,0 +1,41 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include "insert.hpp"
+
+#ifndef GENERATOR_T
+#error "you must define a GENERATOR_T"
+#endif
+
+using generator__ = GENERATOR_T;
+using t__         = typename decltype(generator__{}(0))::value_type;
+
+// clang-format off
+NONIUS_BENCHMARK("std::map", benchmark_insert_mut_std<generator__, std::map<t__, unsigned>>())
+NONIUS_BENCHMARK("std::unordered_map", benchmark_insert_mut_std<generator__, std::unordered_map<t__, unsigned>>())
+NONIUS_BENCHMARK("boost::flat_map", benchmark_insert_mut_std<generator__, boost::container::flat_map<t__, unsigned>>())
+
+NONIUS_BENCHMARK("immer::map/5B", benchmark_insert<generator__, immer::map<t__, unsigned, std::hash<t__>,std::equal_to<t__>,def_memory,5>>())
+NONIUS_BENCHMARK("immer::map/4B", benchmark_insert<generator__, immer::map<t__, unsigned, std::hash<t__>,std::equal_to<t__>,def_memory,4>>())
+#ifndef DISABLE_GC_BENCHMARKS
+NONIUS_BENCHMARK("immer::map/GC", benchmark_insert<generator__, immer::map<t__, unsigned, std::hash<t__>,std::equal_to<t__>,gc_memory,5>>())
+#endif
+NONIUS_BENCHMARK("immer::map/UN", benchmark_insert<generator__, immer::map<t__, unsigned, std::hash<t__>,std::equal_to<t__>,unsafe_memory,5>>())
+
+NONIUS_BENCHMARK("immer::map/move/5B", benchmark_insert_move<generator__, immer::map<t__, unsigned, std::hash<t__>,std::equal_to<t__>,def_memory,5>>())
+NONIUS_BENCHMARK("immer::map/move/4B", benchmark_insert_move<generator__, immer::map<t__, unsigned, std::hash<t__>,std::equal_to<t__>,def_memory,4>>())
+NONIUS_BENCHMARK("immer::map/move/UN", benchmark_insert_move<generator__, immer::map<t__, unsigned, std::hash<t__>,std::equal_to<t__>,unsafe_memory,5>>())
+
+NONIUS_BENCHMARK("immer::map/tran/5B", benchmark_insert_mut<generator__, immer::map_transient<t__, unsigned, std::hash<t__>,std::equal_to<t__>,def_memory,5>>())
+NONIUS_BENCHMARK("immer::map/tran/4B", benchmark_insert_mut<generator__, immer::map_transient<t__, unsigned, std::hash<t__>,std::equal_to<t__>,def_memory,4>>())
+#ifndef DISABLE_GC_BENCHMARKS
+NONIUS_BENCHMARK("immer::map/tran/GC", benchmark_insert_mut<generator__, immer::map_transient<t__, unsigned, std::hash<t__>,std::equal_to<t__>,gc_memory,5>>())
+#endif
+NONIUS_BENCHMARK("immer::map/tran/UN", benchmark_insert_mut<generator__, immer::map_transient<t__, unsigned, std::hash<t__>,std::equal_to<t__>,unsafe_memory,5>>())
+
+// clang-format on
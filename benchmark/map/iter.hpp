@@ -0,0 +1,87 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include "benchmark/config.hpp"
+
+#include <boost/container/flat_map.hpp>
+#include <immer/algorithm.hpp>
+#include <immer/map.hpp>
+#include <map>
+#include <numeric>
+#include <unordered_map>
+
+namespace {
+
+struct iter_step
+{
+    template <typename Pair>
+    unsigned operator()(unsigned x, const Pair& y) const
+    {
+        return x + y.second;
+    }
+};
+
+template <typename Generator, typename Map>
+auto benchmark_access_std_iter()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g1 = Generator{}(n);
+
+        auto v = Map{};
+        for (auto i = 0u; i < n; ++i)
+            v[g1[i]] = i;
+
+        measure(meter, [&] {
+            volatile auto c =
+                std::accumulate(v.begin(), v.end(), 0u, iter_step{});
+            return c;
+        });
+    };
+}
+
+template <typename Generator, typename Map>
+auto benchmark_access_reduce()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g1 = Generator{}(n);
+
+        auto v = Map{};
+        for (auto i = 0u; i < n; ++i)
+            v = v.set(g1[i], i);
+
+        measure(meter, [&] {
+            volatile auto c = immer::accumulate(v, 0u, iter_step{});
+            return c;
+        });
+    };
+}
+
+template <typename Generator, typename Map>
+auto benchmark_access_iter()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g1 = Generator{}(n);
+
+        auto v = Map{};
+        for (auto i = 0u; i < n; ++i)
+            v = v.set(g1[i], i);
+
+        measure(meter, [&] {
+            volatile auto c =
+                std::accumulate(v.begin(), v.end(), 0u, iter_step{});
+            return c;
+        });
+    };
+}
+
+} // namespace
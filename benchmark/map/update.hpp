@@ -0,0 +1,183 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include "benchmark/config.hpp"
+
+#include <boost/container/flat_map.hpp>
+#include <immer/map.hpp>
+#include <immer/map_transient.hpp>
+#include <map>
+#include <unordered_map>
+
+namespace {
+
+// Every update touches keys that are in the map, half of the
+// `update_if_exists` ones touch keys that are not.
+
+struct inc_fn
+{
+    unsigned operator()(unsigned x) const { return x + 1; }
+};
+
+template <typename Generator, typename Map>
+auto benchmark_update_mut_std()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g  = Generator{}(n);
+        auto v_ = [&] {
+            auto v = Map{};
+            for (auto i = 0u; i < n; ++i)
+                v[g[i]] = i;
+            return v;
+        }();
+        measure(meter, [&] {
+            auto v = v_;
+            for (auto i = 0u; i < n; ++i)
+                measure_op([&] { ++v[g[i]]; });
+            return v;
+        });
+    };
+}
+
+template <typename Generator, typename Map>
+auto benchmark_update_if_exists_mut_std()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g  = Generator{}(n * 2);
+        auto v_ = [&] {
+            auto v = Map{};
+            for (auto i = 0u; i < n; ++i)
+                v[g[i]] = i;
+            return v;
+        }();
+        measure(meter, [&] {
+            auto v = v_;
+            for (auto i = 0u; i < n; ++i) {
+                measure_op([&] {
+                    auto it = v.find(g[i * 2]);
+                    if (it != v.end())
+                        ++it->second;
+                });
+            }
+            return v;
+        });
+    };
+}
+
+template <typename Generator, typename Map>
+auto make_update_map(const Generator& g, std::size_t n)
+{
+    auto v = Map{}.transient();
+    for (auto i = 0u; i < n; ++i)
+        v.set(g[i], i);
+    return v.persistent();
+}
+
+template <typename Generator, typename Map>
+auto benchmark_update()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g  = Generator{}(n);
+        auto v_ = make_update_map<decltype(g), Map>(g, n);
+        measure(meter, [&] {
+            auto v = v_;
+            for (auto i = 0u; i < n; ++i)
+                measure_op([&] { v = v.update(g[i], inc_fn{}); });
+            return v;
+        });
+    };
+}
+
+template <typename Generator, typename Map>
+auto benchmark_update_move()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g  = Generator{}(n);
+        auto v_ = make_update_map<decltype(g), Map>(g, n);
+        measure(meter, [&] {
+            auto v = v_;
+            for (auto i = 0u; i < n; ++i)
+                measure_op([&] { v = std::move(v).update(g[i], inc_fn{}); });
+            return v;
+        });
+    };
+}
+
+template <typename Generator, typename Map>
+auto benchmark_update_mut()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g  = Generator{}(n);
+        auto v_ = make_update_map<decltype(g), Map>(g, n);
+        measure(meter, [&] {
+            auto v = v_.transient();
+            for (auto i = 0u; i < n; ++i)
+                measure_op([&] { v.update(g[i], inc_fn{}); });
+            return v;
+        });
+    };
+}
+
+template <typename Generator, typename Map>
+auto benchmark_update_if_exists()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g  = Generator{}(n * 2);
+        auto v_ = make_update_map<decltype(g), Map>(g, n);
+        measure(meter, [&] {
+            auto v = v_;
+            for (auto i = 0u; i < n; ++i)
+                measure_op([&] { v = v.update_if_exists(g[i * 2], inc_fn{}); });
+            return v;
+        });
+    };
+}
+
+template <typename Generator, typename Map>
+auto benchmark_update_if_exists_move()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g  = Generator{}(n * 2);
+        auto v_ = make_update_map<decltype(g), Map>(g, n);
+        measure(meter, [&] {
+            auto v = v_;
+            for (auto i = 0u; i < n; ++i)
+                measure_op([&] {
+                    v = std::move(v).update_if_exists(g[i * 2], inc_fn{});
+                });
+            return v;
+        });
+    };
+}
+
+template <typename Generator, typename Map>
+auto benchmark_update_if_exists_mut()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g  = Generator{}(n * 2);
+        auto v_ = make_update_map<decltype(g), Map>(g, n);
+        measure(meter, [&] {
+            auto v = v_.transient();
+            for (auto i = 0u; i < n; ++i)
+                measure_op([&] { v.update_if_exists(g[i * 2], inc_fn{}); });
+            return v;
+        });
+    };
+}
+
+} // namespace
@@ -0,0 +1,310 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+//
+// Memory footprint of the containers for various branching factors.
+// Unlike the `benchmark/set/memory` experiments, which are meant to be
+// run inside massif, these count the bytes that the containers request
+// from their heap, through a heap adaptor, and print a table with:
+//
+// - bytes/elem: the bytes of a container of `N` elements, built with
+//   a transient, divided by `N`.
+//
+// - bytes/version: the unique bytes that each of `M` versions retains,
+//   when every version updates `S` random elements of the previous one
+//   and all of them are kept alive.  This is what a history of edits,
+//   like an undo stack, costs on top of the first version.
+//
+// The counts are of the memory requested by the nodes with the default
+// reference counting.  Free lists are left out, so that their caches do
+// not blur the numbers.  With a policy that does not count references
+// the garbage left by the transients would never be freed, so it would
+// be counted too.
+//
+
+#include <immer/flex_vector.hpp>
+#include <immer/flex_vector_transient.hpp>
+#include <immer/heap/cpp_heap.hpp>
+#include <immer/heap/heap_policy.hpp>
+#include <immer/map.hpp>
+#include <immer/map_transient.hpp>
+#include <immer/memory_policy.hpp>
+#include <immer/set.hpp>
+#include <immer/set_transient.hpp>
+#include <immer/table.hpp>
+#include <immer/table_transient.hpp>
+#include <immer/vector.hpp>
+#include <immer/vector_transient.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr auto N = std::size_t{1} << 16;
+constexpr auto M = std::size_t{1} << 8;
+constexpr auto S = std::size_t{1};
+
+template <typename Base>
+struct counting_heap : Base
+{
+    static std::size_t& live()
+    {
+        static auto bytes = std::size_t{};
+        return bytes;
+    }
+
+    template <typename... Tags>
+    static void* allocate(std::size_t size, Tags... tags)
+    {
+        auto p = Base::allocate(size, tags...);
+        live() += size;
+        return p;
+    }
+
+    template <typename... Tags>
+    static void deallocate(std::size_t size, void* data, Tags... tags)
+    {
+        Base::deallocate(size, data, tags...);
+        live() -= size;
+    }
+};
+
+using heap_t = counting_heap<immer::cpp_heap>;
+
+using memory_t = immer::memory_policy<immer::heap_policy<heap_t>,
+                                      immer::refcount_policy,
+                                      immer::default_lock_policy>;
+
+struct generate_unsigned
+{
+    auto operator()() const
+    {
+        auto engine = std::default_random_engine{42};
+        auto dist   = std::uniform_int_distribution<unsigned>{};
+        return std::bind(dist, engine);
+    }
+};
+
+struct generate_string_short
+{
+    static constexpr auto char_set =
+        "_-0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+    static constexpr auto max_length = 15;
+    static constexpr auto min_length = 4;
+
+    auto operator()() const
+    {
+        auto gen = generate_unsigned{}();
+        return [=]() mutable {
+            auto len = gen() % (max_length - min_length) + min_length;
+            auto str = std::string(len, ' ');
+            std::generate_n(str.begin(), len, [&] {
+                return char_set[gen() % sizeof(char_set)];
+            });
+            return str;
+        };
+    }
+};
+
+template <typename K>
+struct row
+{
+    K id;
+    unsigned value;
+};
+
+// The values to put in the containers, generated before measuring.
+// The keys are distinct, so that the containers have `N` elements.
+template <typename T>
+struct data
+{
+    std::vector<T> keys;
+    std::vector<std::size_t> picks;
+
+    template <typename Generator>
+    static data make()
+    {
+        auto g    = Generator{}();
+        auto ug   = generate_unsigned{}();
+        auto seen = immer::set<T>{}.transient();
+        auto r    = data{};
+        while (r.keys.size() < N) {
+            auto k = g();
+            if (!seen.count(k)) {
+                seen.insert(k);
+                r.keys.push_back(std::move(k));
+            }
+        }
+        for (auto i = std::size_t{}; i < M * S; ++i)
+            r.picks.push_back(ug() % N);
+        return r;
+    }
+};
+
+struct vector_ops
+{
+    template <typename Tr, typename T>
+    static void add(Tr& t, const data<T>& d, std::size_t i)
+    {
+        t.push_back(d.keys[i]);
+    }
+
+    template <typename Tr, typename T>
+    static void update(Tr& t, const data<T>& d, std::size_t j)
+    {
+        t.set(d.picks[j], d.keys[(d.picks[j] + 1) % N]);
+    }
+};
+
+struct map_ops
+{
+    template <typename Tr, typename T>
+    static void add(Tr& t, const data<T>& d, std::size_t i)
+    {
+        t.set(d.keys[i], static_cast<unsigned>(i));
+    }
+
+    template <typename Tr, typename T>
+    static void update(Tr& t, const data<T>& d, std::size_t j)
+    {
+        t.update(d.keys[d.picks[j]], [](unsigned x) { return x + 1; });
+    }
+};
+
+struct table_ops
+{
+    template <typename Tr, typename T>
+    static void add(Tr& t, const data<T>& d, std::size_t i)
+    {
+        t.insert({d.keys[i], static_cast<unsigned>(i)});
+    }
+
+    template <typename Tr, typename T>
+    static void update(Tr& t, const data<T>& d, std::size_t j)
+    {
+        t.update(d.keys[d.picks[j]], [](auto r) {
+            ++r.value;
+            return r;
+        });
+    }
+};
+
+// sets can not update an element, their versions erase one and insert
+// it back, which touches the same nodes twice
+struct set_ops
+{
+    template <typename Tr, typename T>
+    static void add(Tr& t, const data<T>& d, std::size_t i)
+    {
+        t.insert(d.keys[i]);
+    }
+
+    template <typename Tr, typename T>
+    static void update(Tr& t, const data<T>& d, std::size_t j)
+    {
+        t.erase(d.keys[d.picks[j]]);
+        t.insert(d.keys[d.picks[j]]);
+    }
+};
+
+inline void report_header()
+{
+    std::printf(
+        "%-40s %12s %14s\n", "container", "bytes/elem", "bytes/version");
+}
+
+template <typename Container, typename Ops, typename T>
+void measure(const char* name, Ops, const data<T>& d)
+{
+    auto& live = heap_t::live();
+    auto start = live;
+    auto first = [&] {
+        auto t = Container{}.transient();
+        for (auto i = std::size_t{}; i < N; ++i)
+            Ops::add(t, d, i);
+        return t.persistent();
+    }();
+    auto built = live;
+
+    auto versions = std::vector<Container>{};
+    versions.reserve(M);
+    auto v = first;
+    for (auto m = std::size_t{}; m < M; ++m) {
+        auto t = v.transient();
+        for (auto s = std::size_t{}; s < S; ++s)
+            Ops::update(t, d, m * S + s);
+        v = t.persistent();
+        versions.push_back(v);
+    }
+    auto retained = live;
+
+    std::printf("%-40s %12.2f %14.1f\n",
+                name,
+                double(built - start) / N,
+                double(retained - built) / M);
+    std::fflush(stdout);
+}
+
+template <typename T>
+int main_footprint(const data<T>& d)
+{
+    using immer::flex_vector;
+    using immer::map;
+    using immer::set;
+    using immer::table;
+    using immer::vector;
+    using hash_t  = std::hash<T>;
+    using equal_t = std::equal_to<T>;
+    using row_t   = row<T>;
+    using key_fn  = immer::table_key_fn;
+    using mem_t   = memory_t;
+
+    report_header();
+
+    // the default BL makes the leaves as big as the inner nodes
+    measure<vector<T, mem_t, 4>>("vector/B4", vector_ops{}, d);
+    measure<vector<T, mem_t, 5>>("vector/B5", vector_ops{}, d);
+    measure<vector<T, mem_t, 6>>("vector/B6", vector_ops{}, d);
+    measure<vector<T, mem_t, 5, 2>>("vector/B5/BL2", vector_ops{}, d);
+    measure<vector<T, mem_t, 5, 4>>("vector/B5/BL4", vector_ops{}, d);
+    measure<vector<T, mem_t, 5, 7>>("vector/B5/BL7", vector_ops{}, d);
+
+    measure<flex_vector<T, mem_t, 4>>("flex_vector/B4", vector_ops{}, d);
+    measure<flex_vector<T, mem_t, 5>>("flex_vector/B5", vector_ops{}, d);
+    measure<flex_vector<T, mem_t, 6>>("flex_vector/B6", vector_ops{}, d);
+
+    measure<map<T, unsigned, hash_t, equal_t, mem_t, 3>>(
+        "map/B3", map_ops{}, d);
+    measure<map<T, unsigned, hash_t, equal_t, mem_t, 4>>(
+        "map/B4", map_ops{}, d);
+    measure<map<T, unsigned, hash_t, equal_t, mem_t, 5>>(
+        "map/B5", map_ops{}, d);
+    measure<map<T, unsigned, hash_t, equal_t, mem_t, 6>>(
+        "map/B6", map_ops{}, d);
+
+    measure<table<row_t, key_fn, hash_t, equal_t, mem_t, 4>>(
+        "table/B4", table_ops{}, d);
+    measure<table<row_t, key_fn, hash_t, equal_t, mem_t, 5>>(
+        "table/B5", table_ops{}, d);
+    measure<table<row_t, key_fn, hash_t, equal_t, mem_t, 6>>(
+        "table/B6", table_ops{}, d);
+
+    measure<set<T, hash_t, equal_t, mem_t, 4>>("set/B4", set_ops{}, d);
+    measure<set<T, hash_t, equal_t, mem_t, 5>>("set/B5", set_ops{}, d);
+    measure<set<T, hash_t, equal_t, mem_t, 6>>("set/B6", set_ops{}, d);
+    return 0;
+}
+
+} // namespace
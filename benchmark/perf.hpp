@@ -0,0 +1,195 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+// Hardware event counters for the benchmarks, enabled on Linux with the
+// `BENCHMARK_PERF_COUNTERS` CMake option.  Every call to `measure()` is
+// wrapped in the counters of the events below, and the reporters of
+// `benchmark/report.hpp` write the counts per run of every benchmark in
+// their JSON file, as in:
+//
+//     "per_run": {"cycles": 812.5, "instructions": 1534.2, ...}
+//
+// The counts include the warmup runs that nonius does to plan the
+// samples, which do the same work.  Events that the machine can not
+// count, or that the user is not allowed to, because of
+// `/proc/sys/kernel/perf_event_paranoid`, are `null`.  Only the events
+// in user space are counted.
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+struct perf_event_kind
+{
+    const char* name;
+    std::uint32_t type;
+    std::uint64_t config;
+};
+
+constexpr std::uint64_t perf_read_misses(std::uint64_t cache)
+{
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+constexpr perf_event_kind perf_events[] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"l1d_misses",
+     PERF_TYPE_HW_CACHE,
+     perf_read_misses(PERF_COUNT_HW_CACHE_L1D)},
+    {"llc_misses",
+     PERF_TYPE_HW_CACHE,
+     perf_read_misses(PERF_COUNT_HW_CACHE_LL)},
+    {"dtlb_misses",
+     PERF_TYPE_HW_CACHE,
+     perf_read_misses(PERF_COUNT_HW_CACHE_DTLB)},
+};
+
+constexpr auto perf_event_count = sizeof(perf_events) / sizeof(perf_events[0]);
+
+// the counts of the events, negative for those that were not counted
+using perf_values = std::array<double, perf_event_count>;
+
+/*!
+ * The counters of the events of this thread.  Every event has its own
+ * counter, so that the ones that can be counted are even when others
+ * can not, and the counts are scaled by the time that they ran, in case
+ * the kernel had to multiplex them.
+ */
+class perf_counters
+{
+public:
+    static perf_counters& instance()
+    {
+        static perf_counters counters;
+        return counters;
+    }
+
+    void start()
+    {
+        for (auto fd : fds_) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+    }
+
+    perf_values stop()
+    {
+        for (auto fd : fds_)
+            if (fd >= 0)
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        auto r = perf_values{};
+        for (auto i = std::size_t{}; i < perf_event_count; ++i) {
+            // value, time enabled, time running
+            std::uint64_t data[3] = {};
+            r[i]                  = -1;
+            if (fds_[i] >= 0 &&
+                read(fds_[i], data, sizeof(data)) == sizeof(data) && data[2])
+                r[i] = double(data[0]) * double(data[1]) / double(data[2]);
+        }
+        return r;
+    }
+
+    perf_counters(const perf_counters&) = delete;
+    perf_counters& operator=(const perf_counters&) = delete;
+
+private:
+    perf_counters()
+    {
+        for (auto i = std::size_t{}; i < perf_event_count; ++i) {
+            auto attr           = perf_event_attr{};
+            attr.size           = sizeof(attr);
+            attr.type           = perf_events[i].type;
+            attr.config         = perf_events[i].config;
+            attr.disabled       = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv     = 1;
+            attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                               PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds_[i] = static_cast<int>(
+                syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+            if (fds_[i] < 0)
+                std::cerr << "perf: can not count " << perf_events[i].name
+                          << ": " << std::strerror(errno) << std::endl;
+        }
+    }
+
+    ~perf_counters()
+    {
+        for (auto fd : fds_)
+            if (fd >= 0)
+                close(fd);
+    }
+
+    std::array<int, perf_event_count> fds_;
+};
+
+// the counts of a benchmark and the runs that it did meanwhile
+struct perf_totals
+{
+    std::uint64_t runs = 0;
+    perf_values counts = {};
+};
+
+// where the counts of the benchmark that is running go, set by the
+// reporter
+inline perf_totals*& perf_current()
+{
+    static perf_totals* current = nullptr;
+    return current;
+}
+
+/*!
+ * Counts the events while it lives and adds them to the benchmark that
+ * is running, which does `runs` runs meanwhile.
+ */
+class perf_scope
+{
+public:
+    explicit perf_scope(int runs)
+        : runs_{runs}
+    {
+        perf_counters::instance().start();
+    }
+
+    ~perf_scope()
+    {
+        auto counts = perf_counters::instance().stop();
+        auto t      = perf_current();
+        if (!t)
+            return;
+        t->runs += runs_;
+        for (auto i = std::size_t{}; i < perf_event_count; ++i)
+            t->counts[i] = counts[i] < 0 || t->counts[i] < 0
+                               ? -1
+                               : t->counts[i] + counts[i];
+    }
+
+    perf_scope(const perf_scope&) = delete;
+    perf_scope& operator=(const perf_scope&) = delete;
+
+private:
+    int runs_;
+};
+
+} // anonymous namespace
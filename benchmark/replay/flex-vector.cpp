@@ -0,0 +1,220 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include "replay.hpp"
+
+#include <immer/box.hpp>
+#include <immer/flex_vector.hpp>
+
+namespace {
+
+// The operations of `extra/fuzzer/flex-vector.cpp`, in the same order,
+// and the reads, which the fuzzer does not do.
+struct flex_vector_workload
+{
+    static constexpr auto name      = "flex_vector";
+    static constexpr auto var_count = 8;
+    static constexpr auto max_size  = std::size_t{1} << 20;
+
+    template <typename Memory>
+    using vars = std::array<immer::flex_vector<int, Memory>, var_count>;
+
+    enum ops
+    {
+        op_push_back,
+        op_update,
+        op_take,
+        op_drop,
+        op_concat,
+        op_push_back_move,
+        op_update_move,
+        op_take_move,
+        op_drop_move,
+        op_concat_move_l,
+        op_concat_move_r,
+        op_concat_move_lr,
+        op_insert,
+        op_erase,
+        op_compare,
+        op_read,
+    };
+
+    template <typename Vars>
+    static replay_op decode(fuzzer_input& in, const Vars& vs)
+    {
+        auto is_valid_var = [&](auto idx) {
+            return idx >= 0 && idx < var_count;
+        };
+        auto is_valid_var_neq = [](auto other) {
+            return [=](auto idx) {
+                return idx >= 0 && idx < var_count && idx != other;
+            };
+        };
+        auto is_valid_index = [](auto& v) {
+            return [&](auto idx) { return idx >= 0 && idx < v.size(); };
+        };
+        auto is_valid_size = [](auto& v) {
+            return [&](auto idx) { return idx >= 0 && idx <= v.size(); };
+        };
+        auto src = read<char>(in, is_valid_var);
+        auto dst = read<char>(in, is_valid_var);
+        auto op  = replay_op{std::uint8_t(read<char>(in)),
+                            std::uint8_t(src),
+                            std::uint8_t(dst),
+                            0,
+                            0};
+        switch (op.code) {
+        case op_update:
+        case op_update_move:
+        case op_erase:
+            op.arg = read<std::uint8_t>(in, is_valid_index(vs[src]));
+            break;
+        case op_take:
+        case op_drop:
+        case op_take_move:
+        case op_drop_move:
+        case op_insert:
+            op.arg = read<std::uint8_t>(in, is_valid_size(vs[src]));
+            break;
+        case op_concat:
+            op.src2 = read<char>(in, is_valid_var);
+            break;
+        case op_concat_move_l:
+        case op_concat_move_r:
+        case op_concat_move_lr:
+            op.src2 = read<char>(in, is_valid_var_neq(src));
+            break;
+        default:
+            break;
+        }
+        return op;
+    }
+
+    // Mostly reads and updates, with some growth, snapshots and drops.
+    template <typename Engine, typename Vars>
+    static replay_op generate(Engine& e, const Vars& vs)
+    {
+        auto var  = std::uniform_int_distribution<int>{0, var_count - 1};
+        auto dice = std::uniform_int_distribution<int>{0, 99};
+        auto src  = std::uint8_t(var(e));
+        auto op   = replay_op{0, src, std::uint8_t(var(e)), 0, 0};
+        auto& v   = vs[src];
+        auto roll = dice(e);
+        if (v.empty() || roll < 20)
+            op.code = v.size() < max_size ? op_push_back_move : op_take_move;
+        else if (roll < 60)
+            op.code = op_read;
+        else if (roll < 80)
+            op.code = op_update_move;
+        else if (roll < 90)
+            op.code = op_update;
+        else if (roll < 92)
+            op.code = dice(e) < 50 ? op_take : op_drop;
+        else if (roll < 96)
+            op.code = op_concat;
+        else
+            op.code = dice(e) < 50 ? op_insert : op_erase;
+        switch (op.code) {
+        case op_read:
+        case op_update:
+        case op_update_move:
+        case op_erase:
+            op.arg = std::uniform_int_distribution<std::size_t>{
+                0, v.size() - 1}(e);
+            break;
+        case op_take:
+        case op_drop:
+        case op_take_move:
+        case op_insert:
+            op.arg =
+                std::uniform_int_distribution<std::size_t>{0, v.size()}(e);
+            break;
+        case op_concat:
+            op.src2 = std::uint8_t(var(e));
+            break;
+        default:
+            break;
+        }
+        return op;
+    }
+
+    template <typename Vars>
+    static void apply(Vars& vs, const replay_op& op)
+    {
+        auto can_concat = [](auto&& v1, auto&& v2) {
+            return v1.size() + v2.size() < max_size;
+        };
+        auto can_compare = [](auto&& v) { return v.size() < (1 << 15); };
+        auto inc         = [](auto x) { return x + 1; };
+        auto& src        = vs[op.src];
+        auto& dst        = vs[op.dst];
+        auto& src2       = vs[op.src2];
+        switch (op.code) {
+        case op_push_back:
+            dst = src.push_back(42);
+            break;
+        case op_update:
+            dst = src.update(op.arg, inc);
+            break;
+        case op_take:
+            dst = src.take(op.arg);
+            break;
+        case op_drop:
+            dst = src.drop(op.arg);
+            break;
+        case op_concat:
+            if (can_concat(src, src2))
+                dst = src + src2;
+            break;
+        case op_push_back_move:
+            dst = std::move(src).push_back(21);
+            break;
+        case op_update_move:
+            dst = std::move(src).update(op.arg, inc);
+            break;
+        case op_take_move:
+            dst = std::move(src).take(op.arg);
+            break;
+        case op_drop_move:
+            dst = std::move(src).drop(op.arg);
+            break;
+        case op_concat_move_l:
+            if (can_concat(src, src2))
+                dst = std::move(src) + src2;
+            break;
+        case op_concat_move_r:
+            if (can_concat(src, src2))
+                dst = src + std::move(src2);
+            break;
+        case op_concat_move_lr:
+            if (can_concat(src, src2))
+                dst = std::move(src) + std::move(src2);
+            break;
+        case op_compare:
+            if (can_compare(src) && src == dst)
+                std::swap(src, dst);
+            break;
+        case op_erase:
+            dst = src.erase(op.arg);
+            break;
+        case op_insert:
+            dst = src.insert(op.arg, immer::box<int>{42});
+            break;
+        case op_read:
+            if (src[op.arg] == 0)
+                dst = src;
+            break;
+        default:
+            break;
+        }
+    }
+};
+
+} // namespace
+
+int main() { return main_replay<flex_vector_workload>(); }
@@ -0,0 +1,165 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include "replay.hpp"
+
+#include <immer/algorithm.hpp>
+#include <immer/map.hpp>
+
+namespace {
+
+// The operations of `extra/fuzzer/map.cpp`, in the same order, but with
+// the default hash, so that the keys do not collide.
+struct map_workload
+{
+    static constexpr auto name      = "map";
+    static constexpr auto var_count = 4;
+    static constexpr auto key_count = std::size_t{1} << 16;
+
+    template <typename Memory>
+    using vars = std::array<immer::map<std::size_t,
+                                       int,
+                                       std::hash<std::size_t>,
+                                       std::equal_to<std::size_t>,
+                                       Memory>,
+                            var_count>;
+
+    enum ops
+    {
+        op_set,
+        op_erase,
+        op_set_move,
+        op_erase_move,
+        op_iterate,
+        op_find,
+        op_update,
+        op_update_move,
+        op_update_if_exists,
+        op_update_if_exists_move,
+        op_diff,
+    };
+
+    template <typename Vars>
+    static replay_op decode(fuzzer_input& in, const Vars&)
+    {
+        auto is_valid_var = [&](auto idx) {
+            return idx >= 0 && idx < var_count;
+        };
+        auto src = read<char>(in, is_valid_var);
+        auto dst = read<char>(in, is_valid_var);
+        auto op  = replay_op{std::uint8_t(read<char>(in)),
+                            std::uint8_t(src),
+                            std::uint8_t(dst),
+                            0,
+                            0};
+        switch (op.code) {
+        case op_set:
+        case op_erase:
+        case op_set_move:
+        case op_erase_move:
+        case op_find:
+        case op_update:
+        case op_update_move:
+        case op_update_if_exists:
+        case op_update_if_exists_move:
+            op.arg = read<std::size_t>(in);
+            break;
+        default:
+            break;
+        }
+        return op;
+    }
+
+    // Mostly lookups and updates in place, with some snapshots, which
+    // update a copy into another variable, and some drops.
+    template <typename Engine, typename Vars>
+    static replay_op generate(Engine& e, const Vars&)
+    {
+        auto var  = std::uniform_int_distribution<int>{0, var_count - 1};
+        auto key  = std::uniform_int_distribution<std::size_t>{0, key_count};
+        auto dice = std::uniform_int_distribution<int>{0, 99};
+        auto op   = replay_op{0, std::uint8_t(var(e)), 0, 0, key(e)};
+        auto roll = dice(e);
+        op.dst    = roll < 90 ? op.src : std::uint8_t(var(e));
+        if (roll < 40)
+            op.code = op_find;
+        else if (roll < 60)
+            op.code = op_set_move;
+        else if (roll < 80)
+            op.code = op_update_if_exists_move;
+        else if (roll < 90)
+            op.code = op_erase_move;
+        else if (roll < 98)
+            op.code = op_update;
+        else
+            op.code = op_diff;
+        return op;
+    }
+
+    template <typename Vars>
+    static void apply(Vars& vs, const replay_op& op)
+    {
+        auto inc  = [](int x) { return x + 1; };
+        auto& src = vs[op.src];
+        auto& dst = vs[op.dst];
+        switch (op.code) {
+        case op_set:
+            dst = src.set(op.arg, 42);
+            break;
+        case op_erase:
+            dst = src.erase(op.arg);
+            break;
+        case op_set_move:
+            dst = std::move(src).set(op.arg, 42);
+            break;
+        case op_erase_move:
+            dst = std::move(src).erase(op.arg);
+            break;
+        case op_iterate: {
+            auto srcv = src;
+            for (const auto& v : srcv)
+                dst = dst.set(v.first, v.second);
+            break;
+        }
+        case op_find:
+            if (auto res = src.find(op.arg))
+                dst = dst.set(*res, 42);
+            break;
+        case op_update:
+            dst = src.update(op.arg, inc);
+            break;
+        case op_update_move:
+            dst = std::move(src).update(op.arg, inc);
+            break;
+        case op_update_if_exists:
+            dst = src.update_if_exists(op.arg, inc);
+            break;
+        case op_update_if_exists_move:
+            dst = std::move(src).update_if_exists(op.arg, inc);
+            break;
+        case op_diff: {
+            auto changes = std::size_t{};
+            immer::diff(
+                src,
+                dst,
+                [&](auto&&) { ++changes; },
+                [&](auto&&) { ++changes; },
+                [&](auto&&, auto&&) { ++changes; });
+            if (changes == 0 && op.src != op.dst)
+                dst = src;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+};
+
+} // namespace
+
+int main() { return main_replay<map_workload>(); }
@@ -0,0 +1,234 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+//
+// Replays of logs of operations that mix reads, updates, snapshots and
+// drops on a few variables, like a program does, instead of timing one
+// operation at a time.  The logs are read in the input format of the
+// fuzzers in `extra/fuzzer`, so that their corpora double as workloads,
+// from the files in the `IMMER_REPLAY_TRACES` environment variable,
+// separated by `:`.  When there are none, a log of `replay_ops` random
+// operations is generated instead.
+//
+// A log is first recorded, by running it once on the default
+// containers, to resolve the choices that depend on their state, like
+// the indices that the fuzzers skip when they are out of bounds.  Then
+// it is replayed with every memory policy, and for every tenth of it a
+// table shows:
+//
+// - Mops/s: the operations per second during that tenth.
+//
+// - live KiB: the memory requested from the heap at the end of it, by
+//   the nodes that are alive and, for the free lists, the ones that
+//   they keep for later.
+//
+// The memory is counted by a heap adaptor below the free lists, thus
+// the policies that are based on a garbage collector are left out.
+//
+
+#include "extra/fuzzer/fuzzer_input.hpp"
+
+#include <immer/heap/cpp_heap.hpp>
+#include <immer/heap/heap_policy.hpp>
+#include <immer/memory_policy.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr auto replay_ops     = std::size_t{1} << 18;
+constexpr auto replay_windows = std::size_t{10};
+
+// One operation of a log, with all its choices resolved.  The meaning
+// of the fields depends on the `code`.
+struct replay_op
+{
+    std::uint8_t code;
+    std::uint8_t src;
+    std::uint8_t dst;
+    std::uint8_t src2;
+    std::size_t arg;
+};
+
+using replay_log = std::vector<replay_op>;
+
+template <typename Tag>
+struct counting_heap : immer::cpp_heap
+{
+    static std::size_t& live()
+    {
+        static auto bytes = std::size_t{};
+        return bytes;
+    }
+
+    template <typename... Tags>
+    static void* allocate(std::size_t size, Tags... tags)
+    {
+        auto p = immer::cpp_heap::allocate(size, tags...);
+        live() += size;
+        return p;
+    }
+
+    template <typename... Tags>
+    static void deallocate(std::size_t size, void* data, Tags... tags)
+    {
+        immer::cpp_heap::deallocate(size, data, tags...);
+        live() -= size;
+    }
+};
+
+struct basic_tag
+{};
+struct safe_tag
+{};
+struct unsafe_tag
+{};
+
+using basic_heap  = counting_heap<basic_tag>;
+using safe_heap   = counting_heap<safe_tag>;
+using unsafe_heap = counting_heap<unsafe_tag>;
+
+using basic_memory = immer::memory_policy<immer::heap_policy<basic_heap>,
+                                          immer::refcount_policy,
+                                          immer::default_lock_policy>;
+using safe_memory =
+    immer::memory_policy<immer::free_list_heap_policy<safe_heap>,
+                         immer::refcount_policy,
+                         immer::default_lock_policy>;
+using unsafe_memory =
+    immer::memory_policy<immer::unsafe_free_list_heap_policy<unsafe_heap>,
+                         immer::unsafe_refcount_policy,
+                         immer::default_lock_policy>;
+
+inline std::vector<std::string> replay_trace_files()
+{
+    auto r   = std::vector<std::string>{};
+    auto env = std::getenv("IMMER_REPLAY_TRACES");
+    if (!env)
+        return r;
+    auto s = std::string{env};
+    for (auto pos = std::size_t{}; pos <= s.size();) {
+        auto end = s.find(':', pos);
+        if (end == std::string::npos)
+            end = s.size();
+        if (end > pos)
+            r.push_back(s.substr(pos, end - pos));
+        pos = end + 1;
+    }
+    return r;
+}
+
+inline std::vector<std::uint8_t> replay_load(const std::string& path)
+{
+    auto f = std::ifstream{path, std::ios::binary};
+    return {std::istreambuf_iterator<char>{f},
+            std::istreambuf_iterator<char>{}};
+}
+
+// The variables that a log is recorded with.
+template <typename Workload>
+using recording_vars =
+    typename Workload::template vars<immer::default_memory_policy>;
+
+// Reads a log in the fuzzer format of the `Workload`, recording every
+// step that it does, until the input is over.
+template <typename Workload>
+replay_log replay_record(const std::vector<std::uint8_t>& bytes)
+{
+    auto log  = replay_log{};
+    auto vars = recording_vars<Workload>{};
+    auto in   = fuzzer_input{bytes.data(), bytes.size()};
+    try {
+        for (;;) {
+            auto op = Workload::decode(in, vars);
+            Workload::apply(vars, op);
+            log.push_back(op);
+        }
+    } catch (const no_more_input&) {}
+    return log;
+}
+
+template <typename Workload>
+replay_log replay_generate()
+{
+    auto log    = replay_log{};
+    auto vars   = recording_vars<Workload>{};
+    auto engine = std::default_random_engine{42};
+    log.reserve(replay_ops);
+    while (log.size() < replay_ops) {
+        auto op = Workload::generate(engine, vars);
+        Workload::apply(vars, op);
+        log.push_back(op);
+    }
+    return log;
+}
+
+template <typename Workload, typename Memory, typename Heap>
+void replay_measure(const char* policy, const replay_log& log)
+{
+    using clock_t = std::chrono::steady_clock;
+
+    auto start  = double(Heap::live());
+    auto window = (log.size() + replay_windows - 1) / replay_windows;
+    std::printf("%s/%s\n", Workload::name, policy);
+    std::printf("%12s %10s %10s\n", "ops", "Mops/s", "live KiB");
+    {
+        auto vars = typename Workload::template vars<Memory>{};
+        for (auto first = std::size_t{}; first < log.size(); first += window) {
+            auto last = std::min(log.size(), first + window);
+            auto t0   = clock_t::now();
+            for (auto i = first; i < last; ++i)
+                Workload::apply(vars, log[i]);
+            auto secs = std::chrono::duration<double>(clock_t::now() - t0);
+            std::printf("%12zu %10.2f %10.1f\n",
+                        last,
+                        (last - first) / secs.count() / 1e6,
+                        (Heap::live() - start) / 1024);
+        }
+    }
+    std::printf("%12s %10s %10.1f\n\n",
+                "released",
+                "",
+                (Heap::live() - start) / 1024);
+    std::fflush(stdout);
+}
+
+template <typename Workload>
+void replay_all(const char* trace, const replay_log& log)
+{
+    std::printf("# %s: %zu operations\n\n", trace, log.size());
+    replay_measure<Workload, basic_memory, basic_heap>("basic", log);
+    replay_measure<Workload, safe_memory, safe_heap>("free_list", log);
+    replay_measure<Workload, unsafe_memory, unsafe_heap>("unsafe", log);
+}
+
+template <typename Workload>
+int main_replay()
+{
+    auto files = replay_trace_files();
+    if (files.empty())
+        replay_all<Workload>("random", replay_generate<Workload>());
+    for (auto& f : files)
+        replay_all<Workload>(f.c_str(),
+                             replay_record<Workload>(replay_load(f)));
+    return 0;
+}
+
+} // namespace
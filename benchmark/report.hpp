@@ -0,0 +1,292 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+// Machine readable reports of the benchmarks.  The `html-json` and
+// `json` reporters, which otherwise behave like `html` and `standard`,
+// also write the samples of every benchmark, in nanoseconds per run, in
+// a JSON file next to the output file, `<target>.json`, or in the
+// standard output when there is none:
+//
+//     {"rounds": [{"params": {"N": "1000"},
+//                  "benchmarks": [{"name": "flex/immer",
+//                                  "samples": [812.5, 809.1, ...]}]}]}
+//
+// Benchmarks that failed have no samples.  With the
+// `BENCHMARK_PERF_COUNTERS` option every benchmark also has the
+// `"runs"` that it did and the hardware events `"per_run"`, see
+// `benchmark/perf.hpp`.  With the `BENCHMARK_LATENCY` option they
+// also have the percentiles of the `"latency"` of the single operations,
+// which are printed after the results of every benchmark too, see
+// `benchmark/latency.hpp`.  `tools/compare-benchmark-reports.py`
+// compares the files of two report directories.
+
+#include <nonius.h++>
+
+#if IMMER_BENCHMARK_PERF_COUNTERS
+#include "benchmark/perf.hpp"
+#endif
+
+#if IMMER_BENCHMARK_LATENCY
+#include "benchmark/latency.hpp"
+#endif
+
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct report_benchmark
+{
+    std::string name;
+    std::vector<double> samples = {};
+#if IMMER_BENCHMARK_PERF_COUNTERS
+    perf_totals perf = {};
+#endif
+#if IMMER_BENCHMARK_LATENCY
+    latency_histogram latency = {};
+#endif
+};
+
+struct report_round
+{
+    std::string params;
+    std::vector<report_benchmark> benchmarks;
+};
+
+inline std::string report_json_string(const std::string& s)
+{
+    auto r = std::string{"\""};
+    for (auto c : s) {
+        if (c == '"' || c == '\\')
+            r += '\\';
+        r += c;
+    }
+    return r + "\"";
+}
+
+#if IMMER_BENCHMARK_LATENCY
+constexpr struct
+{
+    const char* name;
+    double p;
+} report_percentiles[] = {
+    {"p50", 0.5}, {"p90", 0.9}, {"p99", 0.99}, {"p999", 0.999}};
+
+inline void report_write_latency(std::ostream& os, const latency_histogram& h)
+{
+    auto ns = latency_ns_per_tick();
+    os << "{\"count\": " << h.count();
+    for (auto& p : report_percentiles)
+        os << ", \"" << p.name << "\": " << double(h.percentile(p.p)) * ns;
+    os << ", \"max\": " << double(h.max()) * ns << "}";
+}
+#endif
+
+inline void report_write_json(std::ostream& os,
+                              const std::vector<report_round>& rounds)
+{
+    os.precision(6);
+    os << "{\"rounds\": [";
+    auto first_round = true;
+    for (auto& r : rounds) {
+        os << (first_round ? "" : ",\n  ") << "{\"params\": {" << r.params
+           << "},\n   \"benchmarks\": [";
+        first_round      = false;
+        auto first_bench = true;
+        for (auto& b : r.benchmarks) {
+            os << (first_bench ? "" : ",\n    ")
+               << "{\"name\": " << report_json_string(b.name)
+               << ", \"samples\": [";
+            first_bench = false;
+            for (auto i = std::size_t{}; i < b.samples.size(); ++i)
+                os << (i ? ", " : "") << b.samples[i];
+            os << "]";
+#if IMMER_BENCHMARK_PERF_COUNTERS
+            os << ", \"runs\": " << b.perf.runs << ", \"per_run\": {";
+            for (auto i = std::size_t{}; i < perf_event_count; ++i) {
+                os << (i ? ", " : "")
+                   << report_json_string(perf_events[i].name) << ": ";
+                if (b.perf.counts[i] < 0 || !b.perf.runs)
+                    os << "null";
+                else
+                    os << b.perf.counts[i] / b.perf.runs;
+            }
+            os << "}";
+#endif
+#if IMMER_BENCHMARK_LATENCY
+            os << ", \"latency\": ";
+            report_write_latency(os, b.latency);
+#endif
+            os << "}";
+        }
+        os << "]}";
+    }
+    os << "]}\n";
+}
+
+/*!
+ * Reporter that reports like `Reporter` and also records the samples
+ * of every benchmark, which it writes when the suite is complete, in a
+ * JSON file next to the output file of `Reporter`.
+ */
+template <typename Reporter>
+struct json_reporter : nonius::reporter
+{
+    std::string description() override
+    {
+        auto& inner = static_cast<nonius::reporter&>(inner_);
+        return inner.description() + ", and the samples in a JSON file";
+    }
+
+private:
+    void do_configure(nonius::configuration& cfg) override
+    {
+        inner_.configure(cfg);
+        output_ = cfg.output_file;
+        if (!output_.empty()) {
+            auto dot = output_.find_last_of('.');
+            if (dot != std::string::npos &&
+                output_.find('/', dot) == std::string::npos)
+                output_.erase(dot);
+            output_ += ".json";
+        }
+    }
+
+    void do_warmup_start() override { inner_.warmup_start(); }
+    void do_warmup_end(int iterations) override
+    {
+        inner_.warmup_end(iterations);
+    }
+
+    void do_estimate_clock_resolution_start() override
+    {
+        inner_.estimate_clock_resolution_start();
+    }
+    void do_estimate_clock_resolution_complete(
+        nonius::environment_estimate<nonius::fp_seconds> estimate) override
+    {
+        inner_.estimate_clock_resolution_complete(estimate);
+    }
+
+    void do_estimate_clock_cost_start() override
+    {
+        inner_.estimate_clock_cost_start();
+    }
+    void do_estimate_clock_cost_complete(
+        nonius::environment_estimate<nonius::fp_seconds> estimate) override
+    {
+        inner_.estimate_clock_cost_complete(estimate);
+    }
+
+    void do_suite_start() override { inner_.suite_start(); }
+
+    void do_params_start(nonius::parameters const& params) override
+    {
+        auto ss    = std::ostringstream{};
+        auto first = true;
+        for (auto&& p : params) {
+            auto v = std::ostringstream{};
+            v << p.second;
+            ss << (first ? "" : ", ") << report_json_string(p.first) << ": "
+               << report_json_string(v.str());
+            first = false;
+        }
+        rounds_.push_back({ss.str(), {}});
+        inner_.params_start(params);
+    }
+
+    void do_benchmark_start(std::string const& name) override
+    {
+        rounds_.back().benchmarks.push_back({name});
+#if IMMER_BENCHMARK_PERF_COUNTERS
+        perf_current() = &rounds_.back().benchmarks.back().perf;
+#endif
+#if IMMER_BENCHMARK_LATENCY
+        latency_current() = &rounds_.back().benchmarks.back().latency;
+#endif
+        inner_.benchmark_start(name);
+    }
+
+    void do_measurement_start(
+        nonius::execution_plan<nonius::fp_seconds> plan) override
+    {
+        inner_.measurement_start(plan);
+    }
+    void do_measurement_complete(
+        std::vector<nonius::fp_seconds> const& samples) override
+    {
+        auto& b = rounds_.back().benchmarks.back();
+        for (auto s : samples)
+            b.samples.push_back(s.count() * 1e9);
+        inner_.measurement_complete(samples);
+    }
+
+    void do_analysis_start() override { inner_.analysis_start(); }
+    void do_analysis_complete(
+        nonius::sample_analysis<nonius::fp_seconds> const& analysis) override
+    {
+        inner_.analysis_complete(analysis);
+    }
+
+    void do_benchmark_failure(std::exception_ptr error) override
+    {
+        rounds_.back().benchmarks.back().samples.clear();
+        finish_benchmark();
+        inner_.benchmark_failure(error);
+    }
+    void do_benchmark_complete() override
+    {
+        finish_benchmark();
+        inner_.benchmark_complete();
+#if IMMER_BENCHMARK_LATENCY
+        auto& h = rounds_.back().benchmarks.back().latency;
+        if (h.count()) {
+            std::cout << "latency (ns): ";
+            report_write_latency(std::cout, h);
+            std::cout << std::endl;
+        }
+#endif
+    }
+    void do_params_complete() override { inner_.params_complete(); }
+
+    void do_suite_complete() override
+    {
+        inner_.suite_complete();
+        if (output_.empty())
+            report_write_json(std::cout, rounds_);
+        else {
+            auto os = std::ofstream{output_};
+            report_write_json(os, rounds_);
+        }
+    }
+
+    void finish_benchmark()
+    {
+#if IMMER_BENCHMARK_PERF_COUNTERS
+        perf_current() = nullptr;
+#endif
+#if IMMER_BENCHMARK_LATENCY
+        latency_current() = nullptr;
+#endif
+    }
+
+    Reporter inner_;
+    std::string output_;
+    std::vector<report_round> rounds_;
+};
+
+} // anonymous namespace
+
+NONIUS_REPORTER("html-json", json_reporter<nonius::html_reporter>);
+NONIUS_REPORTER("json", json_reporter<nonius::standard_reporter>);
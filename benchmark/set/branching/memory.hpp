@@ -0,0 +1,34 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+// Footprint of the sets for every branching factor of the sweep, see
+// `benchmark/memory/footprint.hpp` for what the columns mean.
+
+#include "benchmark/memory/footprint.hpp"
+
+namespace {
+
+template <typename T>
+int main_branching(const data<T>& d)
+{
+    using immer::set;
+    using hash_t  = std::hash<T>;
+    using equal_t = std::equal_to<T>;
+    using mem_t   = memory_t;
+
+    report_header();
+    measure<set<T, hash_t, equal_t, mem_t, 3>>("set/B3", set_ops{}, d);
+    measure<set<T, hash_t, equal_t, mem_t, 4>>("set/B4", set_ops{}, d);
+    measure<set<T, hash_t, equal_t, mem_t, 5>>("set/B5", set_ops{}, d);
+    measure<set<T, hash_t, equal_t, mem_t, 6>>("set/B6", set_ops{}, d);
+    return 0;
+}
+
+} // namespace
@@ -0,0 +1,41 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+// Compares immer::int_map with immer::map for the unsigned keys of the
+// set benchmarks, using the scenarios of the map benchmarks.
+
+#include "generator.ipp"
+
+#include "../../map/access.hpp"
+#include "../../map/insert.hpp"
+#include "../../map/iter.hpp"
+
+#include <immer/int_map.hpp>
+
+using generator__ = GENERATOR_T;
+using t__         = typename decltype(generator__{}(0))::value_type;
+
+// clang-format off
+using map__     = immer::map<t__, unsigned, std::hash<t__>, std::equal_to<t__>, def_memory, 5>;
+using int_map__ = immer::int_map<t__, unsigned, def_memory>;
+
+NONIUS_BENCHMARK("insert/immer::map", benchmark_insert<generator__, map__>())
+NONIUS_BENCHMARK("insert/immer::int_map", benchmark_insert<generator__, int_map__>())
+NONIUS_BENCHMARK("insert/move/immer::map", benchmark_insert_move<generator__, map__>())
+NONIUS_BENCHMARK("insert/move/immer::int_map", benchmark_insert_move<generator__, int_map__>())
+
+NONIUS_BENCHMARK("access/immer::map", benchmark_access<generator__, map__>())
+NONIUS_BENCHMARK("access/immer::int_map", benchmark_access<generator__, int_map__>())
+NONIUS_BENCHMARK("bad/immer::map", benchmark_bad_access<generator__, map__>())
+NONIUS_BENCHMARK("bad/immer::int_map", benchmark_bad_access<generator__, int_map__>())
+
+NONIUS_BENCHMARK("iter/immer::map", benchmark_access_iter<generator__, map__>())
+NONIUS_BENCHMARK("iter/immer::int_map", benchmark_access_iter<generator__, int_map__>())
+NONIUS_BENCHMARK("reduce/immer::map", benchmark_access_reduce<generator__, map__>())
+NONIUS_BENCHMARK("reduce/immer::int_map", benchmark_access_reduce<generator__, int_map__>())
+// clang-format on
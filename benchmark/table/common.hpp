@@ -0,0 +1,56 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include "benchmark/config.hpp"
+
+#include <immer/table.hpp>
+#include <immer/table_transient.hpp>
+#include <unordered_map>
+
+namespace {
+
+// The rows of the tables, keyed by the generated values.  The standard
+// containers that they are compared against map the key to the row.
+template <typename K>
+struct row
+{
+    K id;
+    unsigned value;
+};
+
+struct inc_row_fn
+{
+    template <typename Row>
+    Row operator()(Row r) const
+    {
+        ++r.value;
+        return r;
+    }
+};
+
+template <typename Table, typename Generator>
+auto make_table(const Generator& g, std::size_t n)
+{
+    auto v = Table{}.transient();
+    for (auto i = 0u; i < n; ++i)
+        v.insert({g[i], i});
+    return v.persistent();
+}
+
+template <typename Map, typename Generator>
+auto make_std_table(const Generator& g, std::size_t n)
+{
+    auto v = Map{};
+    for (auto i = 0u; i < n; ++i)
+        v[g[i]] = {g[i], i};
+    return v;
+}
+
+} // namespace
@@ -0,0 +1,132 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include "common.hpp"
+
+namespace {
+
+// Every update touches keys that are in the table, half of the
+// `update_if_exists` ones touch keys that are not.
+
+template <typename Generator, typename Map>
+auto benchmark_update_mut_std()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g  = Generator{}(n);
+        auto v_ = make_std_table<Map>(g, n);
+        measure(meter, [&] {
+            auto v = v_;
+            for (auto i = 0u; i < n; ++i) {
+                auto& r = v[g[i]];
+                r       = inc_row_fn{}(r);
+            }
+            return v;
+        });
+    };
+}
+
+template <typename Generator, typename Table>
+auto benchmark_update()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g  = Generator{}(n);
+        auto v_ = make_table<Table>(g, n);
+        measure(meter, [&] {
+            auto v = v_;
+            for (auto i = 0u; i < n; ++i)
+                v = v.update(g[i], inc_row_fn{});
+            return v;
+        });
+    };
+}
+
+template <typename Generator, typename Table>
+auto benchmark_update_move()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g  = Generator{}(n);
+        auto v_ = make_table<Table>(g, n);
+        measure(meter, [&] {
+            auto v = v_;
+            for (auto i = 0u; i < n; ++i)
+                v = std::move(v).update(g[i], inc_row_fn{});
+            return v;
+        });
+    };
+}
+
+template <typename Generator, typename Table>
+auto benchmark_update_mut()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g  = Generator{}(n);
+        auto v_ = make_table<Table>(g, n);
+        measure(meter, [&] {
+            auto v = v_.transient();
+            for (auto i = 0u; i < n; ++i)
+                v.update(g[i], inc_row_fn{});
+            return v;
+        });
+    };
+}
+
+template <typename Generator, typename Table>
+auto benchmark_update_if_exists()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g  = Generator{}(n * 2);
+        auto v_ = make_table<Table>(g, n);
+        measure(meter, [&] {
+            auto v = v_;
+            for (auto i = 0u; i < n; ++i)
+                v = v.update_if_exists(g[i * 2], inc_row_fn{});
+            return v;
+        });
+    };
+}
+
+template <typename Generator, typename Table>
+auto benchmark_update_if_exists_move()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g  = Generator{}(n * 2);
+        auto v_ = make_table<Table>(g, n);
+        measure(meter, [&] {
+            auto v = v_;
+            for (auto i = 0u; i < n; ++i)
+                v = std::move(v).update_if_exists(g[i * 2], inc_row_fn{});
+            return v;
+        });
+    };
+}
+
+template <typename Generator, typename Table>
+auto benchmark_update_if_exists_mut()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g  = Generator{}(n * 2);
+        auto v_ = make_table<Table>(g, n);
+        measure(meter, [&] {
+            auto v = v_.transient();
+            for (auto i = 0u; i < n; ++i)
+                v.update_if_exists(g[i * 2], inc_row_fn{});
+            return v;
+        });
+    };
+}
+
+} // namespace
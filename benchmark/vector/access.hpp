@@ -221,6 +221,34 @@ auto benchmark_access_random()
     };
 }
 
+template <typename Vektor>
+auto benchmark_access_random_concat()
+{
+    return [] (nonius::parameters params)
+    {
+        auto n = params.get<N>();
+
+        auto v = Vektor{};
+        auto c = Vektor{};
+        for (auto i = 0u; i < n; ++i) {
+            c = c.push_back(i);
+            if (c.size() == 33u || i + 1 == n) {
+                v = v + c;
+                c = {};
+            }
+        }
+        auto g = make_generator(n);
+
+        return [=] {
+            auto r = 0u;
+            for (auto i = 0u; i < n; ++i)
+                r += v[g[i]];
+            volatile auto rr = r;
+            return rr;
+        };
+    };
+}
+
 template <typename Fn>
 auto benchmark_access_librrb(Fn maker)
 {
@@ -8,6 +8,7 @@
 
 #include "benchmark/vector/access.hpp"
 #include <immer/flex_vector.hpp>
+#include <immer/tuning.hpp>
 
 #ifndef MEMORY_T
 #error "define the MEMORY_T"
@@ -18,3 +19,8 @@ NONIUS_BENCHMARK("flex/4", benchmark_access_idx<immer::flex_vector<std::size_t,M
 NONIUS_BENCHMARK("flex/5", benchmark_access_idx<immer::flex_vector<std::size_t,MEMORY_T,5>>())
 NONIUS_BENCHMARK("flex/6", benchmark_access_idx<immer::flex_vector<std::size_t,MEMORY_T,6>>())
 NONIUS_BENCHMARK("flex/7", benchmark_access_idx<immer::flex_vector<std::size_t,MEMORY_T,7>>())
+
+NONIUS_BENCHMARK("tuned/128", benchmark_access_idx<immer::tuned_flex_vector<std::size_t,MEMORY_T,128>>())
+NONIUS_BENCHMARK("tuned/256", benchmark_access_idx<immer::tuned_flex_vector<std::size_t,MEMORY_T,256>>())
+NONIUS_BENCHMARK("tuned/512", benchmark_access_idx<immer::tuned_flex_vector<std::size_t,MEMORY_T,512>>())
+NONIUS_BENCHMARK("tuned/1024", benchmark_access_idx<immer::tuned_flex_vector<std::size_t,MEMORY_T,1024>>())
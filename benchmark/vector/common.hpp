@@ -24,7 +24,7 @@ extern "C" {
 #endif
 
 namespace immer {
-template <typename T, typename MP> class array;
+template <typename T, typename MP, typename Growth> class array;
 } // namespace immer
 
 namespace {
@@ -71,8 +71,8 @@ template <typename T>
 struct get_limit : std::integral_constant<
     std::size_t, std::numeric_limits<std::size_t>::max()> {};
 
-template <typename T, typename MP>
-struct get_limit<immer::array<T, MP>> : std::integral_constant<
+template <typename T, typename MP, typename Growth>
+struct get_limit<immer::array<T, MP, Growth>> : std::integral_constant<
     std::size_t, 10000> {};
 
 auto make_librrb_vector(std::size_t n)
@@ -8,6 +8,7 @@
 
 #include "benchmark/vector/access.hpp"
 
+#include <immer/adaptive_vector.hpp>
 #include <immer/algorithm.hpp>
 #include <immer/array.hpp>
 #include <immer/flex_vector.hpp>
@@ -59,6 +60,7 @@ NONIUS_BENCHMARK("flex/F/5B/idx",   benchmark_access_idx<immer::flex_vector<unsi
 NONIUS_BENCHMARK("vector/4B/idx",   benchmark_access_idx<immer::vector<unsigned,def_memory,4>>())
 NONIUS_BENCHMARK("vector/5B/idx",   benchmark_access_idx<immer::vector<unsigned,def_memory,5>>())
 NONIUS_BENCHMARK("vector/6B/idx",   benchmark_access_idx<immer::vector<unsigned,def_memory,6>>())
+NONIUS_BENCHMARK("adaptive/5B/idx", benchmark_access_idx<immer::adaptive_vector<unsigned,def_memory,5>>())
 #if IMMER_BENCHMARK_EXPERIMENTAL
 NONIUS_BENCHMARK("dvektor/4B/idx",  benchmark_access_idx<immer::dvektor<unsigned,def_memory,4>>())
 NONIUS_BENCHMARK("dvektor/5B/idx",  benchmark_access_idx<immer::dvektor<unsigned,def_memory,5>>())
@@ -73,6 +75,12 @@ NONIUS_BENCHMARK("flex/F/5B/reduce", benchmark_access_reduce<immer::flex_vector<
 NONIUS_BENCHMARK("vector/4B/reduce", benchmark_access_reduce<immer::vector<unsigned,def_memory,4>>())
 NONIUS_BENCHMARK("vector/5B/reduce", benchmark_access_reduce<immer::vector<unsigned,def_memory,5>>())
 NONIUS_BENCHMARK("vector/6B/reduce", benchmark_access_reduce<immer::vector<unsigned,def_memory,6>>())
+NONIUS_BENCHMARK("adaptive/5B/reduce", benchmark_access_reduce<immer::adaptive_vector<unsigned,def_memory,5>>())
+#if IMMER_BENCHMARK_EXPERIMENTAL
+NONIUS_BENCHMARK("dvektor/4B/reduce", benchmark_access_reduce<immer::dvektor<unsigned,def_memory,4>>())
+NONIUS_BENCHMARK("dvektor/5B/reduce", benchmark_access_reduce<immer::dvektor<unsigned,def_memory,5>>())
+NONIUS_BENCHMARK("dvektor/6B/reduce", benchmark_access_reduce<immer::dvektor<unsigned,def_memory,6>>())
+#endif
 
 #if IMMER_BENCHMARK_STEADY
 NONIUS_BENCHMARK("steady/random",      benchmark_access_random<steady::vector<unsigned>>())
@@ -80,6 +88,7 @@ NONIUS_BENCHMARK("steady/random",      benchmark_access_random<steady::vector<un
 
 NONIUS_BENCHMARK("flex/5B/random",     benchmark_access_random<immer::flex_vector<unsigned,def_memory,5>>())
 NONIUS_BENCHMARK("flex/F/5B/random",   benchmark_access_random<immer::flex_vector<unsigned,def_memory,5>, push_front_fn>())
+NONIUS_BENCHMARK("flex/C/5B/random",   benchmark_access_random_concat<immer::flex_vector<unsigned,def_memory,5>>())
 NONIUS_BENCHMARK("vector/4B/random",   benchmark_access_random<immer::vector<unsigned,def_memory,4>>())
 NONIUS_BENCHMARK("vector/5B/random",   benchmark_access_random<immer::vector<unsigned,def_memory,5>>())
 NONIUS_BENCHMARK("vector/6B/random",   benchmark_access_random<immer::vector<unsigned,def_memory,6>>())
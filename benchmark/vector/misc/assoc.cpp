@@ -8,6 +8,7 @@
 
 #include "benchmark/vector/assoc.hpp"
 
+#include <immer/adaptive_vector.hpp>
 #include <immer/array.hpp>
 #include <immer/flex_vector.hpp>
 #include <immer/flex_vector_transient.hpp>
@@ -16,6 +17,7 @@
 
 #if IMMER_BENCHMARK_EXPERIMENTAL
 #include <immer/experimental/dvektor.hpp>
+#include <immer/experimental/dvektor_transient.hpp>
 #endif
 
 #include <immer/heap/gc_heap.hpp>
@@ -81,8 +83,12 @@ NONIUS_BENCHMARK("dvektor/6B", benchmark_assoc<immer::dvektor<unsigned,def_memor
 NONIUS_BENCHMARK("dvektor/GC", benchmark_assoc<immer::dvektor<unsigned,gc_memory,5>>())
 NONIUS_BENCHMARK("dvektor/NO", benchmark_assoc<immer::dvektor<unsigned,basic_memory,5>>())
 NONIUS_BENCHMARK("dvektor/UN", benchmark_assoc<immer::dvektor<unsigned,unsafe_memory,5>>())
+
+NONIUS_BENCHMARK("t/dvektor/5B", benchmark_assoc_mut<immer::dvektor<unsigned,def_memory,5>>())
+NONIUS_BENCHMARK("t/dvektor/UN", benchmark_assoc_mut<immer::dvektor<unsigned,unsafe_memory,5>>())
 #endif
 
+NONIUS_BENCHMARK("adaptive/5B", benchmark_assoc<immer::adaptive_vector<unsigned,def_memory,5>>())
 NONIUS_BENCHMARK("array",      benchmark_assoc<immer::array<unsigned>>())
 
 #if IMMER_BENCHMARK_STEADY
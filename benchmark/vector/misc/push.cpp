@@ -8,6 +8,7 @@
 
 #include "benchmark/vector/push.hpp"
 
+#include <immer/adaptive_vector.hpp>
 #include <immer/array.hpp>
 #include <immer/flex_vector.hpp>
 #include <immer/vector_transient.hpp>
@@ -15,6 +16,7 @@
 
 #if IMMER_BENCHMARK_EXPERIMENTAL
 #include <immer/experimental/dvektor.hpp>
+#include <immer/experimental/dvektor_transient.hpp>
 #endif
 
 #include <immer/heap/gc_heap.hpp>
@@ -74,8 +76,12 @@ NONIUS_BENCHMARK("dvektor/6B", benchmark_push<immer::dvektor<unsigned,def_memory
 NONIUS_BENCHMARK("dvektor/GC", benchmark_push<immer::dvektor<unsigned,gc_memory,5>>())
 NONIUS_BENCHMARK("dvektor/NO", benchmark_push<immer::dvektor<unsigned,basic_memory,5>>())
 NONIUS_BENCHMARK("dvektor/UN", benchmark_push<immer::dvektor<unsigned,unsafe_memory,5>>())
+
+NONIUS_BENCHMARK("t/dvektor/5B", benchmark_push_mut<immer::dvektor<unsigned,def_memory,5>>())
+NONIUS_BENCHMARK("t/dvektor/UN", benchmark_push_mut<immer::dvektor<unsigned,unsafe_memory,5>>())
 #endif
 
+NONIUS_BENCHMARK("adaptive/5B", benchmark_push<immer::adaptive_vector<unsigned,def_memory,5>>())
 NONIUS_BENCHMARK("array",      benchmark_push<immer::array<unsigned>>())
 
 #if IMMER_BENCHMARK_STEADY
@@ -24,7 +24,7 @@ auto benchmark_push_mut_std()
         measure(meter, [&] {
             auto v = Vektor{};
             for (auto i = 0u; i < n; ++i)
-                v.push_back(i);
+                measure_op([&] { v.push_back(i); });
             return v;
         });
     };
@@ -42,7 +42,7 @@ auto benchmark_push_mut()
         measure(meter, [&] {
             auto v = Vektor{}.transient();
             for (auto i = 0u; i < n; ++i)
-                v.push_back(i);
+                measure_op([&] { v.push_back(i); });
             return v;
         });
     };
@@ -60,7 +60,7 @@ auto benchmark_push_move()
         measure(meter, [&] {
             auto v = Vektor{};
             for (auto i = 0u; i < n; ++i)
-                v = std::move(v).push_back(i);
+                measure_op([&] { v = std::move(v).push_back(i); });
             return v;
         });
     };
@@ -78,7 +78,7 @@ auto benchmark_push()
         measure(meter, [&] {
             auto v = Vektor{};
             for (auto i = 0u; i < n; ++i)
-                v = v.push_back(i);
+                measure_op([&] { v = v.push_back(i); });
             return v;
         });
     };
@@ -91,7 +91,7 @@ auto benchmark_push_librrb(nonius::chronometer meter)
     measure(meter, [&] {
         auto v = rrb_create();
         for (auto i = 0u; i < n; ++i)
-            v = rrb_push(v, reinterpret_cast<void*>(i));
+            measure_op([&] { v = rrb_push(v, reinterpret_cast<void*>(i)); });
         return v;
     });
 }
@@ -103,7 +103,9 @@ auto benchmark_push_mut_librrb(nonius::chronometer meter)
     measure(meter, [&] {
         auto v = rrb_to_transient(rrb_create());
         for (auto i = 0u; i < n; ++i)
-            v = transient_rrb_push(v, reinterpret_cast<void*>(i));
+            measure_op([&] {
+                v = transient_rrb_push(v, reinterpret_cast<void*>(i));
+            });
         return v;
     });
 }
@@ -0,0 +1,135 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/algorithm.hpp>
+
+#include <arrow/api.h>
+
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace immer {
+namespace arrow_bridge {
+
+namespace detail {
+
+template <typename T>
+using arrow_type_t = typename ::arrow::CTypeTraits<T>::ArrowType;
+
+template <typename T>
+using arrow_array_t = typename ::arrow::TypeTraits<arrow_type_t<T>>::ArrayType;
+
+template <typename T>
+constexpr bool is_exportable_v =
+    std::is_arithmetic<T>::value && !std::is_same<T, bool>::value;
+
+// a buffer that looks into a chunk of a vector, that it keeps alive, and
+// with it the leaf the chunk is in
+template <typename Vector>
+class chunk_buffer : public ::arrow::Buffer
+{
+public:
+    chunk_buffer(std::shared_ptr<const Vector> owner,
+                 const std::uint8_t* data,
+                 std::int64_t size)
+        : ::arrow::Buffer{data, size}
+        , owner_{std::move(owner)}
+    {}
+
+private:
+    std::shared_ptr<const Vector> owner_;
+};
+
+} // namespace detail
+
+/*!
+ * Returns an `arrow::ChunkedArray` with the elements of the vector `v`,
+ * which must be of a primitive numeric type other than `bool`, that
+ * Arrow stores bit-packed.  Every chunk of the vector, as given by
+ * `immer::for_each_chunk`, becomes a chunk of the result that points
+ * into the leaf of the vector where it is.  Nothing is copied: the
+ * buffers share a copy of `v`, that keeps its nodes alive as long as
+ * any of them is.
+ *
+ * The chunks have no validity bitmap and are read-only, like the
+ * leaves.  They are aligned as the elements are, which is enough for
+ * Arrow, but the IPC writers may copy them to pad them to 64 bytes.
+ */
+template <typename Vector>
+std::shared_ptr<::arrow::ChunkedArray> to_arrow(Vector v)
+{
+    using value_t = typename Vector::value_type;
+    using type_t  = detail::arrow_type_t<value_t>;
+    using array_t = detail::arrow_array_t<value_t>;
+    static_assert(detail::is_exportable_v<value_t>,
+                  "only vectors of numbers can be exported to Arrow");
+
+    auto type   = ::arrow::TypeTraits<type_t>::type_singleton();
+    auto owner  = std::make_shared<const Vector>(std::move(v));
+    auto chunks = ::arrow::ArrayVector{};
+    immer::for_each_chunk(*owner, [&](auto first, auto last) {
+        auto length = static_cast<std::int64_t>(last - first);
+        auto buffer = std::make_shared<detail::chunk_buffer<Vector>>(
+            owner,
+            reinterpret_cast<const std::uint8_t*>(first),
+            length * static_cast<std::int64_t>(sizeof(value_t)));
+        chunks.push_back(std::make_shared<array_t>(
+            ::arrow::ArrayData::Make(type, length, {nullptr, buffer}, 0)));
+    });
+    return std::make_shared<::arrow::ChunkedArray>(std::move(chunks), type);
+}
+
+/*!
+ * Returns a vector of type `Vector` with the elements of the chunked
+ * array `a`, that are appended in bulk, a chunk at a time, to a
+ * transient, filling the leaves directly from the Arrow buffers.  It
+ * fails when the type of `a` does not match the elements of `Vector` or
+ * when it has null values.
+ */
+template <typename Vector>
+::arrow::Result<Vector> from_arrow(const ::arrow::ChunkedArray& a)
+{
+    using value_t = typename Vector::value_type;
+    using type_t  = detail::arrow_type_t<value_t>;
+    using array_t = detail::arrow_array_t<value_t>;
+    static_assert(detail::is_exportable_v<value_t>,
+                  "only vectors of numbers can be imported from Arrow");
+
+    auto type = ::arrow::TypeTraits<type_t>::type_singleton();
+    if (!a.type()->Equals(*type))
+        return ::arrow::Status::TypeError("cannot import ",
+                                          a.type()->ToString(),
+                                          " into a vector of ",
+                                          type->ToString());
+    if (a.null_count() > 0)
+        return ::arrow::Status::Invalid("cannot import null values");
+
+    auto t = Vector{}.transient();
+    for (auto& chunk : a.chunks()) {
+        auto& array = static_cast<const array_t&>(*chunk);
+        auto first  = array.raw_values();
+        t.append(first, first + array.length());
+    }
+    return t.persistent();
+}
+
+/*!
+ * Like the other overload, for a single array `a`.
+ */
+template <typename Vector>
+::arrow::Result<Vector> from_arrow(const ::arrow::Array& a)
+{
+    return from_arrow<Vector>(::arrow::ChunkedArray{a.Slice(0)});
+}
+
+} // namespace arrow_bridge
+} // namespace immer
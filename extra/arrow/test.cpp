@@ -0,0 +1,79 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer-arrow.hpp>
+
+#include <immer/flex_vector.hpp>
+#include <immer/vector.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cstdint>
+
+TEST_CASE("vectors are exported without copying")
+{
+    auto v = immer::vector<double>{};
+    for (auto i = 0; i < 1000; ++i)
+        v = std::move(v).push_back(i * 0.5);
+
+    auto a = immer::arrow_bridge::to_arrow(v);
+    CHECK(a->length() == 1000);
+    CHECK(a->null_count() == 0);
+    CHECK(a->num_chunks() > 1);
+    CHECK(a->type()->Equals(*arrow::float64()));
+
+    // the chunks point into the leaves of the vector
+    auto i = std::size_t{};
+    for (auto& chunk : a->chunks()) {
+        auto& d = static_cast<const arrow::DoubleArray&>(*chunk);
+        CHECK(d.raw_values() == &v[i]);
+        i += d.length();
+    }
+    CHECK(i == v.size());
+
+    // and keep them alive
+    auto first = &v[0];
+    v          = {};
+    CHECK(static_cast<const arrow::DoubleArray&>(*a->chunk(0)).raw_values() ==
+          first);
+    CHECK(static_cast<const arrow::DoubleArray&>(*a->chunk(0)).Value(3) ==
+          1.5);
+}
+
+TEST_CASE("vectors are imported from arrays")
+{
+    auto v = immer::flex_vector<std::int32_t>{};
+    for (auto i = 0; i < 3000; ++i)
+        v = std::move(v).push_back(i);
+    v = v.drop(7) + v.take(100);
+
+    auto a = immer::arrow_bridge::to_arrow(v);
+    auto r = immer::arrow_bridge::from_arrow<immer::vector<std::int32_t>>(*a);
+    REQUIRE(r.ok());
+    CHECK(r->size() == v.size());
+    CHECK(std::equal(r->begin(), r->end(), v.begin()));
+
+    auto slice = a->Slice(10, 50);
+    auto s =
+        immer::arrow_bridge::from_arrow<immer::flex_vector<std::int32_t>>(
+            *slice);
+    REQUIRE(s.ok());
+    CHECK(*s == v.drop(10).take(50));
+
+    auto wrong = immer::arrow_bridge::from_arrow<immer::vector<double>>(*a);
+    CHECK(wrong.status().IsTypeError());
+
+    auto builder = arrow::Int32Builder{};
+    REQUIRE(builder.Append(1).ok());
+    REQUIRE(builder.AppendNull().ok());
+    auto nulls = builder.Finish().ValueOrDie();
+    CHECK(immer::arrow_bridge::from_arrow<immer::vector<std::int32_t>>(*nulls)
+              .status()
+              .IsInvalid());
+}
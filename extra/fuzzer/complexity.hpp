@@ -0,0 +1,56 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/memory_stats.hpp>
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <initializer_list>
+
+// The complexity fuzzers do not look for crashes but for inputs that
+// make an operation cost more than the data structure guarantees,
+// like a degenerate tree after a sequence of concatenations or a
+// lookup that visits too many levels.  Costs are measured through
+// the memory stats, and an input that exceeds a bound aborts, so that
+// the fuzzer reports it like a crash.
+
+inline void check_cost(const char* what, std::size_t cost, std::size_t bound)
+{
+    if (cost > bound) {
+        std::fprintf(stderr,
+                     "complexity bound exceeded: %s costs %zu > %zu\n",
+                     what,
+                     cost,
+                     bound);
+        std::abort();
+    }
+}
+
+// The nodes of `result` that none of `args` has, that is, those that
+// the operation that made `result` from `args` had to allocate.
+template <typename Result, typename... Args>
+std::size_t new_nodes(const Result& result, const Args&... args)
+{
+    auto c = immer::memory_stats_collector{};
+    (void) std::initializer_list<int>{(c.add(args), 0)...};
+    auto before = c.usage().nodes();
+    return c.add(result).usage().nodes() - before;
+}
+
+// The number of levels of a tree with `n` leaves where every node has
+// at least `base` children, rounding up.
+inline std::size_t log_ceil(std::size_t n, std::size_t base)
+{
+    auto r = std::size_t{};
+    for (auto x = std::size_t{1}; x < n; x *= base)
+        ++r;
+    return r;
+}
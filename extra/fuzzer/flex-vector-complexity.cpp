@@ -0,0 +1,143 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include "complexity.hpp"
+#include "fuzzer_input.hpp"
+
+#include <immer/flex_vector.hpp>
+
+#include <algorithm>
+#include <array>
+#include <initializer_list>
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data,
+                                      std::size_t size)
+{
+    constexpr auto var_count = 8;
+    constexpr auto bits      = 2;
+    constexpr auto branches  = 1 << bits;
+    constexpr auto max_size  = 1 << 12;
+
+    using vector_t =
+        immer::flex_vector<int, immer::default_memory_policy, bits, bits>;
+    using size_t = std::uint16_t;
+
+    auto vars = std::array<vector_t, var_count>{};
+
+    auto is_valid_var = [&](auto idx) { return idx >= 0 && idx < var_count; };
+    auto is_valid_index = [](auto& v) {
+        return [&](auto idx) { return idx >= 0 && idx < v.size(); };
+    };
+    auto is_valid_size = [](auto& v) {
+        return [&](auto idx) { return idx >= 0 && idx <= v.size(); };
+    };
+    auto depth = [](auto& v) { return immer::memory_stats(v).depth; };
+
+    // The rebalancing of the concatenation leaves at most two nodes
+    // more than needed on every level, which can not be emptier than
+    // half of the branches on average, and the tail takes the place of
+    // a leaf.  Slicing keeps the height of the nodes on its edges, thus
+    // the height is bounded by the largest vector that it was sliced
+    // from, which was built the same way.
+    auto peak        = std::size_t{};
+    auto check_depth = [&](const vector_t& v) {
+        peak = std::max(peak, v.size());
+        check_cost("depth", depth(v), log_ceil(peak, branches / 2) + 3);
+    };
+    // Updating a vector copies, at most, the nodes on the path to the
+    // changed leaf and a new root.  Concatenating them also rebalances,
+    // on every level, the nodes that are next to the seam.
+    auto path_bound = [&](auto&&... vs) {
+        auto d = std::size_t{};
+        (void) std::initializer_list<int>{
+            (d = std::max(d, depth(vs)), 0)...};
+        return d + 2;
+    };
+    auto concat_bound = [&](auto&&... vs) {
+        return 2 * branches * path_bound(vs...);
+    };
+
+    return fuzzer_input{data, size}.run([&](auto& in) {
+        enum ops
+        {
+            op_push_back,
+            op_push_front,
+            op_update,
+            op_take,
+            op_drop,
+            op_concat,
+            op_insert,
+            op_erase,
+        };
+        auto src = read<char>(in, is_valid_var);
+        auto dst = read<char>(in, is_valid_var);
+        auto& v  = vars[src];
+        auto r   = vector_t{};
+        switch (read<char>(in)) {
+        case op_push_back: {
+            if (v.size() >= max_size)
+                return true;
+            r = v.push_back(42);
+            check_cost("push_back", new_nodes(r, v), path_bound(v));
+            break;
+        }
+        case op_push_front: {
+            if (v.size() >= max_size)
+                return true;
+            r = v.push_front(42);
+            check_cost("push_front", new_nodes(r, v), concat_bound(v));
+            break;
+        }
+        case op_update: {
+            auto idx = read<size_t>(in, is_valid_index(v));
+            r        = v.update(idx, [](auto x) { return x + 1; });
+            check_cost("update", new_nodes(r, v), path_bound(v));
+            break;
+        }
+        case op_take: {
+            auto idx = read<size_t>(in, is_valid_size(v));
+            r        = v.take(idx);
+            check_cost("take", new_nodes(r, v), path_bound(v));
+            break;
+        }
+        case op_drop: {
+            auto idx = read<size_t>(in, is_valid_size(v));
+            r        = v.drop(idx);
+            check_cost("drop", new_nodes(r, v), path_bound(v));
+            break;
+        }
+        case op_concat: {
+            auto& w = vars[read<char>(in, is_valid_var)];
+            if (v.size() + w.size() > max_size)
+                return true;
+            r = v + w;
+            check_cost("concat", new_nodes(r, v, w), concat_bound(v, w));
+            break;
+        }
+        case op_insert: {
+            if (v.size() >= max_size)
+                return true;
+            auto idx = read<size_t>(in, is_valid_size(v));
+            r        = v.insert(idx, 42);
+            check_cost("insert", new_nodes(r, v), concat_bound(v));
+            break;
+        }
+        case op_erase: {
+            auto idx = read<size_t>(in, is_valid_index(v));
+            r        = v.erase(idx);
+            check_cost("erase", new_nodes(r, v), concat_bound(v));
+            break;
+        }
+        default:
+            return true;
+        };
+        check_depth(r);
+        vars[dst] = std::move(r);
+        return true;
+    });
+}
@@ -0,0 +1,85 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include "complexity.hpp"
+#include "fuzzer_input.hpp"
+
+#include <immer/map.hpp>
+
+#include <array>
+
+struct colliding_hash_t
+{
+    std::size_t operator()(std::size_t x) const { return x & ~15; }
+};
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data,
+                                      std::size_t size)
+{
+    constexpr auto var_count = 4;
+    constexpr auto bits      = 3;
+    constexpr auto max_depth = immer::detail::hamts::max_depth<bits>;
+
+    using map_t = immer::map<std::size_t,
+                             int,
+                             colliding_hash_t,
+                             std::equal_to<>,
+                             immer::default_memory_policy,
+                             bits>;
+
+    auto vars = std::array<map_t, var_count>{};
+
+    auto is_valid_var = [&](auto idx) { return idx >= 0 && idx < var_count; };
+
+    // Inserting or removing a key copies the nodes on the path to it,
+    // plus the ones that are needed to tell apart the keys whose hashes
+    // share a prefix, which are never more than the levels of the trie,
+    // whatever the keys.  Only the keys of equal hash share the
+    // collision nodes at the bottom.
+    auto check_map = [&](const char* what, const map_t& r, const map_t& m) {
+        auto s = immer::memory_stats(r);
+        check_cost(what, new_nodes(r, m), max_depth + 1);
+        check_cost("depth", s.depth, max_depth + 1);
+        check_cost("values", s.values, r.size());
+        check_cost("size", r.size(), s.values);
+    };
+
+    return fuzzer_input{data, size}.run([&](auto& in) {
+        enum ops
+        {
+            op_set,
+            op_erase,
+            op_update,
+        };
+        auto src = read<char>(in, is_valid_var);
+        auto dst = read<char>(in, is_valid_var);
+        auto& m  = vars[src];
+        auto r   = map_t{};
+        switch (read<char>(in)) {
+        case op_set: {
+            r = m.set(read<size_t>(in), 42);
+            check_map("set", r, m);
+            break;
+        }
+        case op_erase: {
+            r = m.erase(read<size_t>(in));
+            check_map("erase", r, m);
+            break;
+        }
+        case op_update: {
+            r = m.update(read<size_t>(in), [](auto x) { return x + 1; });
+            check_map("update", r, m);
+            break;
+        }
+        default:
+            return true;
+        };
+        vars[dst] = std::move(r);
+        return true;
+    });
+}
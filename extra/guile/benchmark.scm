@@ -69,6 +69,13 @@
 (benchmark (apply u32vector (iota bench-size)))
 (benchmark (list->vlist (iota bench-size)))
 (benchmark (apply fector (iota bench-size)))
+(benchmark (ivector-from-list (iota bench-size)))
+(benchmark (ivector-u32-from-list (iota bench-size)))
+(benchmark (let ((t (ivector-transient (ivector))))
+             (ivector-transient-push-list! t (iota bench-size))
+             (ivector-transient-persistent t)))
+(benchmark (list->vector (iota bench-size)))
+(benchmark (list->u32vector (iota bench-size)))
 
 (display ";;;; benchmarking iteration...") (newline)
 
@@ -91,6 +98,30 @@
 (benchmark (vlist-fold + 0 bench-vlist))
 (benchmark (fector-fold + bench-fector 0))
 
+(display-eval
+ (define-syntax chunk-sum
+   (syntax-rules ()
+     ((_ *length *ref)
+      (lambda (acc chunk)
+        (let ((len (*length chunk)))
+          (let iter ((i 0) (acc acc))
+            (if (< i len)
+                (iter (+ i 1) (+ acc (*ref chunk i)))
+                acc))))))))
+
+(benchmark (ivector-fold-chunks (chunk-sum vector-length vector-ref)
+                                0 bench-ivector))
+(benchmark (ivector-u32-fold-chunks (chunk-sum u32vector-length
+                                               u32vector-ref)
+                                    0 bench-ivector-u32))
+
+(display ";;;; benchmarking conversion to lists...") (newline)
+(benchmark (ivector-to-list bench-ivector))
+(benchmark (ivector-u32-to-list bench-ivector-u32))
+(benchmark (vector->list bench-vector))
+(benchmark (u32vector->list bench-u32vector))
+(benchmark (vlist->list bench-vlist))
+
 (display ";;;; benchmarking iteration by index...") (newline)
 
 (display-eval
@@ -166,3 +197,38 @@
 (benchmark (append bench-list bench-list))
 (benchmark (vector-append bench-vector bench-vector))
 (benchmark (vlist-append bench-vlist bench-vlist))
+
+(display ";;;; benchmarking map creation...") (newline)
+
+(display-eval (define bench-alist (map cons bench-list bench-list)))
+
+(benchmark (fold (lambda (x m) (imap-set m x x)) (imap) bench-list))
+(benchmark (imap-from-alist bench-alist))
+(benchmark (let ((t (imap-transient (imap))))
+             (imap-transient-set-alist! t bench-alist)
+             (imap-transient-persistent t)))
+(benchmark (alist->vhash bench-alist))
+(benchmark (let ((h (make-hash-table)))
+             (for-each (lambda (x) (hash-set! h x x)) bench-list)
+             h))
+
+(display ";;;; benchmarking map lookup...") (newline)
+
+(display-eval (define bench-imap (imap-from-alist bench-alist)))
+(display-eval (define bench-vhash (alist->vhash bench-alist)))
+(display-eval (define bench-hash-table
+                (let ((h (make-hash-table)))
+                  (for-each (lambda (x) (hash-set! h x x)) bench-list)
+                  h)))
+
+(benchmark (fold (lambda (x acc) (+ acc (imap-ref bench-imap x)))
+                 0 bench-list))
+(benchmark (fold (lambda (x acc) (+ acc (cdr (vhash-assoc x bench-vhash))))
+                 0 bench-list))
+(benchmark (fold (lambda (x acc) (+ acc (hash-ref bench-hash-table x)))
+                 0 bench-list))
+
+(display ";;;; benchmarking map iteration...") (newline)
+(benchmark (imap-fold (lambda (acc k v) (+ acc v)) 0 bench-imap))
+(benchmark (vhash-fold (lambda (k v acc) (+ acc v)) 0 bench-vhash))
+(benchmark (hash-fold (lambda (k v acc) (+ acc v)) 0 bench-hash-table))
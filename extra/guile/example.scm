@@ -37,6 +37,33 @@
   (assert (eq? (ivector-ref v2 2) ":)")))
 ;; include:intro/end
 
+;; include:bulk/start
+(let* ((v (ivector-u32-from-list (iota 100)))
+       (t (ivector-u32-transient v)))
+  (ivector-u32-transient-push-list! t (iota 100 100))
+  (let ((w (ivector-u32-transient-persistent t)))
+    (assert (eq? (ivector-u32-length v) 100))
+    (assert (eq? (ivector-u32-length w) 200))
+    (assert (equal? (ivector-u32-to-list w) (iota 200)))
+    ;; every chunk is an u32vector
+    (assert (eq? (ivector-u32-fold-chunks
+                  (lambda (acc c) (+ acc (u32vector-length c)))
+                  0 w)
+                 200))))
+
+(let* ((m1 (imap '(a . 1) '(b . 2)))
+       (m2 (imap-set m1 "c" 3))
+       (m3 (imap-update (imap-erase m2 'a) 'b (lambda (x) (* x 10)))))
+  (assert (eq? (imap-ref m1 'a) 1))
+  (assert (eq? (imap-ref m2 "c") 3))
+  (assert (not (imap-ref m1 "c")))
+  (assert (eq? (imap-ref m3 'a 'none) 'none))
+  (assert (eq? (imap-ref m3 'b) 20))
+  (assert (imap-contains? m3 "c"))
+  (assert (eq? (imap-length m3) 2))
+  (assert (eq? (imap-fold (lambda (acc k v) (+ acc v)) 0 m3) 23)))
+;; include:bulk/end
+
 ;; Experiments
 
 (let ((d (dummy)))
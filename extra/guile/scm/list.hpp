@@ -9,7 +9,9 @@
 #pragma once
 
 #include <scm/val.hpp>
+#include <cstddef>
 #include <iostream>
+#include <iterator>
 
 namespace scm {
 
@@ -20,6 +22,10 @@ struct list : detail::wrapper
 
     using iterator = list;
     using value_type = val;
+    using difference_type = std::ptrdiff_t;
+    using reference = val;
+    using pointer = const val*;
+    using iterator_category = std::input_iterator_tag;
 
     list() : base_t{SCM_EOL} {};
     list end() const { return {}; }
@@ -9,9 +9,16 @@
 #include <immer/algorithm.hpp>
 #include <immer/flex_vector.hpp>
 #include <immer/flex_vector_transient.hpp>
-#include <iostream>
+#include <immer/map.hpp>
+#include <immer/map_transient.hpp>
 #include <scm/scm.hpp>
 
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <new>
+
 namespace {
 
 struct guile_heap
@@ -42,6 +49,77 @@ using guile_memory = immer::memory_policy<immer::heap_policy<guile_heap>,
 template <typename T>
 using guile_ivector = immer::flex_vector<T, guile_memory>;
 
+// Keys are compared with `equal?` and hashed accordingly, like in the
+// `hash-ref` family of procedures.
+struct guile_hash
+{
+    std::size_t operator()(scm::val x) const
+    {
+        return scm_ihash(x, std::numeric_limits<unsigned long>::max());
+    }
+};
+
+struct guile_equal
+{
+    bool operator()(scm::val a, scm::val b) const
+    {
+        return scm_is_true(scm_equal_p(a, b));
+    }
+};
+
+using guile_imap =
+    immer::map<scm::val, scm::val, guile_hash, guile_equal, guile_memory>;
+
+// The chunks are handed to Scheme as fresh vectors, uniform ones for the
+// numeric types, that the callee may keep or fold with the native
+// procedures of the vectors, while Scheme is called only once per leaf.
+SCM make_chunk(const scm::val* first, const scm::val* last)
+{
+    auto r = scm_c_make_vector(last - first, SCM_UNSPECIFIED);
+    for (auto i = std::size_t{}; first != last; ++first, ++i)
+        SCM_SIMPLE_VECTOR_SET(r, i, *first);
+    return r;
+}
+
+// Guile frees the storage of the uniform vectors that it takes with
+// `free`, thus the copy must come from `malloc`.
+template <typename T>
+T* copy_chunk(const T* first, const T* last)
+{
+    auto n = std::max(std::size_t(last - first), std::size_t{1});
+    auto r = static_cast<T*>(std::malloc(n * sizeof(T)));
+    if (!r)
+        throw std::bad_alloc{};
+    std::copy(first, last, r);
+    return r;
+}
+
+#define IMMER_GUILE_DEFINE_CHUNK(cpp_name__, srfi4_name__)               \
+    SCM make_chunk(const cpp_name__* first, const cpp_name__* last)      \
+    {                                                                    \
+        return scm_take_##srfi4_name__##vector(copy_chunk(first, last),  \
+                                               last - first);            \
+    }                                                                    \
+    /**/
+
+IMMER_GUILE_DEFINE_CHUNK(float, f32);
+IMMER_GUILE_DEFINE_CHUNK(double, f64);
+IMMER_GUILE_DEFINE_CHUNK(std::int8_t, s8);
+IMMER_GUILE_DEFINE_CHUNK(std::int16_t, s16);
+IMMER_GUILE_DEFINE_CHUNK(std::int32_t, s32);
+IMMER_GUILE_DEFINE_CHUNK(std::int64_t, s64);
+IMMER_GUILE_DEFINE_CHUNK(std::uint8_t, u8);
+IMMER_GUILE_DEFINE_CHUNK(std::uint16_t, u16);
+IMMER_GUILE_DEFINE_CHUNK(std::uint32_t, u32);
+IMMER_GUILE_DEFINE_CHUNK(std::uint64_t, u64);
+
+template <typename Map>
+scm::val map_ref(const Map& m, scm::val k, scm::args rest)
+{
+    auto p = m.find(k);
+    return p ? *p : rest ? *rest : scm::val{SCM_BOOL_F};
+}
+
 struct dummy
 {
     SCM port_ = scm_current_warning_port();
@@ -73,6 +151,27 @@ void func()
     scm_newline(port);
 }
 
+template <typename T>
+void init_ivector_transient(const std::string& name)
+{
+    using self_t = typename guile_ivector<T>::transient_type;
+    using size_t = typename self_t::size_type;
+
+    scm::type<self_t>(name)
+        .constructor([](const guile_ivector<T>& v) { return v.transient(); })
+        .define("ref", &self_t::operator[])
+        .define("length", &self_t::size)
+        .define("set!",
+                [](self_t& v, size_t i, scm::val x) { v.set(i, x); })
+        .define("push!", [](self_t& v, scm::val x) { v.push_back(x); })
+        .define("push-list!",
+                [](self_t& v, scm::list xs) {
+                    for (auto x : xs)
+                        v.push_back(x);
+                })
+        .define("persistent", [](self_t& v) { return v.persistent(); });
+}
+
 template <typename T = scm::val>
 void init_ivector(std::string type_name = "")
 {
@@ -83,6 +182,8 @@ void init_ivector(std::string type_name = "")
 
     auto name = "ivector"s + (type_name.empty() ? ""s : "-" + type_name);
 
+    init_ivector_transient<T>(name + "-transient");
+
     scm::type<self_t>(name)
         .constructor(
             [](scm::args rest) { return self_t(rest.begin(), rest.end()); })
@@ -108,8 +209,99 @@ void init_ivector(std::string type_name = "")
                         v = v + x;
                     return v;
                 })
-        .define("fold", [](scm::val fn, scm::val first, const self_t& v) {
-            return immer::accumulate(v, first, fn);
+        .define("fold",
+                [](scm::val fn, scm::val first, const self_t& v) {
+                    return immer::accumulate(v, first, fn);
+                })
+        .define("fold-chunks",
+                [](scm::val fn, scm::val first, const self_t& v) {
+                    immer::for_each_chunk(v, [&](auto f, auto l) {
+                        first = fn(first, scm::val{make_chunk(f, l)});
+                    });
+                    return first;
+                })
+        .define("from-list",
+                [](scm::list xs) { return self_t(xs.begin(), xs.end()); })
+        .define("to-list", [](const self_t& v) {
+            auto r = SCM_EOL;
+            immer::for_each_chunk(v, [&](auto f, auto l) {
+                for (; f != l; ++f)
+                    r = scm_cons(scm::val{*f}, r);
+            });
+            return scm::val{scm_reverse_x(r, SCM_EOL)};
+        });
+}
+
+void init_imap_transient()
+{
+    using self_t = guile_imap::transient_type;
+
+    scm::type<self_t>("imap-transient")
+        .constructor([](const guile_imap& m) { return m.transient(); })
+        .define("ref", &map_ref<self_t>)
+        .define("length", &self_t::size)
+        .define("contains?",
+                [](const self_t& m, scm::val k) {
+                    return scm::val{scm_from_bool(m.count(k))};
+                })
+        .define("set!",
+                [](self_t& m, scm::val k, scm::val x) { m.set(k, x); })
+        .define("erase!", [](self_t& m, scm::val k) { m.erase(k); })
+        .define("set-alist!",
+                [](self_t& m, scm::list xs) {
+                    for (auto x : xs)
+                        m.set(scm_car(x), scm_cdr(x));
+                })
+        .define("persistent", [](self_t& m) { return m.persistent(); });
+}
+
+void init_imap()
+{
+    using self_t = guile_imap;
+
+    init_imap_transient();
+
+    scm::type<self_t>("imap")
+        .constructor([](scm::args rest) {
+            auto t = self_t{}.transient();
+            for (auto x : rest)
+                t.set(scm_car(x), scm_cdr(x));
+            return std::move(t).persistent();
+        })
+        .define("ref", &map_ref<self_t>)
+        .define("length", &self_t::size)
+        .define("contains?",
+                [](const self_t& m, scm::val k) {
+                    return scm::val{scm_from_bool(m.count(k))};
+                })
+        .define("set",
+                [](const self_t& m, scm::val k, scm::val x) {
+                    return m.set(k, x);
+                })
+        .define("update",
+                [](const self_t& m, scm::val k, scm::val fn) {
+                    return m.update(k, fn);
+                })
+        .define("erase",
+                [](const self_t& m, scm::val k) { return m.erase(k); })
+        .define("fold",
+                [](scm::val fn, scm::val first, const self_t& m) {
+                    for (auto& x : m)
+                        first = fn(first, x.first, x.second);
+                    return first;
+                })
+        .define("from-alist",
+                [](scm::list xs) {
+                    auto t = self_t{}.transient();
+                    for (auto x : xs)
+                        t.set(scm_car(x), scm_cdr(x));
+                    return std::move(t).persistent();
+                })
+        .define("to-alist", [](const self_t& m) {
+            auto r = SCM_EOL;
+            for (auto& x : m)
+                r = scm_acons(x.first, x.second, r);
+            return scm::val{r};
         });
 }
 
@@ -145,4 +337,6 @@ extern "C" void init_immer()
     init_ivector<std::int64_t>("s64");
     init_ivector<float>("f32");
     init_ivector<double>("f64");
+
+    init_imap();
 }
@@ -7,9 +7,15 @@
 //
 
 #include <emscripten/bind.h>
+#include <emscripten/val.h>
+#include <immer/algorithm.hpp>
+#include <immer/heap/heap_policy.hpp>
+#include <immer/heap/malloc_heap.hpp>
 #include <immer/refcount/unsafe_refcount_policy.hpp>
 #include <immer/vector.hpp>
 
+#include <vector>
+
 namespace {
 
 using memory_t = immer::memory_policy<
@@ -53,13 +59,85 @@ VectorT set(VectorT& v, std::size_t i, typename VectorT::value_type x)
 }
 
 template <typename T>
-void bind_vector(const char* name)
+struct typed_array;
+
+template <>
+struct typed_array<int>
+{
+    static const char* name() { return "Int32Array"; }
+};
+
+template <>
+struct typed_array<double>
+{
+    static const char* name() { return "Float64Array"; }
+};
+
+// Copies the typed array into the wasm heap at once, instead of
+// crossing the boundary for every element.
+template <typename VectorT>
+VectorT from_array(const emscripten::val& array)
+{
+    using value_t = typename VectorT::value_type;
+    auto buffer   = emscripten::convertJSArrayToNumberVector<value_t>(array);
+    return VectorT{buffer.begin(), buffer.end()};
+}
+
+template <typename T>
+emscripten::val view(const T* first, const T* last)
+{
+    return emscripten::val{
+        emscripten::typed_memory_view(static_cast<std::size_t>(last - first),
+                                      first)};
+}
+
+// The views point into the wasm heap, without copying, thus they are
+// only valid while the vector is alive and the heap does not grow.
+template <typename VectorT>
+emscripten::val chunks(const VectorT& v)
+{
+    auto r = emscripten::val::array();
+    immer::for_each_chunk(v, [&](auto first, auto last) {
+        r.call<void>("push", view(first, last));
+    });
+    return r;
+}
+
+// Calls `fn` with the view of every chunk and the index of its first
+// element, which may stop by returning `false`.
+template <typename VectorT>
+void for_each_chunk(const VectorT& v, emscripten::val fn)
+{
+    auto offset = std::size_t{};
+    immer::for_each_chunk_p(v, [&](auto first, auto last) {
+        auto result = fn(view(first, last), offset);
+        offset += last - first;
+        return result.isUndefined() || result.template as<bool>();
+    });
+}
+
+template <typename VectorT>
+emscripten::val to_array(const VectorT& v)
+{
+    using value_t = typename VectorT::value_type;
+    auto type     = emscripten::val::global(typed_array<value_t>::name());
+    auto r        = emscripten::val{type.new_(v.size())};
+    auto offset   = std::size_t{};
+    immer::for_each_chunk(v, [&](auto first, auto last) {
+        r.call<void>("set", view(first, last), offset);
+        offset += last - first;
+    });
+    return r;
+}
+
+template <typename T>
+auto bind_vector(const char* name)
 {
     using emscripten::class_;
 
     using vector_t = js_vector_t<T>;
 
-    class_<vector_t>(name)
+    return class_<vector_t>(name)
         .constructor()
         .function("push", &push_back<vector_t>)
         .function("set", &set<vector_t>)
@@ -67,6 +145,18 @@ void bind_vector(const char* name)
         .property("size", &vector_t::size);
 }
 
+template <typename T>
+void bind_number_vector(const char* name)
+{
+    using vector_t = js_vector_t<T>;
+
+    bind_vector<T>(name)
+        .class_function("fromArray", &from_array<vector_t>)
+        .function("toArray", &to_array<vector_t>)
+        .function("chunks", &chunks<vector_t>)
+        .function("forEachChunk", &for_each_chunk<vector_t>);
+}
+
 } // anonymous namespace
 
 EMSCRIPTEN_BINDINGS(immer)
@@ -74,8 +164,8 @@ EMSCRIPTEN_BINDINGS(immer)
     using emscripten::function;
 
     bind_vector<emscripten::val>("Vector");
-    bind_vector<int>("VectorInt");
-    bind_vector<double>("VectorNumber");
+    bind_number_vector<int>("VectorInt");
+    bind_number_vector<double>("VectorNumber");
 
     function("range_int", &range<js_vector_t<int>>);
     function("rangeSlow_int", &range_slow<js_vector_t<int>>);
@@ -10,6 +10,10 @@ var immer = Module
 
 var N = 1000
 
+var numbers = new Float64Array(N)
+for (var x = 0; x < N; ++x)
+    numbers[x] = x
+
 var suite = new Benchmark.Suite('push')
     .add('Immutable.List', function(){
         var v = new Immutable.List
@@ -65,6 +69,19 @@ var suite = new Benchmark.Suite('push')
     .add('immer.VectorDouble-NativeTransient', function(){
         immer.range_double(0, N).delete()
     })
+    .add('immer.VectorNumber-FromArray', function(){
+        immer.VectorNumber.fromArray(numbers).delete()
+    })
+    .add('immer.VectorNumber-FromArray-Chunks', function(){
+        var v = immer.VectorNumber.fromArray(numbers)
+        var sum = 0
+        v.forEachChunk(function(chunk) {
+            for (var i = 0; i < chunk.length; ++i)
+                sum += chunk[i]
+        })
+        v.delete()
+        return sum
+    })
     .on('cycle', function(event) {
         console.log(String(event.target));
     })
@@ -1,4 +1,3 @@
-
 # immer: immutable data structures for C++
 # Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
 #
@@ -6,40 +5,293 @@
 # See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
 
 ##
+# Compares the bindings with pyrsistent and with the builtin list and
+# dict, which are mutable and show the cost of immutability.  Every
+# benchmark is run for each size in the comma separated
+# IMMER_BENCHMARK_SIZES, from 1e3 up to 1e8, which is 1e3,1e5 by default:
+#
+#     IMMER_BENCHMARK_SIZES=1e3,1e6,1e8 pytest extra/python/benchmark
+#
+# The sizes above BIG_SIZE are only measured a few times, instead of
+# letting pytest-benchmark calibrate them.  The operations that take
+# arrays need NumPy, and are skipped without it.
+
+import os
+
+import pytest
 
 import immer
 import pyrsistent
 
-BENCHMARK_SIZE = 1000
+try:
+    import numpy
+except ImportError:
+    numpy = None
+
+SIZES = [int(float(x)) for x in
+         os.environ.get("IMMER_BENCHMARK_SIZES", "1e3,1e5").split(",")]
+BIG_SIZE = 10**6
+BIG_ROUNDS = 3
+
+needs_numpy = pytest.mark.skipif(numpy is None, reason="needs NumPy")
+sizes = pytest.mark.parametrize("n", SIZES, ids=lambda n: "n=%g" % n)
+
 
-def push(v, n=BENCHMARK_SIZE):
-    for x in xrange(n):
+def run(benchmark, n, fn, *args):
+    if n > BIG_SIZE:
+        return benchmark.pedantic(fn, args=args, rounds=BIG_ROUNDS,
+                                  iterations=1)
+    return benchmark(fn, *args)
+
+
+# Vectors
+# =======
+
+def push(v, n):
+    for x in range(n):
         v = v.append(x)
     return v
 
+def push_list(n):
+    v = []
+    for x in range(n):
+        v.append(x)
+    return v
+
 def assoc(v):
-    for i in xrange(len(v)):
+    for i in range(len(v)):
         v = v.set(i, i+1)
     return v
 
+def assoc_list(v):
+    v = list(v)
+    for i in range(len(v)):
+        v[i] = i+1
+    return v
+
 def index(v):
-    for i in xrange(len(v)):
+    for i in range(len(v)):
         v[i]
 
-def test_push_immer(benchmark):
-    benchmark(push, immer.Vector())
+def iterate(v):
+    for x in v:
+        pass
+
+def middle(v):
+    n = len(v)
+    return v[n // 4 : n - n // 4]
+
+VECTORS = {
+    "immer": lambda n: push(immer.Vector(), n),
+    "pyrsistent": lambda n: pyrsistent.pvector(range(n)),
+    "list": lambda n: list(range(n)),
+}
+
+vectors = pytest.mark.parametrize("kind", sorted(VECTORS))
+
+@sizes
+def test_push_immer(benchmark, n):
+    run(benchmark, n, push, immer.Vector(), n)
+
+@sizes
+def test_push_pyrsistent(benchmark, n):
+    run(benchmark, n, push, pyrsistent.pvector(), n)
+
+@sizes
+def test_push_list(benchmark, n):
+    run(benchmark, n, push_list, n)
+
+@sizes
+def test_build_pyrsistent(benchmark, n):
+    run(benchmark, n, pyrsistent.pvector, range(n))
+
+@sizes
+def test_build_list(benchmark, n):
+    run(benchmark, n, list, range(n))
+
+@sizes
+def test_assoc_immer(benchmark, n):
+    run(benchmark, n, assoc, VECTORS["immer"](n))
+
+@sizes
+def test_assoc_pyrsistent(benchmark, n):
+    run(benchmark, n, assoc, VECTORS["pyrsistent"](n))
+
+@sizes
+def test_assoc_list(benchmark, n):
+    run(benchmark, n, assoc_list, VECTORS["list"](n))
+
+@sizes
+@vectors
+def test_index(benchmark, kind, n):
+    run(benchmark, n, index, VECTORS[kind](n))
+
+@sizes
+@vectors
+def test_iterate(benchmark, kind, n):
+    run(benchmark, n, iterate, VECTORS[kind](n))
+
+@sizes
+@vectors
+def test_slice(benchmark, kind, n):
+    run(benchmark, n, middle, VECTORS[kind](n))
+
+
+# Buffers
+# =======
+#
+# Moving numbers in and out of NumPy arrays, which the numeric vectors
+# do in bulk and the others element by element.
+
+def buffer_source(n):
+    return numpy.arange(n, dtype=numpy.int64)
+
+@needs_numpy
+@sizes
+def test_from_buffer_immer(benchmark, n):
+    run(benchmark, n, immer.IntVector.from_buffer, buffer_source(n))
+
+@needs_numpy
+@sizes
+def test_from_buffer_pyrsistent(benchmark, n):
+    run(benchmark, n, pyrsistent.pvector, buffer_source(n))
+
+@needs_numpy
+@sizes
+def test_from_buffer_list(benchmark, n):
+    run(benchmark, n, buffer_source(n).tolist)
+
+@needs_numpy
+@sizes
+def test_to_numpy_immer(benchmark, n):
+    v = immer.IntVector.from_buffer(buffer_source(n))
+    run(benchmark, n, v.to_numpy)
+
+@needs_numpy
+@sizes
+def test_to_numpy_immer_chunks(benchmark, n):
+    v = immer.IntVector.from_buffer(buffer_source(n))
+    run(benchmark, n, lambda: sum(len(c) for c in v.chunks()))
+
+@needs_numpy
+@sizes
+def test_to_numpy_pyrsistent(benchmark, n):
+    v = pyrsistent.pvector(range(n))
+    run(benchmark, n, numpy.fromiter, v, numpy.int64, n)
+
+@needs_numpy
+@sizes
+def test_to_numpy_list(benchmark, n):
+    v = list(range(n))
+    run(benchmark, n, numpy.array, v, numpy.int64)
+
+
+# Maps
+# ====
+
+def map_set(m, n):
+    for x in range(n):
+        m = m.set(x, x)
+    return m
+
+def dict_set(n):
+    m = {}
+    for x in range(n):
+        m[x] = x
+    return m
+
+def lookup(m):
+    for k in range(len(m)):
+        m[k]
+
+def contains(m):
+    n = len(m)
+    for k in range(n, 2 * n):
+        k in m
+
+def iterate_keys(m):
+    for k in m:
+        pass
+
+def map_items(n):
+    return dict((x, x) for x in range(n))
+
+MAPS = {
+    "immer": lambda n: immer.Map.from_dict(map_items(n)),
+    "pyrsistent": lambda n: pyrsistent.pmap(map_items(n)),
+    "dict": map_items,
+}
+
+maps = pytest.mark.parametrize("kind", sorted(MAPS))
+
+@sizes
+def test_map_set_immer(benchmark, n):
+    run(benchmark, n, map_set, immer.Map(), n)
+
+@sizes
+def test_map_set_pyrsistent(benchmark, n):
+    run(benchmark, n, map_set, pyrsistent.pmap(), n)
+
+@sizes
+def test_map_set_dict(benchmark, n):
+    run(benchmark, n, dict_set, n)
+
+@sizes
+def test_map_from_dict_immer(benchmark, n):
+    run(benchmark, n, immer.Map.from_dict, map_items(n))
+
+@sizes
+def test_map_from_dict_pyrsistent(benchmark, n):
+    run(benchmark, n, pyrsistent.pmap, map_items(n))
+
+@sizes
+def test_map_from_dict_dict(benchmark, n):
+    run(benchmark, n, dict, map_items(n))
+
+@sizes
+def test_map_update_many_immer(benchmark, n):
+    run(benchmark, n, immer.Map().update_many, map_items(n))
+
+@sizes
+def test_map_update_many_pyrsistent(benchmark, n):
+    run(benchmark, n, pyrsistent.pmap().update, map_items(n))
+
+@sizes
+def test_map_update_many_dict(benchmark, n):
+    run(benchmark, n, lambda items: dict().update(items), map_items(n))
+
+@sizes
+@maps
+def test_map_lookup(benchmark, kind, n):
+    run(benchmark, n, lookup, MAPS[kind](n))
+
+@sizes
+@maps
+def test_map_contains_missing(benchmark, kind, n):
+    run(benchmark, n, contains, MAPS[kind](n))
 
-def test_push_pyrsistent(benchmark):
-    benchmark(push, pyrsistent.pvector())
+@sizes
+@maps
+def test_map_iterate(benchmark, kind, n):
+    run(benchmark, n, iterate_keys, MAPS[kind](n))
 
-def test_assoc_immer(benchmark):
-    benchmark(assoc, push(immer.Vector()))
+@sizes
+def test_map_to_dict_immer(benchmark, n):
+    run(benchmark, n, MAPS["immer"](n).to_dict)
 
-def test_assoc_pyrsistent(benchmark):
-    benchmark(assoc, push(pyrsistent.pvector()))
+@sizes
+def test_map_to_dict_pyrsistent(benchmark, n):
+    run(benchmark, n, dict, MAPS["pyrsistent"](n))
 
-def test_index_immer(benchmark):
-    benchmark(index, push(immer.Vector()))
+@sizes
+def test_map_diff_immer(benchmark, n):
+    m = MAPS["immer"](n)
+    run(benchmark, n, m.diff, m.set(0, -1).erase(1))
 
-def test_index_pyrsistent(benchmark):
-    benchmark(index, push(pyrsistent.pvector()))
+@sizes
+def test_map_diff_dict(benchmark, n):
+    m = MAPS["dict"](n)
+    o = dict(m)
+    o[0] = -1
+    del o[1]
+    run(benchmark, n, lambda: m.items() ^ o.items())
@@ -6,11 +6,25 @@
 // See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
 //
 
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 
+#include <immer/algorithm.hpp>
+#include <immer/hash_cache.hpp>
+#include <immer/map.hpp>
+#include <immer/map_transient.hpp>
+#include <immer/persist.hpp>
 #include <immer/vector.hpp>
+#include <immer/vector_transient.hpp>
 #include <immer/refcount/unsafe_refcount_policy.hpp>
 
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
 namespace {
 
 struct heap_t
@@ -30,12 +44,431 @@ struct heap_t
 
 using memory_t = immer::memory_policy<
     immer::unsafe_free_list_heap_policy<heap_t>,
-    immer::unsafe_refcount_policy>;
+    immer::unsafe_refcount_policy,
+    immer::no_lock_policy>;
+
+// The vectors of numbers are built and copied with the GIL released,
+// so they take their memory from the raw domain, which does not need
+// it, and use a thread safe free list and reference counts
+struct raw_heap_t
+{
+    template <typename ...Tags>
+    static void* allocate(std::size_t size, Tags...)
+    {
+        return PyMem_RawMalloc(size);
+    }
+
+    template <typename ...Tags>
+    static void deallocate(std::size_t, void* obj, Tags...)
+    {
+        PyMem_RawFree(obj);
+    }
+};
+
+using numeric_memory_t = immer::memory_policy<
+    immer::free_list_heap_policy<raw_heap_t>,
+    immer::refcount_policy,
+    immer::default_lock_policy>;
 
 } // anonymous namespace
 
 namespace py = pybind11;
 
+namespace {
+
+struct slice_range
+{
+    std::size_t start = 0;
+    std::size_t stop  = 0;
+    std::size_t step  = 0;
+    std::size_t count = 0;
+};
+
+// Resolving a slice calls into Python, copying it does not
+inline slice_range resolve_slice(std::size_t size, py::slice s)
+{
+    auto r = slice_range{};
+    if (!s.compute(size, &r.start, &r.stop, &r.step, &r.count))
+        throw py::error_already_set{};
+    return r;
+}
+
+// Slices copy the elements into a new vector, a chunk at a time when
+// they are contiguous
+template <typename Vector>
+Vector copy_slice(const Vector& v, slice_range r)
+{
+    auto t = Vector{}.transient();
+    if (r.step == 1 && r.count > 0)
+        immer::for_each_chunk(
+            v.begin() + r.start, v.begin() + r.stop, [&] (auto f, auto l) {
+                for (; f != l; ++f)
+                    t.push_back(*f);
+            });
+    else
+        // negative steps wrap around, which is what we want here
+        for (auto i = std::size_t{}; i < r.count; ++i, r.start += r.step)
+            t.push_back(v[r.start]);
+    return t.persistent();
+}
+
+template <typename Vector>
+Vector slice_vector(const Vector& v, py::slice s)
+{
+    return copy_slice(v, resolve_slice(v.size(), s));
+}
+
+// While a pickle session is open, the vectors of numbers that are
+// pickled name a vector pickled before them in the session as their
+// base, and only write the nodes that are not in it.  Since the
+// pickler memoizes the base, every node shared by the versions is
+// written once.  The first reduction of a vector in the session is
+// remembered, so that the bases never form a cycle.
+class pickle_session
+{
+public:
+    static pickle_session*& current()
+    {
+        static thread_local pickle_session* session = nullptr;
+        return session;
+    }
+
+    ~pickle_session()
+    {
+        if (current() == this)
+            current() = previous_;
+    }
+
+    void enter()
+    {
+        previous_ = current();
+        current() = this;
+    }
+
+    void exit()
+    {
+        current() = previous_;
+        reduced_.clear();
+        last_.clear();
+    }
+
+    // returns the reduction of `self` made before in this session, or
+    // none
+    py::object reduced(const py::object& self) const
+    {
+        for (auto& r : reduced_)
+            if (r.first.ptr() == self.ptr())
+                return r.second;
+        return py::none();
+    }
+
+    // returns the last vector of the type of `self` reduced in this
+    // session, or none, and makes `self` the last one
+    py::object swap_last(const py::object& self)
+    {
+        auto type = self.attr("__class__");
+        for (auto& l : last_)
+            if (l.attr("__class__").ptr() == type.ptr()) {
+                auto r = l;
+                l      = self;
+                return r;
+            }
+        last_.push_back(self);
+        return py::none();
+    }
+
+    void remember(py::object self, py::object reduction)
+    {
+        reduced_.emplace_back(std::move(self), std::move(reduction));
+    }
+
+private:
+    pickle_session* previous_ = nullptr;
+    std::vector<std::pair<py::object, py::object>> reduced_;
+    std::vector<py::object> last_;
+};
+
+// A pickled vector is an archive of the nodes of the vector that are
+// not in its base, and the identifier of the vector in it
+template <typename Vector>
+py::object reduce_vector(py::object self)
+{
+    auto session = pickle_session::current();
+    if (session) {
+        auto r = session->reduced(self);
+        if (!r.is_none())
+            return r;
+    }
+    auto base = session ? session->swap_last(self) : py::object(py::none());
+    auto& v   = self.cast<const Vector&>();
+    auto b    = base.is_none() ? nullptr : &base.cast<const Vector&>();
+    auto data = std::string{};
+    auto id   = std::size_t{};
+    {
+        py::gil_scoped_release nogil;
+        auto out = immer::output_archive{};
+        id       = b ? out.save(v, *b) : out.save(v);
+        auto s   = std::ostringstream{};
+        out.write(s);
+        data = s.str();
+    }
+    auto r = py::make_tuple(self.attr("__class__").attr("_from_archive"),
+                            py::make_tuple(base, py::bytes(data), id));
+    if (session)
+        session->remember(self, r);
+    return r;
+}
+
+template <typename Vector>
+Vector load_vector(py::object base, py::bytes data, std::size_t id)
+{
+    auto b = base.is_none() ? nullptr : &base.cast<const Vector&>();
+    auto s = std::string(data);
+    py::gil_scoped_release nogil;
+    auto in = std::istringstream{s};
+    immer::input_archive archive{in};
+    return b ? archive.load<Vector>(id, *b) : archive.load<Vector>(id);
+}
+
+// Vectors of numbers move in and out of Python a chunk at a time,
+// through the buffer protocol, instead of one call per element
+template <typename T>
+void bind_numeric_vector(py::module& m, const char* name)
+{
+    using vector_t = immer::vector<T, numeric_memory_t>;
+
+    py::class_<vector_t>(m, name)
+        .def(py::init<>())
+        .def("__len__", &vector_t::size)
+        .def("__getitem__",
+             [] (const vector_t& v, std::size_t i) {
+                 if (i >= v.size())
+                     throw py::index_error{"Index out of range"};
+                 return v[i];
+             })
+        .def("__getitem__",
+             [] (const vector_t& v, py::slice s) {
+                 auto r = resolve_slice(v.size(), s);
+                 py::gil_scoped_release nogil;
+                 return copy_slice(v, r);
+             })
+        .def("__iter__",
+             [] (const vector_t& v) {
+                 return py::make_iterator(v.begin(), v.end());
+             },
+             py::keep_alive<0, 1>())
+        .def("__add__",
+             [] (const vector_t& a, const vector_t& b) {
+                 py::gil_scoped_release nogil;
+                 auto t = a.transient();
+                 immer::for_each_chunk(b, [&] (auto first, auto last) {
+                     for (; first != last; ++first)
+                         t.push_back(*first);
+                 });
+                 return t.persistent();
+             },
+             "Returns a vector with the elements of both, sharing the "
+             "nodes of the first one.")
+        .def("__reduce__", &reduce_vector<vector_t>)
+        .def_static("_from_archive", &load_vector<vector_t>)
+        .def("append",
+             [] (const vector_t& v, T x) {
+                 return v.push_back(x);
+             })
+        .def("set",
+             [] (const vector_t& v, std::size_t i, T x) {
+                 if (i >= v.size())
+                     throw py::index_error{"Index out of range"};
+                 return v.set(i, x);
+             })
+        .def_static("from_buffer",
+             [] (py::buffer b) {
+                 auto info = b.request();
+                 if (info.ndim != 1 ||
+                     info.format != py::format_descriptor<T>::format())
+                     throw py::type_error{
+                         "expected a one dimensional buffer of " +
+                         py::format_descriptor<T>::format()};
+                 auto data   = static_cast<const char*>(info.ptr);
+                 auto size   = static_cast<Py_ssize_t>(info.shape[0]);
+                 auto stride = static_cast<Py_ssize_t>(info.strides[0]);
+                 // `info` keeps the buffer alive until we are done
+                 py::gil_scoped_release nogil;
+                 auto t = vector_t{}.transient();
+                 for (auto i = Py_ssize_t{}; i < size; ++i)
+                     t.push_back(*reinterpret_cast<const T*>(data +
+                                                             i * stride));
+                 return t.persistent();
+             },
+             "Builds a vector copying the contents of an object that "
+             "supports the buffer protocol, like a NumPy array.")
+        .def("to_numpy",
+             [] (const vector_t& v) {
+                 auto result = py::array_t<T>(v.size());
+                 auto out    = result.mutable_data();
+                 {
+                     py::gil_scoped_release nogil;
+                     immer::for_each_chunk(v, [&] (auto first, auto last) {
+                         out = std::copy(first, last, out);
+                     });
+                 }
+                 return result;
+             },
+             "Returns a NumPy array with a copy of the contents.")
+        .def("chunks",
+             [] (py::object self) {
+                 auto& v     = self.cast<const vector_t&>();
+                 auto result = py::list{};
+                 immer::for_each_chunk(v, [&] (auto first, auto last) {
+                     // the views keep the vector, and thus its nodes,
+                     // alive and can not be written to
+                     auto a = py::array_t<T>(
+                         {static_cast<Py_ssize_t>(last - first)},
+                         {static_cast<Py_ssize_t>(sizeof(T))},
+                         first,
+                         self);
+                     a.attr("setflags")(py::arg("write") = false);
+                     result.append(a);
+                 });
+                 return result;
+             },
+             "Returns read-only NumPy arrays that view the contiguous "
+             "chunks of the vector in order, without copying them.");
+}
+
+// Python computes the hashes of the keys, which may be slow for some
+// types, so the map keeps them next to the keys
+struct py_hash
+{
+    std::size_t operator()(const py::object& x) const
+    {
+        auto h = PyObject_Hash(x.ptr());
+        if (h == -1 && PyErr_Occurred())
+            throw py::error_already_set{};
+        return static_cast<std::size_t>(h);
+    }
+};
+
+struct py_equal
+{
+    bool operator()(const py::object& a, const py::object& b) const
+    {
+        auto r = PyObject_RichCompareBool(a.ptr(), b.ptr(), Py_EQ);
+        if (r == -1)
+            throw py::error_already_set{};
+        return r == 1;
+    }
+};
+
+using map_t = immer::map<py::object,
+                         py::object,
+                         immer::hash_cache<py_hash>,
+                         py_equal,
+                         memory_t>;
+
+// the argument may be a dict or any iterable of key value pairs
+template <typename Fn>
+void for_each_item(py::object items, Fn&& fn)
+{
+    if (py::isinstance<py::dict>(items))
+        items = items.attr("items")();
+    for (auto item : items) {
+        auto pair = py::reinterpret_borrow<py::tuple>(item);
+        if (pair.size() != 2)
+            throw py::value_error{"expected pairs of key and value"};
+        fn(py::object{pair[0]}, py::object{pair[1]});
+    }
+}
+
+void bind_map(py::module& m)
+{
+    py::class_<map_t>(m, "Map")
+        .def(py::init<>())
+        .def("__len__", &map_t::size)
+        .def("__getitem__",
+             [] (const map_t& v, py::object k) {
+                 auto p = v.find(k);
+                 if (!p)
+                     throw py::key_error{};
+                 return *p;
+             })
+        .def("__contains__",
+             [] (const map_t& v, py::object k) {
+                 return v.count(k) > 0;
+             })
+        .def("__iter__",
+             [] (const map_t& v) {
+                 return py::make_key_iterator(v.begin(), v.end());
+             },
+             py::keep_alive<0, 1>())
+        .def("get",
+             [] (const map_t& v, py::object k, py::object otherwise) {
+                 auto p = v.find(k);
+                 return p ? *p : otherwise;
+             },
+             py::arg("key"), py::arg("default") = py::none())
+        .def("set",
+             [] (const map_t& v, py::object k, py::object x) {
+                 return v.set(std::move(k), std::move(x));
+             })
+        .def("erase",
+             [] (const map_t& v, py::object k) {
+                 return v.erase(k);
+             })
+        .def("update_many",
+             [] (const map_t& v, py::object items) {
+                 auto t = v.transient();
+                 for_each_item(items, [&] (py::object k, py::object x) {
+                     t.set(std::move(k), std::move(x));
+                 });
+                 return t.persistent();
+             },
+             "Returns a map with all the key value pairs of a dict or an "
+             "iterable of pairs set, in a single call.")
+        .def_static("from_dict",
+             [] (py::dict d) {
+                 auto t = map_t{}.transient();
+                 for (auto item : d)
+                     t.set(py::reinterpret_borrow<py::object>(item.first),
+                           py::reinterpret_borrow<py::object>(item.second));
+                 return t.persistent();
+             })
+        .def("to_dict",
+             [] (const map_t& v) {
+                 auto result = py::dict{};
+                 for (auto& x : v)
+                     result[x.first] = x.second;
+                 return result;
+             })
+        .def("__reduce__",
+             [] (py::object self) {
+                 auto cls = self.attr("__class__");
+                 return py::make_tuple(cls.attr("from_dict"),
+                                       py::make_tuple(self.attr("to_dict")()));
+             })
+        .def("diff",
+             [] (const map_t& a, const map_t& b) {
+                 auto added   = py::dict{};
+                 auto removed = py::dict{};
+                 auto changed = py::dict{};
+                 immer::diff(
+                     a,
+                     b,
+                     [&] (auto&& x) { added[x.first] = x.second; },
+                     [&] (auto&& x) { removed[x.first] = x.second; },
+                     [&] (auto&& x, auto&& y) {
+                         changed[x.first] = py::make_tuple(x.second, y.second);
+                     });
+                 return py::make_tuple(added, removed, changed);
+             },
+             "Returns three dicts with the pairs added in the other map, "
+             "the ones removed, and the keys that changed mapped to their "
+             "old and new values.  It skips the subtrees that both maps "
+             "share, which makes it fast when one derives from the other.");
+}
+
+} // anonymous namespace
+
 PYBIND11_PLUGIN(immer_python_module)
 {
     py::module m("immer", R"pbdoc(
@@ -45,6 +478,10 @@ PYBIND11_PLUGIN(immer_python_module)
         .. autosummary::
            :toctree: _generate
            Vector
+           IntVector
+           FloatVector
+           Map
+           PickleSession
     )pbdoc");
 
     using vector_t = immer::vector<py::object, memory_t>;
@@ -54,10 +491,16 @@ PYBIND11_PLUGIN(immer_python_module)
         .def("__len__", &vector_t::size)
         .def("__getitem__",
              [] (const vector_t& v, std::size_t i) {
-                 if (i > v.size())
+                 if (i >= v.size())
                      throw py::index_error{"Index out of range"};
                  return v[i];
              })
+        .def("__getitem__", &slice_vector<vector_t>)
+        .def("__iter__",
+             [] (const vector_t& v) {
+                 return py::make_iterator(v.begin(), v.end());
+             },
+             py::keep_alive<0, 1>())
         .def("append",
              [] (const vector_t& v, py::object x) {
                  return v.push_back(std::move(x));
@@ -65,8 +508,45 @@ PYBIND11_PLUGIN(immer_python_module)
         .def("set",
              [] (const vector_t& v, std::size_t i, py::object x) {
                  return v.set(i, std::move(x));
+             })
+        // the elements are Python objects, which only the pickler
+        // knows how to write, so they are pickled one by one
+        .def("__reduce__",
+             [] (py::object self) {
+                 auto cls = self.attr("__class__");
+                 return py::make_tuple(cls.attr("_from_list"),
+                                       py::make_tuple(py::list(self)));
+             })
+        .def_static("_from_list",
+             [] (py::list xs) {
+                 auto t = vector_t{}.transient();
+                 for (auto x : xs)
+                     t.push_back(py::reinterpret_borrow<py::object>(x));
+                 return t.persistent();
              });
 
+    py::class_<pickle_session>(m, "PickleSession", R"pbdoc(
+        Context manager within which the vectors of numbers that are
+        pickled only write the nodes that they do not share with the
+        ones pickled before them.  Pickling many versions of a vector in
+        a single ``pickle.dumps`` call inside it writes every shared node
+        once.
+    )pbdoc")
+        .def(py::init<>())
+        .def("__enter__",
+             [] (py::object self) {
+                 self.cast<pickle_session&>().enter();
+                 return self;
+             })
+        .def("__exit__",
+             [] (pickle_session& s, py::object, py::object, py::object) {
+                 s.exit();
+             });
+
+    bind_numeric_vector<std::int64_t>(m, "IntVector");
+    bind_numeric_vector<double>(m, "FloatVector");
+    bind_map(m);
+
 #ifdef VERSION_INFO
     m.attr("__version__") = py::str(VERSION_INFO);
 #else
@@ -0,0 +1,267 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/detail/adaptive/sequence.hpp>
+#include <immer/detail/adaptive/iterator.hpp>
+#include <immer/memory_policy.hpp>
+
+#include <cstddef>
+#include <iterator>
+
+namespace immer {
+
+/*!
+ * Immutable sequential container that is stored like an @ref array
+ * while it is small and like a @ref vector once it is not.
+ *
+ * @tparam T The type of the values to be stored in the container.
+ * @tparam MemoryPolicy Memory management policy. See @ref
+ *         memory_policy.
+ * @tparam Threshold The size up to which the elements are kept in a
+ *         single contiguous buffer.
+ *
+ * @rst
+ *
+ * A small array is faster than a tree for every operation, since it is
+ * one allocation and its elements are next to each other, but updating
+ * it copies all of them.  This container switches from one to the other
+ * when a ``push_back`` crosses the ``Threshold``, which by default is
+ * about 4KiB worth of trivially copyable elements, and back when
+ * ``take`` leaves half of it.  The ``B`` and ``BL`` parameters are the
+ * ones of the :cpp:class:`vector` that it turns into.
+ *
+ * It has the same interface as :cpp:class:`vector`, except for the
+ * transients and the operations on ranges of indices.
+ *
+ * @endrst
+ */
+template <typename T,
+          typename MemoryPolicy  = default_memory_policy,
+          detail::rbts::bits_t B = default_bits,
+          detail::rbts::bits_t BL =
+              detail::rbts::derive_bits_leaf<T, MemoryPolicy, B>,
+          std::size_t Threshold = detail::adaptive::default_threshold<T>>
+class adaptive_vector
+{
+    using impl_t =
+        detail::adaptive::sequence<T, MemoryPolicy, B, BL, Threshold>;
+
+public:
+    static constexpr auto bits      = B;
+    static constexpr auto bits_leaf = BL;
+    static constexpr auto threshold = Threshold;
+    using memory_policy             = MemoryPolicy;
+
+    using value_type      = T;
+    using reference       = const T&;
+    using size_type       = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using const_reference = const T&;
+
+    using iterator =
+        detail::adaptive::iterator<T, MemoryPolicy, B, BL, Threshold>;
+    using const_iterator   = iterator;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+
+    /*!
+     * Default constructor.  It creates a vector of `size() == 0`.  It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    adaptive_vector() = default;
+
+    /*!
+     * Constructs a vector containing the elements in `values`.
+     */
+    adaptive_vector(std::initializer_list<T> values)
+        : impl_{impl_t::from_initializer_list(values)}
+    {}
+
+    /*!
+     * Constructs a vector containing the elements in the range
+     * defined by the input iterator `first` and range sentinel `last`.
+     */
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    adaptive_vector(Iter first, Sent last)
+        : impl_{impl_t::from_range(first, last)}
+    {}
+
+    /*!
+     * Constructs a vector containing the element `val` repeated `n`
+     * times.
+     */
+    adaptive_vector(size_type n, T v = {})
+        : impl_{impl_t::from_fill(n, v)}
+    {}
+
+    /*!
+     * Returns an iterator pointing at the first element of the
+     * collection. It does not allocate memory and its complexity is
+     * @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD iterator begin() const { return {impl_}; }
+
+    /*!
+     * Returns an iterator pointing just after the last element of the
+     * collection. It does not allocate and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD iterator end() const
+    {
+        return {impl_, typename iterator::end_t{}};
+    }
+
+    /*!
+     * Returns an iterator that traverses the collection backwards,
+     * pointing at the first element of the reversed collection. It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD reverse_iterator rbegin() const
+    {
+        return reverse_iterator{end()};
+    }
+
+    /*!
+     * Returns an iterator that traverses the collection backwards,
+     * pointing after the last element of the reversed collection. It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD reverse_iterator rend() const
+    {
+        return reverse_iterator{begin()};
+    }
+
+    /*!
+     * Returns the number of elements in the container.  It does
+     * not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD size_type size() const { return impl_.size(); }
+
+    /*!
+     * Returns `true` if there are no elements in the container.  It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD bool empty() const { return impl_.size() == 0; }
+
+    /*!
+     * Access the last element.
+     */
+    IMMER_NODISCARD const T& back() const { return impl_.back(); }
+
+    /*!
+     * Access the first element.
+     */
+    IMMER_NODISCARD const T& front() const { return impl_.front(); }
+
+    /*!
+     * Returns a `const` reference to the element at position `index`.
+     * It is undefined when @f$ 0 index \geq size() @f$.  It does not
+     * allocate memory and its complexity is *effectively* @f$ O(1)
+     * @f$.
+     */
+    IMMER_NODISCARD reference operator[](size_type index) const
+    {
+        return impl_.get(index);
+    }
+
+    /*!
+     * Returns a `const` reference to the element at position
+     * `index`. It throws an `std::out_of_range` exception when @f$
+     * index \geq size() @f$.  It does not allocate memory and its
+     * complexity is *effectively* @f$ O(1) @f$.
+     */
+    reference at(size_type index) const { return impl_.get_check(index); }
+
+    /*!
+     * Returns whether the vectors are equal.
+     */
+    IMMER_NODISCARD bool operator==(const adaptive_vector& other) const
+    {
+        return impl_.equals(other.impl_);
+    }
+    IMMER_NODISCARD bool operator!=(const adaptive_vector& other) const
+    {
+        return !(*this == other);
+    }
+
+    /*!
+     * Returns a vector with `value` inserted at the end.  It may
+     * allocate memory.  Its complexity is @f$ O(Threshold) @f$ while
+     * the vector is small, and *effectively* @f$ O(1) @f$ afterwards.
+     */
+    IMMER_NODISCARD adaptive_vector push_back(value_type value) const
+    {
+        return impl_.push_back(std::move(value));
+    }
+
+    /*!
+     * Returns a vector with a new element at the end, constructed in
+     * place with the arguments `args`.  Its complexity is the one of
+     * `push_back`.
+     */
+    template <typename... Args>
+    IMMER_NODISCARD adaptive_vector emplace_back(Args&&... args) const
+    {
+        return impl_.emplace_back(std::forward<Args>(args)...);
+    }
+
+    /*!
+     * Returns a vector containing value `value` at position `idx`.
+     * Undefined for `index >= size()`.  It may allocate memory and its
+     * complexity is the one of `push_back`.
+     */
+    IMMER_NODISCARD adaptive_vector set(size_type index,
+                                        value_type value) const
+    {
+        return impl_.assoc(index, std::move(value));
+    }
+
+    /*!
+     * Returns a vector containing the result of the expression
+     * `fn((*this)[idx])` at position `idx`.  Undefined for `index >=
+     * size()`.  It may allocate memory and its complexity is the one of
+     * `push_back`.
+     */
+    template <typename FnT>
+    IMMER_NODISCARD adaptive_vector update(size_type index, FnT&& fn) const
+    {
+        return impl_.update(index, std::forward<FnT>(fn));
+    }
+
+    /*!
+     * Returns a vector containing only the first `min(elems, size())`
+     * elements. It may allocate memory and its complexity is
+     * *effectively* @f$ O(1) @f$, or @f$ O(Threshold) @f$ when the
+     * result is small.
+     */
+    IMMER_NODISCARD adaptive_vector take(size_type elems) const
+    {
+        return impl_.take(elems);
+    }
+
+    /*!
+     * Returns whether the elements are stored in a tree, instead of in
+     * a single array.
+     */
+    IMMER_NODISCARD bool is_tree() const { return impl_.is_big; }
+
+    // Semi-private
+    const impl_t& impl() const { return impl_; }
+
+    adaptive_vector(impl_t impl)
+        : impl_(std::move(impl))
+    {}
+
+private:
+    impl_t impl_ = {};
+};
+
+} // namespace immer
@@ -8,11 +8,18 @@
 
 #pragma once
 
+#include <immer/detail/reduce.hpp>
+#include <immer/executor.hpp>
+
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
 #include <functional>
+#include <iterator>
+#include <memory>
 #include <numeric>
 #include <type_traits>
+#include <vector>
 
 namespace immer {
 
@@ -59,6 +66,21 @@ void for_each_chunk(const T* first, const T* last, Fn&& fn)
     std::forward<Fn>(fn)(first, last);
 }
 
+/*!
+ * Apply operation `fn` for every contiguous *chunk* of data in the
+ * range, like @a for_each_chunk, but splitting the work in subtrees of
+ * about equal size that are processed using the executor `ex` (see
+ * @ref executor).  The chunks are visited in no particular order and
+ * `fn` may be invoked concurrently from different threads, so it must
+ * be safe to do so.  It is supported by ``vector``, ``flex_vector``,
+ * ``map``, ``set`` and ``table``.
+ */
+template <typename Range, typename Fn, typename Executor = thread_executor>
+void par_for_each_chunk(const Range& r, Fn&& fn, Executor&& ex = {})
+{
+    r.impl().par_for_each_chunk(fn, ex);
+}
+
 /*!
  * Apply operation `fn` for every contiguous *chunk* of data in the
  * range sequentially, until `fn` returns `false`.  Each time, `Fn` is
@@ -93,6 +115,73 @@ bool for_each_chunk_p(const T* first, const T* last, Fn&& fn)
     return std::forward<Fn>(fn)(first, last);
 }
 
+/*!
+ * A contiguous part of the memory of a container, in bytes, as used by
+ * scatter-gather I/O.
+ */
+struct io_span
+{
+    const void* data;
+    std::size_t size;
+};
+
+namespace detail {
+
+template <typename Span, typename T, typename OutIter>
+auto as_iovecs_fn(OutIter& out)
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "only trivially copyable values can be sent as bytes");
+    return [&out](const T* first, const T* last) {
+        if (first != last)
+            *out++ = Span{const_cast<void*>(static_cast<const void*>(first)),
+                          static_cast<std::size_t>(last - first) * sizeof(T)};
+    };
+}
+
+} // namespace detail
+
+/*!
+ * Writes to `out` a span for every contiguous *chunk* of data in the
+ * range, in order, and returns the iterator past the last one.  It
+ * allows sending a container of trivially copyable values with
+ * scatter-gather I/O, like `writev` or `io_uring`, without copying it
+ * into a buffer first.  The spans are of type `Span`, which is
+ * initialized with a `void*` and a size in bytes, so that the type of
+ * the system can be written directly:
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    auto iovs = std::vector<iovec>{};
+ *    immer::as_iovecs<iovec>(v, std::back_inserter(iovs));
+ *    writev(fd, iovs.data(), iovs.size());
+ *
+ * .. note:: The spans point into the nodes of the container, that live
+ *    as long as some copy of it does.  Since copying it takes constant
+ *    time, a copy kept until an asynchronous send completes is the
+ *    handle that keeps the data alive.  Systems limit how many spans
+ *    can be passed at once, to ``IOV_MAX`` for ``writev``.
+ *
+ * @endrst
+ */
+template <typename Span = io_span, typename Range, typename OutIter>
+OutIter as_iovecs(const Range& r, OutIter out)
+{
+    using value_t = typename Range::value_type;
+    for_each_chunk(r, detail::as_iovecs_fn<Span, value_t>(out));
+    return out;
+}
+
+template <typename Span = io_span, typename Iterator, typename OutIter>
+OutIter as_iovecs(const Iterator& first, const Iterator& last, OutIter out)
+{
+    using value_t = typename std::iterator_traits<Iterator>::value_type;
+    for_each_chunk(first, last, detail::as_iovecs_fn<Span, value_t>(out));
+    return out;
+}
+
 namespace detail {
 
 template <class Iter, class T>
@@ -156,6 +245,96 @@ T accumulate(Iterator first, Iterator last, T init, Fn fn)
     return init;
 }
 
+/*!
+ * Cache of the partial results of @a par_reduce over the nodes of a
+ * container.  It keeps the last reduced version alive, so the nodes
+ * that it remembers can not be reused for other data.
+ *
+ * A memo should only be used with versions of the same container and
+ * the same `init` and `combine` arguments.
+ */
+template <typename T>
+class reduce_memo
+{
+public:
+    using cache_t = typename detail::reduce_cache<T>::map_t;
+
+    /*!
+     * Returns the number of partial results that are cached.
+     */
+    std::size_t size() const { return cache_.size(); }
+
+    /*!
+     * Forgets all the partial results and the last reduced version.
+     */
+    void clear()
+    {
+        cache_.clear();
+        version_.reset();
+    }
+
+    // Semi-private
+    const cache_t& cache() const { return cache_; }
+
+    void update(std::shared_ptr<const void> version, cache_t cache)
+    {
+        cache_   = std::move(cache);
+        version_ = std::move(version);
+    }
+
+private:
+    cache_t cache_;
+    std::shared_ptr<const void> version_;
+};
+
+/*!
+ * Reduces the elements of the range `r` with the associative function
+ * `combine`, splitting the work in subtrees that are processed using
+ * the executor `ex` (see @ref executor).  `combine` is used both to
+ * fold an element into a partial result, as `combine(T, const
+ * value_type&)`, and to join two partial results, as `combine(T, T)`.
+ * Because every task starts its partial result from `init`, it must be
+ * an identity of `combine`, like `0` is for addition.  `combine` may
+ * be invoked concurrently from different threads.  The elements of
+ * sequences are combined in order, so `combine` does not need to be
+ * commutative for them.  It is supported by ``vector``,
+ * ``flex_vector``, ``map``, ``set`` and ``table``.
+ */
+template <typename Range,
+          typename T,
+          typename Combine,
+          typename Executor = thread_executor>
+T par_reduce(const Range& r, T init, Combine&& combine, Executor&& ex = {})
+{
+    using cache_t = typename detail::reduce_cache<T>::map_t;
+    return r.impl().par_reduce(init,
+                               combine,
+                               ex,
+                               static_cast<const cache_t*>(nullptr),
+                               static_cast<cache_t*>(nullptr));
+}
+
+/*!
+ * Like @a par_reduce, but the partial results of the nodes of `r` are
+ * looked up in the `memo` before computing them, and the `memo` is
+ * then updated to hold the partial results of `r`.  When `r` shares
+ * most of its structure with the last version reduced with the same
+ * `memo`, only the nodes that changed are reduced again, plus a lookup
+ * for every inner node that is reused.
+ */
+template <typename Range, typename T, typename Combine, typename Executor>
+T par_reduce(const Range& r,
+             T init,
+             Combine&& combine,
+             Executor&& ex,
+             reduce_memo<T>& memo)
+{
+    auto fresh  = typename reduce_memo<T>::cache_t{};
+    auto result = r.impl().par_reduce(init, combine, ex, &memo.cache(), &fresh);
+    memo.update(std::make_shared<Range>(r), std::move(fresh));
+    return result;
+}
+
 /*!
  * Equivalent of `std::for_each` applied to the range `r`.
  */
@@ -207,6 +386,34 @@ OutIter copy(InIter first, InIter last, OutIter out)
     return out;
 }
 
+/*!
+ * Like @a copy, but the range `r` is split in slices of about the same
+ * size that are copied concurrently using the executor `ex` (see @ref
+ * executor), each of them to its offset in the random access output
+ * iterator `out`.  Every chunk is copied with `std::copy`, which for
+ * trivially copyable elements copied to a pointer becomes a single
+ * ``memmove``.  It is supported by ``vector``, ``flex_vector`` and
+ * ``slice_view``.
+ */
+template <typename Range, typename OutIter, typename Executor = thread_executor>
+OutIter par_copy(const Range& r, OutIter out, Executor&& ex = {})
+{
+    using diff_t = typename std::iterator_traits<OutIter>::difference_type;
+    auto&& impl  = r.impl();
+    auto size    = static_cast<std::size_t>(r.size());
+    detail::bulk_ranges(ex,
+                        size,
+                        detail::bulk_min_elements,
+                        [&](std::size_t first, std::size_t last) {
+                            auto o = out + static_cast<diff_t>(first);
+                            impl.for_each_chunk(
+                                first, last, [&](auto f, auto l) {
+                                    o = std::copy(f, l, o);
+                                });
+                        });
+    return out + static_cast<diff_t>(size);
+}
+
 /*!
  * Equivalent of `std::all_of` applied to the range `r`.
  */
@@ -229,6 +436,146 @@ bool all_of(Iter first, Iter last, Pred p)
     });
 }
 
+/*!
+ * Equivalent of `std::find_if` applied to the range `r`.  Every chunk
+ * is searched with `std::find_if`, and the traversal stops at the
+ * first one that contains a match.  It is supported by ``vector``,
+ * ``flex_vector``, ``array``, ``slice_view`` and ``reversed_view``, for
+ * which advancing the returned iterator to its index is @f$ O(1) @f$.
+ */
+template <typename Range, typename Pred>
+auto find_if(const Range& r, Pred p)
+{
+    auto offset = std::size_t{};
+    for_each_chunk_p(r, [&](auto first, auto last) {
+        auto it = std::find_if(first, last, p);
+        offset += static_cast<std::size_t>(it - first);
+        return it == last;
+    });
+    return std::next(r.begin(), offset);
+}
+
+/*!
+ * Equivalent of `std::find` applied to the range `r`.  It is
+ * supported by the same containers as @a find_if.  Every chunk is
+ * searched with `std::find`, that the compilers vectorize for
+ * arithmetic types.
+ */
+template <typename Range, typename T>
+auto find(const Range& r, const T& value)
+{
+    auto offset = std::size_t{};
+    for_each_chunk_p(r, [&](auto first, auto last) {
+        auto it = std::find(first, last, value);
+        offset += static_cast<std::size_t>(it - first);
+        return it == last;
+    });
+    return std::next(r.begin(), offset);
+}
+
+/*!
+ * Equivalent of `std::count` applied to the range `r`.
+ */
+template <typename Range, typename T>
+std::size_t count(const Range& r, const T& value)
+{
+    auto n = std::size_t{};
+    for_each_chunk(r, [&](auto first, auto last) {
+        n += static_cast<std::size_t>(std::count(first, last, value));
+    });
+    return n;
+}
+
+/*!
+ * Equivalent of `std::count_if` applied to the range `r`.
+ */
+template <typename Range, typename Pred>
+std::size_t count_if(const Range& r, Pred p)
+{
+    auto n = std::size_t{};
+    for_each_chunk(r, [&](auto first, auto last) {
+        n += static_cast<std::size_t>(std::count_if(first, last, p));
+    });
+    return n;
+}
+
+/*!
+ * Returns `true` if the ranges `a` and `b` have the same size and
+ * their elements compare equal one by one.  Unlike the comparison
+ * operators of the containers, the ranges may be of different types,
+ * like a ``vector`` and a ``flex_vector`` or a ``slice_view`` of
+ * either.  The chunks of both ranges are compared with `std::equal`
+ * and it stops at the first mismatch.  It is supported by the same
+ * containers as @a find_if.
+ */
+template <typename RangeA, typename RangeB>
+bool equal(const RangeA& a, const RangeB& b)
+{
+    using diff_t = typename std::iterator_traits<
+        decltype(b.begin())>::difference_type;
+    if (static_cast<std::size_t>(a.size()) !=
+        static_cast<std::size_t>(b.size()))
+        return false;
+    auto bi = b.begin();
+    return for_each_chunk_p(a, [&](auto first, auto last) {
+        auto bl = bi + static_cast<diff_t>(last - first);
+        auto ok = for_each_chunk_p(bi, bl, [&](auto f, auto l) {
+            auto eq = std::equal(f, l, first);
+            first += l - f;
+            return eq;
+        });
+        bi = bl;
+        return ok;
+    });
+}
+
+/*!
+ * Equivalent of `std::min_element` applied to the range `r`.  The
+ * minimum of every chunk is found with `std::min_element` and compared
+ * to the best one so far.  It is supported by the same containers as
+ * @a find_if.
+ */
+template <typename Range, typename Compare = std::less<>>
+auto min_element(const Range& r, Compare cmp = {})
+{
+    using value_t = typename Range::value_type;
+    auto best     = static_cast<const value_t*>(nullptr);
+    auto index    = std::size_t{};
+    auto offset   = std::size_t{};
+    for_each_chunk(r, [&](auto first, auto last) {
+        auto it = std::min_element(first, last, cmp);
+        if (it != last && (!best || cmp(*it, *best))) {
+            best  = &*it;
+            index = offset + static_cast<std::size_t>(it - first);
+        }
+        offset += static_cast<std::size_t>(last - first);
+    });
+    return std::next(r.begin(), best ? index : offset);
+}
+
+/*!
+ * Equivalent of `std::max_element` applied to the range `r`.  Like
+ * the standard one, it returns the first of the largest elements.  It
+ * is supported by the same containers as @a find_if.
+ */
+template <typename Range, typename Compare = std::less<>>
+auto max_element(const Range& r, Compare cmp = {})
+{
+    using value_t = typename Range::value_type;
+    auto best     = static_cast<const value_t*>(nullptr);
+    auto index    = std::size_t{};
+    auto offset   = std::size_t{};
+    for_each_chunk(r, [&](auto first, auto last) {
+        auto it = std::max_element(first, last, cmp);
+        if (it != last && (!best || cmp(*best, *it))) {
+            best  = &*it;
+            index = offset + static_cast<std::size_t>(it - first);
+        }
+        offset += static_cast<std::size_t>(last - first);
+    });
+    return std::next(r.begin(), best ? index : offset);
+}
+
 /*!
  * Object that can be used to process changes as computed by the @a diff
  * algorithm.
@@ -298,18 +645,87 @@ auto make_differ(AddedFn&& added, RemovedFn&& removed)
  *
  * @rst
  *
- * .. note:: This method is only implemented for ``map`` and ``set``. When sets
- *           are diffed, the ``changed`` function is never called.
+ * .. note:: When sets are diffed, the ``changed`` function is never called.
  *
  * @endrst
+ *
+ * For ``vector`` and ``flex_vector`` the callbacks receive index ranges
+ * ``(first, last)`` instead of elements:
+ *
+ *   - `differ.changed(first, last)` for the indices present in both `a`
+ *      and `b` that hold different elements.  Adjacent changes are
+ *      reported as a single range.
+ *
+ *   - `differ.added(first, last)` for the indices past the end of `a`.
+ *
+ *   - `differ.removed(first, last)` for the indices past the end of `b`.
+ *
+ * Subtrees that are shared at the same position are skipped, so the
+ * cost is @f$ O(|diff| \log n) @f$ when `b` is derived from `a` by
+ * @f$ |diff| @f$ updates.  Note that inserting or erasing elements in
+ * the middle of a flex_vector shifts all the following indices, which
+ * are then reported as changed.
  */
+namespace detail {
+
+// Whether the nodes of the container `T` hold some of its values in
+// boxes, see `out_of_line_policy`.
+template <typename T, typename = void>
+struct has_out_of_line_values : std::false_type
+{};
+
+template <typename T>
+struct has_out_of_line_values<
+    T,
+    std::enable_if_t<T::stored_value_t::out_of_line>> : std::true_type
+{};
+
+template <typename T, typename Pred>
+T filter_impl(const T& c, Pred& pred, std::false_type)
+{
+    return T{c.impl().filter(pred)};
+}
+
+template <typename T, typename Pred>
+T filter_impl(const T& c, Pred& pred, std::true_type)
+{
+    using storage_t = typename T::stored_value_t;
+    return T{c.impl().filter(
+        [&](const auto& x) { return pred(storage_t::get(x)); })};
+}
+
 template <typename T, typename Differ>
-void diff(const T& a, const T& b, Differ&& differ)
+void diff_impl(const T& a, const T& b, Differ&& differ, std::false_type)
 {
     a.impl().template diff<std::equal_to<typename T::value_type>>(
         b.impl(), std::forward<Differ>(differ));
 }
 
+template <typename T, typename Differ>
+void diff_impl(const T& a, const T& b, Differ&& differ, std::true_type)
+{
+    using storage_t = typename T::stored_value_t;
+    a.impl().template diff<std::equal_to<typename T::value_type>>(
+        b.impl(),
+        make_differ(
+            [&](const auto& x) { differ.added(storage_t::get(x)); },
+            [&](const auto& x) { differ.removed(storage_t::get(x)); },
+            [&](const auto& x, const auto& y) {
+                differ.changed(storage_t::get(x), storage_t::get(y));
+            }));
+}
+
+} // namespace detail
+
+template <typename T, typename Differ>
+void diff(const T& a, const T& b, Differ&& differ)
+{
+    detail::diff_impl(a,
+                      b,
+                      std::forward<Differ>(differ),
+                      detail::has_out_of_line_values<T>{});
+}
+
 /*!
  * Compute the differences between `a` and `b` using the callbacks in `fns` as
  * differ.  Equivalent to `diff(a, b, make_differ(fns)...)`.
@@ -320,6 +736,120 @@ void diff(const T& a, const T& b, Fns&&... fns)
     diff(a, b, make_differ(std::forward<Fns>(fns)...));
 }
 
+/*!
+ * Returns a container with the elements of `c` for which `pred`
+ * returns `true`.  It is supported by ``map``, ``set`` and ``table``,
+ * and the headers of ``vector`` and ``flex_vector`` provide overloads
+ * for them.  The subtrees where every element is kept are shared with
+ * the result, and the nodes that are left empty are removed, thus a
+ * filter that keeps most of the elements costs time proportional to
+ * the size of `c`, but memory proportional to the removed ones.
+ */
+template <typename T, typename Pred>
+T filter(const T& c, Pred&& pred)
+{
+    return detail::filter_impl(c, pred, detail::has_out_of_line_values<T>{});
+}
+
+/*!
+ * Returns a container with the elements of `a` and `b`, which must be
+ * both sets, maps or tables of the same type.  For the keys in both
+ * maps or tables, the value in `a` is kept.  The two tries are
+ * traversed at once and the subtrees that they share are reused
+ * without visiting them, thus the complexity is @f$ O(|diff|) @f$ when
+ * `b` is derived from `a` by @f$ |diff| @f$ updates, and at most
+ * @f$ O(|b| + |a|) @f$.  Use `map::merge` to combine the values instead.
+ */
+template <typename T>
+T set_union(const T& a, const T& b)
+{
+    return T{a.impl().merge(
+        b.impl(), [](const auto& x, const auto&) { return x; })};
+}
+
+/*!
+ * Like @a set_union, but the subtrees under the roots of `a` and `b`
+ * are merged concurrently using the executor `ex` (see @ref executor).
+ * Since they hold disjoint ranges of hashes, this splits the work in
+ * up to 32 tasks of about the same size.
+ */
+template <typename T, typename Executor = thread_executor>
+T par_set_union(const T& a, const T& b, Executor&& ex = {})
+{
+    return T{a.impl().par_merge(
+        b.impl(), [](const auto& x, const auto&) { return x; }, ex)};
+}
+
+/*!
+ * Returns a container with the elements of `a` whose key is also in
+ * `b`.  It shares the structure of `a` and has the same complexity as
+ * @a set_union.
+ */
+template <typename T>
+T set_intersection(const T& a, const T& b)
+{
+    return T{a.impl().intersect(b.impl())};
+}
+
+/*!
+ * Returns a container with the elements of `a` whose key is not in
+ * `b`.  It shares the structure of `a` and has the same complexity as
+ * @a set_union.
+ */
+template <typename T>
+T set_difference(const T& a, const T& b)
+{
+    return T{a.impl().subtract(b.impl())};
+}
+
+/*!
+ * Splits the set, map or table `c` in `2^log2_parts` containers of the
+ * same type, where the i-th holds the elements of `c` whose hash ends
+ * with the bits of `i`.  These are the elements under the slots of the
+ * trie whose index ends with those bits, thus the parts reuse whole
+ * subtrees of `c`, wrapped in new nodes for the levels that the bits
+ * select from, and no element is copied.  It makes @f$ O(k) @f$ nodes
+ * for @f$ k @f$ parts, and it takes the time to count the elements of
+ * the reused subtrees, without touching the elements themselves.  Use
+ * @a join_partitions to put them back together.  `log2_parts` must not
+ * be larger than 32.
+ */
+template <typename T>
+std::vector<T> partition_by_hash(const T& c, unsigned log2_parts)
+{
+    auto parts = c.impl().partition(log2_parts);
+    auto r     = std::vector<T>{};
+    r.reserve(parts.size());
+    for (auto& p : parts)
+        r.push_back(T{std::move(p)});
+    return r;
+}
+
+/*!
+ * Returns the set, map or table with the elements of all the
+ * containers in the range `r`, which must hold disjoint ranges of
+ * hashes, like those returned by @a partition_by_hash.  They are
+ * joined pairwise with @a set_union in a balanced tree, and since
+ * their elements fall in different slots of the tries, the subtrees
+ * of the parts are reused and only the nodes above them are made.
+ */
+template <typename Range>
+auto join_partitions(const Range& r) -> std::decay_t<decltype(*std::begin(r))>
+{
+    using container_t = std::decay_t<decltype(*std::begin(r))>;
+    auto parts        = std::vector<container_t>(std::begin(r), std::end(r));
+    while (parts.size() > 1) {
+        auto next = std::vector<container_t>{};
+        next.reserve((parts.size() + 1) / 2);
+        for (auto i = std::size_t{}; i + 1 < parts.size(); i += 2)
+            next.push_back(set_union(parts[i], parts[i + 1]));
+        if (parts.size() % 2)
+            next.push_back(std::move(parts.back()));
+        parts = std::move(next);
+    }
+    return parts.empty() ? container_t{} : std::move(parts.front());
+}
+
 /** @} */ // group: algorithm
 
 } // namespace immer
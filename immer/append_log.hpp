@@ -0,0 +1,252 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/atom.hpp>
+#include <immer/config.hpp>
+#include <immer/vector.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace immer {
+
+/*!
+ * Log of values of type `T` that many threads append to at once, and
+ * that is read as a ``vector``.
+ *
+ * @tparam T The type of the values, that must be nothrow move
+ *         constructible.
+ * @tparam MemoryPolicy Memory management policy. See @ref
+ *         memory_policy.
+ *
+ * @rst
+ *
+ * Appending to an ``atom`` of a vector copies its tail every time, and
+ * retries when another thread appended meanwhile, so the threads spend
+ * most of their time redoing each other's work.  Here, every append
+ * claims a slot with one ``fetch_add`` on a counter, and moves the
+ * value into that slot of a leaf that is being filled.  Every leaf is
+ * allocated in advance, a few of them at a time.  The thread that
+ * fills the last slot of a leaf grafts the whole leaf onto the
+ * published vector, in the order of the slots, with one update of its
+ * spine.  Thus, appends do not copy anything and do not retry, and the
+ * publishing is done once every :math:`2^{BL}` of them.
+ *
+ * .. code-block:: c++
+ *
+ *    immer::append_log<event> log;
+ *    // in every producer
+ *    log.push(event{...});
+ *    // in any reader
+ *    immer::vector<event> events = log.snapshot();
+ *
+ * The snapshots only have the leaves that are full, that is, they lag
+ * behind by less than :math:`2^{BL}` values per leaf being filled.
+ * ``flush()`` publishes the rest.  A flushed leaf that was not full is
+ * appended value by value, and the appends that follow go into a new
+ * leaf.
+ *
+ * .. note:: The log can hold at most as many partially filled leaves
+ *    as there are leaves allocated in advance.  A producer that gets
+ *    too far ahead of the slowest ones waits for them.
+ *
+ * @endrst
+ */
+template <typename T,
+          typename MemoryPolicy  = default_memory_policy,
+          detail::rbts::bits_t B = default_bits,
+          detail::rbts::bits_t BL =
+              detail::rbts::derive_bits_leaf<T, MemoryPolicy, B>>
+class append_log
+{
+    static_assert(std::is_nothrow_move_constructible<T>::value,
+                  "the values are moved into the slots after claiming them");
+
+public:
+    using value_type    = T;
+    using size_type     = std::size_t;
+    using memory_policy = MemoryPolicy;
+
+    using vector_type = vector<T, MemoryPolicy, B, BL>;
+
+private:
+    using tree_t  = detail::rbts::rbtree<T, MemoryPolicy, B, BL>;
+    using node_t  = typename tree_t::node_t;
+    using owner_t = typename tree_t::owner_t;
+    using atom_t  = atom<vector_type, MemoryPolicy>;
+
+    static constexpr auto leaf_size = detail::rbts::branches<BL, size_type>;
+    static constexpr auto ring_size = size_type{64};
+
+    // A leaf that is being filled.  It holds the leaf number `seq`
+    // once the one before it in the ring was published.
+    struct segment
+    {
+        node_t* leaf = node_t::make_leaf_n(leaf_size);
+        std::atomic<size_type> seq{};
+        // the slots that are not filled yet
+        std::atomic<size_type> remaining{leaf_size};
+        // the number of values, less than `leaf_size` when flushed
+        std::atomic<size_type> count{leaf_size};
+        bool ready = false;
+    };
+
+public:
+    /*!
+     * Constructs a log with the values of `init`.
+     */
+    append_log(vector_type init = {})
+        : state_{init}
+        , vector_{std::move(init)}
+    {
+        for (auto i = size_type{}; i < ring_size; ++i)
+            ring_[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    append_log(const append_log&) = delete;
+    append_log(append_log&&)      = delete;
+    void operator=(const append_log&) = delete;
+    void operator=(append_log&&) = delete;
+
+    ~append_log()
+    {
+        flush();
+        for (auto& s : ring_)
+            node_t::heap::deallocate(node_t::sizeof_leaf_n(leaf_size),
+                                     s.leaf);
+    }
+
+    /*!
+     * Appends `value` to the log.  It is thread safe, and it is
+     * published when its leaf is full, or on the next `flush()`.
+     */
+    void push(T value)
+    {
+        auto i    = next_.fetch_add(1, std::memory_order_relaxed);
+        auto& seg = acquire(i / leaf_size);
+        new (seg.leaf->leaf() + i % leaf_size) T(std::move(value));
+        if (seg.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            complete(seg);
+    }
+
+    /*!
+     * Publishes the values that were pushed before the call, including
+     * those of the leaf that is being filled.  It is thread safe, and
+     * it waits for the pushes that are still filling their slots.
+     */
+    void flush()
+    {
+        auto i = next_.load(std::memory_order_relaxed);
+        while (i % leaf_size) {
+            auto end = i - i % leaf_size + leaf_size;
+            if (next_.compare_exchange_weak(i, end)) {
+                // closes the leaf, taking the slots that nobody can
+                // claim anymore as filled
+                auto& seg = acquire(i / leaf_size);
+                auto n    = i % leaf_size;
+                seg.count.store(n, std::memory_order_relaxed);
+                if (seg.remaining.fetch_sub(leaf_size - n,
+                                            std::memory_order_acq_rel) ==
+                    leaf_size - n)
+                    complete(seg);
+                i = end;
+                break;
+            }
+        }
+        auto leaves = (i + leaf_size - 1) / leaf_size;
+        while (published_.load(std::memory_order_acquire) < leaves)
+            std::this_thread::yield();
+    }
+
+    /*!
+     * Returns the published values.
+     */
+    IMMER_NODISCARD vector_type snapshot() const { return *state_.load(); }
+
+private:
+    // waits until the leaf number `s` has a segment
+    segment& acquire(size_type s)
+    {
+        auto& seg = ring_[s % ring_size];
+        while (seg.seq.load(std::memory_order_acquire) != s)
+            std::this_thread::yield();
+        return seg;
+    }
+
+    // publishes the segments that are complete, in order
+    void complete(segment& seg)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        seg.ready = true;
+        auto p    = published_.load(std::memory_order_relaxed);
+        auto v    = vector_;
+        for (; ring_[p % ring_size].ready; ++p) {
+            auto& next = ring_[p % ring_size];
+            v          = graft(std::move(v), next);
+            next.count.store(leaf_size, std::memory_order_relaxed);
+            next.remaining.store(leaf_size, std::memory_order_relaxed);
+            next.ready = false;
+            next.seq.store(p + ring_size, std::memory_order_release);
+        }
+        vector_ = v;
+        state_.store(std::move(v));
+        published_.store(p, std::memory_order_release);
+    }
+
+    // appends the values of `seg` to `v`, and leaves `seg` with an
+    // empty leaf
+    vector_type graft(vector_type v, segment& seg)
+    {
+        auto n    = seg.count.load(std::memory_order_relaxed);
+        auto leaf = seg.leaf;
+        auto t    = v.impl();
+        auto e    = owner_t{};
+        if (n == leaf_size && t.size % leaf_size == 0) {
+            auto fresh = node_t::make_leaf_n(leaf_size);
+            if (t.size == 0)
+                t = tree_t{leaf_size, BL, tree_t::empty_root(), leaf};
+            else {
+                IMMER_TRY {
+                    t.push_tail_mut(e, t.tail_offset(), leaf);
+                }
+                IMMER_CATCH (...) {
+                    node_t::heap::deallocate(
+                        node_t::sizeof_leaf_n(leaf_size), fresh);
+                    IMMER_RETHROW;
+                }
+                t.size += leaf_size;
+            }
+            seg.leaf = fresh;
+        } else {
+            // the leaves of a vector must be full, but for its tail
+            for (auto i = size_type{}; i < n; ++i)
+                t.push_back_mut(e, leaf->leaf()[i]);
+            detail::destroy_n(leaf->leaf(), n);
+        }
+        e = owner_t{};
+        return t;
+    }
+
+    atom_t state_;
+    std::atomic<size_type> next_{0};
+    std::atomic<size_type> published_{0};
+    std::mutex mutex_;
+    // the last published vector, guarded by `mutex_`
+    vector_type vector_;
+    std::array<segment, ring_size> ring_;
+};
+
+} // namespace immer
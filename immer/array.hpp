@@ -11,11 +11,12 @@
 #include <immer/detail/arrays/with_capacity.hpp>
 #include <immer/memory_policy.hpp>
 
+#include <algorithm>
 #include <cstddef>
 
 namespace immer {
 
-template <typename T, typename MemoryPolicy>
+template <typename T, typename MemoryPolicy, typename Growth>
 class array_transient;
 
 /*!
@@ -23,6 +24,10 @@ class array_transient;
  * contiguous memory.
  *
  * @tparam T The type of the values to be stored in the container.
+ * @tparam MemoryPolicy Memory management policy. See @ref
+ *         memory_policy.
+ * @tparam Growth Growth policy of the buffer of the transients, like
+ *         @a geometric_growth.
  *
  * @rst
  *
@@ -39,13 +44,15 @@ class array_transient;
  *
  * @endrst
  */
-template <typename T, typename MemoryPolicy = default_memory_policy>
+template <typename T,
+          typename MemoryPolicy = default_memory_policy,
+          typename Growth       = default_array_growth>
 class array
 {
-    using impl_t =
-        std::conditional_t<MemoryPolicy::use_transient_rvalues,
-                           detail::arrays::with_capacity<T, MemoryPolicy>,
-                           detail::arrays::no_capacity<T, MemoryPolicy>>;
+    using impl_t = std::conditional_t<
+        MemoryPolicy::use_transient_rvalues,
+        detail::arrays::with_capacity<T, MemoryPolicy, Growth>,
+        detail::arrays::no_capacity<T, MemoryPolicy>>;
 
     using move_t =
         std::integral_constant<bool, MemoryPolicy::use_transient_rvalues>;
@@ -62,7 +69,7 @@ public:
     using reverse_iterator = std::reverse_iterator<iterator>;
 
     using memory_policy  = MemoryPolicy;
-    using transient_type = array_transient<T, MemoryPolicy>;
+    using transient_type = array_transient<T, MemoryPolicy, Growth>;
 
     /*!
      * Default constructor.  It creates an array of `size() == 0`.  It
@@ -90,6 +97,26 @@ public:
         : impl_{impl_t::from_range(first, last)}
     {}
 
+    /*!
+     * Returns an array with the elements of the range `r`.  When it is
+     * a forward range, its size is known upfront and the array is made
+     * with a single allocation of exactly that size.  Otherwise the
+     * elements are pushed into a transient, that grows as per
+     * `Growth`.
+     */
+    template <typename Range>
+    IMMER_NODISCARD static array from_range(const Range& r)
+    {
+        using std::begin;
+        using std::end;
+        return from_range_impl(
+            begin(r),
+            end(r),
+            std::integral_constant<
+                bool,
+                detail::is_forward_iterator_v<decltype(begin(r))>>{});
+    }
+
     /*!
      * Constructs an array containing the element `val` repeated `n`
      * times.
@@ -178,6 +205,21 @@ public:
      */
     reference at(size_type index) const { return impl_.get_check(index); }
 
+    /*!
+     * Writes to the output iterator `out` the elements at the indices
+     * in the range `indices`, and returns the iterator past the last
+     * one written.  The elements of an array are contiguous, thus it
+     * is just `operator[]` for every index, provided for symmetry with
+     * the other sequences.  Undefined for indices @f$ \geq size() @f$.
+     */
+    template <typename Indices, typename Out>
+    Out get_many(const Indices& indices, Out out) const
+    {
+        for (auto&& index : indices)
+            *out++ = data()[index];
+        return out;
+    }
+
     /*!
      * Returns whether the vectors are equal.
      */
@@ -215,6 +257,50 @@ public:
         return push_back_move(move_t{}, std::move(value));
     }
 
+    /*!
+     * Returns a array with a new element at the end, constructed in
+     * place with the arguments `args`.  Unlike `push_back`, no
+     * temporary `value_type` is made nor moved, which matters for
+     * values that are expensive to move.  It may allocate memory and
+     * its complexity is the one of `push_back`.
+     */
+    template <typename... Args>
+    IMMER_NODISCARD array emplace_back(Args&&... args) const&
+    {
+        return impl_.emplace_back(std::forward<Args>(args)...);
+    }
+    template <typename... Args>
+    IMMER_NODISCARD decltype(auto) emplace_back(Args&&... args) &&
+    {
+        return emplace_back_move(move_t{}, std::forward<Args>(args)...);
+    }
+
+    /*!
+     * Returns an array with the elements in the range defined by the
+     * forward iterator `first` and range sentinel `last` inserted at
+     * the end.  It allocates memory only once and its complexity is
+     * @f$ O(size + n) @f$ for @f$ n @f$ elements.
+     */
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent> &&
+                                   detail::is_forward_iterator_v<Iter>,
+                               bool> = true>
+    IMMER_NODISCARD array append(Iter first, Sent last) const&
+    {
+        return impl_.append(first, last);
+    }
+
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent> &&
+                                   detail::is_forward_iterator_v<Iter>,
+                               bool> = true>
+    IMMER_NODISCARD decltype(auto) append(Iter first, Sent last) &&
+    {
+        return append_move(move_t{}, first, last);
+    }
+
     /*!
      * Returns an array containing value `value` at position `idx`.
      * Undefined for `index >= size()`.
@@ -241,6 +327,32 @@ public:
         return set_move(move_t{}, index, std::move(value));
     }
 
+    /*!
+     * Returns an array with the value of every `(index, value)` pair in
+     * the range defined by the input iterator `first` and range
+     * sentinel `last` set at its index, where later pairs win.  It
+     * copies the elements only once, and its complexity is @f$ O(size
+     * + n) @f$ for @f$ n @f$ pairs.  Undefined when an index is @f$
+     * \geq size() @f$.
+     */
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    IMMER_NODISCARD array set_many(Iter first, Sent last) const&
+    {
+        return impl_.assoc_many(first, last);
+    }
+
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    IMMER_NODISCARD decltype(auto) set_many(Iter first, Sent last) &&
+    {
+        return set_many_move(move_t{}, first, last);
+    }
+
     /*!
      * Returns an array containing the result of the expression
      * `fn((*this)[idx])` at position `idx`.
@@ -337,6 +449,30 @@ private:
         return impl_.push_back(std::move(value));
     }
 
+    template <typename... Args>
+    array&& emplace_back_move(std::true_type, Args&&... args)
+    {
+        impl_.emplace_back_mut({}, std::forward<Args>(args)...);
+        return std::move(*this);
+    }
+    template <typename... Args>
+    array emplace_back_move(std::false_type, Args&&... args)
+    {
+        return impl_.emplace_back(std::forward<Args>(args)...);
+    }
+
+    template <typename Iter, typename Sent>
+    array&& append_move(std::true_type, Iter first, Sent last)
+    {
+        impl_.append_mut({}, first, last);
+        return std::move(*this);
+    }
+    template <typename Iter, typename Sent>
+    array append_move(std::false_type, Iter first, Sent last)
+    {
+        return impl_.append(first, last);
+    }
+
     array&& set_move(std::true_type, size_type index, value_type value)
     {
         impl_.assoc_mut({}, index, std::move(value));
@@ -347,6 +483,18 @@ private:
         return impl_.assoc(index, std::move(value));
     }
 
+    template <typename Iter, typename Sent>
+    array&& set_many_move(std::true_type, Iter first, Sent last)
+    {
+        impl_.assoc_many_mut({}, first, last);
+        return std::move(*this);
+    }
+    template <typename Iter, typename Sent>
+    array set_many_move(std::false_type, Iter first, Sent last)
+    {
+        return impl_.assoc_many(first, last);
+    }
+
     template <typename Fn>
     array&& update_move(std::true_type, size_type index, Fn&& fn)
     {
@@ -369,7 +517,43 @@ private:
         return impl_.take(elems);
     }
 
+    template <typename Iter, typename Sent>
+    static array from_range_impl(Iter first, Sent last, std::true_type)
+    {
+        return impl_t::from_range(first, last);
+    }
+
+    template <typename Iter, typename Sent>
+    static array from_range_impl(Iter first, Sent last, std::false_type)
+    {
+        auto t = transient_type{};
+        for (; first != last; ++first)
+            t.push_back(*first);
+        return std::move(t).persistent();
+    }
+
     impl_t impl_ = impl_t::empty();
 };
 
+/*!
+ * Returns an array with the elements of `a` for which `pred` returns
+ * `true`, in the same order.  When all of them are kept it returns `a`
+ * itself.
+ */
+template <typename T, typename MemoryPolicy, typename Growth, typename Pred>
+array<T, MemoryPolicy, Growth>
+filter(const array<T, MemoryPolicy, Growth>& a, Pred&& pred)
+{
+    auto first =
+        std::find_if(a.begin(), a.end(), [&](const T& x) { return !pred(x); });
+    if (first == a.end())
+        return a;
+    auto r = a.take(static_cast<std::size_t>(first - a.begin()));
+    std::for_each(first + 1, a.end(), [&](const T& x) {
+        if (pred(x))
+            r = std::move(r).push_back(x);
+    });
+    return r;
+}
+
 } /* namespace immer */
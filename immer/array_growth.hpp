@@ -0,0 +1,51 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+
+namespace immer {
+
+/*!
+ * Growth policy for the buffer of an ``array_transient``, and of an
+ * ``array`` whose memory policy uses transient rvalues.  When a buffer
+ * of capacity `cap` has to fit `sz > cap` elements, the new capacity is
+ * the greatest of `sz` and `cap * Num / Den`.  Since it grows by a
+ * constant factor, adding `n` elements one by one copies every element
+ * a constant number of times, amortized.
+ *
+ * @rst
+ *
+ * .. note:: A factor closer to one wastes less memory and copies more
+ *    often.  When the final size is known, ``reserve()`` makes a single
+ *    allocation of exactly that size, whatever the policy.
+ *
+ * @endrst
+ */
+template <std::size_t Num = 2, std::size_t Den = 1>
+struct geometric_growth
+{
+    static_assert(Den > 0 && Num > Den,
+                  "the growth factor must be greater than one");
+
+    static std::size_t recommend(std::size_t sz, std::size_t cap)
+    {
+        auto max = std::numeric_limits<std::size_t>::max();
+        return sz <= cap          ? cap
+               : cap >= max / Num ? max
+                                  /* otherwise */
+                                  : std::max(cap * Num / Den, sz);
+    }
+};
+
+using default_array_growth = geometric_growth<>;
+
+} // namespace immer
@@ -15,7 +15,7 @@
 
 namespace immer {
 
-template <typename T, typename MemoryPolicy>
+template <typename T, typename MemoryPolicy, typename Growth>
 class array;
 
 /*!
@@ -28,10 +28,13 @@ class array;
  *
  * @endrst
  */
-template <typename T, typename MemoryPolicy = default_memory_policy>
+template <typename T,
+          typename MemoryPolicy = default_memory_policy,
+          typename Growth       = default_array_growth>
 class array_transient : MemoryPolicy::transience_t::owner
 {
-    using impl_t             = detail::arrays::with_capacity<T, MemoryPolicy>;
+    using impl_t = detail::arrays::with_capacity<T, MemoryPolicy, Growth>;
+
     using impl_no_capacity_t = detail::arrays::no_capacity<T, MemoryPolicy>;
     using owner_t            = typename MemoryPolicy::transience_t::owner;
 
@@ -47,7 +50,7 @@ public:
     using reverse_iterator = std::reverse_iterator<iterator>;
 
     using memory_policy   = MemoryPolicy;
-    using persistent_type = array<T, MemoryPolicy>;
+    using persistent_type = array<T, MemoryPolicy, Growth>;
 
     /*!
      * Default constructor.  It creates a mutable array of `size() ==
@@ -101,6 +104,20 @@ public:
      */
     IMMER_NODISCARD bool empty() const { return impl_.size == 0; }
 
+    /*!
+     * Returns the number of elements that fit in the buffer without
+     * allocating a new one.
+     */
+    IMMER_NODISCARD std::size_t capacity() const { return impl_.capacity; }
+
+    /*!
+     * Makes room for at least `n` elements.  When the buffer is smaller
+     * it is replaced by one of exactly `n` elements, thus a builder
+     * that knows its final size does a single allocation.  It may
+     * allocate memory and its complexity is @f$ O(size) @f$.
+     */
+    void reserve(size_type n) { impl_.reserve_mut(*this, n); }
+
     /*!
      * Access the raw data.
      */
@@ -146,6 +163,33 @@ public:
         impl_.push_back_mut(*this, std::move(value));
     }
 
+    /*!
+     * Inserts a new element at the end, constructed in place with the
+     * arguments `args`.  It may allocate memory and its complexity is
+     * *effectively* @f$ O(1) @f$.
+     */
+    template <typename... Args>
+    void emplace_back(Args&&... args)
+    {
+        impl_.emplace_back_mut(*this, std::forward<Args>(args)...);
+    }
+
+    /*!
+     * Inserts the elements in the range defined by the forward
+     * iterator `first` and range sentinel `last` at the end.  It may
+     * allocate memory and its complexity is *effectively* @f$ O(n) @f$
+     * for @f$ n @f$ elements.
+     */
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent> &&
+                                   detail::is_forward_iterator_v<Iter>,
+                               bool> = true>
+    void append(Iter first, Sent last)
+    {
+        impl_.append_mut(*this, first, last);
+    }
+
     /*!
      * Sets to the value `value` at position `idx`.
      * Undefined for `index >= size()`.
@@ -157,6 +201,22 @@ public:
         impl_.assoc_mut(*this, index, std::move(value));
     }
 
+    /*!
+     * Sets the value of every `(index, value)` pair in the range
+     * defined by the input iterator `first` and range sentinel `last`
+     * at its index, where later pairs win.  Undefined when an index is
+     * @f$ \geq size() @f$.  It may allocate memory and its complexity
+     * is *effectively* @f$ O(n) @f$ for @f$ n @f$ pairs.
+     */
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    void set_many(Iter first, Sent last)
+    {
+        impl_.assoc_many_mut(*this, first, last);
+    }
+
     /*!
      * Updates the array to contain the result of the expression
      * `fn((*this)[idx])` at position `idx`.
@@ -9,10 +9,20 @@
 #pragma once
 
 #include <immer/box.hpp>
+#include <immer/detail/hazard_pointers.hpp>
 #include <immer/refcount/no_refcount_policy.hpp>
 
 #include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace immer {
 
@@ -59,6 +69,12 @@ struct refcount_atom_impl
 
     template <typename Fn>
     box_type update(Fn&& fn)
+    {
+        return update_exchange(std::forward<Fn>(fn)).second;
+    }
+
+    template <typename Fn>
+    std::pair<box_type, box_type> update_exchange(Fn&& fn)
     {
         while (true) {
             auto oldv = load();
@@ -67,7 +83,7 @@ struct refcount_atom_impl
                 scoped_lock_t lock{lock_};
                 if (oldv.impl_ == impl_.impl_) {
                     impl_ = newv;
-                    return {newv};
+                    return {std::move(oldv), std::move(newv)};
                 }
             }
         }
@@ -78,6 +94,93 @@ private:
     box_type impl_;
 };
 
+template <typename T, typename MemoryPolicy>
+struct hazard_atom_impl
+{
+    using box_type      = box<T, MemoryPolicy>;
+    using value_type    = T;
+    using memory_policy = MemoryPolicy;
+    using holder_t      = typename box_type::holder;
+
+    hazard_atom_impl(const hazard_atom_impl&) = delete;
+    hazard_atom_impl(hazard_atom_impl&&)      = delete;
+    hazard_atom_impl& operator=(const hazard_atom_impl&) = delete;
+    hazard_atom_impl& operator=(hazard_atom_impl&&) = delete;
+
+    hazard_atom_impl(box_type b)
+        : impl_{b.impl_}
+    {
+        b.impl_ = nullptr;
+    }
+
+    ~hazard_atom_impl() { box_type{impl_.load(std::memory_order_relaxed)}; }
+
+    box_type load() const
+    {
+        auto& hazard = hazard_domain::local();
+        auto p       = impl_.load(std::memory_order_relaxed);
+        while (true) {
+            hazard.ptr.store(p, std::memory_order_seq_cst);
+            auto q = impl_.load(std::memory_order_seq_cst);
+            if (p == q)
+                break;
+            p = q;
+        }
+        p->inc();
+        hazard.ptr.store(nullptr, std::memory_order_release);
+        return {p};
+    }
+
+    void store(box_type b)
+    {
+        retire(impl_.exchange(b.impl_, std::memory_order_seq_cst));
+        b.impl_ = nullptr;
+    }
+
+    box_type exchange(box_type b)
+    {
+        auto p  = impl_.exchange(b.impl_, std::memory_order_seq_cst);
+        b.impl_ = nullptr;
+        // readers may still be about to take a reference to it
+        p->inc();
+        retire(p);
+        return {p};
+    }
+
+    template <typename Fn>
+    box_type update(Fn&& fn)
+    {
+        return update_exchange(std::forward<Fn>(fn)).second;
+    }
+
+    template <typename Fn>
+    std::pair<box_type, box_type> update_exchange(Fn&& fn)
+    {
+        while (true) {
+            auto oldv = load();
+            auto newv = oldv.update(fn);
+            auto p    = oldv.impl_;
+            newv.impl_->inc();
+            if (impl_.compare_exchange_strong(
+                    p, newv.impl_, std::memory_order_seq_cst)) {
+                retire(p);
+                return {std::move(oldv), std::move(newv)};
+            }
+            newv.impl_->dec();
+        }
+    }
+
+private:
+    static void retire(holder_t* p)
+    {
+        hazard_domain::global().retire(p, [](void* x) {
+            box_type{static_cast<holder_t*>(x)};
+        });
+    }
+
+    std::atomic<holder_t*> impl_;
+};
+
 template <typename T, typename MemoryPolicy>
 struct gc_atom_impl
 {
@@ -106,12 +209,19 @@ struct gc_atom_impl
 
     template <typename Fn>
     box_type update(Fn&& fn)
+    {
+        return update_exchange(std::forward<Fn>(fn)).second;
+    }
+
+    template <typename Fn>
+    std::pair<box_type, box_type> update_exchange(Fn&& fn)
     {
         while (true) {
             auto oldv = box_type{impl_.load()};
             auto newv = oldv.update(fn);
-            if (impl_.compare_exchange_weak(oldv.impl_, newv.impl_))
-                return {newv};
+            auto p    = oldv.impl_;
+            if (impl_.compare_exchange_weak(p, newv.impl_))
+                return {std::move(oldv), std::move(newv)};
         }
     }
 
@@ -119,11 +229,374 @@ private:
     std::atomic<typename box_type::holder*> impl_;
 };
 
+template <typename T>
+struct inline_atom_impl
+{
+    using box_type      = box<T, inline_box_policy>;
+    using value_type    = T;
+    using memory_policy = inline_box_policy;
+
+    inline_atom_impl(const inline_atom_impl&) = delete;
+    inline_atom_impl(inline_atom_impl&&)      = delete;
+    inline_atom_impl& operator=(const inline_atom_impl&) = delete;
+    inline_atom_impl& operator=(inline_atom_impl&&) = delete;
+
+    inline_atom_impl(box_type b)
+        : impl_{b.get()}
+    {}
+
+    box_type load() const { return impl_.load(); }
+
+    void store(box_type b) { impl_.store(b.get()); }
+
+    box_type exchange(box_type b) { return impl_.exchange(b.get()); }
+
+    template <typename Fn>
+    box_type update(Fn&& fn)
+    {
+        return update_exchange(std::forward<Fn>(fn)).second;
+    }
+
+    template <typename Fn>
+    std::pair<box_type, box_type> update_exchange(Fn&& fn)
+    {
+        auto oldv = impl_.load();
+        while (true) {
+            auto newv = box_type{oldv}.update(fn);
+            if (impl_.compare_exchange_weak(oldv, newv.get()))
+                return {box_type{oldv}, std::move(newv)};
+        }
+    }
+
+private:
+    std::atomic<T> impl_;
+};
+
+// If we are using "real" garbage collection (we assume this when we use
+// `no_refcount_policy`), we just store the pointer in an atomic, otherwise
+// `Impl` decides how the value is kept alive while it is being loaded.
+// Inline boxes need no protection at all and live in a plain atomic.
+template <typename T, typename MemoryPolicy, typename Impl>
+struct gc_or_atom_impl
+{
+    using type =
+        std::conditional_t<std::is_same<typename MemoryPolicy::refcount,
+                                        no_refcount_policy>::value,
+                           gc_atom_impl<T, MemoryPolicy>,
+                           Impl>;
+};
+
+template <typename T, typename Impl>
+struct gc_or_atom_impl<T, inline_box_policy, Impl>
+{
+    using type = inline_atom_impl<T>;
+};
+
+template <typename T, typename MemoryPolicy, typename Impl>
+using gc_or_atom_impl_t = typename gc_or_atom_impl<T, MemoryPolicy, Impl>::type;
+
+// A single compare and swap of a plain atomic is already cheaper than
+// publishing a request, so inline boxes skip the combining.
+template <typename Impl>
+using combining_or_inline_impl_t =
+    std::conditional_t<std::is_same<typename Impl::memory_policy,
+                                    inline_box_policy>::value,
+                       Impl,
+                       combining_atom_impl<Impl>>;
+
+template <typename Impl>
+struct combining_atom_impl
+{
+    using box_type      = typename Impl::box_type;
+    using value_type    = typename Impl::value_type;
+    using memory_policy = typename Impl::memory_policy;
+
+    combining_atom_impl(const combining_atom_impl&) = delete;
+    combining_atom_impl(combining_atom_impl&&)      = delete;
+    combining_atom_impl& operator=(const combining_atom_impl&) = delete;
+    combining_atom_impl& operator=(combining_atom_impl&&) = delete;
+
+    combining_atom_impl(box_type b)
+        : impl_{std::move(b)}
+    {}
+
+    box_type load() const { return impl_.load(); }
+
+    void store(box_type b) { impl_.store(std::move(b)); }
+
+    box_type exchange(box_type b) { return impl_.exchange(std::move(b)); }
+
+    template <typename Fn>
+    box_type update(Fn&& fn)
+    {
+        request r;
+        publish(r, fn, false);
+        return std::move(r.result);
+    }
+
+    template <typename Fn>
+    std::pair<box_type, box_type> update_exchange(Fn&& fn)
+    {
+        request r;
+        publish(r, fn, true);
+        return {std::move(r.old), std::move(r.result)};
+    }
+
+private:
+    struct request
+    {
+        void* fn;
+        value_type (*apply)(void*, const value_type&);
+        request* next;
+        bool want_old;
+        // empty until the combiner fills them in, so that no value is
+        // allocated up front
+        box_type old    = box_type{nullptr_holder()};
+        box_type result = box_type{nullptr_holder()};
+        std::exception_ptr error;
+        std::atomic<bool> done{false};
+    };
+
+    static typename box_type::holder* nullptr_holder() { return nullptr; }
+
+    template <typename Fn>
+    void publish(request& r, Fn& fn, bool want_old)
+    {
+        r.want_old = want_old;
+        r.fn = const_cast<void*>(static_cast<const void*>(std::addressof(fn)));
+        r.apply = [](void* f, const value_type& v) -> value_type {
+            return (*static_cast<Fn*>(f))(v);
+        };
+        r.next = pending_.load(std::memory_order_relaxed);
+        while (!pending_.compare_exchange_weak(
+            r.next, &r, std::memory_order_release, std::memory_order_relaxed))
+            ;
+        while (!r.done.load(std::memory_order_acquire)) {
+            if (!combining_.exchange(true, std::memory_order_acquire)) {
+                combine();
+                combining_.store(false, std::memory_order_release);
+            } else
+                std::this_thread::yield();
+        }
+        if (r.error)
+            std::rethrow_exception(r.error);
+    }
+
+    void combine()
+    {
+        auto batch = pending_.exchange(nullptr, std::memory_order_acquire);
+        if (!batch)
+            return;
+        // the requests are popped newest first, apply them in order
+        auto first = static_cast<request*>(nullptr);
+        while (batch) {
+            auto next   = batch->next;
+            batch->next = first;
+            first       = batch;
+            batch       = next;
+        }
+        IMMER_TRY {
+            impl_.update([&](const value_type& v) {
+                auto x    = v;
+                auto prev = static_cast<const box_type*>(nullptr);
+                for (auto r = first; r; r = r->next) {
+                    IMMER_TRY {
+                        auto y = r->apply(r->fn, x);
+                        if (r->want_old)
+                            r->old = prev ? *prev : box_type{x};
+                        x         = std::move(y);
+                        r->result = box_type{x};
+                        r->error  = nullptr;
+                        prev      = &r->result;
+                    }
+                    IMMER_CATCH (...) {
+                        r->error = std::current_exception();
+                    }
+                }
+                return x;
+            });
+        }
+        IMMER_CATCH (...) {
+            for (auto r = first; r; r = r->next)
+                r->error = std::current_exception();
+        }
+        for (auto r = first; r;) {
+            auto next = r->next;
+            r->done.store(true, std::memory_order_release);
+            r = next;
+        }
+    }
+
+    Impl impl_;
+    std::atomic<request*> pending_{nullptr};
+    std::atomic<bool> combining_{false};
+};
+
+struct transaction_access;
+
+/*!
+ * Wakes up the threads waiting on an atom and calls its watchers.
+ * Writers only pay for an uncontended read-modify-write and a load
+ * when nobody is waiting nor watching.
+ */
+template <typename Box>
+struct atom_notifier
+{
+    using watcher_t  = std::function<void(const Box&, const Box&)>;
+    using watchers_t = std::vector<std::pair<std::size_t, watcher_t>>;
+
+    bool watched() const { return watched_.load(std::memory_order_acquire); }
+
+    void changed()
+    {
+        // the read-modify-writes on waiters_ are ordered with the one
+        // in wait(): either the waiter sees the new value or we see it
+        if (waiters_.fetch_add(0, std::memory_order_acq_rel)) {
+            std::lock_guard<std::mutex> lock{mutex_};
+            cv_.notify_all();
+        }
+    }
+
+    void changed(const Box& old, const Box& new_)
+    {
+        changed();
+        auto ws = std::shared_ptr<const watchers_t>{};
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            ws = watchers_;
+        }
+        if (ws)
+            for (auto&& w : *ws)
+                w.second(old, new_);
+    }
+
+    template <typename Load>
+    Box wait(const Box& old, Load&& load)
+    {
+        std::unique_lock<std::mutex> lock{mutex_};
+        waiters_.fetch_add(1, std::memory_order_acq_rel);
+        auto cur = load();
+        while (detail::box_identical(cur, old)) {
+            cv_.wait(lock);
+            cur = load();
+        }
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+        return cur;
+    }
+
+    std::size_t watch(watcher_t w)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        auto ws = watchers_ ? std::make_shared<watchers_t>(*watchers_)
+                            : std::make_shared<watchers_t>();
+        ws->emplace_back(++last_id_, std::move(w));
+        watchers_ = std::move(ws);
+        watched_.store(true, std::memory_order_release);
+        return last_id_;
+    }
+
+    void unwatch(std::size_t id)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (!watchers_)
+            return;
+        auto ws = std::make_shared<watchers_t>();
+        for (auto&& w : *watchers_)
+            if (w.first != id)
+                ws->push_back(w);
+        watched_.store(!ws->empty(), std::memory_order_release);
+        watchers_ = ws->empty() ? nullptr : std::move(ws);
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::atomic<int> waiters_{0};
+    std::atomic<bool> watched_{false};
+    std::shared_ptr<const watchers_t> watchers_;
+    std::size_t last_id_ = 0;
+};
+
 } // namespace detail
 
+/*!
+ * Reclamation policy for `atom` that protects the stored value with
+ * the `lock` of the memory policy, making every operation take it.
+ */
+struct lock_reclamation_policy
+{
+    template <typename T, typename MemoryPolicy>
+    struct apply
+    {
+        using type = detail::gc_or_atom_impl_t<
+            T,
+            MemoryPolicy,
+            detail::refcount_atom_impl<T, MemoryPolicy>>;
+    };
+};
+
+/*!
+ * Reclamation policy for `atom` that protects the stored value with
+ * hazard pointers.  Loading never takes a lock nor writes to the atom
+ * itself, and the updates are a compare and swap of its pointer, so
+ * it scales much better when many threads access the same atom.  The
+ * reference that the atom held on a replaced value is dropped once no
+ * thread is in the middle of loading it.
+ */
+struct hazard_pointer_reclamation_policy
+{
+    template <typename T, typename MemoryPolicy>
+    struct apply
+    {
+        using type = detail::gc_or_atom_impl_t<
+            T,
+            MemoryPolicy,
+            detail::hazard_atom_impl<T, MemoryPolicy>>;
+    };
+};
+
+/*!
+ * Reclamation policy for `atom` that combines the concurrent updates.
+ * A thread calling `update` publishes its function and, if no other
+ * thread is doing so, it becomes the combiner: it applies all the
+ * published functions in turn and stores the last value with a single
+ * update of the underlying atom.  Every thread gets the value that
+ * resulted from its own function.  Thus, under contention, the
+ * functions are not evaluated again and again after failed attempts,
+ * and the throughput grows with the number of writers instead of
+ * collapsing.  The loads and stores go straight to the underlying
+ * atom, whose protection is chosen with `ReclamationPolicy`.  Atoms
+ * of boxes with an `inline_box_policy` are not combined, they are
+ * already a single compare and swap.
+ *
+ * @rst
+ *
+ * .. note:: The functions are run by whichever thread is combining,
+ *    and an exception thrown by one of them is rethrown only in the
+ *    thread that published it.
+ *
+ * @endrst
+ */
+template <typename ReclamationPolicy = lock_reclamation_policy>
+struct combining_reclamation_policy
+{
+    template <typename T, typename MemoryPolicy>
+    struct apply
+    {
+        using type = detail::combining_or_inline_impl_t<
+            typename ReclamationPolicy::template apply<T, MemoryPolicy>::type>;
+    };
+};
+
 /*!
  * Stores for boxed values of type `T` in a thread-safe manner.
  *
+ * @tparam ReclamationPolicy Decides how the stored value is protected
+ *     from being freed while it is being loaded, when the memory
+ *     policy uses reference counting.  It can be either
+ *     `lock_reclamation_policy` or `hazard_pointer_reclamation_policy`,
+ *     optionally wrapped in `combining_reclamation_policy`.
+ *
  * @see box
  *
  * @rst
@@ -145,13 +618,16 @@ private:
  *
  * @endrst
  */
-template <typename T, typename MemoryPolicy = default_memory_policy>
+template <typename T,
+          typename MemoryPolicy      = default_memory_policy,
+          typename ReclamationPolicy = lock_reclamation_policy>
 class atom
 {
 public:
-    using box_type      = box<T, MemoryPolicy>;
-    using value_type    = T;
-    using memory_policy = MemoryPolicy;
+    using box_type           = box<T, MemoryPolicy>;
+    using value_type         = T;
+    using memory_policy      = MemoryPolicy;
+    using reclamation_policy = ReclamationPolicy;
 
     atom(const atom&) = delete;
     atom(atom&&)      = delete;
@@ -170,7 +646,7 @@ public:
      */
     atom& operator=(box_type b)
     {
-        impl_.store(std::move(b));
+        store(std::move(b));
         return *this;
     }
 
@@ -192,14 +668,31 @@ public:
     /*!
      * Stores a new value in a thread-safe manner.
      */
-    void store(box_type b) { impl_.store(std::move(b)); }
+    void store(box_type b)
+    {
+        if (notifier_.watched()) {
+            auto old = impl_.exchange(b);
+            notifier_.changed(old, b);
+        } else {
+            impl_.store(std::move(b));
+            notifier_.changed();
+        }
+    }
 
     /*!
      * Stores a new value and returns the old value, in a thread-safe manner.
      */
     IMMER_NODISCARD box_type exchange(box_type b)
     {
-        return impl_.exchange(std::move(b));
+        if (notifier_.watched()) {
+            auto old = impl_.exchange(b);
+            notifier_.changed(old, b);
+            return old;
+        } else {
+            auto old = impl_.exchange(std::move(b));
+            notifier_.changed();
+            return old;
+        }
     }
 
     /*!
@@ -217,38 +710,72 @@ public:
     template <typename Fn>
     box_type update(Fn&& fn)
     {
-        return impl_.update(std::forward<Fn>(fn));
+        if (notifier_.watched()) {
+            auto r = impl_.update_exchange(std::forward<Fn>(fn));
+            notifier_.changed(r.first, r.second);
+            return std::move(r.second);
+        } else {
+            auto r = impl_.update(std::forward<Fn>(fn));
+            notifier_.changed();
+            return r;
+        }
     }
 
-private:
-    struct get_refcount_atom_impl
+    /*!
+     * Blocks the calling thread until the atom holds a box other than
+     * `old`, and returns it.  It does not poll: the thread sleeps until
+     * a `store`, `exchange` or `update` wakes it up.  If the atom
+     * already holds another box, it returns right away.
+     *
+     * @rst
+     *
+     * .. note:: Boxes are compared by identity, so storing a new box
+     *    with an equal value wakes the waiters too.
+     *
+     * @endrst
+     */
+    box_type wait(const box_type& old) const
     {
-        template <typename U, typename MP>
-        struct apply
-        {
-            using type = detail::refcount_atom_impl<U, MP>;
-        };
-    };
+        return notifier_.wait(old, [&] { return impl_.load(); });
+    }
 
-    struct get_gc_atom_impl
+    /*!
+     * Registers `fn` to be called as `fn(old, new)` after every
+     * successful `store`, `exchange` or `update`, with the boxes that
+     * were replaced and stored.  This allows, for example, to `diff`
+     * the two values right away.  It returns an identifier to be
+     * passed to `unwatch`.
+     *
+     * @rst
+     *
+     * .. warning:: The watchers run in the writing thread, after the
+     *    value has been stored.  When several threads write at once,
+     *    the watchers may run concurrently and not in the order in which
+     *    the values were stored, but every call describes one write.
+     *
+     * @endrst
+     */
+    std::size_t watch(std::function<void(const box_type&, const box_type&)> fn)
     {
-        template <typename U, typename MP>
-        struct apply
-        {
-            using type = detail::gc_atom_impl<U, MP>;
-        };
-    };
+        return notifier_.watch(std::move(fn));
+    }
+
+    /*!
+     * Removes the watcher registered with the identifier `id`.  A
+     * write that is already calling the watchers may still call it.
+     */
+    void unwatch(std::size_t id) { notifier_.unwatch(id); }
+
+private:
+    using impl_t =
+        typename ReclamationPolicy::template apply<T, MemoryPolicy>::type;
 
-    // If we are using "real" garbage collection (we assume this when we use
-    // `no_refcount_policy`), we just store the pointer in an atomic.  If we use
-    // reference counting, we rely on the reference counting spinlock.
-    using impl_t = typename std::conditional_t<
-        std::is_same<typename MemoryPolicy::refcount,
-                     no_refcount_policy>::value,
-        get_gc_atom_impl,
-        get_refcount_atom_impl>::template apply<T, MemoryPolicy>::type;
+    friend struct detail::transaction_access;
 
     impl_t impl_;
+    mutable detail::atom_notifier<box_type> notifier_;
+    // even when idle and odd while `transact` commits to this atom
+    mutable std::atomic<std::size_t> version_{0};
 };
 
 } // namespace immer
@@ -0,0 +1,493 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/hamts/bits.hpp>
+#include <immer/detail/type_traits.hpp>
+#include <immer/memory_policy.hpp>
+#include <immer/vector.hpp>
+#include <immer/vector_transient.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace immer {
+
+namespace detail {
+namespace bits {
+
+// Converts the values of `T`, that is `bool`, an integer or an
+// enumeration, to the unsigned number that is stored, and back.
+template <typename T, typename Enable = void>
+struct codec
+{
+    static std::uint64_t encode(T v) { return static_cast<std::uint64_t>(v); }
+    static T decode(std::uint64_t x) { return static_cast<T>(x); }
+};
+
+template <typename T>
+struct codec<T, std::enable_if_t<std::is_enum<T>::value>>
+{
+    using underlying_t = std::underlying_type_t<T>;
+
+    static std::uint64_t encode(T v)
+    {
+        return static_cast<std::uint64_t>(static_cast<underlying_t>(v));
+    }
+    static T decode(std::uint64_t x)
+    {
+        return static_cast<T>(static_cast<underlying_t>(x));
+    }
+};
+
+template <>
+struct codec<bool>
+{
+    static std::uint64_t encode(bool v) { return v ? 1 : 0; }
+    static bool decode(std::uint64_t x) { return x != 0; }
+};
+
+// The values are packed in 64 bit words, `per_word` in each, starting
+// at the least significant bits, and the bits that do not hold a value
+// are always zero.  Thus, the containers with the same values have the
+// same words.
+template <typename T, std::size_t Bits, typename MemoryPolicy>
+struct impl
+{
+    using codec_t = codec<T>;
+    using words_t = vector<std::uint64_t, MemoryPolicy>;
+
+    static constexpr auto per_word   = std::size_t{64 / Bits};
+    static constexpr auto field_mask = (std::uint64_t{1} << Bits) - 1;
+
+    // the least significant bit of every field in a full word
+    static constexpr std::uint64_t low_bits(std::size_t n = per_word)
+    {
+        return n ? low_bits(n - 1) << Bits | 1 : 0;
+    }
+
+    // the bits of the first `n` fields of a word
+    static constexpr std::uint64_t valid_bits(std::size_t n)
+    {
+        return n == per_word && n * Bits == 64
+                   ? ~std::uint64_t{}
+                   : (std::uint64_t{1} << (n * Bits)) - 1;
+    }
+
+    words_t words;
+    std::size_t size = 0;
+
+    static std::uint64_t encode(T v)
+    {
+        auto x = codec_t::encode(v);
+        assert((x & ~field_mask) == 0 && "value does not fit in the bits");
+        return x & field_mask;
+    }
+
+    static T field(std::uint64_t w, std::size_t i)
+    {
+        return codec_t::decode(w >> (i * Bits) & field_mask);
+    }
+
+    T get(std::size_t i) const
+    {
+        return field(words[i / per_word], i % per_word);
+    }
+
+    // Number of values in the word at `idx`, where the last one may
+    // not be full.
+    std::size_t fields_in(std::size_t idx) const
+    {
+        auto rest = size - idx * per_word;
+        return rest < per_word ? rest : per_word;
+    }
+
+    // Number of fields among the first `n` of `w` that hold `x`.  The
+    // fields of `w ^ broadcast(x)` that are not zero get their bits
+    // folded into their least significant one, which are counted.
+    static std::size_t
+    count_in(std::uint64_t w, std::uint64_t x, std::size_t n)
+    {
+        auto d = w ^ (x * low_bits());
+        auto y = d;
+        for (auto s = std::size_t{1}; s < Bits; ++s)
+            y |= d >> s;
+        return n - hamts::popcount(y & low_bits(n));
+    }
+
+    std::size_t count(T v) const
+    {
+        auto x     = encode(v);
+        auto total = std::size_t{};
+        auto idx   = std::size_t{};
+        words.impl().for_each_chunk([&](auto first, auto last) {
+            for (; first != last; ++first, ++idx)
+                total += count_in(*first, x, fields_in(idx));
+        });
+        return total;
+    }
+
+    template <typename Fn>
+    bool for_each_chunk_p(Fn&& fn) const
+    {
+        T buffer[per_word];
+        auto idx = std::size_t{};
+        return words.impl().for_each_chunk_p([&](auto first, auto last) {
+            for (; first != last; ++first, ++idx) {
+                auto n = fields_in(idx);
+                for (auto i = std::size_t{}; i < n; ++i)
+                    buffer[i] = field(*first, i);
+                if (!fn(static_cast<const T*>(buffer),
+                        static_cast<const T*>(buffer + n)))
+                    return false;
+            }
+            return true;
+        });
+    }
+
+    template <typename Fn>
+    void for_each_chunk(Fn&& fn) const
+    {
+        for_each_chunk_p([&](auto first, auto last) {
+            fn(first, last);
+            return true;
+        });
+    }
+};
+
+} // namespace bits
+} // namespace detail
+
+/*!
+ * Immutable sequential container of `bool` or small values, that packs
+ * every one of them in `Bits` bits of 64 bit words.  A
+ * `bit_vector<bool>` takes one bit per element, eight times less than
+ * an `immer::vector<bool>`.
+ *
+ * @tparam T The type of the values, `bool`, an unsigned integer type or
+ *         an enumeration whose values are not negative.
+ * @tparam Bits The number of bits of each value, at most 32.  It is
+ *         `1` by default for `bool`, and must be given for the others.
+ *         Only the values that fit in them can be stored.
+ * @tparam MemoryPolicy Memory management policy. See @ref
+ *         memory_policy.
+ *
+ * @rst
+ *
+ * The words are stored in a ``vector<std::uint64_t>``, which is
+ * returned by ``words()``, so that the algorithms that work on them,
+ * like counting bits or combining flags, can process 64 bits at a time
+ * using ``for_each_chunk``.  The operations that are done this way are
+ * provided: ``count()`` pops the bits of whole words, and two
+ * ``bit_vector<bool>`` can be combined with ``&``, ``|`` and ``^``.
+ *
+ * .. code-block:: c++
+ *
+ *    enum class state : std::uint8_t { off, on, unknown };
+ *    auto v = immer::bit_vector<state, 2>{}
+ *                 .push_back(state::on)
+ *                 .push_back(state::unknown);
+ *    assert(v[1] == state::unknown && v.count(state::on) == 1);
+ *
+ * @endrst
+ */
+template <typename T            = bool,
+          std::size_t Bits      = std::is_same<T, bool>::value ? 1 : 0,
+          typename MemoryPolicy = default_memory_policy>
+class bit_vector
+{
+    static_assert(std::is_integral<T>::value || std::is_enum<T>::value,
+                  "bit_vector stores booleans, integers or enumerations");
+    static_assert(Bits > 0 && Bits <= 32,
+                  "the number of bits of a value must be in [1, 32]");
+
+    using impl_t  = detail::bits::impl<T, Bits, MemoryPolicy>;
+    using words_t = typename impl_t::words_t;
+
+    static constexpr auto per_word = impl_t::per_word;
+
+public:
+    using value_type      = T;
+    using reference       = T;
+    using const_reference = T;
+    using size_type       = std::size_t;
+    using memory_policy   = MemoryPolicy;
+    using words_type      = words_t;
+
+    static constexpr auto bits = Bits;
+
+    /*!
+     * Default constructor.  It creates a vector of `size() == 0`.  It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    bit_vector() = default;
+
+    /*!
+     * Constructs a vector containing the elements in `values`.
+     */
+    bit_vector(std::initializer_list<T> values)
+        : bit_vector(values.begin(), values.end())
+    {}
+
+    /*!
+     * Constructs a vector containing the elements in the range
+     * defined by the input iterator `first` and range sentinel `last`.
+     */
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    bit_vector(Iter first, Sent last)
+    {
+        auto words = typename words_t::transient_type{};
+        auto word  = std::uint64_t{};
+        auto n     = std::size_t{};
+        for (; first != last; ++first) {
+            word |= impl_t::encode(*first) << (n % per_word * Bits);
+            if (++n % per_word == 0) {
+                words.push_back(word);
+                word = 0;
+            }
+        }
+        if (n % per_word)
+            words.push_back(word);
+        impl_.words = words.persistent();
+        impl_.size  = n;
+    }
+
+    /*!
+     * Returns the number of elements in the container.  It does not
+     * allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD size_type size() const { return impl_.size; }
+
+    /*!
+     * Returns `true` if there are no elements in the container.  It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD bool empty() const { return impl_.size == 0; }
+
+    /*!
+     * Returns the element at position `index`.  It does not allocate
+     * memory and its complexity is *effectively* @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD T operator[](size_type index) const
+    {
+        return impl_.get(index);
+    }
+
+    /*!
+     * Returns the element at position `index`.  It throws an
+     * `std::out_of_range` exception when @f$ index \geq size() @f$.
+     */
+    T at(size_type index) const
+    {
+        if (index >= size())
+            IMMER_THROW(std::out_of_range{"index out of range"});
+        return impl_.get(index);
+    }
+
+    /*!
+     * Returns the last element of the container.
+     */
+    IMMER_NODISCARD T back() const { return impl_.get(size() - 1); }
+
+    /*!
+     * Returns the number of elements that are equal to `value`.  It
+     * does not allocate memory and its complexity is @f$ O(n \cdot
+     * Bits / 64) @f$.
+     */
+    IMMER_NODISCARD size_type count(T value) const
+    {
+        return impl_.count(value);
+    }
+
+    /*!
+     * Returns the number of elements that are `true`.  It is only
+     * available for a `bit_vector<bool>`.
+     */
+    template <typename U = T>
+    IMMER_NODISCARD std::enable_if_t<std::is_same<U, bool>::value, size_type>
+    count() const
+    {
+        return impl_.count(true);
+    }
+
+    /*!
+     * Returns the words where the elements are packed, the element `i`
+     * being in the bits `[i % (64 / Bits) * Bits, ... + Bits)` of the
+     * word `i / (64 / Bits)`.  The bits after the last element are
+     * zero.  It does not allocate memory and its complexity is @f$
+     * O(1) @f$.
+     */
+    IMMER_NODISCARD const words_type& words() const { return impl_.words; }
+
+    /*!
+     * Returns a vector with `value` inserted at the end.  It may
+     * allocate memory and its complexity is *effectively* @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD bit_vector push_back(T value) const&
+    {
+        return bit_vector{*this}.push_back_mut(value);
+    }
+    IMMER_NODISCARD bit_vector push_back(T value) &&
+    {
+        return std::move(push_back_mut(value));
+    }
+
+    /*!
+     * Returns a vector containing value `value` at position `index`.
+     * Undefined for `index >= size()`.  It may allocate memory and its
+     * complexity is *effectively* @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD bit_vector set(size_type index, T value) const&
+    {
+        return bit_vector{*this}.set_mut(index, value);
+    }
+    IMMER_NODISCARD bit_vector set(size_type index, T value) &&
+    {
+        return std::move(set_mut(index, value));
+    }
+
+    /*!
+     * Returns a vector containing the result of the expression
+     * `fn(x)` at position `index`, where `x` is the value there.
+     * Undefined for `index >= size()`.
+     */
+    template <typename FnT>
+    IMMER_NODISCARD bit_vector update(size_type index, FnT&& fn) const&
+    {
+        return set(index, std::forward<FnT>(fn)(impl_.get(index)));
+    }
+    template <typename FnT>
+    IMMER_NODISCARD bit_vector update(size_type index, FnT&& fn) &&
+    {
+        auto v = std::forward<FnT>(fn)(impl_.get(index));
+        return std::move(*this).set(index, v);
+    }
+
+    /*!
+     * Returns a vector that contains only the first `elems` elements.
+     * It may allocate memory and its complexity is *effectively* @f$
+     * O(1) @f$.
+     */
+    IMMER_NODISCARD bit_vector take(size_type elems) const&
+    {
+        return bit_vector{*this}.take_mut(elems);
+    }
+    IMMER_NODISCARD bit_vector take(size_type elems) &&
+    {
+        return std::move(take_mut(elems));
+    }
+
+    /*!
+     * Returns whether the vectors are equal.  The words are compared
+     * without unpacking them.
+     */
+    IMMER_NODISCARD bool operator==(const bit_vector& other) const
+    {
+        return impl_.size == other.impl_.size &&
+               impl_.words == other.impl_.words;
+    }
+    IMMER_NODISCARD bool operator!=(const bit_vector& other) const
+    {
+        return !(*this == other);
+    }
+
+    /*!
+     * Returns the element-wise conjunction, disjunction or exclusive
+     * disjunction of two `bit_vector<bool>` of the same size, computed
+     * a word at a time.
+     */
+    friend bit_vector operator&(const bit_vector& a, const bit_vector& b)
+    {
+        return a.combine(b, [](auto x, auto y) { return x & y; });
+    }
+    friend bit_vector operator|(const bit_vector& a, const bit_vector& b)
+    {
+        return a.combine(b, [](auto x, auto y) { return x | y; });
+    }
+    friend bit_vector operator^(const bit_vector& a, const bit_vector& b)
+    {
+        return a.combine(b, [](auto x, auto y) { return x ^ y; });
+    }
+
+    // Semi-private
+    const impl_t& impl() const { return impl_; }
+
+private:
+    bit_vector& push_back_mut(T value)
+    {
+        auto x = impl_t::encode(value);
+        auto i = impl_.size % per_word;
+        if (i == 0)
+            impl_.words = std::move(impl_.words).push_back(x);
+        else
+            impl_.words = std::move(impl_.words)
+                              .update(impl_.size / per_word, [&](auto w) {
+                                  return w | x << i * Bits;
+                              });
+        ++impl_.size;
+        return *this;
+    }
+
+    bit_vector& set_mut(size_type index, T value)
+    {
+        auto x     = impl_t::encode(value);
+        auto shift = index % per_word * Bits;
+        impl_.words =
+            std::move(impl_.words).update(index / per_word, [&](auto w) {
+                return (w & ~(impl_t::field_mask << shift)) | x << shift;
+            });
+        return *this;
+    }
+
+    bit_vector& take_mut(size_type elems)
+    {
+        if (elems >= impl_.size)
+            return *this;
+        auto n      = (elems + per_word - 1) / per_word;
+        impl_.words = std::move(impl_.words).take(n);
+        if (elems % per_word)
+            impl_.words = std::move(impl_.words).update(n - 1, [&](auto w) {
+                return w & impl_t::valid_bits(elems % per_word);
+            });
+        impl_.size = elems;
+        return *this;
+    }
+
+    template <typename Op>
+    bit_vector combine(const bit_vector& b, Op op) const
+    {
+        static_assert(std::is_same<T, bool>::value,
+                      "only bit_vector<bool> can be combined");
+        assert(size() == b.size());
+        auto words = typename words_t::transient_type{};
+        auto it    = b.impl_.words.begin();
+        impl_.words.impl().for_each_chunk([&](auto first, auto last) {
+            for (; first != last; ++first, ++it)
+                words.push_back(op(*first, *it));
+        });
+        auto r        = bit_vector{};
+        r.impl_.words = words.persistent();
+        r.impl_.size  = impl_.size;
+        return r;
+    }
+
+    impl_t impl_;
+};
+
+} // namespace immer
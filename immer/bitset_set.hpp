@@ -0,0 +1,370 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/bitset/bitset.hpp>
+#include <immer/detail/iterator_facade.hpp>
+#include <immer/detail/type_traits.hpp>
+#include <immer/memory_policy.hpp>
+
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+namespace immer {
+
+template <typename T, typename MemoryPolicy>
+class bitset_set;
+
+namespace detail {
+namespace bitset {
+
+template <typename T, typename MemoryPolicy>
+class bitset_iterator
+    : public iterator_facade<bitset_iterator<T, MemoryPolicy>,
+                             std::forward_iterator_tag,
+                             T,
+                             const T&,
+                             std::ptrdiff_t,
+                             const T*>
+{
+    using trie_t = trie<MemoryPolicy>;
+    using node_t = typename trie_t::node_t;
+
+public:
+    bitset_iterator() = default;
+
+    bitset_iterator(const node_t* root, typename trie_t::value_t from)
+        : root_{root}
+    {
+        seek(from);
+    }
+
+private:
+    friend iterator_core_access;
+
+    const node_t* root_ = nullptr;
+    const node_t* leaf_ = nullptr;
+    T curr_             = {};
+
+    void seek(typename trie_t::value_t from)
+    {
+        auto v = typename trie_t::value_t{};
+        // most of the time the next value is in the same leaf
+        if (leaf_ && (from & ~trie_t::leaf_mask) ==
+                         (curr_ & ~trie_t::leaf_mask)) {
+            if (trie_t::leaf_lower_bound(leaf_, from, v)) {
+                curr_ = static_cast<T>(v);
+                return;
+            }
+            from = (from | trie_t::leaf_mask) + 1;
+        }
+        if (root_ && (from >> 32) == 0 &&
+            trie_t::lower_bound(root_, top_level, from, v, leaf_))
+            curr_ = static_cast<T>(v);
+        else
+            leaf_ = nullptr;
+    }
+
+    void increment()
+    {
+        assert(leaf_);
+        seek(typename trie_t::value_t{curr_} + 1);
+    }
+
+    bool equal(const bitset_iterator& other) const
+    {
+        return leaf_ == other.leaf_ && (!leaf_ || curr_ == other.curr_);
+    }
+
+    const T& dereference() const { return curr_; }
+};
+
+} // namespace bitset
+} // namespace detail
+
+/*!
+ * Immutable set of unsigned integers stored as a compressed bitmap.
+ *
+ * @tparam T The type of the values, an unsigned integer of up to 32
+ *         bits.
+ * @tparam MemoryPolicy Memory management policy. See @ref
+ *         memory_policy.
+ *
+ * @rst
+ *
+ * This container is a radix trie over the bits of the values.  Its
+ * leaves are bitmaps of 512 consecutive values, in 64 bytes, and its
+ * inner nodes have up to 32 children, of which only the non-empty ones
+ * are stored, like in the nodes of :cpp:class:`immer::set`.  A dense
+ * set takes little more than one bit per value in its range, instead
+ * of the tens of bytes per value of a hash set, and a sparse one
+ * still one leaf per value at worst.
+ *
+ * Inserting or removing a value copies the path to it, of at most six
+ * nodes.  The union, intersection and difference of two sets share the
+ * subtrees that are the same in both, like those of the versions of a
+ * set, without visiting them, and combine the leaves word by word.
+ *
+ * .. code-block:: c++
+ *
+ *    auto admins  = immer::bitset_set<>{1, 2, 3};
+ *    auto editors = admins.insert(40).erase(1);
+ *    auto both    = admins & editors; // {2, 3}
+ *    auto any     = admins | editors; // {1, 2, 3, 40}
+ *    auto only    = admins - editors; // {1}
+ *
+ * @endrst
+ */
+template <typename T            = std::uint32_t,
+          typename MemoryPolicy = default_memory_policy>
+class bitset_set
+{
+    static_assert(std::is_unsigned<T>::value && sizeof(T) <= 4,
+                  "bitset_set holds unsigned integers of up to 32 bits");
+
+    using trie_t = detail::bitset::trie<MemoryPolicy>;
+    using node_t = typename trie_t::node_t;
+
+    static constexpr auto top = detail::bitset::top_level;
+
+public:
+    using value_type      = T;
+    using size_type       = detail::bitset::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference       = const T&;
+    using const_reference = const T&;
+
+    using iterator       = detail::bitset::bitset_iterator<T, MemoryPolicy>;
+    using const_iterator = iterator;
+
+    using memory_policy_type = MemoryPolicy;
+
+    /*!
+     * Default constructor.  It creates a set of `size() == 0`.  It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    bitset_set() = default;
+
+    /*!
+     * Constructs a set containing the elements in `values`.
+     */
+    bitset_set(std::initializer_list<value_type> values)
+        : bitset_set(values.begin(), values.end())
+    {}
+
+    /*!
+     * Constructs a set containing the elements in the range
+     * defined by the input iterator `first` and range sentinel `last`.
+     */
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    bitset_set(Iter first, Sent last)
+    {
+        for (; first != last; ++first)
+            *this = std::move(*this).insert(*first);
+    }
+
+    bitset_set(const bitset_set& other)
+        : root_{node_t::inc(other.root_)}
+    {}
+
+    bitset_set(bitset_set&& other)
+        : root_{other.root_}
+    {
+        other.root_ = nullptr;
+    }
+
+    bitset_set& operator=(const bitset_set& other)
+    {
+        auto next = other;
+        swap(*this, next);
+        return *this;
+    }
+
+    bitset_set& operator=(bitset_set&& other)
+    {
+        swap(*this, other);
+        return *this;
+    }
+
+    ~bitset_set() { node_t::release(root_, top); }
+
+    friend void swap(bitset_set& a, bitset_set& b)
+    {
+        using std::swap;
+        swap(a.root_, b.root_);
+    }
+
+    /*!
+     * Returns an iterator pointing at the smallest value.  It does not
+     * allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD iterator begin() const { return {root_, 0}; }
+
+    /*!
+     * Returns an iterator pointing just after the greatest value.
+     */
+    IMMER_NODISCARD iterator end() const { return {}; }
+
+    /*!
+     * Returns an iterator pointing at the smallest value that is not
+     * less than `value`.
+     */
+    IMMER_NODISCARD iterator lower_bound(T value) const
+    {
+        return {root_, value};
+    }
+
+    /*!
+     * Returns the number of elements in the set.  Its complexity is
+     * @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD size_type size() const
+    {
+        return root_ ? root_->count() : 0;
+    }
+
+    IMMER_NODISCARD bool empty() const { return !root_; }
+
+    /*!
+     * Returns `1` when `value` is in the set, `0` otherwise.
+     */
+    IMMER_NODISCARD size_type count(T value) const
+    {
+        return trie_t::contains(root_, value) ? 1 : 0;
+    }
+
+    IMMER_NODISCARD bool contains(T value) const
+    {
+        return trie_t::contains(root_, value);
+    }
+
+    /*!
+     * Returns a set containing `value`.  If the `value` is already in
+     * the set, it returns the same set.  Its complexity is @f$ O(1)
+     * @f$, as the trie has a fixed depth.
+     */
+    IMMER_NODISCARD bitset_set insert(T value) const&
+    {
+        if (contains(value))
+            return *this;
+        return bitset_set{trie_t::insert(root_, top, value)};
+    }
+    IMMER_NODISCARD bitset_set&& insert(T value) &&
+    {
+        if (!contains(value))
+            update(value, 1, [&] { return trie_t::insert(root_, top, value); });
+        return std::move(*this);
+    }
+
+    /*!
+     * Returns a set without `value`.  If the `value` is not in the set
+     * it returns the same set.
+     */
+    IMMER_NODISCARD bitset_set erase(T value) const&
+    {
+        if (!contains(value))
+            return *this;
+        return bitset_set{trie_t::erase(root_, top, value)};
+    }
+    IMMER_NODISCARD bitset_set&& erase(T value) &&
+    {
+        if (contains(value))
+            update(value, -1, [&] { return trie_t::erase(root_, top, value); });
+        return std::move(*this);
+    }
+
+    /*!
+     * Returns the set with the values that are in `a` or in `b`.
+     */
+    IMMER_NODISCARD friend bitset_set operator|(const bitset_set& a,
+                                                const bitset_set& b)
+    {
+        return combine(a, b, typename trie_t::union_op{});
+    }
+
+    /*!
+     * Returns the set with the values that are both in `a` and `b`.
+     */
+    IMMER_NODISCARD friend bitset_set operator&(const bitset_set& a,
+                                                const bitset_set& b)
+    {
+        return combine(a, b, typename trie_t::intersection_op{});
+    }
+
+    /*!
+     * Returns the set with the values of `a` that are not in `b`.
+     */
+    IMMER_NODISCARD friend bitset_set operator-(const bitset_set& a,
+                                                const bitset_set& b)
+    {
+        return combine(a, b, typename trie_t::difference_op{});
+    }
+
+    /*!
+     * Calls `fn` with every value of the set, in increasing order.
+     * This is faster than iterating over it.
+     */
+    template <typename Fn>
+    void for_each(Fn&& fn) const
+    {
+        auto g = [&](typename trie_t::value_t v) { fn(static_cast<T>(v)); };
+        if (root_)
+            trie_t::for_each(root_, top, 0, g);
+    }
+
+    IMMER_NODISCARD bool operator==(const bitset_set& other) const
+    {
+        return trie_t::equals(root_, other.root_, top);
+    }
+    IMMER_NODISCARD bool operator!=(const bitset_set& other) const
+    {
+        return !(*this == other);
+    }
+
+    /*!
+     * Returns a value that can be used as identity for the container.  If two
+     * values have the same identity, they are guaranteed to be equal and to
+     * contain the same objects.  However, two equal containers are not
+     * guaranteed to have the same identity.
+     */
+    void* identity() const { return const_cast<node_t*>(root_); }
+
+private:
+    explicit bitset_set(const node_t* root)
+        : root_{root}
+    {}
+
+    template <typename Op>
+    static bitset_set combine(const bitset_set& a, const bitset_set& b, Op op)
+    {
+        return bitset_set{trie_t::combine(a.root_, b.root_, top, op)};
+    }
+
+    // updates the value in place when its path is not shared, and
+    // replaces the trie with the result of `fn` otherwise
+    template <typename Fn>
+    void update(T value, int delta, Fn&& fn)
+    {
+        if (trie_t::can_update_in_place(root_, value, delta))
+            trie_t::flip_in_place(const_cast<node_t*>(root_), value, delta);
+        else
+            *this = bitset_set{fn()};
+    }
+
+    const node_t* root_ = nullptr;
+};
+
+} // namespace immer
@@ -0,0 +1,469 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/type_traits.hpp>
+#include <immer/vector.hpp>
+#include <immer/vector_transient.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace immer {
+
+namespace detail {
+namespace bloom {
+
+// a block of a split block Bloom filter, a cache line with one bit set
+// in every word for each key
+struct block
+{
+    std::uint64_t words[8];
+};
+
+constexpr std::size_t block_bits = 512;
+
+inline std::uint32_t salt(std::size_t i)
+{
+    static constexpr std::uint32_t salts[8] = {0x47b6137bu,
+                                               0x44974d91u,
+                                               0x8824ad5bu,
+                                               0xa2b7289du,
+                                               0x705495c7u,
+                                               0x2df1424bu,
+                                               0x9efc4947u,
+                                               0x5c6bfb31u};
+    return salts[i];
+}
+
+// the hashers of the standard library are often the identity for
+// integers, so their bits are mixed first
+inline std::uint64_t mix(std::uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+// the high half of the hash picks the block, the low half the bits
+inline std::size_t block_index(std::uint64_t h, std::size_t n)
+{
+    return static_cast<std::size_t>(((h >> 32) * n) >> 32);
+}
+
+inline bool test(const block& b, std::uint64_t h)
+{
+    auto lo = static_cast<std::uint32_t>(h);
+    for (auto i = std::size_t{}; i < 8; ++i)
+        if (!((b.words[i] >> ((lo * salt(i)) >> 26)) & 1))
+            return false;
+    return true;
+}
+
+inline void add(block& b, std::uint64_t h)
+{
+    auto lo = static_cast<std::uint32_t>(h);
+    for (auto i = std::size_t{}; i < 8; ++i)
+        b.words[i] |= std::uint64_t{1} << ((lo * salt(i)) >> 26);
+}
+
+// the key of the values of a set is themselves, the one of a map is
+// the first of the pair
+template <typename Container, typename = void>
+struct key_of
+{
+    using type = typename Container::value_type;
+
+    static const type& get(const type& v) { return v; }
+};
+
+template <typename Container>
+struct key_of<Container, void_t<typename Container::key_type>>
+{
+    using type = typename Container::key_type;
+
+    static const type& get(const typename Container::value_type& v)
+    {
+        return v.first;
+    }
+};
+
+} // namespace bloom
+} // namespace detail
+
+/*!
+ * Wraps a ``map`` or a ``set`` of type `Container` with a Bloom filter
+ * of its keys, so that most lookups of keys that are not there are
+ * answered without descending the trie.
+ *
+ * @rst
+ *
+ * The filter is a split block Bloom filter: a key sets one bit in each
+ * of the eight words of a single 64 byte block.  Thus, a lookup reads
+ * one cache line of the filter, and with ``BitsPerKey`` bits for every
+ * key about 1% of the misses get through when it is 10.  The blocks are
+ * the elements of an :cpp:class:`immer::vector`, so that the versions
+ * share all the blocks but the ones that their updates touched, and an
+ * insertion that does not set any new bit does not copy anything.
+ *
+ * A Bloom filter can not remove a key, so ``erase()`` leaves its bits
+ * set, and the filter is built again once there are more keys that
+ * have been removed than keys.  It is also built again, twice as big,
+ * when it gets full.  Both take a pass over the container, which is
+ * amortized over the updates that caused them.
+ *
+ * .. code-block:: c++
+ *
+ *    auto m = immer::bloom_filtered<immer::map<int, row>>{};
+ *    for (auto& r : rows)
+ *        m = std::move(m).set(r.id, r);
+ *    for (auto& o : orders)
+ *        if (auto r = m.find(o.row_id)) // most misses read one block
+ *            join(*r, o);
+ *
+ * @endrst
+ */
+template <typename Container, std::size_t BitsPerKey = 10>
+class bloom_filtered
+{
+    using key_of_t = detail::bloom::key_of<Container>;
+
+public:
+    using container_type = Container;
+    using key_type       = typename key_of_t::type;
+    using value_type     = typename Container::value_type;
+    using size_type      = std::size_t;
+    using hasher         = typename Container::hasher;
+
+    using memory_policy_type = typename Container::memory_policy_type;
+    using filter_type = vector<detail::bloom::block, memory_policy_type>;
+
+    static_assert(BitsPerKey > 0, "the filter needs some bits per key");
+
+    class transient_type;
+
+    /*!
+     * Default constructor.  It creates an empty container.
+     */
+    bloom_filtered() = default;
+
+    /*!
+     * Constructs a filter for the keys in `c`.
+     */
+    bloom_filtered(Container c)
+        : bloom_filtered{transient_type{std::move(c)}.persistent()}
+    {}
+
+    /*!
+     * Returns the wrapped container.
+     */
+    IMMER_NODISCARD const Container& container() const { return c_; }
+
+    /*!
+     * Returns the blocks of the filter.
+     */
+    IMMER_NODISCARD const filter_type& filter() const { return filter_; }
+
+    /*!
+     * Returns the number of elements.
+     */
+    IMMER_NODISCARD size_type size() const { return c_.size(); }
+
+    /*!
+     * Returns `true` if there are no elements.
+     */
+    IMMER_NODISCARD bool empty() const { return c_.empty(); }
+
+    /*!
+     * Returns `false` when the key `k` is not in the container, and
+     * `true` when it may be.  It reads one block of the filter.
+     */
+    IMMER_NODISCARD bool may_contain(const key_type& k) const
+    {
+        return may_contain_in(filter_, k);
+    }
+
+    /*!
+     * Returns `1` when the key `k` is contained and `0` otherwise.
+     */
+    IMMER_NODISCARD size_type count(const key_type& k) const
+    {
+        return may_contain(k) ? c_.count(k) : 0;
+    }
+
+    /*!
+     * Returns what `find()` returns in the container, which is a
+     * `nullptr` when the key `k` is not there.
+     */
+    IMMER_NODISCARD auto find(const key_type& k) const
+        -> decltype(std::declval<const Container&>().find(k))
+    {
+        return may_contain(k) ? c_.find(k) : nullptr;
+    }
+
+    /*!
+     * Returns a container with the value `v` inserted, as `insert()`
+     * does in the container.
+     */
+    IMMER_NODISCARD bloom_filtered insert(value_type v) const&
+    {
+        auto t = transient();
+        t.insert(std::move(v));
+        return std::move(t).persistent();
+    }
+    IMMER_NODISCARD bloom_filtered insert(value_type v) &&
+    {
+        auto t = std::move(*this).transient();
+        t.insert(std::move(v));
+        return std::move(t).persistent();
+    }
+
+    /*!
+     * Returns a map with the value `v` associated to the key `k`.  It
+     * is only available when the container is a map.
+     */
+    template <typename C = Container>
+    IMMER_NODISCARD bloom_filtered
+    set(typename C::key_type k, typename C::mapped_type v) const&
+    {
+        auto t = transient();
+        t.set(std::move(k), std::move(v));
+        return std::move(t).persistent();
+    }
+    template <typename C = Container>
+    IMMER_NODISCARD bloom_filtered
+    set(typename C::key_type k, typename C::mapped_type v) &&
+    {
+        auto t = std::move(*this).transient();
+        t.set(std::move(k), std::move(v));
+        return std::move(t).persistent();
+    }
+
+    /*!
+     * Returns a container without the key `k`.
+     */
+    IMMER_NODISCARD bloom_filtered erase(const key_type& k) const&
+    {
+        auto t = transient();
+        t.erase(k);
+        return std::move(t).persistent();
+    }
+    IMMER_NODISCARD bloom_filtered erase(const key_type& k) &&
+    {
+        auto t = std::move(*this).transient();
+        t.erase(k);
+        return std::move(t).persistent();
+    }
+
+    /*!
+     * Returns a transient form of this container, whose updates keep
+     * the filter in sync too.
+     */
+    IMMER_NODISCARD transient_type transient() const&
+    {
+        return transient_type{c_.transient(), filter_.transient(), stale_};
+    }
+    IMMER_NODISCARD transient_type transient() &&
+    {
+        return transient_type{std::move(c_).transient(),
+                              std::move(filter_).transient(),
+                              stale_};
+    }
+
+    /*!
+     * Returns whether the containers have the same elements.
+     */
+    IMMER_NODISCARD bool operator==(const bloom_filtered& other) const
+    {
+        return c_ == other.c_;
+    }
+
+    IMMER_NODISCARD bool operator!=(const bloom_filtered& other) const
+    {
+        return !(*this == other);
+    }
+
+private:
+    template <typename Filter>
+    static bool may_contain_in(const Filter& filter, const key_type& k)
+    {
+        auto n = filter.size();
+        if (n == 0)
+            return false;
+        auto h = detail::bloom::mix(hasher{}(k));
+        return detail::bloom::test(filter[detail::bloom::block_index(h, n)],
+                                   h);
+    }
+
+    bloom_filtered(Container c, filter_type filter, size_type stale)
+        : c_{std::move(c)}
+        , filter_{std::move(filter)}
+        , stale_{stale}
+    {}
+
+    Container c_;
+    filter_type filter_;
+    // the number of keys that were erased but are still in the filter
+    size_type stale_ = 0;
+};
+
+/*!
+ * The transient form of a @ref bloom_filtered, that wraps the transient
+ * form of the container and of the blocks of the filter.
+ */
+template <typename Container, std::size_t BitsPerKey>
+class bloom_filtered<Container, BitsPerKey>::transient_type
+{
+    using container_t = typename Container::transient_type;
+    using filter_t    = typename filter_type::transient_type;
+
+public:
+    /*!
+     * Returns the number of elements.
+     */
+    IMMER_NODISCARD size_type size() const { return c_.size(); }
+
+    /*!
+     * Returns `false` when the key `k` is not in the container, and
+     * `true` when it may be.
+     */
+    IMMER_NODISCARD bool may_contain(const key_type& k) const
+    {
+        return may_contain_in(filter_, k);
+    }
+
+    /*!
+     * Returns `1` when the key `k` is contained and `0` otherwise.
+     */
+    IMMER_NODISCARD size_type count(const key_type& k) const
+    {
+        return may_contain(k) ? c_.count(k) : 0;
+    }
+
+    /*!
+     * Returns what `find()` returns in the container.
+     */
+    IMMER_NODISCARD auto find(const key_type& k) const
+        -> decltype(std::declval<const container_t&>().find(k))
+    {
+        return may_contain(k) ? c_.find(k) : nullptr;
+    }
+
+    /*!
+     * Inserts the value `v`, as `insert()` does in the container.
+     */
+    void insert(value_type v)
+    {
+        auto n = c_.size();
+        auto h = hash(key_of_t::get(v));
+        c_.insert(std::move(v));
+        if (c_.size() != n)
+            added(h);
+    }
+
+    /*!
+     * Associates the value `v` to the key `k`.  It is only available
+     * when the container is a map.
+     */
+    template <typename C = Container>
+    void set(typename C::key_type k, typename C::mapped_type v)
+    {
+        auto n = c_.size();
+        auto h = hash(k);
+        c_.set(std::move(k), std::move(v));
+        if (c_.size() != n)
+            added(h);
+    }
+
+    /*!
+     * Removes the key `k`, if it is there.
+     */
+    void erase(const key_type& k)
+    {
+        auto n = c_.size();
+        c_.erase(k);
+        if (c_.size() != n && ++stale_ > c_.size())
+            rebuild();
+    }
+
+    /*!
+     * Returns a persistent form of this container.
+     */
+    IMMER_NODISCARD bloom_filtered persistent() &
+    {
+        return {c_.persistent(), filter_.persistent(), stale_};
+    }
+    IMMER_NODISCARD bloom_filtered persistent() &&
+    {
+        return {std::move(c_).persistent(),
+                std::move(filter_).persistent(),
+                stale_};
+    }
+
+private:
+    friend bloom_filtered;
+
+    transient_type(Container c)
+        : c_{std::move(c).transient()}
+    {
+        rebuild();
+    }
+
+    transient_type(container_t c, filter_t filter, size_type stale)
+        : c_{std::move(c)}
+        , filter_{std::move(filter)}
+        , stale_{stale}
+    {}
+
+    static std::uint64_t hash(const key_type& k)
+    {
+        return detail::bloom::mix(hasher{}(k));
+    }
+
+    void added(std::uint64_t h)
+    {
+        auto n = filter_.size();
+        if ((c_.size() + stale_) * BitsPerKey > n * detail::bloom::block_bits)
+            return rebuild();
+        auto i = detail::bloom::block_index(h, n);
+        // a block that has all the bits already is left shared
+        if (!detail::bloom::test(filter_[i], h))
+            filter_.update(i, [&](detail::bloom::block b) {
+                detail::bloom::add(b, h);
+                return b;
+            });
+    }
+
+    // builds a filter with room for twice the keys, or none when there
+    // are no keys
+    void rebuild()
+    {
+        auto bb     = detail::bloom::block_bits;
+        auto n      = (2 * c_.size() * BitsPerKey + bb - 1) / bb;
+        auto blocks = std::vector<detail::bloom::block>(n);
+        for (auto& v : c_) {
+            auto h = hash(key_of_t::get(v));
+            detail::bloom::add(blocks[detail::bloom::block_index(h, n)], h);
+        }
+        filter_ = filter_type(blocks.begin(), blocks.end()).transient();
+        stale_  = 0;
+    }
+
+    container_t c_;
+    filter_t filter_;
+    size_type stale_ = 0;
+};
+
+} // namespace immer
@@ -10,8 +10,12 @@
 
 #include <immer/detail/util.hpp>
 #include <immer/memory_policy.hpp>
+#include <immer/relocatable.hpp>
 
 #include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <utility>
 
 namespace immer {
 
@@ -23,8 +27,25 @@ struct gc_atom_impl;
 template <typename U, typename MP>
 struct refcount_atom_impl;
 
+template <typename U, typename MP>
+struct hazard_atom_impl;
+
+template <typename Impl>
+struct combining_atom_impl;
+
+template <typename U>
+struct inline_atom_impl;
+
 } // namespace detail
 
+/*!
+ * Tag to use as the memory policy of a `box` to store the value right
+ * in the box, instead of in a reference counted object on the heap.
+ * It can only be used with trivially copyable types, see @ref box.
+ */
+struct inline_box_policy
+{};
+
 /*!
  * Immutable box for a single value of type `T`.
  *
@@ -37,6 +58,9 @@ class box
 {
     friend struct detail::gc_atom_impl<T, MemoryPolicy>;
     friend struct detail::refcount_atom_impl<T, MemoryPolicy>;
+    friend struct detail::hazard_atom_impl<T, MemoryPolicy>;
+    template <typename Impl>
+    friend struct detail::combining_atom_impl;
 
     struct holder : MemoryPolicy::refcount
     {
@@ -163,6 +187,152 @@ public:
     }
 };
 
+/*!
+ * Box that stores a trivially copyable `T` by value.  Copying the box
+ * copies the value, and there is no allocation nor reference count
+ * involved.  It has the same interface as the other boxes, so it can
+ * be used instead of them for small values, and an `atom` of it keeps
+ * the value in a plain `std::atomic<T>`.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    using handle = immer::box<std::int64_t, immer::inline_box_policy>;
+ *    auto a = immer::atom<std::int64_t, immer::inline_box_policy>{42};
+ *    a.update([](auto x) { return x + 1; });
+ *
+ * .. note:: Two of these boxes are never identical, only equal, so the
+ *    atoms holding them consider a value unchanged when it has the
+ *    same bytes as before.  Keep ``T`` small enough for
+ *    ``std::atomic<T>`` to be lock free, usually no more than two
+ *    words, or the atom falls back to a lock inside the standard
+ *    library.
+ *
+ * @endrst
+ */
+template <typename T>
+class box<T, inline_box_policy>
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "inline boxes can only hold trivially copyable types");
+
+    T value_;
+
+public:
+    const T* impl() const { return &value_; };
+
+    using value_type    = T;
+    using memory_policy = inline_box_policy;
+
+    /*!
+     * Constructs a box holding `T{}`.
+     */
+    box()
+        : value_{}
+    {}
+
+    /*!
+     * Constructs a box holding `T{arg}`
+     */
+    template <typename Arg,
+              typename Enable = std::enable_if_t<
+                  !std::is_same<box, std::decay_t<Arg>>::value>>
+    box(Arg&& arg)
+        : value_{std::forward<Arg>(arg)}
+    {}
+
+    /*!
+     * Constructs a box holding `T{arg1, arg2, args...}`
+     */
+    template <typename Arg1, typename Arg2, typename... Args>
+    box(Arg1&& arg1, Arg2&& arg2, Args&&... args)
+        : value_{std::forward<Arg1>(arg1),
+                 std::forward<Arg2>(arg2),
+                 std::forward<Args>(args)...}
+    {}
+
+    friend void swap(box& a, box& b)
+    {
+        using std::swap;
+        swap(a.value_, b.value_);
+    }
+
+    /*! Query the current value. */
+    IMMER_NODISCARD const T& get() const { return value_; }
+
+    /*! Conversion to the boxed type. */
+    operator const T&() const { return get(); }
+
+    /*! Access via dereference */
+    const T& operator*() const { return get(); }
+
+    /*! Access via pointer member access */
+    const T* operator->() const { return &get(); }
+
+    /*!
+     * Returns a new box built by applying the `fn` to the underlying
+     * value.
+     */
+    template <typename Fn>
+    IMMER_NODISCARD box update(Fn&& fn) const&
+    {
+        return std::forward<Fn>(fn)(get());
+    }
+    template <typename Fn>
+    IMMER_NODISCARD box&& update(Fn&& fn) &&
+    {
+        value_ = std::forward<Fn>(fn)(std::move(value_));
+        return std::move(*this);
+    }
+};
+
+namespace detail {
+
+// Whether two boxes hold the very same value, and not just two
+// equal ones.  Inline boxes can only compare their bytes.
+template <typename T, typename MP>
+bool box_identical(const box<T, MP>& a, const box<T, MP>& b)
+{
+    return &a.get() == &b.get();
+}
+
+template <typename T>
+bool box_identical(const box<T, inline_box_policy>& a,
+                   const box<T, inline_box_policy>& b)
+{
+    return std::memcmp(&a.get(), &b.get(), sizeof(T)) == 0;
+}
+
+// How the nodes of a container hold a value of type `T`: in place,
+// or in a box when it is bigger than the out of line limit of the
+// memory policy.  `get` gives the value in both cases.
+template <typename T,
+          typename MP,
+          bool OutOfLine = (get_out_of_line_limit_v<MP> > 0 &&
+                            sizeof(T) > get_out_of_line_limit_v<MP>)>
+struct stored_value
+{
+    static constexpr bool out_of_line = false;
+
+    using type = T;
+
+    static T& get(T& v) { return v; }
+    static const T& get(const T& v) { return v; }
+};
+
+template <typename T, typename MP>
+struct stored_value<T, MP, true>
+{
+    static constexpr bool out_of_line = true;
+
+    using type = box<T, MP>;
+
+    static const T& get(const type& v) { return v.get(); }
+};
+
+} // namespace detail
+
 template <typename T, typename MP>
 IMMER_NODISCARD bool operator==(const box<T, MP>& a, const box<T, MP>& b)
 {
@@ -223,6 +393,11 @@ IMMER_NODISCARD auto operator<(T2&& b, const box<T, MP>& a)
     return b < a.get();
 }
 
+// A box is just a pointer to its value.
+template <typename T, typename MP>
+struct is_trivially_relocatable<box<T, MP>> : std::true_type
+{};
+
 } // namespace immer
 
 namespace std {
@@ -0,0 +1,235 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/atom.hpp>
+#include <immer/config.hpp>
+#include <immer/persist.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace immer {
+
+/*!
+ * Describes a checkpoint written by a @ref checkpointer.
+ */
+struct checkpoint_info
+{
+    //! Identifier of the container in the archive that was written.
+    std::size_t id = 0;
+    //! Whether the archive only has what changed since the previous
+    //! checkpoint, and must be loaded with `input_archive::load(id,
+    //! base)` passing the container loaded from that one.
+    bool incremental = false;
+    //! Number of bytes passed to the sink.
+    std::uint64_t bytes = 0;
+};
+
+/*!
+ * Settings of a @ref checkpointer.
+ */
+struct checkpoint_options
+{
+    //! Size of the pieces of the archive passed to the sink, which hold
+    //! whole records and thus may be bigger.
+    std::size_t chunk_size = 64 * 1024;
+    //! Maximum rate at which the archive is passed to the sink, or zero
+    //! for no limit.  The checkpointer sleeps between the chunks to keep
+    //! under it.
+    std::uint64_t bytes_per_second = 0;
+    //! Whether to write only the nodes that are not in the previous
+    //! checkpoint.  When `false`, every checkpoint has the whole
+    //! container.
+    bool incremental = true;
+};
+
+/*!
+ * Owns a thread that writes checkpoints of containers of type
+ * `Container` while other threads keep updating them.  Since a version
+ * of a container never changes, the thread can serialize a snapshot
+ * without stopping the writers, who only pay for taking it.
+ *
+ * Every checkpoint is a separate @ref output_archive, passed to a sink
+ * in chunks, at a limited rate if wanted.  The first checkpoint has the
+ * whole container, and the next ones only the nodes that are not in the
+ * previous one, which the checkpointer keeps alive for that purpose.
+ * Thus, the cost of a checkpoint is proportional to what changed since
+ * the last one.  Checkpoints are written in the order they were asked
+ * for.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    using map_t = immer::map<std::string, int>;
+ *    immer::atom<map_t> state;
+ *    immer::checkpointer<map_t> cp;
+ *    auto done = immer::checkpoint_async(state, cp, [&](auto p, auto n) {
+ *        file.write(p, n);
+ *    });
+ *    // keep updating the state...
+ *    auto info = done.get();
+ *
+ * .. note:: The reader of an incremental checkpoint needs the container
+ *    that it loaded from the previous one.  When that is lost, `reset()`
+ *    makes the next checkpoint a complete one.
+ *
+ * @endrst
+ */
+template <typename Container>
+class checkpointer
+{
+public:
+    using container_type = Container;
+    using sink_type      = std::function<void(const char*, std::size_t)>;
+
+    explicit checkpointer(checkpoint_options opts = {})
+        : opts_{opts}
+        , thread_{[this] { run(); }}
+    {}
+
+    checkpointer(const checkpointer&)            = delete;
+    checkpointer& operator=(const checkpointer&) = delete;
+
+    /*!
+     * Writes the checkpoints that are still pending and stops the
+     * thread.
+     */
+    ~checkpointer()
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            stop_ = true;
+        }
+        work_.notify_one();
+        thread_.join();
+    }
+
+    /*!
+     * Queues a checkpoint of `c`, that the thread of the checkpointer
+     * passes to `sink` as `sink(data, size)` calls.  The future is
+     * fulfilled when it has been written, or with the exception thrown
+     * by the sink, in which case the next checkpoint is based on the
+     * last one that succeeded.
+     */
+    std::future<checkpoint_info> checkpoint(Container c, sink_type sink)
+    {
+        auto j = job{std::move(c), std::move(sink), {}};
+        auto f = j.done.get_future();
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            pending_.push_back(std::move(j));
+        }
+        work_.notify_one();
+        return f;
+    }
+
+    /*!
+     * Makes the next checkpoint a complete one.
+     */
+    void reset()
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        reset_ = true;
+    }
+
+private:
+    struct job
+    {
+        Container value;
+        sink_type sink;
+        std::promise<checkpoint_info> done;
+    };
+
+    void run()
+    {
+        auto lock = std::unique_lock<std::mutex>{mutex_};
+        while (true) {
+            work_.wait(lock, [&] { return stop_ || !pending_.empty(); });
+            if (pending_.empty())
+                return;
+            auto j = std::move(pending_.front());
+            pending_.pop_front();
+            if (reset_) {
+                has_base_ = false;
+                reset_    = false;
+            }
+            lock.unlock();
+            IMMER_TRY {
+                j.done.set_value(write(j));
+            }
+            IMMER_CATCH (...) {
+                j.done.set_exception(std::current_exception());
+            }
+            lock.lock();
+        }
+    }
+
+    checkpoint_info write(job& j)
+    {
+        using clock = std::chrono::steady_clock;
+
+        auto info        = checkpoint_info{};
+        auto out         = output_archive{};
+        info.incremental = opts_.incremental && has_base_;
+        info.id          = info.incremental ? out.save(j.value, base_)
+                                            : out.save(j.value);
+        auto start       = clock::now();
+        out.write_chunks(
+            [&](const char* data, std::size_t size) {
+                j.sink(data, size);
+                info.bytes += size;
+                if (opts_.bytes_per_second)
+                    std::this_thread::sleep_until(
+                        start + std::chrono::microseconds{
+                                    info.bytes * 1000000 /
+                                    opts_.bytes_per_second});
+            },
+            std::max(opts_.chunk_size, std::size_t{1}));
+        base_     = std::move(j.value);
+        has_base_ = true;
+        return info;
+    }
+
+    checkpoint_options opts_;
+    std::mutex mutex_;
+    std::condition_variable work_;
+    std::deque<job> pending_;
+    bool stop_  = false;
+    bool reset_ = false;
+    // only touched by the thread
+    Container base_ = {};
+    bool has_base_  = false;
+    std::thread thread_;
+};
+
+/*!
+ * Takes a snapshot of the value of the atom `a` and queues a
+ * checkpoint of it in `cp`, see `checkpointer::checkpoint()`.  The
+ * calling thread only loads the atom.
+ */
+template <typename T, typename MP, typename RP, typename Sink>
+std::future<checkpoint_info>
+checkpoint_async(const atom<T, MP, RP>& a, checkpointer<T>& cp, Sink sink)
+{
+    return cp.checkpoint(a.load().get(), std::move(sink));
+}
+
+} // namespace immer
@@ -0,0 +1,151 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/iterator_facade.hpp>
+#include <immer/detail/rbts/chunk_walker.hpp>
+
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+namespace immer {
+
+/*!
+ * Resumable traversal of the leaves of a ``vector`` or ``flex_vector``
+ * of type `Vector`, as returned by @a chunks.  Every call to `next()`
+ * returns the following leaf as a range of pointers, in order, the
+ * same non empty chunks that @a for_each_chunk visits.  The cursor keeps the
+ * path to the current leaf, so resuming is cheap and never descends
+ * from the root.  It holds a copy of the vector, thus the chunks stay
+ * valid while it lives.
+ *
+ * It is also an input range of chunks, to be consumed with a range
+ * based ``for`` loop.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    auto c = immer::chunks(v);
+ *    // in every tick of the event loop
+ *    for (auto i = 0; i < 8 && !c.done(); ++i) {
+ *        auto chunk = c.next();
+ *        process(chunk.first, chunk.second);
+ *    }
+ *
+ * .. note:: It is the pull based equivalent of a coroutine generator
+ *    and it works in C++14.  C++20 code can still ``co_await`` between
+ *    calls to ``next()``, or wrap it in the generator of its choice.
+ *
+ * @endrst
+ */
+template <typename Vector>
+class chunk_cursor
+{
+    using impl_t   = std::decay_t<decltype(std::declval<Vector>().impl())>;
+    using walker_t = detail::rbts::chunk_walker<impl_t>;
+
+public:
+    using value_type = typename Vector::value_type;
+    using chunk_type = std::pair<const value_type*, const value_type*>;
+
+    chunk_cursor(Vector v)
+        : v_{std::move(v)}
+        , walker_{v_.impl()}
+    {}
+
+    chunk_cursor(const chunk_cursor&) = delete;
+    chunk_cursor& operator=(const chunk_cursor&) = delete;
+
+    chunk_cursor(chunk_cursor&& other)
+        : v_{other.v_}
+        , walker_{v_.impl()}
+    {
+        // restart from scratch and skip the chunks that have been
+        // visited already, the walker points into the old copy
+        for (auto n = other.visited_; n; --n)
+            walker_.next();
+        visited_ = other.visited_;
+    }
+
+    /*!
+     * Returns whether all the chunks have been visited.
+     */
+    bool done() const { return walker_.done(); }
+
+    /*!
+     * Returns the next chunk, or an empty range after the last one.
+     */
+    chunk_type next()
+    {
+        ++visited_;
+        return walker_.next();
+    }
+
+    class iterator
+        : public detail::iterator_facade<iterator,
+                                         std::input_iterator_tag,
+                                         chunk_type,
+                                         const chunk_type&>
+    {
+        friend class detail::iterator_core_access;
+        friend chunk_cursor;
+
+        chunk_cursor* c_ = nullptr;
+        chunk_type curr_ = {};
+
+        iterator(chunk_cursor* c)
+            : c_{c}
+        {
+            increment();
+        }
+
+        void increment()
+        {
+            if (c_->done())
+                c_ = nullptr;
+            else
+                curr_ = c_->next();
+        }
+
+        bool equal(const iterator& other) const { return c_ == other.c_; }
+
+        const chunk_type& dereference() const { return curr_; }
+
+    public:
+        iterator() = default;
+    };
+
+    /*!
+     * Returns an iterator to the next chunk.  Advancing it consumes
+     * the chunks of the cursor.
+     */
+    iterator begin() { return {this}; }
+    iterator end() { return {}; }
+
+private:
+    Vector v_;
+    walker_t walker_;
+    std::size_t visited_ = 0;
+};
+
+/*!
+ * Returns a @a chunk_cursor that visits the leaves of `v` one at a
+ * time.
+ */
+template <typename Vector>
+chunk_cursor<std::decay_t<Vector>> chunks(Vector&& v)
+{
+    return {std::forward<Vector>(v)};
+}
+
+} // namespace immer
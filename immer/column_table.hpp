@@ -0,0 +1,356 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/algorithm.hpp>
+#include <immer/config.hpp>
+#include <immer/flex_vector.hpp>
+#include <immer/flex_vector_transient.hpp>
+#include <immer/memory_policy.hpp>
+
+#include <cstddef>
+#include <initializer_list>
+#include <tuple>
+#include <utility>
+
+namespace immer {
+
+template <typename... Ts>
+class column_table_transient;
+
+/*!
+ * Immutable table of rows made of one value of every type in `Ts`,
+ * stored by column: the `I`-th field of all the rows lives in the
+ * `I`-th column, a ``flex_vector``, and all the columns are indexed by
+ * the same row numbers.  A scan of one field only touches the memory
+ * of that column, and runs over whole leaves with `for_each_chunk`.
+ *
+ * Changing a field copies the path to it in its column alone, while
+ * the other columns are shared with the previous version.  Changes of
+ * whole rows, like `push_back` or `erase`, touch every column.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    auto t = immer::column_table<int, double>{}
+ *                 .push_back(1, 0.5)
+ *                 .push_back(2, 1.5);
+ *    auto sum = 0.0;
+ *    t.for_each_chunk<1>([&](auto f, auto l) {
+ *        for (; f != l; ++f)
+ *            sum += *f;
+ *    });
+ *
+ * @endrst
+ */
+template <typename... Ts>
+class column_table
+{
+    using seq_t = std::index_sequence_for<Ts...>;
+
+public:
+    using size_type      = std::size_t;
+    using row_type       = std::tuple<Ts...>;
+    using transient_type = column_table_transient<Ts...>;
+
+    static constexpr auto columns = sizeof...(Ts);
+
+    /*!
+     * The type of the `I`-th column.
+     */
+    template <std::size_t I>
+    using column_type = flex_vector<std::tuple_element_t<I, row_type>>;
+
+    column_table() = default;
+
+    /*!
+     * Returns the number of rows.
+     */
+    IMMER_NODISCARD size_type size() const
+    {
+        return std::get<0>(columns_).size();
+    }
+
+    IMMER_NODISCARD bool empty() const { return size() == 0; }
+
+    /*!
+     * Returns the `I`-th column.
+     */
+    template <std::size_t I>
+    IMMER_NODISCARD const column_type<I>& column() const
+    {
+        return std::get<I>(columns_);
+    }
+
+    /*!
+     * Returns the `I`-th field of the row `row`.
+     */
+    template <std::size_t I>
+    IMMER_NODISCARD const std::tuple_element_t<I, row_type>&
+    get(size_type row) const
+    {
+        return std::get<I>(columns_)[row];
+    }
+
+    /*!
+     * Returns a copy of all the fields of the row `row`.
+     */
+    IMMER_NODISCARD row_type row(size_type row) const
+    {
+        return row_impl(row, seq_t{});
+    }
+
+    /*!
+     * Calls `fn(first, last)` with consecutive ranges of the `I`-th
+     * column, like @a for_each_chunk.
+     */
+    template <std::size_t I, typename Fn>
+    void for_each_chunk(Fn&& fn) const
+    {
+        immer::for_each_chunk(std::get<I>(columns_), std::forward<Fn>(fn));
+    }
+
+    /*!
+     * Returns a table with a new row at the end with the fields `xs`.
+     */
+    IMMER_NODISCARD column_table push_back(Ts... xs) const
+    {
+        return push_back_impl(row_type{std::move(xs)...}, seq_t{});
+    }
+
+    IMMER_NODISCARD column_table push_back(row_type r) const
+    {
+        return push_back_impl(std::move(r), seq_t{});
+    }
+
+    /*!
+     * Returns a table where the `I`-th field of the row `row` is `v`.
+     * Only the `I`-th column is changed.
+     */
+    template <std::size_t I>
+    IMMER_NODISCARD column_table
+    set(size_type row, std::tuple_element_t<I, row_type> v) const
+    {
+        auto r = *this;
+        std::get<I>(r.columns_) =
+            std::move(std::get<I>(r.columns_)).set(row, std::move(v));
+        return r;
+    }
+
+    /*!
+     * Returns a table where the `I`-th field `x` of the row `row` is
+     * replaced by `fn(x)`.  Only the `I`-th column is changed.
+     */
+    template <std::size_t I, typename Fn>
+    IMMER_NODISCARD column_table update(size_type row, Fn&& fn) const
+    {
+        auto r = *this;
+        std::get<I>(r.columns_) = std::move(std::get<I>(r.columns_))
+                                      .update(row, std::forward<Fn>(fn));
+        return r;
+    }
+
+    /*!
+     * Returns a table where all the fields of the row `row` are `r`.
+     */
+    IMMER_NODISCARD column_table set_row(size_type row, row_type r) const
+    {
+        return set_row_impl(row, std::move(r), seq_t{});
+    }
+
+    /*!
+     * Returns a table without the row `row`.  The rows after it are
+     * shifted down by one.
+     */
+    IMMER_NODISCARD column_table erase(size_type row) const
+    {
+        return erase_impl(row, seq_t{});
+    }
+
+    /*!
+     * Returns a table with the first `n` rows.
+     */
+    IMMER_NODISCARD column_table take(size_type n) const
+    {
+        return take_impl(n, seq_t{});
+    }
+
+    /*!
+     * Returns a table without the first `n` rows.
+     */
+    IMMER_NODISCARD column_table drop(size_type n) const
+    {
+        return drop_impl(n, seq_t{});
+    }
+
+    IMMER_NODISCARD bool operator==(const column_table& other) const
+    {
+        return columns_ == other.columns_;
+    }
+    IMMER_NODISCARD bool operator!=(const column_table& other) const
+    {
+        return !(*this == other);
+    }
+
+    /*!
+     * Returns a @a transient form of this container, an
+     * `immer::column_table_transient`.
+     */
+    IMMER_NODISCARD transient_type transient() const
+    {
+        return transient_type{columns_, seq_t{}};
+    }
+
+private:
+    friend transient_type;
+
+    using columns_t = std::tuple<flex_vector<Ts>...>;
+
+    column_table(columns_t cs)
+        : columns_{std::move(cs)}
+    {}
+
+    template <std::size_t... Is>
+    row_type row_impl(size_type row, std::index_sequence<Is...>) const
+    {
+        return row_type{std::get<Is>(columns_)[row]...};
+    }
+
+    template <std::size_t... Is>
+    column_table push_back_impl(row_type r, std::index_sequence<Is...>) const
+    {
+        return columns_t{
+            std::get<Is>(columns_).push_back(std::move(std::get<Is>(r)))...};
+    }
+
+    template <std::size_t... Is>
+    column_table
+    set_row_impl(size_type row, row_type r, std::index_sequence<Is...>) const
+    {
+        return columns_t{
+            std::get<Is>(columns_).set(row, std::move(std::get<Is>(r)))...};
+    }
+
+    template <std::size_t... Is>
+    column_table erase_impl(size_type row, std::index_sequence<Is...>) const
+    {
+        return columns_t{std::get<Is>(columns_).erase(row)...};
+    }
+
+    template <std::size_t... Is>
+    column_table take_impl(size_type n, std::index_sequence<Is...>) const
+    {
+        return columns_t{std::get<Is>(columns_).take(n)...};
+    }
+
+    template <std::size_t... Is>
+    column_table drop_impl(size_type n, std::index_sequence<Is...>) const
+    {
+        return columns_t{std::get<Is>(columns_).drop(n)...};
+    }
+
+    columns_t columns_;
+};
+
+/*!
+ * Mutable version of `immer::column_table`, where every column is a
+ * ``flex_vector_transient``.
+ */
+template <typename... Ts>
+class column_table_transient
+{
+    using seq_t = std::index_sequence_for<Ts...>;
+
+public:
+    using persistent_type = column_table<Ts...>;
+    using size_type       = typename persistent_type::size_type;
+    using row_type        = typename persistent_type::row_type;
+
+    column_table_transient() = default;
+
+    IMMER_NODISCARD size_type size() const
+    {
+        return std::get<0>(columns_).size();
+    }
+
+    IMMER_NODISCARD bool empty() const { return size() == 0; }
+
+    template <std::size_t I>
+    IMMER_NODISCARD const std::tuple_element_t<I, row_type>&
+    get(size_type row) const
+    {
+        return std::get<I>(columns_)[row];
+    }
+
+    void push_back(Ts... xs) { push_back(row_type{std::move(xs)...}); }
+
+    void push_back(row_type r) { push_back_impl(std::move(r), seq_t{}); }
+
+    template <std::size_t I>
+    void set(size_type row, std::tuple_element_t<I, row_type> v)
+    {
+        std::get<I>(columns_).set(row, std::move(v));
+    }
+
+    template <std::size_t I, typename Fn>
+    void update(size_type row, Fn&& fn)
+    {
+        std::get<I>(columns_).update(row, std::forward<Fn>(fn));
+    }
+
+    void set_row(size_type row, row_type r)
+    {
+        set_row_impl(row, std::move(r), seq_t{});
+    }
+
+    /*!
+     * Returns an immutable form of this container.
+     */
+    IMMER_NODISCARD persistent_type persistent() &
+    {
+        return persistent_impl(seq_t{});
+    }
+
+private:
+    friend persistent_type;
+
+    template <std::size_t... Is>
+    column_table_transient(const typename persistent_type::columns_t& cs,
+                           std::index_sequence<Is...>)
+        : columns_{std::get<Is>(cs).transient()...}
+    {}
+
+    template <std::size_t... Is>
+    void push_back_impl(row_type r, std::index_sequence<Is...>)
+    {
+        (void) std::initializer_list<int>{
+            (std::get<Is>(columns_).push_back(std::move(std::get<Is>(r))),
+             0)...};
+    }
+
+    template <std::size_t... Is>
+    void set_row_impl(size_type row, row_type r, std::index_sequence<Is...>)
+    {
+        (void) std::initializer_list<int>{
+            (std::get<Is>(columns_).set(row, std::move(std::get<Is>(r))),
+             0)...};
+    }
+
+    template <std::size_t... Is>
+    persistent_type persistent_impl(std::index_sequence<Is...>)
+    {
+        return typename persistent_type::columns_t{
+            std::get<Is>(columns_).persistent()...};
+    }
+
+    std::tuple<typename flex_vector<Ts>::transient_type...> columns_;
+};
+
+} // namespace immer
@@ -0,0 +1,263 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/iterator_facade.hpp>
+#include <immer/flex_vector.hpp>
+#include <immer/vector.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+namespace immer {
+
+namespace detail {
+
+/*!
+ * The implementation that a `concat_view` exposes to the algorithms:
+ * the traversals of every piece, one after the other.
+ */
+template <typename Pieces>
+struct concat_impl
+{
+    const Pieces* pieces;
+
+    template <typename Fn>
+    void for_each_chunk(Fn&& fn) const
+    {
+        for (auto& p : *pieces)
+            p.impl().for_each_chunk(fn);
+    }
+
+    template <typename Fn>
+    bool for_each_chunk_p(Fn&& fn) const
+    {
+        for (auto& p : *pieces)
+            if (!p.impl().for_each_chunk_p(fn))
+                return false;
+        return true;
+    }
+};
+
+/*!
+ * Iterates over the elements of the pieces of a `concat_view`, one
+ * piece after the other.
+ */
+template <typename Pieces, typename Vector>
+struct concat_iterator
+    : iterator_facade<concat_iterator<Pieces, Vector>,
+                      std::forward_iterator_tag,
+                      typename Vector::value_type,
+                      typename Vector::reference,
+                      typename Vector::difference_type,
+                      const typename Vector::value_type*>
+{
+    concat_iterator() = default;
+
+    concat_iterator(const Pieces* pieces, std::size_t piece)
+        : pieces_{pieces}
+        , piece_{piece}
+    {
+        if (piece_ < pieces_->size())
+            it_ = (*pieces_)[piece_].begin();
+    }
+
+private:
+    friend iterator_core_access;
+
+    const Pieces* pieces_ = nullptr;
+    std::size_t piece_    = 0;
+    typename Vector::iterator it_{};
+
+    void increment()
+    {
+        // the view has no empty pieces
+        if (++it_ == (*pieces_)[piece_].end() &&
+            ++piece_ < pieces_->size())
+            it_ = (*pieces_)[piece_].begin();
+    }
+
+    bool equal(const concat_iterator& other) const
+    {
+        return piece_ == other.piece_ &&
+               (piece_ == pieces_->size() || it_ == other.it_);
+    }
+
+    typename Vector::reference dereference() const { return *it_; }
+};
+
+} // namespace detail
+
+/*!
+ * Read-only concatenation of ``flex_vector`` of type `Vector` that is
+ * not done until it is needed.  It records the pieces, and iterating
+ * over it, or passing it to the :doc:`algorithms <algorithms>`, visits
+ * them one after the other, thus a result that is only traversed once
+ * never pays for the rebalancing of the concatenations.  Elements are
+ * accessed by index in @f$ O(log(k) + log(n)) @f$, for @f$ k @f$
+ * pieces, without concatenating them either.  The vector with all the
+ * elements, to keep it or update it, is built with `materialize()`,
+ * like @a concat_all does.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    auto all = immer::concat_view<immer::flex_vector<int>>{};
+ *    for (auto& piece : pieces)
+ *        all = std::move(all) + piece;
+ *    auto sum = immer::accumulate(all, 0);
+ *
+ * @endrst
+ */
+template <typename Vector>
+class concat_view
+{
+    using pieces_t = vector<Vector, typename Vector::memory_policy>;
+    using ends_t   = vector<std::size_t, typename Vector::memory_policy>;
+    using impl_t   = detail::concat_impl<pieces_t>;
+
+public:
+    using vector_type     = Vector;
+    using value_type      = typename Vector::value_type;
+    using reference       = typename Vector::reference;
+    using size_type       = typename Vector::size_type;
+    using difference_type = typename Vector::difference_type;
+    using const_reference = typename Vector::const_reference;
+
+    using iterator       = detail::concat_iterator<pieces_t, Vector>;
+    using const_iterator = iterator;
+
+    /*!
+     * Default constructor.  It creates an empty view.
+     */
+    concat_view() = default;
+
+    /*!
+     * Constructs a view with the single piece `v`.
+     */
+    concat_view(Vector v) { push_piece(std::move(v)); }
+
+    /*!
+     * Returns an iterator pointing at the first element of the first
+     * piece.
+     */
+    IMMER_NODISCARD iterator begin() const { return {&pieces_, 0}; }
+
+    /*!
+     * Returns an iterator pointing just after the last element of the
+     * last piece.
+     */
+    IMMER_NODISCARD iterator end() const
+    {
+        return {&pieces_, pieces_.size()};
+    }
+
+    /*!
+     * Returns the number of elements in all the pieces.  Its
+     * complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD size_type size() const
+    {
+        return ends_.empty() ? 0 : ends_.back();
+    }
+
+    /*!
+     * Returns `true` if there are no elements in the view.
+     */
+    IMMER_NODISCARD bool empty() const { return pieces_.empty(); }
+
+    /*!
+     * Returns the pieces of the view, without the empty ones.
+     */
+    IMMER_NODISCARD const pieces_t& pieces() const { return pieces_; }
+
+    /*!
+     * Returns a `const` reference to the element at position `index`,
+     * which is found with a binary search of its piece.  It is
+     * undefined when @f$ index \geq size() @f$.
+     */
+    IMMER_NODISCARD reference operator[](size_type index) const
+    {
+        auto it = std::upper_bound(ends_.begin(), ends_.end(), index);
+        auto i  = static_cast<size_type>(it - ends_.begin());
+        return pieces_[i][i ? index - ends_[i - 1] : index];
+    }
+
+    /*!
+     * Returns a `const` reference to the element at position `index`.
+     * It throws an `std::out_of_range` exception when @f$ index \geq
+     * size() @f$.
+     */
+    reference at(size_type index) const
+    {
+        if (index >= size())
+            IMMER_THROW(std::out_of_range{"index out of range"});
+        return (*this)[index];
+    }
+
+    /*!
+     * Returns a view with `v` after the elements of this one.  It does
+     * not touch the elements of either.
+     */
+    IMMER_NODISCARD concat_view push_back(Vector v) const&
+    {
+        auto r = *this;
+        r.push_piece(std::move(v));
+        return r;
+    }
+    IMMER_NODISCARD concat_view&& push_back(Vector v) &&
+    {
+        push_piece(std::move(v));
+        return std::move(*this);
+    }
+
+    /*!
+     * Returns a view with the piece `v`, or the pieces of the view
+     * `v`, after the ones of `x`.
+     */
+    friend concat_view operator+(concat_view x, Vector v)
+    {
+        return std::move(x).push_back(std::move(v));
+    }
+    friend concat_view operator+(concat_view x, const concat_view& v)
+    {
+        for (auto& p : v.pieces_)
+            x.push_piece(p);
+        return x;
+    }
+
+    /*!
+     * Returns a vector with the elements of all the pieces, which are
+     * concatenated with @a concat_all.
+     */
+    IMMER_NODISCARD Vector materialize() const { return concat_all(pieces_); }
+
+    // Semi-private
+    impl_t impl() const { return {&pieces_}; }
+
+private:
+    void push_piece(Vector v)
+    {
+        if (v.empty())
+            return;
+        auto end = size() + v.size();
+        pieces_  = std::move(pieces_).push_back(std::move(v));
+        ends_    = std::move(ends_).push_back(end);
+    }
+
+    pieces_t pieces_;
+    ends_t ends_;
+};
+
+} // namespace immer
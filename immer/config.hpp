@@ -74,6 +74,12 @@
 #define IMMER_DEBUG_STATS 0
 #endif
 
+// Whether the containers call the callbacks of `immer::trace_hooks`,
+// see `immer/trace.hpp`.
+#ifndef IMMER_TRACE_HOOKS
+#define IMMER_TRACE_HOOKS 0
+#endif
+
 #ifndef IMMER_DEBUG_DEEP_CHECK
 #define IMMER_DEBUG_DEEP_CHECK 0
 #endif
@@ -101,18 +107,77 @@
 #define IMMER_LIKELY(cond) cond
 #define IMMER_UNLIKELY(cond) cond
 #define IMMER_FORCEINLINE __forceinline
-#define IMMER_PREFETCH(p)
+#define IMMER_PREFETCH_READ(p)
+#define IMMER_PREFETCH_WRITE(p)
 #else
 #define IMMER_UNREACHABLE __builtin_unreachable()
 #define IMMER_LIKELY(cond) __builtin_expect(!!(cond), 1)
 #define IMMER_UNLIKELY(cond) __builtin_expect(!!(cond), 0)
 #define IMMER_FORCEINLINE inline __attribute__((always_inline))
-#define IMMER_PREFETCH(p)
-// #define IMMER_PREFETCH(p)    __builtin_prefetch(p)
+// used where a batch of objects is about to be read or written
+#define IMMER_PREFETCH_READ(p) __builtin_prefetch(p, 0)
+#define IMMER_PREFETCH_WRITE(p) __builtin_prefetch(p, 1)
 #endif
 
 #define IMMER_DESCENT_DEEP 0
 
+// Whether the traversals of the vectors, on which `for_each_chunk` and
+// the other algorithms are built, prefetch the leaf that they visit
+// next while the current one is visited.
+#ifndef IMMER_PREFETCH_LEAVES
+#define IMMER_PREFETCH_LEAVES 1
+#endif
+
+// Number of bytes that `immer::node_tuning` aims for in every node
+// when choosing the branching factors of the containers.
+#ifndef IMMER_TARGET_NODE_BYTES
+#define IMMER_TARGET_NODE_BYTES 256
+#endif
+
+// Whether `adaptive_lock_policy` parks the threads that wait for it on a
+// futex.  Where there is none, they yield instead.
+#ifndef IMMER_HAS_FUTEX
+#if defined(__linux__)
+#define IMMER_HAS_FUTEX 1
+#else
+#define IMMER_HAS_FUTEX 0
+#endif
+#endif
+
+// Whether the ``map``, ``set`` and ``table`` containers hash their
+// keys with `immer::default_hash` instead of `std::hash` when no hash
+// function is given.  It changes the types of the containers, thus it
+// must have the same value in every translation unit.
+#ifndef IMMER_USE_DEFAULT_HASH
+#define IMMER_USE_DEFAULT_HASH 0
+#endif
+
+// Whether to count the bits of the CHAMP bitmaps with the compiler
+// builtins.  GCC lowers them to a call into its runtime library when
+// the target lacks a population count instruction, which is slower
+// than the inline fallback, so in that case the fallback is used
+// unless the instruction is enabled (e.g. with `-mpopcnt` or
+// `-march=native`).
+#ifndef IMMER_HAS_BUILTIN_POPCOUNT
+#if defined(__GNUC__) && !defined(__clang__) &&                               \
+    (defined(__x86_64__) || defined(__i386__)) && !defined(__POPCNT__)
+#define IMMER_HAS_BUILTIN_POPCOUNT 0
+#else
+#define IMMER_HAS_BUILTIN_POPCOUNT 1
+#endif
+#endif
+
+// Whether `cpp_heap` passes the size of the objects to `operator
+// delete`, which saves a size lookup in allocators like jemalloc or
+// tcmalloc.  Clang only provides it with `-fsized-deallocation`.
+#ifndef IMMER_HAS_SIZED_DEALLOCATION
+#if defined(__cpp_sized_deallocation)
+#define IMMER_HAS_SIZED_DEALLOCATION 1
+#else
+#define IMMER_HAS_SIZED_DEALLOCATION 0
+#endif
+#endif
+
 #ifndef IMMER_ENABLE_DEBUG_SIZE_HEAP
 #ifdef NDEBUG
 #define IMMER_ENABLE_DEBUG_SIZE_HEAP 0
@@ -124,6 +189,7 @@
 namespace immer {
 
 const auto default_bits           = 5;
+const auto default_btree_branches = 32;
 const auto default_free_list_size = 1 << 10;
 
 } // namespace immer
@@ -0,0 +1,37 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+
+#include <functional>
+#include <type_traits>
+
+namespace immer {
+
+template <typename T, typename Enable = void>
+struct default_hash;
+
+/*!
+ * The hash function object that the ``map``, ``set`` and ``table``
+ * containers use by default for the type `T`.  It is `std::hash<T>`,
+ * unless ``IMMER_USE_DEFAULT_HASH`` is defined to ``1``, in which case
+ * it is @ref default_hash.  The macro must have the same value in
+ * every translation unit of the program.
+ */
+template <typename T>
+using container_hash = std::conditional_t<IMMER_USE_DEFAULT_HASH,
+                                          default_hash<T>,
+                                          std::hash<T>>;
+
+} // namespace immer
+
+#if IMMER_USE_DEFAULT_HASH
+#include <immer/hash.hpp>
+#endif
@@ -0,0 +1,157 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/algorithm.hpp>
+#include <immer/array.hpp>
+#include <immer/array_transient.hpp>
+#include <immer/executor.hpp>
+#include <immer/flex_vector.hpp>
+#include <immer/vector.hpp>
+#include <immer/vector_transient.hpp>
+
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+namespace immer {
+
+/*!
+ * @defgroup convert
+ *
+ * Conversions between the sequence containers that reuse what the
+ * layouts let them reuse.  A ``vector`` and a ``flex_vector`` with the
+ * same parameters share the same nodes, so converting one into the
+ * other is @f$ O(1) @f$ whenever the tree has the shape that the
+ * target expects.  An ``array`` is one contiguous buffer, that is
+ * split into leaves in one pass without pushing its elements one by
+ * one, and its elements are moved instead of copied when the array
+ * was the only owner of the buffer.
+ *
+ * @{
+ */
+
+namespace detail {
+
+template <typename Result, typename T, typename Array, typename Executor>
+Result from_array(Array a, Executor& ex)
+{
+    auto first = a.data();
+    auto last  = first + a.size();
+    // leaves can not point into the buffer, since every node has a
+    // header, but they can take its elements when nobody else sees it
+    if (!std::is_trivially_copyable<T>::value &&
+        a.impl().ptr->refs().unique())
+        return Result::from_range_parallel(
+            std::make_move_iterator(const_cast<T*>(first)),
+            std::make_move_iterator(const_cast<T*>(last)),
+            ex);
+    return Result::from_range_parallel(first, last, ex);
+}
+
+} // namespace detail
+
+/*!
+ * Returns a ``vector`` with the elements of the array `a`.  The leaves
+ * are filled from slices of its buffer, in parallel with the executor
+ * `ex` (see @ref executor), and the elements are moved out of it when
+ * `a` was its only owner, as when it is passed with `std::move()`.
+ */
+template <typename T,
+          typename MemoryPolicy,
+          typename Growth,
+          typename Executor = sequential_executor>
+vector<T, MemoryPolicy>
+to_vector(array<T, MemoryPolicy, Growth> a, Executor&& ex = {})
+{
+    return detail::from_array<vector<T, MemoryPolicy>, T>(std::move(a), ex);
+}
+
+/*!
+ * Returns a ``flex_vector`` with the elements of the array `a`, like
+ * the ``to_vector()`` for arrays.  Thus, concatenating an array to a
+ * flex_vector is ``v + to_flex_vector(std::move(a))``, which builds
+ * the leaves of the array in one pass and shares all the nodes of `v`.
+ */
+template <typename T,
+          typename MemoryPolicy,
+          typename Growth,
+          typename Executor = sequential_executor>
+flex_vector<T, MemoryPolicy>
+to_flex_vector(array<T, MemoryPolicy, Growth> a, Executor&& ex = {})
+{
+    return detail::from_array<flex_vector<T, MemoryPolicy>, T>(std::move(a),
+                                                                ex);
+}
+
+/*!
+ * Returns a ``flex_vector`` with the elements of `v`, sharing all its
+ * nodes.  It is @f$ O(1) @f$, and the same as the converting
+ * constructor of ``flex_vector``.
+ */
+template <typename T,
+          typename MemoryPolicy,
+          detail::rbts::bits_t B,
+          detail::rbts::bits_t BL>
+flex_vector<T, MemoryPolicy, B, BL>
+to_flex_vector(vector<T, MemoryPolicy, B, BL> v)
+{
+    return v;
+}
+
+/*!
+ * Returns a ``vector`` with the elements of `v`.  When `v` has not
+ * been sliced or concatenated in a way that left a relaxed node in its
+ * root, the tree is the same that a ``vector`` would have, and the
+ * result shares all its nodes in @f$ O(1) @f$.  Otherwise, the
+ * elements are pushed into a new vector chunk by chunk.
+ */
+template <typename T,
+          typename MemoryPolicy,
+          detail::rbts::bits_t B,
+          detail::rbts::bits_t BL>
+vector<T, MemoryPolicy, B, BL>
+to_vector(const flex_vector<T, MemoryPolicy, B, BL>& v)
+{
+    using result_t = vector<T, MemoryPolicy, B, BL>;
+    using tree_t   = detail::rbts::rbtree<T, MemoryPolicy, B, BL>;
+    auto& impl     = v.impl();
+    // a node that is not relaxed only has regular subtrees below
+    if (!impl.root->relaxed()) {
+        impl.inc();
+        return result_t{tree_t{impl.size, impl.shift, impl.root, impl.tail}};
+    }
+    auto t = result_t{}.transient();
+    for_each_chunk(v, [&](auto first, auto last) {
+        for (; first != last; ++first)
+            t.push_back(*first);
+    });
+    return std::move(t).persistent();
+}
+
+/*!
+ * Returns an ``array`` with the elements of `v`, a ``vector`` or a
+ * ``flex_vector``.  The buffer is allocated once, with the size of
+ * `v`, and filled leaf by leaf.
+ */
+template <typename Vector,
+          typename Growth = default_array_growth,
+          typename T      = typename Vector::value_type,
+          typename MP     = typename Vector::memory_policy>
+array<T, MP, Growth> to_array(const Vector& v)
+{
+    auto t = array<T, MP, Growth>{}.transient();
+    t.reserve(v.size());
+    for_each_chunk(v, [&](auto first, auto last) { t.append(first, last); });
+    return std::move(t).persistent();
+}
+
+/** @} */ // group: convert
+
+} // namespace immer
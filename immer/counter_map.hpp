@@ -0,0 +1,210 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/atom.hpp>
+#include <immer/config.hpp>
+#include <immer/map.hpp>
+#include <immer/map_transient.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+namespace immer {
+
+/*!
+ * Concurrent map of counters, from keys of type `K` to values of type
+ * `T`, for workloads where many threads add to the same few keys.
+ * Instead of publishing every increment, as an `atom` of a ``map``
+ * would, every thread adds to its own `local_type`, which keeps the
+ * sums of its pending deltas in a transient map.  Those are merged
+ * into the published map once there are `max_pending` of them,
+ * or when the local is flushed or destroyed, with one update of the
+ * atom that adds the deltas of all the keys at once.  Since addition
+ * is commutative, the order of the flushes does not matter.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    immer::counter_map<std::string> hits;
+ *    // in every thread
+ *    auto local = hits.local();
+ *    for (auto& req : requests)
+ *        local.add(req.path);
+ *    // anywhere
+ *    auto total = hits.snapshot().find("/index.html");
+ *
+ * The snapshots are immutable ``map`` objects, that lag behind by at
+ * most ``max_pending`` increments per live local.  Concurrent flushes
+ * are combined into one update of the map by the
+ * :cpp:class:`combining_reclamation_policy` of the atom.
+ *
+ * @endrst
+ */
+template <typename K,
+          typename T            = std::int64_t,
+          typename Hash         = std::hash<K>,
+          typename Equal        = std::equal_to<K>,
+          typename MemoryPolicy = default_memory_policy>
+class counter_map
+{
+public:
+    using key_type      = K;
+    using mapped_type   = T;
+    using value_type    = std::pair<K, T>;
+    using size_type     = std::size_t;
+    using hasher        = Hash;
+    using key_equal     = Equal;
+    using memory_policy = MemoryPolicy;
+
+    using map_type = map<K, T, Hash, Equal, MemoryPolicy>;
+
+private:
+    using atom_t = atom<map_type, MemoryPolicy, combining_reclamation_policy<>>;
+
+public:
+    /*!
+     * Accumulates the deltas of one thread, see `counter_map::local()`.
+     * It is not thread safe, must not outlive the counter map, and is
+     * flushed when it is destroyed.
+     */
+    class local_type
+    {
+    public:
+        local_type(local_type&& other)
+            : owner_{other.owner_}
+            , deltas_{std::move(other.deltas_)}
+            , pending_{other.pending_}
+        {
+            other.owner_   = nullptr;
+            other.pending_ = 0;
+        }
+
+        local_type(const local_type&) = delete;
+        local_type& operator=(const local_type&) = delete;
+        local_type& operator=(local_type&&) = delete;
+
+        ~local_type()
+        {
+            if (owner_)
+                flush();
+        }
+
+        /*!
+         * Adds `delta` to the counter of the key `k`, publishing all
+         * the pending deltas when there are `max_pending` of them.
+         */
+        void add(K k, T delta = T{1})
+        {
+            deltas_.update(std::move(k),
+                           [&](const T& x) { return x + delta; });
+            if (++pending_ >= owner_->max_pending_)
+                flush();
+        }
+
+        /*!
+         * Returns the number of deltas that have not been published.
+         */
+        IMMER_NODISCARD size_type pending() const { return pending_; }
+
+        /*!
+         * Publishes the pending deltas.
+         */
+        void flush()
+        {
+            if (pending_ == 0)
+                return;
+            owner_->merge(std::move(deltas_).persistent());
+            deltas_  = map_type{}.transient();
+            pending_ = 0;
+        }
+
+    private:
+        friend counter_map;
+
+        local_type(counter_map& owner)
+            : owner_{&owner}
+        {}
+
+        counter_map* owner_;
+        typename map_type::transient_type deltas_ = map_type{}.transient();
+        size_type pending_                        = 0;
+    };
+
+    /*!
+     * Constructs a counter map with the counters of `init`, whose
+     * locals publish their deltas once they have `max_pending` of
+     * them.
+     */
+    counter_map(map_type init = {}, size_type max_pending = 1024)
+        : state_{std::move(init)}
+        , max_pending_{max_pending ? max_pending : 1}
+    {}
+
+    counter_map(const counter_map&) = delete;
+    counter_map(counter_map&&)      = delete;
+    void operator=(const counter_map&) = delete;
+    void operator=(counter_map&&) = delete;
+
+    /*!
+     * Returns a new local to add to the counters from the calling
+     * thread.
+     */
+    IMMER_NODISCARD local_type local() { return *this; }
+
+    /*!
+     * Adds `delta` to the counter of the key `k` right away, without a
+     * local.  Every call updates the published map.
+     */
+    void add(K k, T delta = T{1})
+    {
+        state_.update([&](map_type m) {
+            return std::move(m).update(k,
+                                       [&](const T& x) { return x + delta; });
+        });
+    }
+
+    /*!
+     * Returns the published counters.  The keys that were never added
+     * to are not there.
+     */
+    IMMER_NODISCARD map_type snapshot() const { return *state_.load(); }
+
+    /*!
+     * Returns the published counter of the key `k`, or `0` when it is
+     * not there.
+     */
+    IMMER_NODISCARD T get(const K& k) const
+    {
+        auto s = state_.load();
+        auto p = s->find(k);
+        return p ? *p : T{};
+    }
+
+private:
+    // adds the deltas to the counters, the maps never share nodes, as
+    // summing them with `map::merge` requires
+    void merge(map_type deltas)
+    {
+        state_.update([&](const map_type& m) {
+            return m.empty() ? deltas
+                             : m.merge(deltas, [](const T& x, const T& y) {
+                                   return x + y;
+                               });
+        });
+    }
+
+    atom_t state_;
+    size_type max_pending_;
+};
+
+} // namespace immer
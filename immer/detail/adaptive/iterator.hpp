@@ -0,0 +1,107 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/detail/adaptive/sequence.hpp>
+#include <immer/detail/iterator_facade.hpp>
+
+namespace immer {
+namespace detail {
+namespace adaptive {
+
+template <typename T,
+          typename MP,
+          rbts::bits_t B,
+          rbts::bits_t BL,
+          std::size_t Threshold>
+struct iterator
+    : iterator_facade<iterator<T, MP, B, BL, Threshold>,
+                      std::random_access_iterator_tag,
+                      T,
+                      const T&,
+                      std::ptrdiff_t,
+                      const T*>
+{
+    using impl_t = sequence<T, MP, B, BL, Threshold>;
+
+    struct end_t
+    {};
+
+    iterator() = default;
+
+    iterator(const impl_t& v)
+        : v_{&v}
+        , i_{0}
+        , base_{~std::size_t{}}
+        , curr_{v.is_big ? nullptr : v.small.data()}
+    {}
+
+    iterator(const impl_t& v, end_t)
+        : v_{&v}
+        , i_{v.size()}
+        , base_{~std::size_t{}}
+        , curr_{v.is_big ? nullptr : v.small.data()}
+    {}
+
+    const impl_t& impl() const { return *v_; }
+    std::size_t index() const { return i_; }
+
+private:
+    friend iterator_core_access;
+
+    const impl_t* v_;
+    std::size_t i_;
+    mutable std::size_t base_;
+    mutable const T* curr_ = nullptr;
+
+    void increment()
+    {
+        assert(i_ < v_->size());
+        ++i_;
+    }
+
+    void decrement()
+    {
+        assert(i_ > 0);
+        --i_;
+    }
+
+    void advance(std::ptrdiff_t n)
+    {
+        assert(n <= 0 || i_ + static_cast<std::size_t>(n) <= v_->size());
+        assert(n >= 0 || static_cast<std::size_t>(-n) <= i_);
+        i_ += n;
+    }
+
+    bool equal(const iterator& other) const { return i_ == other.i_; }
+
+    std::ptrdiff_t distance_to(const iterator& other) const
+    {
+        return other.i_ > i_ ? static_cast<std::ptrdiff_t>(other.i_ - i_)
+                             : -static_cast<std::ptrdiff_t>(i_ - other.i_);
+    }
+
+    // the array is one chunk, whose start is set on construction, and
+    // the leaves of the tree are looked up when the index leaves them
+    const T& dereference() const
+    {
+        if (!v_->is_big)
+            return curr_[i_];
+        auto base = i_ & ~rbts::mask<BL>;
+        if (base_ != base) {
+            base_ = base;
+            curr_ = v_->big.array_for(i_);
+        }
+        return curr_[i_ & rbts::mask<BL>];
+    }
+};
+
+} // namespace adaptive
+} // namespace detail
+} // namespace immer
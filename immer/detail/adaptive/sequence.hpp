@@ -0,0 +1,315 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/detail/arrays/with_capacity.hpp>
+#include <immer/detail/rbts/rbtree.hpp>
+#include <immer/detail/rbts/rbtree_iterator.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace immer {
+namespace detail {
+namespace adaptive {
+
+// Up to about 4KiB an array is copied faster than the nodes of a tree
+// are allocated, but the elements that are not trivially copyable also
+// pay for their copy constructors.
+template <typename T>
+constexpr std::size_t default_threshold =
+    std::max<std::size_t>(8,
+                          (std::is_trivially_copyable<T>::value ? 4096 : 1024) /
+                              sizeof(T));
+
+// A sequence that is an array while it has up to `Threshold` elements
+// and a tree afterwards.  A tree only turns back into an array when it
+// is taken down to half of that, so that a sequence that oscillates
+// around the threshold does not convert on every operation.
+template <typename T,
+          typename MemoryPolicy,
+          rbts::bits_t B,
+          rbts::bits_t BL,
+          std::size_t Threshold>
+struct sequence
+{
+    using small_t = arrays::with_capacity<T, MemoryPolicy>;
+    using big_t   = rbts::rbtree<T, MemoryPolicy, B, BL>;
+    using owner_t = typename MemoryPolicy::transience_t::owner;
+
+    bool is_big;
+    // whether this is an empty array that holds no reference to the
+    // empty node, like the default and the moved from sequences, so that
+    // making and moving sequences does not touch any reference count
+    bool is_unowned;
+    union
+    {
+        small_t small;
+        big_t big;
+    };
+
+    struct small_tag
+    {};
+    struct big_tag
+    {};
+
+    sequence() { set_unowned(); }
+
+    // the representation is made in place by `make`
+    template <typename Fn>
+    sequence(small_tag, Fn&& make)
+        : is_big{false}
+        , is_unowned{false}
+        , small{make()}
+    {}
+
+    template <typename Fn>
+    sequence(big_tag, Fn&& make)
+        : is_big{true}
+        , is_unowned{false}
+        , big{make()}
+    {}
+
+    sequence(const sequence& other)
+        : is_big{other.is_big}
+        , is_unowned{other.is_unowned}
+    {
+        if (is_unowned)
+            set_unowned();
+        else if (is_big)
+            new (&big) big_t{other.big};
+        else
+            new (&small) small_t{other.small};
+    }
+
+    sequence(sequence&& other)
+        : is_big{other.is_big}
+        , is_unowned{other.is_unowned}
+    {
+        if (is_big)
+            new (&big) big_t{
+                other.big.size, other.big.shift, other.big.root, other.big.tail};
+        else
+            new (&small) small_t{
+                other.small.ptr, other.small.size, other.small.capacity};
+        other.set_unowned();
+    }
+
+    sequence& operator=(const sequence& other)
+    {
+        return *this = sequence{other};
+    }
+
+    sequence& operator=(sequence&& other)
+    {
+        if (this != &other) {
+            this->~sequence();
+            new (this) sequence{std::move(other)};
+        }
+        return *this;
+    }
+
+    ~sequence()
+    {
+        if (is_unowned)
+            return;
+        else if (is_big)
+            big.~big_t();
+        else
+            small.~small_t();
+    }
+
+    template <typename Fn>
+    static sequence make_small(Fn&& make)
+    {
+        return {small_tag{}, make};
+    }
+
+    template <typename Fn>
+    static sequence make_big(Fn&& make)
+    {
+        return {big_tag{}, make};
+    }
+
+    template <typename U>
+    static sequence from_initializer_list(std::initializer_list<U> values)
+    {
+        return from_range(values.begin(), values.end());
+    }
+
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<compatible_sentinel_v<Iter, Sent>, bool> = true>
+    static sequence from_range(Iter first, Sent last)
+    {
+        using forward_t =
+            std::integral_constant<bool, is_forward_iterator_v<Iter>>;
+        return from_range(first, last, forward_t{});
+    }
+
+    template <typename Iter, typename Sent>
+    static sequence from_range(Iter first, Sent last, std::true_type)
+    {
+        if (static_cast<std::size_t>(distance(first, last)) <= Threshold)
+            return make_small([&] { return small_t::from_range(first, last); });
+        else
+            return make_big([&] { return big_t::from_range(first, last); });
+    }
+
+    // the input iterators can only be read once, so the elements go to
+    // a tree until the size is known
+    template <typename Iter, typename Sent>
+    static sequence from_range(Iter first, Sent last, std::false_type)
+    {
+        auto r = make_big([&] { return big_t::from_range(first, last); });
+        if (r.size() <= Threshold)
+            return make_small([&] { return r.shrink(r.size()); });
+        return r;
+    }
+
+    static sequence from_fill(std::size_t n, T v)
+    {
+        if (n <= Threshold)
+            return make_small([&] { return small_t::from_fill(n, v); });
+        else
+            return make_big([&] { return big_t::from_fill(n, v); });
+    }
+
+    std::size_t size() const { return is_big ? big.size : small.size; }
+
+    const T& get(std::size_t index) const
+    {
+        return is_big ? big.get(index) : small.get(index);
+    }
+
+    const T& get_check(std::size_t index) const
+    {
+        return is_big ? big.get_check(index) : small.get_check(index);
+    }
+
+    const T& front() const { return get(0); }
+    const T& back() const { return get(size() - 1); }
+
+    template <typename Fn>
+    void for_each_chunk(Fn&& fn) const
+    {
+        if (is_big)
+            big.for_each_chunk(std::forward<Fn>(fn));
+        else
+            small.for_each_chunk(std::forward<Fn>(fn));
+    }
+
+    template <typename Fn>
+    bool for_each_chunk_p(Fn&& fn) const
+    {
+        return is_big ? big.for_each_chunk_p(std::forward<Fn>(fn))
+                      : small.for_each_chunk_p(std::forward<Fn>(fn));
+    }
+
+    bool equals(const sequence& other) const
+    {
+        if (is_big && other.is_big)
+            return big.equals(other.big);
+        if (!is_big && !other.is_big)
+            return small.equals(other.small);
+        if (size() != other.size())
+            return false;
+        for (auto i = std::size_t{}; i < size(); ++i)
+            if (!(get(i) == other.get(i)))
+                return false;
+        return true;
+    }
+
+    template <typename... Args>
+    sequence emplace_back(Args&&... args) const
+    {
+        if (is_big)
+            return make_big(
+                [&] { return big.emplace_back(std::forward<Args>(args)...); });
+        else if (small.size < Threshold)
+            return make_small([&] {
+                return small.emplace_back(std::forward<Args>(args)...);
+            });
+        else
+            return make_big([&] { return grow(std::forward<Args>(args)...); });
+    }
+
+    sequence push_back(T value) const
+    {
+        return emplace_back(std::move(value));
+    }
+
+    sequence assoc(std::size_t idx, T value) const
+    {
+        if (is_big)
+            return make_big([&] { return big.assoc(idx, std::move(value)); });
+        else
+            return make_small(
+                [&] { return small.assoc(idx, std::move(value)); });
+    }
+
+    template <typename Fn>
+    sequence update(std::size_t idx, Fn&& op) const
+    {
+        if (is_big)
+            return make_big(
+                [&] { return big.update(idx, std::forward<Fn>(op)); });
+        else
+            return make_small(
+                [&] { return small.update(idx, std::forward<Fn>(op)); });
+    }
+
+    sequence take(std::size_t sz) const
+    {
+        if (sz >= size())
+            return *this;
+        else if (!is_big)
+            return make_small([&] { return small.take(sz); });
+        else if (sz <= Threshold / 2)
+            return make_small([&] { return shrink(sz); });
+        else
+            return make_big([&] { return big.take(sz); });
+    }
+
+private:
+    void set_unowned()
+    {
+        auto& empty = small_t::empty();
+        is_big      = false;
+        is_unowned  = true;
+        new (&small) small_t{empty.ptr, empty.size, empty.capacity};
+    }
+
+    template <typename... Args>
+    big_t grow(Args&&... args) const
+    {
+        auto e      = owner_t{};
+        auto result = big_t{};
+        result.append_mut(e, small.data(), small.data() + small.size);
+        result.emplace_back_mut(e, std::forward<Args>(args)...);
+        // hand the nodes over to the result before `e` discards them
+        e = owner_t{};
+        return result;
+    }
+
+    small_t shrink(std::size_t sz) const
+    {
+        assert(is_big && sz <= big.size);
+        using iter_t = rbts::rbtree_iterator<T, MemoryPolicy, B, BL>;
+        auto first   = iter_t{big};
+        return small_t::from_range(first, first + sz);
+    }
+};
+
+} // namespace adaptive
+} // namespace detail
+} // namespace immer
@@ -12,6 +12,7 @@
 #include <immer/config.hpp>
 #include <immer/detail/arrays/node.hpp>
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <stdexcept>
@@ -20,6 +21,35 @@ namespace immer {
 namespace detail {
 namespace arrays {
 
+/*!
+ * Reports the differences between the elements in `[a, a + na)` and
+ * `[b, b + nb)` to `differ`, as `diff_trees()` does for the trees.
+ */
+template <typename EqualValue, typename T, typename Differ>
+void diff_ranges(const T* a,
+                 std::size_t na,
+                 const T* b,
+                 std::size_t nb,
+                 Differ&& differ)
+{
+    auto common = std::min(na, nb);
+    if (a != b) {
+        for (auto i = std::size_t{}; i < common;) {
+            while (i < common && EqualValue{}(a[i], b[i]))
+                ++i;
+            auto first = i;
+            while (i < common && !EqualValue{}(a[i], b[i]))
+                ++i;
+            if (first != i)
+                differ.changed(first, i);
+        }
+    }
+    if (na > common)
+        differ.removed(common, na);
+    else if (nb > common)
+        differ.added(common, nb);
+}
+
 template <typename T, typename MemoryPolicy>
 struct no_capacity
 {
@@ -32,10 +62,7 @@ struct no_capacity
 
     static const no_capacity& empty()
     {
-        static const no_capacity empty_{
-            node_t::make_n(0),
-            0,
-        };
+        static const no_capacity empty_{node_t::empty(), 0};
         return empty_;
     }
 
@@ -158,11 +185,24 @@ struct no_capacity
                 std::equal(data(), data() + size, other.data()));
     }
 
+    template <typename EqualValue, typename Differ>
+    void diff(const no_capacity& other, Differ&& differ) const
+    {
+        diff_ranges<EqualValue>(
+            data(), size, other.data(), other.size, differ);
+    }
+
     no_capacity push_back(T value) const
+    {
+        return emplace_back(std::move(value));
+    }
+
+    template <typename... Args>
+    no_capacity emplace_back(Args&&... args) const
     {
         auto p = node_t::copy_n(size + 1, ptr, size);
         IMMER_TRY {
-            new (p->data() + size) T{std::move(value)};
+            new (p->data() + size) T(std::forward<Args>(args)...);
             return {p, size + 1};
         }
         IMMER_CATCH (...) {
@@ -171,6 +211,27 @@ struct no_capacity
         }
     }
 
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<is_forward_iterator_v<Iter> &&
+                                   compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    no_capacity append(Iter first, Sent last) const
+    {
+        auto count = static_cast<size_t>(distance(first, last));
+        if (count == 0)
+            return *this;
+        auto p = node_t::copy_n(size + count, ptr, size);
+        IMMER_TRY {
+            detail::uninitialized_copy(first, last, p->data() + size);
+            return {p, size + count};
+        }
+        IMMER_CATCH (...) {
+            node_t::delete_n(p, size, size + count);
+            IMMER_RETHROW;
+        }
+    }
+
     no_capacity assoc(std::size_t idx, T value) const
     {
         auto p = node_t::copy_n(size, ptr, size);
@@ -184,6 +245,22 @@ struct no_capacity
         }
     }
 
+    template <typename Iter, typename Sent>
+    no_capacity assoc_many(Iter first, Sent last) const
+    {
+        using std::get;
+        auto p = node_t::copy_n(size, ptr, size);
+        IMMER_TRY {
+            for (; first != last; ++first)
+                p->data()[get<0>(*first)] = get<1>(*first);
+            return {p, size};
+        }
+        IMMER_CATCH (...) {
+            node_t::delete_n(p, size, size);
+            IMMER_RETHROW;
+        }
+    }
+
     template <typename Fn>
     no_capacity update(std::size_t idx, Fn&& op) const
     {
@@ -70,6 +70,24 @@ struct node
         return new (heap::allocate(sizeof_n(n))) node_t{};
     }
 
+    /*!
+     * Returns an empty node with room for one element, shared by all
+     * the arrays of this node type.  It lives in static storage, so
+     * making it never allocates, and it keeps a reference of its own,
+     * so it is never freed nor mutated in place.  Every call returns a
+     * new reference to it.
+     */
+    static node_t* empty()
+    {
+        static const auto empty_ = [] {
+            static std::aligned_storage_t<sizeof_n(1), alignof(node_t)>
+                storage;
+            return new (&storage) node_t{};
+        }();
+        empty_->refs().inc();
+        return empty_;
+    }
+
     static node_t* make_e(edit_t e, size_t n)
     {
         auto p     = make_n(n);
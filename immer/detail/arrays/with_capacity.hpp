@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <immer/array_growth.hpp>
 #include <immer/config.hpp>
 #include <immer/detail/arrays/no_capacity.hpp>
 
@@ -19,7 +20,9 @@ namespace immer {
 namespace detail {
 namespace arrays {
 
-template <typename T, typename MemoryPolicy>
+template <typename T,
+          typename MemoryPolicy,
+          typename Growth = default_array_growth>
 struct with_capacity
 {
     using no_capacity_t = no_capacity<T, MemoryPolicy>;
@@ -34,7 +37,7 @@ struct with_capacity
 
     static const with_capacity& empty()
     {
-        static const with_capacity empty_{node_t::make_n(1), 0, 1};
+        static const with_capacity empty_{node_t::empty(), 0, 1};
         return empty_;
     }
 
@@ -175,13 +178,16 @@ struct with_capacity
                 std::equal(data(), data() + size, other.data()));
     }
 
+    template <typename EqualValue, typename Differ>
+    void diff(const with_capacity& other, Differ&& differ) const
+    {
+        diff_ranges<EqualValue>(
+            data(), size, other.data(), other.size, differ);
+    }
+
     static size_t recommend_up(size_t sz, size_t cap)
     {
-        auto max = std::numeric_limits<size_t>::max();
-        return sz <= cap        ? cap
-               : cap >= max / 2 ? max
-                                /* otherwise */
-                                : std::max(2 * cap, sz);
+        return Growth::recommend(sz, cap);
     }
 
     static size_t recommend_down(size_t sz, size_t cap)
@@ -192,12 +198,26 @@ struct with_capacity
                               /* otherwise */ cap;
     }
 
+    void reserve_mut(edit_t e, size_t n)
+    {
+        if (n > capacity) {
+            auto p = node_t::copy_e(e, n, ptr, size);
+            *this  = {p, size, n};
+        }
+    }
+
     with_capacity push_back(T value) const
+    {
+        return emplace_back(std::move(value));
+    }
+
+    template <typename... Args>
+    with_capacity emplace_back(Args&&... args) const
     {
         auto cap = recommend_up(size + 1, capacity);
         auto p   = node_t::copy_n(cap, ptr, size);
         IMMER_TRY {
-            new (p->data() + size) T{std::move(value)};
+            new (p->data() + size) T(std::forward<Args>(args)...);
             return {p, size + 1, cap};
         }
         IMMER_CATCH (...) {
@@ -207,15 +227,39 @@ struct with_capacity
     }
 
     void push_back_mut(edit_t e, T value)
+    {
+        emplace_back_mut(e, std::move(value));
+    }
+
+    template <typename... Args>
+    void emplace_back_mut(edit_t e, Args&&... args)
     {
         if (ptr->can_mutate(e) && capacity > size) {
-            new (data() + size) T{std::move(value)};
+            new (data() + size) T(std::forward<Args>(args)...);
+            ++size;
+        } else if (detail::can_relocate<T> && ptr->refs().unique()) {
+            // nothing else refers to the full buffer, so its elements
+            // are moved with one `memcpy` and it is freed without
+            // destroying them
+            auto cap = recommend_up(size + 1, capacity);
+            auto p   = node_t::make_e(e, cap);
+            IMMER_TRY {
+                new (p->data() + size) T(std::forward<Args>(args)...);
+            }
+            IMMER_CATCH (...) {
+                node_t::heap::deallocate(node_t::sizeof_n(cap), p);
+                IMMER_RETHROW;
+            }
+            detail::uninitialized_relocate(data(), data() + size, p->data());
+            node_t::heap::deallocate(node_t::sizeof_n(capacity), ptr);
+            ptr      = p;
+            capacity = cap;
             ++size;
         } else {
             auto cap = recommend_up(size + 1, capacity);
             auto p   = node_t::copy_e(e, cap, ptr, size);
             IMMER_TRY {
-                new (p->data() + size) T{std::move(value)};
+                new (p->data() + size) T(std::forward<Args>(args)...);
                 *this = {p, size + 1, cap};
             }
             IMMER_CATCH (...) {
@@ -225,6 +269,51 @@ struct with_capacity
         }
     }
 
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<is_forward_iterator_v<Iter> &&
+                                   compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    with_capacity append(Iter first, Sent last) const
+    {
+        auto count = static_cast<size_t>(distance(first, last));
+        auto cap   = recommend_up(size + count, capacity);
+        auto p     = node_t::copy_n(cap, ptr, size);
+        IMMER_TRY {
+            detail::uninitialized_copy(first, last, p->data() + size);
+            return {p, size + count, cap};
+        }
+        IMMER_CATCH (...) {
+            node_t::delete_n(p, size, cap);
+            IMMER_RETHROW;
+        }
+    }
+
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<is_forward_iterator_v<Iter> &&
+                                   compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    void append_mut(edit_t e, Iter first, Sent last)
+    {
+        auto count = static_cast<size_t>(distance(first, last));
+        if (ptr->can_mutate(e) && capacity >= size + count) {
+            detail::uninitialized_copy(first, last, data() + size);
+            size += count;
+        } else {
+            auto cap = recommend_up(size + count, capacity);
+            auto p   = node_t::copy_e(e, cap, ptr, size);
+            IMMER_TRY {
+                detail::uninitialized_copy(first, last, p->data() + size);
+                *this = {p, size + count, cap};
+            }
+            IMMER_CATCH (...) {
+                node_t::delete_n(p, size, cap);
+                IMMER_RETHROW;
+            }
+        }
+    }
+
     with_capacity assoc(std::size_t idx, T value) const
     {
         auto p = node_t::copy_n(capacity, ptr, size);
@@ -238,6 +327,43 @@ struct with_capacity
         }
     }
 
+    template <typename Iter, typename Sent>
+    with_capacity assoc_many(Iter first, Sent last) const
+    {
+        using std::get;
+        auto p = node_t::copy_n(capacity, ptr, size);
+        IMMER_TRY {
+            for (; first != last; ++first)
+                p->data()[get<0>(*first)] = get<1>(*first);
+            return {p, size, capacity};
+        }
+        IMMER_CATCH (...) {
+            node_t::delete_n(p, size, capacity);
+            IMMER_RETHROW;
+        }
+    }
+
+    template <typename Iter, typename Sent>
+    void assoc_many_mut(edit_t e, Iter first, Sent last)
+    {
+        using std::get;
+        if (ptr->can_mutate(e)) {
+            for (; first != last; ++first)
+                data()[get<0>(*first)] = get<1>(*first);
+        } else {
+            auto p = node_t::copy_e(e, capacity, ptr, size);
+            IMMER_TRY {
+                for (; first != last; ++first)
+                    p->data()[get<0>(*first)] = get<1>(*first);
+                *this = {p, size, capacity};
+            }
+            IMMER_CATCH (...) {
+                node_t::delete_n(p, size, capacity);
+                IMMER_RETHROW;
+            }
+        }
+    }
+
     void assoc_mut(edit_t e, std::size_t idx, T value)
     {
         if (ptr->can_mutate(e)) {
@@ -302,7 +428,7 @@ struct with_capacity
     {
         assert(sz <= size);
         if (ptr->can_mutate(e)) {
-            detail::destroy_n(data() + size, size - sz);
+            detail::destroy_n(data() + sz, size - sz);
             size = sz;
         } else {
             auto cap = recommend_down(sz, capacity);
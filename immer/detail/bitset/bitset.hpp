@@ -0,0 +1,361 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/bitset/node.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <initializer_list>
+
+namespace immer {
+namespace detail {
+namespace bitset {
+
+/*!
+ * The operations on the tries of a bitset.  They take the nodes that
+ * they read by `const` pointer and return an owned reference to the
+ * node of the result, that is one of the ones they read whenever the
+ * result is equal to it, so that unchanged subtrees stay shared.
+ * An empty subtree is `nullptr`.
+ */
+template <typename MemoryPolicy>
+struct trie
+{
+    using node_t  = node<MemoryPolicy>;
+    using value_t = std::uint64_t;
+
+    static constexpr auto leaf_mask = (value_t{1} << leaf_bits) - 1;
+
+    static count_t index(value_t v, count_t level)
+    {
+        return static_cast<count_t>(v >> shift_of(level)) & (branches - 1);
+    }
+
+    static count_t position(bitmap_t map, bitmap_t bit)
+    {
+        return hamts::popcount(static_cast<bitmap_t>(map & (bit - 1)));
+    }
+
+    static const word_t& word_of(const node_t* leaf, value_t v)
+    {
+        return leaf->words()[(v & leaf_mask) >> word_bits];
+    }
+
+    static word_t bit_of(value_t v) { return word_t{1} << (v & 63); }
+
+    static bool contains(const node_t* n, value_t v)
+    {
+        for (auto level = top_level; n && level; --level) {
+            auto bit = bitmap_t{1} << index(v, level);
+            if (!(n->map() & bit))
+                return false;
+            n = n->children()[position(n->map(), bit)];
+        }
+        return n && (word_of(n, v) & bit_of(v));
+    }
+
+    // Whether the path to `v` is not shared and all its nodes exist,
+    // so that adding `delta` to the count of its leaf can be done in
+    // place, without allocating nor leaving an empty leaf behind.
+    static bool can_update_in_place(const node_t* n, value_t v, int delta)
+    {
+        for (auto level = top_level; level; --level) {
+            if (!n || !n->unique())
+                return false;
+            auto bit = bitmap_t{1} << index(v, level);
+            if (!(n->map() & bit))
+                return false;
+            n = n->children()[position(n->map(), bit)];
+        }
+        return n && n->unique() && (delta > 0 || n->count() > 1);
+    }
+
+    // Updates the path to `v`, which must be updatable in place, adding
+    // `delta` to the counts of its nodes and flipping the bit of `v`.
+    static void flip_in_place(node_t* n, value_t v, int delta)
+    {
+        for (auto level = top_level; level; --level) {
+            n->impl.d.count += delta;
+            auto bit = bitmap_t{1} << index(v, level);
+            n        = n->children()[position(n->map(), bit)];
+        }
+        n->impl.d.count += delta;
+        n->words()[(v & leaf_mask) >> word_bits] ^= bit_of(v);
+    }
+
+    // The trie `n` with `v`, which must not be in it.
+    static const node_t* insert(const node_t* n, count_t level, value_t v)
+    {
+        if (!level) {
+            word_t ws[leaf_words] = {};
+            if (n)
+                std::copy(n->words(), n->words() + leaf_words, ws);
+            ws[(v & leaf_mask) >> word_bits] |= bit_of(v);
+            return node_t::make_leaf(ws, (n ? n->count() : 0) + 1);
+        }
+        auto map = n ? n->map() : bitmap_t{};
+        auto bit = bitmap_t{1} << index(v, level);
+        auto pos = position(map, bit);
+        auto has = (map & bit) != 0;
+        auto c   = insert(has ? n->children()[pos] : nullptr, level - 1, v);
+        return replace_child(n, map | bit, pos, has, c, level);
+    }
+
+    // The trie `n` without `v`, which must be in it.
+    static const node_t* erase(const node_t* n, count_t level, value_t v)
+    {
+        if (n->count() == 1)
+            return nullptr;
+        if (!level) {
+            word_t ws[leaf_words];
+            std::copy(n->words(), n->words() + leaf_words, ws);
+            ws[(v & leaf_mask) >> word_bits] &= ~bit_of(v);
+            return node_t::make_leaf(ws, n->count() - 1);
+        }
+        auto bit = bitmap_t{1} << index(v, level);
+        auto pos = position(n->map(), bit);
+        auto c   = erase(n->children()[pos], level - 1, v);
+        if (c)
+            return replace_child(n, n->map(), pos, true, c, level);
+        return replace_child(n, n->map() & ~bit, pos, false, nullptr, level);
+    }
+
+    // Copies the inner node `n` with the child `c` at `pos`, either in
+    // place of the one that was there when `replace`, or inserted
+    // before it, or with the one at `pos` removed when `c` is null.
+    // Takes ownership of `c`.
+    static const node_t* replace_child(const node_t* n,
+                                       bitmap_t map,
+                                       count_t pos,
+                                       bool replace,
+                                       const node_t* c,
+                                       count_t level)
+    {
+        node_t* cs[branches];
+        auto old = n ? n->children_count() : count_t{};
+        auto k   = count_t{};
+        for (auto i = count_t{}; i < old; ++i) {
+            if (i == pos) {
+                if (c)
+                    cs[k++] = const_cast<node_t*>(c);
+                if (c && !replace)
+                    cs[k++] = n->children()[i];
+            } else
+                cs[k++] = n->children()[i];
+        }
+        if (c && pos == old)
+            cs[k++] = const_cast<node_t*>(c);
+        IMMER_TRY {
+            auto p = node_t::make_inner(map, cs, k);
+            for (auto i = count_t{}; i < k; ++i)
+                if (cs[i] != c)
+                    node_t::inc(cs[i]);
+            return p;
+        }
+        IMMER_CATCH (...) {
+            node_t::release(c, level - 1);
+            IMMER_RETHROW;
+        }
+    }
+
+    // The result of combining the tries `a` and `b` with `Op`, which
+    // tells what to do with the subtrees that are only in one of
+    // them, and how to combine the words of the leaves.
+    template <typename Op>
+    static const node_t*
+    combine(const node_t* a, const node_t* b, count_t level, Op op)
+    {
+        if (a == b)
+            return a ? op.same(a) : nullptr;
+        if (!b)
+            return op.only_a(a);
+        if (!a)
+            return op.only_b(b);
+        if (!level)
+            return combine_leaves(a, b, op);
+        node_t* cs[branches];
+        auto n   = count_t{};
+        auto map = bitmap_t{};
+        IMMER_TRY {
+            for (auto i = count_t{}; i < branches; ++i) {
+                auto bit = bitmap_t{1} << i;
+                auto ca  = a->map() & bit
+                               ? a->children()[position(a->map(), bit)]
+                               : nullptr;
+                auto cb  = b->map() & bit
+                               ? b->children()[position(b->map(), bit)]
+                               : nullptr;
+                if (!ca && !cb)
+                    continue;
+                if (auto c = combine(ca, cb, level - 1, op)) {
+                    cs[n++] = const_cast<node_t*>(c);
+                    map |= bit;
+                }
+            }
+        }
+        IMMER_CATCH (...) {
+            release_all(cs, n, level - 1);
+            IMMER_RETHROW;
+        }
+        if (!n)
+            return nullptr;
+        for (auto x : {a, b}) {
+            if (x->map() == map &&
+                std::equal(cs, cs + n, x->children())) {
+                release_all(cs, n, level - 1);
+                return node_t::inc(x);
+            }
+        }
+        IMMER_TRY {
+            return node_t::make_inner(map, cs, n);
+        }
+        IMMER_CATCH (...) {
+            release_all(cs, n, level - 1);
+            IMMER_RETHROW;
+        }
+    }
+
+    template <typename Op>
+    static const node_t*
+    combine_leaves(const node_t* a, const node_t* b, Op op)
+    {
+        word_t ws[leaf_words];
+        auto wa = a->words();
+        auto wb = b->words();
+        for (auto i = count_t{}; i < leaf_words; ++i)
+            ws[i] = op.word(wa[i], wb[i]);
+        if (std::equal(ws, ws + leaf_words, wa))
+            return node_t::inc(a);
+        if (std::equal(ws, ws + leaf_words, wb))
+            return node_t::inc(b);
+        auto count = size_t{};
+        for (auto i = count_t{}; i < leaf_words; ++i)
+            count += hamts::popcount(ws[i]);
+        return count ? node_t::make_leaf(ws, count) : nullptr;
+    }
+
+    static void release_all(node_t* const* cs, count_t n, count_t level)
+    {
+        for (auto i = count_t{}; i < n; ++i)
+            node_t::release(cs[i], level);
+    }
+
+    struct union_op
+    {
+        const node_t* same(const node_t* a) const { return node_t::inc(a); }
+        const node_t* only_a(const node_t* a) const { return node_t::inc(a); }
+        const node_t* only_b(const node_t* b) const { return node_t::inc(b); }
+        word_t word(word_t a, word_t b) const { return a | b; }
+    };
+
+    struct intersection_op
+    {
+        const node_t* same(const node_t* a) const { return node_t::inc(a); }
+        const node_t* only_a(const node_t*) const { return nullptr; }
+        const node_t* only_b(const node_t*) const { return nullptr; }
+        word_t word(word_t a, word_t b) const { return a & b; }
+    };
+
+    struct difference_op
+    {
+        const node_t* same(const node_t*) const { return nullptr; }
+        const node_t* only_a(const node_t* a) const { return node_t::inc(a); }
+        const node_t* only_b(const node_t*) const { return nullptr; }
+        word_t word(word_t a, word_t b) const { return a & ~b; }
+    };
+
+    static bool equals(const node_t* a, const node_t* b, count_t level)
+    {
+        if (a == b)
+            return true;
+        if (!a || !b || a->count() != b->count())
+            return false;
+        if (!level)
+            return std::equal(a->words(), a->words() + leaf_words, b->words());
+        if (a->map() != b->map())
+            return false;
+        auto n = a->children_count();
+        for (auto i = count_t{}; i < n; ++i)
+            if (!equals(a->children()[i], b->children()[i], level - 1))
+                return false;
+        return true;
+    }
+
+    // Finds the smallest value in `n` that is not less than `from`,
+    // which must be in the range of values of `n`.  Stores it in `out`
+    // and the leaf that it is in in `leaf`.
+    static bool lower_bound(const node_t* n,
+                            count_t level,
+                            value_t from,
+                            value_t& out,
+                            const node_t*& leaf)
+    {
+        if (!level) {
+            if (!leaf_lower_bound(n, from, out))
+                return false;
+            leaf = n;
+            return true;
+        }
+        auto shift = shift_of(level);
+        auto first = index(from, level);
+        auto base  = from >> (shift + bits) << (shift + bits);
+        for (auto i = first; i < branches; ++i) {
+            auto bit = bitmap_t{1} << i;
+            if (!(n->map() & bit))
+                continue;
+            auto c     = n->children()[position(n->map(), bit)];
+            auto cfrom = i == first ? from : base | (value_t{i} << shift);
+            if (lower_bound(c, level - 1, cfrom, out, leaf))
+                return true;
+        }
+        return false;
+    }
+
+    static bool leaf_lower_bound(const node_t* n, value_t from, value_t& out)
+    {
+        auto off = from & leaf_mask;
+        for (auto i = off >> word_bits; i < leaf_words; ++i) {
+            auto x = n->words()[i];
+            if (i == off >> word_bits)
+                x &= ~word_t{} << (off & 63);
+            if (x) {
+                out = (from & ~leaf_mask) + (i << word_bits) +
+                      node_t::lowest_bit(x);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <typename Fn>
+    static void for_each(const node_t* n, count_t level, value_t base, Fn& fn)
+    {
+        if (!level) {
+            for (auto i = count_t{}; i < leaf_words; ++i)
+                for (auto x = n->words()[i]; x; x &= x - 1)
+                    fn(base + (value_t{i} << word_bits) +
+                       node_t::lowest_bit(x));
+            return;
+        }
+        auto shift = shift_of(level);
+        auto k     = count_t{};
+        for (auto i = count_t{}; i < branches; ++i)
+            if (n->map() & (bitmap_t{1} << i))
+                for_each(n->children()[k++],
+                         level - 1,
+                         base | (value_t{i} << shift),
+                         fn);
+    }
+};
+
+} // namespace bitset
+} // namespace detail
+} // namespace immer
@@ -0,0 +1,168 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/combine_standard_layout.hpp>
+#include <immer/detail/hamts/bits.hpp>
+#include <immer/detail/util.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace immer {
+namespace detail {
+namespace bitset {
+
+using count_t  = std::uint32_t;
+using size_t   = std::size_t;
+using bitmap_t = std::uint32_t;
+using word_t   = std::uint64_t;
+
+// A leaf holds the bits of 512 consecutive values, and an inner node
+// up to 32 children.  Five inner levels cover the 32 bit values.
+constexpr count_t word_bits  = 6;
+constexpr count_t leaf_bits  = 9;
+constexpr count_t leaf_words = 1u << (leaf_bits - word_bits);
+constexpr count_t bits       = 5;
+constexpr count_t branches   = 1u << bits;
+constexpr count_t top_level  = 5;
+
+constexpr count_t shift_of(count_t level)
+{
+    return leaf_bits + (level - 1) * bits;
+}
+
+/*!
+ * Node of the radix trie of a bitset.  Every node knows how many
+ * values are under it.  The inner nodes only store the children that
+ * are not empty, in the order of the bits that are set in their
+ * `map`, like the nodes of the hash tries.
+ */
+template <typename MemoryPolicy>
+struct node
+{
+    using node_t = node;
+
+    using memory      = MemoryPolicy;
+    using heap_policy = typename memory::heap;
+    using heap        = typename heap_policy::type;
+    using refs_t      = typename memory::refcount;
+
+    struct inner_t
+    {
+        bitmap_t map;
+        node_t* children[branches];
+    };
+
+    struct leaf_t
+    {
+        word_t words[leaf_words];
+    };
+
+    union data_t
+    {
+        inner_t inner;
+        leaf_t leaf;
+    };
+
+    struct impl_data_t
+    {
+        size_t count;
+        data_t data;
+    };
+
+    using impl_t = combine_standard_layout_t<impl_data_t, refs_t>;
+
+    impl_t impl;
+
+    constexpr static std::size_t sizeof_leaf()
+    {
+        return immer_offsetof(impl_t, d.data.leaf) + sizeof(leaf_t);
+    }
+
+    constexpr static std::size_t sizeof_inner_n(count_t n)
+    {
+        return immer_offsetof(impl_t, d.data.inner.children) +
+               sizeof(node_t*) * n;
+    }
+
+    size_t count() const { return impl.d.count; }
+
+    word_t* words() { return impl.d.data.leaf.words; }
+    const word_t* words() const { return impl.d.data.leaf.words; }
+
+    bitmap_t map() const { return impl.d.data.inner.map; }
+    count_t children_count() const { return hamts::popcount(map()); }
+
+    node_t** children() { return impl.d.data.inner.children; }
+    node_t* const* children() const { return impl.d.data.inner.children; }
+
+    static refs_t& refs(const node_t* x)
+    {
+        return auto_const_cast(get<refs_t>(x->impl));
+    }
+
+    static const node_t* inc(const node_t* n)
+    {
+        if (n)
+            refs(n).inc();
+        return n;
+    }
+
+    bool unique() const { return refs(this).unique(); }
+
+    static node_t* make_leaf(const word_t* ws, size_t count)
+    {
+        auto p = new (heap::allocate(sizeof_leaf())) node_t;
+        std::copy(ws, ws + leaf_words, p->words());
+        p->impl.d.count = count;
+        return p;
+    }
+
+    // Makes an inner node with the `n` children in `cs`, and takes
+    // ownership of them only when it does not throw.
+    static node_t* make_inner(bitmap_t map, node_t* const* cs, count_t n)
+    {
+        auto p = new (heap::allocate(sizeof_inner_n(n))) node_t;
+        auto c = size_t{};
+        for (auto i = count_t{}; i < n; ++i) {
+            p->children()[i] = cs[i];
+            c += cs[i]->count();
+        }
+        p->impl.d.data.inner.map = map;
+        p->impl.d.count          = c;
+        return p;
+    }
+
+    static void release(const node_t* p, count_t level)
+    {
+        if (!p || !refs(p).dec())
+            return;
+        auto q = const_cast<node_t*>(p);
+        if (level) {
+            auto n = q->children_count();
+            for (auto i = count_t{}; i < n; ++i)
+                release(q->children()[i], level - 1);
+            heap::deallocate(sizeof_inner_n(n), q);
+        } else
+            heap::deallocate(sizeof_leaf(), q);
+    }
+
+    // The index of the lowest bit set in `x`, which must not be zero.
+    static count_t lowest_bit(word_t x)
+    {
+        return hamts::popcount((x & (~x + 1)) - 1);
+    }
+};
+
+} // namespace bitset
+} // namespace detail
+} // namespace immer
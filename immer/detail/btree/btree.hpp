@@ -0,0 +1,811 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/btree/node.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <type_traits>
+#include <utility>
+
+namespace immer {
+namespace detail {
+namespace btree {
+
+/*!
+ * Persistent B+-tree of values of type `T`, sorted by the keys that
+ * `KeyFn` extracts from them with the ordering `Less`.
+ *
+ * Every update takes an edit token and whether it comes from a
+ * transient.  Nodes are updated in place when they are not shared or,
+ * for a transient, when they belong to it, and copied otherwise.
+ * Insertion and removal split and merge the nodes on the way down, so
+ * that they never have to go back up.
+ */
+template <typename T,
+          typename KeyFn,
+          typename Less,
+          typename MemoryPolicy,
+          count_t B>
+struct btree
+{
+    using key_t =
+        std::decay_t<decltype(std::declval<KeyFn>()(std::declval<const T&>()))>;
+    using node_t = node<T, key_t, MemoryPolicy, B>;
+    using edit_t = typename node_t::edit_t;
+
+    static constexpr count_t min_count = node_t::min_count;
+
+    size_t size;
+    count_t height;
+    node_t* root;
+
+    static btree empty() { return {0, 0, nullptr}; }
+
+    // The edit token of the updates that do not come from a transient.
+    static edit_t noone() { return node_t::transience::noone; }
+
+    btree(size_t sz, count_t h, node_t* r)
+        : size{sz}
+        , height{h}
+        , root{r}
+    {}
+
+    btree(const btree& other)
+        : btree{other.size, other.height, other.root}
+    {
+        if (root)
+            root->inc();
+    }
+
+    btree(btree&& other)
+        : btree{0, 0, nullptr}
+    {
+        swap(*this, other);
+    }
+
+    btree& operator=(const btree& other)
+    {
+        auto next = other;
+        swap(*this, next);
+        return *this;
+    }
+
+    btree& operator=(btree&& other)
+    {
+        swap(*this, other);
+        return *this;
+    }
+
+    friend void swap(btree& x, btree& y)
+    {
+        using std::swap;
+        swap(x.size, y.size);
+        swap(x.height, y.height);
+        swap(x.root, y.root);
+    }
+
+    ~btree()
+    {
+        if (root)
+            node_t::release(root, height);
+    }
+
+    static decltype(auto) key(const T& v) { return KeyFn{}(v); }
+
+    template <typename A, typename C>
+    static bool less(const A& a, const C& b)
+    {
+        return Less{}(a, b);
+    }
+
+    // The child of `n` whose values may have the key `k`.
+    template <typename K>
+    static count_t child_index(const node_t* n, const K& k)
+    {
+        auto keys = n->keys();
+        return static_cast<count_t>(
+            std::upper_bound(keys,
+                             keys + n->key_count(),
+                             k,
+                             [](const K& a, const key_t& b) {
+                                 return less(a, b);
+                             }) -
+            keys);
+    }
+
+    // The position of the first value of the leaf `n` whose key is not
+    // less than `k`.
+    template <typename K>
+    static count_t value_index(const node_t* n, const K& k)
+    {
+        auto vs = n->values();
+        return static_cast<count_t>(
+            std::lower_bound(vs,
+                             vs + n->count(),
+                             k,
+                             [](const T& a, const K& b) {
+                                 return less(key(a), b);
+                             }) -
+            vs);
+    }
+
+    static const T& first_value(const node_t* n, count_t height)
+    {
+        for (; height; --height)
+            n = n->children()[0];
+        return n->values()[0];
+    }
+
+    template <typename K>
+    const T* find(const K& k) const
+    {
+        if (!root)
+            return nullptr;
+        auto n = root;
+        for (auto h = height; h; --h)
+            n = n->children()[child_index(n, k)];
+        auto i = value_index(n, k);
+        return i < n->count() && !less(k, key(n->values()[i]))
+                   ? n->values() + i
+                   : nullptr;
+    }
+
+    // The number of values for which `pred(v)` holds, which must hold
+    // for a prefix of the values ordered by key.
+    template <typename K, typename Pred>
+    size_t rank(const K& k, Pred pred) const
+    {
+        if (!root)
+            return 0;
+        auto n = root;
+        auto r = size_t{};
+        for (auto h = height; h; --h) {
+            auto i = child_index(n, k);
+            for (auto j = count_t{}; j < i; ++j)
+                r += n->sizes()[j];
+            n = n->children()[i];
+        }
+        auto vs = n->values();
+        return r + (std::partition_point(vs, vs + n->count(), pred) - vs);
+    }
+
+    template <typename K>
+    size_t lower_bound(const K& k) const
+    {
+        return rank(k, [&](const T& v) { return less(key(v), k); });
+    }
+
+    template <typename K>
+    size_t upper_bound(const K& k) const
+    {
+        return rank(k, [&](const T& v) { return !less(k, key(v)); });
+    }
+
+    // Returns the values of the leaf with the value at position `i`,
+    // which are the ones at positions `[first, last)`.
+    const T* array_for(size_t i, size_t& first, size_t& last) const
+    {
+        assert(i < size);
+        auto n    = root;
+        auto base = size_t{};
+        for (auto h = height; h; --h) {
+            auto j = count_t{};
+            while (i - base >= n->sizes()[j])
+                base += n->sizes()[j++];
+            n = n->children()[j];
+        }
+        first = base;
+        last  = base + n->count();
+        return n->values();
+    }
+
+    template <typename Fn>
+    static void each_leaf(const node_t* n, count_t height, Fn& fn)
+    {
+        if (!height)
+            fn(n->values(), n->values() + n->count());
+        else
+            for (auto i = count_t{}; i < n->count(); ++i)
+                each_leaf(n->children()[i], height - 1, fn);
+    }
+
+    template <typename Fn>
+    static bool each_leaf_p(const node_t* n, count_t height, Fn& fn)
+    {
+        if (!height)
+            return fn(n->values(), n->values() + n->count());
+        for (auto i = count_t{}; i < n->count(); ++i)
+            if (!each_leaf_p(n->children()[i], height - 1, fn))
+                return false;
+        return true;
+    }
+
+    template <typename Fn>
+    void for_each_chunk(Fn&& fn) const
+    {
+        if (root)
+            each_leaf(root, height, fn);
+    }
+
+    template <typename Fn>
+    bool for_each_chunk_p(Fn&& fn) const
+    {
+        return !root || each_leaf_p(root, height, fn);
+    }
+
+    template <typename Fn>
+    void for_each_chunk(size_t first, size_t last, Fn&& fn) const
+    {
+        while (first < last) {
+            auto base = size_t{};
+            auto end  = size_t{};
+            auto vs   = array_for(first, base, end);
+            auto stop = std::min(end, last);
+            fn(vs + (first - base), vs + (stop - base));
+            first = stop;
+        }
+    }
+
+    bool equals(const btree& other) const
+    {
+        if (size != other.size)
+            return false;
+        if (root == other.root)
+            return true;
+        auto i     = size_t{};
+        auto first = size_t{};
+        auto last  = size_t{};
+        auto vs    = (const T*) nullptr;
+        return for_each_chunk_p([&](const T* f, const T* l) {
+            for (; f != l; ++f, ++i) {
+                if (i == last)
+                    vs = other.array_for(i, first, last);
+                if (!(*f == vs[i - first]))
+                    return false;
+            }
+            return true;
+        });
+    }
+
+    template <typename U>
+    static void insert_at(U* p, count_t n, count_t i, U&& v)
+    {
+        relocate(p + i, n - i, p + i + 1);
+        new (p + i) U(std::move(v));
+    }
+
+    template <typename U>
+    static void erase_at(U* p, count_t n, count_t i)
+    {
+        detail::destroy_at(p + i);
+        relocate(p + i + 1, n - i - 1, p + i);
+    }
+
+    static node_t* owned(node_t* n, count_t height, edit_t e, bool tr)
+    {
+        if (n->can_mutate(e, tr))
+            return n;
+        auto r = node_t::copy(n, height, e, tr);
+        node_t::release(n, height);
+        return r;
+    }
+
+    // Adds the child `c` at position `pos` of the inner node `n`, which
+    // must not be full, with the key `sep` between it and its left
+    // sibling, or its right one when `pos == 0`.
+    static void
+    insert_child(node_t* n, count_t pos, node_t* c, size_t sz, key_t&& sep)
+    {
+        assert(n->count() && n->count() < B);
+        insert_at(n->keys(), n->key_count(), pos ? pos - 1 : 0, std::move(sep));
+        std::copy_backward(n->children() + pos,
+                           n->children() + n->count(),
+                           n->children() + n->count() + 1);
+        std::copy_backward(n->sizes() + pos,
+                           n->sizes() + n->count(),
+                           n->sizes() + n->count() + 1);
+        n->children()[pos] = c;
+        n->sizes()[pos]    = sz;
+        ++n->impl.d.count;
+    }
+
+    static void remove_child(node_t* n, count_t pos)
+    {
+        erase_at(n->keys(), n->key_count(), pos ? pos - 1 : 0);
+        std::copy(n->children() + pos + 1,
+                  n->children() + n->count(),
+                  n->children() + pos);
+        std::copy(
+            n->sizes() + pos + 1, n->sizes() + n->count(), n->sizes() + pos);
+        --n->impl.d.count;
+    }
+
+    // Splits the full child `i` of the inner node `n` of height `h`,
+    // which must be owned and not full, moving its upper half to a new
+    // node after it.
+    static void split_child(node_t* n, count_t i, count_t h, edit_t e, bool tr)
+    {
+        auto c   = n->children()[i];
+        auto ch  = h - 1;
+        auto cnt = c->count();
+        auto mid = cnt / 2;
+        auto r   = ch ? node_t::make_inner(e, tr) : node_t::make_leaf(e, tr);
+        if (!ch) {
+            IMMER_TRY {
+                insert_child(n, i + 1, r, 0, key_t(key(c->values()[mid])));
+            }
+            IMMER_CATCH (...) {
+                node_t::delete_shell(r, ch);
+                IMMER_RETHROW;
+            }
+            relocate(c->values() + mid, cnt - mid, r->values());
+        } else {
+            auto sep = c->keys() + mid - 1;
+            insert_child(n, i + 1, r, 0, std::move(*sep));
+            detail::destroy_at(sep);
+            relocate(sep + 1, cnt - mid - 1, r->keys());
+            std::copy(c->children() + mid,
+                      c->children() + cnt,
+                      r->children());
+            std::copy(c->sizes() + mid, c->sizes() + cnt, r->sizes());
+        }
+        c->impl.d.count = mid;
+        r->impl.d.count = cnt - mid;
+        auto rsize      = r->size(ch);
+        n->sizes()[i] -= rsize;
+        n->sizes()[i + 1] = rsize;
+    }
+
+    // Moves the first `k` values or children of the child `j + 1` of
+    // `n` to the end of the child `j`, which both must be owned.
+    static void move_left(node_t* n, count_t j, count_t k, count_t ch)
+    {
+        auto a  = n->children()[j];
+        auto b  = n->children()[j + 1];
+        auto ac = a->count();
+        auto bc = b->count();
+        auto moved = size_t{};
+        if (!ch) {
+            if (k < bc) {
+                auto sep = key_t(key(b->values()[k]));
+                n->keys()[j] = std::move(sep);
+            }
+            relocate(b->values(), k, a->values() + ac);
+            relocate(b->values() + k, bc - k, b->values());
+            moved = k;
+        } else {
+            new (a->keys() + ac - 1) key_t(std::move(n->keys()[j]));
+            relocate(b->keys(), k - 1, a->keys() + ac);
+            if (k < bc) {
+                n->keys()[j] = std::move(b->keys()[k - 1]);
+                detail::destroy_at(b->keys() + k - 1);
+                relocate(b->keys() + k, bc - k - 1, b->keys());
+            }
+            for (auto i = count_t{}; i < k; ++i) {
+                a->children()[ac + i] = b->children()[i];
+                a->sizes()[ac + i]    = b->sizes()[i];
+                moved += b->sizes()[i];
+            }
+            std::copy(b->children() + k, b->children() + bc, b->children());
+            std::copy(b->sizes() + k, b->sizes() + bc, b->sizes());
+        }
+        a->impl.d.count = ac + k;
+        b->impl.d.count = bc - k;
+        n->sizes()[j] += moved;
+        n->sizes()[j + 1] -= moved;
+    }
+
+    // Moves the last `k` values or children of the child `j` of `n` to
+    // the beginning of the child `j + 1`, which both must be owned.
+    static void move_right(node_t* n, count_t j, count_t k, count_t ch)
+    {
+        auto a  = n->children()[j];
+        auto b  = n->children()[j + 1];
+        auto ac = a->count();
+        auto bc = b->count();
+        auto moved = size_t{};
+        if (!ch) {
+            auto sep = key_t(key(a->values()[ac - k]));
+            relocate(b->values(), bc, b->values() + k);
+            relocate(a->values() + ac - k, k, b->values());
+            n->keys()[j] = std::move(sep);
+            moved        = k;
+        } else {
+            relocate(b->keys(), bc - 1, b->keys() + k);
+            new (b->keys() + k - 1) key_t(std::move(n->keys()[j]));
+            relocate(a->keys() + ac - k, k - 1, b->keys());
+            n->keys()[j] = std::move(a->keys()[ac - k - 1]);
+            detail::destroy_at(a->keys() + ac - k - 1);
+            std::copy_backward(
+                b->children(), b->children() + bc, b->children() + bc + k);
+            std::copy_backward(
+                b->sizes(), b->sizes() + bc, b->sizes() + bc + k);
+            for (auto i = count_t{}; i < k; ++i) {
+                b->children()[i] = a->children()[ac - k + i];
+                b->sizes()[i]    = a->sizes()[ac - k + i];
+                moved += b->sizes()[i];
+            }
+        }
+        a->impl.d.count = ac - k;
+        b->impl.d.count = bc + k;
+        n->sizes()[j] -= moved;
+        n->sizes()[j + 1] += moved;
+    }
+
+    // Merges the child `j + 1` of `n` into the child `j`, which both
+    // must be owned and fit in a node.
+    static void merge(node_t* n, count_t j, count_t ch)
+    {
+        auto b = n->children()[j + 1];
+        assert(n->children()[j]->count() + b->count() <= B);
+        move_left(n, j, b->count(), ch);
+        node_t::delete_shell(b, ch);
+        remove_child(n, j + 1);
+    }
+
+    // Restores the minimum size of the children `j` and `j + 1` of `n`,
+    // when one of them does not reach it.
+    static void balance(node_t* n, count_t j, count_t h, edit_t e, bool tr)
+    {
+        auto ch = h - 1;
+        auto cn = n->children();
+        auto ac = cn[j]->count();
+        auto bc = cn[j + 1]->count();
+        if (ac >= min_count && bc >= min_count)
+            return;
+        cn[j]     = owned(cn[j], ch, e, tr);
+        cn[j + 1] = owned(cn[j + 1], ch, e, tr);
+        if (ac + bc <= B)
+            merge(n, j, ch);
+        else if (ac < min_count)
+            move_left(n, j, (ac + bc) / 2 - ac, ch);
+        else
+            move_right(n, j, (ac + bc) / 2 - bc, ch);
+    }
+
+    // Makes sure that the child `i` of `n`, which has the minimum size,
+    // has more by taking values or children from a sibling, and returns
+    // the index of the child with its former values afterwards.
+    static count_t refill(node_t* n, count_t i, count_t h, edit_t e, bool tr)
+    {
+        auto ch = h - 1;
+        auto cn = n->children();
+        if (i > 0 && cn[i - 1]->count() > min_count) {
+            cn[i - 1] = owned(cn[i - 1], ch, e, tr);
+            move_right(n, i - 1, 1, ch);
+            return i;
+        } else if (i + 1 < n->count() && cn[i + 1]->count() > min_count) {
+            cn[i + 1] = owned(cn[i + 1], ch, e, tr);
+            move_left(n, i, 1, ch);
+            return i;
+        } else if (i + 1 < n->count()) {
+            cn[i + 1] = owned(cn[i + 1], ch, e, tr);
+            merge(n, i, ch);
+            return i;
+        } else {
+            cn[i - 1] = owned(cn[i - 1], ch, e, tr);
+            merge(n, i - 1, ch);
+            return i - 1;
+        }
+    }
+
+    // Adds a root over the current one, that may be split afterwards.
+    void grow(edit_t e, bool tr)
+    {
+        auto r             = node_t::make_inner(e, tr);
+        r->children()[0]   = root;
+        r->sizes()[0]      = size;
+        r->impl.d.count    = 1;
+        root               = r;
+        ++height;
+    }
+
+    // Removes the root when it only has one child.
+    void shrink()
+    {
+        while (height && root->count() == 1) {
+            auto c               = root->children()[0];
+            root->impl.d.count   = 0;
+            node_t::delete_shell(root, height);
+            root = c;
+            --height;
+        }
+    }
+
+    // Makes sure that the root is owned and not full.
+    void prepare_root(edit_t e, bool tr)
+    {
+        root = owned(root, height, e, tr);
+        if (root->count() == B) {
+            grow(e, tr);
+            IMMER_TRY {
+                split_child(root, 0, height, e, tr);
+            }
+            IMMER_CATCH (...) {
+                shrink();
+                IMMER_RETHROW;
+            }
+        }
+    }
+
+    template <typename K, typename Fn>
+    static bool upsert(
+        node_t* n, count_t h, const K& k, Fn& fn, edit_t e, bool tr)
+    {
+        if (!h) {
+            auto vs = n->values();
+            auto i  = value_index(n, k);
+            if (i < n->count() && !less(k, key(vs[i]))) {
+                T v   = fn(static_cast<const T*>(vs + i));
+                vs[i]  = std::move(v);
+                return false;
+            } else {
+                T v = fn(static_cast<const T*>(nullptr));
+                insert_at(vs, n->count(), i, std::move(v));
+                ++n->impl.d.count;
+                return true;
+            }
+        }
+        auto i = child_index(n, k);
+        auto c = n->children()[i] = owned(n->children()[i], h - 1, e, tr);
+        if (c->count() == B) {
+            split_child(n, i, h, e, tr);
+            if (!less(k, n->keys()[i]))
+                ++i;
+            c = n->children()[i];
+        }
+        auto added = upsert(c, h - 1, k, fn, e, tr);
+        n->sizes()[i] += added;
+        return added;
+    }
+
+    /*!
+     * Replaces the value with key `k` by `fn(p)`, where `p` points to
+     * it, or adds `fn(nullptr)` when there is none.
+     */
+    template <typename K, typename Fn>
+    void upsert_mut(edit_t e, bool tr, const K& k, Fn&& fn)
+    {
+        if (!root) {
+            root = node_t::make_leaf(e, tr, fn(static_cast<const T*>(nullptr)));
+            size = 1;
+            return;
+        }
+        prepare_root(e, tr);
+        size += upsert(root, height, k, fn, e, tr);
+    }
+
+    void add_mut(edit_t e, bool tr, T v)
+    {
+        upsert_mut(e, tr, key(v), [&](const T*) { return std::move(v); });
+    }
+
+    template <typename K>
+    static void sub(node_t* n, count_t h, const K& k, edit_t e, bool tr)
+    {
+        if (!h) {
+            erase_at(n->values(), n->count(), value_index(n, k));
+            --n->impl.d.count;
+            return;
+        }
+        auto i = child_index(n, k);
+        auto c = n->children()[i] = owned(n->children()[i], h - 1, e, tr);
+        if (c->count() <= min_count)
+            i = refill(n, i, h, e, tr);
+        sub(n->children()[i], h - 1, k, e, tr);
+        --n->sizes()[i];
+    }
+
+    template <typename K>
+    void sub_mut(edit_t e, bool tr, const K& k)
+    {
+        if (!find(k))
+            return;
+        root = owned(root, height, e, tr);
+        sub(root, height, k, e, tr);
+        --size;
+        if (!root->count()) {
+            node_t::delete_shell(root, height);
+            root = nullptr;
+        } else {
+            shrink();
+        }
+    }
+
+    /*!
+     * Adds the values of `other`, that must all be greater than the
+     * ones in this tree, and that is not taller.  `sep` is the key of
+     * the first value of `other`.
+     */
+    void append_mut(edit_t e, bool tr, btree other, key_t sep)
+    {
+        auto bh = other.height;
+        auto bs = other.size;
+        auto b  = std::exchange(other.root, nullptr);
+        assert(height >= bh);
+        if (height == bh) {
+            IMMER_TRY {
+                grow(e, tr);
+            }
+            IMMER_CATCH (...) {
+                node_t::release(b, bh);
+                IMMER_RETHROW;
+            }
+        } else {
+            prepare_root(e, tr);
+        }
+        auto n = root;
+        for (auto h = height; h > bh + 1; --h) {
+            auto last = n->count() - 1;
+            auto c    = n->children()[last] =
+                owned(n->children()[last], h - 1, e, tr);
+            if (c->count() == B) {
+                split_child(n, last, h, e, tr);
+                c = n->children()[++last];
+            }
+            n->sizes()[last] += bs;
+            n = c;
+        }
+        insert_child(n, n->count(), b, bs, std::move(sep));
+        size += bs;
+        balance(n, n->count() - 2, bh + 1, e, tr);
+        shrink();
+    }
+
+    /*!
+     * Adds the values of `other`, that must all be smaller than the
+     * ones in this tree, and that is not taller.  `sep` is the key of
+     * the first value of this tree.
+     */
+    void prepend_mut(edit_t e, bool tr, btree other, key_t sep)
+    {
+        auto bh = other.height;
+        auto bs = other.size;
+        auto b  = std::exchange(other.root, nullptr);
+        assert(height >= bh);
+        if (height == bh) {
+            IMMER_TRY {
+                grow(e, tr);
+            }
+            IMMER_CATCH (...) {
+                node_t::release(b, bh);
+                IMMER_RETHROW;
+            }
+        } else {
+            prepare_root(e, tr);
+        }
+        auto n = root;
+        for (auto h = height; h > bh + 1; --h) {
+            auto c = n->children()[0] = owned(n->children()[0], h - 1, e, tr);
+            if (c->count() == B) {
+                split_child(n, 0, h, e, tr);
+                c = n->children()[0];
+            }
+            n->sizes()[0] += bs;
+            n = c;
+        }
+        insert_child(n, 0, b, bs, std::move(sep));
+        size += bs;
+        balance(n, 0, bh + 1, e, tr);
+        shrink();
+    }
+
+    /*!
+     * Returns a tree with the values of `l` followed by the ones of
+     * `r`, whose keys must all be greater than the ones in `l`.  Its
+     * complexity is @f$ O(log(n)) @f$.
+     */
+    static btree join(btree l, btree r, edit_t e, bool tr)
+    {
+        if (!l.root)
+            return r;
+        if (!r.root)
+            return l;
+        auto sep = key_t(key(first_value(r.root, r.height)));
+        if (l.height >= r.height) {
+            l.append_mut(e, tr, std::move(r), std::move(sep));
+            return l;
+        } else {
+            r.prepend_mut(e, tr, std::move(l), std::move(sep));
+            return r;
+        }
+    }
+
+    // The tree with the values or children of `n` in `[first, last)`.
+    static btree part(const node_t* n,
+                      count_t h,
+                      count_t first,
+                      count_t last,
+                      edit_t e,
+                      bool tr)
+    {
+        if (first == last)
+            return empty();
+        else if (first == 0 && last == n->count())
+            return {n->size(h), h, const_cast<node_t*>(n)->inc()};
+        else if (h && last - first == 1)
+            return {n->sizes()[first], h - 1, n->children()[first]->inc()};
+        auto p = node_t::copy_range(n, h, first, last, e, tr);
+        return {p->size(h), h, p};
+    }
+
+    template <typename K>
+    static std::pair<btree, btree>
+    split_node(const node_t* n, count_t h, const K& k, edit_t e, bool tr)
+    {
+        if (!h) {
+            auto i = value_index(n, k);
+            return {part(n, h, 0, i, e, tr),
+                    part(n, h, i, n->count(), e, tr)};
+        }
+        auto i   = child_index(n, k);
+        auto sub = split_node(n->children()[i], h - 1, k, e, tr);
+        auto l   = join(part(n, h, 0, i, e, tr), std::move(sub.first), e, tr);
+        auto r   = join(std::move(sub.second),
+                      part(n, h, i + 1, n->count(), e, tr),
+                      e,
+                      tr);
+        return {std::move(l), std::move(r)};
+    }
+
+    /*!
+     * Returns the trees with the values whose keys are less than `k`,
+     * and with the rest of them.  Its complexity is @f$ O(log(n)) @f$.
+     */
+    template <typename K>
+    std::pair<btree, btree> split(edit_t e, bool tr, const K& k) const
+    {
+        if (!root)
+            return {empty(), empty()};
+        return split_node(root, height, k, e, tr);
+    }
+
+#if IMMER_DEBUG_DEEP_CHECK
+    bool check_tree() const
+    {
+        assert(!root == !size);
+        assert(!root || check_node(root, height, true) == size);
+        return true;
+    }
+
+    static size_t check_node(const node_t* n, count_t h, bool is_root)
+    {
+        assert(n->count() <= B);
+        assert(is_root || n->count() >= min_count);
+        assert(!is_root || !h || n->count() >= 2);
+        if (!h) {
+            for (auto i = count_t{1}; i < n->count(); ++i)
+                assert(less(key(n->values()[i - 1]), key(n->values()[i])));
+            return n->count();
+        }
+        auto r = size_t{};
+        for (auto i = count_t{}; i < n->count(); ++i) {
+            auto c = n->children()[i];
+            assert(check_node(c, h - 1, false) == n->sizes()[i]);
+            if (i > 0) {
+                auto l = n->children()[i - 1];
+                for (auto lh = h - 1; lh; --lh)
+                    l = l->children()[l->count() - 1];
+                assert(less(key(l->values()[l->count() - 1]),
+                            n->keys()[i - 1]));
+                assert(!less(key(first_value(c, h - 1)), n->keys()[i - 1]));
+            }
+            r += n->sizes()[i];
+        }
+        return r;
+    }
+#endif
+};
+
+} // namespace btree
+} // namespace detail
+} // namespace immer
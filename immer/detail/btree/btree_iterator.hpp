@@ -0,0 +1,97 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/detail/btree/btree.hpp>
+#include <immer/detail/iterator_facade.hpp>
+
+namespace immer {
+namespace detail {
+namespace btree {
+
+template <typename T,
+          typename KeyFn,
+          typename Less,
+          typename MemoryPolicy,
+          count_t B>
+struct btree_iterator
+    : iterator_facade<btree_iterator<T, KeyFn, Less, MemoryPolicy, B>,
+                      std::random_access_iterator_tag,
+                      T,
+                      const T&,
+                      std::ptrdiff_t,
+                      const T*>
+{
+    using tree_t = btree<T, KeyFn, Less, MemoryPolicy, B>;
+
+    struct end_t
+    {};
+
+    btree_iterator() = default;
+
+    btree_iterator(const tree_t& v, size_t i = 0)
+        : v_{&v}
+        , i_{i}
+    {}
+
+    btree_iterator(const tree_t& v, end_t)
+        : v_{&v}
+        , i_{v.size}
+    {}
+
+    const tree_t& impl() const { return *v_; }
+    size_t index() const { return i_; }
+
+private:
+    friend iterator_core_access;
+
+    const tree_t* v_;
+    size_t i_;
+    mutable size_t first_   = 0;
+    mutable size_t last_    = 0;
+    mutable const T* curr_ = nullptr;
+
+    void increment()
+    {
+        assert(i_ < v_->size);
+        ++i_;
+    }
+
+    void decrement()
+    {
+        assert(i_ > 0);
+        --i_;
+    }
+
+    void advance(std::ptrdiff_t n)
+    {
+        assert(n <= 0 || i_ + static_cast<size_t>(n) <= v_->size);
+        assert(n >= 0 || static_cast<size_t>(-n) <= i_);
+        i_ += n;
+    }
+
+    bool equal(const btree_iterator& other) const { return i_ == other.i_; }
+
+    std::ptrdiff_t distance_to(const btree_iterator& other) const
+    {
+        return other.i_ > i_ ? static_cast<std::ptrdiff_t>(other.i_ - i_)
+                             : -static_cast<std::ptrdiff_t>(i_ - other.i_);
+    }
+
+    const T& dereference() const
+    {
+        if (i_ < first_ || i_ >= last_)
+            curr_ = v_->array_for(i_, first_, last_);
+        return curr_[i_ - first_];
+    }
+};
+
+} // namespace btree
+} // namespace detail
+} // namespace immer
@@ -0,0 +1,278 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/combine_standard_layout.hpp>
+#include <immer/detail/util.hpp>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace immer {
+namespace detail {
+namespace btree {
+
+using count_t = std::uint32_t;
+using size_t  = std::size_t;
+
+/*!
+ * Moves the `n` objects at `src` to the uninitialized memory at
+ * `dst`, destroying them at the source.  The ranges may overlap, as
+ * long as `dst` is before `src` or after `src + n`.
+ */
+template <typename T>
+void relocate(T* src, count_t n, T* dst)
+{
+    if (dst < src) {
+        for (auto i = count_t{}; i < n; ++i) {
+            new (dst + i) T(std::move(src[i]));
+            detail::destroy_at(src + i);
+        }
+    } else {
+        for (auto i = n; i-- > 0;) {
+            new (dst + i) T(std::move(src[i]));
+            detail::destroy_at(src + i);
+        }
+    }
+}
+
+/*!
+ * Node of a B+-tree.  Leaves store up to `B` values sorted by key.
+ * Inner nodes store up to `B` children, the number of values under
+ * each of them, and a key between every pair of consecutive children
+ * that is greater than all the keys on its left and not greater than
+ * any on its right.  The height of the node is not stored, it is known
+ * by the tree while it is traversed.
+ */
+template <typename T, typename Key, typename MemoryPolicy, count_t B>
+struct node
+{
+    static_assert(B >= 4, "nodes must branch at least four ways");
+
+    using node_t = node;
+
+    using memory      = MemoryPolicy;
+    using heap_policy = typename memory::heap;
+    using heap        = typename heap_policy::type;
+    using transience  = typename memory::transience_t;
+    using refs_t      = typename memory::refcount;
+    using ownee_t     = typename transience::ownee;
+    using edit_t      = typename transience::edit;
+    using value_t     = T;
+    using key_t       = Key;
+
+    // all the nodes but the root hold at least this many elements
+    static constexpr count_t min_count = B / 2;
+
+    struct leaf_t
+    {
+        aligned_storage_for<T> buffer[B];
+    };
+
+    struct inner_t
+    {
+        node_t* children[B];
+        size_t sizes[B];
+        aligned_storage_for<Key> keys[B - 1];
+    };
+
+    union data_t
+    {
+        leaf_t leaf;
+        inner_t inner;
+    };
+
+    struct impl_data_t
+    {
+        count_t count;
+        data_t data;
+    };
+
+    using impl_t = combine_standard_layout_t<impl_data_t, refs_t, ownee_t>;
+
+    impl_t impl;
+
+    constexpr static std::size_t sizeof_leaf()
+    {
+        return immer_offsetof(impl_t, d.data) + sizeof(leaf_t);
+    }
+
+    constexpr static std::size_t sizeof_inner()
+    {
+        return immer_offsetof(impl_t, d.data) + sizeof(inner_t);
+    }
+
+    count_t count() const { return impl.d.count; }
+
+    T* values() { return (T*) &impl.d.data.leaf.buffer; }
+    const T* values() const { return (const T*) &impl.d.data.leaf.buffer; }
+
+    node_t** children() { return impl.d.data.inner.children; }
+    node_t* const* children() const { return impl.d.data.inner.children; }
+
+    size_t* sizes() { return impl.d.data.inner.sizes; }
+    const size_t* sizes() const { return impl.d.data.inner.sizes; }
+
+    Key* keys() { return (Key*) &impl.d.data.inner.keys; }
+    const Key* keys() const { return (const Key*) &impl.d.data.inner.keys; }
+
+    // the number of keys of an inner node
+    count_t key_count() const { return count() ? count() - 1 : 0; }
+
+    static refs_t& refs(const node_t* x)
+    {
+        return auto_const_cast(get<refs_t>(x->impl));
+    }
+    static const ownee_t& ownee(const node_t* x)
+    {
+        return get<ownee_t>(x->impl);
+    }
+    static ownee_t& ownee(node_t* x) { return get<ownee_t>(x->impl); }
+
+    // Whether the node can be updated in place, because it is not
+    // shared or, while a transient is being edited, it belongs to it.
+    bool can_mutate(edit_t e, bool transient) const
+    {
+        return refs(this).unique() || (transient && ownee(this).can_mutate(e));
+    }
+
+    node_t* inc()
+    {
+        refs(this).inc();
+        return this;
+    }
+
+    bool dec() const { return refs(this).dec(); }
+
+    size_t size(count_t height) const
+    {
+        if (!height)
+            return count();
+        auto r = size_t{};
+        for (auto i = count_t{}; i < count(); ++i)
+            r += sizes()[i];
+        return r;
+    }
+
+    static node_t* make_leaf(edit_t e, bool transient)
+    {
+        auto p = new (heap::allocate(sizeof_leaf())) node_t;
+        p->impl.d.count = 0;
+        if (transient)
+            ownee(p) = e;
+        return p;
+    }
+
+    static node_t* make_inner(edit_t e, bool transient)
+    {
+        auto p = new (heap::allocate(sizeof_inner())) node_t;
+        p->impl.d.count = 0;
+        if (transient)
+            ownee(p) = e;
+        return p;
+    }
+
+    static node_t* make_leaf(edit_t e, bool transient, T value)
+    {
+        auto p = make_leaf(e, transient);
+        IMMER_TRY {
+            new (p->values()) T(std::move(value));
+        }
+        IMMER_CATCH (...) {
+            heap::deallocate(sizeof_leaf(), p);
+            IMMER_RETHROW;
+        }
+        p->impl.d.count = 1;
+        return p;
+    }
+
+    // Makes a node with the values or the children of `src` in the
+    // range `[first, last)`.
+    static node_t* copy_range(const node_t* src,
+                              count_t height,
+                              count_t first,
+                              count_t last,
+                              edit_t e,
+                              bool transient)
+    {
+        assert(first < last && last <= src->count());
+        if (!height) {
+            auto p = make_leaf(e, transient);
+            IMMER_TRY {
+                detail::uninitialized_copy(src->values() + first,
+                                           src->values() + last,
+                                           p->values());
+            }
+            IMMER_CATCH (...) {
+                heap::deallocate(sizeof_leaf(), p);
+                IMMER_RETHROW;
+            }
+            p->impl.d.count = last - first;
+            return p;
+        } else {
+            auto p = make_inner(e, transient);
+            IMMER_TRY {
+                detail::uninitialized_copy(src->keys() + first,
+                                           src->keys() + last - 1,
+                                           p->keys());
+            }
+            IMMER_CATCH (...) {
+                heap::deallocate(sizeof_inner(), p);
+                IMMER_RETHROW;
+            }
+            for (auto i = first; i < last; ++i) {
+                p->children()[i - first] = src->children()[i]->inc();
+                p->sizes()[i - first]    = src->sizes()[i];
+            }
+            p->impl.d.count = last - first;
+            return p;
+        }
+    }
+
+    static node_t*
+    copy(const node_t* src, count_t height, edit_t e, bool transient)
+    {
+        return copy_range(src, height, 0, src->count(), e, transient);
+    }
+
+    // Frees the node, which must not hold values nor keys anymore.
+    static void delete_shell(node_t* p, count_t height)
+    {
+        assert(!p->count());
+        heap::deallocate(height ? sizeof_inner() : sizeof_leaf(), p);
+    }
+
+    static void delete_deep(node_t* p, count_t height)
+    {
+        if (!height) {
+            detail::destroy_n(p->values(), p->count());
+            heap::deallocate(sizeof_leaf(), p);
+        } else {
+            for (auto i = count_t{}; i < p->count(); ++i) {
+                auto c = p->children()[i];
+                if (c->dec())
+                    delete_deep(c, height - 1);
+            }
+            detail::destroy_n(p->keys(), p->key_count());
+            heap::deallocate(sizeof_inner(), p);
+        }
+    }
+
+    static void release(node_t* p, count_t height)
+    {
+        if (p->dec())
+            delete_deep(p, height);
+    }
+};
+
+} // namespace btree
+} // namespace detail
+} // namespace immer
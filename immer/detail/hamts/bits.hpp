@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include <immer/config.hpp>
+
 #include <cstddef>
 #include <cstdint>
 
@@ -62,8 +64,6 @@ constexpr T max_depth = (sizeof(hash_t) * 8u + B - 1u) / B;
 template <bits_t B, typename T = count_t>
 constexpr T max_shift = max_depth<B, count_t>* B;
 
-#define IMMER_HAS_BUILTIN_POPCOUNT 1
-
 inline auto popcount_fallback(std::uint32_t x)
 {
     // More alternatives:
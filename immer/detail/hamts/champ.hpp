@@ -10,8 +10,13 @@
 
 #include <immer/config.hpp>
 #include <immer/detail/hamts/node.hpp>
+#include <immer/detail/reduce.hpp>
+#include <immer/executor.hpp>
 
 #include <algorithm>
+#include <deque>
+#include <utility>
+#include <vector>
 
 namespace immer {
 namespace detail {
@@ -137,11 +142,7 @@ struct champ
     node_t* root;
     size_t size;
 
-    static node_t* empty()
-    {
-        static const auto node = node_t::make_inner_n(0);
-        return node->inc();
-    }
+    static node_t* empty() { return node_t::empty()->inc(); }
 
     champ(node_t* r, size_t sz = 0)
         : root{r}
@@ -186,6 +187,7 @@ struct champ
 
     void dec() const
     {
+        IMMER_TRACE_RELEASE_SCOPE();
         if (root->dec())
             node_t::delete_deep(root, 0);
     }
@@ -307,25 +309,175 @@ struct champ
         for_each_chunk_traversal(root, 0, fn);
     }
 
+    // Visits the subtree of `node`, which is at `depth`, in pre-order
+    // with an explicit stack of the children that are left to visit at
+    // every level.  When a node is visited all its children are
+    // prefetched, and when a child is visited the values of its next
+    // sibling are prefetched as well, so that the cache misses of a
+    // scan overlap instead of chasing one pointer at a time.
     template <typename Fn>
     void
     for_each_chunk_traversal(const node_t* node, count_t depth, Fn&& fn) const
     {
+        using iter_t = const node_t* const*;
+        struct level_t
+        {
+            iter_t next;
+            iter_t last;
+        };
+        level_t stack[max_depth<B> + 1];
+        auto top = stack;
+        for (auto start = depth;;) {
+            if (depth < max_depth<B>) {
+                if (node->datamap())
+                    fn(node->values(), node->values() + node->data_count());
+                if (node->nodemap()) {
+                    auto fst = node->children();
+                    auto lst = fst + node->children_count();
+                    for (auto it = fst; it != lst; ++it)
+                        IMMER_PREFETCH_READ(*it);
+                    *top++ = {fst, lst};
+                }
+            } else {
+                fn(node->collisions(),
+                   node->collisions() + node->collision_count());
+            }
+            while (top != stack && top[-1].next == top[-1].last)
+                --top;
+            if (top == stack)
+                return;
+            depth = start + static_cast<count_t>(top - stack);
+            node  = *top[-1].next++;
+            if (depth < max_depth<B> && top[-1].next != top[-1].last) {
+                auto sibling = *top[-1].next;
+                if (sibling->datamap())
+                    IMMER_PREFETCH_READ(sibling->values());
+            }
+        }
+    }
+
+    using par_sub_t = std::pair<const node_t*, count_t>;
+
+    /*!
+     * Splits the tree until there are enough subtrees to keep the
+     * executor `ex` busy.  The values of the split nodes are passed
+     * to `fn` right away.
+     */
+    template <typename Fn, typename Executor>
+    std::vector<par_sub_t> par_split(Fn&& fn, Executor& ex) const
+    {
+        auto wanted = ex.concurrency() * bulk_oversubscription;
+        auto subs   = std::vector<par_sub_t>{{root, 0}};
+        for (auto split = true; split && subs.size() < wanted;) {
+            auto next = std::vector<par_sub_t>{};
+            split     = false;
+            for (auto& s : subs) {
+                auto node = s.first;
+                if (s.second < max_depth<B> && node->nodemap()) {
+                    if (node->datamap())
+                        fn(node->values(),
+                           node->values() + node->data_count());
+                    auto fst = node->children();
+                    auto lst = fst + node->children_count();
+                    for (; fst != lst; ++fst)
+                        next.push_back({*fst, s.second + 1});
+                    split = true;
+                } else
+                    next.push_back(s);
+            }
+            subs = std::move(next);
+        }
+        return subs;
+    }
+
+    template <typename Fn, typename Executor>
+    void par_for_each_chunk(Fn&& fn, Executor& ex) const
+    {
+        auto subs = par_split(fn, ex);
+        bulk_ranges(ex, subs.size(), [&](size_t first, size_t last) {
+            for (; first != last; ++first)
+                for_each_chunk_traversal(
+                    subs[first].first, subs[first].second, fn);
+        });
+    }
+
+    template <typename U, typename Combine, typename Executor>
+    U par_reduce(const U& init,
+                 Combine& combine,
+                 Executor& ex,
+                 const typename reduce_cache<U>::map_t* old,
+                 typename reduce_cache<U>::map_t* fresh) const
+    {
+        auto acc  = init;
+        auto subs = par_split(
+            [&](auto fst, auto lst) {
+                for (; fst != lst; ++fst)
+                    acc = combine(std::move(acc), *fst);
+            },
+            ex);
+        return combine(
+            std::move(acc),
+            reduce_subtrees(
+                subs, init, combine, ex, old, fresh, [&](auto&& s, auto&& t) {
+                    return reduce_traversal(s.first, s.second, init, combine, t);
+                }));
+    }
+
+    template <typename U>
+    void reduce_keep(const node_t* node, count_t depth, reduce_task<U>& t) const
+    {
+        if (auto hit = t.find(node, 0)) {
+            t.record(node, 0, *hit);
+            if (depth + 1 < max_depth<B>) {
+                auto fst = node->children();
+                auto lst = fst + node->children_count();
+                for (; fst != lst; ++fst)
+                    reduce_keep(*fst, depth + 1, t);
+            }
+        }
+    }
+
+    template <typename U, typename Combine>
+    U reduce_traversal(const node_t* node,
+                       count_t depth,
+                       const U& init,
+                       Combine& combine,
+                       reduce_task<U>& t) const
+    {
+        auto acc = init;
         if (depth < max_depth<B>) {
-            auto datamap = node->datamap();
-            if (datamap)
-                fn(node->values(), node->values() + node->data_count());
-            auto nodemap = node->nodemap();
-            if (nodemap) {
+            // only the nodes with children are memoized, the others
+            // hold a few values only
+            auto memo = t.memoizing() && node->nodemap();
+            if (memo) {
+                if (auto hit = t.find(node, 0)) {
+                    reduce_keep(node, depth, t);
+                    return *hit;
+                }
+            }
+            if (node->datamap()) {
+                auto fst = node->values();
+                auto lst = fst + node->data_count();
+                for (; fst != lst; ++fst)
+                    acc = combine(std::move(acc), *fst);
+            }
+            if (node->nodemap()) {
                 auto fst = node->children();
                 auto lst = fst + node->children_count();
                 for (; fst != lst; ++fst)
-                    for_each_chunk_traversal(*fst, depth + 1, fn);
+                    acc = combine(
+                        std::move(acc),
+                        reduce_traversal(*fst, depth + 1, init, combine, t));
             }
+            if (memo)
+                t.record(node, 0, acc);
         } else {
-            fn(node->collisions(),
-               node->collisions() + node->collision_count());
+            auto fst = node->collisions();
+            auto lst = fst + node->collision_count();
+            for (; fst != lst; ++fst)
+                acc = combine(std::move(acc), *fst);
         }
+        return acc;
     }
 
     template <typename EqualValue, typename Differ>
@@ -480,7 +632,10 @@ struct champ
         auto new_offset       = new_node->data_count(bit);
         auto const& old_value = old_node->values()[old_offset];
         auto const& new_value = new_node->values()[new_offset];
-        if (!Equal{}(old_value, new_value)) {
+        if (!value_equal(old_node,
+                         old_offset,
+                         cached_hash(new_node, new_offset),
+                         new_value)) {
             differ.removed(old_value);
             differ.added(new_value);
         } else {
@@ -526,21 +681,178 @@ struct champ
         }
     }
 
+    // Calls `fn(v, h)` for the values `v`, whose hash is `h`, that come
+    // after the position `hash` in the order of the trie, which is the
+    // one of `batch_hash_less`, until it returns `false`.  Of the values
+    // whose hash is `hash`, the first `skip` are skipped too, and with
+    // `skip == 0` all the values are visited.  It only descends the
+    // path to the position, and returns whether it visited everything.
+    template <typename Fn>
+    bool for_each_after(hash_t hash, size_t skip, Fn&& fn) const
+    {
+        return for_each_after_rec(root, 0, hash, skip, skip != 0, fn);
+    }
+
+    template <typename Fn>
+    static bool for_each_after_rec(const node_t* node,
+                                   count_t depth,
+                                   hash_t hash,
+                                   size_t skip,
+                                   bool seek,
+                                   Fn& fn)
+    {
+        if (depth == max_depth<B>) {
+            auto fst = node->collisions();
+            auto lst = fst + node->collision_count();
+            auto h   = Hash{}(*fst);
+            if (seek && h == hash)
+                fst += std::min(skip, static_cast<size_t>(lst - fst));
+            for (; fst != lst; ++fst)
+                if (!fn(*fst, h))
+                    return false;
+            return true;
+        }
+        auto first =
+            seek ? static_cast<count_t>((hash >> (depth * B)) & mask<B>) : 0;
+        for (auto b = first; b < branches<B>; ++b) {
+            auto bit     = bitmap_t{1u} << b;
+            auto on_path = seek && b == first;
+            if (node->nodemap() & bit) {
+                auto child = node->children()[node->children_count(bit)];
+                if (!for_each_after_rec(
+                        child, depth + 1, hash, skip, on_path, fn))
+                    return false;
+            } else if (node->datamap() & bit) {
+                auto offset = node->data_count(bit);
+                auto h      = value_hash(node, offset);
+                // the value at the position was visited already
+                if ((!on_path || batch_hash_less(hash, h)) &&
+                    !fn(node->values()[offset], h))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    // The hash of the value at `offset` in the data of `node`, which is
+    // only recomputed when the hashes are not cached.
+    static hash_t value_hash(const node_t* node, count_t offset)
+    {
+        return node_t::cache_hashes ? node->hashes()[offset]
+                                    : Hash{}(node->values()[offset]);
+    }
+
+    // Like `value_hash`, but returns a dummy value when the hashes are
+    // not cached, for when they are only needed to fill the cache.
+    static hash_t cached_hash(const node_t* node, count_t offset)
+    {
+        return node_t::cache_hashes ? node->hashes()[offset] : hash_t{};
+    }
+
+    // Whether the value at `offset` in the data of `node` has the key
+    // `k`, whose hash is `hash`.  Cached hashes are compared first.
+    template <typename K>
+    static bool
+    value_equal(const node_t* node, count_t offset, hash_t hash, const K& k)
+    {
+        return (!node_t::cache_hashes || node->hashes()[offset] == hash) &&
+               Equal{}(node->values()[offset], k);
+    }
+
+    // Number of lookups that `get_many` interleaves.
+    static constexpr auto get_many_group = count_t{16};
+
+    // Writes to `out` the result of looking up every key in `[first,
+    // last)`, like `get` does.  The lookups are done in groups that
+    // descend together one level at a time, prefetching the nodes of
+    // the next level of all of them before reading any, so that
+    // their cache misses overlap.  The values found are compared
+    // after prefetching them too.
+    template <typename Project,
+              typename Default,
+              typename Iter,
+              typename Sent,
+              typename Out>
+    Out get_many(Iter first, Sent last, Out out) const
+    {
+        using key_t = std::remove_reference_t<decltype(*first)>;
+        const key_t* keys[get_many_group];
+        node_t* nodes[get_many_group];
+        node_t* owners[get_many_group];
+        count_t offsets[get_many_group];
+        hash_t hashes[get_many_group];
+        while (first != last) {
+            auto n = count_t{};
+            for (; n < get_many_group && first != last; ++n, ++first) {
+                keys[n]   = &*first;
+                hashes[n] = Hash{}(*keys[n]);
+                nodes[n]  = root;
+                owners[n] = nullptr;
+            }
+            auto pending = n;
+            for (auto depth = count_t{}; pending && depth < max_depth<B>;
+                 ++depth) {
+                for (auto i = count_t{}; i < n; ++i) {
+                    auto node = nodes[i];
+                    if (!node)
+                        continue;
+                    auto frag = (hashes[i] >> (depth * B)) & mask<B>;
+                    auto bit  = bitmap_t{1u} << frag;
+                    if (node->nodemap() & bit) {
+                        nodes[i] = node->children()[node->children_count(bit)];
+                        IMMER_PREFETCH_READ(nodes[i]);
+                        continue;
+                    } else if (node->datamap() & bit) {
+                        owners[i]  = node;
+                        offsets[i] = node->data_count(bit);
+                        IMMER_PREFETCH_READ(node->values() + offsets[i]);
+                        if (node_t::cache_hashes)
+                            IMMER_PREFETCH_READ(node->hashes() + offsets[i]);
+                    }
+                    nodes[i] = nullptr;
+                    --pending;
+                }
+            }
+            for (auto i = count_t{}; i < n; ++i) {
+                const T* found = nullptr;
+                if (owners[i]) {
+                    if (value_equal(owners[i], offsets[i], hashes[i], *keys[i]))
+                        found = owners[i]->values() + offsets[i];
+                } else if (auto node = nodes[i]) {
+                    found = find_collision(node, *keys[i]);
+                }
+                if (found)
+                    *out++ = Project{}(*found);
+                else
+                    *out++ = Default{}();
+            }
+        }
+        return out;
+    }
+
     template <typename Project, typename Default, typename K>
     decltype(auto) get(const K& k) const
+    {
+        return get<Project, Default>(k, Hash{}(k));
+    }
+
+    // The overloads that take a `hash` use it instead of hashing `k`
+    // again, thus it must be `Hash{}(k)`.
+    template <typename Project, typename Default, typename K>
+    decltype(auto) get(const K& k, hash_t hash) const
     {
         auto node = root;
-        auto hash = Hash{}(k);
+        auto frag = hash;
         for (auto i = count_t{}; i < max_depth<B>; ++i) {
-            auto bit = bitmap_t{1u} << (hash & mask<B>);
+            auto bit = bitmap_t{1u} << (frag & mask<B>);
             if (node->nodemap() & bit) {
                 auto offset = node->children_count(bit);
                 node        = node->children()[offset];
-                hash        = hash >> B;
+                frag        = frag >> B;
             } else if (node->datamap() & bit) {
                 auto offset = node->data_count(bit);
                 auto val    = node->values() + offset;
-                if (Equal{}(*val, k))
+                if (value_equal(node, offset, hash, k))
                     return Project{}(*val);
                 else
                     return Default{}();
@@ -548,12 +860,26 @@ struct champ
                 return Default{}();
             }
         }
+        auto found = find_collision(node, k);
+        return found ? Project{}(*found) : Default{}();
+    }
+
+    // The value in the collision node `node` equal to `k`, or null.  It
+    // bisects the node when the hash function orders the collisions.
+    template <typename K>
+    static const T* find_collision(const node_t* node, const K& k)
+    {
         auto fst = node->collisions();
         auto lst = fst + node->collision_count();
+        if (node_t::sorted_collisions) {
+            fst = std::lower_bound(
+                fst, lst, k, typename node_t::collision_less{});
+            return fst != lst && Equal{}(*fst, k) ? fst : nullptr;
+        }
         for (; fst != lst; ++fst)
             if (Equal{}(*fst, k))
-                return Project{}(*fst);
-        return Default{}();
+                return fst;
+        return nullptr;
     }
 
     struct add_result
@@ -562,7 +888,7 @@ struct champ
         bool added;
     };
 
-    add_result do_add(node_t* node, T v, hash_t hash, shift_t shift) const
+    add_result do_add(node_t* node, T&& v, hash_t hash, shift_t shift) const
     {
         assert(node);
         if (shift == max_shift<B>) {
@@ -594,13 +920,13 @@ struct champ
             } else if (node->datamap() & bit) {
                 auto offset = node->data_count(bit);
                 auto val    = node->values() + offset;
-                if (Equal{}(*val, v))
+                if (value_equal(node, offset, hash, v))
                     return {node_t::copy_inner_replace_value(
                                 node, offset, std::move(v)),
                             false};
                 else {
                     auto child = node_t::make_merged(
-                        shift + B, std::move(v), hash, *val, Hash{}(*val));
+                        shift + B, std::move(v), hash, *val, value_hash(node, offset));
                     IMMER_TRY {
                         return {node_t::copy_inner_replace_merged(
                                     node, bit, offset, child),
@@ -613,7 +939,8 @@ struct champ
                 }
             } else {
                 return {
-                    node_t::copy_inner_insert_value(node, bit, std::move(v)),
+                    node_t::copy_inner_insert_value(
+                        node, bit, std::move(v), hash),
                     true};
             }
         }
@@ -621,7 +948,12 @@ struct champ
 
     champ add(T v) const
     {
-        auto hash     = Hash{}(v);
+        auto hash = Hash{}(v);
+        return add(std::move(v), hash);
+    }
+
+    champ add(T v, hash_t hash) const
+    {
         auto res      = do_add(root, std::move(v), hash, 0);
         auto new_size = size + (res.added ? 1 : 0);
         return {res.node, new_size};
@@ -635,7 +967,7 @@ struct champ
     };
 
     add_mut_result
-    do_add_mut(edit_t e, node_t* node, T v, hash_t hash, shift_t shift) const
+    do_add_mut(edit_t e, node_t* node, T&& v, hash_t hash, shift_t shift) const
     {
         assert(node);
         if (shift == max_shift<B>) {
@@ -686,7 +1018,7 @@ struct champ
             } else if (node->datamap() & bit) {
                 auto offset = node->data_count(bit);
                 auto val    = node->values() + offset;
-                if (Equal{}(*val, v)) {
+                if (value_equal(node, offset, hash, v)) {
                     if (node->can_mutate(e)) {
                         auto vals    = node->ensure_mutable_values(e);
                         vals[offset] = std::move(v);
@@ -699,7 +1031,7 @@ struct champ
                 } else {
                     auto mutate        = node->can_mutate(e);
                     auto mutate_values = mutate && node->can_mutate_values(e);
-                    auto hash2         = Hash{}(*val);
+                    auto hash2         = value_hash(node, offset);
                     auto child         = node_t::make_merged_e(
                         e,
                         shift + B,
@@ -722,9 +1054,9 @@ struct champ
             } else {
                 auto mutate = node->can_mutate(e);
                 auto r      = mutate ? node_t::move_inner_insert_value(
-                                      e, node, bit, std::move(v))
+                                      e, node, bit, std::move(v), hash)
                                      : node_t::copy_inner_insert_value(
-                                      node, bit, std::move(v));
+                                      node, bit, std::move(v), hash);
                 return {node_t::owned_values(r, e), true, mutate};
             }
         }
@@ -733,13 +1065,1206 @@ struct champ
     void add_mut(edit_t e, T v)
     {
         auto hash = Hash{}(v);
-        auto res  = do_add_mut(e, root, std::move(v), hash, 0);
+        add_mut(e, std::move(v), hash);
+    }
+
+    void add_mut(edit_t e, T v, hash_t hash)
+    {
+        auto res = do_add_mut(e, root, std::move(v), hash, 0);
         if (!res.mutated && root->dec())
             node_t::delete_deep(root, 0);
         root = res.node;
         size += res.added ? 1 : 0;
     }
 
+    struct batch_entry
+    {
+        hash_t hash;
+        T* value;
+        bool movable;
+    };
+
+    static bool batch_hash_less(hash_t a, hash_t b)
+    {
+        for (auto shift = shift_t{}; shift < max_shift<B>; shift += B) {
+            auto fa = (a >> shift) & mask<B>;
+            auto fb = (b >> shift) & mask<B>;
+            if (fa != fb)
+                return fa < fb;
+        }
+        return false;
+    }
+
+    static bool batch_single_key(const batch_entry* first,
+                                 const batch_entry* last,
+                                 const T* existing)
+    {
+        auto ref = existing ? existing : (last - 1)->value;
+        if (!existing && first->hash != (last - 1)->hash)
+            return false;
+        for (; first != last; ++first)
+            if (!Equal{}(*first->value, *ref))
+                return false;
+        return true;
+    }
+
+    // Resolves the entries of a batch for the same key, the latest one
+    // wins.
+    struct batch_last
+    {
+        batch_entry operator()(const batch_entry&, const batch_entry& next)
+        {
+            return next;
+        }
+    };
+
+    // Resolves the entries of a batch for the same key with
+    // `combine(previous, next)`, keeping the results in `storage`,
+    // whose elements never move.
+    template <typename Combine>
+    struct batch_combine
+    {
+        Combine& combine;
+        std::deque<T>& storage;
+
+        batch_entry operator()(const batch_entry& acc, const batch_entry& next)
+        {
+            const auto& a = *acc.value;
+            const auto& b = *next.value;
+            storage.push_back(combine(a, b));
+            return {next.hash, &storage.back(), true};
+        }
+    };
+
+    // Folds the entries `[first, last)` of a batch, all for the same
+    // key, after `existing`, the entry already in the tree, if any.
+    template <typename Step>
+    static batch_entry batch_fold(const batch_entry* existing,
+                                  const batch_entry* first,
+                                  const batch_entry* last,
+                                  Step& step)
+    {
+        auto acc = existing ? *existing : *first++;
+        for (; first != last; ++first)
+            acc = step(acc, *first);
+        return acc;
+    }
+
+    static void batch_construct(T* dst, const batch_entry& src)
+    {
+        if (src.movable)
+            new (dst) T{std::move(*src.value)};
+        else
+            new (dst) T{*src.value};
+    }
+
+    // Makes a collision node with copies of the entries in `srcs`.
+    static node_t* batch_make_collision(const std::vector<batch_entry>& srcs)
+    {
+        auto n = static_cast<count_t>(srcs.size());
+        auto p = node_t::make_collision_n(n);
+        auto i = count_t{};
+        IMMER_TRY {
+            for (; i < n; ++i)
+                batch_construct(p->collisions() + i, srcs[i]);
+            node_t::sort_collisions(p);
+        }
+        IMMER_CATCH (...) {
+            detail::destroy_n(p->collisions(), i);
+            node_t::deallocate_collision(p, n);
+            IMMER_RETHROW;
+        }
+        return p;
+    }
+
+    // Makes an inner node with copies of the entries in `vals` and the
+    // children in `kids`, whose references are taken over.  On failure
+    // the children are left to the caller.
+    static node_t* batch_make_inner(bitmap_t datamap,
+                                    bitmap_t nodemap,
+                                    const batch_entry* vals,
+                                    count_t nvals,
+                                    node_t* const* kids,
+                                    count_t nkids)
+    {
+        auto p                       = node_t::make_inner_n(nkids, nvals);
+        p->impl.d.data.inner.datamap = datamap;
+        p->impl.d.data.inner.nodemap = nodemap;
+        auto i                       = count_t{};
+        IMMER_TRY {
+            for (; i < nvals; ++i)
+                batch_construct(p->values() + i, vals[i]);
+        }
+        IMMER_CATCH (...) {
+            detail::destroy_n(p->values(), i);
+            if (nvals)
+                node_t::deallocate_inner(p, nkids, nvals);
+            else
+                node_t::deallocate_inner(p, nkids);
+            IMMER_RETHROW;
+        }
+        if (node_t::cache_hashes)
+            for (i = 0; i < nvals; ++i)
+                p->hashes()[i] = vals[i].hash;
+        std::copy(kids, kids + nkids, p->children());
+        return p;
+    }
+
+    // Builds a new node with the contents of `node` (which may be null
+    // and is not consumed) plus the entries in the sorted batch `[first,
+    // last)`, where `step` resolves the entries for the same key.  Every
+    // node that receives entries is allocated once, the untouched
+    // subtrees are shared.
+    template <typename Own, typename Step>
+    node_t* do_add_batch(node_t* node,
+                         batch_entry* first,
+                         batch_entry* last,
+                         shift_t shift,
+                         size_t& added,
+                         Own& own,
+                         Step& step) const
+    {
+        if (shift == max_shift<B>) {
+            auto srcs = std::vector<batch_entry>{};
+            if (node) {
+                auto fst = node->collisions();
+                auto lst = fst + node->collision_count();
+                for (; fst != lst; ++fst)
+                    srcs.push_back({0, fst, false});
+            }
+            for (; first != last; ++first) {
+                auto it = std::find_if(
+                    srcs.begin(), srcs.end(), [&](const batch_entry& x) {
+                        return Equal{}(*x.value, *first->value);
+                    });
+                if (it != srcs.end())
+                    *it = step(*it, *first);
+                else {
+                    srcs.push_back(*first);
+                    ++added;
+                }
+            }
+            return own(batch_make_collision(srcs), true);
+        } else {
+            auto datamap  = node ? node->datamap() : bitmap_t{};
+            auto nodemap  = node ? node->nodemap() : bitmap_t{};
+            auto ndatamap = bitmap_t{};
+            auto nnodemap = bitmap_t{};
+            node_t* kids[branches<B>];
+            batch_entry vals[branches<B>];
+            auto nkids = count_t{};
+            auto nvals = count_t{};
+            IMMER_TRY {
+                for (auto idx = count_t{}; idx < branches<B>; ++idx) {
+                    auto bit = bitmap_t{1u} << idx;
+                    auto run = first;
+                    while (run != last &&
+                           ((run->hash >> shift) & mask<B>) == idx)
+                        ++run;
+                    if (first == run && !((datamap | nodemap) & bit))
+                        continue;
+                    if (nodemap & bit) {
+                        auto child =
+                            node->children()[node->children_count(bit)];
+                        kids[nkids++] =
+                            first != run
+                                ? do_add_batch(child,
+                                               first,
+                                               run,
+                                               shift + B,
+                                               added,
+                                               own,
+                                               step)
+                                : child->inc();
+                        nnodemap |= bit;
+                    } else if (datamap & bit) {
+                        auto offset = node->data_count(bit);
+                        auto val    = node->values() + offset;
+                        auto existing =
+                            batch_entry{cached_hash(node, offset), val, false};
+                        if (first == run) {
+                            vals[nvals++] = existing;
+                            ndatamap |= bit;
+                        } else if (batch_single_key(first, run, val)) {
+                            vals[nvals++] =
+                                batch_fold(&existing, first, run, step);
+                            ndatamap |= bit;
+                        } else {
+                            auto merged = std::vector<batch_entry>(first, run);
+                            auto hash   = value_hash(node, offset);
+                            auto pos    = std::lower_bound(
+                                merged.begin(),
+                                merged.end(),
+                                hash,
+                                [](const batch_entry& x, hash_t h) {
+                                    return batch_hash_less(x.hash, h);
+                                });
+                            merged.insert(pos, {hash, val, false});
+                            kids[nkids++] =
+                                do_add_batch(nullptr,
+                                             merged.data(),
+                                             merged.data() + merged.size(),
+                                             shift + B,
+                                             added,
+                                             own,
+                                             step);
+                            --added; // the existing value was counted
+                            nnodemap |= bit;
+                        }
+                    } else if (batch_single_key(first, run, nullptr)) {
+                        vals[nvals++] = batch_fold(nullptr, first, run, step);
+                        ndatamap |= bit;
+                        ++added;
+                    } else {
+                        kids[nkids++] = do_add_batch(
+                            nullptr, first, run, shift + B, added, own, step);
+                        nnodemap |= bit;
+                    }
+                    first = run;
+                }
+                return own(batch_make_inner(
+                               ndatamap, nnodemap, vals, nvals, kids, nkids),
+                           false);
+            }
+            IMMER_CATCH (...) {
+                for (auto i = count_t{}; i < nkids; ++i)
+                    if (kids[i]->dec())
+                        node_t::delete_deep_shift(kids[i], shift + B);
+                IMMER_RETHROW;
+            }
+        }
+    }
+
+    template <typename Iter, typename Sent, typename Own, typename Step>
+    node_t* add_batch_root(
+        Iter first, Sent last, size_t& added, Own own, Step step) const
+    {
+        auto values = std::vector<T>{};
+        for (; first != last; ++first)
+            values.push_back(*first);
+        auto entries = std::vector<batch_entry>{};
+        entries.reserve(values.size());
+        for (auto& v : values)
+            entries.push_back({Hash{}(v), &v, true});
+        std::stable_sort(entries.begin(),
+                         entries.end(),
+                         [](const batch_entry& a, const batch_entry& b) {
+                             return batch_hash_less(a.hash, b.hash);
+                         });
+        return do_add_batch(root,
+                            entries.data(),
+                            entries.data() + entries.size(),
+                            0,
+                            added,
+                            own,
+                            step);
+    }
+
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<compatible_sentinel_v<Iter, Sent>, bool> = true>
+    champ add_batch(Iter first, Sent last) const
+    {
+        if (first == last)
+            return *this;
+        auto added = size_t{};
+        auto node  = add_batch_root(
+            first,
+            last,
+            added,
+            [](node_t* p, bool) { return p; },
+            batch_last{});
+        return {node, size + added};
+    }
+
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<compatible_sentinel_v<Iter, Sent>, bool> = true>
+    void add_batch_mut(edit_t e, Iter first, Sent last)
+    {
+        add_batch_mut_impl(e, first, last, batch_last{});
+    }
+
+    // Like `add_batch`, but when a key is already in the tree, or
+    // appears several times in the batch, the value is `combine(old,
+    // new)`, applied in the order of the batch.
+    template <typename Iter,
+              typename Sent,
+              typename Combine,
+              std::enable_if_t<compatible_sentinel_v<Iter, Sent>, bool> = true>
+    champ upsert_batch(Iter first, Sent last, Combine&& combine) const
+    {
+        if (first == last)
+            return *this;
+        auto added   = size_t{};
+        auto storage = std::deque<T>{};
+        auto node    = add_batch_root(
+            first,
+            last,
+            added,
+            [](node_t* p, bool) { return p; },
+            batch_combine<std::remove_reference_t<Combine>>{combine, storage});
+        return {node, size + added};
+    }
+
+    template <typename Iter,
+              typename Sent,
+              typename Combine,
+              std::enable_if_t<compatible_sentinel_v<Iter, Sent>, bool> = true>
+    void upsert_batch_mut(edit_t e, Iter first, Sent last, Combine&& combine)
+    {
+        auto storage = std::deque<T>{};
+        add_batch_mut_impl(
+            e,
+            first,
+            last,
+            batch_combine<std::remove_reference_t<Combine>>{combine, storage});
+    }
+
+    template <typename Iter, typename Sent, typename Step>
+    void add_batch_mut_impl(edit_t e, Iter first, Sent last, Step step)
+    {
+        if (first == last)
+            return;
+        auto added = size_t{};
+        auto node  = add_batch_root(
+            first,
+            last,
+            added,
+            [e](node_t* p, bool c) {
+                return c ? node_t::owned(p, e)
+                         : node_t::owned_values_safe(p, e);
+            },
+            std::move(step));
+        if (root->dec())
+            node_t::delete_deep(root, 0);
+        root = node;
+        size += added;
+    }
+
+    // The number of values in the subtree `node`.
+    static size_t count_values(const node_t* node, shift_t shift)
+    {
+        if (shift == max_shift<B>)
+            return node->collision_count();
+        auto n    = size_t{node->data_count()};
+        auto fst  = node->children();
+        auto lst  = fst + node->children_count();
+        for (; fst != lst; ++fst)
+            n += count_values(*fst, shift + B);
+        return n;
+    }
+
+    // The value in the subtree `node` with the same key as `v`, whose
+    // hash is `hash`, or null when there is none.
+    static const T*
+    find_value(const node_t* node, const T& v, hash_t hash, shift_t shift)
+    {
+        for (; shift < max_shift<B>; shift += B) {
+            auto bit = bitmap_t{1u} << ((hash >> shift) & mask<B>);
+            if (node->nodemap() & bit)
+                node = node->children()[node->children_count(bit)];
+            else if (node->datamap() & bit) {
+                auto offset = node->data_count(bit);
+                return value_equal(node, offset, hash, v)
+                           ? node->values() + offset
+                           : nullptr;
+            } else
+                return nullptr;
+        }
+        return find_collision(node, v);
+    }
+
+    // Returns the subtree `node` (not consumed) with the value at
+    // `offset` in `src` merged into it.  `combine` gets first the value
+    // of the left hand side of the merge, which is `src` when `left`.
+    template <typename Combine>
+    node_t* merge_value(node_t* node,
+                        const node_t* src,
+                        count_t offset,
+                        shift_t shift,
+                        Combine& combine,
+                        bool left,
+                        bool& found) const
+    {
+        auto v        = src->values() + offset;
+        auto hash     = value_hash(src, offset);
+        auto existing = find_value(node, *v, hash, shift);
+        auto dummy    = size_t{};
+        auto own      = [](node_t* p, bool) { return p; };
+        auto step     = batch_last{};
+        found         = existing != nullptr;
+        if (existing) {
+            auto c = left ? combine(*v, *existing) : combine(*existing, *v);
+            auto e = batch_entry{hash, &c, true};
+            return do_add_batch(node, &e, &e + 1, shift, dummy, own, step);
+        } else {
+            auto e = batch_entry{hash, const_cast<T*>(v), false};
+            return do_add_batch(node, &e, &e + 1, shift, dummy, own, step);
+        }
+    }
+
+    // Returns a tree with the values of the trees `a` and `b`, which
+    // are not consumed.  The values with the same key are replaced by
+    // `combine(x, y)`, where `x` comes from `a` and `y` from `b`.  The
+    // subtrees that `a` and `b` share are reused without visiting them.
+    // `added` counts the values of `b` whose key is not in `a`.  When
+    // `premerged` is given, it holds the merged children of the inner
+    // nodes `a` and `b` indexed by their offset in `a`, which are taken
+    // over instead of merging them again.
+    template <typename Combine>
+    node_t* do_merge(node_t* a,
+                     node_t* b,
+                     shift_t shift,
+                     Combine& combine,
+                     size_t& added,
+                     node_t** premerged = nullptr) const
+    {
+        if (a == b)
+            return a->inc();
+        if (shift == max_shift<B>) {
+            auto na       = a->collision_count();
+            auto srcs     = std::vector<batch_entry>{};
+            auto combined = std::vector<T>{};
+            // the entries point into `combined`, which must not grow
+            combined.reserve(na);
+            auto fst = a->collisions();
+            for (auto lst = fst + na; fst != lst; ++fst)
+                srcs.push_back({0, fst, false});
+            auto bfst = b->collisions();
+            auto blst = bfst + b->collision_count();
+            for (; bfst != blst; ++bfst) {
+                auto it = std::find_if(
+                    srcs.begin(), srcs.begin() + na, [&](const batch_entry& x) {
+                        return Equal{}(*x.value, *bfst);
+                    });
+                if (it != srcs.begin() + na) {
+                    combined.push_back(combine(*it->value, *bfst));
+                    *it = {0, &combined.back(), true};
+                } else {
+                    srcs.push_back({0, bfst, false});
+                    ++added;
+                }
+            }
+            return batch_make_collision(srcs);
+        } else {
+            auto amap     = a->datamap() | a->nodemap();
+            auto bmap     = b->datamap() | b->nodemap();
+            auto ndatamap = bitmap_t{};
+            auto nnodemap = bitmap_t{};
+            node_t* kids[branches<B>];
+            batch_entry vals[branches<B>];
+            auto nkids    = count_t{};
+            auto nvals    = count_t{};
+            auto combined = std::vector<T>{};
+            IMMER_TRY {
+                for (auto bit : set_bits_range<bitmap_t>(amap | bmap)) {
+                    if (a->nodemap() & bit) {
+                        auto ao = a->children_count(bit);
+                        auto ac = a->children()[ao];
+                        if (b->nodemap() & bit) {
+                            auto bc = b->children()[b->children_count(bit)];
+                            kids[nkids++] =
+                                premerged
+                                    ? std::exchange(premerged[ao], nullptr)
+                                    : do_merge(
+                                          ac, bc, shift + B, combine, added);
+                        } else if (b->datamap() & bit) {
+                            auto found    = false;
+                            kids[nkids++] = merge_value(ac,
+                                                        b,
+                                                        b->data_count(bit),
+                                                        shift + B,
+                                                        combine,
+                                                        false,
+                                                        found);
+                            added += !found;
+                        } else
+                            kids[nkids++] = ac->inc();
+                        nnodemap |= bit;
+                    } else if (a->datamap() & bit) {
+                        auto ao = a->data_count(bit);
+                        auto av = a->values() + ao;
+                        if (b->nodemap() & bit) {
+                            auto bc = b->children()[b->children_count(bit)];
+                            auto found    = false;
+                            kids[nkids++] = merge_value(
+                                bc, a, ao, shift + B, combine, true, found);
+                            added += count_values(bc, shift + B) - found;
+                            nnodemap |= bit;
+                        } else if (b->datamap() & bit) {
+                            auto bo = b->data_count(bit);
+                            auto bv = b->values() + bo;
+                            auto ah = value_hash(a, ao);
+                            if (value_equal(b, bo, ah, *av)) {
+                                if (combined.empty())
+                                    combined.reserve(branches<B>);
+                                combined.push_back(combine(*av, *bv));
+                                vals[nvals++] = {
+                                    cached_hash(a, ao), &combined.back(), true};
+                                ndatamap |= bit;
+                            } else {
+                                kids[nkids++] = node_t::make_merged(
+                                    shift + B, *av, ah, *bv, value_hash(b, bo));
+                                nnodemap |= bit;
+                                ++added;
+                            }
+                        } else {
+                            vals[nvals++] = {cached_hash(a, ao), av, false};
+                            ndatamap |= bit;
+                        }
+                    } else if (b->nodemap() & bit) {
+                        auto bc       = b->children()[b->children_count(bit)];
+                        kids[nkids++] = bc->inc();
+                        nnodemap |= bit;
+                        added += count_values(bc, shift + B);
+                    } else {
+                        auto bo       = b->data_count(bit);
+                        vals[nvals++] = {
+                            cached_hash(b, bo), b->values() + bo, false};
+                        ndatamap |= bit;
+                        ++added;
+                    }
+                }
+                return batch_make_inner(
+                    ndatamap, nnodemap, vals, nvals, kids, nkids);
+            }
+            IMMER_CATCH (...) {
+                for (auto i = count_t{}; i < nkids; ++i)
+                    if (kids[i]->dec())
+                        node_t::delete_deep_shift(kids[i], shift + B);
+                IMMER_RETHROW;
+            }
+        }
+    }
+
+    template <typename Combine>
+    champ merge(const champ& other, Combine combine) const
+    {
+        auto added = size_t{};
+        auto node  = do_merge(root, other.root, 0, combine, added);
+        return {node, size + added};
+    }
+
+    // Like `merge`, but the children of the roots that both sides have
+    // are merged concurrently using the executor `ex`.  They hold
+    // disjoint ranges of hashes, so for a large tree they are a
+    // balanced split of the work.
+    template <typename Combine, typename Executor>
+    champ par_merge(const champ& other, Combine combine, Executor& ex) const
+    {
+        auto a = root;
+        auto b = other.root;
+        if (a == b)
+            return *this;
+        // the children that both share are reused right away
+        auto n         = a->children_count();
+        auto added     = std::vector<size_t>(n + 1);
+        auto premerged = std::vector<node_t*>(n);
+        auto jobs      = std::vector<bitmap_t>{};
+        for (auto bit :
+             set_bits_range<bitmap_t>(a->nodemap() & b->nodemap())) {
+            auto ac = a->children()[a->children_count(bit)];
+            auto bc = b->children()[b->children_count(bit)];
+            if (ac == bc)
+                premerged[a->children_count(bit)] = ac->inc();
+            else
+                jobs.push_back(bit);
+        }
+        IMMER_TRY {
+            bulk_ranges(ex, jobs.size(), [&](size_t first, size_t last) {
+                for (; first != last; ++first) {
+                    auto ao = a->children_count(jobs[first]);
+                    auto bc = b->children()[b->children_count(jobs[first])];
+                    premerged[ao] = do_merge(
+                        a->children()[ao], bc, B, combine, added[ao]);
+                }
+            });
+            auto node = do_merge(
+                a, b, 0, combine, added.back(), premerged.data());
+            auto total = size_t{};
+            for (auto x : added)
+                total += x;
+            return {node, size + total};
+        }
+        IMMER_CATCH (...) {
+            for (auto p : premerged)
+                if (p && p->dec())
+                    node_t::delete_deep_shift(p, B);
+            IMMER_RETHROW;
+        }
+    }
+
+    // What is left of a subtree after filtering it: either nothing, a
+    // single value that is inlined in the parent, or a new node.
+    struct filter_result
+    {
+        node_t* node;
+        batch_entry value;
+    };
+
+    // The result of filtering a collision node `a`, when the values in
+    // `srcs` are the ones that are kept.
+    static filter_result filter_collision(node_t* a,
+                                          const std::vector<batch_entry>& srcs,
+                                          size_t& removed)
+    {
+        removed += a->collision_count() - srcs.size();
+        if (srcs.size() == a->collision_count())
+            return {a->inc(), {}};
+        else if (srcs.size() > 1)
+            return {batch_make_collision(srcs), {}};
+        else if (srcs.size() == 1) {
+            auto h = node_t::cache_hashes ? Hash{}(*srcs[0].value) : 0;
+            return {nullptr, {h, srcs[0].value, false}};
+        } else
+            return {nullptr, {}};
+    }
+
+    // Collects what is kept of the data and the children of an inner
+    // node being filtered, and then builds the result.  The node is
+    // reused when nothing was removed, and emptied nodes are collapsed
+    // into their parents like `do_sub` does.
+    struct filter_builder
+    {
+        bitmap_t datamap = {};
+        bitmap_t nodemap = {};
+        node_t* kids[branches<B>];
+        batch_entry vals[branches<B>];
+        count_t nkids = {};
+        count_t nvals = {};
+
+        void keep(bitmap_t bit, filter_result r)
+        {
+            if (r.node) {
+                kids[nkids++] = r.node;
+                nodemap |= bit;
+            } else if (r.value.value) {
+                vals[nvals++] = r.value;
+                datamap |= bit;
+            }
+        }
+
+        filter_result finish(node_t* a, shift_t shift, bool changed)
+        {
+            if (!changed) {
+                for (auto i = count_t{}; i < nkids; ++i)
+                    kids[i]->dec();
+                nkids = 0;
+                return {a->inc(), {}};
+            } else if (nkids == 0 && nvals <= 1 && shift > 0) {
+                return {nullptr, nvals ? vals[0] : batch_entry{}};
+            } else if (nkids == 0 && nvals == 0) {
+                return {empty(), {}};
+            } else {
+                auto p = batch_make_inner(
+                    datamap, nodemap, vals, nvals, kids, nkids);
+                nkids = 0;
+                return {p, {}};
+            }
+        }
+
+        void release(shift_t shift)
+        {
+            for (auto i = count_t{}; i < nkids; ++i)
+                if (kids[i]->dec())
+                    node_t::delete_deep_shift(kids[i], shift + B);
+        }
+    };
+
+    // Returns what is left of the tree `a` (not consumed) when keeping
+    // only the values whose key is in the tree `b`, when `common`, or
+    // those whose key is not in `b` otherwise.  The subtrees that `a`
+    // and `b` share are kept or dropped without visiting them.
+    // `removed` counts the values of `a` that are dropped.  The root is
+    // always left as a node.
+    filter_result do_filter(
+        node_t* a, node_t* b, shift_t shift, bool common, size_t& removed) const
+    {
+        if (a == b) {
+            if (common)
+                return {a->inc(), {}};
+            removed += count_values(a, shift);
+            return {shift ? nullptr : empty(), {}};
+        }
+        if (shift == max_shift<B>) {
+            auto srcs = std::vector<batch_entry>{};
+            auto fst  = a->collisions();
+            auto lst  = fst + a->collision_count();
+            auto bfst = b->collisions();
+            auto blst = bfst + b->collision_count();
+            for (; fst != lst; ++fst) {
+                auto in_b = std::find_if(bfst, blst, [&](const T& x) {
+                                return Equal{}(x, *fst);
+                            }) != blst;
+                if (in_b == common)
+                    srcs.push_back({0, fst, false});
+            }
+            return filter_collision(a, srcs, removed);
+        } else {
+            auto removed0 = removed;
+            auto res      = filter_builder{};
+            IMMER_TRY {
+                for (auto bit : set_bits_range<bitmap_t>(a->datamap() |
+                                                         a->nodemap())) {
+                    if (a->nodemap() & bit) {
+                        auto ac = a->children()[a->children_count(bit)];
+                        if (b->nodemap() & bit) {
+                            auto bc = b->children()[b->children_count(bit)];
+                            res.keep(
+                                bit,
+                                do_filter(ac, bc, shift + B, common, removed));
+                        } else if (b->datamap() & bit) {
+                            auto bo = b->data_count(bit);
+                            auto bh = value_hash(b, bo);
+                            auto v =
+                                find_value(ac, b->values()[bo], bh, shift + B);
+                            auto n = count_values(ac, shift + B);
+                            if (common) {
+                                removed += n - !!v;
+                                if (v)
+                                    res.keep(bit,
+                                             {nullptr,
+                                              {bh, const_cast<T*>(v), false}});
+                            } else if (!v) {
+                                res.keep(bit, {ac->inc(), {}});
+                            } else {
+                                ++removed;
+                                auto r = do_sub(ac, *v, bh, shift + B);
+                                if (r.kind == sub_result::tree)
+                                    res.keep(bit, {r.data.tree, {}});
+                                else if (r.kind == sub_result::singleton)
+                                    res.keep(
+                                        bit,
+                                        {nullptr,
+                                         {r.hash, r.data.singleton, false}});
+                            }
+                        } else if (common) {
+                            removed += count_values(ac, shift + B);
+                        } else {
+                            res.keep(bit, {ac->inc(), {}});
+                        }
+                    } else {
+                        auto ao   = a->data_count(bit);
+                        auto av   = a->values() + ao;
+                        auto ah   = value_hash(a, ao);
+                        auto in_b = false;
+                        if (b->nodemap() & bit) {
+                            auto bc = b->children()[b->children_count(bit)];
+                            in_b    = find_value(bc, *av, ah, shift + B);
+                        } else if (b->datamap() & bit) {
+                            in_b = value_equal(b, b->data_count(bit), ah, *av);
+                        }
+                        if (in_b == common)
+                            res.keep(
+                                bit,
+                                {nullptr, {cached_hash(a, ao), av, false}});
+                        else
+                            ++removed;
+                    }
+                }
+                return res.finish(a, shift, removed != removed0);
+            }
+            IMMER_CATCH (...) {
+                res.release(shift);
+                IMMER_RETHROW;
+            }
+        }
+    }
+
+    // Returns what is left of the tree `a` (not consumed) when keeping
+    // only the values for which `pred` returns `true`.  The subtrees
+    // where every value is kept are reused.
+    template <typename Pred, typename Own>
+    filter_result do_filter_if(
+        node_t* a, shift_t shift, Pred& pred, size_t& removed, Own& own) const
+    {
+        if (shift == max_shift<B>) {
+            auto srcs = std::vector<batch_entry>{};
+            auto fst  = a->collisions();
+            auto lst  = fst + a->collision_count();
+            for (; fst != lst; ++fst)
+                if (pred(*fst))
+                    srcs.push_back({0, fst, false});
+            return own_filtered(
+                filter_collision(a, srcs, removed), a, shift, own);
+        } else {
+            auto removed0 = removed;
+            auto res      = filter_builder{};
+            IMMER_TRY {
+                for (auto bit : set_bits_range<bitmap_t>(a->datamap() |
+                                                         a->nodemap())) {
+                    if (a->nodemap() & bit) {
+                        auto ac = a->children()[a->children_count(bit)];
+                        res.keep(
+                            bit,
+                            do_filter_if(ac, shift + B, pred, removed, own));
+                    } else {
+                        auto ao = a->data_count(bit);
+                        auto av = a->values() + ao;
+                        if (pred(*av))
+                            res.keep(
+                                bit,
+                                {nullptr, {cached_hash(a, ao), av, false}});
+                        else
+                            ++removed;
+                    }
+                }
+                return own_filtered(
+                    res.finish(a, shift, removed != removed0), a, shift, own);
+            }
+            IMMER_CATCH (...) {
+                res.release(shift);
+                IMMER_RETHROW;
+            }
+        }
+    }
+
+    template <typename Pred>
+    champ filter(Pred pred) const
+    {
+        auto removed = size_t{};
+        auto own     = [](node_t* p, bool) { return p; };
+        auto res     = do_filter_if(root, 0, pred, removed, own);
+        return {res.node, size - removed};
+    }
+
+    champ intersect(const champ& other) const
+    {
+        auto removed = size_t{};
+        auto res     = do_filter(root, other.root, 0, true, removed);
+        return {res.node, size - removed};
+    }
+
+    champ subtract(const champ& other) const
+    {
+        auto removed = size_t{};
+        auto res     = do_filter(root, other.root, 0, false, removed);
+        return {res.node, size - removed};
+    }
+
+    // Marks the node that filtering `a` made, if any, as owned by the
+    // transient through `own`.  The empty root is shared and left
+    // alone.
+    template <typename Own>
+    static filter_result
+    own_filtered(filter_result r, node_t* a, shift_t shift, Own& own)
+    {
+        if (r.node && r.node != a) {
+            if (shift == max_shift<B>)
+                own(r.node, true);
+            else if (r.node->datamap() | r.node->nodemap())
+                own(r.node, false);
+        }
+        return r;
+    }
+
+    // A key of a batch to erase, with its hash.
+    template <typename K>
+    struct erase_entry
+    {
+        hash_t hash;
+        const K* key;
+    };
+
+    // Returns what is left of the tree `a` (not consumed) when removing
+    // the keys of the batch `[first, last)`, which is not empty and is
+    // sorted by hash like the batches that are inserted.  Only the
+    // subtrees that the keys fall into are visited, and those where no
+    // value is removed are reused.
+    template <typename K, typename Own>
+    filter_result do_sub_batch(node_t* a,
+                               const erase_entry<K>* first,
+                               const erase_entry<K>* last,
+                               shift_t shift,
+                               size_t& removed,
+                               Own& own) const
+    {
+        if (shift == max_shift<B>) {
+            auto srcs = std::vector<batch_entry>{};
+            auto fst  = a->collisions();
+            auto lst  = fst + a->collision_count();
+            for (; fst != lst; ++fst)
+                if (std::none_of(first, last, [&](const erase_entry<K>& x) {
+                        return Equal{}(*fst, *x.key);
+                    }))
+                    srcs.push_back({0, fst, false});
+            return own_filtered(
+                filter_collision(a, srcs, removed), a, shift, own);
+        } else {
+            auto removed0 = removed;
+            auto res      = filter_builder{};
+            IMMER_TRY {
+                for (auto bit : set_bits_range<bitmap_t>(a->datamap() |
+                                                         a->nodemap())) {
+                    auto idx = static_cast<hash_t>(
+                        popcount(static_cast<bitmap_t>(bit - 1)));
+                    auto frag = [&](const erase_entry<K>* x) {
+                        return (x->hash >> shift) & mask<B>;
+                    };
+                    while (first != last && frag(first) < idx)
+                        ++first;
+                    auto run = first;
+                    while (run != last && frag(run) == idx)
+                        ++run;
+                    if (a->nodemap() & bit) {
+                        auto ac = a->children()[a->children_count(bit)];
+                        res.keep(bit,
+                                 first != run
+                                     ? do_sub_batch(ac,
+                                                    first,
+                                                    run,
+                                                    shift + B,
+                                                    removed,
+                                                    own)
+                                     : filter_result{ac->inc(), {}});
+                    } else {
+                        auto ao = a->data_count(bit);
+                        auto av = a->values() + ao;
+                        if (std::none_of(
+                                first, run, [&](const erase_entry<K>& x) {
+                                    return value_equal(a, ao, x.hash, *x.key);
+                                }))
+                            res.keep(
+                                bit,
+                                {nullptr, {cached_hash(a, ao), av, false}});
+                        else
+                            ++removed;
+                    }
+                    first = run;
+                }
+                return own_filtered(
+                    res.finish(a, shift, removed != removed0), a, shift, own);
+            }
+            IMMER_CATCH (...) {
+                res.release(shift);
+                IMMER_RETHROW;
+            }
+        }
+    }
+
+    template <typename Iter, typename Sent, typename Own>
+    node_t*
+    sub_batch_root(Iter first, Sent last, size_t& removed, Own own) const
+    {
+        using entry_t = erase_entry<std::decay_t<decltype(*first)>>;
+        auto entries  = std::vector<entry_t>{};
+        for (; first != last; ++first)
+            entries.push_back({Hash{}(*first), &*first});
+        if (entries.empty())
+            return root->inc();
+        std::sort(entries.begin(),
+                  entries.end(),
+                  [](const entry_t& a, const entry_t& b) {
+                      return batch_hash_less(a.hash, b.hash);
+                  });
+        return do_sub_batch(root,
+                            entries.data(),
+                            entries.data() + entries.size(),
+                            0,
+                            removed,
+                            own)
+            .node;
+    }
+
+    // Removes all the keys in `[first, last)`, which must be a forward
+    // range of references to the keys.  The keys are sorted by hash
+    // and every node that they fall into is visited and copied only
+    // once.
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<compatible_sentinel_v<Iter, Sent>, bool> = true>
+    champ sub_batch(Iter first, Sent last) const
+    {
+        auto removed = size_t{};
+        auto node    = sub_batch_root(
+            first, last, removed, [](node_t* p, bool) { return p; });
+        return {node, size - removed};
+    }
+
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<compatible_sentinel_v<Iter, Sent>, bool> = true>
+    void sub_batch_mut(edit_t e, Iter first, Sent last)
+    {
+        auto removed = size_t{};
+        auto node    = sub_batch_root(first, last, removed, owner_of(e));
+        replace_root(node, removed);
+    }
+
+    // Like `filter`, but the nodes that are made are owned by `e`.
+    template <typename Pred>
+    void filter_mut(edit_t e, Pred pred)
+    {
+        auto removed = size_t{};
+        auto own     = owner_of(e);
+        auto node    = do_filter_if(root, 0, pred, removed, own).node;
+        replace_root(node, removed);
+    }
+
+    // Makes a function that marks the nodes that it is given as owned
+    // by `e`, the ones that are collisions when its second argument is
+    // true.
+    static auto owner_of(edit_t e)
+    {
+        return [e](node_t* p, bool c) {
+            return c ? node_t::owned(p, e) : node_t::owned_values_safe(p, e);
+        };
+    }
+
+    void replace_root(node_t* node, size_t removed)
+    {
+        if (root->dec())
+            node_t::delete_deep(root, 0);
+        root = node;
+        size -= removed;
+    }
+
+    // Returns what is left of the tree `a` (not consumed) when keeping
+    // only the values whose hash has `part` in its `bits` bits from
+    // `shift` on.  Those are under the slots whose index ends with the
+    // bits of `part` for this level, thus when no bits are left for the
+    // levels below, the children in those slots are kept as they are.
+    // `kept` counts the values that are kept.
+    filter_result do_partition(
+        node_t* a, shift_t shift, hash_t part, count_t bits, size_t& kept) const
+    {
+        assert(shift < max_shift<B>);
+        auto step  = bits < B ? count_t{1} << bits : branches<B>;
+        auto slots = bitmap_t{};
+        for (auto i = static_cast<count_t>(part & mask<B>); i < branches<B>;
+             i += step)
+            slots |= bitmap_t{1u} << i;
+        auto all     = a->datamap() | a->nodemap();
+        auto changed = (all & ~slots) != 0;
+        auto low     = (hash_t{1} << bits) - 1;
+        auto res     = filter_builder{};
+        IMMER_TRY {
+            for (auto bit : set_bits_range<bitmap_t>(all & slots)) {
+                if (a->nodemap() & bit) {
+                    auto ac = a->children()[a->children_count(bit)];
+                    if (bits <= B) {
+                        kept += count_values(ac, shift + B);
+                        res.keep(bit, {ac->inc(), {}});
+                    } else {
+                        auto r = do_partition(
+                            ac, shift + B, part >> B, bits - B, kept);
+                        changed = changed || r.node != ac;
+                        res.keep(bit, r);
+                    }
+                } else {
+                    auto ao = a->data_count(bit);
+                    if (((value_hash(a, ao) >> shift) & low) == part) {
+                        ++kept;
+                        res.keep(
+                            bit,
+                            {nullptr,
+                             {cached_hash(a, ao), a->values() + ao, false}});
+                    } else
+                        changed = true;
+                }
+            }
+            return res.finish(a, shift, changed);
+        }
+        IMMER_CATCH (...) {
+            res.release(shift);
+            IMMER_RETHROW;
+        }
+    }
+
+    // Splits the tree in `2^log2_parts` trees, the i-th holding the
+    // values whose hash ends with the bits of `i`.
+    std::vector<champ> partition(count_t log2_parts) const
+    {
+        assert(log2_parts <= 32);
+        auto parts = std::vector<champ>{};
+        if (log2_parts == 0) {
+            parts.push_back(*this);
+            return parts;
+        }
+        auto n = hash_t{1} << log2_parts;
+        parts.reserve(n);
+        for (auto part = hash_t{}; part < n; ++part) {
+            auto kept = size_t{};
+            auto res  = do_partition(root, 0, part, log2_parts, kept);
+            parts.push_back({res.node, kept});
+        }
+        return parts;
+    }
+
+    // Returns a copy of the tree `node` for the champ `Other`, with the
+    // same shape but the values replaced by `fn(x)`.  `fn` must keep
+    // the keys, since the values are not hashed or compared again.
+    template <typename Other, typename Fn>
+    static typename Other::node_t*
+    do_transform(const node_t* node, shift_t shift, Fn& fn)
+    {
+        using onode_t = typename Other::node_t;
+        using U       = typename onode_t::value_t;
+        static_assert(onode_t::cache_hashes == node_t::cache_hashes,
+                      "the hashes must be cached on both sides or neither");
+        if (shift == max_shift<B>) {
+            auto n = node->collision_count();
+            auto p = onode_t::make_collision_n(n);
+            auto i = count_t{};
+            IMMER_TRY {
+                for (; i < n; ++i)
+                    new (p->collisions() + i) U{fn(node->collisions()[i])};
+                onode_t::sort_collisions(p);
+            }
+            IMMER_CATCH (...) {
+                detail::destroy_n(p->collisions(), i);
+                onode_t::deallocate_collision(p, n);
+                IMMER_RETHROW;
+            }
+            return p;
+        } else {
+            onode_t* kids[branches<B>];
+            auto nkids = node->children_count();
+            auto nvals = node->data_count();
+            auto i     = count_t{};
+            IMMER_TRY {
+                for (; i < nkids; ++i)
+                    kids[i] = do_transform<Other>(
+                        node->children()[i], shift + B, fn);
+                auto p = nvals ? onode_t::make_inner_n(nkids, nvals)
+                               : onode_t::make_inner_n(nkids);
+                p->impl.d.data.inner.datamap = node->datamap();
+                p->impl.d.data.inner.nodemap = node->nodemap();
+                auto j                       = count_t{};
+                IMMER_TRY {
+                    for (; j < nvals; ++j)
+                        new (p->values() + j) U{fn(node->values()[j])};
+                }
+                IMMER_CATCH (...) {
+                    detail::destroy_n(p->values(), j);
+                    if (nvals)
+                        onode_t::deallocate_inner(p, nkids, nvals);
+                    else
+                        onode_t::deallocate_inner(p, nkids);
+                    IMMER_RETHROW;
+                }
+                if (onode_t::cache_hashes && nvals)
+                    std::copy(node->hashes(),
+                              node->hashes() + nvals,
+                              p->hashes());
+                std::copy(kids, kids + nkids, p->children());
+                return p;
+            }
+            IMMER_CATCH (...) {
+                while (i)
+                    onode_t::delete_deep_shift(kids[--i], shift + B);
+                IMMER_RETHROW;
+            }
+        }
+    }
+
+    template <typename Other, typename Fn>
+    Other transform(Fn fn) const
+    {
+        return {do_transform<Other>(root, 0, fn), size};
+    }
+
     using update_result = add_result;
 
     template <typename Project,
@@ -790,7 +2315,7 @@ struct champ
             } else if (node->datamap() & bit) {
                 auto offset = node->data_count(bit);
                 auto val    = node->values() + offset;
-                if (Equal{}(*val, k))
+                if (value_equal(node, offset, hash, k))
                     return {node_t::copy_inner_replace_value(
                                 node,
                                 offset,
@@ -805,7 +2330,7 @@ struct champ
                                   std::forward<Fn>(fn)(Default{}())),
                         hash,
                         *val,
-                        Hash{}(*val));
+                        value_hash(node, offset));
                     IMMER_TRY {
                         return {node_t::copy_inner_replace_merged(
                                     node, bit, offset, child),
@@ -821,7 +2346,8 @@ struct champ
                             node,
                             bit,
                             Combine{}(std::forward<K>(k),
-                                      std::forward<Fn>(fn)(Default{}()))),
+                                      std::forward<Fn>(fn)(Default{}())),
+                            hash),
                         true};
             }
         }
@@ -834,8 +2360,18 @@ struct champ
               typename Fn>
     champ update(const K& k, Fn&& fn) const
     {
-        auto hash = Hash{}(k);
-        auto res  = do_update<Project, Default, Combine>(
+        return update<Project, Default, Combine>(
+            k, Hash{}(k), std::forward<Fn>(fn));
+    }
+
+    template <typename Project,
+              typename Default,
+              typename Combine,
+              typename K,
+              typename Fn>
+    champ update(const K& k, hash_t hash, Fn&& fn) const
+    {
+        auto res = do_update<Project, Default, Combine>(
             root, k, std::forward<Fn>(fn), hash, 0);
         auto new_size = size + (res.added ? 1 : 0);
         return {res.node, new_size};
@@ -880,7 +2416,7 @@ struct champ
             } else if (node->datamap() & bit) {
                 auto offset = node->data_count(bit);
                 auto val    = node->values() + offset;
-                if (Equal{}(*val, k))
+                if (value_equal(node, offset, hash, k))
                     return node_t::copy_inner_replace_value(
                         node,
                         offset,
@@ -979,7 +2515,7 @@ struct champ
             } else if (node->datamap() & bit) {
                 auto offset = node->data_count(bit);
                 auto val    = node->values() + offset;
-                if (Equal{}(*val, k)) {
+                if (value_equal(node, offset, hash, k)) {
                     if (node->can_mutate(e)) {
                         auto vals    = node->ensure_mutable_values(e);
                         vals[offset] = Combine{}(std::forward<K>(k),
@@ -998,7 +2534,7 @@ struct champ
                 } else {
                     auto mutate        = node->can_mutate(e);
                     auto mutate_values = mutate && node->can_mutate_values(e);
-                    auto hash2         = Hash{}(*val);
+                    auto hash2         = value_hash(node, offset);
                     auto child         = node_t::make_merged_e(
                         e,
                         shift + B,
@@ -1024,9 +2560,9 @@ struct champ
                 auto v      = Combine{}(std::forward<K>(k),
                                    std::forward<Fn>(fn)(Default{}()));
                 auto r      = mutate ? node_t::move_inner_insert_value(
-                                      e, node, bit, std::move(v))
+                                      e, node, bit, std::move(v), hash)
                                      : node_t::copy_inner_insert_value(
-                                      node, bit, std::move(v));
+                                      node, bit, std::move(v), hash);
                 return {node_t::owned_values(r, e), true, mutate};
             }
         }
@@ -1039,8 +2575,18 @@ struct champ
               typename Fn>
     void update_mut(edit_t e, const K& k, Fn&& fn)
     {
-        auto hash = Hash{}(k);
-        auto res  = do_update_mut<Project, Default, Combine>(
+        update_mut<Project, Default, Combine>(
+            e, k, Hash{}(k), std::forward<Fn>(fn));
+    }
+
+    template <typename Project,
+              typename Default,
+              typename Combine,
+              typename K,
+              typename Fn>
+    void update_mut(edit_t e, const K& k, hash_t hash, Fn&& fn)
+    {
+        auto res = do_update_mut<Project, Default, Combine>(
             e, root, k, std::forward<Fn>(fn), hash, 0);
         if (!res.mutated && root->dec())
             node_t::delete_deep(root, 0);
@@ -1121,7 +2667,7 @@ struct champ
             } else if (node->datamap() & bit) {
                 auto offset = node->data_count(bit);
                 auto val    = node->values() + offset;
-                if (Equal{}(*val, k)) {
+                if (value_equal(node, offset, hash, k)) {
                     if (node->can_mutate(e)) {
                         auto vals    = node->ensure_mutable_values(e);
                         vals[offset] = Combine{}(std::forward<K>(k),
@@ -1179,11 +2725,13 @@ struct champ
 
         kind_t kind;
         data_t data;
+        hash_t hash; // of the singleton, only set when hashes are cached
 
         sub_result()
             : kind{nothing} {};
-        sub_result(T* x)
+        sub_result(T* x, hash_t h)
             : kind{singleton}
+            , hash{h}
         {
             data.singleton = x;
         };
@@ -1205,7 +2753,7 @@ struct champ
                 if (Equal{}(*cur, k))
                     return node->collision_count() > 2
                                ? node_t::copy_collision_remove(node, cur)
-                               : sub_result{fst + (cur == fst)};
+                               : sub_result{fst + (cur == fst), hash};
 #if !defined(_MSC_VER)
 #if defined(__GNUC__) && !defined(__clang__)
 #pragma GCC diagnostic push
@@ -1235,7 +2783,11 @@ struct champ
                                    node->children_count() == 1 && shift > 0
                                ? result
                                : node_t::copy_inner_replace_inline(
-                                     node, bit, offset, *result.data.singleton);
+                                     node,
+                                     bit,
+                                     offset,
+                                     *result.data.singleton,
+                                     result.hash);
                 case sub_result::tree:
                     IMMER_TRY {
                         return node_t::copy_inner_replace(
@@ -1248,18 +2800,20 @@ struct champ
                 }
             } else if (node->datamap() & bit) {
                 auto offset = node->data_count(bit);
-                auto val    = node->values() + offset;
-                if (Equal{}(*val, k)) {
+                if (value_equal(node, offset, hash, k)) {
                     auto nv = node->data_count();
                     if (node->nodemap() || nv > 2)
                         return node_t::copy_inner_remove_value(
                             node, bit, offset);
                     else if (nv == 2) {
-                        return shift > 0 ? sub_result{node->values() + !offset}
-                                         : node_t::make_inner_n(
-                                               0,
-                                               node->datamap() & ~bit,
-                                               node->values()[!offset]);
+                        return shift > 0
+                                   ? sub_result{node->values() + !offset,
+                                                cached_hash(node, !offset)}
+                                   : node_t::make_inner_n(
+                                         0,
+                                         node->datamap() & ~bit,
+                                         node->values()[!offset],
+                                         cached_hash(node, !offset));
                     } else {
                         assert(shift == 0);
                         return empty();
@@ -1292,33 +2846,38 @@ struct champ
 
         kind_t kind;
         data_t data;
+        hash_t hash;
         bool owned;
         bool mutated;
 
         sub_result_mut(sub_result a)
             : kind{a.kind}
             , data{a.data}
+            , hash{a.hash}
             , owned{false}
             , mutated{false}
         {}
         sub_result_mut(sub_result a, bool m)
             : kind{a.kind}
             , data{a.data}
+            , hash{a.hash}
             , owned{false}
             , mutated{m}
         {}
         sub_result_mut()
             : kind{kind_t::nothing}
             , mutated{false} {};
-        sub_result_mut(T* x, bool m)
+        sub_result_mut(T* x, hash_t h, bool m)
             : kind{kind_t::singleton}
+            , hash{h}
             , owned{m}
             , mutated{m}
         {
             data.singleton = x;
         };
-        sub_result_mut(T* x, bool o, bool m)
+        sub_result_mut(T* x, hash_t h, bool o, bool m)
             : kind{kind_t::singleton}
+            , hash{h}
             , owned{o}
             , mutated{m}
         {
@@ -1352,9 +2911,10 @@ struct champ
                             auto r = new (store)
                                 T{std::move(node->collisions()[cur == fst])};
                             node_t::delete_collision(node);
-                            return sub_result_mut{r, true};
+                            return sub_result_mut{r, hash, true};
                         } else {
-                            return sub_result_mut{fst + (cur == fst), false};
+                            return sub_result_mut{
+                                fst + (cur == fst), hash, false};
                         }
                     } else {
                         auto r = mutate
@@ -1386,7 +2946,10 @@ struct champ
                             if (!result.mutated && child->dec())
                                 node_t::delete_deep_shift(child, shift + B);
                         }
-                        return {result.data.singleton, result.owned, mutate};
+                        return {result.data.singleton,
+                                result.hash,
+                                result.owned,
+                                mutate};
                     } else {
                         auto r =
                             mutate ? node_t::move_inner_replace_inline(
@@ -1396,12 +2959,14 @@ struct champ
                                          offset,
                                          result.owned
                                              ? std::move(*result.data.singleton)
-                                             : *result.data.singleton)
+                                             : *result.data.singleton,
+                                         result.hash)
                                    : node_t::copy_inner_replace_inline(
                                          node,
                                          bit,
                                          offset,
-                                         *result.data.singleton);
+                                         *result.data.singleton,
+                                         result.hash);
                         if (result.owned)
                             detail::destroy_at(result.data.singleton);
                         if (!result.mutated && mutate && child->dec())
@@ -1429,9 +2994,8 @@ struct champ
                 }
             } else if (node->datamap() & bit) {
                 auto offset        = node->data_count(bit);
-                auto val           = node->values() + offset;
                 auto mutate_values = mutate && node->can_mutate_values(e);
-                if (Equal{}(*val, k)) {
+                if (value_equal(node, offset, hash, k)) {
                     auto nv = node->data_count();
                     if (node->nodemap() || nv > 2) {
                         auto r = mutate ? node_t::move_inner_remove_value(
@@ -1441,20 +3005,22 @@ struct champ
                         return {node_t::owned_values_safe(r, e), mutate};
                     } else if (nv == 2) {
                         if (shift > 0) {
+                            auto h = cached_hash(node, !offset);
                             if (mutate_values) {
                                 auto r = new (store)
                                     T{std::move(node->values()[!offset])};
                                 node_t::delete_inner(node);
-                                return {r, true};
+                                return {r, h, true};
                             } else {
-                                return {node->values() + !offset, false};
+                                return {node->values() + !offset, h, false};
                             }
                         } else {
                             auto& v = node->values()[!offset];
                             auto r  = node_t::make_inner_n(
                                 0,
                                 node->datamap() & ~bit,
-                                mutate_values ? std::move(v) : v);
+                                mutate_values ? std::move(v) : v,
+                                cached_hash(node, !offset));
                             assert(!node->nodemap());
                             if (mutate)
                                 node_t::delete_inner(node);
@@ -1529,6 +3095,8 @@ struct champ
     template <typename Eq>
     static bool equals_collisions(const T* a, const T* b, count_t n)
     {
+        if (node_t::sorted_collisions)
+            return std::equal(a, a + n, b, Eq{});
         auto ae = a + n;
         auto be = b + n;
         for (; a != ae; ++a) {
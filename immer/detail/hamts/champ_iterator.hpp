@@ -61,6 +61,15 @@ struct champ_iterator
         std::copy(other.path_, other.path_ + depth_ + 1, path_);
     }
 
+    champ_iterator& operator=(const champ_iterator& other)
+    {
+        cur_   = other.cur_;
+        end_   = other.end_;
+        depth_ = other.depth_;
+        std::copy(other.path_, other.path_ + depth_ + 1, path_);
+        return *this;
+    }
+
 private:
     friend iterator_core_access;
 
@@ -85,7 +94,11 @@ private:
             if (parent->nodemap()) {
                 ++depth_;
                 path_[depth_] = parent->children();
-                auto child    = *path_[depth_];
+                // the siblings are visited next, fetch them already
+                auto last = path_[depth_] + parent->children_count();
+                for (auto it = path_[depth_] + 1; it < last; ++it)
+                    IMMER_PREFETCH_READ(*it);
+                auto child = *path_[depth_];
                 assert(child);
                 if (depth_ < max_depth<B>) {
                     if (child->datamap()) {
@@ -112,6 +125,9 @@ private:
                 path_[depth_] = next;
                 auto child    = *path_[depth_];
                 assert(child);
+                if (depth_ < max_depth<B> && next + 1 < last &&
+                    next[1]->datamap())
+                    IMMER_PREFETCH_READ(next[1]->values());
                 if (depth_ < max_depth<B>) {
                     if (child->datamap()) {
                         cur_ = child->values();
@@ -148,6 +164,46 @@ private:
     const T& dereference() const { return *cur_; }
 };
 
+// Iterates over a champ whose values are boxes, see `stored_value`,
+// yielding the values in the boxes.
+template <typename T, typename Hash, typename Eq, typename MP, bits_t B>
+struct champ_unboxing_iterator
+    : iterator_facade<champ_unboxing_iterator<T, Hash, Eq, MP, B>,
+                      std::forward_iterator_tag,
+                      typename T::value_type,
+                      const typename T::value_type&,
+                      std::ptrdiff_t,
+                      const typename T::value_type*>
+{
+    using base_t = champ_iterator<T, Hash, Eq, MP, B>;
+    using tree_t = typename base_t::tree_t;
+    using end_t  = typename base_t::end_t;
+
+    champ_unboxing_iterator() = default;
+
+    champ_unboxing_iterator(const tree_t& v)
+        : base_{v}
+    {}
+
+    champ_unboxing_iterator(const tree_t& v, end_t)
+        : base_{v, end_t{}}
+    {}
+
+private:
+    friend iterator_core_access;
+
+    base_t base_;
+
+    void increment() { ++base_; }
+
+    bool equal(const champ_unboxing_iterator& other) const
+    {
+        return base_ == other.base_;
+    }
+
+    const typename T::value_type& dereference() const { return base_->get(); }
+};
+
 } // namespace hamts
 } // namespace detail
 } // namespace immer
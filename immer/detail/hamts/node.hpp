@@ -11,15 +11,98 @@
 #include <immer/config.hpp>
 #include <immer/detail/combine_standard_layout.hpp>
 #include <immer/detail/hamts/bits.hpp>
+#include <immer/detail/type_traits.hpp>
 #include <immer/detail/util.hpp>
+#include <immer/trace.hpp>
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
+#include <type_traits>
 
 namespace immer {
 namespace detail {
 namespace hamts {
 
+/*!
+ * Whether the CHAMP nodes should store the hash of every value next to
+ * it, which is enabled by hash functions that define a `cache_hashes`
+ * static member that is `true`.
+ */
+template <typename Hash, typename = void>
+struct hash_caching : std::false_type
+{};
+
+template <typename Hash>
+struct hash_caching<Hash, std::enable_if_t<Hash::cache_hashes>>
+    : std::true_type
+{};
+
+/*!
+ * Ordering of the collision nodes of hash functions that do not define
+ * a `collision_less` member type: they are kept in insertion order.
+ */
+struct unordered_collisions
+{
+    template <typename A, typename B>
+    bool operator()(const A&, const B&) const
+    {
+        return false;
+    }
+};
+
+/*!
+ * The function object that orders the values in the collision nodes,
+ * which is the `collision_less` member type of hash functions that
+ * define one.
+ */
+template <typename Hash, typename = void>
+struct collision_ordering
+{
+    using type = unordered_collisions;
+};
+
+template <typename Hash>
+struct collision_ordering<Hash, void_t<typename Hash::collision_less>>
+{
+    using type = typename Hash::collision_less;
+};
+
+/*!
+ * Orders values of type `Value` by the keys that `KeyFn` extracts from
+ * them, with the collision ordering of `Hash`, for the containers
+ * whose hash functions only see the keys.
+ */
+template <typename Hash, typename Value, typename KeyFn>
+struct key_collision_less
+{
+    using less_t = typename collision_ordering<Hash>::type;
+
+    bool operator()(const Value& a, const Value& b) const
+    {
+        return less_t{}(KeyFn{}(a), KeyFn{}(b));
+    }
+
+    template <typename Key>
+    bool operator()(const Value& a, const Key& b) const
+    {
+        return less_t{}(KeyFn{}(a), b);
+    }
+
+    template <typename Key>
+    bool operator()(const Key& a, const Value& b) const
+    {
+        return less_t{}(a, KeyFn{}(b));
+    }
+};
+
+template <typename Hash, typename Value, typename KeyFn>
+using key_collision_less_t = std::conditional_t<
+    std::is_same<typename collision_ordering<Hash>::type,
+                 unordered_collisions>::value,
+    unordered_collisions,
+    key_collision_less<Hash, Value, KeyFn>>;
+
 // For C++14 support.
 // Calling the destructor inline breaks MSVC in some obscure
 // corner cases.
@@ -44,6 +127,22 @@ struct node
     using value_t     = T;
     using bitmap_t    = typename get_bitmap_type<B>::type;
 
+    // when enabled, the full hash of every value in the data arrays of
+    // inner nodes is stored after the values, in the same block
+    static constexpr bool cache_hashes = hash_caching<Hash>::value;
+
+    // when enabled, the values in the collision nodes are kept sorted
+    // by `collision_less`, so that they can be looked up by bisection
+    using collision_less = typename collision_ordering<Hash>::type;
+    static constexpr bool sorted_collisions =
+        !std::is_same<collision_less, unordered_collisions>::value;
+
+    // when enabled, the values of the inner nodes that are made with
+    // them are put in the same block, after the children, saving an
+    // allocation and its header, but such values are never shared:
+    // updating a child copies them
+    static constexpr bool embed_values = memory::embed_values;
+
     enum class kind_t
     {
         collision,
@@ -89,11 +188,20 @@ struct node
 
     impl_t impl;
 
+    constexpr static std::size_t hashes_offset_n(count_t count)
+    {
+        return (immer_offsetof(values_t, d.buffer) +
+                sizeof(values_data_t::buffer) * count + alignof(hash_t) - 1) &
+               ~(alignof(hash_t) - 1);
+    }
+
     constexpr static std::size_t sizeof_values_n(count_t count)
     {
         return std::max(sizeof(values_t),
-                        immer_offsetof(values_t, d.buffer) +
-                            sizeof(values_data_t::buffer) * count);
+                        cache_hashes
+                            ? hashes_offset_n(count) + sizeof(hash_t) * count
+                            : immer_offsetof(values_t, d.buffer) +
+                                  sizeof(values_data_t::buffer) * count);
     }
 
     constexpr static std::size_t sizeof_collision_n(count_t count)
@@ -108,6 +216,28 @@ struct node
                sizeof(inner_t::buffer) * count;
     }
 
+    constexpr static std::size_t embedded_values_offset_n(count_t count)
+    {
+        return (sizeof_inner_n(count) + alignof(values_t) - 1) &
+               ~(alignof(values_t) - 1);
+    }
+
+    constexpr static std::size_t sizeof_inner_n(count_t count, count_t nv)
+    {
+        return embed_values && nv ? embedded_values_offset_n(count) +
+                                        sizeof_values_n(nv)
+                                  : sizeof_inner_n(count);
+    }
+
+    // whether the values of `p`, that has `count` children, are in the
+    // block of the node itself
+    static bool embeds_values(const node_t* p, count_t count)
+    {
+        return embed_values &&
+               (const char*) p->impl.d.data.inner.values ==
+                   (const char*) p + embedded_values_offset_n(count);
+    }
+
 #if IMMER_TAGGED_NODE
     kind_t kind() const { return impl.d.kind; }
 #endif
@@ -126,6 +256,26 @@ struct node
         return (const T*) &impl.d.data.inner.values->d.buffer;
     }
 
+    static hash_t* hashes(values_t* p, count_t count)
+    {
+        assert(cache_hashes);
+        return (hash_t*) ((char*) p + hashes_offset_n(count));
+    }
+
+    hash_t* hashes()
+    {
+        IMMER_ASSERT_TAGGED(kind() == kind_t::inner);
+        assert(impl.d.data.inner.values);
+        return hashes(impl.d.data.inner.values, data_count());
+    }
+
+    const hash_t* hashes() const
+    {
+        IMMER_ASSERT_TAGGED(kind() == kind_t::inner);
+        assert(impl.d.data.inner.values);
+        return hashes(impl.d.data.inner.values, data_count());
+    }
+
     auto children()
     {
         IMMER_ASSERT_TAGGED(kind() == kind_t::inner);
@@ -222,10 +372,71 @@ struct node
         return can_mutate(impl.d.data.inner.values, e);
     }
 
+    // These keep the cached hashes of `dst` in sync with its values,
+    // which are those of `src` with the value at `offset` removed or
+    // a value with `hash` inserted at `offset`.  They do nothing when
+    // the hashes are not cached.
+
+    static void copy_hashes(const node_t* src, node_t* dst)
+    {
+        if (cache_hashes && src->datamap()) {
+            auto srcp = src->hashes();
+            std::copy(srcp, srcp + src->data_count(), dst->hashes());
+        }
+    }
+
+    static void
+    copy_hashes_remove(const node_t* src, node_t* dst, count_t offset)
+    {
+        if (cache_hashes && dst->datamap()) {
+            auto srcp = src->hashes();
+            auto dstp = dst->hashes();
+            std::copy(srcp, srcp + offset, dstp);
+            std::copy(srcp + offset + 1, srcp + src->data_count(), dstp + offset);
+        }
+    }
+
+    static void copy_hashes_insert(const node_t* src,
+                                   node_t* dst,
+                                   count_t offset,
+                                   hash_t hash)
+    {
+        if (cache_hashes) {
+            auto dstp = dst->hashes();
+            if (src->datamap()) {
+                auto srcp = src->hashes();
+                std::copy(srcp, srcp + offset, dstp);
+                std::copy(
+                    srcp + offset, srcp + src->data_count(), dstp + offset + 1);
+            }
+            dstp[offset] = hash;
+        }
+    }
+
     static node_t* make_inner_n(count_t n)
     {
         assert(n <= branches<B>);
-        auto m = heap::allocate(sizeof_inner_n(n));
+        return make_inner_n_into(heap::allocate(sizeof_inner_n(n)));
+    }
+
+    /*!
+     * Returns the empty node shared by all the tries of this node
+     * type.  It lives in static storage, so making it never allocates,
+     * and it keeps a reference of its own, so it is never freed nor
+     * mutated in place.  The caller increments the count.
+     */
+    static node_t* empty()
+    {
+        static const auto empty_ = [] {
+            static std::aligned_storage_t<sizeof_inner_n(0), alignof(node_t)>
+                storage;
+            return make_inner_n_into(&storage);
+        }();
+        return empty_;
+    }
+
+    static node_t* make_inner_n_into(void* m)
+    {
         auto p = new (m) node_t;
         assert(p == (node_t*) m);
 #if IMMER_TAGGED_NODE
@@ -250,6 +461,19 @@ struct node
     static node_t* make_inner_n(count_t n, count_t nv)
     {
         assert(nv <= branches<B>);
+        if (embed_values && nv) {
+            assert(n <= branches<B>);
+            auto m = heap::allocate(sizeof_inner_n(n, nv));
+            auto p = new (m) node_t;
+#if IMMER_TAGGED_NODE
+            p->impl.d.kind = node_t::kind_t::inner;
+#endif
+            p->impl.d.data.inner.nodemap = 0;
+            p->impl.d.data.inner.datamap = 0;
+            p->impl.d.data.inner.values  = new (
+                static_cast<char*>(m) + embedded_values_offset_n(n)) values_t{};
+            return p;
+        }
         auto p = make_inner_n(n);
         if (nv) {
             IMMER_TRY {
@@ -264,6 +488,31 @@ struct node
         return p;
     }
 
+    // Makes a node for `n` children with the values of `src`, that are
+    // shared with it unless they are embedded in it, in which case they
+    // are copied
+    static node_t* make_inner_n_values_of(count_t n, node_t* src)
+    {
+        auto nc = src->children_count();
+        if (!embeds_values(src, nc))
+            return make_inner_n(n, src->impl.d.data.inner.values);
+        auto nv = src->data_count();
+        auto p  = make_inner_n(n, nv);
+        IMMER_TRY {
+            detail::uninitialized_copy(
+                src->values(), src->values() + nv, p->values());
+        }
+        IMMER_CATCH (...) {
+            deallocate_inner(p, n, nv);
+            IMMER_RETHROW;
+        }
+        if (cache_hashes) {
+            auto srch = hashes(src->impl.d.data.inner.values, nv);
+            std::copy(srch, srch + nv, hashes(p->impl.d.data.inner.values, nv));
+        }
+        return p;
+    }
+
     static node_t* make_inner_n(count_t n, count_t idx, node_t* child)
     {
         assert(n >= 1);
@@ -273,7 +522,7 @@ struct node
         return p;
     }
 
-    static node_t* make_inner_n(count_t n, bitmap_t bitmap, T x)
+    static node_t* make_inner_n(count_t n, bitmap_t bitmap, T x, hash_t hash)
     {
         auto p                       = make_inner_n(n, 1);
         p->impl.d.data.inner.datamap = bitmap;
@@ -284,16 +533,27 @@ struct node
             deallocate_inner(p, n, 1);
             IMMER_RETHROW;
         }
+        if (cache_hashes)
+            p->hashes()[0] = hash;
         return p;
     }
 
-    static node_t*
-    make_inner_n(count_t n, count_t idx1, T x1, count_t idx2, T x2)
+    static node_t* make_inner_n(count_t n,
+                                count_t idx1,
+                                T x1,
+                                hash_t hash1,
+                                count_t idx2,
+                                T x2,
+                                hash_t hash2)
     {
         assert(idx1 != idx2);
         auto p = make_inner_n(n, 2);
         p->impl.d.data.inner.datamap =
             (bitmap_t{1u} << idx1) | (bitmap_t{1u} << idx2);
+        if (cache_hashes) {
+            p->hashes()[0] = idx1 < idx2 ? hash1 : hash2;
+            p->hashes()[1] = idx1 < idx2 ? hash2 : hash1;
+        }
         auto assign = [&](auto&& x1, auto&& x2) {
             auto vp = p->values();
             IMMER_TRY {
@@ -320,6 +580,7 @@ struct node
 
     static node_t* make_collision_n(count_t n)
     {
+        IMMER_TRACE_HOOK(collision_node, n);
         auto m = heap::allocate(sizeof_collision_n(n));
         auto p = new (m) node_t;
 #if IMMER_TAGGED_NODE
@@ -329,8 +590,22 @@ struct node
         return p;
     }
 
+    // Restores the order of the values of the collision node `p` after
+    // they were constructed in any order
+    static void sort_collisions(node_t* p)
+    {
+        sort_collisions(p, std::integral_constant<bool, sorted_collisions>{});
+    }
+    static void sort_collisions(node_t*, std::false_type) {}
+    static void sort_collisions(node_t* p, std::true_type)
+    {
+        auto fst = p->collisions();
+        std::sort(fst, fst + p->collision_count(), collision_less{});
+    }
+
     static node_t* make_collision(T v1, T v2)
     {
+        IMMER_TRACE_HOOK(collision_node, 2);
         auto m = heap::allocate(sizeof_collision_n(2));
         auto p = new (m) node_t;
 #if IMMER_TAGGED_NODE
@@ -338,10 +613,14 @@ struct node
 #endif
         p->impl.d.data.collision.count = 2;
         auto cols                      = p->collisions();
+        auto x1                        = &v1;
+        auto x2                        = &v2;
+        if (sorted_collisions && collision_less{}(v2, v1))
+            std::swap(x1, x2);
         IMMER_TRY {
-            new (cols) T{std::move(v1)};
+            new (cols) T{std::move(*x1)};
             IMMER_TRY {
-                new (cols + 1) T{std::move(v2)};
+                new (cols + 1) T{std::move(*x2)};
             }
             IMMER_CATCH (...) {
                 cols->~T();
@@ -359,7 +638,8 @@ struct node
     {
         assert(can_mutate(e));
         auto old = impl.d.data.inner.values;
-        if (node_t::can_mutate(old, e))
+        if (embeds_values(this, children_count()) ||
+            node_t::can_mutate(old, e))
             return values();
         else {
             auto nv    = data_count();
@@ -374,6 +654,10 @@ struct node
                 deallocate_values(nxt, nv);
                 IMMER_RETHROW;
             }
+            if (cache_hashes) {
+                auto srch = hashes(old, nv);
+                std::copy(srch, srch + nv, hashes(nxt, nv));
+            }
             impl.d.data.inner.values = nxt;
             if (refs(old).dec())
                 delete_values(old, nv);
@@ -381,8 +665,67 @@ struct node
         }
     }
 
+    // Makes a collision node with the values of `src`, that are moved
+    // out of it when `Move`, and `v` in its sorted position.  Values
+    // that are relocatable are moved with `memmove` instead.
+    template <bool Move>
+    static node_t* collision_insert_sorted(node_t* src, T v)
+    {
+        IMMER_ASSERT_TAGGED(src->kind() == kind_t::collision);
+        auto put = [](T* first, T* last, T* out) {
+            return Move ? detail::uninitialized_move(first, last, out)
+                        : detail::uninitialized_copy(first, last, out);
+        };
+
+        auto n    = src->collision_count();
+        auto srcp = src->collisions();
+        auto pos  = std::upper_bound(srcp, srcp + n, v, collision_less{});
+        auto dst  = make_collision_n(n + 1);
+        auto dstp = dst->collisions();
+        auto mid  = dstp + (pos - srcp);
+        if (Move && detail::can_relocate<T>) {
+            IMMER_TRY {
+                new (mid) T{std::move(v)};
+            }
+            IMMER_CATCH (...) {
+                deallocate_collision(dst, n + 1);
+                IMMER_RETHROW;
+            }
+            detail::uninitialized_relocate(srcp, pos, dstp);
+            detail::uninitialized_relocate(pos, srcp + n, mid + 1);
+            delete_collision_relocated(src, n);
+            return dst;
+        }
+        IMMER_TRY {
+            put(srcp, pos, dstp);
+            IMMER_TRY {
+                new (mid) T{std::move(v)};
+                IMMER_TRY {
+                    put(pos, srcp + n, mid + 1);
+                }
+                IMMER_CATCH (...) {
+                    mid->~T();
+                    IMMER_RETHROW;
+                }
+            }
+            IMMER_CATCH (...) {
+                detail::destroy(dstp, mid);
+                IMMER_RETHROW;
+            }
+        }
+        IMMER_CATCH (...) {
+            deallocate_collision(dst, n + 1);
+            IMMER_RETHROW;
+        }
+        if (Move)
+            delete_collision(src);
+        return dst;
+    }
+
     static node_t* copy_collision_insert(node_t* src, T v)
     {
+        if (sorted_collisions)
+            return collision_insert_sorted<false>(src, std::move(v));
         IMMER_ASSERT_TAGGED(src->kind() == kind_t::collision);
         auto n    = src->collision_count();
         auto dst  = make_collision_n(n + 1);
@@ -407,6 +750,8 @@ struct node
 
     static node_t* move_collision_insert(node_t* src, T v)
     {
+        if (sorted_collisions)
+            return collision_insert_sorted<true>(src, std::move(v));
         IMMER_ASSERT_TAGGED(src->kind() == kind_t::collision);
         auto n    = src->collision_count();
         auto dst  = make_collision_n(n + 1);
@@ -415,6 +760,11 @@ struct node
         IMMER_TRY {
             new (dstp) T{std::move(v)};
             IMMER_TRY {
+                if (detail::can_relocate<T>) {
+                    detail::uninitialized_relocate(srcp, srcp + n, dstp + 1);
+                    delete_collision_relocated(src, n);
+                    return dst;
+                }
                 detail::uninitialized_move(srcp, srcp + n, dstp + 1);
             }
             IMMER_CATCH (...) {
@@ -463,6 +813,13 @@ struct node
         auto dst  = make_collision_n(n - 1);
         auto srcp = src->collisions();
         auto dstp = dst->collisions();
+        if (detail::can_relocate<T>) {
+            dstp = detail::uninitialized_relocate(srcp, v, dstp);
+            detail::uninitialized_relocate(v + 1, srcp + n, dstp);
+            v->~T();
+            delete_collision_relocated(src, n);
+            return dst;
+        }
         IMMER_TRY {
             dstp = detail::uninitialized_move(srcp, v, dstp);
             IMMER_TRY {
@@ -481,8 +838,44 @@ struct node
         return dst;
     }
 
+    // Makes a copy of the collision node `src` with `v` in place of the
+    // value at `pos`, which has the same key, so the order is kept
+    static node_t* collision_replace_sorted(node_t* src, T* pos, T v)
+    {
+        IMMER_ASSERT_TAGGED(src->kind() == kind_t::collision);
+        auto n    = src->collision_count();
+        auto srcp = src->collisions();
+        auto dst  = make_collision_n(n);
+        auto dstp = dst->collisions();
+        auto mid  = dstp + (pos - srcp);
+        IMMER_TRY {
+            detail::uninitialized_copy(srcp, pos, dstp);
+            IMMER_TRY {
+                new (mid) T{std::move(v)};
+                IMMER_TRY {
+                    detail::uninitialized_copy(pos + 1, srcp + n, mid + 1);
+                }
+                IMMER_CATCH (...) {
+                    mid->~T();
+                    IMMER_RETHROW;
+                }
+            }
+            IMMER_CATCH (...) {
+                detail::destroy(dstp, mid);
+                IMMER_RETHROW;
+            }
+        }
+        IMMER_CATCH (...) {
+            deallocate_collision(dst, n);
+            IMMER_RETHROW;
+        }
+        return dst;
+    }
+
     static node_t* copy_collision_replace(node_t* src, T* pos, T v)
     {
+        if (sorted_collisions)
+            return collision_replace_sorted(src, pos, std::move(v));
         IMMER_ASSERT_TAGGED(src->kind() == kind_t::collision);
         auto n    = src->collision_count();
         auto dst  = make_collision_n(n);
@@ -518,7 +911,7 @@ struct node
     {
         IMMER_ASSERT_TAGGED(src->kind() == kind_t::inner);
         auto n    = src->children_count();
-        auto dst  = make_inner_n(n, src->impl.d.data.inner.values);
+        auto dst  = make_inner_n_values_of(n, src);
         auto srcp = src->children();
         auto dstp = dst->children();
         dst->impl.d.data.inner.datamap = src->datamap();
@@ -577,6 +970,7 @@ struct node
         }
         inc_nodes(src->children(), n);
         std::copy(src->children(), src->children() + n, dst->children());
+        copy_hashes(src, dst);
         return dst;
     }
 
@@ -620,6 +1014,7 @@ struct node
                   src->children() + n,
                   dst->children() + noffset + 1);
         dst->children()[noffset] = node;
+        copy_hashes_remove(src, dst, voffset);
         return dst;
     }
 
@@ -671,6 +1066,7 @@ struct node
                   src->children() + n,
                   dst->children() + noffset + 1);
         dst->children()[noffset] = node;
+        copy_hashes_remove(src, dst, voffset);
         delete_inner(src);
         return dst;
     }
@@ -678,7 +1074,8 @@ struct node
     static node_t* copy_inner_replace_inline(node_t* src,
                                              bitmap_t bit,
                                              count_t noffset,
-                                             T value)
+                                             T value,
+                                             hash_t hash)
     {
         IMMER_ASSERT_TAGGED(src->kind() == kind_t::inner);
         assert(!(src->datamap() & bit));
@@ -722,11 +1119,17 @@ struct node
         std::copy(src->children() + noffset + 1,
                   src->children() + n,
                   dst->children() + noffset);
+        copy_hashes_insert(src, dst, voffset, hash);
         return dst;
     }
 
     static node_t* move_inner_replace_inline(
-        edit_t e, node_t* src, bitmap_t bit, count_t noffset, T value)
+        edit_t e,
+        node_t* src,
+        bitmap_t bit,
+        count_t noffset,
+        T value,
+        hash_t hash)
     {
         IMMER_ASSERT_TAGGED(src->kind() == kind_t::inner);
         assert(!(src->datamap() & bit));
@@ -783,6 +1186,7 @@ struct node
         std::copy(src->children() + noffset + 1,
                   src->children() + n,
                   dst->children() + noffset);
+        copy_hashes_insert(src, dst, voffset, hash);
         delete_inner(src);
         return dst;
     }
@@ -820,6 +1224,7 @@ struct node
         }
         inc_nodes(src->children(), n);
         std::copy(src->children(), src->children() + n, dst->children());
+        copy_hashes_remove(src, dst, voffset);
         return dst;
     }
 
@@ -878,11 +1283,15 @@ struct node
             }
         }
         std::copy(src->children(), src->children() + n, dst->children());
+        copy_hashes_remove(src, dst, voffset);
         delete_inner(src);
         return dst;
     }
 
-    static node_t* copy_inner_insert_value(node_t* src, bitmap_t bit, T v)
+    static node_t* copy_inner_insert_value(node_t* src,
+                                           bitmap_t bit,
+                                           T v,
+                                           hash_t hash)
     {
         IMMER_ASSERT_TAGGED(src->kind() == kind_t::inner);
         auto n                         = src->children_count();
@@ -919,11 +1328,13 @@ struct node
         }
         inc_nodes(src->children(), n);
         std::copy(src->children(), src->children() + n, dst->children());
+        copy_hashes_insert(src, dst, offset, hash);
         return dst;
     }
 
     static node_t*
-    move_inner_insert_value(edit_t e, node_t* src, bitmap_t bit, T v)
+    move_inner_insert_value(
+        edit_t e, node_t* src, bitmap_t bit, T v, hash_t hash)
     {
         IMMER_ASSERT_TAGGED(src->kind() == kind_t::inner);
         auto n                         = src->children_count();
@@ -974,6 +1385,7 @@ struct node
             IMMER_RETHROW;
         }
         std::copy(src->children(), src->children() + n, dst->children());
+        copy_hashes_insert(src, dst, offset, hash);
         delete_inner(src);
         return dst;
     }
@@ -999,8 +1411,10 @@ struct node
                 return make_inner_n(0,
                                     static_cast<count_t>(idx1 >> shift),
                                     std::move(v1),
+                                    hash1,
                                     static_cast<count_t>(idx2 >> shift),
-                                    std::move(v2));
+                                    std::move(v2),
+                                    hash2);
             }
         } else {
             return make_collision(std::move(v1), std::move(v2));
@@ -1030,8 +1444,10 @@ struct node
                 auto r = make_inner_n(0,
                                       static_cast<count_t>(idx1 >> shift),
                                       std::move(v1),
+                                      hash1,
                                       static_cast<count_t>(idx2 >> shift),
-                                      std::move(v2));
+                                      std::move(v2),
+                                      hash2);
                 return owned_values(r, e);
             }
         } else {
@@ -1070,47 +1486,87 @@ struct node
     {
         assert(p);
         IMMER_ASSERT_TAGGED(p->kind() == kind_t::inner);
+        IMMER_TRACE_FREED_NODE();
         auto vp = p->impl.d.data.inner.values;
+        auto n  = p->children_count();
+        if (embeds_values(p, n)) {
+            auto nv = p->data_count();
+            detail::destroy_n((T*) &vp->d.buffer, nv);
+            deallocate_inner(p, n, nv);
+            return;
+        }
         if (vp && refs(vp).dec())
             delete_values(vp, p->data_count());
-        deallocate_inner(p, p->children_count());
+        deallocate_inner(p, n);
     }
 
     static void delete_collision(node_t* p)
     {
         assert(p);
         IMMER_ASSERT_TAGGED(p->kind() == kind_t::collision);
+        IMMER_TRACE_FREED_NODE();
         auto n = p->collision_count();
         detail::destroy_n(p->collisions(), n);
         deallocate_collision(p, n);
     }
 
+    // Frees the collision node `p`, whose `n` values were relocated
+    static void delete_collision_relocated(node_t* p, count_t n)
+    {
+        IMMER_TRACE_FREED_NODE();
+        deallocate_collision(p, n);
+    }
+
+    // Drops the references to the children of `p` in a batch, after
+    // prefetching them so that the cache misses on their reference
+    // counts overlap.  The children that died are put in `dead`,
+    // returning the end of them, and freed by the caller afterwards.
+    static node_t** dec_children(node_t* p, node_t** dead)
+    {
+        auto fst = p->children();
+        auto lst = fst + p->children_count();
+        for (auto it = fst; it != lst; ++it)
+            IMMER_PREFETCH_WRITE(&refs(*it));
+        for (; fst != lst; ++fst)
+            if ((*fst)->dec())
+                *dead++ = *fst;
+        return dead;
+    }
+
+    // Frees the dead node `p` at the depth `s` and the children that
+    // die with it.  The dead nodes that are still to be freed are kept
+    // in a work list instead of recursing, which is bounded since
+    // every node adds at most a branch less than it has, and a node is
+    // freed as soon as its children are decremented.
     static void delete_deep(node_t* p, shift_t s)
     {
-        if (s == max_depth<B>)
-            delete_collision(p);
-        else {
-            auto fst = p->children();
-            auto lst = fst + p->children_count();
-            for (; fst != lst; ++fst)
-                if ((*fst)->dec())
-                    delete_deep(*fst, s + 1);
-            delete_inner(p);
+        struct item
+        {
+            node_t* node;
+            shift_t depth;
+        };
+
+        item work[max_depth<B> * (branches<B> - 1) + 1];
+        auto top = work;
+        *top++   = {p, s};
+        while (top != work) {
+            auto it = *--top;
+            if (it.depth == max_depth<B>) {
+                delete_collision(it.node);
+                continue;
+            }
+            node_t* dead[branches<B>];
+            auto last = dec_children(it.node, dead);
+            delete_inner(it.node);
+            // the last child is pushed first, to free them in order
+            while (last != dead)
+                *top++ = {*--last, it.depth + 1};
         }
     }
 
     static void delete_deep_shift(node_t* p, shift_t s)
     {
-        if (s == max_shift<B>)
-            delete_collision(p);
-        else {
-            auto fst = p->children();
-            auto lst = fst + p->children_count();
-            for (; fst != lst; ++fst)
-                if ((*fst)->dec())
-                    delete_deep_shift(*fst, s + B);
-            delete_inner(p);
-        }
+        delete_deep(p, s / B);
     }
 
     static void deallocate_values(values_t* p, count_t n)
@@ -1131,6 +1587,10 @@ struct node
     static void deallocate_inner(node_t* p, count_t n, count_t nv)
     {
         assert(nv);
+        if (embeds_values(p, n)) {
+            heap::deallocate(node_t::sizeof_inner_n(n, nv), p);
+            return;
+        }
         heap::deallocate(node_t::sizeof_values_n(nv),
                          p->impl.d.data.inner.values);
         heap::deallocate(node_t::sizeof_inner_n(n), p);
@@ -0,0 +1,193 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace immer {
+namespace detail {
+
+/*!
+ * Process wide registry of hazard pointers, as described by Maged
+ * M. Michael in "Hazard Pointers: Safe Memory Reclamation for
+ * Lock-Free Objects".
+ *
+ * Every thread owns one slot, where it publishes the pointer it is
+ * about to dereference.  Pointers that are unlinked from a shared
+ * location are `retire()`d instead of released, and they are only
+ * released once no slot holds them.
+ */
+class hazard_domain
+{
+public:
+    struct record
+    {
+        std::atomic<const void*> ptr{nullptr};
+        std::atomic<bool> active{false};
+        record* next = nullptr;
+        // keeps the slots of different threads in different cache lines
+        char padding[64];
+    };
+
+    using release_fn = void (*)(void*);
+
+    static hazard_domain& global()
+    {
+        static hazard_domain domain_;
+        return domain_;
+    }
+
+    /*!
+     * Returns the slot of the calling thread.  It is given back to
+     * the domain when the thread exits.
+     */
+    static record& local()
+    {
+        thread_local owner owner_{global()};
+        return *owner_.rec;
+    }
+
+    hazard_domain() = default;
+    hazard_domain(const hazard_domain&) = delete;
+    hazard_domain& operator=(const hazard_domain&) = delete;
+
+    ~hazard_domain()
+    {
+        for (auto r = retired_.exchange(nullptr); r;) {
+            auto next = r->next;
+            r->release(r->ptr);
+            delete r;
+            r = next;
+        }
+        for (auto r = records_.load(); r;) {
+            auto next = r->next;
+            delete r;
+            r = next;
+        }
+    }
+
+    /*!
+     * Calls `release(p)` once no slot protects `p` any more.
+     */
+    void retire(void* p, release_fn release)
+    {
+        push(new retired_node{p, release, nullptr}, 1);
+        if (retired_count_.load(std::memory_order_relaxed) >= threshold())
+            reclaim();
+    }
+
+    /*!
+     * Releases the retired pointers that are not protected.
+     */
+    void reclaim()
+    {
+        auto r = retired_.exchange(nullptr, std::memory_order_acquire);
+        if (!r)
+            return;
+        auto hazards = std::vector<const void*>{};
+        for (auto h = records_.load(std::memory_order_acquire); h; h = h->next)
+            if (auto p = h->ptr.load(std::memory_order_seq_cst))
+                hazards.push_back(p);
+        std::sort(hazards.begin(), hazards.end());
+        auto kept      = static_cast<retired_node*>(nullptr);
+        auto kept_last = kept;
+        auto released  = std::size_t{};
+        auto kept_n    = std::size_t{};
+        while (r) {
+            auto next = r->next;
+            if (std::binary_search(hazards.begin(), hazards.end(), r->ptr)) {
+                r->next = kept;
+                kept    = r;
+                if (!kept_last)
+                    kept_last = r;
+                ++kept_n;
+            } else {
+                r->release(r->ptr);
+                delete r;
+                ++released;
+            }
+            r = next;
+        }
+        retired_count_.fetch_sub(released + kept_n, std::memory_order_relaxed);
+        if (kept)
+            push_list(kept, kept_last, kept_n);
+    }
+
+private:
+    struct retired_node
+    {
+        void* ptr;
+        release_fn release;
+        retired_node* next;
+    };
+
+    struct owner
+    {
+        record* rec;
+
+        owner(hazard_domain& d)
+            : rec{d.acquire()}
+        {}
+
+        ~owner()
+        {
+            rec->ptr.store(nullptr, std::memory_order_release);
+            rec->active.store(false, std::memory_order_release);
+        }
+    };
+
+    record* acquire()
+    {
+        for (auto r = records_.load(std::memory_order_acquire); r; r = r->next)
+            if (!r->active.load(std::memory_order_relaxed) &&
+                !r->active.exchange(true, std::memory_order_acquire))
+                return r;
+        auto r = new record{};
+        r->active.store(true, std::memory_order_relaxed);
+        r->next = records_.load(std::memory_order_relaxed);
+        while (!records_.compare_exchange_weak(
+            r->next, r, std::memory_order_release, std::memory_order_relaxed))
+            ;
+        record_count_.fetch_add(1, std::memory_order_relaxed);
+        return r;
+    }
+
+    void push(retired_node* r, std::size_t n) { push_list(r, r, n); }
+
+    void push_list(retired_node* first, retired_node* last, std::size_t n)
+    {
+        retired_count_.fetch_add(n, std::memory_order_relaxed);
+        last->next = retired_.load(std::memory_order_relaxed);
+        while (!retired_.compare_exchange_weak(last->next,
+                                               first,
+                                               std::memory_order_release,
+                                               std::memory_order_relaxed))
+            ;
+    }
+
+    // scanning the slots is amortized over a number of retired
+    // pointers that grows with the number of slots
+    std::size_t threshold() const
+    {
+        return 2 * record_count_.load(std::memory_order_relaxed) + 16;
+    }
+
+    std::atomic<record*> records_{nullptr};
+    std::atomic<std::size_t> record_count_{0};
+    std::atomic<retired_node*> retired_{nullptr};
+    std::atomic<std::size_t> retired_count_{0};
+};
+
+} // namespace detail
+} // namespace immer
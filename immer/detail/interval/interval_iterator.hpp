@@ -0,0 +1,79 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/detail/interval/interval_tree.hpp>
+#include <immer/detail/iterator_facade.hpp>
+
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+namespace immer {
+namespace detail {
+namespace interval {
+
+/*!
+ * Iterator over the associations of an interval tree in the order of
+ * their intervals.  It keeps the nodes whose left subtree has been
+ * visited but not themselves, which are at most as many as the height
+ * of the tree.
+ */
+template <typename K, typename T, typename Compare, typename MemoryPolicy>
+struct interval_iterator
+    : iterator_facade<interval_iterator<K, T, Compare, MemoryPolicy>,
+                      std::forward_iterator_tag,
+                      std::pair<std::pair<K, K>, T>,
+                      const std::pair<std::pair<K, K>, T>&,
+                      std::ptrdiff_t,
+                      const std::pair<std::pair<K, K>, T>*>
+{
+    using tree_t  = interval_tree<K, T, Compare, MemoryPolicy>;
+    using node_t  = typename tree_t::node_t;
+    using value_t = typename tree_t::value_t;
+
+    struct end_t
+    {};
+
+    interval_iterator() = default;
+
+    interval_iterator(const tree_t& v) { push_left(v.root); }
+
+    interval_iterator(const tree_t&, end_t) {}
+
+private:
+    friend iterator_core_access;
+
+    std::vector<const node_t*> path_;
+
+    void push_left(const node_t* n)
+    {
+        for (; n; n = n->left())
+            path_.push_back(n);
+    }
+
+    void increment()
+    {
+        auto n = path_.back();
+        path_.pop_back();
+        push_left(n->right());
+    }
+
+    bool equal(const interval_iterator& other) const
+    {
+        return path_.size() == other.path_.size() &&
+               (path_.empty() || path_.back() == other.path_.back());
+    }
+
+    const value_t& dereference() const { return path_.back()->value(); }
+};
+
+} // namespace interval
+} // namespace detail
+} // namespace immer
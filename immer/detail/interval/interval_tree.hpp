@@ -0,0 +1,407 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/interval/node.hpp>
+
+#include <cassert>
+#include <utility>
+
+namespace immer {
+namespace detail {
+namespace interval {
+
+/*!
+ * Persistent interval tree, mapping half-open intervals `[first,
+ * last)` of endpoints of type `K` to values of type `T`.  It is an AVL
+ * tree sorted by the intervals, first by their start and then by their
+ * end, where every node also knows the greatest end in its subtree.
+ *
+ * Like in the other trees, every update takes an edit token and
+ * whether it comes from a transient, and it consumes the reference to
+ * the nodes that it is given, also when it throws, so that the ones
+ * that it can mutate are updated in place.  The others are copied,
+ * which only happens to the @f$ O(log(n)) @f$ nodes on the path to the
+ * updated one and their siblings that are rotated.
+ */
+template <typename K, typename T, typename Compare, typename MemoryPolicy>
+struct interval_tree
+{
+    using node_t  = node<K, T, Compare, MemoryPolicy>;
+    using edit_t  = typename node_t::edit_t;
+    using value_t = typename node_t::value_t;
+    using key_t   = std::pair<K, K>;
+
+    size_t size;
+    node_t* root;
+
+    static interval_tree empty() { return {0, nullptr}; }
+
+    // The edit token of the updates that do not come from a transient.
+    static edit_t noone() { return node_t::transience::noone; }
+
+    interval_tree(size_t sz, node_t* r)
+        : size{sz}
+        , root{r}
+    {}
+
+    interval_tree(const interval_tree& other)
+        : interval_tree{other.size, node_t::inc(other.root)}
+    {}
+
+    interval_tree(interval_tree&& other)
+        : interval_tree{0, nullptr}
+    {
+        swap(*this, other);
+    }
+
+    interval_tree& operator=(const interval_tree& other)
+    {
+        auto next = other;
+        swap(*this, next);
+        return *this;
+    }
+
+    interval_tree& operator=(interval_tree&& other)
+    {
+        swap(*this, other);
+        return *this;
+    }
+
+    friend void swap(interval_tree& x, interval_tree& y)
+    {
+        using std::swap;
+        swap(x.size, y.size);
+        swap(x.root, y.root);
+    }
+
+    ~interval_tree() { node_t::release(root); }
+
+    static bool less(const key_t& a, const key_t& b)
+    {
+        auto cmp = Compare{};
+        return cmp(a.first, b.first) ||
+               (!cmp(b.first, a.first) && cmp(a.second, b.second));
+    }
+
+    const value_t* find(const key_t& k) const
+    {
+        auto n = root;
+        while (n) {
+            if (less(k, n->value().first))
+                n = n->left();
+            else if (less(n->value().first, k))
+                n = n->right();
+            else
+                return &n->value();
+        }
+        return nullptr;
+    }
+
+    // Calls `fn` with the associations whose interval overlaps `[a,
+    // b)`, in order.  The subtrees whose greatest end is not after `a`
+    // are skipped, and so are the right ones of the nodes that start
+    // at `b` or after.
+    template <typename Fn>
+    static void for_each_overlapping(const node_t* n,
+                                     const K& a,
+                                     const K& b,
+                                     Fn& fn)
+    {
+        auto cmp = Compare{};
+        while (n && cmp(a, n->max())) {
+            for_each_overlapping(n->left(), a, b, fn);
+            if (!cmp(n->first(), b))
+                return;
+            if (cmp(a, n->last()))
+                fn(n->value());
+            n = n->right();
+        }
+    }
+
+    // Calls `fn` with the associations whose interval contains `p`, in
+    // order.
+    template <typename Fn>
+    static void for_each_containing(const node_t* n, const K& p, Fn& fn)
+    {
+        auto cmp = Compare{};
+        while (n && cmp(p, n->max())) {
+            for_each_containing(n->left(), p, fn);
+            if (cmp(p, n->first()))
+                return;
+            if (cmp(p, n->last()))
+                fn(n->value());
+            n = n->right();
+        }
+    }
+
+    // Whether some interval overlaps `[a, b)`.  When the left subtree
+    // has an interval that ends after `a` and none of them overlaps,
+    // that one starts at `b` or after, and so do all the intervals on
+    // the right, so only one path is visited.
+    bool any_overlapping(const K& a, const K& b) const
+    {
+        auto cmp = Compare{};
+        auto n   = root;
+        while (n) {
+            if (cmp(n->first(), b) && cmp(a, n->last()))
+                return true;
+            n = n->left() && cmp(a, n->left()->max()) ? n->left()
+                                                       : n->right();
+        }
+        return false;
+    }
+
+    // Returns `n`, or a copy of it when it can not be mutated, in which
+    // case the reference to `n` is dropped.  When it throws, `n` is
+    // left untouched.
+    static node_t* owned(node_t* n, edit_t e, bool tr)
+    {
+        if (n->can_mutate(e, tr))
+            return n;
+        auto r = node_t::copy(n, e, tr);
+        node_t::release(n);
+        return r;
+    }
+
+    // The rotations take a node that can be mutated, and leave it
+    // untouched when they throw.
+    static node_t* rotate_right(node_t* n, edit_t e, bool tr)
+    {
+        auto l     = owned(n->left(), e, tr);
+        n->left()  = l->right();
+        l->right() = n;
+        n->fix();
+        l->fix();
+        return l;
+    }
+
+    static node_t* rotate_left(node_t* n, edit_t e, bool tr)
+    {
+        auto r     = owned(n->right(), e, tr);
+        n->right() = r->left();
+        r->left()  = n;
+        n->fix();
+        r->fix();
+        return r;
+    }
+
+    // Restores the balance of `n`, that can be mutated and whose
+    // subtrees differ in height by two at most.
+    static node_t* balance(node_t* n, edit_t e, bool tr)
+    {
+        auto hl = node_t::height(n->left());
+        auto hr = node_t::height(n->right());
+        if (hl > hr + 1) {
+            auto l = n->left();
+            if (node_t::height(l->left()) < node_t::height(l->right())) {
+                n->left() = owned(l, e, tr);
+                n->left() = rotate_left(n->left(), e, tr);
+            }
+            return rotate_right(n, e, tr);
+        } else if (hr > hl + 1) {
+            auto r = n->right();
+            if (node_t::height(r->right()) < node_t::height(r->left())) {
+                n->right() = owned(r, e, tr);
+                n->right() = rotate_right(n->right(), e, tr);
+            }
+            return rotate_left(n, e, tr);
+        }
+        n->fix();
+        return n;
+    }
+
+    // Associates `v` to its interval in the subtree `n`, that it
+    // consumes.
+    static node_t*
+    do_set(node_t* n, value_t& v, edit_t e, bool tr, bool& added)
+    {
+        if (!n) {
+            added = true;
+            return node_t::make(e, tr, std::move(v), nullptr, nullptr);
+        }
+        auto go_left  = less(v.first, n->value().first);
+        auto go_right = !go_left && less(n->value().first, v.first);
+        if (!go_left && !go_right && !n->can_mutate(e, tr)) {
+            added = false;
+            IMMER_TRY {
+                auto r = node_t::make(
+                    e, tr, std::move(v), n->left(), n->right());
+                node_t::inc(r->left());
+                node_t::inc(r->right());
+                node_t::release(n);
+                return r;
+            }
+            IMMER_CATCH (...) {
+                node_t::release(n);
+                IMMER_RETHROW;
+            }
+        }
+        IMMER_TRY {
+            n = owned(n, e, tr);
+        }
+        IMMER_CATCH (...) {
+            node_t::release(n);
+            IMMER_RETHROW;
+        }
+        IMMER_TRY {
+            if (go_left) {
+                auto l    = n->left();
+                n->left() = nullptr;
+                n->left() = do_set(l, v, e, tr, added);
+            } else if (go_right) {
+                auto r     = n->right();
+                n->right() = nullptr;
+                n->right() = do_set(r, v, e, tr, added);
+            } else {
+                added             = false;
+                n->value().second = std::move(v.second);
+                return n;
+            }
+            return balance(n, e, tr);
+        }
+        IMMER_CATCH (...) {
+            node_t::release(n);
+            IMMER_RETHROW;
+        }
+    }
+
+    // Removes the leftmost node of the subtree `n`, that it consumes,
+    // putting its association in `out`.
+    static node_t* remove_min(node_t* n, value_t& out, edit_t e, bool tr)
+    {
+        if (!n->left()) {
+            auto r = node_t::inc(n->right());
+            IMMER_TRY {
+                if (n->can_mutate(e, tr))
+                    out = std::move(n->value());
+                else
+                    out = n->value();
+            }
+            IMMER_CATCH (...) {
+                node_t::release(r);
+                node_t::release(n);
+                IMMER_RETHROW;
+            }
+            node_t::release(n);
+            return r;
+        }
+        IMMER_TRY {
+            n = owned(n, e, tr);
+        }
+        IMMER_CATCH (...) {
+            node_t::release(n);
+            IMMER_RETHROW;
+        }
+        IMMER_TRY {
+            auto l    = n->left();
+            n->left() = nullptr;
+            n->left() = remove_min(l, out, e, tr);
+            return balance(n, e, tr);
+        }
+        IMMER_CATCH (...) {
+            node_t::release(n);
+            IMMER_RETHROW;
+        }
+    }
+
+    // Removes the interval `k` from the subtree `n`, that it consumes
+    // and that must contain it.
+    static node_t* do_erase(node_t* n, const key_t& k, edit_t e, bool tr)
+    {
+        assert(n);
+        auto go_left  = less(k, n->value().first);
+        auto go_right = !go_left && less(n->value().first, k);
+        if (!go_left && !go_right && (!n->left() || !n->right())) {
+            auto c = node_t::inc(n->left() ? n->left() : n->right());
+            node_t::release(n);
+            return c;
+        }
+        IMMER_TRY {
+            n = owned(n, e, tr);
+        }
+        IMMER_CATCH (...) {
+            node_t::release(n);
+            IMMER_RETHROW;
+        }
+        IMMER_TRY {
+            if (go_left) {
+                auto l    = n->left();
+                n->left() = nullptr;
+                n->left() = do_erase(l, k, e, tr);
+            } else {
+                // the node takes the association that follows it
+                auto r     = n->right();
+                n->right() = nullptr;
+                n->right() = go_right ? do_erase(r, k, e, tr)
+                                      : remove_min(r, n->value(), e, tr);
+            }
+            return balance(n, e, tr);
+        }
+        IMMER_CATCH (...) {
+            node_t::release(n);
+            IMMER_RETHROW;
+        }
+    }
+
+    // When it throws, the tree is left empty.
+    void set_mut(edit_t e, bool tr, value_t v)
+    {
+        auto added = false;
+        auto r     = root;
+        root       = nullptr;
+        IMMER_TRY {
+            root = do_set(r, v, e, tr, added);
+        }
+        IMMER_CATCH (...) {
+            size = 0;
+            IMMER_RETHROW;
+        }
+        size += added;
+    }
+
+    // When it throws, the tree is left empty.
+    bool erase_mut(edit_t e, bool tr, const key_t& k)
+    {
+        if (!find(k))
+            return false;
+        auto r = root;
+        root   = nullptr;
+        IMMER_TRY {
+            root = do_erase(r, k, e, tr);
+        }
+        IMMER_CATCH (...) {
+            size = 0;
+            IMMER_RETHROW;
+        }
+        --size;
+        return true;
+    }
+
+    template <typename Fn>
+    static void for_each_node(const node_t* n, Fn& fn)
+    {
+        while (n) {
+            for_each_node(n->left(), fn);
+            fn(&n->value(), &n->value() + 1);
+            n = n->right();
+        }
+    }
+
+    template <typename Fn>
+    void for_each_chunk(Fn&& fn) const
+    {
+        for_each_node(root, fn);
+    }
+};
+
+} // namespace interval
+} // namespace detail
+} // namespace immer
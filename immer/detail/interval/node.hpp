@@ -0,0 +1,172 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/combine_standard_layout.hpp>
+#include <immer/detail/util.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace immer {
+namespace detail {
+namespace interval {
+
+using count_t = std::uint32_t;
+using size_t  = std::size_t;
+
+/*!
+ * Node of an interval tree.  It holds an association from an interval,
+ * that is a pair of endpoints of type `K`, to a value of type `T`, and
+ * it is annotated with the height of its subtree, to keep it balanced,
+ * and the greatest end of the intervals in it, to skip the subtrees
+ * that can not overlap a query.
+ */
+template <typename K, typename T, typename Compare, typename MemoryPolicy>
+struct node
+{
+    using node_t = node;
+
+    using memory      = MemoryPolicy;
+    using heap_policy = typename memory::heap;
+    using heap        = typename heap_policy::type;
+    using transience  = typename memory::transience_t;
+    using refs_t      = typename memory::refcount;
+    using ownee_t     = typename transience::ownee;
+    using edit_t      = typename transience::edit;
+    using value_t     = std::pair<std::pair<K, K>, T>;
+
+    struct impl_data_t
+    {
+        node_t* left;
+        node_t* right;
+        count_t height;
+        aligned_storage_for<K> max;
+        aligned_storage_for<value_t> value;
+    };
+
+    using impl_t = combine_standard_layout_t<impl_data_t, refs_t, ownee_t>;
+
+    impl_t impl;
+
+    value_t& value() { return *reinterpret_cast<value_t*>(&impl.d.value); }
+    const value_t& value() const
+    {
+        return *reinterpret_cast<const value_t*>(&impl.d.value);
+    }
+
+    K& max() { return *reinterpret_cast<K*>(&impl.d.max); }
+    const K& max() const { return *reinterpret_cast<const K*>(&impl.d.max); }
+
+    const K& first() const { return value().first.first; }
+    const K& last() const { return value().first.second; }
+
+    node_t*& left() { return impl.d.left; }
+    node_t*& right() { return impl.d.right; }
+    node_t* left() const { return impl.d.left; }
+    node_t* right() const { return impl.d.right; }
+
+    static count_t height(const node_t* n) { return n ? n->impl.d.height : 0; }
+
+    // restores the annotations of the node after its children or its
+    // interval changed
+    void fix()
+    {
+        impl.d.height = std::max(height(left()), height(right())) + 1;
+        auto m        = &last();
+        if (left() && Compare{}(*m, left()->max()))
+            m = &left()->max();
+        if (right() && Compare{}(*m, right()->max()))
+            m = &right()->max();
+        max() = *m;
+    }
+
+    static refs_t& refs(const node_t* x)
+    {
+        return auto_const_cast(get<refs_t>(x->impl));
+    }
+    static ownee_t& ownee(node_t* x) { return get<ownee_t>(x->impl); }
+    static const ownee_t& ownee(const node_t* x)
+    {
+        return get<ownee_t>(x->impl);
+    }
+
+    // Whether the node can be updated in place, because it is not
+    // shared or, while a transient is being edited, it belongs to it.
+    bool can_mutate(edit_t e, bool transient) const
+    {
+        return refs(this).unique() || (transient && ownee(this).can_mutate(e));
+    }
+
+    static node_t* inc(node_t* n)
+    {
+        if (n)
+            refs(n).inc();
+        return n;
+    }
+
+    bool dec() const { return refs(this).dec(); }
+
+    // Makes a node with `v` and the children `l` and `r`, which it
+    // takes ownership of only when it does not throw.
+    template <typename V>
+    static node_t* make(edit_t e, bool transient, V&& v, node_t* l, node_t* r)
+    {
+        auto p = new (heap::allocate(sizeof(node_t))) node_t;
+        IMMER_TRY {
+            new (&p->impl.d.value) value_t(std::forward<V>(v));
+            IMMER_TRY {
+                new (&p->impl.d.max) K(p->last());
+            }
+            IMMER_CATCH (...) {
+                detail::destroy_at(&p->value());
+                IMMER_RETHROW;
+            }
+        }
+        IMMER_CATCH (...) {
+            heap::deallocate(sizeof(node_t), p);
+            IMMER_RETHROW;
+        }
+        p->left()  = l;
+        p->right() = r;
+        p->fix();
+        if (transient)
+            ownee(p) = e;
+        return p;
+    }
+
+    static node_t* copy(const node_t* src, edit_t e, bool transient)
+    {
+        auto p = make(e, transient, src->value(), src->left(), src->right());
+        inc(p->left());
+        inc(p->right());
+        return p;
+    }
+
+    // Drops a reference to `p`, and frees the nodes that are not
+    // referenced anymore.  The tree is balanced, so the recursion is
+    // only as deep as its height.
+    static void release(node_t* p)
+    {
+        if (p && p->dec()) {
+            release(p->left());
+            release(p->right());
+            detail::destroy_at(&p->max());
+            detail::destroy_at(&p->value());
+            heap::deallocate(sizeof(node_t), p);
+        }
+    }
+};
+
+} // namespace interval
+} // namespace detail
+} // namespace immer
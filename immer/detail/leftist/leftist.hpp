@@ -0,0 +1,176 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/leftist/node.hpp>
+
+#include <cassert>
+#include <utility>
+
+namespace immer {
+namespace detail {
+namespace leftist {
+
+/*!
+ * Persistent leftist heap of values of type `T`, where a value has
+ * priority over another when `Compare` orders the second before the
+ * first, like in `std::priority_queue`.
+ *
+ * Two heaps are merged along their right paths, which are at most
+ * @f$ O(log(n)) @f$ long, so pushing, popping and merging take
+ * @f$ O(log(n)) @f$ and copy only the nodes on those paths.  Like in
+ * the other trees, every update takes an edit token and whether it
+ * comes from a transient, and the nodes that it can mutate are
+ * updated in place.
+ */
+template <typename T, typename Compare, typename MemoryPolicy>
+struct leftist
+{
+    using node_t = node<T, MemoryPolicy>;
+    using edit_t = typename node_t::edit_t;
+
+    size_t size;
+    node_t* root;
+
+    static leftist empty() { return {0, nullptr}; }
+
+    // The edit token of the updates that do not come from a transient.
+    static edit_t noone() { return node_t::transience::noone; }
+
+    leftist(size_t sz, node_t* r)
+        : size{sz}
+        , root{r}
+    {}
+
+    leftist(const leftist& other)
+        : leftist{other.size, node_t::inc(other.root)}
+    {}
+
+    leftist(leftist&& other)
+        : leftist{0, nullptr}
+    {
+        swap(*this, other);
+    }
+
+    leftist& operator=(const leftist& other)
+    {
+        auto next = other;
+        swap(*this, next);
+        return *this;
+    }
+
+    leftist& operator=(leftist&& other)
+    {
+        swap(*this, other);
+        return *this;
+    }
+
+    friend void swap(leftist& x, leftist& y)
+    {
+        using std::swap;
+        swap(x.size, y.size);
+        swap(x.root, y.root);
+    }
+
+    ~leftist() { node_t::release(root); }
+
+    const T& top() const
+    {
+        assert(root);
+        return root->value();
+    }
+
+    static node_t* owned(node_t* n, edit_t e, bool tr)
+    {
+        if (n->can_mutate(e, tr))
+            return n;
+        auto r = node_t::copy(n, e, tr);
+        node_t::release(n);
+        return r;
+    }
+
+    // Merges the heaps `a` and `b`, taking ownership of both, also
+    // when it throws.
+    static node_t* merge(node_t* a, node_t* b, edit_t e, bool tr)
+    {
+        if (!a)
+            return b;
+        if (!b)
+            return a;
+        if (Compare{}(a->value(), b->value()))
+            std::swap(a, b);
+        IMMER_TRY {
+            a = owned(a, e, tr);
+        }
+        IMMER_CATCH (...) {
+            node_t::release(a);
+            node_t::release(b);
+            IMMER_RETHROW;
+        }
+        auto r     = a->right();
+        a->right() = nullptr;
+        IMMER_TRY {
+            a->right() = merge(r, b, e, tr);
+        }
+        IMMER_CATCH (...) {
+            node_t::release(a);
+            IMMER_RETHROW;
+        }
+        a->fix_rank();
+        return a;
+    }
+
+    // Replaces the root with the merge of `root` and `other`, leaving
+    // the heap empty if that throws.
+    void merge_root(node_t* other, edit_t e, bool tr)
+    {
+        auto r = root;
+        root   = nullptr;
+        IMMER_TRY {
+            root = merge(r, other, e, tr);
+        }
+        IMMER_CATCH (...) {
+            size = 0;
+            IMMER_RETHROW;
+        }
+    }
+
+    void push_mut(edit_t e, bool tr, T v)
+    {
+        auto n = node_t::make(e, tr, std::move(v), nullptr, nullptr);
+        merge_root(n, e, tr);
+        ++size;
+    }
+
+    void pop_mut(edit_t e, bool tr)
+    {
+        assert(root);
+        auto n = root;
+        auto l = node_t::inc(n->left());
+        auto r = node_t::inc(n->right());
+        root   = l;
+        node_t::release(n);
+        merge_root(r, e, tr);
+        --size;
+    }
+
+    void meld_mut(edit_t e, bool tr, leftist other)
+    {
+        auto sz    = size + other.size;
+        auto r     = other.root;
+        other.root = nullptr;
+        merge_root(r, e, tr);
+        size = sz;
+    }
+};
+
+} // namespace leftist
+} // namespace detail
+} // namespace immer
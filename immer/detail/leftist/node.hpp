@@ -0,0 +1,166 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/combine_standard_layout.hpp>
+#include <immer/detail/util.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace immer {
+namespace detail {
+namespace leftist {
+
+using count_t = std::uint32_t;
+using size_t  = std::size_t;
+
+/*!
+ * Node of a leftist heap.  It holds a value, which has priority over
+ * the ones of its children, and its rank: the length of the path down
+ * its right children until an empty one, which is never longer than
+ * the one on the left.
+ */
+template <typename T, typename MemoryPolicy>
+struct node
+{
+    using node_t = node;
+
+    using memory      = MemoryPolicy;
+    using heap_policy = typename memory::heap;
+    using heap        = typename heap_policy::type;
+    using transience  = typename memory::transience_t;
+    using refs_t      = typename memory::refcount;
+    using ownee_t     = typename transience::ownee;
+    using edit_t      = typename transience::edit;
+    using value_t     = T;
+
+    struct impl_data_t
+    {
+        node_t* left;
+        node_t* right;
+        count_t rank;
+        aligned_storage_for<T> value;
+    };
+
+    using impl_t = combine_standard_layout_t<impl_data_t, refs_t, ownee_t>;
+
+    impl_t impl;
+
+    T& value() { return *reinterpret_cast<T*>(&impl.d.value); }
+    const T& value() const
+    {
+        return *reinterpret_cast<const T*>(&impl.d.value);
+    }
+
+    node_t*& left() { return impl.d.left; }
+    node_t*& right() { return impl.d.right; }
+    node_t* left() const { return impl.d.left; }
+    node_t* right() const { return impl.d.right; }
+
+    static count_t rank(const node_t* n) { return n ? n->impl.d.rank : 0; }
+
+    // restores the invariant of the node after its children changed
+    void fix_rank()
+    {
+        if (rank(left()) < rank(right()))
+            std::swap(left(), right());
+        impl.d.rank = rank(right()) + 1;
+    }
+
+    static refs_t& refs(const node_t* x)
+    {
+        return auto_const_cast(get<refs_t>(x->impl));
+    }
+    static ownee_t& ownee(node_t* x) { return get<ownee_t>(x->impl); }
+    static const ownee_t& ownee(const node_t* x)
+    {
+        return get<ownee_t>(x->impl);
+    }
+
+    // Whether the node can be updated in place, because it is not
+    // shared or, while a transient is being edited, it belongs to it.
+    bool can_mutate(edit_t e, bool transient) const
+    {
+        return refs(this).unique() || (transient && ownee(this).can_mutate(e));
+    }
+
+    static node_t* inc(node_t* n)
+    {
+        if (n)
+            refs(n).inc();
+        return n;
+    }
+
+    bool dec() const { return refs(this).dec(); }
+
+    // Makes a node with `v` and the children `l` and `r`, which it
+    // takes ownership of only when it does not throw.
+    static node_t* make(edit_t e, bool transient, T v, node_t* l, node_t* r)
+    {
+        auto p = new (heap::allocate(sizeof(node_t))) node_t;
+        IMMER_TRY {
+            new (&p->impl.d.value) T(std::move(v));
+        }
+        IMMER_CATCH (...) {
+            heap::deallocate(sizeof(node_t), p);
+            IMMER_RETHROW;
+        }
+        p->left()      = l;
+        p->right()     = r;
+        p->impl.d.rank = rank(r) + 1;
+        if (transient)
+            ownee(p) = e;
+        return p;
+    }
+
+    static node_t* copy(const node_t* src, edit_t e, bool transient)
+    {
+        auto p = make(e, transient, src->value(), src->left(), src->right());
+        inc(p->left());
+        inc(p->right());
+        return p;
+    }
+
+    // Drops a reference to `p`, and frees the nodes that are not
+    // referenced anymore.  The left paths of a leftist heap can be as
+    // long as the heap, so this does not recurse: the right children
+    // that are still to be released are kept in a stack that is linked
+    // through the nodes that were already freed.
+    static void release(node_t* p)
+    {
+        auto stack = static_cast<node_t*>(nullptr);
+        while (true) {
+            if (p && p->dec()) {
+                auto l = p->left();
+                auto r = p->right();
+                detail::destroy_at(&p->value());
+                if (r) {
+                    p->left()  = stack;
+                    p->right() = r;
+                    stack      = p;
+                } else
+                    heap::deallocate(sizeof(node_t), p);
+                p = l;
+            } else if (stack) {
+                auto cell = stack;
+                stack     = cell->left();
+                p         = cell->right();
+                heap::deallocate(sizeof(node_t), cell);
+            } else
+                break;
+        }
+    }
+};
+
+} // namespace leftist
+} // namespace detail
+} // namespace immer
@@ -0,0 +1,156 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/combine_standard_layout.hpp>
+#include <immer/detail/util.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace immer {
+namespace detail {
+namespace lists {
+
+using count_t = std::uint32_t;
+using size_t  = std::size_t;
+
+/*!
+ * Cell of a list, holding up to `N` values in the slots from `front`
+ * to `end`, that are followed by the values of the list at the slot
+ * `next_offset` of the `next` cell.  A list is a cell and the slot of
+ * its first value in it, so the values of a cell are shared by all the
+ * lists that start in it.
+ *
+ * Prepending to a list that starts at the `front` of its cell claims
+ * the slot before it, when there is one, instead of allocating a new
+ * cell.  Only the first list to claim it gets it, the others make a
+ * new cell.  Thus `front` is the only field that changes after the
+ * cell is made, and it only goes down.
+ */
+template <typename T, typename MemoryPolicy, count_t N>
+struct node
+{
+    using node_t = node;
+
+    using memory      = MemoryPolicy;
+    using heap_policy = typename memory::heap;
+    using heap        = typename heap_policy::type;
+    using refs_t      = typename memory::refcount;
+    using value_t     = T;
+
+    struct impl_data_t
+    {
+        node_t* next;
+        count_t next_offset;
+        count_t end;
+        std::atomic<count_t> front;
+        aligned_storage_for<T> values[N];
+    };
+
+    using impl_t = combine_standard_layout_t<impl_data_t, refs_t>;
+
+    impl_t impl;
+
+    T* values() { return reinterpret_cast<T*>(&impl.d.values[0]); }
+    const T* values() const
+    {
+        return reinterpret_cast<const T*>(&impl.d.values[0]);
+    }
+
+    node_t* next() const { return impl.d.next; }
+    count_t next_offset() const { return impl.d.next_offset; }
+    count_t end() const { return impl.d.end; }
+
+    static refs_t& refs(const node_t* x)
+    {
+        return auto_const_cast(get<refs_t>(x->impl));
+    }
+
+    static node_t* inc(node_t* n)
+    {
+        if (n)
+            refs(n).inc();
+        return n;
+    }
+
+    bool dec() const { return refs(this).dec(); }
+
+    // Makes a cell with no values, whose slots from `front` to `end`
+    // are to be filled by the caller, followed by `next`, that it takes
+    // ownership of.
+    static node_t* make(count_t front, count_t end, node_t* next, count_t off)
+    {
+        auto p = new (heap::allocate(sizeof(node_t))) node_t;
+        p->impl.d.next        = next;
+        p->impl.d.next_offset = off;
+        p->impl.d.end         = end;
+        p->impl.d.front.store(front, std::memory_order_relaxed);
+        return p;
+    }
+
+    // Frees a cell whose slots were never filled.
+    static void delete_empty(node_t* p)
+    {
+        heap::deallocate(sizeof(node_t), p);
+    }
+
+    // Makes a list of `v` followed by the list at `offset` of `p`,
+    // which it takes ownership of only when it does not throw, and
+    // returns its cell and offset.
+    template <typename U>
+    static std::pair<node_t*, count_t> cons(U&& v, node_t* p, count_t offset)
+    {
+        if (p && offset > 0) {
+            auto expected = offset;
+            if (p->impl.d.front.compare_exchange_strong(
+                    expected, offset - 1, std::memory_order_relaxed)) {
+                IMMER_TRY {
+                    new (p->values() + offset - 1) T(std::forward<U>(v));
+                }
+                IMMER_CATCH (...) {
+                    // nobody else can claim the slot before ours
+                    p->impl.d.front.store(offset, std::memory_order_relaxed);
+                    IMMER_RETHROW;
+                }
+                return {p, offset - 1};
+            }
+        }
+        auto r = make(N - 1, N, p, offset);
+        IMMER_TRY {
+            new (r->values() + N - 1) T(std::forward<U>(v));
+        }
+        IMMER_CATCH (...) {
+            delete_empty(r);
+            IMMER_RETHROW;
+        }
+        return {r, N - 1};
+    }
+
+    // Drops a reference to `p`, and frees the cells that are not
+    // referenced anymore.  A list can be as long as the memory allows,
+    // so this walks down the cells instead of recursing.
+    static void release(node_t* p)
+    {
+        while (p && p->dec()) {
+            auto next  = p->next();
+            auto front = p->impl.d.front.load(std::memory_order_relaxed);
+            detail::destroy_n(p->values() + front, p->end() - front);
+            heap::deallocate(sizeof(node_t), p);
+            p = next;
+        }
+    }
+};
+
+} // namespace lists
+} // namespace detail
+} // namespace immer
@@ -0,0 +1,164 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/combine_standard_layout.hpp>
+#include <immer/detail/util.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+namespace immer {
+namespace detail {
+namespace patricia {
+
+using size_t = std::size_t;
+
+constexpr size_t align_up(size_t n, size_t a) { return (n + a - 1) / a * a; }
+
+/*!
+ * Node of a big-endian Patricia trie over the bits of keys of type
+ * `Bits`, an unsigned integer.  A leaf holds a value, and its `prefix`
+ * is the bits of its key.  A branch has two children, the keys of both
+ * share the bits of its `prefix` above its `mask`, which has a single
+ * bit set, and those with that bit cleared are on the left.  Branches
+ * have a `mask`, leaves do not.  The children, or the value, are right
+ * after the node in the same allocation.  Every node also counts the
+ * values in its subtree.
+ */
+template <typename Bits, typename Value, typename MemoryPolicy>
+struct node
+{
+    using node_t = node;
+
+    using memory      = MemoryPolicy;
+    using heap_policy = typename memory::heap;
+    using heap        = typename heap_policy::type;
+    using refs_t      = typename memory::refcount;
+    using value_t     = Value;
+
+    struct impl_data_t
+    {
+        size_t size;
+        Bits prefix;
+        Bits mask;
+    };
+
+    using impl_t = combine_standard_layout_t<impl_data_t, refs_t>;
+
+    impl_t impl;
+
+    static constexpr size_t data_offset =
+        align_up(sizeof(impl_t), std::max(alignof(value_t), alignof(node_t*)));
+
+    static constexpr size_t sizeof_branch = data_offset + 2 * sizeof(node_t*);
+    static constexpr size_t sizeof_leaf   = data_offset + sizeof(value_t);
+
+    size_t size() const { return impl.d.size; }
+    Bits prefix() const { return impl.d.prefix; }
+    Bits mask() const { return impl.d.mask; }
+    bool is_leaf() const { return !impl.d.mask; }
+
+    char* data() { return reinterpret_cast<char*>(this) + data_offset; }
+    const char* data() const
+    {
+        return reinterpret_cast<const char*>(this) + data_offset;
+    }
+
+    node_t** children() { return reinterpret_cast<node_t**>(data()); }
+    node_t* const* children() const
+    {
+        return reinterpret_cast<node_t* const*>(data());
+    }
+
+    value_t& value() { return *reinterpret_cast<value_t*>(data()); }
+    const value_t& value() const
+    {
+        return *reinterpret_cast<const value_t*>(data());
+    }
+
+    static refs_t& refs(const node_t* x)
+    {
+        return auto_const_cast(get<refs_t>(x->impl));
+    }
+
+    static node_t* inc(const node_t* n)
+    {
+        if (n)
+            refs(n).inc();
+        return const_cast<node_t*>(n);
+    }
+
+    bool unique() const { return refs(this).unique(); }
+
+    // Makes a branch over the children `l` and `r`, taking ownership of
+    // them, also when it throws, in which case they are released.
+    static node_t* make_branch(Bits prefix, Bits mask, node_t* l, node_t* r)
+    {
+        auto p = static_cast<node_t*>(nullptr);
+        IMMER_TRY {
+            p = new (heap::allocate(sizeof_branch)) node_t;
+        }
+        IMMER_CATCH (...) {
+            release(l);
+            release(r);
+            IMMER_RETHROW;
+        }
+        p->impl.d.size   = l->size() + r->size();
+        p->impl.d.prefix = prefix;
+        p->impl.d.mask   = mask;
+        p->children()[0] = l;
+        p->children()[1] = r;
+        return p;
+    }
+
+    // Makes a leaf for the key `key` with a value constructed from
+    // `args`.
+    template <typename... Args>
+    static node_t* make_leaf(Bits key, Args&&... args)
+    {
+        auto p = new (heap::allocate(sizeof_leaf)) node_t;
+        IMMER_TRY {
+            new (&p->value()) value_t(std::forward<Args>(args)...);
+        }
+        IMMER_CATCH (...) {
+            heap::deallocate(sizeof_leaf, p);
+            IMMER_RETHROW;
+        }
+        p->impl.d.size   = 1;
+        p->impl.d.prefix = key;
+        p->impl.d.mask   = 0;
+        return p;
+    }
+
+    // Drops a reference to `p`, and frees the nodes that are not
+    // referenced anymore.  The children of a branch may be null while
+    // it is being updated.
+    static void release(const node_t* p)
+    {
+        if (!p || !refs(p).dec())
+            return;
+        auto q = const_cast<node_t*>(p);
+        if (q->is_leaf()) {
+            detail::destroy_at(&q->value());
+            heap::deallocate(sizeof_leaf, q);
+        } else {
+            release(q->children()[0]);
+            release(q->children()[1]);
+            heap::deallocate(sizeof_branch, q);
+        }
+    }
+};
+
+} // namespace patricia
+} // namespace detail
+} // namespace immer
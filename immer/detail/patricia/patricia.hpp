@@ -0,0 +1,407 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/patricia/node.hpp>
+
+#include <type_traits>
+#include <utility>
+
+namespace immer {
+namespace detail {
+namespace patricia {
+
+// The bits of the keys, as an unsigned integer of the same width, whose
+// order is the one of the keys: signed keys have their sign bit flipped.
+template <typename K>
+struct key_bits
+{
+    static_assert(std::is_integral<K>::value && !std::is_same<K, bool>::value,
+                  "the keys must be integers");
+
+    using type = std::make_unsigned_t<K>;
+
+    static constexpr type flip =
+        std::is_signed<K>::value
+            ? static_cast<type>(type{1} << (sizeof(K) * 8 - 1))
+            : type{};
+
+    static type to_bits(K k) { return static_cast<type>(k) ^ flip; }
+    static K to_key(type b) { return static_cast<K>(b ^ flip); }
+};
+
+// Returns `x` with only its highest set bit.
+template <typename Bits>
+Bits highest_bit(Bits x)
+{
+    for (auto s = 1u; s < sizeof(Bits) * 8; s *= 2)
+        x = static_cast<Bits>(x | (x >> s));
+    return static_cast<Bits>(x ^ (x >> 1));
+}
+
+// The bits of `k` above the bit of `m`.
+template <typename Bits>
+Bits mask_above(Bits k, Bits m)
+{
+    return static_cast<Bits>(k & ~static_cast<Bits>(m | (m - 1)));
+}
+
+// The largest key under the prefix `p` above the bit of `m`.
+template <typename Bits>
+Bits last_below(Bits p, Bits m)
+{
+    return static_cast<Bits>(p | m | (m - 1));
+}
+
+/*!
+ * Persistent big-endian Patricia trie mapping integer keys of type `K`
+ * to values of type `T`.  A branch tells apart its subtrees by the
+ * highest bit where their keys differ, so that the keys are sorted from
+ * left to right, a lookup visits at most as many nodes as bits in the
+ * key, and the shape of the trie only depends on the keys in it, not on
+ * the order in which they were inserted.
+ *
+ * Every update consumes the reference to the root, so that the nodes
+ * that are not shared are updated in place, while the others are
+ * copied.  When it throws, the tree is left empty.
+ */
+template <typename K, typename T, typename MemoryPolicy>
+struct patricia
+{
+    using traits  = key_bits<K>;
+    using bits_t  = typename traits::type;
+    using value_t = std::pair<K, T>;
+    using node_t  = node<bits_t, value_t, MemoryPolicy>;
+
+    node_t* root;
+
+    static patricia empty() { return patricia{nullptr}; }
+
+    explicit patricia(node_t* r)
+        : root{r}
+    {}
+
+    patricia(const patricia& other)
+        : patricia{node_t::inc(other.root)}
+    {}
+
+    patricia(patricia&& other)
+        : patricia{nullptr}
+    {
+        swap(*this, other);
+    }
+
+    patricia& operator=(const patricia& other)
+    {
+        auto next = other;
+        swap(*this, next);
+        return *this;
+    }
+
+    patricia& operator=(patricia&& other)
+    {
+        swap(*this, other);
+        return *this;
+    }
+
+    friend void swap(patricia& x, patricia& y)
+    {
+        using std::swap;
+        swap(x.root, y.root);
+    }
+
+    ~patricia() { node_t::release(root); }
+
+    size_t size() const { return root ? root->size() : 0; }
+
+    static bool matches(bits_t k, const node_t* n)
+    {
+        return mask_above(k, n->mask()) == n->prefix();
+    }
+
+    static bool goes_right(bits_t k, const node_t* n)
+    {
+        return (k & n->mask()) != 0;
+    }
+
+    const value_t* find(const K& key) const
+    {
+        auto k = traits::to_bits(key);
+        auto n = root;
+        while (n && !n->is_leaf()) {
+            if (!matches(k, n))
+                return nullptr;
+            n = n->children()[goes_right(k, n)];
+        }
+        return n && n->prefix() == k ? &n->value() : nullptr;
+    }
+
+    // Joins the subtrees `t0` and `t1`, that it consumes, whose keys
+    // share the prefixes `p0` and `p1`, which differ, under a new
+    // branch at the highest bit where they do.
+    static node_t* join(bits_t p0, node_t* t0, bits_t p1, node_t* t1)
+    {
+        auto m = highest_bit(static_cast<bits_t>(p0 ^ p1));
+        auto p = mask_above(p0, m);
+        return (p0 & m) ? node_t::make_branch(p, m, t1, t0)
+                        : node_t::make_branch(p, m, t0, t1);
+    }
+
+    // Returns `n`, that it consumes, or a copy of it, sharing its
+    // children, when it is shared.
+    static node_t* owned(node_t* n)
+    {
+        if (n->unique())
+            return n;
+        auto c = n->children();
+        auto r = node_t::make_branch(
+            n->prefix(), n->mask(), node_t::inc(c[0]), node_t::inc(c[1]));
+        node_t::release(n);
+        return r;
+    }
+
+    // Associates `v` to its key in the subtree `n`, that it consumes.
+    static node_t* do_set(node_t* n, bits_t k, value_t& v, bool& added)
+    {
+        if (!n) {
+            added = true;
+            return node_t::make_leaf(k, std::move(v));
+        }
+        if (n->is_leaf() && n->prefix() == k) {
+            added = false;
+            if (n->unique()) {
+                n->value().second = std::move(v.second);
+                return n;
+            }
+        } else if (n->is_leaf() || !matches(k, n)) {
+            auto leaf = static_cast<node_t*>(nullptr);
+            IMMER_TRY {
+                leaf = node_t::make_leaf(k, std::move(v));
+            }
+            IMMER_CATCH (...) {
+                node_t::release(n);
+                IMMER_RETHROW;
+            }
+            added = true;
+            return join(k, leaf, n->prefix(), n);
+        } else {
+            n           = owned(n);
+            auto& child = n->children()[goes_right(k, n)];
+            auto old    = child;
+            child       = nullptr;
+            IMMER_TRY {
+                child = do_set(old, k, v, added);
+            }
+            IMMER_CATCH (...) {
+                node_t::release(n);
+                IMMER_RETHROW;
+            }
+            n->impl.d.size += added;
+            return n;
+        }
+        auto r = static_cast<node_t*>(nullptr);
+        IMMER_TRY {
+            r = node_t::make_leaf(k, std::move(v));
+        }
+        IMMER_CATCH (...) {
+            node_t::release(n);
+            IMMER_RETHROW;
+        }
+        node_t::release(n);
+        return r;
+    }
+
+    // Removes the key `k`, that must be in the subtree `n`, that it
+    // consumes.  A branch that is left with a single child is replaced
+    // by it.
+    static node_t* do_erase(node_t* n, bits_t k)
+    {
+        if (n->is_leaf()) {
+            node_t::release(n);
+            return nullptr;
+        }
+        auto right  = goes_right(k, n);
+        n           = owned(n);
+        auto& child = n->children()[right];
+        auto old    = child;
+        child       = nullptr;
+        IMMER_TRY {
+            child = do_erase(old, k);
+        }
+        IMMER_CATCH (...) {
+            node_t::release(n);
+            IMMER_RETHROW;
+        }
+        if (child) {
+            n->impl.d.size -= 1;
+            return n;
+        }
+        auto other            = n->children()[!right];
+        n->children()[!right] = nullptr;
+        node_t::release(n);
+        return other;
+    }
+
+    // Returns the union of the subtrees `s` and `t`, where the keys
+    // that are in both get the value `fn(x, y)` of their associations
+    // `x` in `s` and `y` in `t`.  The subtrees that only one of them
+    // has, or that both share, are reused.
+    template <typename Fn>
+    static node_t* do_merge(const node_t* s, const node_t* t, Fn& fn)
+    {
+        if (!s || s == t)
+            return node_t::inc(t);
+        if (!t)
+            return node_t::inc(s);
+        if (t->is_leaf()) {
+            auto x     = lookup(s, t->prefix());
+            auto v     = x ? fn(x->value(), t->value()) : t->value();
+            auto added = false;
+            return do_set(node_t::inc(s), t->prefix(), v, added);
+        }
+        if (s->is_leaf()) {
+            auto y     = lookup(t, s->prefix());
+            auto v     = y ? fn(s->value(), y->value()) : s->value();
+            auto added = false;
+            return do_set(node_t::inc(t), s->prefix(), v, added);
+        }
+        if (s->mask() == t->mask() && s->prefix() == t->prefix()) {
+            auto l = do_merge(s->children()[0], t->children()[0], fn);
+            auto r = static_cast<node_t*>(nullptr);
+            IMMER_TRY {
+                r = do_merge(s->children()[1], t->children()[1], fn);
+            }
+            IMMER_CATCH (...) {
+                node_t::release(l);
+                IMMER_RETHROW;
+            }
+            return node_t::make_branch(s->prefix(), s->mask(), l, r);
+        }
+        if (s->mask() > t->mask() && matches(t->prefix(), s))
+            return merge_into(s, t, false, fn);
+        if (t->mask() > s->mask() && matches(s->prefix(), t))
+            return merge_into(t, s, true, fn);
+        return join(s->prefix(), node_t::inc(s), t->prefix(), node_t::inc(t));
+    }
+
+    // Merges the subtree `b` with the child of the branch `a` that
+    // shares its prefix, where `b_first` tells whether `b` comes first
+    // in the arguments of `fn`.
+    template <typename Fn>
+    static node_t*
+    merge_into(const node_t* a, const node_t* b, bool b_first, Fn& fn)
+    {
+        auto right = goes_right(b->prefix(), a);
+        auto c     = a->children();
+        auto m     = b_first ? do_merge(b, c[right], fn)
+                             : do_merge(c[right], b, fn);
+        auto other = node_t::inc(c[!right]);
+        return right ? node_t::make_branch(a->prefix(), a->mask(), other, m)
+                     : node_t::make_branch(a->prefix(), a->mask(), m, other);
+    }
+
+    static const node_t* lookup(const node_t* n, bits_t k)
+    {
+        while (n && !n->is_leaf()) {
+            if (!matches(k, n))
+                return nullptr;
+            n = n->children()[goes_right(k, n)];
+        }
+        return n && n->prefix() == k ? n : nullptr;
+    }
+
+    // Returns the subtree of `n` with the keys in `[lo, hi]`, sharing
+    // the subtrees that are wholly in it.
+    static node_t* do_range(const node_t* n, bits_t lo, bits_t hi)
+    {
+        if (!n)
+            return nullptr;
+        if (n->is_leaf())
+            return lo <= n->prefix() && n->prefix() <= hi ? node_t::inc(n)
+                                                          : nullptr;
+        auto first = n->prefix();
+        auto last  = last_below(first, n->mask());
+        if (last < lo || hi < first)
+            return nullptr;
+        if (lo <= first && last <= hi)
+            return node_t::inc(n);
+        auto c = n->children();
+        auto l = do_range(c[0], lo, hi);
+        auto r = static_cast<node_t*>(nullptr);
+        IMMER_TRY {
+            r = do_range(c[1], lo, hi);
+        }
+        IMMER_CATCH (...) {
+            node_t::release(l);
+            IMMER_RETHROW;
+        }
+        if (!l)
+            return r;
+        if (!r)
+            return l;
+        return node_t::make_branch(n->prefix(), n->mask(), l, r);
+    }
+
+    bool set_mut(value_t v)
+    {
+        auto k     = traits::to_bits(v.first);
+        auto added = false;
+        auto r     = root;
+        root       = nullptr;
+        root       = do_set(r, k, v, added);
+        return added;
+    }
+
+    bool erase_mut(const K& key)
+    {
+        if (!find(key))
+            return false;
+        auto r = root;
+        root   = nullptr;
+        root   = do_erase(r, traits::to_bits(key));
+        return true;
+    }
+
+    template <typename Fn>
+    patricia merge(const patricia& other, Fn&& fn) const
+    {
+        return patricia{do_merge(root, other.root, fn)};
+    }
+
+    // The keys in `[first, last]`, inclusive.
+    patricia range(const K& first, const K& last) const
+    {
+        auto lo = traits::to_bits(first);
+        auto hi = traits::to_bits(last);
+        return patricia{lo <= hi ? do_range(root, lo, hi) : nullptr};
+    }
+
+    template <typename Fn>
+    static void for_each_node(const node_t* n, Fn&& fn)
+    {
+        if (n->is_leaf())
+            fn(&n->value(), &n->value() + 1);
+        else {
+            for_each_node(n->children()[0], fn);
+            for_each_node(n->children()[1], fn);
+        }
+    }
+
+    template <typename Fn>
+    void for_each_chunk(Fn&& fn) const
+    {
+        if (root)
+            for_each_node(root, fn);
+    }
+};
+
+} // namespace patricia
+} // namespace detail
+} // namespace immer
@@ -0,0 +1,90 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/detail/iterator_facade.hpp>
+#include <immer/detail/patricia/patricia.hpp>
+
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace immer {
+namespace detail {
+namespace patricia {
+
+/*!
+ * Iterator over the values of a Patricia trie in the order of their
+ * keys.  It keeps, in a vector, the current leaf on top of the right
+ * children of the branches on the path to it that are still to be
+ * visited, which are never more than the bits of the keys.
+ */
+template <typename K, typename T, typename MemoryPolicy>
+struct patricia_iterator
+    : iterator_facade<patricia_iterator<K, T, MemoryPolicy>,
+                      std::forward_iterator_tag,
+                      std::pair<K, T>,
+                      const std::pair<K, T>&,
+                      std::ptrdiff_t,
+                      const std::pair<K, T>*>
+{
+    using tree_t  = patricia<K, T, MemoryPolicy>;
+    using node_t  = typename tree_t::node_t;
+    using value_t = typename tree_t::value_t;
+
+    struct end_t
+    {};
+
+    patricia_iterator() = default;
+
+    patricia_iterator(const tree_t& v)
+    {
+        if (v.root)
+            descend(v.root);
+    }
+
+    patricia_iterator(const tree_t&, end_t) {}
+
+private:
+    friend iterator_core_access;
+
+    std::vector<const node_t*> stack_;
+
+    void descend(const node_t* n)
+    {
+        while (!n->is_leaf()) {
+            stack_.push_back(n->children()[1]);
+            n = n->children()[0];
+        }
+        stack_.push_back(n);
+    }
+
+    void increment()
+    {
+        stack_.pop_back();
+        if (!stack_.empty()) {
+            auto n = stack_.back();
+            stack_.pop_back();
+            descend(n);
+        }
+    }
+
+    bool equal(const patricia_iterator& other) const
+    {
+        return stack_.size() == other.stack_.size() &&
+               (stack_.empty() || stack_.back() == other.stack_.back());
+    }
+
+    const value_t& dereference() const { return stack_.back()->value(); }
+};
+
+} // namespace patricia
+} // namespace detail
+} // namespace immer
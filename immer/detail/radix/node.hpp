@@ -0,0 +1,250 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/combine_standard_layout.hpp>
+#include <immer/detail/util.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <utility>
+
+namespace immer {
+namespace detail {
+namespace radix {
+
+using count_t = std::uint32_t;
+using size_t  = std::size_t;
+
+constexpr auto no_index = ~count_t{};
+
+constexpr size_t align_up(size_t n, size_t a) { return (n + a - 1) / a * a; }
+
+/*!
+ * Node of a radix tree.  Its edge from the parent is labeled by the
+ * byte under which the parent keeps it followed by its `prefix`, and
+ * it holds a value when the path from the root spells a whole key.
+ * The children are sorted by their byte.  All of that is in a single
+ * allocation, sized for the number of children and the length of the
+ * prefix, in this order: the node, the pointers to the children, their
+ * bytes, the prefix and the value.  Every node also counts the values
+ * in its subtree.
+ */
+template <typename Value, typename MemoryPolicy>
+struct node
+{
+    using node_t = node;
+
+    using memory      = MemoryPolicy;
+    using heap_policy = typename memory::heap;
+    using heap        = typename heap_policy::type;
+    using transience  = typename memory::transience_t;
+    using refs_t      = typename memory::refcount;
+    using ownee_t     = typename transience::ownee;
+    using edit_t      = typename transience::edit;
+    using value_t     = Value;
+
+    struct impl_data_t
+    {
+        size_t size;
+        count_t nchildren;
+        count_t prefix_size;
+        bool has_value;
+    };
+
+    using impl_t = combine_standard_layout_t<impl_data_t, refs_t, ownee_t>;
+
+    impl_t impl;
+
+    static constexpr size_t children_offset =
+        align_up(sizeof(impl_t), alignof(node_t*));
+
+    static constexpr size_t keys_offset(count_t n)
+    {
+        return children_offset + n * sizeof(node_t*);
+    }
+
+    static constexpr size_t prefix_offset(count_t n)
+    {
+        return keys_offset(n) + n;
+    }
+
+    static constexpr size_t value_offset(count_t n, count_t p)
+    {
+        return align_up(prefix_offset(n) + p, alignof(value_t));
+    }
+
+    static constexpr size_t sizeof_node(count_t n, count_t p, bool v)
+    {
+        return v ? value_offset(n, p) + sizeof(value_t)
+                 : prefix_offset(n) + p;
+    }
+
+    size_t byte_size() const
+    {
+        return sizeof_node(nchildren(), prefix_size(), has_value());
+    }
+
+    char* raw() { return reinterpret_cast<char*>(this); }
+    const char* raw() const { return reinterpret_cast<const char*>(this); }
+
+    size_t size() const { return impl.d.size; }
+    count_t nchildren() const { return impl.d.nchildren; }
+    count_t prefix_size() const { return impl.d.prefix_size; }
+    bool has_value() const { return impl.d.has_value; }
+
+    node_t** children()
+    {
+        return reinterpret_cast<node_t**>(raw() + children_offset);
+    }
+    node_t* const* children() const
+    {
+        return reinterpret_cast<node_t* const*>(raw() + children_offset);
+    }
+
+    unsigned char* keys()
+    {
+        return reinterpret_cast<unsigned char*>(raw() +
+                                                keys_offset(nchildren()));
+    }
+    const unsigned char* keys() const
+    {
+        return reinterpret_cast<const unsigned char*>(
+            raw() + keys_offset(nchildren()));
+    }
+
+    char* prefix() { return raw() + prefix_offset(nchildren()); }
+    const char* prefix() const { return raw() + prefix_offset(nchildren()); }
+
+    value_t& value()
+    {
+        return *reinterpret_cast<value_t*>(
+            raw() + value_offset(nchildren(), prefix_size()));
+    }
+    const value_t& value() const
+    {
+        return *reinterpret_cast<const value_t*>(
+            raw() + value_offset(nchildren(), prefix_size()));
+    }
+
+    // Returns the index of the child under byte `b`, or where it would
+    // be inserted, and whether it is there.
+    std::pair<count_t, bool> find(unsigned char b) const
+    {
+        auto k = keys();
+        auto l = count_t{};
+        auto h = nchildren();
+        while (l < h) {
+            auto m = l + (h - l) / 2;
+            if (k[m] < b)
+                l = m + 1;
+            else
+                h = m;
+        }
+        return {l, l < nchildren() && k[l] == b};
+    }
+
+    static refs_t& refs(const node_t* x)
+    {
+        return auto_const_cast(get<refs_t>(x->impl));
+    }
+    static ownee_t& ownee(node_t* x) { return get<ownee_t>(x->impl); }
+    static const ownee_t& ownee(const node_t* x)
+    {
+        return get<ownee_t>(x->impl);
+    }
+
+    // Whether the node can be updated in place, because it is not
+    // shared or, while a transient is being edited, it belongs to it.
+    bool can_mutate(edit_t e, bool transient) const
+    {
+        return refs(this).unique() || (transient && ownee(this).can_mutate(e));
+    }
+
+    static node_t* inc(node_t* n)
+    {
+        if (n)
+            refs(n).inc();
+        return n;
+    }
+
+    bool dec() const { return refs(this).dec(); }
+
+    // Makes a node with the given prefix and room for `n` children,
+    // whose bytes and pointers are left for the caller to fill, and no
+    // value.
+    static node_t* make(edit_t e,
+                        bool transient,
+                        const char* prefix,
+                        count_t prefix_size,
+                        count_t n,
+                        bool has_value = false)
+    {
+        auto bytes = sizeof_node(n, prefix_size, has_value);
+        auto p     = new (heap::allocate(bytes)) node_t;
+        p->impl.d.size        = 0;
+        p->impl.d.nchildren   = n;
+        p->impl.d.prefix_size = prefix_size;
+        p->impl.d.has_value   = has_value;
+        if (prefix_size)
+            std::memcpy(p->prefix(), prefix, prefix_size);
+        if (transient)
+            ownee(p) = e;
+        return p;
+    }
+
+    // Makes a node with a value constructed from `args`, and room for
+    // `n` children.
+    template <typename... Args>
+    static node_t* make_value(edit_t e,
+                              bool transient,
+                              const char* prefix,
+                              count_t prefix_size,
+                              count_t n,
+                              Args&&... args)
+    {
+        auto p = make(e, transient, prefix, prefix_size, n, true);
+        IMMER_TRY {
+            new (&p->value()) value_t(std::forward<Args>(args)...);
+        }
+        IMMER_CATCH (...) {
+            heap::deallocate(p->byte_size(), p);
+            IMMER_RETHROW;
+        }
+        return p;
+    }
+
+    // Frees the memory of the node, whose children have been taken
+    // elsewhere, destroying its value.
+    static void free_shell(node_t* p)
+    {
+        if (p->has_value())
+            detail::destroy_at(&p->value());
+        heap::deallocate(p->byte_size(), p);
+    }
+
+    // Drops a reference to `p`, and frees the nodes that are not
+    // referenced anymore.
+    static void release(node_t* p)
+    {
+        if (p && p->dec()) {
+            auto c = p->children();
+            for (auto i = count_t{}; i < p->nchildren(); ++i)
+                release(c[i]);
+            free_shell(p);
+        }
+    }
+};
+
+} // namespace radix
+} // namespace detail
+} // namespace immer
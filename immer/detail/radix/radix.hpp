@@ -0,0 +1,457 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/radix/node.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <utility>
+
+namespace immer {
+namespace detail {
+namespace radix {
+
+/*!
+ * Persistent radix tree mapping keys, which are sequences of bytes of
+ * type `K`, like `std::string`, to values of type `T`.  The nodes with
+ * a single child and no value are merged into their child, whose
+ * prefix then has the bytes of both, so that a lookup visits at most a
+ * node per byte of the key, and usually much less.
+ *
+ * Every update takes an edit token and whether it comes from a
+ * transient, and it consumes the reference to the root, so that the
+ * nodes that it can mutate are updated in place.  The ones that change
+ * their number of children, or the length of their prefix, are
+ * allocated again.
+ */
+template <typename K, typename T, typename MemoryPolicy>
+struct radix
+{
+    using value_t = std::pair<K, T>;
+    using node_t  = node<value_t, MemoryPolicy>;
+    using edit_t  = typename node_t::edit_t;
+
+    node_t* root;
+
+    static radix empty() { return radix{nullptr}; }
+
+    // The edit token of the updates that do not come from a transient.
+    static edit_t noone() { return node_t::transience::noone; }
+
+    explicit radix(node_t* r)
+        : root{r}
+    {}
+
+    radix(const radix& other)
+        : radix{node_t::inc(other.root)}
+    {}
+
+    radix(radix&& other)
+        : radix{nullptr}
+    {
+        swap(*this, other);
+    }
+
+    radix& operator=(const radix& other)
+    {
+        auto next = other;
+        swap(*this, next);
+        return *this;
+    }
+
+    radix& operator=(radix&& other)
+    {
+        swap(*this, other);
+        return *this;
+    }
+
+    friend void swap(radix& x, radix& y)
+    {
+        using std::swap;
+        swap(x.root, y.root);
+    }
+
+    ~radix() { node_t::release(root); }
+
+    size_t size() const { return root ? root->size() : 0; }
+
+    static const char* data(const K& k)
+    {
+        return reinterpret_cast<const char*>(k.data());
+    }
+
+    // Returns how many bytes of the prefix of `n` match the first `len`
+    // bytes of `key`.
+    static count_t common(const node_t* n, const char* key, size_t len)
+    {
+        auto p = n->prefix();
+        auto m = std::min<size_t>(n->prefix_size(), len);
+        auto i = count_t{};
+        while (i < m && p[i] == key[i])
+            ++i;
+        return i;
+    }
+
+    const value_t* find(const K& k) const
+    {
+        auto key = data(k);
+        auto len = static_cast<size_t>(k.size());
+        auto n   = root;
+        auto pos = size_t{};
+        while (n) {
+            auto ps = n->prefix_size();
+            if (len - pos < ps || std::memcmp(n->prefix(), key + pos, ps))
+                return nullptr;
+            pos += ps;
+            if (pos == len)
+                return n->has_value() ? &n->value() : nullptr;
+            auto c = n->find(static_cast<unsigned char>(key[pos]));
+            if (!c.second)
+                return nullptr;
+            n = n->children()[c.first];
+            ++pos;
+        }
+        return nullptr;
+    }
+
+    // The changes to the shape of a node made by `rebuild()`
+    struct change
+    {
+        const char* prefix = nullptr;
+        count_t prefix_size = 0;
+        count_t remove      = no_index;
+        count_t insert      = no_index;
+        unsigned char key   = 0;
+        node_t* child       = nullptr;
+        bool drop_value     = false;
+        value_t* put_value  = nullptr;
+    };
+
+    // Makes a node like `n`, that it consumes, with the changes `c`:
+    // another prefix, without the child at `c.remove`, whose pointer
+    // must have been released and cleared, with `c.child` inserted at
+    // `c.insert`, and without a value or with another one.
+    static node_t* rebuild(node_t* n, edit_t e, bool tr, const change& c)
+    {
+        auto mut     = n->can_mutate(e, tr);
+        auto nc      = n->nchildren() - (c.remove != no_index) +
+                  (c.insert != no_index);
+        auto has_val = c.put_value || (n->has_value() && !c.drop_value);
+        auto r       = static_cast<node_t*>(nullptr);
+        IMMER_TRY {
+            if (c.put_value)
+                r = node_t::make_value(e,
+                                       tr,
+                                       c.prefix,
+                                       c.prefix_size,
+                                       nc,
+                                       std::move(*c.put_value));
+            else if (!has_val)
+                r = node_t::make(e, tr, c.prefix, c.prefix_size, nc);
+            else if (mut)
+                r = node_t::make_value(
+                    e, tr, c.prefix, c.prefix_size, nc, std::move(n->value()));
+            else
+                r = node_t::make_value(
+                    e, tr, c.prefix, c.prefix_size, nc, n->value());
+        }
+        IMMER_CATCH (...) {
+            node_t::release(n);
+            IMMER_RETHROW;
+        }
+        auto src  = n->children();
+        auto keys = n->keys();
+        auto dst  = r->children();
+        auto dk   = r->keys();
+        auto j    = count_t{};
+        auto size = size_t{has_val};
+        for (auto i = count_t{}; i <= n->nchildren(); ++i) {
+            if (j == c.insert) {
+                dst[j]  = c.child;
+                dk[j++] = c.key;
+                size += c.child->size();
+            }
+            if (i == n->nchildren())
+                break;
+            if (i == c.remove)
+                continue;
+            dst[j] = mut ? src[i] : node_t::inc(src[i]);
+            dk[j]  = keys[i];
+            size += src[i]->size();
+            ++j;
+        }
+        assert(j == nc);
+        r->impl.d.size = size;
+        if (mut)
+            node_t::free_shell(n);
+        else
+            node_t::release(n);
+        return r;
+    }
+
+    // Returns `n`, that it consumes, or a copy of it when it can not be
+    // mutated.
+    static node_t* owned(node_t* n, edit_t e, bool tr)
+    {
+        if (n->can_mutate(e, tr))
+            return n;
+        auto c        = change{};
+        c.prefix      = n->prefix();
+        c.prefix_size = n->prefix_size();
+        return rebuild(n, e, tr, c);
+    }
+
+    // Associates `v` to its key in the subtree `n`, that it consumes,
+    // whose edge ends at byte `pos` of the key.
+    static node_t* do_set(node_t* n,
+                          const char* key,
+                          size_t len,
+                          size_t pos,
+                          value_t& v,
+                          edit_t e,
+                          bool tr,
+                          bool& added)
+    {
+        if (!n) {
+            added = true;
+            auto r =
+                node_t::make_value(e, tr, key + pos, len - pos, 0, std::move(v));
+            r->impl.d.size = 1;
+            return r;
+        }
+        auto ps = n->prefix_size();
+        auto cm = common(n, key + pos, len - pos);
+        if (cm < ps) {
+            // split the prefix of the node at the first mismatch
+            auto below        = change{};
+            below.prefix      = n->prefix() + cm + 1;
+            below.prefix_size = ps - cm - 1;
+            auto byte         = static_cast<unsigned char>(n->prefix()[cm]);
+            auto parent       = static_cast<node_t*>(nullptr);
+            IMMER_TRY {
+                parent = pos + cm == len
+                             ? node_t::make_value(
+                                   e, tr, key + pos, cm, 1, std::move(v))
+                             : node_t::make(e, tr, key + pos, cm, 1);
+            }
+            IMMER_CATCH (...) {
+                node_t::release(n);
+                IMMER_RETHROW;
+            }
+            IMMER_TRY {
+                parent->children()[0] = rebuild(n, e, tr, below);
+            }
+            IMMER_CATCH (...) {
+                node_t::free_shell(parent);
+                IMMER_RETHROW;
+            }
+            parent->keys()[0] = byte;
+            parent->impl.d.size =
+                parent->children()[0]->size() + parent->has_value();
+            added = true;
+            if (pos + cm == len)
+                return parent;
+            return do_set(parent, key, len, pos, v, e, tr, added);
+        }
+        pos += ps;
+        if (pos == len) {
+            if (n->has_value()) {
+                added = false;
+                if (n->can_mutate(e, tr)) {
+                    n->value().second = std::move(v.second);
+                    return n;
+                }
+            } else
+                added = true;
+            auto c        = change{};
+            c.prefix      = n->prefix();
+            c.prefix_size = ps;
+            c.put_value   = &v;
+            return rebuild(n, e, tr, c);
+        }
+        auto b  = static_cast<unsigned char>(key[pos]);
+        auto ch = n->find(b);
+        if (!ch.second) {
+            auto leaf     = do_set(nullptr, key, len, pos + 1, v, e, tr, added);
+            auto c        = change{};
+            c.prefix      = n->prefix();
+            c.prefix_size = ps;
+            c.insert      = ch.first;
+            c.key         = b;
+            c.child       = leaf;
+            IMMER_TRY {
+                return rebuild(n, e, tr, c);
+            }
+            IMMER_CATCH (...) {
+                node_t::release(leaf);
+                IMMER_RETHROW;
+            }
+        }
+        n            = owned(n, e, tr);
+        auto& child  = n->children()[ch.first];
+        auto old     = child;
+        child        = nullptr;
+        IMMER_TRY {
+            child = do_set(old, key, len, pos + 1, v, e, tr, added);
+        }
+        IMMER_CATCH (...) {
+            // the child was consumed, the node is left without it
+            child = nullptr;
+            node_t::release(n);
+            IMMER_RETHROW;
+        }
+        n->impl.d.size += added;
+        return n;
+    }
+
+    // Removes the key from the subtree `n`, that it consumes, whose
+    // edge ends at byte `pos` of the key, that must be in it.
+    static node_t* do_erase(node_t* n,
+                            const char* key,
+                            size_t len,
+                            size_t pos,
+                            edit_t e,
+                            bool tr)
+    {
+        pos += n->prefix_size();
+        if (pos == len) {
+            if (n->nchildren() == 0) {
+                node_t::release(n);
+                return nullptr;
+            }
+            if (n->nchildren() == 1)
+                return merge(n, no_index, e, tr);
+            auto c        = change{};
+            c.prefix      = n->prefix();
+            c.prefix_size = n->prefix_size();
+            c.drop_value  = true;
+            return rebuild(n, e, tr, c);
+        }
+        auto ch     = n->find(static_cast<unsigned char>(key[pos]));
+        n           = owned(n, e, tr);
+        auto& child = n->children()[ch.first];
+        auto old    = child;
+        child       = nullptr;
+        IMMER_TRY {
+            child = do_erase(old, key, len, pos + 1, e, tr);
+        }
+        IMMER_CATCH (...) {
+            node_t::release(n);
+            IMMER_RETHROW;
+        }
+        if (child) {
+            n->impl.d.size -= 1;
+            return n;
+        }
+        if (!n->has_value() && n->nchildren() == 2)
+            return merge(n, ch.first, e, tr);
+        auto c        = change{};
+        c.prefix      = n->prefix();
+        c.prefix_size = n->prefix_size();
+        c.remove      = ch.first;
+        return rebuild(n, e, tr, c);
+    }
+
+    // Replaces `n`, that it consumes and that is left with a single
+    // child and no value after removing its value or its child at
+    // `removed`, by that child, with the label of the edge in between
+    // prepended to its prefix.
+    static node_t* merge(node_t* n, count_t removed, edit_t e, bool tr)
+    {
+        auto i     = removed == 0 ? 1 : 0;
+        auto child = node_t::inc(n->children()[i]);
+        auto label = std::string{n->prefix(), n->prefix_size()};
+        label.push_back(static_cast<char>(n->keys()[i]));
+        label.append(child->prefix(), child->prefix_size());
+        node_t::release(n);
+        auto c        = change{};
+        c.prefix      = label.data();
+        c.prefix_size = static_cast<count_t>(label.size());
+        return rebuild(child, e, tr, c);
+    }
+
+    // The key is only read until the value is moved into its node.
+    // When it throws, the tree is left empty.
+    bool set_mut(edit_t e, bool tr, value_t v)
+    {
+        auto key   = data(v.first);
+        auto len   = static_cast<size_t>(v.first.size());
+        auto added = false;
+        auto r     = root;
+        root       = nullptr;
+        root       = do_set(r, key, len, 0, v, e, tr, added);
+        return added;
+    }
+
+    // When it throws, the tree is left empty.
+    bool erase_mut(edit_t e, bool tr, const K& k)
+    {
+        if (!find(k))
+            return false;
+        auto r = root;
+        root   = nullptr;
+        root = do_erase(r, data(k), static_cast<size_t>(k.size()), 0, e, tr);
+        return true;
+    }
+
+    // Returns the tree with the keys that start with `k`, sharing the
+    // subtree that has them.
+    radix with_prefix(const K& k) const
+    {
+        auto key = data(k);
+        auto len = static_cast<size_t>(k.size());
+        auto n   = root;
+        auto pos = size_t{};
+        while (n) {
+            auto cm = common(n, key + pos, len - pos);
+            if (pos + cm == len) {
+                // the root needs the whole path as its prefix
+                auto label = std::string{key, pos};
+                label.append(n->prefix(), n->prefix_size());
+                auto c        = change{};
+                c.prefix      = label.data();
+                c.prefix_size = static_cast<count_t>(label.size());
+                return radix{rebuild(node_t::inc(n), noone(), false, c)};
+            }
+            if (cm < n->prefix_size())
+                break;
+            pos += cm;
+            auto ch = n->find(static_cast<unsigned char>(key[pos]));
+            if (!ch.second)
+                break;
+            n = n->children()[ch.first];
+            ++pos;
+        }
+        return empty();
+    }
+
+    template <typename Fn>
+    static void for_each_node(const node_t* n, Fn&& fn)
+    {
+        if (n->has_value())
+            fn(&n->value(), &n->value() + 1);
+        for (auto i = count_t{}; i < n->nchildren(); ++i)
+            for_each_node(n->children()[i], fn);
+    }
+
+    template <typename Fn>
+    void for_each_chunk(Fn&& fn) const
+    {
+        if (root)
+            for_each_node(root, fn);
+    }
+};
+
+} // namespace radix
+} // namespace detail
+} // namespace immer
@@ -0,0 +1,92 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/detail/iterator_facade.hpp>
+#include <immer/detail/radix/radix.hpp>
+
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace immer {
+namespace detail {
+namespace radix {
+
+/*!
+ * Iterator over the values of a radix tree in the order of their keys,
+ * byte by byte.  It keeps the path from the root to the current node,
+ * which is as long as the number of nodes on it, in a vector.
+ */
+template <typename K, typename T, typename MemoryPolicy>
+struct radix_iterator
+    : iterator_facade<radix_iterator<K, T, MemoryPolicy>,
+                      std::forward_iterator_tag,
+                      std::pair<K, T>,
+                      const std::pair<K, T>&,
+                      std::ptrdiff_t,
+                      const std::pair<K, T>*>
+{
+    using tree_t  = radix<K, T, MemoryPolicy>;
+    using node_t  = typename tree_t::node_t;
+    using value_t = typename tree_t::value_t;
+
+    struct end_t
+    {};
+
+    radix_iterator() = default;
+
+    radix_iterator(const tree_t& v)
+    {
+        if (v.root) {
+            path_.push_back({v.root, 0});
+            if (!v.root->has_value())
+                advance();
+        }
+    }
+
+    radix_iterator(const tree_t&, end_t) {}
+
+private:
+    friend iterator_core_access;
+
+    // a node on the path and the index of the next child to visit
+    std::vector<std::pair<const node_t*, count_t>> path_;
+
+    // goes to the next node with a value in preorder, since the keys
+    // of the children are longer than the one of their parent
+    void advance()
+    {
+        while (!path_.empty()) {
+            auto& top = path_.back();
+            if (top.second < top.first->nchildren()) {
+                auto child = top.first->children()[top.second++];
+                path_.push_back({child, 0});
+                if (child->has_value())
+                    return;
+            } else
+                path_.pop_back();
+        }
+    }
+
+    void increment() { advance(); }
+
+    bool equal(const radix_iterator& other) const
+    {
+        return path_.size() == other.path_.size() &&
+               (path_.empty() || path_.back() == other.path_.back());
+    }
+
+    const value_t& dereference() const { return path_.back().first->value(); }
+};
+
+} // namespace radix
+} // namespace detail
+} // namespace immer
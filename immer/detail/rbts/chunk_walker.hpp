@@ -0,0 +1,120 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/detail/rbts/bits.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <utility>
+
+namespace immer {
+namespace detail {
+namespace rbts {
+
+/*!
+ * Walks the leaves of a `rbtree` or `rrbtree` in order, one per call
+ * to `next()`, keeping the path from the root to the current leaf in
+ * an explicit stack.  Thus every step is amortized @f$ O(1) @f$ and
+ * never descends from the root again.  The tree must outlive it.
+ */
+template <typename Tree>
+struct chunk_walker
+{
+    using node_t  = typename Tree::node_t;
+    using value_t = typename node_t::value_t;
+    using chunk_t = std::pair<const value_t*, const value_t*>;
+
+    static constexpr auto B  = node_t::bits;
+    static constexpr auto BL = node_t::bits_leaf;
+
+    chunk_walker() = default;
+
+    chunk_walker(const Tree& t)
+        : tail_{t.size > t.tail_offset() ? t.tail : nullptr}
+        , tail_size_{t.size - t.tail_offset()}
+    {
+        if (t.tail_offset())
+            push(t.root, t.shift, t.tail_offset());
+    }
+
+    bool done() const
+    {
+        // the subtrees are never empty, a frame with children left
+        // leads to one more leaf
+        for (auto i = size_t{}; i < depth_; ++i)
+            if (stack_[i].index < stack_[i].count)
+                return false;
+        return !tail_;
+    }
+
+    /*!
+     * Returns the next leaf, or an empty range when there are no more.
+     */
+    chunk_t next()
+    {
+        while (depth_) {
+            auto& f = stack_[depth_ - 1];
+            if (f.index == f.count) {
+                --depth_;
+                continue;
+            }
+            auto child = f.node->inner()[f.index];
+            auto size  = f.relaxed ? f.relaxed->d.sizes[f.index] - f.offset
+                                   : std::min(f.size - f.offset,
+                                             size_t{1} << f.shift);
+            f.offset += size;
+            ++f.index;
+            if (f.shift == BL) {
+                auto data = child->leaf();
+                return {data, data + size};
+            }
+            push(child, f.shift - B, size);
+        }
+        if (tail_) {
+            auto data = tail_->leaf();
+            tail_     = nullptr;
+            return {data, data + tail_size_};
+        }
+        return {};
+    }
+
+private:
+    struct frame
+    {
+        node_t* node;
+        const typename node_t::relaxed_t* relaxed;
+        shift_t shift;
+        size_t size;
+        size_t offset;
+        count_t index;
+        count_t count;
+    };
+
+    // enough levels for any size that fits in a size_t
+    static constexpr auto max_depth = (sizeof(size_t) * 8 - BL) / B + 2;
+
+    void push(node_t* node, shift_t shift, size_t size)
+    {
+        auto r = node->relaxed();
+        auto count =
+            r ? r->d.count : static_cast<count_t>(((size - 1) >> shift) + 1);
+        stack_[depth_++] = {node, r, shift, size, 0, 0, count};
+    }
+
+    std::array<frame, max_depth> stack_;
+    size_t depth_     = 0;
+    node_t* tail_     = nullptr;
+    size_t tail_size_ = 0;
+};
+
+} // namespace rbts
+} // namespace detail
+} // namespace immer
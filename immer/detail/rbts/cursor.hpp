@@ -0,0 +1,103 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/detail/rbts/bits.hpp>
+
+#include <cassert>
+#include <cstddef>
+#include <tuple>
+#include <utility>
+
+namespace immer {
+namespace detail {
+namespace rbts {
+
+template <typename Tree>
+struct cursor
+{
+    using tree_t  = Tree;
+    using edit_t  = typename Tree::edit_t;
+    using value_t = typename Tree::node_t::value_t;
+
+    cursor(tree_t& t, edit_t e, size_t i)
+        : t_{&t}
+        , e_{e}
+        , i_{i}
+    {}
+
+    size_t index() const { return i_; }
+
+    void seek(size_t i) { i_ = i; }
+
+    cursor& operator++()
+    {
+        ++i_;
+        return *this;
+    }
+
+    cursor& operator--()
+    {
+        assert(i_ > 0);
+        --i_;
+        return *this;
+    }
+
+    cursor& operator+=(std::ptrdiff_t n)
+    {
+        assert(n >= 0 || static_cast<size_t>(-n) <= i_);
+        i_ += n;
+        return *this;
+    }
+
+    cursor& operator-=(std::ptrdiff_t n) { return *this += -n; }
+
+    const value_t& get() const
+    {
+        assert(i_ < t_->size);
+        if (i_ < first_ || i_ >= last_) {
+            std::tie(data_, first_, last_) = t_->region_for(i_);
+            mutable_                       = false;
+        }
+        return data_[i_ - first_];
+    }
+
+    void set(value_t value) { get_mut() = std::move(value); }
+
+    template <typename Fn>
+    void update(Fn&& fn)
+    {
+        auto& x = get_mut();
+        x       = std::forward<Fn>(fn)(std::move(x));
+    }
+
+private:
+    tree_t* t_;
+    edit_t e_;
+    size_t i_;
+    mutable const value_t* data_ = nullptr;
+    mutable size_t first_        = 0;
+    mutable size_t last_         = 0;
+    mutable bool mutable_        = false;
+
+    value_t& get_mut()
+    {
+        assert(i_ < t_->size);
+        if (!mutable_ || i_ < first_ || i_ >= last_) {
+            std::tie(data_, first_, last_) = t_->region_for_mut(e_, i_);
+            mutable_                       = true;
+        }
+        // the leaf was made mutable by region_for_mut()
+        return const_cast<value_t&>(data_[i_ - first_]);
+    }
+};
+
+} // namespace rbts
+} // namespace detail
+} // namespace immer
@@ -0,0 +1,134 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/rbts/bits.hpp>
+#include <immer/detail/rbts/subtree.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <type_traits>
+
+namespace immer {
+namespace detail {
+namespace rbts {
+
+/*!
+ * Accumulates the changed indices, which are found in increasing
+ * order, so that contiguous ones are reported together.
+ */
+template <typename Fn>
+struct diff_ranges_reporter
+{
+    Fn& fn;
+    size_t first = 0;
+    size_t last  = 0;
+
+    void add(size_t f, size_t l)
+    {
+        assert(f >= last);
+        if (f != last) {
+            flush();
+            first = f;
+        }
+        last = l;
+    }
+
+    void flush()
+    {
+        if (first != last)
+            fn(first, last);
+        first = last;
+    }
+};
+
+/*!
+ * Compares the elements in `[lo, hi)`, which must be covered by both
+ * `a` and `b`, skipping the subtrees that are shared at the same
+ * position.
+ */
+template <typename EqualValue, typename NodeT, typename Reporter>
+void diff_subs(const subtree<NodeT>& a,
+               const subtree<NodeT>& b,
+               size_t lo,
+               size_t hi,
+               Reporter& report)
+{
+    assert(lo < hi);
+    assert(a.first <= lo && hi <= a.last());
+    assert(b.first <= lo && hi <= b.last());
+    if (a.node == b.node && a.first == b.first)
+        return;
+    if (a.level == 0 && b.level == 0) {
+        auto la = a.node->leaf();
+        auto lb = b.node->leaf();
+        for (auto i = lo; i < hi; ++i)
+            if (!EqualValue{}(la[i - a.first], lb[i - b.first]))
+                report.add(i, i + 1);
+    } else if (a.level > b.level) {
+        each_subtree(a, lo, hi, [&](auto&& ca) {
+            diff_subs<EqualValue>(
+                ca, b, std::max(lo, ca.first), std::min(hi, ca.last()), report);
+        });
+    } else if (a.level < b.level) {
+        each_subtree(b, lo, hi, [&](auto&& cb) {
+            diff_subs<EqualValue>(
+                a, cb, std::max(lo, cb.first), std::min(hi, cb.last()), report);
+        });
+    } else {
+        each_subtree(a, lo, hi, [&](auto&& ca) {
+            auto clo = std::max(lo, ca.first);
+            auto chi = std::min(hi, ca.last());
+            each_subtree(b, clo, chi, [&](auto&& cb) {
+                diff_subs<EqualValue>(ca,
+                                      cb,
+                                      std::max(clo, cb.first),
+                                      std::min(chi, cb.last()),
+                                      report);
+            });
+        });
+    }
+}
+
+/*!
+ * Computes the differences between the trees `a` and `b`, which can
+ * be either `rbtree` or `rrbtree`.  Index ranges `[first, last)` are
+ * reported as `differ.changed(first, last)` when both trees hold
+ * different elements there, `differ.added(first, last)` for the
+ * indices past the end of `a` and `differ.removed(first, last)` for
+ * those past the end of `b`.
+ */
+template <typename EqualValue, typename Tree, typename Differ>
+void diff_trees(const Tree& a, const Tree& b, Differ&& differ)
+{
+    using sub_t     = subtree<typename Tree::node_t>;
+    using changed_t = std::remove_reference_t<decltype(differ.changed)>;
+    sub_t as[2], bs[2];
+    auto na         = root_subtrees(a, as);
+    auto nb         = root_subtrees(b, bs);
+    auto common     = std::min(a.size, b.size);
+    auto report     = diff_ranges_reporter<changed_t>{differ.changed};
+    for (auto i = 0; i < na; ++i)
+        for (auto j = 0; j < nb; ++j) {
+            auto lo = std::max(as[i].first, bs[j].first);
+            auto hi = std::min({as[i].last(), bs[j].last(), common});
+            if (lo < hi)
+                diff_subs<EqualValue>(as[i], bs[j], lo, hi, report);
+        }
+    report.flush();
+    if (a.size > common)
+        differ.removed(common, a.size);
+    else if (b.size > common)
+        differ.added(common, b.size);
+}
+
+} // namespace rbts
+} // namespace detail
+} // namespace immer
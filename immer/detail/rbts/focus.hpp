@@ -0,0 +1,112 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/detail/rbts/bits.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+
+namespace immer {
+namespace detail {
+namespace rbts {
+
+/*!
+ * Reads the elements of a `rbtree` or `rrbtree` keeping the path from
+ * the root to the leaf of the last one, with the range of indices that
+ * every node on it covers.  Reading from the same leaf costs @f$ O(1)
+ * @f$, and reading from another one only descends from the lowest node
+ * on the path that covers it, thus reading neighbouring elements is
+ * amortized @f$ O(1) @f$.  It only keeps pointers to the nodes, so it
+ * can be used with any tree that shares them, which must outlive it.
+ */
+template <typename Tree>
+struct focus
+{
+    using node_t  = typename Tree::node_t;
+    using value_t = typename node_t::value_t;
+
+    static constexpr auto B  = node_t::bits;
+    static constexpr auto BL = node_t::bits_leaf;
+
+    const value_t& get(const Tree& t, size_t idx)
+    {
+        assert(idx < t.size);
+        if (idx - first_ >= last_ - first_)
+            refocus(t, idx);
+        return data_[idx - first_];
+    }
+
+private:
+    struct frame
+    {
+        node_t* node;
+        size_t first;
+        size_t size;
+    };
+
+    // enough levels for any size that fits in a size_t
+    static constexpr auto max_depth = (sizeof(size_t) * 8 - BL) / B + 2;
+
+    void refocus(const Tree& t, size_t idx)
+    {
+        auto tail_off = t.tail_offset();
+        if (idx >= tail_off) {
+            data_  = t.tail->leaf();
+            first_ = tail_off;
+            last_  = t.size;
+            return;
+        }
+        while (depth_ && idx - path_[depth_ - 1].first >=
+                             path_[depth_ - 1].size)
+            --depth_;
+        if (!depth_)
+            path_[depth_++] = {t.root, 0, tail_off};
+        auto shift = static_cast<shift_t>(t.shift - (depth_ - 1) * B);
+        auto f     = path_[depth_ - 1];
+        for (;;) {
+            auto r      = f.node->relaxed();
+            auto offset = idx - f.first;
+            auto i      = static_cast<count_t>(offset >> shift);
+            auto before = size_t{};
+            auto size   = size_t{};
+            if (r) {
+                while (r->d.sizes[i] <= offset)
+                    ++i;
+                before = i ? r->d.sizes[i - 1] : 0;
+                size   = r->d.sizes[i] - before;
+            } else {
+                before = size_t{i} << shift;
+                size   = std::min(f.size - before, size_t{1} << shift);
+            }
+            auto child = f.node->inner()[i];
+            if (shift == BL) {
+                data_  = child->leaf();
+                first_ = f.first + before;
+                last_  = first_ + size;
+                return;
+            }
+            f               = {child, f.first + before, size};
+            path_[depth_++] = f;
+            shift -= B;
+        }
+    }
+
+    std::array<frame, max_depth> path_;
+    size_t depth_        = 0;
+    const value_t* data_ = nullptr;
+    size_t first_        = 0;
+    size_t last_         = 0;
+};
+
+} // namespace rbts
+} // namespace detail
+} // namespace immer
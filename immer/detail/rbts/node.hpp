@@ -13,6 +13,7 @@
 #include <immer/detail/rbts/bits.hpp>
 #include <immer/detail/util.hpp>
 #include <immer/heap/tags.hpp>
+#include <immer/trace.hpp>
 
 #include <cassert>
 #include <cstddef>
@@ -217,9 +218,26 @@ struct node
         return make_inner_n_into(m, sizeof_inner_n(n), n);
     }
 
+    /*!
+     * Returns the empty inner node shared by all the trees of this
+     * node type.  It lives in static storage, so making it never
+     * allocates, and it keeps a reference of its own, so it is never
+     * freed nor mutated in place.  The caller increments the count.
+     */
+    static node_t* empty_inner()
+    {
+        static const auto empty_ = [] {
+            constexpr auto size = sizeof_inner_n(0);
+            static std::aligned_storage_t<size, alignof(node_t)> storage;
+            return make_inner_n_into(&storage, size, 0u);
+        }();
+        return empty_;
+    }
+
     static node_t* make_inner_e(edit_t e)
     {
-        auto m                       = heap::allocate(max_sizeof_inner);
+        auto m = transience::template allocate<heap>(e, max_sizeof_inner);
+
         auto p                       = new (m) node_t;
         ownee(p)                     = e;
         p->impl.d.data.inner.relaxed = nullptr;
@@ -274,13 +292,14 @@ struct node
 
     static node_t* make_inner_r_e(edit_t e)
     {
-        auto mp = heap::allocate(max_sizeof_inner_r);
+        auto mp = transience::template allocate<heap>(e, max_sizeof_inner_r);
         auto mr = static_cast<void*>(nullptr);
         if (embed_relaxed) {
             mr = reinterpret_cast<unsigned char*>(mp) + max_sizeof_inner;
         } else {
             IMMER_TRY {
-                mr = heap::allocate(max_sizeof_relaxed, norefs_tag{});
+                mr = transience::template allocate<heap>(
+                    e, max_sizeof_relaxed, norefs_tag{});
             }
             IMMER_CATCH (...) {
                 heap::deallocate(max_sizeof_inner_r, mp);
@@ -304,8 +323,8 @@ struct node
         return static_if<embed_relaxed, node_t*>(
             [&](auto) { return node_t::make_inner_r_e(e); },
             [&](auto) {
-                auto p =
-                    new (heap::allocate(node_t::max_sizeof_inner_r)) node_t;
+                auto p = new (transience::template allocate<heap>(
+                    e, node_t::max_sizeof_inner_r)) node_t;
                 node_t::refs(r).inc();
                 p->impl.d.data.inner.relaxed = r;
                 node_t::ownee(p)             = e;
@@ -334,9 +353,25 @@ struct node
         return make_leaf_n_into(m, sizeof_leaf_n(n), n);
     }
 
+    /*!
+     * Returns the empty leaf shared by all the trees of this node
+     * type, like `empty_inner()`.
+     */
+    static node_t* empty_leaf()
+    {
+        static const auto empty_ = [] {
+            constexpr auto size = sizeof_leaf_n(0);
+            static std::aligned_storage_t<size, alignof(node_t)> storage;
+            return make_leaf_n_into(&storage, size, 0u);
+        }();
+        return empty_;
+    }
+
     static node_t* make_leaf_e(edit_t e)
     {
-        auto p   = new (heap::allocate(max_sizeof_leaf)) node_t;
+        auto p =
+            new (transience::template allocate<heap>(e, max_sizeof_leaf))
+                node_t;
         ownee(p) = e;
 #if IMMER_TAGGED_NODE
         p->impl.d.kind = node_t::kind_t::leaf;
@@ -484,6 +519,35 @@ struct node
         return p;
     }
 
+    template <typename... Args>
+    static node_t* make_leaf_emplace_n(count_t n, Args&&... args)
+    {
+        assert(n >= 1);
+        auto p = make_leaf_n(n);
+        IMMER_TRY {
+            new (p->leaf()) T(std::forward<Args>(args)...);
+        }
+        IMMER_CATCH (...) {
+            heap::deallocate(node_t::sizeof_leaf_n(n), p);
+            IMMER_RETHROW;
+        }
+        return p;
+    }
+
+    template <typename... Args>
+    static node_t* make_leaf_emplace_e(edit_t e, Args&&... args)
+    {
+        auto p = make_leaf_e(e);
+        IMMER_TRY {
+            new (p->leaf()) T(std::forward<Args>(args)...);
+        }
+        IMMER_CATCH (...) {
+            heap::deallocate(node_t::max_sizeof_leaf, p);
+            IMMER_RETHROW;
+        }
+        return p;
+    }
+
     static node_t* make_path(shift_t shift, node_t* node)
     {
         IMMER_ASSERT_TAGGED(node->kind() == kind_t::leaf);
@@ -779,12 +843,12 @@ struct node
         return dst;
     }
 
-    template <typename U>
-    static node_t* copy_leaf_emplace(node_t* src, count_t n, U&& x)
+    template <typename... Args>
+    static node_t* copy_leaf_emplace(node_t* src, count_t n, Args&&... args)
     {
         auto dst = copy_leaf_n(n + 1, src, n);
         IMMER_TRY {
-            new (dst->leaf() + n) T{std::forward<U>(x)};
+            new (dst->leaf() + n) T(std::forward<Args>(args)...);
         }
         IMMER_CATCH (...) {
             detail::destroy_n(dst->leaf(), n);
@@ -798,6 +862,7 @@ struct node
     {
         IMMER_ASSERT_TAGGED(p->kind() == kind_t::inner);
         assert(!p->relaxed());
+        IMMER_TRACE_FREED_NODE();
         heap::deallocate(ownee(p).owned() ? node_t::max_sizeof_inner
                                           : node_t::sizeof_inner_n(n),
                          p);
@@ -823,6 +888,7 @@ struct node
         IMMER_ASSERT_TAGGED(p->kind() == kind_t::inner);
         auto r = p->relaxed();
         assert(r);
+        IMMER_TRACE_FREED_NODE();
         static_if<!embed_relaxed>([&](auto) {
             if (node_t::refs(r).dec())
                 heap::deallocate(node_t::ownee(r).owned()
@@ -850,6 +916,7 @@ struct node
     static void delete_leaf(node_t* p, count_t n)
     {
         IMMER_ASSERT_TAGGED(p->kind() == kind_t::leaf);
+        IMMER_TRACE_FREED_NODE();
         detail::destroy_n(p->leaf(), n);
         heap::deallocate(ownee(p).owned() ? node_t::max_sizeof_leaf
                                           : node_t::sizeof_leaf_n(n),
@@ -11,6 +11,7 @@
 #include <algorithm>
 #include <memory>
 #include <numeric>
+#include <tuple>
 #include <utility>
 
 #include <immer/config.hpp>
@@ -18,6 +19,7 @@
 #include <immer/detail/rbts/visitor.hpp>
 #include <immer/detail/util.hpp>
 #include <immer/heap/tags.hpp>
+#include <immer/trace.hpp>
 
 namespace immer {
 namespace detail {
@@ -360,18 +362,30 @@ struct equals_visitor : visitor_base<equals_visitor>
         }
     };
 
+    // Compares the values in [f, e) with those of the tree of `iter`
+    // starting at its position, a chunk of that tree at a time, such
+    // that the leaves are compared in bulk even when their boundaries
+    // do not match.
+    template <typename Iter, typename T>
+    static bool equal_range(const Iter& iter, const T* f, const T* e)
+    {
+        auto first = iter.index();
+        auto last  = first + static_cast<size_t>(e - f);
+        return iter.impl().for_each_chunk_p(
+            first, last, [&](auto rf, auto re) {
+                auto res = equal_values(rf, re, f);
+                f += re - rf;
+                return res;
+            });
+    }
+
     template <typename Iter>
     static auto equal_chunk_p(Iter&& iter)
     {
         return [iter](auto f, auto e) mutable {
-            if (f == &*iter) {
-                iter += e - f;
-                return true;
-            }
-            for (; f != e; ++f, ++iter)
-                if (*f != *iter)
-                    return false;
-            return true;
+            auto res = this_t::equal_range(iter, f, e);
+            iter += e - f;
+            return res;
         };
     }
 
@@ -429,12 +443,9 @@ struct equals_visitor : visitor_base<equals_visitor>
         auto cl = posl.count();
         auto cr = posr.count();
         auto mp = std::min(cl, cr);
-        return std::equal(posl.node()->leaf(),
-                          posl.node()->leaf() + mp,
-                          posr.node()->leaf()) &&
-               std::equal(posl.node()->leaf() + mp,
-                          posl.node()->leaf() + posl.count(),
-                          first + (idx + mp));
+        auto data = posl.node()->leaf();
+        return equal_values(data, data + mp, posr.node()->leaf()) &&
+               this_t::equal_range(first + (idx + mp), data + mp, data + cl);
     }
 
     template <typename Pos, typename NodeT>
@@ -448,9 +459,8 @@ struct equals_visitor : visitor_base<equals_visitor>
     static bool visit_leaf(Pos&& pos, NodeT* other)
     {
         auto node = pos.node();
-        return node == other || std::equal(node->leaf(),
-                                           node->leaf() + pos.count(),
-                                           other->leaf());
+        return equal_values(
+            node->leaf(), node->leaf() + pos.count(), other->leaf());
     }
 };
 
@@ -513,17 +523,46 @@ struct update_visitor : visitor_base<update_visitor<NodeT>>
     }
 };
 
+// Drops the references to the `n` children of an inner node that is
+// being released.  When they are leaves, they are all decremented in a
+// batch, after prefetching them so that the cache misses on their
+// reference counts overlap, and `dead` says which ones have to be
+// freed.  Returns whether that was done.  The positions of inner
+// children read them, so those are only prefetched and have to be
+// decremented one by one by visiting them, while we still own them.
+template <typename Pos, typename NodeT>
+bool dec_children(Pos&& p, NodeT** children, count_t n, bool* dead)
+{
+    using node_t = node_type<Pos>;
+    for (auto i = count_t{}; i < n; ++i)
+        IMMER_PREFETCH_WRITE(&node_t::refs(children[i]));
+    if (p.shift() != bits_leaf<Pos>)
+        return false;
+    for (auto i = count_t{}; i < n; ++i)
+        dead[i] = children[i]->dec();
+    return true;
+}
+
 struct dec_visitor : visitor_base<dec_visitor>
 {
     using this_t = dec_visitor;
 
+    // says which of the leaves visited next have already been
+    // decremented and have to be freed
+    using dead_t = const bool*;
+
     template <typename Pos>
     static void visit_relaxed(Pos&& p)
     {
         using node_t = node_type<Pos>;
         auto node    = p.node();
         if (node->dec()) {
-            p.each(this_t{});
+            bool dead[branches<bits<Pos>>];
+            if (dec_children(p, node->inner(), p.count(), dead)) {
+                auto d = dead_t{dead};
+                p.each(this_t{}, d);
+            } else
+                p.each(this_t{});
             node_t::delete_inner_r(node, p.count());
         }
     }
@@ -534,7 +573,12 @@ struct dec_visitor : visitor_base<dec_visitor>
         using node_t = node_type<Pos>;
         auto node    = p.node();
         if (node->dec()) {
-            p.each(this_t{});
+            bool dead[branches<bits<Pos>>];
+            if (dec_children(p, node->inner(), p.count(), dead)) {
+                auto d = dead_t{dead};
+                p.each(this_t{}, d);
+            } else
+                p.each(this_t{});
             node_t::delete_inner(node, p.count());
         }
     }
@@ -548,8 +592,91 @@ struct dec_visitor : visitor_base<dec_visitor>
             node_t::delete_leaf(node, p.count());
         }
     }
+
+    template <typename Pos>
+    static void visit_leaf(Pos&& p, dead_t& dead)
+    {
+        using node_t = node_type<Pos>;
+        if (*dead++)
+            node_t::delete_leaf(p.node(), p.count());
+    }
+
+    template <typename Pos>
+    static void visit_relaxed(Pos&& p, dead_t& dead)
+    {
+        IMMER_UNREACHABLE;
+    }
+
+    template <typename Pos>
+    static void visit_regular(Pos&& p, dead_t& dead)
+    {
+        IMMER_UNREACHABLE;
+    }
 };
 
+// Frees the inner nodes that died, starting from `node` at `shift`,
+// that ends at the element `size` when it is not relaxed.  Instead of
+// recursing, it keeps the dead nodes that are still to be freed in a
+// work list, which is bounded since every node adds at most a branch
+// less than it has.  A node is freed right after its children are
+// decremented, which prefetches them first, so that the cache misses
+// that they take overlap and are taken while the parent is freed.
+template <typename NodeT>
+void release_inner(NodeT* node, shift_t shift, size_t size)
+{
+    constexpr auto B      = NodeT::bits;
+    constexpr auto BL     = NodeT::bits_leaf;
+    constexpr auto levels = (sizeof(size_t) * 8 - BL) / B + 1;
+
+    struct item
+    {
+        NodeT* node;
+        shift_t shift;
+        size_t size;
+    };
+
+    item work[levels * (branches<B> - 1) + 1];
+    auto top = work;
+    *top++   = {node, shift, size};
+    while (top != work) {
+        auto it       = *--top;
+        auto children = it.node->inner();
+        auto r        = it.node->relaxed();
+        auto last     = it.size ? (it.size - 1) >> it.shift & mask<B> : 0;
+        auto count    = r         ? r->d.count
+                        : it.size ? static_cast<count_t>(last + 1)
+                                  : count_t{};
+        // the size of a regular node may count the elements before it
+        // too, as that of a `regular_pos`, thus only its last bits matter
+        auto size_of = [&](count_t i) -> size_t {
+            if (r)
+                return r->d.sizes[i] - (i ? r->d.sizes[i - 1] : 0);
+            auto full = size_t{1} << it.shift;
+            return i + 1 < count ? full : ((it.size - 1) & (full - 1)) + 1;
+        };
+        bool dead[branches<B>];
+        for (auto i = count_t{}; i < count; ++i)
+            IMMER_PREFETCH_WRITE(&NodeT::refs(children[i]));
+        for (auto i = count_t{}; i < count; ++i)
+            dead[i] = children[i]->dec();
+        if (it.shift == BL) {
+            for (auto i = count_t{}; i < count; ++i)
+                if (dead[i])
+                    NodeT::delete_leaf(children[i],
+                                       static_cast<count_t>(size_of(i)));
+        } else {
+            // the last child is pushed first, to free them in order
+            for (auto i = count; i-- > 0;)
+                if (dead[i])
+                    *top++ = {children[i], it.shift - B, size_of(i)};
+        }
+        if (r)
+            NodeT::delete_inner_r(it.node, count);
+        else
+            NodeT::delete_inner(it.node, count);
+    }
+}
+
 template <typename NodeT>
 void dec_leaf(NodeT* node, count_t n)
 {
@@ -559,25 +686,120 @@ void dec_leaf(NodeT* node, count_t n)
 template <typename NodeT>
 void dec_inner(NodeT* node, shift_t shift, size_t size)
 {
-    visit_maybe_relaxed_sub(node, shift, size, dec_visitor());
+    if (node->dec())
+        release_inner(node, shift, size);
 }
 
 template <typename NodeT>
 void dec_relaxed(NodeT* node, shift_t shift)
 {
-    make_relaxed_pos(node, shift, node->relaxed()).visit(dec_visitor());
+    dec_inner(node, shift, 0);
 }
 
 template <typename NodeT>
 void dec_regular(NodeT* node, shift_t shift, size_t size)
 {
-    make_regular_pos(node, shift, size).visit(dec_visitor());
+    dec_inner(node, shift, size);
 }
 
 template <typename NodeT>
 void dec_empty_regular(NodeT* node)
 {
-    make_empty_regular_pos(node).visit(dec_visitor());
+    dec_inner(node, NodeT::bits_leaf, 0);
+}
+
+/*!
+ * Builds a regular tree with `size` copies of `v`, with the same shape
+ * as the tree that is obtained by pushing them back one by one.  Since
+ * nodes are immutable, all the full leaves are the same node, and so
+ * are all the full inner nodes of a level: only one full node and one
+ * node of the rightmost path are allocated per level, and the rest are
+ * references to them.  Returns the `shift` of the tree, the root and
+ * the tail.  The root is null when all the values fit in the tail.
+ */
+template <typename NodeT, typename T>
+std::tuple<shift_t, NodeT*, NodeT*> make_filled_tree(size_t size, const T& v)
+{
+    using node_t      = NodeT;
+    constexpr auto B  = node_t::bits;
+    constexpr auto BL = node_t::bits_leaf;
+
+    assert(size > 0);
+    auto tail_off = (size - 1) & ~mask<BL>;
+    auto tail_sz  = static_cast<count_t>(size - tail_off);
+    auto tail     = node_t::make_leaf_n(tail_sz);
+    IMMER_TRY {
+        std::uninitialized_fill_n(tail->leaf(), tail_sz, v);
+    }
+    IMMER_CATCH (...) {
+        node_t::heap::deallocate(node_t::sizeof_leaf_n(tail_sz), tail);
+        IMMER_RETHROW;
+    }
+    if (!tail_off)
+        return std::make_tuple(shift_t{BL}, static_cast<node_t*>(nullptr), tail);
+
+    // the current level has `nfull` references to the subtree `full`,
+    // followed by the partial subtree `last`, when there is one
+    auto full = node_t::make_leaf_n(branches<BL>);
+    IMMER_TRY {
+        std::uninitialized_fill_n(full->leaf(), branches<BL>, v);
+    }
+    IMMER_CATCH (...) {
+        node_t::heap::deallocate(node_t::sizeof_leaf_n(branches<BL>), full);
+        dec_leaf(tail, tail_sz);
+        IMMER_RETHROW;
+    }
+    auto last      = static_cast<node_t*>(nullptr);
+    auto nfull     = tail_off >> BL;
+    auto full_size = size_t{branches<BL>};
+    auto last_size = size_t{};
+    auto shift     = shift_t{BL};
+    for (;;) {
+        auto nparents = nfull >> B;
+        auto rest     = static_cast<count_t>(nfull & mask<B>);
+        auto nlast    = static_cast<count_t>(rest + (last ? 1 : 0));
+        auto pfull    = static_cast<node_t*>(nullptr);
+        auto plast    = static_cast<node_t*>(nullptr);
+        IMMER_TRY {
+            if (nparents)
+                pfull = node_t::make_inner_n(branches<B>);
+            if (nlast)
+                plast = node_t::make_inner_n(nlast);
+        }
+        IMMER_CATCH (...) {
+            if (pfull)
+                node_t::delete_inner(pfull, branches<B>);
+            if (shift == BL)
+                dec_leaf(full, branches<BL>);
+            else {
+                if (full)
+                    dec_regular(full, shift - B, full_size);
+                if (last)
+                    dec_regular(last, shift - B, last_size);
+            }
+            dec_leaf(tail, tail_sz);
+            IMMER_RETHROW;
+        }
+        if (pfull)
+            std::fill_n(pfull->inner(), branches<B>, full);
+        if (plast) {
+            std::fill_n(plast->inner(), rest, full);
+            if (last)
+                plast->inner()[rest] = last;
+        }
+        // we held one reference to `full`, the new nodes need `uses`
+        auto uses = (nparents ? branches<B> : 0u) + rest;
+        for (auto i = 1u; i < uses; ++i)
+            full->inc();
+        last_size = rest * full_size + last_size;
+        full_size <<= B;
+        full  = pfull;
+        last  = plast;
+        nfull = nparents;
+        if (nfull + (last ? 1u : 0u) == 1u)
+            return std::make_tuple(shift, full ? full : last, tail);
+        shift += B;
+    }
 }
 
 template <typename NodeT>
@@ -867,7 +1089,7 @@ struct dec_right_visitor : visitor_base<dec_right_visitor>
         using node_t = node_type<Pos>;
         auto node    = p.node();
         if (node->dec()) {
-            p.each_right(dec_t{}, idx);
+            each_right(p, idx);
             node_t::delete_inner_r(node, p.count());
         }
     }
@@ -878,11 +1100,23 @@ struct dec_right_visitor : visitor_base<dec_right_visitor>
         using node_t = node_type<Pos>;
         auto node    = p.node();
         if (node->dec()) {
-            p.each_right(dec_t{}, idx);
+            each_right(p, idx);
             node_t::delete_inner(node, p.count());
         }
     }
 
+    template <typename Pos>
+    static void each_right(Pos&& p, count_t idx)
+    {
+        bool dead[branches<bits<Pos>>];
+        auto n = p.count() > idx ? p.count() - idx : count_t{};
+        if (dec_children(p, p.node()->inner() + idx, n, dead)) {
+            auto d = dec_t::dead_t{dead};
+            p.each_right(dec_t{}, idx, d);
+        } else
+            p.each_right(dec_t{}, idx);
+    }
+
     template <typename Pos>
     static void visit_leaf(Pos&& p, count_t idx)
     {
@@ -1198,7 +1432,7 @@ struct dec_left_visitor : visitor_base<dec_left_visitor>
         using node_t = node_type<Pos>;
         auto node    = p.node();
         if (node->dec()) {
-            p.each_left(dec_t{}, idx);
+            each_left(p, idx);
             node_t::delete_inner_r(node, p.count());
         }
     }
@@ -1209,11 +1443,22 @@ struct dec_left_visitor : visitor_base<dec_left_visitor>
         using node_t = node_type<Pos>;
         auto node    = p.node();
         if (node->dec()) {
-            p.each_left(dec_t{}, idx);
+            each_left(p, idx);
             node_t::delete_inner(node, p.count());
         }
     }
 
+    template <typename Pos>
+    static void each_left(Pos&& p, count_t idx)
+    {
+        bool dead[branches<bits<Pos>>];
+        if (dec_children(p, p.node()->inner(), idx, dead)) {
+            auto d = dec_t::dead_t{dead};
+            p.each_left(dec_t{}, idx, d);
+        } else
+            p.each_left(dec_t{}, idx);
+    }
+
     template <typename Pos>
     static void visit_leaf(Pos&& p, count_t idx)
     {
@@ -1378,13 +1623,19 @@ struct slice_left_mut_visitor
         auto idx    = pos.index(first);
         auto count  = pos.count();
         auto mutate = Mutating &&
-                      std::is_nothrow_move_constructible<value_t>::value &&
+                      (std::is_nothrow_move_constructible<value_t>::value ||
+                       detail::can_relocate<value_t>) &&
                       node->can_mutate(e);
         if (mutate) {
             auto data     = node->leaf();
             auto newcount = count - idx;
-            std::move(data + idx, data + count, data);
-            detail::destroy_n(data + newcount, idx);
+            if (detail::can_relocate<value_t>) {
+                detail::destroy_n(data, idx);
+                detail::uninitialized_relocate(data + idx, data + count, data);
+            } else {
+                std::move(data + idx, data + count, data);
+                detail::destroy_n(data + newcount, idx);
+            }
             return std::make_tuple(0, node);
         } else {
             auto newn = node_t::copy_leaf_e(e, node, idx, count);
@@ -1766,6 +2017,9 @@ struct concat_rebalance_plan
         const auto branches             = count_t{1} << bits;
         const auto optimal              = ((total - 1) >> bits) + 1;
         count_t i                       = 0;
+#if IMMER_TRACE_HOOKS
+        const auto nodes = n;
+#endif
         while (n >= optimal + rrb_extras) {
             // skip ok nodes
             while (counts[i] > branches - rrb_invariant)
@@ -1789,6 +2043,7 @@ struct concat_rebalance_plan
 #if !defined(_MSC_VER)
 #pragma GCC diagnostic pop
 #endif
+        IMMER_TRACE_HOOK(concat_rebalance, nodes, n, shift);
     }
 
     template <typename LPos, typename CPos, typename RPos>
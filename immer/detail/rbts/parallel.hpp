@@ -0,0 +1,221 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/rbts/bits.hpp>
+#include <immer/detail/rbts/operations.hpp>
+#include <immer/detail/rbts/subtree.hpp>
+#include <immer/detail/reduce.hpp>
+#include <immer/detail/util.hpp>
+#include <immer/executor.hpp>
+
+#include <cassert>
+#include <tuple>
+#include <vector>
+
+namespace immer {
+namespace detail {
+namespace rbts {
+
+/*!
+ * Builds, using the executor `ex`, a regular tree with the `size`
+ * values starting at the random access iterator `first`.  The result
+ * has the same shape as the tree that is obtained by pushing back the
+ * values one by one: full leaves, a tail with the remaining `1` to
+ * `branches<BL>` elements, and inner nodes that are full except for
+ * the rightmost path.  Returns the `shift` of the tree, the root and
+ * the tail.  The root is null when all the values fit in the tail.
+ */
+template <typename NodeT, typename Iter, typename Executor>
+std::tuple<shift_t, NodeT*, NodeT*>
+make_regular_tree_parallel(size_t size, Iter first, Executor& ex)
+{
+    using node_t      = NodeT;
+    using diff_t      = typename std::iterator_traits<Iter>::difference_type;
+    constexpr auto B  = node_t::bits;
+    constexpr auto BL = node_t::bits_leaf;
+    auto at = [&](size_t i) { return first + static_cast<diff_t>(i); };
+
+    assert(size > 0);
+    auto tail_off = (size - 1) & ~mask<BL>;
+    auto tail_sz  = static_cast<count_t>(size - tail_off);
+    auto tail     = node_t::make_leaf_n(tail_sz);
+    IMMER_TRY {
+        detail::uninitialized_copy(at(tail_off), at(size), tail->leaf());
+    }
+    IMMER_CATCH (...) {
+        node_t::heap::deallocate(node_t::sizeof_leaf_n(tail_sz), tail);
+        IMMER_RETHROW;
+    }
+    if (!tail_off)
+        return std::make_tuple(shift_t{BL}, static_cast<node_t*>(nullptr), tail);
+
+    // the nodes of the level that is being built, they own the whole
+    // forest below them
+    auto nodes = std::vector<node_t*>(tail_off >> BL, nullptr);
+    IMMER_TRY {
+        auto grain = std::max(bulk_min_elements >> BL, size_t{1});
+        bulk_ranges(ex, nodes.size(), grain, [&](size_t b, size_t e) {
+            for (; b != e; ++b) {
+                auto leaf = node_t::make_leaf_n(branches<BL>);
+                IMMER_TRY {
+                    detail::uninitialized_copy(at(b << BL),
+                                               at((b + 1) << BL),
+                                               leaf->leaf());
+                }
+                IMMER_CATCH (...) {
+                    node_t::heap::deallocate(
+                        node_t::sizeof_leaf_n(branches<BL>), leaf);
+                    IMMER_RETHROW;
+                }
+                nodes[b] = leaf;
+            }
+        });
+    }
+    IMMER_CATCH (...) {
+        for (auto n : nodes)
+            if (n)
+                node_t::delete_leaf(n, branches<BL>);
+        dec_leaf(tail, tail_sz);
+        IMMER_RETHROW;
+    }
+
+    auto shift = shift_t{BL};
+    for (;;) {
+        auto count   = nodes.size();
+        auto parents = std::vector<node_t*>((count + mask<B>) >> B, nullptr);
+        IMMER_TRY {
+            bulk_ranges(ex, parents.size(), [&](size_t b, size_t e) {
+                for (; b != e; ++b) {
+                    auto first_child = b << B;
+                    auto n           = static_cast<count_t>(
+                        std::min(count - first_child, size_t{branches<B>}));
+                    auto p = node_t::make_inner_n(n);
+                    std::copy(nodes.data() + first_child,
+                              nodes.data() + first_child + n,
+                              p->inner());
+                    parents[b] = p;
+                }
+            });
+        }
+        IMMER_CATCH (...) {
+            for (auto i = size_t{}; i < parents.size(); ++i)
+                if (parents[i])
+                    node_t::delete_inner(
+                        parents[i],
+                        static_cast<count_t>(std::min(
+                            count - (i << B), size_t{branches<B>})));
+            auto child_size = size_t{1} << shift;
+            for (auto i = size_t{}; i < count; ++i) {
+                auto n = std::min(tail_off - i * child_size, child_size);
+                if (shift == BL)
+                    dec_leaf(nodes[i], static_cast<count_t>(n));
+                else
+                    dec_regular(nodes[i], shift - B, n);
+            }
+            dec_leaf(tail, tail_sz);
+            IMMER_RETHROW;
+        }
+        if (parents.size() == 1)
+            return std::make_tuple(shift, parents[0], tail);
+        nodes = std::move(parents);
+        shift += B;
+    }
+}
+
+/*!
+ * Records in `task` the cached partial results of the subtree `s` and
+ * of the inner subtrees below it, so they survive in the next cache.
+ */
+template <typename T, typename NodeT>
+void reduce_keep(const subtree<NodeT>& s, reduce_task<T>& task)
+{
+    if (auto hit = task.find(s.node, s.size)) {
+        task.record(s.node, s.size, *hit);
+        if (s.level > 1)
+            each_subtree(s, s.first, s.last(), [&](auto&& c) {
+                reduce_keep(c, task);
+            });
+    }
+}
+
+/*!
+ * Reduces the elements of the subtree `s` in order, starting from the
+ * identity `init`.  The partial results of inner nodes are memoized
+ * when the `task` is memoizing.
+ */
+template <typename T, typename NodeT, typename Combine>
+T reduce_subtree(const subtree<NodeT>& s,
+                 const T& init,
+                 Combine& combine,
+                 reduce_task<T>& task)
+{
+    auto acc = init;
+    if (s.level == 0) {
+        const auto data = s.node->leaf();
+        for (auto i = size_t{}; i < s.size; ++i)
+            acc = combine(std::move(acc), data[i]);
+        return acc;
+    }
+    if (task.memoizing()) {
+        if (auto hit = task.find(s.node, s.size)) {
+            reduce_keep(s, task);
+            return *hit;
+        }
+    }
+    each_subtree(s, s.first, s.last(), [&](auto&& c) {
+        acc = combine(std::move(acc), reduce_subtree(c, init, combine, task));
+    });
+    if (task.memoizing())
+        task.record(s.node, s.size, acc);
+    return acc;
+}
+
+/*!
+ * Reduces the elements of the tree `t`, which can be either `rbtree`
+ * or `rrbtree`, in order, splitting the work over the executor `ex`.
+ * See `reduce_subtrees` for the meaning of `old` and `fresh`.
+ */
+template <typename T, typename Tree, typename Combine, typename Executor>
+T par_reduce_tree(const Tree& t,
+                  const T& init,
+                  Combine& combine,
+                  Executor& ex,
+                  const typename reduce_cache<T>::map_t* old,
+                  typename reduce_cache<T>::map_t* fresh)
+{
+    using sub_t = subtree<typename Tree::node_t>;
+    sub_t roots[2];
+    auto wanted = ex.concurrency() * bulk_oversubscription;
+    auto subs   = std::vector<sub_t>(roots, roots + root_subtrees(t, roots));
+    for (auto split = true; split && subs.size() < wanted;) {
+        auto next = std::vector<sub_t>{};
+        split     = false;
+        for (auto& s : subs) {
+            // splitting into leaves would leave nothing to memoize
+            if (s.level > 1) {
+                each_subtree(s, s.first, s.last(), [&](auto&& c) {
+                    next.push_back(c);
+                });
+                split = true;
+            } else
+                next.push_back(s);
+        }
+        subs = std::move(next);
+    }
+    return reduce_subtrees(
+        subs, init, combine, ex, old, fresh, [&](auto&& s, auto&& task) {
+            return reduce_subtree(s, init, combine, task);
+        });
+}
+
+} // namespace rbts
+} // namespace detail
+} // namespace immer
@@ -11,7 +11,9 @@
 #include <immer/config.hpp>
 #include <immer/detail/rbts/bits.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
 #include <type_traits>
 #include <utility>
 
@@ -31,6 +33,25 @@ using node_type = typename std::decay<Pos>::type::node_t;
 template <typename Pos>
 using edit_type = typename std::decay<Pos>::type::node_t::edit_t;
 
+// Fetches the elements of the leaf that a traversal visits next while
+// the current one is being visited, so that a sequential scan does not
+// stall on the cache misses of every leaf.  At most four cache lines
+// are fetched, which covers the leaves of the default size.
+template <typename NodeT>
+IMMER_FORCEINLINE void prefetch_leaf(NodeT* leaf)
+{
+#if IMMER_PREFETCH_LEAVES
+    constexpr auto line  = std::size_t{64};
+    constexpr auto bytes = std::min(
+        sizeof(*leaf->leaf()) << NodeT::bits_leaf, std::size_t{4} * line);
+    auto data = reinterpret_cast<const char*>(leaf->leaf());
+    for (auto i = std::size_t{}; i < bytes; i += line)
+        IMMER_PREFETCH_READ(data + i);
+#else
+    (void) leaf;
+#endif
+}
+
 template <typename NodeT>
 struct empty_regular_pos
 {
@@ -346,7 +367,7 @@ void each_regular(Pos&& p, Visitor v, Args&&... args)
     auto e            = n + last;
     if (p.shift() == BL) {
         for (; n != e; ++n) {
-            IMMER_PREFETCH(n + 1);
+            prefetch_leaf(n[1]);
             make_full_leaf_pos(*n).visit(v, args...);
         }
         make_leaf_pos(*n, p.size()).visit(v, args...);
@@ -368,7 +389,7 @@ bool each_pred_regular(Pos&& p, Visitor v, Args&&... args)
     auto e            = n + last;
     if (p.shift() == BL) {
         for (; n != e; ++n) {
-            IMMER_PREFETCH(n + 1);
+            prefetch_leaf(n[1]);
             if (!make_full_leaf_pos(*n).visit(v, args...))
                 return false;
         }
@@ -397,8 +418,8 @@ bool each_pred_zip_regular(Pos&& p,
     auto e    = n + last;
     if (p.shift() == BL) {
         for (; n != e; ++n, ++n2) {
-            IMMER_PREFETCH(n + 1);
-            IMMER_PREFETCH(n2 + 1);
+            prefetch_leaf(n[1]);
+            prefetch_leaf(n2[1]);
             if (!make_full_leaf_pos(*n).visit(v, *n2, args...))
                 return false;
         }
@@ -425,7 +446,7 @@ bool each_pred_i_regular(
                 auto n = p.node()->inner() + f;
                 auto e = p.node()->inner() + l;
                 for (; n < e; ++n) {
-                    IMMER_PREFETCH(n + 1);
+                    prefetch_leaf(n[1]);
                     if (!make_full_leaf_pos(*n).visit(v, args...))
                         return false;
                 }
@@ -433,7 +454,7 @@ bool each_pred_i_regular(
                 auto n = p.node()->inner() + f;
                 auto e = p.node()->inner() + l - 1;
                 for (; n < e; ++n) {
-                    IMMER_PREFETCH(n + 1);
+                    prefetch_leaf(n[1]);
                     if (!make_full_leaf_pos(*n).visit(v, args...))
                         return false;
                 }
@@ -474,7 +495,7 @@ bool each_pred_left_regular(Pos&& p, Visitor v, count_t last, Args&&... args)
         auto n = p.node()->inner();
         auto e = n + last;
         for (; n != e; ++n) {
-            IMMER_PREFETCH(n + 1);
+            prefetch_leaf(n[1]);
             if (!make_full_leaf_pos(*n).visit(v, args...))
                 return false;
         }
@@ -501,7 +522,7 @@ bool each_pred_right_regular(Pos&& p, Visitor v, count_t start, Args&&... args)
         auto e    = p.node()->inner() + last;
         if (n <= e) {
             for (; n != e; ++n) {
-                IMMER_PREFETCH(n + 1);
+                prefetch_leaf(n[1]);
                 if (!make_full_leaf_pos(*n).visit(v, args...))
                     return false;
             }
@@ -536,14 +557,14 @@ void each_i_regular(Pos&& p, Visitor v, count_t f, count_t l, Args&&... args)
                 auto n = p.node()->inner() + f;
                 auto e = p.node()->inner() + l;
                 for (; n < e; ++n) {
-                    IMMER_PREFETCH(n + 1);
+                    prefetch_leaf(n[1]);
                     make_full_leaf_pos(*n).visit(v, args...);
                 }
             } else {
                 auto n = p.node()->inner() + f;
                 auto e = p.node()->inner() + l - 1;
                 for (; n < e; ++n) {
-                    IMMER_PREFETCH(n + 1);
+                    prefetch_leaf(n[1]);
                     make_full_leaf_pos(*n).visit(v, args...);
                 }
                 make_leaf_pos(*n, p.size()).visit(v, args...);
@@ -578,7 +599,7 @@ void each_left_regular(Pos&& p, Visitor v, count_t last, Args&&... args)
         auto n = p.node()->inner();
         auto e = n + last;
         for (; n != e; ++n) {
-            IMMER_PREFETCH(n + 1);
+            prefetch_leaf(n[1]);
             make_full_leaf_pos(*n).visit(v, args...);
         }
     } else {
@@ -602,7 +623,7 @@ void each_right_regular(Pos&& p, Visitor v, count_t start, Args&&... args)
         auto e    = p.node()->inner() + last;
         if (n <= e) {
             for (; n != e; ++n) {
-                IMMER_PREFETCH(n + 1);
+                prefetch_leaf(n[1]);
                 make_full_leaf_pos(*n).visit(v, args...);
             }
             make_leaf_pos(*n, p.size()).visit(v, args...);
@@ -875,7 +896,7 @@ struct regular_sub_pos
         auto e     = node()->inner() + last;
         if (shift() == BL) {
             for (; n != e; ++n) {
-                IMMER_PREFETCH(n + 1);
+                prefetch_leaf(n[1]);
                 make_full_leaf_pos(*n).visit(v, args...);
             }
             make_leaf_sub_pos(*n, lsize).visit(v, args...);
@@ -1179,7 +1200,8 @@ struct full_pos
         auto e = p + branches<B>;
         if (shift_ == BL) {
             for (; p != e; ++p) {
-                IMMER_PREFETCH(p + 1);
+                if (p + 1 != e)
+                    prefetch_leaf(p[1]);
                 make_full_leaf_pos(*p).visit(v, args...);
             }
         } else {
@@ -1196,7 +1218,8 @@ struct full_pos
         auto e = p + branches<B>;
         if (shift_ == BL) {
             for (; p != e; ++p) {
-                IMMER_PREFETCH(p + 1);
+                if (p + 1 != e)
+                    prefetch_leaf(p[1]);
                 if (!make_full_leaf_pos(*p).visit(v, args...))
                     return false;
             }
@@ -1217,7 +1240,8 @@ struct full_pos
         auto e  = p + branches<B>;
         if (shift_ == BL) {
             for (; p != e; ++p, ++p2) {
-                IMMER_PREFETCH(p + 1);
+                if (p + 1 != e)
+                    prefetch_leaf(p[1]);
                 if (!make_full_leaf_pos(*p).visit(v, *p2, args...))
                     return false;
             }
@@ -1237,7 +1261,8 @@ struct full_pos
         auto e = node_->inner() + n;
         if (shift_ == BL) {
             for (; p != e; ++p) {
-                IMMER_PREFETCH(p + 1);
+                if (p + 1 != e)
+                    prefetch_leaf(p[1]);
                 if (!make_full_leaf_pos(*p).visit(v, args...))
                     return false;
             }
@@ -1257,7 +1282,8 @@ struct full_pos
         auto e = node_->inner() + n;
         if (shift_ == BL) {
             for (; p != e; ++p) {
-                IMMER_PREFETCH(p + 1);
+                if (p + 1 != e)
+                    prefetch_leaf(p[1]);
                 make_full_leaf_pos(*p).visit(v, args...);
             }
         } else {
@@ -1477,7 +1503,8 @@ struct relaxed_pos
         auto n = count();
         if (shift_ == BL) {
             for (auto i = count_t{0}; i < n; ++i) {
-                IMMER_PREFETCH(p + i + 1);
+                if (i + 1 < n)
+                    prefetch_leaf(p[i + 1]);
                 if (!make_leaf_sub_pos(p[i], relaxed_->d.sizes[i] - s)
                          .visit(v, args...))
                     return false;
@@ -1502,7 +1529,8 @@ struct relaxed_pos
             auto p = node_->inner();
             auto s = i > 0 ? relaxed_->d.sizes[i - 1] : 0;
             for (; i < n; ++i) {
-                IMMER_PREFETCH(p + i + 1);
+                if (i + 1 < n)
+                    prefetch_leaf(p[i + 1]);
                 if (!make_leaf_sub_pos(p[i], relaxed_->d.sizes[i] - s)
                          .visit(v, args...))
                     return false;
@@ -1529,7 +1557,8 @@ struct relaxed_pos
         auto s = size_t{};
         if (shift_ == BL) {
             for (auto i = count_t{0}; i < n; ++i) {
-                IMMER_PREFETCH(p + i + 1);
+                if (i + 1 < n)
+                    prefetch_leaf(p[i + 1]);
                 if (!make_leaf_sub_pos(p[i], relaxed_->d.sizes[i] - s)
                          .visit(v, args...))
                     return false;
@@ -1556,7 +1585,8 @@ struct relaxed_pos
         auto p = node_->inner();
         if (shift_ == BL) {
             for (auto i = start; i < relaxed_->d.count; ++i) {
-                IMMER_PREFETCH(p + i + 1);
+                if (i + 1 < relaxed_->d.count)
+                    prefetch_leaf(p[i + 1]);
                 if (!make_leaf_sub_pos(p[i], relaxed_->d.sizes[i] - s)
                          .visit(v, args...))
                     return false;
@@ -1581,7 +1611,8 @@ struct relaxed_pos
             auto p = node_->inner();
             auto s = i > 0 ? relaxed_->d.sizes[i - 1] : 0;
             for (; i < n; ++i) {
-                IMMER_PREFETCH(p + i + 1);
+                if (i + 1 < n)
+                    prefetch_leaf(p[i + 1]);
                 make_leaf_sub_pos(p[i], relaxed_->d.sizes[i] - s)
                     .visit(v, args...);
                 s = relaxed_->d.sizes[i];
@@ -1617,7 +1648,8 @@ struct relaxed_pos
         auto s = size_t{};
         if (shift_ == BL) {
             for (auto i = count_t{0}; i < n; ++i) {
-                IMMER_PREFETCH(p + i + 1);
+                if (i + 1 < n)
+                    prefetch_leaf(p[i + 1]);
                 make_leaf_sub_pos(p[i], relaxed_->d.sizes[i] - s)
                     .visit(v, args...);
                 s = relaxed_->d.sizes[i];
@@ -1649,7 +1681,8 @@ struct relaxed_pos
         auto p = node_->inner();
         if (shift_ == BL) {
             for (auto i = start; i < relaxed_->d.count; ++i) {
-                IMMER_PREFETCH(p + i + 1);
+                if (i + 1 < relaxed_->d.count)
+                    prefetch_leaf(p[i + 1]);
                 make_leaf_sub_pos(p[i], relaxed_->d.sizes[i] - s)
                     .visit(v, args...);
                 s = relaxed_->d.sizes[i];
@@ -9,8 +9,10 @@
 #pragma once
 
 #include <immer/config.hpp>
+#include <immer/detail/rbts/diff.hpp>
 #include <immer/detail/rbts/node.hpp>
 #include <immer/detail/rbts/operations.hpp>
+#include <immer/detail/rbts/parallel.hpp>
 #include <immer/detail/rbts/position.hpp>
 #include <immer/detail/type_traits.hpp>
 
@@ -41,17 +43,9 @@ struct rbtree
         return (size_t{1} << BL) * ipow(size_t{1} << B, (S - BL) / B);
     }
 
-    static node_t* empty_root()
-    {
-        static const auto empty_ = node_t::make_inner_n(0u);
-        return empty_->inc();
-    }
+    static node_t* empty_root() { return node_t::empty_inner()->inc(); }
 
-    static node_t* empty_tail()
-    {
-        static const auto empty_ = node_t::make_leaf_n(0u);
-        return empty_->inc();
-    }
+    static node_t* empty_tail() { return node_t::empty_leaf()->inc(); }
 
     template <typename U>
     static auto from_initializer_list(std::initializer_list<U> values)
@@ -60,6 +54,8 @@ struct rbtree
         auto result = rbtree{};
         for (auto&& v : values)
             result.push_back_mut(e, v);
+        // hand the nodes over to the result before `e` discards them
+        e = owner_t{};
         return result;
     }
 
@@ -72,16 +68,32 @@ struct rbtree
         auto result = rbtree{};
         for (; first != last; ++first)
             result.push_back_mut(e, *first);
+        e = owner_t{};
         return result;
     }
 
+    template <typename Iter, typename Executor>
+    static auto from_range_parallel(Iter first, Iter last, Executor&& ex)
+    {
+        if (first == last)
+            return rbtree{};
+        auto size = static_cast<size_t>(std::distance(first, last));
+        auto tree = make_regular_tree_parallel<node_t>(size, first, ex);
+        auto root = std::get<1>(tree);
+        return rbtree{size,
+                      std::get<0>(tree),
+                      root ? root : empty_root(),
+                      std::get<2>(tree)};
+    }
+
     static auto from_fill(size_t n, T v)
     {
-        auto e      = owner_t{};
-        auto result = rbtree{};
-        while (n-- > 0)
-            result.push_back_mut(e, v);
-        return result;
+        if (n == 0)
+            return rbtree{};
+        auto tree = make_filled_tree<node_t>(n, v);
+        auto root = std::get<1>(tree);
+        return rbtree{
+            n, std::get<0>(tree), root ? root : empty_root(), std::get<2>(tree)};
     }
 
     rbtree()
@@ -144,7 +156,15 @@ struct rbtree
         tail->inc();
     }
 
-    void dec() const { traverse(dec_visitor()); }
+    void dec() const
+    {
+        IMMER_TRACE_RELEASE_SCOPE();
+        // the offsets are read from the root, before it is freed
+        auto offset = tail_offset();
+        auto n      = tail_size();
+        dec_inner(root, shift, offset);
+        dec_leaf(tail, n);
+    }
 
     auto tail_size() const { return size ? ((size - 1) & mask<BL>) +1 : 0; }
 
@@ -233,6 +253,29 @@ struct rbtree
         traverse(for_each_chunk_i_visitor{}, first, last, std::forward<Fn>(fn));
     }
 
+    template <typename Fn, typename Executor>
+    void par_for_each_chunk(Fn&& fn, Executor& ex) const
+    {
+        auto leaves = (size + mask<BL>) >> BL;
+        auto grain  = std::max(bulk_min_elements >> BL, size_t{1});
+        bulk_ranges(ex, leaves, grain, [&](size_t first, size_t last) {
+            for_each_chunk(
+                first << BL, std::min(last << BL, size), [&](auto f, auto l) {
+                    fn(as_const(f), as_const(l));
+                });
+        });
+    }
+
+    template <typename U, typename Combine, typename Executor>
+    U par_reduce(const U& init,
+                 Combine& combine,
+                 Executor& ex,
+                 const typename reduce_cache<U>::map_t* old,
+                 typename reduce_cache<U>::map_t* fresh) const
+    {
+        return par_reduce_tree(*this, init, combine, ex, old, fresh);
+    }
+
     template <typename Fn>
     bool for_each_chunk_p(Fn&& fn) const
     {
@@ -246,6 +289,12 @@ struct rbtree
             for_each_chunk_p_i_visitor{}, first, last, std::forward<Fn>(fn));
     }
 
+    template <typename EqualValue, typename Differ>
+    void diff(const rbtree& other, Differ&& differ) const
+    {
+        diff_trees<EqualValue>(*this, other, differ);
+    }
+
     bool equals(const rbtree& other) const
     {
         if (size != other.size)
@@ -259,6 +308,38 @@ struct rbtree
                    .visit(equals_visitor{}, other.tail);
     }
 
+    // Moves the full tail, that starts at `tail_off`, into the tree and
+    // replaces it with `new_tail`, that the caller owns on failure.
+    void push_tail_mut(edit_t e, size_t tail_off, node_t* new_tail)
+    {
+        if (tail_off == size_t{branches<B>} << shift) {
+            auto new_root = node_t::make_inner_e(e);
+            IMMER_TRY {
+                auto path = node_t::make_path_e(e, shift, tail);
+                new_root->inner()[0] = root;
+                new_root->inner()[1] = path;
+                root                 = new_root;
+                tail                 = new_tail;
+                shift += B;
+            }
+            IMMER_CATCH (...) {
+                node_t::delete_inner_e(new_root);
+                IMMER_RETHROW;
+            }
+        } else if (tail_off) {
+            auto new_root = make_regular_sub_pos(root, shift, tail_off)
+                                .visit(push_tail_mut_visitor<node_t>{}, e, tail);
+            root = new_root;
+            tail = new_tail;
+        } else {
+            auto new_root = node_t::make_path_e(e, shift, tail);
+            assert(tail_off == 0);
+            dec_empty_regular(root);
+            root = new_root;
+            tail = new_tail;
+        }
+    }
+
     void ensure_mutable_tail(edit_t e, count_t n)
     {
         if (!tail->can_mutate(e)) {
@@ -269,42 +350,23 @@ struct rbtree
     }
 
     void push_back_mut(edit_t e, T value)
+    {
+        emplace_back_mut(e, std::move(value));
+    }
+
+    template <typename... Args>
+    void emplace_back_mut(edit_t e, Args&&... args)
     {
         auto tail_off = tail_offset();
         auto ts       = size - tail_off;
         if (ts < branches<BL>) {
             ensure_mutable_tail(e, ts);
-            new (&tail->leaf()[ts]) T{std::move(value)};
+            new (&tail->leaf()[ts]) T(std::forward<Args>(args)...);
         } else {
-            auto new_tail = node_t::make_leaf_e(e, std::move(value));
+            auto new_tail =
+                node_t::make_leaf_emplace_e(e, std::forward<Args>(args)...);
             IMMER_TRY {
-                if (tail_off == size_t{branches<B>} << shift) {
-                    auto new_root = node_t::make_inner_e(e);
-                    IMMER_TRY {
-                        auto path = node_t::make_path_e(e, shift, tail);
-                        new_root->inner()[0] = root;
-                        new_root->inner()[1] = path;
-                        root                 = new_root;
-                        tail                 = new_tail;
-                        shift += B;
-                    }
-                    IMMER_CATCH (...) {
-                        node_t::delete_inner_e(new_root);
-                        IMMER_RETHROW;
-                    }
-                } else if (tail_off) {
-                    auto new_root =
-                        make_regular_sub_pos(root, shift, tail_off)
-                            .visit(push_tail_mut_visitor<node_t>{}, e, tail);
-                    root = new_root;
-                    tail = new_tail;
-                } else {
-                    auto new_root = node_t::make_path_e(e, shift, tail);
-                    assert(tail_off == 0);
-                    dec_empty_regular(root);
-                    root = new_root;
-                    tail = new_tail;
-                }
+                push_tail_mut(e, tail_off, new_tail);
             }
             IMMER_CATCH (...) {
                 node_t::delete_leaf(new_tail, 1);
@@ -314,16 +376,55 @@ struct rbtree
         ++size;
     }
 
-    rbtree push_back(T value) const
+    // Pushes `n` copies of `v` at the end.  Once the tail is full, the
+    // full leaves that are pushed are all the same node, so only the
+    // inner nodes that hold them are allocated.
+    void fill_back_mut(edit_t e, size_t n, const T& v)
+    {
+        for (; n && size - tail_offset() < branches<BL>; --n)
+            push_back_mut(e, v);
+        if (n >= branches<BL>) {
+            auto leaf = node_t::make_leaf_n(branches<BL>);
+            IMMER_TRY {
+                std::uninitialized_fill_n(leaf->leaf(), branches<BL>, v);
+            }
+            IMMER_CATCH (...) {
+                node_t::heap::deallocate(node_t::sizeof_leaf_n(branches<BL>),
+                                         leaf);
+                IMMER_RETHROW;
+            }
+            IMMER_TRY {
+                for (; n >= branches<BL>; n -= branches<BL>) {
+                    push_tail_mut(e, tail_offset(), leaf->inc());
+                    size += branches<BL>;
+                }
+            }
+            IMMER_CATCH (...) {
+                // the reference taken for the failed push
+                leaf->dec();
+                dec_leaf(leaf, branches<BL>);
+                IMMER_RETHROW;
+            }
+            dec_leaf(leaf, branches<BL>);
+        }
+        for (; n; --n)
+            push_back_mut(e, v);
+    }
+
+    rbtree push_back(T value) const { return emplace_back(std::move(value)); }
+
+    template <typename... Args>
+    rbtree emplace_back(Args&&... args) const
     {
         auto tail_off = tail_offset();
         auto ts       = size - tail_off;
         if (ts < branches<BL>) {
-            auto new_tail =
-                node_t::copy_leaf_emplace(tail, ts, std::move(value));
+            auto new_tail = node_t::copy_leaf_emplace(
+                tail, ts, std::forward<Args>(args)...);
             return {size + 1, shift, root->inc(), new_tail};
         } else {
-            auto new_tail = node_t::make_leaf_n(1, std::move(value));
+            auto new_tail =
+                node_t::make_leaf_emplace_n(1, std::forward<Args>(args)...);
             IMMER_TRY {
                 if (tail_off == size_t{branches<B>} << shift) {
                     auto new_root = node_t::make_inner_n(2);
@@ -358,11 +459,68 @@ struct rbtree
         }
     }
 
+    template <typename Iter, typename Sent>
+    void append_mut(edit_t e, Iter first, Sent last)
+    {
+        while (first != last) {
+            auto ts = tail_size();
+            if (ts == branches<BL>) {
+                push_back_mut(e, *first);
+                ++first;
+            } else {
+                ensure_mutable_tail(e, ts);
+                for (; ts < branches<BL> && first != last; ++ts, ++first) {
+                    new (&tail->leaf()[ts]) T{*first};
+                    ++size;
+                }
+            }
+        }
+    }
+
+    template <typename Iter, typename Sent>
+    rbtree append(Iter first, Sent last) const
+    {
+        auto e      = owner_t{};
+        auto result = *this;
+        result.append_mut(e, first, last);
+        e = owner_t{};
+        return result;
+    }
+
     const T* array_for(size_t index) const
     {
         return descend(array_for_visitor<T>(), index);
     }
 
+    std::tuple<const T*, size_t, size_t> region_for(size_t idx) const
+    {
+        auto first = idx & ~mask<BL, size_t>;
+        auto last  = std::min(size, first + branches<BL, size_t>);
+        return std::make_tuple(array_for(idx), first, last);
+    }
+
+    std::tuple<T*, size_t, size_t> region_for_mut(edit_t e, size_t idx)
+    {
+        auto first = idx & ~mask<BL, size_t>;
+        auto last  = std::min(size, first + branches<BL, size_t>);
+        return std::make_tuple(&get_mut(e, idx) - (idx - first), first, last);
+    }
+
+    // Calls `fn(first, last)` with the elements in `[first, last)`,
+    // leaf by leaf, making every leaf mutable by `e` before.
+    template <typename Fn>
+    void for_each_chunk_mut(edit_t e, size_t first, size_t last, Fn&& fn)
+    {
+        while (first < last) {
+            auto region = region_for_mut(e, first);
+            auto data   = std::get<0>(region);
+            auto offset = std::get<1>(region);
+            auto end    = std::min(std::get<2>(region), last);
+            fn(data + (first - offset), data + (end - offset));
+            first = end;
+        }
+    }
+
     T& get_mut(edit_t e, size_t idx)
     {
         auto tail_off = tail_offset();
@@ -380,6 +538,46 @@ struct rbtree
         return descend(get_visitor<T>(), index);
     }
 
+    // Number of lookups that `get_many` interleaves.
+    static constexpr auto get_many_group = size_t{16};
+
+    // Writes to `out` the elements at the indices in `[first, last)`.
+    // The lookups are done in groups that descend together one level at
+    // a time, prefetching the nodes of the next level of all of them
+    // before reading any, so that their cache misses overlap.
+    template <typename Iter, typename Sent, typename Out>
+    Out get_many(Iter first, Sent last, Out out) const
+    {
+        auto tail_off = tail_offset();
+        node_t* nodes[get_many_group];
+        size_t indices[get_many_group];
+        while (first != last) {
+            auto n = size_t{};
+            for (; n < get_many_group && first != last; ++n, ++first) {
+                indices[n] = *first;
+                nodes[n]   = indices[n] >= tail_off ? tail : root;
+            }
+            for (auto level = shift; level != endshift<B, BL>; level -= B) {
+                for (auto i = size_t{}; i < n; ++i) {
+                    if (nodes[i] == tail)
+                        continue;
+                    auto idx = indices[i];
+                    auto p   = nodes[i]->inner()[(idx >> level) & mask<B>];
+                    nodes[i] = p;
+                    // the slot that is read at the next level
+                    if (level == BL)
+                        IMMER_PREFETCH_READ(p->leaf() + (idx & mask<BL>));
+                    else
+                        IMMER_PREFETCH_READ(
+                            p->inner() + ((idx >> (level - B)) & mask<B>));
+                }
+            }
+            for (auto i = size_t{}; i < n; ++i)
+                *out++ = nodes[i]->leaf()[indices[i] & mask<BL>];
+        }
+        return out;
+    }
+
     const T& get_check(size_t index) const
     {
         if (index >= size)
@@ -425,6 +623,24 @@ struct rbtree
         return update(idx, [&](auto&&) { return std::move(value); });
     }
 
+    template <typename Iter, typename Sent>
+    void assoc_many_mut(edit_t e, Iter first, Sent last)
+    {
+        using std::get;
+        for (; first != last; ++first)
+            assoc_mut(e, get<0>(*first), get<1>(*first));
+    }
+
+    template <typename Iter, typename Sent>
+    rbtree assoc_many(Iter first, Sent last) const
+    {
+        auto e      = owner_t{};
+        auto result = *this;
+        result.assoc_many_mut(e, first, last);
+        e = owner_t{};
+        return result;
+    }
+
     rbtree take(size_t new_size) const
     {
         auto tail_off = tail_offset();
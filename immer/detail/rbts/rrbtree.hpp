@@ -9,8 +9,10 @@
 #pragma once
 
 #include <immer/config.hpp>
+#include <immer/detail/rbts/diff.hpp>
 #include <immer/detail/rbts/node.hpp>
 #include <immer/detail/rbts/operations.hpp>
+#include <immer/detail/rbts/parallel.hpp>
 #include <immer/detail/rbts/position.hpp>
 
 #include <immer/detail/type_traits.hpp>
@@ -47,25 +49,9 @@ struct rrbtree
                ipow((size_t{1} << B) - 2, (S - BL) / B);
     }
 
-    static node_t* empty_root()
-    {
-        static const auto empty_ = []{
-            constexpr auto size = node_t::sizeof_inner_n(0);
-            static std::aligned_storage_t<size, alignof(std::max_align_t)> storage;
-            return node_t::make_inner_n_into(&storage, size, 0u);
-        }();
-        return empty_->inc();
-    }
+    static node_t* empty_root() { return node_t::empty_inner()->inc(); }
 
-    static node_t* empty_tail()
-    {
-        static const auto empty_ = []{
-            constexpr auto size = node_t::sizeof_leaf_n(0);
-            static std::aligned_storage_t<size, alignof(std::max_align_t)> storage;
-            return node_t::make_leaf_n_into(&storage, size, 0u);
-        }();
-        return empty_->inc();
-    }
+    static node_t* empty_tail() { return node_t::empty_leaf()->inc(); }
 
     template <typename U>
     static auto from_initializer_list(std::initializer_list<U> values)
@@ -74,6 +60,8 @@ struct rrbtree
         auto result = rrbtree{};
         for (auto&& v : values)
             result.push_back_mut(e, v);
+        // hand the nodes over to the result before `e` discards them
+        e = owner_t{};
         return result;
     }
 
@@ -86,16 +74,32 @@ struct rrbtree
         auto result = rrbtree{};
         for (; first != last; ++first)
             result.push_back_mut(e, *first);
+        e = owner_t{};
         return result;
     }
 
+    template <typename Iter, typename Executor>
+    static auto from_range_parallel(Iter first, Iter last, Executor&& ex)
+    {
+        if (first == last)
+            return rrbtree{};
+        auto size = static_cast<size_t>(std::distance(first, last));
+        auto tree = make_regular_tree_parallel<node_t>(size, first, ex);
+        auto root = std::get<1>(tree);
+        return rrbtree{size,
+                       std::get<0>(tree),
+                       root ? root : empty_root(),
+                       std::get<2>(tree)};
+    }
+
     static auto from_fill(size_t n, T v)
     {
-        auto e      = owner_t{};
-        auto result = rrbtree{};
-        while (n-- > 0)
-            result.push_back_mut(e, v);
-        return result;
+        if (n == 0)
+            return rrbtree{};
+        auto tree = make_filled_tree<node_t>(n, v);
+        auto root = std::get<1>(tree);
+        return rrbtree{
+            n, std::get<0>(tree), root ? root : empty_root(), std::get<2>(tree)};
     }
 
     rrbtree() noexcept
@@ -158,7 +162,15 @@ struct rrbtree
         tail->inc();
     }
 
-    void dec() const { traverse(dec_visitor()); }
+    void dec() const
+    {
+        IMMER_TRACE_RELEASE_SCOPE();
+        // the offsets are read from the root, before it is freed
+        auto offset = tail_offset();
+        auto n      = tail_size();
+        dec_inner(root, shift, offset);
+        dec_leaf(tail, n);
+    }
 
     auto tail_size() const { return size - tail_offset(); }
 
@@ -267,6 +279,29 @@ struct rrbtree
         traverse(for_each_chunk_i_visitor{}, first, last, std::forward<Fn>(fn));
     }
 
+    template <typename Fn, typename Executor>
+    void par_for_each_chunk(Fn&& fn, Executor& ex) const
+    {
+        auto leaves = (size + mask<BL>) >> BL;
+        auto grain  = std::max(bulk_min_elements >> BL, size_t{1});
+        bulk_ranges(ex, leaves, grain, [&](size_t first, size_t last) {
+            for_each_chunk(
+                first << BL, std::min(last << BL, size), [&](auto f, auto l) {
+                    fn(as_const(f), as_const(l));
+                });
+        });
+    }
+
+    template <typename U, typename Combine, typename Executor>
+    U par_reduce(const U& init,
+                 Combine& combine,
+                 Executor& ex,
+                 const typename reduce_cache<U>::map_t* old,
+                 typename reduce_cache<U>::map_t* fresh) const
+    {
+        return par_reduce_tree(*this, init, combine, ex, old, fresh);
+    }
+
     template <typename Fn>
     bool for_each_chunk_p(Fn&& fn) const
     {
@@ -280,6 +315,12 @@ struct rrbtree
             for_each_chunk_p_i_visitor{}, first, last, std::forward<Fn>(fn));
     }
 
+    template <typename EqualValue, typename Differ>
+    void diff(const rrbtree& other, Differ&& differ) const
+    {
+        diff_trees<EqualValue>(*this, other, differ);
+    }
+
     bool equals(const rrbtree& other) const
     {
         using iter_t = rrbtree_iterator<T, MemoryPolicy, B, BL>;
@@ -320,14 +361,15 @@ struct rrbtree
                    ? make_leaf_sub_pos(tail, tail_size())
                          .visit(equals_visitor{}, other.tail)
                : tail_off > tail_off_other
-                   ? std::equal(tail->leaf(),
-                                tail->leaf() + (size - tail_off),
-                                other.tail->leaf() +
-                                    (tail_off - tail_off_other))
+                   ? equal_values(tail->leaf(),
+                                  tail->leaf() + (size - tail_off),
+                                  other.tail->leaf() +
+                                      (tail_off - tail_off_other))
                    /* otherwise */
-                   : std::equal(tail->leaf(),
-                                tail->leaf() + (size - tail_off),
-                                iter_t{other} + tail_off);
+                   : equals_visitor::equal_range(iter_t{other} + tail_off,
+                                                 tail->leaf(),
+                                                 tail->leaf() +
+                                                     (size - tail_off));
     }
 
     std::tuple<shift_t, node_t*> push_tail(node_t* root,
@@ -444,14 +486,21 @@ struct rrbtree
     }
 
     void push_back_mut(edit_t e, T value)
+    {
+        emplace_back_mut(e, std::move(value));
+    }
+
+    template <typename... Args>
+    void emplace_back_mut(edit_t e, Args&&... args)
     {
         auto ts = tail_size();
         if (ts < branches<BL>) {
             ensure_mutable_tail(e, ts);
-            new (&tail->leaf()[ts]) T{std::move(value)};
+            new (&tail->leaf()[ts]) T(std::forward<Args>(args)...);
         } else {
             using std::get;
-            auto new_tail = node_t::make_leaf_e(e, std::move(value));
+            auto new_tail =
+                node_t::make_leaf_emplace_e(e, std::forward<Args>(args)...);
             auto tail_off = tail_offset();
             IMMER_TRY {
                 push_tail_mut(e, tail_off, tail, ts);
@@ -465,16 +514,20 @@ struct rrbtree
         ++size;
     }
 
-    rrbtree push_back(T value) const
+    rrbtree push_back(T value) const { return emplace_back(std::move(value)); }
+
+    template <typename... Args>
+    rrbtree emplace_back(Args&&... args) const
     {
         auto ts = tail_size();
         if (ts < branches<BL>) {
-            auto new_tail =
-                node_t::copy_leaf_emplace(tail, ts, std::move(value));
+            auto new_tail = node_t::copy_leaf_emplace(
+                tail, ts, std::forward<Args>(args)...);
             return {size + 1, shift, root->inc(), new_tail};
         } else {
             using std::get;
-            auto new_tail = node_t::make_leaf_n(1u, std::move(value));
+            auto new_tail =
+                node_t::make_leaf_emplace_n(1u, std::forward<Args>(args)...);
             auto tail_off = tail_offset();
             IMMER_TRY {
                 auto new_root =
@@ -489,6 +542,350 @@ struct rrbtree
         }
     }
 
+    template <typename Iter, typename Sent>
+    void append_mut(edit_t e, Iter first, Sent last)
+    {
+        while (first != last) {
+            auto ts = tail_size();
+            if (ts == branches<BL>) {
+                push_back_mut(e, *first);
+                ++first;
+            } else {
+                ensure_mutable_tail(e, ts);
+                for (; ts < branches<BL> && first != last; ++ts, ++first) {
+                    new (&tail->leaf()[ts]) T{*first};
+                    ++size;
+                }
+            }
+        }
+    }
+
+    template <typename Iter, typename Sent>
+    rrbtree append(Iter first, Sent last) const
+    {
+        auto e      = owner_t{};
+        auto result = *this;
+        result.append_mut(e, first, last);
+        e = owner_t{};
+        return result;
+    }
+
+    void compact_mut(edit_t e)
+    {
+        if (!root->relaxed())
+            return;
+        auto result = rrbtree{};
+        for_each_chunk([&](auto f, auto l) { result.append_mut(e, f, l); });
+        swap(*this, result);
+    }
+
+    rrbtree compact() const
+    {
+        if (!root->relaxed())
+            return *this;
+        auto e      = owner_t{};
+        auto result = rrbtree{};
+        for_each_chunk([&](auto f, auto l) { result.append_mut(e, f, l); });
+        e = owner_t{};
+        return result;
+    }
+
+    void push_front_mut(edit_t e, T value)
+    {
+        auto tail_off = tail_offset();
+        if (tail_off == 0) {
+            auto ts = size;
+            if (ts < branches<BL>) {
+                tail = push_front_leaf_mut(e, tail, ts, value);
+            } else {
+                auto new_leaf = node_t::make_leaf_e(e, std::move(value));
+                auto new_root = static_cast<node_t*>(nullptr);
+                IMMER_TRY {
+                    new_root = node_t::make_inner_r_e(e);
+                }
+                IMMER_CATCH (...) {
+                    node_t::delete_leaf(new_leaf, 1u);
+                    IMMER_RETHROW;
+                }
+                auto r               = new_root->relaxed();
+                new_root->inner()[0] = new_leaf;
+                r->d.sizes[0]        = 1;
+                r->d.count           = 1;
+                dec_empty_regular(root);
+                root  = new_root;
+                shift = BL;
+            }
+        } else {
+            root       = ensure_relaxed_mut(e, root, shift, tail_off);
+            auto front = push_front_relaxed_mut(e, root, shift, value);
+            if (front) {
+                auto new_root = static_cast<node_t*>(nullptr);
+                IMMER_TRY {
+                    new_root = node_t::make_inner_r_e(e);
+                }
+                IMMER_CATCH (...) {
+                    dec_relaxed(front, shift);
+                    IMMER_RETHROW;
+                }
+                auto r               = new_root->relaxed();
+                new_root->inner()[0] = front;
+                new_root->inner()[1] = root;
+                r->d.sizes[0]        = 1;
+                r->d.sizes[1]        = tail_off + 1;
+                r->d.count           = 2;
+                root                 = new_root;
+                shift += B;
+            }
+        }
+        ++size;
+    }
+
+    rrbtree push_front(T value) const
+    {
+        auto tail_off = tail_offset();
+        if (tail_off == 0) {
+            if (size < branches<BL>) {
+                auto new_tail = copy_leaf_push_front(tail, size, value);
+                return {size + 1, shift, root->inc(), new_tail};
+            } else {
+                auto new_leaf = node_t::make_leaf_n(1u, std::move(value));
+                IMMER_TRY {
+                    auto new_root        = node_t::make_inner_r_n(1u);
+                    auto r               = new_root->relaxed();
+                    new_root->inner()[0] = new_leaf;
+                    r->d.sizes[0]        = 1;
+                    r->d.count           = 1;
+                    return {size + 1, BL, new_root, tail->inc()};
+                }
+                IMMER_CATCH (...) {
+                    node_t::delete_leaf(new_leaf, 1u);
+                    IMMER_RETHROW;
+                }
+            }
+        } else {
+            auto is_front = false;
+            auto node =
+                push_front_inner(root, shift, tail_off, value, is_front);
+            if (!is_front)
+                return {size + 1, shift, node, tail->inc()};
+            IMMER_TRY {
+                auto new_root        = node_t::make_inner_r_n(2u);
+                auto r               = new_root->relaxed();
+                new_root->inner()[0] = node;
+                new_root->inner()[1] = root->inc();
+                r->d.sizes[0]        = 1;
+                r->d.sizes[1]        = tail_off + 1;
+                r->d.count           = 2;
+                return {size + 1, shift + B, new_root, tail->inc()};
+            }
+            IMMER_CATCH (...) {
+                dec_relaxed(node, shift);
+                IMMER_RETHROW;
+            }
+        }
+    }
+
+    // Returns a leaf with `value` followed by the `n` elements of
+    // `leaf`.
+    static node_t* copy_leaf_push_front(node_t* leaf, count_t n, T& value)
+    {
+        auto dst = node_t::make_leaf_n(n + 1, std::move(value));
+        IMMER_TRY {
+            detail::uninitialized_copy(
+                leaf->leaf(), leaf->leaf() + n, dst->leaf() + 1);
+        }
+        IMMER_CATCH (...) {
+            detail::destroy_at(dst->leaf());
+            node_t::heap::deallocate(node_t::sizeof_leaf_n(n + 1), dst);
+            IMMER_RETHROW;
+        }
+        return dst;
+    }
+
+    // Returns a relaxed copy of the inner `node` at `shift`, which holds
+    // `size` elements, with `value` in front.  When the node has no
+    // room left, it sets `is_front` and returns a new node at the same
+    // `shift` holding just `value`, to be put in front of it instead.
+    static node_t* push_front_inner(
+        node_t* node, shift_t shift, size_t size, T& value, bool& is_front)
+    {
+        auto r = node->relaxed();
+        auto n = r ? r->d.count
+                   : static_cast<count_t>(((size - 1) >> shift) + 1);
+        auto sizes = [&](count_t i) {
+            return r ? r->d.sizes[i] : std::min(size, size_t{i + 1u} << shift);
+        };
+        auto csize       = sizes(0);
+        auto child       = static_cast<node_t*>(nullptr);
+        auto child_front = false;
+        if (shift == BL) {
+            child_front = csize == branches<BL>;
+            if (child_front)
+                child = node_t::make_leaf_n(1u, std::move(value));
+            else
+                child = copy_leaf_push_front(node->inner()[0], csize, value);
+        } else {
+            child = push_front_inner(
+                node->inner()[0], shift - B, csize, value, child_front);
+        }
+        auto m   = n + child_front;
+        auto dst = static_cast<node_t*>(nullptr);
+        IMMER_TRY {
+            dst = node_t::make_inner_r_n(
+                child_front && n == branches<B> ? 1u : m);
+        }
+        IMMER_CATCH (...) {
+            if (shift == BL)
+                dec_leaf(child, child_front ? 1u : csize + 1);
+            else
+                dec_relaxed(child, shift - B);
+            IMMER_RETHROW;
+        }
+        auto dst_r = dst->relaxed();
+        if (child_front && n == branches<B>) {
+            dst->inner()[0]   = child;
+            dst_r->d.sizes[0] = 1;
+            dst_r->d.count    = 1;
+            is_front          = true;
+        } else {
+            auto p = dst->inner() + child_front;
+            std::copy(node->inner(), node->inner() + n, p);
+            node_t::inc_nodes(p + !child_front, n - !child_front);
+            for (auto i = count_t{0}; i < n; ++i)
+                dst_r->d.sizes[i + child_front] = sizes(i) + 1;
+            dst->inner()[0]   = child;
+            dst_r->d.sizes[0] = child_front ? 1 : dst_r->d.sizes[0];
+            dst_r->d.count    = m;
+        }
+        return dst;
+    }
+
+    // Returns a mutable leaf with `value` followed by the `n` elements
+    // of `leaf`, which it replaces.  The elements are only shifted in
+    // place when that can not throw, so that `leaf` is left untouched
+    // otherwise.  Relocatable elements are shifted with one `memmove`.
+    static node_t*
+    push_front_leaf_mut(edit_t e, node_t* leaf, count_t n, T& value)
+    {
+        constexpr auto can_shift = std::is_nothrow_move_constructible<T>{} &&
+                                   std::is_nothrow_move_assignable<T>{};
+        if ((can_shift || detail::can_relocate<T>) && leaf->can_mutate(e)) {
+            auto p = leaf->leaf();
+            if (detail::can_relocate<T>) {
+                detail::uninitialized_relocate(p, p + n, p + 1);
+                IMMER_TRY {
+                    new (p) T{std::move(value)};
+                }
+                IMMER_CATCH (...) {
+                    detail::uninitialized_relocate(p + 1, p + n + 1, p);
+                    IMMER_RETHROW;
+                }
+            } else if (n) {
+                new (p + n) T{std::move(p[n - 1])};
+                std::move_backward(p, p + n - 1, p + n);
+                p[0] = std::move(value);
+            } else {
+                new (p) T{std::move(value)};
+            }
+            return leaf;
+        } else {
+            auto dst = node_t::make_leaf_e(e, std::move(value));
+            IMMER_TRY {
+                detail::uninitialized_copy(
+                    leaf->leaf(), leaf->leaf() + n, dst->leaf() + 1);
+            }
+            IMMER_CATCH (...) {
+                node_t::delete_leaf(dst, 1u);
+                IMMER_RETHROW;
+            }
+            dec_leaf(leaf, n);
+            return dst;
+        }
+    }
+
+    // Returns a mutable relaxed node with the same contents as the
+    // inner `node` at `shift`, which it replaces.
+    static node_t*
+    ensure_relaxed_mut(edit_t e, node_t* node, shift_t shift, size_t size)
+    {
+        if (auto r = node->relaxed()) {
+            if (node->can_mutate(e)) {
+                node->ensure_mutable_relaxed(e);
+                return node;
+            }
+            auto dst = node_t::copy_inner_r_e(e, node, r->d.count);
+            dec_relaxed(node, shift);
+            return dst;
+        } else {
+            auto n     = static_cast<count_t>(((size - 1) >> shift) + 1);
+            auto dst   = node_t::make_inner_r_e(e);
+            auto dst_r = dst->relaxed();
+            node_t::inc_nodes(node->inner(), n);
+            std::copy(node->inner(), node->inner() + n, dst->inner());
+            for (auto i = count_t{0}; i < n; ++i)
+                dst_r->d.sizes[i] = std::min(size, size_t{i + 1u} << shift);
+            dst_r->d.count = n;
+            dec_regular(node, shift, size);
+            return dst;
+        }
+    }
+
+    // Puts `value` in front of the mutable relaxed `node` at `shift`.
+    // When it has no room left, it returns a new node at the same
+    // `shift` holding just `value`, to be put in front of it instead.
+    static node_t*
+    push_front_relaxed_mut(edit_t e, node_t* node, shift_t shift, T& value)
+    {
+        auto r     = node->relaxed();
+        auto n     = r->d.count;
+        auto csize = r->d.sizes[0];
+        auto front = static_cast<node_t*>(nullptr);
+        if (shift == BL) {
+            if (csize < branches<BL>)
+                node->inner()[0] =
+                    push_front_leaf_mut(e, node->inner()[0], csize, value);
+            else
+                front = node_t::make_leaf_e(e, std::move(value));
+        } else {
+            auto child =
+                ensure_relaxed_mut(e, node->inner()[0], shift - B, csize);
+            node->inner()[0] = child;
+            front = push_front_relaxed_mut(e, child, shift - B, value);
+        }
+        if (!front) {
+            for (auto i = count_t{0}; i < n; ++i)
+                ++r->d.sizes[i];
+            return nullptr;
+        } else if (n < branches<B>) {
+            auto p = node->inner();
+            auto s = r->d.sizes;
+            std::move_backward(p, p + n, p + n + 1);
+            for (auto i = n; i > 0; --i)
+                s[i] = s[i - 1] + 1;
+            p[0]       = front;
+            s[0]       = 1;
+            r->d.count = n + 1;
+            return nullptr;
+        } else {
+            auto wrap = static_cast<node_t*>(nullptr);
+            IMMER_TRY {
+                wrap = node_t::make_inner_r_e(e);
+            }
+            IMMER_CATCH (...) {
+                if (shift == BL)
+                    node_t::delete_leaf(front, 1u);
+                else
+                    dec_relaxed(front, shift - B);
+                IMMER_RETHROW;
+            }
+            auto wrap_r        = wrap->relaxed();
+            wrap->inner()[0]   = front;
+            wrap_r->d.sizes[0] = 1;
+            wrap_r->d.count    = 1;
+            return wrap;
+        }
+    }
+
     std::tuple<const T*, size_t, size_t> region_for(size_t idx) const
     {
         using std::get;
@@ -504,6 +901,29 @@ struct rrbtree
         }
     }
 
+    std::tuple<T*, size_t, size_t> region_for_mut(edit_t e, size_t idx)
+    {
+        auto& x     = get_mut(e, idx);
+        auto region = region_for(idx);
+        auto first  = std::get<1>(region);
+        return std::make_tuple(&x - (idx - first), first, std::get<2>(region));
+    }
+
+    // Calls `fn(first, last)` with the elements in `[first, last)`,
+    // leaf by leaf, making every leaf mutable by `e` before.
+    template <typename Fn>
+    void for_each_chunk_mut(edit_t e, size_t first, size_t last, Fn&& fn)
+    {
+        while (first < last) {
+            auto region = region_for_mut(e, first);
+            auto data   = std::get<0>(region);
+            auto offset = std::get<1>(region);
+            auto end    = std::min(std::get<2>(region), last);
+            fn(data + (first - offset), data + (end - offset));
+            first = end;
+        }
+    }
+
     T& get_mut(edit_t e, size_t idx)
     {
         auto tail_off = tail_offset();
@@ -526,6 +946,51 @@ struct rrbtree
         return descend(get_visitor<T>(), index);
     }
 
+    // Number of lookups that `get_many` interleaves.
+    static constexpr auto get_many_group = size_t{16};
+
+    // Writes to `out` the elements at the indices in `[first, last)`,
+    // descending for a group of them at once, like `rbtree::get_many`.
+    // Since the slot to read in a relaxed node depends on its sizes,
+    // only the nodes are prefetched.
+    template <typename Iter, typename Sent, typename Out>
+    Out get_many(Iter first, Sent last, Out out) const
+    {
+        auto tail_off = tail_offset();
+        node_t* nodes[get_many_group];
+        size_t indices[get_many_group];
+        while (first != last) {
+            auto n = size_t{};
+            for (; n < get_many_group && first != last; ++n, ++first) {
+                auto idx   = static_cast<size_t>(*first);
+                nodes[n]   = idx >= tail_off ? tail : root;
+                indices[n] = idx >= tail_off ? idx - tail_off : idx;
+            }
+            for (auto level = shift; level != endshift<B, BL>; level -= B) {
+                for (auto i = size_t{}; i < n; ++i) {
+                    if (nodes[i] == tail)
+                        continue;
+                    auto& idx   = indices[i];
+                    auto node   = nodes[i];
+                    auto offset = static_cast<count_t>(idx >> level);
+                    if (auto r = node->relaxed()) {
+                        while (r->d.sizes[offset] <= idx)
+                            ++offset;
+                        if (offset)
+                            idx -= r->d.sizes[offset - 1];
+                    } else {
+                        offset &= mask<B>;
+                    }
+                    nodes[i] = node->inner()[offset];
+                    IMMER_PREFETCH_READ(nodes[i]);
+                }
+            }
+            for (auto i = size_t{}; i < n; ++i)
+                *out++ = nodes[i]->leaf()[indices[i] & mask<BL>];
+        }
+        return out;
+    }
+
     const T& get_check(size_t index) const
     {
         if (index >= size)
@@ -571,6 +1036,24 @@ struct rrbtree
         return update(idx, [&](auto&&) { return std::move(value); });
     }
 
+    template <typename Iter, typename Sent>
+    void assoc_many_mut(edit_t e, Iter first, Sent last)
+    {
+        using std::get;
+        for (; first != last; ++first)
+            assoc_mut(e, get<0>(*first), get<1>(*first));
+    }
+
+    template <typename Iter, typename Sent>
+    rrbtree assoc_many(Iter first, Sent last) const
+    {
+        auto e      = owner_t{};
+        auto result = *this;
+        result.assoc_many_mut(e, first, last);
+        e = owner_t{};
+        return result;
+    }
+
     void take_mut(edit_t e, size_t new_size)
     {
         auto tail_off = tail_offset();
@@ -0,0 +1,97 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/rbts/bits.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+namespace immer {
+namespace detail {
+namespace rbts {
+
+/*!
+ * A subtree placed at the absolute index range `[first, first +
+ * size)` of the sequence.  The `level` is `0` for leaves and grows by
+ * one on every inner level above.
+ */
+template <typename NodeT>
+struct subtree
+{
+    NodeT* node;
+    count_t level;
+    size_t first;
+    size_t size;
+
+    size_t last() const { return first + size; }
+};
+
+/*!
+ * Calls `fn(child)` for the children of the inner subtree `p` that
+ * overlap `[lo, hi)`, in order.
+ */
+template <typename NodeT, typename Fn>
+void each_subtree(const subtree<NodeT>& p, size_t lo, size_t hi, Fn&& fn)
+{
+    constexpr auto B  = NodeT::bits;
+    constexpr auto BL = NodeT::bits_leaf;
+    assert(p.level > 0);
+    auto shift = static_cast<shift_t>(BL + (p.level - 1) * B);
+    auto r     = p.node->relaxed();
+    if (r) {
+        auto before = size_t{};
+        for (auto i = count_t{}; i < r->d.count; ++i) {
+            auto c = subtree<NodeT>{p.node->inner()[i],
+                                     p.level - 1,
+                                     p.first + before,
+                                     r->d.sizes[i] - before};
+            before = r->d.sizes[i];
+            if (c.first >= hi)
+                break;
+            if (c.last() > lo)
+                fn(c);
+        }
+    } else {
+        auto csize = size_t{1} << shift;
+        auto i     = static_cast<count_t>((lo - p.first) >> shift);
+        for (auto f = p.first + (size_t{i} << shift); f < hi && f < p.last();
+             f += csize, ++i)
+            fn(subtree<NodeT>{p.node->inner()[i],
+                               p.level - 1,
+                               f,
+                               std::min(csize, p.last() - f)});
+    }
+}
+
+/*!
+ * Fills `out` with the subtrees that hold the elements of the tree
+ * `t`, which can be either `rbtree` or `rrbtree`: the root, when it is
+ * not empty, followed by the tail.  Returns how many were written.
+ */
+template <typename Tree>
+int root_subtrees(const Tree& t, subtree<typename Tree::node_t>* out)
+{
+    using node_t      = typename Tree::node_t;
+    constexpr auto B  = node_t::bits;
+    constexpr auto BL = node_t::bits_leaf;
+    auto n            = 0;
+    auto tail_off     = t.tail_offset();
+    auto level        = static_cast<count_t>((t.shift - BL) / B + 1);
+    if (tail_off)
+        out[n++] = {t.root, level, 0, tail_off};
+    if (t.size > tail_off)
+        out[n++] = {t.tail, 0, tail_off, t.size - tail_off};
+    return n;
+}
+
+} // namespace rbts
+} // namespace detail
+} // namespace immer
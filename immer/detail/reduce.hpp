@@ -0,0 +1,120 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/executor.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace immer {
+namespace detail {
+
+/*!
+ * Partial results of a reduction, keyed by the identity of the node
+ * that holds the reduced elements and the number of elements of the
+ * node that are considered.
+ */
+template <typename T>
+struct reduce_cache
+{
+    using key_t = std::pair<const void*, std::size_t>;
+
+    struct key_hash
+    {
+        std::size_t operator()(const key_t& k) const
+        {
+            auto h = std::hash<const void*>{}(k.first);
+            return h ^ (std::hash<std::size_t>{}(k.second) + 0x9e3779b9 +
+                        (h << 6) + (h >> 2));
+        }
+    };
+
+    using map_t = std::unordered_map<key_t, T, key_hash>;
+};
+
+/*!
+ * State of one task of a reduction.  When `old` is not null the
+ * partial results of the subtrees are looked up there before
+ * computing them, and every partial result that the reduction uses is
+ * recorded in `fresh`, so a later reduction can reuse it too.
+ */
+template <typename T>
+struct reduce_task
+{
+    using cache_t = reduce_cache<T>;
+    using key_t   = typename cache_t::key_t;
+    using map_t   = typename cache_t::map_t;
+
+    const map_t* old;
+    std::vector<std::pair<key_t, T>> fresh;
+
+    bool memoizing() const { return old != nullptr; }
+
+    const T* find(const void* node, std::size_t size) const
+    {
+        auto it = old->find(key_t{node, size});
+        return it == old->end() ? nullptr : &it->second;
+    }
+
+    void record(const void* node, std::size_t size, const T& v)
+    {
+        fresh.emplace_back(key_t{node, size}, v);
+    }
+};
+
+/*!
+ * Reduces, in order, the partial results `reduce_sub(sub, task)` of
+ * every subtree in `subs`, distributing them over the executor `ex`.
+ * The `init` value must be an identity of `combine`, as it is used to
+ * start the partial result of every task.  When `fresh` is not null,
+ * the partial results recorded by the tasks are moved into it.
+ */
+template <typename T,
+          typename Sub,
+          typename Combine,
+          typename Executor,
+          typename ReduceSub>
+T reduce_subtrees(const std::vector<Sub>& subs,
+                  const T& init,
+                  Combine& combine,
+                  Executor& ex,
+                  const typename reduce_cache<T>::map_t* old,
+                  typename reduce_cache<T>::map_t* fresh,
+                  ReduceSub&& reduce_sub)
+{
+    auto n        = subs.size();
+    auto tasks    = bulk_tasks(ex, n);
+    auto partials = std::vector<T>(tasks, init);
+    auto states   = std::vector<reduce_task<T>>(tasks, reduce_task<T>{old, {}});
+    auto work     = [&](std::size_t i) {
+        for (auto j = n * i / tasks, e = n * (i + 1) / tasks; j != e; ++j)
+            partials[i] =
+                combine(std::move(partials[i]), reduce_sub(subs[j], states[i]));
+    };
+    if (tasks == 1)
+        work(0);
+    else
+        ex.bulk(tasks, work);
+    auto result = init;
+    for (auto& p : partials)
+        result = combine(std::move(result), std::move(p));
+    if (fresh)
+        for (auto& s : states)
+            for (auto& e : s.fresh)
+                fresh->insert(std::move(e));
+    return result;
+}
+
+} // namespace detail
+} // namespace immer
@@ -0,0 +1,165 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/combine_standard_layout.hpp>
+#include <immer/detail/hamts/bits.hpp>
+#include <immer/detail/util.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace immer {
+namespace detail {
+namespace sparse {
+
+using count_t  = std::uint32_t;
+using size_t   = std::size_t;
+using bitmap_t = std::uint32_t;
+using index_t  = std::uint64_t;
+
+// Every node covers 32 times the slots of its children, and a leaf 32
+// slots.  Twelve levels cover the indices below 2^60.
+constexpr count_t bits       = 5;
+constexpr count_t branches   = 1u << bits;
+constexpr count_t max_levels = 12;
+
+constexpr size_t align_up(size_t n, size_t a) { return (n + a - 1) / a * a; }
+
+/*!
+ * Node of the radix trie of a sparse vector.  Like the nodes of the
+ * hash tries, it only stores the children, or in a leaf the values,
+ * whose bit is set in its `map`, in the order of those bits, right
+ * after the node in the same allocation.  Every node also counts the
+ * values stored under it.
+ */
+template <typename T, typename MemoryPolicy>
+struct node
+{
+    using node_t = node;
+
+    using memory      = MemoryPolicy;
+    using heap_policy = typename memory::heap;
+    using heap        = typename heap_policy::type;
+    using refs_t      = typename memory::refcount;
+
+    struct impl_data_t
+    {
+        size_t count;
+        bitmap_t map;
+    };
+
+    using impl_t = combine_standard_layout_t<impl_data_t, refs_t>;
+
+    impl_t impl;
+
+    static constexpr size_t data_offset =
+        align_up(sizeof(impl_t), std::max(alignof(T), alignof(node_t*)));
+
+    constexpr static size_t sizeof_inner_n(count_t n)
+    {
+        return data_offset + sizeof(node_t*) * n;
+    }
+
+    constexpr static size_t sizeof_leaf_n(count_t n)
+    {
+        return data_offset + sizeof(T) * n;
+    }
+
+    size_t count() const { return impl.d.count; }
+    bitmap_t map() const { return impl.d.map; }
+    count_t size() const { return hamts::popcount(map()); }
+
+    char* data() { return reinterpret_cast<char*>(this) + data_offset; }
+    const char* data() const
+    {
+        return reinterpret_cast<const char*>(this) + data_offset;
+    }
+
+    node_t** children() { return reinterpret_cast<node_t**>(data()); }
+    node_t* const* children() const
+    {
+        return reinterpret_cast<node_t* const*>(data());
+    }
+
+    T* values() { return reinterpret_cast<T*>(data()); }
+    const T* values() const { return reinterpret_cast<const T*>(data()); }
+
+    static refs_t& refs(const node_t* x)
+    {
+        return auto_const_cast(get<refs_t>(x->impl));
+    }
+
+    static const node_t* inc(const node_t* n)
+    {
+        if (n)
+            refs(n).inc();
+        return n;
+    }
+
+    bool unique() const { return refs(this).unique(); }
+
+    // Makes an inner node with the `n` children in `cs`, and takes
+    // ownership of them only when it does not throw.
+    static node_t* make_inner(bitmap_t map, node_t* const* cs, count_t n)
+    {
+        auto p = new (heap::allocate(sizeof_inner_n(n))) node_t;
+        auto c = size_t{};
+        for (auto i = count_t{}; i < n; ++i) {
+            p->children()[i] = cs[i];
+            c += cs[i]->count();
+        }
+        p->impl.d.map   = map;
+        p->impl.d.count = c;
+        return p;
+    }
+
+    // Makes a leaf with the `n` values of the bits of `map`, calling
+    // `init(i, p)` to construct the value `i` at `p`.
+    template <typename Fn>
+    static node_t* make_leaf(bitmap_t map, count_t n, Fn&& init)
+    {
+        auto p = new (heap::allocate(sizeof_leaf_n(n))) node_t;
+        auto i = count_t{};
+        IMMER_TRY {
+            for (; i < n; ++i)
+                init(i, p->values() + i);
+        }
+        IMMER_CATCH (...) {
+            detail::destroy_n(p->values(), i);
+            heap::deallocate(sizeof_leaf_n(n), p);
+            IMMER_RETHROW;
+        }
+        p->impl.d.map   = map;
+        p->impl.d.count = n;
+        return p;
+    }
+
+    static void release(const node_t* p, count_t level)
+    {
+        if (!p || !refs(p).dec())
+            return;
+        auto q = const_cast<node_t*>(p);
+        auto n = q->size();
+        if (level) {
+            for (auto i = count_t{}; i < n; ++i)
+                release(q->children()[i], level - 1);
+            heap::deallocate(sizeof_inner_n(n), q);
+        } else {
+            detail::destroy_n(q->values(), n);
+            heap::deallocate(sizeof_leaf_n(n), q);
+        }
+    }
+};
+
+} // namespace sparse
+} // namespace detail
+} // namespace immer
@@ -0,0 +1,308 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/sparse/node.hpp>
+
+#include <algorithm>
+#include <new>
+#include <utility>
+
+namespace immer {
+namespace detail {
+namespace sparse {
+
+/*!
+ * The operations on the tries of a sparse vector.  A trie of `level`
+ * has `level` inner levels above its leaves, and covers the indices
+ * below `capacity(level)`.  Like the ones of a bitset, the operations
+ * take the nodes that they read by `const` pointer and return an owned
+ * reference to the node of the result, sharing the subtrees that do
+ * not change.  An empty subtree is `nullptr`.
+ */
+template <typename T, typename MemoryPolicy>
+struct trie
+{
+    using node_t = node<T, MemoryPolicy>;
+
+    static constexpr count_t shift_of(count_t level) { return level * bits; }
+
+    static constexpr index_t capacity(count_t level)
+    {
+        return index_t{1} << shift_of(level + 1);
+    }
+
+    static count_t index(index_t i, count_t level)
+    {
+        return static_cast<count_t>(i >> shift_of(level)) & (branches - 1);
+    }
+
+    static count_t position(bitmap_t map, bitmap_t bit)
+    {
+        return hamts::popcount(static_cast<bitmap_t>(map & (bit - 1)));
+    }
+
+    // The number of levels that the indices up to `i` need.
+    static count_t levels_for(index_t i)
+    {
+        auto level = count_t{};
+        while (i >= capacity(level))
+            ++level;
+        return level;
+    }
+
+    static const T* find(const node_t* n, count_t level, index_t i)
+    {
+        while (n) {
+            auto bit = bitmap_t{1} << index(i, level);
+            if (!(n->map() & bit))
+                return nullptr;
+            auto pos = position(n->map(), bit);
+            if (!level)
+                return n->values() + pos;
+            n = n->children()[pos];
+            --level;
+        }
+        return nullptr;
+    }
+
+    // The value at `i` when it is stored and the path to it is not
+    // shared, so that it can be updated in place.
+    static T* find_unique(const node_t* n, count_t level, index_t i)
+    {
+        while (n && n->unique()) {
+            auto bit = bitmap_t{1} << index(i, level);
+            if (!(n->map() & bit))
+                return nullptr;
+            auto pos = position(n->map(), bit);
+            if (!level)
+                return const_cast<node_t*>(n)->values() + pos;
+            n = n->children()[pos];
+            --level;
+        }
+        return nullptr;
+    }
+
+    // Makes the root of `levels` levels, above the root `n` of a trie
+    // of `level` levels, that takes ownership of `n`.
+    static const node_t* grow(const node_t* n, count_t level, count_t levels)
+    {
+        for (; n && level < levels; ++level) {
+            auto c = const_cast<node_t*>(n);
+            IMMER_TRY {
+                n = node_t::make_inner(1, &c, 1);
+            }
+            IMMER_CATCH (...) {
+                node_t::release(n, level);
+                IMMER_RETHROW;
+            }
+        }
+        return n;
+    }
+
+    // The trie `n` with `v` at `i`.
+    static const node_t*
+    set(const node_t* n, count_t level, index_t i, T& v, bool& added)
+    {
+        auto map = n ? n->map() : bitmap_t{};
+        auto bit = bitmap_t{1} << index(i, level);
+        auto pos = position(map, bit);
+        auto has = (map & bit) != 0;
+        if (!level) {
+            added  = !has;
+            auto k = (n ? n->size() : 0) + added;
+            return node_t::make_leaf(map | bit, k, [&](count_t j, T* p) {
+                if (j == pos)
+                    new (p) T(std::move(v));
+                else
+                    new (p) T(n->values()[j < pos || has ? j : j - 1]);
+            });
+        }
+        auto child = has ? n->children()[pos] : nullptr;
+        auto c     = set(child, level - 1, i, v, added);
+        return replace_child(n, map | bit, pos, has, c, level);
+    }
+
+    // The trie `n` without the value at `i`, which must be there.
+    static const node_t* erase(const node_t* n, count_t level, index_t i)
+    {
+        if (n->count() == 1)
+            return nullptr;
+        auto bit = bitmap_t{1} << index(i, level);
+        auto pos = position(n->map(), bit);
+        if (!level)
+            return node_t::make_leaf(
+                n->map() & ~bit, n->size() - 1, [&](count_t k, T* p) {
+                    new (p) T(n->values()[k < pos ? k : k + 1]);
+                });
+        auto c = erase(n->children()[pos], level - 1, i);
+        if (c)
+            return replace_child(n, n->map(), pos, true, c, level);
+        return replace_child(n, n->map() & ~bit, pos, false, nullptr, level);
+    }
+
+    // The trie `n` with only the values at the indices up to `last`,
+    // which is relative to the start of `n`.
+    static const node_t*
+    truncate(const node_t* n, count_t level, index_t last)
+    {
+        if (!n || last >= capacity(level) - 1)
+            return node_t::inc(n);
+        auto top  = index(last, level);
+        auto mask = top + 1 == branches ? ~bitmap_t{}
+                                        : (bitmap_t{1} << (top + 1)) - 1;
+        auto map  = n->map() & mask;
+        auto k    = hamts::popcount(map);
+        if (!level) {
+            if (!k)
+                return nullptr;
+            if (k == n->size())
+                return node_t::inc(n);
+            return node_t::make_leaf(map, k, [&](count_t j, T* p) {
+                new (p) T(n->values()[j]);
+            });
+        }
+        node_t* cs[branches];
+        auto m    = count_t{};
+        auto bit  = bitmap_t{1} << top;
+        auto rest = last & (capacity(level - 1) - 1);
+        auto own  = false;
+        for (auto j = count_t{}; j < k; ++j)
+            cs[m++] = n->children()[j];
+        if (map & bit) {
+            if (auto c = truncate(cs[m - 1], level - 1, rest)) {
+                own       = c != cs[m - 1];
+                cs[m - 1] = const_cast<node_t*>(c);
+                if (!own)
+                    node_t::release(c, level - 1);
+            } else {
+                --m;
+                map &= ~bit;
+            }
+        }
+        if (!m)
+            return nullptr;
+        if (!own && m == n->size())
+            return node_t::inc(n);
+        IMMER_TRY {
+            auto p = node_t::make_inner(map, cs, m);
+            for (auto j = count_t{}; j < m; ++j)
+                if (!own || j + 1 < m)
+                    node_t::inc(cs[j]);
+            return p;
+        }
+        IMMER_CATCH (...) {
+            if (own)
+                node_t::release(cs[m - 1], level - 1);
+            IMMER_RETHROW;
+        }
+    }
+
+    // Copies the inner node `n` with the child `c` at `pos`, either in
+    // place of the one that was there when `replace`, or inserted
+    // before it, or with the one at `pos` removed when `c` is null.
+    // Takes ownership of `c`.
+    static const node_t* replace_child(const node_t* n,
+                                       bitmap_t map,
+                                       count_t pos,
+                                       bool replace,
+                                       const node_t* c,
+                                       count_t level)
+    {
+        node_t* cs[branches];
+        auto old = n ? n->size() : count_t{};
+        auto k   = count_t{};
+        for (auto i = count_t{}; i < old; ++i) {
+            if (i == pos) {
+                if (c)
+                    cs[k++] = const_cast<node_t*>(c);
+                if (c && !replace)
+                    cs[k++] = n->children()[i];
+            } else
+                cs[k++] = n->children()[i];
+        }
+        if (c && pos == old)
+            cs[k++] = const_cast<node_t*>(c);
+        IMMER_TRY {
+            auto p = node_t::make_inner(map, cs, k);
+            for (auto i = count_t{}; i < k; ++i)
+                if (cs[i] != c)
+                    node_t::inc(cs[i]);
+            return p;
+        }
+        IMMER_CATCH (...) {
+            node_t::release(c, level - 1);
+            IMMER_RETHROW;
+        }
+    }
+
+    // Removes the inner levels above the root `n` that only have their
+    // first child, whose reference it takes, and updates `level`.
+    static const node_t* shrink(const node_t* n, count_t& level)
+    {
+        while (n && level && n->map() == 1) {
+            auto c = node_t::inc(n->children()[0]);
+            node_t::release(n, level--);
+            n = c;
+        }
+        if (!n)
+            level = 0;
+        return n;
+    }
+
+    static bool equals(const node_t* a, const node_t* b, count_t level)
+    {
+        if (a == b)
+            return true;
+        if (!a || !b || a->count() != b->count() || a->map() != b->map())
+            return false;
+        auto n = a->size();
+        if (!level)
+            return std::equal(a->values(), a->values() + n, b->values());
+        for (auto i = count_t{}; i < n; ++i)
+            if (!equals(a->children()[i], b->children()[i], level - 1))
+                return false;
+        return true;
+    }
+
+    // Calls `fn(i, v)` with the values stored at the indices in
+    // `[first, last)`, in order, where `base` is the first index
+    // covered by `n`.
+    template <typename Fn>
+    static void for_each(const node_t* n,
+                         count_t level,
+                         index_t base,
+                         index_t first,
+                         index_t last,
+                         Fn& fn)
+    {
+        auto shift = shift_of(level);
+        auto k     = count_t{};
+        for (auto i = count_t{}; i < branches; ++i) {
+            if (!(n->map() & (bitmap_t{1} << i)))
+                continue;
+            auto pos = k++;
+            auto lo  = base + (index_t{i} << shift);
+            auto hi  = lo + (index_t{1} << shift);
+            if (hi <= first)
+                continue;
+            if (lo >= last)
+                return;
+            if (level)
+                for_each(n->children()[pos], level - 1, lo, first, last, fn);
+            else
+                fn(lo, n->values()[pos]);
+        }
+    }
+};
+
+} // namespace sparse
+} // namespace detail
+} // namespace immer
@@ -9,8 +9,12 @@
 #pragma once
 
 #include <immer/config.hpp>
+#include <immer/relocatable.hpp>
 
+#include <algorithm>
+#include <cassert>
 #include <cstddef>
+#include <cstring>
 #include <memory>
 #include <new>
 #include <type_traits>
@@ -132,6 +136,57 @@ auto uninitialized_move(Iter1 first, Iter1 last, Iter2 out)
     }
 }
 
+template <typename T>
+constexpr bool can_relocate = is_trivially_relocatable<T>::value;
+
+// Moves the values in `[first, last)` to the uninitialized memory at
+// `out`, that may overlap them, and ends their lifetime, so they must
+// not be destroyed afterwards.
+template <typename T>
+auto uninitialized_relocate(T* first, T* last, T* out) noexcept
+    -> std::enable_if_t<can_relocate<T>, T*>
+{
+    auto n = static_cast<std::size_t>(last - first);
+    if (n)
+        std::memmove(static_cast<void*>(out),
+                     static_cast<const void*>(first),
+                     n * sizeof(T));
+    return out + n;
+}
+template <typename T>
+auto uninitialized_relocate(T* first, T* last, T* out)
+    -> std::enable_if_t<!can_relocate<T>, T*>
+{
+    assert(out + (last - first) <= first || last <= out);
+    auto r = detail::uninitialized_move(first, last, out);
+    detail::destroy(first, last);
+    return r;
+}
+
+// Values whose equality is the equality of their bytes.  Floating
+// point numbers are not, because of NaN and the signed zeros, and
+// neither are enumerations, since they may overload the operator.
+template <typename T>
+constexpr bool is_bitwise_comparable =
+    std::is_integral<T>::value || std::is_pointer<T>::value;
+
+template <typename T>
+auto equal_values(const T* first, const T* last, const T* other)
+    -> std::enable_if_t<is_bitwise_comparable<T>, bool>
+{
+    return first == last || first == other ||
+           std::memcmp(first,
+                       other,
+                       static_cast<std::size_t>(last - first) * sizeof(T)) ==
+               0;
+}
+template <typename T>
+auto equal_values(const T* first, const T* last, const T* other)
+    -> std::enable_if_t<!is_bitwise_comparable<T>, bool>
+{
+    return first == other || std::equal(first, last, other);
+}
+
 template <typename SourceIter, typename Sent, typename SinkIter>
 auto uninitialized_copy(SourceIter first, Sent last, SinkIter out) noexcept
     -> std::enable_if_t<can_trivially_copy<SourceIter, SinkIter>, SinkIter>
@@ -0,0 +1,91 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/memory_policy.hpp>
+
+#include <tuple>
+#include <utility>
+
+namespace immer {
+
+/*!
+ * Edits several containers that use the same `MemoryPolicy` together.
+ * The transients that it makes, of a @ref vector, @ref flex_vector,
+ * @ref map, @ref set or @ref table, all share one edit token, and @ref
+ * commit turns them into persistent values at once.  Later transients
+ * get a new token, thus the nodes made during the session can not be
+ * changed after it.
+ *
+ * With reference counting the transients mutate the nodes that only
+ * they reference and there is no token, so that a session costs the
+ * same as the separate transients.  With @ref gc_transience_policy,
+ * the transients of a session share the one token instead of taking one
+ * each.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    auto s  = immer::edit_session<memory>{};
+ *    auto tm = s.transient(m);
+ *    auto tv = s.transient(v);
+ *    tm.set("count", tv.size());
+ *    tv.push_back(42);
+ *    std::tie(m, v) = s.commit(std::move(tm), std::move(tv));
+ *
+ * .. warning:: The transients of a session may change in place the nodes
+ *    that the others made, thus they must not share nodes, for example
+ *    by concatenating one flex vector transient into another.  The
+ *    transients of a session that are not committed must not be used
+ *    after the commit.
+ *
+ * .. note:: The ``arena_transience_policy`` does not support sessions,
+ *    since every arena belongs to a single transient.
+ *
+ * @endrst
+ */
+template <typename MemoryPolicy = default_memory_policy>
+class edit_session
+{
+    using owner_t = typename MemoryPolicy::transience_t::owner;
+
+public:
+    /*!
+     * Returns a transient of the container `c`, which shares the edit
+     * token of this session.
+     */
+    template <typename Container>
+    typename Container::transient_type transient(const Container& c)
+    {
+        using transient_t = typename Container::transient_type;
+        return transient_t{c.impl(), owner_t::share(owner_)};
+    }
+
+    /*!
+     * Returns a tuple with the persistent values of the transients
+     * `ts`, in the same order, and starts a new session.  The
+     * transients should be moved in, otherwise they are copied.
+     */
+    template <typename... Transients>
+    std::tuple<typename Transients::persistent_type...>
+    commit(Transients... ts)
+    {
+        auto r = std::tuple<typename Transients::persistent_type...>{
+            std::move(ts).persistent()...};
+        owner_ = owner_t{};
+        return r;
+    }
+
+private:
+    owner_t owner_;
+};
+
+} // namespace immer
@@ -0,0 +1,490 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if IMMER_HAS_CPP17 && defined(__has_include)
+#if __has_include(<execution>)
+#include <execution>
+#if defined(__cpp_lib_execution) && defined(__cpp_lib_parallel_algorithm)
+#define IMMER_HAS_STD_EXECUTION 1
+#endif
+#endif
+#endif
+
+#if IMMER_HAS_TBB
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+#endif
+
+namespace immer {
+
+/*!
+ * @defgroup executor
+ * @{
+ */
+
+/*!
+ * Executor that runs all the tasks in the calling thread, in order.
+ *
+ * An *executor* is the object that the parallel operations of the
+ * library use to distribute work.  It must provide:
+ *
+ * - A `concurrency()` method returning the number of tasks that it
+ *   can usefully run at the same time.  Algorithms use it to decide
+ *   how finely to split their input.
+ *
+ * - A `bulk(n, fn)` method that invokes `fn(i)` for every `i` in
+ *   `[0, n)`, potentially concurrently, and returns once all the
+ *   invocations have completed.  If any invocation throws, one of
+ *   the exceptions is rethrown from `bulk` after all the others have
+ *   finished.
+ *
+ * Any thread pool can be plugged in with a small adapter providing
+ * these two methods.  The algorithms split their work in tasks that
+ * cover whole subtrees, a few more tasks than `concurrency()` and no
+ * smaller than a minimum size, so an executor that reports the number
+ * of threads that it really has is not oversubscribed.
+ */
+struct sequential_executor
+{
+    std::size_t concurrency() const { return 1; }
+
+    template <typename Fn>
+    void bulk(std::size_t n, Fn&& fn) const
+    {
+        for (auto i = std::size_t{}; i < n; ++i)
+            fn(i);
+    }
+};
+
+/*!
+ * Executor that spawns up to `concurrency()` threads for every `bulk`
+ * invocation.  The calling thread participates in the work too.  It
+ * is a simple default, an application that already has a thread pool
+ * should rather adapt it to the executor interface.
+ */
+class thread_executor
+{
+    std::size_t concurrency_;
+
+public:
+    thread_executor()
+        : thread_executor{std::thread::hardware_concurrency()}
+    {}
+
+    explicit thread_executor(std::size_t concurrency)
+        : concurrency_{std::max(concurrency, std::size_t{1})}
+    {}
+
+    std::size_t concurrency() const { return concurrency_; }
+
+    template <typename Fn>
+    void bulk(std::size_t n, Fn&& fn) const
+    {
+        auto workers = std::min(n, concurrency_);
+        if (workers <= 1) {
+            sequential_executor{}.bulk(n, fn);
+            return;
+        }
+        std::atomic<std::size_t> next{0};
+        std::exception_ptr error;
+        std::mutex mtx;
+        auto work = [&] {
+            for (auto i = next++; i < n; i = next++) {
+                IMMER_TRY {
+                    fn(i);
+                }
+                IMMER_CATCH (...) {
+                    std::lock_guard<std::mutex> lock{mtx};
+                    if (!error)
+                        error = std::current_exception();
+                }
+            }
+        };
+        auto threads = std::vector<std::thread>{};
+        IMMER_TRY {
+            threads.reserve(workers - 1);
+            while (threads.size() < workers - 1)
+                threads.emplace_back(work);
+        }
+        IMMER_CATCH (...) {
+            // could not get more threads, continue with the ones we
+            // have, the calling thread alone can finish the job
+        }
+        work();
+        for (auto& t : threads)
+            t.join();
+        if (error)
+            std::rethrow_exception(error);
+    }
+};
+
+/*!
+ * Executor backed by a pool of threads that it keeps alive, so that
+ * `bulk` does not spawn threads every time.  The indices of every
+ * `bulk` are split evenly among the threads, and the calling thread,
+ * and a thread that runs out of them steals half of the remaining
+ * ones of another thread.  Thus, it balances uneven tasks without
+ * paying for a shared queue.  A `bulk` invoked from one of its tasks
+ * runs in the calling thread, and invocations from different threads
+ * are serialized.
+ */
+class pool_executor
+{
+    struct job_t
+    {
+        void* fn;
+        void (*call)(void*, std::size_t);
+        // every slot packs a [begin, end) range of indices
+        std::unique_ptr<std::atomic<std::uint64_t>[]> ranges;
+        std::size_t slots;
+        std::exception_ptr error;
+        std::mutex error_mtx;
+    };
+
+    struct state_t
+    {
+        std::mutex mtx;
+        std::condition_variable wake;
+        std::condition_variable done;
+        job_t* job          = nullptr;
+        std::size_t round   = 0;
+        std::size_t running = 0;
+        bool stop           = false;
+    };
+
+    std::size_t concurrency_;
+    std::unique_ptr<state_t> state_;
+    std::unique_ptr<std::mutex> submit_;
+    std::vector<std::thread> threads_;
+
+    static const pool_executor*& current()
+    {
+        static thread_local const pool_executor* p = nullptr;
+        return p;
+    }
+
+    static std::uint64_t pack(std::uint64_t b, std::uint64_t e)
+    {
+        return b << 32 | e;
+    }
+
+    // runs the indices of the slot `i` and then steals from the others
+    static void work(job_t& job, std::size_t i)
+    {
+        auto slot = job.ranges.get();
+        while (true) {
+            auto r = slot[i].load(std::memory_order_acquire);
+            auto b = r >> 32, e = r & 0xffffffffu;
+            if (b < e) {
+                if (!slot[i].compare_exchange_weak(r, pack(b + 1, e)))
+                    continue;
+                IMMER_TRY {
+                    job.call(job.fn, static_cast<std::size_t>(b));
+                }
+                IMMER_CATCH (...) {
+                    std::lock_guard<std::mutex> lock{job.error_mtx};
+                    if (!job.error)
+                        job.error = std::current_exception();
+                }
+            } else if (!steal(job, i)) {
+                return;
+            }
+        }
+    }
+
+    static bool steal(job_t& job, std::size_t i)
+    {
+        auto slot = job.ranges.get();
+        for (auto k = std::size_t{1}; k < job.slots; ++k) {
+            auto& victim = slot[(i + k) % job.slots];
+            auto r       = victim.load(std::memory_order_acquire);
+            auto b = r >> 32, e = r & 0xffffffffu;
+            while (b < e) {
+                auto mid = b + (e - b) / 2;
+                if (victim.compare_exchange_weak(r, pack(b, mid))) {
+                    slot[i].store(pack(mid, e), std::memory_order_release);
+                    return true;
+                }
+                b = r >> 32, e = r & 0xffffffffu;
+            }
+        }
+        return false;
+    }
+
+    void loop(std::size_t i) const
+    {
+        current()   = this;
+        auto& st    = *state_;
+        auto& round = st.round;
+        auto seen   = std::size_t{};
+        std::unique_lock<std::mutex> lock{st.mtx};
+        while (true) {
+            st.wake.wait(lock, [&] { return st.stop || round != seen; });
+            if (st.stop)
+                return;
+            seen = round;
+            // the job may be over before this thread got to see it
+            if (!st.job)
+                continue;
+            auto& job = *st.job;
+            ++st.running;
+            lock.unlock();
+            work(job, i);
+            lock.lock();
+            if (--st.running == 0)
+                st.done.notify_all();
+        }
+    }
+
+    template <typename Fn>
+    void run(std::size_t n, Fn& fn) const
+    {
+        auto& st = *state_;
+        job_t job;
+        job.fn   = &fn;
+        job.call = [](void* f, std::size_t i) { (*static_cast<Fn*>(f))(i); };
+        job.slots = threads_.size() + 1;
+        job.ranges.reset(new std::atomic<std::uint64_t>[job.slots]);
+        for (auto k = std::size_t{}; k < job.slots; ++k)
+            job.ranges[k].store(
+                pack(n * k / job.slots, n * (k + 1) / job.slots));
+        {
+            std::lock_guard<std::mutex> lock{st.mtx};
+            st.job = &job;
+            ++st.round;
+        }
+        st.wake.notify_all();
+        current() = this;
+        work(job, 0);
+        current() = nullptr;
+        {
+            // the others may still be looking for indices to steal
+            std::unique_lock<std::mutex> lock{st.mtx};
+            st.done.wait(lock, [&] { return st.running == 0; });
+            st.job = nullptr;
+        }
+        if (job.error)
+            std::rethrow_exception(job.error);
+    }
+
+public:
+    pool_executor()
+        : pool_executor{std::thread::hardware_concurrency()}
+    {}
+
+    /*!
+     * Creates a pool where `concurrency` threads, including the one
+     * that invokes `bulk`, run the tasks.
+     */
+    explicit pool_executor(std::size_t concurrency)
+        : concurrency_{std::max(concurrency, std::size_t{1})}
+        , state_{new state_t}
+        , submit_{new std::mutex}
+    {
+        IMMER_TRY {
+            threads_.reserve(concurrency_ - 1);
+            for (auto i = std::size_t{1}; i < concurrency_; ++i)
+                threads_.emplace_back([this, i] { loop(i); });
+        }
+        IMMER_CATCH (...) {
+            stop();
+            IMMER_RETHROW;
+        }
+    }
+
+    pool_executor(const pool_executor&) = delete;
+    pool_executor& operator=(const pool_executor&) = delete;
+
+    ~pool_executor() { stop(); }
+
+    std::size_t concurrency() const { return concurrency_; }
+
+    template <typename Fn>
+    void bulk(std::size_t n, Fn&& fn) const
+    {
+        if (threads_.empty() || n <= 1 || current() == this) {
+            sequential_executor{}.bulk(n, fn);
+            return;
+        }
+        std::lock_guard<std::mutex> lock{*submit_};
+        // the ranges are packed in 32 bits, larger jobs go in batches
+        constexpr auto max_batch = std::size_t{1} << 31;
+        for (auto first = std::size_t{}; first < n; first += max_batch) {
+            auto batch = [&](std::size_t i) { fn(first + i); };
+            run(std::min(n - first, max_batch), batch);
+        }
+    }
+
+private:
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock{state_->mtx};
+            state_->stop = true;
+        }
+        state_->wake.notify_all();
+        for (auto& t : threads_)
+            t.join();
+        threads_.clear();
+    }
+};
+
+#if IMMER_HAS_STD_EXECUTION
+
+/*!
+ * Executor that runs the tasks with a standard parallel algorithm,
+ * using the execution policy `Policy`, for example
+ * ``std::execution::par``.  The exceptions thrown by the tasks are
+ * caught and the first one is rethrown from `bulk`, instead of
+ * terminating the program as the standard algorithms do.  It is only
+ * available when the standard library supports execution policies.
+ */
+template <typename Policy>
+class std_executor
+{
+    Policy policy_;
+    std::size_t concurrency_;
+
+public:
+    explicit std_executor(
+        Policy policy           = {},
+        std::size_t concurrency = std::thread::hardware_concurrency())
+        : policy_{policy}
+        , concurrency_{std::max(concurrency, std::size_t{1})}
+    {}
+
+    std::size_t concurrency() const { return concurrency_; }
+
+    template <typename Fn>
+    void bulk(std::size_t n, Fn&& fn) const
+    {
+        auto indices = std::vector<std::size_t>(n);
+        for (auto i = std::size_t{}; i < n; ++i)
+            indices[i] = i;
+        std::exception_ptr error;
+        std::mutex mtx;
+        std::for_each(policy_, indices.begin(), indices.end(), [&](auto i) {
+            IMMER_TRY {
+                fn(i);
+            }
+            IMMER_CATCH (...) {
+                std::lock_guard<std::mutex> lock{mtx};
+                if (!error)
+                    error = std::current_exception();
+            }
+        });
+        if (error)
+            std::rethrow_exception(error);
+    }
+};
+
+#endif // IMMER_HAS_STD_EXECUTION
+
+#if IMMER_HAS_TBB
+
+/*!
+ * Executor that runs the tasks in the current Intel TBB task arena,
+ * which steals work on its own.  It is only available when
+ * ``IMMER_HAS_TBB`` is defined to ``1``, and then the program must be
+ * linked against TBB.
+ */
+struct tbb_executor
+{
+    std::size_t concurrency() const
+    {
+        return static_cast<std::size_t>(
+            tbb::this_task_arena::max_concurrency());
+    }
+
+    template <typename Fn>
+    void bulk(std::size_t n, Fn&& fn) const
+    {
+        tbb::parallel_for(tbb::blocked_range<std::size_t>{0, n},
+                          [&](const tbb::blocked_range<std::size_t>& r) {
+                              for (auto i = r.begin(); i != r.end(); ++i)
+                                  fn(i);
+                          });
+    }
+};
+
+#endif // IMMER_HAS_TBB
+
+/** @} */ // group: executor
+
+namespace detail {
+
+/*!
+ * How many more tasks than `concurrency()` are given to an executor,
+ * so that uneven work can be balanced.
+ */
+constexpr auto bulk_oversubscription = std::size_t{4};
+
+/*!
+ * Minimum number of elements that a task processes, such that the
+ * cost of scheduling it is amortized.  The algorithms that split their
+ * work in leaves or subtrees convert it to their own units.
+ */
+constexpr auto bulk_min_elements = std::size_t{1} << 12;
+
+/*!
+ * Number of tasks in which the parallel algorithms split `n` units of
+ * work when they run on the executor `ex`, such that every task gets
+ * at least `grain` units.
+ */
+template <typename Executor>
+std::size_t
+bulk_tasks(const Executor& ex, std::size_t n, std::size_t grain = 1)
+{
+    return std::min((n + grain - 1) / grain,
+                    ex.concurrency() * bulk_oversubscription);
+}
+
+/*!
+ * Splits `[0, n)` in contiguous ranges of at least `grain` units and
+ * calls `fn(first, last)` for each of them using the executor `ex`.
+ */
+template <typename Executor, typename Fn>
+void bulk_ranges(Executor& ex, std::size_t n, std::size_t grain, Fn&& fn)
+{
+    auto tasks = bulk_tasks(ex, n, grain);
+    if (tasks <= 1) {
+        if (n)
+            fn(std::size_t{}, n);
+        return;
+    }
+    ex.bulk(tasks, [&](std::size_t i) {
+        fn(n * i / tasks, n * (i + 1) / tasks);
+    });
+}
+
+template <typename Executor, typename Fn>
+void bulk_ranges(Executor& ex, std::size_t n, Fn&& fn)
+{
+    bulk_ranges(ex, n, 1, std::forward<Fn>(fn));
+}
+
+} // namespace detail
+
+} // namespace immer
@@ -16,6 +16,7 @@
 #include <boost/iterator/iterator_facade.hpp>
 #include <boost/smart_ptr/intrusive_ref_counter.hpp>
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cstddef>
@@ -400,6 +401,84 @@ struct impl
     {
         return update(idx, [&](auto&&) { return std::move(value); });
     }
+
+    // The focused leaf can be changed in place when this is the only
+    // reference to it, which a dirty focus never shares with the tree
+    // above it.  Otherwise, or when the index is in another leaf, the
+    // path is copied as in the persistent operations, which leaves a
+    // fresh leaf in the focus for the next ones.
+    bool owns_focus(std::size_t index) const
+    {
+        return dirty && ((index ^ focus) >> B) == 0 &&
+               intrusive_ptr_unique(p.display[0].get());
+    }
+
+    void push_back_mut(T value)
+    {
+        if ((size & mask<B>) && owns_focus(size)) {
+            p.display[0]->leaf()[size & mask<B>] = std::move(value);
+            ++size;
+        } else {
+            *this = push_back(std::move(value));
+        }
+    }
+
+    template <typename FnT>
+    void update_mut(std::size_t idx, FnT&& fn)
+    {
+        if (owns_focus(idx)) {
+            auto& v = p.display[0]->leaf()[idx & mask<B>];
+            v       = fn(std::move(v));
+        } else {
+            *this = update(idx, std::forward<FnT>(fn));
+        }
+    }
+
+    void assoc_mut(std::size_t idx, T value)
+    {
+        update_mut(idx, [&](auto&&) { return std::move(value); });
+    }
+
+    template <typename Fn>
+    void for_each_chunk(Fn&& fn) const
+    {
+        for_each_chunk_p([&](auto first, auto last) {
+            fn(first, last);
+            return true;
+        });
+    }
+
+    template <typename Fn>
+    bool for_each_chunk_p(Fn&& fn) const
+    {
+        if (!size)
+            return true;
+        auto r = p;
+        if (dirty)
+            r.stabilize(focus);
+        return for_each_chunk_p(
+            r.display[r.depth - 1].get(), r.depth - 1, 0, fn);
+    }
+
+    template <typename Fn>
+    bool for_each_chunk_p(const node_t* n,
+                          unsigned level,
+                          std::size_t first,
+                          Fn& fn) const
+    {
+        if (level == 0) {
+            auto data = n->leaf().data();
+            auto last = std::min(size - first, branches<B>);
+            return fn(data, data + last);
+        }
+        auto step = std::size_t{1} << (level * B);
+        for (auto i = 0u; i < branches<B> && first < size; ++i) {
+            if (!for_each_chunk_p(n->inner()[i].get(), level - 1, first, fn))
+                return false;
+            first += step;
+        }
+        return true;
+    }
 };
 
 template <typename T, int B, typename MP>
@@ -16,12 +16,31 @@
 
 namespace immer {
 
-template <typename T, int B = 5, typename MemoryPolicy = default_memory_policy>
+template <typename T, typename MemoryPolicy, int B>
+class dvektor_transient;
+
+/*!
+ * Immutable sequential container with a simpler layout than @ref
+ * vector: a radix balanced tree without a tail, that instead keeps a
+ * *display* of the path to the last updated leaf, so that the updates
+ * close to the previous one only copy that leaf.
+ *
+ * The nodes are reference counted and allocated with the heap of the
+ * `MemoryPolicy`, like those of the other containers.  The transients
+ * change in place the leaf in the display when no one else references
+ * it, thus they only save copies with a reference counting policy.
+ */
+template <typename T,
+          typename MemoryPolicy = default_memory_policy,
+          int B                 = 5>
 class dvektor
 {
     using impl_t = detail::dvektor::impl<T, B, MemoryPolicy>;
 
 public:
+    static constexpr auto bits = B;
+    using memory_policy        = MemoryPolicy;
+
     using value_type      = T;
     using reference       = const T&;
     using size_type       = std::size_t;
@@ -32,6 +51,8 @@ public:
     using const_iterator   = iterator;
     using reverse_iterator = std::reverse_iterator<iterator>;
 
+    using transient_type = dvektor_transient<T, MemoryPolicy, B>;
+
     dvektor() = default;
 
     iterator begin() const { return {impl_}; }
@@ -50,18 +71,35 @@ public:
         return {impl_.push_back(std::move(value))};
     }
 
-    dvektor assoc(std::size_t idx, value_type value) const
+    dvektor set(std::size_t idx, value_type value) const
     {
         return {impl_.assoc(idx, std::move(value))};
     }
 
+    dvektor assoc(std::size_t idx, value_type value) const
+    {
+        return set(idx, std::move(value));
+    }
+
     template <typename FnT>
     dvektor update(std::size_t idx, FnT&& fn) const
     {
         return {impl_.update(idx, std::forward<FnT>(fn))};
     }
 
+    /*!
+     * Returns a @a transient form of this container, an
+     * `immer::dvektor_transient`.
+     */
+    IMMER_NODISCARD transient_type transient() const& { return impl_; }
+    IMMER_NODISCARD transient_type transient() && { return std::move(impl_); }
+
+    // Semi-private
+    const impl_t& impl() const { return impl_; }
+
 private:
+    friend transient_type;
+
     dvektor(impl_t impl)
         : impl_(std::move(impl))
     {}
@@ -0,0 +1,94 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/experimental/detail/dvektor_impl.hpp>
+
+#include <immer/memory_policy.hpp>
+
+#include <cstddef>
+
+namespace immer {
+
+template <typename T, typename MemoryPolicy, int B>
+class dvektor;
+
+/*!
+ * Mutable version of `immer::dvektor`.
+ */
+template <typename T,
+          typename MemoryPolicy = default_memory_policy,
+          int B                 = 5>
+class dvektor_transient
+{
+    using impl_t = detail::dvektor::impl<T, B, MemoryPolicy>;
+
+public:
+    static constexpr auto bits = B;
+    using memory_policy        = MemoryPolicy;
+
+    using value_type      = T;
+    using reference       = const T&;
+    using size_type       = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using const_reference = const T&;
+
+    using iterator         = detail::dvektor::iterator<T, B, MemoryPolicy>;
+    using const_iterator   = iterator;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+
+    using persistent_type = dvektor<T, MemoryPolicy, B>;
+
+    dvektor_transient() = default;
+
+    iterator begin() const { return {impl_}; }
+    iterator end() const { return {impl_, typename iterator::end_t{}}; }
+
+    reverse_iterator rbegin() const { return reverse_iterator{end()}; }
+    reverse_iterator rend() const { return reverse_iterator{begin()}; }
+
+    std::size_t size() const { return impl_.size; }
+    bool empty() const { return impl_.size == 0; }
+
+    reference operator[](size_type index) const { return impl_.get(index); }
+
+    void push_back(value_type value) { impl_.push_back_mut(std::move(value)); }
+
+    void set(std::size_t idx, value_type value)
+    {
+        impl_.assoc_mut(idx, std::move(value));
+    }
+
+    template <typename FnT>
+    void update(std::size_t idx, FnT&& fn)
+    {
+        impl_.update_mut(idx, std::forward<FnT>(fn));
+    }
+
+    /*!
+     * Returns an @a immutable form of this container, an
+     * `immer::dvektor`.
+     */
+    IMMER_NODISCARD persistent_type persistent() & { return impl_; }
+    IMMER_NODISCARD persistent_type persistent() && { return std::move(impl_); }
+
+    // Semi-private
+    const impl_t& impl() const { return impl_; }
+
+private:
+    friend persistent_type;
+
+    dvektor_transient(impl_t impl)
+        : impl_(std::move(impl))
+    {}
+
+    impl_t impl_ = detail::dvektor::empty<T, B, MemoryPolicy>;
+};
+
+} // namespace immer
@@ -10,7 +10,18 @@
 
 #include <immer/detail/rbts/rrbtree.hpp>
 #include <immer/detail/rbts/rrbtree_iterator.hpp>
+#include <immer/executor.hpp>
 #include <immer/memory_policy.hpp>
+#include <immer/relocatable.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace immer {
 
@@ -26,6 +37,21 @@ template <typename T,
           detail::rbts::bits_t BL>
 class flex_vector_transient;
 
+namespace detail {
+
+template <typename Range, typename Executor>
+auto concat_all(const Range& r, Executor& ex)
+    -> std::decay_t<decltype(*std::begin(r))>;
+
+template <typename Vector, typename Iter>
+void split_at(Vector v,
+              std::size_t offset,
+              Iter first,
+              Iter last,
+              std::vector<Vector>& r);
+
+} // namespace detail
+
 /*!
  * Immutable sequential container supporting both random access,
  * structural sharing and efficient concatenation and slicing.
@@ -83,6 +109,19 @@ public:
 
     using transient_type = flex_vector_transient<T, MemoryPolicy, B, BL>;
 
+    /*!
+     * An edit of a patch, see `apply_patch()`, that replaces the
+     * elements in `[first, last)` by `values`.  Thus, an insertion at
+     * `i` is `{i, i, values}`, an erasure is `{j, k, {}}` and a
+     * replacement at `m` is `{m, m + 1, {value}}`.
+     */
+    struct edit
+    {
+        size_type first;
+        size_type last;
+        flex_vector values;
+    };
+
     /*!
      * Returns the maximum theoretical size supported by the internal structure
      * given the current B, BL.
@@ -114,9 +153,31 @@ public:
         : impl_{impl_t::from_range(first, last)}
     {}
 
+    /*!
+     * Returns a flex_vector containing the elements in the range defined by
+     * the random access iterators `first` and `last`.  The leaves and
+     * inner nodes of the result are built concurrently using the
+     * executor `ex` (see @ref executor), and the resulting tree is
+     * identical to the one built by the sequential range constructor.
+     */
+    template <typename Iter,
+              typename Executor = thread_executor,
+              std::enable_if_t<
+                  std::is_base_of<std::random_access_iterator_tag,
+                                  typename std::iterator_traits<
+                                      Iter>::iterator_category>::value,
+                  bool> = true>
+    IMMER_NODISCARD static flex_vector
+    from_range_parallel(Iter first, Iter last, Executor&& ex = {})
+    {
+        return impl_t::from_range_parallel(first, last, ex);
+    }
+
     /*!
      * Constructs a vector containing the element `val` repeated `n`
-     * times.
+     * times.  All the full leaves, and all the full inner nodes of each
+     * level, are the same node, so it allocates @f$ O(log(n)) @f$
+     * memory.
      */
     flex_vector(size_type n, T v = {})
         : impl_{impl_t::from_fill(n, v)}
@@ -211,6 +272,22 @@ public:
      */
     reference at(size_type index) const { return impl_.get_check(index); }
 
+    /*!
+     * Writes to the output iterator `out` the elements at the indices
+     * in the range `indices`, and returns the iterator past the last
+     * one written.  It is equivalent to using `operator[]` for every
+     * index, but the lookups are interleaved so that their cache misses
+     * overlap, which is faster for batches of indices on large vectors.
+     * Undefined for indices @f$ \geq size() @f$.
+     */
+    template <typename Indices, typename Out>
+    Out get_many(const Indices& indices, Out out) const
+    {
+        using std::begin;
+        using std::end;
+        return impl_.get_many(begin(indices), end(indices), out);
+    }
+
     /*!
      * Returns whether the vectors are equal.
      */
@@ -248,9 +325,52 @@ public:
         return push_back_move(move_t{}, std::move(value));
     }
 
+    /*!
+     * Returns a flex_vector with a new element at the end, constructed in
+     * place with the arguments `args`.  Unlike `push_back`, no
+     * temporary `value_type` is made nor moved, which matters for
+     * values that are expensive to move.  It may allocate memory and
+     * its complexity is the one of `push_back`.
+     */
+    template <typename... Args>
+    IMMER_NODISCARD flex_vector emplace_back(Args&&... args) const&
+    {
+        return impl_.emplace_back(std::forward<Args>(args)...);
+    }
+    template <typename... Args>
+    IMMER_NODISCARD decltype(auto) emplace_back(Args&&... args) &&
+    {
+        return emplace_back_move(move_t{}, std::forward<Args>(args)...);
+    }
+
+    /*!
+     * Returns a flex_vector with the elements in the range defined by the
+     * input iterator `first` and range sentinel `last` inserted at the
+     * end.  It fills the leaves in place instead of copying the last one
+     * for every element, and its complexity is *effectively* @f$ O(n)
+     * @f$ for @f$ n @f$ elements.
+     */
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    IMMER_NODISCARD flex_vector append(Iter first, Sent last) const&
+    {
+        return impl_.append(first, last);
+    }
+
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    IMMER_NODISCARD decltype(auto) append(Iter first, Sent last) &&
+    {
+        return append_move(move_t{}, first, last);
+    }
+
     /*!
      * Returns a flex_vector with `value` inserted at the front.  It may
-     * allocate memory and its complexity is @f$ O(log(size)) @f$.
+     * allocate memory and its complexity is *effectively* @f$ O(1) @f$.
      *
      * @rst
      *
@@ -263,9 +383,14 @@ public:
      *
      * @endrst
      */
-    IMMER_NODISCARD flex_vector push_front(value_type value) const
+    IMMER_NODISCARD flex_vector push_front(value_type value) const&
+    {
+        return impl_.push_front(std::move(value));
+    }
+
+    IMMER_NODISCARD decltype(auto) push_front(value_type value) &&
     {
-        return flex_vector{}.push_back(value) + *this;
+        return push_front_move(move_t{}, std::move(value));
     }
 
     /*!
@@ -295,6 +420,32 @@ public:
         return set_move(move_t{}, index, std::move(value));
     }
 
+    /*!
+     * Returns a flex_vector with the value of every `(index, value)` pair in
+     * the range defined by the input iterator `first` and range
+     * sentinel `last` set at its index, where later pairs win.  Each
+     * node on the way to the updated positions is copied only once,
+     * and its complexity is *effectively* @f$ O(n) @f$ for @f$ n @f$
+     * pairs.  Undefined when an index is @f$ \geq size() @f$.
+     */
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    IMMER_NODISCARD flex_vector set_many(Iter first, Sent last) const&
+    {
+        return impl_.assoc_many(first, last);
+    }
+
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    IMMER_NODISCARD decltype(auto) set_many(Iter first, Sent last) &&
+    {
+        return set_many_move(move_t{}, first, last);
+    }
+
     /*!
      * Returns a vector containing the result of the expression
      * `fn((*this)[idx])` at position `idx`.
@@ -326,6 +477,50 @@ public:
         return update_move(move_t{}, index, std::forward<FnT>(fn));
     }
 
+    /*!
+     * Like `set`, but when the element at `index` compares equal to
+     * `value` it returns the same flex_vector, thus keeping its `identity()`,
+     * instead of copying the path to the element.  This way, the code
+     * that detects changes through the identity, like `diff` or a
+     * memoization cache, sees none.  Undefined for `index >= size()`.
+     */
+    IMMER_NODISCARD flex_vector set_if_changed(size_type index,
+                                               value_type value) const&
+    {
+        if (impl_.get(index) == value)
+            return *this;
+        return impl_.assoc(index, std::move(value));
+    }
+
+    IMMER_NODISCARD decltype(auto) set_if_changed(size_type index,
+                                                  value_type value) &&
+    {
+        return set_if_changed_move(move_t{}, index, std::move(value));
+    }
+
+    /*!
+     * Like `update`, but when `fn((*this)[idx])` compares equal to the
+     * element it returns the same flex_vector, like `set_if_changed`.
+     */
+    template <typename FnT>
+    IMMER_NODISCARD flex_vector update_if_changed(size_type index,
+                                                  FnT&& fn) const&
+    {
+        auto& x = impl_.get(index);
+        auto v  = std::forward<FnT>(fn)(x);
+        if (x == v)
+            return *this;
+        return impl_.assoc(index, std::move(v));
+    }
+
+    template <typename FnT>
+    IMMER_NODISCARD decltype(auto) update_if_changed(size_type index,
+                                                     FnT&& fn) &&
+    {
+        return update_if_changed_move(
+            move_t{}, index, std::forward<FnT>(fn));
+    }
+
     /*!
      * Returns a vector containing only the first `min(elems, size())`
      * elements. It may allocate memory and its complexity is
@@ -378,6 +573,31 @@ public:
         return drop_move(move_t{}, elems);
     }
 
+    /*!
+     * Returns a flex_vector without the last element, or an empty one
+     * when it is empty.  Like `vector::pop_back()`, its complexity is
+     * amortized @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD flex_vector pop_back() const& { return take(size() - 1); }
+
+    IMMER_NODISCARD decltype(auto) pop_back() &&
+    {
+        return take_move(move_t{}, size() - 1);
+    }
+
+    /*!
+     * Returns a flex_vector without the first element, or an empty one
+     * when it is empty.  The first leaf is copied, or its elements are
+     * shifted in place when called on an rvalue that owns it, and so is
+     * the path to it in the tree, which makes it @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD flex_vector pop_front() const& { return drop(1); }
+
+    IMMER_NODISCARD decltype(auto) pop_front() &&
+    {
+        return drop_move(move_t{}, 1);
+    }
+
     /*!
      * Concatenation operator. Returns a flex_vector with the contents
      * of `l` followed by those of `r`.  It may allocate memory
@@ -496,6 +716,39 @@ public:
         }
     }
 
+    /*!
+     * Returns a flex_vector where every `edit` in the range `edits`
+     * replaced its elements, whose indices refer to this vector.  The
+     * edits must be sorted and must not overlap.  The tree is split
+     * once at the bounds of all the edits, and the untouched runs and
+     * the new values are joined with @a concat_all, instead of slicing
+     * and concatenating the whole vector for every edit.  It may
+     * allocate memory and its complexity is @f$ O(k log(size)) @f$ for
+     * @f$ k @f$ edits.
+     */
+    template <typename Edits>
+    IMMER_NODISCARD flex_vector apply_patch(const Edits& edits) const&
+    {
+        return patch(*this, edits);
+    }
+    template <typename Edits>
+    IMMER_NODISCARD flex_vector apply_patch(const Edits& edits) &&
+    {
+        return patch(std::move(*this), edits);
+    }
+
+    /*!
+     * Returns a vector with the same elements, stored in a regular
+     * tree of full leaves and inner nodes.  Vectors that went through
+     * many `take`, `drop`, `insert`, `erase` or concatenations may be
+     * spread over many half-empty relaxed nodes, that are slower to
+     * index and to iterate.  When the vector is already regular it
+     * returns the same vector in @f$ O(1) @f$, so it may be called
+     * after every batch of such operations.  Otherwise it copies the
+     * elements into new nodes and its complexity is @f$ O(n) @f$.
+     */
+    IMMER_NODISCARD flex_vector compact() const { return impl_.compact(); }
+
     /*!
      * Returns an @a transient form of this container, an
      * `immer::flex_vector_transient`.
@@ -517,16 +770,6 @@ public:
     // Semi-private
     const impl_t& impl() const { return impl_; }
 
-#if IMMER_DEBUG_PRINT
-    void debug_print(std::ostream& out = std::cerr) const
-    {
-        impl_.debug_print(out);
-    }
-#endif
-
-private:
-    friend transient_type;
-
     flex_vector(impl_t impl)
         : impl_(std::move(impl))
     {
@@ -537,6 +780,16 @@ private:
 #endif
     }
 
+#if IMMER_DEBUG_PRINT
+    void debug_print(std::ostream& out = std::cerr) const
+    {
+        impl_.debug_print(out);
+    }
+#endif
+
+private:
+    friend transient_type;
+
     flex_vector&& push_back_move(std::true_type, value_type value)
     {
         impl_.push_back_mut({}, std::move(value));
@@ -547,6 +800,40 @@ private:
         return impl_.push_back(std::move(value));
     }
 
+    template <typename... Args>
+    flex_vector&& emplace_back_move(std::true_type, Args&&... args)
+    {
+        impl_.emplace_back_mut({}, std::forward<Args>(args)...);
+        return std::move(*this);
+    }
+    template <typename... Args>
+    flex_vector emplace_back_move(std::false_type, Args&&... args)
+    {
+        return impl_.emplace_back(std::forward<Args>(args)...);
+    }
+
+    template <typename Iter, typename Sent>
+    flex_vector&& append_move(std::true_type, Iter first, Sent last)
+    {
+        impl_.append_mut({}, first, last);
+        return std::move(*this);
+    }
+    template <typename Iter, typename Sent>
+    flex_vector append_move(std::false_type, Iter first, Sent last)
+    {
+        return impl_.append(first, last);
+    }
+
+    flex_vector&& push_front_move(std::true_type, value_type value)
+    {
+        impl_.push_front_mut({}, std::move(value));
+        return std::move(*this);
+    }
+    flex_vector push_front_move(std::false_type, value_type value)
+    {
+        return impl_.push_front(std::move(value));
+    }
+
     flex_vector&& set_move(std::true_type, size_type index, value_type value)
     {
         impl_.assoc_mut({}, index, std::move(value));
@@ -557,6 +844,18 @@ private:
         return impl_.assoc(index, std::move(value));
     }
 
+    template <typename Iter, typename Sent>
+    flex_vector&& set_many_move(std::true_type, Iter first, Sent last)
+    {
+        impl_.assoc_many_mut({}, first, last);
+        return std::move(*this);
+    }
+    template <typename Iter, typename Sent>
+    flex_vector set_many_move(std::false_type, Iter first, Sent last)
+    {
+        return impl_.assoc_many(first, last);
+    }
+
     template <typename Fn>
     flex_vector&& update_move(std::true_type, size_type index, Fn&& fn)
     {
@@ -569,6 +868,36 @@ private:
         return impl_.update(index, std::forward<Fn>(fn));
     }
 
+    flex_vector&&
+    set_if_changed_move(std::true_type, size_type index, value_type value)
+    {
+        if (!(impl_.get(index) == value))
+            impl_.assoc_mut({}, index, std::move(value));
+        return std::move(*this);
+    }
+    flex_vector
+    set_if_changed_move(std::false_type, size_type index, value_type value)
+    {
+        return set_if_changed(index, std::move(value));
+    }
+
+    template <typename Fn>
+    flex_vector&&
+    update_if_changed_move(std::true_type, size_type index, Fn&& fn)
+    {
+        auto& x = impl_.get(index);
+        auto v  = std::forward<Fn>(fn)(x);
+        if (!(x == v))
+            impl_.assoc_mut({}, index, std::move(v));
+        return std::move(*this);
+    }
+    template <typename Fn>
+    flex_vector
+    update_if_changed_move(std::false_type, size_type index, Fn&& fn)
+    {
+        return update_if_changed(index, std::forward<Fn>(fn));
+    }
+
     flex_vector&& take_move(std::true_type, size_type elems)
     {
         impl_.take_mut({}, elems);
@@ -613,6 +942,28 @@ private:
         return l.impl_.concat(r.impl_);
     }
 
+    template <typename Edits>
+    static flex_vector patch(flex_vector v, const Edits& edits)
+    {
+        auto bounds = std::vector<size_type>{};
+        for (auto& e : edits) {
+            bounds.push_back(e.first);
+            bounds.push_back(e.last);
+        }
+        auto parts = std::vector<flex_vector>{};
+        parts.reserve(bounds.size() + 1);
+        detail::split_at(
+            std::move(v), std::size_t{}, bounds.begin(), bounds.end(), parts);
+        // the odd parts are the ones between the bounds of an edit
+        auto i = std::size_t{1};
+        for (auto& e : edits) {
+            parts[i] = e.values;
+            i += 2;
+        }
+        auto ex = sequential_executor{};
+        return detail::concat_all(parts, ex);
+    }
+
     impl_t impl_ = {};
 };
 
@@ -621,4 +972,441 @@ static_assert(std::is_nothrow_move_constructible<flex_vector<int>>::value,
 static_assert(std::is_nothrow_move_assignable<flex_vector<int>>::value,
               "flex_vector is not nothrow move assignable");
 
+namespace detail {
+
+/*!
+ * Appends the elements of `v` in `[first, last)` to `r`.  Runs of at
+ * least a leaf are sliced out of `v` and concatenated, sharing their
+ * structure, and shorter ones are copied.
+ */
+template <typename Vector>
+void append_slice(Vector& r,
+                  const Vector& v,
+                  std::size_t first,
+                  std::size_t last)
+{
+    constexpr auto min_slice = std::size_t{1} << Vector::bits_leaf;
+    if (last - first >= min_slice)
+        r = std::move(r) + v.drop(first).take(last - first);
+    else
+        r = std::move(r).append(v.begin() + first, v.begin() + last);
+}
+
+/*!
+ * Returns the first index in `[lo, hi)` of the elements of the tree `t`
+ * for which `pred` is `false`, where `pred` is `true` for all the
+ * elements before it.  Every probe of the binary search fetches a
+ * whole leaf and discards it at once, and the search finishes within
+ * the leaf, thus it only descends the tree @f$ O(log(n / 2^{BL})) @f$
+ * times.
+ */
+template <typename Tree, typename Pred>
+std::size_t
+partition_point(const Tree& t, std::size_t lo, std::size_t hi, Pred&& pred)
+{
+    while (lo < hi) {
+        auto region = t.region_for(lo + (hi - lo) / 2);
+        auto data   = std::get<0>(region);
+        auto first  = std::get<1>(region);
+        auto b      = std::max(first, lo);
+        auto e      = std::min(std::get<2>(region), hi);
+        auto p =
+            std::partition_point(data + (b - first), data + (e - first), pred);
+        auto i = first + static_cast<std::size_t>(p - data);
+        if (i == b && b > lo)
+            hi = b;
+        else if (i == e && e < hi)
+            lo = e;
+        else
+            return i;
+    }
+    return lo;
+}
+
+} // namespace detail
+
+/*!
+ * Returns a flex_vector with the elements of `v` for which `pred`
+ * returns `true`, in the same order.  The runs of elements that are
+ * kept are sliced out of `v` and concatenated, sharing their
+ * structure, and only the runs shorter than a leaf are copied.  Thus,
+ * a filter that removes few elements costs time and memory
+ * proportional to the number of removed elements.
+ */
+template <typename T,
+          typename MemoryPolicy,
+          detail::rbts::bits_t B,
+          detail::rbts::bits_t BL,
+          typename Pred>
+flex_vector<T, MemoryPolicy, B, BL>
+filter(const flex_vector<T, MemoryPolicy, B, BL>& v, Pred&& pred)
+{
+    auto r   = flex_vector<T, MemoryPolicy, B, BL>{};
+    auto run = std::size_t{}; // first index of the run
+    auto idx = std::size_t{};
+    v.impl().for_each_chunk([&](auto fst, auto lst) {
+        for (; fst != lst; ++fst, ++idx)
+            if (!pred(*fst)) {
+                detail::append_slice(r, v, run, idx);
+                run = idx + 1;
+            }
+    });
+    if (run == 0)
+        return v;
+    detail::append_slice(r, v, run, idx);
+    return r;
+}
+
+namespace detail {
+
+template <typename Range, typename Executor>
+auto concat_all(const Range& r, Executor& ex)
+    -> std::decay_t<decltype(*std::begin(r))>
+{
+    using vector_t           = std::decay_t<decltype(*std::begin(r))>;
+    constexpr auto min_slice = std::size_t{1} << vector_t::bits_leaf;
+    auto parts               = std::vector<vector_t>{};
+    for (auto&& v : r) {
+        if (v.empty())
+            continue;
+        else if (v.size() < min_slice && !parts.empty())
+            parts.back() = std::move(parts.back()).append(v.begin(), v.end());
+        else
+            parts.push_back(v);
+    }
+    // every round concatenates the neighbouring parts pairwise, so that
+    // both sides of every concatenation have about the same size
+    while (parts.size() > 1) {
+        auto next = std::vector<vector_t>((parts.size() + 1) / 2);
+        ex.bulk(parts.size() / 2, [&](std::size_t i) {
+            next[i] = std::move(parts[2 * i]) + std::move(parts[2 * i + 1]);
+        });
+        if (parts.size() % 2)
+            next.back() = std::move(parts.back());
+        parts = std::move(next);
+    }
+    return parts.empty() ? vector_t{} : std::move(parts.front());
+}
+
+template <typename T,
+          typename MemoryPolicy,
+          rbts::bits_t B,
+          rbts::bits_t BL,
+          typename Compare,
+          typename Executor>
+flex_vector<T, MemoryPolicy, B, BL>
+sort(const flex_vector<T, MemoryPolicy, B, BL>& v, Compare& cmp, Executor& ex)
+{
+    auto buf = std::vector<T>{};
+    buf.reserve(v.size());
+    v.impl().for_each_chunk(
+        [&](auto fst, auto lst) { buf.insert(buf.end(), fst, lst); });
+    // sort a run per task, then merge neighbouring runs pairwise
+    auto n     = buf.size();
+    auto tasks = bulk_tasks(ex, n, bulk_min_elements);
+    auto at    = [&](std::size_t i) {
+        return buf.begin() + static_cast<std::ptrdiff_t>(n * i / tasks);
+    };
+    if (tasks > 0)
+        ex.bulk(tasks, [&](std::size_t i) {
+            std::stable_sort(at(i), at(i + 1), cmp);
+        });
+    for (auto w = std::size_t{1}; w < tasks; w *= 2)
+        ex.bulk((tasks + 2 * w - 1) / (2 * w), [&](std::size_t i) {
+            auto mid = 2 * w * i + w;
+            if (mid < tasks)
+                std::inplace_merge(
+                    at(mid - w), at(mid), at(std::min(mid + w, tasks)), cmp);
+        });
+    return flex_vector<T, MemoryPolicy, B, BL>::from_range_parallel(
+        std::make_move_iterator(buf.begin()),
+        std::make_move_iterator(buf.end()),
+        ex);
+}
+
+// Pushes to `r` the parts of `v`, whose first element is at `offset`
+// of the vector that is being split, between the indices in `[first,
+// last)`.
+template <typename Vector, typename Iter>
+void split_at(
+    Vector v, std::size_t offset, Iter first, Iter last, std::vector<Vector>& r)
+{
+    if (first == last) {
+        r.push_back(std::move(v));
+        return;
+    }
+    auto mid   = first + (last - first) / 2;
+    auto pos   = std::min(v.size(), static_cast<std::size_t>(*mid) - offset);
+    auto right = v.drop(pos);
+    split_at(std::move(v).take(pos), offset, first, mid, r);
+    split_at(std::move(right), offset + pos, std::next(mid), last, r);
+}
+
+} // namespace detail
+
+/*!
+ * Returns the concatenation of all the flex_vectors in the range `r`,
+ * in order.  Chaining `operator+` over many fragments grows a single
+ * vector, rebalancing its right edge once per fragment.  Instead, the
+ * fragments shorter than a leaf are appended to the one before them,
+ * and the rest are concatenated in a balanced tree of pairwise
+ * concatenations, of @f$ O(log(k)) @f$ depth for @f$ k @f$ fragments.
+ */
+template <typename Range>
+auto concat_all(const Range& r) -> std::decay_t<decltype(*std::begin(r))>
+{
+    auto ex = sequential_executor{};
+    return detail::concat_all(r, ex);
+}
+
+/*!
+ * Like @a concat_all, but the concatenations in every level of the
+ * tree run concurrently using the executor `ex` (see @ref executor).
+ */
+template <typename Range, typename Executor = thread_executor>
+auto par_concat_all(const Range& r, Executor&& ex = {})
+    -> std::decay_t<decltype(*std::begin(r))>
+{
+    return detail::concat_all(r, ex);
+}
+
+/*!
+ * Returns the parts of `v` between the indices in the range
+ * `positions`, which must be sorted, in order: the first part holds
+ * the elements before the first index and the last one those from the
+ * last index on, thus there is one more part than indices.  The
+ * indices beyond the end are taken as the end, giving empty parts.
+ *
+ * The tree is cut at the middle index first, and then each side is cut
+ * at the indices that fall in it, recursively.  The sides are only
+ * referenced by the calls that cut them, thus their spines are cut in
+ * place when the memory policy supports it, instead of being copied
+ * by every cut.  It takes @f$ O(k log(n)) @f$ for @f$ k @f$ indices.
+ * It is the inverse of @a concat_all, and it is meant to split the
+ * vector for parallel tasks.
+ */
+template <typename T,
+          typename MemoryPolicy,
+          detail::rbts::bits_t B,
+          detail::rbts::bits_t BL,
+          typename Range>
+std::vector<flex_vector<T, MemoryPolicy, B, BL>>
+split_at(flex_vector<T, MemoryPolicy, B, BL> v, const Range& positions)
+{
+    auto r = std::vector<flex_vector<T, MemoryPolicy, B, BL>>{};
+    r.reserve(static_cast<std::size_t>(
+                  std::distance(std::begin(positions), std::end(positions))) +
+              1);
+    detail::split_at(std::move(v),
+                     std::size_t{},
+                     std::begin(positions),
+                     std::end(positions),
+                     r);
+    return r;
+}
+
+/*!
+ * Returns `v` split with @a split_at in `k` parts whose sizes differ
+ * at most by one.  When `k` is zero, it returns no parts.
+ */
+template <typename T,
+          typename MemoryPolicy,
+          detail::rbts::bits_t B,
+          detail::rbts::bits_t BL>
+std::vector<flex_vector<T, MemoryPolicy, B, BL>>
+split(flex_vector<T, MemoryPolicy, B, BL> v, std::size_t k)
+{
+    if (k == 0)
+        return {};
+    auto n         = v.size();
+    auto positions = std::vector<std::size_t>(k - 1);
+    for (auto i = std::size_t{1}; i < k; ++i)
+        positions[i - 1] = n / k * i + std::min(i, n % k);
+    return split_at(std::move(v), positions);
+}
+
+/*!
+ * Returns a flex_vector with the elements of `v` sorted by `cmp`,
+ * keeping the order of the elements that are equivalent.  The
+ * elements are copied once into a buffer, where they are sorted, and
+ * then moved into the leaves of a regular tree.  Its complexity is
+ * @f$ O(n log(n)) @f$.
+ */
+template <typename T,
+          typename MemoryPolicy,
+          detail::rbts::bits_t B,
+          detail::rbts::bits_t BL,
+          typename Compare = std::less<T>>
+flex_vector<T, MemoryPolicy, B, BL>
+sort(const flex_vector<T, MemoryPolicy, B, BL>& v, Compare cmp = {})
+{
+    auto ex = sequential_executor{};
+    return detail::sort(v, cmp, ex);
+}
+
+/*!
+ * Like @a sort, but runs of the buffer are sorted and merged
+ * concurrently using the executor `ex` (see @ref executor), and so are
+ * the nodes of the result built.
+ */
+template <typename T,
+          typename MemoryPolicy,
+          detail::rbts::bits_t B,
+          detail::rbts::bits_t BL,
+          typename Compare  = std::less<T>,
+          typename Executor = thread_executor>
+flex_vector<T, MemoryPolicy, B, BL>
+par_sort(const flex_vector<T, MemoryPolicy, B, BL>& v,
+         Compare cmp   = {},
+         Executor&& ex = {})
+{
+    return detail::sort(v, cmp, ex);
+}
+
+/*!
+ * Returns an iterator to the first element of `v`, which must be
+ * sorted by `cmp`, that is not less than `key`, or `v.end()` if there
+ * is none.  Unlike `std::lower_bound`, which looks up every probe from
+ * the root, it searches leaf by leaf, and only descends into the tree
+ * @f$ O(log(n / 2^{BL})) @f$ times.
+ */
+template <typename T,
+          typename MemoryPolicy,
+          detail::rbts::bits_t B,
+          detail::rbts::bits_t BL,
+          typename K,
+          typename Compare = std::less<>>
+typename flex_vector<T, MemoryPolicy, B, BL>::iterator
+lower_bound(const flex_vector<T, MemoryPolicy, B, BL>& v,
+            const K& key,
+            Compare cmp = {})
+{
+    return v.begin() +
+           detail::partition_point(v.impl(), 0, v.size(), [&](const T& x) {
+               return cmp(x, key);
+           });
+}
+
+/*!
+ * Returns an iterator to the first element of `v`, which must be
+ * sorted by `cmp`, that is greater than `key`, or `v.end()` if there
+ * is none.  It searches like @a lower_bound.
+ */
+template <typename T,
+          typename MemoryPolicy,
+          detail::rbts::bits_t B,
+          detail::rbts::bits_t BL,
+          typename K,
+          typename Compare = std::less<>>
+typename flex_vector<T, MemoryPolicy, B, BL>::iterator
+upper_bound(const flex_vector<T, MemoryPolicy, B, BL>& v,
+            const K& key,
+            Compare cmp = {})
+{
+    return v.begin() +
+           detail::partition_point(v.impl(), 0, v.size(), [&](const T& x) {
+               return !cmp(key, x);
+           });
+}
+
+/*!
+ * Returns the union of `a` and `b`, which must be sorted by `cmp`,
+ * like `std::set_union`: for equivalent elements it keeps the ones in
+ * `a`, plus the extra ones in `b` if there are fewer in `a`.  The runs
+ * that come from the same vector are found with binary searches like
+ * @a lower_bound, and those of at least a leaf are sliced and
+ * concatenated, sharing their structure.  Thus, merging vectors that
+ * interleave in few runs costs time proportional to the number of
+ * runs times @f$ O(log(n)) @f$.
+ */
+template <typename T,
+          typename MemoryPolicy,
+          detail::rbts::bits_t B,
+          detail::rbts::bits_t BL,
+          typename Compare = std::less<T>>
+flex_vector<T, MemoryPolicy, B, BL>
+set_union(const flex_vector<T, MemoryPolicy, B, BL>& a,
+          const flex_vector<T, MemoryPolicy, B, BL>& b,
+          Compare cmp = {})
+{
+    auto r  = flex_vector<T, MemoryPolicy, B, BL>{};
+    auto na = a.size(), nb = b.size();
+    auto i = std::size_t{}, j = std::size_t{};
+    auto run = std::size_t{}; // first index of the pending run of `a`
+    while (i < na && j < nb) {
+        auto& y = b[j];
+        i = detail::partition_point(
+            a.impl(), i, na, [&](const T& x) { return cmp(x, y); });
+        if (i == na)
+            break;
+        auto& x = a[i];
+        if (!cmp(y, x)) {
+            ++i;
+            ++j;
+        } else {
+            detail::append_slice(r, a, run, i);
+            run    = i;
+            auto k = detail::partition_point(
+                b.impl(), j, nb, [&](const T& z) { return cmp(z, x); });
+            detail::append_slice(r, b, j, k);
+            j = k;
+        }
+    }
+    if (r.empty() && j == nb)
+        return a;
+    detail::append_slice(r, a, run, na);
+    detail::append_slice(r, b, j, nb);
+    return r;
+}
+
+/*!
+ * Returns the intersection of `a` and `b`, which must be sorted by
+ * `cmp`, like `std::set_intersection`, keeping the elements of `a`.
+ * It skips the elements that are not in both with binary searches like
+ * @a lower_bound, and slices the long runs out of `a` like @a
+ * set_union.
+ */
+template <typename T,
+          typename MemoryPolicy,
+          detail::rbts::bits_t B,
+          detail::rbts::bits_t BL,
+          typename Compare = std::less<T>>
+flex_vector<T, MemoryPolicy, B, BL>
+set_intersection(const flex_vector<T, MemoryPolicy, B, BL>& a,
+                 const flex_vector<T, MemoryPolicy, B, BL>& b,
+                 Compare cmp = {})
+{
+    auto r  = flex_vector<T, MemoryPolicy, B, BL>{};
+    auto na = a.size(), nb = b.size();
+    auto i = std::size_t{}, j = std::size_t{};
+    auto run = std::size_t{}; // first index of the pending run of `a`
+    while (i < na && j < nb) {
+        auto& x = a[i];
+        auto& y = b[j];
+        if (cmp(x, y)) {
+            detail::append_slice(r, a, run, i);
+            i = run = detail::partition_point(
+                a.impl(), i, na, [&](const T& z) { return cmp(z, y); });
+        } else if (cmp(y, x)) {
+            j = detail::partition_point(
+                b.impl(), j, nb, [&](const T& z) { return cmp(z, x); });
+        } else {
+            ++i;
+            ++j;
+        }
+    }
+    if (run == 0 && i == na)
+        return a;
+    detail::append_slice(r, a, run, i);
+    return r;
+}
+
+// A flex_vector only holds its size and pointers to its nodes.
+template <typename T,
+          typename MP,
+          detail::rbts::bits_t B,
+          detail::rbts::bits_t BL>
+struct is_trivially_relocatable<flex_vector<T, MP, B, BL>> : std::true_type
+{};
+
 } // namespace immer
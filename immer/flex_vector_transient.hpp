@@ -8,9 +8,11 @@
 
 #pragma once
 
+#include <immer/detail/rbts/cursor.hpp>
 #include <immer/detail/rbts/rrbtree.hpp>
 #include <immer/detail/rbts/rrbtree_iterator.hpp>
 #include <immer/memory_policy.hpp>
+#include <immer/trace.hpp>
 
 namespace immer {
 
@@ -62,6 +64,11 @@ public:
     using const_iterator   = iterator;
     using reverse_iterator = std::reverse_iterator<iterator>;
 
+    /*!
+     * The type of the cursors returned by `cursor_at()`.
+     */
+    using cursor = detail::rbts::cursor<impl_t>;
+
     using persistent_type = flex_vector<T, MemoryPolicy, B, BL>;
 
     /*!
@@ -156,6 +163,41 @@ public:
         impl_.push_back_mut(*this, std::move(value));
     }
 
+    /*!
+     * Inserts a new element at the end, constructed in place with the
+     * arguments `args`.  It may allocate memory and its complexity is
+     * *effectively* @f$ O(1) @f$.
+     */
+    template <typename... Args>
+    void emplace_back(Args&&... args)
+    {
+        impl_.emplace_back_mut(*this, std::forward<Args>(args)...);
+    }
+
+    /*!
+     * Inserts the elements in the range defined by the input iterator
+     * `first` and range sentinel `last` at the end.  It may allocate
+     * memory and its complexity is *effectively* @f$ O(n) @f$ for @f$ n
+     * @f$ elements.
+     */
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    void append(Iter first, Sent last)
+    {
+        impl_.append_mut(*this, first, last);
+    }
+
+    /*!
+     * Inserts `value` at the front.  It may allocate memory and its
+     * complexity is *effectively* @f$ O(1) @f$.
+     */
+    void push_front(value_type value)
+    {
+        impl_.push_front_mut(*this, std::move(value));
+    }
+
     /*!
      * Sets to the value `value` at position `idx`.
      * Undefined for `index >= size()`.
@@ -167,6 +209,22 @@ public:
         impl_.assoc_mut(*this, index, std::move(value));
     }
 
+    /*!
+     * Sets the value of every `(index, value)` pair in the range
+     * defined by the input iterator `first` and range sentinel `last`
+     * at its index, where later pairs win.  Undefined when an index is
+     * @f$ \geq size() @f$.  It may allocate memory and its complexity
+     * is *effectively* @f$ O(n) @f$ for @f$ n @f$ pairs.
+     */
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    void set_many(Iter first, Sent last)
+    {
+        impl_.assoc_many_mut(*this, first, last);
+    }
+
     /*!
      * Updates the vector to contain the result of the expression
      * `fn((*this)[idx])` at position `idx`.
@@ -180,6 +238,55 @@ public:
         impl_.update_mut(*this, index, std::forward<FnT>(fn));
     }
 
+    /*!
+     * Calls `fn(first, last)` with pointers to the elements, in order,
+     * a leaf at a time, which can be changed in place.  The leaves and
+     * the nodes on the path to them that are shared with other
+     * containers are copied first.  The pointers are invalidated by any
+     * other change to the transient.  It may allocate memory and its
+     * complexity is *effectively* @f$ O(n) @f$.
+     */
+    template <typename Fn>
+    void for_each_chunk_mut(Fn&& fn)
+    {
+        impl_.for_each_chunk_mut(*this, 0, impl_.size, fn);
+    }
+
+    /*!
+     * Sets every element `x` with index in `[first, last)` to `fn(x)`,
+     * like `update`, but visiting the leaves only once, through
+     * `for_each_chunk_mut`.  Undefined for `last > size()`.
+     */
+    template <typename Fn>
+    void update_range(size_type first, size_type last, Fn&& fn)
+    {
+        impl_.for_each_chunk_mut(*this, first, last, [&](auto f, auto l) {
+            for (; f != l; ++f)
+                *f = fn(std::move(*f));
+        });
+    }
+
+    /*!
+     * Returns a cursor at position `index`, that reads the element
+     * there with `get()` and changes it in place with `set(value)` and
+     * `update(fn)`.  It is moved with `++`, `--`, `+=`, `-=` and
+     * `seek(index)`, and tells where it is with `index()`.  The cursor
+     * remembers the leaf it is in, so that moving within it and
+     * changing its elements is @f$ O(1) @f$, and it only descends the
+     * tree again when it crosses to another leaf.
+     *
+     * @rst
+     *
+     * .. warning:: The cursor is invalidated by any other change to the
+     *    transient, and by calling ``persistent()`` on it.
+     *
+     * @endrst
+     */
+    IMMER_NODISCARD cursor cursor_at(size_type index)
+    {
+        return {impl_, *this, index};
+    }
+
     /*!
      * Resizes the vector to only contain the first `min(elems, size())`
      * elements. It may allocate memory and its complexity is
@@ -194,6 +301,33 @@ public:
      */
     void drop(size_type elems) { impl_.drop_mut(*this, elems); }
 
+    /*!
+     * Removes the last element, if any.  The tail is shrunk in place,
+     * so its complexity is amortized @f$ O(1) @f$.
+     */
+    void pop_back() { take(size() - 1); }
+
+    /*!
+     * Removes the first element, if any.  It may allocate memory and
+     * its complexity is @f$ O(log(n)) @f$.
+     */
+    void pop_front() { drop(1); }
+
+    /*!
+     * Resizes the vector to contain `n` elements, removing the ones
+     * past `n` or appending copies of `v` at the end.  The appended
+     * copies are a tree where all the full nodes of a level are the same
+     * node, so it allocates @f$ O(log(n)) @f$ memory, and they are
+     * copied, as usual, when they are changed later.
+     */
+    void resize(size_type n, value_type v = {})
+    {
+        if (n <= impl_.size)
+            impl_.take_mut(*this, n);
+        else
+            concat_mut_l(impl_, *this, impl_t::from_fill(n - impl_.size, v));
+    }
+
     /*!
      * Appends the contents of the `r` at the end.  It may allocate
      * memory and its complexity is:
@@ -207,6 +341,7 @@ public:
     void append(flex_vector_transient&& r)
     {
         concat_mut_lr_l(impl_, *this, r.impl_, r);
+        r.owner_t::operator=(owner_t{});
     }
 
     /*!
@@ -222,18 +357,35 @@ public:
     void prepend(flex_vector_transient&& l)
     {
         concat_mut_lr_r(l.impl_, l, impl_, *this);
+        l.owner_t::operator=(owner_t{});
     }
 
+    /*!
+     * Stores the elements in a regular tree of full leaves and inner
+     * nodes, like `flex_vector::compact()`.  It does nothing when the
+     * vector is already regular.  Otherwise it may allocate memory and
+     * its complexity is @f$ O(n) @f$.
+     */
+    void compact() { impl_.compact_mut(*this); }
+
     /*!
      * Returns an @a immutable form of this container, an
      * `immer::flex_vector`.
      */
     IMMER_NODISCARD persistent_type persistent() &
     {
+        IMMER_TRACE_HOOK(persistent, impl_.size);
         this->owner_t::operator=(owner_t{});
         return impl_;
     }
-    IMMER_NODISCARD persistent_type persistent() && { return std::move(impl_); }
+    IMMER_NODISCARD persistent_type persistent() &&
+    {
+        // the nodes that were created under the current edit are now
+        // part of the persistent value
+        IMMER_TRACE_HOOK(persistent, impl_.size);
+        this->owner_t::operator=(owner_t{});
+        return std::move(impl_);
+    }
 
 private:
     friend persistent_type;
@@ -242,6 +394,14 @@ private:
         : impl_(std::move(impl))
     {}
 
+    template <typename MP>
+    friend class edit_session;
+
+    flex_vector_transient(impl_t impl, owner_t owner)
+        : owner_t(std::move(owner))
+        , impl_(std::move(impl))
+    {}
+
     impl_t impl_ = {};
 };
 
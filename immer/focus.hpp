@@ -0,0 +1,109 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/rbts/focus.hpp>
+
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace immer {
+
+/*!
+ * Random access to a ``vector`` or ``flex_vector`` of type `Vector`,
+ * as returned by @a focus, that is fast for neighbouring indices.  It
+ * remembers the path from the root to the leaf of the last element
+ * that it read, so that reading another element of the same leaf
+ * costs @f$ O(1) @f$, and one in a nearby leaf only descends from
+ * their closest common parent, thus walking the vector forwards or
+ * backwards, or looking around the last position, is amortized @f$
+ * O(1) @f$ per element instead of @f$ O(log(n)) @f$.  It holds a copy
+ * of the vector, thus the references that it returns stay valid while
+ * it lives.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    auto f = immer::focus(samples);
+ *    for (auto i = window; i < f.size(); ++i)
+ *        avg += (f[i] - f[i - window]) / window;
+ *
+ * .. note:: The elements of a transient are best updated in sequence
+ *    with its ``cursor_at()``, which keeps the leaf that it is
+ *    updating in the same way.
+ *
+ * @endrst
+ */
+template <typename Vector>
+class vector_focus
+{
+    using impl_t  = std::decay_t<decltype(std::declval<Vector>().impl())>;
+    using focus_t = detail::rbts::focus<impl_t>;
+
+public:
+    using value_type = typename Vector::value_type;
+    using size_type  = typename Vector::size_type;
+    using reference  = const value_type&;
+
+    vector_focus(Vector v)
+        : v_{std::move(v)}
+    {}
+
+    /*!
+     * Returns the number of elements in the vector.
+     */
+    size_type size() const { return v_.size(); }
+
+    /*!
+     * Returns the vector that it reads.
+     */
+    const Vector& vector() const { return v_; }
+
+    /*!
+     * Returns a `const` reference to the element at position `index`,
+     * which must be smaller than `size()`.  It does not allocate
+     * memory and it is amortized @f$ O(1) @f$ when `index` is close to
+     * the one of the previous read.
+     */
+    reference operator[](size_type index) const
+    {
+        return focus_.get(v_.impl(), index);
+    }
+
+    /*!
+     * Like `operator[]`, but throws an `std::out_of_range` error when
+     * `index` is not smaller than `size()`.
+     */
+    reference at(size_type index) const
+    {
+        if (index >= size())
+            IMMER_THROW(std::out_of_range{"index out of range"});
+        return (*this)[index];
+    }
+
+private:
+    Vector v_;
+    mutable focus_t focus_;
+};
+
+/*!
+ * Returns a @a vector_focus that reads the elements of `v`, keeping
+ * the path to the last one.
+ */
+template <typename Vector>
+vector_focus<std::decay_t<Vector>> focus(Vector&& v)
+{
+    return {std::forward<Vector>(v)};
+}
+
+} // namespace immer
@@ -0,0 +1,300 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/box.hpp>
+#include <immer/config.hpp>
+#include <immer/container_hash.hpp>
+#include <immer/detail/util.hpp>
+#include <immer/map.hpp>
+#include <immer/memory_policy.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+namespace immer {
+
+namespace detail {
+namespace frozen {
+
+/*!
+ * Open addressing table with linear probing, holding a copy of every
+ * value of a map.  Each slot has the hash of its value, or zero when
+ * empty, next to the value itself, so that a lookup most often reads
+ * a single cache line.  It is at most three quarters full, thus there
+ * is always an empty slot that ends the probing.
+ */
+template <typename K, typename T, typename Hash, typename Equal, typename MP>
+struct table
+{
+    using heap    = typename MP::heap::type;
+    using value_t = std::pair<K, T>;
+
+    struct slot
+    {
+        std::size_t tag;
+        aligned_storage_for<value_t> storage;
+
+        const value_t& value() const
+        {
+            return *reinterpret_cast<const value_t*>(&storage);
+        }
+    };
+
+    slot* slots;
+    std::size_t mask;
+    unsigned shift;
+
+    // the tag is the hash with its lowest bit set, so that it is never
+    // zero, and the slot is taken from its highest bits, after mixing
+    // them, so that hash functions with poor high bits probe well
+    static std::size_t tag_of(std::size_t h) { return h | 1u; }
+
+    std::size_t index_of(std::size_t h) const
+    {
+        constexpr auto golden = sizeof(std::size_t) >= 8
+                                    ? std::size_t(0x9e3779b97f4a7c15ull)
+                                    : std::size_t(0x9e3779b9u);
+        return (h * golden) >> shift;
+    }
+
+    template <typename Map>
+    explicit table(const Map& m)
+    {
+        auto bits = 1u;
+        while ((std::size_t{1} << bits) * 3 < m.size() * 4 + 4)
+            ++bits;
+        auto capacity = std::size_t{1} << bits;
+        mask          = capacity - 1;
+        shift         = static_cast<unsigned>(sizeof(std::size_t) * 8 - bits);
+        slots = static_cast<slot*>(heap::allocate(capacity * sizeof(slot)));
+        for (auto i = std::size_t{}; i < capacity; ++i)
+            slots[i].tag = 0;
+        IMMER_TRY {
+            for (const auto& v : m) {
+                auto h = Hash{}(v.first);
+                auto i = index_of(h);
+                while (slots[i].tag)
+                    i = (i + 1) & mask;
+                new (&slots[i].storage) value_t{v};
+                slots[i].tag = tag_of(h);
+            }
+        }
+        IMMER_CATCH (...) {
+            destroy();
+            IMMER_RETHROW;
+        }
+    }
+
+    table(const table&)            = delete;
+    table& operator=(const table&) = delete;
+
+    ~table() { destroy(); }
+
+    template <typename Key>
+    const value_t* find(const Key& k) const
+    {
+        auto h   = Hash{}(k);
+        auto tag = tag_of(h);
+        for (auto i = index_of(h);; i = (i + 1) & mask) {
+            auto& s = slots[i];
+            if (!s.tag)
+                return nullptr;
+            if (s.tag == tag && Equal{}(s.value().first, k))
+                return &s.value();
+        }
+    }
+
+    void destroy()
+    {
+        for (auto i = std::size_t{}; i <= mask; ++i)
+            if (slots[i].tag)
+                slots[i].value().~value_t();
+        heap::deallocate((mask + 1) * sizeof(slot), slots);
+    }
+};
+
+} // namespace frozen
+} // namespace detail
+
+/*!
+ * Read only snapshot of a @ref map, that trades the ability to derive
+ * new versions for faster lookups.  Besides the map, it holds a copy
+ * of its values in a flat hash table, where a lookup most often takes a
+ * single cache miss, instead of one per level of the trie.
+ *
+ * It is made with @ref freeze, taking time and memory linear in the
+ * size of the map, and @ref unfreeze gives back the map that it was
+ * made from.  Copying it is cheap, since the table is shared.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    auto m = immer::map<std::string, int>{{"a", 1}, {"b", 2}};
+ *    auto f = immer::freeze(m);
+ *    assert(f["a"] == 1);
+ *    assert(immer::unfreeze(f) == m);
+ *
+ * @endrst
+ */
+template <typename K,
+          typename T,
+          typename Hash           = container_hash<K>,
+          typename Equal          = std::equal_to<K>,
+          typename MemoryPolicy   = default_memory_policy,
+          detail::hamts::bits_t B = default_bits>
+class frozen_map
+{
+    using table_t = detail::frozen::table<K, T, Hash, Equal, MemoryPolicy>;
+
+public:
+    using map_type        = map<K, T, Hash, Equal, MemoryPolicy, B>;
+    using key_type        = K;
+    using mapped_type     = T;
+    using value_type      = std::pair<K, T>;
+    using size_type       = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using hasher          = Hash;
+    using key_equal       = Equal;
+    using reference       = const value_type&;
+    using const_reference = const value_type&;
+    using iterator        = typename map_type::iterator;
+    using const_iterator  = iterator;
+
+    /*!
+     * Default constructor.  It creates a frozen map of `size() == 0`.
+     */
+    frozen_map()
+        : frozen_map{map_type{}}
+    {}
+
+    /*!
+     * Builds the table for the map `m`.
+     */
+    explicit frozen_map(map_type m)
+        : table_{m}
+        , map_{std::move(m)}
+    {}
+
+    /*!
+     * Returns an iterator pointing at the first element of the
+     * collection, in the order of the map that it was made from.
+     */
+    IMMER_NODISCARD iterator begin() const { return map_.begin(); }
+
+    /*!
+     * Returns an iterator pointing just after the last element of the
+     * collection.
+     */
+    IMMER_NODISCARD iterator end() const { return map_.end(); }
+
+    /*!
+     * Returns the number of elements in the container.
+     */
+    IMMER_NODISCARD size_type size() const { return map_.size(); }
+
+    /*!
+     * Returns `true` if there are no elements in the container.
+     */
+    IMMER_NODISCARD bool empty() const { return map_.empty(); }
+
+    /*!
+     * Returns `1` when the key `k` is contained in the map or `0`
+     * otherwise.  It does not allocate memory and its complexity is
+     * *effectively* @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD size_type count(const K& k) const
+    {
+        return table_->find(k) ? 1 : 0;
+    }
+
+    /*!
+     * Returns a pointer to the value associated with the key `k`, or
+     * `nullptr` when the key is not contained in the map.  The pointer
+     * is valid as long as a copy of this frozen map is alive.
+     */
+    IMMER_NODISCARD const T* find(const K& k) const
+    {
+        auto p = table_->find(k);
+        return p ? &p->second : nullptr;
+    }
+
+    /*!
+     * Returns a `const` reference to the value associated to the key
+     * `k`, or to a default constructed value when the key is not
+     * contained in the map.
+     */
+    IMMER_NODISCARD const T& operator[](const K& k) const
+    {
+        auto p = table_->find(k);
+        if (p)
+            return p->second;
+        static const T v{};
+        return v;
+    }
+
+    /*!
+     * Returns a `const` reference to the value associated to the key
+     * `k`.  If the key is not contained in the map, throws an
+     * `std::out_of_range` error.
+     */
+    const T& at(const K& k) const
+    {
+        auto p = table_->find(k);
+        if (!p)
+            IMMER_THROW(std::out_of_range{"key not found"});
+        return p->second;
+    }
+
+    /*!
+     * Returns the map that this was made from.
+     */
+    IMMER_NODISCARD const map_type& unfreeze() const { return map_; }
+
+private:
+    box<table_t, MemoryPolicy> table_;
+    map_type map_;
+};
+
+/*!
+ * Returns a @ref frozen_map with the contents of `m`.
+ */
+template <typename K,
+          typename T,
+          typename Hash,
+          typename Equal,
+          typename MP,
+          detail::hamts::bits_t B>
+frozen_map<K, T, Hash, Equal, MP, B>
+freeze(map<K, T, Hash, Equal, MP, B> m)
+{
+    return frozen_map<K, T, Hash, Equal, MP, B>{std::move(m)};
+}
+
+/*!
+ * Returns the map that the frozen map `f` was made from.
+ */
+template <typename K,
+          typename T,
+          typename Hash,
+          typename Equal,
+          typename MP,
+          detail::hamts::bits_t B>
+map<K, T, Hash, Equal, MP, B>
+unfreeze(const frozen_map<K, T, Hash, Equal, MP, B>& f)
+{
+    return f.unfreeze();
+}
+
+} // namespace immer
@@ -0,0 +1,392 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/array.hpp>
+#include <immer/config.hpp>
+#include <immer/executor.hpp>
+#include <immer/int_map.hpp>
+#include <immer/memory_policy.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace immer {
+
+template <typename Node, typename MemoryPolicy>
+class graph;
+
+/*!
+ * Flat compressed sparse row representation of a @ref graph, as
+ * returned by `graph::to_csr()`.  The nodes are numbered from zero in
+ * the order of their identifiers, and the successors of the node with
+ * index `i` are the indices `targets()[offsets()[i]]` up to
+ * `targets()[offsets()[i + 1]]`, in the order of their identifiers
+ * too.  Thus, a traversal only reads contiguous memory.
+ *
+ * It keeps the version of the graph that it was built from alive,
+ * which is cheap since the graph is immutable, so that a later
+ * `to_csr()` can tell which rows did not change.
+ */
+template <typename Node, typename MemoryPolicy = default_memory_policy>
+class graph_csr
+{
+public:
+    using node_type  = Node;
+    using size_type  = std::size_t;
+    using graph_type = graph<Node, MemoryPolicy>;
+
+    /*!
+     * Returns the identifiers of the nodes, sorted.
+     */
+    IMMER_NODISCARD const std::vector<Node>& nodes() const { return nodes_; }
+
+    /*!
+     * Returns where the successors of every node start in `targets()`,
+     * followed by the number of edges.
+     */
+    IMMER_NODISCARD const std::vector<size_type>& offsets() const
+    {
+        return offsets_;
+    }
+
+    /*!
+     * Returns the indices of the successors of all the nodes, one row
+     * after the other.
+     */
+    IMMER_NODISCARD const std::vector<size_type>& targets() const
+    {
+        return targets_;
+    }
+
+    /*!
+     * Returns the number of nodes.
+     */
+    IMMER_NODISCARD size_type size() const { return nodes_.size(); }
+
+    /*!
+     * Returns the number of edges.
+     */
+    IMMER_NODISCARD size_type edge_count() const { return targets_.size(); }
+
+    /*!
+     * Returns the index of the node `n`, or `size()` when it is not in
+     * the graph.  Its complexity is @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD size_type index_of(const Node& n) const
+    {
+        auto it = std::lower_bound(nodes_.begin(), nodes_.end(), n);
+        return it != nodes_.end() && *it == n
+                   ? static_cast<size_type>(it - nodes_.begin())
+                   : size();
+    }
+
+    /*!
+     * Returns the range of the indices of the successors of the node
+     * with index `i`.
+     */
+    IMMER_NODISCARD std::pair<const size_type*, const size_type*>
+    successors(size_type i) const
+    {
+        return {targets_.data() + offsets_[i],
+                targets_.data() + offsets_[i + 1]};
+    }
+
+    /*!
+     * Returns the version of the graph that this was built from.
+     */
+    IMMER_NODISCARD const graph_type& source() const { return source_; }
+
+    /*!
+     * Returns the number of rows that were copied from the previous
+     * representation passed to `graph::to_csr()`, instead of being
+     * built again.
+     */
+    IMMER_NODISCARD size_type reused_rows() const { return reused_; }
+
+private:
+    friend graph_type;
+
+    graph_type source_;
+    std::vector<Node> nodes_;
+    std::vector<size_type> offsets_;
+    std::vector<size_type> targets_;
+    // the row of every node, in the adjacency of `source_`
+    std::vector<const typename graph_type::edges_type*> rows_;
+    size_type reused_ = 0;
+};
+
+/*!
+ * Immutable directed graph whose nodes are identified by integers of
+ * type `Node`.
+ *
+ * @rst
+ *
+ * The adjacency is an :cpp:class:`int_map` from every node to the
+ * sorted :cpp:class:`array` of its successors.  Thus, the successors of
+ * a node are contiguous, instead of being a trie of their own as in a
+ * ``map<Node, set<Node>>``, and the nodes are visited in the order of
+ * their identifiers.  Adding or removing an edge copies the row of
+ * its source, which is cheap for the sparse graphs that this is meant
+ * for, and the path to it in the map.
+ *
+ * For the algorithms that traverse the whole graph many times,
+ * ``to_csr()`` builds a flat :cpp:class:`graph_csr` in parallel.
+ * Passing it the previous one makes it copy the rows that did not
+ * change, instead of searching the index of every successor again:
+ *
+ * .. code-block:: c++
+ *
+ *    auto g   = immer::graph<std::uint32_t>{}.add_edge(1, 2).add_edge(2, 3);
+ *    auto csr = g.to_csr();
+ *    g        = g.add_edge(3, 1);
+ *    csr      = g.to_csr(csr);
+ *    page_rank(csr);
+ *
+ * @endrst
+ */
+template <typename Node         = std::uint32_t,
+          typename MemoryPolicy = default_memory_policy>
+class graph
+{
+public:
+    using node_type      = Node;
+    using size_type      = std::size_t;
+    using edges_type     = array<Node, MemoryPolicy>;
+    using adjacency_type = int_map<Node, edges_type, MemoryPolicy>;
+    using csr_type       = graph_csr<Node, MemoryPolicy>;
+
+    using memory_policy_type = MemoryPolicy;
+
+    /*!
+     * Default constructor.  It creates an empty graph.
+     */
+    graph() = default;
+
+    /*!
+     * Returns the number of nodes.
+     */
+    IMMER_NODISCARD size_type node_count() const { return adj_.size(); }
+
+    /*!
+     * Returns the number of edges.  Its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD size_type edge_count() const { return edges_; }
+
+    /*!
+     * Returns whether the node `n` is in the graph.
+     */
+    IMMER_NODISCARD bool contains(const Node& n) const
+    {
+        return adj_.count(n) != 0;
+    }
+
+    /*!
+     * Returns the successors of the node `n`, sorted, which are empty
+     * when it is not in the graph.
+     */
+    IMMER_NODISCARD const edges_type& successors(const Node& n) const
+    {
+        static const auto empty = edges_type{};
+        auto p                  = adj_.find(n);
+        return p ? *p : empty;
+    }
+
+    /*!
+     * Returns whether there is an edge from `from` to `to`.  Its
+     * complexity is @f$ O(W + log(d)) @f$, for a source with @f$ d @f$
+     * successors.
+     */
+    IMMER_NODISCARD bool has_edge(const Node& from, const Node& to) const
+    {
+        auto& s = successors(from);
+        return std::binary_search(s.begin(), s.end(), to);
+    }
+
+    /*!
+     * Returns the map from every node to its successors.
+     */
+    IMMER_NODISCARD const adjacency_type& adjacency() const { return adj_; }
+
+    /*!
+     * Returns a graph with the node `n`, without any edge when it was
+     * not there.
+     */
+    IMMER_NODISCARD graph add_node(Node n) const&
+    {
+        auto r = *this;
+        r.add_node_mut(n);
+        return r;
+    }
+    IMMER_NODISCARD graph&& add_node(Node n) &&
+    {
+        add_node_mut(n);
+        return std::move(*this);
+    }
+
+    /*!
+     * Returns a graph with an edge from `from` to `to`, adding the
+     * nodes that are not there.  It returns the same graph when the
+     * edge is there already.
+     */
+    IMMER_NODISCARD graph add_edge(Node from, Node to) const&
+    {
+        auto r = *this;
+        r.add_edge_mut(from, to);
+        return r;
+    }
+    IMMER_NODISCARD graph&& add_edge(Node from, Node to) &&
+    {
+        add_edge_mut(from, to);
+        return std::move(*this);
+    }
+
+    /*!
+     * Returns a graph without the edge from `from` to `to`.  The nodes
+     * stay.  It returns the same graph when the edge is not there.
+     */
+    IMMER_NODISCARD graph erase_edge(const Node& from, const Node& to) const&
+    {
+        auto r = *this;
+        r.erase_edge_mut(from, to);
+        return r;
+    }
+    IMMER_NODISCARD graph&& erase_edge(const Node& from, const Node& to) &&
+    {
+        erase_edge_mut(from, to);
+        return std::move(*this);
+    }
+
+    /*!
+     * Returns whether the graphs have the same nodes and edges.
+     */
+    IMMER_NODISCARD bool operator==(const graph& other) const
+    {
+        return edges_ == other.edges_ && adj_ == other.adj_;
+    }
+
+    IMMER_NODISCARD bool operator!=(const graph& other) const
+    {
+        return !(*this == other);
+    }
+
+    /*!
+     * Returns the compressed sparse row representation of the graph,
+     * whose rows are filled in parallel using the executor `ex` (see
+     * @ref executor).  Gathering the rows and their offsets is a
+     * sequential pass over the nodes, the successors are then turned
+     * into indices with a binary search each.
+     */
+    template <typename Executor = thread_executor>
+    IMMER_NODISCARD csr_type to_csr(Executor&& ex = {}) const
+    {
+        return build_csr(nullptr, ex);
+    }
+
+    /*!
+     * Like the other `to_csr()`, but when the graph has the same nodes
+     * as the one that `previous` was built from, the rows of the nodes
+     * whose successors are the same array in both are copied from it.
+     * Thus, after a few edges change in a big graph, most of the work
+     * is copying memory.
+     */
+    template <typename Executor = thread_executor>
+    IMMER_NODISCARD csr_type to_csr(const csr_type& previous,
+                                    Executor&& ex = {}) const
+    {
+        return build_csr(&previous, ex);
+    }
+
+private:
+    void add_node_mut(Node n)
+    {
+        if (!adj_.count(n))
+            adj_ = std::move(adj_).set(n, edges_type{});
+    }
+
+    void add_edge_mut(Node from, Node to)
+    {
+        auto& s = successors(from);
+        auto it = std::lower_bound(s.begin(), s.end(), to);
+        if (it != s.end() && *it == to)
+            return;
+        auto i = static_cast<size_type>(it - s.begin());
+        auto r = s.take(i).push_back(to).append(it, s.end());
+        adj_   = std::move(adj_).set(from, std::move(r));
+        add_node_mut(to);
+        ++edges_;
+    }
+
+    void erase_edge_mut(const Node& from, const Node& to)
+    {
+        auto& s = successors(from);
+        auto it = std::lower_bound(s.begin(), s.end(), to);
+        if (it == s.end() || *it != to)
+            return;
+        auto i = static_cast<size_type>(it - s.begin());
+        auto r = s.take(i).append(it + 1, s.end());
+        adj_   = std::move(adj_).set(from, std::move(r));
+        --edges_;
+    }
+
+    template <typename Executor>
+    csr_type build_csr(const csr_type* previous, Executor& ex) const
+    {
+        auto r    = csr_type{};
+        r.source_ = *this;
+        auto n    = node_count();
+        r.nodes_.reserve(n);
+        r.rows_.reserve(n);
+        r.offsets_.reserve(n + 1);
+        r.offsets_.push_back(0);
+        for (auto& kv : r.source_.adj_) {
+            r.nodes_.push_back(kv.first);
+            r.rows_.push_back(&kv.second);
+            r.offsets_.push_back(r.offsets_.back() + kv.second.size());
+        }
+        r.targets_.resize(edges_);
+
+        // the indices of the successors are only the same when the
+        // nodes are
+        if (previous && previous->nodes_ != r.nodes_)
+            previous = nullptr;
+        auto grain = std::max(detail::bulk_min_elements * n /
+                                  std::max(edges_, size_type{1}),
+                              size_type{1});
+        std::atomic<size_type> reused{0};
+        detail::bulk_ranges(ex, n, grain, [&](size_type first, size_type last) {
+            auto count = size_type{};
+            for (auto i = first; i < last; ++i) {
+                auto& row = *r.rows_[i];
+                auto out  = r.targets_.begin() + r.offsets_[i];
+                if (previous &&
+                    previous->rows_[i]->identity() == row.identity()) {
+                    auto src =
+                        previous->targets_.begin() + previous->offsets_[i];
+                    std::copy(src, src + row.size(), out);
+                    ++count;
+                } else
+                    for (auto& t : row)
+                        *out++ = r.index_of(t);
+            }
+            reused += count;
+        });
+        r.reused_ = reused;
+        return r;
+    }
+
+    adjacency_type adj_;
+    size_type edges_ = 0;
+};
+
+} // namespace immer
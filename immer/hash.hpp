@@ -0,0 +1,215 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/container_hash.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+
+#if IMMER_HAS_CPP17
+#include <string_view>
+#endif
+
+namespace immer {
+
+namespace detail {
+namespace hash {
+
+// the constants and the structure are those of wyhash
+constexpr std::uint64_t secret0 = 0xa0761d6478bd642full;
+constexpr std::uint64_t secret1 = 0xe7037ed1a0b428dbull;
+constexpr std::uint64_t secret2 = 0x8ebc6af09c88c6e3ull;
+constexpr std::uint64_t secret3 = 0x589965cc75374cc3ull;
+
+// multiplies `a` and `b` into a 128 bit number, leaving its low half in
+// `a` and its high half in `b`
+inline void mum(std::uint64_t& a, std::uint64_t& b)
+{
+#if defined(__SIZEOF_INT128__)
+    __extension__ typedef unsigned __int128 u128;
+    auto r = static_cast<u128>(a) * b;
+    a      = static_cast<std::uint64_t>(r);
+    b      = static_cast<std::uint64_t>(r >> 64);
+#else
+    auto ha = a >> 32, hb = b >> 32;
+    auto la = a & 0xffffffffu, lb = b & 0xffffffffu;
+    auto rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    auto t  = rl + (rm0 << 32);
+    auto c  = static_cast<std::uint64_t>(t < rl);
+    auto lo = t + (rm1 << 32);
+    c += lo < t;
+    a = lo;
+    b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+inline std::uint64_t mix(std::uint64_t a, std::uint64_t b)
+{
+    mum(a, b);
+    return a ^ b;
+}
+
+inline std::uint64_t read8(const unsigned char* p)
+{
+    auto r = std::uint64_t{};
+    std::memcpy(&r, p, 8);
+    return r;
+}
+
+inline std::uint64_t read4(const unsigned char* p)
+{
+    auto r = std::uint32_t{};
+    std::memcpy(&r, p, 4);
+    return r;
+}
+
+inline std::uint64_t read3(const unsigned char* p, std::size_t n)
+{
+    return std::uint64_t{p[0]} << 16 | std::uint64_t{p[n >> 1]} << 8 |
+           p[n - 1];
+}
+
+inline std::size_t fold(std::uint64_t h)
+{
+    return sizeof(std::size_t) >= 8 ? static_cast<std::size_t>(h)
+                                    : static_cast<std::size_t>(h ^ (h >> 32));
+}
+
+inline std::size_t bytes(const void* data, std::size_t len)
+{
+    auto p    = static_cast<const unsigned char*>(data);
+    auto seed = secret0 ^ mix(secret0, secret1);
+    auto a = std::uint64_t{}, b = std::uint64_t{};
+    if (IMMER_LIKELY(len <= 16)) {
+        if (len >= 4) {
+            auto k = (len >> 3) << 2;
+            a      = read4(p) << 32 | read4(p + k);
+            b      = read4(p + len - 4) << 32 | read4(p + len - 4 - k);
+        } else if (len > 0) {
+            a = read3(p, len);
+        }
+    } else {
+        auto i = len;
+        if (i > 48) {
+            auto see1 = seed, see2 = seed;
+            do {
+                seed = mix(read8(p) ^ secret1, read8(p + 8) ^ seed);
+                see1 = mix(read8(p + 16) ^ secret2, read8(p + 24) ^ see1);
+                see2 = mix(read8(p + 32) ^ secret3, read8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = mix(read8(p) ^ secret1, read8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = read8(p + i - 16);
+        b = read8(p + i - 8);
+    }
+    a ^= secret1;
+    b ^= seed;
+    mum(a, b);
+    return fold(mix(a ^ secret0 ^ len, b ^ secret1));
+}
+
+inline std::size_t integer(std::uint64_t x)
+{
+    return fold(mix(x ^ secret0, secret1));
+}
+
+} // namespace hash
+} // namespace detail
+
+/*!
+ * Passes the result of the hash function object `Hash` through a
+ * mixing function, such that every bit of the output depends on every
+ * bit of the input.  The ``map``, ``set`` and ``table`` containers
+ * take the lowest bits of the hash first, thus a hash whose low bits
+ * are poor, like the identity that many standard libraries use for
+ * integers or a hash of aligned pointers, makes deep tries and
+ * collision nodes unless it is mixed.
+ */
+template <typename Hash>
+struct mixed_hash : Hash
+{
+    template <typename T>
+    std::size_t operator()(const T& x) const
+    {
+        return detail::hash::integer(Hash::operator()(x));
+    }
+};
+
+/*!
+ * Fast and well distributed hash function object for the keys of the
+ * ``map``, ``set`` and ``table`` containers.  Strings are hashed with
+ * the algorithm of *wyhash*, which reads them 16 or 48 bytes at a time,
+ * and integers, enumerations and pointers with its mixing function.
+ * The other types are hashed with `std::hash` and then mixed, as with
+ * @ref mixed_hash.
+ *
+ * The hashes are not the same on every platform, thus they should not
+ * be persisted.  The containers use it by default when
+ * ``IMMER_USE_DEFAULT_HASH`` is defined to ``1``, see @ref
+ * container_hash.
+ */
+template <typename T, typename Enable>
+struct default_hash : mixed_hash<std::hash<T>>
+{};
+
+template <typename T>
+struct default_hash<T,
+                    std::enable_if_t<std::is_integral<T>::value ||
+                                     std::is_enum<T>::value>>
+{
+    std::size_t operator()(T x) const
+    {
+        return detail::hash::integer(static_cast<std::uint64_t>(x));
+    }
+};
+
+template <typename T>
+struct default_hash<T*>
+{
+    std::size_t operator()(const T* x) const
+    {
+        return detail::hash::integer(reinterpret_cast<std::uintptr_t>(x));
+    }
+};
+
+template <typename Char, typename Traits, typename Alloc>
+struct default_hash<std::basic_string<Char, Traits, Alloc>>
+{
+    std::size_t
+    operator()(const std::basic_string<Char, Traits, Alloc>& x) const
+    {
+        return detail::hash::bytes(x.data(), x.size() * sizeof(Char));
+    }
+};
+
+#if IMMER_HAS_CPP17
+template <typename Char, typename Traits>
+struct default_hash<std::basic_string_view<Char, Traits>>
+{
+    std::size_t operator()(std::basic_string_view<Char, Traits> x) const
+    {
+        return detail::hash::bytes(x.data(), x.size() * sizeof(Char));
+    }
+};
+#endif
+
+} // namespace immer
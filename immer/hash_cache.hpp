@@ -0,0 +1,40 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+namespace immer {
+
+/*!
+ * Wraps the hash function object `Hash` so that the ``map``, ``set``
+ * and ``table`` containers that use it store the full hash of every
+ * element next to it in their nodes.
+ *
+ * Lookups then compare the stored hash before calling the equality
+ * function on a candidate element, and the hashes of the existing
+ * elements are not computed again when they are moved down the tree
+ * by an insertion or up by a removal.  This pays off when the keys are
+ * expensive to hash or to compare, like long strings, at the cost of
+ * one `std::size_t` of memory per element.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    using map_t = immer::map<std::string, int,
+ *                             immer::hash_cache<std::hash<std::string>>>;
+ *
+ * @endrst
+ */
+template <typename Hash>
+struct hash_cache : Hash
+{
+    static constexpr bool cache_hashes = true;
+};
+
+} // namespace immer
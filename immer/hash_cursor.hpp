@@ -0,0 +1,129 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace immer {
+
+/*!
+ * A position in a ``map`` or a ``set``, as returned by their
+ * `resume()` member, to go on with a traversal later without keeping
+ * an iterator, and thus a version, alive.  It is just the hash of the
+ * last element that was visited, so it can be stored or sent anywhere,
+ * and used with any later version of the container.
+ *
+ * @rst
+ *
+ * The elements are visited in the order of their hashes as read by the
+ * trie, starting from its lowest bits.  Hence, when resuming on a
+ * different version, every element that was there at the start, is
+ * still there and has not been visited is visited exactly once.
+ * Elements that were added are visited only when they come after the
+ * position.  The elements that share their whole hash with others are
+ * counted, and removing one of them can make the next one be skipped.
+ *
+ * @endrst
+ */
+struct hash_cursor
+{
+    //! The hash of the last element that was visited.
+    std::uint64_t hash = 0;
+    //! The number of elements with that `hash` that were visited, which
+    //! is `0` at the beginning.
+    std::uint32_t count = 0;
+    //! Whether all the elements were visited.
+    bool end = false;
+
+    /*!
+     * Returns the cursor as a string of 24 hexadecimal digits.
+     */
+    std::string encode() const
+    {
+        static const char digits[] = "0123456789abcdef";
+        auto r                     = std::string(24, '0');
+        auto c = end ? std::numeric_limits<std::uint32_t>::max() : count;
+        for (auto i = 0; i < 16; ++i)
+            r[15 - i] = digits[(hash >> (4 * i)) & 15];
+        for (auto i = 0; i < 8; ++i)
+            r[23 - i] = digits[(c >> (4 * i)) & 15];
+        return r;
+    }
+
+    /*!
+     * Returns the cursor encoded in `s` by `encode()`.  It throws
+     * `std::invalid_argument` when `s` is not such a string.
+     */
+    static hash_cursor decode(const std::string& s)
+    {
+        auto digit = [](char c) -> std::uint64_t {
+            if (c >= '0' && c <= '9')
+                return static_cast<std::uint64_t>(c - '0');
+            if (c >= 'a' && c <= 'f')
+                return static_cast<std::uint64_t>(c - 'a' + 10);
+            IMMER_THROW(std::invalid_argument{"invalid cursor"});
+        };
+        if (s.size() != 24)
+            IMMER_THROW(std::invalid_argument{"invalid cursor"});
+        auto r = hash_cursor{};
+        auto c = std::uint64_t{};
+        for (auto i = 0; i < 16; ++i)
+            r.hash = (r.hash << 4) | digit(s[i]);
+        for (auto i = 16; i < 24; ++i)
+            c = (c << 4) | digit(s[i]);
+        r.end   = c == std::numeric_limits<std::uint32_t>::max();
+        r.count = r.end ? 0 : static_cast<std::uint32_t>(c);
+        return r;
+    }
+
+    bool operator==(const hash_cursor& other) const
+    {
+        return hash == other.hash && count == other.count && end == other.end;
+    }
+
+    bool operator!=(const hash_cursor& other) const
+    {
+        return !(*this == other);
+    }
+};
+
+namespace detail {
+namespace hamts {
+
+// Calls `fn` with the next `n` values of the champ `impl` after the
+// position `c`, and returns the position after them.
+template <typename Champ, typename Fn>
+hash_cursor resume(const Champ& impl, hash_cursor c, std::size_t n, Fn&& fn)
+{
+    if (c.end || n == 0)
+        return c;
+    auto all = impl.for_each_after(c.hash, c.count, [&](auto& v, auto h) {
+        fn(v);
+        if (c.count && c.hash == h)
+            ++c.count;
+        else {
+            c.hash  = h;
+            c.count = 1;
+        }
+        return --n != 0;
+    });
+    c.end = all;
+    return c;
+}
+
+} // namespace hamts
+} // namespace detail
+
+} // namespace immer
@@ -0,0 +1,347 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/heap/free_list_node.hpp>
+#include <immer/trace.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <mutex>
+
+namespace immer {
+
+/*!
+ * Parameters that drive the size of the free lists of every @ref
+ * adaptive_free_list_heap.  They can be changed at any time with
+ * `set_adaptive_free_list_config()`, and every free list picks them up
+ * at the end of its current window.
+ */
+struct adaptive_free_list_config
+{
+    //! Number of objects that a free list can always keep, and that
+    //! its limit goes back to when it is trimmed.
+    std::size_t min_limit = 0;
+    //! Maximum number of objects that a free list can keep.
+    std::size_t max_limit = 8 * default_free_list_size;
+    //! Number of allocations after which a free list adapts its limit.
+    std::size_t window = 256;
+    //! Fraction of the allocations of a window that missed the free
+    //! list above which its limit grows.
+    double grow_miss_rate = 0.05;
+};
+
+/*!
+ * Counters of one @ref adaptive_free_list_heap, or the sum of all of
+ * them.
+ */
+struct adaptive_free_list_stats
+{
+    //! Allocations served from the free list.
+    std::size_t hits = 0;
+    //! Allocations that went to the parent heap.
+    std::size_t misses = 0;
+    //! Objects returned to the parent heap by shrinking or trimming.
+    std::size_t released = 0;
+    //! Objects in the free list.
+    std::size_t count = 0;
+    //! Maximum number of objects that the free list keeps now.
+    std::size_t limit = 0;
+};
+
+namespace detail {
+
+struct adaptive_free_list_entry
+{
+    void (*trim)();
+    adaptive_free_list_stats (*stats)();
+    adaptive_free_list_entry* next;
+};
+
+inline std::atomic<adaptive_free_list_entry*>& adaptive_free_lists()
+{
+    static std::atomic<adaptive_free_list_entry*> lists_{nullptr};
+    return lists_;
+}
+
+inline void register_adaptive_free_list(adaptive_free_list_entry& e)
+{
+    auto& lists = adaptive_free_lists();
+    e.next      = lists.load(std::memory_order_relaxed);
+    while (!lists.compare_exchange_weak(
+        e.next, &e, std::memory_order_release, std::memory_order_relaxed))
+        ;
+}
+
+struct adaptive_free_list_settings
+{
+    std::mutex mutex;
+    adaptive_free_list_config config;
+
+    static adaptive_free_list_settings& get()
+    {
+        static adaptive_free_list_settings settings_;
+        return settings_;
+    }
+
+    static adaptive_free_list_config load()
+    {
+        auto& s = get();
+        std::lock_guard<std::mutex> lock{s.mutex};
+        return s.config;
+    }
+};
+
+} // namespace detail
+
+/*!
+ * Changes the parameters of all the @ref adaptive_free_list_heap.
+ */
+inline void set_adaptive_free_list_config(const adaptive_free_list_config& c)
+{
+    assert(c.min_limit <= c.max_limit && c.window > 0);
+    auto& s = detail::adaptive_free_list_settings::get();
+    std::lock_guard<std::mutex> lock{s.mutex};
+    s.config = c;
+}
+
+/*!
+ * Returns the parameters of the @ref adaptive_free_list_heap.
+ */
+inline adaptive_free_list_config adaptive_free_list_config_now()
+{
+    return detail::adaptive_free_list_settings::load();
+}
+
+/*!
+ * Returns every object of every @ref adaptive_free_list_heap that has
+ * been used to its parent heap, and sets their limits back to
+ * `min_limit`.  This is meant to be called when the program is idle or
+ * from a memory pressure callback, like a handler of low memory
+ * notifications of the operating system.
+ */
+inline void trim_adaptive_free_lists()
+{
+    auto& lists = detail::adaptive_free_lists();
+    for (auto e = lists.load(std::memory_order_acquire); e; e = e->next)
+        e->trim();
+}
+
+/*!
+ * Returns the counters of all the @ref adaptive_free_list_heap that
+ * have been used, added up.
+ */
+inline adaptive_free_list_stats adaptive_free_lists_stats()
+{
+    auto r      = adaptive_free_list_stats{};
+    auto& lists = detail::adaptive_free_lists();
+    for (auto e = lists.load(std::memory_order_acquire); e; e = e->next) {
+        auto s = e->stats();
+        r.hits += s.hits;
+        r.misses += s.misses;
+        r.released += s.released;
+        r.count += s.count;
+        r.limit += s.limit;
+    }
+    return r;
+}
+
+/*!
+ * Adaptor that keeps the memory in a thread-safe global free list,
+ * like @ref free_list_heap, but whose limit is chosen at run-time from
+ * the allocations that it sees.  Must be preceded by a
+ * `with_free_list_node<...>` heap adaptor.
+ *
+ * Every `window` allocations, see @ref adaptive_free_list_config, the
+ * free list adapts its limit:
+ *
+ * - When more than `grow_miss_rate` of the allocations of the window
+ *   missed the free list, its limit is doubled, or increased by the
+ *   number of misses if that is more, up to `max_limit`.
+ *
+ * - Otherwise, the objects that stayed in the free list during the
+ *   whole window were not needed: they are returned to `Base` and the
+ *   limit is lowered by as many, down to `min_limit`.
+ *
+ * Thus, a burst of allocations grows the free list and it shrinks back
+ * once the burst is over.  Since shrinking needs allocations to
+ * happen, an idle program should call `trim()`, or
+ * `trim_adaptive_free_lists()` for all the sizes, to give the memory
+ * back.
+ *
+ * The free list is protected by a mutex.  It is best put behind a
+ * @ref thread_local_free_list_heap, which only takes or gives objects
+ * from it when its own list is empty or full, as the @ref
+ * adaptive_free_list_heap_policy does.
+ *
+ * @tparam Size Maximum size of the objects to be allocated.
+ * @tparam Base Type of the parent heap.
+ */
+template <std::size_t Size, typename Base>
+struct adaptive_free_list_heap : Base
+{
+    using base_t = Base;
+
+    template <typename... Tags>
+    static void* allocate(std::size_t size, Tags...)
+    {
+        assert(size <= sizeof(free_list_node) + Size);
+        assert(size >= sizeof(free_list_node));
+
+        auto& s       = state();
+        auto n        = static_cast<free_list_node*>(nullptr);
+        auto released = static_cast<free_list_node*>(nullptr);
+        {
+            std::lock_guard<std::mutex> lock{s.mutex};
+            n = s.data;
+            if (n) {
+                s.data = n->next;
+                s.low  = std::min(s.low, --s.count);
+                ++s.hits;
+            } else {
+                ++s.misses;
+                ++s.window_misses;
+            }
+            if (++s.window_allocations >= s.config.window)
+                released = adapt(s);
+        }
+        release(released);
+        if (!n) {
+            IMMER_TRACE_HOOK(free_list_miss, Size);
+            return base_t::allocate(Size + sizeof(free_list_node));
+        }
+        return n;
+    }
+
+    template <typename... Tags>
+    static void deallocate(std::size_t size, void* data, Tags...)
+    {
+        assert(size <= sizeof(free_list_node) + Size);
+        assert(size >= sizeof(free_list_node));
+
+        auto& s = state();
+        {
+            std::lock_guard<std::mutex> lock{s.mutex};
+            if (s.count < s.limit) {
+                auto n  = static_cast<free_list_node*>(data);
+                n->next = s.data;
+                s.data  = n;
+                ++s.count;
+                return;
+            }
+        }
+        base_t::deallocate(Size + sizeof(free_list_node), data);
+    }
+
+    /*!
+     * Returns all the objects in the free list to `Base` and sets its
+     * limit back to `min_limit`.
+     */
+    static void trim()
+    {
+        auto& s  = state();
+        auto all = static_cast<free_list_node*>(nullptr);
+        {
+            std::lock_guard<std::mutex> lock{s.mutex};
+            all = s.data;
+            s.released += s.count;
+            s.data  = nullptr;
+            s.count = 0;
+            s.low   = 0;
+            s.limit = s.config.min_limit;
+        }
+        release(all);
+    }
+
+    /*!
+     * Returns the counters of this free list.
+     */
+    static adaptive_free_list_stats stats()
+    {
+        auto& s = state();
+        std::lock_guard<std::mutex> lock{s.mutex};
+        auto r     = adaptive_free_list_stats{};
+        r.hits     = s.hits;
+        r.misses   = s.misses;
+        r.released = s.released;
+        r.count    = s.count;
+        r.limit    = s.limit;
+        return r;
+    }
+
+private:
+    struct state_t
+    {
+        std::mutex mutex;
+        adaptive_free_list_config config =
+            detail::adaptive_free_list_settings::load();
+        free_list_node* data           = nullptr;
+        std::size_t count              = 0;
+        std::size_t limit              = config.min_limit;
+        std::size_t low                = 0;
+        std::size_t window_allocations = 0;
+        std::size_t window_misses      = 0;
+        std::size_t hits               = 0;
+        std::size_t misses             = 0;
+        std::size_t released           = 0;
+        detail::adaptive_free_list_entry entry{&trim, &stats, nullptr};
+
+        state_t() { detail::register_adaptive_free_list(entry); }
+    };
+
+    static state_t& state()
+    {
+        static state_t state_;
+        return state_;
+    }
+
+    // Adapts the limit at the end of a window, and returns the objects
+    // that must be released.  The configuration is reloaded, so that
+    // changes to it take effect in the next window.
+    static free_list_node* adapt(state_t& s)
+    {
+        auto r  = static_cast<free_list_node*>(nullptr);
+        auto& c = s.config;
+        if (s.window_misses > c.grow_miss_rate * s.window_allocations) {
+            s.limit = std::max(2 * s.limit, s.limit + s.window_misses);
+        } else if (s.low) {
+            auto keep = std::min(s.count, c.min_limit);
+            auto n    = std::min(s.low, s.count - keep);
+            s.limit -= std::min(s.limit, s.low);
+            s.count -= n;
+            s.released += n;
+            for (; n; --n) {
+                auto next    = s.data->next;
+                s.data->next = r;
+                r            = s.data;
+                s.data       = next;
+            }
+        }
+        c       = detail::adaptive_free_list_settings::load();
+        s.limit = std::min(std::max(s.limit, c.min_limit), c.max_limit);
+        s.low                = s.count;
+        s.window_allocations = 0;
+        s.window_misses      = 0;
+        return r;
+    }
+
+    static void release(free_list_node* n)
+    {
+        while (n) {
+            auto next = n->next;
+            base_t::deallocate(Size + sizeof(free_list_node), n);
+            n = next;
+        }
+    }
+};
+
+} // namespace immer
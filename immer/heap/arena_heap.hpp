@@ -0,0 +1,126 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/heap/with_data.hpp>
+
+#include <cstddef>
+#include <new>
+
+namespace immer {
+
+namespace detail {
+
+struct alignas(std::max_align_t) arena_block
+{
+    void* arena = nullptr;
+};
+
+} // namespace detail
+
+/*!
+ * Adaptor that can also allocate objects from *arenas*, which take big
+ * chunks of memory from `Base` and hand them out by bumping a pointer.
+ * The objects allocated from an arena are not released one by one:
+ * `deallocate()` ignores them and they are all released together by
+ * `discard_arena()`.  Every object is preceded by a header that tells
+ * whether it belongs to an arena.
+ *
+ * It is meant to be used with @ref arena_transience_policy, that
+ * creates an arena per transient, or with @ref repack.
+ *
+ * @tparam Base      Type of the parent heap.
+ * @tparam ChunkSize Size of the chunks that the arenas take from
+ *                   `Base`.  Objects bigger than a quarter of it are
+ *                   allocated directly from `Base` instead.
+ */
+template <typename Base, std::size_t ChunkSize = 64 * 1024>
+struct arena_heap : with_data<detail::arena_block, Base>
+{
+    using base_t = with_data<detail::arena_block, Base>;
+
+    template <typename... Tags>
+    static void deallocate(std::size_t size, void* data, Tags... tags)
+    {
+        auto h = static_cast<detail::arena_block*>(data) - 1;
+        if (!h->arena)
+            base_t::deallocate(size, data, tags...);
+    }
+
+    /*!
+     * Returns a new empty arena.  The arena itself is allocated from
+     * `Base` and never released explicitly.
+     */
+    static void* make_arena()
+    {
+        return new (Base::allocate(sizeof(arena))) arena{};
+    }
+
+    /*!
+     * Allocates an object of `size` bytes from the arena `a`.
+     */
+    template <typename... Tags>
+    static void* allocate_in(void* a, std::size_t size, Tags... tags)
+    {
+        constexpr auto align = alignof(std::max_align_t);
+        auto total = sizeof(detail::arena_block) + (size + align - 1) /
+                                                       align * align;
+        if (total > ChunkSize / 4)
+            return base_t::allocate(size, tags...);
+        auto& ar = *static_cast<arena*>(a);
+        if (static_cast<std::size_t>(ar.end - ar.next) < total) {
+            auto c = static_cast<char*>(Base::allocate(ChunkSize));
+            *reinterpret_cast<void**>(c) = ar.chunks;
+            ar.chunks = c;
+            ar.next   = c + sizeof(detail::arena_block);
+            ar.end    = c + ChunkSize;
+        }
+        auto h = new (ar.next) detail::arena_block{a};
+        ar.next += total;
+        return h + 1;
+    }
+
+    /*!
+     * Releases all the memory that the objects of the arena `a` use at
+     * once.  The arena stays valid, and empty.
+     */
+    static void discard_arena(void* a)
+    {
+        auto& ar = *static_cast<arena*>(a);
+        while (ar.chunks) {
+            auto c    = ar.chunks;
+            ar.chunks = *static_cast<void**>(c);
+            Base::deallocate(ChunkSize, c);
+        }
+        ar.next = ar.end = nullptr;
+    }
+
+    /*!
+     * Discards the arena `a` and releases the arena itself, that must
+     * not be used anymore.
+     */
+    static void release_arena(void* a)
+    {
+        discard_arena(a);
+        static_cast<arena*>(a)->~arena();
+        Base::deallocate(sizeof(arena), a);
+    }
+
+private:
+    // every chunk starts with a pointer to the previous one
+    struct arena
+    {
+        void* chunks = nullptr;
+        char* next   = nullptr;
+        char* end    = nullptr;
+    };
+};
+
+} // namespace immer
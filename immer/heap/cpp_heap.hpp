@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include <immer/config.hpp>
+
 #include <cstddef>
 #include <memory>
 
@@ -31,11 +33,18 @@ struct cpp_heap
     /*!
      * Releases a memory region `data` that was previously returned by
      * `allocate`.  One must not use nor deallocate again a memory
-     * region that once it has been deallocated.
+     * region that once it has been deallocated.  The `size` must be
+     * the one passed to `allocate`, and it is forwarded to the sized
+     * `operator delete` when `IMMER_HAS_SIZED_DEALLOCATION` is set.
      */
-    static void deallocate(std::size_t, void* data)
+    static void deallocate(std::size_t size, void* data)
     {
+#if IMMER_HAS_SIZED_DEALLOCATION
+        ::operator delete(data, size);
+#else
+        (void) size;
         ::operator delete(data);
+#endif
     }
 };
 
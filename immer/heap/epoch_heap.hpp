@@ -0,0 +1,293 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/heap/cpp_heap.hpp>
+#include <immer/heap/heap_policy.hpp>
+#include <immer/lock/no_lock_policy.hpp>
+#include <immer/memory_policy.hpp>
+#include <immer/refcount/unsafe_refcount_policy.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace immer {
+
+namespace detail {
+
+/*!
+ * Process wide state of the epoch based reclamation scheme described
+ * by Keir Fraser in "Practical lock-freedom".
+ *
+ * Threads *pin* the current epoch while they read shared data.  Memory
+ * that is released is tagged with the epoch at that moment and only
+ * really freed once the global epoch has advanced twice past it, which
+ * requires every pinned thread to have seen the newer epochs.
+ */
+class epoch_domain
+{
+public:
+    using release_fn = void (*)(std::size_t, void*);
+
+    struct record
+    {
+        // pinned epoch shifted left by one, or'ed with 1 while pinned
+        std::atomic<std::uint64_t> state{0};
+        std::atomic<bool> used{false};
+        record* next = nullptr;
+        // keeps the records of different threads in different cache lines
+        char padding[64];
+    };
+
+    struct retired
+    {
+        void* ptr;
+        std::size_t size;
+        release_fn release;
+        std::uint64_t epoch;
+    };
+
+    struct local_state
+    {
+        record* rec;
+        unsigned depth = 0;
+        std::vector<retired> garbage;
+
+        local_state(epoch_domain& d)
+            : rec{d.acquire()}
+        {}
+
+        ~local_state()
+        {
+            global().orphan(std::move(garbage));
+            rec->state.store(0, std::memory_order_release);
+            rec->used.store(false, std::memory_order_release);
+        }
+    };
+
+    // the domain is never destroyed, so that memory can still be
+    // released from destructors that run at exit
+    static epoch_domain& global()
+    {
+        static auto domain_ = new epoch_domain;
+        return *domain_;
+    }
+
+    static local_state& local()
+    {
+        thread_local local_state local_{global()};
+        return local_;
+    }
+
+    void pin(local_state& l)
+    {
+        if (l.depth++ == 0) {
+            auto e = epoch_.load(std::memory_order_seq_cst);
+            l.rec->state.store((e << 1) | 1, std::memory_order_seq_cst);
+        }
+    }
+
+    void unpin(local_state& l)
+    {
+        if (--l.depth == 0)
+            l.rec->state.store(0, std::memory_order_release);
+    }
+
+    void retire(local_state& l, void* p, std::size_t size, release_fn release)
+    {
+        l.garbage.push_back(
+            {p, size, release, epoch_.load(std::memory_order_seq_cst)});
+        if (l.garbage.size() >= collect_threshold)
+            collect(l);
+    }
+
+    /*!
+     * Tries to advance the epoch and frees the memory retired by the
+     * calling thread, or by threads that already finished, that no
+     * pinned thread can still be reading.
+     */
+    void collect(local_state& l)
+    {
+        advance();
+        auto e = epoch_.load(std::memory_order_seq_cst);
+        free_expired(l.garbage, e);
+        std::unique_lock<std::mutex> lock{orphans_mutex_, std::try_to_lock};
+        if (lock.owns_lock())
+            free_expired(orphans_, e);
+    }
+
+private:
+    static constexpr std::size_t collect_threshold = 256;
+
+    record* acquire()
+    {
+        for (auto r = records_.load(std::memory_order_acquire); r; r = r->next)
+            if (!r->used.load(std::memory_order_relaxed) &&
+                !r->used.exchange(true, std::memory_order_acquire))
+                return r;
+        auto r = new record{};
+        r->used.store(true, std::memory_order_relaxed);
+        r->next = records_.load(std::memory_order_relaxed);
+        while (!records_.compare_exchange_weak(
+            r->next, r, std::memory_order_release, std::memory_order_relaxed))
+            ;
+        return r;
+    }
+
+    // the epoch can only move on when every pinned thread has seen it
+    void advance()
+    {
+        auto e = epoch_.load(std::memory_order_seq_cst);
+        auto r = records_.load(std::memory_order_acquire);
+        for (; r; r = r->next) {
+            auto s = r->state.load(std::memory_order_seq_cst);
+            if ((s & 1) && (s >> 1) != e)
+                return;
+        }
+        epoch_.compare_exchange_strong(e, e + 1, std::memory_order_seq_cst);
+    }
+
+    static void free_expired(std::vector<retired>& garbage, std::uint64_t e)
+    {
+        auto kept = garbage.begin();
+        for (auto& g : garbage) {
+            if (g.epoch + 2 <= e)
+                g.release(g.size, g.ptr);
+            else
+                *kept++ = g;
+        }
+        garbage.erase(kept, garbage.end());
+    }
+
+    void orphan(std::vector<retired> garbage)
+    {
+        std::lock_guard<std::mutex> lock{orphans_mutex_};
+        orphans_.insert(orphans_.end(), garbage.begin(), garbage.end());
+    }
+
+    std::atomic<std::uint64_t> epoch_{0};
+    std::atomic<record*> records_{nullptr};
+    std::mutex orphans_mutex_;
+    std::vector<retired> orphans_;
+};
+
+} // namespace detail
+
+/*!
+ * Pins the current epoch of the `epoch_heap` during its lifetime.
+ * Memory that is released by other threads while the guard is alive
+ * is not freed until after it is destroyed, so the thread can safely
+ * read shared data allocated with an `epoch_heap`.  Guards can be
+ * nested.
+ */
+class epoch_guard
+{
+public:
+    epoch_guard()
+        : local_{detail::epoch_domain::local()}
+    {
+        detail::epoch_domain::global().pin(local_);
+    }
+
+    epoch_guard(const epoch_guard&) = delete;
+    epoch_guard& operator=(const epoch_guard&) = delete;
+
+    ~epoch_guard() { detail::epoch_domain::global().unpin(local_); }
+
+private:
+    detail::epoch_domain::local_state& local_;
+};
+
+/*!
+ * A heap that allocates from `Base`, but that defers releasing the
+ * memory until no thread holding an `epoch_guard` could be reading it.
+ * The memory is released to `Base` by the thread that deallocated it,
+ * in batches, or by a later thread when the former finished.
+ */
+template <typename Base>
+struct epoch_heap
+{
+    template <typename... Tags>
+    static void* allocate(std::size_t size, Tags... tags)
+    {
+        return Base::allocate(size, tags...);
+    }
+
+    template <typename... Tags>
+    static void deallocate(std::size_t size, void* data, Tags...)
+    {
+        auto& domain = detail::epoch_domain::global();
+        domain.retire(
+            detail::epoch_domain::local(), data, size, &release<Tags...>);
+    }
+
+    /*!
+     * Frees the memory deallocated by the calling thread that is not
+     * being read any more, without waiting for a batch to fill.
+     */
+    static void collect()
+    {
+        detail::epoch_domain::global().collect(detail::epoch_domain::local());
+    }
+
+private:
+    template <typename... Tags>
+    static void release(std::size_t size, void* data)
+    {
+        Base::deallocate(size, data, Tags{}...);
+    }
+};
+
+/*!
+ * Memory policy for read mostly data shared by many threads, that
+ * avoids atomic reference counting.
+ *
+ * It combines non atomic reference counting with an `epoch_heap`.
+ * Every operation that copies, changes or destroys containers using
+ * this policy must happen in one writer thread at a time.  Other
+ * threads may read a published container through a `const` reference,
+ * without copying it, while they hold an `epoch_guard`.  The memory of
+ * the versions that the writer drops is only reused once those
+ * readers are done.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    using vector_t = immer::vector<int, immer::epoch_memory_policy>;
+ *    using box_t    = immer::box<vector_t, immer::epoch_memory_policy>;
+ *
+ *    std::atomic<const vector_t*> current;
+ *
+ *    // writer thread
+ *    auto latest = box_t{};
+ *    latest      = latest.update([](auto v) { return v.push_back(42); });
+ *    current.store(&latest.get());
+ *
+ *    // reader threads
+ *    immer::epoch_guard guard;
+ *    auto sum = immer::accumulate(*current.load(), 0);
+ *
+ * .. warning:: The elements are destroyed as soon as the writer drops
+ *    them, only their memory is kept.  Use element types that are
+ *    trivially destructible, or whose destructors only release
+ *    memory allocated with this same policy.
+ *
+ * @endrst
+ */
+using epoch_memory_policy = memory_policy<heap_policy<epoch_heap<cpp_heap>>,
+                                          unsafe_refcount_policy,
+                                          no_lock_policy>;
+
+} // namespace immer
@@ -10,6 +10,7 @@
 
 #include <immer/heap/free_list_node.hpp>
 #include <immer/heap/with_data.hpp>
+#include <immer/trace.hpp>
 
 #include <atomic>
 #include <cassert>
@@ -40,6 +41,7 @@ struct free_list_heap : Base
         do {
             n = head().data;
             if (!n) {
+                IMMER_TRACE_HOOK(free_list_miss, Size);
                 auto p = base_t::allocate(Size + sizeof(free_list_node));
                 return static_cast<free_list_node*>(p);
             }
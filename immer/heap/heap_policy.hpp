@@ -9,10 +9,12 @@
 #pragma once
 
 #include <immer/config.hpp>
+#include <immer/heap/adaptive_free_list_heap.hpp>
 #include <immer/heap/debug_size_heap.hpp>
 #include <immer/heap/free_list_heap.hpp>
 #include <immer/heap/split_heap.hpp>
 #include <immer/heap/thread_local_free_list_heap.hpp>
+#include <immer/heap/unsafe_free_list_heap.hpp>
 
 #include <algorithm>
 #include <cstdlib>
@@ -106,13 +108,15 @@ struct free_list_heap_policy
     template <std::size_t Size>
     struct optimized
     {
-        using type =
-            split_heap<Size,
-                       with_free_list_node<thread_local_free_list_heap<
-                           Size,
-                           Limit,
-                           free_list_heap<Size, Limit, debug_size_heap<Heap>>>>,
-                       debug_size_heap<Heap>>;
+        using type = split_heap<
+            Size,
+            with_free_list_node<thread_local_free_list_heap<
+                Size,
+                Limit,
+                free_list_heap<Size + detail::thread_local_free_list_header,
+                               Limit,
+                               debug_size_heap<Heap>>>>,
+            debug_size_heap<Heap>>;
     };
 };
 
@@ -137,4 +141,35 @@ struct unsafe_free_list_heap_policy
     };
 };
 
+/*!
+ * Similar to @ref free_list_heap_policy, but the global free list is
+ * an @ref adaptive_free_list_heap, whose limit grows when allocations
+ * miss it and shrinks back when its objects are not used, instead of
+ * being fixed at compile-time.  The `thread_local` free lists in front
+ * of it keep at most `LocalLimit` objects each.
+ *
+ * @tparam Heap       Heap to be used when the free list is empty.
+ * @tparam LocalLimit Maximum number of objects in the free list of
+ *                    every thread.
+ */
+template <typename Heap, std::size_t LocalLimit = default_free_list_size / 16>
+struct adaptive_free_list_heap_policy
+{
+    using type = debug_size_heap<Heap>;
+
+    template <std::size_t Size>
+    struct optimized
+    {
+        using type = split_heap<
+            Size,
+            with_free_list_node<thread_local_free_list_heap<
+                Size,
+                LocalLimit,
+                adaptive_free_list_heap<
+                    Size + detail::thread_local_free_list_header,
+                    debug_size_heap<Heap>>>>,
+            debug_size_heap<Heap>>;
+    };
+};
+
 } // namespace immer
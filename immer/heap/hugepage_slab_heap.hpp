@@ -0,0 +1,175 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/heap/free_list_node.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace immer {
+
+namespace detail {
+
+/*!
+ * Maps `size` bytes, a multiple of `page`, backed by huge pages when
+ * possible.  It first tries explicitly reserved huge pages and
+ * otherwise asks for transparent huge pages on a region aligned to
+ * `page`.
+ */
+inline void* map_huge_pages(std::size_t size, std::size_t page)
+{
+#if defined(__linux__)
+    constexpr auto prot = PROT_READ | PROT_WRITE;
+    constexpr auto anon = MAP_PRIVATE | MAP_ANONYMOUS;
+#if defined(MAP_HUGETLB)
+    auto flags = anon | MAP_HUGETLB;
+#if defined(MAP_HUGE_2MB) && defined(MAP_HUGE_1GB)
+    flags |= page >= (std::size_t{1} << 30) ? MAP_HUGE_1GB : MAP_HUGE_2MB;
+#endif
+    auto p = mmap(nullptr, size, prot, flags, -1, 0);
+    if (p != MAP_FAILED)
+        return p;
+#endif
+    // transparent huge pages are only used for aligned ranges, so we
+    // map a bit more and trim the ends
+    auto q = mmap(nullptr, size + page, prot, anon, -1, 0);
+    if (IMMER_UNLIKELY(q == MAP_FAILED))
+        IMMER_THROW(std::bad_alloc{});
+    auto b     = static_cast<char*>(q);
+    auto start = reinterpret_cast<std::uintptr_t>(b);
+    auto a     = b + (page - start % page) % page;
+    if (a != b)
+        munmap(b, a - b);
+    munmap(a + size, b + page - a);
+#if defined(MADV_HUGEPAGE)
+    madvise(a, size, MADV_HUGEPAGE);
+#endif
+    return a;
+#else
+    auto p = std::malloc(size);
+    if (IMMER_UNLIKELY(!p))
+        IMMER_THROW(std::bad_alloc{});
+    return p;
+#endif
+}
+
+inline void unmap_huge_pages(void* p, std::size_t size)
+{
+#if defined(__linux__)
+    munmap(p, size);
+#else
+    std::free(p);
+#endif
+}
+
+} // namespace detail
+
+/*!
+ * A heap that carves the objects out of slabs of `PageSize` bytes
+ * backed by huge pages, so that traversing big containers needs fewer
+ * TLB entries.  On Linux, slabs are mapped with `MAP_HUGETLB` when the
+ * system has huge pages reserved, and otherwise ``madvise`` asks for
+ * transparent huge pages.  On other systems it falls back to
+ * `std::malloc`.
+ *
+ * It is meant to be the `Base` of pooling heaps, like @ref
+ * free_list_heap or @ref size_class_heap, which take memory from it
+ * in the slow path.  Thus it uses a mutex.  Objects bigger than a
+ * quarter of a slab get their own mapping, that is released by
+ * `deallocate()`.  Smaller ones are kept in a free list for their size
+ * and reused, and the slabs are never returned to the system.
+ *
+ * @tparam PageSize Size of the huge pages, usually 2MB or 1GB.
+ */
+template <std::size_t PageSize = std::size_t{2} << 20>
+struct hugepage_slab_heap
+{
+    template <typename... Tags>
+    static void* allocate(std::size_t size, Tags...)
+    {
+        size = round_up(size, alignof(std::max_align_t));
+        if (size > PageSize / 4)
+            return detail::map_huge_pages(round_up(size, PageSize), PageSize);
+        auto& s = state();
+        std::lock_guard<std::mutex> lock{s.mutex};
+        auto& list = free_list(s, size);
+        if (list) {
+            auto n = list;
+            list   = n->next;
+            return n;
+        }
+        if (static_cast<std::size_t>(s.end - s.next) < size) {
+            s.next = static_cast<char*>(
+                detail::map_huge_pages(PageSize, PageSize));
+            s.end = s.next + PageSize;
+        }
+        auto p = s.next;
+        s.next += size;
+        return p;
+    }
+
+    template <typename... Tags>
+    static void deallocate(std::size_t size, void* data, Tags...)
+    {
+        size = round_up(size, alignof(std::max_align_t));
+        if (size > PageSize / 4)
+            return detail::unmap_huge_pages(data, round_up(size, PageSize));
+        auto& s = state();
+        std::lock_guard<std::mutex> lock{s.mutex};
+        auto& list = free_list(s, size);
+        auto n     = static_cast<free_list_node*>(data);
+        n->next    = list;
+        list       = n;
+    }
+
+private:
+    struct state_t
+    {
+        std::mutex mutex;
+        char* next = nullptr;
+        char* end  = nullptr;
+        // pooling heaps use a few different sizes only
+        std::vector<std::pair<std::size_t, free_list_node*>> lists;
+    };
+
+    static std::size_t round_up(std::size_t size, std::size_t align)
+    {
+        return (size + align - 1) / align * align;
+    }
+
+    static free_list_node*& free_list(state_t& s, std::size_t size)
+    {
+        for (auto& l : s.lists)
+            if (l.first == size)
+                return l.second;
+        s.lists.emplace_back(size, nullptr);
+        return s.lists.back().second;
+    }
+
+    // the state is never destroyed, so that memory can still be
+    // released from destructors that run at exit
+    static state_t& state()
+    {
+        static auto state_ = new state_t;
+        return *state_;
+    }
+};
+
+} // namespace immer
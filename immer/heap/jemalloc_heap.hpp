@@ -0,0 +1,66 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+
+#if IMMER_HAS_JEMALLOC
+#include <jemalloc/jemalloc.h>
+#else
+#error "Using jemalloc_heap requires jemalloc"
+#endif
+
+#include <cstddef>
+#include <exception>
+#include <new>
+
+namespace immer {
+
+/*!
+ * A heap that uses the non standard API of `jemalloc`_, so that the
+ * size of the objects is passed to `sdallocx` when they are released
+ * and the allocator does not need to look it up.
+ *
+ * @rst
+ *
+ * .. warning:: Every object must be deallocated with the same size
+ *    that was used to allocate it, as all the containers in this
+ *    library do.
+ *
+ * .. _jemalloc: https://jemalloc.net
+ *
+ * @endrst
+ */
+struct jemalloc_heap
+{
+    /*!
+     * Returns a pointer to a memory region of size `size`, if the
+     * allocation was successful and throws `std::bad_alloc` otherwise.
+     */
+    template <typename... Tags>
+    static void* allocate(std::size_t size, Tags...)
+    {
+        auto p = mallocx(size, 0);
+        if (IMMER_UNLIKELY(!p))
+            IMMER_THROW(std::bad_alloc{});
+        return p;
+    }
+
+    /*!
+     * Releases a memory region `data` of size `size` that was
+     * previously returned by `allocate`.
+     */
+    template <typename... Tags>
+    static void deallocate(std::size_t size, void* data, Tags...)
+    {
+        sdallocx(data, size, 0);
+    }
+};
+
+} // namespace immer
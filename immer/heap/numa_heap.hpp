@@ -0,0 +1,228 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/heap/debug_size_heap.hpp>
+#include <immer/heap/split_heap.hpp>
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <new>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace immer {
+
+namespace detail {
+
+struct numa_thread_state
+{
+    // node set by a `numa_node_guard`, or -1
+    long forced        = -1;
+    unsigned node      = 0;
+    unsigned countdown = 0;
+};
+
+inline numa_thread_state& numa_state()
+{
+    thread_local numa_thread_state state_;
+    return state_;
+}
+
+inline unsigned query_numa_node()
+{
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+        return node;
+#endif
+    return 0;
+}
+
+// the node of the calling thread is only queried once in a while, since
+// the scheduler seldom moves threads across nodes
+inline unsigned current_numa_node()
+{
+    constexpr auto refresh = 256u;
+    auto& s                = numa_state();
+    if (s.forced >= 0)
+        return static_cast<unsigned>(s.forced);
+    if (s.countdown == 0) {
+        s.node      = query_numa_node();
+        s.countdown = refresh;
+    }
+    --s.countdown;
+    return s.node;
+}
+
+struct numa_block
+{
+    numa_block* next;
+    std::size_t node;
+};
+
+} // namespace detail
+
+/*!
+ * Makes the `numa_heap` allocations of the current thread use the pool
+ * of the NUMA node `node` during its lifetime, instead of the pool of
+ * the node the thread runs on.  Guards can be nested.
+ */
+class numa_node_guard
+{
+public:
+    explicit numa_node_guard(unsigned node)
+        : previous_{detail::numa_state().forced}
+    {
+        detail::numa_state().forced = node;
+    }
+
+    numa_node_guard(const numa_node_guard&) = delete;
+    numa_node_guard& operator=(const numa_node_guard&) = delete;
+
+    ~numa_node_guard() { detail::numa_state().forced = previous_; }
+
+private:
+    long previous_;
+};
+
+/*!
+ * Adaptor that, like @ref free_list_heap, keeps the released memory in
+ * thread-safe global free lists instead of returning it to the parent
+ * heap, but it keeps one free list per NUMA node.  Objects are taken
+ * from the free list of the node where the calling thread runs, and
+ * every object remembers that node in a header so that `deallocate()`
+ * puts it back in the same free list, no matter which thread releases
+ * it.  Thus, the memory cached for a node is only reused on that node.
+ *
+ * New memory is taken from `Base`.  With the default first touch
+ * policy of operating systems like Linux, fresh pages are placed on the
+ * node of the thread that first writes them, which is the allocating
+ * thread.  `Base` can also be a heap that explicitly binds the memory
+ * to the current node.
+ *
+ * @tparam Size  Maximum size of the objects to be allocated.
+ * @tparam Limit Maximum number of elements to keep in every free list.
+ * @tparam Base  Type of the parent heap.
+ * @tparam Nodes Number of NUMA nodes with a free list.  Threads running
+ *               on other nodes share the lists modulo this number.
+ */
+template <std::size_t Size,
+          std::size_t Limit,
+          typename Base,
+          std::size_t Nodes = 8>
+struct numa_heap : Base
+{
+    using base_t = Base;
+
+    template <typename... Tags>
+    static void* allocate(std::size_t size, Tags...)
+    {
+        assert(size <= Size);
+
+        auto node = detail::current_numa_node() % Nodes;
+        auto& h   = head(node);
+        detail::numa_block* n;
+        do {
+            n = h.data;
+            if (!n) {
+                auto p = base_t::allocate(Size + sizeof(detail::numa_block));
+                return new (p) detail::numa_block{nullptr, node} + 1;
+            }
+        } while (!h.data.compare_exchange_weak(n, n->next));
+        h.count.fetch_sub(1u, std::memory_order_relaxed);
+        return n + 1;
+    }
+
+    template <typename... Tags>
+    static void deallocate(std::size_t size, void* data, Tags...)
+    {
+        assert(size <= Size);
+
+        auto n  = static_cast<detail::numa_block*>(data) - 1;
+        auto& h = head(n->node);
+        // we use relaxed, because we are fine with temporarily having
+        // a few more/less buffers in free list
+        if (h.count.load(std::memory_order_relaxed) >= Limit) {
+            base_t::deallocate(Size + sizeof(detail::numa_block), n);
+        } else {
+            do {
+                n->next = h.data;
+            } while (!h.data.compare_exchange_weak(n->next, n));
+            h.count.fetch_add(1u, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    struct head_t
+    {
+        std::atomic<detail::numa_block*> data;
+        std::atomic<std::size_t> count;
+        // keeps the lists of different nodes in different cache lines
+        char padding[64];
+    };
+
+    static head_t& head(std::size_t node)
+    {
+        static head_t heads_[Nodes];
+        return heads_[node];
+    }
+};
+
+/*!
+ * Heap policy that, like @ref free_list_heap_policy, uses free lists
+ * for the nodes of the containers, but keeps them per NUMA node using
+ * a @ref numa_heap.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    using memory = immer::memory_policy<
+ *        immer::numa_heap_policy<immer::cpp_heap>,
+ *        immer::default_refcount_policy,
+ *        immer::default_lock_policy>;
+ *
+ * @endrst
+ */
+template <typename Heap, std::size_t Limit = default_free_list_size>
+struct numa_heap_policy
+{
+    using type = debug_size_heap<Heap>;
+
+    template <std::size_t Size>
+    struct optimized
+    {
+        using type = split_heap<Size,
+                                numa_heap<Size, Limit, debug_size_heap<Heap>>,
+                                debug_size_heap<Heap>>;
+    };
+};
+
+/*!
+ * Returns a copy of the container `c` that does not share any node
+ * with it, allocating its nodes as if the current thread was running on
+ * the NUMA node `node`.  When the container uses a @ref
+ * numa_heap_policy, this builds a replica that is local to the threads of
+ * that node.  To also get fresh memory placed on that node, call it
+ * from a thread running there.
+ */
+template <typename Container>
+Container numa_clone(const Container& c, unsigned node)
+{
+    numa_node_guard guard{node};
+    return Container(c.begin(), c.end());
+}
+
+} // namespace immer
@@ -0,0 +1,153 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+
+#if IMMER_HAS_CPP17
+
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <utility>
+
+namespace immer {
+
+namespace detail {
+
+struct alignas(std::max_align_t) pmr_block
+{
+    std::pmr::memory_resource* resource;
+};
+
+template <typename Tag>
+std::pmr::memory_resource*& pmr_current()
+{
+    thread_local std::pmr::memory_resource* r = nullptr;
+    return r;
+}
+
+} // namespace detail
+
+/*!
+ * A heap that allocates from a `std::pmr::memory_resource`, the
+ * *current* one of the thread, that a @ref pmr_scope sets, or the
+ * default resource of the process when none does.  Every object is
+ * preceded by a header with the resource it was taken from, where it
+ * is given back, whatever thread releases it and whatever resource is
+ * current then.  Every `Tag` has a separate current resource.
+ *
+ * Thus, the containers made while serving a request can take their
+ * nodes from an arena, like a `std::pmr::monotonic_buffer_resource`,
+ * that is released at once when the request is done.  It is meant to
+ * be used with @ref pmr_transience_policy, so that the transients keep
+ * allocating from the resource that was current when they were made.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    using memory = immer::memory_policy<immer::heap_policy<immer::pmr_heap<>>,
+ *                                        immer::refcount_policy,
+ *                                        immer::default_lock_policy,
+ *                                        immer::pmr_transience_policy>;
+ *
+ *    auto arena = std::pmr::monotonic_buffer_resource{};
+ *    {
+ *        auto scope = immer::pmr_scope<>{&arena};
+ *        auto v     = immer::vector<int, memory>{}.push_back(42);
+ *        ...
+ *    }
+ *
+ * .. warning:: The containers must not outlive the resources their
+ *    nodes were taken from.  Other heaps must not be put on top of this
+ *    one, like the free lists of @ref free_list_heap_policy, since they
+ *    would hand out the nodes of a resource in the scope of another.
+ *
+ * .. note:: Only available in C++17.
+ *
+ * @endrst
+ */
+template <typename Tag = void>
+struct pmr_heap
+{
+    /*!
+     * Returns the resource that the thread allocates from.
+     */
+    static std::pmr::memory_resource* current()
+    {
+        auto r = detail::pmr_current<Tag>();
+        return r ? r : std::pmr::get_default_resource();
+    }
+
+    /*!
+     * Makes `r` the resource that the thread allocates from, or the
+     * default resource when it is null, and returns the one that was
+     * set before.  @ref pmr_scope is usually more convenient.
+     */
+    static std::pmr::memory_resource*
+    set_current(std::pmr::memory_resource* r) noexcept
+    {
+        return std::exchange(detail::pmr_current<Tag>(), r);
+    }
+
+    template <typename... Tags>
+    static void* allocate(std::size_t size, Tags... tags)
+    {
+        return allocate_in(current(), size, tags...);
+    }
+
+    /*!
+     * Allocates an object of `size` bytes from the resource `r`.
+     */
+    template <typename... Tags>
+    static void* allocate_in(std::pmr::memory_resource* r,
+                             std::size_t size,
+                             Tags...)
+    {
+        auto p = r->allocate(sizeof(detail::pmr_block) + size,
+                             alignof(detail::pmr_block));
+        return new (p) detail::pmr_block{r} + 1;
+    }
+
+    template <typename... Tags>
+    static void deallocate(std::size_t size, void* data, Tags...)
+    {
+        auto h = static_cast<detail::pmr_block*>(data) - 1;
+        h->resource->deallocate(h,
+                                sizeof(detail::pmr_block) + size,
+                                alignof(detail::pmr_block));
+    }
+};
+
+/*!
+ * Makes a resource the current one of a @ref pmr_heap in the calling
+ * thread, during the lifetime of the scope, after which the previous
+ * one is restored.  Scopes may be nested.
+ */
+template <typename Tag = void>
+class pmr_scope
+{
+public:
+    explicit pmr_scope(std::pmr::memory_resource* r) noexcept
+        : previous_{pmr_heap<Tag>::set_current(r)}
+    {}
+
+    pmr_scope(const pmr_scope&)            = delete;
+    pmr_scope& operator=(const pmr_scope&) = delete;
+
+    ~pmr_scope() { pmr_heap<Tag>::set_current(previous_); }
+
+private:
+    std::pmr::memory_resource* previous_;
+};
+
+} // namespace immer
+
+#endif // IMMER_HAS_CPP17
@@ -0,0 +1,344 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/memory_stats.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace immer {
+
+namespace detail {
+namespace region {
+
+struct alignas(std::max_align_t) header
+{
+    std::size_t size;    // of the block after the header, rounded up
+    std::uint64_t cycle; // last cycle that found it alive, 0 when free
+};
+
+constexpr auto align = alignof(std::max_align_t);
+
+inline std::size_t round(std::size_t size)
+{
+    return (std::max(size, std::size_t{1}) + align - 1) / align * align;
+}
+
+struct chunk
+{
+    char* data;
+    std::size_t size;
+    std::size_t used;
+};
+
+struct state;
+
+// Marks the blocks of the heap that the visitor reaches, with the
+// interface of a set for `usage::visitor`.  The pointers that are not
+// in the heap, like those of the empty nodes in static storage, are
+// reported as seen.
+struct marker
+{
+    state* s;
+
+    struct result
+    {
+        bool second;
+    };
+
+    result insert(const void* p);
+};
+
+struct root
+{
+    std::function<void(usage::visitor<marker>&)> trace;
+};
+
+// The state of the heap.  There is one per `Tag`.
+struct state
+{
+    std::mutex mutex;
+    std::vector<chunk> chunks; // sorted by address
+    std::size_t current = 0;   // index of the chunk that is bumped
+    std::unordered_map<std::size_t, std::vector<header*>> free;
+    std::map<std::size_t, root> roots;
+    std::size_t next_root = 0;
+
+    std::uint64_t cycle = 1;
+    bool collecting     = false;
+    std::vector<root> snapshot;
+    std::size_t next_trace = 0;
+    std::size_t next_sweep = 0;
+    std::size_t freed      = 0;
+
+    ~state()
+    {
+        for (auto& c : chunks)
+            std::free(c.data);
+    }
+
+    chunk* find_chunk(const void* p)
+    {
+        auto c   = static_cast<const char*>(p);
+        auto it  = std::upper_bound(
+            chunks.begin(), chunks.end(), c, [](const char* x, auto& ch) {
+                return x < ch.data;
+            });
+        if (it == chunks.begin())
+            return nullptr;
+        --it;
+        return c < it->data + it->used ? &*it : nullptr;
+    }
+
+    // the blocks bigger than a quarter of a chunk get one of their own
+    header* new_block(std::size_t size, std::size_t chunk_size)
+    {
+        auto total = sizeof(header) + size;
+        if (total > chunk_size / 4)
+            return init(add_chunk(total, false), size);
+        auto ch = current < chunks.size() ? &chunks[current] : nullptr;
+        if (!ch || ch->size - ch->used < total)
+            ch = add_chunk(chunk_size, true);
+        return init(ch, size);
+    }
+
+    chunk* add_chunk(std::size_t bytes, bool bump)
+    {
+        auto data = static_cast<char*>(std::malloc(bytes));
+        if (!data)
+            IMMER_THROW(std::bad_alloc{});
+        auto c   = chunk{data, bytes, 0};
+        auto it  = std::upper_bound(
+            chunks.begin(), chunks.end(), c, [](auto& x, auto& y) {
+                return x.data < y.data;
+            });
+        auto pos = static_cast<std::size_t>(it - chunks.begin());
+        chunks.insert(it, c);
+        if (bump)
+            current = pos;
+        else if (pos <= current && current + 1 < chunks.size())
+            ++current;
+        return &chunks[pos];
+    }
+
+    static header* init(chunk* ch, std::size_t size)
+    {
+        auto h = reinterpret_cast<header*>(ch->data + ch->used);
+        ch->used += sizeof(header) + size;
+        h->size = size;
+        return h;
+    }
+};
+
+template <typename Tag>
+state& get_state()
+{
+    static state s;
+    return s;
+}
+
+inline marker::result marker::insert(const void* p)
+{
+    if (!s->find_chunk(p))
+        return {false};
+    auto h = static_cast<header*>(const_cast<void*>(p)) - 1;
+    if (h->cycle == s->cycle)
+        return {false};
+    h->cycle = s->cycle;
+    return {true};
+}
+
+} // namespace region
+} // namespace detail
+
+/*!
+ * Heap with a collector of its own, that frees the nodes that the
+ * registered roots do not reach.  Unlike @ref gc_heap, it does not
+ * scan the whole process: it traces only the containers that are
+ * registered with @ref add_root, following their nodes by their type,
+ * thus it never looks inside the leaves or at the elements.  The work
+ * can be split in steps with @ref collect_step, to bound the pauses.
+ *
+ * The nodes are allocated in chunks of `ChunkSize` bytes, taken with
+ * `std::malloc`, after a header that holds their size and the last
+ * collection that found them alive.  The blocks that a collection frees
+ * are reused for allocations of the same size, the chunks are not
+ * returned.  Every `Tag` has a separate heap, with its own roots.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    using heap   = immer::region_heap<>;
+ *    using memory = immer::memory_policy<immer::heap_policy<heap>,
+ *                                        immer::no_refcount_policy,
+ *                                        immer::default_lock_policy,
+ *                                        immer::gc_transience_policy,
+ *                                        false>;
+ *
+ *    auto v  = immer::vector<int, memory>{}.push_back(42);
+ *    auto id = heap::add_root(v);
+ *    ...
+ *    while (!heap::collect_step(16))
+ *        serve_requests();
+ *
+ * .. warning:: Only the nodes reached from the roots survive a
+ *    collection, so every container of the heap that is alive when a
+ *    collection starts must be registered, and so must be those made
+ *    from containers that are not.  Containers made during a
+ *    collection from registered ones may wait until the next one.
+ *    Transients are not traced, thus none may be alive when a
+ *    collection starts.  The elements must not hold nodes of the heap,
+ *    as nested containers would.
+ *
+ * .. note:: Only ``vector``, ``flex_vector``, ``map``, ``set`` and
+ *    ``table`` can be registered, the containers that @ref memory_stats
+ *    knows.  The heap locks a mutex on every allocation, and the steps
+ *    of a collection must not run along with the other operations of
+ *    the containers of the heap in other threads.
+ *
+ * @endrst
+ */
+template <typename Tag = void, std::size_t ChunkSize = 1 << 20>
+struct region_heap
+{
+    template <typename... Tags>
+    static void* allocate(std::size_t size, Tags...)
+    {
+        auto& s    = state();
+        std::lock_guard<std::mutex> lock{s.mutex};
+        size       = detail::region::round(size);
+        auto h     = static_cast<detail::region::header*>(nullptr);
+        auto it    = s.free.find(size);
+        if (it != s.free.end() && !it->second.empty()) {
+            h = it->second.back();
+            it->second.pop_back();
+        } else {
+            h = s.new_block(size, ChunkSize);
+        }
+        // allocated black, the collection in progress keeps it
+        h->cycle = s.cycle;
+        return h + 1;
+    }
+
+    template <typename... Tags>
+    static void deallocate(std::size_t, void* data, Tags...)
+    {
+        auto& s    = state();
+        std::lock_guard<std::mutex> lock{s.mutex};
+        release(s, static_cast<detail::region::header*>(data) - 1);
+    }
+
+    /*!
+     * Registers the container `c` as a root, that keeps alive the nodes
+     * that it reaches until @ref remove_root is called with the
+     * returned id.  The container is copied, which does not copy its
+     * nodes.
+     */
+    template <typename Container>
+    static std::size_t add_root(Container c)
+    {
+        auto& s    = state();
+        std::lock_guard<std::mutex> lock{s.mutex};
+        auto id    = s.next_root++;
+        s.roots[id].trace = [c](auto& v) { v.add(c.impl()); };
+        return id;
+    }
+
+    static void remove_root(std::size_t id)
+    {
+        auto& s    = state();
+        std::lock_guard<std::mutex> lock{s.mutex};
+        s.roots.erase(id);
+    }
+
+    /*!
+     * Does a part of a collection, tracing up to `budget` roots or
+     * sweeping up to `budget` chunks, and starts one when none is in
+     * progress.  Returns whether the collection is complete.
+     */
+    static bool collect_step(std::size_t budget)
+    {
+        auto& s    = state();
+        std::lock_guard<std::mutex> lock{s.mutex};
+        if (!s.collecting) {
+            ++s.cycle;
+            s.collecting = true;
+            s.snapshot.clear();
+            for (auto& r : s.roots)
+                s.snapshot.push_back(r.second);
+            s.next_trace = 0;
+            s.next_sweep = 0;
+            s.freed      = 0;
+        }
+        for (; budget && s.next_trace < s.snapshot.size(); --budget) {
+            auto usage   = memory_usage{};
+            auto m       = detail::region::marker{&s};
+            auto visitor = detail::usage::visitor<detail::region::marker>{
+                usage, &m};
+            s.snapshot[s.next_trace++].trace(visitor);
+        }
+        for (; budget && s.next_sweep < s.chunks.size(); --budget)
+            sweep(s, s.chunks[s.next_sweep++]);
+        if (s.next_trace < s.snapshot.size() ||
+            s.next_sweep < s.chunks.size())
+            return false;
+        s.collecting = false;
+        s.snapshot.clear();
+        return true;
+    }
+
+    /*!
+     * Completes the collection in progress, or does a whole new one.
+     * Returns the bytes that it freed, including the headers.
+     */
+    static std::size_t collect()
+    {
+        while (!collect_step(std::size_t(-1)))
+            continue;
+        return state().freed;
+    }
+
+private:
+    static detail::region::state& state()
+    {
+        return detail::region::get_state<region_heap>();
+    }
+
+    static void release(detail::region::state& s, detail::region::header* h)
+    {
+        h->cycle = 0;
+        s.free[h->size].push_back(h);
+        s.freed += sizeof(detail::region::header) + h->size;
+    }
+
+    static void sweep(detail::region::state& s, detail::region::chunk& c)
+    {
+        for (auto p = c.data; p < c.data + c.used;) {
+            auto h = reinterpret_cast<detail::region::header*>(p);
+            p += sizeof(detail::region::header) + h->size;
+            if (h->cycle && h->cycle != s.cycle)
+                release(s, h);
+        }
+    }
+};
+
+} // namespace immer
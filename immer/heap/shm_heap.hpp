@@ -0,0 +1,485 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/heap/heap_policy.hpp>
+#include <immer/lock/spinlock_policy.hpp>
+#include <immer/memory_policy.hpp>
+#include <immer/refcount/refcount_policy.hpp>
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#if !defined(__unix__) && !defined(__APPLE__)
+#error "immer/heap/shm_heap.hpp requires POSIX shared memory"
+#endif
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace immer {
+
+/*!
+ * Address at which a @ref shm_segment is mapped by default in every
+ * process.  It is far away from where systems usually place the heap,
+ * the shared libraries and the images.
+ */
+constexpr std::uintptr_t default_shm_base =
+    sizeof(std::uintptr_t) >= 8
+        ? static_cast<std::uintptr_t>(std::uint64_t{3} << 44)
+        : std::uintptr_t{3} << 29;
+
+/*!
+ * Exception thrown when a shared memory segment can not be used, like
+ * when it is not one or it can not be mapped where it must be.
+ */
+class shm_error : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+namespace detail {
+namespace shm {
+
+static_assert(ATOMIC_BOOL_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "the atomics in a segment must work across processes");
+
+constexpr char magic[8] = {'i', 'm', 'm', 'e', 'r', 's', 'h', '1'};
+
+constexpr std::size_t granule      = alignof(std::max_align_t);
+constexpr std::size_t size_classes = 64;
+constexpr std::size_t root_slots   = 16;
+
+// the one of the standard library may not be lock-free, which it must
+// be when other processes can hold it
+struct spinlock
+{
+    std::atomic<bool> locked;
+
+    void lock()
+    {
+        while (locked.exchange(true, std::memory_order_acquire))
+            while (locked.load(std::memory_order_relaxed)) {}
+    }
+
+    void unlock() { locked.store(false, std::memory_order_release); }
+};
+
+struct guard
+{
+    spinlock& lock;
+
+    guard(spinlock& l)
+        : lock{l}
+    {
+        lock.lock();
+    }
+
+    ~guard() { lock.unlock(); }
+};
+
+// a freed block that does not fit in a size class
+struct large_block
+{
+    std::uint64_t next;
+    std::uint64_t size;
+};
+
+// offsets are relative to the start of the segment, 0 means none
+struct header_t
+{
+    char magic[8];
+    std::uint64_t base;
+    std::uint64_t size;
+    spinlock heap_lock;
+    std::uint64_t next;
+    std::uint64_t free[size_classes];
+    std::uint64_t large;
+    spinlock roots_lock;
+    std::uint64_t roots[root_slots];
+};
+
+constexpr std::size_t header_size =
+    (sizeof(header_t) + granule - 1) / granule * granule;
+
+inline header_t*& current()
+{
+    static header_t* segment = nullptr;
+    return segment;
+}
+
+inline char* at(header_t* h, std::uint64_t offset)
+{
+    return reinterpret_cast<char*>(h) + offset;
+}
+
+inline std::uint64_t offset_of(header_t* h, const void* p)
+{
+    return static_cast<std::uint64_t>(static_cast<const char*>(p) -
+                                      reinterpret_cast<const char*>(h));
+}
+
+} // namespace shm
+} // namespace detail
+
+/*!
+ * A heap that allocates from the @ref shm_segment attached to the
+ * process.  It is **thread-safe** and work across processes, which may
+ * free the objects allocated by the others.  The blocks are recycled
+ * in lists of blocks of the same size, kept in the segment.
+ *
+ * @rst
+ *
+ * .. warning:: Allocating with no segment attached throws
+ *    `std::bad_alloc`.  The empty containers share a node that is
+ *    allocated the first time one is created, thus a process can not
+ *    use containers with this heap before attaching a segment, nor
+ *    after detaching it.
+ *
+ * @endrst
+ */
+struct shm_heap
+{
+    template <typename... Tags>
+    static void* allocate(std::size_t size, Tags...)
+    {
+        using namespace detail::shm;
+        auto h = current();
+        if (IMMER_UNLIKELY(!h))
+            IMMER_THROW(std::bad_alloc{});
+        auto bytes = round(size);
+        auto cls   = bytes / granule;
+        guard g{h->heap_lock};
+        if (cls < size_classes) {
+            if (auto off = h->free[cls]) {
+                std::memcpy(&h->free[cls], at(h, off), sizeof(off));
+                return at(h, off);
+            }
+        } else {
+            for (auto link = &h->large; *link;) {
+                auto b = reinterpret_cast<large_block*>(at(h, *link));
+                if (b->size == bytes) {
+                    auto off = *link;
+                    *link    = b->next;
+                    return at(h, off);
+                }
+                link = &b->next;
+            }
+        }
+        if (IMMER_UNLIKELY(h->size - h->next < bytes))
+            IMMER_THROW(std::bad_alloc{});
+        auto off = h->next;
+        h->next += bytes;
+        return at(h, off);
+    }
+
+    static void deallocate(std::size_t size, void* data)
+    {
+        using namespace detail::shm;
+        auto h     = current();
+        auto bytes = round(size);
+        auto off   = offset_of(h, data);
+        auto cls   = bytes / granule;
+        guard g{h->heap_lock};
+        if (cls < size_classes) {
+            std::memcpy(data, &h->free[cls], sizeof(off));
+            h->free[cls] = off;
+        } else {
+            auto b   = static_cast<large_block*>(data);
+            b->next  = h->large;
+            b->size  = bytes;
+            h->large = off;
+        }
+    }
+
+private:
+    static std::size_t round(std::size_t size)
+    {
+        using detail::shm::granule;
+        auto n = (size + granule - 1) / granule * granule;
+        return n < sizeof(detail::shm::large_block)
+                   ? sizeof(detail::shm::large_block)
+                   : n;
+    }
+};
+
+/*!
+ * Memory policy for the containers whose nodes live in a @ref
+ * shm_segment.  The reference counts are atomic, so that any process
+ * can copy and release them.
+ */
+using shm_memory_policy =
+    memory_policy<heap_policy<shm_heap>, refcount_policy, spinlock_policy>;
+
+/*!
+ * A POSIX shared memory object that processes map at the same address,
+ * so that the containers using @ref shm_memory_policy can be shared
+ * among them.  One process publishes a version of a container in one of
+ * the slots of the segment and the others load it, getting a copy that
+ * shares all its nodes with it.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    using map_t = immer::map<int, int, std::hash<int>,
+ *                             std::equal_to<int>,
+ *                             immer::shm_memory_policy>;
+ *
+ *    // in the publisher
+ *    auto segment = immer::shm_segment::create("/config", 1 << 30);
+ *    segment.publish(map_t{}.set(1, 2));
+ *
+ *    // in the readers
+ *    auto segment = immer::shm_segment::open("/config");
+ *    auto config  = segment.load<map_t>();
+ *
+ * .. note:: The nodes hold plain pointers, thus all processes must map
+ *    the segment at the same address and opening it fails when that
+ *    address is taken.  The processes must run the same program, so
+ *    that the values and their hashes agree, and the values can not
+ *    own memory outside of the segment, like a ``std::string`` does.
+ *
+ * .. note:: Every process maps the segment for writing, since copying a
+ *    container updates the reference counts that are kept in its nodes.
+ *    A process that dies while holding one of the locks of the segment
+ *    blocks the others.
+ *
+ * @endrst
+ */
+class shm_segment
+{
+public:
+    /*!
+     * Creates a segment of `size` bytes named `name`, that must not
+     * exist, mapped at `base`, and attaches it to the process.  Throws
+     * `std::system_error` when it can not be created and @ref shm_error
+     * when it can not be mapped at `base`.
+     */
+    static shm_segment create(const std::string& name,
+                              std::size_t size,
+                              std::uintptr_t base = default_shm_base)
+    {
+        using namespace detail::shm;
+        if (IMMER_UNLIKELY(size < header_size))
+            IMMER_THROW(shm_error{"shared memory segment too small"});
+        check_detached();
+        auto fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (IMMER_UNLIKELY(fd < 0))
+            IMMER_THROW(std::system_error(
+                errno, std::generic_category(), "creating " + name));
+        if (IMMER_UNLIKELY(::ftruncate(fd, static_cast<off_t>(size)) != 0)) {
+            auto error = errno;
+            ::close(fd);
+            ::shm_unlink(name.c_str());
+            IMMER_THROW(std::system_error(
+                error, std::generic_category(), "resizing " + name));
+        }
+        auto result = shm_segment{};
+        IMMER_TRY {
+            result.map(fd, name, size, base);
+        }
+        IMMER_CATCH (...) {
+            ::shm_unlink(name.c_str());
+            IMMER_RETHROW;
+        }
+        auto h = result.header_;
+        new (h) header_t{};
+        h->base = base;
+        h->size = size;
+        h->next = header_size;
+        std::memcpy(h->magic, magic, sizeof(magic));
+        result.attach();
+        return result;
+    }
+
+    /*!
+     * Maps the existing segment named `name` at the address where it
+     * was created, and attaches it to the process.  Throws
+     * `std::system_error` when it can not be opened and @ref shm_error
+     * when it is not a segment or it can not be mapped where it must.
+     */
+    static shm_segment open(const std::string& name)
+    {
+        using namespace detail::shm;
+        check_detached();
+        auto fd = ::shm_open(name.c_str(), O_RDWR, 0);
+        if (IMMER_UNLIKELY(fd < 0))
+            IMMER_THROW(std::system_error(
+                errno, std::generic_category(), "opening " + name));
+        header_t h{};
+        struct stat st;
+        if (IMMER_UNLIKELY(::fstat(fd, &st) != 0 ||
+                           ::pread(fd, &h, sizeof(h), 0) != sizeof(h) ||
+                           std::memcmp(h.magic, magic, sizeof(magic)) != 0 ||
+                           h.size != static_cast<std::uint64_t>(st.st_size))) {
+            ::close(fd);
+            IMMER_THROW(shm_error{"not a shared memory segment: " + name});
+        }
+        auto result = shm_segment{};
+        result.map(fd,
+                   name,
+                   static_cast<std::size_t>(h.size),
+                   static_cast<std::uintptr_t>(h.base));
+        result.attach();
+        return result;
+    }
+
+    /*!
+     * Removes the name of the segment `name`.  The processes that have
+     * it mapped can keep using it.
+     */
+    static void remove(const std::string& name)
+    {
+        ::shm_unlink(name.c_str());
+    }
+
+    shm_segment(shm_segment&& other)
+        : header_{other.header_}
+        , size_{other.size_}
+    {
+        other.header_ = nullptr;
+    }
+
+    shm_segment(const shm_segment&)            = delete;
+    shm_segment& operator=(const shm_segment&) = delete;
+    shm_segment& operator=(shm_segment&&)      = delete;
+
+    /*!
+     * Detaches and unmaps the segment.  All the containers that use it
+     * must be destroyed before.
+     */
+    ~shm_segment()
+    {
+        if (header_) {
+            if (detail::shm::current() == header_)
+                detail::shm::current() = nullptr;
+            ::munmap(header_, size_);
+        }
+    }
+
+    /*!
+     * Returns the size of the segment in bytes.
+     */
+    std::size_t size() const { return size_; }
+
+    /*!
+     * Returns the number of bytes that have ever been taken from the
+     * segment, including the ones that were freed and can be reused.
+     */
+    std::size_t used() const
+    {
+        detail::shm::guard g{header_->heap_lock};
+        return static_cast<std::size_t>(header_->next);
+    }
+
+    /*!
+     * Publishes a copy of `c` in the slot `slot`, replacing the one
+     * there.  The container must use @ref shm_memory_policy.
+     */
+    template <typename Container>
+    void publish(const Container& c, std::size_t slot = 0)
+    {
+        using namespace detail::shm;
+        check_slot(slot);
+        auto p   = new (shm_heap::allocate(sizeof(Container))) Container{c};
+        auto old = std::uint64_t{};
+        {
+            guard g{header_->roots_lock};
+            old = header_->roots[slot];
+            header_->roots[slot] = offset_of(header_, p);
+        }
+        // the readers copy the container while holding the lock, so
+        // they are done with the old one
+        if (old) {
+            auto q = reinterpret_cast<Container*>(at(header_, old));
+            q->~Container();
+            shm_heap::deallocate(sizeof(Container), q);
+        }
+    }
+
+    /*!
+     * Returns the container published in the slot `slot`, of the same
+     * type that it was published with.  Throws @ref shm_error when
+     * nothing was published there.
+     */
+    template <typename Container>
+    Container load(std::size_t slot = 0) const
+    {
+        using namespace detail::shm;
+        check_slot(slot);
+        guard g{header_->roots_lock};
+        auto off = header_->roots[slot];
+        if (IMMER_UNLIKELY(!off))
+            IMMER_THROW(shm_error{"nothing published in the slot"});
+        return *reinterpret_cast<const Container*>(at(header_, off));
+    }
+
+private:
+    shm_segment() = default;
+
+    static void check_slot(std::size_t slot)
+    {
+        if (IMMER_UNLIKELY(slot >= detail::shm::root_slots))
+            IMMER_THROW(std::out_of_range{"no such shared memory slot"});
+    }
+
+    void map(int fd, const std::string& name, std::size_t size,
+             std::uintptr_t base)
+    {
+        auto flags = MAP_SHARED;
+#ifdef MAP_FIXED_NOREPLACE
+        flags |= MAP_FIXED_NOREPLACE;
+#endif
+        auto p     = ::mmap(reinterpret_cast<void*>(base),
+                            size,
+                            PROT_READ | PROT_WRITE,
+                            flags,
+                            fd,
+                            0);
+        auto error = errno;
+        ::close(fd);
+        if (IMMER_UNLIKELY(p == MAP_FAILED && error != EEXIST))
+            IMMER_THROW(std::system_error(
+                error, std::generic_category(), "mapping " + name));
+        if (IMMER_UNLIKELY(p != reinterpret_cast<void*>(base))) {
+            if (p != MAP_FAILED)
+                ::munmap(p, size);
+            IMMER_THROW(shm_error{"can not map the segment at its base: " +
+                                  name});
+        }
+        header_ = static_cast<detail::shm::header_t*>(p);
+        size_   = size;
+    }
+
+    static void check_detached()
+    {
+        if (IMMER_UNLIKELY(detail::shm::current()))
+            IMMER_THROW(shm_error{"a shared memory segment is attached"});
+    }
+
+    void attach() { detail::shm::current() = header_; }
+
+    detail::shm::header_t* header_ = nullptr;
+    std::size_t size_              = 0;
+};
+
+} // namespace immer
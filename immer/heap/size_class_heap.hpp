@@ -0,0 +1,204 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/heap/free_list_node.hpp>
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+
+namespace immer {
+
+/*!
+ * Adaptor that pools all the allocations of up to `MaxSize` bytes,
+ * rounding their size up to a multiple of `Granularity`.  Every
+ * thread keeps a free list per size class, which is refilled from a
+ * global free list for that class or otherwise carved from a slab of
+ * `SlabSize` bytes taken from `Base`.  Bigger allocations go directly
+ * to `Base`.
+ *
+ * Unlike @ref free_list_heap, which only recycles objects of one
+ * size, this heap serves the nodes of varying sizes that ``map``,
+ * ``set``, ``table`` and the relaxed nodes of ``flex_vector`` use.
+ * Since it works for any size it can be used through a @ref
+ * heap_policy, which uses it for all the nodes:
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    using memory = immer::memory_policy<
+ *        immer::heap_policy<immer::size_class_heap<immer::cpp_heap>>,
+ *        immer::default_refcount_policy,
+ *        immer::default_lock_policy>;
+ *
+ * @endrst
+ *
+ * When a thread finishes, or when one of its free lists holds more
+ * than `Limit` objects, the objects are moved to the global free list
+ * of their class.  The slabs are never returned to `Base`.
+ *
+ * @tparam Base        Type of the parent heap.
+ * @tparam MaxSize     Maximum size of the pooled objects.
+ * @tparam Granularity Difference between the sizes of two classes.  It
+ *                     must be a multiple of `alignof(std::max_align_t)`.
+ * @tparam SlabSize    Size of the chunks taken from `Base`.
+ * @tparam Limit       Maximum number of objects in every free list of
+ *                     a thread.
+ */
+template <typename Base,
+          std::size_t MaxSize     = 1024,
+          std::size_t Granularity = 16,
+          std::size_t SlabSize    = 64 * 1024,
+          std::size_t Limit       = default_free_list_size>
+struct size_class_heap
+{
+    static constexpr std::size_t classes =
+        (MaxSize + Granularity - 1) / Granularity;
+
+    // every slab starts with a pointer to the previous one, so that
+    // they stay reachable
+    static constexpr std::size_t slab_header = alignof(std::max_align_t);
+
+    static_assert(Granularity % alignof(std::max_align_t) == 0,
+                  "size classes must keep the alignment of the objects");
+    static_assert(sizeof(void*) <= slab_header &&
+                      classes * Granularity <= SlabSize - slab_header,
+                  "the slabs must fit the biggest objects");
+
+    template <typename... Tags>
+    static void* allocate(std::size_t size, Tags... tags)
+    {
+        if (size > MaxSize)
+            return Base::allocate(size, tags...);
+        auto c     = size_class(size);
+        auto& list = local().lists[c];
+        if (!list.data)
+            refill(c);
+        auto n    = list.data;
+        list.data = n->next;
+        --list.count;
+        return n;
+    }
+
+    template <typename... Tags>
+    static void deallocate(std::size_t size, void* data, Tags... tags)
+    {
+        if (size > MaxSize)
+            return Base::deallocate(size, data, tags...);
+        auto c     = size_class(size);
+        auto& list = local().lists[c];
+        if (list.count >= Limit)
+            push_global(c, list.data, list.count);
+        auto n    = static_cast<free_list_node*>(data);
+        n->next   = list.data;
+        list.data = n;
+        ++list.count;
+    }
+
+private:
+    struct list_t
+    {
+        free_list_node* data = nullptr;
+        std::size_t count    = 0;
+    };
+
+    struct local_t
+    {
+        list_t lists[classes];
+        char* slab_next = nullptr;
+        char* slab_end  = nullptr;
+
+        ~local_t()
+        {
+            for (auto c = std::size_t{}; c < classes; ++c)
+                push_global(c, lists[c].data, lists[c].count);
+        }
+    };
+
+    struct global_t
+    {
+        std::atomic<free_list_node*> lists[classes];
+        std::atomic<void*> slabs{nullptr};
+    };
+
+    static std::size_t size_class(std::size_t size)
+    {
+        assert(size <= MaxSize);
+        return size ? (size - 1) / Granularity : 0;
+    }
+
+    static local_t& local()
+    {
+        thread_local local_t local_;
+        return local_;
+    }
+
+    static global_t& global()
+    {
+        static global_t global_{};
+        return global_;
+    }
+
+    static void
+    push_global(std::size_t c, free_list_node*& data, std::size_t& count)
+    {
+        if (!data)
+            return;
+        auto last = data;
+        while (last->next)
+            last = last->next;
+        auto& head = global().lists[c];
+        last->next = head.load(std::memory_order_relaxed);
+        while (!head.compare_exchange_weak(last->next,
+                                           data,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed))
+            ;
+        data  = nullptr;
+        count = 0;
+    }
+
+    static void refill(std::size_t c)
+    {
+        auto& l    = local();
+        auto& list = l.lists[c];
+        // taking the whole global list at once avoids the ABA problem
+        list.data = global().lists[c].exchange(nullptr,
+                                               std::memory_order_acquire);
+        if (list.data) {
+            for (auto n = list.data; n; n = n->next)
+                ++list.count;
+            return;
+        }
+        auto size = (c + 1) * Granularity;
+        if (static_cast<std::size_t>(l.slab_end - l.slab_next) < size) {
+            auto slab   = static_cast<char*>(Base::allocate(SlabSize));
+            auto& slabs = global().slabs;
+            auto prev   = slabs.load(std::memory_order_relaxed);
+            do {
+                *reinterpret_cast<void**>(slab) = prev;
+            } while (!slabs.compare_exchange_weak(prev,
+                                                  slab,
+                                                  std::memory_order_release,
+                                                  std::memory_order_relaxed));
+            l.slab_next = slab + slab_header;
+            l.slab_end  = slab + SlabSize;
+        }
+        auto n     = reinterpret_cast<free_list_node*>(l.slab_next);
+        n->next    = nullptr;
+        list.data  = n;
+        list.count = 1;
+        l.slab_next += size;
+    }
+};
+
+} // namespace immer
@@ -0,0 +1,225 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+
+#include <atomic>
+#include <climits>
+#include <cstddef>
+
+namespace immer {
+
+/*!
+ * Counters for the objects of one size class of a @ref stats_heap.
+ */
+struct heap_stats_counters
+{
+    //! Number of objects that were allocated.
+    std::size_t allocations = 0;
+    //! Number of objects that were deallocated.
+    std::size_t deallocations = 0;
+    //! Number of objects allocated and not deallocated yet.
+    std::size_t live = 0;
+    //! Maximum value that `live` has had.
+    std::size_t high_water = 0;
+};
+
+/*!
+ * Snapshot of the counters of a @ref stats_heap.
+ */
+struct heap_stats
+{
+    static constexpr std::size_t classes = sizeof(std::size_t) * CHAR_BIT + 1;
+
+    /*!
+     * Counters by size class.  The class `i > 0` holds the objects whose
+     * size is in `(2^(i-1), 2^i]`.
+     */
+    heap_stats_counters by_size[classes];
+
+    /*!
+     * Counters for all the objects.  The `high_water` is the sum of the
+     * ones of the size classes, so it may be bigger than the real peak.
+     */
+    heap_stats_counters total;
+
+    static std::size_t size_class(std::size_t size)
+    {
+        auto c = std::size_t{};
+        while (c < classes - 1 && (std::size_t{1} << c) < size)
+            ++c;
+        return c;
+    }
+};
+
+/*!
+ * Adaptor that counts the objects allocated and deallocated through
+ * it, by size class.  The counts are kept per thread, so that they do
+ * not add contention; only the number of live objects is shared.  A
+ * snapshot of all of them can be taken with `stats()`.
+ *
+ * It can be put anywhere in a chain of heap adaptors.  To measure how
+ * well a free list works, put one in front of it and another as its
+ * parent, with a different `Tag`.  The difference between their
+ * allocations are the hits of the free list and the allocations of the
+ * latter are the misses:
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    struct pooled_tag {};
+ *    struct system_tag {};
+ *
+ *    using heap = immer::stats_heap<
+ *        immer::with_free_list_node<immer::free_list_heap<
+ *            64, 1024, immer::stats_heap<immer::cpp_heap, system_tag>>>,
+ *        pooled_tag>;
+ *
+ * @endrst
+ *
+ * @tparam Base Type of the parent heap.
+ * @tparam Tag  Type that tells apart different instances of the adaptor
+ *              with the same `Base`, which would otherwise share their
+ *              counters.
+ */
+template <typename Base, typename Tag = void>
+struct stats_heap : Base
+{
+    using base_t = Base;
+
+    template <typename... Tags>
+    static void* allocate(std::size_t size, Tags... tags)
+    {
+        auto p = base_t::allocate(size, tags...);
+        auto c = heap_stats::size_class(size);
+        bump(local().by_size[c].allocations);
+        auto& g    = global().by_size[c];
+        auto live  = g.live.fetch_add(1u, std::memory_order_relaxed) + 1;
+        auto water = g.high_water.load(std::memory_order_relaxed);
+        while (water < live && !g.high_water.compare_exchange_weak(
+                                   water, live, std::memory_order_relaxed))
+            ;
+        return p;
+    }
+
+    template <typename... Tags>
+    static void deallocate(std::size_t size, void* data, Tags... tags)
+    {
+        base_t::deallocate(size, data, tags...);
+        auto c = heap_stats::size_class(size);
+        bump(local().by_size[c].deallocations);
+        global().by_size[c].live.fetch_sub(1u, std::memory_order_relaxed);
+    }
+
+    /*!
+     * Returns the current value of the counters, added up for all the
+     * threads.  The counters of other threads may lag a little behind.
+     */
+    static heap_stats stats()
+    {
+        auto result = heap_stats{};
+        auto& g     = global();
+        auto r      = g.records.load(std::memory_order_acquire);
+        for (; r; r = r->next) {
+            for (auto c = std::size_t{}; c < heap_stats::classes; ++c) {
+                auto& s = result.by_size[c];
+                s.allocations +=
+                    r->by_size[c].allocations.load(std::memory_order_relaxed);
+                s.deallocations += r->by_size[c].deallocations.load(
+                    std::memory_order_relaxed);
+            }
+        }
+        for (auto c = std::size_t{}; c < heap_stats::classes; ++c) {
+            auto& s      = result.by_size[c];
+            s.live       = g.by_size[c].live.load(std::memory_order_relaxed);
+            s.high_water = g.by_size[c].high_water.load(
+                std::memory_order_relaxed);
+            result.total.allocations += s.allocations;
+            result.total.deallocations += s.deallocations;
+            result.total.live += s.live;
+            result.total.high_water += s.high_water;
+        }
+        return result;
+    }
+
+private:
+    using counter_t = std::atomic<std::size_t>;
+
+    struct record
+    {
+        struct counts_t
+        {
+            counter_t allocations{0};
+            counter_t deallocations{0};
+        };
+
+        counts_t by_size[heap_stats::classes];
+        std::atomic<bool> used{false};
+        record* next = nullptr;
+    };
+
+    struct global_t
+    {
+        struct counts_t
+        {
+            counter_t live{0};
+            counter_t high_water{0};
+        };
+
+        counts_t by_size[heap_stats::classes];
+        std::atomic<record*> records{nullptr};
+    };
+
+    // records are never released, a thread adopts the record of a
+    // finished one, keeping its counts
+    struct owner_t
+    {
+        record* rec = acquire();
+        ~owner_t() { rec->used.store(false, std::memory_order_release); }
+    };
+
+    // only the owning thread writes the counters of a record
+    static void bump(counter_t& c)
+    {
+        c.store(c.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+    }
+
+    static record& local()
+    {
+        thread_local owner_t owner_;
+        return *owner_.rec;
+    }
+
+    static global_t& global()
+    {
+        static global_t global_{};
+        return global_;
+    }
+
+    static record* acquire()
+    {
+        auto& rs = global().records;
+        for (auto r = rs.load(std::memory_order_acquire); r; r = r->next)
+            if (!r->used.load(std::memory_order_relaxed) &&
+                !r->used.exchange(true, std::memory_order_acquire))
+                return r;
+        auto r = new record{};
+        r->used.store(true, std::memory_order_relaxed);
+        r->next = rs.load(std::memory_order_relaxed);
+        while (!rs.compare_exchange_weak(
+            r->next, r, std::memory_order_release, std::memory_order_relaxed))
+            ;
+        return r;
+    }
+};
+
+} // namespace immer
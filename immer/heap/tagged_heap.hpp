@@ -0,0 +1,228 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/type_traits.hpp>
+#include <immer/memory_policy.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace immer {
+
+/*!
+ * Memory attributed to one tag of a @ref tagged_heap.
+ */
+struct tagged_memory
+{
+    //! Name of the tag, see @ref tagged_heap.
+    const char* tag = nullptr;
+    //! Bytes requested by the objects that are alive.
+    std::size_t live_bytes = 0;
+    //! Number of objects that are alive.
+    std::size_t live_objects = 0;
+    //! Maximum value that `live_bytes` has had.
+    std::size_t high_water_bytes = 0;
+    //! Number of objects that were allocated.
+    std::size_t allocations = 0;
+};
+
+namespace detail {
+
+template <typename Tag, typename = void>
+struct memory_tag_name
+{
+    static const char* get() { return "unnamed"; }
+};
+
+template <typename Tag>
+struct memory_tag_name<Tag, void_t<decltype(Tag::name())>>
+{
+    static const char* get() { return Tag::name(); }
+};
+
+struct memory_tag_counters
+{
+    const char* name;
+    std::atomic<std::size_t> live_bytes{0};
+    std::atomic<std::size_t> live_objects{0};
+    std::atomic<std::size_t> high_water_bytes{0};
+    std::atomic<std::size_t> allocations{0};
+    memory_tag_counters* next = nullptr;
+
+    memory_tag_counters(const char* n)
+        : name{n}
+    {
+        auto& all = registry();
+        next      = all.load(std::memory_order_relaxed);
+        while (!all.compare_exchange_weak(
+            next, this, std::memory_order_release, std::memory_order_relaxed))
+            ;
+    }
+
+    tagged_memory snapshot() const
+    {
+        auto r             = tagged_memory{};
+        r.tag              = name;
+        r.live_bytes       = live_bytes.load(std::memory_order_relaxed);
+        r.live_objects     = live_objects.load(std::memory_order_relaxed);
+        r.high_water_bytes = high_water_bytes.load(std::memory_order_relaxed);
+        r.allocations      = allocations.load(std::memory_order_relaxed);
+        return r;
+    }
+
+    static std::atomic<memory_tag_counters*>& registry()
+    {
+        static std::atomic<memory_tag_counters*> registry_{nullptr};
+        return registry_;
+    }
+
+    template <typename Tag>
+    static memory_tag_counters& of()
+    {
+        static memory_tag_counters counters_{memory_tag_name<Tag>::get()};
+        return counters_;
+    }
+};
+
+} // namespace detail
+
+/*!
+ * Adaptor that attributes the memory allocated through it to `Tag`.
+ * All the heaps with the same `Tag` add to the same counters, which
+ * can be read with `memory_of<Tag>()`, or for all the tags that have
+ * been used with `memory_by_tag()`.  The name of the tag is the result
+ * of `Tag::name()` when it has such a static member function.
+ *
+ * It is meant to be used through @ref tagged_memory_policy, which
+ * attributes to a tag all the nodes of the containers that use it.
+ * Since containers with different tags have different types, the tag
+ * should be the logical purpose of the containers, like the cache of
+ * sessions or the index of documents, and not the instance.
+ *
+ * @tparam Base Type of the parent heap.
+ * @tparam Tag  Type that names the owner of the memory.
+ */
+template <typename Base, typename Tag>
+struct tagged_heap : Base
+{
+    using base_t = Base;
+
+    template <typename... Tags>
+    static void* allocate(std::size_t size, Tags... tags)
+    {
+        auto p     = base_t::allocate(size, tags...);
+        auto& c    = detail::memory_tag_counters::of<Tag>();
+        auto bytes = c.live_bytes.fetch_add(size, std::memory_order_relaxed) +
+                     size;
+        auto water = c.high_water_bytes.load(std::memory_order_relaxed);
+        while (water < bytes && !c.high_water_bytes.compare_exchange_weak(
+                                    water, bytes, std::memory_order_relaxed))
+            ;
+        c.live_objects.fetch_add(1u, std::memory_order_relaxed);
+        c.allocations.fetch_add(1u, std::memory_order_relaxed);
+        return p;
+    }
+
+    template <typename... Tags>
+    static void deallocate(std::size_t size, void* data, Tags... tags)
+    {
+        base_t::deallocate(size, data, tags...);
+        auto& c = detail::memory_tag_counters::of<Tag>();
+        c.live_bytes.fetch_sub(size, std::memory_order_relaxed);
+        c.live_objects.fetch_sub(1u, std::memory_order_relaxed);
+    }
+};
+
+/*!
+ * Heap policy that attributes to `Tag` the memory of all the heaps that
+ * `HeapPolicy` returns, see @ref tagged_heap.  The sizes counted are
+ * the ones that the containers request, not the ones that the pools of
+ * `HeapPolicy` round them to.
+ */
+template <typename HeapPolicy, typename Tag>
+struct tagged_heap_policy
+{
+    using type = tagged_heap<typename HeapPolicy::type, Tag>;
+
+    template <std::size_t Size>
+    struct optimized
+    {
+        using type = tagged_heap<
+            typename HeapPolicy::template optimized<Size>::type,
+            Tag>;
+    };
+};
+
+/*!
+ * The memory policy `MemoryPolicy` with its heap policy wrapped in a
+ * @ref tagged_heap_policy, so that the containers that use it count
+ * their nodes under `Tag`:
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    struct sessions_tag
+ *    {
+ *        static const char* name() { return "sessions"; }
+ *    };
+ *
+ *    using sessions_map =
+ *        immer::map<std::string,
+ *                   session,
+ *                   std::hash<std::string>,
+ *                   std::equal_to<std::string>,
+ *                   immer::tagged_memory_policy<sessions_tag>>;
+ *
+ *    for (auto& m : immer::memory_by_tag())
+ *        std::cerr << m.tag << ": " << m.live_bytes << "\n";
+ *
+ * @endrst
+ */
+template <typename Tag, typename MemoryPolicy = default_memory_policy>
+using tagged_memory_policy =
+    memory_policy<tagged_heap_policy<typename MemoryPolicy::heap, Tag>,
+                  typename MemoryPolicy::refcount,
+                  typename MemoryPolicy::lock,
+                  typename MemoryPolicy::transience,
+                  MemoryPolicy::prefer_fewer_bigger_objects,
+                  MemoryPolicy::use_transient_rvalues,
+                  MemoryPolicy::embed_values>;
+
+/*!
+ * Returns the memory attributed to `Tag` by the @ref tagged_heap.
+ */
+template <typename Tag>
+tagged_memory memory_of()
+{
+    return detail::memory_tag_counters::of<Tag>().snapshot();
+}
+
+/*!
+ * Returns the memory attributed to every tag that has been used by a
+ * @ref tagged_heap, from the one with the most live bytes to the one
+ * with the least.
+ */
+inline std::vector<tagged_memory> memory_by_tag()
+{
+    auto r   = std::vector<tagged_memory>{};
+    auto& cs = detail::memory_tag_counters::registry();
+    for (auto c = cs.load(std::memory_order_acquire); c; c = c->next)
+        r.push_back(c->snapshot());
+    std::stable_sort(r.begin(), r.end(), [](auto& a, auto& b) {
+        return a.live_bytes > b.live_bytes;
+    });
+    return r;
+}
+
+} // namespace immer
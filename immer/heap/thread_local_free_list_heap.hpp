@@ -8,29 +8,78 @@
 
 #pragma once
 
-#include <immer/heap/unsafe_free_list_heap.hpp>
+#include <immer/config.hpp>
+#include <immer/heap/free_list_node.hpp>
+#include <immer/trace.hpp>
 
+#include <atomic>
+#include <cassert>
 #include <cstddef>
 
 namespace immer {
 namespace detail {
 
+/*!
+ * Size of the header that `thread_local_free_list_heap` adds in front
+ * of the blocks it takes from its parent heap.
+ */
+constexpr std::size_t thread_local_free_list_header = sizeof(void*);
+
 template <typename Heap>
 struct thread_local_free_list_storage
 {
+    // owners are never destroyed, instead they are adopted by new
+    // threads when the thread using them finishes, so that other
+    // threads can always return blocks to them
+    struct owner_t
+    {
+        std::atomic<free_list_node*> remote{nullptr};
+        std::atomic<bool> used{false};
+        owner_t* next = nullptr;
+    };
+
     struct head_t
     {
         free_list_node* data;
         std::size_t count;
+        owner_t* owner;
 
         ~head_t() { Heap::clear(); }
     };
 
     static head_t& head()
     {
-        thread_local static head_t head_{nullptr, 0};
+        thread_local static head_t head_{nullptr, 0, acquire()};
         return head_;
     }
+
+    static void release(owner_t* o)
+    {
+        o->used.store(false, std::memory_order_release);
+    }
+
+private:
+    static std::atomic<owner_t*>& owners()
+    {
+        static std::atomic<owner_t*> owners_{nullptr};
+        return owners_;
+    }
+
+    static owner_t* acquire()
+    {
+        auto& os = owners();
+        for (auto o = os.load(std::memory_order_acquire); o; o = o->next)
+            if (!o->used.load(std::memory_order_relaxed) &&
+                !o->used.exchange(true, std::memory_order_acquire))
+                return o;
+        auto o = new owner_t{};
+        o->used.store(true, std::memory_order_relaxed);
+        o->next = os.load(std::memory_order_relaxed);
+        while (!os.compare_exchange_weak(
+            o->next, o, std::memory_order_release, std::memory_order_relaxed))
+            ;
+        return o;
+    }
 };
 
 } // namespace detail
@@ -42,16 +91,115 @@ struct thread_local_free_list_storage
  * adaptor.  When the current thread finishes, the memory is returned
  * to the parent heap.
  *
+ * Every block remembers the thread that allocated it.  When another
+ * thread releases it, the block is pushed to a lock-free queue of the
+ * allocating thread instead, which moves the whole queue to its free
+ * list the next time the list runs empty.  This way, memory keeps being
+ * reused when one thread allocates the nodes and other threads release
+ * them.  The blocks taken from `Base` are
+ * `detail::thread_local_free_list_header` bytes bigger to hold this
+ * information.
+ *
  * @tparam Size  Maximum size of the objects to be allocated.
  * @tparam Limit Maximum number of elements to keep in the free list.
  * @tparam Base  Type of the parent heap.
  */
 template <std::size_t Size, std::size_t Limit, typename Base>
-struct thread_local_free_list_heap
-    : detail::unsafe_free_list_heap_impl<detail::thread_local_free_list_storage,
-                                         Size,
-                                         Limit,
-                                         Base>
-{};
+struct thread_local_free_list_heap : Base
+{
+    using base_t = Base;
+
+    template <typename... Tags>
+    static void* allocate(std::size_t size, Tags...)
+    {
+        assert(size <= sizeof(free_list_node) + Size);
+        assert(size >= sizeof(free_list_node));
+
+        auto& h = storage::head();
+        if (!h.data)
+            drain(h);
+        auto n = h.data;
+        if (!n) {
+            IMMER_TRACE_HOOK(free_list_miss, Size);
+            auto p = static_cast<owner_t**>(base_t::allocate(block_size));
+            *p     = h.owner;
+            return p + 1;
+        }
+        --h.count;
+        h.data = n->next;
+        return n;
+    }
+
+    template <typename... Tags>
+    static void deallocate(std::size_t size, void* data, Tags...)
+    {
+        assert(size <= sizeof(free_list_node) + Size);
+        assert(size >= sizeof(free_list_node));
+
+        auto& h = storage::head();
+        auto o  = *(static_cast<owner_t**>(data) - 1);
+        auto n  = static_cast<free_list_node*>(data);
+        if (o == h.owner) {
+            push_local(h, n);
+        } else {
+            auto& remote = o->remote;
+            n->next      = remote.load(std::memory_order_relaxed);
+            while (!remote.compare_exchange_weak(n->next,
+                                                 n,
+                                                 std::memory_order_release,
+                                                 std::memory_order_relaxed))
+                ;
+        }
+    }
+
+    static void clear()
+    {
+        auto& h = storage::head();
+        drain(h);
+        while (h.data) {
+            auto n = h.data->next;
+            base_t::deallocate(block_size, header(h.data));
+            h.data = n;
+            --h.count;
+        }
+        storage::release(h.owner);
+    }
+
+private:
+    using storage =
+        detail::thread_local_free_list_storage<thread_local_free_list_heap>;
+    using head_t  = typename storage::head_t;
+    using owner_t = typename storage::owner_t;
+
+    static constexpr std::size_t block_size =
+        Size + sizeof(free_list_node) + detail::thread_local_free_list_header;
+
+    static void* header(free_list_node* n)
+    {
+        return reinterpret_cast<owner_t**>(n) - 1;
+    }
+
+    static void push_local(head_t& h, free_list_node* n)
+    {
+        if (h.count >= Limit)
+            base_t::deallocate(block_size, header(n));
+        else {
+            n->next = h.data;
+            h.data  = n;
+            ++h.count;
+        }
+    }
+
+    // taking the whole queue at once avoids the ABA problem
+    static void drain(head_t& h)
+    {
+        auto n = h.owner->remote.exchange(nullptr, std::memory_order_acquire);
+        while (n) {
+            auto next = n->next;
+            push_local(h, n);
+            n = next;
+        }
+    }
+};
 
 } // namespace immer
@@ -10,6 +10,7 @@
 
 #include <immer/config.hpp>
 #include <immer/heap/free_list_node.hpp>
+#include <immer/trace.hpp>
 
 #include <cassert>
 #include <cstddef>
@@ -52,6 +53,7 @@ public:
 
         auto n = storage::head().data;
         if (!n) {
+            IMMER_TRACE_HOOK(free_list_miss, Size);
             auto p = base_t::allocate(Size + sizeof(free_list_node));
             return static_cast<free_list_node*>(p);
         }
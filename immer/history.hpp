@@ -0,0 +1,218 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/memory_stats.hpp>
+
+#include <cassert>
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace immer {
+
+namespace detail {
+namespace history {
+
+using counts_t = std::unordered_map<const void*, std::size_t>;
+
+// Sets for `usage::visitor` that count the references to every node
+// from the versions and from the other counted nodes.  The visitor only
+// descends into the nodes that the adder sees for the first time, and
+// into those that lose their last reference in the remover, thus both
+// cost in proportion to the nodes that a version does not share.
+struct adder
+{
+    counts_t* counts;
+
+    struct result
+    {
+        bool second;
+    };
+
+    result insert(const void* p) { return {(*counts)[p]++ == 0}; }
+};
+
+struct remover
+{
+    counts_t* counts;
+
+    struct result
+    {
+        bool second;
+    };
+
+    result insert(const void* p)
+    {
+        auto it = counts->find(p);
+        assert(it != counts->end());
+        if (--it->second)
+            return {false};
+        counts->erase(it);
+        return {true};
+    }
+};
+
+} // namespace history
+} // namespace detail
+
+/*!
+ * Keeps the last versions of a container `T`, a @ref vector, @ref
+ * flex_vector, @ref map, @ref set or @ref table, as an undo log does,
+ * within a limit on their number and on the bytes of the nodes that
+ * they retain together.  The nodes that the versions share are counted
+ * once, thus the @ref retained_bytes are what the history keeps alive,
+ * as @ref shared_memory_stats would count them.
+ *
+ * The versions are stored in a ring, and every @ref push counts the
+ * nodes of the new version that are not in the previous ones, and drops
+ * the oldest versions while the limits are exceeded.  Thus pushing a
+ * version made by a few edits of the last one costs about @f$ O(log(n))
+ * @f$, plus @f$ O(1) @f$ per node that was not shared.  The newest
+ * version is always kept, even when it is bigger than the budget.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    auto h = immer::history<immer::flex_vector<char>>{100, 1 << 20};
+ *    h.push(doc);
+ *    ...
+ *    doc = doc.insert(pos, c);
+ *    h.push(doc);
+ *    ...
+ *    h.pop_back(); // undo
+ *    doc = h.back();
+ *
+ * .. note:: The bytes of the nodes are those that @ref memory_stats
+ *    reports, and the versions should be held only by the history for
+ *    the eviction to free them.  The accounting takes a hash table
+ *    entry per node retained.
+ *
+ * @endrst
+ */
+template <typename T>
+class history
+{
+public:
+    using value_type = T;
+    using size_type  = std::size_t;
+
+    /*!
+     * Creates an empty history that keeps at most `max_versions`, that
+     * must be more than zero, and drops the oldest ones while they
+     * retain more than `max_bytes`.
+     */
+    explicit history(size_type max_versions,
+                     size_type max_bytes = size_type(-1))
+        : ring_(max_versions)
+        , max_bytes_{max_bytes}
+    {
+        assert(max_versions > 0);
+    }
+
+    size_type size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_type max_versions() const { return ring_.size(); }
+    size_type max_bytes() const { return max_bytes_; }
+
+    /*!
+     * Bytes of the nodes that the versions in the history retain,
+     * counting those that they share once.
+     */
+    size_type retained_bytes() const { return bytes_; }
+
+    /*!
+     * Returns the `i`-th version, where the oldest is the 0th.
+     */
+    const T& operator[](size_type i) const
+    {
+        assert(i < size_);
+        return ring_[(first_ + i) % ring_.size()];
+    }
+
+    const T& front() const { return (*this)[0]; }
+    const T& back() const { return (*this)[size_ - 1]; }
+
+    /*!
+     * Adds `v` as the newest version, dropping the oldest ones while
+     * there are too many or they retain more than @ref max_bytes.
+     */
+    void push(T v)
+    {
+        if (size_ == ring_.size())
+            pop_front();
+        bytes_ += visit<detail::history::adder>(v);
+        ring_[(first_ + size_) % ring_.size()] = std::move(v);
+        ++size_;
+        while (size_ > 1 && bytes_ > max_bytes_)
+            pop_front();
+    }
+
+    //! Drops the oldest version.
+    void pop_front()
+    {
+        assert(size_ > 0);
+        release(ring_[first_]);
+        first_ = (first_ + 1) % ring_.size();
+        --size_;
+    }
+
+    //! Drops the newest version, as an undo does.
+    void pop_back()
+    {
+        assert(size_ > 0);
+        release(ring_[(first_ + size_ - 1) % ring_.size()]);
+        --size_;
+    }
+
+    void clear()
+    {
+        while (size_)
+            pop_back();
+    }
+
+    /*!
+     * Changes the byte budget, dropping the oldest versions while it is
+     * exceeded.
+     */
+    void set_max_bytes(size_type max_bytes)
+    {
+        max_bytes_ = max_bytes;
+        while (size_ > 1 && bytes_ > max_bytes_)
+            pop_front();
+    }
+
+private:
+    template <typename Counter>
+    size_type visit(const T& v)
+    {
+        auto usage   = memory_usage{};
+        auto counter = Counter{&counts_};
+        detail::usage::visitor<Counter>{usage, &counter}.add(v.impl());
+        return usage.bytes;
+    }
+
+    void release(T& v)
+    {
+        bytes_ -= visit<detail::history::remover>(v);
+        v = T{};
+    }
+
+    std::vector<T> ring_;
+    size_type first_     = 0;
+    size_type size_      = 0;
+    size_type bytes_     = 0;
+    size_type max_bytes_ = 0;
+    detail::history::counts_t counts_;
+};
+
+} // namespace immer
@@ -0,0 +1,764 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/hamts/champ.hpp>
+#include <immer/detail/rbts/rbtree.hpp>
+#include <immer/detail/rbts/rrbtree.hpp>
+#include <immer/persist.hpp>
+#include <immer/refcount/no_refcount_policy.hpp>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define IMMER_IMAGE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define IMMER_IMAGE_MMAP 0
+#include <fstream>
+#include <iterator>
+#endif
+
+namespace immer {
+
+/*!
+ * Address at which an @ref image_writer lays out its images by default.
+ * It is far away from where systems usually place the heap and the
+ * shared libraries, so that the image can most often be mapped there.
+ */
+constexpr std::uintptr_t default_image_base =
+    sizeof(std::uintptr_t) >= 8
+        ? static_cast<std::uintptr_t>(std::uint64_t{1} << 45)
+        : std::uintptr_t{1} << 30;
+
+/*!
+ * Exception thrown when opening a file that is not an image or that does
+ * not contain what was asked for.
+ */
+class image_error : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+namespace detail {
+namespace image {
+
+enum class root_kind : std::uint8_t
+{
+    rbtree = 1,
+    rrbtree,
+    champ,
+};
+
+constexpr char magic[8] = {'i', 'm', 'm', 'e', 'r', 'i', 'm', '1'};
+
+struct header_t
+{
+    char magic[8];
+    // address the pointers in the image are relative to
+    std::uint64_t base;
+    std::uint64_t size;
+    std::uint64_t roots;
+    std::uint64_t root_count;
+    // offsets of every pointer in the image
+    std::uint64_t relocs;
+    std::uint64_t reloc_count;
+};
+
+struct root_t
+{
+    std::uint8_t kind;
+    std::uint8_t bits;
+    std::uint8_t bits_leaf;
+    std::uint8_t cache_hashes;
+    std::uint32_t value_size;
+    std::uint64_t size;
+    std::uint64_t shift;
+    std::uint64_t root;
+    std::uint64_t tail;
+};
+
+// values are copied byte by byte into the image and used from there
+template <typename T>
+struct is_flat : std::is_trivially_copyable<T>
+{};
+
+template <typename T1, typename T2>
+struct is_flat<std::pair<T1, T2>>
+    : std::integral_constant<bool, is_flat<T1>::value && is_flat<T2>::value>
+{};
+
+template <typename T>
+constexpr bool is_flat_v = is_flat<T>::value;
+
+constexpr std::uint64_t align(std::uint64_t n)
+{
+    return (n + alignof(std::max_align_t) - 1) &
+           ~std::uint64_t{alignof(std::max_align_t) - 1};
+}
+
+template <typename Node>
+void check_node()
+{
+    static_assert(std::is_same<typename Node::refs_t, no_refcount_policy>{},
+                  "images can only hold containers using no_refcount_policy");
+    static_assert(is_flat_v<typename Node::value_t>,
+                  "images can only hold trivially copyable values");
+    static_assert(alignof(typename Node::value_t) <= alignof(std::max_align_t),
+                  "images can not hold over-aligned values");
+}
+
+} // namespace image
+} // namespace detail
+
+/*!
+ * Writes containers into an image: a file that holds their nodes in the
+ * same layout that they have in memory, so that it can be mapped by an
+ * @ref image and used in place without parsing it.  Like with an @ref
+ * output_archive, every distinct node is written once and the containers
+ * added to the same image share their structure.
+ *
+ * The pointers among the nodes are written for the image to be mapped
+ * at the `base` address.  The image also lists where they are, so that
+ * they can be fixed up when it has to be mapped somewhere else.
+ *
+ * It supports @ref vector, @ref flex_vector, @ref map and @ref set using
+ * `no_refcount_policy` and holding trivially copyable values, or pairs
+ * of them.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    using memory = immer::memory_policy<immer::heap_policy<immer::cpp_heap>,
+ *                                        immer::no_refcount_policy,
+ *                                        immer::default_lock_policy>;
+ *    using vector_t = immer::vector<int, memory>;
+ *
+ *    auto out = immer::image_writer{};
+ *    auto id  = out.add(vector_t{1, 2, 3});
+ *    out.write(stream);
+ *
+ *    immer::image img{"snapshot.img"};
+ *    auto v = img.root<vector_t>(id);
+ *
+ * .. note:: The image relies on the layout of the nodes, thus it has to
+ *    be opened on the same platform and with containers of the same
+ *    type, including their memory policy and branching factors.
+ *
+ * @endrst
+ */
+class image_writer
+{
+public:
+    explicit image_writer(std::uintptr_t base = default_image_base)
+        : base_{base}
+        , data_(detail::image::align(sizeof(detail::image::header_t)))
+    {}
+
+    /*!
+     * Adds the container `c` to the image, returning the index of the
+     * root to get it back with.  The nodes that were added before, for
+     * this or other containers, are not written again.
+     */
+    template <typename Container>
+    std::size_t add(const Container& c)
+    {
+        roots_.push_back(add_impl(c.impl()));
+        return roots_.size() - 1;
+    }
+
+    /*!
+     * Writes the image with everything added so far to `out`.
+     */
+    void write(std::ostream& out) const
+    {
+        using namespace detail::image;
+        auto roots     = align(data_.size());
+        auto roots_end = roots + roots_.size() * sizeof(root_t);
+        auto relocs    = align(roots_end);
+        auto header    = header_t{};
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.base        = base_;
+        header.size        = relocs + relocs_.size() * sizeof(std::uint64_t);
+        header.roots       = roots;
+        header.root_count  = roots_.size();
+        header.relocs      = relocs;
+        header.reloc_count = relocs_.size();
+        auto padding       = std::string(alignof(std::max_align_t), '\0');
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(data_.data() + sizeof(header), data_.size() - sizeof(header));
+        out.write(padding.data(), roots - data_.size());
+        out.write(reinterpret_cast<const char*>(roots_.data()),
+                  roots_.size() * sizeof(root_t));
+        out.write(padding.data(), relocs - roots_end);
+        out.write(reinterpret_cast<const char*>(relocs_.data()),
+                  relocs_.size() * sizeof(std::uint64_t));
+    }
+
+    /*!
+     * Writes the image with everything added so far to `out` as C++
+     * source code, defining an array of bytes called `name` that holds
+     * it.  Compiling that source embeds the image in the program, where
+     * it can be opened in place with `image{name, sizeof(name)}`,
+     * without reading any file nor allocating the nodes.
+     *
+     * @rst
+     *
+     * .. code-block:: c++
+     *
+     *    // at build time
+     *    auto out = immer::image_writer{};
+     *    out.add(country_codes);
+     *    out.write_source(header, "country_codes_image");
+     *
+     *    // in the program, that includes the written source
+     *    static immer::image img{country_codes_image,
+     *                            sizeof(country_codes_image)};
+     *    static const auto codes = img.root<map_t>(0);
+     *
+     * @endrst
+     */
+    void write_source(std::ostream& out, const std::string& name) const
+    {
+        auto buffer = std::ostringstream{};
+        write(buffer);
+        auto bytes  = buffer.str();
+        auto digits = "0123456789abcdef";
+        out << "// immer image written by immer::image_writer\n"
+            << "alignas(" << alignof(std::max_align_t) << ") unsigned char "
+            << name << "[] = {";
+        for (auto i = std::size_t{}; i < bytes.size(); ++i) {
+            auto b = static_cast<unsigned char>(bytes[i]);
+            out << (i % 12 ? " " : "\n    ") << "0x" << digits[b >> 4]
+                << digits[b & 15] << ",";
+        }
+        out << "\n};\n";
+    }
+
+private:
+    using root_kind = detail::image::root_kind;
+
+    template <typename T, typename MP, detail::rbts::bits_t B,
+              detail::rbts::bits_t BL>
+    detail::image::root_t
+    add_impl(const detail::rbts::rbtree<T, MP, B, BL>& t)
+    {
+        return add_rbts(t, root_kind::rbtree);
+    }
+
+    template <typename T, typename MP, detail::rbts::bits_t B,
+              detail::rbts::bits_t BL>
+    detail::image::root_t
+    add_impl(const detail::rbts::rrbtree<T, MP, B, BL>& t)
+    {
+        return add_rbts(t, root_kind::rrbtree);
+    }
+
+    template <typename T, typename Hash, typename Equal, typename MP,
+              detail::hamts::bits_t B>
+    detail::image::root_t
+    add_impl(const detail::hamts::champ<T, Hash, Equal, MP, B>& t)
+    {
+        using node_t = typename detail::hamts::champ<T, Hash, Equal, MP, B>::
+            node_t;
+        detail::image::check_node<node_t>();
+        auto r         = detail::image::root_t{};
+        r.kind         = static_cast<std::uint8_t>(root_kind::champ);
+        r.bits         = B;
+        r.cache_hashes = node_t::cache_hashes;
+        r.value_size   = sizeof(T);
+        r.size         = t.size;
+        r.root         = add_champ<node_t, B>(t.root, 0);
+        return r;
+    }
+
+    template <typename Tree>
+    detail::image::root_t add_rbts(const Tree& t, root_kind kind)
+    {
+        using node_t = typename Tree::node_t;
+        detail::image::check_node<node_t>();
+        auto tail_off = t.tail_offset();
+        auto r        = detail::image::root_t{};
+        r.kind        = static_cast<std::uint8_t>(kind);
+        r.bits        = node_t::bits;
+        r.bits_leaf   = node_t::bits_leaf;
+        r.value_size  = sizeof(typename node_t::value_t);
+        r.size        = t.size;
+        r.shift       = t.shift;
+        r.root        = add_rbts_inner<node_t>(t.root, t.shift, tail_off);
+        r.tail        = add_rbts_leaf<node_t>(
+            t.tail, static_cast<detail::rbts::count_t>(t.size - tail_off));
+        return r;
+    }
+
+    template <typename Node>
+    std::uint64_t add_rbts_leaf(Node* n, detail::rbts::count_t count)
+    {
+        auto key = detail::persist::node_key{n, count};
+        auto it  = offsets_.find(key);
+        if (it != offsets_.end())
+            return it->second;
+        auto size = Node::sizeof_leaf_n(count);
+        auto off  = allocate(size);
+        auto p    = Node::make_leaf_n_into(at(off), size, count);
+        std::memcpy(static_cast<void*>(p->leaf()),
+                    n->leaf(),
+                    count * sizeof(typename Node::value_t));
+        return offsets_[key] = off;
+    }
+
+    template <typename Node>
+    std::uint64_t
+    add_rbts_inner(Node* n, detail::rbts::shift_t shift, std::size_t size)
+    {
+        using namespace detail::rbts;
+        using relaxed_t   = typename Node::relaxed_t;
+        constexpr auto B  = Node::bits;
+        constexpr auto BL = Node::bits_leaf;
+        auto key          = detail::persist::node_key{n, size};
+        auto it           = offsets_.find(key);
+        if (it != offsets_.end())
+            return it->second;
+        std::uint64_t children[branches<B>];
+        auto count = count_t{};
+        auto child = [&](Node* c, std::size_t s) {
+            return shift == BL ? add_rbts_leaf(c, static_cast<count_t>(s))
+                               : add_rbts_inner(c, shift - B, s);
+        };
+        auto relaxed = n->relaxed();
+        if (relaxed) {
+            count     = relaxed->d.count;
+            auto prev = std::size_t{};
+            for (auto i = count_t{}; i < count; ++i) {
+                auto s      = relaxed->d.sizes[i];
+                children[i] = child(n->inner()[i], s - prev);
+                prev        = s;
+            }
+        } else {
+            auto cap = std::size_t{1} << shift;
+            count    = size ? static_cast<count_t>(((size - 1) >> shift) + 1)
+                            : count_t{};
+            for (auto i = count_t{}; i < count; ++i)
+                children[i] =
+                    child(n->inner()[i], std::min(cap, size - i * cap));
+        }
+        // the relaxed block goes right after the node when the memory
+        // policy embeds it, like the one made by make_inner_r_n()
+        auto roff = std::uint64_t{};
+        if (relaxed && !Node::embed_relaxed) {
+            roff   = allocate(Node::sizeof_relaxed_n(count));
+            auto r = new (at(roff)) relaxed_t;
+            r->d.count = count;
+            std::copy(relaxed->d.sizes, relaxed->d.sizes + count, r->d.sizes);
+        }
+        auto size_n = relaxed ? Node::sizeof_inner_r_n(count)
+                              : Node::sizeof_inner_n(count);
+        auto off    = allocate(size_n);
+        if (relaxed && Node::embed_relaxed) {
+            roff   = off + Node::sizeof_inner_n(count);
+            auto r = new (at(roff)) relaxed_t;
+            r->d.count = count;
+            std::copy(relaxed->d.sizes, relaxed->d.sizes + count, r->d.sizes);
+        }
+        auto p = Node::make_inner_n_into(at(off), size_n, count);
+        if (relaxed)
+            link(p->impl.d.data.inner.relaxed, roff);
+        for (auto i = count_t{}; i < count; ++i)
+            link(p->inner()[i], children[i]);
+        return offsets_[key] = off;
+    }
+
+    template <typename Node, detail::hamts::bits_t B>
+    std::uint64_t add_champ(Node* n, detail::hamts::count_t depth)
+    {
+        using namespace detail::hamts;
+        using value_t  = typename Node::value_t;
+        using values_t = typename Node::values_t;
+        auto key       = detail::persist::node_key{n, 0};
+        auto it        = offsets_.find(key);
+        if (it != offsets_.end())
+            return it->second;
+        if (depth == max_depth<B>) {
+            auto count = n->collision_count();
+            auto off   = allocate(Node::sizeof_collision_n(count));
+            auto p     = new (at(off)) Node;
+#if IMMER_TAGGED_NODE
+            p->impl.d.kind = Node::kind_t::collision;
+#endif
+            p->impl.d.data.collision.count = count;
+            std::memcpy(static_cast<void*>(p->collisions()),
+                        n->collisions(),
+                        count * sizeof(value_t));
+            return offsets_[key] = off;
+        }
+        std::uint64_t children[branches<B>];
+        auto nc = n->children_count();
+        for (auto i = count_t{}; i < nc; ++i)
+            children[i] = add_champ<Node, B>(n->children()[i], depth + 1);
+        auto nv   = n->data_count();
+        auto voff = std::uint64_t{};
+        if (n->datamap()) {
+            voff   = allocate(Node::sizeof_values_n(nv));
+            auto v = new (at(voff)) values_t{};
+            std::memcpy(static_cast<void*>(&v->d.buffer),
+                        n->values(),
+                        nv * sizeof(value_t));
+            if (Node::cache_hashes)
+                std::copy(n->hashes(), n->hashes() + nv, Node::hashes(v, nv));
+        }
+        auto off = allocate(Node::sizeof_inner_n(nc));
+        auto p   = new (at(off)) Node;
+#if IMMER_TAGGED_NODE
+        p->impl.d.kind = Node::kind_t::inner;
+#endif
+        p->impl.d.data.inner.nodemap = n->nodemap();
+        p->impl.d.data.inner.datamap = n->datamap();
+        p->impl.d.data.inner.values  = nullptr;
+        if (n->datamap())
+            link(p->impl.d.data.inner.values, voff);
+        for (auto i = count_t{}; i < nc; ++i)
+            link(p->children()[i], children[i]);
+        return offsets_[key] = off;
+    }
+
+    // returns the offset of a new block of zeroes of `size` bytes
+    std::uint64_t allocate(std::size_t size)
+    {
+        auto off = detail::image::align(data_.size());
+        data_.resize(off + size);
+        return off;
+    }
+
+    void* at(std::uint64_t off) { return data_.data() + off; }
+
+    template <typename T>
+    void link(T*& slot, std::uint64_t target)
+    {
+        slot = reinterpret_cast<T*>(base_ + target);
+        relocs_.push_back(static_cast<std::uint64_t>(
+            reinterpret_cast<char*>(&slot) - data_.data()));
+    }
+
+    std::uintptr_t base_;
+    std::vector<char> data_;
+    std::vector<detail::image::root_t> roots_;
+    std::vector<std::uint64_t> relocs_;
+    std::unordered_map<detail::persist::node_key,
+                       std::uint64_t,
+                       detail::persist::node_key_hash>
+        offsets_;
+};
+
+/*!
+ * A file written by an @ref image_writer, mapped in memory.  Opening it
+ * does not read the nodes, which are paged in by the system the first
+ * time that they are accessed, and the containers taken from it use
+ * them in place.
+ *
+ * When the image can not be mapped at the address it was written for,
+ * the pointers among its nodes are fixed up when opening it.  Those are
+ * only found in inner nodes, thus the leaves, holding most of the data,
+ * are still left to be paged in lazily.
+ *
+ * The containers taken from an image must not outlive it.  Their nodes
+ * are never freed, since they are not reference counted, and so are the
+ * nodes of the new versions derived from them unless a garbage
+ * collected heap is used.  The image is mapped read-only, thus they are
+ * never updated in place.
+ *
+ * An image can also be embedded in the program as a static array, see
+ * @ref image_writer::write_source, and opened where it is.  This gives
+ * constant tables, like big lookup maps, that take no time to build at
+ * startup other than fixing up their pointers, and no heap, and that
+ * can be the base of new versions like any other container.
+ *
+ * @rst
+ *
+ * .. note:: The nodes of an image are not validated, only the header
+ *    and the roots are.  Images must only be opened when they come from
+ *    a trusted source.
+ *
+ * @endrst
+ */
+class image
+{
+public:
+    /*!
+     * Maps the image in the file at `path`.  Throws `std::system_error`
+     * when the file can not be mapped and @ref image_error when it is
+     * not an image.
+     */
+    explicit image(const std::string& path)
+    {
+        map(path);
+        IMMER_TRY {
+            relocate();
+        }
+        IMMER_CATCH (...) {
+            unmap();
+            IMMER_RETHROW;
+        }
+#if IMMER_IMAGE_MMAP
+        ::mprotect(data_, size_, PROT_READ);
+#endif
+    }
+
+    /*!
+     * Opens the image in the `size` bytes at `data`, like the ones
+     * embedded in the program by @ref image_writer::write_source, which
+     * are used in place and must outlive it.  They have to be aligned
+     * like `std::max_align_t` and writable, since the pointers among
+     * the nodes are fixed up there when they were written for another
+     * address.  Throws @ref image_error when they are not an image.
+     */
+    image(void* data, std::size_t size)
+        : data_{static_cast<char*>(data)}
+        , size_{size}
+        , owned_{false}
+    {
+        auto addr = reinterpret_cast<std::uintptr_t>(data);
+        if (IMMER_UNLIKELY(addr % alignof(std::max_align_t) != 0))
+            fail();
+        relocate();
+    }
+
+    image(const image&) = delete;
+    image& operator=(const image&) = delete;
+
+    ~image() { unmap(); }
+
+    /*!
+     * Returns the number of containers in the image.
+     */
+    std::size_t size() const
+    {
+        return static_cast<std::size_t>(header().root_count);
+    }
+
+    /*!
+     * Whether the image was mapped at another address than the one it
+     * was written for, and thus it had to be fixed up.
+     */
+    bool relocated() const
+    {
+        return reinterpret_cast<std::uintptr_t>(data_) != header().base;
+    }
+
+    /*!
+     * Returns the container of type `Container` added to the image with
+     * the index `i`.  A @ref vector can also be taken as a @ref
+     * flex_vector.
+     */
+    template <typename Container>
+    Container root(std::size_t i) const
+    {
+        using impl_t =
+            std::decay_t<decltype(std::declval<const Container&>().impl())>;
+        if (IMMER_UNLIKELY(i >= size()))
+            IMMER_THROW(image_error{"no such root in the image"});
+        auto r = detail::image::root_t{};
+        std::memcpy(&r,
+                    data_ + header().roots + i * sizeof(detail::image::root_t),
+                    sizeof(r));
+        return Container{root_impl(r, type_t<impl_t>{})};
+    }
+
+private:
+    using root_kind = detail::image::root_kind;
+
+    template <typename T>
+    struct type_t
+    {};
+
+    template <typename T, typename MP, detail::rbts::bits_t B,
+              detail::rbts::bits_t BL>
+    auto root_impl(const detail::image::root_t& r,
+                   type_t<detail::rbts::rbtree<T, MP, B, BL>>) const
+    {
+        return root_rbts<detail::rbts::rbtree<T, MP, B, BL>>(r, false);
+    }
+
+    template <typename T, typename MP, detail::rbts::bits_t B,
+              detail::rbts::bits_t BL>
+    auto root_impl(const detail::image::root_t& r,
+                   type_t<detail::rbts::rrbtree<T, MP, B, BL>>) const
+    {
+        return root_rbts<detail::rbts::rrbtree<T, MP, B, BL>>(r, true);
+    }
+
+    template <typename T, typename Hash, typename Equal, typename MP,
+              detail::hamts::bits_t B>
+    auto root_impl(const detail::image::root_t& r,
+                   type_t<detail::hamts::champ<T, Hash, Equal, MP, B>>) const
+    {
+        using tree_t = detail::hamts::champ<T, Hash, Equal, MP, B>;
+        using node_t = typename tree_t::node_t;
+        detail::image::check_node<node_t>();
+        if (r.kind != static_cast<std::uint8_t>(root_kind::champ) ||
+            r.bits != B || r.cache_hashes != node_t::cache_hashes ||
+            r.value_size != sizeof(T))
+            IMMER_THROW(image_error{"unexpected root in the image"});
+        return tree_t{node<node_t>(r.root), static_cast<std::size_t>(r.size)};
+    }
+
+    template <typename Tree>
+    Tree root_rbts(const detail::image::root_t& r, bool allow_relaxed) const
+    {
+        using node_t = typename Tree::node_t;
+        detail::image::check_node<node_t>();
+        auto kind    = static_cast<root_kind>(r.kind);
+        auto kind_ok = kind == root_kind::rbtree ||
+                       (allow_relaxed && kind == root_kind::rrbtree);
+        if (!kind_ok || r.bits != node_t::bits ||
+            r.bits_leaf != node_t::bits_leaf ||
+            r.value_size != sizeof(typename node_t::value_t) ||
+            r.shift < node_t::bits_leaf ||
+            r.shift >= sizeof(std::size_t) * 8)
+            IMMER_THROW(image_error{"unexpected root in the image"});
+        return Tree{static_cast<std::size_t>(r.size),
+                    static_cast<detail::rbts::shift_t>(r.shift),
+                    node<node_t>(r.root),
+                    node<node_t>(r.tail)};
+    }
+
+    template <typename Node>
+    Node* node(std::uint64_t off) const
+    {
+        if (IMMER_UNLIKELY(off >= size_ || off % alignof(Node) != 0))
+            IMMER_THROW(image_error{"malformed image root"});
+        return reinterpret_cast<Node*>(data_ + off);
+    }
+
+    detail::image::header_t header() const
+    {
+        auto h = detail::image::header_t{};
+        std::memcpy(&h, data_, sizeof(h));
+        return h;
+    }
+
+    static void fail() { IMMER_THROW(image_error{"not an immer image"}); }
+
+    void map(const std::string& path)
+    {
+#if IMMER_IMAGE_MMAP
+        auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (IMMER_UNLIKELY(fd < 0))
+            IMMER_THROW(std::system_error(
+                errno, std::generic_category(), "opening " + path));
+        struct stat st;
+        if (IMMER_UNLIKELY(::fstat(fd, &st) != 0)) {
+            auto error = errno;
+            ::close(fd);
+            IMMER_THROW(std::system_error(
+                error, std::generic_category(), "reading " + path));
+        }
+        auto h = detail::image::header_t{};
+        if (IMMER_UNLIKELY(::pread(fd, &h, sizeof(h), 0) != sizeof(h))) {
+            ::close(fd);
+            fail();
+        }
+        // placing the image where it was written for is only a hint,
+        // the system picks another address if that one is taken
+        size_  = static_cast<std::size_t>(st.st_size);
+        auto p = ::mmap(reinterpret_cast<void*>(
+                            static_cast<std::uintptr_t>(h.base)),
+                        size_,
+                        PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE,
+                        fd,
+                        0);
+        auto error = errno;
+        ::close(fd);
+        if (IMMER_UNLIKELY(p == MAP_FAILED))
+            IMMER_THROW(std::system_error(
+                error, std::generic_category(), "mapping " + path));
+        data_ = static_cast<char*>(p);
+#else
+        auto in = std::ifstream{path, std::ios::binary};
+        if (IMMER_UNLIKELY(!in))
+            IMMER_THROW(std::system_error(
+                errno, std::generic_category(), "opening " + path));
+        auto bytes = std::vector<char>{std::istreambuf_iterator<char>{in},
+                                       std::istreambuf_iterator<char>{}};
+        size_      = bytes.size();
+        data_      = static_cast<char*>(std::malloc(size_ ? size_ : 1));
+        if (IMMER_UNLIKELY(!data_))
+            IMMER_THROW(std::bad_alloc{});
+        std::memcpy(data_, bytes.data(), size_);
+#endif
+    }
+
+    void unmap()
+    {
+        if (!owned_)
+            return;
+#if IMMER_IMAGE_MMAP
+        ::munmap(data_, size_);
+#else
+        std::free(data_);
+#endif
+    }
+
+    void relocate()
+    {
+        using namespace detail::image;
+        if (IMMER_UNLIKELY(size_ < sizeof(header_t)))
+            fail();
+        auto h = header();
+        if (std::memcmp(h.magic, magic, sizeof(magic)) != 0 ||
+            h.size != size_ || h.roots > size_ ||
+            h.root_count > (size_ - h.roots) / sizeof(root_t) ||
+            h.relocs > size_ || h.relocs % sizeof(std::uint64_t) != 0 ||
+            h.reloc_count > (size_ - h.relocs) / sizeof(std::uint64_t))
+            fail();
+        if (!relocated())
+            return;
+        auto delta = reinterpret_cast<std::uintptr_t>(data_) -
+                     static_cast<std::uintptr_t>(h.base);
+        auto slots = reinterpret_cast<const std::uint64_t*>(data_ + h.relocs);
+        for (auto i = slots, e = i + h.reloc_count; i != e; ++i) {
+            auto off = *i;
+            if (IMMER_UNLIKELY(off > size_ - sizeof(std::uintptr_t) ||
+                               off % alignof(std::uintptr_t) != 0))
+                fail();
+            auto p = std::uintptr_t{};
+            std::memcpy(&p, data_ + off, sizeof(p));
+            if (IMMER_UNLIKELY(p - h.base >= size_))
+                fail();
+            p += delta;
+            std::memcpy(data_ + off, &p, sizeof(p));
+        }
+    }
+
+    char* data_       = nullptr;
+    std::size_t size_ = 0;
+    bool owned_       = true;
+};
+
+} // namespace immer
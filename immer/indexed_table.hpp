@@ -0,0 +1,482 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/map.hpp>
+#include <immer/map_transient.hpp>
+#include <immer/memory_policy.hpp>
+#include <immer/set.hpp>
+#include <immer/table.hpp>
+#include <immer/table_transient.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace immer {
+
+/*!
+ * Secondary index for @a indexed_table.  `Fn` is the type of a
+ * function object, like the `KeyFn` of a table, such that `Fn{}(x)`
+ * returns the secondary key of the row `x`.  Many rows may share a
+ * secondary key.
+ */
+template <typename Fn, typename Hash = void, typename Equal = void>
+struct index_by
+{
+    using fn_type = Fn;
+
+    template <typename T>
+    using key_t = std::decay_t<decltype(Fn{}(std::declval<const T&>()))>;
+
+    template <typename T>
+    using hash_t = std::conditional_t<std::is_void<Hash>::value,
+                                      std::hash<key_t<T>>,
+                                      Hash>;
+
+    template <typename T>
+    using equal_t = std::conditional_t<std::is_void<Equal>::value,
+                                       std::equal_to<key_t<T>>,
+                                       Equal>;
+};
+
+namespace detail {
+
+template <typename Index, typename T, typename K, typename MemoryPolicy>
+using index_map_t = map<typename Index::template key_t<T>,
+                        set<K, std::hash<K>, std::equal_to<K>, MemoryPolicy>,
+                        typename Index::template hash_t<T>,
+                        typename Index::template equal_t<T>,
+                        MemoryPolicy>;
+
+// applies `op` to a persistent container, keeping the result, or to a
+// transient one, that is changed in place
+template <typename C, typename Op>
+void index_apply(C& c, Op&& op, std::false_type)
+{
+    const auto& cc = c;
+    c              = op(cc);
+}
+
+template <typename C, typename Op>
+void index_apply(C& c, Op&& op, std::true_type)
+{
+    op(c);
+}
+
+template <typename IsTransient, typename M, typename K>
+void index_add(M& m, const typename M::key_type& sk, const K& k)
+{
+    auto p = m.find(sk);
+    auto s = p ? p->insert(k) : typename M::mapped_type{}.insert(k);
+    index_apply(
+        m,
+        [&](auto& m) { return m.set(sk, std::move(s)); },
+        IsTransient{});
+}
+
+template <typename IsTransient, typename M, typename K>
+void index_remove(M& m, const typename M::key_type& sk, const K& k)
+{
+    if (auto p = m.find(sk)) {
+        auto s = p->erase(k);
+        if (s.empty())
+            index_apply(
+                m, [&](auto& m) { return m.erase(sk); }, IsTransient{});
+        else
+            index_apply(
+                m,
+                [&](auto& m) { return m.set(sk, std::move(s)); },
+                IsTransient{});
+    }
+}
+
+/*!
+ * The operations of @a indexed_table, shared by the persistent form,
+ * where `Table` and `Ms` are a ``table`` and a tuple of ``map``, and the
+ * transient one, where they are their transients.
+ */
+template <typename KeyFn, typename IsTransient, typename... Indexes>
+struct indexed_table_ops
+{
+    template <typename Ms, typename T, typename K, std::size_t... Is>
+    static void
+    add(Ms& ms, const T& v, const K& k, std::index_sequence<Is...>)
+    {
+        (void) std::initializer_list<int>{
+            (index_add<IsTransient>(
+                 std::get<Is>(ms), typename Indexes::fn_type{}(v), k),
+             0)...};
+    }
+
+    template <typename Ms, typename T, typename K, std::size_t... Is>
+    static void
+    remove(Ms& ms, const T& v, const K& k, std::index_sequence<Is...>)
+    {
+        (void) std::initializer_list<int>{
+            (index_remove<IsTransient>(
+                 std::get<Is>(ms), typename Indexes::fn_type{}(v), k),
+             0)...};
+    }
+
+    template <typename Table, typename Ms, typename T>
+    static void insert(Table& t, Ms& ms, T v)
+    {
+        auto seq = std::index_sequence_for<Indexes...>{};
+        auto k   = KeyFn{}(v);
+        if (auto old = t.find(k))
+            remove(ms, *old, k, seq);
+        add(ms, v, k, seq);
+        index_apply(
+            t,
+            [&](auto& t) { return t.insert(std::move(v)); },
+            IsTransient{});
+    }
+
+    template <typename Table, typename Ms, typename K, typename Fn>
+    static void update(Table& t, Ms& ms, K k, Fn&& fn)
+    {
+        using value_t = typename Table::value_type;
+        auto p        = t.find(k);
+        auto v        = KeyFn{}(std::forward<Fn>(fn)(p ? *p : value_t{}), k);
+        insert(t, ms, std::move(v));
+    }
+
+    template <typename Table, typename Ms, typename K, typename Fn>
+    static void update_if_exists(Table& t, Ms& ms, K k, Fn&& fn)
+    {
+        if (auto p = t.find(k))
+            insert(t, ms, KeyFn{}(std::forward<Fn>(fn)(*p), k));
+    }
+
+    template <typename Table, typename Ms, typename K>
+    static void erase(Table& t, Ms& ms, const K& k)
+    {
+        if (auto p = t.find(k)) {
+            remove(ms, *p, k, std::index_sequence_for<Indexes...>{});
+            index_apply(
+                t, [&](auto& t) { return t.erase(k); }, IsTransient{});
+        }
+    }
+};
+
+} // namespace detail
+
+template <typename T,
+          typename KeyFn,
+          typename MemoryPolicy,
+          typename... Indexes>
+class indexed_table_transient;
+
+/*!
+ * An @a table of values of type `T`, keyed by `KeyFn`, that also
+ * maintains a secondary index for every type in `Indexes`, usually an
+ * @a index_by.  Every index is a persistent ``map`` from the
+ * secondary key of the rows to the ``set`` of the primary keys of the
+ * rows with that secondary key.  It is updated by `insert`, `update`
+ * and `erase`, in the persistent and the @a transient forms, so the
+ * indexes share their structure across versions like any container.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    struct by_owner { int operator()(const task& t) const { ... } };
+ *    using store_t =
+ *        immer::indexed_table<task, immer::table_key_fn,
+ *                             immer::default_memory_policy,
+ *                             immer::index_by<by_owner>>;
+ *    auto s = store_t{}.insert(task{1, 42}).insert(task{2, 42});
+ *    s.for_each_by<0>(42, [](const task& t) { ... });
+ *
+ * .. note:: Every change of a row with a different secondary key
+ *    updates two entries of that index, one for the old key and one
+ *    for the new one.  Maintaining an index costs about as much as an
+ *    update of a ``map`` of sets.
+ *
+ * @endrst
+ */
+template <typename T,
+          typename KeyFn        = table_key_fn,
+          typename MemoryPolicy = default_memory_policy,
+          typename... Indexes>
+class indexed_table
+{
+public:
+    using table_type = immer::table<T,
+                                    KeyFn,
+                                    std::hash<table_key_t<KeyFn, T>>,
+                                    std::equal_to<table_key_t<KeyFn, T>>,
+                                    MemoryPolicy>;
+    using key_type   = typename table_type::key_type;
+    using value_type = T;
+    using size_type  = typename table_type::size_type;
+    using iterator   = typename table_type::iterator;
+
+    using transient_type =
+        indexed_table_transient<T, KeyFn, MemoryPolicy, Indexes...>;
+
+    /*!
+     * The type of the `I`-th index, a map from secondary keys to sets
+     * of primary keys.
+     */
+    template <std::size_t I>
+    using index_type = detail::index_map_t<
+        std::tuple_element_t<I, std::tuple<Indexes...>>,
+        T,
+        key_type,
+        MemoryPolicy>;
+
+    indexed_table() = default;
+
+    IMMER_NODISCARD iterator begin() const { return table_.begin(); }
+    IMMER_NODISCARD iterator end() const { return table_.end(); }
+    IMMER_NODISCARD size_type size() const { return table_.size(); }
+    IMMER_NODISCARD bool empty() const { return table_.empty(); }
+
+    IMMER_NODISCARD size_type count(const key_type& k) const
+    {
+        return table_.count(k);
+    }
+
+    IMMER_NODISCARD const T* find(const key_type& k) const
+    {
+        return table_.find(k);
+    }
+
+    IMMER_NODISCARD const T& operator[](const key_type& k) const
+    {
+        return table_[k];
+    }
+
+    /*!
+     * Returns the table of rows, indexed by primary key.
+     */
+    IMMER_NODISCARD const table_type& rows() const { return table_; }
+
+    /*!
+     * Returns the `I`-th index.
+     */
+    template <std::size_t I>
+    IMMER_NODISCARD const index_type<I>& index() const
+    {
+        return std::get<I>(indexes_);
+    }
+
+    /*!
+     * Returns the number of rows whose `I`-th secondary key is `sk`.
+     */
+    template <std::size_t I>
+    IMMER_NODISCARD size_type
+    count_by(const typename index_type<I>::key_type& sk) const
+    {
+        auto p = std::get<I>(indexes_).find(sk);
+        return p ? p->size() : 0;
+    }
+
+    /*!
+     * Calls `fn` with every row whose `I`-th secondary key is `sk`.
+     */
+    template <std::size_t I, typename Fn>
+    void for_each_by(const typename index_type<I>::key_type& sk,
+                     Fn&& fn) const
+    {
+        if (auto p = std::get<I>(indexes_).find(sk))
+            for (auto&& k : *p)
+                fn(table_[k]);
+    }
+
+    /*!
+     * Returns a table with `value`, replacing the row with the same
+     * key, if any, and with the indexes updated accordingly.
+     */
+    IMMER_NODISCARD indexed_table insert(value_type value) const
+    {
+        auto r = *this;
+        ops_t::insert(r.table_, r.indexes_, std::move(value));
+        return r;
+    }
+
+    /*!
+     * Returns `this->insert(fn((*this)[k]))`, with the key `k` set in
+     * the value returned by `fn`, like ``table::update``.
+     */
+    template <typename Fn>
+    IMMER_NODISCARD indexed_table update(key_type k, Fn&& fn) const
+    {
+        auto r = *this;
+        ops_t::update(
+            r.table_, r.indexes_, std::move(k), std::forward<Fn>(fn));
+        return r;
+    }
+
+    /*!
+     * Like `update`, but the table is unchanged when there is no row
+     * with key `k`.
+     */
+    template <typename Fn>
+    IMMER_NODISCARD indexed_table update_if_exists(key_type k, Fn&& fn) const
+    {
+        auto r = *this;
+        ops_t::update_if_exists(
+            r.table_, r.indexes_, std::move(k), std::forward<Fn>(fn));
+        return r;
+    }
+
+    /*!
+     * Returns a table without the row of key `k`, and without its
+     * entries in the indexes.
+     */
+    IMMER_NODISCARD indexed_table erase(const key_type& k) const
+    {
+        auto r = *this;
+        ops_t::erase(r.table_, r.indexes_, k);
+        return r;
+    }
+
+    IMMER_NODISCARD bool operator==(const indexed_table& other) const
+    {
+        return table_ == other.table_;
+    }
+    IMMER_NODISCARD bool operator!=(const indexed_table& other) const
+    {
+        return !(*this == other);
+    }
+
+    /*!
+     * Returns a @a transient form of this container, an
+     * `immer::indexed_table_transient`.
+     */
+    IMMER_NODISCARD transient_type transient() const
+    {
+        return transient_type{table_, indexes_};
+    }
+
+private:
+    friend transient_type;
+
+    using indexes_t = std::tuple<
+        detail::index_map_t<Indexes, T, key_type, MemoryPolicy>...>;
+    using ops_t =
+        detail::indexed_table_ops<KeyFn, std::false_type, Indexes...>;
+
+    indexed_table(table_type t, indexes_t ms)
+        : table_{std::move(t)}
+        , indexes_{std::move(ms)}
+    {}
+
+    table_type table_;
+    indexes_t indexes_;
+};
+
+/*!
+ * Mutable version of `immer::indexed_table`.  The rows and every index
+ * are changed in place through their own transients.
+ */
+template <typename T,
+          typename KeyFn,
+          typename MemoryPolicy,
+          typename... Indexes>
+class indexed_table_transient
+{
+public:
+    using persistent_type =
+        indexed_table<T, KeyFn, MemoryPolicy, Indexes...>;
+    using key_type   = typename persistent_type::key_type;
+    using value_type = T;
+    using size_type  = typename persistent_type::size_type;
+    using iterator   = typename persistent_type::iterator;
+
+    indexed_table_transient() = default;
+
+    IMMER_NODISCARD iterator begin() const { return table_.begin(); }
+    IMMER_NODISCARD iterator end() const { return table_.end(); }
+    IMMER_NODISCARD size_type size() const { return table_.size(); }
+    IMMER_NODISCARD bool empty() const { return table_.empty(); }
+
+    IMMER_NODISCARD size_type count(const key_type& k) const
+    {
+        return table_.count(k);
+    }
+
+    IMMER_NODISCARD const T* find(const key_type& k) const
+    {
+        return table_.find(k);
+    }
+
+    void insert(value_type value)
+    {
+        ops_t::insert(table_, indexes_, std::move(value));
+    }
+
+    template <typename Fn>
+    void update(key_type k, Fn&& fn)
+    {
+        ops_t::update(table_, indexes_, std::move(k), std::forward<Fn>(fn));
+    }
+
+    template <typename Fn>
+    void update_if_exists(key_type k, Fn&& fn)
+    {
+        ops_t::update_if_exists(
+            table_, indexes_, std::move(k), std::forward<Fn>(fn));
+    }
+
+    void erase(const key_type& k) { ops_t::erase(table_, indexes_, k); }
+
+    /*!
+     * Returns an immutable form of this container.
+     */
+    IMMER_NODISCARD persistent_type persistent() &
+    {
+        return {table_.persistent(),
+                persistent_indexes(std::index_sequence_for<Indexes...>{})};
+    }
+
+private:
+    friend persistent_type;
+
+    using indexes_t = std::tuple<typename detail::index_map_t<
+        Indexes,
+        T,
+        key_type,
+        MemoryPolicy>::transient_type...>;
+    using ops_t =
+        detail::indexed_table_ops<KeyFn, std::true_type, Indexes...>;
+
+    template <typename Ms>
+    indexed_table_transient(const typename persistent_type::table_type& t,
+                            const Ms& ms)
+        : indexed_table_transient{
+              t, ms, std::index_sequence_for<Indexes...>{}}
+    {}
+
+    template <typename Ms, std::size_t... Is>
+    indexed_table_transient(const typename persistent_type::table_type& t,
+                            const Ms& ms,
+                            std::index_sequence<Is...>)
+        : table_{t.transient()}
+        , indexes_{std::get<Is>(ms).transient()...}
+    {}
+
+    template <std::size_t... Is>
+    auto persistent_indexes(std::index_sequence<Is...>)
+    {
+        return typename persistent_type::indexes_t{
+            std::get<Is>(indexes_).persistent()...};
+    }
+
+    typename persistent_type::table_type::transient_type table_;
+    indexes_t indexes_;
+};
+
+} // namespace immer
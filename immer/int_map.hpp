@@ -0,0 +1,317 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/patricia/patricia.hpp>
+#include <immer/detail/patricia/patricia_iterator.hpp>
+#include <immer/memory_policy.hpp>
+
+#include <algorithm>
+#include <initializer_list>
+#include <stdexcept>
+#include <utility>
+
+namespace immer {
+
+/*!
+ * Immutable mapping of values from integer keys of type `K` to values
+ * of type `T`, that is sorted by the keys.
+ *
+ * @tparam K    The type of the keys, an integer type.
+ * @tparam T    The type of the values to be stored in the container.
+ * @tparam MemoryPolicy Memory management policy. See @ref
+ *              memory_policy.
+ *
+ * @rst
+ *
+ * This container is a big-endian Patricia trie, where every branch
+ * splits its keys by the highest bit in which they differ.  Unlike
+ * :cpp:class:`immer::map`, it does not hash the keys and it has no
+ * collisions: finding a key visits at most as many nodes as bits in
+ * the key, and usually about :math:`log_2(n)`.  Its associations are
+ * iterated in the order of the keys, and ``range()`` returns the ones
+ * in an interval of keys in :math:`O(log(n))`, sharing the subtrees
+ * that are in it.  Since the shape of the trie only depends on the
+ * keys in it, ``merge()`` can reuse the subtrees that are only in one
+ * of the maps, or that both share.
+ *
+ * .. code-block:: c++
+ *
+ *    auto m = immer::int_map<std::uint64_t, std::string>{}
+ *                 .set(42, "foo")
+ *                 .set(7, "bar")
+ *                 .set(1000, "baz");
+ *    for (auto& kv : m.range(0, 100))
+ *        // visits 7 and then 42
+ *
+ * @endrst
+ */
+template <typename K,
+          typename T,
+          typename MemoryPolicy = default_memory_policy>
+class int_map
+{
+    using impl_t  = detail::patricia::patricia<K, T, MemoryPolicy>;
+    using value_t = std::pair<K, T>;
+
+    struct default_value
+    {
+        const T& operator()() const
+        {
+            static T v{};
+            return v;
+        }
+    };
+
+public:
+    using key_type        = K;
+    using mapped_type     = T;
+    using value_type      = value_t;
+    using size_type       = detail::patricia::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference       = const value_type&;
+    using const_reference = const value_type&;
+
+    using iterator = detail::patricia::patricia_iterator<K, T, MemoryPolicy>;
+    using const_iterator = iterator;
+
+    using memory_policy_type = MemoryPolicy;
+
+    /*!
+     * Default constructor.  It creates a map of `size() == 0`.  It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    int_map() = default;
+
+    /*!
+     * Constructs a map containing the associations in `values`.  When
+     * a key appears more than once, the last value is kept.
+     */
+    int_map(std::initializer_list<value_type> values)
+    {
+        for (auto& v : values)
+            impl_.set_mut(v);
+    }
+
+    /*!
+     * Returns an iterator pointing at the association with the
+     * smallest key.  It allocates memory for the path to the current
+     * leaf.
+     */
+    IMMER_NODISCARD iterator begin() const { return {impl_}; }
+
+    /*!
+     * Returns an iterator pointing just after the association with the
+     * largest key.  It does not allocate memory.
+     */
+    IMMER_NODISCARD iterator end() const
+    {
+        return {impl_, typename iterator::end_t{}};
+    }
+
+    /*!
+     * Returns the number of associations in the map.  It does not
+     * allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD size_type size() const { return impl_.size(); }
+
+    /*!
+     * Returns `true` if there are no associations in the map.  It does
+     * not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD bool empty() const { return !impl_.root; }
+
+    /*!
+     * Returns `1` when the key `k` is contained in the map or `0`
+     * otherwise.  It does not allocate memory and its complexity is
+     * @f$ O(W) @f$, where @f$ W @f$ is the number of bits of `K`.
+     */
+    IMMER_NODISCARD size_type count(const K& k) const
+    {
+        return impl_.find(k) ? 1 : 0;
+    }
+
+    /*!
+     * Returns a `const` reference to the value associated to the key
+     * `k`.  If the key is not contained in the map, it returns a
+     * default constructed value.  It does not allocate memory and its
+     * complexity is @f$ O(W) @f$.
+     */
+    IMMER_NODISCARD const T& operator[](const K& k) const
+    {
+        auto p = find(k);
+        return p ? *p : default_value{}();
+    }
+
+    /*!
+     * Returns a `const` reference to the value associated to the key
+     * `k`.  If the key is not contained in the map, throws an
+     * `std::out_of_range` error.  It does not allocate memory and its
+     * complexity is @f$ O(W) @f$.
+     */
+    const T& at(const K& k) const
+    {
+        auto p = find(k);
+        if (!p)
+            IMMER_THROW(std::out_of_range{"key not found"});
+        return *p;
+    }
+
+    /*!
+     * Returns a pointer to the value associated with the key `k`.  If
+     * the key is not contained in the map, a `nullptr` is returned.
+     * It does not allocate memory and its complexity is @f$ O(W) @f$.
+     */
+    IMMER_NODISCARD const T* find(const K& k) const
+    {
+        auto p = impl_.find(k);
+        return p ? &p->second : nullptr;
+    }
+
+    /*!
+     * Returns the map with the associations whose key is in `[first,
+     * last)`, which shares with this one the subtrees wholly in that
+     * interval.  Its complexity is @f$ O(W) @f$ and iterating over the
+     * result visits only those associations.
+     */
+    IMMER_NODISCARD int_map range(const K& first, const K& last) const
+    {
+        if (!(first < last))
+            return {};
+        return impl_.range(first, static_cast<K>(last - 1));
+    }
+
+    /*!
+     * Returns whether the maps have the same associations.
+     */
+    IMMER_NODISCARD bool operator==(const int_map& other) const
+    {
+        return impl_.root == other.impl_.root ||
+               (size() == other.size() &&
+                std::equal(begin(), end(), other.begin()));
+    }
+
+    IMMER_NODISCARD bool operator!=(const int_map& other) const
+    {
+        return !(*this == other);
+    }
+
+    /*!
+     * Returns a map containing the association `value`.  If the key is
+     * already in the map, its value is replaced.  It may allocate
+     * memory and its complexity is @f$ O(W) @f$.
+     */
+    IMMER_NODISCARD int_map insert(value_type value) const&
+    {
+        auto r = impl_;
+        r.set_mut(std::move(value));
+        return r;
+    }
+    IMMER_NODISCARD int_map&& insert(value_type value) &&
+    {
+        impl_.set_mut(std::move(value));
+        return std::move(*this);
+    }
+
+    /*!
+     * Returns a map containing the association `(k, v)`, see
+     * `insert()`.
+     */
+    IMMER_NODISCARD int_map set(key_type k, mapped_type v) const&
+    {
+        return insert({std::move(k), std::move(v)});
+    }
+    IMMER_NODISCARD int_map&& set(key_type k, mapped_type v) &&
+    {
+        return std::move(*this).insert({std::move(k), std::move(v)});
+    }
+
+    /*!
+     * Returns a map replacing the association `(k, v)` by the new
+     * association `(k, fn(v))`, where `v` is the currently associated
+     * value for `k` in the map or a default constructed value
+     * otherwise.  Its complexity is @f$ O(W) @f$.
+     */
+    template <typename Fn>
+    IMMER_NODISCARD int_map update(key_type k, Fn&& fn) const&
+    {
+        auto p = find(k);
+        return set(std::move(k), std::forward<Fn>(fn)(p ? *p : T{}));
+    }
+    template <typename Fn>
+    IMMER_NODISCARD int_map&& update(key_type k, Fn&& fn) &&
+    {
+        auto p = find(k);
+        auto v = std::forward<Fn>(fn)(p ? *p : T{});
+        return std::move(*this).set(std::move(k), std::move(v));
+    }
+
+    /*!
+     * Returns a map without the key `k`.  If the key is not in the map
+     * it returns it unchanged.  Its complexity is @f$ O(W) @f$.
+     */
+    IMMER_NODISCARD int_map erase(const K& k) const&
+    {
+        if (!impl_.find(k))
+            return *this;
+        auto r = impl_;
+        r.erase_mut(k);
+        return r;
+    }
+    IMMER_NODISCARD int_map&& erase(const K& k) &&
+    {
+        impl_.erase_mut(k);
+        return std::move(*this);
+    }
+
+    /*!
+     * Returns a map with the associations of this map and of `other`.
+     * When a key is in both, it is associated to `fn(v1, v2)`, where
+     * `v1` is its value in this map and `v2` in `other`.  Both tries
+     * are traversed at once, comparing the prefixes of their branches,
+     * and the subtrees whose keys are only in one of them, or that
+     * both share, are reused without visiting them.
+     *
+     * @rst
+     *
+     * .. note:: Since the shared associations are not visited, ``fn(v,
+     *    v)`` must be equivalent to ``v``.
+     *
+     * @endrst
+     */
+    template <typename Fn>
+    IMMER_NODISCARD int_map merge(const int_map& other, Fn&& fn) const
+    {
+        auto combine = [&](const value_type& x, const value_type& y) {
+            return value_type{x.first, fn(x.second, y.second)};
+        };
+        return impl_.merge(other.impl_, combine);
+    }
+
+    /*!
+     * Returns a value that can be used as identity for the container.  If two
+     * values have the same identity, they are guaranteed to be equal and to
+     * contain the same objects.  However, two equal containers are not
+     * guaranteed to have the same identity.
+     */
+    void* identity() const { return impl_.root; }
+
+    // Semi-private
+    const impl_t& impl() const { return impl_; }
+
+    int_map(impl_t impl)
+        : impl_(std::move(impl))
+    {}
+
+private:
+    impl_t impl_ = impl_t::empty();
+};
+
+} // namespace immer
@@ -0,0 +1,568 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/hamts/champ.hpp>
+#include <immer/detail/rbts/operations.hpp>
+#include <immer/detail/rbts/subtree.hpp>
+#include <immer/merkle_cache.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+namespace immer {
+
+namespace detail {
+namespace intern {
+
+using merkle::combine;
+
+inline std::size_t hash_ptr(const void* p)
+{
+    return std::hash<const void*>{}(p);
+}
+
+// Every node is interned after its children, which are then canonical
+// themselves, so two nodes are structurally equal when they hold equal
+// elements and the very same children.  This keeps the comparisons
+// shallow and the hashes of a node independent of its subtree size.
+template <typename Tree, typename Hash, typename Equal>
+class rbts_table
+{
+    using node_t = typename Tree::node_t;
+    using sub_t  = rbts::subtree<node_t>;
+
+    static constexpr auto B  = node_t::bits;
+    static constexpr auto BL = node_t::bits_leaf;
+
+    struct entry
+    {
+        rbts::count_t level;
+        std::size_t size;
+        std::size_t hash;
+    };
+
+    using nodes_t   = std::unordered_map<node_t*, entry>;
+    using buckets_t = std::unordered_multimap<std::size_t, node_t*>;
+
+public:
+    rbts_table(Hash hash, Equal equal)
+        : hash_{std::move(hash)}
+        , equal_{std::move(equal)}
+    {}
+
+    rbts_table(rbts_table&& other)
+        : hash_{std::move(other.hash_)}
+        , equal_{std::move(other.equal_)}
+        , nodes_{std::move(other.nodes_)}
+        , buckets_{std::move(other.buckets_)}
+    {
+        other.nodes_.clear();
+        other.buckets_.clear();
+    }
+
+    ~rbts_table() { clear(); }
+
+    Tree intern(const Tree& t)
+    {
+        sub_t roots[2];
+        auto n        = rbts::root_subtrees(t, roots);
+        auto tail_off = t.tail_offset();
+        auto root     = tail_off ? intern_sub(roots[0]) : t.root->inc();
+        auto tail     = static_cast<node_t*>(nullptr);
+        IMMER_TRY {
+            tail = t.size > tail_off ? intern_sub(roots[n - 1]) : t.tail->inc();
+        }
+        IMMER_CATCH (...) {
+            if (tail_off)
+                release(root, roots[0].level, tail_off);
+            else
+                root->dec();
+            IMMER_RETHROW;
+        }
+        return Tree{t.size, t.shift, root, tail};
+    }
+
+    std::size_t size() const { return nodes_.size(); }
+
+    void trim()
+    {
+        for (auto again = true; again;) {
+            again = false;
+            for (auto it = nodes_.begin(); it != nodes_.end();) {
+                if (node_t::refs(it->first).unique()) {
+                    forget(it);
+                    it    = nodes_.erase(it);
+                    again = true;
+                } else
+                    ++it;
+            }
+        }
+    }
+
+    void clear()
+    {
+        for (auto it = nodes_.begin(); it != nodes_.end(); ++it)
+            release(it->first, it->second.level, it->second.size);
+        nodes_.clear();
+        buckets_.clear();
+    }
+
+private:
+    static void release(node_t* node, rbts::count_t level, std::size_t size)
+    {
+        if (level == 0)
+            rbts::dec_leaf(node, static_cast<rbts::count_t>(size));
+        else
+            rbts::dec_inner(
+                node, static_cast<rbts::shift_t>(BL + (level - 1) * B), size);
+    }
+
+    void forget(typename nodes_t::iterator it)
+    {
+        auto range = buckets_.equal_range(it->second.hash);
+        for (auto b = range.first; b != range.second; ++b)
+            if (b->second == it->first) {
+                buckets_.erase(b);
+                break;
+            }
+        release(it->first, it->second.level, it->second.size);
+    }
+
+    // Adds `node` to the table, that takes over one of its references
+    void remember(node_t* node, const sub_t& s, std::size_t hash)
+    {
+        auto it = nodes_.emplace(node, entry{s.level, s.size, hash}).first;
+        IMMER_TRY {
+            buckets_.emplace(hash, node);
+        }
+        IMMER_CATCH (...) {
+            nodes_.erase(it);
+            IMMER_RETHROW;
+        }
+    }
+
+    node_t* intern_sub(const sub_t& s)
+    {
+        if (nodes_.count(s.node))
+            return s.node->inc();
+        return s.level == 0 ? intern_leaf(s) : intern_inner(s);
+    }
+
+    node_t* intern_leaf(const sub_t& s)
+    {
+        auto data = s.node->leaf();
+        auto seed = std::size_t{s.size};
+        for (auto i = std::size_t{}; i < s.size; ++i)
+            seed = combine(seed, hash_(data[i]));
+        auto range = buckets_.equal_range(seed);
+        for (auto b = range.first; b != range.second; ++b) {
+            auto& e = nodes_.find(b->second)->second;
+            if (e.level == 0 && e.size == s.size &&
+                std::equal(data, data + s.size, b->second->leaf(), equal_))
+                return b->second->inc();
+        }
+        remember(s.node, s, seed);
+        s.node->inc();
+        return s.node->inc();
+    }
+
+    node_t* intern_inner(const sub_t& s)
+    {
+        node_t* kids[rbts::branches<B>];
+        std::size_t sizes[rbts::branches<B>];
+        auto n       = rbts::count_t{};
+        auto changed = false;
+        auto relaxed = s.node->relaxed();
+        IMMER_TRY {
+            rbts::each_subtree(s, s.first, s.last(), [&](auto&& c) {
+                kids[n]  = intern_sub(c);
+                sizes[n] = c.size;
+                changed  = changed || kids[n] != c.node;
+                ++n;
+            });
+            auto seed = combine(combine(s.level, s.size), relaxed != nullptr);
+            for (auto i = rbts::count_t{}; i < n; ++i)
+                seed = combine(seed, hash_ptr(kids[i]));
+            auto range = buckets_.equal_range(seed);
+            for (auto b = range.first; b != range.second; ++b) {
+                auto& e = nodes_.find(b->second)->second;
+                auto c  = b->second;
+                auto cr = c->relaxed();
+                if (e.level == s.level && e.size == s.size &&
+                    (cr != nullptr) == (relaxed != nullptr) &&
+                    (!cr || (cr->d.count == n &&
+                             std::equal(cr->d.sizes,
+                                        cr->d.sizes + n,
+                                        relaxed->d.sizes))) &&
+                    std::equal(kids, kids + n, c->inner())) {
+                    release_kids(kids, sizes, n, s.level);
+                    return c->inc();
+                }
+            }
+            if (!changed) {
+                remember(s.node, s, seed);
+                release_kids(kids, sizes, n, s.level);
+                s.node->inc();
+                return s.node->inc();
+            }
+            auto m =
+                relaxed ? node_t::make_inner_r_n(n) : node_t::make_inner_n(n);
+            if (relaxed) {
+                std::copy(relaxed->d.sizes,
+                          relaxed->d.sizes + n,
+                          m->relaxed()->d.sizes);
+                m->relaxed()->d.count = n;
+            }
+            std::copy(kids, kids + n, m->inner());
+            n = 0;
+            IMMER_TRY {
+                remember(m, s, seed);
+            }
+            IMMER_CATCH (...) {
+                release(m, s.level, s.size);
+                IMMER_RETHROW;
+            }
+            return m->inc();
+        }
+        IMMER_CATCH (...) {
+            release_kids(kids, sizes, n, s.level);
+            IMMER_RETHROW;
+        }
+    }
+
+    static void release_kids(node_t** kids,
+                             std::size_t* sizes,
+                             rbts::count_t n,
+                             rbts::count_t level)
+    {
+        for (auto i = rbts::count_t{}; i < n; ++i)
+            release(kids[i], level - 1, sizes[i]);
+    }
+
+    Hash hash_;
+    Equal equal_;
+    nodes_t nodes_;
+    buckets_t buckets_;
+};
+
+template <typename Tree, typename Hash, typename Equal>
+class champ_table
+{
+    using node_t = typename Tree::node_t;
+
+    static constexpr auto B = Tree::bits;
+
+    struct entry
+    {
+        hamts::count_t depth;
+        std::size_t hash;
+    };
+
+    using nodes_t   = std::unordered_map<node_t*, entry>;
+    using buckets_t = std::unordered_multimap<std::size_t, node_t*>;
+
+public:
+    champ_table(Hash hash, Equal equal)
+        : hash_{std::move(hash)}
+        , equal_{std::move(equal)}
+    {}
+
+    champ_table(champ_table&& other)
+        : hash_{std::move(other.hash_)}
+        , equal_{std::move(other.equal_)}
+        , nodes_{std::move(other.nodes_)}
+        , buckets_{std::move(other.buckets_)}
+    {
+        other.nodes_.clear();
+        other.buckets_.clear();
+    }
+
+    ~champ_table() { clear(); }
+
+    Tree intern(const Tree& t)
+    {
+        if (!t.size)
+            return t;
+        return Tree{intern_node(t.root, 0), t.size};
+    }
+
+    std::size_t size() const { return nodes_.size(); }
+
+    void trim()
+    {
+        for (auto again = true; again;) {
+            again = false;
+            for (auto it = nodes_.begin(); it != nodes_.end();) {
+                if (node_t::refs(it->first).unique()) {
+                    forget(it);
+                    it    = nodes_.erase(it);
+                    again = true;
+                } else
+                    ++it;
+            }
+        }
+    }
+
+    void clear()
+    {
+        for (auto it = nodes_.begin(); it != nodes_.end(); ++it)
+            release(it->first, it->second.depth);
+        nodes_.clear();
+        buckets_.clear();
+    }
+
+private:
+    static void release(node_t* node, hamts::count_t depth)
+    {
+        if (node->dec())
+            node_t::delete_deep(node, depth);
+    }
+
+    void forget(typename nodes_t::iterator it)
+    {
+        auto range = buckets_.equal_range(it->second.hash);
+        for (auto b = range.first; b != range.second; ++b)
+            if (b->second == it->first) {
+                buckets_.erase(b);
+                break;
+            }
+        release(it->first, it->second.depth);
+    }
+
+    void remember(node_t* node, hamts::count_t depth, std::size_t hash)
+    {
+        auto it = nodes_.emplace(node, entry{depth, hash}).first;
+        IMMER_TRY {
+            buckets_.emplace(hash, node);
+        }
+        IMMER_CATCH (...) {
+            nodes_.erase(it);
+            IMMER_RETHROW;
+        }
+    }
+
+    node_t* intern_node(node_t* node, hamts::count_t depth)
+    {
+        if (nodes_.count(node))
+            return node->inc();
+        return depth == hamts::max_depth<B> ? intern_collision(node, depth)
+                                            : intern_inner(node, depth);
+    }
+
+    node_t* intern_collision(node_t* node, hamts::count_t depth)
+    {
+        auto fst  = node->collisions();
+        auto cnt  = node->collision_count();
+        auto seed = std::size_t{cnt};
+        for (auto i = hamts::count_t{}; i < cnt; ++i)
+            seed = combine(seed, hash_(fst[i]));
+        auto range = buckets_.equal_range(seed);
+        for (auto b = range.first; b != range.second; ++b) {
+            auto c = b->second;
+            if (nodes_.find(c)->second.depth == depth &&
+                c->collision_count() == cnt &&
+                std::equal(fst, fst + cnt, c->collisions(), equal_))
+                return c->inc();
+        }
+        remember(node, depth, seed);
+        node->inc();
+        return node->inc();
+    }
+
+    node_t* intern_inner(node_t* node, hamts::count_t depth)
+    {
+        node_t* kids[hamts::branches<B>];
+        auto nk = node->children_count();
+        auto nv = node->data_count();
+        auto k  = hamts::count_t{};
+        IMMER_TRY {
+            for (; k < nk; ++k)
+                kids[k] = intern_node(node->children()[k], depth + 1);
+            auto seed = combine(node->datamap(), node->nodemap());
+            for (auto i = hamts::count_t{}; i < nv; ++i)
+                seed = combine(seed, hash_(node->values()[i]));
+            for (auto i = hamts::count_t{}; i < nk; ++i)
+                seed = combine(seed, hash_ptr(kids[i]));
+            auto range = buckets_.equal_range(seed);
+            for (auto b = range.first; b != range.second; ++b) {
+                auto c = b->second;
+                if (nodes_.find(c)->second.depth == depth &&
+                    c->datamap() == node->datamap() &&
+                    c->nodemap() == node->nodemap() &&
+                    std::equal(kids, kids + nk, c->children()) &&
+                    (!nv || c->values() == node->values() ||
+                     std::equal(node->values(),
+                                node->values() + nv,
+                                c->values(),
+                                equal_))) {
+                    release_kids(kids, k, depth);
+                    return c->inc();
+                }
+            }
+            if (std::equal(kids, kids + nk, node->children())) {
+                remember(node, depth, seed);
+                release_kids(kids, k, depth);
+                node->inc();
+                return node->inc();
+            }
+            auto m = node_t::make_inner_n_values_of(nk, node);
+            m->impl.d.data.inner.datamap = node->datamap();
+            m->impl.d.data.inner.nodemap = node->nodemap();
+            std::copy(kids, kids + nk, m->children());
+            k = 0;
+            IMMER_TRY {
+                remember(m, depth, seed);
+            }
+            IMMER_CATCH (...) {
+                release(m, depth);
+                IMMER_RETHROW;
+            }
+            return m->inc();
+        }
+        IMMER_CATCH (...) {
+            release_kids(kids, k, depth);
+            IMMER_RETHROW;
+        }
+    }
+
+    static void
+    release_kids(node_t** kids, hamts::count_t n, hamts::count_t depth)
+    {
+        for (auto i = hamts::count_t{}; i < n; ++i)
+            release(kids[i], depth + 1);
+    }
+
+    Hash hash_;
+    Equal equal_;
+    nodes_t nodes_;
+    buckets_t buckets_;
+};
+
+template <typename Tree, typename Hash, typename Equal>
+struct table_for
+{
+    using type = rbts_table<Tree, Hash, Equal>;
+};
+
+template <typename T,
+          typename H,
+          typename E,
+          typename MP,
+          hamts::bits_t B,
+          typename Hash,
+          typename Equal>
+struct table_for<hamts::champ<T, H, E, MP, B>, Hash, Equal>
+{
+    using type = champ_table<hamts::champ<T, H, E, MP, B>, Hash, Equal>;
+};
+
+} // namespace intern
+} // namespace detail
+
+/*!
+ * Keeps a canonical copy of every node of the containers of type
+ * `Container` that it interns, so that containers that were built
+ * independently share the nodes with the same contents.  It supports
+ * ``vector``, ``flex_vector``, ``map``, ``set`` and ``table``.
+ *
+ * @tparam Hash A function object that hashes one `value_type`.
+ * @tparam Equal A function object that compares two `value_type`.
+ *
+ * Interning walks the container bottom-up and replaces every node by
+ * the one in the table with the same elements and children, adding it
+ * to the table when there is none.  The subtrees that were interned
+ * already are recognized by their identity and not visited again.
+ * Containers that have been interned in the same table then share all
+ * their equal subtrees, taking that memory only once, and comparing
+ * them with `==` skips those subtrees without looking at their
+ * elements.
+ *
+ * @rst
+ *
+ * .. note:: As for the :cpp:class:`merkle_cache`, the shape of a
+ *    ``flex_vector`` depends on how it was built and only equal
+ *    subtrees with the same shape are shared.  The elements in the
+ *    nodes of a ``map`` or a ``set`` with colliding hashes are
+ *    compared in the order they were inserted.
+ *
+ * .. note:: The table holds a reference to every canonical node, so
+ *    those are never freed while it knows them.  Call ``trim()`` to
+ *    forget the nodes that are not used by any container any more, or
+ *    ``clear()`` to forget everything.  Because of this, it requires a
+ *    memory policy with reference counting.
+ *
+ * .. warning:: Only pass persistent values to the table.  The nodes
+ *    owned by a transient are updated in place.
+ *
+ * @endrst
+ */
+template <typename Container,
+          typename Hash  = merkle_hash<typename Container::value_type>,
+          typename Equal = std::equal_to<typename Container::value_type>>
+class intern_table
+{
+    using impl_t =
+        std::decay_t<decltype(std::declval<const Container&>().impl())>;
+    using table_t =
+        typename detail::intern::table_for<impl_t, Hash, Equal>::type;
+
+public:
+    explicit intern_table(Hash hash = {}, Equal equal = {})
+        : impl_{std::move(hash), std::move(equal)}
+    {}
+
+    intern_table(intern_table&&) = default;
+
+    intern_table(const intern_table&)            = delete;
+    intern_table& operator=(const intern_table&) = delete;
+    intern_table& operator=(intern_table&&)      = delete;
+
+    /*!
+     * Returns a container equal to `c` built out of the canonical
+     * nodes of the table.
+     */
+    Container intern(const Container& c) { return impl_.intern(c.impl()); }
+
+    /*!
+     * Returns the number of canonical nodes in the table.
+     */
+    std::size_t size() const { return impl_.size(); }
+
+    /*!
+     * Forgets the nodes that are only referenced by the table itself.
+     */
+    void trim() { impl_.trim(); }
+
+    /*!
+     * Forgets all the nodes.
+     */
+    void clear() { impl_.clear(); }
+
+private:
+    table_t impl_;
+};
+
+/*!
+ * Returns a container equal to `c` that shares its nodes with the
+ * containers interned before in `table`.  See @ref intern_table.
+ */
+template <typename Container, typename Hash, typename Equal>
+Container intern(const Container& c,
+                 intern_table<Container, Hash, Equal>& table)
+{
+    return table.intern(c);
+}
+
+} // namespace immer
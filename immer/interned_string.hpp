@@ -0,0 +1,322 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/util.hpp>
+#include <immer/memory_policy.hpp>
+#include <immer/refcount/no_refcount_policy.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+namespace immer {
+
+namespace detail {
+
+/*!
+ * The table of the live interned strings of a memory policy.  It is
+ * split in shards, each behind its own lock, by the hash of the
+ * strings, and it only holds weak references: a string is removed
+ * from it when its last handle goes away.
+ */
+template <typename MemoryPolicy>
+class interned_string_table
+{
+public:
+    struct node : MemoryPolicy::refcount
+    {
+        std::size_t hash;
+        std::string str;
+
+        node(std::size_t h, std::string s)
+            : hash{h}
+            , str{std::move(s)}
+        {}
+    };
+
+    static interned_string_table& instance()
+    {
+        // never destroyed, the strings in other statics may outlive it
+        static auto t = new interned_string_table{};
+        return *t;
+    }
+
+    node* intern(std::string s)
+    {
+        auto h  = std::hash<std::string>{}(s);
+        auto& b = shard(h);
+        scoped_lock_t l{b.lock};
+        auto r = b.nodes.equal_range(h);
+        for (auto it = r.first; it != r.second; ++it) {
+            if (it->second->str == s) {
+                it->second->inc();
+                return it->second;
+            }
+        }
+        auto p = detail::make<heap, node>(h, std::move(s));
+        IMMER_TRY {
+            b.nodes.emplace(h, p);
+        }
+        IMMER_CATCH (...) {
+            destroy(p);
+            IMMER_RETHROW;
+        }
+        return p;
+    }
+
+    // drops a reference to `p`, under the lock of its shard, so that
+    // it can not be found again while it is being removed
+    void release(node* p)
+    {
+        auto& b = shard(p->hash);
+        scoped_lock_t l{b.lock};
+        if (p->dec()) {
+            auto r = b.nodes.equal_range(p->hash);
+            for (auto it = r.first; it != r.second; ++it) {
+                if (it->second == p) {
+                    b.nodes.erase(it);
+                    break;
+                }
+            }
+            destroy(p);
+        }
+    }
+
+    std::size_t size()
+    {
+        auto n = std::size_t{};
+        for (auto& b : shards_) {
+            scoped_lock_t l{b.lock};
+            n += b.nodes.size();
+        }
+        return n;
+    }
+
+private:
+    using heap          = typename MemoryPolicy::heap::type;
+    using lock_t        = typename MemoryPolicy::lock;
+    using scoped_lock_t = typename lock_t::scoped_lock;
+
+    static constexpr auto shard_count = std::size_t{16};
+
+    struct shard_t
+    {
+        lock_t lock;
+        std::unordered_multimap<std::size_t, node*> nodes;
+    };
+
+    interned_string_table() = default;
+
+    shard_t& shard(std::size_t hash) { return shards_[hash % shard_count]; }
+
+    static void destroy(node* p)
+    {
+        p->~node();
+        heap::deallocate(sizeof(node), p);
+    }
+
+    shard_t shards_[shard_count];
+};
+
+} // namespace detail
+
+/*!
+ * Immutable string of which there is only one copy in memory for
+ * every distinct content.  Building one looks it up in a table of the
+ * interned strings and shares the copy that is already there, if any.
+ * It is then compared by identity, and its hash is computed once,
+ * when the string is first interned.  Since `std::hash` and
+ * `operator==` use them, the hash tries of @ref map and @ref set keyed
+ * by interned strings never hash a string nor compare its characters.
+ *
+ * Handles are reference counted like a @ref box and the string is
+ * removed from the table when the last handle to it goes away.
+ *
+ * @tparam MemoryPolicy Memory management policy, its reference count
+ *         and heap are used for the strings, and its lock for the
+ *         table.  See @ref memory_policy.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    auto a = immer::interned_string{"key"};
+ *    auto b = immer::interned_string{std::string{"key"}};
+ *    assert(a == b && &a.str() == &b.str());
+ *    auto m = immer::map<immer::interned_string, int>{}.set(a, 42);
+ *
+ * .. note:: Building an interned string takes the lock of a shard of
+ *    the table and so does dropping the last handle to one.  Copies of
+ *    a handle that already exists just increment its reference count.
+ *    Intern the keys once, at the edges of the program, and keep the
+ *    handles around.
+ *
+ * @endrst
+ */
+template <typename MemoryPolicy = default_memory_policy>
+class basic_interned_string
+{
+    static_assert(!std::is_same<typename MemoryPolicy::refcount,
+                                no_refcount_policy>::value,
+                  "interned strings need a reference count to be released");
+
+    using table_t = detail::interned_string_table<MemoryPolicy>;
+    using node_t  = typename table_t::node;
+
+public:
+    using memory_policy = MemoryPolicy;
+    using size_type     = std::size_t;
+
+    /*!
+     * Constructs the empty string, which is never in the table.
+     */
+    basic_interned_string() = default;
+
+    /*!
+     * Constructs the interned string with the contents of `s`.
+     */
+    explicit basic_interned_string(std::string s)
+        : impl_{s.empty() ? nullptr : table_t::instance().intern(std::move(s))}
+    {}
+
+    explicit basic_interned_string(const char* s)
+        : basic_interned_string{std::string{s}}
+    {}
+
+    basic_interned_string(const basic_interned_string& other)
+        : impl_{other.impl_}
+    {
+        if (impl_)
+            impl_->inc();
+    }
+
+    basic_interned_string(basic_interned_string&& other)
+        : impl_{other.impl_}
+    {
+        other.impl_ = nullptr;
+    }
+
+    basic_interned_string& operator=(const basic_interned_string& other)
+    {
+        auto aux = other;
+        swap(*this, aux);
+        return *this;
+    }
+
+    basic_interned_string& operator=(basic_interned_string&& other)
+    {
+        swap(*this, other);
+        return *this;
+    }
+
+    ~basic_interned_string()
+    {
+        if (impl_)
+            table_t::instance().release(impl_);
+    }
+
+    friend void swap(basic_interned_string& a, basic_interned_string& b)
+    {
+        using std::swap;
+        swap(a.impl_, b.impl_);
+    }
+
+    /*!
+     * Returns the contents of the string.  All the equal interned
+     * strings return the same object.
+     */
+    IMMER_NODISCARD const std::string& str() const
+    {
+        return impl_ ? impl_->str : empty_str();
+    }
+
+    operator const std::string&() const { return str(); }
+
+    IMMER_NODISCARD const char* c_str() const { return str().c_str(); }
+
+    IMMER_NODISCARD size_type size() const { return str().size(); }
+
+    IMMER_NODISCARD bool empty() const { return !impl_; }
+
+    /*!
+     * Returns the hash of the contents, as computed by
+     * `std::hash<std::string>` when it was interned.
+     */
+    IMMER_NODISCARD std::size_t hash() const
+    {
+        return impl_ ? impl_->hash : empty_hash();
+    }
+
+    /*!
+     * Returns whether the two strings have the same contents, which
+     * for interned strings means that they are the same object.
+     */
+    IMMER_NODISCARD bool operator==(const basic_interned_string& b) const
+    {
+        return impl_ == b.impl_;
+    }
+    IMMER_NODISCARD bool operator!=(const basic_interned_string& b) const
+    {
+        return impl_ != b.impl_;
+    }
+
+    /*!
+     * Orders the strings by their contents.
+     */
+    IMMER_NODISCARD bool operator<(const basic_interned_string& b) const
+    {
+        return impl_ != b.impl_ && str() < b.str();
+    }
+
+    /*!
+     * Returns the number of distinct strings that are currently
+     * interned with this memory policy.
+     */
+    static size_type interned_count() { return table_t::instance().size(); }
+
+private:
+    static const std::string& empty_str()
+    {
+        static const auto s = std::string{};
+        return s;
+    }
+
+    static std::size_t empty_hash()
+    {
+        static const auto h = std::hash<std::string>{}(std::string{});
+        return h;
+    }
+
+    node_t* impl_ = nullptr;
+};
+
+/*!
+ * An interned string with the default memory policy.
+ */
+using interned_string = basic_interned_string<>;
+
+} // namespace immer
+
+namespace std {
+
+template <typename MP>
+struct hash<immer::basic_interned_string<MP>>
+{
+    std::size_t operator()(const immer::basic_interned_string<MP>& x) const
+    {
+        return x.hash();
+    }
+};
+
+} // namespace std
@@ -0,0 +1,327 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/interval/interval_iterator.hpp>
+#include <immer/detail/interval/interval_tree.hpp>
+#include <immer/memory_policy.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <stdexcept>
+#include <utility>
+
+namespace immer {
+
+/*!
+ * Immutable mapping of values from half-open intervals of endpoints of
+ * type `K`, the pairs `{first, last}` that contain the points `p` such
+ * that `first <= p < last`, to values of type `T`, that can find the
+ * intervals that overlap another one or contain a point.
+ *
+ * @tparam K    The type of the endpoints of the intervals.
+ * @tparam T    The type of the values to be stored in the container.
+ * @tparam Compare The type of a function object that orders values of
+ *              type `K`.
+ * @tparam MemoryPolicy Memory management policy. See @ref
+ *              memory_policy.
+ *
+ * @rst
+ *
+ * The intervals are sorted by their start and then by their end in a
+ * balanced binary tree, where every node also remembers the greatest
+ * end in its subtree.  Thus, updates take :math:`O(log(n))` and copy
+ * only the nodes on the path to the changed interval, sharing the
+ * rest with the previous version, and finding the :math:`k` intervals
+ * that overlap a query skips the subtrees that end before it, which
+ * takes :math:`O(log(n) + k)` when they do not nest deeply and
+ * :math:`O(k log(n))` at worst.  Several associations may have
+ * overlapping or equal intervals, but an interval is only associated
+ * to one value.
+ *
+ * .. code-block:: c++
+ *
+ *    auto regions = immer::interval_map<std::uint64_t, std::string>{}
+ *                       .set({0x1000, 0x2000}, "text")
+ *                       .set({0x2000, 0x3000}, "data")
+ *                       .set({0x1800, 0x2800}, "mapped");
+ *    regions.for_each_containing(0x2400, [](auto& r) {
+ *        // visits "data" and "mapped"
+ *    });
+ *
+ * @endrst
+ */
+template <typename K,
+          typename T,
+          typename Compare      = std::less<K>,
+          typename MemoryPolicy = default_memory_policy>
+class interval_map
+{
+    using impl_t =
+        detail::interval::interval_tree<K, T, Compare, MemoryPolicy>;
+
+    struct default_value
+    {
+        const T& operator()() const
+        {
+            static T v{};
+            return v;
+        }
+    };
+
+public:
+    using interval_type   = std::pair<K, K>;
+    using key_type        = interval_type;
+    using mapped_type     = T;
+    using value_type      = std::pair<interval_type, T>;
+    using size_type       = detail::interval::size_t;
+    using difference_type = std::ptrdiff_t;
+    using key_compare     = Compare;
+    using reference       = const value_type&;
+    using const_reference = const value_type&;
+
+    using iterator =
+        detail::interval::interval_iterator<K, T, Compare, MemoryPolicy>;
+    using const_iterator = iterator;
+
+    using memory_policy_type = MemoryPolicy;
+
+    /*!
+     * Default constructor.  It creates a map of `size() == 0`.  It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    interval_map() = default;
+
+    /*!
+     * Constructs a map containing the associations in `values`.  When
+     * an interval appears more than once, the last value is kept.
+     */
+    interval_map(std::initializer_list<value_type> values)
+    {
+        auto owner = typename MemoryPolicy::transience_t::owner{};
+        for (auto& v : values)
+            impl_.set_mut(owner, true, v);
+    }
+
+    /*!
+     * Returns an iterator pointing at the association with the first
+     * interval, the one that starts first or, among those, ends first.
+     * It allocates memory for the path to the current node.
+     */
+    IMMER_NODISCARD iterator begin() const { return {impl_}; }
+
+    /*!
+     * Returns an iterator pointing just after the association with the
+     * last interval.  It does not allocate memory.
+     */
+    IMMER_NODISCARD iterator end() const
+    {
+        return {impl_, typename iterator::end_t{}};
+    }
+
+    /*!
+     * Returns the number of associations in the map.  It does not
+     * allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD size_type size() const { return impl_.size; }
+
+    /*!
+     * Returns `true` if there are no associations in the map.  It does
+     * not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD bool empty() const { return impl_.size == 0; }
+
+    /*!
+     * Returns `1` when the interval `k` is a key of the map or `0`
+     * otherwise.  It does not allocate memory and its complexity is
+     * @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD size_type count(const interval_type& k) const
+    {
+        return impl_.find(k) ? 1 : 0;
+    }
+
+    /*!
+     * Returns a `const` reference to the value associated to the
+     * interval `k`.  If it is not a key of the map, it returns a
+     * default constructed value.  It does not allocate memory and its
+     * complexity is @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD const T& operator[](const interval_type& k) const
+    {
+        auto p = find(k);
+        return p ? *p : default_value{}();
+    }
+
+    /*!
+     * Returns a `const` reference to the value associated to the
+     * interval `k`.  If it is not a key of the map, throws an
+     * `std::out_of_range` error.  It does not allocate memory and its
+     * complexity is @f$ O(log(n)) @f$.
+     */
+    const T& at(const interval_type& k) const
+    {
+        auto p = find(k);
+        if (!p)
+            IMMER_THROW(std::out_of_range{"interval not found"});
+        return *p;
+    }
+
+    /*!
+     * Returns a pointer to the value associated with the interval `k`,
+     * which must be equal to a key, not just overlap it.  If there is
+     * none, a `nullptr` is returned.  It does not allocate memory and
+     * its complexity is @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD const T* find(const interval_type& k) const
+    {
+        auto p = impl_.find(k);
+        return p ? &p->second : nullptr;
+    }
+
+    /*!
+     * Calls `fn` with every association whose interval overlaps
+     * `[first, last)`, in order.  It does not allocate memory and its
+     * complexity is @f$ O(log(n) + k) @f$, where @f$ k @f$ is the
+     * number of such associations, when the intervals do not nest
+     * deeply, and @f$ O(k log(n)) @f$ at worst.
+     */
+    template <typename Fn>
+    void for_each_overlapping(const K& first, const K& last, Fn&& fn) const
+    {
+        impl_t::for_each_overlapping(impl_.root, first, last, fn);
+    }
+
+    /*!
+     * Calls `fn` with every association whose interval contains the
+     * point `p`, in order.  It does not allocate memory and its
+     * complexity is @f$ O(log(n) + k) @f$ like
+     * `for_each_overlapping()`.
+     */
+    template <typename Fn>
+    void for_each_containing(const K& p, Fn&& fn) const
+    {
+        impl_t::for_each_containing(impl_.root, p, fn);
+    }
+
+    /*!
+     * Returns whether some interval overlaps `[first, last)`.  It
+     * does not allocate memory and its complexity is
+     * @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD bool overlaps(const K& first, const K& last) const
+    {
+        return impl_.any_overlapping(first, last);
+    }
+
+    /*!
+     * Returns whether the maps have the same associations.
+     */
+    IMMER_NODISCARD bool operator==(const interval_map& other) const
+    {
+        return impl_.root == other.impl_.root ||
+               (size() == other.size() &&
+                std::equal(begin(), end(), other.begin()));
+    }
+
+    IMMER_NODISCARD bool operator!=(const interval_map& other) const
+    {
+        return !(*this == other);
+    }
+
+    /*!
+     * Returns a map containing the association `value`.  If its
+     * interval is already a key of the map, its value is replaced.  It
+     * may allocate memory and its complexity is @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD interval_map insert(value_type value) const&
+    {
+        auto r = impl_;
+        r.set_mut(impl_t::noone(), false, std::move(value));
+        return r;
+    }
+    IMMER_NODISCARD interval_map&& insert(value_type value) &&
+    {
+        impl_.set_mut(impl_t::noone(), false, std::move(value));
+        return std::move(*this);
+    }
+
+    /*!
+     * Returns a map containing the association `(k, v)`, see
+     * `insert()`.
+     */
+    IMMER_NODISCARD interval_map set(interval_type k, mapped_type v) const&
+    {
+        return insert({std::move(k), std::move(v)});
+    }
+    IMMER_NODISCARD interval_map&& set(interval_type k, mapped_type v) &&
+    {
+        return std::move(*this).insert({std::move(k), std::move(v)});
+    }
+
+    /*!
+     * Returns a map replacing the association `(k, v)` by the new
+     * association `(k, fn(v))`, where `v` is the currently associated
+     * value for the interval `k` in the map or a default constructed
+     * value otherwise.  Its complexity is @f$ O(log(n)) @f$.
+     */
+    template <typename Fn>
+    IMMER_NODISCARD interval_map update(interval_type k, Fn&& fn) const&
+    {
+        auto p = find(k);
+        return set(std::move(k), std::forward<Fn>(fn)(p ? *p : T{}));
+    }
+    template <typename Fn>
+    IMMER_NODISCARD interval_map&& update(interval_type k, Fn&& fn) &&
+    {
+        auto p = find(k);
+        auto v = std::forward<Fn>(fn)(p ? *p : T{});
+        return std::move(*this).set(std::move(k), std::move(v));
+    }
+
+    /*!
+     * Returns a map without the interval `k`, which must be equal to a
+     * key to be removed.  Its complexity is @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD interval_map erase(const interval_type& k) const&
+    {
+        if (!impl_.find(k))
+            return *this;
+        auto r = impl_;
+        r.erase_mut(impl_t::noone(), false, k);
+        return r;
+    }
+    IMMER_NODISCARD interval_map&& erase(const interval_type& k) &&
+    {
+        impl_.erase_mut(impl_t::noone(), false, k);
+        return std::move(*this);
+    }
+
+    /*!
+     * Returns a value that can be used as identity for the container.  If two
+     * values have the same identity, they are guaranteed to be equal and to
+     * contain the same objects.  However, two equal containers are not
+     * guaranteed to have the same identity.
+     */
+    void* identity() const { return impl_.root; }
+
+    // Semi-private
+    const impl_t& impl() const { return impl_; }
+
+    interval_map(impl_t impl)
+        : impl_(std::move(impl))
+    {}
+
+private:
+    impl_t impl_ = impl_t::empty();
+};
+
+} // namespace immer
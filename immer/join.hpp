@@ -0,0 +1,345 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/box.hpp>
+#include <immer/executor.hpp>
+#include <immer/map.hpp>
+#include <immer/map_transient.hpp>
+#include <immer/par_build.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace immer {
+
+namespace detail {
+namespace hamts {
+
+// A pair of subtrees at `depth` of the tries being joined, or the
+// subtree `na` and the value `vb` at the same bit, whose hash is `hb`.
+// `nb` is null when only the first trie has the subtree.
+template <typename NodeA, typename NodeB, typename ValueB>
+struct join_task
+{
+    const NodeA* na;
+    const NodeB* nb;
+    const ValueB* vb;
+    hash_t hb;
+    count_t depth;
+};
+
+// Walks the tries of the maps `a` and `b` side by side, which have the
+// same hash function and branching, so the subtrees at the same bits
+// hold the keys with the same hash prefix.  The bits of `b` alone are
+// skipped, as are those of `a` alone unless `left`, and where one side
+// has a value and the other a subtree, the key is looked up in the
+// subtree only.  `emit(pa, pb)` is called with every pair of `a` and
+// the pair of `b` with its key, or null when `b` does not have it.
+template <typename ChampA,
+          typename ChampB,
+          typename StorageA,
+          typename StorageB,
+          typename Equal,
+          typename Emit>
+struct map_join
+{
+    using node_a   = typename ChampA::node_t;
+    using node_b   = typename ChampB::node_t;
+    using bitmap_t = typename ChampA::bitmap_t;
+    using value_b  = std::decay_t<decltype(*std::declval<node_b>().values())>;
+    using pair_b   = std::decay_t<decltype(StorageB::get(
+        std::declval<const value_b&>()))>;
+    using task_t   = join_task<node_a, node_b, value_b>;
+
+    static constexpr auto B = ChampA::bits;
+
+    const ChampA& a;
+    bool left;
+    Emit& emit;
+    // where the subtrees at `fork_depth` go instead of being walked
+    std::vector<task_t>* tasks;
+    count_t fork_depth;
+
+    template <typename Storage, typename Node, typename K>
+    static auto find(const Node* node, count_t depth, const K& k, hash_t h)
+        -> decltype(node->values())
+    {
+        auto frag = depth < max_depth<B> ? h >> (B * depth) : hash_t{};
+        for (; depth < max_depth<B>; ++depth, frag >>= B) {
+            auto bit = bitmap_t{1u} << (frag & mask<B>);
+            if (node->nodemap() & bit)
+                node = node->children()[node->children_count(bit)];
+            else if (node->datamap() & bit) {
+                auto v = node->values() + node->data_count(bit);
+                return Equal{}(Storage::get(*v).first, k) ? v : nullptr;
+            } else
+                return nullptr;
+        }
+        auto fst = node->collisions();
+        auto lst = fst + node->collision_count();
+        for (; fst != lst; ++fst)
+            if (Equal{}(Storage::get(*fst).first, k))
+                return fst;
+        return nullptr;
+    }
+
+    void run(const task_t& t)
+    {
+        if (t.vb)
+            walk_value(t.na, StorageB::get(*t.vb), t.hb, t.depth);
+        else if (t.nb)
+            walk(t.na, t.nb, t.depth);
+        else
+            walk_left(t.na, t.depth);
+    }
+
+    void walk_left(const node_a* na, count_t depth)
+    {
+        a.for_each_chunk_traversal(na, depth, [&](auto f, auto l) {
+            for (; f != l; ++f)
+                emit(StorageA::get(*f), static_cast<const pair_b*>(nullptr));
+        });
+    }
+
+    // the values of the subtree `na` with `pb`, which has the hash `hb`
+    void walk_value(const node_a* na, const pair_b& pb, hash_t hb, count_t d)
+    {
+        if (!left) {
+            if (auto va = find<StorageA>(na, d, pb.first, hb))
+                emit(StorageA::get(*va), &pb);
+            return;
+        }
+        a.for_each_chunk_traversal(na, d, [&](auto f, auto l) {
+            for (; f != l; ++f) {
+                auto& pa = StorageA::get(*f);
+                emit(pa, Equal{}(pa.first, pb.first) ? &pb : nullptr);
+            }
+        });
+    }
+
+    void walk(const node_a* na, const node_b* nb, count_t depth)
+    {
+        if (depth >= max_depth<B>) {
+            auto fst = na->collisions();
+            auto lst = fst + na->collision_count();
+            for (; fst != lst; ++fst) {
+                auto& pa = StorageA::get(*fst);
+                auto vb  = find<StorageB>(nb, depth, pa.first, hash_t{});
+                if (vb || left)
+                    emit(pa, vb ? &StorageB::get(*vb) : nullptr);
+            }
+            return;
+        }
+        auto anodes = na->nodemap();
+        auto bnodes = nb->nodemap();
+        auto bdata  = nb->datamap();
+        auto bits   = anodes | na->datamap();
+        if (!left)
+            bits &= bnodes | bdata;
+        for (auto bit : set_bits_range<bitmap_t>(bits)) {
+            if (anodes & bit) {
+                auto ca = na->children()[na->children_count(bit)];
+                auto t  = task_t{ca, nullptr, nullptr, 0, depth + 1};
+                if (bnodes & bit)
+                    t.nb = nb->children()[nb->children_count(bit)];
+                else if (bdata & bit) {
+                    auto offset = nb->data_count(bit);
+                    t.vb        = nb->values() + offset;
+                    t.hb        = ChampB::value_hash(nb, offset);
+                }
+                if (tasks && depth + 1 == fork_depth)
+                    tasks->push_back(t);
+                else
+                    run(t);
+            } else {
+                auto offset = na->data_count(bit);
+                auto& pa    = StorageA::get(na->values()[offset]);
+                auto ha     = ChampA::value_hash(na, offset);
+                auto vb     = static_cast<const value_b*>(nullptr);
+                if (bnodes & bit) {
+                    auto cb = nb->children()[nb->children_count(bit)];
+                    vb      = find<StorageB>(cb, depth + 1, pa.first, ha);
+                } else if (bdata & bit) {
+                    auto v = nb->values() + nb->data_count(bit);
+                    if (ChampB::value_hash(nb, v - nb->values()) == ha &&
+                        Equal{}(StorageB::get(*v).first, pa.first))
+                        vb = v;
+                }
+                if (vb || left)
+                    emit(pa, vb ? &StorageB::get(*vb) : nullptr);
+            }
+        }
+    }
+};
+
+} // namespace hamts
+
+// Joins the maps `a` and `b` into a map of type `Map`, calling
+// `emit(t, pa, pb)` to set the result of every pair into the transient
+// `t`.  The tries are walked sequentially down to the depth where there
+// are enough subtrees for the workers of `ex`, and the ones below are
+// joined in parallel, each into a transient of its own.  Their keys are
+// disjoint, so merging the results does not combine any value.
+template <typename Map,
+          typename MapA,
+          typename MapB,
+          typename Emit,
+          typename Executor>
+Map par_map_join(
+    const MapA& a, const MapB& b, bool left, Emit&& emit, Executor& ex)
+{
+    using champ_a   = std::decay_t<decltype(a.impl())>;
+    using champ_b   = std::decay_t<decltype(b.impl())>;
+    using storage_a = stored_value<typename MapA::value_type,
+                                   typename MapA::memory_policy_type>;
+    using storage_b = stored_value<typename MapB::value_type,
+                                   typename MapB::memory_policy_type>;
+    using equal_t   = typename MapA::key_equal;
+    using task_t    = typename hamts::
+        map_join<champ_a, champ_b, storage_a, storage_b, equal_t, int>::task_t;
+
+    auto with_joiner = [&](auto& t, auto* tasks, hamts::count_t d, auto&& fn) {
+        auto sink = [&](auto& pa, auto* pb) { emit(t, pa, pb); };
+        using join_t = hamts::map_join<champ_a,
+                                       champ_b,
+                                       storage_a,
+                                       storage_b,
+                                       equal_t,
+                                       decltype(sink)>;
+        fn(join_t{a.impl(), left, sink, tasks, d});
+    };
+
+    // enough subtrees for every worker, each with enough keys to join
+    auto parts = std::min(ex.concurrency() * bulk_oversubscription,
+                          a.size() / bulk_min_elements);
+    auto depth = hamts::count_t{};
+    for (auto n = std::size_t{1};
+         n < parts && depth + 1 < hamts::max_depth<champ_a::bits>;
+         n <<= champ_a::bits)
+        ++depth;
+
+    auto tasks   = std::vector<task_t>{};
+    auto results = std::vector<Map>{};
+    auto top     = Map{}.transient();
+    with_joiner(top, depth ? &tasks : nullptr, depth, [&](auto&& j) {
+        j.walk(a.impl().root, b.impl().root, 0);
+    });
+    results.resize(tasks.size() + 1);
+    results[0] = std::move(top).persistent();
+    ex.bulk(tasks.size(), [&](std::size_t i) {
+        auto t = Map{}.transient();
+        with_joiner(t, decltype(&tasks){}, hamts::count_t{}, [&](auto&& j) {
+            j.run(tasks[i]);
+        });
+        results[i + 1] = std::move(t).persistent();
+    });
+    using result_t = typename Map::mapped_type;
+    return par_merge_all(
+        results, [](const result_t&, const result_t& y) { return y; }, ex);
+}
+
+} // namespace detail
+
+/*!
+ * Returns the inner join of the maps `a` and `b` on their keys: a
+ * ``map`` from every key that is in both to `fn(k, x, y)`, where `x`
+ * and `y` are its values in `a` and `b`.  The maps must have the same
+ * hasher, key comparison and branching.
+ *
+ * @rst
+ *
+ * Both maps keep their keys in tries indexed by the bits of their
+ * hashes, so the keys with the same hash prefix are in the subtrees at
+ * the same position in both of them.  Thus, instead of looking up
+ * every key of ``a`` in ``b`` from the root, the tries are walked side
+ * by side: the subtrees that only one of them has are skipped without
+ * visiting them, and when one has a value where the other has a
+ * subtree, the key is looked up in that subtree alone.  The subtrees
+ * below the top levels are joined in parallel with the executor ``ex``
+ * (see :cpp:class:`executor`), each worker setting the results into a
+ * transient of its own, which are merged at the end.
+ *
+ * .. code-block:: c++
+ *
+ *    auto orders = immer::join(
+ *        users, purchases, [](auto& id, auto& user, auto& purchase) {
+ *            return order{user.name, purchase.total};
+ *        });
+ *
+ * @endrst
+ */
+template <typename K,
+          typename TA,
+          typename TB,
+          typename Hash,
+          typename Equal,
+          typename MPA,
+          typename MPB,
+          detail::hamts::bits_t B,
+          typename Fn,
+          typename Executor = thread_executor>
+auto join(const map<K, TA, Hash, Equal, MPA, B>& a,
+          const map<K, TB, Hash, Equal, MPB, B>& b,
+          Fn&& fn,
+          Executor&& ex = {})
+{
+    using result_t = std::decay_t<decltype(fn(std::declval<const K&>(),
+                                              std::declval<const TA&>(),
+                                              std::declval<const TB&>()))>;
+    return detail::par_map_join<map<K, result_t, Hash, Equal, MPA, B>>(
+        a,
+        b,
+        false,
+        [&](auto& t, auto& pa, auto* pb) {
+            t.set(pa.first, fn(pa.first, pa.second, pb->second));
+        },
+        ex);
+}
+
+/*!
+ * Returns the left join of the maps `a` and `b` on their keys: a
+ * ``map`` from every key of `a` to `fn(k, x, y)`, where `x` is its
+ * value in `a` and `y` points to its value in `b`, or is null when
+ * `b` does not have it.  It works like @a join, but the subtrees of
+ * `a` that `b` does not have are not skipped.
+ */
+template <typename K,
+          typename TA,
+          typename TB,
+          typename Hash,
+          typename Equal,
+          typename MPA,
+          typename MPB,
+          detail::hamts::bits_t B,
+          typename Fn,
+          typename Executor = thread_executor>
+auto left_join(const map<K, TA, Hash, Equal, MPA, B>& a,
+               const map<K, TB, Hash, Equal, MPB, B>& b,
+               Fn&& fn,
+               Executor&& ex = {})
+{
+    using result_t = std::decay_t<decltype(fn(std::declval<const K&>(),
+                                              std::declval<const TA&>(),
+                                              std::declval<const TB*>()))>;
+    return detail::par_map_join<map<K, result_t, Hash, Equal, MPA, B>>(
+        a,
+        b,
+        true,
+        [&](auto& t, auto& pa, auto* pb) {
+            auto y = pb ? &pb->second : nullptr;
+            t.set(pa.first, fn(pa.first, pa.second, y));
+        },
+        ex);
+}
+
+} // namespace immer
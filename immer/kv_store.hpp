@@ -0,0 +1,386 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/algorithm.hpp>
+#include <immer/atom.hpp>
+#include <immer/box.hpp>
+#include <immer/checkpoint.hpp>
+#include <immer/config.hpp>
+#include <immer/map.hpp>
+#include <immer/set.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <utility>
+
+namespace immer {
+
+/*!
+ * Embedded key-value store with multi-version concurrency control,
+ * from keys of type `K` to values of type `T`.  Every committed
+ * transaction produces a new version of an immutable ``map``, which is
+ * published through an `atom` with the @ref
+ * combining_reclamation_policy.  Thus:
+ *
+ * - Readers take a `snapshot_type` with a single load.  It never
+ *   changes and never blocks the writers, however long it is kept.
+ *
+ * - A `transaction` works on a private version of the map, derived
+ *   from a snapshot, where it sees its own writes.  Its commit checks
+ *   that none of the keys that it read or wrote changed since the
+ *   snapshot, comparing their values, and then applies its writes.
+ *   Hence, transactions are serializable and a conflicting one is
+ *   rejected instead of overwriting the others.
+ *
+ * - Concurrent commits are applied by a single thread in a batch, that
+ *   publishes all of them with one update of the atom.
+ *
+ * - The changes between any two snapshots are found with `changes()`,
+ *   and `watch()` calls a function with the versions before and after
+ *   every commit, from which a change feed can be built.
+ *
+ * - `checkpoint()` writes a version with a @ref checkpointer, while
+ *   the writers go on.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    immer::kv_store<std::string, long> accounts;
+ *    accounts.transact([](auto& tx) {
+ *        auto from = tx.find("alice");
+ *        auto to   = tx.find("bob");
+ *        tx.set("alice", (from ? *from : 0) - 10);
+ *        tx.set("bob", (to ? *to : 0) + 10);
+ *    });
+ *
+ * @endrst
+ *
+ * The values must be equality comparable.  Snapshots and transactions
+ * cost a few words, and a transaction costs as many nodes as the keys
+ * that it writes, since its private map shares everything else.
+ */
+template <typename K,
+          typename T,
+          typename Hash         = std::hash<K>,
+          typename Equal        = std::equal_to<K>,
+          typename MemoryPolicy = default_memory_policy>
+class kv_store
+{
+public:
+    using key_type      = K;
+    using mapped_type   = T;
+    using value_type    = std::pair<K, T>;
+    using size_type     = std::size_t;
+    using hasher        = Hash;
+    using key_equal     = Equal;
+    using memory_policy = MemoryPolicy;
+
+    using map_type     = map<K, T, Hash, Equal, MemoryPolicy>;
+    using version_type = std::uint64_t;
+
+private:
+    using key_set_t = set<K, Hash, Equal, MemoryPolicy>;
+
+    struct state
+    {
+        version_type version = 0;
+        map_type data;
+    };
+
+    using atom_t = atom<state, MemoryPolicy, combining_reclamation_policy<>>;
+    using box_t  = typename atom_t::box_type;
+
+public:
+    /*!
+     * An immutable version of the store, as returned by `snapshot()`.
+     */
+    class snapshot_type
+    {
+    public:
+        /*!
+         * Returns the number of transactions that had been committed
+         * when this version was published.
+         */
+        IMMER_NODISCARD version_type version() const
+        {
+            return state_->version;
+        }
+
+        /*!
+         * Returns the map with all the associations of this version.
+         */
+        IMMER_NODISCARD const map_type& data() const { return state_->data; }
+
+        /*!
+         * Returns a pointer to the value associated with `k`, or
+         * `nullptr` when it is not there.  The pointer is valid as
+         * long as the snapshot lives.
+         */
+        IMMER_NODISCARD const T* find(const K& k) const
+        {
+            return state_->data.find(k);
+        }
+
+        /*!
+         * Returns `1` when the key `k` is contained and `0` otherwise.
+         */
+        IMMER_NODISCARD size_type count(const K& k) const
+        {
+            return state_->data.count(k);
+        }
+
+        /*!
+         * Returns the number of associations.
+         */
+        IMMER_NODISCARD size_type size() const { return state_->data.size(); }
+
+    private:
+        friend kv_store;
+
+        snapshot_type(box_t s)
+            : state_{std::move(s)}
+        {}
+
+        box_t state_;
+    };
+
+    /*!
+     * A set of reads and writes that are committed together with
+     * `commit()`.  It is created with `begin()` and used by a single
+     * thread.
+     */
+    class transaction
+    {
+    public:
+        /*!
+         * Returns the snapshot that the transaction reads from.  After
+         * a successful commit, it is the version that the commit
+         * published.
+         */
+        IMMER_NODISCARD const snapshot_type& snapshot() const
+        {
+            return base_;
+        }
+
+        /*!
+         * Returns a pointer to the value associated with `k` in the
+         * snapshot, or to the one written by this transaction, or
+         * `nullptr` when there is none.  The key is checked at commit.
+         */
+        const T* find(const K& k)
+        {
+            reads_ = std::move(reads_).insert(k);
+            return data_.find(k);
+        }
+
+        /*!
+         * Associates the value `v` to the key `k`.
+         */
+        void set(K k, T v)
+        {
+            writes_ = std::move(writes_).insert(k);
+            data_   = std::move(data_).set(std::move(k), std::move(v));
+        }
+
+        /*!
+         * Removes the key `k`, if it is there.
+         */
+        void erase(const K& k)
+        {
+            writes_ = std::move(writes_).insert(k);
+            data_   = std::move(data_).erase(k);
+        }
+
+        /*!
+         * Returns `true` when the transaction has not written anything.
+         */
+        IMMER_NODISCARD bool read_only() const { return writes_.empty(); }
+
+    private:
+        friend kv_store;
+
+        transaction(snapshot_type base)
+            : base_{std::move(base)}
+            , data_{base_.data()}
+        {}
+
+        // whether `s` has the same values as the snapshot for all the
+        // keys that have been read or written
+        bool valid_in(const state& s) const
+        {
+            if (s.version == base_.version())
+                return true;
+            auto same = [&](const K& k) {
+                auto x = base_.find(k);
+                auto y = s.data.find(k);
+                return x == y || (x && y && *x == *y);
+            };
+            for (auto& k : reads_)
+                if (!same(k))
+                    return false;
+            for (auto& k : writes_)
+                if (!reads_.count(k) && !same(k))
+                    return false;
+            return true;
+        }
+
+        // the map of `s` with the writes of the transaction
+        map_type applied_to(const state& s) const
+        {
+            if (s.version == base_.version())
+                return data_;
+            auto r = s.data;
+            for (auto& k : writes_) {
+                if (auto v = data_.find(k))
+                    r = std::move(r).set(k, *v);
+                else
+                    r = std::move(r).erase(k);
+            }
+            return r;
+        }
+
+        snapshot_type base_;
+        map_type data_;
+        key_set_t reads_;
+        key_set_t writes_;
+    };
+
+    /*!
+     * Constructs a store with the associations of `data` at version
+     * zero.
+     */
+    kv_store(map_type data = {})
+        : state_{state{0, std::move(data)}}
+    {}
+
+    kv_store(const kv_store&) = delete;
+    kv_store(kv_store&&)      = delete;
+    void operator=(const kv_store&) = delete;
+    void operator=(kv_store&&) = delete;
+
+    /*!
+     * Returns the last committed version.
+     */
+    IMMER_NODISCARD snapshot_type snapshot() const { return state_.load(); }
+
+    /*!
+     * Starts a transaction that reads from the last committed version.
+     */
+    IMMER_NODISCARD transaction begin() const { return snapshot(); }
+
+    /*!
+     * Applies the writes of `tx` atomically and returns `true`, or
+     * returns `false` when one of the keys that it read or wrote has
+     * changed since its snapshot.  After a successful commit, `tx`
+     * reads from the version that it published and can be used for
+     * another transaction.  A transaction that did not write anything
+     * commits without publishing a version.
+     */
+    bool commit(transaction& tx)
+    {
+        if (tx.read_only())
+            return true;
+        // most conflicts are found before publishing, without making
+        // the other commits wait
+        if (!tx.valid_in(*state_.load()))
+            return false;
+        auto ok = true;
+        auto r  = state_.update([&](const state& s) {
+            ok = tx.valid_in(s);
+            return ok ? state{s.version + 1, tx.applied_to(s)} : s;
+        });
+        if (ok)
+            tx = transaction{snapshot_type{std::move(r)}};
+        return ok;
+    }
+
+    /*!
+     * Runs `fn(tx)` with a new transaction `tx` and commits it, over
+     * and over until the commit succeeds, and returns the version that
+     * it published.  Like with `atom::update`, `fn` may thus run
+     * several times and should not have other side effects.
+     */
+    template <typename Fn>
+    snapshot_type transact(Fn&& fn)
+    {
+        while (true) {
+            auto tx = begin();
+            fn(tx);
+            if (commit(tx))
+                return tx.snapshot();
+        }
+    }
+
+    /*!
+     * Calls the functions `fns`, as in @a diff, for every association
+     * that was added, removed or changed from the version `a` to the
+     * version `b`.  Its cost is proportional to the number of changes
+     * when `b` is derived from `a`.
+     */
+    template <typename... Fns>
+    static void
+    changes(const snapshot_type& a, const snapshot_type& b, Fns&&... fns)
+    {
+        diff(a.data(), b.data(), std::forward<Fns>(fns)...);
+    }
+
+    /*!
+     * Registers `fn` to be called as `fn(old, new)` after every commit
+     * that publishes a version, with the versions before and after it,
+     * see `atom::watch`.  It returns an identifier to be passed to
+     * `unwatch`.
+     *
+     * @rst
+     *
+     * .. note:: With several writers, the calls may come in any order
+     *    and from any of them.  A change feed that needs them in order
+     *    can sort them by ``new.version()``, every version but the
+     *    first is the ``old`` of exactly one call.
+     *
+     * @endrst
+     */
+    std::size_t watch(
+        std::function<void(const snapshot_type&, const snapshot_type&)> fn)
+    {
+        return state_.watch([fn = std::move(fn)](const box_t& a,
+                                                 const box_t& b) {
+            // rejected commits store the same version again
+            if (a->version != b->version)
+                fn(snapshot_type{a}, snapshot_type{b});
+        });
+    }
+
+    /*!
+     * Removes the watcher registered with the identifier `id`.
+     */
+    void unwatch(std::size_t id) { state_.unwatch(id); }
+
+    /*!
+     * Queues a checkpoint of the last committed version in `cp`, see
+     * `checkpointer::checkpoint()`, and returns the version and a
+     * future of the checkpoint.  The calling thread only takes a
+     * snapshot.
+     */
+    template <typename Sink>
+    std::pair<version_type, std::future<checkpoint_info>>
+    checkpoint(checkpointer<map_type>& cp, Sink sink) const
+    {
+        auto s = snapshot();
+        return {s.version(), cp.checkpoint(s.data(), std::move(sink))};
+    }
+
+private:
+    atom_t state_;
+};
+
+} // namespace immer
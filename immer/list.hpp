@@ -0,0 +1,359 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/iterator_facade.hpp>
+#include <immer/detail/lists/node.hpp>
+#include <immer/detail/type_traits.hpp>
+#include <immer/memory_policy.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+namespace immer {
+
+namespace detail {
+namespace lists {
+
+template <typename T, typename MemoryPolicy, count_t N>
+struct iterator
+    : iterator_facade<iterator<T, MemoryPolicy, N>,
+                      std::forward_iterator_tag,
+                      T,
+                      const T&,
+                      std::ptrdiff_t,
+                      const T*>
+{
+    using node_t = node<T, MemoryPolicy, N>;
+
+    iterator() = default;
+
+    iterator(const node_t* p, count_t offset)
+        : p_{p}
+        , offset_{offset}
+    {}
+
+private:
+    friend iterator_core_access;
+
+    const node_t* p_ = nullptr;
+    count_t offset_  = 0;
+
+    void increment()
+    {
+        if (++offset_ == p_->end()) {
+            offset_ = p_->next_offset();
+            p_      = p_->next();
+        }
+    }
+
+    bool equal(const iterator& other) const
+    {
+        return p_ == other.p_ && offset_ == other.offset_;
+    }
+
+    const T& dereference() const { return p_->values()[offset_]; }
+};
+
+} // namespace lists
+} // namespace detail
+
+/*!
+ * Immutable singly linked list, where adding or removing a value at
+ * the front is @f$ O(1) @f$ and shares the rest of the list.
+ *
+ * @tparam T The type of the values to be stored in the container.
+ * @tparam MemoryPolicy Memory management policy. See @ref
+ *         memory_policy.
+ * @tparam N The number of values that a cell of the list can hold.
+ *
+ * @rst
+ *
+ * This is the list of functional languages, for the algorithms that
+ * keep many versions that differ only at the front, like the stacks of
+ * parsers or the paths of a backtracking search.  Unlike
+ * ``flex_vector::push_front``, that concatenates trees in
+ * :math:`O(log(n))`, ``push_front`` makes at most one cell, with the
+ * heap of the memory policy, and ``pop_front`` and copies only touch
+ * reference counts.
+ *
+ * .. code-block:: c++
+ *
+ *    auto tail = immer::list<int>{2, 3};
+ *    auto a    = tail.push_front(1);
+ *    auto b    = tail.push_front(0);
+ *    assert(a.front() == 1 && b.front() == 0);
+ *    assert(a.pop_front() == b.pop_front());
+ *
+ * When ``N`` is more than 1, the values are stored in the cells from
+ * back to front, and pushing into a list whose cell has free slots
+ * before its first value fills one of them, as long as no other list
+ * sharing that cell did it first.  Thus, building a list by pushing in
+ * a loop makes one cell every ``N`` values, that are contiguous in
+ * memory, as are the lists built from ranges.  See ``chunked_list``.
+ *
+ * Lists are released one cell after the other, so destroying a long
+ * one does not overflow the stack.
+ *
+ * .. note:: The values of a cell are destroyed with the cell, that is
+ *    when no list has its values anymore, but not before.
+ *
+ * @endrst
+ */
+template <typename T,
+          typename MemoryPolicy = default_memory_policy,
+          std::size_t N         = 1>
+class list
+{
+    static_assert(N > 0, "the cells must hold at least one value");
+
+    using count_t = detail::lists::count_t;
+    using node_t  = detail::lists::node<T, MemoryPolicy, count_t{N}>;
+
+public:
+    using value_type      = T;
+    using reference       = const T&;
+    using size_type       = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using const_reference = const T&;
+
+    using iterator = detail::lists::iterator<T, MemoryPolicy, count_t{N}>;
+    using const_iterator = iterator;
+
+    using memory_policy_type = MemoryPolicy;
+
+    /*!
+     * Default constructor.  It creates a list of `size() == 0`.  It
+     * does not allocate memory.
+     */
+    list() = default;
+
+    /*!
+     * Constructs a list containing the elements in `values`.
+     */
+    list(std::initializer_list<T> values)
+        : list{values.begin(), values.end()}
+    {}
+
+    /*!
+     * Constructs a list containing the elements in the range defined
+     * by the forward iterator `first` and range sentinel `last`.  The
+     * cells are filled from the front, so all of them but the last one
+     * are full.
+     */
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    list(Iter first, Sent last)
+    {
+        auto tail  = static_cast<node_t*>(nullptr);
+        auto count = count_t{};
+        IMMER_TRY {
+            for (; first != last; ++first) {
+                if (!tail || count == N) {
+                    auto p = node_t::make(0, N, nullptr, 0);
+                    if (tail)
+                        tail->impl.d.next = p;
+                    else
+                        cell_ = p;
+                    tail  = p;
+                    count = 0;
+                }
+                new (tail->values() + count) T(*first);
+                ++count;
+                ++size_;
+            }
+            if (tail)
+                tail->impl.d.end = count;
+        }
+        IMMER_CATCH (...) {
+            if (tail)
+                tail->impl.d.end = count;
+            node_t::release(cell_);
+            IMMER_RETHROW;
+        }
+    }
+
+    list(const list& other)
+        : cell_{node_t::inc(other.cell_)}
+        , offset_{other.offset_}
+        , size_{other.size_}
+    {}
+
+    list(list&& other) { swap(*this, other); }
+
+    list& operator=(const list& other)
+    {
+        auto copy = other;
+        swap(*this, copy);
+        return *this;
+    }
+
+    list& operator=(list&& other)
+    {
+        swap(*this, other);
+        return *this;
+    }
+
+    ~list() { node_t::release(cell_); }
+
+    friend void swap(list& a, list& b)
+    {
+        using std::swap;
+        swap(a.cell_, b.cell_);
+        swap(a.offset_, b.offset_);
+        swap(a.size_, b.size_);
+    }
+
+    /*!
+     * Returns an iterator pointing at the first element of the
+     * collection.  It does not allocate memory and its complexity is
+     * @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD iterator begin() const { return {cell_, offset_}; }
+
+    /*!
+     * Returns an iterator pointing just after the last element of the
+     * collection.  It does not allocate and its complexity is @f$ O(1)
+     * @f$.
+     */
+    IMMER_NODISCARD iterator end() const { return {}; }
+
+    /*!
+     * Returns the number of elements in the container.  It does not
+     * allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD size_type size() const { return size_; }
+
+    /*!
+     * Returns `true` if there are no elements in the container.  It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD bool empty() const { return size_ == 0; }
+
+    /*!
+     * Access the first element.  The list must not be empty.
+     */
+    IMMER_NODISCARD const T& front() const
+    {
+        return cell_->values()[offset_];
+    }
+
+    /*!
+     * Returns a list with `value` in front of the elements of this
+     * one, that it shares.  It is @f$ O(1) @f$, and allocates one cell
+     * at most.
+     */
+    IMMER_NODISCARD list push_front(T value) const&
+    {
+        node_t::inc(cell_);
+        IMMER_TRY {
+            auto r = node_t::cons(std::move(value), cell_, offset_);
+            return {r.first, r.second, size_ + 1};
+        }
+        IMMER_CATCH (...) {
+            node_t::release(cell_);
+            IMMER_RETHROW;
+        }
+    }
+
+    IMMER_NODISCARD list push_front(T value) &&
+    {
+        auto r = node_t::cons(std::move(value), cell_, offset_);
+        cell_  = nullptr;
+        return {r.first, r.second, size_ + 1};
+    }
+
+    /*!
+     * Returns a list without the first element, sharing all the others.
+     * It is @f$ O(1) @f$ and does not allocate.  Popping from an empty
+     * list returns an empty list.
+     */
+    IMMER_NODISCARD list pop_front() const { return drop(1); }
+
+    /*!
+     * Returns a list without the first `n` elements, sharing the
+     * others.  It does not allocate and walks past @f$ O(n / N) @f$
+     * cells.
+     */
+    IMMER_NODISCARD list drop(size_type n) const
+    {
+        n        = std::min(n, size_);
+        auto p   = cell_;
+        auto off = offset_;
+        for (auto k = n; k > 0;) {
+            auto avail = static_cast<size_type>(p->end() - off);
+            if (k < avail) {
+                off += static_cast<count_t>(k);
+                break;
+            }
+            k -= avail;
+            off = p->next_offset();
+            p   = p->next();
+        }
+        return {node_t::inc(p), off, size_ - n};
+    }
+
+    /*!
+     * Returns a list with the elements of this one in the reverse
+     * order.  It is @f$ O(n) @f$ and shares nothing with this one.
+     */
+    IMMER_NODISCARD list reverse() const
+    {
+        auto r = list{};
+        for (auto& x : *this)
+            r = std::move(r).push_front(x);
+        return r;
+    }
+
+    /*!
+     * Returns whether the lists are equal.  Lists that share their
+     * first cell and offset are equal in @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD bool operator==(const list& other) const
+    {
+        return size_ == other.size_ &&
+               ((cell_ == other.cell_ && offset_ == other.offset_) ||
+                std::equal(begin(), end(), other.begin()));
+    }
+
+    IMMER_NODISCARD bool operator!=(const list& other) const
+    {
+        return !(*this == other);
+    }
+
+private:
+    list(node_t* cell, count_t offset, size_type size)
+        : cell_{cell}
+        , offset_{offset}
+        , size_{size}
+    {}
+
+    node_t* cell_   = nullptr;
+    count_t offset_ = 0;
+    size_type size_ = 0;
+};
+
+/*!
+ * A ``list`` whose cells hold `N` values, to make the traversals touch
+ * fewer cache lines and the lists built by pushing allocate `N` times
+ * less often.
+ */
+template <typename T,
+          std::size_t N         = 8,
+          typename MemoryPolicy = default_memory_policy>
+using chunked_list = list<T, MemoryPolicy, N>;
+
+} // namespace immer
@@ -0,0 +1,121 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/lock/spinlock_policy.hpp>
+
+#include <atomic>
+#include <thread>
+
+#if IMMER_HAS_FUTEX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace immer {
+
+/*!
+ * Lock that spins for a little while, with exponentially increasing
+ * pauses, and then parks the thread until the lock is released.  When
+ * there are more threads than cores, the holder of the lock may be
+ * descheduled, and then a spinning thread would burn its whole time
+ * slice.  Uncontended, it costs the same as @a spinlock_policy: one
+ * atomic exchange to lock and one to unlock.
+ *
+ * On Linux it parks on a futex.  Elsewhere it falls back to yielding.
+ *
+ * @rst
+ *
+ * .. note:: The futex is private to the process, so this lock can not
+ *    live in memory shared between processes.  Use
+ *    :cpp:class:`spinlock_policy` there.
+ *
+ * @endrst
+ */
+struct adaptive_lock_policy
+{
+    // 0: unlocked, 1: locked, 2: locked and there may be parked threads
+    std::atomic<int> v_{0};
+
+    bool try_lock()
+    {
+        auto expected = 0;
+        return v_.compare_exchange_strong(
+            expected, 1, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    void lock()
+    {
+        if (try_lock())
+            return;
+        for (auto k = 0u; k < spin_rounds; ++k) {
+            for (auto i = 0u; i < (1u << k); ++i) {
+#ifdef IMMER_SMT_PAUSE
+                IMMER_SMT_PAUSE;
+#endif
+            }
+            if (v_.load(std::memory_order_relaxed) == 0 && try_lock())
+                return;
+        }
+        while (v_.exchange(2, std::memory_order_acquire) != 0)
+            park();
+    }
+
+    void unlock()
+    {
+        if (v_.exchange(0, std::memory_order_release) == 2)
+            unpark();
+    }
+
+    struct scoped_lock
+    {
+        scoped_lock(const scoped_lock&) = delete;
+        scoped_lock& operator=(const scoped_lock&) = delete;
+
+        explicit scoped_lock(adaptive_lock_policy& lp)
+            : lp_{lp}
+        {
+            lp.lock();
+        }
+
+        ~scoped_lock() { lp_.unlock(); }
+
+    private:
+        adaptive_lock_policy& lp_;
+    };
+
+private:
+    // up to 2^7 - 1 pauses in total, in the order of a microsecond
+    static constexpr auto spin_rounds = 7u;
+
+#if IMMER_HAS_FUTEX
+    static_assert(sizeof(std::atomic<int>) == sizeof(int),
+                  "the futex needs direct access to the lock word");
+
+    int* word() { return reinterpret_cast<int*>(&v_); }
+
+    void park()
+    {
+        syscall(
+            SYS_futex, word(), FUTEX_WAIT_PRIVATE, 2, nullptr, nullptr, 0);
+    }
+
+    void unpark()
+    {
+        syscall(SYS_futex, word(), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+    }
+#else
+    void park() { std::this_thread::yield(); }
+    void unpark() {}
+#endif
+};
+
+} // namespace immer
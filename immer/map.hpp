@@ -8,14 +8,21 @@
 
 #pragma once
 
+#include <immer/box.hpp>
 #include <immer/config.hpp>
+#include <immer/container_hash.hpp>
 #include <immer/detail/hamts/champ.hpp>
 #include <immer/detail/hamts/champ_iterator.hpp>
+#include <immer/hash_cursor.hpp>
+#include <immer/executor.hpp>
 #include <immer/memory_policy.hpp>
+#include <immer/relocatable.hpp>
 
 #include <cassert>
 #include <functional>
+#include <iterator>
 #include <stdexcept>
+#include <tuple>
 
 namespace immer {
 
@@ -47,7 +54,8 @@ class map_transient;
  * When storing big objects, the size of these contiguous chunks can
  * become too big, damaging performance.  If this is measured to be
  * problematic for a specific use-case, it can be solved by using a
- * `immer::box` to wrap the type `T`.
+ * `immer::box` to wrap the type `T`, or by using an @ref
+ * out_of_line_policy, that boxes the big values transparently.
  *
  * **Example**
  *   .. literalinclude:: ../example/map/intro.cpp
@@ -60,13 +68,14 @@ class map_transient;
  */
 template <typename K,
           typename T,
-          typename Hash           = std::hash<K>,
+          typename Hash           = container_hash<K>,
           typename Equal          = std::equal_to<K>,
           typename MemoryPolicy   = default_memory_policy,
           detail::hamts::bits_t B = default_bits>
 class map
 {
-    using value_t = std::pair<K, T>;
+    using storage_t = detail::stored_value<std::pair<K, T>, MemoryPolicy>;
+    using value_t   = typename storage_t::type;
 
     using move_t =
         std::integral_constant<bool, MemoryPolicy::use_transient_rvalues>;
@@ -75,11 +84,12 @@ class map
     {
         const T& operator()(const value_t& v) const noexcept
         {
-            return v.second;
+            return storage_t::get(v).second;
         }
-        T&& operator()(value_t&& v) const noexcept
+        std::conditional_t<storage_t::out_of_line, const T&, T&&>
+        operator()(value_t&& v) const noexcept
         {
-            return std::move(v.second);
+            return std::move(storage_t::get(v).second);
         }
     };
 
@@ -87,7 +97,7 @@ class map
     {
         const T* operator()(const value_t& v) const noexcept
         {
-            return &v.second;
+            return &storage_t::get(v).second;
         }
     };
 
@@ -117,9 +127,26 @@ class map
         }
     };
 
+    struct key_of
+    {
+        const K& operator()(const value_t& v) const noexcept
+        {
+            return storage_t::get(v).first;
+        }
+    };
+
     struct hash_key
     {
-        auto operator()(const value_t& v) { return Hash{}(v.first); }
+        static constexpr bool cache_hashes =
+            detail::hamts::hash_caching<Hash>::value;
+
+        using collision_less =
+            detail::hamts::key_collision_less_t<Hash, value_t, key_of>;
+
+        auto operator()(const value_t& v)
+        {
+            return Hash{}(storage_t::get(v).first);
+        }
 
         template <typename Key>
         auto operator()(const Key& v)
@@ -132,13 +159,13 @@ class map
     {
         auto operator()(const value_t& a, const value_t& b)
         {
-            return Equal{}(a.first, b.first);
+            return Equal{}(storage_t::get(a).first, storage_t::get(b).first);
         }
 
         template <typename Key>
         auto operator()(const value_t& a, const Key& b)
         {
-            return Equal{}(a.first, b);
+            return Equal{}(storage_t::get(a).first, b);
         }
     };
 
@@ -146,7 +173,10 @@ class map
     {
         auto operator()(const value_t& a, const value_t& b)
         {
-            return Equal{}(a.first, b.first) && a.second == b.second;
+            auto& x = storage_t::get(a);
+            auto& y = storage_t::get(b);
+            return &x == &y ||
+                   (Equal{}(x.first, y.first) && x.second == y.second);
         }
     };
 
@@ -164,8 +194,15 @@ public:
     using reference       = const value_type&;
     using const_reference = const value_type&;
 
-    using iterator = detail::hamts::
-        champ_iterator<value_t, hash_key, equal_key, MemoryPolicy, B>;
+    using iterator = std::conditional_t<
+        storage_t::out_of_line,
+        detail::hamts::champ_unboxing_iterator<value_t,
+                                               hash_key,
+                                               equal_key,
+                                               MemoryPolicy,
+                                               B>,
+        detail::hamts::
+            champ_iterator<value_t, hash_key, equal_key, MemoryPolicy, B>>;
     using const_iterator = iterator;
 
     using transient_type = map_transient<K, T, Hash, Equal, MemoryPolicy, B>;
@@ -362,6 +399,37 @@ public:
                                   detail::constantly<const T*, nullptr>>(k);
     }
 
+    /*!
+     * Like `find`, but `hash` is used as the hash of `k` instead of
+     * computing it, thus it must be `hasher{}(k)`.  This avoids hashing
+     * an expensive key again when it is looked up in several containers.
+     */
+    IMMER_NODISCARD const T* find_hashed(const K& k, std::size_t hash) const
+    {
+        return impl_.template get<project_value_ptr,
+                                  detail::constantly<const T*, nullptr>>(k,
+                                                                         hash);
+    }
+
+    /*!
+     * Looks up every key in the range `keys`, writing to the output
+     * iterator `out` a pointer to its associated value, or a `nullptr`
+     * if it is not in the map, and returns the iterator past the last
+     * one written.  It is equivalent to calling `find` for every key,
+     * but the lookups are interleaved so that their cache misses
+     * overlap, which is faster for batches of keys on large maps.  The
+     * range must yield references to the keys.
+     */
+    template <typename Keys, typename Out>
+    Out find_many(const Keys& keys, Out out) const
+    {
+        using std::begin;
+        using std::end;
+        return impl_.template get_many<project_value_ptr,
+                                       detail::constantly<const T*, nullptr>>(
+            begin(keys), end(keys), out);
+    }
+
     /*!
      * Returns whether the maps are equal.
      */
@@ -389,6 +457,48 @@ public:
         return insert_move(move_t{}, std::move(value));
     }
 
+    /*!
+     * Like `insert`, but `hash` is used as the hash of the key of
+     * `value`, thus it must be `hasher{}(value.first)`.
+     */
+    IMMER_NODISCARD map insert_hashed(value_type value,
+                                      std::size_t hash) const&
+    {
+        return impl_.add(std::move(value), hash);
+    }
+    IMMER_NODISCARD decltype(auto) insert_hashed(value_type value,
+                                                 std::size_t hash) &&
+    {
+        return insert_hashed_move(move_t{}, std::move(value), hash);
+    }
+
+    /*!
+     * Returns a map containing all the associations in the range
+     * defined by the input iterator `first` and range sentinel `last`.
+     * When a key is already in the map, or appears more than once in
+     * the range, the last association wins.  The range is sorted by
+     * hash and every touched node is descended into and allocated only
+     * once, so this is cheaper than inserting the values one by one.
+     * It may allocate memory and its complexity is *effectively* @f$
+     * O(n \log n) @f$ where @f$ n @f$ is the size of the range.
+     */
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    IMMER_NODISCARD map insert_range(Iter first, Sent last) const&
+    {
+        return impl_.add_batch(first, last);
+    }
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    IMMER_NODISCARD decltype(auto) insert_range(Iter first, Sent last) &&
+    {
+        return insert_range_move(move_t{}, first, last);
+    }
+
     /*!
      * Returns a map containing the association `(k, v)`.  If the key
      * is already in the map, it replaces its association in the map.
@@ -404,6 +514,46 @@ public:
         return set_move(move_t{}, std::move(k), std::move(v));
     }
 
+    /*!
+     * Like `set`, but the value associated to `k` is constructed in
+     * place with the arguments `args`, instead of moving a temporary
+     * `mapped_type` into the association.  It may allocate memory and
+     * its complexity is *effectively* @f$ O(1) @f$.
+     */
+    template <typename... Args>
+    IMMER_NODISCARD map emplace(key_type k, Args&&... args) const&
+    {
+        return impl_.add(make_value(std::move(k), std::forward<Args>(args)...));
+    }
+    template <typename... Args>
+    IMMER_NODISCARD decltype(auto) emplace(key_type k, Args&&... args) &&
+    {
+        return emplace_move(
+            move_t{}, std::move(k), std::forward<Args>(args)...);
+    }
+
+    /*!
+     * Like `emplace`, but when the key `k` is already in the map it
+     * returns the map unchanged, and the arguments are not used.  The
+     * key is hashed only once.  It may allocate memory and its
+     * complexity is *effectively* @f$ O(1) @f$.
+     */
+    template <typename... Args>
+    IMMER_NODISCARD map try_emplace(key_type k, Args&&... args) const&
+    {
+        auto hash = Hash{}(k);
+        if (find_hashed(k, hash))
+            return *this;
+        return impl_.add(make_value(std::move(k), std::forward<Args>(args)...),
+                         hash);
+    }
+    template <typename... Args>
+    IMMER_NODISCARD decltype(auto) try_emplace(key_type k, Args&&... args) &&
+    {
+        return try_emplace_move(
+            move_t{}, std::move(k), std::forward<Args>(args)...);
+    }
+
     /*!
      * Returns a map replacing the association `(k, v)` by the
      * association new association `(k, fn(v))`, where `v` is the
@@ -424,6 +574,26 @@ public:
         return update_move(move_t{}, std::move(k), std::forward<Fn>(fn));
     }
 
+    /*!
+     * Like `update`, but `hash` is used as the hash of `k`, thus it
+     * must be `hasher{}(k)`.
+     */
+    template <typename Fn>
+    IMMER_NODISCARD map
+    update_hashed(key_type k, std::size_t hash, Fn&& fn) const&
+    {
+        return impl_
+            .template update<project_value, default_value, combine_value>(
+                std::move(k), hash, std::forward<Fn>(fn));
+    }
+    template <typename Fn>
+    IMMER_NODISCARD decltype(auto)
+    update_hashed(key_type k, std::size_t hash, Fn&& fn) &&
+    {
+        return update_hashed_move(
+            move_t{}, std::move(k), hash, std::forward<Fn>(fn));
+    }
+
     /*!
      * Returns a map replacing the association `(k, v)` by the association new
      * association `(k, fn(v))`, where `v` is the currently associated value for
@@ -443,6 +613,47 @@ public:
             move_t{}, std::move(k), std::forward<Fn>(fn));
     }
 
+    /*!
+     * Like `set`, but when `k` is already associated to a value that
+     * compares equal to `v` it returns the same map, thus keeping its
+     * `identity()`, instead of copying the path to the value.  This
+     * way, the code that detects changes through the identity, like
+     * `diff` or a memoization cache, sees none.  The key is hashed
+     * only once.  It may allocate memory and its complexity is
+     * *effectively* @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD map set_if_changed(key_type k, mapped_type v) const&
+    {
+        auto hash = Hash{}(k);
+        auto p    = find_hashed(k, hash);
+        return set_changed(std::move(k), hash, p, std::move(v));
+    }
+    IMMER_NODISCARD decltype(auto) set_if_changed(key_type k,
+                                                  mapped_type v) &&
+    {
+        return set_if_changed_move(move_t{}, std::move(k), std::move(v));
+    }
+
+    /*!
+     * Like `update`, but when `fn(v)` compares equal to `v` it returns
+     * the same map, like `set_if_changed`.  When `k` is not in the map,
+     * the result of `fn` is always associated to it.
+     */
+    template <typename Fn>
+    IMMER_NODISCARD map update_if_changed(key_type k, Fn&& fn) const&
+    {
+        auto hash = Hash{}(k);
+        auto p    = find_hashed(k, hash);
+        auto v    = std::forward<Fn>(fn)(p ? *p : default_value{}());
+        return set_changed(std::move(k), hash, p, std::move(v));
+    }
+    template <typename Fn>
+    IMMER_NODISCARD decltype(auto) update_if_changed(key_type k, Fn&& fn) &&
+    {
+        return update_if_changed_move(
+            move_t{}, std::move(k), std::forward<Fn>(fn));
+    }
+
     /*!
      * Returns a map without the key `k`.  If the key is not
      * associated in the map it returns the same map.  It may allocate
@@ -454,6 +665,105 @@ public:
         return erase_move(move_t{}, k);
     }
 
+    /*!
+     * Returns a map without the keys in the range `keys`, which must
+     * yield references to the keys and can be traversed more than
+     * once.  The keys are sorted by hash and every node where some of
+     * them fall is visited and copied only once, the untouched subtrees
+     * are shared, thus it is cheaper than erasing the keys one by one.
+     * Its complexity is *effectively* @f$ O(n \log n) @f$ where @f$ n
+     * @f$ is the number of keys.
+     */
+    template <typename Keys>
+    IMMER_NODISCARD map erase_many(const Keys& keys) const&
+    {
+        using std::begin;
+        using std::end;
+        return impl_.sub_batch(begin(keys), end(keys));
+    }
+    template <typename Keys>
+    IMMER_NODISCARD decltype(auto) erase_many(const Keys& keys) &&
+    {
+        return erase_many_move(move_t{}, keys);
+    }
+
+    /*!
+     * Returns a map without the associations for which `pred(x)`
+     * returns `true`.  The map is traversed once, the subtrees where
+     * nothing is erased are shared with the result and the nodes that
+     * are left empty are removed.  Its complexity is @f$ O(n) @f$.
+     */
+    template <typename Pred>
+    IMMER_NODISCARD map erase_if(Pred&& pred) const&
+    {
+        return impl_.filter(keep_unless(pred));
+    }
+    template <typename Pred>
+    IMMER_NODISCARD decltype(auto) erase_if(Pred&& pred) &&
+    {
+        return erase_if_move(move_t{}, pred);
+    }
+
+    /*!
+     * Returns a map with the associations of this map and of `other`.
+     * When a key is in both, it is associated to `fn(v1, v2)`, where
+     * `v1` is its value in this map and `v2` in `other`.  Both maps are
+     * traversed at once, and the subtrees they share are reused without
+     * visiting them, thus merging two versions derived from a common
+     * one costs @f$ O(|diff|) @f$ when they differ by @f$ |diff| @f$
+     * updates.
+     *
+     * @rst
+     *
+     * .. note:: Since the shared associations are not visited, ``fn(v,
+     *    v)`` must be equivalent to ``v``, as it is for most conflict
+     *    resolution rules, like keeping the largest value.
+     *
+     * @endrst
+     */
+    template <typename Fn>
+    IMMER_NODISCARD map merge(const map& other, Fn&& fn) const
+    {
+        return impl_.merge(other.impl_, merge_values(fn));
+    }
+
+    /*!
+     * Like `merge`, but the subtrees under the root are merged
+     * concurrently using the executor `ex` (see @ref executor), thus
+     * `fn` may be invoked from different threads at once.
+     */
+    template <typename Fn, typename Executor = thread_executor>
+    IMMER_NODISCARD map
+    par_merge(const map& other, Fn&& fn, Executor&& ex = {}) const
+    {
+        return impl_.par_merge(other.impl_, merge_values(fn), ex);
+    }
+
+    /*!
+     * Calls `fn(v)` for the next `n` associations `v` after the position
+     * `c`, and returns the position after them, which is at the end
+     * once all have been visited.  It costs @f$ O(log(size)) @f$ to
+     * find the position plus the visited associations, and works on
+     * any version of the map, see @ref hash_cursor.
+     *
+     * @rst
+     *
+     * .. code-block:: c++
+     *
+     *    auto page = std::vector<std::pair<K, T>>{};
+     *    auto next = m.resume(immer::hash_cursor::decode(token), 100,
+     *                         [&](auto& kv) { page.push_back(kv); });
+     *    reply(page, next.end ? "" : next.encode());
+     *
+     * @endrst
+     */
+    template <typename Fn>
+    hash_cursor resume(hash_cursor c, size_type n, Fn&& fn) const
+    {
+        return detail::hamts::resume(
+            impl_, c, n, [&](const value_t& v) { fn(storage_t::get(v)); });
+    }
+
     /*!
      * Returns a @a transient form of this container, an
      * `immer::map_transient`.
@@ -478,6 +788,12 @@ public:
     // Semi-private
     const impl_t& impl() const { return impl_; }
 
+    using stored_value_t = storage_t;
+
+    map(impl_t impl)
+        : impl_(std::move(impl))
+    {}
+
 private:
     friend transient_type;
 
@@ -491,6 +807,28 @@ private:
         return impl_.add(std::move(value));
     }
 
+    map&& insert_hashed_move(std::true_type, value_type value, std::size_t hash)
+    {
+        impl_.add_mut({}, std::move(value), hash);
+        return std::move(*this);
+    }
+    map insert_hashed_move(std::false_type, value_type value, std::size_t hash)
+    {
+        return impl_.add(std::move(value), hash);
+    }
+
+    template <typename Iter, typename Sent>
+    map&& insert_range_move(std::true_type, Iter first, Sent last)
+    {
+        impl_.add_batch_mut({}, first, last);
+        return std::move(*this);
+    }
+    template <typename Iter, typename Sent>
+    map insert_range_move(std::false_type, Iter first, Sent last)
+    {
+        return impl_.add_batch(first, last);
+    }
+
     map&& set_move(std::true_type, key_type k, mapped_type m)
     {
         impl_.add_mut({}, {std::move(k), std::move(m)});
@@ -501,6 +839,44 @@ private:
         return impl_.add({std::move(k), std::move(m)});
     }
 
+    template <typename... Args>
+    static value_type make_value(key_type k, Args&&... args)
+    {
+        return {std::piecewise_construct,
+                std::forward_as_tuple(std::move(k)),
+                std::forward_as_tuple(std::forward<Args>(args)...)};
+    }
+
+    template <typename... Args>
+    map&& emplace_move(std::true_type, key_type k, Args&&... args)
+    {
+        impl_.add_mut({},
+                      make_value(std::move(k), std::forward<Args>(args)...));
+        return std::move(*this);
+    }
+    template <typename... Args>
+    map emplace_move(std::false_type, key_type k, Args&&... args)
+    {
+        return impl_.add(make_value(std::move(k), std::forward<Args>(args)...));
+    }
+
+    template <typename... Args>
+    map&& try_emplace_move(std::true_type, key_type k, Args&&... args)
+    {
+        auto hash = Hash{}(k);
+        if (!find_hashed(k, hash))
+            impl_.add_mut(
+                {},
+                make_value(std::move(k), std::forward<Args>(args)...),
+                hash);
+        return std::move(*this);
+    }
+    template <typename... Args>
+    map try_emplace_move(std::false_type, key_type k, Args&&... args)
+    {
+        return try_emplace(std::move(k), std::forward<Args>(args)...);
+    }
+
     template <typename Fn>
     map&& update_move(std::true_type, key_type k, Fn&& fn)
     {
@@ -516,6 +892,23 @@ private:
                 std::move(k), std::forward<Fn>(fn));
     }
 
+    template <typename Fn>
+    map&&
+    update_hashed_move(std::true_type, key_type k, std::size_t hash, Fn&& fn)
+    {
+        impl_.template update_mut<project_value, default_value, combine_value>(
+            {}, std::move(k), hash, std::forward<Fn>(fn));
+        return std::move(*this);
+    }
+    template <typename Fn>
+    map
+    update_hashed_move(std::false_type, key_type k, std::size_t hash, Fn&& fn)
+    {
+        return impl_
+            .template update<project_value, default_value, combine_value>(
+                std::move(k), hash, std::forward<Fn>(fn));
+    }
+
     template <typename Fn>
     map&& update_if_exists_move(std::true_type, key_type k, Fn&& fn)
     {
@@ -530,6 +923,43 @@ private:
             std::move(k), std::forward<Fn>(fn));
     }
 
+    // Associates `v` to `k`, whose value was `p`, unless they are equal.
+    map set_changed(key_type k, std::size_t hash, const T* p, T v) const
+    {
+        if (p && *p == v)
+            return *this;
+        return impl_.add({std::move(k), std::move(v)}, hash);
+    }
+
+    map&& set_if_changed_move(std::true_type, key_type k, mapped_type v)
+    {
+        auto hash = Hash{}(k);
+        auto p    = find_hashed(k, hash);
+        if (!p || !(*p == v))
+            impl_.add_mut({}, {std::move(k), std::move(v)}, hash);
+        return std::move(*this);
+    }
+    map set_if_changed_move(std::false_type, key_type k, mapped_type v)
+    {
+        return set_if_changed(std::move(k), std::move(v));
+    }
+
+    template <typename Fn>
+    map&& update_if_changed_move(std::true_type, key_type k, Fn&& fn)
+    {
+        auto hash = Hash{}(k);
+        auto p    = find_hashed(k, hash);
+        auto v    = std::forward<Fn>(fn)(p ? *p : default_value{}());
+        if (!p || !(*p == v))
+            impl_.add_mut({}, {std::move(k), std::move(v)}, hash);
+        return std::move(*this);
+    }
+    template <typename Fn>
+    map update_if_changed_move(std::false_type, key_type k, Fn&& fn)
+    {
+        return update_if_changed(std::move(k), std::forward<Fn>(fn));
+    }
+
     map&& erase_move(std::true_type, const key_type& value)
     {
         impl_.sub_mut({}, value);
@@ -540,11 +970,88 @@ private:
         return impl_.sub(value);
     }
 
-    map(impl_t impl)
-        : impl_(std::move(impl))
-    {}
+    template <typename Keys>
+    map&& erase_many_move(std::true_type, const Keys& keys)
+    {
+        using std::begin;
+        using std::end;
+        impl_.sub_batch_mut({}, begin(keys), end(keys));
+        return std::move(*this);
+    }
+    template <typename Keys>
+    map erase_many_move(std::false_type, const Keys& keys)
+    {
+        using std::begin;
+        using std::end;
+        return impl_.sub_batch(begin(keys), end(keys));
+    }
+
+    template <typename Pred>
+    map&& erase_if_move(std::true_type, Pred& pred)
+    {
+        impl_.filter_mut({}, keep_unless(pred));
+        return std::move(*this);
+    }
+    template <typename Pred>
+    map erase_if_move(std::false_type, Pred& pred)
+    {
+        return impl_.filter(keep_unless(pred));
+    }
+
+    template <typename Pred>
+    static auto keep_unless(Pred& pred)
+    {
+        return [&pred](const value_t& v) { return !pred(storage_t::get(v)); };
+    }
+
+    template <typename Fn>
+    static auto merge_values(Fn& fn)
+    {
+        return [&fn](const value_t& x, const value_t& y) {
+            auto& a = storage_t::get(x);
+            return value_t{value_type{a.first,
+                                      fn(a.second, storage_t::get(y).second)}};
+        };
+    }
 
     impl_t impl_ = impl_t::empty();
 };
 
+/*!
+ * Returns a map with the keys of `m`, each of them associated to
+ * `fn(v)`, where `v` is its value in `m`.  The result is built with the
+ * same shape as `m`, node by node, without hashing or comparing the
+ * keys, thus it is faster than inserting the associations one by one
+ * in a new map.  Its complexity is @f$ O(n) @f$.
+ */
+template <typename K,
+          typename T,
+          typename Hash,
+          typename Equal,
+          typename MemoryPolicy,
+          detail::hamts::bits_t B,
+          typename Fn>
+auto transform_values(const map<K, T, Hash, Equal, MemoryPolicy, B>& m,
+                      Fn&& fn)
+{
+    using value_t  = std::decay_t<decltype(fn(std::declval<const T&>()))>;
+    using result_t = map<K, value_t, Hash, Equal, MemoryPolicy, B>;
+    using impl_t   = std::decay_t<decltype(std::declval<result_t>().impl())>;
+    return result_t{m.impl().template transform<impl_t>(
+        [&](const std::pair<K, T>& kv) {
+            return std::pair<K, value_t>{kv.first, fn(kv.second)};
+        })};
+}
+
+// A map only holds its size and a pointer to its root.
+template <typename K,
+          typename T,
+          typename Hash,
+          typename Equal,
+          typename MP,
+          detail::hamts::bits_t B>
+struct is_trivially_relocatable<map<K, T, Hash, Equal, MP, B>>
+    : std::true_type
+{};
+
 } // namespace immer
@@ -8,8 +8,10 @@
 
 #pragma once
 
+#include <immer/container_hash.hpp>
 #include <immer/detail/hamts/champ.hpp>
 #include <immer/memory_policy.hpp>
+#include <immer/trace.hpp>
 
 #include <functional>
 
@@ -35,7 +37,7 @@ class map;
  */
 template <typename K,
           typename T,
-          typename Hash           = std::hash<K>,
+          typename Hash           = container_hash<K>,
           typename Equal          = std::equal_to<K>,
           typename MemoryPolicy   = default_memory_policy,
           detail::hamts::bits_t B = default_bits>
@@ -235,6 +237,17 @@ public:
                                   detail::constantly<const T*, nullptr>>(k);
     }
 
+    /*!
+     * Like `find`, but `hash` is used as the hash of `k` instead of
+     * computing it, thus it must be `hasher{}(k)`.
+     */
+    IMMER_NODISCARD const T* find_hashed(const K& k, std::size_t hash) const
+    {
+        return impl_.template get<typename persistent_type::project_value_ptr,
+                                  detail::constantly<const T*, nullptr>>(
+            k, hash);
+    }
+
     /*!
      * Inserts the association `value`.  If the key is already in the map, it
      * replaces its association in the map.  It may allocate memory and its
@@ -242,6 +255,33 @@ public:
      */
     void insert(value_type value) { impl_.add_mut(*this, std::move(value)); }
 
+    /*!
+     * Like `insert`, but `hash` is used as the hash of the key of
+     * `value`, thus it must be `hasher{}(value.first)`.
+     */
+    void insert_hashed(value_type value, std::size_t hash)
+    {
+        impl_.add_mut(*this, std::move(value), hash);
+    }
+
+    /*!
+     * Inserts all the associations in the range defined by the input
+     * iterator `first` and range sentinel `last`.  When a key is
+     * already in the map, or appears more than once in the range, the
+     * last association wins.  Every touched node is descended into
+     * and allocated only once.  It may allocate memory and its
+     * complexity is *effectively* @f$ O(n \log n) @f$ where @f$ n @f$
+     * is the size of the range.
+     */
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    void insert_range(Iter first, Sent last)
+    {
+        impl_.add_batch_mut(*this, first, last);
+    }
+
     /*!
      * Inserts the association `(k, v)`.  If the key is already in the map, it
      * replaces its association in the map.  It may allocate memory and its
@@ -252,6 +292,37 @@ public:
         impl_.add_mut(*this, {std::move(k), std::move(v)});
     }
 
+    /*!
+     * Like `set`, but the value associated to `k` is constructed in place with
+     * the arguments `args`.  It may allocate memory and its complexity is
+     * *effectively* @f$ O(1) @f$.
+     */
+    template <typename... Args>
+    void emplace(key_type k, Args&&... args)
+    {
+        impl_.add_mut(*this,
+                      persistent_type::make_value(std::move(k),
+                                                  std::forward<Args>(args)...));
+    }
+
+    /*!
+     * Like `emplace`, but it does nothing when the key `k` is already in the
+     * map, and then the arguments are not used.  It returns whether the
+     * association was inserted.  The key is hashed only once.
+     */
+    template <typename... Args>
+    bool try_emplace(key_type k, Args&&... args)
+    {
+        auto hash = Hash{}(k);
+        if (find_hashed(k, hash))
+            return false;
+        impl_.add_mut(*this,
+                      persistent_type::make_value(std::move(k),
+                                                  std::forward<Args>(args)...),
+                      hash);
+        return true;
+    }
+
     /*!
      * Replaces the association `(k, v)` by the association new association `(k,
      * fn(v))`, where `v` is the currently associated value for `k` in the map
@@ -267,6 +338,19 @@ public:
             *this, std::move(k), std::forward<Fn>(fn));
     }
 
+    /*!
+     * Like `update`, but `hash` is used as the hash of `k`, thus it
+     * must be `hasher{}(k)`.
+     */
+    template <typename Fn>
+    void update_hashed(key_type k, std::size_t hash, Fn&& fn)
+    {
+        impl_.template update_mut<typename persistent_type::project_value,
+                                  typename persistent_type::default_value,
+                                  typename persistent_type::combine_value>(
+            *this, std::move(k), hash, std::forward<Fn>(fn));
+    }
+
     /*!
      * Replaces the association `(k, v)` by the association new association `(k,
      * fn(v))`, where `v` is the currently associated value for `k` in the map
@@ -282,6 +366,25 @@ public:
             *this, std::move(k), std::forward<Fn>(fn));
     }
 
+    /*!
+     * Returns a pointer to the value associated to the key `k`, that
+     * can be changed in place, or `nullptr` when there is none.  The
+     * nodes on the path to it that are shared with other containers
+     * are copied first, and so is the value when it is stored out of
+     * line, thus the change is only seen by this transient.  The
+     * pointer is invalidated by any other change to the transient.  It
+     * may allocate memory and its complexity is *effectively* @f$ O(1)
+     * @f$.
+     */
+    IMMER_NODISCARD T* get_mut(const K& k)
+    {
+        impl_.template update_if_exists_mut<
+            typename persistent_type::project_value,
+            typename persistent_type::combine_value>(
+            *this, k, [](auto&& v) { return std::forward<decltype(v)>(v); });
+        return const_cast<T*>(find(k));
+    }
+
     /*!
      * Removes the key `k` from the k.  Does nothing if the key is not
      * associated in the map.  It may allocate memory and its complexity is
@@ -289,16 +392,47 @@ public:
      */
     void erase(const K& k) { impl_.sub_mut(*this, k); }
 
+    /*!
+     * Removes all the keys in the range `keys`, which must yield
+     * references to them and can be traversed more than once.  Every
+     * node where some of them fall is visited only once.  Its
+     * complexity is *effectively* @f$ O(n \log n) @f$ where @f$ n @f$ is
+     * the number of keys.
+     */
+    template <typename Keys>
+    void erase_many(const Keys& keys)
+    {
+        using std::begin;
+        using std::end;
+        impl_.sub_batch_mut(*this, begin(keys), end(keys));
+    }
+
+    /*!
+     * Removes the associations for which `pred(x)` returns `true`, in one
+     * traversal that keeps the subtrees where nothing is erased.  Its
+     * complexity is @f$ O(n) @f$.
+     */
+    template <typename Pred>
+    void erase_if(Pred&& pred)
+    {
+        impl_.filter_mut(*this, persistent_type::keep_unless(pred));
+    }
+
     /*!
      * Returns an @a immutable form of this container, an
      * `immer::map`.
      */
     IMMER_NODISCARD persistent_type persistent() &
     {
+        IMMER_TRACE_HOOK(persistent, impl_.size);
         this->owner_t::operator=(owner_t{});
         return impl_;
     }
-    IMMER_NODISCARD persistent_type persistent() && { return std::move(impl_); }
+    IMMER_NODISCARD persistent_type persistent() &&
+    {
+        IMMER_TRACE_HOOK(persistent, impl_.size);
+        return std::move(impl_);
+    }
 
 private:
     friend persistent_type;
@@ -308,6 +442,14 @@ private:
         : impl_(std::move(impl))
     {}
 
+    template <typename MP>
+    friend class edit_session;
+
+    map_transient(impl_t impl, owner_t owner)
+        : owner_t(std::move(owner))
+        , impl_(std::move(impl))
+    {}
+
     impl_t impl_ = impl_t::empty();
 
 public:
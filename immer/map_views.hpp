@@ -0,0 +1,268 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/iterator_facade.hpp>
+
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+namespace immer {
+
+namespace detail {
+
+/*!
+ * Iterator yielding `Proj{}(*it)` for every position `it` of the
+ * iterator `Iter`, in the same category.
+ */
+template <typename Iter, typename Proj>
+struct projecting_iterator
+    : iterator_facade<
+          projecting_iterator<Iter, Proj>,
+          typename std::iterator_traits<Iter>::iterator_category,
+          std::decay_t<decltype(Proj{}(*std::declval<Iter>()))>,
+          decltype(Proj{}(*std::declval<Iter>())),
+          typename std::iterator_traits<Iter>::difference_type,
+          std::add_pointer_t<decltype(Proj{}(*std::declval<Iter>()))>>
+{
+    using difference_type =
+        typename std::iterator_traits<Iter>::difference_type;
+
+    projecting_iterator() = default;
+
+    projecting_iterator(Iter it)
+        : it_{std::move(it)}
+    {}
+
+private:
+    friend iterator_core_access;
+
+    Iter it_;
+
+    void increment() { ++it_; }
+    void decrement() { --it_; }
+    void advance(difference_type n) { it_ += n; }
+
+    bool equal(const projecting_iterator& other) const
+    {
+        return it_ == other.it_;
+    }
+
+    difference_type distance_to(const projecting_iterator& other) const
+    {
+        return other.it_ - it_;
+    }
+
+    decltype(auto) dereference() const { return Proj{}(*it_); }
+};
+
+struct project_first
+{
+    template <typename Pair>
+    const auto& operator()(const Pair& p) const
+    {
+        return p.first;
+    }
+};
+
+struct project_second
+{
+    template <typename Pair>
+    const auto& operator()(const Pair& p) const
+    {
+        return p.second;
+    }
+};
+
+// applies `Proj` to the pairs stored in the nodes of a map, which may
+// be boxed, see `stored_value`
+template <typename Storage, typename Proj>
+struct project_stored
+{
+    template <typename Stored>
+    const auto& operator()(const Stored& v) const
+    {
+        return Proj{}(Storage::get(v));
+    }
+};
+
+template <typename Map>
+struct equal_stored_keys
+{
+    using storage_t = typename Map::stored_value_t;
+
+    template <typename Stored>
+    bool operator()(const Stored& a, const Stored& b) const
+    {
+        return typename Map::key_equal{}(storage_t::get(a).first,
+                                         storage_t::get(b).first);
+    }
+};
+
+/*!
+ * The implementation that a `projection_view` exposes to the
+ * algorithms: the chunks of the map with every element projected.
+ */
+template <typename Map, typename Proj>
+struct projection_impl
+{
+    using proj_t = project_stored<typename Map::stored_value_t, Proj>;
+
+    const Map* map;
+
+    template <typename Fn>
+    void for_each_chunk(Fn&& fn) const
+    {
+        map->impl().for_each_chunk([&](auto first, auto last) {
+            using iter_t = projecting_iterator<decltype(first), proj_t>;
+            fn(iter_t{first}, iter_t{last});
+        });
+    }
+};
+
+} // namespace detail
+
+/*!
+ * Read-only view of the keys, or of the mapped values, of a ``map`` of
+ * type `Map`, which `Projection` takes from every key-value pair.  It
+ * is made with @a keys or @a values.
+ *
+ * It keeps the map alive and it is created and copied in @f$ O(1) @f$.
+ * Its iterators yield references into the map, in the order of its own
+ * iterators, and it works with the :doc:`algorithms <algorithms>`, that
+ * are given chunks of random access iterators over the nodes of the
+ * map instead of pointers, since the keys and the values are
+ * interleaved in them.  Nothing is copied.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    auto m   = immer::map<std::string, int>{{"a", 1}, {"b", 2}};
+ *    auto sum = immer::accumulate(immer::values(m), 0);
+ *    assert(sum == 3);
+ *
+ * @endrst
+ */
+template <typename Map, typename Projection>
+class projection_view
+{
+    using impl_t = detail::projection_impl<Map, Projection>;
+
+public:
+    using iterator =
+        detail::projecting_iterator<typename Map::iterator, Projection>;
+
+    using map_type        = Map;
+    using const_iterator  = iterator;
+    using value_type      = typename iterator::value_type;
+    using reference       = typename iterator::reference;
+    using const_reference = reference;
+    using size_type       = typename Map::size_type;
+    using difference_type = typename Map::difference_type;
+
+    /*!
+     * Default constructor.  It creates a view of an empty map.
+     */
+    projection_view() = default;
+
+    /*!
+     * Constructs a view of the map `m`.
+     */
+    explicit projection_view(Map m)
+        : m_{std::move(m)}
+    {}
+
+    /*!
+     * Returns an iterator pointing at the first element of the view.
+     */
+    IMMER_NODISCARD iterator begin() const { return m_.begin(); }
+
+    /*!
+     * Returns an iterator pointing just after the last element of the
+     * view.
+     */
+    IMMER_NODISCARD iterator end() const { return m_.end(); }
+
+    /*!
+     * Returns the number of elements in the view.
+     */
+    IMMER_NODISCARD size_type size() const { return m_.size(); }
+
+    /*!
+     * Returns `true` if there are no elements in the view.
+     */
+    IMMER_NODISCARD bool empty() const { return m_.empty(); }
+
+    /*!
+     * Returns the map that the view looks into.
+     */
+    IMMER_NODISCARD const Map& map() const { return m_; }
+
+    impl_t impl() const { return {&m_}; }
+
+private:
+    Map m_;
+};
+
+/*!
+ * View of the keys of a ``map``.  See @a keys.
+ */
+template <typename Map>
+using keys_view = projection_view<Map, detail::project_first>;
+
+/*!
+ * View of the mapped values of a ``map``.  See @a values.
+ */
+template <typename Map>
+using values_view = projection_view<Map, detail::project_second>;
+
+/*!
+ * Returns `true` when the maps of the views `a` and `b` have the same
+ * keys, whatever their values.  Only the keys are compared, with the
+ * `key_equal` of the map, and the subtrees that the maps share are
+ * skipped.
+ */
+template <typename Map>
+IMMER_NODISCARD bool operator==(const keys_view<Map>& a,
+                                const keys_view<Map>& b)
+{
+    using equal_t = detail::equal_stored_keys<Map>;
+    return a.map().impl().template equals<equal_t>(b.map().impl());
+}
+
+template <typename Map>
+IMMER_NODISCARD bool operator!=(const keys_view<Map>& a,
+                                const keys_view<Map>& b)
+{
+    return !(a == b);
+}
+
+/*!
+ * Returns a view of the keys of the ``map`` `m`.
+ */
+template <typename Map>
+keys_view<Map> keys(Map m)
+{
+    return keys_view<Map>{std::move(m)};
+}
+
+/*!
+ * Returns a view of the mapped values of the ``map`` `m`.
+ */
+template <typename Map>
+values_view<Map> values(Map m)
+{
+    return values_view<Map>{std::move(m)};
+}
+
+} // namespace immer
@@ -10,6 +10,7 @@
 
 #include <immer/heap/cpp_heap.hpp>
 #include <immer/heap/heap_policy.hpp>
+#include <immer/lock/adaptive_lock_policy.hpp>
 #include <immer/lock/no_lock_policy.hpp>
 #include <immer/lock/spinlock_policy.hpp>
 #include <immer/refcount/no_refcount_policy.hpp>
@@ -17,6 +18,7 @@
 #include <immer/refcount/unsafe_refcount_policy.hpp>
 #include <immer/transience/gc_transience_policy.hpp>
 #include <immer/transience/no_transience_policy.hpp>
+#include <cstddef>
 #include <type_traits>
 
 namespace immer {
@@ -82,6 +84,11 @@ constexpr auto get_use_transient_rvalues_v =
  * @tparam UseTransientRValues Boolean flag indicating whether
  *         immutable containers should try to modify contents in-place
  *         when manipulating an r-value reference.
+ * @tparam EmbedValues Boolean flag indicating whether the inner nodes
+ *         of maps and sets should hold their values in the same
+ *         allocation as their children.  Lookups then touch a single
+ *         block, but the values are copied instead of shared when only
+ *         a child of the node changes.  It is off by default.
  */
 template <typename HeapPolicy,
           typename RefcountPolicy,
@@ -90,7 +97,8 @@ template <typename HeapPolicy,
           bool PreferFewerBiggerObjects =
               get_prefer_fewer_bigger_objects_v<HeapPolicy>,
           bool UseTransientRValues =
-              get_use_transient_rvalues_v<RefcountPolicy>>
+              get_use_transient_rvalues_v<RefcountPolicy>,
+          bool EmbedValues = false>
 struct memory_policy
 {
     using heap       = HeapPolicy;
@@ -103,6 +111,8 @@ struct memory_policy
 
     static constexpr bool use_transient_rvalues = UseTransientRValues;
 
+    static constexpr bool embed_values = EmbedValues;
+
     using transience_t = typename transience::template apply<heap>::type;
 };
 
@@ -122,7 +132,9 @@ using default_heap_policy = free_list_heap_policy<cpp_heap>;
 #endif
 
 /*!
- * By default we use thread safe reference counting.
+ * By default we use thread safe reference counting.  Pass @ref
+ * adaptive_lock_policy as the `LockPolicy` of a memory policy to park
+ * the threads that wait for the lock of an atom instead of spinning.
  */
 #if IMMER_NO_THREAD_SAFETY
 using default_refcount_policy = unsafe_refcount_policy;
@@ -139,4 +151,47 @@ using default_memory_policy = memory_policy<default_heap_policy,
                                             default_refcount_policy,
                                             default_lock_policy>;
 
+/*!
+ * Memory policy that behaves like `MemoryPolicy`, but makes maps
+ * store every value bigger than `Limit` bytes out of line, in a box
+ * that is shared by all the nodes that hold it.  Copying a node on
+ * an update then copies a pointer for each of those values instead
+ * of the values themselves.  Lookups and iterators still give
+ * access to the values, at the cost of an indirection.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    using policy = immer::out_of_line_policy<64>;
+ *    auto m = immer::map<int, big, std::hash<int>,
+ *                        std::equal_to<int>, policy>{};
+ *
+ * @endrst
+ */
+template <std::size_t Limit, typename MemoryPolicy = default_memory_policy>
+struct out_of_line_policy : MemoryPolicy
+{
+    static constexpr std::size_t out_of_line_limit = Limit;
+};
+
+/*!
+ * Metafunction that returns the size above which the values of the
+ * containers using a given *memory policy* are stored out of line,
+ * or zero when they are always stored in the nodes.
+ */
+template <typename MemoryPolicy, typename = void>
+struct get_out_of_line_limit : std::integral_constant<std::size_t, 0>
+{};
+
+template <typename MemoryPolicy>
+struct get_out_of_line_limit<
+    MemoryPolicy,
+    std::enable_if_t<(MemoryPolicy::out_of_line_limit >= 0)>>
+    : std::integral_constant<std::size_t, MemoryPolicy::out_of_line_limit>
+{};
+
+template <typename T>
+constexpr auto get_out_of_line_limit_v = get_out_of_line_limit<T>::value;
+
 } // namespace immer
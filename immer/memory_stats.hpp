@@ -0,0 +1,316 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/hamts/champ.hpp>
+#include <immer/detail/rbts/rbtree.hpp>
+#include <immer/detail/rbts/rrbtree.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <unordered_set>
+
+namespace immer {
+
+/*!
+ * Statistics about the nodes of one or more containers, as returned by
+ * @ref memory_stats and @ref memory_stats_collector.
+ *
+ * The leaves are the nodes at the bottom of a vector, that hold its
+ * elements.  The nodes of a map, set or table hold both values and
+ * children, and are all counted as inner nodes, but for the collision
+ * nodes at the bottom.  The `bytes` are those that the nodes took when
+ * they were allocated by the persistent operations, thus they do not
+ * include the overhead of the heap, nor the headroom of the nodes that
+ * were allocated by transients.
+ */
+struct memory_usage
+{
+    std::size_t inner_nodes     = 0;
+    std::size_t relaxed_nodes   = 0;
+    std::size_t leaf_nodes      = 0;
+    std::size_t collision_nodes = 0;
+
+    //! Bytes of the nodes and of the arrays of values of the hash tries.
+    std::size_t bytes = 0;
+
+    //! Values stored in the nodes, counting the shared ones only once.
+    std::size_t values = 0;
+
+    //! Children and values stored, over those that the nodes could fit.
+    std::size_t used_slots  = 0;
+    std::size_t total_slots = 0;
+
+    //! Levels of nodes of the deepest path.
+    std::size_t depth = 0;
+
+    //! Times that a node counted before was reached again, and skipped.
+    std::size_t shared_nodes = 0;
+
+    std::size_t nodes() const
+    {
+        return inner_nodes + leaf_nodes + collision_nodes;
+    }
+
+    double fill_factor() const
+    {
+        return total_slots ? double(used_slots) / total_slots : 0;
+    }
+
+    double relaxed_ratio() const
+    {
+        return inner_nodes ? double(relaxed_nodes) / inner_nodes : 0;
+    }
+};
+
+namespace detail {
+namespace usage {
+
+// Adds the nodes of a tree to `r`.  When `seen` is not null, the nodes
+// in it are skipped and the ones that are visited are added to it, as
+// are the other blocks that the nodes own, like the sizes of relaxed
+// nodes.  `Seen` is a set of pointers, with an `insert()` like that of
+// `std::unordered_set`.
+template <typename Seen = std::unordered_set<const void*>>
+struct visitor
+{
+    memory_usage& r;
+    Seen* seen;
+
+    bool first_time(const void* p)
+    {
+        if (!seen || seen->insert(p).second)
+            return true;
+        ++r.shared_nodes;
+        return false;
+    }
+
+    void owned(const void* p)
+    {
+        if (seen)
+            seen->insert(p);
+    }
+
+    void reach(std::size_t level) { r.depth = std::max(r.depth, level); }
+
+    template <typename T, typename MP, rbts::bits_t B, rbts::bits_t BL>
+    void add(const rbts::rbtree<T, MP, B, BL>& t)
+    {
+        add_rbts(t);
+    }
+
+    template <typename T, typename MP, rbts::bits_t B, rbts::bits_t BL>
+    void add(const rbts::rrbtree<T, MP, B, BL>& t)
+    {
+        add_rbts(t);
+    }
+
+    template <typename T,
+              typename Hash,
+              typename Equal,
+              typename MP,
+              hamts::bits_t B>
+    void add(const hamts::champ<T, Hash, Equal, MP, B>& t)
+    {
+        using node_t = typename hamts::champ<T, Hash, Equal, MP, B>::node_t;
+        add_champ<node_t, B>(t.root, 0);
+    }
+
+    template <typename Tree>
+    void add_rbts(const Tree& t)
+    {
+        auto tail_off = t.tail_offset();
+        add_rbts_inner(t.root, t.shift, tail_off, 1);
+        add_rbts_leaf(
+            t.tail, static_cast<rbts::count_t>(t.size - tail_off), 1);
+    }
+
+    template <typename Node>
+    void add_rbts_leaf(Node* n, rbts::count_t count, std::size_t level)
+    {
+        if (!first_time(n))
+            return;
+        reach(level);
+        ++r.leaf_nodes;
+        r.bytes += Node::sizeof_leaf_n(count);
+        r.values += count;
+        r.used_slots += count;
+        r.total_slots += rbts::branches<Node::bits_leaf>;
+    }
+
+    template <typename Node>
+    void add_rbts_inner(Node* n,
+                        rbts::shift_t shift,
+                        std::size_t size,
+                        std::size_t level)
+    {
+        using namespace rbts;
+        constexpr auto B  = Node::bits;
+        constexpr auto BL = Node::bits_leaf;
+        if (!first_time(n))
+            return;
+        reach(level);
+        ++r.inner_nodes;
+        auto child = [&](Node* c, std::size_t s) {
+            if (shift == BL)
+                add_rbts_leaf(c, static_cast<count_t>(s), level + 1);
+            else
+                add_rbts_inner(c, shift - B, s, level + 1);
+        };
+        auto count = count_t{};
+        if (auto relaxed = n->relaxed()) {
+            ++r.relaxed_nodes;
+            count     = relaxed->d.count;
+            auto prev = std::size_t{};
+            for (auto i = count_t{}; i < count; ++i) {
+                child(n->inner()[i], relaxed->d.sizes[i] - prev);
+                prev = relaxed->d.sizes[i];
+            }
+            r.bytes += Node::sizeof_inner_r_n(count);
+            if (!Node::embed_relaxed) {
+                owned(relaxed);
+                r.bytes += Node::sizeof_relaxed_n(count);
+            }
+        } else {
+            auto cap = std::size_t{1} << shift;
+            count    = size ? static_cast<count_t>(((size - 1) >> shift) + 1)
+                            : count_t{};
+            for (auto i = count_t{}; i < count; ++i)
+                child(n->inner()[i], std::min(cap, size - i * cap));
+            r.bytes += Node::sizeof_inner_n(count);
+        }
+        r.used_slots += count;
+        r.total_slots += branches<B>;
+    }
+
+    template <typename Node, hamts::bits_t B>
+    void add_champ(Node* n, hamts::count_t depth)
+    {
+        using namespace hamts;
+        if (!first_time(n))
+            return;
+        reach(depth + 1);
+        if (depth == max_depth<B>) {
+            auto count = n->collision_count();
+            ++r.collision_nodes;
+            r.bytes += Node::sizeof_collision_n(count);
+            r.values += count;
+            r.used_slots += count;
+            r.total_slots += count;
+            return;
+        }
+        auto nc = n->children_count();
+        auto nv = n->data_count();
+        ++r.inner_nodes;
+        r.used_slots += nc + nv;
+        r.total_slots += branches<B>;
+        if (nv && Node::embeds_values(n, nc)) {
+            r.bytes += Node::sizeof_inner_n(nc, nv);
+            r.values += nv;
+        } else {
+            r.bytes += Node::sizeof_inner_n(nc);
+            // the arrays of values may be shared among nodes too
+            if (nv && first_time(n->impl.d.data.inner.values)) {
+                r.bytes += Node::sizeof_values_n(nv);
+                r.values += nv;
+            }
+        }
+        for (auto i = count_t{}; i < nc; ++i)
+            add_champ<Node, B>(n->children()[i], depth + 1);
+    }
+};
+
+} // namespace usage
+} // namespace detail
+
+/*!
+ * Returns statistics about the nodes of the container `c`, that may be
+ * a @ref vector, @ref flex_vector, @ref map, @ref set or @ref table.
+ * It visits every node once and does not allocate memory, thus its
+ * complexity is @f$ O(n) @f$ in the number of nodes, about @f$ O(size
+ * / 2^B) @f$.  The nodes that are shared within the container, like
+ * those of a vector concatenated with itself, are counted every time
+ * that they are reached.  Use @ref memory_stats_collector to count the
+ * nodes of several containers that share them.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    auto v = immer::vector<int>{...};
+ *    auto s = immer::memory_stats(v);
+ *    metrics.gauge("bytes", s.bytes);
+ *    metrics.gauge("fill", s.fill_factor());
+ *
+ * @endrst
+ */
+template <typename Container>
+memory_usage memory_stats(const Container& c)
+{
+    auto r = memory_usage{};
+    detail::usage::visitor<>{r, nullptr}.add(c.impl());
+    return r;
+}
+
+/*!
+ * Accumulates the statistics about the nodes of several containers,
+ * counting the nodes that they share only once, so that the `bytes`
+ * are those that they take together.  The nodes that it saw before
+ * are not visited again, thus adding a new version of a container
+ * costs in proportion to what changed, plus the cost of remembering
+ * the new nodes in a hash set.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    auto c = immer::memory_stats_collector{};
+ *    for (auto& snapshot : history)
+ *        c.add(snapshot);
+ *    auto s = c.usage(); // s.shared_nodes tells how much is shared
+ *
+ * @endrst
+ */
+class memory_stats_collector
+{
+public:
+    /*!
+     * Adds the nodes of `c`, that may be any container that @ref
+     * memory_stats supports, and that have not been added before.
+     */
+    template <typename Container>
+    memory_stats_collector& add(const Container& c)
+    {
+        detail::usage::visitor<>{usage_, &seen_}.add(c.impl());
+        return *this;
+    }
+
+    const memory_usage& usage() const { return usage_; }
+
+private:
+    memory_usage usage_;
+    std::unordered_set<const void*> seen_;
+};
+
+/*!
+ * Returns the statistics about the nodes of all the containers `cs`,
+ * counting the nodes that they share only once.  See @ref
+ * memory_stats_collector.
+ */
+template <typename... Containers>
+memory_usage shared_memory_stats(const Containers&... cs)
+{
+    auto c = memory_stats_collector{};
+    (void) std::initializer_list<int>{(c.add(cs), 0)...};
+    return c.usage();
+}
+
+} // namespace immer
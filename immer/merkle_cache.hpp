@@ -0,0 +1,689 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/hamts/champ.hpp>
+#include <immer/detail/rbts/operations.hpp>
+#include <immer/detail/rbts/rrbtree.hpp>
+#include <immer/detail/rbts/subtree.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace immer {
+
+/*!
+ * Hashes the values stored in the containers for a @ref merkle_cache.
+ * It uses `std::hash` and combines both members of a `std::pair`, so
+ * that maps hash their keys and their mapped values.
+ */
+template <typename T>
+struct merkle_hash : std::hash<T>
+{};
+
+namespace detail {
+namespace merkle {
+
+inline std::size_t combine(std::size_t seed, std::size_t h)
+{
+    return seed ^ (h + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+}
+
+// The pairs of distinct nodes that were found equal, with the smaller
+// pointer first, so that comparing them again does not visit them.
+template <typename Key, typename KeyHash>
+struct equal_memo
+{
+    using pair_t = std::pair<Key, Key>;
+
+    struct pair_hash
+    {
+        std::size_t operator()(const pair_t& p) const
+        {
+            return combine(KeyHash{}(p.first), KeyHash{}(p.second));
+        }
+    };
+
+    std::unordered_set<pair_t, pair_hash> pairs;
+
+    static pair_t make(Key a, Key b)
+    {
+        return std::less<Key>{}(a, b) ? pair_t{a, b} : pair_t{b, a};
+    }
+
+    bool contains(Key a, Key b) const { return pairs.count(make(a, b)); }
+    void insert(Key a, Key b) { pairs.insert(make(a, b)); }
+
+    // forgets the pairs with a node that the cache does not hold
+    template <typename Map>
+    void trim(const Map& held)
+    {
+        for (auto it = pairs.begin(); it != pairs.end();) {
+            if (held.count(it->first) && held.count(it->second))
+                ++it;
+            else
+                it = pairs.erase(it);
+        }
+    }
+};
+
+// The shape of a `rbtree` depends only on its size, thus two of them
+// that differ have subtrees that hash differently at the same places.
+template <typename Tree>
+struct is_relaxed_tree : std::false_type
+{};
+
+template <typename T, typename MP, rbts::bits_t B, rbts::bits_t BL>
+struct is_relaxed_tree<rbts::rrbtree<T, MP, B, BL>> : std::true_type
+{};
+
+template <typename Tree, typename Hash, typename Equal>
+class rbts_cache
+{
+    using node_t  = typename Tree::node_t;
+    using value_t = typename node_t::value_t;
+    using sub_t   = rbts::subtree<node_t>;
+    using key_t   = std::pair<node_t*, std::size_t>;
+
+    static constexpr auto B  = node_t::bits;
+    static constexpr auto BL = node_t::bits_leaf;
+
+    static constexpr bool relaxed = is_relaxed_tree<Tree>::value;
+
+    struct key_hash
+    {
+        std::size_t operator()(const key_t& k) const
+        {
+            return combine(std::hash<const void*>{}(k.first), k.second);
+        }
+    };
+
+    struct entry
+    {
+        rbts::shift_t shift;
+        std::size_t hash;
+    };
+
+    using map_t = std::unordered_map<key_t, entry, key_hash>;
+
+    struct chunk
+    {
+        const value_t* data;
+        std::size_t size;
+    };
+
+public:
+    rbts_cache(Hash hash, Equal equal)
+        : hash_{std::move(hash)}
+        , equal_{std::move(equal)}
+    {}
+
+    rbts_cache(rbts_cache&& other)
+        : hash_{std::move(other.hash_)}
+        , equal_{std::move(other.equal_)}
+        , cache_{std::move(other.cache_)}
+        , memo_{std::move(other.memo_)}
+    {
+        other.cache_.clear();
+        other.memo_.pairs.clear();
+    }
+
+    ~rbts_cache() { clear(); }
+
+    std::size_t hash(const Tree& t)
+    {
+        sub_t roots[2];
+        auto n    = rbts::root_subtrees(t, roots);
+        auto seed = std::size_t{t.size};
+        for (auto i = 0; i < n; ++i)
+            seed = combine(seed, hash_sub(roots[i]));
+        return seed;
+    }
+
+    bool equal(const Tree& a, const Tree& b)
+    {
+        if (a.size != b.size)
+            return false;
+        sub_t xs[2], ys[2];
+        auto nx = rbts::root_subtrees(a, xs);
+        auto ny = rbts::root_subtrees(b, ys);
+        return equal_subs(xs, nx, ys, ny);
+    }
+
+    std::vector<std::size_t> children(const Tree& t,
+                                      const std::vector<std::uint32_t>& path)
+    {
+        sub_t roots[2];
+        auto n = rbts::root_subtrees(t, roots);
+        auto r = std::vector<std::size_t>{};
+        if (path.empty()) {
+            for (auto i = 0; i < n; ++i)
+                r.push_back(hash_sub(roots[i]));
+            return r;
+        }
+        if (path[0] >= std::uint32_t(n))
+            IMMER_THROW(std::out_of_range{"merkle path out of range"});
+        auto s = roots[path[0]];
+        for (auto i = std::size_t{1}; i < path.size(); ++i) {
+            auto found = false;
+            auto j     = std::uint32_t{};
+            if (s.level > 0)
+                rbts::each_subtree(s, s.first, s.last(), [&](auto&& c) {
+                    if (j++ == path[i]) {
+                        s     = c;
+                        found = true;
+                    }
+                });
+            if (!found)
+                IMMER_THROW(std::out_of_range{"merkle path out of range"});
+        }
+        if (s.level > 0)
+            rbts::each_subtree(s, s.first, s.last(), [&](auto&& c) {
+                r.push_back(hash_sub(c));
+            });
+        return r;
+    }
+
+    std::size_t size() const { return cache_.size(); }
+
+    void trim()
+    {
+        for (auto again = true; again;) {
+            again = false;
+            for (auto it = cache_.begin(); it != cache_.end();) {
+                if (node_t::refs(it->first.first).unique()) {
+                    release(*it);
+                    it    = cache_.erase(it);
+                    again = true;
+                } else
+                    ++it;
+            }
+        }
+        memo_.trim(cache_);
+    }
+
+    void clear()
+    {
+        for (auto& e : cache_)
+            release(e);
+        cache_.clear();
+        memo_.pairs.clear();
+    }
+
+private:
+    // leaves are hashed every time, caching them would cost more
+    // memory than rehashing their few elements
+    std::size_t hash_sub(const sub_t& s)
+    {
+        auto seed = std::size_t{s.size};
+        if (s.level == 0) {
+            const auto data = s.node->leaf();
+            for (auto i = std::size_t{}; i < s.size; ++i)
+                seed = combine(seed, hash_(data[i]));
+            return seed;
+        }
+        auto key = key_t{s.node, s.size};
+        auto it  = cache_.find(key);
+        if (it != cache_.end())
+            return it->second.hash;
+        rbts::each_subtree(s, s.first, s.last(), [&](auto&& c) {
+            seed = combine(seed, hash_sub(c));
+        });
+        auto shift = static_cast<rbts::shift_t>(BL + (s.level - 1) * B);
+        cache_.emplace(key, entry{shift, seed});
+        s.node->inc();
+        return seed;
+    }
+
+    // the subtrees of a `rrbtree` whose sizes do not line up, because
+    // they were built in different ways, are compared element by
+    // element, otherwise the subtrees are compared in pairs
+    bool equal_subs(const sub_t* xs, int nx, const sub_t* ys, int ny)
+    {
+        auto aligned = nx == ny;
+        for (auto i = 0; aligned && i < nx; ++i)
+            aligned = xs[i].size == ys[i].size;
+        if (!aligned)
+            return equal_elements(xs, nx, ys, ny);
+        for (auto i = 0; i < nx; ++i)
+            if (!equal_sub(xs[i], ys[i]))
+                return false;
+        return true;
+    }
+
+    bool equal_sub(const sub_t& a, const sub_t& b)
+    {
+        if (a.node == b.node && a.level == b.level)
+            return true;
+        if (a.level == 0 && b.level == 0) {
+            auto fst = a.node->leaf();
+            return std::equal(fst, fst + a.size, b.node->leaf(), equal_);
+        }
+        auto ka = key_t{a.node, a.size};
+        auto kb = key_t{b.node, b.size};
+        if (a.level > 0 && b.level > 0 && memo_.contains(ka, kb))
+            return true;
+        if (!relaxed && hash_sub(a) != hash_sub(b))
+            return false;
+        if (a.level == 0 || b.level == 0)
+            return equal_elements(&a, 1, &b, 1);
+        sub_t xs[1 << B], ys[1 << B];
+        auto nx = 0, ny = 0;
+        rbts::each_subtree(
+            a, a.first, a.last(), [&](auto&& c) { xs[nx++] = c; });
+        rbts::each_subtree(
+            b, b.first, b.last(), [&](auto&& c) { ys[ny++] = c; });
+        if (!equal_subs(xs, nx, ys, ny))
+            return false;
+        // the memo only keeps nodes that the cache holds
+        hash_sub(a);
+        hash_sub(b);
+        memo_.insert(ka, kb);
+        return true;
+    }
+
+    bool equal_elements(const sub_t* xs, int nx, const sub_t* ys, int ny)
+    {
+        auto cx = std::vector<chunk>{};
+        auto cy = std::vector<chunk>{};
+        for (auto i = 0; i < nx; ++i)
+            leaves(xs[i], cx);
+        for (auto i = 0; i < ny; ++i)
+            leaves(ys[i], cy);
+        auto x = cx.begin(), y = cy.begin();
+        auto i = std::size_t{}, j = std::size_t{};
+        for (; x != cx.end() && y != cy.end();) {
+            auto n = std::min(x->size - i, y->size - j);
+            if (!std::equal(x->data + i, x->data + i + n, y->data + j, equal_))
+                return false;
+            i += n;
+            j += n;
+            if (i == x->size)
+                ++x, i = 0;
+            if (j == y->size)
+                ++y, j = 0;
+        }
+        return x == cx.end() && y == cy.end();
+    }
+
+    static void leaves(const sub_t& s, std::vector<chunk>& out)
+    {
+        if (s.level == 0)
+            out.push_back({s.node->leaf(), s.size});
+        else
+            rbts::each_subtree(
+                s, s.first, s.last(), [&](auto&& c) { leaves(c, out); });
+    }
+
+    static void release(const typename map_t::value_type& e)
+    {
+        rbts::dec_inner(e.first.first, e.second.shift, e.first.second);
+    }
+
+    Hash hash_;
+    Equal equal_;
+    map_t cache_;
+    equal_memo<key_t, key_hash> memo_;
+};
+
+template <typename Tree, typename Hash, typename Equal>
+class champ_cache
+{
+    using node_t = typename Tree::node_t;
+
+    static constexpr auto B = Tree::bits;
+
+    struct entry
+    {
+        hamts::count_t depth;
+        std::size_t hash;
+    };
+
+    using map_t = std::unordered_map<node_t*, entry>;
+
+public:
+    champ_cache(Hash hash, Equal equal)
+        : hash_{std::move(hash)}
+        , equal_{std::move(equal)}
+    {}
+
+    champ_cache(champ_cache&& other)
+        : hash_{std::move(other.hash_)}
+        , equal_{std::move(other.equal_)}
+        , cache_{std::move(other.cache_)}
+        , memo_{std::move(other.memo_)}
+    {
+        other.cache_.clear();
+        other.memo_.pairs.clear();
+    }
+
+    ~champ_cache() { clear(); }
+
+    std::size_t hash(const Tree& t)
+    {
+        return combine(std::size_t{t.size}, hash_node(t.root, 0));
+    }
+
+    bool equal(const Tree& a, const Tree& b)
+    {
+        return a.size == b.size && equal_node(a.root, b.root, 0);
+    }
+
+    std::vector<std::size_t> children(const Tree& t,
+                                      const std::vector<std::uint32_t>& path)
+    {
+        auto r = std::vector<std::size_t>{};
+        if (path.empty()) {
+            r.push_back(hash_node(t.root, 0));
+            return r;
+        }
+        if (path[0] != 0)
+            IMMER_THROW(std::out_of_range{"merkle path out of range"});
+        auto n     = t.root;
+        auto depth = hamts::count_t{};
+        for (auto i = std::size_t{1}; i < path.size(); ++i, ++depth) {
+            if (depth == hamts::max_depth<B> || path[i] >= n->children_count())
+                IMMER_THROW(std::out_of_range{"merkle path out of range"});
+            n = n->children()[path[i]];
+        }
+        if (depth < hamts::max_depth<B>) {
+            auto fst = n->children();
+            auto lst = fst + n->children_count();
+            for (; fst != lst; ++fst)
+                r.push_back(hash_node(*fst, depth + 1));
+        }
+        return r;
+    }
+
+    std::size_t size() const { return cache_.size(); }
+
+    void trim()
+    {
+        for (auto again = true; again;) {
+            again = false;
+            for (auto it = cache_.begin(); it != cache_.end();) {
+                if (node_t::refs(it->first).unique()) {
+                    release(*it);
+                    it    = cache_.erase(it);
+                    again = true;
+                } else
+                    ++it;
+            }
+        }
+        memo_.trim(cache_);
+    }
+
+    void clear()
+    {
+        for (auto& e : cache_)
+            release(e);
+        cache_.clear();
+        memo_.pairs.clear();
+    }
+
+private:
+    // the shape of the tries depends only on their contents, thus the
+    // nodes at the same place in two equal ones hash the same
+    bool equal_node(node_t* a, node_t* b, hamts::count_t depth)
+    {
+        if (a == b)
+            return true;
+        if (depth == hamts::max_depth<B>)
+            return equal_collisions(a, b);
+        if (memo_.contains(a, b))
+            return true;
+        if (hash_node(a, depth) != hash_node(b, depth) ||
+            a->nodemap() != b->nodemap() || a->datamap() != b->datamap())
+            return false;
+        if (auto nv = a->data_count()) {
+            auto fst = a->values();
+            if (!std::equal(fst, fst + nv, b->values(), equal_))
+                return false;
+        }
+        auto nc = a->children_count();
+        for (auto i = hamts::count_t{}; i < nc; ++i)
+            if (!equal_node(a->children()[i], b->children()[i], depth + 1))
+                return false;
+        memo_.insert(a, b);
+        return true;
+    }
+
+    bool equal_collisions(node_t* a, node_t* b)
+    {
+        auto n = a->collision_count();
+        if (n != b->collision_count())
+            return false;
+        auto fst = b->collisions();
+        auto lst = fst + n;
+        for (auto x = a->collisions(); x != a->collisions() + n; ++x)
+            if (std::find_if(fst, lst, [&](auto& y) {
+                    return equal_(*x, y);
+                }) == lst)
+                return false;
+        return true;
+    }
+
+    std::size_t hash_node(node_t* n, hamts::count_t depth)
+    {
+        // the order of the collisions depends on the history of the
+        // node, so they are combined in a way that does not depend on it
+        if (depth == hamts::max_depth<B>) {
+            auto sum = std::size_t{};
+            auto fst = n->collisions();
+            auto lst = fst + n->collision_count();
+            for (; fst != lst; ++fst)
+                sum += combine(0, hash_(*fst));
+            return combine(std::size_t{n->collision_count()}, sum);
+        }
+        auto it = cache_.find(n);
+        if (it != cache_.end())
+            return it->second.hash;
+        auto seed = combine(std::size_t{n->datamap()}, n->nodemap());
+        if (n->datamap()) {
+            auto fst = n->values();
+            auto lst = fst + n->data_count();
+            for (; fst != lst; ++fst)
+                seed = combine(seed, hash_(*fst));
+        }
+        auto fst = n->children();
+        auto lst = fst + n->children_count();
+        for (; fst != lst; ++fst)
+            seed = combine(seed, hash_node(*fst, depth + 1));
+        cache_.emplace(n, entry{depth, seed});
+        n->inc();
+        return seed;
+    }
+
+    static void release(const typename map_t::value_type& e)
+    {
+        if (e.first->dec())
+            node_t::delete_deep(e.first, e.second.depth);
+    }
+
+    Hash hash_;
+    Equal equal_;
+    map_t cache_;
+    equal_memo<node_t*, std::hash<node_t*>> memo_;
+};
+
+template <typename Tree, typename Hash, typename Equal>
+struct cache_for
+{
+    using type = rbts_cache<Tree, Hash, Equal>;
+};
+
+template <typename T,
+          typename H,
+          typename E,
+          typename MP,
+          hamts::bits_t B,
+          typename Hash,
+          typename Equal>
+struct cache_for<hamts::champ<T, H, E, MP, B>, Hash, Equal>
+{
+    using type = champ_cache<hamts::champ<T, H, E, MP, B>, Hash, Equal>;
+};
+
+} // namespace merkle
+} // namespace detail
+
+template <typename K, typename V>
+struct merkle_hash<std::pair<K, V>>
+{
+    std::size_t operator()(const std::pair<K, V>& x) const
+    {
+        return detail::merkle::combine(merkle_hash<K>{}(x.first),
+                                       merkle_hash<V>{}(x.second));
+    }
+};
+
+/*!
+ * Remembers a hash of the contents of each inner node of the
+ * containers of type `Container` that it has hashed, so that the hash
+ * of a new version only needs to visit the nodes that it does not
+ * share with the versions hashed before.  It supports ``vector``,
+ * ``flex_vector``, ``map``, ``set`` and ``table``.
+ *
+ * @tparam Hash A function object that hashes one `value_type`.
+ *
+ * @tparam Equal A function object that compares two `value_type`, for
+ *         @ref equal.
+ *
+ * The hash of a node combines the hashes of its elements and of its
+ * children, as in a Merkle tree.  This makes the cache useful to keep
+ * two replicas of a container in sync: they compare their `hash()`
+ * first and, when it differs, walk down with `children()` through the
+ * subtrees whose hashes differ, until they find the leaves that they
+ * need to exchange.
+ *
+ * @rst
+ *
+ * .. note:: The hashes of ``map``, ``set`` and ``table`` only depend on
+ *    their contents, since the shape of their trees only depends on
+ *    them too.  The shape of a ``flex_vector`` also depends on how it
+ *    was built, so two with the same elements may hash differently
+ *    when they were concatenated or sliced in different ways.  The
+ *    hashes are not cryptographic.
+ *
+ * .. note:: The cache holds a reference to every node that it keeps a
+ *    hash for, so those can not be freed and their identity stays
+ *    valid.  Call ``trim()`` to forget the nodes that are not used by
+ *    any container any more, or ``clear()`` to forget everything.
+ *    Because of this, it requires a memory policy with reference
+ *    counting.
+ *
+ * .. note:: Besides the hashes, the cache remembers the pairs of
+ *    distinct nodes that @ref equal found equal, so that comparing two
+ *    versions again, or others made from them, skips those subtrees as
+ *    it skips the nodes that they share.
+ *
+ * .. warning:: Only pass persistent values to the cache.  The nodes
+ *    owned by a transient are updated in place and their hashes would
+ *    be stale.
+ *
+ * @endrst
+ */
+template <typename Container,
+          typename Hash  = merkle_hash<typename Container::value_type>,
+          typename Equal = std::equal_to<typename Container::value_type>>
+class merkle_cache
+{
+    using impl_t =
+        std::decay_t<decltype(std::declval<const Container&>().impl())>;
+    using cache_t =
+        typename detail::merkle::cache_for<impl_t, Hash, Equal>::type;
+
+public:
+    /*!
+     * Identifies a subtree by the index of each child taken on the way
+     * down from the top of the container.
+     */
+    using path_t = std::vector<std::uint32_t>;
+
+    explicit merkle_cache(Hash hash = {}, Equal equal = {})
+        : impl_{std::move(hash), std::move(equal)}
+    {}
+
+    merkle_cache(merkle_cache&&) = default;
+
+    merkle_cache(const merkle_cache&)            = delete;
+    merkle_cache& operator=(const merkle_cache&) = delete;
+    merkle_cache& operator=(merkle_cache&&)      = delete;
+
+    /*!
+     * Returns the hash of all the elements of `c`.
+     */
+    std::size_t hash(const Container& c) { return impl_.hash(c.impl()); }
+
+    /*!
+     * Returns whether `a` and `b` hold the same elements, as their
+     * `operator==` would do, but using the cache to skip subtrees.
+     * The nodes that they share are equal, the subtrees at the same
+     * place that hash differently are not, and those found equal
+     * before are not visited again.  Thus the first comparison of two
+     * versions hashes them both, and later ones only visit the nodes
+     * that were not hashed or compared before.
+     *
+     * @rst
+     *
+     * .. note:: The shape of a ``flex_vector`` does not only depend on
+     *    its elements, thus its subtrees that hash differently are
+     *    compared anyway, and those that were built differently are
+     *    compared element by element.
+     *
+     * @endrst
+     */
+    bool equal(const Container& a, const Container& b)
+    {
+        return impl_.equal(a.impl(), b.impl());
+    }
+
+    /*!
+     * Returns the hashes of the subtrees right below the one at `path`
+     * in `c`, in order.  An empty `path` names the top of the
+     * container, and the result is empty when the subtree is a leaf.
+     * When a subtree hashes differently but all its children match,
+     * the elements stored in the subtree itself differ.  It throws
+     * `std::out_of_range` when `path` does not name a subtree of `c`.
+     */
+    std::vector<std::size_t> children(const Container& c, const path_t& path)
+    {
+        return impl_.children(c.impl(), path);
+    }
+
+    /*!
+     * Returns the number of nodes the cache holds a hash for.
+     */
+    std::size_t size() const { return impl_.size(); }
+
+    /*!
+     * Forgets the hashes of the nodes that are only referenced by the
+     * cache itself.
+     */
+    void trim() { impl_.trim(); }
+
+    /*!
+     * Forgets all the hashes.
+     */
+    void clear() { impl_.clear(); }
+
+private:
+    cache_t impl_;
+};
+
+} // namespace immer
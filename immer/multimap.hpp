@@ -0,0 +1,405 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/algorithm.hpp>
+#include <immer/config.hpp>
+#include <immer/detail/util.hpp>
+#include <immer/map.hpp>
+#include <immer/memory_policy.hpp>
+#include <immer/set.hpp>
+#include <immer/set_transient.hpp>
+#include <immer/small_map.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <utility>
+
+namespace immer {
+
+namespace detail {
+namespace small {
+
+/*!
+ * The values of one key of a @a multimap.  Up to `N` of them are
+ * stored inline, right in the entry of the trie of the multimap, and
+ * more than that in a nested `Set`.
+ */
+template <typename V, typename Set, std::size_t N>
+class value_group
+{
+    static constexpr auto big = static_cast<std::size_t>(-1);
+
+public:
+    using iterator = small::iterator<V, typename Set::iterator>;
+
+    value_group() = default;
+
+    explicit value_group(Set s)
+        : size_{big}
+    {
+        new (&s_.big) Set{std::move(s)};
+    }
+
+    value_group(const value_group& other) { copy_from(other); }
+
+    value_group(value_group&& other) { move_from(std::move(other)); }
+
+    value_group& operator=(const value_group& other)
+    {
+        if (this != &other) {
+            auto tmp = other;
+            destroy();
+            move_from(std::move(tmp));
+        }
+        return *this;
+    }
+
+    value_group& operator=(value_group&& other)
+    {
+        if (this != &other) {
+            destroy();
+            move_from(std::move(other));
+        }
+        return *this;
+    }
+
+    ~value_group() { destroy(); }
+
+    bool is_small() const { return size_ != big; }
+
+    std::size_t size() const { return is_small() ? size_ : s_.big.size(); }
+
+    bool empty() const { return size() == 0; }
+
+    iterator begin() const
+    {
+        return is_small() ? iterator{s_.small} : iterator{s_.big.begin()};
+    }
+
+    iterator end() const
+    {
+        return is_small() ? iterator{s_.small + size_}
+                          : iterator{s_.big.end()};
+    }
+
+    bool contains(const V& v) const
+    {
+        if (!is_small())
+            return s_.big.count(v) > 0;
+        for (auto i = std::size_t{}; i < size_; ++i)
+            if (s_.small[i] == v)
+                return true;
+        return false;
+    }
+
+    template <typename Fn>
+    void for_each_chunk(Fn&& fn) const
+    {
+        if (is_small())
+            fn(static_cast<const V*>(s_.small),
+               static_cast<const V*>(s_.small + size_));
+        else
+            immer::for_each_chunk(s_.big, std::forward<Fn>(fn));
+    }
+
+    // the group with `v` added, which must not be in it yet
+    value_group with(V v) const
+    {
+        if (!is_small())
+            return value_group{s_.big.insert(std::move(v))};
+        if (size_ < N) {
+            auto r = *this;
+            new (r.s_.small + r.size_) V{std::move(v)};
+            ++r.size_;
+            return r;
+        }
+        auto s = typename Set::transient_type{};
+        for (auto i = std::size_t{}; i < size_; ++i)
+            s.insert(s_.small[i]);
+        s.insert(std::move(v));
+        return value_group{s.persistent()};
+    }
+
+    // the group without `v`, which must be in it
+    value_group without(const V& v) const
+    {
+        if (!is_small()) {
+            auto s = s_.big.erase(v);
+            if (s.size() > N / 2)
+                return value_group{std::move(s)};
+            auto r = value_group{};
+            for (auto&& x : s)
+                r = r.with(x);
+            return r;
+        }
+        auto r = value_group{};
+        for (auto i = std::size_t{}; i < size_; ++i)
+            if (!(s_.small[i] == v))
+                r = r.with(s_.small[i]);
+        return r;
+    }
+
+    bool operator==(const value_group& other) const
+    {
+        if (!is_small() && !other.is_small())
+            return s_.big == other.s_.big;
+        if (size() != other.size())
+            return false;
+        for (auto&& x : *this)
+            if (!other.contains(x))
+                return false;
+        return true;
+    }
+    bool operator!=(const value_group& other) const
+    {
+        return !(*this == other);
+    }
+
+private:
+    union storage
+    {
+        storage() {}
+        ~storage() {}
+
+        V small[N];
+        Set big;
+    };
+
+    void copy_from(const value_group& other)
+    {
+        if (!other.is_small()) {
+            new (&s_.big) Set{other.s_.big};
+            size_ = big;
+            return;
+        }
+        size_ = 0;
+        IMMER_TRY {
+            for (; size_ < other.size_; ++size_)
+                new (s_.small + size_) V{other.s_.small[size_]};
+        }
+        IMMER_CATCH (...) {
+            destroy();
+            IMMER_RETHROW;
+        }
+    }
+
+    void move_from(value_group&& other)
+    {
+        if (!other.is_small()) {
+            new (&s_.big) Set{std::move(other.s_.big)};
+            size_ = big;
+            return;
+        }
+        size_ = 0;
+        IMMER_TRY {
+            for (; size_ < other.size_; ++size_)
+                new (s_.small + size_) V{std::move(other.s_.small[size_])};
+        }
+        IMMER_CATCH (...) {
+            destroy();
+            IMMER_RETHROW;
+        }
+    }
+
+    void destroy()
+    {
+        if (is_small())
+            detail::destroy_n(s_.small, size_);
+        else
+            s_.big.~Set();
+        size_ = 0;
+    }
+
+    std::size_t size_ = 0;
+    storage s_;
+};
+
+} // namespace small
+} // namespace detail
+
+/*!
+ * Immutable unordered mapping from keys of type `K` to sets of values
+ * of type `V`.  It is a single @ref map whose entries hold the values
+ * of their key: up to `N` of them are stored inline, in the entry
+ * itself, and only past that they are promoted to a nested @ref set.
+ * Since most keys of a multimap have only a few values, most of them
+ * take no allocation of their own.
+ *
+ * @tparam K    The type of the keys.
+ * @tparam V    The type of the values, hashed with `std::hash<V>` and
+ *              compared with `operator==`.
+ * @tparam N    The number of values of a key that are stored inline.
+ * @tparam Hash The type of a function object capable of hashing
+ *              values of type `K`.
+ * @tparam Equal The type of a function object capable of comparing
+ *              values of type `K`.
+ * @tparam MemoryPolicy Memory management policy. See @ref
+ *              memory_policy.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    auto m = immer::multimap<int, std::string>{}
+ *                 .insert(1, "a")
+ *                 .insert(1, "b")
+ *                 .insert(2, "c");
+ *    m.equal_range(1).for_each_chunk([](auto f, auto l) { ... });
+ *
+ * .. note:: The inline values make every entry of the trie bigger, by
+ *    the size of `N` values.  Keep ``N`` small, the default fits keys
+ *    that usually map to one or two values.  A group that was promoted
+ *    to a set goes back inline when it shrinks to `N / 2` values.
+ *
+ * @endrst
+ */
+template <typename K,
+          typename V,
+          std::size_t N           = 2,
+          typename Hash           = std::hash<K>,
+          typename Equal          = std::equal_to<K>,
+          typename MemoryPolicy   = default_memory_policy,
+          detail::hamts::bits_t B = default_bits>
+class multimap
+{
+    using set_t =
+        immer::set<V, std::hash<V>, std::equal_to<V>, MemoryPolicy, B>;
+
+public:
+    using key_type   = K;
+    using value_type = V;
+    using size_type  = detail::hamts::size_t;
+    using group_type = detail::small::value_group<V, set_t, N>;
+    using map_type   = map<K, group_type, Hash, Equal, MemoryPolicy, B>;
+    using iterator   = typename map_type::iterator;
+    using hasher     = Hash;
+    using key_equal  = Equal;
+
+    /*!
+     * Default constructor.  It creates a multimap of `size() == 0`.
+     */
+    multimap() = default;
+
+    /*!
+     * Returns an iterator over the entries of the multimap, pairs of a
+     * key and the group of its values.
+     */
+    IMMER_NODISCARD iterator begin() const { return map_.begin(); }
+    IMMER_NODISCARD iterator end() const { return map_.end(); }
+
+    /*!
+     * Returns the number of values in the multimap, of all the keys.
+     */
+    IMMER_NODISCARD size_type size() const { return size_; }
+
+    /*!
+     * Returns the number of distinct keys in the multimap.
+     */
+    IMMER_NODISCARD size_type key_count() const { return map_.size(); }
+
+    IMMER_NODISCARD bool empty() const { return size_ == 0; }
+
+    /*!
+     * Returns the number of values of the key `k`.
+     */
+    IMMER_NODISCARD size_type count(const K& k) const
+    {
+        auto p = map_.find(k);
+        return p ? p->size() : 0;
+    }
+
+    /*!
+     * Returns whether `v` is one of the values of the key `k`.
+     */
+    IMMER_NODISCARD bool contains(const K& k, const V& v) const
+    {
+        auto p = map_.find(k);
+        return p && p->contains(v);
+    }
+
+    /*!
+     * Returns the values of the key `k`, an empty group when there are
+     * none.  The group can be iterated, and its `for_each_chunk` calls
+     * `fn(first, last)` with contiguous spans of `const V*`: a single
+     * one for the inline values, the leaves of the nested set
+     * otherwise.
+     */
+    IMMER_NODISCARD const group_type& equal_range(const K& k) const
+    {
+        static const auto empty = group_type{};
+        auto p                  = map_.find(k);
+        return p ? *p : empty;
+    }
+
+    /*!
+     * Returns a multimap where `v` is one of the values of `k`.  It
+     * returns the same multimap when it already was.
+     */
+    IMMER_NODISCARD multimap insert(K k, V v) const
+    {
+        auto p = map_.find(k);
+        if (p && p->contains(v))
+            return *this;
+        auto g = p ? p->with(std::move(v)) : group_type{}.with(std::move(v));
+        return {map_.set(std::move(k), std::move(g)), size_ + 1};
+    }
+
+    /*!
+     * Returns a multimap without the key `k` and all of its values.
+     */
+    IMMER_NODISCARD multimap erase(const K& k) const
+    {
+        auto p = map_.find(k);
+        if (!p)
+            return *this;
+        return {map_.erase(k), size_ - p->size()};
+    }
+
+    /*!
+     * Returns a multimap where `v` is not a value of `k`.  The key is
+     * removed along with its last value.
+     */
+    IMMER_NODISCARD multimap erase(const K& k, const V& v) const
+    {
+        auto p = map_.find(k);
+        if (!p || !p->contains(v))
+            return *this;
+        if (p->size() == 1)
+            return {map_.erase(k), size_ - 1};
+        return {map_.set(k, p->without(v)), size_ - 1};
+    }
+
+    IMMER_NODISCARD bool operator==(const multimap& other) const
+    {
+        return size_ == other.size_ && map_ == other.map_;
+    }
+    IMMER_NODISCARD bool operator!=(const multimap& other) const
+    {
+        return !(*this == other);
+    }
+
+    /*!
+     * Returns the map from keys to groups of values behind this
+     * multimap.
+     */
+    IMMER_NODISCARD const map_type& groups() const { return map_; }
+
+private:
+    multimap(map_type m, size_type size)
+        : map_{std::move(m)}
+        , size_{size}
+    {}
+
+    map_type map_;
+    size_type size_ = 0;
+};
+
+} // namespace immer
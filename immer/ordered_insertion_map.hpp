@@ -0,0 +1,407 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/container_hash.hpp>
+#include <immer/detail/iterator_facade.hpp>
+#include <immer/flex_vector.hpp>
+#include <immer/flex_vector_transient.hpp>
+#include <immer/map.hpp>
+#include <immer/map_transient.hpp>
+#include <immer/memory_policy.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+namespace immer {
+
+namespace detail {
+
+// an association in the log of an `ordered_insertion_map`, that stays
+// there, dead, when it is erased, until the log is compacted
+template <typename K, typename T>
+struct insertion_entry
+{
+    std::pair<K, T> value;
+    bool live;
+};
+
+/*!
+ * Iterator over the live entries of the log of an
+ * `ordered_insertion_map`.
+ */
+template <typename LogIter, typename Value>
+struct insertion_iterator
+    : iterator_facade<insertion_iterator<LogIter, Value>,
+                      std::forward_iterator_tag,
+                      Value,
+                      const Value&,
+                      std::ptrdiff_t,
+                      const Value*>
+{
+    insertion_iterator() = default;
+
+    insertion_iterator(LogIter it, LogIter last)
+        : it_{std::move(it)}
+        , last_{std::move(last)}
+    {
+        skip();
+    }
+
+private:
+    friend iterator_core_access;
+
+    LogIter it_;
+    LogIter last_;
+
+    void skip()
+    {
+        while (it_ != last_ && !it_->live)
+            ++it_;
+    }
+
+    void increment()
+    {
+        ++it_;
+        skip();
+    }
+
+    bool equal(const insertion_iterator& other) const
+    {
+        return it_ == other.it_;
+    }
+
+    const Value& dereference() const { return it_->value; }
+};
+
+} // namespace detail
+
+/*!
+ * Immutable unsorted mapping of values from keys of type `K` to values
+ * of type `T`, that is iterated in the order in which the keys were
+ * first inserted, like the dictionaries of Python.
+ *
+ * @tparam K    The type of the keys.
+ * @tparam T    The type of the values to be stored in the container.
+ * @tparam Hash The type of a function object capable of hashing
+ *              values of type `K`.
+ * @tparam Equal The type of a function object capable of comparing
+ *              values of type `K`.
+ * @tparam MemoryPolicy Memory management policy. See @ref
+ *              memory_policy.
+ *
+ * @rst
+ *
+ * The associations are appended to a ``flex_vector``, the *log*, and
+ * a ``map`` from the keys to their position in it finds them.  Thus,
+ * lookups and updates take :math:`O(log(n))`, like in a ``map``, and
+ * the iteration follows the log, in :math:`O(1)` per element, without
+ * sorting anything.  Setting the value of a key that is already there
+ * keeps its place.  An erased association is only marked as such in
+ * the log, and the log is compacted when there are more of those than
+ * of the live ones, which keeps erasing in amortized
+ * :math:`O(log(n))`.
+ *
+ * .. code-block:: c++
+ *
+ *    auto m = immer::ordered_insertion_map<std::string, int>{}
+ *                 .set("b", 1).set("a", 2).set("c", 3).erase("a");
+ *    // iterates over {"b", 1}, {"c", 3}
+ *
+ * @endrst
+ */
+template <typename K,
+          typename T,
+          typename Hash         = container_hash<K>,
+          typename Equal        = std::equal_to<K>,
+          typename MemoryPolicy = default_memory_policy>
+class ordered_insertion_map
+{
+    using value_t = std::pair<K, T>;
+    using entry_t = detail::insertion_entry<K, T>;
+    using log_t   = flex_vector<entry_t, MemoryPolicy>;
+    using index_t = map<K, std::size_t, Hash, Equal, MemoryPolicy>;
+
+    struct default_value
+    {
+        const T& operator()() const
+        {
+            static T v{};
+            return v;
+        }
+    };
+
+public:
+    using key_type        = K;
+    using mapped_type     = T;
+    using value_type      = value_t;
+    using size_type       = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using hasher          = Hash;
+    using key_equal       = Equal;
+    using reference       = const value_type&;
+    using const_reference = const value_type&;
+
+    using iterator =
+        detail::insertion_iterator<typename log_t::iterator, value_t>;
+    using const_iterator = iterator;
+
+    using memory_policy_type = MemoryPolicy;
+
+    /*!
+     * Default constructor.  It creates a map of `size() == 0`.  It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    ordered_insertion_map() = default;
+
+    /*!
+     * Constructs a map containing the associations in `values`, in
+     * that order.  When a key appears more than once, the last value
+     * is kept, at the place of the first one.
+     */
+    ordered_insertion_map(std::initializer_list<value_type> values)
+    {
+        for (auto& v : values)
+            *this = std::move(*this).insert(v);
+    }
+
+    /*!
+     * Returns an iterator pointing at the association that was
+     * inserted first.  It does not allocate memory.
+     */
+    IMMER_NODISCARD iterator begin() const
+    {
+        return {log_.begin(), log_.end()};
+    }
+
+    /*!
+     * Returns an iterator pointing just after the association that was
+     * inserted last.  It does not allocate memory.
+     */
+    IMMER_NODISCARD iterator end() const { return {log_.end(), log_.end()}; }
+
+    /*!
+     * Returns the number of associations in the map.  It does not
+     * allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD size_type size() const { return index_.size(); }
+
+    /*!
+     * Returns `true` if there are no associations in the map.  It does
+     * not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD bool empty() const { return index_.empty(); }
+
+    /*!
+     * Returns `1` when the key `k` is contained in the map or `0`
+     * otherwise.  It does not allocate memory and its complexity is
+     * *effectively* @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD size_type count(const K& k) const
+    {
+        return index_.count(k);
+    }
+
+    /*!
+     * Returns a `const` reference to the value associated to the key
+     * `k`.  If the key is not contained in the map, it returns a
+     * default constructed value.  It does not allocate memory and its
+     * complexity is @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD const T& operator[](const K& k) const
+    {
+        auto p = find(k);
+        return p ? *p : default_value{}();
+    }
+
+    /*!
+     * Returns a `const` reference to the value associated to the key
+     * `k`.  If the key is not contained in the map, throws an
+     * `std::out_of_range` error.  It does not allocate memory and its
+     * complexity is @f$ O(log(n)) @f$.
+     */
+    const T& at(const K& k) const
+    {
+        auto p = find(k);
+        if (!p)
+            IMMER_THROW(std::out_of_range{"key not found"});
+        return *p;
+    }
+
+    /*!
+     * Returns a pointer to the value associated with the key `k`.  If
+     * the key is not contained in the map, a `nullptr` is returned.
+     * It does not allocate memory and its complexity is
+     * @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD const T* find(const K& k) const
+    {
+        auto i = index_.find(k);
+        return i ? &log_[*i].value.second : nullptr;
+    }
+
+    /*!
+     * Returns whether the maps have the same associations in the same
+     * order.
+     */
+    IMMER_NODISCARD bool operator==(const ordered_insertion_map& other) const
+    {
+        return size() == other.size() &&
+               std::equal(begin(), end(), other.begin());
+    }
+
+    IMMER_NODISCARD bool operator!=(const ordered_insertion_map& other) const
+    {
+        return !(*this == other);
+    }
+
+    /*!
+     * Returns a map containing the association `value`.  If the key is
+     * already in the map, its value is replaced and it keeps its
+     * place, otherwise it is added at the end.  Its complexity is
+     * @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD ordered_insertion_map insert(value_type value) const&
+    {
+        return set_impl(index_, log_, dead_, std::move(value));
+    }
+
+    IMMER_NODISCARD ordered_insertion_map insert(value_type value) &&
+    {
+        return set_impl(
+            std::move(index_), std::move(log_), dead_, std::move(value));
+    }
+
+    /*!
+     * Returns a map containing the association `(k, v)`, see
+     * `insert()`.
+     */
+    IMMER_NODISCARD ordered_insertion_map set(key_type k,
+                                              mapped_type v) const&
+    {
+        return insert({std::move(k), std::move(v)});
+    }
+
+    IMMER_NODISCARD ordered_insertion_map set(key_type k, mapped_type v) &&
+    {
+        return std::move(*this).insert({std::move(k), std::move(v)});
+    }
+
+    /*!
+     * Returns a map replacing the association `(k, v)` by the new
+     * association `(k, fn(v))`, where `v` is the
+     * currently associated value for `k` in the map or a default
+     * constructed value otherwise.  Its complexity is
+     * @f$ O(log(n)) @f$.
+     */
+    template <typename Fn>
+    IMMER_NODISCARD ordered_insertion_map update(key_type k, Fn&& fn) const&
+    {
+        auto p = find(k);
+        return set(std::move(k), std::forward<Fn>(fn)(p ? *p : T{}));
+    }
+
+    template <typename Fn>
+    IMMER_NODISCARD ordered_insertion_map update(key_type k, Fn&& fn) &&
+    {
+        auto p = find(k);
+        auto v = std::forward<Fn>(fn)(p ? *p : T{});
+        return std::move(*this).set(std::move(k), std::move(v));
+    }
+
+    /*!
+     * Returns a map without the key `k`.  The others keep their
+     * order.  Its complexity is amortized @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD ordered_insertion_map erase(const K& k) const&
+    {
+        return erase_impl(index_, log_, dead_, k);
+    }
+
+    IMMER_NODISCARD ordered_insertion_map erase(const K& k) &&
+    {
+        return erase_impl(std::move(index_), std::move(log_), dead_, k);
+    }
+
+private:
+    ordered_insertion_map(index_t index, log_t log, size_type dead)
+        : index_{std::move(index)}
+        , log_{std::move(log)}
+        , dead_{dead}
+    {}
+
+    template <typename Index, typename Log>
+    static ordered_insertion_map
+    set_impl(Index&& index, Log&& log, size_type dead, value_type value)
+    {
+        if (auto i = index.find(value.first)) {
+            auto pos = *i;
+            return {std::forward<Index>(index),
+                    std::forward<Log>(log).set(
+                        pos, entry_t{std::move(value), true}),
+                    dead};
+        } else {
+            auto pos = log.size();
+            auto idx = std::forward<Index>(index).set(value.first, pos);
+            return {std::move(idx),
+                    std::forward<Log>(log).push_back(
+                        entry_t{std::move(value), true}),
+                    dead};
+        }
+    }
+
+    template <typename Index, typename Log>
+    static ordered_insertion_map
+    erase_impl(Index&& index, Log&& log, size_type dead, const K& k)
+    {
+        auto i = index.find(k);
+        if (!i)
+            return {std::forward<Index>(index), std::forward<Log>(log), dead};
+        auto pos = *i;
+        auto idx = std::forward<Index>(index).erase(k);
+        if (pos + 1 == log.size())
+            return {std::move(idx), std::forward<Log>(log).take(pos), dead};
+        auto l = std::forward<Log>(log).update(pos, [](entry_t e) {
+            e.live = false;
+            return e;
+        });
+        if (++dead <= idx.size() || dead < compact_threshold)
+            return {std::move(idx), std::move(l), dead};
+        return compact(l);
+    }
+
+    // rebuilds the log with only the live entries, and the index with
+    // their new positions
+    static ordered_insertion_map compact(const log_t& log)
+    {
+        auto l = typename log_t::transient_type{};
+        auto i = typename index_t::transient_type{};
+        for (auto& e : log) {
+            if (e.live) {
+                i.set(e.value.first, l.size());
+                l.push_back(e);
+            }
+        }
+        return {i.persistent(), l.persistent(), 0};
+    }
+
+    static constexpr auto compact_threshold = size_type{32};
+
+    index_t index_;
+    log_t log_;
+    size_type dead_ = 0;
+};
+
+} // namespace immer
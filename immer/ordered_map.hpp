@@ -0,0 +1,406 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/btree/btree.hpp>
+#include <immer/detail/btree/btree_iterator.hpp>
+#include <immer/memory_policy.hpp>
+
+#include <cassert>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+namespace immer {
+
+template <typename K,
+          typename T,
+          typename Less,
+          typename MemoryPolicy,
+          detail::btree::count_t B>
+class ordered_map_transient;
+
+/*!
+ * Immutable sorted mapping of values from keys of type `K` to values
+ * of type `T`.
+ *
+ * @tparam K    The type of the keys.
+ * @tparam T    The type of the values to be stored in the container.
+ * @tparam Less The type of a function object that orders keys of type
+ *              `K`.  Keys that are not less than each other are
+ *              considered equal.
+ * @tparam MemoryPolicy Memory management policy. See @ref
+ *              memory_policy.
+ * @tparam B    The maximum number of associations in a leaf and of
+ *              children in an inner node of the tree.
+ *
+ * @rst
+ *
+ * This container is a B+-tree like :cpp:class:`immer::ordered_set`,
+ * that stores the associations sorted by key.  It is iterated in the
+ * order of the keys, finds the ones in a range in :math:`O(log(n))`,
+ * and can be split at a key and joined with a map of greater keys in
+ * :math:`O(log(n))`.
+ *
+ * @endrst
+ */
+template <typename K,
+          typename T,
+          typename Less                = std::less<K>,
+          typename MemoryPolicy        = default_memory_policy,
+          detail::btree::count_t B = default_btree_branches>
+class ordered_map
+{
+    using value_t = std::pair<K, T>;
+
+    struct key_of
+    {
+        const K& operator()(const value_t& v) const noexcept
+        {
+            return v.first;
+        }
+    };
+
+    struct default_value
+    {
+        const T& operator()() const
+        {
+            static T v{};
+            return v;
+        }
+    };
+
+    using impl_t = detail::btree::btree<value_t, key_of, Less, MemoryPolicy, B>;
+
+public:
+    using key_type        = K;
+    using mapped_type     = T;
+    using value_type      = value_t;
+    using size_type       = detail::btree::size_t;
+    using difference_type = std::ptrdiff_t;
+    using key_compare     = Less;
+    using reference       = const value_type&;
+    using const_reference = const value_type&;
+
+    using iterator =
+        detail::btree::btree_iterator<value_t, key_of, Less, MemoryPolicy, B>;
+    using const_iterator   = iterator;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+
+    using transient_type = ordered_map_transient<K, T, Less, MemoryPolicy, B>;
+
+    using memory_policy_type = MemoryPolicy;
+
+    /*!
+     * Default constructor.  It creates a map of `size() == 0`.  It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    ordered_map() = default;
+
+    /*!
+     * Constructs a map containing the elements in `values`.
+     */
+    ordered_map(std::initializer_list<value_type> values)
+        : ordered_map(values.begin(), values.end())
+    {}
+
+    /*!
+     * Constructs a map containing the elements in the range
+     * defined by the input iterator `first` and range sentinel `last`.
+     */
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    ordered_map(Iter first, Sent last)
+    {
+        auto owner = typename MemoryPolicy::transience_t::owner{};
+        for (; first != last; ++first)
+            impl_.add_mut(owner, true, *first);
+    }
+
+    /*!
+     * Returns an iterator pointing at the first element of the
+     * collection. It does not allocate memory and its complexity is
+     * @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD iterator begin() const { return {impl_}; }
+
+    /*!
+     * Returns an iterator pointing just after the last element of the
+     * collection. It does not allocate and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD iterator end() const
+    {
+        return {impl_, typename iterator::end_t{}};
+    }
+
+    /*!
+     * Returns an iterator that traverses the collection backwards,
+     * pointing at the last element.
+     */
+    IMMER_NODISCARD reverse_iterator rbegin() const
+    {
+        return reverse_iterator{end()};
+    }
+
+    /*!
+     * Returns an iterator that traverses the collection backwards,
+     * pointing before the first element.
+     */
+    IMMER_NODISCARD reverse_iterator rend() const
+    {
+        return reverse_iterator{begin()};
+    }
+
+    /*!
+     * Returns the number of elements in the container.  It does
+     * not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD size_type size() const { return impl_.size; }
+
+    /*!
+     * Returns `true` if there are no elements in the container.  It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD bool empty() const { return impl_.size == 0; }
+
+    /*!
+     * Returns `1` when the key `k` is contained in the map or `0`
+     * otherwise. It won't allocate memory and its complexity is
+     * @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD size_type count(const K& k) const
+    {
+        return impl_.find(k) ? 1 : 0;
+    }
+
+    /*!
+     * Returns a `const` reference to the values associated to the key
+     * `k`.  If the key is not contained in the map, it returns a
+     * default constructed value.  It does not allocate memory and its
+     * complexity is @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD const T& operator[](const K& k) const
+    {
+        auto p = impl_.find(k);
+        return p ? p->second : default_value{}();
+    }
+
+    /*!
+     * Returns a `const` reference to the values associated to the key
+     * `k`.  If the key is not contained in the map, throws an
+     * `std::out_of_range` error.  It does not allocate memory and its
+     * complexity is @f$ O(log(n)) @f$.
+     */
+    const T& at(const K& k) const
+    {
+        auto p = impl_.find(k);
+        if (!p)
+            IMMER_THROW(std::out_of_range{"key not found"});
+        return p->second;
+    }
+
+    /*!
+     * Returns a pointer to the value associated with the key `k`.  If
+     * the key is not contained in the map, a `nullptr` is returned.
+     * It does not allocate memory and its complexity is @f$ O(log(n))
+     * @f$.
+     */
+    IMMER_NODISCARD const T* find(const K& k) const
+    {
+        auto p = impl_.find(k);
+        return p ? &p->second : nullptr;
+    }
+
+    /*!
+     * Returns an iterator pointing at the first association whose key
+     * is not less than `k`, or `end()` if there is none.  It does not
+     * allocate memory and its complexity is @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD iterator lower_bound(const K& k) const
+    {
+        return {impl_, impl_.lower_bound(k)};
+    }
+
+    /*!
+     * Returns an iterator pointing at the first association whose key
+     * is greater than `k`, or `end()` if there is none.  It does not
+     * allocate memory and its complexity is @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD iterator upper_bound(const K& k) const
+    {
+        return {impl_, impl_.upper_bound(k)};
+    }
+
+    /*!
+     * Returns whether the maps are equal.
+     */
+    IMMER_NODISCARD bool operator==(const ordered_map& other) const
+    {
+        return impl_.equals(other.impl_);
+    }
+    IMMER_NODISCARD bool operator!=(const ordered_map& other) const
+    {
+        return !(*this == other);
+    }
+
+    /*!
+     * Returns a map containing the association `value`.  If the key is
+     * already in the map, it replaces its association in the map.  It
+     * may allocate memory and its complexity is @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD ordered_map insert(value_type value) const&
+    {
+        auto r = impl_;
+        r.add_mut(impl_t::noone(), false, std::move(value));
+        return r;
+    }
+    IMMER_NODISCARD ordered_map&& insert(value_type value) &&
+    {
+        impl_.add_mut(impl_t::noone(), false, std::move(value));
+        return std::move(*this);
+    }
+
+    /*!
+     * Returns a map containing the association `(k, v)`.  If the key
+     * is already in the map, it replaces its association in the map.
+     * It may allocate memory and its complexity is @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD ordered_map set(key_type k, mapped_type v) const&
+    {
+        return insert({std::move(k), std::move(v)});
+    }
+    IMMER_NODISCARD ordered_map&& set(key_type k, mapped_type v) &&
+    {
+        return std::move(*this).insert({std::move(k), std::move(v)});
+    }
+
+    /*!
+     * Returns a map replacing the association `(k, v)` by the
+     * association new association `(k, fn(v))`, where `v` is the
+     * currently associated value for `k` in the map or a default
+     * constructed value otherwise. It may allocate memory and its
+     * complexity is @f$ O(log(n)) @f$.
+     */
+    template <typename Fn>
+    IMMER_NODISCARD ordered_map update(key_type k, Fn&& fn) const&
+    {
+        auto r = impl_;
+        update_mut(r, impl_t::noone(), false, std::move(k), fn);
+        return r;
+    }
+    template <typename Fn>
+    IMMER_NODISCARD ordered_map&& update(key_type k, Fn&& fn) &&
+    {
+        update_mut(impl_, impl_t::noone(), false, std::move(k), fn);
+        return std::move(*this);
+    }
+
+    /*!
+     * Returns a map without the key `k`.  If the key is not
+     * associated in the map it returns the same map.  It may allocate
+     * memory and its complexity is @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD ordered_map erase(const K& k) const&
+    {
+        auto r = impl_;
+        r.sub_mut(impl_t::noone(), false, k);
+        return r;
+    }
+    IMMER_NODISCARD ordered_map&& erase(const K& k) &&
+    {
+        impl_.sub_mut(impl_t::noone(), false, k);
+        return std::move(*this);
+    }
+
+    /*!
+     * Returns the maps with the associations whose keys are less than
+     * `k`, and with the rest of them.  Both share most of their nodes
+     * with this one, and its complexity is @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD std::pair<ordered_map, ordered_map> split(const K& k) const
+    {
+        auto r = impl_.split(impl_t::noone(), false, k);
+        return {std::move(r.first), std::move(r.second)};
+    }
+
+    /*!
+     * Returns a map with the associations whose keys are not less than
+     * `first` and less than `last`.  Its complexity is @f$ O(log(n))
+     * @f$.
+     */
+    IMMER_NODISCARD ordered_map range(const K& first, const K& last) const
+    {
+        if (!Less{}(first, last))
+            return {};
+        auto r = impl_.split(impl_t::noone(), false, first).second;
+        return r.split(impl_t::noone(), false, last).first;
+    }
+
+    /*!
+     * Returns a map with the associations of this one and those of
+     * `right`, whose keys must all be greater than the ones here.  Its
+     * complexity is @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD ordered_map join(const ordered_map& right) const
+    {
+        assert(empty() || right.empty() ||
+               Less{}(rbegin()->first, right.begin()->first));
+        return impl_t::join(impl_, right.impl_, impl_t::noone(), false);
+    }
+
+    /*!
+     * Returns an @a transient form of this container, an
+     * `immer::ordered_map_transient`.
+     */
+    IMMER_NODISCARD transient_type transient() const&
+    {
+        return transient_type{impl_};
+    }
+    IMMER_NODISCARD transient_type transient() &&
+    {
+        return transient_type{std::move(impl_)};
+    }
+
+    /*!
+     * Returns a value that can be used as identity for the container.  If two
+     * values have the same identity, they are guaranteed to be equal and to
+     * contain the same objects.  However, two equal containers are not
+     * guaranteed to have the same identity.
+     */
+    void* identity() const { return impl_.root; }
+
+    // Semi-private
+    const impl_t& impl() const { return impl_; }
+
+    ordered_map(impl_t impl)
+        : impl_(std::move(impl))
+    {}
+
+private:
+    friend transient_type;
+
+    template <typename Fn>
+    static void update_mut(
+        impl_t& impl, typename impl_t::edit_t e, bool tr, K k, Fn& fn)
+    {
+        impl.upsert_mut(e, tr, k, [&](const value_t* p) {
+            return value_t{std::move(k),
+                           fn(p ? p->second : default_value{}())};
+        });
+    }
+
+    impl_t impl_ = impl_t::empty();
+};
+
+} // namespace immer
@@ -0,0 +1,192 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/memory_policy.hpp>
+#include <immer/ordered_map.hpp>
+
+#include <functional>
+
+namespace immer {
+
+/*!
+ * Mutable version of `immer::ordered_map`.
+ *
+ * @rst
+ *
+ * Refer to :doc:`transients` to learn more about when and how to use
+ * the mutable versions of immutable containers.
+ *
+ * @endrst
+ */
+template <typename K,
+          typename T,
+          typename Less                = std::less<K>,
+          typename MemoryPolicy        = default_memory_policy,
+          detail::btree::count_t B = default_btree_branches>
+class ordered_map_transient : MemoryPolicy::transience_t::owner
+{
+    using base_t  = typename MemoryPolicy::transience_t::owner;
+    using owner_t = base_t;
+
+public:
+    using persistent_type = ordered_map<K, T, Less, MemoryPolicy, B>;
+
+    using key_type        = K;
+    using mapped_type     = T;
+    using value_type      = std::pair<K, T>;
+    using size_type       = detail::btree::size_t;
+    using difference_type = std::ptrdiff_t;
+    using key_compare     = Less;
+    using reference       = const value_type&;
+    using const_reference = const value_type&;
+
+    using iterator       = typename persistent_type::iterator;
+    using const_iterator = iterator;
+
+    /*!
+     * Default constructor.  It creates a map of `size() == 0`.  It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    ordered_map_transient() = default;
+
+    /*!
+     * Returns an iterator pointing at the first element of the
+     * collection. It does not allocate memory and its complexity is
+     * @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD iterator begin() const { return {impl_}; }
+
+    /*!
+     * Returns an iterator pointing just after the last element of the
+     * collection. It does not allocate and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD iterator end() const
+    {
+        return {impl_, typename iterator::end_t{}};
+    }
+
+    /*!
+     * Returns the number of elements in the container.  It does
+     * not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD size_type size() const { return impl_.size; }
+
+    /*!
+     * Returns `true` if there are no elements in the container.  It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD bool empty() const { return impl_.size == 0; }
+
+    /*!
+     * Returns `1` when the key `k` is contained in the map or `0`
+     * otherwise. It won't allocate memory and its complexity is
+     * @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD size_type count(const K& k) const
+    {
+        return impl_.find(k) ? 1 : 0;
+    }
+
+    /*!
+     * Returns a pointer to the value associated with the key `k`.  If
+     * the key is not contained in the map, a `nullptr` is returned.
+     * It does not allocate memory and its complexity is @f$ O(log(n))
+     * @f$.
+     */
+    IMMER_NODISCARD const T* find(const K& k) const
+    {
+        auto p = impl_.find(k);
+        return p ? &p->second : nullptr;
+    }
+
+    /*!
+     * Returns an iterator pointing at the first association whose key
+     * is not less than `k`, or `end()` if there is none.
+     */
+    IMMER_NODISCARD iterator lower_bound(const K& k) const
+    {
+        return {impl_, impl_.lower_bound(k)};
+    }
+
+    /*!
+     * Returns an iterator pointing at the first association whose key
+     * is greater than `k`, or `end()` if there is none.
+     */
+    IMMER_NODISCARD iterator upper_bound(const K& k) const
+    {
+        return {impl_, impl_.upper_bound(k)};
+    }
+
+    /*!
+     * Inserts the association `value`, replacing the one with the same
+     * key if there is one.  It may allocate memory and its complexity
+     * is @f$ O(log(n)) @f$.
+     */
+    void insert(value_type value)
+    {
+        impl_.add_mut(*this, true, std::move(value));
+    }
+
+    /*!
+     * Inserts the association `(k, v)`, replacing the one with the same
+     * key if there is one.  It may allocate memory and its complexity
+     * is @f$ O(log(n)) @f$.
+     */
+    void set(key_type k, mapped_type v)
+    {
+        impl_.add_mut(*this, true, {std::move(k), std::move(v)});
+    }
+
+    /*!
+     * Replaces the association `(k, v)` by the association `(k,
+     * fn(v))`, where `v` is the currently associated value for `k` in
+     * the map or a default constructed value otherwise.  It may
+     * allocate memory and its complexity is @f$ O(log(n)) @f$.
+     */
+    template <typename Fn>
+    void update(key_type k, Fn&& fn)
+    {
+        persistent_type::update_mut(impl_, *this, true, std::move(k), fn);
+    }
+
+    /*!
+     * Removes the association with the key `k`, doing nothing if there
+     * is none.  It may allocate memory and its complexity is @f$
+     * O(log(n)) @f$.
+     */
+    void erase(const K& k) { impl_.sub_mut(*this, true, k); }
+
+    /*!
+     * Returns an @a immutable form of this container, an
+     * `immer::ordered_map`.
+     */
+    IMMER_NODISCARD persistent_type persistent() &
+    {
+        this->owner_t::operator=(owner_t{});
+        return impl_;
+    }
+    IMMER_NODISCARD persistent_type persistent() && { return std::move(impl_); }
+
+private:
+    friend persistent_type;
+    using impl_t = typename persistent_type::impl_t;
+
+    ordered_map_transient(impl_t impl)
+        : impl_(std::move(impl))
+    {}
+
+    impl_t impl_ = impl_t::empty();
+
+public:
+    // Semi-private
+    const impl_t& impl() const { return impl_; }
+};
+
+} // namespace immer
@@ -0,0 +1,351 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/btree/btree.hpp>
+#include <immer/detail/btree/btree_iterator.hpp>
+#include <immer/memory_policy.hpp>
+
+#include <cassert>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <utility>
+
+namespace immer {
+
+template <typename T,
+          typename Less,
+          typename MemoryPolicy,
+          detail::btree::count_t B>
+class ordered_set_transient;
+
+/*!
+ * Immutable set representing a sorted bag of values.
+ *
+ * @tparam T    The type of the values to be stored in the container.
+ * @tparam Less The type of a function object that orders values of
+ *              type `T`.  Values that are not less than each other
+ *              are considered equal.
+ * @tparam MemoryPolicy Memory management policy. See @ref
+ *              memory_policy.
+ * @tparam B    The maximum number of values in a leaf and of children
+ *              in an inner node of the tree.
+ *
+ * @rst
+ *
+ * This container is a B+-tree: its values are stored sorted in wide
+ * leaves of up to ``B`` of them, under inner nodes that keep copies of
+ * the values that separate their children.  It is iterated in order,
+ * finds the values in a range in :math:`O(log(n))`, and can be split
+ * at a value and joined with a set of greater values in
+ * :math:`O(log(n))`, sharing all the nodes that are not on their
+ * boundary.  Lookups and updates are :math:`O(log(n))` too, and
+ * slower than those of :cpp:class:`immer::set` when the order is not
+ * needed.
+ *
+ * @endrst
+ */
+template <typename T,
+          typename Less                = std::less<T>,
+          typename MemoryPolicy        = default_memory_policy,
+          detail::btree::count_t B = default_btree_branches>
+class ordered_set
+{
+    struct key_of
+    {
+        const T& operator()(const T& v) const noexcept { return v; }
+    };
+
+    using impl_t = detail::btree::btree<T, key_of, Less, MemoryPolicy, B>;
+
+public:
+    using value_type      = T;
+    using size_type       = detail::btree::size_t;
+    using difference_type = std::ptrdiff_t;
+    using key_compare     = Less;
+    using reference       = const T&;
+    using const_reference = const T&;
+
+    using iterator =
+        detail::btree::btree_iterator<T, key_of, Less, MemoryPolicy, B>;
+    using const_iterator   = iterator;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+
+    using transient_type = ordered_set_transient<T, Less, MemoryPolicy, B>;
+
+    using memory_policy_type = MemoryPolicy;
+
+    /*!
+     * Default constructor.  It creates a set of `size() == 0`.  It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    ordered_set() = default;
+
+    /*!
+     * Constructs a set containing the elements in `values`.
+     */
+    ordered_set(std::initializer_list<value_type> values)
+        : ordered_set(values.begin(), values.end())
+    {}
+
+    /*!
+     * Constructs a set containing the elements in the range
+     * defined by the input iterator `first` and range sentinel `last`.
+     */
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    ordered_set(Iter first, Sent last)
+    {
+        auto owner = typename MemoryPolicy::transience_t::owner{};
+        for (; first != last; ++first)
+            impl_.add_mut(owner, true, *first);
+    }
+
+    /*!
+     * Returns an iterator pointing at the first element of the
+     * collection. It does not allocate memory and its complexity is
+     * @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD iterator begin() const { return {impl_}; }
+
+    /*!
+     * Returns an iterator pointing just after the last element of the
+     * collection. It does not allocate and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD iterator end() const
+    {
+        return {impl_, typename iterator::end_t{}};
+    }
+
+    /*!
+     * Returns an iterator that traverses the collection backwards,
+     * pointing at the last element.
+     */
+    IMMER_NODISCARD reverse_iterator rbegin() const
+    {
+        return reverse_iterator{end()};
+    }
+
+    /*!
+     * Returns an iterator that traverses the collection backwards,
+     * pointing before the first element.
+     */
+    IMMER_NODISCARD reverse_iterator rend() const
+    {
+        return reverse_iterator{begin()};
+    }
+
+    /*!
+     * Returns the number of elements in the container.  It does
+     * not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD size_type size() const { return impl_.size; }
+
+    /*!
+     * Returns `true` if there are no elements in the container.  It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD bool empty() const { return impl_.size == 0; }
+
+    /*!
+     * Returns `1` when `value` is contained in the set or `0`
+     * otherwise. It won't allocate memory and its complexity is
+     * @f$ O(log(n)) @f$.
+     *
+     * This overload participates in overload resolution only if
+     * `Less::is_transparent` is valid and denotes a type.
+     */
+    template <typename K,
+              typename U = Less,
+              typename   = typename U::is_transparent>
+    IMMER_NODISCARD size_type count(const K& value) const
+    {
+        return impl_.find(value) ? 1 : 0;
+    }
+
+    /*!
+     * Returns `1` when `value` is contained in the set or `0`
+     * otherwise. It won't allocate memory and its complexity is
+     * @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD size_type count(const T& value) const
+    {
+        return impl_.find(value) ? 1 : 0;
+    }
+
+    /*!
+     * Returns a pointer to the value if `value` is contained in the
+     * set, or nullptr otherwise.  It does not allocate memory and its
+     * complexity is @f$ O(log(n)) @f$.
+     *
+     * This overload participates in overload resolution only if
+     * `Less::is_transparent` is valid and denotes a type.
+     */
+    template <typename K,
+              typename U = Less,
+              typename   = typename U::is_transparent>
+    IMMER_NODISCARD const T* find(const K& value) const
+    {
+        return impl_.find(value);
+    }
+
+    /*!
+     * Returns a pointer to the value if `value` is contained in the
+     * set, or nullptr otherwise.  It does not allocate memory and its
+     * complexity is @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD const T* find(const T& value) const
+    {
+        return impl_.find(value);
+    }
+
+    /*!
+     * Returns an iterator pointing at the first element that is not
+     * less than `value`, or `end()` if there is none.  It does not
+     * allocate memory and its complexity is @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD iterator lower_bound(const T& value) const
+    {
+        return {impl_, impl_.lower_bound(value)};
+    }
+
+    /*!
+     * Returns an iterator pointing at the first element that is
+     * greater than `value`, or `end()` if there is none.  It does not
+     * allocate memory and its complexity is @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD iterator upper_bound(const T& value) const
+    {
+        return {impl_, impl_.upper_bound(value)};
+    }
+
+    /*!
+     * Returns whether the sets are equal.
+     */
+    IMMER_NODISCARD bool operator==(const ordered_set& other) const
+    {
+        return impl_.equals(other.impl_);
+    }
+    IMMER_NODISCARD bool operator!=(const ordered_set& other) const
+    {
+        return !(*this == other);
+    }
+
+    /*!
+     * Returns a set containing `value`.  If the `value` is already in
+     * the set, it returns the same set.  It may allocate memory and
+     * its complexity is @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD ordered_set insert(T value) const&
+    {
+        if (impl_.find(value))
+            return *this;
+        auto r = impl_;
+        r.add_mut(impl_t::noone(), false, std::move(value));
+        return r;
+    }
+    IMMER_NODISCARD ordered_set&& insert(T value) &&
+    {
+        if (!impl_.find(value))
+            impl_.add_mut(impl_t::noone(), false, std::move(value));
+        return std::move(*this);
+    }
+
+    /*!
+     * Returns a set without `value`.  If the `value` is not in the
+     * set it returns the same set.  It may allocate memory and its
+     * complexity is @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD ordered_set erase(const T& value) const&
+    {
+        auto r = impl_;
+        r.sub_mut(impl_t::noone(), false, value);
+        return r;
+    }
+    IMMER_NODISCARD ordered_set&& erase(const T& value) &&
+    {
+        impl_.sub_mut(impl_t::noone(), false, value);
+        return std::move(*this);
+    }
+
+    /*!
+     * Returns the sets with the elements that are less than `value`,
+     * and with the rest of them.  Both share most of their nodes with
+     * this one, and its complexity is @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD std::pair<ordered_set, ordered_set>
+    split(const T& value) const
+    {
+        auto r = impl_.split(impl_t::noone(), false, value);
+        return {std::move(r.first), std::move(r.second)};
+    }
+
+    /*!
+     * Returns a set with the elements that are not less than `first`
+     * and less than `last`.  Its complexity is @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD ordered_set range(const T& first, const T& last) const
+    {
+        if (!Less{}(first, last))
+            return {};
+        auto r = impl_.split(impl_t::noone(), false, first).second;
+        return r.split(impl_t::noone(), false, last).first;
+    }
+
+    /*!
+     * Returns a set with the elements of this one and those of
+     * `right`, which must all be greater than them.  Its complexity is
+     * @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD ordered_set join(const ordered_set& right) const
+    {
+        assert(empty() || right.empty() ||
+               Less{}(*rbegin(), *right.begin()));
+        return impl_t::join(impl_, right.impl_, impl_t::noone(), false);
+    }
+
+    /*!
+     * Returns an @a transient form of this container, an
+     * `immer::ordered_set_transient`.
+     */
+    IMMER_NODISCARD transient_type transient() const&
+    {
+        return transient_type{impl_};
+    }
+    IMMER_NODISCARD transient_type transient() &&
+    {
+        return transient_type{std::move(impl_)};
+    }
+
+    /*!
+     * Returns a value that can be used as identity for the container.  If two
+     * values have the same identity, they are guaranteed to be equal and to
+     * contain the same objects.  However, two equal containers are not
+     * guaranteed to have the same identity.
+     */
+    void* identity() const { return impl_.root; }
+
+    // Semi-private
+    const impl_t& impl() const { return impl_; }
+
+    ordered_set(impl_t impl)
+        : impl_(std::move(impl))
+    {}
+
+private:
+    friend transient_type;
+
+    impl_t impl_ = impl_t::empty();
+};
+
+} // namespace immer
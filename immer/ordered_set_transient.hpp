@@ -0,0 +1,166 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/memory_policy.hpp>
+#include <immer/ordered_set.hpp>
+
+#include <functional>
+
+namespace immer {
+
+/*!
+ * Mutable version of `immer::ordered_set`.
+ *
+ * @rst
+ *
+ * Refer to :doc:`transients` to learn more about when and how to use
+ * the mutable versions of immutable containers.
+ *
+ * @endrst
+ */
+template <typename T,
+          typename Less                = std::less<T>,
+          typename MemoryPolicy        = default_memory_policy,
+          detail::btree::count_t B = default_btree_branches>
+class ordered_set_transient : MemoryPolicy::transience_t::owner
+{
+    using base_t  = typename MemoryPolicy::transience_t::owner;
+    using owner_t = base_t;
+
+public:
+    using persistent_type = ordered_set<T, Less, MemoryPolicy, B>;
+
+    using value_type      = T;
+    using size_type       = detail::btree::size_t;
+    using difference_type = std::ptrdiff_t;
+    using key_compare     = Less;
+    using reference       = const T&;
+    using const_reference = const T&;
+
+    using iterator       = typename persistent_type::iterator;
+    using const_iterator = iterator;
+
+    /*!
+     * Default constructor.  It creates a set of `size() == 0`.  It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    ordered_set_transient() = default;
+
+    /*!
+     * Returns an iterator pointing at the first element of the
+     * collection. It does not allocate memory and its complexity is
+     * @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD iterator begin() const { return {impl_}; }
+
+    /*!
+     * Returns an iterator pointing just after the last element of the
+     * collection. It does not allocate and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD iterator end() const
+    {
+        return {impl_, typename iterator::end_t{}};
+    }
+
+    /*!
+     * Returns the number of elements in the container.  It does
+     * not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD size_type size() const { return impl_.size; }
+
+    /*!
+     * Returns `true` if there are no elements in the container.  It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD bool empty() const { return impl_.size == 0; }
+
+    /*!
+     * Returns `1` when `value` is contained in the set or `0`
+     * otherwise. It won't allocate memory and its complexity is
+     * @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD size_type count(const T& value) const
+    {
+        return impl_.find(value) ? 1 : 0;
+    }
+
+    /*!
+     * Returns a pointer to the value if `value` is contained in the
+     * set, or nullptr otherwise.  It does not allocate memory and its
+     * complexity is @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD const T* find(const T& value) const
+    {
+        return impl_.find(value);
+    }
+
+    /*!
+     * Returns an iterator pointing at the first element that is not
+     * less than `value`, or `end()` if there is none.
+     */
+    IMMER_NODISCARD iterator lower_bound(const T& value) const
+    {
+        return {impl_, impl_.lower_bound(value)};
+    }
+
+    /*!
+     * Returns an iterator pointing at the first element that is
+     * greater than `value`, or `end()` if there is none.
+     */
+    IMMER_NODISCARD iterator upper_bound(const T& value) const
+    {
+        return {impl_, impl_.upper_bound(value)};
+    }
+
+    /*!
+     * Inserts `value` into the set, and does nothing if the value is
+     * already there.  It may allocate memory and its complexity is @f$
+     * O(log(n)) @f$.
+     */
+    void insert(T value)
+    {
+        if (!impl_.find(value))
+            impl_.add_mut(*this, true, std::move(value));
+    }
+
+    /*!
+     * Removes the `value` from the set, doing nothing if the value is
+     * not in the set.  It may allocate memory and its complexity is @f$
+     * O(log(n)) @f$.
+     */
+    void erase(const T& value) { impl_.sub_mut(*this, true, value); }
+
+    /*!
+     * Returns an @a immutable form of this container, an
+     * `immer::ordered_set`.
+     */
+    IMMER_NODISCARD persistent_type persistent() &
+    {
+        this->owner_t::operator=(owner_t{});
+        return impl_;
+    }
+    IMMER_NODISCARD persistent_type persistent() && { return std::move(impl_); }
+
+private:
+    friend persistent_type;
+    using impl_t = typename persistent_type::impl_t;
+
+    ordered_set_transient(impl_t impl)
+        : impl_(std::move(impl))
+    {}
+
+    impl_t impl_ = impl_t::empty();
+
+public:
+    // Semi-private
+    const impl_t& impl() const { return impl_; }
+};
+
+} // namespace immer
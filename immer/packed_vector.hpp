@@ -0,0 +1,378 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/array.hpp>
+#include <immer/config.hpp>
+#include <immer/memory_policy.hpp>
+#include <immer/vector.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace immer {
+
+namespace detail {
+namespace packed {
+
+// Every block stores the value `i` as `first + i * slope + deltas[i]`,
+// with the deltas packed in `bits` bits each.  The slope is the mean
+// difference between consecutive values, so that sorted sequences with
+// a stable rate, like timestamps, have small deltas.  All the arithmetic
+// is done modulo 2^64 and truncated to the width of `T`, which makes
+// the encoding exact for any values.
+template <typename T, std::size_t N, typename MemoryPolicy>
+struct block
+{
+    using words_t    = array<std::uint64_t, MemoryPolicy>;
+    using signed_t   = std::make_signed_t<T>;
+    using unsigned_t = std::make_unsigned_t<T>;
+
+    std::uint64_t first = 0;
+    std::uint64_t slope = 0;
+    std::uint8_t bits   = 0;
+    words_t words;
+
+    static block encode(const T* data)
+    {
+        auto b  = block{};
+        b.slope = static_cast<std::uint64_t>(
+            static_cast<std::int64_t>(
+                static_cast<signed_t>(static_cast<T>(data[N - 1] - data[0]))) /
+            static_cast<std::int64_t>(N - 1));
+        // the residuals are compared as signed values of the width of
+        // `T`, so that the ones below the line are small too
+        auto residual = [&](std::size_t i) {
+            return static_cast<std::int64_t>(static_cast<signed_t>(
+                static_cast<unsigned_t>(static_cast<std::uint64_t>(data[i]) -
+                                        static_cast<std::uint64_t>(data[0]) -
+                                        i * b.slope)));
+        };
+        auto lo = residual(0);
+        for (auto i = std::size_t{1}; i < N; ++i)
+            lo = std::min(lo, residual(i));
+        b.first = static_cast<std::uint64_t>(data[0]) +
+                  static_cast<std::uint64_t>(lo);
+        std::uint64_t deltas[N];
+        auto all = std::uint64_t{};
+        for (auto i = std::size_t{}; i < N; ++i) {
+            deltas[i] = static_cast<unsigned_t>(
+                static_cast<std::uint64_t>(data[i]) - b.first - i * b.slope);
+            all |= deltas[i];
+        }
+        while (b.bits < 64 && all >> b.bits)
+            ++b.bits;
+        if (b.bits) {
+            std::uint64_t words[N] = {};
+            for (auto i = std::size_t{}; i < N; ++i) {
+                auto pos = i * b.bits;
+                words[pos / 64] |= deltas[i] << pos % 64;
+                if (pos % 64 + b.bits > 64)
+                    words[pos / 64 + 1] |= deltas[i] >> (64 - pos % 64);
+            }
+            b.words = words_t(words, words + (N * b.bits + 63) / 64);
+        }
+        return b;
+    }
+
+    T get(std::size_t i) const
+    {
+        auto d = std::uint64_t{};
+        if (bits) {
+            auto pos  = i * bits;
+            auto data = words.data();
+            d         = data[pos / 64] >> pos % 64;
+            if (pos % 64 + bits > 64)
+                d |= data[pos / 64 + 1] << (64 - pos % 64);
+            if (bits < 64)
+                d &= (std::uint64_t{1} << bits) - 1;
+        }
+        return static_cast<T>(first + i * slope + d);
+    }
+
+    void decode(T* out) const
+    {
+        for (auto i = std::size_t{}; i < N; ++i)
+            out[i] = get(i);
+    }
+
+    friend bool operator==(const block& a, const block& b)
+    {
+        return a.first == b.first && a.slope == b.slope && a.bits == b.bits &&
+               a.words == b.words;
+    }
+
+    friend bool operator!=(const block& a, const block& b)
+    {
+        return !(a == b);
+    }
+};
+
+template <typename T, std::size_t N, typename MemoryPolicy>
+struct impl
+{
+    using block_t  = block<T, N, MemoryPolicy>;
+    using blocks_t = vector<block_t, MemoryPolicy>;
+    using tail_t   = vector<T, MemoryPolicy>;
+
+    blocks_t blocks;
+    tail_t tail;
+
+    std::size_t size() const { return blocks.size() * N + tail.size(); }
+
+    template <typename Fn>
+    void for_each_chunk(Fn&& fn) const
+    {
+        T buffer[N];
+        for (auto& b : blocks) {
+            b.decode(buffer);
+            fn(static_cast<const T*>(buffer),
+               static_cast<const T*>(buffer + N));
+        }
+        tail.impl().for_each_chunk(fn);
+    }
+
+    template <typename Fn>
+    bool for_each_chunk_p(Fn&& fn) const
+    {
+        T buffer[N];
+        for (auto& b : blocks) {
+            b.decode(buffer);
+            if (!fn(static_cast<const T*>(buffer),
+                    static_cast<const T*>(buffer + N)))
+                return false;
+        }
+        return tail.impl().for_each_chunk_p(fn);
+    }
+};
+
+} // namespace packed
+} // namespace detail
+
+/*!
+ * Immutable sequential container of integers, that stores them
+ * compressed in blocks of `N` values.  It is meant for the long series
+ * of integers, like timestamps or counters, that would not fit in
+ * memory otherwise.  The values are added to an uncompressed tail that
+ * is packed into a new block when it gets `N` values.
+ *
+ * @tparam T The type of the values.  It must be an integer type.
+ * @tparam N The number of values in a block.
+ * @tparam MemoryPolicy Memory management policy. See @ref
+ *         memory_policy.
+ *
+ * A block stores each value as its distance to the line that joins
+ * the first and the last value of the block, packed in as many bits as
+ * the farthest one needs.  This takes a few bits per value for those
+ * that are sorted and grow at a stable rate, and is still exact for
+ * any other values.  Every value can be decoded on its own, thus the
+ * access is still @f$ O(log(n)) @f$.
+ *
+ * The blocks are stored in a @ref vector, so copying, adding to or
+ * updating the container shares all the blocks that it does not
+ * change.  The values can be traversed with `for_each_chunk` and the
+ * algorithms built on it, which decode a block at a time.
+ *
+ * @rst
+ *
+ * .. note:: Updating a value decodes and packs its whole block again,
+ *    thus it costs @f$ O(N) @f$ more than in a ``vector``.
+ *
+ * @endrst
+ */
+template <typename T,
+          std::size_t N         = 128,
+          typename MemoryPolicy = default_memory_policy>
+class packed_vector
+{
+    static_assert(std::is_integral<T>::value && !std::is_same<T, bool>::value,
+                  "packed_vector only stores integers");
+    static_assert(N > 1, "blocks must hold more than one value");
+
+    using impl_t = detail::packed::impl<T, N, MemoryPolicy>;
+
+public:
+    using value_type      = T;
+    using reference       = T;
+    using const_reference = T;
+    using size_type       = std::size_t;
+    using memory_policy   = MemoryPolicy;
+
+    /*!
+     * Default constructor.  It creates a vector of `size() == 0`.
+     */
+    packed_vector() = default;
+
+    /*!
+     * Constructs a vector containing the elements in `values`.
+     */
+    packed_vector(std::initializer_list<T> values)
+    {
+        for (auto v : values)
+            *this = std::move(*this).push_back(v);
+    }
+
+    /*!
+     * Returns the number of elements in the container.  It does not
+     * allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD size_type size() const { return impl_.size(); }
+
+    /*!
+     * Returns `true` if there are no elements in the container.
+     */
+    IMMER_NODISCARD bool empty() const { return size() == 0; }
+
+    /*!
+     * Returns the number of bytes taken by the packed values of the
+     * full blocks, as a measure of how well they compress.
+     */
+    IMMER_NODISCARD std::size_t packed_bytes() const
+    {
+        auto bytes = std::size_t{};
+        for (auto& b : impl_.blocks)
+            bytes += b.words.size() * sizeof(std::uint64_t);
+        return bytes;
+    }
+
+    /*!
+     * Returns the element at position `index`.  It does not allocate
+     * memory and its complexity is *effectively* @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD T operator[](size_type index) const
+    {
+        auto full = impl_.blocks.size() * N;
+        return index < full ? impl_.blocks[index / N].get(index % N)
+                            : impl_.tail[index - full];
+    }
+
+    /*!
+     * Returns the element at position `index`.  It throws an
+     * `std::out_of_range` exception when @f$ index \geq size() @f$.
+     */
+    T at(size_type index) const
+    {
+        if (index >= size())
+            IMMER_THROW(std::out_of_range{"index out of range"});
+        return (*this)[index];
+    }
+
+    /*!
+     * Returns the last element of the container.
+     */
+    IMMER_NODISCARD T back() const { return (*this)[size() - 1]; }
+
+    /*!
+     * Returns a vector with `value` inserted at the end.  It may
+     * allocate memory and its complexity is *effectively* @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD packed_vector push_back(T value) const&
+    {
+        return packed_vector{*this}.push_back_mut(value);
+    }
+
+    IMMER_NODISCARD packed_vector push_back(T value) &&
+    {
+        return std::move(push_back_mut(value));
+    }
+
+    /*!
+     * Returns a vector containing value `value` at position `index`.
+     * Undefined for `index >= size()`.
+     */
+    IMMER_NODISCARD packed_vector set(size_type index, T value) const
+    {
+        return update(index, [&](T) { return value; });
+    }
+
+    /*!
+     * Returns a vector containing the result of the expression
+     * `fn(x)` at position `index`, where `x` is the value there.
+     * Undefined for `index >= size()`.
+     */
+    template <typename FnT>
+    IMMER_NODISCARD packed_vector update(size_type index, FnT&& fn) const
+    {
+        auto full   = impl_.blocks.size() * N;
+        auto result = *this;
+        if (index >= full) {
+            result.impl_.tail = impl_.tail.update(index - full, fn);
+        } else {
+            T buffer[N];
+            impl_.blocks[index / N].decode(buffer);
+            buffer[index % N]   = fn(buffer[index % N]);
+            result.impl_.blocks =
+                impl_.blocks.set(index / N, impl_t::block_t::encode(buffer));
+        }
+        return result;
+    }
+
+    /*!
+     * Returns a vector that contains only the first `elems` elements.
+     * It may allocate memory and its complexity is *effectively* @f$
+     * O(N + log(n)) @f$.
+     */
+    IMMER_NODISCARD packed_vector take(size_type elems) const
+    {
+        if (elems >= size())
+            return *this;
+        auto full   = impl_.blocks.size() * N;
+        auto result = packed_vector{};
+        if (elems >= full) {
+            result.impl_.blocks = impl_.blocks;
+            result.impl_.tail   = impl_.tail.take(elems - full);
+        } else {
+            T buffer[N];
+            impl_.blocks[elems / N].decode(buffer);
+            result.impl_.blocks = impl_.blocks.take(elems / N);
+            result.impl_.tail =
+                typename impl_t::tail_t(buffer, buffer + elems % N);
+        }
+        return result;
+    }
+
+    /*!
+     * Returns whether the vectors are equal.  Blocks are compared
+     * without decoding them.
+     */
+    IMMER_NODISCARD bool operator==(const packed_vector& other) const
+    {
+        return impl_.blocks == other.impl_.blocks &&
+               impl_.tail == other.impl_.tail;
+    }
+    IMMER_NODISCARD bool operator!=(const packed_vector& other) const
+    {
+        return !(*this == other);
+    }
+
+    // Semi-private
+    const impl_t& impl() const { return impl_; }
+
+private:
+    packed_vector& push_back_mut(T value)
+    {
+        impl_.tail = std::move(impl_.tail).push_back(value);
+        if (impl_.tail.size() == N) {
+            T buffer[N];
+            std::copy(impl_.tail.begin(), impl_.tail.end(), buffer);
+            impl_.blocks = std::move(impl_.blocks)
+                               .push_back(impl_t::block_t::encode(buffer));
+            impl_.tail = {};
+        }
+        return *this;
+    }
+
+    impl_t impl_;
+};
+
+} // namespace immer
@@ -0,0 +1,334 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/executor.hpp>
+#include <immer/flex_vector.hpp>
+#include <immer/flex_vector_transient.hpp>
+#include <immer/map.hpp>
+#include <immer/map_transient.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <istream>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace immer {
+
+namespace detail {
+
+template <typename T,
+          typename MemoryPolicy,
+          rbts::bits_t B,
+          rbts::bits_t BL,
+          typename Executor>
+flex_vector<T, MemoryPolicy, B, BL>
+par_join(std::vector<flex_vector<T, MemoryPolicy, B, BL>>& parts, Executor& ex)
+{
+    return concat_all(parts, ex);
+}
+
+// Merges the maps of `parts` with `fn(earlier, later)` for the keys
+// that are in several of them, in the same pairwise tree as
+// concat_all, so that the result does not depend on the executor.
+template <typename Map, typename Fn, typename Executor>
+Map par_merge_all(std::vector<Map>& parts, Fn&& fn, Executor& ex)
+{
+    for (auto w = std::size_t{1}; w < parts.size(); w *= 2)
+        ex.bulk((parts.size() + 2 * w - 1) / (2 * w), [&](std::size_t i) {
+            auto mid = 2 * w * i + w;
+            if (mid < parts.size()) {
+                auto& l = parts[mid - w];
+                auto& r = parts[mid];
+                l = l.empty() ? std::move(r) : l.merge(r, fn);
+                r = {};
+            }
+        });
+    return parts.empty() ? Map{} : std::move(parts.front());
+}
+
+template <typename K,
+          typename T,
+          typename Hash,
+          typename Equal,
+          typename MemoryPolicy,
+          hamts::bits_t B,
+          typename Executor>
+map<K, T, Hash, Equal, MemoryPolicy, B>
+par_join(std::vector<map<K, T, Hash, Equal, MemoryPolicy, B>>& parts,
+         Executor& ex)
+{
+    // the later parts win
+    return par_merge_all(
+        parts, [](const T&, const T& y) { return y; }, ex);
+}
+
+// Reads the next chunk of about `size` bytes of `in` that ends with a
+// whole record.  The partial record at its end is left in `carry`, to
+// start the next chunk.  Returns an empty chunk when the input is over.
+inline std::string
+read_records(std::istream& in, std::string& carry, std::size_t size, char delim)
+{
+    auto chunk = std::move(carry);
+    carry.clear();
+    while (in) {
+        auto old = chunk.size();
+        chunk.resize(old + size);
+        in.read(&chunk[old], static_cast<std::streamsize>(size));
+        chunk.resize(old + static_cast<std::size_t>(in.gcount()));
+        if (!in)
+            break;
+        // a record longer than the chunk makes it grow until it ends
+        auto pos = chunk.rfind(delim);
+        if (pos != std::string::npos && pos >= old) {
+            carry.assign(chunk, pos + 1, std::string::npos);
+            chunk.resize(pos + 1);
+            break;
+        }
+    }
+    return chunk;
+}
+
+// Calls `fn(first, last)` for every record of `chunk`.  The delimiter
+// after the last record is optional.
+template <typename Fn>
+void for_each_record(const std::string& chunk, char delim, Fn&& fn)
+{
+    auto first = chunk.data();
+    auto end   = first + chunk.size();
+    while (first != end) {
+        auto last = std::find(first, end, delim);
+        fn(first, last);
+        first = last == end ? end : last + 1;
+    }
+}
+
+} // namespace detail
+
+/*!
+ * Builds a container of type `Container`, a ``flex_vector`` or a
+ * ``map``, on all the workers of the executor `ex` (see @ref
+ * executor).  The work is split in `parts`: for every `i` in `[0,
+ * parts)`, `fn(i, t)` fills a transient `t` of its own.  Since every
+ * transient has its own ownership token, the workers mutate their
+ * nodes in place without any locking.  Then, the results are stitched
+ * together: vectors are concatenated in the order of their parts, as
+ * with @a par_concat_all, and maps are merged such that, when a key is
+ * set in several parts, the value from the last one is kept, as if the
+ * parts were filled one after the other.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    auto v = immer::par_build<immer::flex_vector<int>>(
+ *        8, [&](std::size_t i, auto& t) {
+ *            for (auto x : chunks[i])
+ *                t.push_back(parse(x));
+ *        });
+ *
+ * .. note:: A ``vector`` can not be concatenated in better than linear
+ *    time, so build a ``flex_vector`` instead and convert it when
+ *    needed.
+ *
+ * @endrst
+ */
+template <typename Container,
+          typename Fn,
+          typename Executor = thread_executor>
+Container par_build(std::size_t parts, Fn&& fn, Executor&& ex = {})
+{
+    auto results = std::vector<Container>(parts);
+    ex.bulk(parts, [&](std::size_t i) {
+        auto t = Container{}.transient();
+        fn(i, t);
+        results[i] = std::move(t).persistent();
+    });
+    return detail::par_join(results, ex);
+}
+
+/*!
+ * Loads a container of type `Container`, a ``flex_vector`` or a
+ * ``map``, from the records of the stream `in`, which are separated by
+ * `delim`.  It works as a pipeline: while the workers of the executor
+ * `ex` parse a batch of chunks of about `chunk_size` bytes, a thread
+ * of its own reads the next batch from the stream.  For every record
+ * of a chunk, `fn(first, last, t)` is called with the characters
+ * `[first, last)` of the record, without the delimiter, and a
+ * transient `t` for that chunk, to which it adds the parsed values.
+ * The results are then stitched together as with @a par_build: the
+ * vectors are concatenated in the order of the input and the maps are
+ * merged such that the value of the last record with a key is kept.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    auto file  = std::ifstream{"users.csv"};
+ *    auto users = immer::par_load<immer::map<int, user>>(
+ *        file, [](const char* first, const char* last, auto& t) {
+ *            auto u = parse_user(first, last);
+ *            t.set(u.id, std::move(u));
+ *        });
+ *
+ * Empty records are passed to `fn` too, except the one after the last
+ * delimiter of the input.  Exceptions thrown by `fn`, or by the stream,
+ * are rethrown once the batch that is in flight is done.
+ *
+ * @endrst
+ */
+template <typename Container,
+          typename Fn,
+          typename Executor = thread_executor>
+Container par_load(std::istream& in,
+                   Fn&& fn,
+                   Executor&& ex = {},
+                   std::size_t chunk_size = std::size_t{1} << 20,
+                   char delim = '\n')
+{
+    using batch_t   = std::vector<std::string>;
+    auto carry      = std::string{};
+    auto batch_size = ex.concurrency() * detail::bulk_oversubscription;
+    auto read_batch = [&] {
+        auto r = batch_t{};
+        while (r.size() < batch_size) {
+            auto chunk = detail::read_records(in, carry, chunk_size, delim);
+            if (chunk.empty())
+                break;
+            r.push_back(std::move(chunk));
+        }
+        return r;
+    };
+
+    auto results = std::vector<Container>{};
+    auto batch   = read_batch();
+    while (!batch.empty()) {
+        auto next   = batch_t{};
+        auto error  = std::exception_ptr{};
+        auto reader = std::thread{[&] {
+            IMMER_TRY {
+                next = read_batch();
+            }
+            IMMER_CATCH (...) {
+                error = std::current_exception();
+            }
+        }};
+        auto base = results.size();
+        results.resize(base + batch.size());
+        IMMER_TRY {
+            ex.bulk(batch.size(), [&](std::size_t i) {
+                auto t = Container{}.transient();
+                detail::for_each_record(
+                    batch[i], delim, [&](const char* f, const char* l) {
+                        fn(f, l, t);
+                    });
+                results[base + i] = std::move(t).persistent();
+            });
+        }
+        IMMER_CATCH (...) {
+            reader.join();
+            IMMER_RETHROW;
+        }
+        reader.join();
+        if (error)
+            std::rethrow_exception(error);
+        batch = std::move(next);
+    }
+    return detail::par_join(results, ex);
+}
+
+/*!
+ * Groups the elements of the range `seq` by the key that `key_fn`
+ * returns for them, into a ``map`` from every key to the
+ * ``flex_vector`` of its elements, in the order of `seq`.  The range
+ * is split in as many parts as the executor `ex` needs to keep its
+ * workers busy (see @ref executor), and every part is grouped by a
+ * worker of its own, pushing into transients.  The maps of the parts
+ * are then merged pairwise, also in parallel, concatenating the
+ * vectors of the keys that are in both, which costs @f$ O(log(n))
+ * @f$ per key instead of copying the elements.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    auto by_user = immer::group_by(
+ *        events, [](const event& e) { return e.user_id; });
+ *    for (auto& kv : by_user)
+ *        report(kv.first, kv.second);
+ *
+ * `seq` can be any range with random access iterators, like a
+ * ``flex_vector`` or a ``std::vector``.  Use :cpp:func:`group_by_into`
+ * to choose the hasher or the memory policy of the result.
+ *
+ * @endrst
+ */
+template <typename Map,
+          typename Range,
+          typename KeyFn,
+          typename Executor = thread_executor>
+Map group_by_into(const Range& seq, KeyFn&& key_fn, Executor&& ex = {})
+{
+    using vector_t = typename Map::mapped_type;
+    using groups_t = std::unordered_map<typename Map::key_type,
+                                        typename vector_t::transient_type,
+                                        typename Map::hasher,
+                                        typename Map::key_equal>;
+
+    auto first = std::begin(seq);
+    auto n     = static_cast<std::size_t>(std::end(seq) - first);
+    auto parts = std::min(
+        ex.concurrency() * detail::bulk_oversubscription,
+        std::max(n / detail::bulk_min_elements, std::size_t{1}));
+    auto results = std::vector<Map>(parts);
+    ex.bulk(parts, [&](std::size_t i) {
+        auto groups = groups_t{};
+        auto last   = first + static_cast<std::ptrdiff_t>(n * (i + 1) / parts);
+        for (auto it = first + static_cast<std::ptrdiff_t>(n * i / parts);
+             it != last;
+             ++it) {
+            auto& v = *it;
+            auto k  = key_fn(v);
+            auto g  = groups.find(k);
+            if (g == groups.end())
+                g = groups.emplace(std::move(k), vector_t{}.transient()).first;
+            g->second.push_back(v);
+        }
+        auto t = Map{}.transient();
+        for (auto& g : groups)
+            t.set(g.first, std::move(g.second).persistent());
+        results[i] = std::move(t).persistent();
+    });
+    return detail::par_merge_all(
+        results,
+        [](const vector_t& x, const vector_t& y) { return x + y; },
+        ex);
+}
+
+/*!
+ * Like @a group_by_into, into a ``map`` with the default hasher and
+ * memory policy, from the keys returned by `key_fn` to ``flex_vector``
+ * of the values of `seq`.
+ */
+template <typename Range, typename KeyFn, typename Executor = thread_executor>
+auto group_by(const Range& seq, KeyFn&& key_fn, Executor&& ex = {})
+{
+    using value_t = std::decay_t<decltype(*std::begin(seq))>;
+    using key_t   = std::decay_t<decltype(key_fn(*std::begin(seq)))>;
+    return group_by_into<map<key_t, flex_vector<value_t>>>(
+        seq, key_fn, std::forward<Executor>(ex));
+}
+
+} // namespace immer
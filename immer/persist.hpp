@@ -0,0 +1,1494 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/hamts/champ.hpp>
+#include <immer/detail/rbts/rbtree.hpp>
+#include <immer/detail/rbts/rrbtree.hpp>
+#include <immer/detail/util.hpp>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <istream>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace immer {
+
+/*!
+ * Exception thrown when reading an archive that is truncated, corrupt or
+ * that does not contain what was asked for.
+ */
+class archive_error : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/*!
+ * Cursor over the bytes of one record of an @ref input_archive, that a
+ * @ref persist_value reads values from.
+ */
+struct archive_reader
+{
+    const char* pos;
+    const char* end;
+
+    void read(void* data, std::size_t size)
+    {
+        if (IMMER_UNLIKELY(static_cast<std::size_t>(end - pos) < size))
+            IMMER_THROW(archive_error{"truncated archive record"});
+        std::memcpy(data, pos, size);
+        pos += size;
+    }
+
+    template <typename T>
+    T read()
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "");
+        auto result = T{};
+        read(&result, sizeof(T));
+        return result;
+    }
+};
+
+/*!
+ * Random access storage that an @ref input_archive reads its records
+ * from on demand, like a file or a store of pages.  Implementations
+ * may be called from the thread using the archive only.
+ */
+class archive_source
+{
+public:
+    virtual ~archive_source() = default;
+
+    /*!
+     * Returns the number of bytes in the storage.
+     */
+    virtual std::uint64_t size() = 0;
+
+    /*!
+     * Copies `size` bytes starting at `offset` to `data`.  It is only
+     * called with ranges that are within `size()`, and reports errors
+     * by throwing.
+     */
+    virtual void read(std::uint64_t offset, void* data, std::size_t size) = 0;
+};
+
+/*!
+ * An @ref archive_source that reads from a seekable `std::istream`,
+ * like a `std::ifstream` opened in binary mode.
+ */
+class stream_source : public archive_source
+{
+public:
+    explicit stream_source(std::istream& in)
+        : in_{in}
+    {}
+
+    std::uint64_t size() override
+    {
+        in_.seekg(0, std::ios::end);
+        auto end = in_.tellg();
+        if (IMMER_UNLIKELY(!in_ || end < 0))
+            IMMER_THROW(archive_error{"can not seek in the archive"});
+        return static_cast<std::uint64_t>(end);
+    }
+
+    void read(std::uint64_t offset, void* data, std::size_t size) override
+    {
+        in_.seekg(static_cast<std::streamoff>(offset));
+        in_.read(static_cast<char*>(data), static_cast<std::streamsize>(size));
+        if (IMMER_UNLIKELY(!in_))
+            IMMER_THROW(archive_error{"can not read the archive"});
+    }
+
+private:
+    std::istream& in_;
+};
+
+/*!
+ * Tells an archive how to write a value of type `T` and read it back.
+ * By default the bytes of trivially copyable types are copied, which
+ * assumes that the archive is read on the same platform.  It can be
+ * specialized for other types, providing the same static members.
+ */
+template <typename T, typename Enable = void>
+struct persist_value
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "specialize immer::persist_value for this type");
+
+    static void save(std::string& out, const T& value)
+    {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    static T load(archive_reader& in) { return in.read<T>(); }
+};
+
+template <typename T1, typename T2>
+struct persist_value<std::pair<T1, T2>>
+{
+    static void save(std::string& out, const std::pair<T1, T2>& value)
+    {
+        persist_value<T1>::save(out, value.first);
+        persist_value<T2>::save(out, value.second);
+    }
+
+    static std::pair<T1, T2> load(archive_reader& in)
+    {
+        auto first = persist_value<T1>::load(in);
+        return {std::move(first), persist_value<T2>::load(in)};
+    }
+};
+
+template <typename Char, typename Traits, typename Allocator>
+struct persist_value<std::basic_string<Char, Traits, Allocator>>
+{
+    using string_t = std::basic_string<Char, Traits, Allocator>;
+
+    static void save(std::string& out, const string_t& value)
+    {
+        persist_value<std::uint64_t>::save(out, value.size());
+        out.append(reinterpret_cast<const char*>(value.data()),
+                   value.size() * sizeof(Char));
+    }
+
+    static string_t load(archive_reader& in)
+    {
+        auto size = in.read<std::uint64_t>();
+        if (IMMER_UNLIKELY(size > static_cast<std::size_t>(in.end - in.pos) /
+                                      sizeof(Char)))
+            IMMER_THROW(archive_error{"truncated archive record"});
+        auto result = string_t(static_cast<std::size_t>(size), Char{});
+        in.read(&result[0], result.size() * sizeof(Char));
+        return result;
+    }
+};
+
+namespace detail {
+namespace persist {
+
+enum class record_kind : std::uint8_t
+{
+    rbts_leaf = 1,
+    rbts_inner,
+    rbts_relaxed,
+    rbts_tree,
+    champ_inner,
+    champ_collision,
+    champ_tree,
+    // a node that the reader already has, found in the base of a delta
+    base,
+};
+
+// parent of the base records that refer to the root of the base
+constexpr std::uint64_t no_parent = ~std::uint64_t{};
+
+// size of the nodes taken from the base of a map or set, which is only
+// known by traversing them
+constexpr std::size_t unknown_size = ~std::size_t{};
+
+constexpr char magic[8] = {'i', 'm', 'm', 'e', 'r', 'p', 's', '1'};
+
+template <typename T>
+void put(std::string& out, T value)
+{
+    persist_value<T>::save(out, value);
+}
+
+// nodes are identified by their address and, since the nodes of
+// vectors do not know their own size, by the number of elements
+// reachable through them
+using node_key = std::pair<const void*, std::size_t>;
+
+struct node_key_hash
+{
+    std::size_t operator()(const node_key& k) const
+    {
+        return std::hash<const void*>{}(k.first) ^ (k.second * 31u);
+    }
+};
+
+// every kind of node of every container type gets a different tag, so
+// that a node loaded for one type is never reused for another
+template <typename Node, record_kind Kind>
+const void* type_tag()
+{
+    static const char tag = 0;
+    return &tag;
+}
+
+// calls `fn` with every child of an inner node of a vector, its size
+// and its index, returning their number
+template <typename Node, typename Fn>
+rbts::count_t
+each_rbts_child(Node* n, rbts::shift_t shift, std::size_t size, Fn&& fn)
+{
+    auto relaxed = n->relaxed();
+    if (relaxed) {
+        auto prev = std::size_t{};
+        for (auto i = rbts::count_t{}; i < relaxed->d.count; ++i) {
+            auto s = relaxed->d.sizes[i];
+            fn(n->inner()[i], s - prev, i);
+            prev = s;
+        }
+        return relaxed->d.count;
+    } else {
+        auto cap   = std::size_t{1} << shift;
+        auto count = static_cast<rbts::count_t>(size ? ((size - 1) >> shift) + 1
+                                                     : 0);
+        for (auto i = rbts::count_t{}; i < count; ++i)
+            fn(n->inner()[i], std::min(cap, size - i * cap), i);
+        return count;
+    }
+}
+
+} // namespace persist
+} // namespace detail
+
+/*!
+ * Archive that stores containers keeping the structural sharing among
+ * them.  Every distinct node is written once to a pool of records and
+ * containers are stored as references to their root nodes, so saving
+ * many versions of a container only takes the space of the nodes that
+ * differ.
+ *
+ * It supports @ref vector, @ref flex_vector, @ref map and @ref set.  The
+ * values are written with @ref persist_value.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    auto v1 = immer::flex_vector<int>{1, 2, 3};
+ *    auto v2 = v1.push_back(4);
+ *
+ *    auto out = immer::output_archive{};
+ *    auto id1 = out.save(v1);
+ *    auto id2 = out.save(v2); // only writes the new nodes
+ *    out.write(stream);
+ *
+ *    immer::input_archive in{stream};
+ *    auto w1 = in.load<immer::flex_vector<int>>(id1);
+ *    auto w2 = in.load<immer::flex_vector<int>>(id2); // shares with w1
+ *
+ * .. note:: The archive relies on the layout of the nodes, thus it has
+ *    to be read back with containers of the same type, including their
+ *    memory policy and branching factors.  The nodes of a map or set are
+ *    placed by the hash of the keys, which must be the same when
+ *    reading.
+ *
+ * @endrst
+ */
+class output_archive
+{
+public:
+    /*!
+     * Adds the container `c` to the archive, returning the identifier to
+     * load it with.  The nodes that were saved before, for this or other
+     * containers, are not written again.
+     */
+    template <typename Container>
+    std::size_t save(const Container& c)
+    {
+        return save_impl(c.impl());
+    }
+
+    /*!
+     * Adds the container `c` to the archive for a reader that already
+     * has `base`, usually a previous version of it, and returns the
+     * identifier to load it with using `input_archive::load(id, base)`.
+     * The nodes of `c` that are also in `base` are not written, only
+     * where to find them in `base`, so the archive only holds what
+     * changed.
+     *
+     * The containers of the reader must share their structure like the
+     * ones of the writer do, which is the case when it loaded them from
+     * archives written by it.
+     */
+    template <typename Container>
+    std::size_t save(const Container& c, const Container& base)
+    {
+        diff_impl(base.impl(), c.impl());
+        delta_ = true;
+        IMMER_TRY {
+            auto id = save_impl(c.impl());
+            delta_  = false;
+            return id;
+        }
+        IMMER_CATCH (...) {
+            delta_ = false;
+            IMMER_RETHROW;
+        }
+    }
+
+    /*!
+     * Writes everything saved so far to `out`.
+     */
+    void write(std::ostream& out) const
+    {
+        write_chunks(
+            [&](const char* data, std::size_t size) {
+                out.write(data, static_cast<std::streamsize>(size));
+            },
+            std::size_t{64} * 1024);
+    }
+
+    /*!
+     * Writes everything saved so far calling `fn(data, size)` with
+     * consecutive pieces of the archive.  They hold whole records and
+     * are `chunk_size` bytes long or more, but for the last one.
+     */
+    template <typename Fn>
+    void write_chunks(Fn&& fn, std::size_t chunk_size) const
+    {
+        auto buf = std::string(detail::persist::magic,
+                               sizeof(detail::persist::magic));
+        detail::persist::put<std::uint64_t>(buf, records_.size());
+        for (auto& r : records_) {
+            detail::persist::put<std::uint64_t>(buf, r.size());
+            buf += r;
+            if (buf.size() >= chunk_size) {
+                fn(buf.data(), buf.size());
+                buf.clear();
+            }
+        }
+        if (!buf.empty())
+            fn(buf.data(), buf.size());
+    }
+
+private:
+    using record_kind = detail::persist::record_kind;
+
+    // where a node of the base is found, as the child `index` of its
+    // `parent` or, when it has none, as its root (0) or tail (1)
+    struct base_ref
+    {
+        detail::persist::node_key parent;
+        std::uint32_t index;
+    };
+
+    template <typename T>
+    using node_map = std::unordered_map<detail::persist::node_key,
+                                        T,
+                                        detail::persist::node_key_hash>;
+    using node_set = std::unordered_set<detail::persist::node_key,
+                                        detail::persist::node_key_hash>;
+    using base_id  = std::tuple<const void*, const void*, std::size_t>;
+
+    template <typename T, typename MP, detail::rbts::bits_t B,
+              detail::rbts::bits_t BL>
+    std::size_t save_impl(const detail::rbts::rbtree<T, MP, B, BL>& t)
+    {
+        return save_rbts(t);
+    }
+
+    template <typename T, typename MP, detail::rbts::bits_t B,
+              detail::rbts::bits_t BL>
+    std::size_t save_impl(const detail::rbts::rrbtree<T, MP, B, BL>& t)
+    {
+        return save_rbts(t);
+    }
+
+    template <typename T, typename Hash, typename Equal, typename MP,
+              detail::hamts::bits_t B>
+    std::size_t
+    save_impl(const detail::hamts::champ<T, Hash, Equal, MP, B>& t)
+    {
+        using node_t = typename detail::hamts::champ<T, Hash, Equal, MP, B>::
+            node_t;
+        auto root = save_champ<node_t, B>(t.root, 0);
+        auto r    = start(record_kind::champ_tree);
+        detail::persist::put<std::uint8_t>(r, B);
+        detail::persist::put<std::uint64_t>(r, t.size);
+        detail::persist::put<std::uint64_t>(r, root);
+        return finish(std::move(r));
+    }
+
+    template <typename Tree>
+    std::size_t save_rbts(const Tree& t)
+    {
+        using node_t = typename Tree::node_t;
+        auto tail_off = t.tail_offset();
+        auto root     = save_rbts_inner<node_t>(t.root, t.shift, tail_off);
+        auto tail     = save_rbts_leaf<node_t>(
+            t.tail, static_cast<detail::rbts::count_t>(t.size - tail_off));
+        auto r = start(record_kind::rbts_tree);
+        detail::persist::put<std::uint8_t>(r, node_t::bits);
+        detail::persist::put<std::uint8_t>(r, node_t::bits_leaf);
+        detail::persist::put<std::uint64_t>(r, t.size);
+        detail::persist::put<std::uint32_t>(r, t.shift);
+        detail::persist::put<std::uint64_t>(r, root);
+        detail::persist::put<std::uint64_t>(r, tail);
+        return finish(std::move(r));
+    }
+
+    template <typename Node>
+    std::size_t save_rbts_leaf(Node* n, detail::rbts::count_t count)
+    {
+        using value_t = typename Node::value_t;
+        auto key      = detail::persist::node_key{n, count};
+        if (auto id = find(key))
+            return *id;
+        auto r = start(record_kind::rbts_leaf);
+        detail::persist::put<std::uint32_t>(r, count);
+        for (auto i = n->leaf(), e = i + count; i != e; ++i)
+            persist_value<value_t>::save(r, *i);
+        return ids_[key] = finish(std::move(r));
+    }
+
+    template <typename Node>
+    std::size_t save_rbts_inner(Node* n,
+                                detail::rbts::shift_t shift,
+                                std::size_t size)
+    {
+        using namespace detail::rbts;
+        constexpr auto B  = Node::bits;
+        constexpr auto BL = Node::bits_leaf;
+        auto key          = detail::persist::node_key{n, size};
+        if (auto id = find(key))
+            return *id;
+        std::size_t children[branches<B>];
+        auto count = detail::persist::each_rbts_child(
+            n, shift, size, [&](Node* c, std::size_t s, count_t i) {
+                children[i] =
+                    shift == BL ? save_rbts_leaf(c, static_cast<count_t>(s))
+                                : save_rbts_inner(c, shift - B, s);
+            });
+        auto r = start(n->relaxed() ? record_kind::rbts_relaxed
+                                    : record_kind::rbts_inner);
+        detail::persist::put<std::uint32_t>(r, count);
+        for (auto i = count_t{}; i < count; ++i)
+            detail::persist::put<std::uint64_t>(r, children[i]);
+        return ids_[key] = finish(std::move(r));
+    }
+
+    template <typename Node, detail::hamts::bits_t B>
+    std::size_t save_champ(Node* n, detail::hamts::count_t depth)
+    {
+        using namespace detail::hamts;
+        using value_t = typename Node::value_t;
+        auto key         = detail::persist::node_key{n, 0};
+        if (auto id = find(key))
+            return *id;
+        if (depth == max_depth<B>) {
+            auto r = start(record_kind::champ_collision);
+            detail::persist::put<std::uint32_t>(r, n->collision_count());
+            for (auto i = n->collisions(), e = i + n->collision_count();
+                 i != e;
+                 ++i)
+                persist_value<value_t>::save(r, *i);
+            return ids_[key] = finish(std::move(r));
+        }
+        std::size_t children[branches<B>];
+        auto nc = n->children_count();
+        for (auto i = count_t{}; i < nc; ++i)
+            children[i] = save_champ<Node, B>(n->children()[i], depth + 1);
+        auto r = start(record_kind::champ_inner);
+        detail::persist::put<std::uint64_t>(r, n->nodemap());
+        detail::persist::put<std::uint64_t>(r, n->datamap());
+        if (n->datamap())
+            for (auto i = n->values(), e = i + n->data_count(); i != e; ++i)
+                persist_value<value_t>::save(r, *i);
+        for (auto i = count_t{}; i < nc; ++i)
+            detail::persist::put<std::uint64_t>(r, children[i]);
+        return ids_[key] = finish(std::move(r));
+    }
+
+    template <typename T, typename MP, detail::rbts::bits_t B,
+              detail::rbts::bits_t BL>
+    void diff_impl(const detail::rbts::rbtree<T, MP, B, BL>& base,
+                   const detail::rbts::rbtree<T, MP, B, BL>& t)
+    {
+        diff_rbts(base, t);
+    }
+
+    template <typename T, typename MP, detail::rbts::bits_t B,
+              detail::rbts::bits_t BL>
+    void diff_impl(const detail::rbts::rrbtree<T, MP, B, BL>& base,
+                   const detail::rbts::rrbtree<T, MP, B, BL>& t)
+    {
+        diff_rbts(base, t);
+    }
+
+    template <typename T, typename Hash, typename Equal, typename MP,
+              detail::hamts::bits_t B>
+    void diff_impl(const detail::hamts::champ<T, Hash, Equal, MP, B>& base,
+                   const detail::hamts::champ<T, Hash, Equal, MP, B>& t)
+    {
+        using node_t = typename detail::hamts::champ<T, Hash, Equal, MP, B>::
+            node_t;
+        use_base(base.root, nullptr, base.size);
+        diff_champ<node_t, B>(base.root, t.root);
+    }
+
+    // The nodes that are in both trees are found walking them one level
+    // at a time, from the root.  Only the nodes of the base that are not
+    // in `t` are expanded, so the walk visits what changed and the nodes
+    // right below it.  Those nodes are remembered with where they are in
+    // the base, to be referred to by save_base().
+    template <typename Tree>
+    void diff_rbts(const Tree& base, const Tree& t)
+    {
+        using namespace detail::rbts;
+        using node_t      = typename Tree::node_t;
+        constexpr auto B  = node_t::bits;
+        constexpr auto BL = node_t::bits_leaf;
+        struct item
+        {
+            node_t* node;
+            // zero for the leaves
+            shift_t shift;
+            std::size_t size;
+            base_ref origin;
+        };
+        use_base(base.root, base.tail, base.size);
+        auto base_off = base.tail_offset();
+        auto off      = t.tail_offset();
+        auto olds     = std::vector<item>{
+            {base.root, base.shift, base_off, {{}, 0}},
+            {base.tail, 0, base.size - base_off, {{}, 1}}};
+        auto news =
+            std::vector<item>{{t.root, t.shift, off, {}},
+                              {t.tail, 0, t.size - off, {}}};
+        auto key = [](const item& i) {
+            return detail::persist::node_key{i.node, i.size};
+        };
+        for (auto level = std::max(base.shift, t.shift);;
+             level      = level == BL ? 0 : level - B) {
+            auto in_old = node_set{};
+            auto in_new = node_set{};
+            for (auto& i : olds)
+                if (i.shift == level)
+                    in_old.insert(key(i));
+            for (auto& i : news)
+                if (i.shift == level)
+                    in_new.insert(key(i));
+            auto expand = [&](std::vector<item>& items,
+                              const node_set& other,
+                              bool old) {
+                auto next = std::vector<item>{};
+                auto seen = node_set{};
+                for (auto& i : items) {
+                    auto k = key(i);
+                    if (i.shift != level) {
+                        next.push_back(i);
+                        continue;
+                    }
+                    if (old)
+                        base_.emplace(k, i.origin);
+                    if (level && other.count(k) == 0 && seen.insert(k).second)
+                        detail::persist::each_rbts_child(
+                            i.node,
+                            level,
+                            i.size,
+                            [&](node_t* c, std::size_t s, count_t idx) {
+                                auto cs = level == BL ? 0 : level - B;
+                                next.push_back({c, cs, s, {k, idx}});
+                            });
+                }
+                items = std::move(next);
+            };
+            expand(olds, in_new, true);
+            expand(news, in_old, false);
+            if (level == 0)
+                break;
+        }
+    }
+
+    template <typename Node, detail::hamts::bits_t B>
+    void diff_champ(Node* base, Node* n)
+    {
+        using namespace detail::hamts;
+        struct item
+        {
+            Node* node;
+            base_ref origin;
+        };
+        auto olds = std::vector<item>{{base, {{}, 0}}};
+        auto news = std::vector<item>{{n, {}}};
+        auto key  = [](const item& i) {
+            return detail::persist::node_key{i.node, 0};
+        };
+        for (auto depth = count_t{}; depth <= max_depth<B>; ++depth) {
+            auto in_old = node_set{};
+            auto in_new = node_set{};
+            for (auto& i : olds)
+                in_old.insert(key(i));
+            for (auto& i : news)
+                in_new.insert(key(i));
+            auto expand = [&](std::vector<item>& items,
+                              const node_set& other,
+                              bool old) {
+                auto next = std::vector<item>{};
+                auto seen = node_set{};
+                for (auto& i : items) {
+                    auto k = key(i);
+                    if (old)
+                        base_.emplace(k, i.origin);
+                    if (depth < max_depth<B> && other.count(k) == 0 &&
+                        seen.insert(k).second)
+                        for (auto c = count_t{}; c < i.node->children_count();
+                             ++c)
+                            next.push_back({i.node->children()[c], {k, c}});
+                }
+                items = std::move(next);
+            };
+            expand(olds, in_new, true);
+            expand(news, in_old, false);
+        }
+    }
+
+    // the references to the base are only valid for the base they were
+    // written for
+    void use_base(const void* root, const void* tail, std::size_t size)
+    {
+        auto id = base_id{root, tail, size};
+        if (id != base_id_) {
+            base_.clear();
+            base_ids_.clear();
+            base_id_ = id;
+        }
+    }
+
+    // returns the record of a node that was saved before or, when saving
+    // a delta, that the reader has in the base
+    const std::size_t* find(const detail::persist::node_key& key)
+    {
+        auto it = ids_.find(key);
+        if (it != ids_.end())
+            return &it->second;
+        if (delta_) {
+            auto b = base_.find(key);
+            if (b != base_.end())
+                return &save_base(key, b->second);
+        }
+        return nullptr;
+    }
+
+    const std::size_t& save_base(const detail::persist::node_key& key,
+                                 const base_ref& ref)
+    {
+        auto it = base_ids_.find(key);
+        if (it != base_ids_.end())
+            return it->second;
+        auto parent = ref.parent.first
+                          ? save_base(ref.parent, base_.at(ref.parent))
+                          : detail::persist::no_parent;
+        auto r = start(record_kind::base);
+        detail::persist::put<std::uint64_t>(r, parent);
+        detail::persist::put<std::uint32_t>(r, ref.index);
+        return base_ids_[key] = finish(std::move(r));
+    }
+
+    static std::string start(record_kind kind)
+    {
+        auto r = std::string{};
+        detail::persist::put<std::uint8_t>(r, static_cast<std::uint8_t>(kind));
+        return r;
+    }
+
+    std::size_t finish(std::string r)
+    {
+        records_.push_back(std::move(r));
+        return records_.size() - 1;
+    }
+
+    std::vector<std::string> records_;
+    node_map<std::size_t> ids_;
+    node_map<base_ref> base_;
+    node_map<std::size_t> base_ids_;
+    base_id base_id_{};
+    bool delta_ = false;
+};
+
+/*!
+ * Archive that reads back the containers written by an @ref
+ * output_archive.  Every node is allocated once, the first time that a
+ * container that uses it is loaded, so the containers loaded from the
+ * same archive share their structure like the ones that were saved.
+ *
+ * The archive keeps a reference to the nodes it loads, so it can be
+ * destroyed once all the containers needed are loaded to release the
+ * nodes that are not used by them.  Archives bigger than the memory
+ * can be read from an @ref archive_source, which only fetches the
+ * records of the nodes that are loaded, and evict the nodes that are
+ * not used any more with `trim()`.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    auto file   = std::ifstream{path, std::ios::binary};
+ *    auto source = immer::stream_source{file};
+ *    immer::input_archive in{source};
+ *    for (auto id : ids) {
+ *        process(in.load<immer::flex_vector<int>>(id));
+ *        in.trim(); // forget the nodes of the previous versions
+ *    }
+ *
+ * @endrst
+ */
+class input_archive
+{
+public:
+    /*!
+     * Reads all the records of an archive from `in`.  Throws @ref
+     * archive_error when it is not a complete archive.
+     */
+    explicit input_archive(std::istream& in)
+        : data_{std::istreambuf_iterator<char>{in},
+                std::istreambuf_iterator<char>{}}
+    {
+        auto r = archive_reader{data_.data(), data_.data() + data_.size()};
+        char magic[sizeof(detail::persist::magic)];
+        r.read(magic, sizeof(magic));
+        if (std::memcmp(magic, detail::persist::magic, sizeof(magic)) != 0)
+            IMMER_THROW(archive_error{"not an immer archive"});
+        auto count = r.read<std::uint64_t>();
+        while (count-- > 0) {
+            auto size = r.read<std::uint64_t>();
+            if (IMMER_UNLIKELY(size > static_cast<std::size_t>(r.end - r.pos)))
+                IMMER_THROW(archive_error{"truncated archive"});
+            records_.push_back({r.pos, r.pos + size});
+            r.pos += size;
+        }
+        nodes_.resize(records_.size());
+    }
+
+    /*!
+     * Reads the index of the records of an archive from `source`, which
+     * must outlive the archive.  The records themselves are read when
+     * the containers that use them are loaded, and only kept while
+     * loading them.  Throws @ref archive_error when it is not a complete
+     * archive.
+     */
+    explicit input_archive(archive_source& source)
+        : source_{&source}
+    {
+        auto end = source.size();
+        char magic[sizeof(detail::persist::magic)];
+        auto pos = std::uint64_t{sizeof(magic) + sizeof(std::uint64_t)};
+        if (IMMER_UNLIKELY(end < pos))
+            IMMER_THROW(archive_error{"not an immer archive"});
+        source.read(0, magic, sizeof(magic));
+        if (std::memcmp(magic, detail::persist::magic, sizeof(magic)) != 0)
+            IMMER_THROW(archive_error{"not an immer archive"});
+        auto count = std::uint64_t{};
+        source.read(sizeof(magic), &count, sizeof(count));
+        while (count-- > 0) {
+            auto size = std::uint64_t{};
+            if (IMMER_UNLIKELY(end - pos < sizeof(size)))
+                IMMER_THROW(archive_error{"truncated archive"});
+            source.read(pos, &size, sizeof(size));
+            pos += sizeof(size);
+            if (IMMER_UNLIKELY(size > end - pos))
+                IMMER_THROW(archive_error{"truncated archive"});
+            records_.push_back({nullptr, nullptr});
+            extents_.push_back({pos, size});
+            pos += size;
+        }
+        nodes_.resize(records_.size());
+    }
+
+    input_archive(const input_archive&) = delete;
+    input_archive& operator=(const input_archive&) = delete;
+
+    ~input_archive()
+    {
+        // parents always come after their children, but for the nodes of
+        // a base, which come after their parents and are only released
+        // by them
+        for (auto i = nodes_.size(); i-- > 0;)
+            if (nodes_[i].node)
+                nodes_[i].release(nodes_[i]);
+    }
+
+    /*!
+     * Returns the container of type `Container` saved with the identifier
+     * `id`.
+     */
+    template <typename Container>
+    Container load(std::size_t id)
+    {
+        using impl_t =
+            std::decay_t<decltype(std::declval<const Container&>().impl())>;
+        auto guard = fetch_guard{*this};
+        return Container{load_impl(id, type_t<impl_t>{})};
+    }
+
+    /*!
+     * Returns the container of type `Container` saved with the identifier
+     * `id` by `output_archive::save(c, base)`.  The `base` passed here is
+     * the copy that the reader has of the one passed to the writer, and
+     * the container returned shares with it the nodes they have in
+     * common.  Throws @ref archive_error when the nodes referred to are
+     * not found in `base`.
+     */
+    template <typename Container>
+    Container load(std::size_t id, const Container& base)
+    {
+        using impl_t =
+            std::decay_t<decltype(std::declval<const Container&>().impl())>;
+        auto guard = fetch_guard{*this};
+        set_base(base.impl());
+        IMMER_TRY {
+            auto result = Container{load_impl(id, type_t<impl_t>{})};
+            base_       = base_t{};
+            return result;
+        }
+        IMMER_CATCH (...) {
+            base_ = base_t{};
+            IMMER_RETHROW;
+        }
+    }
+
+    /*!
+     * Forgets the nodes that are only referenced by the archive, that
+     * is, that are not used by any of the containers loaded from it that
+     * are still alive.  They are read again if they are needed later.
+     */
+    void trim()
+    {
+        // a node is only released after all its parents, which come
+        // later in the archive, except for the nodes of a base
+        for (auto again = true; again;) {
+            again = false;
+            for (auto i = nodes_.size(); i-- > 0;) {
+                auto& e = nodes_[i];
+                if (e.node && e.unique(e)) {
+                    e.release(e);
+                    e.node = nullptr;
+                    again  = true;
+                }
+            }
+        }
+    }
+
+private:
+    using record_kind = detail::persist::record_kind;
+
+    template <typename T>
+    struct type_t
+    {};
+
+    struct extent_t
+    {
+        std::uint64_t offset;
+        std::uint64_t size;
+    };
+
+    // drops the records fetched from the source once a load is done
+    struct fetch_guard
+    {
+        input_archive& self;
+
+        ~fetch_guard()
+        {
+            for (auto id : self.fetched_)
+                self.records_[id] = {nullptr, nullptr};
+            self.fetched_.clear();
+            self.pages_.clear();
+        }
+    };
+
+    struct entry
+    {
+        void* node = nullptr;
+        const void* tag;
+        // number of values reachable from the node
+        std::size_t size;
+        // shift or depth where the node was found
+        std::uint32_t level;
+        std::uint32_t count;
+        void (*release)(const entry&);
+        bool (*unique)(const entry&);
+    };
+
+    // the base of the delta being loaded
+    struct base_t
+    {
+        const void* tag = nullptr;
+        void* root      = nullptr;
+        void* tail      = nullptr;
+        std::uint32_t shift;
+        std::size_t root_size;
+        std::size_t tail_size;
+    };
+
+    template <typename T, typename MP, detail::rbts::bits_t B,
+              detail::rbts::bits_t BL>
+    void set_base(const detail::rbts::rbtree<T, MP, B, BL>& t)
+    {
+        set_rbts_base(t);
+    }
+
+    template <typename T, typename MP, detail::rbts::bits_t B,
+              detail::rbts::bits_t BL>
+    void set_base(const detail::rbts::rrbtree<T, MP, B, BL>& t)
+    {
+        set_rbts_base(t);
+    }
+
+    template <typename Tree>
+    void set_rbts_base(const Tree& t)
+    {
+        using node_t = typename Tree::node_t;
+        base_.tag =
+            detail::persist::type_tag<node_t, record_kind::rbts_tree>();
+        base_.root      = t.root;
+        base_.tail      = t.tail;
+        base_.shift     = t.shift;
+        base_.root_size = t.tail_offset();
+        base_.tail_size = t.size - t.tail_offset();
+    }
+
+    template <typename T, typename Hash, typename Equal, typename MP,
+              detail::hamts::bits_t B>
+    void set_base(const detail::hamts::champ<T, Hash, Equal, MP, B>& t)
+    {
+        using node_t = typename detail::hamts::champ<T, Hash, Equal, MP, B>::
+            node_t;
+        base_.tag =
+            detail::persist::type_tag<node_t, record_kind::champ_tree>();
+        base_.root = t.root;
+    }
+
+    template <typename T, typename MP, detail::rbts::bits_t B,
+              detail::rbts::bits_t BL>
+    auto load_impl(std::size_t id, type_t<detail::rbts::rbtree<T, MP, B, BL>>)
+    {
+        return load_rbts<detail::rbts::rbtree<T, MP, B, BL>>(id, false);
+    }
+
+    template <typename T, typename MP, detail::rbts::bits_t B,
+              detail::rbts::bits_t BL>
+    auto load_impl(std::size_t id,
+                   type_t<detail::rbts::rrbtree<T, MP, B, BL>>)
+    {
+        return load_rbts<detail::rbts::rrbtree<T, MP, B, BL>>(id, true);
+    }
+
+    template <typename T, typename Hash, typename Equal, typename MP,
+              detail::hamts::bits_t B>
+    auto load_impl(std::size_t id,
+                   type_t<detail::hamts::champ<T, Hash, Equal, MP, B>>)
+    {
+        using tree_t = detail::hamts::champ<T, Hash, Equal, MP, B>;
+        using node_t = typename tree_t::node_t;
+        auto r       = open(id, record_kind::champ_tree);
+        auto b       = r.read<std::uint8_t>();
+        auto size    = r.read<std::uint64_t>();
+        auto& root   = load_champ<node_t, Hash, B>(child_id(r, id), 0);
+        if (b != B || (root.size != detail::persist::unknown_size &&
+                       root.size != size))
+            IMMER_THROW(archive_error{"malformed archive map"});
+        auto node = static_cast<node_t*>(root.node);
+        return tree_t{node->inc(), static_cast<std::size_t>(size)};
+    }
+
+    static void fail() { IMMER_THROW(archive_error{"malformed archive node"}); }
+
+    template <typename Node>
+    static bool is_unique(const entry& x)
+    {
+        return Node::refs(static_cast<Node*>(x.node)).unique();
+    }
+
+    // returns the bytes of a record, reading them from the source if
+    // they are not in memory
+    archive_reader record(std::size_t id)
+    {
+        auto& r = records_[id];
+        if (source_ && !r.pos) {
+            auto& x = extents_[id];
+            pages_.emplace_back(static_cast<std::size_t>(x.size), '\0');
+            auto& page = pages_.back();
+            source_->read(x.offset, &page[0], page.size());
+            r = {page.data(), page.data() + page.size()};
+            fetched_.push_back(id);
+        }
+        return r;
+    }
+
+    archive_reader open(std::size_t id, record_kind kind)
+    {
+        if (IMMER_UNLIKELY(id >= records_.size()))
+            IMMER_THROW(archive_error{"no such record in the archive"});
+        auto r = record(id);
+        if (IMMER_UNLIKELY(r.read<std::uint8_t>() !=
+                           static_cast<std::uint8_t>(kind)))
+            IMMER_THROW(archive_error{"unexpected record in the archive"});
+        return r;
+    }
+
+    // records can only refer to older ones, which rules out cycles
+    static std::size_t child_id(archive_reader& r, std::size_t parent)
+    {
+        auto id = r.read<std::uint64_t>();
+        if (IMMER_UNLIKELY(id >= parent))
+            fail();
+        return static_cast<std::size_t>(id);
+    }
+
+    static record_kind peek(const archive_reader& r)
+    {
+        if (IMMER_UNLIKELY(r.pos == r.end))
+            fail();
+        return static_cast<record_kind>(*r.pos);
+    }
+
+    template <typename Tree>
+    Tree load_rbts(std::size_t id, bool allow_relaxed)
+    {
+        using namespace detail::rbts;
+        using node_t      = typename Tree::node_t;
+        constexpr auto B  = node_t::bits;
+        constexpr auto BL = node_t::bits_leaf;
+        auto r            = open(id, record_kind::rbts_tree);
+        auto b            = r.read<std::uint8_t>();
+        auto bl           = r.read<std::uint8_t>();
+        auto size         = r.read<std::uint64_t>();
+        auto shift        = r.read<std::uint32_t>();
+        auto root_id      = child_id(r, id);
+        auto tail_id      = child_id(r, id);
+        if (b != B || bl != BL || shift < BL || (shift - BL) % B != 0 ||
+            shift >= sizeof(std::size_t) * 8)
+            IMMER_THROW(archive_error{"malformed archive vector"});
+        auto& root = load_rbts_inner<node_t>(root_id, shift, allow_relaxed);
+        auto& tail = load_rbts_leaf<node_t>(tail_id);
+        auto root_node = static_cast<node_t*>(root.node);
+        auto regular   = root_node->relaxed() == nullptr;
+        if (root.size + tail.size != size ||
+            (regular && root.size != (size ? (size - 1) & ~mask<BL> : 0)))
+            IMMER_THROW(archive_error{"malformed archive vector"});
+        auto tail_node = static_cast<node_t*>(tail.node);
+        return Tree{static_cast<std::size_t>(size),
+                    shift,
+                    root_node->inc(),
+                    tail_node->inc()};
+    }
+
+    template <typename Node>
+    entry& load_rbts_leaf(std::size_t id)
+    {
+        using value_t = typename Node::value_t;
+        constexpr auto tag =
+            &detail::persist::type_tag<Node, record_kind::rbts_leaf>;
+        auto& e = nodes_[id];
+        if (!e.node && is_base(id))
+            resolve_rbts<Node>(id);
+        if (e.node) {
+            if (e.tag != tag())
+                fail();
+            return e;
+        }
+        auto r     = open(id, record_kind::rbts_leaf);
+        auto count = r.read<std::uint32_t>();
+        if (count > detail::rbts::branches<Node::bits_leaf>)
+            fail();
+        auto n = Node::make_leaf_n(count);
+        auto i = std::uint32_t{};
+        IMMER_TRY {
+            for (; i < count; ++i)
+                new (n->leaf() + i) value_t{persist_value<value_t>::load(r)};
+        }
+        IMMER_CATCH (...) {
+            detail::destroy_n(n->leaf(), i);
+            Node::heap::deallocate(Node::sizeof_leaf_n(count), n);
+            IMMER_RETHROW;
+        }
+        e.tag     = tag();
+        e.size    = count;
+        e.level   = 0;
+        e.count   = count;
+        e.release = release_rbts_leaf<Node>;
+        e.unique  = is_unique<Node>;
+        e.node = n;
+        return e;
+    }
+
+    template <typename Node>
+    entry& load_rbts_inner(std::size_t id,
+                           detail::rbts::shift_t shift,
+                           bool allow_relaxed)
+    {
+        using namespace detail::rbts;
+        constexpr auto B  = Node::bits;
+        constexpr auto BL = Node::bits_leaf;
+        constexpr auto regular_tag =
+            &detail::persist::type_tag<Node, record_kind::rbts_inner>;
+        constexpr auto relaxed_tag =
+            &detail::persist::type_tag<Node, record_kind::rbts_relaxed>;
+        auto& e = nodes_[id];
+        if (!e.node && is_base(id))
+            resolve_rbts<Node>(id);
+        if (e.node) {
+            if ((e.tag != regular_tag() &&
+                 (!allow_relaxed || e.tag != relaxed_tag())) ||
+                e.level != shift)
+                fail();
+            return e;
+        }
+        if (id >= records_.size())
+            fail();
+        auto kind    = peek(record(id));
+        auto relaxed = kind == record_kind::rbts_relaxed;
+        if (relaxed && !allow_relaxed)
+            fail();
+        auto r     = open(id, kind);
+        auto count = r.read<std::uint32_t>();
+        if (count > branches<B> || (relaxed && count == 0))
+            fail();
+        Node* children[branches<B>];
+        std::size_t sizes[branches<B>];
+        auto size = std::size_t{};
+        auto cap  = std::size_t{1} << shift;
+        for (auto i = std::uint32_t{}; i < count; ++i) {
+            auto cid = child_id(r, id);
+            auto& c  = shift == BL
+                          ? load_rbts_leaf<Node>(cid)
+                          : load_rbts_inner<Node>(
+                                cid, shift - B, allow_relaxed && relaxed);
+            // all the children of a regular node but the last are full
+            if (c.size == 0 || (!relaxed && i + 1 < count && c.size != cap))
+                fail();
+            children[i] = static_cast<Node*>(c.node);
+            sizes[i]    = size += c.size;
+        }
+        auto n =
+            relaxed ? Node::make_inner_r_n(count) : Node::make_inner_n(count);
+        for (auto i = std::uint32_t{}; i < count; ++i)
+            n->inner()[i] = children[i]->inc();
+        if (relaxed) {
+            auto rel       = n->relaxed();
+            rel->d.count   = count;
+            std::copy(sizes, sizes + count, rel->d.sizes);
+        }
+        e.tag     = relaxed ? relaxed_tag() : regular_tag();
+        e.size    = size;
+        e.level   = shift;
+        e.count   = count;
+        e.release = relaxed ? release_rbts_inner<Node, true>
+                            : release_rbts_inner<Node, false>;
+        e.unique  = is_unique<Node>;
+        e.node    = n;
+        return e;
+    }
+
+    // the children are still referenced by the archive, that releases
+    // them later
+    template <typename Node>
+    static void release_rbts_leaf(const entry& x)
+    {
+        auto n = static_cast<Node*>(x.node);
+        if (n->dec())
+            Node::delete_leaf(n, x.count);
+    }
+
+    template <typename Node, bool Relaxed>
+    static void release_rbts_inner(const entry& x)
+    {
+        auto n     = static_cast<Node*>(x.node);
+        auto count = x.count;
+        if (n->dec()) {
+            for (auto i = n->inner(), e = i + count; i != e; ++i) {
+                auto dead = (*i)->dec();
+                assert(!dead);
+                (void) dead;
+            }
+            if (Relaxed)
+                Node::delete_inner_r(n, count);
+            else
+                Node::delete_inner(n, count);
+        }
+    }
+
+    template <typename Node, typename Hash, detail::hamts::bits_t B>
+    entry& load_champ(std::size_t id, detail::hamts::count_t depth)
+    {
+        using namespace detail::hamts;
+        using value_t  = typename Node::value_t;
+        using bitmap_t = typename Node::bitmap_t;
+        constexpr auto inner_tag =
+            &detail::persist::type_tag<Node, record_kind::champ_inner>;
+        constexpr auto collision_tag =
+            &detail::persist::type_tag<Node, record_kind::champ_collision>;
+        auto& e = nodes_[id];
+        auto collision = depth == max_depth<B>;
+        if (!e.node && is_base(id))
+            resolve_champ<Node, B>(id);
+        if (e.node) {
+            if (e.tag != (collision ? collision_tag() : inner_tag()) ||
+                e.level != depth)
+                fail();
+            return e;
+        }
+        if (collision) {
+            auto r     = open(id, record_kind::champ_collision);
+            auto count = r.read<std::uint32_t>();
+            if (count == 0)
+                fail();
+            auto n = Node::make_collision_n(count);
+            auto i = std::uint32_t{};
+            IMMER_TRY {
+                for (; i < count; ++i)
+                    new (n->collisions() + i)
+                        value_t{persist_value<value_t>::load(r)};
+            }
+            IMMER_CATCH (...) {
+                detail::destroy_n(n->collisions(), i);
+                Node::deallocate_collision(n, count);
+                IMMER_RETHROW;
+            }
+            e.tag     = collision_tag();
+            e.size    = count;
+            e.level   = depth;
+            e.count   = 0;
+            e.release = [](const entry& x) {
+                auto n = static_cast<Node*>(x.node);
+                if (n->dec())
+                    Node::delete_collision(n);
+            };
+            e.unique  = is_unique<Node>;
+            e.node = n;
+            return e;
+        }
+        auto r       = open(id, record_kind::champ_inner);
+        auto nodemap = r.read<std::uint64_t>();
+        auto datamap = r.read<std::uint64_t>();
+        if ((nodemap & datamap) != 0 ||
+            ((nodemap | datamap) >> (branches<B> - 1) >> 1) != 0)
+            fail();
+        auto nv   = popcount(static_cast<bitmap_t>(datamap));
+        auto nc   = popcount(static_cast<bitmap_t>(nodemap));
+        auto n    = Node::make_inner_n(nc, nv);
+        auto i    = count_t{};
+        auto size = std::size_t{nv};
+        IMMER_TRY {
+            n->impl.d.data.inner.datamap = static_cast<bitmap_t>(datamap);
+            for (; i < nv; ++i)
+                new (n->values() + i) value_t{persist_value<value_t>::load(r)};
+            if (Node::cache_hashes)
+                for (auto j = count_t{}; j < nv; ++j)
+                    n->hashes()[j] = Hash{}(n->values()[j]);
+            for (auto j = count_t{}; j < nc; ++j) {
+                auto& c = load_champ<Node, Hash, B>(child_id(r, id), depth + 1);
+                n->children()[j] = static_cast<Node*>(c.node)->inc();
+                n->impl.d.data.inner.nodemap |=
+                    static_cast<bitmap_t>(nodemap & ~(nodemap - 1));
+                nodemap &= nodemap - 1;
+                size = size == detail::persist::unknown_size ||
+                               c.size == detail::persist::unknown_size
+                           ? detail::persist::unknown_size
+                           : size + c.size;
+            }
+        }
+        IMMER_CATCH (...) {
+            // only the children linked so far are in the nodemap
+            for (auto j = count_t{}; j < n->children_count(); ++j)
+                n->children()[j]->dec();
+            if (nv) {
+                detail::destroy_n(n->values(), i);
+                Node::deallocate_inner(n, nc, nv);
+            } else
+                Node::deallocate_inner(n, nc);
+            IMMER_RETHROW;
+        }
+        e.tag     = inner_tag();
+        e.size    = size;
+        e.level   = depth;
+        e.count   = 0;
+        e.release = [](const entry& x) {
+            auto n = static_cast<Node*>(x.node);
+            if (n->dec()) {
+                for (auto i = n->children(), e = i + n->children_count();
+                     i != e;
+                     ++i) {
+                    auto dead = (*i)->dec();
+                    assert(!dead);
+                    (void) dead;
+                }
+                Node::delete_inner(n);
+            }
+        };
+        e.unique  = is_unique<Node>;
+        e.node = n;
+        return e;
+    }
+
+    bool is_base(std::size_t id)
+    {
+        return id < records_.size() && peek(record(id)) == record_kind::base;
+    }
+
+    // reads a reference to a node of the base, returning the record of
+    // its parent
+    std::uint64_t open_base(std::size_t id, std::uint32_t& index)
+    {
+        auto r      = open(id, record_kind::base);
+        auto parent = r.read<std::uint64_t>();
+        index       = r.read<std::uint32_t>();
+        if (IMMER_UNLIKELY(parent != detail::persist::no_parent &&
+                           (parent >= id || !is_base(parent))))
+            fail();
+        return parent;
+    }
+
+    static void no_base()
+    {
+        IMMER_THROW(archive_error{"the archive refers to a missing base"});
+    }
+
+    template <typename Node>
+    void resolve_rbts(std::size_t id)
+    {
+        using namespace detail::rbts;
+        constexpr auto B  = Node::bits;
+        constexpr auto BL = Node::bits_leaf;
+        constexpr auto regular_tag =
+            &detail::persist::type_tag<Node, record_kind::rbts_inner>;
+        constexpr auto relaxed_tag =
+            &detail::persist::type_tag<Node, record_kind::rbts_relaxed>;
+        auto index  = std::uint32_t{};
+        auto pid    = open_base(id, index);
+        auto node   = static_cast<Node*>(nullptr);
+        auto shift  = shift_t{};
+        auto size   = std::size_t{};
+        if (pid == detail::persist::no_parent) {
+            constexpr auto tree_tag =
+                &detail::persist::type_tag<Node, record_kind::rbts_tree>;
+            if (base_.tag != tree_tag() || index > 1)
+                no_base();
+            node  = static_cast<Node*>(index ? base_.tail : base_.root);
+            shift = index ? 0 : base_.shift;
+            size  = index ? base_.tail_size : base_.root_size;
+        } else {
+            auto parent = &nodes_[static_cast<std::size_t>(pid)];
+            if (!parent->node)
+                resolve_rbts<Node>(static_cast<std::size_t>(pid));
+            if ((parent->tag != regular_tag() &&
+                 parent->tag != relaxed_tag()) ||
+                index >= parent->count)
+                no_base();
+            auto p = static_cast<Node*>(parent->node);
+            detail::persist::each_rbts_child(p,
+                            parent->level,
+                            parent->size,
+                            [&](Node* c, std::size_t s, count_t i) {
+                                if (i == index) {
+                                    node = c;
+                                    size = s;
+                                }
+                            });
+            shift = parent->level == BL ? 0 : parent->level - B;
+        }
+        auto& e = nodes_[id];
+        e.size  = size;
+        e.level = shift;
+        if (shift == 0) {
+            e.tag =
+                detail::persist::type_tag<Node, record_kind::rbts_leaf>();
+            e.count   = static_cast<std::uint32_t>(size);
+            e.release = release_rbts_leaf<Node>;
+        } else {
+            auto relaxed = node->relaxed();
+            e.tag        = relaxed ? relaxed_tag() : regular_tag();
+            e.count      = relaxed ? relaxed->d.count
+                                   : static_cast<std::uint32_t>(
+                                    size ? ((size - 1) >> shift) + 1 : 0);
+            e.release = release_rbts_base<Node>;
+        }
+        e.unique  = is_unique<Node>;
+        e.node = node->inc();
+    }
+
+    // unlike the other nodes, the ones of a base own their children
+    template <typename Node>
+    static void release_rbts_base(const entry& x)
+    {
+        auto n = static_cast<Node*>(x.node);
+        if (x.size == 0) {
+            if (n->dec())
+                Node::delete_inner(n, 0);
+        } else
+            detail::rbts::visit_maybe_relaxed_sub(
+                n, x.level, x.size, detail::rbts::dec_visitor{});
+    }
+
+    template <typename Node, detail::hamts::bits_t B>
+    void resolve_champ(std::size_t id)
+    {
+        using namespace detail::hamts;
+        constexpr auto inner_tag =
+            &detail::persist::type_tag<Node, record_kind::champ_inner>;
+        constexpr auto collision_tag =
+            &detail::persist::type_tag<Node, record_kind::champ_collision>;
+        auto index  = std::uint32_t{};
+        auto pid    = open_base(id, index);
+        auto node   = static_cast<Node*>(nullptr);
+        auto depth  = count_t{};
+        if (pid == detail::persist::no_parent) {
+            constexpr auto tree_tag =
+                &detail::persist::type_tag<Node, record_kind::champ_tree>;
+            if (base_.tag != tree_tag() || index != 0)
+                no_base();
+            node = static_cast<Node*>(base_.root);
+        } else {
+            auto parent = &nodes_[static_cast<std::size_t>(pid)];
+            if (!parent->node)
+                resolve_champ<Node, B>(static_cast<std::size_t>(pid));
+            if (parent->tag != inner_tag())
+                no_base();
+            auto p = static_cast<Node*>(parent->node);
+            if (index >= p->children_count())
+                no_base();
+            node  = p->children()[index];
+            depth = parent->level + 1;
+        }
+        auto& e   = nodes_[id];
+        e.tag     = depth == max_depth<B> ? collision_tag() : inner_tag();
+        e.size    = detail::persist::unknown_size;
+        e.level   = depth;
+        e.count   = 0;
+        e.release = [](const entry& x) {
+            auto n = static_cast<Node*>(x.node);
+            if (n->dec())
+                Node::delete_deep(n, x.level);
+        };
+        e.unique  = is_unique<Node>;
+        e.node = node->inc();
+    }
+
+    std::string data_;
+    std::vector<archive_reader> records_;
+    std::vector<entry> nodes_;
+    base_t base_;
+    archive_source* source_ = nullptr;
+    std::vector<extent_t> extents_;
+    std::vector<std::size_t> fetched_;
+    std::deque<std::string> pages_;
+};
+
+} // namespace immer
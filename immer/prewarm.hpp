@@ -0,0 +1,113 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/hamts/node.hpp>
+#include <immer/detail/rbts/node.hpp>
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace immer {
+namespace detail {
+namespace prewarm {
+
+// Allocates `n` blocks of `size` bytes from `Heap` and then frees them
+// all, so that they are left in the pools of the heap.
+template <typename Heap>
+void blocks(std::size_t size, std::size_t n)
+{
+    auto ps = std::vector<void*>{};
+    ps.reserve(n);
+    IMMER_TRY {
+        while (ps.size() < n)
+            ps.push_back(Heap::allocate(size));
+    }
+    IMMER_CATCH (...) {
+        for (auto p : ps)
+            Heap::deallocate(size, p);
+        IMMER_RETHROW;
+    }
+    for (auto p : ps)
+        Heap::deallocate(size, p);
+}
+
+// All the nodes of the vectors have the same size in their heap, that
+// of a full inner node.
+template <typename T, typename MP, rbts::bits_t B, rbts::bits_t BL>
+void nodes(rbts::node<T, MP, B, BL>*, std::size_t n)
+{
+    using node_t = rbts::node<T, MP, B, BL>;
+    blocks<typename node_t::heap>(node_t::max_sizeof_inner, n);
+}
+
+// The nodes of the tries have as many sizes as counts of children and
+// values.  The blocks are split evenly between the inner nodes with
+// `1..2^B` children and the values of the nodes with `1..2^B` values,
+// which are in the node itself when the memory policy embeds them.
+template <typename T, typename H, typename E, typename MP, hamts::bits_t B>
+void nodes(hamts::node<T, H, E, MP, B>*, std::size_t n)
+{
+    using node_t     = hamts::node<T, H, E, MP, B>;
+    using heap_t     = typename node_t::heap;
+    constexpr auto b = hamts::branches<B, std::size_t>;
+    for (auto i = std::size_t{}; i < 2 * b; ++i) {
+        auto k    = static_cast<hamts::count_t>(i % b + 1);
+        auto size = i < b ? node_t::sizeof_inner_n(k)
+                    : node_t::embed_values ? node_t::sizeof_inner_n(0, k)
+                                           : node_t::sizeof_values_n(k);
+        blocks<heap_t>(size, n / (2 * b) + (i < n % (2 * b)));
+    }
+}
+
+} // namespace prewarm
+} // namespace detail
+
+/*!
+ * Fills the pools of the heap of the nodes of `Container` with `n`
+ * nodes, so that the first updates after starting the program do not
+ * have to get every node from the system allocator.  It does so by
+ * allocating `n` nodes, with the sizes that the container uses, and
+ * freeing them back into the heap.  It works with ``vector``,
+ * ``flex_vector``, ``map``, ``set`` and ``table``.
+ *
+ * @rst
+ *
+ * The blocks stay in the pools as far as their limits allow.  With the
+ * :cpp:class:`free_list_heap_policy`, those are the free list of the
+ * calling thread and then the global one, thus every thread should
+ * warm its own free list when it starts:
+ *
+ * .. code-block:: c++
+ *
+ *    auto worker = std::thread{[] {
+ *        immer::prewarm<immer::vector<int>>(1024);
+ *        serve();
+ *    }};
+ *
+ * That heap policy only pools the nodes of the vectors, since those of
+ * the maps and sets have many sizes.  To prewarm those, they must use a
+ * heap that pools them, like :cpp:class:`size_class_heap`.  The nodes
+ * of the maps are split evenly between all their sizes.
+ *
+ * @endrst
+ */
+template <typename Container>
+void prewarm(std::size_t n)
+{
+    using impl_t =
+        std::decay_t<decltype(std::declval<const Container&>().impl())>;
+    using node_t = typename impl_t::node_t;
+    detail::prewarm::nodes(static_cast<node_t*>(nullptr), n);
+}
+
+} // namespace immer
@@ -0,0 +1,203 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/leftist/leftist.hpp>
+#include <immer/detail/type_traits.hpp>
+#include <immer/memory_policy.hpp>
+
+#include <functional>
+#include <initializer_list>
+#include <utility>
+
+namespace immer {
+
+template <typename T, typename Compare, typename MemoryPolicy>
+class priority_queue_transient;
+
+/*!
+ * Immutable priority queue, giving access to the value with the
+ * highest priority.  Like in `std::priority_queue`, a value has
+ * priority over another when `Compare` orders the second before the
+ * first, so that by default the top is the greatest value, and
+ * `std::greater<T>` makes it the smallest one.
+ *
+ * @tparam T The type of the values to be stored in the container.
+ * @tparam Compare The type of a function object that orders values of
+ *         type `T`.
+ * @tparam MemoryPolicy Memory management policy. See @ref
+ *         memory_policy.
+ *
+ * @rst
+ *
+ * This container is a leftist heap.  Pushing, popping and melding two
+ * queues only walk down their right paths, that are :math:`O(log(n))`
+ * long, and copy the nodes on them, sharing the rest with the previous
+ * versions.
+ *
+ * .. code-block:: c++
+ *
+ *    using timers = immer::priority_queue<int, std::greater<int>>;
+ *    auto a = timers{}.push(30).push(10);
+ *    auto b = a.meld(timers{20, 5});
+ *    assert(b.top() == 5 && b.pop().top() == 10);
+ *
+ * @endrst
+ */
+template <typename T,
+          typename Compare      = std::less<T>,
+          typename MemoryPolicy = default_memory_policy>
+class priority_queue
+{
+    using impl_t = detail::leftist::leftist<T, Compare, MemoryPolicy>;
+
+public:
+    using value_type      = T;
+    using size_type       = detail::leftist::size_t;
+    using value_compare   = Compare;
+    using reference       = const T&;
+    using const_reference = const T&;
+
+    using transient_type = priority_queue_transient<T, Compare, MemoryPolicy>;
+
+    using memory_policy_type = MemoryPolicy;
+
+    /*!
+     * Default constructor.  It creates a queue of `size() == 0`.  It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    priority_queue() = default;
+
+    /*!
+     * Constructs a queue containing the elements in `values`.
+     */
+    priority_queue(std::initializer_list<value_type> values)
+        : priority_queue(values.begin(), values.end())
+    {}
+
+    /*!
+     * Constructs a queue containing the elements in the range
+     * defined by the input iterator `first` and range sentinel `last`.
+     */
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    priority_queue(Iter first, Sent last)
+    {
+        auto owner = typename MemoryPolicy::transience_t::owner{};
+        for (; first != last; ++first)
+            impl_.push_mut(owner, true, *first);
+    }
+
+    /*!
+     * Returns the number of elements in the queue.  It does not
+     * allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD size_type size() const { return impl_.size; }
+
+    /*!
+     * Returns `true` if there are no elements in the queue.  It does
+     * not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD bool empty() const { return impl_.size == 0; }
+
+    /*!
+     * Returns the value with the highest priority.  The queue must not
+     * be empty.  It does not allocate memory and its complexity is @f$
+     * O(1) @f$.
+     */
+    IMMER_NODISCARD const T& top() const { return impl_.top(); }
+
+    /*!
+     * Returns a queue that also contains `value`.  It may allocate
+     * memory and its complexity is @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD priority_queue push(T value) const&
+    {
+        auto r = impl_;
+        r.push_mut(impl_t::noone(), false, std::move(value));
+        return r;
+    }
+    IMMER_NODISCARD priority_queue&& push(T value) &&
+    {
+        impl_.push_mut(impl_t::noone(), false, std::move(value));
+        return std::move(*this);
+    }
+
+    /*!
+     * Returns a queue without the value of `top()`.  The queue must
+     * not be empty.  It may allocate memory and its complexity is @f$
+     * O(log(n)) @f$.
+     */
+    IMMER_NODISCARD priority_queue pop() const&
+    {
+        auto r = impl_;
+        r.pop_mut(impl_t::noone(), false);
+        return r;
+    }
+    IMMER_NODISCARD priority_queue&& pop() &&
+    {
+        impl_.pop_mut(impl_t::noone(), false);
+        return std::move(*this);
+    }
+
+    /*!
+     * Returns a queue with the values of this one and those of
+     * `other`.  Both are shared but for their right paths, and its
+     * complexity is @f$ O(log(n)) @f$.
+     */
+    IMMER_NODISCARD priority_queue meld(priority_queue other) const&
+    {
+        auto r = impl_;
+        r.meld_mut(impl_t::noone(), false, std::move(other.impl_));
+        return r;
+    }
+    IMMER_NODISCARD priority_queue&& meld(priority_queue other) &&
+    {
+        impl_.meld_mut(impl_t::noone(), false, std::move(other.impl_));
+        return std::move(*this);
+    }
+
+    /*!
+     * Returns an @a transient form of this container, an
+     * `immer::priority_queue_transient`.
+     */
+    IMMER_NODISCARD transient_type transient() const&
+    {
+        return transient_type{impl_};
+    }
+    IMMER_NODISCARD transient_type transient() &&
+    {
+        return transient_type{std::move(impl_)};
+    }
+
+    /*!
+     * Returns a value that can be used as identity for the container.  If two
+     * values have the same identity, they are guaranteed to be equal and to
+     * contain the same objects.  However, two equal containers are not
+     * guaranteed to have the same identity.
+     */
+    void* identity() const { return impl_.root; }
+
+    // Semi-private
+    const impl_t& impl() const { return impl_; }
+
+    priority_queue(impl_t impl)
+        : impl_(std::move(impl))
+    {}
+
+private:
+    friend transient_type;
+
+    impl_t impl_ = impl_t::empty();
+};
+
+} // namespace immer
@@ -0,0 +1,107 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/memory_policy.hpp>
+#include <immer/priority_queue.hpp>
+
+#include <functional>
+
+namespace immer {
+
+/*!
+ * Mutable version of `immer::priority_queue`.
+ *
+ * @rst
+ *
+ * Refer to :doc:`transients` to learn more about when and how to use
+ * the mutable versions of immutable containers.
+ *
+ * .. note:: If copying a value throws in the middle of an update, the
+ *    transient is left empty.
+ *
+ * @endrst
+ */
+template <typename T,
+          typename Compare      = std::less<T>,
+          typename MemoryPolicy = default_memory_policy>
+class priority_queue_transient : MemoryPolicy::transience_t::owner
+{
+    using base_t  = typename MemoryPolicy::transience_t::owner;
+    using owner_t = base_t;
+
+public:
+    using persistent_type = priority_queue<T, Compare, MemoryPolicy>;
+
+    using value_type      = T;
+    using size_type       = typename persistent_type::size_type;
+    using value_compare   = Compare;
+    using reference       = const T&;
+    using const_reference = const T&;
+
+    /*!
+     * Default constructor.  It creates a queue of `size() == 0`.  It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    priority_queue_transient() = default;
+
+    IMMER_NODISCARD size_type size() const { return impl_.size; }
+
+    IMMER_NODISCARD bool empty() const { return impl_.size == 0; }
+
+    IMMER_NODISCARD const T& top() const { return impl_.top(); }
+
+    /*!
+     * Adds `value` to the queue.  It may allocate memory and its
+     * complexity is @f$ O(log(n)) @f$.
+     */
+    void push(T value) { impl_.push_mut(*this, true, std::move(value)); }
+
+    /*!
+     * Removes the value of `top()`, the queue must not be empty.  Its
+     * complexity is @f$ O(log(n)) @f$.
+     */
+    void pop() { impl_.pop_mut(*this, true); }
+
+    /*!
+     * Adds the values of `other` to the queue.  Its complexity is @f$
+     * O(log(n)) @f$.
+     */
+    void meld(persistent_type other)
+    {
+        impl_.meld_mut(*this, true, std::move(other.impl_));
+    }
+
+    /*!
+     * Returns an @a immutable form of this container, an
+     * `immer::priority_queue`.
+     */
+    IMMER_NODISCARD persistent_type persistent() &
+    {
+        this->owner_t::operator=(owner_t{});
+        return impl_;
+    }
+    IMMER_NODISCARD persistent_type persistent() && { return std::move(impl_); }
+
+private:
+    friend persistent_type;
+    using impl_t = typename persistent_type::impl_t;
+
+    priority_queue_transient(impl_t impl)
+        : impl_(std::move(impl))
+    {}
+
+    impl_t impl_ = impl_t::empty();
+
+public:
+    // Semi-private
+    const impl_t& impl() const { return impl_; }
+};
+
+} // namespace immer
@@ -0,0 +1,266 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/flex_vector.hpp>
+#include <immer/memory_policy.hpp>
+#include <immer/slice_view.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <utility>
+
+namespace immer {
+
+/*!
+ * Immutable first-in first-out queue, with the values pushed at the
+ * back and popped from the front.
+ *
+ * @tparam T The type of the values to be stored in the container.
+ * @tparam MemoryPolicy Memory management policy. See @ref
+ *         memory_policy.
+ *
+ * @rst
+ *
+ * The values are kept in a ``flex_vector`` and the front of the queue
+ * is an offset into it.  Thus, popping only moves the offset, in
+ * :math:`O(1)`, and the vector is sliced with ``drop`` once every
+ * :math:`2^{BL}` pops, when a whole leaf has been popped, instead of
+ * on every one of them.  Pushing appends to the tail of the vector,
+ * reusing its leaves and its memory policy.
+ *
+ * .. code-block:: c++
+ *
+ *    auto q = immer::queue<int>{}.push(1).push(2).push(3);
+ *    assert(q.front() == 1 && q.back() == 3);
+ *    auto r = q.pop();
+ *    assert(r.front() == 2 && r.size() == 2);
+ *
+ * .. note:: The values that are popped stay alive until their leaf is
+ *    dropped, or the queue becomes empty.
+ *
+ * @endrst
+ */
+template <typename T,
+          typename MemoryPolicy  = default_memory_policy,
+          detail::rbts::bits_t B = default_bits,
+          detail::rbts::bits_t BL =
+              detail::rbts::derive_bits_leaf<T, MemoryPolicy, B>>
+class queue
+{
+public:
+    using vector_type = flex_vector<T, MemoryPolicy, B, BL>;
+
+private:
+    using impl_t = detail::slice_impl<
+        std::decay_t<decltype(std::declval<const vector_type&>().impl())>>;
+
+public:
+    using value_type      = T;
+    using reference       = const T&;
+    using size_type       = typename vector_type::size_type;
+    using difference_type = typename vector_type::difference_type;
+    using const_reference = const T&;
+
+    using iterator         = typename vector_type::iterator;
+    using const_iterator   = iterator;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+
+    using memory_policy_type = MemoryPolicy;
+
+    /*!
+     * Default constructor.  It creates a queue of `size() == 0`.  It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    queue() = default;
+
+    /*!
+     * Constructs a queue containing the elements in `values`, with the
+     * first one in the front.
+     */
+    queue(std::initializer_list<T> values)
+        : v_{values}
+    {}
+
+    /*!
+     * Constructs a queue containing the elements in the range
+     * defined by the input iterator `first` and range sentinel `last`.
+     */
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    queue(Iter first, Sent last)
+        : v_{first, last}
+    {}
+
+    /*!
+     * Constructs a queue with the elements of `v`, without copying
+     * them.
+     */
+    explicit queue(vector_type v)
+        : v_{std::move(v)}
+    {}
+
+    /*!
+     * Returns an iterator pointing at the front of the queue.  It does
+     * not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD iterator begin() const
+    {
+        return std::next(v_.begin(), head_);
+    }
+
+    /*!
+     * Returns an iterator pointing just after the back of the queue.
+     * It does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD iterator end() const { return v_.end(); }
+
+    /*!
+     * Returns an iterator that traverses the queue backwards, from the
+     * back to the front.
+     */
+    IMMER_NODISCARD reverse_iterator rbegin() const
+    {
+        return reverse_iterator{end()};
+    }
+
+    /*!
+     * Returns an iterator that traverses the queue backwards, pointing
+     * before the front.
+     */
+    IMMER_NODISCARD reverse_iterator rend() const
+    {
+        return reverse_iterator{begin()};
+    }
+
+    /*!
+     * Returns the number of elements in the queue.  It does not
+     * allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD size_type size() const { return v_.size() - head_; }
+
+    /*!
+     * Returns `true` if there are no elements in the queue.  It does
+     * not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD bool empty() const { return size() == 0; }
+
+    /*!
+     * Access the element that was pushed first, that `pop()` removes.
+     * It is undefined when the queue is empty.
+     */
+    IMMER_NODISCARD const T& front() const { return v_[head_]; }
+
+    /*!
+     * Access the element that was pushed last.  It is undefined when
+     * the queue is empty.
+     */
+    IMMER_NODISCARD const T& back() const { return v_.back(); }
+
+    /*!
+     * Returns a `const` reference to the element at position `index`,
+     * counting from the front.  It is undefined when @f$ index \geq
+     * size() @f$.
+     */
+    IMMER_NODISCARD reference operator[](size_type index) const
+    {
+        return v_[head_ + index];
+    }
+
+    /*!
+     * Returns a queue with `value` pushed at the back.  It may allocate
+     * memory and its complexity is *effectively* @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD queue push(T value) const&
+    {
+        return {v_.push_back(std::move(value)), head_};
+    }
+
+    IMMER_NODISCARD queue push(T value) &&
+    {
+        return {std::move(v_).push_back(std::move(value)), head_};
+    }
+
+    /*!
+     * Returns a queue without the front element.  It is undefined when
+     * the queue is empty.  It is @f$ O(1) @f$, but once every
+     * @f$ 2^{BL} @f$ pops it drops the leaf that has been popped, in
+     * @f$ O(log(size)) @f$.
+     */
+    IMMER_NODISCARD queue pop() const&
+    {
+        assert(!empty());
+        return advance(v_, head_ + 1);
+    }
+
+    IMMER_NODISCARD queue pop() &&
+    {
+        assert(!empty());
+        return advance(std::move(v_), head_ + 1);
+    }
+
+    /*!
+     * Returns a vector with the elements of the queue, from front to
+     * back, that shares the structure of the queue.
+     */
+    IMMER_NODISCARD vector_type vector() const& { return v_.drop(head_); }
+
+    IMMER_NODISCARD vector_type vector() &&
+    {
+        return std::move(v_).drop(head_);
+    }
+
+    /*!
+     * Returns whether the queues are equal.
+     */
+    IMMER_NODISCARD bool operator==(const queue& other) const
+    {
+        return size() == other.size() &&
+               ((v_.identity() == other.v_.identity() &&
+                 head_ == other.head_) ||
+                std::equal(begin(), end(), other.begin()));
+    }
+
+    IMMER_NODISCARD bool operator!=(const queue& other) const
+    {
+        return !(*this == other);
+    }
+
+    // Semi-private
+    impl_t impl() const { return {&v_.impl(), head_, v_.size()}; }
+
+private:
+    static constexpr auto leaf_size = size_type{1} << BL;
+
+    queue(vector_type v, size_type head)
+        : v_{std::move(v)}
+        , head_{head}
+    {}
+
+    template <typename Vector>
+    static queue advance(Vector&& v, size_type head)
+    {
+        if (head == v.size())
+            return {};
+        if (head < leaf_size)
+            return {std::forward<Vector>(v), head};
+        return {std::forward<Vector>(v).drop(head), 0};
+    }
+
+    vector_type v_;
+    size_type head_ = 0;
+};
+
+} // namespace immer
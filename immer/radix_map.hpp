@@ -0,0 +1,315 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/radix/radix.hpp>
+#include <immer/detail/radix/radix_iterator.hpp>
+#include <immer/memory_policy.hpp>
+
+#include <algorithm>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace immer {
+
+template <typename K, typename T, typename MemoryPolicy>
+class radix_map_transient;
+
+/*!
+ * Immutable mapping of values from keys of type `K`, which are strings
+ * of bytes, to values of type `T`, that is sorted by the bytes of the
+ * keys and can find every key that starts with a given prefix.
+ *
+ * @tparam K    The type of the keys, a contiguous sequence of `char`
+ *              like `std::string`, with `data()` and `size()`, that can
+ *              be constructed from a pointer and a length.
+ * @tparam T    The type of the values to be stored in the container.
+ * @tparam MemoryPolicy Memory management policy. See @ref
+ *              memory_policy.
+ *
+ * @rst
+ *
+ * This container is a radix tree, where every edge is labeled by a
+ * byte and, when the node under it has a single child and no value, by
+ * the bytes that follow until the next branch.  Finding a key of
+ * length :math:`k` visits at most :math:`k` nodes, regardless of the
+ * number of keys in the map, and ``with_prefix()`` returns the keys
+ * that start with a prefix of length :math:`k` in :math:`O(k)`,
+ * sharing the subtree that holds them, that can then be iterated in
+ * :math:`O(1)` per element.  Updates copy the nodes on the path to the
+ * key.
+ *
+ * .. code-block:: c++
+ *
+ *    auto routes = immer::radix_map<std::string, int>{}
+ *                      .set("/api/v1/users", 1)
+ *                      .set("/api/v1/items", 2)
+ *                      .set("/api/v2/users", 3);
+ *    for (auto& r : routes.with_prefix("/api/v1/"))
+ *        // visits "/api/v1/items" and "/api/v1/users"
+ *
+ * @endrst
+ */
+template <typename K,
+          typename T,
+          typename MemoryPolicy = default_memory_policy>
+class radix_map
+{
+    using impl_t  = detail::radix::radix<K, T, MemoryPolicy>;
+    using value_t = std::pair<K, T>;
+
+    struct default_value
+    {
+        const T& operator()() const
+        {
+            static T v{};
+            return v;
+        }
+    };
+
+public:
+    using key_type        = K;
+    using mapped_type     = T;
+    using value_type      = value_t;
+    using size_type       = detail::radix::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference       = const value_type&;
+    using const_reference = const value_type&;
+
+    using iterator       = detail::radix::radix_iterator<K, T, MemoryPolicy>;
+    using const_iterator = iterator;
+
+    using transient_type = radix_map_transient<K, T, MemoryPolicy>;
+
+    using memory_policy_type = MemoryPolicy;
+
+    /*!
+     * Default constructor.  It creates a map of `size() == 0`.  It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    radix_map() = default;
+
+    /*!
+     * Constructs a map containing the associations in `values`.  When
+     * a key appears more than once, the last value is kept.
+     */
+    radix_map(std::initializer_list<value_type> values)
+    {
+        auto owner = typename MemoryPolicy::transience_t::owner{};
+        for (auto& v : values)
+            impl_.set_mut(owner, true, v);
+    }
+
+    /*!
+     * Returns an iterator pointing at the association with the first
+     * key, comparing their bytes as unsigned.  It allocates memory for
+     * the path to the current node.
+     */
+    IMMER_NODISCARD iterator begin() const { return {impl_}; }
+
+    /*!
+     * Returns an iterator pointing just after the association with the
+     * last key.  It does not allocate memory.
+     */
+    IMMER_NODISCARD iterator end() const
+    {
+        return {impl_, typename iterator::end_t{}};
+    }
+
+    /*!
+     * Returns the number of associations in the map.  It does not
+     * allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD size_type size() const { return impl_.size(); }
+
+    /*!
+     * Returns `true` if there are no associations in the map.  It does
+     * not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD bool empty() const { return !impl_.root; }
+
+    /*!
+     * Returns `1` when the key `k` is contained in the map or `0`
+     * otherwise.  It does not allocate memory and its complexity is
+     * @f$ O(k) @f$, where @f$ k @f$ is the length of the key.
+     */
+    IMMER_NODISCARD size_type count(const K& k) const
+    {
+        return impl_.find(k) ? 1 : 0;
+    }
+
+    /*!
+     * Returns a `const` reference to the value associated to the key
+     * `k`.  If the key is not contained in the map, it returns a
+     * default constructed value.  It does not allocate memory and its
+     * complexity is @f$ O(k) @f$.
+     */
+    IMMER_NODISCARD const T& operator[](const K& k) const
+    {
+        auto p = find(k);
+        return p ? *p : default_value{}();
+    }
+
+    /*!
+     * Returns a `const` reference to the value associated to the key
+     * `k`.  If the key is not contained in the map, throws an
+     * `std::out_of_range` error.  It does not allocate memory and its
+     * complexity is @f$ O(k) @f$.
+     */
+    const T& at(const K& k) const
+    {
+        auto p = find(k);
+        if (!p)
+            IMMER_THROW(std::out_of_range{"key not found"});
+        return *p;
+    }
+
+    /*!
+     * Returns a pointer to the value associated with the key `k`.  If
+     * the key is not contained in the map, a `nullptr` is returned.
+     * It does not allocate memory and its complexity is @f$ O(k) @f$.
+     */
+    IMMER_NODISCARD const T* find(const K& k) const
+    {
+        auto p = impl_.find(k);
+        return p ? &p->second : nullptr;
+    }
+
+    /*!
+     * Returns the map with the associations whose key starts with
+     * `prefix`, which shares all of them with this one.  Its
+     * complexity is @f$ O(k) @f$, where @f$ k @f$ is the length of the
+     * prefix, and iterating over the result visits only those.
+     */
+    IMMER_NODISCARD radix_map with_prefix(const K& prefix) const
+    {
+        return impl_.with_prefix(prefix);
+    }
+
+    /*!
+     * Returns whether the maps have the same associations.
+     */
+    IMMER_NODISCARD bool operator==(const radix_map& other) const
+    {
+        return impl_.root == other.impl_.root ||
+               (size() == other.size() &&
+                std::equal(begin(), end(), other.begin()));
+    }
+
+    IMMER_NODISCARD bool operator!=(const radix_map& other) const
+    {
+        return !(*this == other);
+    }
+
+    /*!
+     * Returns a map containing the association `value`.  If the key is
+     * already in the map, its value is replaced.  It may allocate
+     * memory and its complexity is @f$ O(k) @f$.
+     */
+    IMMER_NODISCARD radix_map insert(value_type value) const&
+    {
+        auto r = impl_;
+        r.set_mut(impl_t::noone(), false, std::move(value));
+        return r;
+    }
+    IMMER_NODISCARD radix_map&& insert(value_type value) &&
+    {
+        impl_.set_mut(impl_t::noone(), false, std::move(value));
+        return std::move(*this);
+    }
+
+    /*!
+     * Returns a map containing the association `(k, v)`, see
+     * `insert()`.
+     */
+    IMMER_NODISCARD radix_map set(key_type k, mapped_type v) const&
+    {
+        return insert({std::move(k), std::move(v)});
+    }
+    IMMER_NODISCARD radix_map&& set(key_type k, mapped_type v) &&
+    {
+        return std::move(*this).insert({std::move(k), std::move(v)});
+    }
+
+    /*!
+     * Returns a map replacing the association `(k, v)` by the new
+     * association `(k, fn(v))`, where `v` is the currently associated
+     * value for `k` in the map or a default constructed value
+     * otherwise.  Its complexity is @f$ O(k) @f$.
+     */
+    template <typename Fn>
+    IMMER_NODISCARD radix_map update(key_type k, Fn&& fn) const&
+    {
+        auto p = find(k);
+        return set(std::move(k), std::forward<Fn>(fn)(p ? *p : T{}));
+    }
+    template <typename Fn>
+    IMMER_NODISCARD radix_map&& update(key_type k, Fn&& fn) &&
+    {
+        auto p = find(k);
+        auto v = std::forward<Fn>(fn)(p ? *p : T{});
+        return std::move(*this).set(std::move(k), std::move(v));
+    }
+
+    /*!
+     * Returns a map without the key `k`.  If the key is not in the map
+     * it returns it unchanged.  Its complexity is @f$ O(k) @f$.
+     */
+    IMMER_NODISCARD radix_map erase(const K& k) const&
+    {
+        if (!impl_.find(k))
+            return *this;
+        auto r = impl_;
+        r.erase_mut(impl_t::noone(), false, k);
+        return r;
+    }
+    IMMER_NODISCARD radix_map&& erase(const K& k) &&
+    {
+        impl_.erase_mut(impl_t::noone(), false, k);
+        return std::move(*this);
+    }
+
+    /*!
+     * Returns an @a transient form of this container, an
+     * `immer::radix_map_transient`.
+     */
+    IMMER_NODISCARD transient_type transient() const&
+    {
+        return transient_type{impl_};
+    }
+    IMMER_NODISCARD transient_type transient() &&
+    {
+        return transient_type{std::move(impl_)};
+    }
+
+    /*!
+     * Returns a value that can be used as identity for the container.  If two
+     * values have the same identity, they are guaranteed to be equal and to
+     * contain the same objects.  However, two equal containers are not
+     * guaranteed to have the same identity.
+     */
+    void* identity() const { return impl_.root; }
+
+    // Semi-private
+    const impl_t& impl() const { return impl_; }
+
+    radix_map(impl_t impl)
+        : impl_(std::move(impl))
+    {}
+
+private:
+    friend transient_type;
+
+    impl_t impl_ = impl_t::empty();
+};
+
+} // namespace immer
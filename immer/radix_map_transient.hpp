@@ -0,0 +1,139 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/memory_policy.hpp>
+#include <immer/radix_map.hpp>
+
+namespace immer {
+
+/*!
+ * Mutable version of `immer::radix_map`.
+ *
+ * @rst
+ *
+ * Refer to :doc:`transients` to learn more about when and how to use
+ * the mutable versions of immutable containers.
+ *
+ * .. note:: If copying a value throws in the middle of an update, the
+ *    transient is left empty.
+ *
+ * @endrst
+ */
+template <typename K,
+          typename T,
+          typename MemoryPolicy = default_memory_policy>
+class radix_map_transient : MemoryPolicy::transience_t::owner
+{
+    using base_t  = typename MemoryPolicy::transience_t::owner;
+    using owner_t = base_t;
+
+public:
+    using persistent_type = radix_map<K, T, MemoryPolicy>;
+
+    using key_type        = K;
+    using mapped_type     = T;
+    using value_type      = std::pair<K, T>;
+    using size_type       = typename persistent_type::size_type;
+    using reference       = const value_type&;
+    using const_reference = const value_type&;
+
+    using iterator       = typename persistent_type::iterator;
+    using const_iterator = iterator;
+
+    /*!
+     * Default constructor.  It creates a map of `size() == 0`.  It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    radix_map_transient() = default;
+
+    IMMER_NODISCARD iterator begin() const { return {impl_}; }
+    IMMER_NODISCARD iterator end() const
+    {
+        return {impl_, typename iterator::end_t{}};
+    }
+
+    IMMER_NODISCARD size_type size() const { return impl_.size(); }
+    IMMER_NODISCARD bool empty() const { return !impl_.root; }
+
+    IMMER_NODISCARD size_type count(const K& k) const
+    {
+        return impl_.find(k) ? 1 : 0;
+    }
+
+    IMMER_NODISCARD const T* find(const K& k) const
+    {
+        auto p = impl_.find(k);
+        return p ? &p->second : nullptr;
+    }
+
+    /*!
+     * Inserts the association `value`, replacing the value of its key
+     * if it was already there.  Its complexity is @f$ O(k) @f$, where
+     * @f$ k @f$ is the length of the key.
+     */
+    void insert(value_type value)
+    {
+        impl_.set_mut(*this, true, std::move(value));
+    }
+
+    /*!
+     * Inserts the association `(k, v)`, see `insert()`.
+     */
+    void set(key_type k, mapped_type v)
+    {
+        insert({std::move(k), std::move(v)});
+    }
+
+    /*!
+     * Replaces the association `(k, v)` by `(k, fn(v))`, where `v` is
+     * the currently associated value for `k` or a default constructed
+     * value otherwise.  Its complexity is @f$ O(k) @f$.
+     */
+    template <typename Fn>
+    void update(key_type k, Fn&& fn)
+    {
+        auto p = find(k);
+        auto v = std::forward<Fn>(fn)(p ? *p : T{});
+        set(std::move(k), std::move(v));
+    }
+
+    /*!
+     * Removes the key `k`, if it is there.  Its complexity is @f$ O(k)
+     * @f$.
+     */
+    void erase(const K& k) { impl_.erase_mut(*this, true, k); }
+
+    /*!
+     * Returns an @a immutable form of this container, an
+     * `immer::radix_map`.
+     */
+    IMMER_NODISCARD persistent_type persistent() &
+    {
+        this->owner_t::operator=(owner_t{});
+        return impl_;
+    }
+    IMMER_NODISCARD persistent_type persistent() && { return std::move(impl_); }
+
+private:
+    friend persistent_type;
+    using impl_t = typename persistent_type::impl_t;
+
+    radix_map_transient(impl_t impl)
+        : impl_(std::move(impl))
+    {}
+
+    impl_t impl_ = impl_t::empty();
+
+public:
+    // Semi-private
+    const impl_t& impl() const { return impl_; }
+};
+
+} // namespace immer
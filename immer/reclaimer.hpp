@@ -0,0 +1,174 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace immer {
+
+/*!
+ * Owns a thread that destroys the values handed to it with `release()`.
+ * When the last reference to a big container goes away, freeing all
+ * its nodes can take a long time.  Releasing it through a reclaimer
+ * moves that work away from the calling thread, which only pays for
+ * queueing the value.
+ *
+ * Values are destroyed in the order they were released, in batches of
+ * at most `batch_size` values between which the thread takes new ones.
+ * Every value is destroyed at once, thus the reclaimer does not bound
+ * the time it takes to tear down one container, only who waits for it.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    immer::reclaimer r;
+ *    auto v = immer::vector<int>{}; // big
+ *    r.release(std::move(v));      // returns at once
+ *
+ * .. note:: The destructors of the elements run in the reclaimer
+ *    thread.  Containers with a non thread-safe memory policy can only
+ *    be released when no other copy of them is alive.
+ *
+ * @endrst
+ */
+class reclaimer
+{
+public:
+    explicit reclaimer(std::size_t batch_size = 16)
+        : batch_size_{std::max(batch_size, std::size_t{1})}
+        , thread_{[this] { run(); }}
+    {}
+
+    reclaimer(const reclaimer&) = delete;
+    reclaimer& operator=(const reclaimer&) = delete;
+
+    /*!
+     * Destroys the values that are still pending and stops the thread.
+     */
+    ~reclaimer()
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            stop_ = true;
+        }
+        work_.notify_one();
+        thread_.join();
+    }
+
+    /*!
+     * Hands the value over to the reclaimer thread, which destroys it
+     * later.  It must be an rvalue, usually the last copy of a
+     * container passed with `std::move`.
+     */
+    template <typename T>
+    void release(T&& value)
+    {
+        static_assert(!std::is_lvalue_reference<T>::value,
+                      "releasing a copy would not free anything, "
+                      "pass the value with std::move");
+        auto h = std::make_unique<holder<std::decay_t<T>>>(std::move(value));
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            pending_.push_back(std::move(h));
+            ++released_;
+        }
+        work_.notify_one();
+    }
+
+    /*!
+     * Waits until all the values released so far have been destroyed.
+     */
+    void flush()
+    {
+        auto lock   = std::unique_lock<std::mutex>{mutex_};
+        auto target = released_;
+        done_.wait(lock, [&] { return destroyed_ >= target; });
+    }
+
+    /*!
+     * Returns a reclaimer that lives until the program exits.
+     */
+    static reclaimer& global()
+    {
+        static reclaimer global_;
+        return global_;
+    }
+
+private:
+    struct item
+    {
+        virtual ~item() = default;
+    };
+
+    template <typename T>
+    struct holder : item
+    {
+        T value;
+
+        holder(T&& v)
+            : value{std::move(v)}
+        {}
+    };
+
+    void run()
+    {
+        auto batch = std::vector<std::unique_ptr<item>>{};
+        auto lock  = std::unique_lock<std::mutex>{mutex_};
+        while (true) {
+            work_.wait(lock, [&] { return stop_ || !pending_.empty(); });
+            if (pending_.empty())
+                return;
+            auto n = std::min(batch_size_, pending_.size());
+            std::move(pending_.begin(),
+                      pending_.begin() + n,
+                      std::back_inserter(batch));
+            pending_.erase(pending_.begin(), pending_.begin() + n);
+            lock.unlock();
+            batch.clear();
+            lock.lock();
+            destroyed_ += n;
+            done_.notify_all();
+        }
+    }
+
+    std::size_t batch_size_;
+    std::mutex mutex_;
+    std::condition_variable work_;
+    std::condition_variable done_;
+    std::deque<std::unique_ptr<item>> pending_;
+    std::size_t released_  = 0;
+    std::size_t destroyed_ = 0;
+    bool stop_             = false;
+    std::thread thread_;
+};
+
+/*!
+ * Destroys `value`, usually the last copy of a big container, in the
+ * thread of the reclaimer `r` instead of the calling one.
+ */
+template <typename T>
+void release_async(T&& value, reclaimer& r = reclaimer::global())
+{
+    r.release(std::forward<T>(value));
+}
+
+} // namespace immer
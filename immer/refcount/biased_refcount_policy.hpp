@@ -0,0 +1,89 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/refcount/no_refcount_policy.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+namespace immer {
+
+namespace detail {
+
+// ids are never reused, so that a new thread can not take over the
+// counts of the objects of a finished one
+inline std::uint64_t current_thread_id()
+{
+    static std::atomic<std::uint64_t> next_{1};
+    thread_local auto id_ = next_.fetch_add(1, std::memory_order_relaxed);
+    return id_;
+}
+
+} // namespace detail
+
+/*!
+ * A reference counting policy that makes copies cheap in the thread
+ * that created the object.  It is **thread-safe**.
+ *
+ * Every object remembers the thread that created it, its owner.  The
+ * owner counts its increments in a counter that only it writes, without
+ * atomic read-modify-write operations.  Increments from other threads
+ * and all decrements go to a shared atomic counter, that can become
+ * negative.  The object is released when the sum of both reaches zero.
+ *
+ * The decrements stay atomic because the thread that drops the last
+ * reference must always see it, even when it is not the owner and the
+ * owner made the copy it drops.  Thus copying a container in its
+ * thread costs no atomic operation and dropping it costs one, as with
+ * @ref refcount_policy.  The counters are 64 bits wide, since the one of
+ * the owner only grows, and every object takes 24 bytes to count its
+ * references instead of 4.
+ */
+struct biased_refcount_policy
+{
+    std::uint64_t owner;
+    mutable std::atomic<std::int64_t> biased;
+    mutable std::atomic<std::int64_t> shared;
+
+    biased_refcount_policy()
+        : owner{detail::current_thread_id()}
+        , biased{1}
+        , shared{0} {};
+    biased_refcount_policy(disowned)
+        : owner{detail::current_thread_id()}
+        , biased{0}
+        , shared{0}
+    {}
+
+    void inc()
+    {
+        if (owner == detail::current_thread_id())
+            biased.store(biased.load(std::memory_order_relaxed) + 1,
+                         std::memory_order_release);
+        else
+            shared.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool dec()
+    {
+        auto s = shared.fetch_sub(1, std::memory_order_acq_rel) - 1;
+        return s + biased.load(std::memory_order_acquire) == 0;
+    }
+
+    bool unique()
+    {
+        return shared.load(std::memory_order_acquire) +
+                   biased.load(std::memory_order_acquire) ==
+               1;
+    }
+};
+
+} // namespace immer
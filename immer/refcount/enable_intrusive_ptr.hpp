@@ -32,6 +32,11 @@ public:
         if (x->refcount_data_.dec())
             delete x;
     }
+
+    friend bool intrusive_ptr_unique(const Deriv* x)
+    {
+        return x->refcount_data_.unique();
+    }
 };
 
 } // namespace immer
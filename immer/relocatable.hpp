@@ -0,0 +1,40 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <type_traits>
+
+namespace immer {
+
+/*!
+ * Metafunction that tells whether moving a `T` to another address and
+ * destroying the original is the same as copying its bytes.  The
+ * containers then move the elements of the nodes that they own with
+ * `std::memcpy` or `std::memmove`, instead of element by element.
+ *
+ * It is true for trivially copyable types.  Types that do not point
+ * into themselves, like most smart pointers and containers, can opt in
+ * by specializing it:
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    namespace immer {
+ *    template <>
+ *    struct is_trivially_relocatable<my_handle> : std::true_type {};
+ *    }
+ *
+ * @endrst
+ */
+template <typename T>
+struct is_trivially_relocatable : std::is_trivially_copyable<T>
+{};
+
+} // namespace immer
@@ -0,0 +1,302 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/hamts/champ.hpp>
+#include <immer/detail/rbts/operations.hpp>
+#include <immer/detail/rbts/rbtree.hpp>
+#include <immer/detail/rbts/rrbtree.hpp>
+#include <immer/detail/type_traits.hpp>
+#include <immer/detail/util.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace immer {
+namespace detail {
+namespace repack {
+
+template <typename Heap, typename = void>
+struct has_arenas : std::false_type
+{};
+
+template <typename Heap>
+struct has_arenas<Heap,
+                  void_t<decltype(Heap::allocate_in(std::declval<void*>(),
+                                                    std::size_t{}))>>
+    : std::true_type
+{};
+
+template <typename Node>
+void check_node()
+{
+    static_assert(has_arenas<typename Node::heap>::value,
+                  "repack() needs a heap with arenas, like arena_heap");
+}
+
+/*!
+ * Copies the nodes of a tree into an arena, each node followed by the
+ * nodes below it, from left to right.  The nodes that a tree shares
+ * with itself, like those of a vector made of copies of a value, are
+ * copied once.
+ */
+template <typename Node>
+struct rbts_packer
+{
+    using heap      = typename Node::heap;
+    using value_t   = typename Node::value_t;
+    using relaxed_t = typename Node::relaxed_t;
+
+    static constexpr auto B  = Node::bits;
+    static constexpr auto BL = Node::bits_leaf;
+
+    void* arena;
+    std::map<std::pair<const Node*, std::size_t>, Node*> done = {};
+
+    template <typename Tree>
+    Tree pack(const Tree& t)
+    {
+        auto tail_off = t.tail_offset();
+        auto root     = inner(t.root, t.shift, tail_off);
+        IMMER_TRY {
+            auto tail =
+                leaf(t.tail, static_cast<rbts::count_t>(t.size - tail_off));
+            return Tree{t.size, t.shift, root, tail};
+        }
+        IMMER_CATCH (...) {
+            rbts::dec_inner(root, t.shift, tail_off);
+            IMMER_RETHROW;
+        }
+    }
+
+    Node* leaf(Node* n, rbts::count_t count)
+    {
+        if (n == Node::empty_leaf())
+            return n->inc();
+        auto it = done.find({n, count});
+        if (it != done.end())
+            return it->second->inc();
+        auto size = Node::sizeof_leaf_n(count);
+        auto p =
+            Node::make_leaf_n_into(heap::allocate_in(arena, size), size, count);
+        detail::uninitialized_copy(n->leaf(), n->leaf() + count, p->leaf());
+        done[{n, count}] = p;
+        return p;
+    }
+
+    Node* inner(Node* n, rbts::shift_t shift, std::size_t size)
+    {
+        using namespace rbts;
+        if (n == Node::empty_inner())
+            return n->inc();
+        auto it = done.find({n, size});
+        if (it != done.end())
+            return it->second->inc();
+        auto relaxed = n->relaxed();
+        auto count   = relaxed ? relaxed->d.count
+                       : size  ? static_cast<count_t>(((size - 1) >> shift) + 1)
+                               : count_t{};
+        // the relaxed block goes right after the node, embedded in it
+        // when the memory policy says so, like make_inner_r_n() does
+        auto size_n = relaxed ? Node::sizeof_inner_r_n(count)
+                              : Node::sizeof_inner_n(count);
+        auto m      = heap::allocate_in(arena, size_n);
+        auto p      = Node::make_inner_n_into(m, size_n, count);
+        if (relaxed) {
+            auto mr = Node::embed_relaxed
+                          ? static_cast<void*>(static_cast<char*>(m) +
+                                               Node::sizeof_inner_n(count))
+                          : heap::allocate_in(arena,
+                                              Node::sizeof_relaxed_n(count),
+                                              norefs_tag{});
+            auto r     = new (mr) relaxed_t;
+            r->d.count = count;
+            std::copy(relaxed->d.sizes, relaxed->d.sizes + count, r->d.sizes);
+            p->impl.d.data.inner.relaxed = r;
+        }
+        auto full    = std::size_t{1} << shift;
+        auto size_of = [&](count_t i) {
+            return relaxed ? relaxed->d.sizes[i] -
+                                 (i ? relaxed->d.sizes[i - 1] : 0)
+                           : std::min(full, size - i * full);
+        };
+        auto i = count_t{};
+        IMMER_TRY {
+            for (; i < count; ++i)
+                p->inner()[i] =
+                    shift == BL
+                        ? leaf(n->inner()[i], static_cast<count_t>(size_of(i)))
+                        : inner(n->inner()[i], shift - B, size_of(i));
+        }
+        IMMER_CATCH (...) {
+            while (i--)
+                shift == BL ? dec_leaf(p->inner()[i],
+                                       static_cast<count_t>(size_of(i)))
+                            : dec_inner(p->inner()[i], shift - B, size_of(i));
+            IMMER_RETHROW;
+        }
+        done[{n, size}] = p;
+        return p;
+    }
+};
+
+/*!
+ * Copies the nodes of a trie into an arena, each node followed by its
+ * values and then by the nodes below it, from left to right.
+ */
+template <typename Node, hamts::bits_t B>
+struct champ_packer
+{
+    using heap     = typename Node::heap;
+    using value_t  = typename Node::value_t;
+    using values_t = typename Node::values_t;
+
+    void* arena;
+
+    Node* node(Node* n, hamts::count_t depth)
+    {
+        using namespace hamts;
+        if (n == Node::empty())
+            return n->inc();
+        if (depth == max_depth<B>) {
+            auto count = n->collision_count();
+            auto p =
+                new (heap::allocate_in(arena, Node::sizeof_collision_n(count)))
+                    Node;
+#if IMMER_TAGGED_NODE
+            p->impl.d.kind = Node::kind_t::collision;
+#endif
+            p->impl.d.data.collision.count = count;
+            detail::uninitialized_copy(
+                n->collisions(), n->collisions() + count, p->collisions());
+            return p;
+        }
+        auto nc = n->children_count();
+        auto nv = n->data_count();
+        auto m  = heap::allocate_in(arena, Node::sizeof_inner_n(nc, nv));
+        auto p  = Node::make_inner_n_into(m);
+        p->impl.d.data.inner.nodemap = n->nodemap();
+        p->impl.d.data.inner.datamap = n->datamap();
+        if (nv) {
+            auto mv =
+                Node::embed_values
+                    ? static_cast<void*>(static_cast<char*>(m) +
+                                         Node::embedded_values_offset_n(nc))
+                    : heap::allocate_in(arena, Node::sizeof_values_n(nv));
+            auto vp = new (mv) values_t{};
+            detail::uninitialized_copy(
+                n->values(), n->values() + nv, (value_t*) &vp->d.buffer);
+            if (Node::cache_hashes)
+                std::copy(n->hashes(), n->hashes() + nv, Node::hashes(vp, nv));
+            p->impl.d.data.inner.values = vp;
+        }
+        auto i = count_t{};
+        IMMER_TRY {
+            for (; i < nc; ++i)
+                p->children()[i] = node(n->children()[i], depth + 1);
+        }
+        IMMER_CATCH (...) {
+            while (i--)
+                if (p->children()[i]->dec())
+                    Node::delete_deep(p->children()[i], depth + 1);
+            if (nv)
+                detail::destroy_n(p->values(), nv);
+            IMMER_RETHROW;
+        }
+        return p;
+    }
+};
+
+template <typename T, typename MP, rbts::bits_t B, rbts::bits_t BL>
+rbts::rbtree<T, MP, B, BL> repack(const rbts::rbtree<T, MP, B, BL>& t,
+                                  void* arena)
+{
+    using node_t = typename rbts::rbtree<T, MP, B, BL>::node_t;
+    check_node<node_t>();
+    return rbts_packer<node_t>{arena}.pack(t);
+}
+
+template <typename T, typename MP, rbts::bits_t B, rbts::bits_t BL>
+rbts::rrbtree<T, MP, B, BL> repack(const rbts::rrbtree<T, MP, B, BL>& t,
+                                   void* arena)
+{
+    using node_t = typename rbts::rrbtree<T, MP, B, BL>::node_t;
+    check_node<node_t>();
+    return rbts_packer<node_t>{arena}.pack(t);
+}
+
+template <typename T,
+          typename Hash,
+          typename Equal,
+          typename MP,
+          hamts::bits_t B>
+hamts::champ<T, Hash, Equal, MP, B>
+repack(const hamts::champ<T, Hash, Equal, MP, B>& t, void* arena)
+{
+    using node_t = typename hamts::champ<T, Hash, Equal, MP, B>::node_t;
+    check_node<node_t>();
+    return {champ_packer<node_t, B>{arena}.node(t.root, 0), t.size};
+}
+
+} // namespace repack
+} // namespace detail
+
+/*!
+ * Returns a copy of the container `c` whose nodes are all allocated
+ * from the arena `arena`, one after the other in the order in which
+ * they are traversed.  The nodes of a long lived version are otherwise
+ * scattered all over the heap, like the updates that made them were,
+ * while those of the copy are contiguous, so that iterating over it
+ * and looking up in it goes through memory sequentially.  It is meant
+ * for the versions that are published to be read many times.
+ *
+ * Only the nodes reachable from `c` are copied, along with their
+ * values, so it takes time and memory linear in its size.  Nothing is
+ * shared between `c` and the result, but the new versions derived
+ * from the result share its nodes as usual.
+ *
+ * The container must use a memory policy whose heap is an @ref
+ * arena_heap, and `arena` must be made by its `make_arena()`.  The
+ * containers are still reference counted, and their values are
+ * destroyed when the last one referring to them is, but the memory of
+ * the nodes is only released by discarding the arena, which must
+ * outlive every container sharing nodes with the result.
+ *
+ * It supports @ref vector, @ref flex_vector, @ref map and @ref set.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    using heap_t   = immer::arena_heap<immer::cpp_heap>;
+ *    using memory   = immer::memory_policy<immer::heap_policy<heap_t>,
+ *                                          immer::refcount_policy,
+ *                                          immer::default_lock_policy>;
+ *    using vector_t = immer::vector<int, memory>;
+ *
+ *    auto arena    = heap_t::make_arena();
+ *    auto snapshot = immer::repack(v, arena);
+ *    ...
+ *    snapshot = {};
+ *    heap_t::release_arena(arena);
+ *
+ * @endrst
+ */
+template <typename Container>
+Container repack(const Container& c, void* arena)
+{
+    return Container{detail::repack::repack(c.impl(), arena)};
+}
+
+} // namespace immer
@@ -0,0 +1,220 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/executor.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace immer {
+
+namespace detail {
+
+/*!
+ * The implementation that a `reversed_view` exposes to the algorithms:
+ * the leaves of the tree from the last one to the first one, each of
+ * them with reverse iterators.
+ */
+template <typename Tree>
+struct reversed_impl
+{
+    const Tree* tree;
+
+    template <typename Fn>
+    void for_each_chunk(Fn&& fn) const
+    {
+        for_each_chunk_p([&](auto f, auto l) {
+            fn(f, l);
+            return true;
+        });
+    }
+
+    // every leaf is found from the root, which is @f$ O(log(n)) @f$ for
+    // every @f$ 2^{BL} @f$ elements
+    template <typename Fn>
+    bool for_each_chunk_p(Fn&& fn) const
+    {
+        for (auto i = tree->size; i > 0;) {
+            auto region = tree->region_for(i - 1);
+            auto data   = std::get<0>(region);
+            auto first  = std::get<1>(region);
+            if (!fn(std::make_reverse_iterator(data + (i - first)),
+                    std::make_reverse_iterator(data)))
+                return false;
+            i = first;
+        }
+        return true;
+    }
+};
+
+} // namespace detail
+
+/*!
+ * Read-only view of the elements of a ``vector`` or ``flex_vector`` of
+ * type `Vector` in the reverse order, see @a reversed.
+ *
+ * It keeps the vector alive and only translates the indices, so it is
+ * made and copied in @f$ O(1) @f$ without allocating.  Passing it to
+ * the :doc:`algorithms <algorithms>` visits the leaves of the vector
+ * from the last to the first, with the elements of every leaf visited
+ * backwards through reverse iterators, instead of the pointers that
+ * the vectors pass.  The reversed vector itself, to keep it or update
+ * it, is built with `materialize()`.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    auto v = immer::flex_vector<int>{1, 2, 3};
+ *    auto r = immer::reversed(v);
+ *    assert(r[0] == 3 && r.back() == 1);
+ *    auto last_even = immer::find_if(r, [](int x) { return x % 2 == 0; });
+ *
+ * @endrst
+ */
+template <typename Vector>
+class reversed_view
+{
+    using impl_t = detail::reversed_impl<
+        std::decay_t<decltype(std::declval<const Vector&>().impl())>>;
+
+public:
+    using vector_type     = Vector;
+    using value_type      = typename Vector::value_type;
+    using reference       = typename Vector::reference;
+    using size_type       = typename Vector::size_type;
+    using difference_type = typename Vector::difference_type;
+    using const_reference = typename Vector::const_reference;
+
+    using iterator       = std::reverse_iterator<typename Vector::iterator>;
+    using const_iterator = iterator;
+
+    /*!
+     * Default constructor.  It creates an empty view.
+     */
+    reversed_view() = default;
+
+    /*!
+     * Constructs a view of the elements of `v` from the last one to the
+     * first one.
+     */
+    explicit reversed_view(Vector v)
+        : v_{std::move(v)}
+    {}
+
+    /*!
+     * Returns an iterator pointing at the first element of the view,
+     * which is the last one of the vector.
+     */
+    IMMER_NODISCARD iterator begin() const { return iterator{v_.end()}; }
+
+    /*!
+     * Returns an iterator pointing just after the last element of the
+     * view.
+     */
+    IMMER_NODISCARD iterator end() const { return iterator{v_.begin()}; }
+
+    /*!
+     * Returns the number of elements in the view.
+     */
+    IMMER_NODISCARD size_type size() const { return v_.size(); }
+
+    /*!
+     * Returns `true` if there are no elements in the view.
+     */
+    IMMER_NODISCARD bool empty() const { return v_.empty(); }
+
+    /*!
+     * Access the first element, the last one of the vector.
+     */
+    IMMER_NODISCARD const value_type& front() const { return v_.back(); }
+
+    /*!
+     * Access the last element, the first one of the vector.
+     */
+    IMMER_NODISCARD const value_type& back() const { return v_.front(); }
+
+    /*!
+     * Returns a `const` reference to the element at position `index`
+     * of the view.  It is undefined when @f$ index \geq size() @f$.
+     */
+    IMMER_NODISCARD reference operator[](size_type index) const
+    {
+        return v_[v_.size() - 1 - index];
+    }
+
+    /*!
+     * Returns a `const` reference to the element at position `index`
+     * of the view.  It throws an `std::out_of_range` exception when
+     * @f$ index \geq size() @f$.
+     */
+    reference at(size_type index) const
+    {
+        if (index >= size())
+            IMMER_THROW(std::out_of_range{"index out of range"});
+        return v_[v_.size() - 1 - index];
+    }
+
+    /*!
+     * Returns a vector with the elements of the view.  Its leaves are
+     * filled in parallel with the executor `ex` (see @ref executor),
+     * each from the leaves of this vector that mirror it, and the
+     * inner nodes are built above them level by level, as
+     * ``from_range_parallel`` does, without pushing the elements one
+     * by one.  The result is a regular tree, even when the vector was
+     * not.
+     */
+    template <typename Executor = sequential_executor>
+    IMMER_NODISCARD Vector materialize(Executor&& ex = {}) const
+    {
+        return Vector::from_range_parallel(begin(), end(), ex);
+    }
+
+    /*!
+     * Returns the vector that the view looks into.
+     */
+    IMMER_NODISCARD const Vector& vector() const { return v_; }
+
+    // Semi-private
+    impl_t impl() const { return {&v_.impl()}; }
+
+private:
+    Vector v_;
+};
+
+/*!
+ * Returns a view of the elements of `v`, a ``vector`` or a
+ * ``flex_vector``, in the reverse order.  It is @f$ O(1) @f$ and does
+ * not allocate, see ``reversed_view``.
+ */
+template <typename Vector>
+reversed_view<Vector> reversed(Vector v)
+{
+    return reversed_view<Vector>{std::move(v)};
+}
+
+/*!
+ * Returns the vector `v`, a ``vector`` or a ``flex_vector``, with its
+ * elements in the reverse order.  It is the same as
+ * ``reversed(v).materialize(ex)``.
+ */
+template <typename Vector, typename Executor = sequential_executor>
+Vector reverse(Vector v, Executor&& ex = {})
+{
+    return reversed(std::move(v)).materialize(ex);
+}
+
+} // namespace immer
@@ -0,0 +1,338 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/algorithm.hpp>
+#include <immer/config.hpp>
+#include <immer/flex_vector.hpp>
+#include <immer/memory_policy.hpp>
+#include <immer/summary_cache.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <utility>
+
+namespace immer {
+
+/*!
+ * Immutable sequence of bytes for editing text, a ``flex_vector`` of
+ * `char` with text operations on top.  Slicing, concatenation,
+ * insertion and removal of text take @f$ O(log(n)) @f$, like in the
+ * vector, and the searches run over whole leaves with `std::memchr`
+ * and `std::memcmp` instead of iterating through the characters.
+ *
+ * Lines are indexed with a `line_index`, a @ref summary_cache of the
+ * count of newlines of every inner node.  It is kept outside of the
+ * rope, so that one index serves all the versions of a document: the
+ * summaries of the nodes that an edit did not touch are still valid.
+ *
+ * The positions are byte offsets.  The text is not required to be
+ * UTF-8, but when it is, `utf8_floor` and `utf8_substr` make sure that
+ * the slices do not cut a code point in half.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    auto r     = immer::rope{"first\nsecond\nthird"};
+ *    auto index = immer::rope::line_index{0};
+ *    auto pos   = r.line_offset(2, index); // 13
+ *    auto r2    = r.insert(pos, immer::rope{"new "});
+ *    assert(r2.find("third") == 17);
+ *
+ * @endrst
+ */
+template <typename MemoryPolicy = default_memory_policy>
+class basic_rope
+{
+public:
+    using vector_type = flex_vector<char, MemoryPolicy>;
+    using size_type   = std::size_t;
+    using iterator    = typename vector_type::iterator;
+
+    static constexpr auto npos = static_cast<size_type>(-1);
+
+    /*!
+     * The monoid of the number of newlines, for the `line_index`.
+     */
+    struct newline_count
+    {
+        size_type operator()(size_type a, char c) const
+        {
+            return a + (c == '\n');
+        }
+        size_type operator()(size_type a, size_type b) const
+        {
+            return a + b;
+        }
+    };
+
+    using line_index = summary_cache<vector_type, size_type, newline_count>;
+
+    /*!
+     * Default constructor.  It creates a rope of `size() == 0`.
+     */
+    basic_rope() = default;
+
+    /*!
+     * Constructs a rope with the bytes of `s`.
+     */
+    explicit basic_rope(const std::string& s)
+        : chars_{s.begin(), s.end()}
+    {}
+
+    explicit basic_rope(const char* s)
+        : basic_rope{std::string{s}}
+    {}
+
+    /*!
+     * Constructs a rope with the bytes in `v`, without copying them.
+     */
+    explicit basic_rope(vector_type v)
+        : chars_{std::move(v)}
+    {}
+
+    IMMER_NODISCARD iterator begin() const { return chars_.begin(); }
+    IMMER_NODISCARD iterator end() const { return chars_.end(); }
+
+    IMMER_NODISCARD size_type size() const { return chars_.size(); }
+    IMMER_NODISCARD bool empty() const { return chars_.empty(); }
+
+    IMMER_NODISCARD char operator[](size_type pos) const
+    {
+        return chars_[pos];
+    }
+
+    /*!
+     * Returns the vector of the bytes of the rope.
+     */
+    IMMER_NODISCARD const vector_type& chars() const { return chars_; }
+
+    /*!
+     * Returns a copy of the bytes of the rope in a string.
+     */
+    IMMER_NODISCARD std::string str() const
+    {
+        auto r = std::string{};
+        r.reserve(size());
+        immer::for_each_chunk(chars_, [&](auto f, auto l) { r.append(f, l); });
+        return r;
+    }
+
+    /*!
+     * Returns the `n` bytes starting at `pos`, or all of them until
+     * the end when there are not that many.
+     */
+    IMMER_NODISCARD basic_rope substr(size_type pos, size_type n = npos) const
+    {
+        assert(pos <= size());
+        return basic_rope{chars_.drop(pos).take(n)};
+    }
+
+    /*!
+     * Returns a rope with the bytes of `r` inserted at `pos`.
+     */
+    IMMER_NODISCARD basic_rope insert(size_type pos, const basic_rope& r) const
+    {
+        return basic_rope{chars_.insert(pos, r.chars_)};
+    }
+
+    /*!
+     * Returns a rope without the `n` bytes starting at `pos`.
+     */
+    IMMER_NODISCARD basic_rope erase(size_type pos, size_type n) const
+    {
+        return basic_rope{chars_.erase(pos, std::min(size(), pos + n))};
+    }
+
+    IMMER_NODISCARD basic_rope push_back(char c) const
+    {
+        return basic_rope{chars_.push_back(c)};
+    }
+
+    IMMER_NODISCARD friend basic_rope operator+(const basic_rope& a,
+                                                const basic_rope& b)
+    {
+        return basic_rope{a.chars_ + b.chars_};
+    }
+
+    /*!
+     * Returns the position of the first `c` at or after `from`, or
+     * `npos` when there is none.
+     */
+    IMMER_NODISCARD size_type find(char c, size_type from = 0) const
+    {
+        if (from >= size())
+            return npos;
+        auto r = npos;
+        auto i = from;
+        immer::for_each_chunk_p(
+            chars_.begin() + from, chars_.end(), [&](auto f, auto l) {
+                auto n = static_cast<size_type>(l - f);
+                auto p = static_cast<const char*>(std::memchr(f, c, n));
+                if (p) {
+                    r = i + static_cast<size_type>(p - f);
+                    return false;
+                }
+                i += n;
+                return true;
+            });
+        return r;
+    }
+
+    /*!
+     * Returns the position of the first occurrence of `needle` at or
+     * after `from`, or `npos` when there is none.  The candidates are
+     * found with `std::memchr` in every leaf, and compared with
+     * `std::memcmp` unless they cross to the next leaf.
+     */
+    IMMER_NODISCARD size_type find(const std::string& needle,
+                                   size_type from = 0) const
+    {
+        auto m = needle.size();
+        if (m == 0)
+            return from <= size() ? from : npos;
+        if (from >= size() || size() - from < m)
+            return npos;
+        auto r = npos;
+        auto i = from;
+        // no occurrence can start after this
+        auto last_start = size() - m;
+        immer::for_each_chunk_p(
+            chars_.begin() + from, chars_.end(), [&](auto f, auto l) {
+                auto n = static_cast<size_type>(l - f);
+                for (const char* p = f; p != l; ++p) {
+                    p = static_cast<const char*>(std::memchr(
+                        p, needle[0], static_cast<size_type>(l - p)));
+                    if (!p)
+                        break;
+                    auto pos = i + static_cast<size_type>(p - f);
+                    if (pos > last_start)
+                        return false;
+                    if (matches_at(pos, p, l, needle)) {
+                        r = pos;
+                        return false;
+                    }
+                }
+                i += n;
+                return true;
+            });
+        return r;
+    }
+
+    /*!
+     * Returns the number of lines, one more than the number of
+     * newlines.
+     */
+    IMMER_NODISCARD size_type line_count(line_index& index) const
+    {
+        return index.reduce(chars_) + 1;
+    }
+
+    /*!
+     * Returns the position of the first byte of the line `line`,
+     * counting from zero, or `size()` when there are not that many.
+     */
+    IMMER_NODISCARD size_type line_offset(size_type line,
+                                          line_index& index) const
+    {
+        if (line == 0)
+            return 0;
+        auto nl = index.find_first(
+            chars_, [&](size_type count) { return count >= line; });
+        return nl == size() ? nl : nl + 1;
+    }
+
+    /*!
+     * Returns the line that the byte at `pos` is in, counting from
+     * zero.
+     */
+    IMMER_NODISCARD size_type line_of(size_type pos,
+                                      line_index& index) const
+    {
+        assert(pos <= size());
+        return index.reduce(chars_, 0, pos);
+    }
+
+    /*!
+     * Returns the start of the UTF-8 code point that the byte at `pos`
+     * is part of, skipping back over the continuation bytes.
+     */
+    IMMER_NODISCARD size_type utf8_floor(size_type pos) const
+    {
+        if (pos >= size())
+            return size();
+        // a code point has at most three continuation bytes
+        for (auto k = 0; k < 3 && pos > 0 && is_continuation(chars_[pos]);
+             ++k)
+            --pos;
+        return pos;
+    }
+
+    /*!
+     * Returns the bytes between `first` and `last`, both moved back to
+     * the start of their code points, so that no UTF-8 sequence is cut
+     * in half.
+     */
+    IMMER_NODISCARD basic_rope utf8_substr(size_type first,
+                                           size_type last) const
+    {
+        auto f = utf8_floor(first);
+        auto l = utf8_floor(last);
+        return substr(f, l - f);
+    }
+
+    IMMER_NODISCARD bool operator==(const basic_rope& other) const
+    {
+        return chars_ == other.chars_;
+    }
+    IMMER_NODISCARD bool operator!=(const basic_rope& other) const
+    {
+        return chars_ != other.chars_;
+    }
+
+private:
+    static bool is_continuation(char c)
+    {
+        return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+    }
+
+    // whether `needle` is at `pos`, where `p` points to it inside of
+    // the chunk ending at `l`
+    bool matches_at(size_type pos,
+                    const char* p,
+                    const char* l,
+                    const std::string& needle) const
+    {
+        auto m    = needle.size();
+        auto here = std::min(m, static_cast<size_type>(l - p));
+        if (std::memcmp(p, needle.data(), here) != 0)
+            return false;
+        return here == m ||
+               std::equal(needle.begin() + here,
+                          needle.end(),
+                          chars_.begin() + (pos + here));
+    }
+
+    vector_type chars_;
+};
+
+template <typename MemoryPolicy>
+constexpr typename basic_rope<MemoryPolicy>::size_type
+    basic_rope<MemoryPolicy>::npos;
+
+/*!
+ * A rope with the default memory policy.
+ */
+using rope = basic_rope<>;
+
+} // namespace immer
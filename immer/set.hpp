@@ -8,9 +8,12 @@
 
 #pragma once
 
+#include <immer/container_hash.hpp>
 #include <immer/detail/hamts/champ.hpp>
 #include <immer/detail/hamts/champ_iterator.hpp>
+#include <immer/hash_cursor.hpp>
 #include <immer/memory_policy.hpp>
+#include <immer/relocatable.hpp>
 
 #include <functional>
 
@@ -54,7 +57,7 @@ class set_transient;
  *
  */
 template <typename T,
-          typename Hash           = std::hash<T>,
+          typename Hash           = container_hash<T>,
           typename Equal          = std::equal_to<T>,
           typename MemoryPolicy   = default_memory_policy,
           detail::hamts::bits_t B = default_bits>
@@ -198,6 +201,20 @@ public:
                                   detail::constantly<const T*, nullptr>>(value);
     }
 
+    /*!
+     * Like `find`, but `hash` is used as the hash of `value` instead of
+     * computing it, thus it must be `hasher{}(value)`.  This avoids
+     * hashing an expensive value again when it is looked up in several
+     * containers.
+     */
+    IMMER_NODISCARD const T* find_hashed(const T& value,
+                                         std::size_t hash) const
+    {
+        return impl_.template get<project_value_ptr,
+                                  detail::constantly<const T*, nullptr>>(
+            value, hash);
+    }
+
     /*!
      * Returns whether the sets are equal.
      */
@@ -224,6 +241,19 @@ public:
         return insert_move(move_t{}, std::move(value));
     }
 
+    /*!
+     * Like `insert`, but `hash` is used as the hash of `value`, thus it
+     * must be `hasher{}(value)`.
+     */
+    IMMER_NODISCARD set insert_hashed(T value, std::size_t hash) const&
+    {
+        return impl_.add(std::move(value), hash);
+    }
+    IMMER_NODISCARD decltype(auto) insert_hashed(T value, std::size_t hash) &&
+    {
+        return insert_hashed_move(move_t{}, std::move(value), hash);
+    }
+
     /*!
      * Returns a set without `value`.  If the `value` is not in the
      * set it returns the same set.  It may allocate memory and its
@@ -238,6 +268,53 @@ public:
         return erase_move(move_t{}, value);
     }
 
+    /*!
+     * Returns a set without the values in the range `values`, which must
+     * yield references to the values and can be traversed more than
+     * once.  Every node where some of them fall is visited and copied
+     * only once, see `map::erase_many()`.  Its complexity is
+     * *effectively* @f$ O(n \log n) @f$ where @f$ n @f$ is the number of
+     * values.
+     */
+    template <typename Keys>
+    IMMER_NODISCARD set erase_many(const Keys& values) const&
+    {
+        using std::begin;
+        using std::end;
+        return impl_.sub_batch(begin(values), end(values));
+    }
+    template <typename Keys>
+    IMMER_NODISCARD decltype(auto) erase_many(const Keys& values) &&
+    {
+        return erase_many_move(move_t{}, values);
+    }
+
+    /*!
+     * Returns a set without the elements for which `pred(x)` returns
+     * `true`, in one traversal that shares the subtrees where nothing
+     * is erased.  Its complexity is @f$ O(n) @f$.
+     */
+    template <typename Pred>
+    IMMER_NODISCARD set erase_if(Pred&& pred) const&
+    {
+        return impl_.filter(keep_unless(pred));
+    }
+    template <typename Pred>
+    IMMER_NODISCARD decltype(auto) erase_if(Pred&& pred) &&
+    {
+        return erase_if_move(move_t{}, pred);
+    }
+
+    /*!
+     * Calls `fn(v)` for the next `n` values `v` after the position `c`,
+     * and returns the position after them, like `map::resume()`.
+     */
+    template <typename Fn>
+    hash_cursor resume(hash_cursor c, size_type n, Fn&& fn) const
+    {
+        return detail::hamts::resume(impl_, c, n, fn);
+    }
+
     /*!
      * Returns an @a transient form of this container, a
      * `immer::set_transient`.
@@ -262,6 +339,10 @@ public:
     // Semi-private
     const impl_t& impl() const { return impl_; }
 
+    set(impl_t impl)
+        : impl_(std::move(impl))
+    {}
+
 private:
     friend transient_type;
 
@@ -275,6 +356,16 @@ private:
         return impl_.add(std::move(value));
     }
 
+    set&& insert_hashed_move(std::true_type, value_type value, std::size_t hash)
+    {
+        impl_.add_mut({}, std::move(value), hash);
+        return std::move(*this);
+    }
+    set insert_hashed_move(std::false_type, value_type value, std::size_t hash)
+    {
+        return impl_.add(std::move(value), hash);
+    }
+
     set&& erase_move(std::true_type, const value_type& value)
     {
         impl_.sub_mut({}, value);
@@ -285,11 +376,50 @@ private:
         return impl_.sub(value);
     }
 
-    set(impl_t impl)
-        : impl_(std::move(impl))
-    {}
+    template <typename Keys>
+    set&& erase_many_move(std::true_type, const Keys& keys)
+    {
+        using std::begin;
+        using std::end;
+        impl_.sub_batch_mut({}, begin(keys), end(keys));
+        return std::move(*this);
+    }
+    template <typename Keys>
+    set erase_many_move(std::false_type, const Keys& keys)
+    {
+        using std::begin;
+        using std::end;
+        return impl_.sub_batch(begin(keys), end(keys));
+    }
+
+    template <typename Pred>
+    set&& erase_if_move(std::true_type, Pred& pred)
+    {
+        impl_.filter_mut({}, keep_unless(pred));
+        return std::move(*this);
+    }
+    template <typename Pred>
+    set erase_if_move(std::false_type, Pred& pred)
+    {
+        return impl_.filter(keep_unless(pred));
+    }
+
+    template <typename Pred>
+    static auto keep_unless(Pred& pred)
+    {
+        return [&pred](const T& v) { return !pred(v); };
+    }
 
     impl_t impl_ = impl_t::empty();
 };
 
+// A set only holds its size and a pointer to its root.
+template <typename T,
+          typename Hash,
+          typename Equal,
+          typename MP,
+          detail::hamts::bits_t B>
+struct is_trivially_relocatable<set<T, Hash, Equal, MP, B>> : std::true_type
+{};
+
 } // namespace immer
@@ -8,8 +8,10 @@
 
 #pragma once
 
+#include <immer/container_hash.hpp>
 #include <immer/detail/hamts/champ.hpp>
 #include <immer/memory_policy.hpp>
+#include <immer/trace.hpp>
 
 #include <functional>
 
@@ -26,7 +28,7 @@ namespace immer {
  * @endrst
  */
 template <typename T,
-          typename Hash           = std::hash<T>,
+          typename Hash           = container_hash<T>,
           typename Equal          = std::equal_to<T>,
           typename MemoryPolicy   = default_memory_policy,
           detail::hamts::bits_t B = default_bits>
@@ -141,6 +143,17 @@ public:
                                   detail::constantly<const T*, nullptr>>(value);
     }
 
+    /*!
+     * Like `find`, but `hash` is used as the hash of `value` instead of
+     * computing it, thus it must be `hasher{}(value)`.
+     */
+    IMMER_NODISCARD const T* find_hashed(const T& value, std::size_t hash) const
+    {
+        return impl_.template get<typename persistent_type::project_value_ptr,
+                                  detail::constantly<const T*, nullptr>>(
+            value, hash);
+    }
+
     /*!
      * Inserts `value` into the set, and does nothing if the value is already
      * there  It may allocate memory and its complexity is *effectively* @f$
@@ -148,6 +161,15 @@ public:
      */
     void insert(T value) { impl_.add_mut(*this, std::move(value)); }
 
+    /*!
+     * Like `insert`, but `hash` is used as the hash of `value`, thus it
+     * must be `hasher{}(value)`.
+     */
+    void insert_hashed(T value, std::size_t hash)
+    {
+        impl_.add_mut(*this, std::move(value), hash);
+    }
+
     /*!
      * Removes the `value` from the set, doing nothing if the value is not in
      * the set.  It may allocate memory and its complexity is *effectively* @f$
@@ -155,16 +177,47 @@ public:
      */
     void erase(const T& value) { impl_.sub_mut(*this, value); }
 
+    /*!
+     * Removes all the values in the range `values`, which must yield
+     * references to them and can be traversed more than once.  Every
+     * node where some of them fall is visited only once.  Its
+     * complexity is *effectively* @f$ O(n \log n) @f$ where @f$ n @f$ is
+     * the number of values.
+     */
+    template <typename Keys>
+    void erase_many(const Keys& values)
+    {
+        using std::begin;
+        using std::end;
+        impl_.sub_batch_mut(*this, begin(values), end(values));
+    }
+
+    /*!
+     * Removes the values for which `pred(x)` returns `true`, in one
+     * traversal that keeps the subtrees where nothing is erased.  Its
+     * complexity is @f$ O(n) @f$.
+     */
+    template <typename Pred>
+    void erase_if(Pred&& pred)
+    {
+        impl_.filter_mut(*this, persistent_type::keep_unless(pred));
+    }
+
     /*!
      * Returns an @a immutable form of this container, an
      * `immer::set`.
      */
     IMMER_NODISCARD persistent_type persistent() &
     {
+        IMMER_TRACE_HOOK(persistent, impl_.size);
         this->owner_t::operator=(owner_t{});
         return impl_;
     }
-    IMMER_NODISCARD persistent_type persistent() && { return std::move(impl_); }
+    IMMER_NODISCARD persistent_type persistent() &&
+    {
+        IMMER_TRACE_HOOK(persistent, impl_.size);
+        return std::move(impl_);
+    }
 
 private:
     friend persistent_type;
@@ -174,6 +227,14 @@ private:
         : impl_(std::move(impl))
     {}
 
+    template <typename MP>
+    friend class edit_session;
+
+    set_transient(impl_t impl, owner_t owner)
+        : owner_t(std::move(owner))
+        , impl_(std::move(impl))
+    {}
+
     impl_t impl_ = impl_t::empty();
 
 public:
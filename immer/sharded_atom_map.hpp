@@ -0,0 +1,258 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/atom.hpp>
+#include <immer/config.hpp>
+#include <immer/map.hpp>
+#include <immer/tuning.hpp>
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+namespace immer {
+
+/*!
+ * Concurrent dictionary from keys of type `K` to values of type `T`,
+ * made of `N` independent shards.  Every shard is an `atom` holding
+ * an immutable ``map``, and a key always goes to the shard chosen by
+ * its hash.  Thus, writers to different shards do not contend, and
+ * writes scale with the number of shards, while readers still get
+ * cheap immutable snapshots.
+ *
+ * @tparam N The number of shards.  It must be a power of two.
+ *
+ * @tparam ReclamationPolicy Passed to the `atom` of every shard.
+ *
+ * @rst
+ *
+ * .. note:: The shard is taken from the top bits of the hash after a
+ *    Fibonacci multiplication, which spreads identity-like hashes such
+ *    as ``std::hash<int>`` too.  The maps index their first level with
+ *    the bottom bits of the hash, which are left unconstrained.
+ *
+ * @endrst
+ */
+template <typename K,
+          typename T,
+          std::size_t N              = 16,
+          typename Hash              = std::hash<K>,
+          typename Equal             = std::equal_to<K>,
+          typename MemoryPolicy      = default_memory_policy,
+          typename ReclamationPolicy = lock_reclamation_policy>
+class sharded_atom_map
+{
+    static_assert(N > 0 && (N & (N - 1)) == 0,
+                  "the number of shards must be a power of two");
+
+public:
+    using key_type           = K;
+    using mapped_type        = T;
+    using value_type         = std::pair<K, T>;
+    using size_type          = std::size_t;
+    using hasher             = Hash;
+    using key_equal          = Equal;
+    using memory_policy      = MemoryPolicy;
+    using reclamation_policy = ReclamationPolicy;
+
+    using map_type  = map<K, T, Hash, Equal, MemoryPolicy>;
+    using atom_type = atom<map_type, MemoryPolicy, ReclamationPolicy>;
+    using box_type  = typename atom_type::box_type;
+
+    /*!
+     * The number of shards.
+     */
+    static constexpr std::size_t shard_count = N;
+
+    /*!
+     * An immutable view of the whole dictionary at one point in time,
+     * as returned by `snapshot()`.  It holds the map of every shard.
+     */
+    class snapshot_type
+    {
+    public:
+        /*!
+         * Returns a pointer to the value associated with `k`, or
+         * `nullptr` when it is not there.  The pointer is valid as
+         * long as the snapshot lives.
+         */
+        IMMER_NODISCARD const T* find(const K& k) const
+        {
+            auto hash = Hash{}(k);
+            return shards_[shard_index(hash)].find_hashed(k, hash);
+        }
+
+        /*!
+         * Returns `1` when the key `k` is contained and `0` otherwise.
+         */
+        IMMER_NODISCARD size_type count(const K& k) const
+        {
+            return find(k) ? 1 : 0;
+        }
+
+        /*!
+         * Returns the number of associations over all the shards.
+         */
+        IMMER_NODISCARD size_type size() const
+        {
+            auto r = size_type{};
+            for (auto&& m : shards_)
+                r += m.size();
+            return r;
+        }
+
+        /*!
+         * Returns the map of the `i`-th shard.
+         */
+        IMMER_NODISCARD const map_type& shard(std::size_t i) const
+        {
+            return shards_[i];
+        }
+
+    private:
+        friend sharded_atom_map;
+        std::array<map_type, N> shards_;
+    };
+
+    sharded_atom_map() = default;
+
+    sharded_atom_map(const sharded_atom_map&) = delete;
+    sharded_atom_map(sharded_atom_map&&)      = delete;
+    void operator=(const sharded_atom_map&) = delete;
+    void operator=(sharded_atom_map&&) = delete;
+
+    /*!
+     * Returns the index of the shard that holds the keys with the
+     * given `hash`.
+     */
+    static constexpr std::size_t shard_index(std::size_t hash)
+    {
+        return N == 1 ? 0
+                      : (hash * fibonacci) >>
+                            (sizeof(std::size_t) * 8 - shard_bits);
+    }
+
+    /*!
+     * Returns the value associated with `k`, or a default constructed
+     * value when it is not there, in a thread-safe manner.
+     */
+    IMMER_NODISCARD T get(const K& k) const
+    {
+        auto hash = Hash{}(k);
+        auto m    = shards_[shard_index(hash)].atom.load();
+        auto p    = m->find_hashed(k, hash);
+        return p ? *p : T{};
+    }
+
+    /*!
+     * Returns `1` when the key `k` is contained and `0` otherwise.
+     */
+    IMMER_NODISCARD size_type count(const K& k) const
+    {
+        auto hash = Hash{}(k);
+        auto m    = shards_[shard_index(hash)].atom.load();
+        return m->find_hashed(k, hash) ? 1 : 0;
+    }
+
+    /*!
+     * Associates `v` with the key `k`, replacing the previous value if
+     * any, in a thread-safe manner.
+     */
+    void set(K k, T v)
+    {
+        auto hash = Hash{}(k);
+        shards_[shard_index(hash)].atom.update([&](const map_type& m) {
+            return m.insert_hashed({k, v}, hash);
+        });
+    }
+
+    /*!
+     * Replaces the value `v` associated with `k`, or a default
+     * constructed one, with `fn(v)`, atomically.  Like with
+     * `atom::update`, `fn` must have no side effects since it may be
+     * evaluated more than once.
+     */
+    template <typename Fn>
+    void update(K k, Fn&& fn)
+    {
+        auto hash = Hash{}(k);
+        shards_[shard_index(hash)].atom.update([&](const map_type& m) {
+            return m.update_hashed(k, hash, fn);
+        });
+    }
+
+    /*!
+     * Removes the association of the key `k`, if any, in a thread-safe
+     * manner.
+     */
+    void erase(const K& k)
+    {
+        auto hash = Hash{}(k);
+        shards_[shard_index(hash)].atom.update(
+            [&](const map_type& m) { return m.erase(k); });
+    }
+
+    /*!
+     * Returns the map of the `i`-th shard.
+     */
+    IMMER_NODISCARD box_type load_shard(std::size_t i) const
+    {
+        return shards_[i].atom.load();
+    }
+
+    /*!
+     * Returns a consistent snapshot of all the shards: there is a
+     * point in time at which every shard held the map in the
+     * snapshot.  The shards are loaded twice and the snapshot is
+     * taken when no shard changed in between.  The maps loaded first
+     * are kept alive meanwhile, so a shard that holds the same map in
+     * both rounds did not change.  Under heavy writing it may take a
+     * few rounds, but it never blocks the writers.
+     */
+    IMMER_NODISCARD snapshot_type snapshot() const
+    {
+        auto r = snapshot_type{};
+        load_all(r.shards_);
+        while (true) {
+            auto again = snapshot_type{};
+            load_all(again.shards_);
+            auto same = true;
+            for (auto i = std::size_t{}; i < N; ++i)
+                same = same &&
+                       r.shards_[i].identity() == again.shards_[i].identity();
+            if (same)
+                return r;
+            r = std::move(again);
+        }
+    }
+
+private:
+    static constexpr auto shard_bits = detail::floor_log2(N);
+    static constexpr auto fibonacci  = static_cast<std::size_t>(
+        sizeof(std::size_t) == 8 ? 0x9e3779b97f4a7c15ull : 0x9e3779b9ull);
+
+    void load_all(std::array<map_type, N>& maps) const
+    {
+        for (auto i = std::size_t{}; i < N; ++i)
+            maps[i] = shards_[i].atom.load().get();
+    }
+
+    // every atom in its own cache line, so that the writers to
+    // different shards do not contend through false sharing
+    struct alignas(64) shard_t
+    {
+        atom_type atom;
+    };
+
+    std::array<shard_t, N> shards_;
+};
+
+} // namespace immer
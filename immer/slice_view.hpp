@@ -0,0 +1,271 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/rbts/bits.hpp>
+
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace immer {
+
+template <typename T,
+          typename MP,
+          detail::rbts::bits_t B,
+          detail::rbts::bits_t BL>
+class flex_vector;
+
+namespace detail {
+
+/*!
+ * The implementation that a `slice_view` exposes to the algorithms:
+ * the traversals of the tree restricted to the range of the view.
+ */
+template <typename Tree>
+struct slice_impl
+{
+    const Tree* tree;
+    std::size_t first;
+    std::size_t last;
+
+    template <typename Fn>
+    void for_each_chunk(Fn&& fn) const
+    {
+        tree->for_each_chunk(first, last, std::forward<Fn>(fn));
+    }
+
+    template <typename Fn>
+    void for_each_chunk(std::size_t f, std::size_t l, Fn&& fn) const
+    {
+        tree->for_each_chunk(first + f, first + l, std::forward<Fn>(fn));
+    }
+
+    template <typename Fn>
+    bool for_each_chunk_p(Fn&& fn) const
+    {
+        return tree->for_each_chunk_p(first, last, std::forward<Fn>(fn));
+    }
+
+    template <typename Fn>
+    bool for_each_chunk_p(std::size_t f, std::size_t l, Fn&& fn) const
+    {
+        return tree->for_each_chunk_p(
+            first + f, first + l, std::forward<Fn>(fn));
+    }
+};
+
+template <typename Vector>
+Vector materialize_slice(const Vector& v, std::size_t first, std::size_t last)
+{
+    return first == 0 ? v.take(last)
+                      : Vector(std::next(v.begin(), first),
+                               std::next(v.begin(), last));
+}
+
+template <typename T,
+          typename MP,
+          detail::rbts::bits_t B,
+          detail::rbts::bits_t BL>
+flex_vector<T, MP, B, BL> materialize_slice(
+    const flex_vector<T, MP, B, BL>& v, std::size_t first, std::size_t last)
+{
+    return v.drop(first).take(last - first);
+}
+
+} // namespace detail
+
+/*!
+ * Read-only view of the elements of a ``vector`` or ``flex_vector`` of
+ * type `Vector` in the range `[first, last)`.
+ *
+ * It keeps the vector alive, holding a reference to its root and
+ * tail, together with the bounds of the range.  Thus, unlike `take`
+ * and `drop`, a view never allocates memory and it is created, copied
+ * and sliced further in @f$ O(1) @f$.  It works with the
+ * :doc:`algorithms <algorithms>`, that visit only the leaves in its
+ * range, and it can be turned into a container of its own with
+ * `materialize()` when needed.
+ *
+ * @rst
+ *
+ * .. note:: The view keeps all the elements of the vector alive, not
+ *    only the ones in its range.  Materialize small views of big
+ *    vectors that are kept around for long.
+ *
+ * @endrst
+ */
+template <typename Vector>
+class slice_view
+{
+    using impl_t = detail::slice_impl<
+        std::decay_t<decltype(std::declval<const Vector&>().impl())>>;
+
+public:
+    using vector_type     = Vector;
+    using value_type      = typename Vector::value_type;
+    using reference       = typename Vector::reference;
+    using size_type       = typename Vector::size_type;
+    using difference_type = typename Vector::difference_type;
+    using const_reference = typename Vector::const_reference;
+
+    using iterator         = typename Vector::iterator;
+    using const_iterator   = iterator;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+
+    /*!
+     * Default constructor.  It creates an empty view.
+     */
+    slice_view() = default;
+
+    /*!
+     * Constructs a view of all the elements of `v`.
+     */
+    slice_view(Vector v)
+        : v_{std::move(v)}
+        , first_{0}
+        , last_{v_.size()}
+    {}
+
+    /*!
+     * Constructs a view of the elements of `v` in `[first, last)`,
+     * which must be a valid range of indices.
+     */
+    slice_view(Vector v, size_type first, size_type last)
+        : v_{std::move(v)}
+        , first_{first}
+        , last_{last}
+    {
+        assert(first <= last && last <= v_.size());
+    }
+
+    /*!
+     * Returns an iterator pointing at the first element of the view.
+     * The iterators are those of the vector, thus they can be passed
+     * to the algorithms too.
+     */
+    IMMER_NODISCARD iterator begin() const
+    {
+        return std::next(v_.begin(), first_);
+    }
+
+    /*!
+     * Returns an iterator pointing just after the last element of the
+     * view.
+     */
+    IMMER_NODISCARD iterator end() const
+    {
+        return std::next(v_.begin(), last_);
+    }
+
+    /*!
+     * Returns an iterator that traverses the view backwards, pointing
+     * at the last element.
+     */
+    IMMER_NODISCARD reverse_iterator rbegin() const
+    {
+        return reverse_iterator{end()};
+    }
+
+    /*!
+     * Returns an iterator that traverses the view backwards, pointing
+     * before the first element.
+     */
+    IMMER_NODISCARD reverse_iterator rend() const
+    {
+        return reverse_iterator{begin()};
+    }
+
+    /*!
+     * Returns the number of elements in the view.
+     */
+    IMMER_NODISCARD size_type size() const { return last_ - first_; }
+
+    /*!
+     * Returns `true` if there are no elements in the view.
+     */
+    IMMER_NODISCARD bool empty() const { return first_ == last_; }
+
+    /*!
+     * Access the first element.
+     */
+    IMMER_NODISCARD const value_type& front() const { return v_[first_]; }
+
+    /*!
+     * Access the last element.
+     */
+    IMMER_NODISCARD const value_type& back() const { return v_[last_ - 1]; }
+
+    /*!
+     * Returns a `const` reference to the element at position `index`
+     * of the view.  It is undefined when @f$ index \geq size() @f$.
+     */
+    IMMER_NODISCARD reference operator[](size_type index) const
+    {
+        return v_[first_ + index];
+    }
+
+    /*!
+     * Returns a `const` reference to the element at position `index`
+     * of the view.  It throws an `std::out_of_range` exception when
+     * @f$ index \geq size() @f$.
+     */
+    reference at(size_type index) const
+    {
+        if (index >= size())
+            IMMER_THROW(std::out_of_range{"index out of range"});
+        return v_[first_ + index];
+    }
+
+    /*!
+     * Returns a view of the elements of this one in `[first, last)`,
+     * which must be a valid range of indices of this view.  It does
+     * not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD slice_view slice(size_type first, size_type last) const&
+    {
+        assert(first <= last && last <= size());
+        return {v_, first_ + first, first_ + last};
+    }
+    IMMER_NODISCARD slice_view slice(size_type first, size_type last) &&
+    {
+        assert(first <= last && last <= size());
+        return {std::move(v_), first_ + first, first_ + last};
+    }
+
+    /*!
+     * Returns a vector with the elements of the view.  The
+     * ``flex_vector`` ones are sliced with `drop` and `take`, and for
+     * ``vector`` only leading views share the structure, the rest are
+     * copied.
+     */
+    IMMER_NODISCARD Vector materialize() const
+    {
+        return detail::materialize_slice(v_, first_, last_);
+    }
+
+    /*!
+     * Returns the vector that the view looks into.
+     */
+    IMMER_NODISCARD const Vector& vector() const { return v_; }
+
+    // Semi-private
+    impl_t impl() const { return {&v_.impl(), first_, last_}; }
+
+private:
+    Vector v_;
+    size_type first_ = 0;
+    size_type last_  = 0;
+};
+
+} // namespace immer
@@ -0,0 +1,549 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/array.hpp>
+#include <immer/config.hpp>
+#include <immer/detail/iterator_facade.hpp>
+#include <immer/map.hpp>
+#include <immer/map_transient.hpp>
+#include <immer/memory_policy.hpp>
+#include <immer/set.hpp>
+#include <immer/set_transient.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+namespace immer {
+
+namespace detail {
+namespace small {
+
+// Iterates either over the inline array or over the trie, depending on
+// which one holds the values of the container.
+template <typename T, typename BigIterator>
+struct iterator
+    : iterator_facade<iterator<T, BigIterator>,
+                      std::forward_iterator_tag,
+                      T,
+                      const T&,
+                      std::ptrdiff_t,
+                      const T*>
+{
+    iterator() = default;
+
+    iterator(const T* ptr)
+        : ptr_{ptr}
+    {}
+
+    iterator(BigIterator it)
+        : it_{it}
+        , big_{true}
+    {}
+
+private:
+    friend iterator_core_access;
+
+    const T* ptr_ = nullptr;
+    BigIterator it_{};
+    bool big_ = false;
+
+    void increment()
+    {
+        if (big_)
+            ++it_;
+        else
+            ++ptr_;
+    }
+
+    bool equal(const iterator& other) const
+    {
+        return big_ ? it_ == other.it_ : ptr_ == other.ptr_;
+    }
+
+    const T& dereference() const { return big_ ? *it_ : *ptr_; }
+};
+
+} // namespace small
+} // namespace detail
+
+/*!
+ * Immutable unordered mapping of values from type `K` to type `T`,
+ * that stores up to `N` entries inline in a flat array and switches to
+ * a @ref map when it grows beyond that.
+ *
+ * @tparam K    The type of the keys.
+ * @tparam T    The type of the values to be stored in the container.
+ * @tparam N    The number of entries that are stored inline.
+ * @tparam Hash The type of a function object capable of hashing
+ *              values of type `K`.
+ * @tparam Equal The type of a function object capable of comparing
+ *              values of type `K`.
+ * @tparam MemoryPolicy Memory management policy. See @ref
+ *              memory_policy.
+ *
+ * A small map takes a single allocation of exactly its size, and its
+ * lookups compare the keys one after the other without hashing them.
+ * This makes it smaller and faster than a @ref map for the many maps
+ * that only hold a handful of entries, like the attributes of an
+ * object.  Once it holds more than `N` entries all operations are
+ * those of the @ref map, and it only goes back to the inline array
+ * when it shrinks to `N / 2` entries.
+ *
+ * @rst
+ *
+ * .. note:: Updating an inline entry copies the whole array, thus the
+ *    updates are @f$ O(N) @f$ while the map is small.  Pick a small
+ *    ``N``, the default is meant for keys that are cheap to compare.
+ *
+ * @endrst
+ */
+template <typename K,
+          typename T,
+          std::size_t N           = 8,
+          typename Hash           = std::hash<K>,
+          typename Equal          = std::equal_to<K>,
+          typename MemoryPolicy   = default_memory_policy,
+          detail::hamts::bits_t B = default_bits>
+class small_map
+{
+    using map_t   = map<K, T, Hash, Equal, MemoryPolicy, B>;
+    using array_t = array<std::pair<K, T>, MemoryPolicy>;
+
+public:
+    using key_type        = K;
+    using mapped_type     = T;
+    using value_type      = std::pair<K, T>;
+    using size_type       = detail::hamts::size_t;
+    using difference_type = std::ptrdiff_t;
+    using hasher          = Hash;
+    using key_equal       = Equal;
+    using reference       = const value_type&;
+    using const_reference = const value_type&;
+
+    using iterator =
+        detail::small::iterator<value_type, typename map_t::iterator>;
+    using const_iterator = iterator;
+
+    using memory_policy_type = MemoryPolicy;
+
+    /*!
+     * Default constructor.  It creates a map of `size() == 0`.  It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    small_map() = default;
+
+    /*!
+     * Constructs a map containing the elements in `values`.
+     */
+    small_map(std::initializer_list<value_type> values)
+    {
+        for (auto&& v : values)
+            *this = std::move(*this).insert(v);
+    }
+
+    /*!
+     * Returns an iterator pointing at the first element of the
+     * collection. It does not allocate memory and its complexity is
+     * @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD iterator begin() const
+    {
+        return is_small() ? iterator{small_.begin()} : iterator{big_.begin()};
+    }
+
+    /*!
+     * Returns an iterator pointing just after the last element of the
+     * collection. It does not allocate and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD iterator end() const
+    {
+        return is_small() ? iterator{small_.end()} : iterator{big_.end()};
+    }
+
+    /*!
+     * Returns the number of elements in the container.  It does
+     * not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD size_type size() const
+    {
+        return is_small() ? small_.size() : big_.size();
+    }
+
+    /*!
+     * Returns `true` if there are no elements in the container.  It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD bool empty() const { return size() == 0; }
+
+    /*!
+     * Returns whether the entries are stored inline, that is, whether
+     * the map holds no more than `N` of them.
+     */
+    IMMER_NODISCARD bool is_small() const { return big_.empty(); }
+
+    /*!
+     * Returns `1` when the key `k` is contained in the map or `0`
+     * otherwise.  Its complexity is @f$ O(N) @f$ while the map is small
+     * and *effectively* @f$ O(1) @f$ otherwise.
+     */
+    IMMER_NODISCARD size_type count(const K& k) const
+    {
+        return find(k) ? 1 : 0;
+    }
+
+    /*!
+     * Returns a `const` reference to the values associated to the key
+     * `k`.  If the key is not contained in the map, it returns a
+     * default constructed value.
+     */
+    IMMER_NODISCARD const T& operator[](const K& k) const
+    {
+        static const auto empty = T{};
+        auto p                  = find(k);
+        return p ? *p : empty;
+    }
+
+    /*!
+     * Returns a `const` reference to the values associated to the key
+     * `k`.  If the key is not contained in the map, throws an
+     * `std::out_of_range` error.
+     */
+    const T& at(const K& k) const
+    {
+        auto p = find(k);
+        if (!p)
+            IMMER_THROW(std::out_of_range{"key not found"});
+        return *p;
+    }
+
+    /*!
+     * Returns a pointer to the value associated with the key `k`.  If
+     * the key is not contained in the map, a `nullptr` is returned.
+     */
+    IMMER_NODISCARD const T* find(const K& k) const
+    {
+        if (!is_small())
+            return big_.find(k);
+        auto i = index_of(k);
+        return i < small_.size() ? &small_[i].second : nullptr;
+    }
+
+    /*!
+     * Returns whether the maps hold the same entries, regardless of
+     * how they store them.
+     */
+    IMMER_NODISCARD bool operator==(const small_map& other) const
+    {
+        if (!is_small() && !other.is_small())
+            return big_ == other.big_;
+        if (size() != other.size())
+            return false;
+        for (auto&& x : *this) {
+            auto p = other.find(x.first);
+            if (!p || !(*p == x.second))
+                return false;
+        }
+        return true;
+    }
+    IMMER_NODISCARD bool operator!=(const small_map& other) const
+    {
+        return !(*this == other);
+    }
+
+    /*!
+     * Returns a map containing the association `value`.  If the key is
+     * already in the map, it replaces its association in the map.  When
+     * the map already holds `N` entries inline, they are moved to a
+     * @ref map.
+     */
+    IMMER_NODISCARD small_map insert(value_type value) const
+    {
+        if (!is_small())
+            return {{}, big_.insert(std::move(value))};
+        auto i = index_of(value.first);
+        if (i < small_.size())
+            return {small_.set(i, std::move(value)), {}};
+        if (small_.size() < N)
+            return {small_.push_back(std::move(value)), {}};
+        auto m = typename map_t::transient_type{};
+        for (auto&& x : small_)
+            m.insert(x);
+        m.insert(std::move(value));
+        return {{}, m.persistent()};
+    }
+
+    /*!
+     * Returns a map containing the association `(k, v)`.  If the key is
+     * already in the map, it replaces its association in the map.
+     */
+    IMMER_NODISCARD small_map set(key_type k, mapped_type v) const
+    {
+        return insert({std::move(k), std::move(v)});
+    }
+
+    /*!
+     * Returns a map replacing the association `(k, v)` by the new
+     * association `(k, fn(v))`, where `v` is the
+     * currently associated value for `k` in the map or a default
+     * constructed value otherwise.
+     */
+    template <typename Fn>
+    IMMER_NODISCARD small_map update(key_type k, Fn&& fn) const
+    {
+        if (!is_small())
+            return {{}, big_.update(std::move(k), std::forward<Fn>(fn))};
+        auto i = index_of(k);
+        if (i < small_.size())
+            return {small_.set(i, {std::move(k), fn(small_[i].second)}), {}};
+        auto v = fn(T{});
+        return insert({std::move(k), std::move(v)});
+    }
+
+    /*!
+     * Returns a map without the key `k`.  If the key is not associated
+     * in the map it returns the same map.  A map that holds its entries
+     * in a @ref map moves them back inline once it has `N / 2` of them.
+     */
+    IMMER_NODISCARD small_map erase(const K& k) const
+    {
+        if (!is_small()) {
+            auto m = big_.erase(k);
+            if (m.size() > N / 2)
+                return {{}, std::move(m)};
+            return {array_t(m.begin(), m.end()), {}};
+        }
+        auto i = index_of(k);
+        if (i == small_.size())
+            return *this;
+        // the order of the entries does not matter, thus the last one
+        // takes the place of the erased one
+        return {small_.set(i, small_.back()).take(small_.size() - 1), {}};
+    }
+
+private:
+    small_map(array_t small, map_t big)
+        : small_{std::move(small)}
+        , big_{std::move(big)}
+    {}
+
+    std::size_t index_of(const K& k) const
+    {
+        auto data = small_.data();
+        auto size = small_.size();
+        auto i    = std::size_t{};
+        while (i < size && !Equal{}(data[i].first, k))
+            ++i;
+        return i;
+    }
+
+    array_t small_;
+    map_t big_;
+};
+
+/*!
+ * Immutable set of values of type `T`, that stores up to `N` of them
+ * inline in a flat array and switches to a @ref set when it grows
+ * beyond that.
+ *
+ * @tparam T    The type of the values to be stored in the container.
+ * @tparam N    The number of values that are stored inline.
+ * @tparam Hash The type of a function object capable of hashing
+ *              values of type `T`.
+ * @tparam Equal The type of a function object capable of comparing
+ *              values of type `T`.
+ * @tparam MemoryPolicy Memory management policy. See @ref
+ *              memory_policy.
+ *
+ * It is the set counterpart of @ref small_map, see its documentation
+ * for the details.
+ */
+template <typename T,
+          std::size_t N           = 8,
+          typename Hash           = std::hash<T>,
+          typename Equal          = std::equal_to<T>,
+          typename MemoryPolicy   = default_memory_policy,
+          detail::hamts::bits_t B = default_bits>
+class small_set
+{
+    using set_t   = set<T, Hash, Equal, MemoryPolicy, B>;
+    using array_t = array<T, MemoryPolicy>;
+
+public:
+    using value_type      = T;
+    using size_type       = detail::hamts::size_t;
+    using difference_type = std::ptrdiff_t;
+    using hasher          = Hash;
+    using key_equal       = Equal;
+    using reference       = const T&;
+    using const_reference = const T&;
+
+    using iterator = detail::small::iterator<T, typename set_t::iterator>;
+    using const_iterator = iterator;
+
+    using memory_policy_type = MemoryPolicy;
+
+    /*!
+     * Default constructor.  It creates a set of `size() == 0`.  It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    small_set() = default;
+
+    /*!
+     * Constructs a set containing the elements in `values`.
+     */
+    small_set(std::initializer_list<value_type> values)
+    {
+        for (auto&& v : values)
+            *this = std::move(*this).insert(v);
+    }
+
+    /*!
+     * Returns an iterator pointing at the first element of the
+     * collection. It does not allocate memory and its complexity is
+     * @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD iterator begin() const
+    {
+        return is_small() ? iterator{small_.begin()} : iterator{big_.begin()};
+    }
+
+    /*!
+     * Returns an iterator pointing just after the last element of the
+     * collection. It does not allocate and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD iterator end() const
+    {
+        return is_small() ? iterator{small_.end()} : iterator{big_.end()};
+    }
+
+    /*!
+     * Returns the number of elements in the container.  It does
+     * not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD size_type size() const
+    {
+        return is_small() ? small_.size() : big_.size();
+    }
+
+    /*!
+     * Returns `true` if there are no elements in the container.  It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD bool empty() const { return size() == 0; }
+
+    /*!
+     * Returns whether the values are stored inline, that is, whether
+     * the set holds no more than `N` of them.
+     */
+    IMMER_NODISCARD bool is_small() const { return big_.empty(); }
+
+    /*!
+     * Returns `1` when `value` is contained in the set or `0`
+     * otherwise.
+     */
+    IMMER_NODISCARD size_type count(const T& value) const
+    {
+        return find(value) ? 1 : 0;
+    }
+
+    /*!
+     * Returns a pointer to the value if `value` is contained in the
+     * set, or nullptr otherwise.
+     */
+    IMMER_NODISCARD const T* find(const T& value) const
+    {
+        if (!is_small())
+            return big_.find(value);
+        auto i = index_of(value);
+        return i < small_.size() ? &small_[i] : nullptr;
+    }
+
+    /*!
+     * Returns whether the sets hold the same values, regardless of how
+     * they store them.
+     */
+    IMMER_NODISCARD bool operator==(const small_set& other) const
+    {
+        if (!is_small() && !other.is_small())
+            return big_ == other.big_;
+        if (size() != other.size())
+            return false;
+        for (auto&& x : *this)
+            if (!other.find(x))
+                return false;
+        return true;
+    }
+    IMMER_NODISCARD bool operator!=(const small_set& other) const
+    {
+        return !(*this == other);
+    }
+
+    /*!
+     * Returns a set containing `value`.  If the `value` is already in
+     * the set, it returns the same set.  When the set already holds
+     * `N` values inline, they are moved to a @ref set.
+     */
+    IMMER_NODISCARD small_set insert(T value) const
+    {
+        if (!is_small())
+            return {{}, big_.insert(std::move(value))};
+        if (index_of(value) < small_.size())
+            return *this;
+        if (small_.size() < N)
+            return {small_.push_back(std::move(value)), {}};
+        auto s = typename set_t::transient_type{};
+        for (auto&& x : small_)
+            s.insert(x);
+        s.insert(std::move(value));
+        return {{}, s.persistent()};
+    }
+
+    /*!
+     * Returns a set without `value`.  A set that holds its values in a
+     * @ref set moves them back inline once it has `N / 2` of them.
+     */
+    IMMER_NODISCARD small_set erase(const T& value) const
+    {
+        if (!is_small()) {
+            auto s = big_.erase(value);
+            if (s.size() > N / 2)
+                return {{}, std::move(s)};
+            return {array_t(s.begin(), s.end()), {}};
+        }
+        auto i = index_of(value);
+        if (i == small_.size())
+            return *this;
+        return {small_.set(i, small_.back()).take(small_.size() - 1), {}};
+    }
+
+private:
+    small_set(array_t small, set_t big)
+        : small_{std::move(small)}
+        , big_{std::move(big)}
+    {}
+
+    std::size_t index_of(const T& value) const
+    {
+        auto data = small_.data();
+        auto size = small_.size();
+        auto i    = std::size_t{};
+        while (i < size && !Equal{}(data[i], value))
+            ++i;
+        return i;
+    }
+
+    array_t small_;
+    set_t big_;
+};
+
+} // namespace immer
@@ -0,0 +1,320 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace immer {
+
+namespace detail {
+
+/*!
+ * The state shared by the readers and writers of a publisher.  Every
+ * thread that reads gets a record where it announces the epoch at
+ * which it entered its critical section.  The records are never
+ * unlinked while the domain lives, and a thread gives its record back
+ * when it exits, so that another thread can take it.
+ */
+struct rcu_domain
+{
+    static constexpr auto idle = std::numeric_limits<std::uint64_t>::max();
+
+    struct record
+    {
+        std::atomic<std::uint64_t> epoch{idle};
+        std::atomic<bool> taken{true};
+        std::size_t nesting = 0;
+        std::shared_ptr<record> next;
+    };
+
+    std::atomic<std::uint64_t> epoch{0};
+    std::shared_ptr<record> records;
+    std::mutex records_mtx;
+    const std::uint64_t id = next_id();
+
+    static std::uint64_t next_id()
+    {
+        static std::atomic<std::uint64_t> ids{0};
+        return ++ids;
+    }
+
+    // the lowest epoch at which a reader entered its critical section
+    std::uint64_t min_active()
+    {
+        auto r = idle;
+        std::lock_guard<std::mutex> lock{records_mtx};
+        for (auto p = records.get(); p; p = p->next.get())
+            r = std::min(r, p->epoch.load());
+        return r;
+    }
+
+    std::shared_ptr<record> acquire()
+    {
+        std::lock_guard<std::mutex> lock{records_mtx};
+        for (auto p = records; p; p = p->next) {
+            auto expected = false;
+            if (p->taken.compare_exchange_strong(expected, true))
+                return p;
+        }
+        auto p  = std::make_shared<record>();
+        p->next = records;
+        records = p;
+        return p;
+    }
+};
+
+/*!
+ * The records of the calling thread, for the domains in which it has
+ * read.  They are looked up by the identifier of the domain, that is
+ * never reused, so an entry of a dead domain is never matched, and
+ * those entries are dropped whenever a new one is added.
+ */
+struct rcu_thread_records
+{
+    struct entry
+    {
+        std::uint64_t id;
+        std::weak_ptr<rcu_domain> domain;
+        std::shared_ptr<rcu_domain::record> rec;
+    };
+
+    std::vector<entry> entries;
+
+    ~rcu_thread_records()
+    {
+        for (auto& e : entries)
+            e.rec->taken.store(false, std::memory_order_release);
+    }
+
+    static rcu_domain::record& get(const std::shared_ptr<rcu_domain>& d)
+    {
+        static thread_local rcu_thread_records self;
+        for (auto& e : self.entries)
+            if (e.id == d->id)
+                return *e.rec;
+        auto& es = self.entries;
+        es.erase(std::remove_if(es.begin(),
+                                es.end(),
+                                [](auto& e) { return e.domain.expired(); }),
+                 es.end());
+        es.push_back({d->id, d, d->acquire()});
+        return *es.back().rec;
+    }
+};
+
+} // namespace detail
+
+/*!
+ * Publishes successive versions of a value of type `T`, usually a big
+ * container, to many reader threads, in the style of *read-copy-update*.
+ * Readers enter a read-side critical section with `read()` and access
+ * the current version through a reference, without touching the
+ * reference counts of the container.  When a writer publishes a new
+ * version, the old one is destroyed once all the readers that could
+ * have seen it have left their critical sections, a *grace period*.
+ *
+ * The containers need no special memory policy: the versions are
+ * regular values that the publisher keeps alive on behalf of the
+ * readers.  To keep a version after the critical section, copy it,
+ * for example with `load()`.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    immer::snapshot_publisher<immer::map<int, int>> p;
+ *    // readers
+ *    {
+ *        auto r = p.read();
+ *        auto x = r->find(42);
+ *    }
+ *    // writer
+ *    p.update([](auto m) { return m.set(42, 0); });
+ *
+ * .. note:: A read-side critical section only writes to a record owned
+ *    by the reading thread, so readers do not contend.  Writers are
+ *    serialized, and every publication scans the records of the
+ *    readers to destroy the versions whose grace period is over.
+ *    Critical sections can be nested, but they should be short,
+ *    since the publications that happen meanwhile are kept alive.
+ *
+ * @endrst
+ */
+template <typename T>
+class snapshot_publisher
+{
+    struct version
+    {
+        T value;
+        std::uint64_t retired_at = 0;
+    };
+
+public:
+    using value_type = T;
+
+    /*!
+     * A read-side critical section.  It gives access to the version
+     * that was current when it was entered, which stays alive until it
+     * is destroyed.
+     */
+    class read_guard
+    {
+    public:
+        read_guard(read_guard&& other)
+            : rec_{other.rec_}
+            , value_{other.value_}
+        {
+            other.rec_ = nullptr;
+        }
+
+        read_guard& operator=(read_guard&&) = delete;
+
+        ~read_guard()
+        {
+            if (rec_ && --rec_->nesting == 0)
+                rec_->epoch.store(detail::rcu_domain::idle,
+                                  std::memory_order_release);
+        }
+
+        const T& get() const { return *value_; }
+        const T& operator*() const { return *value_; }
+        const T* operator->() const { return value_; }
+
+    private:
+        friend snapshot_publisher;
+
+        read_guard(detail::rcu_domain::record& rec, const T* value)
+            : rec_{&rec}
+            , value_{value}
+        {}
+
+        detail::rcu_domain::record* rec_;
+        const T* value_;
+    };
+
+    snapshot_publisher(T v = {})
+        : current_{new version{std::move(v)}}
+    {}
+
+    snapshot_publisher(const snapshot_publisher&) = delete;
+    snapshot_publisher& operator=(const snapshot_publisher&) = delete;
+
+    /*!
+     * Destroys all the versions.  There must be no readers left.
+     */
+    ~snapshot_publisher()
+    {
+        delete current_.load();
+        for (auto v : retired_)
+            delete v;
+    }
+
+    /*!
+     * Enters a read-side critical section and returns the guard that
+     * gives access to the current version.
+     */
+    IMMER_NODISCARD read_guard read() const
+    {
+        auto& rec = detail::rcu_thread_records::get(domain_);
+        if (rec.nesting++ == 0)
+            rec.epoch.store(domain_->epoch.load());
+        return {rec, &current_.load()->value};
+    }
+
+    /*!
+     * Returns a copy of the current version, that may be kept for as
+     * long as needed.
+     */
+    IMMER_NODISCARD T load() const { return read().get(); }
+
+    /*!
+     * Makes `v` the current version.  The previous one is destroyed
+     * after its grace period, by this or a later writer.
+     */
+    void publish(T v)
+    {
+        auto next = std::unique_ptr<version>{new version{std::move(v)}};
+        std::lock_guard<std::mutex> lock{writer_};
+        retire(current_.exchange(next.release()));
+    }
+
+    /*!
+     * Publishes `fn(v)`, where `v` is the current version.  Writers are
+     * serialized, so that `fn` always sees the latest version and runs
+     * once.
+     */
+    template <typename Fn>
+    void update(Fn&& fn)
+    {
+        std::lock_guard<std::mutex> lock{writer_};
+        auto next = std::unique_ptr<version>{
+            new version{std::forward<Fn>(fn)(current_.load()->value)}};
+        retire(current_.exchange(next.release()));
+    }
+
+    /*!
+     * Waits until the versions replaced so far have been destroyed.
+     * It must not be called from a read-side critical section.
+     */
+    void synchronize()
+    {
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock{writer_};
+                reclaim();
+                if (retired_.empty())
+                    return;
+            }
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    void retire(version* old)
+    {
+        // readers that enter after this incremented the epoch load the
+        // new version, the ones that announced an earlier epoch may
+        // still be using the old one
+        old->retired_at = domain_->epoch.fetch_add(1);
+        retired_.push_back(old);
+        reclaim();
+    }
+
+    void reclaim()
+    {
+        auto min = domain_->min_active();
+        auto out = retired_.begin();
+        for (auto v : retired_) {
+            if (v->retired_at < min)
+                delete v;
+            else
+                *out++ = v;
+        }
+        retired_.erase(out, retired_.end());
+    }
+
+    std::shared_ptr<detail::rcu_domain> domain_ =
+        std::make_shared<detail::rcu_domain>();
+    std::atomic<version*> current_;
+    std::mutex writer_;
+    std::vector<version*> retired_;
+};
+
+} // namespace immer
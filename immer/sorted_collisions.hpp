@@ -0,0 +1,49 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <functional>
+
+namespace immer {
+
+/*!
+ * Wraps the hash function object `Hash` so that the ``map``, ``set``
+ * and ``table`` containers that use it keep the keys whose hashes
+ * fully collide sorted by `Less`.
+ *
+ * The keys with the same hash are stored together in a collision node
+ * at the bottom of the tree, that is otherwise scanned linearly.  With
+ * a poor hash function, or keys chosen by an attacker to collide, this
+ * makes lookups @f$ O(n) @f$.  Sorted collision nodes are searched by
+ * bisection instead, which keeps lookups @f$ O(log(n)) @f$ in the
+ * worst case.  Insertions and removals still copy the node.
+ *
+ * `Less` must be a strict weak order on the keys under which two keys
+ * are equivalent only when they are equal.  To look up keys of other
+ * types with a transparent hash, it must also compare them with the
+ * keys, like ``std::less<>`` does.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    using map_t = immer::map<
+ *        std::string,
+ *        int,
+ *        immer::sorted_collisions<std::hash<std::string>>>;
+ *
+ * @endrst
+ */
+template <typename Hash, typename Less = std::less<>>
+struct sorted_collisions : Hash
+{
+    using collision_less = Less;
+};
+
+} // namespace immer
@@ -0,0 +1,345 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/sparse/sparse.hpp>
+#include <immer/memory_policy.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace immer {
+
+/*!
+ * Immutable sequential container of a huge number of elements, most of
+ * which have the default value of `T`, that only stores the others.
+ *
+ * @tparam T The type of the values to be stored in the container.
+ * @tparam MemoryPolicy Memory management policy. See @ref
+ *         memory_policy.
+ *
+ * @rst
+ *
+ * This container is a radix trie over the bits of the indices, like
+ * the one of a :cpp:class:`immer::vector`, but whose nodes only keep
+ * the children that are not empty, in the order of the bits set in a
+ * bitmap, like the nodes of :cpp:class:`immer::map`.  The leaves hold
+ * the stored values of 32 consecutive indices.  Thus, it takes memory
+ * in proportion to the number of stored values, and finding the value
+ * at an index, or changing it, visits a node per 5 bits of the
+ * greatest stored index, sharing the rest with the previous version.
+ * The indices go up to :math:`2^{60}`.
+ *
+ * An element that has not been set reads as a default constructed
+ * value.  Setting an element stores it, also when it is equal to the
+ * default, until it is erased.  The stored values can be visited in
+ * order with ``for_each()``, which skips the empty subtrees, also
+ * within a range of indices.
+ *
+ * .. code-block:: c++
+ *
+ *    auto v = immer::sparse_vector<double>(std::uint64_t{1} << 40)
+ *                 .set(12, 1.5)
+ *                 .set(1ull << 39, 2.5);
+ *    assert(v[13] == 0 && v.stored() == 2);
+ *    v.for_each(10, 1000, [](auto i, auto x) {
+ *        // visits 12, 1.5
+ *    });
+ *
+ * @endrst
+ */
+template <typename T, typename MemoryPolicy = default_memory_policy>
+class sparse_vector
+{
+    using trie_t  = detail::sparse::trie<T, MemoryPolicy>;
+    using node_t  = typename trie_t::node_t;
+    using count_t = detail::sparse::count_t;
+
+    struct default_value
+    {
+        const T& operator()() const
+        {
+            static T v{};
+            return v;
+        }
+    };
+
+public:
+    using value_type      = T;
+    using reference       = const T&;
+    using const_reference = const T&;
+    using size_type       = std::uint64_t;
+    using difference_type = std::int64_t;
+
+    using memory_policy_type = MemoryPolicy;
+
+    /*!
+     * The greatest size of a sparse vector.
+     */
+    static constexpr size_type max_size =
+        trie_t::capacity(detail::sparse::max_levels - 1);
+
+    /*!
+     * Default constructor.  It creates a vector of `size() == 0`.  It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    sparse_vector() = default;
+
+    /*!
+     * Constructs a vector of `n` default elements.  It does not
+     * allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    explicit sparse_vector(size_type n)
+        : size_{n}
+    {
+        if (n > max_size)
+            IMMER_THROW(std::length_error{"sparse_vector too large"});
+    }
+
+    sparse_vector(const sparse_vector& other)
+        : root_{node_t::inc(other.root_)}
+        , levels_{other.levels_}
+        , size_{other.size_}
+    {}
+
+    sparse_vector(sparse_vector&& other)
+        : sparse_vector{}
+    {
+        swap(*this, other);
+    }
+
+    sparse_vector& operator=(const sparse_vector& other)
+    {
+        auto next = other;
+        swap(*this, next);
+        return *this;
+    }
+
+    sparse_vector& operator=(sparse_vector&& other)
+    {
+        swap(*this, other);
+        return *this;
+    }
+
+    ~sparse_vector() { node_t::release(root_, levels_); }
+
+    friend void swap(sparse_vector& a, sparse_vector& b)
+    {
+        using std::swap;
+        swap(a.root_, b.root_);
+        swap(a.levels_, b.levels_);
+        swap(a.size_, b.size_);
+    }
+
+    /*!
+     * Returns the number of elements in the container, including the
+     * ones that are not stored.  Its complexity is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD size_type size() const { return size_; }
+
+    /*!
+     * Returns `true` if there are no elements in the container.
+     */
+    IMMER_NODISCARD bool empty() const { return size_ == 0; }
+
+    /*!
+     * Returns the number of elements that are stored.  Its complexity
+     * is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD size_type stored() const
+    {
+        return root_ ? root_->count() : 0;
+    }
+
+    /*!
+     * Returns the element at `index`, which is a default constructed
+     * value when it is not stored.  It does not allocate memory and its
+     * complexity is @f$ O(log(i)) @f$ for the greatest stored index
+     * @f$ i @f$.
+     */
+    IMMER_NODISCARD const T& operator[](size_type index) const
+    {
+        auto p = find(index);
+        return p ? *p : default_value{}();
+    }
+
+    /*!
+     * Returns the element at `index`, like `operator[]`.  It throws an
+     * `std::out_of_range` exception when @f$ index \geq size() @f$.
+     */
+    const T& at(size_type index) const
+    {
+        if (index >= size_)
+            IMMER_THROW(std::out_of_range{"index out of range"});
+        return (*this)[index];
+    }
+
+    /*!
+     * Returns a pointer to the element at `index` when it is stored,
+     * or a `nullptr` otherwise.  It does not allocate memory.
+     */
+    IMMER_NODISCARD const T* find(size_type index) const
+    {
+        return index < trie_t::capacity(levels_)
+                   ? trie_t::find(root_, levels_, index)
+                   : nullptr;
+    }
+
+    /*!
+     * Returns a vector that stores `value` at position `index`, which
+     * grows to `index + 1` elements when it is not less than `size()`.
+     * It throws an `std::out_of_range` exception when @f$ index \geq
+     * max\_size @f$.  It may allocate memory and its complexity is @f$
+     * O(log(i)) @f$.
+     */
+    IMMER_NODISCARD sparse_vector set(size_type index, T value) const&
+    {
+        return set_impl(index, value);
+    }
+    IMMER_NODISCARD sparse_vector&& set(size_type index, T value) &&
+    {
+        auto p = index < trie_t::capacity(levels_)
+                     ? trie_t::find_unique(root_, levels_, index)
+                     : nullptr;
+        if (p) {
+            *p    = std::move(value);
+            size_ = std::max(size_, index + 1);
+        } else
+            *this = set_impl(index, value);
+        return std::move(*this);
+    }
+
+    /*!
+     * Returns a vector containing the result of the expression
+     * `fn(x)` at position `index`, where `x` is the element there, see
+     * `set()`.
+     */
+    template <typename FnT>
+    IMMER_NODISCARD sparse_vector update(size_type index, FnT&& fn) const&
+    {
+        return set(index, std::forward<FnT>(fn)((*this)[index]));
+    }
+    template <typename FnT>
+    IMMER_NODISCARD sparse_vector&& update(size_type index, FnT&& fn) &&
+    {
+        auto v = std::forward<FnT>(fn)((*this)[index]);
+        return std::move(*this).set(index, std::move(v));
+    }
+
+    /*!
+     * Returns a vector where the element at `index` is not stored
+     * anymore, and reads as a default constructed value.  Its
+     * complexity is @f$ O(log(i)) @f$.
+     */
+    IMMER_NODISCARD sparse_vector erase(size_type index) const
+    {
+        if (!find(index))
+            return *this;
+        auto levels = levels_;
+        auto r      = trie_t::erase(root_, levels, index);
+        return {trie_t::shrink(r, levels), levels, size_};
+    }
+
+    /*!
+     * Returns a vector with only the first `elems` elements.  Its
+     * complexity is @f$ O(log(i)) @f$.
+     */
+    IMMER_NODISCARD sparse_vector take(size_type elems) const
+    {
+        if (elems >= size_)
+            return *this;
+        auto levels = levels_;
+        auto r = elems ? trie_t::truncate(root_, levels, elems - 1) : nullptr;
+        return {trie_t::shrink(r, levels), levels, elems};
+    }
+
+    /*!
+     * Calls `fn(i, x)` with the index and the value of every stored
+     * element, in order of their indices.  It does not allocate memory
+     * and its complexity is @f$ O(n) @f$ for the @f$ n @f$ stored
+     * values.
+     */
+    template <typename Fn>
+    void for_each(Fn&& fn) const
+    {
+        for_each(0, size_, fn);
+    }
+
+    /*!
+     * Calls `fn(i, x)` like `for_each(fn)`, but only with the stored
+     * elements whose index is in `[first, last)`.  The subtrees out of
+     * that range are not visited.
+     */
+    template <typename Fn>
+    void for_each(size_type first, size_type last, Fn&& fn) const
+    {
+        if (root_)
+            trie_t::for_each(
+                root_, levels_, 0, first, std::min(last, size_), fn);
+    }
+
+    /*!
+     * Returns whether the vectors have the same size and store the
+     * same values at the same indices.  The subtrees that they share
+     * are not compared.
+     */
+    IMMER_NODISCARD bool operator==(const sparse_vector& other) const
+    {
+        return size_ == other.size_ && levels_ == other.levels_ &&
+               trie_t::equals(root_, other.root_, levels_);
+    }
+    IMMER_NODISCARD bool operator!=(const sparse_vector& other) const
+    {
+        return !(*this == other);
+    }
+
+    /*!
+     * Returns a value that can be used as identity for the container.  If two
+     * values have the same identity, they are guaranteed to be equal and to
+     * contain the same objects.  However, two equal containers are not
+     * guaranteed to have the same identity.
+     */
+    void* identity() const { return const_cast<node_t*>(root_); }
+
+private:
+    sparse_vector(const node_t* root, count_t levels, size_type size)
+        : root_{root}
+        , levels_{levels}
+        , size_{size}
+    {}
+
+    sparse_vector set_impl(size_type index, T& value) const
+    {
+        if (index >= max_size)
+            IMMER_THROW(std::out_of_range{"index too large"});
+        auto levels = std::max(levels_, trie_t::levels_for(index));
+        auto root   = trie_t::grow(node_t::inc(root_), levels_, levels);
+        auto added  = false;
+        IMMER_TRY {
+            auto r = trie_t::set(root, levels, index, value, added);
+            node_t::release(root, levels);
+            return {r, levels, std::max(size_, index + 1)};
+        }
+        IMMER_CATCH (...) {
+            node_t::release(root, levels);
+            IMMER_RETHROW;
+        }
+    }
+
+    // The stored values are in a trie of `levels_` inner levels, the
+    // fewest that cover the greatest stored index, or none when there
+    // are no values, so that equal vectors have tries of equal shape.
+    const node_t* root_ = nullptr;
+    count_t levels_     = 0;
+    size_type size_     = 0;
+};
+
+} // namespace immer
@@ -0,0 +1,231 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/hamts/bits.hpp>
+
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if IMMER_HAS_TBB
+#include <tbb/blocked_range.h>
+#endif
+
+namespace immer {
+
+namespace detail {
+
+/*!
+ * The implementation that a `split_range` exposes to the algorithms:
+ * the values of a node, followed by some of its children, all of them
+ * at `depth`, which are visited with the traversal of the trie.
+ */
+template <typename Champ>
+struct split_range_impl
+{
+    using node_t  = typename Champ::node_t;
+    using value_t = typename node_t::value_t;
+
+    const Champ* champ;
+    const value_t* vfirst;
+    const value_t* vlast;
+    const node_t* const* cfirst;
+    const node_t* const* clast;
+    hamts::count_t depth;
+
+    template <typename Fn>
+    void for_each_chunk(Fn&& fn) const
+    {
+        if (vfirst != vlast)
+            fn(vfirst, vlast);
+        for (auto it = cfirst; it != clast; ++it)
+            champ->for_each_chunk_traversal(*it, depth, fn);
+    }
+};
+
+} // namespace detail
+
+/*!
+ * Range over the elements of a ``map``, ``set`` or ``table`` of type
+ * `Container` that can be split in two, at the boundaries of the
+ * nodes of the trie, to process each part in parallel.  The iterators
+ * of these containers are forward only, thus the standard parallel
+ * algorithms can not divide them, but ranges can.
+ *
+ * It keeps the container alive and it is split in @f$ O(1) @f$,
+ * giving the two halves about the same number of subtrees, which have
+ * about the same number of elements as long as the hash is good.  It
+ * models the *range* concept of Intel TBB, such that it can be passed
+ * to ``tbb::parallel_for`` directly, and `partition()` divides it in
+ * as many parts as an @ref executor needs.  The parts work with the
+ * :doc:`algorithms <algorithms>`.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    auto ex    = immer::thread_executor{};
+ *    auto parts = immer::split_range<immer::set<int>>{s}.partition(
+ *        ex.concurrency() * 4);
+ *    ex.bulk(parts.size(), [&](std::size_t i) {
+ *        immer::for_each(parts[i], [](int x) { ... });
+ *    });
+ *
+ * @endrst
+ */
+template <typename Container>
+class split_range
+{
+    using champ_t =
+        std::decay_t<decltype(std::declval<const Container&>().impl())>;
+    using impl_t  = detail::split_range_impl<champ_t>;
+    using node_t  = typename champ_t::node_t;
+    using value_t = typename node_t::value_t;
+
+public:
+    using container_type = Container;
+    using value_type     = typename Container::value_type;
+
+    /*!
+     * Default constructor.  It creates an empty range.
+     */
+    split_range() = default;
+
+    /*!
+     * Constructs a range with all the elements of `c`.
+     */
+    split_range(Container c)
+        : c_{std::move(c)}
+    {
+        auto root = c_.impl().root;
+        if (root->datamap()) {
+            vfirst_ = root->values();
+            vlast_  = vfirst_ + root->data_count();
+        }
+        if (root->nodemap()) {
+            cfirst_ = root->children();
+            clast_  = cfirst_ + root->children_count();
+        }
+        normalize();
+    }
+
+#if IMMER_HAS_TBB
+    /*!
+     * Splitting constructor of the TBB *range* concept.  It leaves the
+     * first half in `r` and takes the second, like `r.split()` does.
+     * It is only available when ``IMMER_HAS_TBB`` is defined to ``1``.
+     */
+    split_range(split_range& r, tbb::split)
+        : split_range{r.split()}
+    {}
+#endif
+
+    /*!
+     * Returns `true` if there are no elements in the range.
+     */
+    IMMER_NODISCARD bool empty() const
+    {
+        return vfirst_ == vlast_ && cfirst_ == clast_;
+    }
+
+    /*!
+     * Returns `true` when the range spans more than one node of the
+     * trie, such that it can be split.
+     */
+    IMMER_NODISCARD bool is_divisible() const
+    {
+        auto n = clast_ - cfirst_;
+        return n > 1 || (n == 1 && vfirst_ != vlast_);
+    }
+
+    /*!
+     * Leaves the first half of the range in this one and returns the
+     * second half.  The range must be divisible.
+     */
+    split_range split()
+    {
+        assert(is_divisible());
+        auto mid  = cfirst_ + (clast_ - cfirst_) / 2;
+        auto r    = *this;
+        r.vfirst_ = r.vlast_ = nullptr;
+        r.cfirst_ = mid;
+        clast_    = mid;
+        r.normalize();
+        normalize();
+        return r;
+    }
+
+    /*!
+     * Splits the range, and then every part in turn, until there are
+     * `n` parts or they can not be split any further.  The parts are
+     * disjoint and they have together all the elements of the range.
+     */
+    IMMER_NODISCARD std::vector<split_range> partition(std::size_t n) const
+    {
+        auto parts = std::vector<split_range>{};
+        if (empty())
+            return parts;
+        parts.push_back(*this);
+        for (auto split = true; split && parts.size() < n;) {
+            split          = false;
+            auto available = parts.size();
+            for (auto i = std::size_t{}; i < available && parts.size() < n;
+                 ++i) {
+                if (parts[i].is_divisible()) {
+                    parts.push_back(parts[i].split());
+                    split = true;
+                }
+            }
+        }
+        return parts;
+    }
+
+    /*!
+     * Returns the container that the range traverses.
+     */
+    IMMER_NODISCARD const Container& container() const { return c_; }
+
+    impl_t impl() const
+    {
+        return {&c_.impl(), vfirst_, vlast_, cfirst_, clast_, depth_};
+    }
+
+private:
+    // a lone child without values of its own is replaced by its values
+    // and children, so that a range that can not be split is never
+    // reported as divisible
+    void normalize()
+    {
+        while (vfirst_ == vlast_ && clast_ - cfirst_ == 1 &&
+               depth_ < detail::hamts::max_depth<champ_t::bits> &&
+               (*cfirst_)->nodemap()) {
+            auto node = *cfirst_;
+            ++depth_;
+            if (node->datamap()) {
+                vfirst_ = node->values();
+                vlast_  = vfirst_ + node->data_count();
+            }
+            cfirst_ = node->children();
+            clast_  = cfirst_ + node->children_count();
+        }
+    }
+
+    Container c_                  = {};
+    const value_t* vfirst_        = nullptr;
+    const value_t* vlast_         = nullptr;
+    const node_t* const* cfirst_  = nullptr;
+    const node_t* const* clast_   = nullptr;
+    detail::hamts::count_t depth_ = 1;
+};
+
+} // namespace immer
@@ -0,0 +1,265 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/rbts/operations.hpp>
+#include <immer/detail/rbts/subtree.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+namespace immer {
+
+/*!
+ * Remembers a summary of each inner node of the ``vector`` or
+ * ``flex_vector`` values of type `Vector` that it has reduced, so
+ * that the aggregate of any range of elements can be computed in
+ * *effectively* @f$ O(log(n)) @f$ while the nodes stay cached.
+ *
+ * @tparam T The type of the summaries.
+ * @tparam Combine A function object that must be associative. It is
+ *     called both as `combine(T, const value_type&)` to add an element
+ *     to a summary and as `combine(T, T)` to join two summaries.
+ *
+ * The summary of a node only depends on its elements.  Because the
+ * slicing, concatenation and update operations of the containers
+ * share all the nodes that they do not change, the summaries survive
+ * those operations and only the nodes along the edited paths need to
+ * be reduced again.  For example, after computing the sum of `v` once,
+ * the sum of `v.drop(a).take(b)` only reduces the elements in the two
+ * leaves at the edges of the slice.
+ *
+ * @rst
+ *
+ * .. note:: The cache holds a reference to every node that it keeps a
+ *    summary for, so those can not be freed and their identity stays
+ *    valid.  Call ``trim()`` to forget the nodes that are not used by
+ *    any container any more, or ``clear()`` to forget everything.
+ *    Because of this, it requires a memory policy with reference
+ *    counting.
+ *
+ * .. warning:: Only pass persistent values to the cache.  The nodes
+ *    owned by a transient are updated in place and their summaries
+ *    would be stale.
+ *
+ * @endrst
+ */
+template <typename Vector, typename T, typename Combine>
+class summary_cache
+{
+    using impl_t =
+        std::decay_t<decltype(std::declval<const Vector&>().impl())>;
+    using node_t = typename impl_t::node_t;
+    using sub_t  = detail::rbts::subtree<node_t>;
+    using key_t  = std::pair<node_t*, std::size_t>;
+
+    static constexpr auto B  = node_t::bits;
+    static constexpr auto BL = node_t::bits_leaf;
+
+    struct key_hash
+    {
+        std::size_t operator()(const key_t& k) const
+        {
+            auto h = std::hash<const void*>{}(k.first);
+            return h ^ (std::hash<std::size_t>{}(k.second) + 0x9e3779b9 +
+                        (h << 6) + (h >> 2));
+        }
+    };
+
+    struct entry
+    {
+        detail::rbts::shift_t shift;
+        T value;
+    };
+
+    using map_t = std::unordered_map<key_t, entry, key_hash>;
+
+public:
+    using value_type = T;
+    using size_type  = detail::rbts::size_t;
+
+    /*!
+     * Constructs an empty cache.  The `identity` value must be an
+     * identity of `combine`, like `0` is for addition.
+     */
+    explicit summary_cache(T identity, Combine combine = {})
+        : identity_{std::move(identity)}
+        , combine_{std::move(combine)}
+    {}
+
+    summary_cache(summary_cache&& other)
+        : identity_{std::move(other.identity_)}
+        , combine_{std::move(other.combine_)}
+        , cache_{std::move(other.cache_)}
+    {
+        other.cache_.clear();
+    }
+
+    summary_cache(const summary_cache&)            = delete;
+    summary_cache& operator=(const summary_cache&) = delete;
+    summary_cache& operator=(summary_cache&&)      = delete;
+
+    ~summary_cache() { clear(); }
+
+    /*!
+     * Returns the summary of all the elements of `v`.
+     */
+    T reduce(const Vector& v) { return reduce(v, 0, v.size()); }
+
+    /*!
+     * Returns the summary of the elements of `v` in the index range
+     * @f$ [first, last) @f$.  The summaries of the inner nodes that are
+     * fully inside the range are cached for later calls.
+     */
+    T reduce(const Vector& v, size_type first, size_type last)
+    {
+        assert(first <= last && last <= v.size());
+        sub_t roots[2];
+        auto n   = detail::rbts::root_subtrees(v.impl(), roots);
+        auto acc = identity_;
+        for (auto i = 0; i < n; ++i) {
+            auto lo = std::max(first, roots[i].first);
+            auto hi = std::min(last, roots[i].last());
+            if (lo < hi)
+                acc = combine_(std::move(acc), reduce_sub(roots[i], lo, hi));
+        }
+        return acc;
+    }
+
+    /*!
+     * Returns the index of the first element of `v` where the summary
+     * of the elements up to and including it satisfies `pred`, or
+     * `v.size()` when there is none.  The predicate must be monotonic,
+     * so that it holds for every longer prefix once it holds.  The
+     * nodes before the one that it is in are skipped using their
+     * summaries, so this takes *effectively* @f$ O(log(n)) @f$ too.
+     */
+    template <typename Pred>
+    size_type find_first(const Vector& v, Pred pred)
+    {
+        sub_t roots[2];
+        auto n   = detail::rbts::root_subtrees(v.impl(), roots);
+        auto acc = identity_;
+        auto idx = size_type{};
+        for (auto i = 0; i < n; ++i)
+            if (find_sub(roots[i], acc, pred, idx))
+                return idx;
+        return v.size();
+    }
+
+    /*!
+     * Returns the number of nodes the cache holds a summary for.
+     */
+    std::size_t size() const { return cache_.size(); }
+
+    /*!
+     * Forgets the summaries of the nodes that are only referenced by
+     * the cache itself.
+     */
+    void trim()
+    {
+        // freeing a node may leave its children only referenced by
+        // the cache too
+        for (auto again = true; again;) {
+            again = false;
+            for (auto it = cache_.begin(); it != cache_.end();) {
+                if (node_t::refs(it->first.first).unique()) {
+                    release(*it);
+                    it    = cache_.erase(it);
+                    again = true;
+                } else
+                    ++it;
+            }
+        }
+    }
+
+    /*!
+     * Forgets all the summaries.
+     */
+    void clear()
+    {
+        for (auto& e : cache_)
+            release(e);
+        cache_.clear();
+    }
+
+private:
+    T reduce_sub(const sub_t& s, size_type lo, size_type hi)
+    {
+        auto acc = identity_;
+        if (s.level == 0) {
+            const auto data = s.node->leaf();
+            for (auto i = lo; i < hi; ++i)
+                acc = combine_(std::move(acc), data[i - s.first]);
+            return acc;
+        }
+        auto whole = lo == s.first && hi == s.last();
+        if (whole) {
+            auto it = cache_.find(key_t{s.node, s.size});
+            if (it != cache_.end())
+                return it->second.value;
+        }
+        detail::rbts::each_subtree(s, lo, hi, [&](auto&& c) {
+            acc = combine_(std::move(acc),
+                           reduce_sub(c,
+                                      std::max(lo, c.first),
+                                      std::min(hi, c.last())));
+        });
+        if (whole) {
+            auto shift = static_cast<detail::rbts::shift_t>(
+                BL + (s.level - 1) * B);
+            cache_.emplace(key_t{s.node, s.size}, entry{shift, acc});
+            s.node->inc();
+        }
+        return acc;
+    }
+
+    template <typename Pred>
+    bool find_sub(const sub_t& s, T& acc, Pred& pred, size_type& idx)
+    {
+        if (s.level == 0) {
+            const auto data = s.node->leaf();
+            for (auto i = size_type{}; i < s.size; ++i) {
+                acc = combine_(std::move(acc), data[i]);
+                if (pred(acc)) {
+                    idx = s.first + i;
+                    return true;
+                }
+            }
+            return false;
+        }
+        auto whole = combine_(acc, reduce_sub(s, s.first, s.last()));
+        if (!pred(whole)) {
+            acc = std::move(whole);
+            return false;
+        }
+        auto found = false;
+        detail::rbts::each_subtree(s, s.first, s.last(), [&](auto&& c) {
+            found = found || find_sub(c, acc, pred, idx);
+        });
+        return found;
+    }
+
+    static void release(const typename map_t::value_type& e)
+    {
+        detail::rbts::dec_inner(e.first.first, e.second.shift, e.first.second);
+    }
+
+    T identity_;
+    Combine combine_;
+    map_t cache_;
+};
+
+} // namespace immer
@@ -1,9 +1,13 @@
 #pragma once
 
 #include <immer/config.hpp>
+#include <immer/container_hash.hpp>
 #include <immer/detail/hamts/champ.hpp>
 #include <immer/detail/hamts/champ_iterator.hpp>
 #include <immer/memory_policy.hpp>
+
+#include <cassert>
+#include <iterator>
 #include <type_traits>
 
 namespace immer {
@@ -96,7 +100,7 @@ using table_key_t = std::decay_t<decltype(KeyFn{}(std::declval<T>()))>;
  */
 template <typename T,
           typename KeyFn          = table_key_fn,
-          typename Hash           = std::hash<table_key_t<KeyFn, T>>,
+          typename Hash           = container_hash<table_key_t<KeyFn, T>>,
           typename Equal          = std::equal_to<table_key_t<KeyFn, T>>,
           typename MemoryPolicy   = default_memory_policy,
           detail::hamts::bits_t B = default_bits>
@@ -150,6 +154,12 @@ class table
 
     struct hash_key
     {
+        static constexpr bool cache_hashes =
+            detail::hamts::hash_caching<Hash>::value;
+
+        using collision_less =
+            detail::hamts::key_collision_less_t<Hash, value_t, KeyFn>;
+
         std::size_t operator()(const value_t& v) const
         {
             return Hash{}(KeyFn{}(v));
@@ -375,6 +385,18 @@ public:
                                   detail::constantly<const T*, nullptr>>(k);
     }
 
+    /*!
+     * Like `find`, but `hash` is used as the hash of `k` instead of
+     * computing it, thus it must be `hasher{}(k)`.  This avoids hashing
+     * an expensive key again when it is looked up in several containers.
+     */
+    IMMER_NODISCARD const T* find_hashed(const K& k, std::size_t hash) const
+    {
+        return impl_.template get<project_value_ptr,
+                                  detail::constantly<const T*, nullptr>>(k,
+                                                                         hash);
+    }
+
     IMMER_NODISCARD bool operator==(const table& other) const
     {
         return impl_.template equals<equal_value>(other.impl_);
@@ -409,6 +431,21 @@ public:
         return insert_move(move_t{}, std::move(value));
     }
 
+    /*!
+     * Like `insert`, but `hash` is used as the hash of the key of
+     * `value`, thus it must be `hasher{}(KeyFn{}(value))`.
+     */
+    IMMER_NODISCARD table insert_hashed(value_type value,
+                                        std::size_t hash) const&
+    {
+        return impl_.add(std::move(value), hash);
+    }
+    IMMER_NODISCARD decltype(auto) insert_hashed(value_type value,
+                                                 std::size_t hash) &&
+    {
+        return insert_hashed_move(move_t{}, std::move(value), hash);
+    }
+
     /*!
      * Returns `this->insert(fn((*this)[k]))`. In particular, `fn` maps
      * `T` to `T`. The key `k` will be replaced inside the value returned by
@@ -428,6 +465,26 @@ public:
         return update_move(move_t{}, std::move(k), std::forward<Fn>(fn));
     }
 
+    /*!
+     * Like `update`, but `hash` is used as the hash of `k`, thus it
+     * must be `hasher{}(k)`.
+     */
+    template <typename Fn>
+    IMMER_NODISCARD table
+    update_hashed(key_type k, std::size_t hash, Fn&& fn) const&
+    {
+        return impl_
+            .template update<project_value, default_value, combine_value>(
+                std::move(k), hash, std::forward<Fn>(fn));
+    }
+    template <typename Fn>
+    IMMER_NODISCARD decltype(auto)
+    update_hashed(key_type k, std::size_t hash, Fn&& fn) &&
+    {
+        return update_hashed_move(
+            move_t{}, std::move(k), hash, std::forward<Fn>(fn));
+    }
+
     /*!
      * Returns `this.count(k) ? this->insert(fn((*this)[k])) : *this`. In
      * particular, `fn` maps `T` to `T`. The key `k` will be replaced inside the
@@ -447,6 +504,46 @@ public:
             move_t{}, std::move(k), std::forward<Fn>(fn));
     }
 
+    /*!
+     * Like `insert`, but when there is already an entry that compares
+     * equal to `value` it returns the same table, thus keeping its
+     * `identity()`, instead of copying the path to the entry.  The key
+     * is hashed only once.  It may allocate memory and its complexity
+     * is *effectively* @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD table insert_if_changed(value_type value) const&
+    {
+        auto hash = Hash{}(KeyFn{}(value));
+        auto p    = find_hashed(KeyFn{}(value), hash);
+        return insert_changed(std::move(value), hash, p);
+    }
+    IMMER_NODISCARD decltype(auto) insert_if_changed(value_type value) &&
+    {
+        return insert_if_changed_move(move_t{}, std::move(value));
+    }
+
+    /*!
+     * Like `update`, but when the value returned by `fn` compares equal
+     * to the entry it returns the same table, like
+     * `insert_if_changed`.  When there is no entry with the key `k`,
+     * the result of `fn` is always inserted.
+     */
+    template <typename Fn>
+    IMMER_NODISCARD table update_if_changed(key_type k, Fn&& fn) const&
+    {
+        auto hash = Hash{}(k);
+        auto p    = find_hashed(k, hash);
+        auto v    = combine_value{}(
+            std::move(k), std::forward<Fn>(fn)(p ? *p : default_value{}()));
+        return insert_changed(std::move(v), hash, p);
+    }
+    template <typename Fn>
+    IMMER_NODISCARD decltype(auto) update_if_changed(key_type k, Fn&& fn) &&
+    {
+        return update_if_changed_move(
+            move_t{}, std::move(k), std::forward<Fn>(fn));
+    }
+
     /*!
      * Returns a table without entries with given key `k`. If the key is not
      * present it returns `*this`. It may allocate
@@ -464,6 +561,90 @@ public:
         return erase_move(move_t{}, k);
     }
 
+    /*!
+     * Returns a table without the values with the keys in the range
+     * `keys`, which must yield references to the keys and can be
+     * traversed more than once.  Every node where some of them fall is
+     * visited and copied only once, see `map::erase_many()`.  Its
+     * complexity is *effectively* @f$ O(n \log n) @f$ where @f$ n @f$ is
+     * the number of keys.
+     */
+    template <typename Keys>
+    IMMER_NODISCARD table erase_many(const Keys& keys) const&
+    {
+        using std::begin;
+        using std::end;
+        return impl_.sub_batch(begin(keys), end(keys));
+    }
+    template <typename Keys>
+    IMMER_NODISCARD decltype(auto) erase_many(const Keys& keys) &&
+    {
+        return erase_many_move(move_t{}, keys);
+    }
+
+    /*!
+     * Returns a table without the values for which `pred(x)` returns
+     * `true`, in one traversal that shares the subtrees where nothing
+     * is erased.  Its complexity is @f$ O(n) @f$.
+     */
+    template <typename Pred>
+    IMMER_NODISCARD table erase_if(Pred&& pred) const&
+    {
+        return impl_.filter(keep_unless(pred));
+    }
+    template <typename Pred>
+    IMMER_NODISCARD decltype(auto) erase_if(Pred&& pred) &&
+    {
+        return erase_if_move(move_t{}, pred);
+    }
+
+    /*!
+     * Returns a table with all the values in the range defined by the
+     * input iterator `first` and range sentinel `last`.  When there is
+     * already a value `old` with the same key, in the table or earlier
+     * in the range, it is replaced by `merge(old, value)`, with the key
+     * of `old` set into the result.  The range is sorted by hash and
+     * every touched node is descended into and allocated only once, so
+     * this is cheaper than inserting or updating the values one by one.
+     * It may allocate memory and its complexity is *effectively* @f$
+     * O(n \log n) @f$ where @f$ n @f$ is the size of the range.
+     */
+    template <typename Iter,
+              typename Sent,
+              typename Fn,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    IMMER_NODISCARD table upsert_many(Iter first, Sent last, Fn&& merge) const&
+    {
+        auto combine = merge_value<Fn>{merge};
+        return impl_.upsert_batch(first, last, combine);
+    }
+    template <typename Iter,
+              typename Sent,
+              typename Fn,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    IMMER_NODISCARD decltype(auto)
+    upsert_many(Iter first, Sent last, Fn&& merge) &&
+    {
+        return upsert_many_move(move_t{}, first, last, merge);
+    }
+
+    /*!
+     * Like `upsert_many(first, last, merge)`, for all the values in the
+     * range `r`.
+     */
+    template <typename Range, typename Fn>
+    IMMER_NODISCARD table upsert_many(const Range& r, Fn&& merge) const&
+    {
+        return upsert_many(std::begin(r), std::end(r), merge);
+    }
+    template <typename Range, typename Fn>
+    IMMER_NODISCARD decltype(auto) upsert_many(const Range& r, Fn&& merge) &&
+    {
+        return std::move(*this).upsert_many(std::begin(r), std::end(r), merge);
+    }
+
     /*!
      * Returns a @a transient form of this container, an
      * `immer::table_transient`.
@@ -482,9 +663,21 @@ public:
         return transient_type{std::move(impl_)};
     }
 
+    /*!
+     * Returns a value that can be used as identity for the container.  If two
+     * values have the same identity, they are guaranteed to be equal and to
+     * contain the same objects.  However, two equal containers are not
+     * guaranteed to have the same identity.
+     */
+    void* identity() const { return impl_.root; }
+
     // Semi-private
     const impl_t& impl() const { return impl_; }
 
+    table(impl_t impl)
+        : impl_(std::move(impl))
+    {}
+
 private:
     friend transient_type;
 
@@ -498,6 +691,18 @@ private:
         return impl_.add(std::move(value));
     }
 
+    table&&
+    insert_hashed_move(std::true_type, value_type value, std::size_t hash)
+    {
+        impl_.add_mut({}, std::move(value), hash);
+        return std::move(*this);
+    }
+    table
+    insert_hashed_move(std::false_type, value_type value, std::size_t hash)
+    {
+        return impl_.add(std::move(value), hash);
+    }
+
     template <typename Fn>
     table&& update_move(std::true_type, key_type k, Fn&& fn)
     {
@@ -513,6 +718,62 @@ private:
                 std::move(k), std::forward<Fn>(fn));
     }
 
+    template <typename Fn>
+    table&&
+    update_hashed_move(std::true_type, key_type k, std::size_t hash, Fn&& fn)
+    {
+        impl_.template update_mut<project_value, default_value, combine_value>(
+            {}, std::move(k), hash, std::forward<Fn>(fn));
+        return std::move(*this);
+    }
+    template <typename Fn>
+    table
+    update_hashed_move(std::false_type, key_type k, std::size_t hash, Fn&& fn)
+    {
+        return impl_
+            .template update<project_value, default_value, combine_value>(
+                std::move(k), hash, std::forward<Fn>(fn));
+    }
+
+    // Inserts `value`, whose key had the entry `p`, unless they are
+    // equal.
+    table insert_changed(value_type value, std::size_t hash, const T* p) const
+    {
+        if (p && *p == value)
+            return *this;
+        return impl_.add(std::move(value), hash);
+    }
+
+    table&& insert_if_changed_move(std::true_type, value_type value)
+    {
+        auto hash = Hash{}(KeyFn{}(value));
+        auto p    = find_hashed(KeyFn{}(value), hash);
+        if (!p || !(*p == value))
+            impl_.add_mut({}, std::move(value), hash);
+        return std::move(*this);
+    }
+    table insert_if_changed_move(std::false_type, value_type value)
+    {
+        return insert_if_changed(std::move(value));
+    }
+
+    template <typename Fn>
+    table&& update_if_changed_move(std::true_type, key_type k, Fn&& fn)
+    {
+        auto hash = Hash{}(k);
+        auto p    = find_hashed(k, hash);
+        auto v    = combine_value{}(
+            std::move(k), std::forward<Fn>(fn)(p ? *p : default_value{}()));
+        if (!p || !(*p == v))
+            impl_.add_mut({}, std::move(v), hash);
+        return std::move(*this);
+    }
+    template <typename Fn>
+    table update_if_changed_move(std::false_type, key_type k, Fn&& fn)
+    {
+        return update_if_changed(std::move(k), std::forward<Fn>(fn));
+    }
+
     template <typename Fn>
     table&& update_if_exists_move(std::true_type, key_type k, Fn&& fn)
     {
@@ -527,6 +788,32 @@ private:
             std::move(k), std::forward<Fn>(fn));
     }
 
+    // Keeps the key of the old value in the result of `merge`.
+    template <typename Fn>
+    struct merge_value
+    {
+        Fn& merge;
+
+        T operator()(const T& old, const T& v) const
+        {
+            return KeyFn{}(merge(old, v), KeyFn{}(old));
+        }
+    };
+
+    template <typename Iter, typename Sent, typename Fn>
+    table&& upsert_many_move(std::true_type, Iter first, Sent last, Fn& merge)
+    {
+        auto combine = merge_value<Fn>{merge};
+        impl_.upsert_batch_mut({}, first, last, combine);
+        return std::move(*this);
+    }
+    template <typename Iter, typename Sent, typename Fn>
+    table upsert_many_move(std::false_type, Iter first, Sent last, Fn& merge)
+    {
+        auto combine = merge_value<Fn>{merge};
+        return impl_.upsert_batch(first, last, combine);
+    }
+
     table&& erase_move(std::true_type, const key_type& value)
     {
         impl_.sub_mut({}, value);
@@ -537,11 +824,68 @@ private:
         return impl_.sub(value);
     }
 
-    table(impl_t impl)
-        : impl_(std::move(impl))
-    {}
+    template <typename Keys>
+    table&& erase_many_move(std::true_type, const Keys& keys)
+    {
+        using std::begin;
+        using std::end;
+        impl_.sub_batch_mut({}, begin(keys), end(keys));
+        return std::move(*this);
+    }
+    template <typename Keys>
+    table erase_many_move(std::false_type, const Keys& keys)
+    {
+        using std::begin;
+        using std::end;
+        return impl_.sub_batch(begin(keys), end(keys));
+    }
+
+    template <typename Pred>
+    table&& erase_if_move(std::true_type, Pred& pred)
+    {
+        impl_.filter_mut({}, keep_unless(pred));
+        return std::move(*this);
+    }
+    template <typename Pred>
+    table erase_if_move(std::false_type, Pred& pred)
+    {
+        return impl_.filter(keep_unless(pred));
+    }
+
+    template <typename Pred>
+    static auto keep_unless(Pred& pred)
+    {
+        return [&pred](const T& v) { return !pred(v); };
+    }
 
     impl_t impl_ = impl_t::empty();
 };
 
+/*!
+ * Returns a table with the values `fn(x)` for every value `x` in `t`.
+ * The key of `fn(x)` must be the key of `x`.  The result is built with
+ * the same shape as `t`, node by node, without hashing or comparing the
+ * keys, thus it is faster than inserting the values one by one in a new
+ * table.  Its complexity is @f$ O(n) @f$.
+ */
+template <typename T,
+          typename KeyFn,
+          typename Hash,
+          typename Equal,
+          typename MemoryPolicy,
+          detail::hamts::bits_t B,
+          typename Fn>
+auto transform_values(const table<T, KeyFn, Hash, Equal, MemoryPolicy, B>& t,
+                      Fn&& fn)
+{
+    using value_t  = std::decay_t<decltype(fn(std::declval<const T&>()))>;
+    using result_t = table<value_t, KeyFn, Hash, Equal, MemoryPolicy, B>;
+    using impl_t   = std::decay_t<decltype(std::declval<result_t>().impl())>;
+    return result_t{t.impl().template transform<impl_t>([&](const T& x) {
+        auto r = value_t(fn(x));
+        assert(Equal{}(KeyFn{}(r), KeyFn{}(x)));
+        return r;
+    })};
+}
+
 } // namespace immer
@@ -2,6 +2,8 @@
 
 #include <immer/detail/hamts/champ.hpp>
 #include <immer/memory_policy.hpp>
+#include <immer/trace.hpp>
+#include <iterator>
 #include <type_traits>
 
 namespace immer {
@@ -203,6 +205,17 @@ public:
                                   detail::constantly<const T*, nullptr>>(k);
     }
 
+    /*!
+     * Like `find`, but `hash` is used as the hash of `k` instead of
+     * computing it, thus it must be `hasher{}(k)`.
+     */
+    IMMER_NODISCARD const T* find_hashed(const K& k, std::size_t hash) const
+    {
+        return impl_.template get<typename persistent_type::project_value_ptr,
+                                  detail::constantly<const T*, nullptr>>(
+            k, hash);
+    }
+
     /*!
      * Inserts `value` to the table.
      * If there is an entry with its key is already,
@@ -212,6 +225,15 @@ public:
      */
     void insert(value_type value) { impl_.add_mut(*this, std::move(value)); }
 
+    /*!
+     * Like `insert`, but `hash` is used as the hash of the key of
+     * `value`, thus it must be `hasher{}(KeyFn{}(value))`.
+     */
+    void insert_hashed(value_type value, std::size_t hash)
+    {
+        impl_.add_mut(*this, std::move(value), hash);
+    }
+
     /*!
      * Returns `this->insert(fn((*this)[k]))`. In particular, `fn` maps `T` to
      * `T`. The key `k` will be set into the value returned bu `fn`.  It may
@@ -226,6 +248,19 @@ public:
             *this, std::move(k), std::forward<Fn>(fn));
     }
 
+    /*!
+     * Like `update`, but `hash` is used as the hash of `k`, thus it
+     * must be `hasher{}(k)`.
+     */
+    template <typename Fn>
+    void update_hashed(key_type k, std::size_t hash, Fn&& fn)
+    {
+        impl_.template update_mut<typename persistent_type::project_value,
+                                  typename persistent_type::default_value,
+                                  typename persistent_type::combine_value>(
+            *this, std::move(k), hash, std::forward<Fn>(fn));
+    }
+
     /*!
      * Returns `this->insert(fn((*this)[k]))` when `this->count(k) > 0`. In
      * particular, `fn` maps `T` to `T`. The key `k` will be replaced into the
@@ -247,12 +282,71 @@ public:
      */
     void erase(const K& k) { impl_.sub_mut(*this, k); }
 
+    /*!
+     * Removes all the keys in the range `keys`, which must yield
+     * references to them and can be traversed more than once.  Every
+     * node where some of them fall is visited only once.  Its
+     * complexity is *effectively* @f$ O(n \log n) @f$ where @f$ n @f$ is
+     * the number of keys.
+     */
+    template <typename Keys>
+    void erase_many(const Keys& keys)
+    {
+        using std::begin;
+        using std::end;
+        impl_.sub_batch_mut(*this, begin(keys), end(keys));
+    }
+
+    /*!
+     * Removes the values for which `pred(x)` returns `true`, in one
+     * traversal that keeps the subtrees where nothing is erased.  Its
+     * complexity is @f$ O(n) @f$.
+     */
+    template <typename Pred>
+    void erase_if(Pred&& pred)
+    {
+        impl_.filter_mut(*this, persistent_type::keep_unless(pred));
+    }
+
+    /*!
+     * Inserts all the values in the range defined by the input iterator
+     * `first` and range sentinel `last`.  When there is already a value
+     * `old` with the same key, in the table or earlier in the range, it
+     * is replaced by `merge(old, value)`, with the key of `old` set into
+     * the result.  Every touched node is descended into and allocated
+     * only once.  It may allocate memory and its complexity is
+     * *effectively* @f$ O(n \log n) @f$ where @f$ n @f$ is the size of
+     * the range.
+     */
+    template <typename Iter,
+              typename Sent,
+              typename Fn,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    void upsert_many(Iter first, Sent last, Fn&& merge)
+    {
+        auto combine =
+            typename persistent_type::template merge_value<Fn>{merge};
+        impl_.upsert_batch_mut(*this, first, last, combine);
+    }
+
+    /*!
+     * Like `upsert_many(first, last, merge)`, for all the values in the
+     * range `r`.
+     */
+    template <typename Range, typename Fn>
+    void upsert_many(const Range& r, Fn&& merge)
+    {
+        upsert_many(std::begin(r), std::end(r), merge);
+    }
+
     /*!
      * Returns an @a immutable form of this container, an
      * `immer::table`.
      */
     IMMER_NODISCARD persistent_type persistent() &
     {
+        IMMER_TRACE_HOOK(persistent, impl_.size);
         this->owner_t::operator=(owner_t{});
         return impl_;
     }
@@ -261,7 +355,11 @@ public:
      * Returns an @a immutable form of this container, an
      * `immer::table`.
      */
-    IMMER_NODISCARD persistent_type persistent() && { return std::move(impl_); }
+    IMMER_NODISCARD persistent_type persistent() &&
+    {
+        IMMER_TRACE_HOOK(persistent, impl_.size);
+        return std::move(impl_);
+    }
 
 private:
     friend persistent_type;
@@ -271,6 +369,14 @@ private:
         : impl_(std::move(impl))
     {}
 
+    template <typename MP>
+    friend class edit_session;
+
+    table_transient(impl_t impl, owner_t owner)
+        : owner_t(std::move(owner))
+        , impl_(std::move(impl))
+    {}
+
     impl_t impl_ = impl_t::empty();
 
 public:
@@ -0,0 +1,148 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+
+#include <chrono>
+#include <cstddef>
+
+namespace immer {
+
+/*!
+ * Callbacks that the containers call at the points where an operation
+ * may be slower than usual, to find out why in production.  They are
+ * only called when the library is built with `IMMER_TRACE_HOOKS`
+ * defined to `1`, otherwise the calls are not compiled in and cost
+ * nothing.  The callbacks that are null are not called.
+ *
+ * The hooks are global and are read without synchronization, thus they
+ * should be set before the containers are used by other threads.  The
+ * callbacks are called from the thread doing the operation, in the
+ * middle of it, so they must not use the containers themselves.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    #define IMMER_TRACE_HOOKS 1
+ *    #include <immer/trace.hpp>
+ *
+ *    immer::trace_hooks::get().release = [](std::size_t nodes) {
+ *        log("released a vector of {} nodes", nodes);
+ *    };
+ *
+ * @endrst
+ */
+struct trace_hooks
+{
+    /*!
+     * Called when concatenating two vectors rebalances the nodes at the
+     * level `shift` of the result, with the `nodes` that it merges and
+     * the `rebalanced` nodes that it makes of them, which are as many
+     * when they were balanced enough.
+     */
+    void (*concat_rebalance)(std::size_t nodes,
+                             std::size_t rebalanced,
+                             unsigned shift) = nullptr;
+
+    /*!
+     * Called when a node for `count` values with colliding hashes is
+     * made, either new or as a copy of another.
+     */
+    void (*collision_node)(std::size_t count) = nullptr;
+
+    /*!
+     * Called when a transient of `size` elements is made persistent.
+     */
+    void (*persistent)(std::size_t size) = nullptr;
+
+    /*!
+     * Called when releasing a vector or a map freed `nodes` nodes, when
+     * they are at least `release_threshold`.
+     */
+    void (*release)(std::size_t nodes) = nullptr;
+    std::size_t release_threshold      = 1024;
+
+    /*!
+     * Called along with `release`, with the `time` that freeing the
+     * `nodes` took.  The clock is only read when it is set.
+     */
+    void (*release_time)(std::size_t nodes,
+                         std::chrono::nanoseconds time) = nullptr;
+
+    /*!
+     * Called when a free list heap is empty and has to allocate a node
+     * of `size` bytes from the heap below it.
+     */
+    void (*free_list_miss)(std::size_t size) = nullptr;
+
+    static trace_hooks& get()
+    {
+        static trace_hooks hooks;
+        return hooks;
+    }
+};
+
+namespace detail {
+
+#if IMMER_TRACE_HOOKS
+
+// nodes of vectors freed by this thread so far
+inline std::size_t& trace_freed_nodes()
+{
+    thread_local std::size_t count = 0;
+    return count;
+}
+
+// calls the `release` hooks with the nodes that were freed while it
+// lived
+struct trace_release_scope
+{
+    using clock_t = std::chrono::steady_clock;
+
+    std::size_t first = trace_freed_nodes();
+    clock_t::time_point start = trace_hooks::get().release_time
+                                    ? clock_t::now()
+                                    : clock_t::time_point{};
+
+    ~trace_release_scope()
+    {
+        auto& h = trace_hooks::get();
+        auto n  = trace_freed_nodes() - first;
+        if (n < h.release_threshold)
+            return;
+        if (h.release)
+            h.release(n);
+        if (h.release_time && start != clock_t::time_point{})
+            h.release_time(n,
+                           std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               clock_t::now() - start));
+    }
+};
+
+#endif
+
+} // namespace detail
+} // namespace immer
+
+#if IMMER_TRACE_HOOKS
+#define IMMER_TRACE_HOOK(name, ...)                                            \
+    do {                                                                       \
+        if (auto immer_hook_ = ::immer::trace_hooks::get().name)               \
+            immer_hook_(__VA_ARGS__);                                          \
+    } while (false)
+#define IMMER_TRACE_FREED_NODE() (void) ++::immer::detail::trace_freed_nodes()
+#define IMMER_TRACE_RELEASE_SCOPE()                                            \
+    ::immer::detail::trace_release_scope immer_trace_release_scope_
+#else
+#define IMMER_TRACE_HOOK(name, ...)
+#define IMMER_TRACE_FREED_NODE()
+#define IMMER_TRACE_RELEASE_SCOPE()
+#endif
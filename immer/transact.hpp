@@ -0,0 +1,211 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/atom.hpp>
+#include <immer/config.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <thread>
+#include <tuple>
+#include <utility>
+
+namespace immer {
+
+namespace detail {
+
+struct transaction_access
+{
+    template <typename Atom>
+    static std::atomic<std::size_t>& version(const Atom& a)
+    {
+        return a.version_;
+    }
+};
+
+template <std::size_t N>
+struct transaction_versions
+{
+    std::array<std::atomic<std::size_t>*, N> words;
+    std::array<std::size_t, N> order;
+
+    template <typename... Atoms>
+    transaction_versions(const Atoms&... atoms)
+        : words{{&transaction_access::version(atoms)...}}
+    {
+        for (auto i = std::size_t{}; i < N; ++i)
+            order[i] = i;
+        // committers lock in the same order, so that the one that
+        // takes the first word always makes progress
+        std::sort(order.begin(), order.end(), [&](auto a, auto b) {
+            return std::less<void*>{}(words[a], words[b]);
+        });
+    }
+
+    std::array<std::size_t, N> read_stable() const
+    {
+        auto r = std::array<std::size_t, N>{};
+        for (auto i = std::size_t{}; i < N; ++i) {
+            r[i] = words[i]->load(std::memory_order_acquire);
+            while (r[i] & 1) {
+                std::this_thread::yield();
+                r[i] = words[i]->load(std::memory_order_acquire);
+            }
+        }
+        return r;
+    }
+
+    bool validate(const std::array<std::size_t, N>& vs) const
+    {
+        // a read-modify-write, so that the loads of the boxes before can
+        // not be moved after it
+        for (auto i = std::size_t{}; i < N; ++i)
+            if (words[i]->fetch_add(0, std::memory_order_acq_rel) != vs[i])
+                return false;
+        return true;
+    }
+
+    bool lock(const std::array<std::size_t, N>& vs)
+    {
+        for (auto j = std::size_t{}; j < N; ++j) {
+            auto i = order[j];
+            auto v = vs[i];
+            if (!words[i]->compare_exchange_strong(
+                    v, vs[i] + 1, std::memory_order_acq_rel)) {
+                while (j--)
+                    words[order[j]]->store(vs[order[j]],
+                                           std::memory_order_release);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void unlock(const std::array<std::size_t, N>& vs, std::size_t delta)
+    {
+        for (auto i = std::size_t{}; i < N; ++i)
+            words[i]->store(vs[i] + delta, std::memory_order_release);
+    }
+};
+
+template <typename... Atoms>
+std::tuple<typename Atoms::box_type...>
+snapshot_impl(const transaction_versions<sizeof...(Atoms)>& tv,
+              std::array<std::size_t, sizeof...(Atoms)>& vs,
+              const Atoms&... atoms)
+{
+    while (true) {
+        vs     = tv.read_stable();
+        auto r = std::make_tuple(atoms.load()...);
+        if (tv.validate(vs))
+            return r;
+    }
+}
+
+template <typename Olds, typename... Atoms, std::size_t... Is>
+bool unchanged(const Olds& olds, std::index_sequence<Is...>, Atoms&... atoms)
+{
+    auto r = true;
+    (void) std::initializer_list<int>{
+        (r = r && detail::box_identical(atoms.load(), std::get<Is>(olds)),
+         0)...};
+    return r;
+}
+
+template <typename Fn, typename... Atoms, std::size_t... Is>
+std::tuple<typename Atoms::box_type...>
+transact_impl(Fn&& fn, std::index_sequence<Is...> is, Atoms&... atoms)
+{
+    constexpr auto n = sizeof...(Atoms);
+    auto tv          = transaction_versions<n>{atoms...};
+    auto vs          = std::array<std::size_t, n>{};
+    while (true) {
+        auto olds = snapshot_impl(tv, vs, atoms...);
+        auto r    = fn(std::get<Is>(olds).get()...);
+        auto news = std::tuple<typename Atoms::box_type...>{
+            std::get<Is>(std::move(r))...};
+        if (!tv.lock(vs))
+            continue;
+        if (!unchanged(olds, is, atoms...)) {
+            tv.unlock(vs, 0);
+            continue;
+        }
+        (void) std::initializer_list<int>{
+            (atoms.store(std::get<Is>(news)), 0)...};
+        tv.unlock(vs, 2);
+        return news;
+    }
+}
+
+} // namespace detail
+
+/*!
+ * Atomically loads the values of several atoms: there is a point in
+ * time at which they all held the returned boxes, as far as `transact`
+ * is concerned.  It retries while a transaction commits to the atoms,
+ * but it never blocks them.
+ */
+template <typename... Atoms>
+std::tuple<typename Atoms::box_type...> snapshot(const Atoms&... atoms)
+{
+    constexpr auto n = sizeof...(Atoms);
+    auto tv          = detail::transaction_versions<n>{atoms...};
+    auto vs          = std::array<std::size_t, n>{};
+    return detail::snapshot_impl(tv, vs, atoms...);
+}
+
+/*!
+ * Updates the atoms `a` and `b` together, replacing their values `x`
+ * and `y` by the two elements of the tuple or pair returned by `fn(x,
+ * y)`.  Other threads see either both old values or both new ones,
+ * when they read them with `snapshot`.  It returns the new boxes.
+ *
+ * The values are read optimistically, so that `fn` runs without
+ * holding any lock.  Then, a short commit locks the atoms, checks that
+ * none changed meanwhile and stores the results.  When one did, it
+ * starts over, so like with `atom::update`, `fn` must have no side
+ * effects.  Since the containers are immutable, reading and checking
+ * them is cheap, whatever their size.
+ *
+ * @rst
+ *
+ * .. warning:: The atoms must be distinct, and once they take part in
+ *    transactions they should be written to with ``transact`` only.
+ *    A plain ``store`` or ``update`` is detected when it happens before
+ *    the commit, but one that races with the commit itself may be
+ *    lost.  Plain ``load`` is still fine, and it never waits, but it
+ *    may see the result of a transaction in one atom before the other.
+ *
+ * @endrst
+ */
+template <typename A, typename B, typename Fn>
+std::tuple<typename A::box_type, typename B::box_type>
+transact(A& a, B& b, Fn&& fn)
+{
+    return detail::transact_impl(
+        std::forward<Fn>(fn), std::make_index_sequence<2>{}, a, b);
+}
+
+/*!
+ * Like the other `transact`, but for three atoms.
+ */
+template <typename A, typename B, typename C, typename Fn>
+std::tuple<typename A::box_type, typename B::box_type, typename C::box_type>
+transact(A& a, B& b, C& c, Fn&& fn)
+{
+    return detail::transact_impl(
+        std::forward<Fn>(fn), std::make_index_sequence<3>{}, a, b, c);
+}
+
+} // namespace immer
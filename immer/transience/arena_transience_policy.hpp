@@ -0,0 +1,137 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+
+namespace immer {
+
+/*!
+ * Like @ref gc_transience_policy, but the edit token of every
+ * transient is an arena of an @ref arena_heap, from which the nodes
+ * that the transient creates are allocated.  When a transient is
+ * destroyed without having produced a persistent value, all the nodes
+ * it created are released at once.  Otherwise, the arena is handed
+ * over to the persistent values and a new one is used for the later
+ * changes of the transient.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    using memory = immer::memory_policy<
+ *        immer::heap_policy<immer::arena_heap<immer::gc_heap>>,
+ *        immer::no_refcount_policy,
+ *        immer::default_lock_policy,
+ *        immer::arena_transience_policy,
+ *        false>;
+ *
+ * .. warning:: The arenas that are handed over are only reclaimed by
+ *    the tracing garbage collector, so that this policy can only be
+ *    used along with a ``gc_heap``, as is the case for
+ *    ``gc_transience_policy``.  The collector must recognize interior
+ *    pointers, which is the default for ``libgc``.
+ *
+ * .. note:: Only the nodes of ``vector`` and ``flex_vector``
+ *    transients are allocated in the arenas.
+ *
+ * @endrst
+ */
+struct arena_transience_policy
+{
+    template <typename HeapPolicy>
+    struct apply
+    {
+        struct type
+        {
+            using heap_ = typename HeapPolicy::type;
+
+            struct edit
+            {
+                void* v;
+                edit(void* v_)
+                    : v{v_}
+                {}
+                edit() = delete;
+                bool operator==(edit x) const { return v == x.v; }
+                bool operator!=(edit x) const { return v != x.v; }
+            };
+
+            // the arena that an owner replaces is not discarded, since
+            // its nodes are now part of persistent values
+            struct owner
+            {
+                static void* make_token_() { return heap_::make_arena(); }
+
+                mutable std::atomic<void*> token_;
+
+                operator edit() { return {token_}; }
+
+                owner()
+                    : token_{make_token_()}
+                {}
+                owner(const owner& o)
+                    : token_{make_token_()}
+                {
+                    o.token_ = make_token_();
+                }
+                owner(owner&& o) noexcept
+                    : token_{o.token_.exchange(nullptr)}
+                {}
+                owner& operator=(const owner& o)
+                {
+                    o.token_ = make_token_();
+                    token_   = make_token_();
+                    return *this;
+                }
+                owner& operator=(owner&& o) noexcept
+                {
+                    token_ = o.token_.exchange(nullptr);
+                    return *this;
+                }
+                ~owner()
+                {
+                    if (auto t = token_.load())
+                        heap_::discard_arena(t);
+                }
+            };
+
+            struct ownee
+            {
+                edit token_{nullptr};
+
+                ownee& operator=(edit e)
+                {
+                    assert(e != noone);
+                    token_ = e;
+                    return *this;
+                }
+
+                bool can_mutate(edit t) const { return token_ == t; }
+                bool owned() const { return token_ != edit{nullptr}; }
+            };
+
+            template <typename Heap, typename... Tags>
+            static void* allocate(edit e, std::size_t size, Tags... tags)
+            {
+                return Heap::allocate_in(e.v, size, tags...);
+            }
+
+            static owner noone;
+        };
+    };
+};
+
+template <typename HP>
+typename arena_transience_policy::apply<HP>::type::owner
+    arena_transience_policy::apply<HP>::type::noone = {};
+
+} // namespace immer
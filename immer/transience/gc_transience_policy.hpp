@@ -8,17 +8,43 @@
 
 #pragma once
 
-#include <immer/heap/tags.hpp>
-
 #include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <utility>
 
 namespace immer {
 
+namespace detail {
+
+constexpr std::uint64_t gc_token_block = 1 << 16;
+
+// Returns an edit token that was never returned before.  Every thread
+// takes blocks of `gc_token_block` tokens from a global counter and
+// hands them out in order, so that making a token rarely touches memory
+// shared with other threads.  The tokens are 64 bit, so that they do not
+// wrap around in practice, and zero stands for no owner.
+inline std::uint64_t make_gc_token()
+{
+    static std::atomic<std::uint64_t> next_block{gc_token_block};
+    thread_local std::uint64_t next = 0;
+    thread_local std::uint64_t last = 0;
+    if (next == last) {
+        next = next_block.fetch_add(gc_token_block, std::memory_order_relaxed);
+        last = next + gc_token_block;
+    }
+    return next++;
+}
+
+} // namespace detail
+
 /*!
  * Provides transience ownership tracking when a *tracing garbage
- * collector* is used instead of reference counting.
+ * collector* is used instead of reference counting.  The edit tokens
+ * are numbers that are never reused, thus making, copying or
+ * persisting a transient does not allocate.
  *
  * @rst
  *
@@ -35,14 +61,15 @@ struct gc_transience_policy
     {
         struct type
         {
-            using heap_ = typename HeapPolicy::type;
-
             struct edit
             {
-                void* v;
-                edit(void* v_)
+                std::uint64_t v;
+                edit(std::uint64_t v_)
                     : v{v_}
                 {}
+                edit(std::nullptr_t)
+                    : v{0}
+                {}
                 edit() = delete;
                 bool operator==(edit x) const { return v == x.v; }
                 bool operator!=(edit x) const { return v != x.v; }
@@ -50,12 +77,12 @@ struct gc_transience_policy
 
             struct owner
             {
-                void* make_token_()
+                static std::uint64_t make_token_()
                 {
-                    return heap_::allocate(1, norefs_tag{});
-                };
+                    return detail::make_gc_token();
+                }
 
-                mutable std::atomic<void*> token_;
+                mutable std::atomic<std::uint64_t> token_;
 
                 operator edit() { return {token_}; }
 
@@ -81,6 +108,15 @@ struct gc_transience_policy
                     token_ = o.token_.load();
                     return *this;
                 }
+
+                // an owner that edits with `e`, along with the others
+                // that share it, used by @ref edit_session
+                static owner share(edit e)
+                {
+                    auto o   = owner{};
+                    o.token_ = e.v;
+                    return o;
+                }
             };
 
             struct ownee
@@ -101,6 +137,12 @@ struct gc_transience_policy
                 bool owned() const { return token_ != edit{nullptr}; }
             };
 
+            template <typename Heap, typename... Tags>
+            static void* allocate(edit, std::size_t size, Tags... tags)
+            {
+                return Heap::allocate(size, tags...);
+            }
+
             static owner noone;
         };
     };
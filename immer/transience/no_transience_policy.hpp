@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include <cstddef>
+
 namespace immer {
 
 /*!
@@ -27,6 +29,7 @@ struct no_transience_policy
             struct owner
             {
                 operator edit() const { return {}; }
+                static owner share(edit) { return {}; }
             };
 
             struct ownee
@@ -36,6 +39,12 @@ struct no_transience_policy
                 bool owned() const { return false; }
             };
 
+            template <typename Heap, typename... Tags>
+            static void* allocate(edit, std::size_t size, Tags... tags)
+            {
+                return Heap::allocate(size, tags...);
+            }
+
             static owner noone;
         };
     };
@@ -0,0 +1,97 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+
+#if IMMER_HAS_CPP17
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace immer {
+
+/*!
+ * Like @ref no_transience_policy, relying on *reference counting*, but
+ * every transient keeps the resource of the @ref pmr_heap that was
+ * current when it was made, and allocates its nodes from it during its
+ * whole life, even out of the @ref pmr_scope that set it.  The other
+ * operations allocate from the current resource.
+ *
+ * @rst
+ *
+ * .. note:: Only the nodes of ``vector`` and ``flex_vector``
+ *    transients are allocated from the resource of the transient, as
+ *    for @ref arena_transience_policy.
+ *
+ * @endrst
+ */
+struct pmr_transience_policy
+{
+    template <typename HeapPolicy>
+    struct apply
+    {
+        struct type
+        {
+            using heap_ = typename HeapPolicy::type;
+
+            // the operations on r-values pass an edit with no resource
+            struct edit
+            {
+                std::pmr::memory_resource* resource = nullptr;
+            };
+
+            // a transient keeps its resource when it is reset
+            struct owner
+            {
+                std::pmr::memory_resource* resource_ = heap_::current();
+
+                owner()                = default;
+                owner(const owner&)    = default;
+                owner(owner&&)         = default;
+                owner& operator=(const owner&) { return *this; }
+                owner& operator=(owner&&) { return *this; }
+
+                operator edit() const { return {resource_}; }
+
+                static owner share(edit e)
+                {
+                    auto o      = owner{};
+                    o.resource_ = e.resource;
+                    return o;
+                }
+            };
+
+            struct ownee
+            {
+                ownee& operator=(edit) { return *this; };
+                bool can_mutate(edit) const { return false; }
+                bool owned() const { return false; }
+            };
+
+            template <typename Heap, typename... Tags>
+            static void* allocate(edit e, std::size_t size, Tags... tags)
+            {
+                return e.resource ? Heap::allocate_in(e.resource, size, tags...)
+                                  : Heap::allocate(size, tags...);
+            }
+
+            static owner noone;
+        };
+    };
+};
+
+template <typename HP>
+typename pmr_transience_policy::apply<HP>::type::owner
+    pmr_transience_policy::apply<HP>::type::noone =
+        pmr_transience_policy::apply<HP>::type::owner::share({});
+
+} // namespace immer
+
+#endif // IMMER_HAS_CPP17
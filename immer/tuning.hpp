@@ -0,0 +1,155 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/hamts/bits.hpp>
+#include <immer/detail/rbts/bits.hpp>
+#include <immer/memory_policy.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+namespace immer {
+
+template <typename T,
+          typename MP,
+          detail::rbts::bits_t B,
+          detail::rbts::bits_t BL>
+class vector;
+
+template <typename T,
+          typename MP,
+          detail::rbts::bits_t B,
+          detail::rbts::bits_t BL>
+class flex_vector;
+
+template <typename K,
+          typename T,
+          typename Hash,
+          typename Equal,
+          typename MP,
+          detail::hamts::bits_t B>
+class map;
+
+template <typename T,
+          typename Hash,
+          typename Equal,
+          typename MP,
+          detail::hamts::bits_t B>
+class set;
+
+/*!
+ * Number of bytes that @a node_tuning aims for in every node.  It is
+ * set with the ``IMMER_TARGET_NODE_BYTES`` macro and the default keeps
+ * inner nodes of 32 pointers, as with the default branching factors.
+ */
+const auto default_node_bytes = std::size_t{IMMER_TARGET_NODE_BYTES};
+
+namespace detail {
+
+constexpr unsigned floor_log2(std::size_t x)
+{
+    return x > 1 ? 1 + floor_log2(x / 2) : 0;
+}
+
+constexpr unsigned clamp_bits(unsigned b, unsigned lo, unsigned hi)
+{
+    return b < lo ? lo : b > hi ? hi : b;
+}
+
+} // namespace detail
+
+/*!
+ * Compile-time choice of the branching factors for values of type
+ * `T`, such that the data of a node, without its header, takes around
+ * `NodeBytes` bytes.  Since the size of a type is a multiple of its
+ * alignment, over-aligned values get fewer per node.
+ *
+ * - `bits` is the `B` of ``vector`` and ``flex_vector``, whose inner
+ *   nodes hold pointers.  It is kept in @f$ [3, 7] @f$.
+ *
+ * - `bits_leaf` is their `BL`.  It fits as many values as the node
+ *   allows in a leaf, so it grows for small types and it shrinks down
+ *   to single value leaves for types larger than a node.
+ *
+ * - `champ_bits` is the `B` of ``map`` and ``set``, whose nodes embed
+ *   the values, that for a ``map`` are the key-value pairs.  It is
+ *   kept in @f$ [3, 6] @f$, the range supported by the bitmaps.
+ *
+ * The aliases @a tuned_vector, @a tuned_flex_vector, @a tuned_map and
+ * @a tuned_set apply it to the containers.
+ *
+ * @rst
+ *
+ * .. note:: The default ``BL`` of the vectors already sizes the
+ *    leaves like the inner nodes.  The tuning is useful to change
+ *    that target, or to derive ``B`` too.  Containers with different
+ *    parameters are different types.
+ *
+ * @endrst
+ */
+template <typename T, std::size_t NodeBytes = default_node_bytes>
+struct node_tuning
+{
+    static constexpr detail::rbts::bits_t bits = detail::clamp_bits(
+        detail::floor_log2(NodeBytes / sizeof(void*)), 3u, 7u);
+
+    static constexpr detail::rbts::bits_t bits_leaf =
+        detail::floor_log2(NodeBytes / sizeof(T));
+
+    static constexpr detail::hamts::bits_t champ_bits = detail::clamp_bits(
+        detail::floor_log2(NodeBytes / sizeof(T)), 3u, 6u);
+};
+
+template <typename T,
+          typename MemoryPolicy = default_memory_policy,
+          std::size_t NodeBytes = default_node_bytes>
+using tuned_vector =
+    vector<T,
+           MemoryPolicy,
+           node_tuning<T, NodeBytes>::bits,
+           node_tuning<T, NodeBytes>::bits_leaf>;
+
+template <typename T,
+          typename MemoryPolicy = default_memory_policy,
+          std::size_t NodeBytes = default_node_bytes>
+using tuned_flex_vector =
+    flex_vector<T,
+                MemoryPolicy,
+                node_tuning<T, NodeBytes>::bits,
+                node_tuning<T, NodeBytes>::bits_leaf>;
+
+template <typename K,
+          typename T,
+          typename Hash         = std::hash<K>,
+          typename Equal        = std::equal_to<K>,
+          typename MemoryPolicy = default_memory_policy,
+          std::size_t NodeBytes = default_node_bytes>
+using tuned_map = map<K,
+                      T,
+                      Hash,
+                      Equal,
+                      MemoryPolicy,
+                      node_tuning<std::pair<K, T>, NodeBytes>::champ_bits>;
+
+template <typename T,
+          typename Hash         = std::hash<T>,
+          typename Equal        = std::equal_to<T>,
+          typename MemoryPolicy = default_memory_policy,
+          std::size_t NodeBytes = default_node_bytes>
+using tuned_set =
+    set<T,
+        Hash,
+        Equal,
+        MemoryPolicy,
+        node_tuning<T, NodeBytes>::champ_bits>;
+
+} // namespace immer
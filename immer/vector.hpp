@@ -10,7 +10,13 @@
 
 #include <immer/detail/rbts/rbtree.hpp>
 #include <immer/detail/rbts/rbtree_iterator.hpp>
+#include <immer/executor.hpp>
 #include <immer/memory_policy.hpp>
+#include <immer/relocatable.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
 
 #if IMMER_DEBUG_PRINT
 #include <immer/flex_vector.hpp>
@@ -128,9 +134,31 @@ public:
         : impl_{impl_t::from_range(first, last)}
     {}
 
+    /*!
+     * Returns a vector containing the elements in the range defined by
+     * the random access iterators `first` and `last`.  The leaves and
+     * inner nodes of the result are built concurrently using the
+     * executor `ex` (see @ref executor), and the resulting tree is
+     * identical to the one built by the sequential range constructor.
+     */
+    template <typename Iter,
+              typename Executor = thread_executor,
+              std::enable_if_t<
+                  std::is_base_of<std::random_access_iterator_tag,
+                                  typename std::iterator_traits<
+                                      Iter>::iterator_category>::value,
+                  bool> = true>
+    IMMER_NODISCARD static vector
+    from_range_parallel(Iter first, Iter last, Executor&& ex = {})
+    {
+        return impl_t::from_range_parallel(first, last, ex);
+    }
+
     /*!
      * Constructs a vector containing the element `val` repeated `n`
-     * times.
+     * times.  All the full leaves, and all the full inner nodes of each
+     * level, are the same node, so it allocates @f$ O(log(n)) @f$
+     * memory.
      */
     vector(size_type n, T v = {})
         : impl_{impl_t::from_fill(n, v)}
@@ -213,6 +241,22 @@ public:
      */
     reference at(size_type index) const { return impl_.get_check(index); }
 
+    /*!
+     * Writes to the output iterator `out` the elements at the indices
+     * in the range `indices`, and returns the iterator past the last
+     * one written.  It is equivalent to using `operator[]` for every
+     * index, but the lookups are interleaved so that their cache misses
+     * overlap, which is faster for batches of indices on large vectors.
+     * Undefined for indices @f$ \geq size() @f$.
+     */
+    template <typename Indices, typename Out>
+    Out get_many(const Indices& indices, Out out) const
+    {
+        using std::begin;
+        using std::end;
+        return impl_.get_many(begin(indices), end(indices), out);
+    }
+
     /*!
      * Returns whether the vectors are equal.
      */
@@ -250,6 +294,49 @@ public:
         return push_back_move(move_t{}, std::move(value));
     }
 
+    /*!
+     * Returns a vector with a new element at the end, constructed in
+     * place with the arguments `args`.  Unlike `push_back`, no
+     * temporary `value_type` is made nor moved, which matters for
+     * values that are expensive to move.  It may allocate memory and
+     * its complexity is the one of `push_back`.
+     */
+    template <typename... Args>
+    IMMER_NODISCARD vector emplace_back(Args&&... args) const&
+    {
+        return impl_.emplace_back(std::forward<Args>(args)...);
+    }
+    template <typename... Args>
+    IMMER_NODISCARD decltype(auto) emplace_back(Args&&... args) &&
+    {
+        return emplace_back_move(move_t{}, std::forward<Args>(args)...);
+    }
+
+    /*!
+     * Returns a vector with the elements in the range defined by the
+     * input iterator `first` and range sentinel `last` inserted at the
+     * end.  It fills the leaves in place instead of copying the last one
+     * for every element, and its complexity is *effectively* @f$ O(n)
+     * @f$ for @f$ n @f$ elements.
+     */
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    IMMER_NODISCARD vector append(Iter first, Sent last) const&
+    {
+        return impl_.append(first, last);
+    }
+
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    IMMER_NODISCARD decltype(auto) append(Iter first, Sent last) &&
+    {
+        return append_move(move_t{}, first, last);
+    }
+
     /*!
      * Returns a vector containing value `value` at position `idx`.
      * Undefined for `index >= size()`.
@@ -277,6 +364,32 @@ public:
         return set_move(move_t{}, index, std::move(value));
     }
 
+    /*!
+     * Returns a vector with the value of every `(index, value)` pair in
+     * the range defined by the input iterator `first` and range
+     * sentinel `last` set at its index, where later pairs win.  Each
+     * node on the way to the updated positions is copied only once,
+     * and its complexity is *effectively* @f$ O(n) @f$ for @f$ n @f$
+     * pairs.  Undefined when an index is @f$ \geq size() @f$.
+     */
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    IMMER_NODISCARD vector set_many(Iter first, Sent last) const&
+    {
+        return impl_.assoc_many(first, last);
+    }
+
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    IMMER_NODISCARD decltype(auto) set_many(Iter first, Sent last) &&
+    {
+        return set_many_move(move_t{}, first, last);
+    }
+
     /*!
      * Returns a vector containing the result of the expression
      * `fn((*this)[idx])` at position `idx`.
@@ -307,6 +420,50 @@ public:
         return update_move(move_t{}, index, std::forward<FnT>(fn));
     }
 
+    /*!
+     * Like `set`, but when the element at `index` compares equal to
+     * `value` it returns the same vector, thus keeping its `identity()`,
+     * instead of copying the path to the element.  This way, the code
+     * that detects changes through the identity, like `diff` or a
+     * memoization cache, sees none.  Undefined for `index >= size()`.
+     */
+    IMMER_NODISCARD vector set_if_changed(size_type index,
+                                          value_type value) const&
+    {
+        if (impl_.get(index) == value)
+            return *this;
+        return impl_.assoc(index, std::move(value));
+    }
+
+    IMMER_NODISCARD decltype(auto) set_if_changed(size_type index,
+                                                  value_type value) &&
+    {
+        return set_if_changed_move(move_t{}, index, std::move(value));
+    }
+
+    /*!
+     * Like `update`, but when `fn((*this)[idx])` compares equal to the
+     * element it returns the same vector, like `set_if_changed`.
+     */
+    template <typename FnT>
+    IMMER_NODISCARD vector update_if_changed(size_type index,
+                                             FnT&& fn) const&
+    {
+        auto& x = impl_.get(index);
+        auto v  = std::forward<FnT>(fn)(x);
+        if (x == v)
+            return *this;
+        return impl_.assoc(index, std::move(v));
+    }
+
+    template <typename FnT>
+    IMMER_NODISCARD decltype(auto) update_if_changed(size_type index,
+                                                     FnT&& fn) &&
+    {
+        return update_if_changed_move(
+            move_t{}, index, std::forward<FnT>(fn));
+    }
+
     /*!
      * Returns a vector containing only the first `min(elems, size())`
      * elements. It may allocate memory and its complexity is
@@ -333,6 +490,21 @@ public:
         return take_move(move_t{}, elems);
     }
 
+    /*!
+     * Returns a vector without the last element, or an empty one when
+     * it is empty.  Only the tail is copied, or shrunk in place when
+     * called on an rvalue that owns it, except once every
+     * `branches<BL>` elements, when the last leaf becomes the tail and
+     * the path to it is copied.  Thus, its complexity is amortized
+     * @f$ O(1) @f$ and using a vector as a stack is cheap.
+     */
+    IMMER_NODISCARD vector pop_back() const& { return take(size() - 1); }
+
+    IMMER_NODISCARD decltype(auto) pop_back() &&
+    {
+        return take_move(move_t{}, size() - 1);
+    }
+
     /*!
      * Returns an @a transient form of this container, an
      * `immer::vector_transient`.
@@ -354,6 +526,16 @@ public:
     // Semi-private
     const impl_t& impl() const { return impl_; }
 
+    vector(impl_t impl)
+        : impl_(std::move(impl))
+    {
+#if IMMER_DEBUG_PRINT
+        // force the compiler to generate debug_print, so we can call
+        // it from a debugger
+        [](volatile auto) {}(&vector::debug_print);
+#endif
+    }
+
 #if IMMER_DEBUG_PRINT
     void debug_print(std::ostream& out = std::cerr) const
     {
@@ -365,16 +547,6 @@ private:
     friend flex_t;
     friend transient_type;
 
-    vector(impl_t impl)
-        : impl_(std::move(impl))
-    {
-#if IMMER_DEBUG_PRINT
-        // force the compiler to generate debug_print, so we can call
-        // it from a debugger
-        [](volatile auto) {}(&vector::debug_print);
-#endif
-    }
-
     vector&& push_back_move(std::true_type, value_type value)
     {
         impl_.push_back_mut({}, std::move(value));
@@ -385,6 +557,30 @@ private:
         return impl_.push_back(std::move(value));
     }
 
+    template <typename... Args>
+    vector&& emplace_back_move(std::true_type, Args&&... args)
+    {
+        impl_.emplace_back_mut({}, std::forward<Args>(args)...);
+        return std::move(*this);
+    }
+    template <typename... Args>
+    vector emplace_back_move(std::false_type, Args&&... args)
+    {
+        return impl_.emplace_back(std::forward<Args>(args)...);
+    }
+
+    template <typename Iter, typename Sent>
+    vector&& append_move(std::true_type, Iter first, Sent last)
+    {
+        impl_.append_mut({}, first, last);
+        return std::move(*this);
+    }
+    template <typename Iter, typename Sent>
+    vector append_move(std::false_type, Iter first, Sent last)
+    {
+        return impl_.append(first, last);
+    }
+
     vector&& set_move(std::true_type, size_type index, value_type value)
     {
         impl_.assoc_mut({}, index, std::move(value));
@@ -395,6 +591,18 @@ private:
         return impl_.assoc(index, std::move(value));
     }
 
+    template <typename Iter, typename Sent>
+    vector&& set_many_move(std::true_type, Iter first, Sent last)
+    {
+        impl_.assoc_many_mut({}, first, last);
+        return std::move(*this);
+    }
+    template <typename Iter, typename Sent>
+    vector set_many_move(std::false_type, Iter first, Sent last)
+    {
+        return impl_.assoc_many(first, last);
+    }
+
     template <typename Fn>
     vector&& update_move(std::true_type, size_type index, Fn&& fn)
     {
@@ -407,6 +615,34 @@ private:
         return impl_.update(index, std::forward<Fn>(fn));
     }
 
+    vector&&
+    set_if_changed_move(std::true_type, size_type index, value_type value)
+    {
+        if (!(impl_.get(index) == value))
+            impl_.assoc_mut({}, index, std::move(value));
+        return std::move(*this);
+    }
+    vector
+    set_if_changed_move(std::false_type, size_type index, value_type value)
+    {
+        return set_if_changed(index, std::move(value));
+    }
+
+    template <typename Fn>
+    vector&& update_if_changed_move(std::true_type, size_type index, Fn&& fn)
+    {
+        auto& x = impl_.get(index);
+        auto v  = std::forward<Fn>(fn)(x);
+        if (!(x == v))
+            impl_.assoc_mut({}, index, std::move(v));
+        return std::move(*this);
+    }
+    template <typename Fn>
+    vector update_if_changed_move(std::false_type, size_type index, Fn&& fn)
+    {
+        return update_if_changed(index, std::forward<Fn>(fn));
+    }
+
     vector&& take_move(std::true_type, size_type elems)
     {
         impl_.take_mut({}, elems);
@@ -420,4 +656,44 @@ private:
     impl_t impl_ = {};
 };
 
+/*!
+ * Returns a vector with the elements of `v` for which `pred` returns
+ * `true`, in the same order.  The longest prefix of `v` that is kept
+ * entirely is shared with the result, thus the cost is proportional to
+ * the number of elements after the first one that is removed.  Use a
+ * ``flex_vector`` to make it proportional to the removed elements.
+ */
+template <typename T,
+          typename MemoryPolicy,
+          detail::rbts::bits_t B,
+          detail::rbts::bits_t BL,
+          typename Pred>
+vector<T, MemoryPolicy, B, BL>
+filter(const vector<T, MemoryPolicy, B, BL>& v, Pred&& pred)
+{
+    auto first = std::size_t{};
+    v.impl().for_each_chunk_p([&](auto fst, auto lst) {
+        for (; fst != lst; ++fst, ++first)
+            if (!pred(*fst))
+                return false;
+        return true;
+    });
+    if (first == v.size())
+        return v;
+    auto r = v.take(first);
+    std::for_each(v.begin() + first + 1, v.end(), [&](const T& x) {
+        if (pred(x))
+            r = std::move(r).push_back(x);
+    });
+    return r;
+}
+
+// A vector only holds its size and pointers to its nodes.
+template <typename T,
+          typename MP,
+          detail::rbts::bits_t B,
+          detail::rbts::bits_t BL>
+struct is_trivially_relocatable<vector<T, MP, B, BL>> : std::true_type
+{};
+
 } // namespace immer
@@ -8,9 +8,11 @@
 
 #pragma once
 
+#include <immer/detail/rbts/cursor.hpp>
 #include <immer/detail/rbts/rbtree.hpp>
 #include <immer/detail/rbts/rbtree_iterator.hpp>
 #include <immer/memory_policy.hpp>
+#include <immer/trace.hpp>
 
 namespace immer {
 
@@ -62,6 +64,11 @@ public:
     using const_iterator   = iterator;
     using reverse_iterator = std::reverse_iterator<iterator>;
 
+    /*!
+     * The type of the cursors returned by `cursor_at()`.
+     */
+    using cursor = detail::rbts::cursor<impl_t>;
+
     using persistent_type = vector<T, MemoryPolicy, B, BL>;
 
     /*!
@@ -144,6 +151,32 @@ public:
         impl_.push_back_mut(*this, std::move(value));
     }
 
+    /*!
+     * Inserts a new element at the end, constructed in place with the
+     * arguments `args`.  It may allocate memory and its complexity is
+     * *effectively* @f$ O(1) @f$.
+     */
+    template <typename... Args>
+    void emplace_back(Args&&... args)
+    {
+        impl_.emplace_back_mut(*this, std::forward<Args>(args)...);
+    }
+
+    /*!
+     * Inserts the elements in the range defined by the input iterator
+     * `first` and range sentinel `last` at the end.  It may allocate
+     * memory and its complexity is *effectively* @f$ O(n) @f$ for @f$ n
+     * @f$ elements.
+     */
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    void append(Iter first, Sent last)
+    {
+        impl_.append_mut(*this, first, last);
+    }
+
     /*!
      * Sets to the value `value` at position `idx`.
      * Undefined for `index >= size()`.
@@ -155,6 +188,22 @@ public:
         impl_.assoc_mut(*this, index, std::move(value));
     }
 
+    /*!
+     * Sets the value of every `(index, value)` pair in the range
+     * defined by the input iterator `first` and range sentinel `last`
+     * at its index, where later pairs win.  Undefined when an index is
+     * @f$ \geq size() @f$.  It may allocate memory and its complexity
+     * is *effectively* @f$ O(n) @f$ for @f$ n @f$ pairs.
+     */
+    template <typename Iter,
+              typename Sent,
+              std::enable_if_t<detail::compatible_sentinel_v<Iter, Sent>,
+                               bool> = true>
+    void set_many(Iter first, Sent last)
+    {
+        impl_.assoc_many_mut(*this, first, last);
+    }
+
     /*!
      * Updates the vector to contain the result of the expression
      * `fn((*this)[idx])` at position `idx`.
@@ -168,6 +217,55 @@ public:
         impl_.update_mut(*this, index, std::forward<FnT>(fn));
     }
 
+    /*!
+     * Calls `fn(first, last)` with pointers to the elements, in order,
+     * a leaf at a time, which can be changed in place.  The leaves and
+     * the nodes on the path to them that are shared with other
+     * containers are copied first.  The pointers are invalidated by any
+     * other change to the transient.  It may allocate memory and its
+     * complexity is *effectively* @f$ O(n) @f$.
+     */
+    template <typename Fn>
+    void for_each_chunk_mut(Fn&& fn)
+    {
+        impl_.for_each_chunk_mut(*this, 0, impl_.size, fn);
+    }
+
+    /*!
+     * Sets every element `x` with index in `[first, last)` to `fn(x)`,
+     * like `update`, but visiting the leaves only once, through
+     * `for_each_chunk_mut`.  Undefined for `last > size()`.
+     */
+    template <typename Fn>
+    void update_range(size_type first, size_type last, Fn&& fn)
+    {
+        impl_.for_each_chunk_mut(*this, first, last, [&](auto f, auto l) {
+            for (; f != l; ++f)
+                *f = fn(std::move(*f));
+        });
+    }
+
+    /*!
+     * Returns a cursor at position `index`, that reads the element
+     * there with `get()` and changes it in place with `set(value)` and
+     * `update(fn)`.  It is moved with `++`, `--`, `+=`, `-=` and
+     * `seek(index)`, and tells where it is with `index()`.  The cursor
+     * remembers the leaf it is in, so that moving within it and
+     * changing its elements is @f$ O(1) @f$, and it only descends the
+     * tree again when it crosses to another leaf.
+     *
+     * @rst
+     *
+     * .. warning:: The cursor is invalidated by any other change to the
+     *    transient, and by calling ``persistent()`` on it.
+     *
+     * @endrst
+     */
+    IMMER_NODISCARD cursor cursor_at(size_type index)
+    {
+        return {impl_, *this, index};
+    }
+
     /*!
      * Resizes the vector to only contain the first `min(elems, size())`
      * elements. It may allocate memory and its complexity is
@@ -175,16 +273,45 @@ public:
      */
     void take(size_type elems) { impl_.take_mut(*this, elems); }
 
+    /*!
+     * Removes the last element, if any.  The tail is shrunk in place,
+     * so its complexity is amortized @f$ O(1) @f$.
+     */
+    void pop_back() { take(size() - 1); }
+
+    /*!
+     * Resizes the vector to contain `n` elements, removing the ones
+     * past `n` or appending copies of `v` at the end.  The full leaves
+     * of appended copies are a single shared node, so it allocates
+     * @f$ O(n / 2^{B + BL}) @f$ memory, and they are copied, as usual,
+     * when they are changed later.
+     */
+    void resize(size_type n, value_type v = {})
+    {
+        if (n <= impl_.size)
+            impl_.take_mut(*this, n);
+        else
+            impl_.fill_back_mut(*this, n - impl_.size, v);
+    }
+
     /*!
      * Returns an @a immutable form of this container, an
      * `immer::vector`.
      */
     IMMER_NODISCARD persistent_type persistent() &
     {
+        IMMER_TRACE_HOOK(persistent, impl_.size);
         this->owner_t::operator=(owner_t{});
         return impl_;
     }
-    IMMER_NODISCARD persistent_type persistent() && { return std::move(impl_); }
+    IMMER_NODISCARD persistent_type persistent() &&
+    {
+        // the nodes that were created under the current edit are now
+        // part of the persistent value
+        IMMER_TRACE_HOOK(persistent, impl_.size);
+        this->owner_t::operator=(owner_t{});
+        return std::move(impl_);
+    }
 
 private:
     friend flex_t;
@@ -194,6 +321,14 @@ private:
         : impl_(std::move(impl))
     {}
 
+    template <typename MP>
+    friend class edit_session;
+
+    vector_transient(impl_t impl, owner_t owner)
+        : owner_t(std::move(owner))
+        , impl_(std::move(impl))
+    {}
+
     impl_t impl_ = {};
 };
 
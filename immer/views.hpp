@@ -0,0 +1,443 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/algorithm.hpp>
+#include <immer/config.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace immer {
+namespace views {
+
+namespace detail {
+
+// whether a stage can write its output with plain assignments into a
+// buffer that is sized upfront, a loop that compilers vectorize
+template <typename T>
+using assignable_buffer_t =
+    std::integral_constant<bool,
+                           std::is_trivially_default_constructible<T>::value &&
+                               std::is_trivially_copy_assignable<T>::value>;
+
+template <typename T, typename = void>
+struct is_stage : std::false_type
+{};
+
+template <typename T>
+struct is_stage<T, std::enable_if_t<T::is_view_stage>> : std::true_type
+{};
+
+} // namespace detail
+
+/*!
+ * Stage applying `fn` to every element.  See @a views::transform.
+ */
+template <typename Fn>
+struct transform_stage
+{
+    static constexpr bool is_view_stage = true;
+
+    Fn fn;
+
+    template <typename T>
+    using output_t = std::decay_t<decltype(std::declval<const Fn&>()(
+        std::declval<const T&>()))>;
+
+    template <typename T, typename Next>
+    struct consumer
+    {
+        using U = output_t<T>;
+
+        Fn fn;
+        Next next;
+        std::vector<U> buf;
+
+        bool operator()(const T* f, const T* l)
+        {
+            fill(f, l, detail::assignable_buffer_t<U>{});
+            return next(as_const(buf.data()),
+                        as_const(buf.data() + buf.size()));
+        }
+
+        void fill(const T* f, const T* l, std::true_type)
+        {
+            auto n = static_cast<std::size_t>(l - f);
+            buf.resize(n);
+            auto out = buf.data();
+            for (auto i = std::size_t{}; i < n; ++i)
+                out[i] = fn(f[i]);
+        }
+
+        void fill(const T* f, const T* l, std::false_type)
+        {
+            buf.clear();
+            for (; f != l; ++f)
+                buf.push_back(fn(*f));
+        }
+
+        static const U* as_const(U* p) { return p; }
+    };
+
+    template <typename T, typename Next>
+    consumer<T, Next> bind(Next next) const
+    {
+        return {fn, std::move(next), {}};
+    }
+};
+
+/*!
+ * Stage keeping the elements that satisfy `pred`.  See @a
+ * views::filter.
+ */
+template <typename Pred>
+struct filter_stage
+{
+    static constexpr bool is_view_stage = true;
+
+    Pred pred;
+
+    template <typename T>
+    using output_t = T;
+
+    template <typename T, typename Next>
+    struct consumer
+    {
+        Pred pred;
+        Next next;
+        std::vector<T> buf;
+
+        bool operator()(const T* f, const T* l)
+        {
+            fill(f, l, detail::assignable_buffer_t<T>{});
+            const T* data = buf.data();
+            return buf.empty() || next(data, data + buf.size());
+        }
+
+        void fill(const T* f, const T* l, std::true_type)
+        {
+            // branchless compaction, every element is written and the
+            // end of the output only advances past the kept ones
+            buf.resize(static_cast<std::size_t>(l - f));
+            auto out = buf.data();
+            auto n   = std::size_t{};
+            for (; f != l; ++f) {
+                out[n] = *f;
+                n += pred(*f) ? 1 : 0;
+            }
+            buf.resize(n);
+        }
+
+        void fill(const T* f, const T* l, std::false_type)
+        {
+            buf.clear();
+            for (; f != l; ++f)
+                if (pred(*f))
+                    buf.push_back(*f);
+        }
+    };
+
+    template <typename T, typename Next>
+    consumer<T, Next> bind(Next next) const
+    {
+        return {pred, std::move(next), {}};
+    }
+};
+
+/*!
+ * Stage keeping the first `n` elements.  See @a views::take.
+ */
+struct take_stage
+{
+    static constexpr bool is_view_stage = true;
+
+    std::size_t n;
+
+    template <typename T>
+    using output_t = T;
+
+    template <typename T, typename Next>
+    struct consumer
+    {
+        std::size_t left;
+        Next next;
+
+        bool operator()(const T* f, const T* l)
+        {
+            auto k = std::min(left, static_cast<std::size_t>(l - f));
+            left -= k;
+            return (!k || next(f, f + k)) && left;
+        }
+    };
+
+    template <typename T, typename Next>
+    consumer<T, Next> bind(Next next) const
+    {
+        return {n, std::move(next)};
+    }
+};
+
+/*!
+ * Stage skipping the first `n` elements.  See @a views::drop.
+ */
+struct drop_stage
+{
+    static constexpr bool is_view_stage = true;
+
+    std::size_t n;
+
+    template <typename T>
+    using output_t = T;
+
+    template <typename T, typename Next>
+    struct consumer
+    {
+        std::size_t left;
+        Next next;
+
+        bool operator()(const T* f, const T* l)
+        {
+            auto k = std::min(left, static_cast<std::size_t>(l - f));
+            left -= k;
+            return f + k == l || next(f + k, l);
+        }
+    };
+
+    template <typename T, typename Next>
+    consumer<T, Next> bind(Next next) const
+    {
+        return {n, std::move(next)};
+    }
+};
+
+namespace detail {
+
+template <typename T, typename... Stages>
+struct output;
+
+template <typename T>
+struct output<T>
+{
+    using type = T;
+};
+
+template <typename T, typename Stage, typename... Stages>
+struct output<T, Stage, Stages...>
+{
+    using type = typename output<typename Stage::template output_t<T>,
+                                 Stages...>::type;
+};
+
+template <std::size_t I, typename T, typename Tuple, typename Fn>
+auto bind_stages(const Tuple&, Fn fn, std::true_type)
+{
+    return fn;
+}
+
+template <std::size_t I, typename T, typename Tuple, typename Fn>
+auto bind_stages(const Tuple& stages, Fn fn, std::false_type)
+{
+    using stage_t = std::tuple_element_t<I, Tuple>;
+    using next_t  = typename stage_t::template output_t<T>;
+    constexpr auto last = I + 1 == std::tuple_size<Tuple>::value;
+    return std::get<I>(stages).template bind<T>(bind_stages<I + 1, next_t>(
+        stages, std::move(fn), std::integral_constant<bool, last>{}));
+}
+
+} // namespace detail
+
+/*!
+ * A lazy pipeline of stages over the immutable sequence `Source`, a
+ * ``vector``, ``flex_vector``, ``array`` or a view of them.  Nothing
+ * is computed until it is traversed, and then every stage runs over a
+ * whole leaf of the source at a time, writing to a buffer that is
+ * reused from leaf to leaf.  Thus the stages are fused, no
+ * intermediate container is made, and the loop of every stage is a
+ * tight loop over contiguous memory that the compiler can vectorize.
+ *
+ * Views are made by piping a container into adaptors like @a
+ * views::transform, @a views::filter, @a views::take and @a
+ * views::drop, and consumed with `for_each_chunk`, @a views::into or
+ * @a views::accumulate.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    namespace v = immer::views;
+ *    auto r = v::into<immer::vector<int>>(
+ *        vec | v::transform([](int x) { return x * 3; })
+ *            | v::filter([](int x) { return x % 2 == 0; })
+ *            | v::take(100));
+ *
+ * .. note:: The view holds a copy of the source, which is cheap, and
+ *    of the functions of the stages.  It can be traversed many times.
+ *
+ * @endrst
+ */
+template <typename Source, typename... Stages>
+class view
+{
+public:
+    using source_type = Source;
+    using value_type  = typename detail::
+        output<typename Source::value_type, Stages...>::type;
+
+    view(Source src, std::tuple<Stages...> stages)
+        : src_{std::move(src)}
+        , stages_{std::move(stages)}
+    {}
+
+    /*!
+     * Calls `fn(first, last)` with consecutive ranges of `const
+     * value_type*` that, together, contain the elements of the view
+     * in order.  When `fn` returns a `bool`, returning `false` stops
+     * the traversal.  The result is `false` when the traversal stopped
+     * early, because of `fn` or of a stage like @a views::take.
+     */
+    template <typename Fn>
+    bool for_each_chunk_p(Fn&& fn) const
+    {
+        using T = typename Source::value_type;
+        auto c  = detail::bind_stages<0, T>(
+            stages_,
+            [&](const value_type* f, const value_type* l) {
+                return call(fn, f, l);
+            },
+            std::integral_constant<bool, sizeof...(Stages) == 0>{});
+        return traverse(src_, c);
+    }
+
+    template <typename Fn>
+    void for_each_chunk(Fn&& fn) const
+    {
+        for_each_chunk_p(std::forward<Fn>(fn));
+    }
+
+    /*!
+     * Returns a view that applies `stage` after all the current ones.
+     */
+    template <typename Stage,
+              std::enable_if_t<detail::is_stage<Stage>::value, bool> = true>
+    friend view<Source, Stages..., Stage> operator|(view v, Stage stage)
+    {
+        return {std::move(v.src_),
+                std::tuple_cat(std::move(v.stages_),
+                               std::make_tuple(std::move(stage)))};
+    }
+
+private:
+    template <typename Fn, typename T>
+    static auto call(Fn& fn, const T* f, const T* l)
+        -> std::enable_if_t<std::is_same<decltype(fn(f, l)), bool>::value,
+                            bool>
+    {
+        return fn(f, l);
+    }
+
+    template <typename Fn, typename T>
+    static auto call(Fn& fn, const T* f, const T* l)
+        -> std::enable_if_t<!std::is_same<decltype(fn(f, l)), bool>::value,
+                            bool>
+    {
+        fn(f, l);
+        return true;
+    }
+
+    template <typename S, typename... Ss, typename C>
+    static bool traverse(const view<S, Ss...>& v, C& c)
+    {
+        return v.for_each_chunk_p(c);
+    }
+
+    template <typename S, typename C>
+    static bool traverse(const S& s, C& c)
+    {
+        return immer::for_each_chunk_p(
+            s, [&](auto f, auto l) { return c(f, l); });
+    }
+
+    Source src_;
+    std::tuple<Stages...> stages_;
+};
+
+/*!
+ * Starts a pipeline with the stage `stage` over `src`.
+ */
+template <typename Source,
+          typename Stage,
+          std::enable_if_t<detail::is_stage<Stage>::value, bool> = true>
+view<Source, Stage> operator|(const Source& src, Stage stage)
+{
+    return {src, std::make_tuple(std::move(stage))};
+}
+
+/*!
+ * Returns a stage that applies `fn` to every element.
+ */
+template <typename Fn>
+transform_stage<std::decay_t<Fn>> transform(Fn&& fn)
+{
+    return {std::forward<Fn>(fn)};
+}
+
+/*!
+ * Returns a stage that keeps the elements satisfying `pred`.
+ */
+template <typename Pred>
+filter_stage<std::decay_t<Pred>> filter(Pred&& pred)
+{
+    return {std::forward<Pred>(pred)};
+}
+
+/*!
+ * Returns a stage that keeps the first `n` elements and stops the
+ * traversal of the source after them.
+ */
+inline take_stage take(std::size_t n) { return {n}; }
+
+/*!
+ * Returns a stage that skips the first `n` elements.
+ */
+inline drop_stage drop(std::size_t n) { return {n}; }
+
+/*!
+ * Evaluates the view `v` into a new sequence of type `Container`, like
+ * ``vector`` or ``flex_vector``.  Every chunk is appended at once to a
+ * transient, thus nothing but the result is allocated.
+ */
+template <typename Container, typename View>
+Container into(const View& v)
+{
+    auto t = Container{}.transient();
+    v.for_each_chunk([&](auto f, auto l) { t.append(f, l); });
+    return std::move(t).persistent();
+}
+
+/*!
+ * Folds the elements of the view `v` with `op`, starting from `init`.
+ */
+template <typename View, typename T, typename Op = std::plus<>>
+T accumulate(const View& v, T init, Op op = {})
+{
+    v.for_each_chunk([&](auto f, auto l) {
+        for (; f != l; ++f)
+            init = op(std::move(init), *f);
+    });
+    return init;
+}
+
+} // namespace views
+} // namespace immer
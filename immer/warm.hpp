@@ -0,0 +1,273 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+#include <immer/detail/hamts/champ.hpp>
+#include <immer/detail/rbts/rbtree.hpp>
+#include <immer/detail/rbts/rrbtree.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define IMMER_WARM_MADVISE 1
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#define IMMER_WARM_MADVISE 0
+#endif
+
+namespace immer {
+namespace detail {
+namespace warm {
+
+constexpr std::size_t cache_line = 64;
+
+struct span
+{
+    const char* data;
+    std::size_t size;
+};
+
+inline std::size_t page_size()
+{
+#if IMMER_WARM_MADVISE
+    static const auto size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    return size;
+#else
+    return 4096;
+#endif
+}
+
+// Asks the system to read ahead the pages of the spans, merging those
+// that are next to each other in a single call.
+inline void advise(const std::vector<span>& spans)
+{
+#if IMMER_WARM_MADVISE
+    auto page  = page_size();
+    auto pages = std::vector<std::pair<std::uintptr_t, std::uintptr_t>>{};
+    pages.reserve(spans.size());
+    for (auto& s : spans) {
+        auto first = reinterpret_cast<std::uintptr_t>(s.data);
+        pages.emplace_back(first & ~(page - 1),
+                           (first + s.size + page - 1) & ~(page - 1));
+    }
+    std::sort(pages.begin(), pages.end());
+    for (auto i = std::size_t{}; i < pages.size();) {
+        auto first = pages[i].first;
+        auto last  = pages[i].second;
+        for (++i; i < pages.size() && pages[i].first <= last; ++i)
+            last = std::max(last, pages[i].second);
+        // the memory of the nodes may not be a mapping that supports
+        // it, which is fine, the pages are touched anyway
+        ::madvise(reinterpret_cast<void*>(first), last - first, MADV_WILLNEED);
+    }
+#else
+    (void) spans;
+#endif
+}
+
+// Reads a byte of every page of the spans, so that they are faulted
+// in, and prefetches all their cache lines.
+inline void touch(const std::vector<span>& spans)
+{
+    static volatile char sink;
+    auto page = page_size();
+    auto sum  = char{};
+    for (auto& s : spans) {
+        for (auto off = std::size_t{}; off < s.size; off += cache_line)
+            IMMER_PREFETCH_READ(s.data + off);
+        for (auto off = std::size_t{}; off < s.size; off += page)
+            sum += *static_cast<const volatile char*>(s.data + off);
+    }
+    sink = sum;
+    (void) sink;
+}
+
+// Warms the nodes level by level, starting with `level`, until
+// `budget` bytes are warmed.  `spans_of(item, add)` calls `add(data,
+// size)` for every block of memory of a node, and `expand(item, next)`
+// adds its children to the next level.  Returns the bytes warmed.
+template <typename Item, typename SpansOf, typename Expand>
+std::size_t breadth_first(std::vector<Item> level,
+                          std::size_t budget,
+                          SpansOf spans_of,
+                          Expand expand)
+{
+    auto warmed = std::size_t{};
+    auto spans  = std::vector<span>{};
+    auto next   = std::vector<Item>{};
+    while (!level.empty() && warmed < budget) {
+        auto n = std::size_t{};
+        spans.clear();
+        for (; n < level.size() && warmed < budget; ++n)
+            spans_of(level[n], [&](const void* data, std::size_t size) {
+                spans.push_back({static_cast<const char*>(data), size});
+                warmed += size;
+            });
+        advise(spans);
+        touch(spans);
+        next.clear();
+        for (auto i = std::size_t{}; i < n; ++i)
+            expand(level[i], next);
+        std::swap(level, next);
+    }
+    return warmed;
+}
+
+template <typename Node>
+struct rbts_item
+{
+    Node* node;
+    // zero for the leaves
+    rbts::shift_t shift;
+    std::size_t size;
+};
+
+template <typename Tree>
+std::size_t warm_rbts(const Tree& t, std::size_t budget)
+{
+    using namespace rbts;
+    using node_t = typename Tree::node_t;
+    using item_t = rbts_item<node_t>;
+    constexpr auto B  = node_t::bits;
+    constexpr auto BL = node_t::bits_leaf;
+
+    auto tail_off = t.tail_offset();
+    auto spans_of = [](const item_t& x, auto add) {
+        auto n = x.node;
+        if (!x.shift)
+            return add(n, node_t::sizeof_leaf_n(static_cast<count_t>(x.size)));
+        if (auto r = n->relaxed()) {
+            add(n, node_t::sizeof_inner_r_n(r->d.count));
+            if (!node_t::embed_relaxed)
+                add(r, node_t::sizeof_relaxed_n(r->d.count));
+        } else {
+            auto count = x.size ? ((x.size - 1) >> x.shift) + 1 : 0;
+            add(n, node_t::sizeof_inner_n(static_cast<count_t>(count)));
+        }
+    };
+    auto expand = [](const item_t& x, std::vector<item_t>& next) {
+        if (!x.shift)
+            return;
+        auto n     = x.node;
+        auto shift = x.shift == BL ? shift_t{} : shift_t(x.shift - B);
+        if (auto r = n->relaxed()) {
+            auto prev = std::size_t{};
+            for (auto i = count_t{}; i < r->d.count; ++i) {
+                next.push_back({n->inner()[i], shift, r->d.sizes[i] - prev});
+                prev = r->d.sizes[i];
+            }
+        } else {
+            auto cap   = std::size_t{1} << x.shift;
+            auto count = x.size ? ((x.size - 1) >> x.shift) + 1 : 0;
+            for (auto i = std::size_t{}; i < count; ++i)
+                next.push_back(
+                    {n->inner()[i], shift, std::min(cap, x.size - i * cap)});
+        }
+    };
+    return breadth_first(
+        std::vector<item_t>{{t.root, t.shift, tail_off},
+                            {t.tail, 0, t.size - tail_off}},
+        budget,
+        spans_of,
+        expand);
+}
+
+template <typename T, typename MP, rbts::bits_t B, rbts::bits_t BL>
+std::size_t warm(const rbts::rbtree<T, MP, B, BL>& t, std::size_t budget)
+{
+    return warm_rbts(t, budget);
+}
+
+template <typename T, typename MP, rbts::bits_t B, rbts::bits_t BL>
+std::size_t warm(const rbts::rrbtree<T, MP, B, BL>& t, std::size_t budget)
+{
+    return warm_rbts(t, budget);
+}
+
+template <typename T,
+          typename Hash,
+          typename Equal,
+          typename MP,
+          hamts::bits_t B>
+std::size_t warm(const hamts::champ<T, Hash, Equal, MP, B>& t,
+                 std::size_t budget)
+{
+    using namespace hamts;
+    using node_t = typename champ<T, Hash, Equal, MP, B>::node_t;
+    using item_t = std::pair<node_t*, count_t>;
+
+    auto spans_of = [](const item_t& x, auto add) {
+        auto n = x.first;
+        if (x.second == max_depth<B>)
+            return add(n, node_t::sizeof_collision_n(n->collision_count()));
+        auto nc = n->children_count();
+        auto nv = n->data_count();
+        if (nv && node_t::embeds_values(n, nc))
+            add(n, node_t::sizeof_inner_n(nc, nv));
+        else {
+            add(n, node_t::sizeof_inner_n(nc));
+            if (nv)
+                add(n->impl.d.data.inner.values, node_t::sizeof_values_n(nv));
+        }
+    };
+    auto expand = [](const item_t& x, std::vector<item_t>& next) {
+        if (x.second == max_depth<B>)
+            return;
+        auto n  = x.first;
+        auto nc = n->children_count();
+        for (auto i = count_t{}; i < nc; ++i)
+            next.emplace_back(n->children()[i], x.second + 1);
+    };
+    return breadth_first(
+        std::vector<item_t>{{t.root, 0}}, budget, spans_of, expand);
+}
+
+} // namespace warm
+} // namespace detail
+
+/*!
+ * Brings the nodes of the container `c` into memory and into the
+ * caches, level by level from the root down, until `budget` bytes have
+ * been warmed, and returns how many were.  It supports @ref vector,
+ * @ref flex_vector, @ref map, @ref set and @ref table.
+ *
+ * For every level, it asks the system to read ahead the pages of its
+ * nodes, with ``madvise(MADV_WILLNEED)`` where it is available, reads
+ * a byte of every page and prefetches every cache line of them.  Thus,
+ * after loading a snapshot or opening an @ref image, a budget of a few
+ * megabytes makes the upper levels, that every lookup goes through,
+ * resident before the container starts to serve queries.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    auto img   = immer::image{"index.img"};
+ *    auto index = img.root<index_map>(0);
+ *    immer::warm(index, 64 << 20);
+ *    serve(index);
+ *
+ * @endrst
+ */
+template <typename Container>
+std::size_t
+warm(const Container& c,
+     std::size_t budget = std::numeric_limits<std::size_t>::max())
+{
+    return detail::warm::warm(c.impl(), budget);
+}
+
+} // namespace immer
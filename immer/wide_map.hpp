@@ -0,0 +1,412 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/array.hpp>
+#include <immer/config.hpp>
+#include <immer/detail/iterator_facade.hpp>
+#include <immer/map.hpp>
+#include <immer/memory_policy.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+namespace immer {
+
+namespace detail {
+namespace wide {
+
+// The hash of the keys of the maps in the slots, where the bits that
+// choose the slot are dropped, so that the tries of the slots do not
+// spend their top levels on bits that all their keys share.
+template <typename Hash, unsigned Bits>
+struct shifted_hash
+{
+    template <typename K>
+    std::size_t operator()(const K& k) const
+    {
+        return Hash{}(k) >> Bits;
+    }
+};
+
+// Iterates over the maps of the slots one after the other, skipping
+// the empty ones.
+template <typename Map>
+struct iterator
+    : iterator_facade<iterator<Map>,
+                      std::forward_iterator_tag,
+                      typename Map::value_type,
+                      typename Map::reference,
+                      std::ptrdiff_t,
+                      const typename Map::value_type*>
+{
+    iterator() = default;
+
+    iterator(const Map* slot, const Map* last)
+        : slot_{slot}
+        , last_{last}
+    {
+        skip_empty();
+    }
+
+private:
+    friend iterator_core_access;
+
+    const Map* slot_ = nullptr;
+    const Map* last_ = nullptr;
+    typename Map::iterator it_{};
+
+    void skip_empty()
+    {
+        while (slot_ != last_ && slot_->empty())
+            ++slot_;
+        if (slot_ != last_)
+            it_ = slot_->begin();
+    }
+
+    void increment()
+    {
+        if (++it_ == slot_->end()) {
+            ++slot_;
+            skip_empty();
+        }
+    }
+
+    bool equal(const iterator& other) const
+    {
+        return slot_ == other.slot_ && (slot_ == last_ || it_ == other.it_);
+    }
+
+    typename Map::reference dereference() const { return *it_; }
+};
+
+} // namespace wide
+} // namespace detail
+
+/*!
+ * Immutable unordered mapping of values from type `K` to type `T`,
+ * whose root is a flat array of @f$ 2^{RootBits} @f$ slots, indexed
+ * directly with the lowest bits of the hash of the keys, that hold a
+ * @ref map each.
+ *
+ * @tparam K    The type of the keys.
+ * @tparam T    The type of the values to be stored in the container.
+ * @tparam Hash The type of a function object capable of hashing
+ *              values of type `K`.
+ * @tparam Equal The type of a function object capable of comparing
+ *              values of type `K`.
+ * @tparam MemoryPolicy Memory management policy. See @ref
+ *              memory_policy.
+ * @tparam B The bits of the hash consumed by every level of the tries
+ *              of the slots.
+ * @tparam RootBits The bits of the hash that choose the slot.
+ *
+ * @rst
+ *
+ * A lookup in a :cpp:class:`immer::map` of :math:`n` entries visits
+ * :math:`log_{2^B}(n)` nodes, one after the other.  Here, the first
+ * ``RootBits`` bits of the hash are resolved by a single access to the
+ * root array, which takes the place of about ``RootBits / B`` levels
+ * of the trie, and the rest are resolved by the trie of the slot, that
+ * only holds the keys of the slot.  For a map of many millions of
+ * entries and the default ``RootBits = 10`` and ``B = 5``, this saves
+ * two dependent memory accesses per lookup.
+ *
+ * The price is that an update of a map that is shared copies the whole
+ * root, which is :math:`2^{RootBits}` maps.  When the wide map is an
+ * rvalue that is not shared, and the memory policy allows it, the root
+ * is updated in place instead, thus it is best built and changed
+ * through ``std::move``.  An empty wide map does not allocate the root
+ * until the first insertion.
+ *
+ * .. code-block:: c++
+ *
+ *    auto m = immer::wide_map<std::string, int>{};
+ *    for (auto& w : words)
+ *        m = std::move(m).update(w, [](int n) { return n + 1; });
+ *
+ * @endrst
+ */
+template <typename K,
+          typename T,
+          typename Hash           = container_hash<K>,
+          typename Equal          = std::equal_to<K>,
+          typename MemoryPolicy   = default_memory_policy,
+          detail::hamts::bits_t B = default_bits,
+          unsigned RootBits       = 10>
+class wide_map
+{
+    using hash_t = detail::wide::shifted_hash<Hash, RootBits>;
+
+public:
+    using slot_type  = map<K, T, hash_t, Equal, MemoryPolicy, B>;
+    using slots_type = array<slot_type, MemoryPolicy>;
+
+    using key_type        = K;
+    using mapped_type     = T;
+    using value_type      = std::pair<K, T>;
+    using size_type       = detail::hamts::size_t;
+    using difference_type = std::ptrdiff_t;
+    using hasher          = Hash;
+    using key_equal       = Equal;
+    using reference       = const value_type&;
+    using const_reference = const value_type&;
+
+    using iterator       = detail::wide::iterator<slot_type>;
+    using const_iterator = iterator;
+
+    using memory_policy_type = MemoryPolicy;
+
+    /*!
+     * The number of slots of the root.
+     */
+    static constexpr std::size_t slot_count = std::size_t{1} << RootBits;
+
+    /*!
+     * Default constructor.  It creates a map of `size() == 0`.  It
+     * does not allocate memory and its complexity is @f$ O(1) @f$.
+     */
+    wide_map() = default;
+
+    /*!
+     * Returns an iterator pointing at the first element of the
+     * collection.  The elements are visited slot by slot.  It does not
+     * allocate memory.
+     */
+    IMMER_NODISCARD iterator begin() const
+    {
+        return {slots_.data(), slots_.data() + slots_.size()};
+    }
+
+    /*!
+     * Returns an iterator pointing just after the last element of the
+     * collection.
+     */
+    IMMER_NODISCARD iterator end() const
+    {
+        auto last = slots_.data() + slots_.size();
+        return {last, last};
+    }
+
+    /*!
+     * Returns the number of elements in the container.  Its complexity
+     * is @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD size_type size() const { return size_; }
+
+    /*!
+     * Returns `true` if there are no elements in the container.
+     */
+    IMMER_NODISCARD bool empty() const { return size_ == 0; }
+
+    /*!
+     * Returns `1` when the key `k` is contained in the map or `0`
+     * otherwise.  It does not allocate memory and its complexity is
+     * *effectively* @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD size_type count(const K& k) const
+    {
+        return find(k) ? 1 : 0;
+    }
+
+    /*!
+     * Returns a pointer to the value associated with the key `k`, or
+     * `nullptr` when the key is not contained in the map.  The key is
+     * hashed once, for both the slot and its trie.
+     */
+    IMMER_NODISCARD const T* find(const K& k) const
+    {
+        if (slots_.empty())
+            return nullptr;
+        auto hash = Hash{}(k);
+        return slots_[slot_of(hash)].find_hashed(k, hash >> RootBits);
+    }
+
+    /*!
+     * Returns a `const` reference to the value associated to the key
+     * `k`, or to a default constructed value when the key is not
+     * contained in the map.
+     */
+    IMMER_NODISCARD const T& operator[](const K& k) const
+    {
+        if (auto p = find(k))
+            return *p;
+        static const T v{};
+        return v;
+    }
+
+    /*!
+     * Returns a `const` reference to the value associated to the key
+     * `k`.  If the key is not contained in the map, throws an
+     * `std::out_of_range` error.
+     */
+    const T& at(const K& k) const
+    {
+        auto p = find(k);
+        if (!p)
+            IMMER_THROW(std::out_of_range{"key not found"});
+        return *p;
+    }
+
+    /*!
+     * Returns whether the maps hold the same associations.  The slots
+     * that they share are not compared.
+     */
+    IMMER_NODISCARD bool operator==(const wide_map& other) const
+    {
+        if (size_ != other.size_)
+            return false;
+        if (slots_.empty() || other.slots_.empty())
+            return size_ == 0;
+        for (auto i = std::size_t{}; i < slot_count; ++i)
+            if (slots_[i] != other.slots_[i])
+                return false;
+        return true;
+    }
+    IMMER_NODISCARD bool operator!=(const wide_map& other) const
+    {
+        return !(*this == other);
+    }
+
+    /*!
+     * Returns a map containing the association `(k, v)`, replacing
+     * the one of `k` if there was any.  It copies the root unless the
+     * map is an rvalue that is not shared, see above, and its
+     * complexity is *effectively* @f$ O(1) @f$.
+     */
+    IMMER_NODISCARD wide_map set(key_type k, mapped_type v) const&
+    {
+        auto hash = Hash{}(k);
+        return modify(hash, [&](const slot_type& m) {
+            return m.insert_hashed({std::move(k), std::move(v)},
+                                   hash >> RootBits);
+        });
+    }
+    IMMER_NODISCARD wide_map&& set(key_type k, mapped_type v) &&
+    {
+        auto hash = Hash{}(k);
+        return modify_move(hash, [&](slot_type&& m) {
+            return std::move(m).insert_hashed({std::move(k), std::move(v)},
+                                              hash >> RootBits);
+        });
+    }
+
+    /*!
+     * Returns a map replacing the association `(k, v)` by `(k,
+     * fn(v))`, where `v` is the value associated to `k` or a default
+     * constructed value otherwise, like @ref map::update.
+     */
+    template <typename Fn>
+    IMMER_NODISCARD wide_map update(key_type k, Fn&& fn) const&
+    {
+        auto hash = Hash{}(k);
+        return modify(hash, [&](const slot_type& m) {
+            return m.update_hashed(
+                std::move(k), hash >> RootBits, std::forward<Fn>(fn));
+        });
+    }
+    template <typename Fn>
+    IMMER_NODISCARD wide_map&& update(key_type k, Fn&& fn) &&
+    {
+        auto hash = Hash{}(k);
+        return modify_move(hash, [&](slot_type&& m) {
+            return std::move(m).update_hashed(
+                std::move(k), hash >> RootBits, std::forward<Fn>(fn));
+        });
+    }
+
+    /*!
+     * Returns a map without the key `k`.  When the key is not in the
+     * map it returns the same map, without copying the root.
+     */
+    IMMER_NODISCARD wide_map erase(const K& k) const&
+    {
+        if (!count(k))
+            return *this;
+        return modify(Hash{}(k),
+                      [&](const slot_type& m) { return m.erase(k); });
+    }
+    IMMER_NODISCARD wide_map&& erase(const K& k) &&
+    {
+        if (count(k))
+            modify_move(Hash{}(k),
+                        [&](slot_type&& m) { return std::move(m).erase(k); });
+        return std::move(*this);
+    }
+
+    /*!
+     * Returns the maps of the slots, whose tries are hashed without
+     * the bits that choose the slot.  It is empty until the first
+     * insertion.
+     */
+    IMMER_NODISCARD const slots_type& slots() const { return slots_; }
+
+    /*!
+     * Returns a value that can be used as identity for the container.
+     * If two values have the same identity, they are guaranteed to be
+     * equal and to contain the same objects.
+     */
+    const void* identity() const { return slots_.data(); }
+
+private:
+    wide_map(slots_type slots, size_type size)
+        : slots_{std::move(slots)}
+        , size_{size}
+    {}
+
+    static std::size_t slot_of(std::size_t hash)
+    {
+        return hash & (slot_count - 1);
+    }
+
+    // Returns a map where the slot of `hash` is `fn(m)`, for the map
+    // `m` that is there.
+    template <typename Fn>
+    wide_map modify(std::size_t hash, Fn&& fn) const
+    {
+        auto i     = slot_of(hash);
+        auto slots = slots_.empty() ? slots_type(slot_count) : slots_;
+        auto r     = slot_type{fn(slots[i])};
+        auto size  = size_ - slots[i].size() + r.size();
+        return {std::move(slots).set(i, std::move(r)), size};
+    }
+
+    // Like `modify`, but changes the root in place when it is not
+    // shared, passing the map of the slot as an rvalue to `fn`.
+    template <typename Fn>
+    wide_map&& modify_move(std::size_t hash, Fn&& fn)
+    {
+        auto i = slot_of(hash);
+        if (slots_.empty())
+            slots_ = slots_type(slot_count);
+        auto old = slots_[i].size();
+        slots_   = std::move(slots_).update(
+            i, [&](slot_type&& m) { return slot_type{fn(std::move(m))}; });
+        size_ = size_ - old + slots_[i].size();
+        return std::move(*this);
+    }
+
+    slots_type slots_;
+    size_type size_ = 0;
+};
+
+template <typename K,
+          typename T,
+          typename Hash,
+          typename Equal,
+          typename MemoryPolicy,
+          detail::hamts::bits_t B,
+          unsigned RootBits>
+constexpr std::size_t
+    wide_map<K, T, Hash, Equal, MemoryPolicy, B, RootBits>::slot_count;
+
+} // namespace immer
@@ -0,0 +1,80 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/atom.hpp>
+#include <immer/lock/adaptive_lock_policy.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+TEST_CASE("try_lock")
+{
+    immer::adaptive_lock_policy l;
+    CHECK(l.try_lock());
+    CHECK(!l.try_lock());
+    l.unlock();
+    CHECK(l.try_lock());
+    l.unlock();
+}
+
+TEST_CASE("waiters park while the holder sleeps")
+{
+    immer::adaptive_lock_policy l;
+    auto counter = 0;
+    auto threads = std::vector<std::thread>{};
+    l.lock();
+    for (auto i = 0; i < 4; ++i)
+        threads.emplace_back([&] {
+            immer::adaptive_lock_policy::scoped_lock lock{l};
+            ++counter;
+        });
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    CHECK(counter == 0);
+    l.unlock();
+    for (auto&& t : threads)
+        t.join();
+    CHECK(counter == 4);
+}
+
+TEST_CASE("contended counter")
+{
+    constexpr auto n = 20000;
+    immer::adaptive_lock_policy l;
+    auto counter = 0;
+    auto threads = std::vector<std::thread>{};
+    for (auto i = 0; i < 8; ++i)
+        threads.emplace_back([&] {
+            for (auto j = 0; j < n; ++j) {
+                immer::adaptive_lock_policy::scoped_lock lock{l};
+                ++counter;
+            }
+        });
+    for (auto&& t : threads)
+        t.join();
+    CHECK(counter == 8 * n);
+}
+
+TEST_CASE("atom with the lock in its memory policy")
+{
+    using memory_t = immer::memory_policy<immer::default_heap_policy,
+                                          immer::default_refcount_policy,
+                                          immer::adaptive_lock_policy>;
+    immer::atom<int, memory_t> a{0};
+    auto threads = std::vector<std::thread>{};
+    for (auto i = 0; i < 4; ++i)
+        threads.emplace_back([&] {
+            for (auto j = 0; j < 1000; ++j)
+                a.update([](int x) { return x + 1; });
+        });
+    for (auto&& t : threads)
+        t.join();
+    CHECK(*a.load() == 4000);
+}
@@ -0,0 +1,200 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/adaptive_vector.hpp>
+#include <immer/algorithm.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+template <typename T>
+using small_vector =
+    immer::adaptive_vector<T,
+                           immer::default_memory_policy,
+                           immer::default_bits,
+                           immer::detail::rbts::derive_bits_leaf<
+                               T,
+                               immer::default_memory_policy,
+                               immer::default_bits>,
+                           100>;
+
+template <typename V>
+V make_iota(std::size_t n)
+{
+    auto v = V{};
+    for (auto i = 0u; i < n; ++i)
+        v = v.push_back(i);
+    return v;
+}
+
+template <typename V>
+bool is_iota(const V& v)
+{
+    for (auto i = 0u; i < v.size(); ++i)
+        if (v[i] != i)
+            return false;
+    return true;
+}
+
+} // namespace
+
+TEST_CASE("instantiation")
+{
+    using vector_t = small_vector<unsigned>;
+
+    SECTION("default")
+    {
+        auto v = vector_t{};
+        CHECK(v.size() == 0u);
+        CHECK(v.empty());
+        CHECK(!v.is_tree());
+    }
+
+    SECTION("range")
+    {
+        auto r = std::vector<unsigned>(1000);
+        std::iota(r.begin(), r.end(), 0u);
+        auto small = vector_t{r.begin(), r.begin() + 100};
+        auto big   = vector_t{r.begin(), r.end()};
+        CHECK(!small.is_tree());
+        CHECK(big.is_tree());
+        CHECK(is_iota(small));
+        CHECK(is_iota(big));
+    }
+
+    SECTION("input range")
+    {
+        auto s = std::istringstream{"0 1 2 3 4"};
+        auto v = vector_t{std::istream_iterator<unsigned>{s},
+                          std::istream_iterator<unsigned>{}};
+        CHECK(v.size() == 5u);
+        CHECK(!v.is_tree());
+        CHECK(is_iota(v));
+    }
+
+    SECTION("fill")
+    {
+        CHECK(!vector_t(100u, 42u).is_tree());
+        CHECK(vector_t(101u, 42u).is_tree());
+        CHECK(vector_t(101u, 42u)[100] == 42u);
+    }
+}
+
+TEST_CASE("crossing the threshold")
+{
+    using vector_t = small_vector<unsigned>;
+
+    auto v = make_iota<vector_t>(100);
+    CHECK(!v.is_tree());
+    auto w = v.push_back(100u);
+    CHECK(w.is_tree());
+    CHECK(!v.is_tree());
+    CHECK(w.size() == 101u);
+    CHECK(is_iota(v));
+    CHECK(is_iota(w));
+
+    SECTION("grows as a tree")
+    {
+        auto u = make_iota<vector_t>(10000);
+        CHECK(u.is_tree());
+        CHECK(is_iota(u));
+        CHECK(u.back() == 9999u);
+        CHECK(u.at(5000) == 5000u);
+        CHECK_THROWS_AS(u.at(10000), std::out_of_range);
+    }
+
+    SECTION("set and update keep the representation")
+    {
+        auto v2 = v.set(3u, 42u);
+        auto w2 = w.update(100u, [](auto x) { return x * 2; });
+        CHECK(!v2.is_tree());
+        CHECK(w2.is_tree());
+        CHECK(v2[3] == 42u);
+        CHECK(v[3] == 3u);
+        CHECK(w2[100] == 200u);
+        CHECK(w[100] == 100u);
+    }
+
+    SECTION("take turns back into an array at half the threshold")
+    {
+        auto big = make_iota<vector_t>(1000);
+        CHECK(big.take(51).is_tree());
+        CHECK(!big.take(50).is_tree());
+        CHECK(!big.take(50).take(20).is_tree());
+        CHECK(is_iota(big.take(51)));
+        CHECK(is_iota(big.take(50)));
+        CHECK(big.take(50).size() == 50u);
+        CHECK(big.take(2000).size() == 1000u);
+    }
+
+    SECTION("equality does not depend on the representation")
+    {
+        auto big   = make_iota<vector_t>(1000).take(80);
+        auto small = make_iota<vector_t>(80);
+        CHECK(big.is_tree());
+        CHECK(!small.is_tree());
+        CHECK(big == small);
+        CHECK(big != small.set(3u, 0u));
+        CHECK(big != small.take(79));
+    }
+}
+
+TEST_CASE("iteration")
+{
+    using vector_t = small_vector<unsigned>;
+
+    for (auto n : {0u, 1u, 100u, 101u, 1000u}) {
+        auto v = make_iota<vector_t>(n);
+        auto i = 0u;
+        for (auto x : v)
+            CHECK(x == i++);
+        CHECK(i == n);
+        CHECK(std::distance(v.begin(), v.end()) == n);
+        CHECK(std::equal(v.rbegin(), v.rend(), v.begin(), v.end()) ==
+              (n <= 1));
+        CHECK(immer::accumulate(v, 0u) == n * (n - 1) / 2);
+        CHECK(immer::all_of(v, [](auto x) { return x < 1000u; }));
+    }
+}
+
+TEST_CASE("default threshold")
+{
+    auto ints    = std::size_t{immer::adaptive_vector<int>::threshold};
+    auto strings = std::size_t{immer::adaptive_vector<std::string>::threshold};
+    CHECK(ints == 1024u);
+    CHECK(strings == std::max<std::size_t>(8, 1024 / sizeof(std::string)));
+
+    auto v = make_iota<immer::adaptive_vector<unsigned>>(1024);
+    CHECK(!v.is_tree());
+    CHECK(v.push_back(0u).is_tree());
+}
+
+TEST_CASE("non trivial elements")
+{
+    using vector_t = small_vector<std::string>;
+
+    auto v = vector_t{};
+    for (auto i = 0; i < 1000; ++i)
+        v = v.emplace_back(std::to_string(i));
+    CHECK(v.is_tree());
+    for (auto i = 0; i < 1000; ++i)
+        CHECK(v[i] == std::to_string(i));
+    auto u = v.take(10).set(3, "x");
+    CHECK(!u.is_tree());
+    CHECK(u[3] == "x");
+    CHECK(u[9] == "9");
+    CHECK(v[3] == "3");
+}
@@ -2,6 +2,7 @@
 #include <immer/flex_vector.hpp>
 #include <immer/map.hpp>
 #include <immer/set.hpp>
+#include <immer/slice_view.hpp>
 #include <immer/table.hpp>
 #include <immer/vector.hpp>
 
@@ -9,6 +10,14 @@
 
 #include <catch2/catch_test_macros.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iterator>
+#include <numeric>
+#include <string>
+#include <vector>
+
 struct thing
 {
     int id = 0;
@@ -50,6 +59,182 @@ TEST_CASE("chunked iteration exposes const")
     do_check(immer::table<thing>{});
 }
 
+TEST_CASE("parallel chunked iteration")
+{
+    auto ex = immer::thread_executor{4};
+
+    auto do_check = [&](auto v) {
+        using value_t = typename decltype(v)::value_type;
+        std::atomic<std::size_t> count{0};
+        immer::par_for_each_chunk(
+            v,
+            [&](auto a, auto b) {
+                static_assert(std::is_same<const value_t*, decltype(a)>::value,
+                              "");
+                count += static_cast<std::size_t>(b - a);
+            },
+            ex);
+        CHECK(count == v.size());
+    };
+
+    do_check(immer::vector<int>{});
+    do_check(immer::map<int, int>{});
+
+    auto v = immer::vector<int>{};
+    auto f = immer::flex_vector<int>{};
+    auto m = immer::map<int, int>{};
+    auto s = immer::set<int>{};
+    auto t = immer::table<thing>{};
+    for (auto i = 0; i < 10000; ++i) {
+        v = std::move(v).push_back(i);
+        f = std::move(f).push_front(i);
+        m = std::move(m).set(i, i);
+        s = std::move(s).insert(i);
+        t = std::move(t).insert({i});
+    }
+    do_check(v);
+    do_check(f);
+    do_check(f + v + f);
+    do_check(m);
+    do_check(s);
+    do_check(t);
+
+    std::atomic<long> sum{0};
+    immer::par_for_each_chunk(
+        f + v, [&](auto a, auto b) { sum += std::accumulate(a, b, 0l); }, ex);
+    CHECK(sum == 2 * immer::accumulate(v, 0l));
+}
+
+TEST_CASE("parallel copy")
+{
+    auto ex = immer::thread_executor{4};
+
+    auto do_check = [&](const auto& v) {
+        using value_t = typename std::decay_t<decltype(v)>::value_type;
+        auto expected = std::vector<value_t>(v.begin(), v.end());
+        auto out      = std::vector<value_t>(v.size() + 1);
+        auto seq      = std::vector<value_t>(v.size() + 1);
+        CHECK(immer::par_copy(v, out.data(), ex) == out.data() + v.size());
+        CHECK(immer::copy(v, seq.data()) == seq.data() + v.size());
+        CHECK(std::equal(expected.begin(), expected.end(), out.begin()));
+        CHECK(std::equal(expected.begin(), expected.end(), seq.begin()));
+        CHECK(out.back() == value_t{});
+    };
+
+    do_check(immer::vector<float>{});
+    do_check(immer::flex_vector<float>{});
+
+    auto v = immer::vector<float>{};
+    auto f = immer::flex_vector<std::string>{};
+    for (auto i = 0; i < 10000; ++i) {
+        v = std::move(v).push_back(static_cast<float>(i) / 3);
+        f = std::move(f).push_front(std::to_string(i));
+    }
+    do_check(v);
+    do_check(f);
+    do_check(f.take(5000) + f);
+    do_check(immer::slice_view<immer::vector<float>>{v, 33, 9000});
+
+    auto out = std::vector<float>(10);
+    immer::par_copy(v.take(10), out.begin());
+    CHECK(out[9] == v[9]);
+}
+
+namespace {
+
+struct concat
+{
+    std::string operator()(std::string a, int x) const
+    {
+        return a + std::to_string(x % 10);
+    }
+    std::string operator()(std::string a, const std::string& b) const
+    {
+        return a + b;
+    }
+};
+
+} // namespace
+
+TEST_CASE("parallel reduce")
+{
+    auto ex   = immer::thread_executor{4};
+    auto plus = [](long a, long b) { return a + b; };
+
+    auto v = immer::vector<int>{};
+    auto f = immer::flex_vector<int>{};
+    auto s = immer::set<int>{};
+    for (auto i = 0; i < 10000; ++i) {
+        v = std::move(v).push_back(i);
+        f = std::move(f).push_front(i);
+        s = std::move(s).insert(i);
+    }
+    auto expected = immer::accumulate(v, 0l);
+
+    SECTION("empty")
+    {
+        CHECK(immer::par_reduce(immer::vector<int>{}, 0l, plus, ex) == 0);
+        CHECK(immer::par_reduce(immer::set<int>{}, 0l, plus, ex) == 0);
+    }
+
+    SECTION("sum")
+    {
+        CHECK(immer::par_reduce(v, 0l, plus, ex) == expected);
+        CHECK(immer::par_reduce(f, 0l, plus, ex) == expected);
+        CHECK(immer::par_reduce(f + v + f, 0l, plus, ex) == 3 * expected);
+        CHECK(immer::par_reduce(s, 0l, plus, ex) == expected);
+        CHECK(immer::par_reduce(s, 0l, plus, immer::sequential_executor{}) ==
+              expected);
+    }
+
+    SECTION("keeps the order of sequences")
+    {
+        auto g = f.take(5000) + f.drop(123) + f;
+        CHECK(immer::par_reduce(g, std::string{}, concat{}, ex) ==
+              immer::accumulate(g, std::string{}, concat{}));
+    }
+
+    SECTION("memoized")
+    {
+        std::atomic<std::size_t> calls{0};
+        auto counted = [&](long a, long b) {
+            ++calls;
+            return a + b;
+        };
+        auto memo = immer::reduce_memo<long>{};
+        CHECK(immer::par_reduce(v, 0l, counted, ex, memo) == expected);
+        CHECK(memo.size() > 0);
+
+        calls   = 0;
+        auto v2 = v.set(5000, 0).push_back(1);
+        CHECK(immer::par_reduce(v2, 0l, counted, ex, memo) ==
+              expected - 5000 + 1);
+        CHECK(calls < v.size() / 4);
+
+        auto v3 = v2.set(42, 0);
+        CHECK(immer::par_reduce(v3, 0l, counted, ex, memo) ==
+              expected - 5000 + 1 - 42);
+
+        auto memof = immer::reduce_memo<long>{};
+        auto g     = f + v;
+        CHECK(immer::par_reduce(g, 0l, plus, ex, memof) == 2 * expected);
+        CHECK(immer::par_reduce(g.set(7000, 0), 0l, plus, ex, memof) ==
+              2 * expected - g[7000]);
+        CHECK(immer::par_reduce(v, 0l, plus, ex, memof) == expected);
+
+        auto memos = immer::reduce_memo<long>{};
+        CHECK(immer::par_reduce(s, 0l, plus, ex, memos) == expected);
+        calls   = 0;
+        auto s2 = s.erase(42);
+        CHECK(immer::par_reduce(s2, 0l, counted, ex, memos) == expected - 42);
+        CHECK(calls < s.size() / 4);
+
+        memos.clear();
+        CHECK(memos.size() == 0);
+        CHECK(immer::par_reduce(s2, 0l, plus, ex, memos) == expected - 42);
+    }
+}
+
 TEST_CASE("accumulate")
 {
     auto do_check = [](auto v) {
@@ -69,6 +254,63 @@ TEST_CASE("accumulate")
     do_check(immer::table<thing>{});
 }
 
+TEST_CASE("iovecs")
+{
+    auto v = immer::flex_vector<int>{};
+    for (auto i = 0; i < 1000; ++i)
+        v = v.push_back(i);
+    v = v.drop(13) + v.take(500);
+
+    auto gather = [](const std::vector<immer::io_span>& spans) {
+        auto bytes = std::string{};
+        for (auto& s : spans)
+            bytes.append(static_cast<const char*>(s.data), s.size);
+        return bytes;
+    };
+    auto bytes_of = [](const std::vector<int>& xs) {
+        return std::string(reinterpret_cast<const char*>(xs.data()),
+                           xs.size() * sizeof(int));
+    };
+
+    SECTION("whole container")
+    {
+        auto spans = std::vector<immer::io_span>{};
+        immer::as_iovecs(v, std::back_inserter(spans));
+        CHECK(spans.size() > 1);
+        CHECK(gather(spans) == bytes_of({v.begin(), v.end()}));
+    }
+
+    SECTION("slice")
+    {
+        auto spans = std::vector<immer::io_span>{};
+        immer::as_iovecs(
+            v.begin() + 100, v.end() - 7, std::back_inserter(spans));
+        CHECK(gather(spans) == bytes_of({v.begin() + 100, v.end() - 7}));
+    }
+
+    SECTION("system type")
+    {
+        struct iov
+        {
+            void* base;
+            std::size_t len;
+        };
+        iov iovs[64];
+        auto w    = immer::vector<int>{1, 2, 3};
+        auto last = immer::as_iovecs<iov>(w, iovs);
+        CHECK(last - iovs == 1);
+        CHECK(iovs[0].len == 3 * sizeof(int));
+        CHECK(static_cast<int*>(iovs[0].base)[2] == 3);
+    }
+
+    SECTION("empty")
+    {
+        auto spans = std::vector<immer::io_span>{};
+        immer::as_iovecs(immer::vector<int>{}, std::back_inserter(spans));
+        CHECK(spans.empty());
+    }
+}
+
 TEST_CASE("diffing exposes const")
 {
     auto do_check = [](auto v) {
@@ -116,6 +358,59 @@ TEST_CASE("all_of")
     // do_check(immer::table<thing>{});
 }
 
+TEST_CASE("chunked searches")
+{
+    auto do_check = [](auto v) {
+        const auto n = static_cast<int>(v.size());
+        for (auto x : {0, 1, 31, 32, n / 2, n - 1, n, -1}) {
+            auto it = immer::find(v, x);
+            CHECK(it == std::find(v.begin(), v.end(), x));
+            CHECK(immer::count(v, x) ==
+                  static_cast<std::size_t>(std::count(v.begin(), v.end(), x)));
+        }
+        auto gt = [](int x) { return x > 100; };
+        CHECK(immer::find_if(v, gt) == std::find_if(v.begin(), v.end(), gt));
+        CHECK(immer::count_if(v, gt) == static_cast<std::size_t>(std::count_if(
+                                            v.begin(), v.end(), gt)));
+        CHECK(immer::min_element(v) == std::min_element(v.begin(), v.end()));
+        CHECK(immer::max_element(v) == std::max_element(v.begin(), v.end()));
+        CHECK(immer::max_element(v, std::greater<>{}) ==
+              std::max_element(v.begin(), v.end(), std::greater<>{}));
+    };
+
+    auto v = immer::flex_vector<int>{};
+    CHECK(immer::find(v, 0) == v.end());
+    CHECK(immer::min_element(v) == v.end());
+    CHECK(immer::max_element(v) == v.end());
+    CHECK(immer::count(v, 0) == 0);
+    for (auto i = 0; i < 666; ++i)
+        v = v.push_back(i % 200);
+    do_check(v);
+    do_check(v.take(300) + v.drop(300));
+    do_check(immer::vector<int>{v.begin(), v.end()});
+    do_check(immer::array<int>{v.begin(), v.begin() + 100});
+    do_check(immer::slice_view<immer::flex_vector<int>>{v, 33, 500});
+}
+
+TEST_CASE("chunked equality")
+{
+    auto v = immer::flex_vector<int>{};
+    for (auto i = 0; i < 666; ++i)
+        v = v.push_back(i);
+    auto w = immer::vector<int>{v.begin(), v.end()};
+    auto u = v.drop(100).push_front(0).take(1) + v.drop(1);
+    auto s = immer::slice_view<immer::flex_vector<int>>{v, 0, 666};
+
+    CHECK(immer::equal(v, w));
+    CHECK(immer::equal(w, u));
+    CHECK(immer::equal(u, s));
+    CHECK(immer::equal(s.slice(1, 100), v.drop(1).take(99)));
+    CHECK(!immer::equal(v, v.take(665)));
+    CHECK(!immer::equal(v, v.set(400, 0)));
+    CHECK(!immer::equal(w.set(0, 1), u));
+    CHECK(immer::equal(immer::vector<int>{}, immer::flex_vector<int>{}));
+}
+
 TEST_CASE("update vectors")
 {
     auto do_check = [](auto v) {
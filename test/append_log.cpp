@@ -0,0 +1,103 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/append_log.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("append_log")
+{
+    immer::append_log<std::string> log;
+    CHECK(log.snapshot().empty());
+
+    for (auto i = 0; i < 100; ++i)
+        log.push(std::to_string(i));
+    // only the full leaves are published
+    auto s = log.snapshot();
+    CHECK(s.size() <= 100u);
+    CHECK(s.size() > 50u);
+
+    log.flush();
+    s = log.snapshot();
+    REQUIRE(s.size() == 100u);
+    for (auto i = 0; i < 100; ++i)
+        CHECK(s[i] == std::to_string(i));
+
+    // the appends after a flush still go after the others
+    for (auto i = 100; i < 1000; ++i) {
+        log.push(std::to_string(i));
+        if (i % 77 == 0)
+            log.flush();
+    }
+    log.flush();
+    s = log.snapshot();
+    REQUIRE(s.size() == 1000u);
+    for (auto i = 0; i < 1000; ++i)
+        CHECK(s[i] == std::to_string(i));
+    CHECK(s.push_back("x").back() == "x");
+}
+
+TEST_CASE("append_log initial values")
+{
+    immer::append_log<int> log{immer::vector<int>{1, 2, 3}};
+    CHECK(log.snapshot().size() == 3u);
+    for (auto i = 4; i < 5000; ++i)
+        log.push(i);
+    log.flush();
+    auto s = log.snapshot();
+    REQUIRE(s.size() == 4999u);
+    for (auto i = 0u; i < s.size(); ++i)
+        REQUIRE(s[i] == int(i) + 1);
+}
+
+TEST_CASE("append_log concurrent")
+{
+    constexpr auto threads = 4;
+    constexpr auto n       = 20000;
+
+    immer::append_log<std::pair<int, int>> log;
+    std::atomic<bool> done{false};
+    std::atomic<bool> shrunk{false};
+
+    auto reader = std::thread{[&] {
+        auto last = std::size_t{};
+        while (!done.load()) {
+            auto s = log.snapshot();
+            if (s.size() < last)
+                shrunk = true;
+            last = s.size();
+        }
+    }};
+    auto producers = std::vector<std::thread>{};
+    for (auto t = 0; t < threads; ++t)
+        producers.emplace_back([&, t] {
+            for (auto i = 0; i < n; ++i) {
+                log.push({t, i});
+                if (i % 4999 == 0)
+                    log.flush();
+            }
+        });
+    for (auto& p : producers)
+        p.join();
+    log.flush();
+    done = true;
+    reader.join();
+    CHECK(!shrunk);
+
+    auto s = log.snapshot();
+    REQUIRE(s.size() == std::size_t{threads * n});
+    // every producer sees its own values in order
+    auto next = std::vector<int>(threads);
+    for (auto& x : s)
+        REQUIRE(x.second == next[x.first]++);
+}
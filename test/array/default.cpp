@@ -8,5 +8,9 @@
 
 #include <immer/array.hpp>
 
+#define VECTOR_NO_FROM_RANGE_PARALLEL
+#define VECTOR_NO_SHARED_FILL
+#define VECTOR_NO_IF_CHANGED
+#define VECTOR_NO_POP_BACK
 #define VECTOR_T ::immer::array
 #include "../vector/generic.ipp"
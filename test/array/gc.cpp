@@ -19,5 +19,9 @@ using gc_memory = immer::memory_policy<immer::heap_policy<immer::gc_heap>,
 template <typename T>
 using test_array_t = immer::array<T, gc_memory>;
 
+#define VECTOR_NO_FROM_RANGE_PARALLEL
+#define VECTOR_NO_SHARED_FILL
+#define VECTOR_NO_IF_CHANGED
+#define VECTOR_NO_POP_BACK
 #define VECTOR_T test_array_t
 #include "../vector/generic.ipp"
@@ -9,8 +9,14 @@
 #include <immer/array.hpp>
 #include <immer/array_transient.hpp>
 
+#include <iterator>
+#include <sstream>
+#include <vector>
+
 #define VECTOR_T ::immer::array
 #define VECTOR_TRANSIENT_T ::immer::array_transient
+#define VECTOR_TRANSIENT_NO_RESIZE
+#define VECTOR_TRANSIENT_NO_MUT_CHUNKS
 
 #include "../vector_transient/generic.ipp"
 
@@ -43,3 +49,74 @@ TEST_CASE("array provides mutable data")
     CHECK(tr.data() == tr.data_mut());
     CHECK(arr.data() != tr.data_mut());
 }
+
+TEST_CASE("array_transient reserve")
+{
+    auto t = immer::array_transient<int>{};
+    t.reserve(100);
+    CHECK(t.capacity() == 100);
+    auto data = t.data();
+    for (auto i = 0; i < 100; ++i)
+        t.push_back(i);
+    CHECK(t.data() == data);
+    CHECK(t.capacity() == 100);
+    t.reserve(10);
+    CHECK(t.capacity() == 100);
+
+    auto a = t.persistent();
+    CHECK(a.size() == 100);
+    CHECK(a.data() == data);
+    CHECK(a[42] == 42);
+
+    // reserving on a shared buffer leaves the persistent one untouched
+    auto u = a.transient();
+    u.reserve(200);
+    CHECK(u.capacity() == 200);
+    CHECK(u.data() != a.data());
+    u.push_back(100);
+    CHECK(a.size() == 100);
+    CHECK(u[100] == 100);
+}
+
+TEST_CASE("array_transient growth policy")
+{
+    using growth_t = immer::geometric_growth<3, 2>;
+    auto t        = immer::
+        array_transient<int, immer::default_memory_policy, growth_t>{};
+    auto reallocs = 0;
+    auto cap      = t.capacity();
+    for (auto i = 0; i < 1000; ++i) {
+        t.push_back(i);
+        if (t.capacity() != cap) {
+            CHECK(t.capacity() >= cap * 3 / 2);
+            cap = t.capacity();
+            ++reallocs;
+        }
+    }
+    CHECK(reallocs < 20);
+    CHECK(growth_t::recommend(10, 8) == 12);
+    CHECK(immer::default_array_growth::recommend(10, 8) == 16);
+    CHECK(immer::default_array_growth::recommend(7, 8) == 8);
+}
+
+TEST_CASE("array from_range")
+{
+    auto v = std::vector<int>{1, 2, 3, 4};
+    auto a = immer::array<int>::from_range(v);
+    CHECK(a.size() == 4);
+    CHECK(std::equal(a.begin(), a.end(), v.begin()));
+
+    struct input_range
+    {
+        std::istream& is;
+        std::istream_iterator<int> begin() const
+        {
+            return std::istream_iterator<int>{is};
+        }
+        std::istream_iterator<int> end() const { return {}; }
+    };
+    auto s = std::istringstream{"5 6 7"};
+    auto b = immer::array<int>::from_range(input_range{s});
+    CHECK(b.size() == 3);
+    CHECK(b[2] == 7);
+}
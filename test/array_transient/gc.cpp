@@ -26,6 +26,8 @@ using test_array_transient_t = immer::array_transient<T, gc_memory>;
 
 #define VECTOR_T test_array_t
 #define VECTOR_TRANSIENT_T test_array_transient_t
+#define VECTOR_TRANSIENT_NO_RESIZE
+#define VECTOR_TRANSIENT_NO_MUT_CHUNKS
 
 #include "../vector_transient/generic.ipp"
 
@@ -0,0 +1,69 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/atom.hpp>
+#include <immer/map.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+template <typename T>
+using test_atom_t = immer::atom<
+    T,
+    immer::default_memory_policy,
+    immer::combining_reclamation_policy<
+        immer::hazard_pointer_reclamation_policy>>;
+
+#define ATOM_T test_atom_t
+#include "generic.ipp"
+
+TEST_CASE("concurrent combined updates")
+{
+    constexpr auto threads = 8;
+    constexpr auto n       = 1000;
+
+    test_atom_t<immer::map<int, int>> x;
+    auto workers = std::vector<std::thread>{};
+    auto seen    = std::vector<char>(threads, true);
+    for (auto i = 0; i < threads; ++i)
+        workers.emplace_back([&, i] {
+            for (auto j = 0; j < n; ++j) {
+                auto k = i * n + j;
+                auto r = x.update([&](auto m) { return m.set(k, j); });
+                seen[i] = seen[i] && r->count(k) && (*r)[k] == j;
+            }
+        });
+    for (auto& w : workers)
+        w.join();
+    auto m = x.load();
+    CHECK(m->size() == threads * n);
+    CHECK(std::all_of(seen.begin(), seen.end(), [](char b) { return b; }));
+    for (auto i = 0; i < threads * n; ++i)
+        CHECK((*m)[i] == i % n);
+}
+
+TEST_CASE("combined update throwing")
+{
+    test_atom_t<int> x{1};
+    CHECK_THROWS_AS(x.update([](int) -> int { throw std::runtime_error{""}; }),
+                    std::runtime_error);
+    CHECK(x.update([](int v) { return v + 1; }) == 2);
+    CHECK(x.load() == 2);
+}
+
+TEST_CASE("combined update with lock policy")
+{
+    immer::atom<int,
+                immer::default_memory_policy,
+                immer::combining_reclamation_policy<>>
+        x{40};
+    CHECK(x.update([](int v) { return v + 2; }) == 42);
+    CHECK(x.load() == 42);
+}
@@ -12,6 +12,10 @@
 
 #include <catch2/catch_test_macros.hpp>
 
+#include <thread>
+#include <utility>
+#include <vector>
+
 template <typename T>
 using BOX_T = typename ATOM_T<T>::box_type;
 
@@ -51,3 +55,33 @@ TEST_CASE("update")
     x.update([](auto x) { return x + 2; });
     CHECK(x.load() == 44);
 }
+
+TEST_CASE("wait")
+{
+    ATOM_T<int> x{42};
+    auto old = x.load();
+    CHECK(x.wait(BOX_T<int>{42}) == 42);
+
+    auto t = std::thread{[&] { x.update([](auto v) { return v + 1; }); }};
+    auto r = x.wait(old);
+    t.join();
+    CHECK(r == 43);
+    CHECK(x.load() == 43);
+}
+
+TEST_CASE("watch")
+{
+    ATOM_T<int> x{1};
+    auto calls = std::vector<std::pair<int, int>>{};
+    auto id    = x.watch([&](auto&& old, auto&& new_) {
+        calls.emplace_back(*old, *new_);
+    });
+    x.store(2);
+    CHECK(x.exchange(3) == 2);
+    x.update([](auto v) { return v * 10; });
+    x = 7;
+    x.unwatch(id);
+    x.store(8);
+    CHECK(calls ==
+          (std::vector<std::pair<int, int>>{{1, 2}, {2, 3}, {3, 30}, {30, 7}}));
+}
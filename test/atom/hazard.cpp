@@ -0,0 +1,48 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/atom.hpp>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+template <typename T>
+using test_atom_t = immer::atom<T,
+                                immer::default_memory_policy,
+                                immer::hazard_pointer_reclamation_policy>;
+
+#define ATOM_T test_atom_t
+#include "generic.ipp"
+
+TEST_CASE("concurrent update and load")
+{
+    constexpr auto threads = 8;
+    constexpr auto n       = 2000;
+
+    test_atom_t<int> x{0};
+    auto workers = std::vector<std::thread>{};
+    auto ordered = std::vector<char>(threads, true);
+    for (auto i = 0; i < threads; ++i)
+        workers.emplace_back([&, i] {
+            auto last = 0;
+            for (auto j = 0; j < n; ++j) {
+                if (i % 2)
+                    x.update([](int v) { return v + 1; });
+                else {
+                    auto v = *x.load();
+                    ordered[i] = ordered[i] && v >= last;
+                    last       = v;
+                }
+            }
+        });
+    for (auto& w : workers)
+        w.join();
+    CHECK(x.load() == threads / 2 * n);
+    CHECK(std::all_of(ordered.begin(), ordered.end(), [](char b) { return b; }));
+}
@@ -0,0 +1,101 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/atom.hpp>
+#include <immer/transact.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+template <typename T>
+using test_atom_t = immer::atom<T, immer::inline_box_policy>;
+
+namespace {
+
+struct point
+{
+    std::int32_t x, y;
+};
+
+} // namespace
+
+TEST_CASE("inline box")
+{
+    using box_t = immer::box<point, immer::inline_box_policy>;
+    static_assert(sizeof(box_t) == sizeof(point), "");
+
+    auto a = box_t{1, 2};
+    auto b = a.update([](point p) {
+        p.x += 10;
+        return p;
+    });
+    CHECK(a->x == 1);
+    CHECK(b->x == 11);
+    CHECK(b->y == 2);
+    CHECK(immer::detail::box_identical(a, box_t{a}));
+    CHECK(!immer::detail::box_identical(a, b));
+}
+
+TEST_CASE("inline atom load and update")
+{
+    test_atom_t<int> x;
+    CHECK(x.load() == 0);
+    x.store(42);
+    CHECK(x.exchange(12) == 42);
+    CHECK(x.update([](int v) { return v + 2; }) == 14);
+    CHECK(*x.load() == 14);
+}
+
+// an inline value only compares its bytes, so waiting on a value that
+// is equal to the current one waits for it to change
+TEST_CASE("inline atom wait")
+{
+    test_atom_t<int> x{42};
+    auto t = std::thread{[&] { x.update([](int v) { return v + 1; }); }};
+    auto r = x.wait(42);
+    t.join();
+    CHECK(r == 43);
+}
+
+TEST_CASE("inline atom is a plain atomic")
+{
+    using atom_t = test_atom_t<std::int64_t>;
+    static_assert(
+        std::is_same<atom_t::reclamation_policy::apply<
+                         std::int64_t,
+                         immer::inline_box_policy>::type,
+                     immer::detail::inline_atom_impl<std::int64_t>>::value,
+        "");
+
+    constexpr auto threads = 8;
+    constexpr auto n       = 2000;
+
+    atom_t x{0};
+    auto workers = std::vector<std::thread>{};
+    for (auto i = 0; i < threads; ++i)
+        workers.emplace_back([&] {
+            for (auto j = 0; j < n; ++j)
+                x.update([](std::int64_t v) { return v + 1; });
+        });
+    for (auto& w : workers)
+        w.join();
+    CHECK(x.load() == threads * n);
+}
+
+TEST_CASE("inline atom transaction")
+{
+    test_atom_t<int> a{1};
+    test_atom_t<int> b{2};
+    immer::transact(a, b, [](int x, int y) { return std::make_tuple(y, x); });
+    CHECK(a.load() == 2);
+    CHECK(b.load() == 1);
+}
@@ -0,0 +1,141 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/algorithm.hpp>
+#include <immer/bit_vector.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace {
+
+enum class state : std::uint8_t
+{
+    off,
+    on,
+    unknown
+};
+
+template <typename BV, typename T>
+bool same(const BV& v, const std::vector<T>& ref)
+{
+    if (v.size() != ref.size())
+        return false;
+    for (auto i = std::size_t{}; i < ref.size(); ++i)
+        if (v[i] != ref[i])
+            return false;
+    auto out = std::vector<T>{};
+    immer::for_each_chunk(
+        v, [&](auto first, auto last) { out.insert(out.end(), first, last); });
+    return out == ref;
+}
+
+} // namespace
+
+TEST_CASE("bit vector of bools")
+{
+    using vec_t = immer::bit_vector<>;
+
+    auto v = vec_t{true, false, true};
+    CHECK(v.size() == 3);
+    CHECK(v[0]);
+    CHECK(!v[1]);
+    CHECK(v.back());
+    CHECK(v.count() == 2);
+    CHECK(v.count(false) == 1);
+    CHECK_THROWS_AS(v.at(3), std::out_of_range);
+    CHECK(v.words().size() == 1);
+    CHECK(v.words()[0] == 0b101);
+
+    auto w = v.set(1, true).push_back(false);
+    CHECK(w.count() == 3);
+    CHECK(w.size() == 4);
+    CHECK(v.count() == 2);
+    CHECK(w.take(3) == vec_t{true, true, true});
+    CHECK(w != v);
+    CHECK(w.update(0, [](bool x) { return !x; }).count() == 2);
+
+    auto ref = std::vector<bool>{};
+    auto big = vec_t{};
+    auto gen = std::mt19937{42};
+    for (auto i = 0; i < 1000; ++i) {
+        auto b = gen() % 3 == 0;
+        big    = std::move(big).push_back(b);
+        ref.push_back(b);
+    }
+    CHECK(big.words().size() == 16);
+    CHECK(same(big, ref));
+    CHECK(big.count() ==
+          static_cast<std::size_t>(std::count(ref.begin(), ref.end(), true)));
+    CHECK(big == vec_t(ref.begin(), ref.end()));
+
+    // the padding stays zero, so taking and pushing back is the same
+    auto t = big.take(130);
+    CHECK(t == vec_t(ref.begin(), ref.begin() + 130));
+    CHECK(t.push_back(true) ==
+          vec_t(ref.begin(), ref.begin() + 130).push_back(true));
+    CHECK(t.count() == static_cast<std::size_t>(
+                           std::count(ref.begin(), ref.begin() + 130, true)));
+
+    auto other = vec_t{};
+    for (auto i = 0; i < 1000; ++i)
+        other = std::move(other).push_back(i % 5 == 0);
+    auto both   = big & other;
+    auto either = big | other;
+    auto differ = big ^ other;
+    for (auto i = 0; i < 1000; ++i) {
+        REQUIRE(both[i] == (ref[i] && i % 5 == 0));
+        REQUIRE(either[i] == (ref[i] || i % 5 == 0));
+        REQUIRE(differ[i] == (ref[i] != (i % 5 == 0)));
+    }
+    CHECK(both.count() + differ.count() == either.count());
+}
+
+TEST_CASE("bit vector of small values")
+{
+    using vec_t = immer::bit_vector<state, 2>;
+
+    auto v = vec_t{}.push_back(state::on).push_back(state::unknown);
+    CHECK(v[1] == state::unknown);
+    CHECK(v.count(state::on) == 1);
+    CHECK(v.count(state::off) == 0);
+
+    auto gen = std::mt19937{7};
+    auto ref = std::vector<state>{state::on, state::unknown};
+    for (auto i = 0; i < 500; ++i) {
+        auto s = static_cast<state>(gen() % 3);
+        v      = std::move(v).push_back(s);
+        ref.push_back(s);
+        if (i % 7 == 0) {
+            auto j = gen() % ref.size();
+            ref[j] = state::off;
+            v      = std::move(v).set(j, state::off);
+        }
+    }
+    CHECK(same(v, ref));
+    for (auto s : {state::off, state::on, state::unknown})
+        CHECK(v.count(s) ==
+              static_cast<std::size_t>(std::count(ref.begin(), ref.end(), s)));
+
+    // 3 bits do not divide 64, each word holds 21 values
+    using odd_t = immer::bit_vector<std::uint8_t, 3>;
+    auto nums   = std::vector<std::uint8_t>{};
+    for (auto i = 0; i < 100; ++i)
+        nums.push_back(static_cast<std::uint8_t>(i % 8));
+    auto o = odd_t(nums.begin(), nums.end());
+    CHECK(o.words().size() == 5);
+    CHECK(same(o, nums));
+    CHECK(o.count(0) == 13);
+    CHECK(o.take(22).count(0) == 3);
+    CHECK(same(o.take(22),
+               std::vector<std::uint8_t>(nums.begin(), nums.begin() + 22)));
+}
@@ -0,0 +1,219 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/bitset_set.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <random>
+#include <set>
+#include <vector>
+
+namespace {
+
+using bitset = immer::bitset_set<>;
+
+std::vector<std::uint32_t> to_vector(const bitset& s)
+{
+    return {s.begin(), s.end()};
+}
+
+std::vector<std::uint32_t> to_vector(const std::set<std::uint32_t>& s)
+{
+    return {s.begin(), s.end()};
+}
+
+std::vector<std::uint32_t> visited(const bitset& s)
+{
+    auto r = std::vector<std::uint32_t>{};
+    s.for_each([&](std::uint32_t v) { r.push_back(v); });
+    return r;
+}
+
+} // namespace
+
+TEST_CASE("instantiation")
+{
+    auto s = bitset{};
+    CHECK(s.size() == 0);
+    CHECK(s.empty());
+    CHECK(s.begin() == s.end());
+    CHECK(s.count(42) == 0);
+    CHECK(s.identity() == nullptr);
+}
+
+TEST_CASE("insert and erase")
+{
+    auto s = bitset{3, 1, 4, 1, 5, 9, 2, 6};
+    CHECK(s.size() == 7);
+    CHECK(to_vector(s) == (std::vector<std::uint32_t>{1, 2, 3, 4, 5, 6, 9}));
+    CHECK(s.count(4) == 1);
+    CHECK(s.count(7) == 0);
+
+    auto s2 = s.erase(4).insert(0xFFFFFFFFu).insert(512);
+    CHECK(s.size() == 7);
+    CHECK(s2.size() == 8);
+    CHECK(!s2.contains(4));
+    CHECK(s2.contains(0xFFFFFFFFu));
+    CHECK(to_vector(s2) ==
+          (std::vector<std::uint32_t>{1, 2, 3, 5, 6, 9, 512, 0xFFFFFFFFu}));
+    CHECK(visited(s2) == to_vector(s2));
+
+    SECTION("no change keeps the identity")
+    {
+        CHECK(s.insert(3).identity() == s.identity());
+        CHECK(s.erase(7).identity() == s.identity());
+    }
+
+    SECTION("erasing everything")
+    {
+        auto e = s2;
+        for (auto v : to_vector(s2))
+            e = e.erase(v);
+        CHECK(e.empty());
+        CHECK(e == bitset{});
+        CHECK(s2.size() == 8);
+    }
+}
+
+TEST_CASE("lower bound")
+{
+    auto s = bitset{10, 600, 70000, 0xFFFFFFF0u};
+    CHECK(*s.lower_bound(0) == 10);
+    CHECK(*s.lower_bound(10) == 10);
+    CHECK(*s.lower_bound(11) == 600);
+    CHECK(*s.lower_bound(601) == 70000);
+    CHECK(*s.lower_bound(70001) == 0xFFFFFFF0u);
+    CHECK(s.lower_bound(0xFFFFFFF1u) == s.end());
+}
+
+TEST_CASE("small value types")
+{
+    auto s = immer::bitset_set<std::uint8_t>{255, 0, 7};
+    CHECK(s.size() == 3);
+    CHECK(std::vector<std::uint8_t>(s.begin(), s.end()) ==
+          (std::vector<std::uint8_t>{0, 7, 255}));
+}
+
+TEST_CASE("set operations share the subtrees")
+{
+    auto a = bitset{};
+    for (auto i = std::uint32_t{}; i < 100000; i += 3)
+        a = std::move(a).insert(i);
+    auto b = a.insert(5000000);
+
+    SECTION("union with a subset")
+    {
+        CHECK((b | a).identity() == b.identity());
+        CHECK((a | b).identity() == b.identity());
+        CHECK((a | a).identity() == a.identity());
+    }
+
+    SECTION("intersection with a superset")
+    {
+        CHECK((b & a).identity() == a.identity());
+        CHECK((a & b).identity() == a.identity());
+    }
+
+    SECTION("difference")
+    {
+        CHECK((b - a) == bitset{5000000});
+        CHECK((a - a).empty());
+        CHECK((a - bitset{}).identity() == a.identity());
+    }
+}
+
+TEST_CASE("dense sets")
+{
+    auto n = std::uint32_t{1u << 20};
+    auto s = bitset{};
+    for (auto i = std::uint32_t{}; i < n; ++i)
+        s = std::move(s).insert(i);
+    CHECK(s.size() == n);
+
+    auto k  = std::uint32_t{};
+    auto ok = true;
+    for (auto v : s)
+        ok = ok && v == k++;
+    CHECK(ok);
+    CHECK(k == n);
+
+    auto evens = bitset{};
+    for (auto i = std::uint32_t{}; i < n; i += 2)
+        evens = std::move(evens).insert(i);
+    auto odds = s - evens;
+    CHECK(odds.size() == n / 2);
+    CHECK((odds | evens) == s);
+    CHECK((odds & evens).empty());
+}
+
+TEST_CASE("random operations against std::set")
+{
+    auto gen = std::mt19937{42};
+    // values around a few clusters, so that leaves are shared and
+    // partially filled, plus some anywhere
+    auto value = [&] {
+        auto c = static_cast<std::uint32_t>(gen() % 4) * 0x40000000u;
+        return static_cast<std::uint32_t>(gen() % 8 ? c + gen() % 5000
+                                                    : gen());
+    };
+
+    auto a  = bitset{};
+    auto b  = bitset{};
+    auto ra = std::set<std::uint32_t>{};
+    auto rb = std::set<std::uint32_t>{};
+    for (auto i = 0; i < 20000; ++i) {
+        auto v = value();
+        switch (gen() % 4) {
+        case 0:
+            a = a.insert(v);
+            ra.insert(v);
+            break;
+        case 1:
+            a = std::move(a).insert(v);
+            ra.insert(v);
+            b = std::move(b).insert(v + 1);
+            rb.insert(v + 1);
+            break;
+        case 2:
+            if (!ra.empty()) {
+                auto it = ra.lower_bound(v);
+                auto x  = it == ra.end() ? *ra.begin() : *it;
+                a       = std::move(a).erase(x);
+                ra.erase(x);
+            }
+            break;
+        default:
+            b = b.erase(v).insert(v / 2);
+            rb.erase(v);
+            rb.insert(v / 2);
+            break;
+        }
+    }
+    CHECK(a.size() == ra.size());
+    CHECK(b.size() == rb.size());
+    CHECK(to_vector(a) == to_vector(ra));
+    CHECK(visited(b) == to_vector(rb));
+
+    auto u = ra;
+    u.insert(rb.begin(), rb.end());
+    auto in = std::set<std::uint32_t>{};
+    auto df = std::set<std::uint32_t>{};
+    for (auto v : ra)
+        (rb.count(v) ? in : df).insert(v);
+
+    CHECK(to_vector(a | b) == to_vector(u));
+    CHECK(to_vector(a & b) == to_vector(in));
+    CHECK(to_vector(a - b) == to_vector(df));
+    CHECK((a | b).size() == u.size());
+    CHECK((a & b).size() == in.size());
+    CHECK((a - b).size() == df.size());
+    CHECK((a | b) == bitset(u.begin(), u.end()));
+    CHECK((a - b) != a);
+}
@@ -0,0 +1,115 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/bloom_filtered.hpp>
+#include <immer/map.hpp>
+#include <immer/map_transient.hpp>
+#include <immer/set.hpp>
+#include <immer/set_transient.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+namespace {
+
+using map_t = immer::bloom_filtered<immer::map<int, std::string>>;
+using set_t = immer::bloom_filtered<immer::set<int>>;
+
+} // namespace
+
+TEST_CASE("bloom_filtered map")
+{
+    auto m = map_t{};
+    CHECK(!m.may_contain(1));
+    CHECK(m.find(1) == nullptr);
+
+    for (auto i = 0; i < 10000; ++i)
+        m = std::move(m).set(i * 2, std::to_string(i));
+    CHECK(m.size() == 10000u);
+
+    // no false negatives
+    for (auto i = 0; i < 10000; ++i) {
+        REQUIRE(m.may_contain(i * 2));
+        REQUIRE(m.find(i * 2));
+        CHECK(*m.find(i * 2) == std::to_string(i));
+    }
+
+    // few false positives
+    auto positives = 0;
+    for (auto i = 0; i < 10000; ++i) {
+        positives += m.may_contain(i * 2 + 1);
+        CHECK(m.count(i * 2 + 1) == 0u);
+    }
+    CHECK(positives < 300);
+
+    // setting a key that is there only changes the value
+    auto n = m.set(2, "x");
+    CHECK(*n.find(2) == "x");
+    CHECK(*m.find(2) == "1");
+    CHECK(n.size() == m.size());
+}
+
+TEST_CASE("bloom_filtered set erase")
+{
+    auto s = set_t{};
+    for (auto i = 0; i < 1000; ++i)
+        s = std::move(s).insert(i);
+    auto blocks = s.filter().size();
+
+    for (auto i = 0; i < 600; ++i)
+        s = std::move(s).erase(i);
+    CHECK(s.size() == 400u);
+    CHECK(s.count(0) == 0u);
+    CHECK(s.count(700) == 1u);
+    // the filter was built again after the 501st was erased
+    CHECK(s.filter().size() < blocks);
+    auto positives = 0;
+    for (auto i = 0; i < 501; ++i)
+        positives += s.may_contain(i);
+    CHECK(positives < 30);
+
+    for (auto i = 600; i < 1000; ++i)
+        s = std::move(s).erase(i);
+    CHECK(s.empty());
+    CHECK(!s.may_contain(700));
+}
+
+TEST_CASE("bloom_filtered transient")
+{
+    auto t = set_t{}.transient();
+    for (auto i = 0; i < 5000; ++i)
+        t.insert(i * 3);
+    t.erase(3);
+    CHECK(t.count(3) == 0u);
+    CHECK(t.count(6) == 1u);
+    auto s = t.persistent();
+    CHECK(s.size() == 4999u);
+    for (auto i = 2; i < 5000; ++i)
+        REQUIRE(s.may_contain(i * 3));
+
+    auto c = set_t{s.container()};
+    CHECK(c == s);
+    for (auto i = 2; i < 5000; ++i)
+        REQUIRE(c.may_contain(i * 3));
+}
+
+TEST_CASE("bloom_filtered versions share blocks")
+{
+    auto s = set_t{};
+    for (auto i = 0; i < 20000; ++i)
+        s = std::move(s).insert(i);
+    auto v = s.insert(-1).insert(-2);
+    CHECK(v.may_contain(-1));
+    CHECK(v.may_contain(-2));
+    REQUIRE(v.filter().size() == s.filter().size());
+    auto shared = std::size_t{};
+    for (auto i = std::size_t{}; i < s.filter().size(); ++i)
+        shared += &s.filter()[i] == &v.filter()[i];
+    CHECK(shared + 64 > s.filter().size());
+}
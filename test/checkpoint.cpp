@@ -0,0 +1,156 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/atom.hpp>
+#include <immer/checkpoint.hpp>
+#include <immer/flex_vector.hpp>
+#include <immer/map.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace {
+
+using map_t = immer::map<std::string, int>;
+
+struct string_sink
+{
+    std::string* out;
+    std::size_t* calls;
+
+    void operator()(const char* data, std::size_t size) const
+    {
+        out->append(data, size);
+        ++*calls;
+    }
+};
+
+template <typename Container>
+Container load(const std::string& data,
+               const immer::checkpoint_info& info,
+               const Container& base = {})
+{
+    auto stream = std::stringstream{data};
+    immer::input_archive in{stream};
+    return info.incremental ? in.load<Container>(info.id, base)
+                            : in.load<Container>(info.id);
+}
+
+} // namespace
+
+TEST_CASE("checkpoints while the writers go on")
+{
+    immer::atom<map_t> state;
+    immer::checkpointer<map_t> cp;
+
+    auto writer = std::thread{[&] {
+        for (auto i = 0; i < 2000; ++i)
+            state.update([&](map_t m) {
+                return std::move(m).set(std::to_string(i), i);
+            });
+    }};
+
+    // every checkpoint is a consistent snapshot, restored by a reader
+    // that applies them in turn
+    auto restored = map_t{};
+    for (auto k = 0; k < 5; ++k) {
+        auto data  = std::string{};
+        auto calls = std::size_t{};
+        auto snap  = state.load().get();
+        auto info  = cp.checkpoint(snap, string_sink{&data, &calls}).get();
+        CHECK(info.incremental == (k > 0));
+        CHECK(info.bytes == data.size());
+        restored = load(data, info, restored);
+        CHECK(restored == snap);
+    }
+    writer.join();
+
+    auto data  = std::string{};
+    auto calls = std::size_t{};
+    auto info  = immer::checkpoint_async(state, cp, string_sink{&data, &calls})
+                    .get();
+    restored = load(data, info, restored);
+    CHECK(restored == state.load().get());
+    CHECK(restored.size() == 2000);
+}
+
+TEST_CASE("incremental checkpoints only write what changed")
+{
+    auto v = immer::flex_vector<int>{};
+    for (auto i = 0; i < 100000; ++i)
+        v = std::move(v).push_back(i);
+
+    immer::checkpointer<immer::flex_vector<int>> cp;
+    auto full  = std::string{};
+    auto delta = std::string{};
+    auto calls = std::size_t{};
+    auto i1    = cp.checkpoint(v, string_sink{&full, &calls}).get();
+    auto w     = v.set(500, -1).push_back(42);
+    auto i2    = cp.checkpoint(w, string_sink{&delta, &calls}).get();
+    CHECK(!i1.incremental);
+    CHECK(i2.incremental);
+    CHECK(delta.size() * 50 < full.size());
+
+    auto r1 = load(full, i1, immer::flex_vector<int>{});
+    auto r2 = load(delta, i2, r1);
+    CHECK(r2 == w);
+
+    // after a reset the checkpoint is complete again
+    cp.reset();
+    auto again = std::string{};
+    auto i3    = cp.checkpoint(w, string_sink{&again, &calls}).get();
+    CHECK(!i3.incremental);
+    CHECK(load(again, i3, immer::flex_vector<int>{}) == w);
+}
+
+TEST_CASE("checkpoints are written in chunks at a limited rate")
+{
+    auto v = immer::flex_vector<int>{};
+    for (auto i = 0; i < 20000; ++i)
+        v = std::move(v).push_back(i);
+
+    auto opts             = immer::checkpoint_options{};
+    opts.chunk_size       = 4096;
+    opts.bytes_per_second = 2 * 1024 * 1024;
+    immer::checkpointer<immer::flex_vector<int>> cp{opts};
+
+    auto data  = std::string{};
+    auto calls = std::size_t{};
+    auto start = std::chrono::steady_clock::now();
+    auto info  = cp.checkpoint(v, string_sink{&data, &calls}).get();
+    auto spent = std::chrono::steady_clock::now() - start;
+    CHECK(calls > 10);
+    CHECK(spent >= std::chrono::microseconds{data.size() * 1000000 /
+                                             opts.bytes_per_second});
+    CHECK(load(data, info, immer::flex_vector<int>{}) == v);
+}
+
+TEST_CASE("a failed checkpoint does not become the base")
+{
+    immer::checkpointer<immer::flex_vector<int>> cp;
+    auto v     = immer::flex_vector<int>{1, 2, 3};
+    auto data  = std::string{};
+    auto calls = std::size_t{};
+    auto i1    = cp.checkpoint(v, string_sink{&data, &calls}).get();
+
+    auto failed = cp.checkpoint(v.push_back(4), [](const char*, std::size_t) {
+        throw std::runtime_error{"disk full"};
+    });
+    CHECK_THROWS_AS(failed.get(), std::runtime_error);
+
+    auto delta = std::string{};
+    auto w     = v.push_back(5);
+    auto i2    = cp.checkpoint(w, string_sink{&delta, &calls}).get();
+    CHECK(i2.incremental);
+    CHECK(load(delta, i2, load(data, i1, immer::flex_vector<int>{})) == w);
+}
@@ -0,0 +1,92 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/algorithm.hpp>
+#include <immer/chunks.hpp>
+#include <immer/flex_vector.hpp>
+#include <immer/vector.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <utility>
+#include <vector>
+
+namespace {
+
+template <typename V>
+V make_test_vector(unsigned n)
+{
+    auto v = V{};
+    for (auto i = 0u; i < n; ++i)
+        v = v.push_back(i);
+    return v;
+}
+
+template <typename V>
+void check_chunks(const V& v)
+{
+    using chunk_t = std::pair<const unsigned*, const unsigned*>;
+    auto expected = std::vector<chunk_t>{};
+    immer::for_each_chunk(v, [&](auto f, auto l) {
+        if (f != l)
+            expected.emplace_back(f, l);
+    });
+
+    auto c      = immer::chunks(v);
+    auto walked = std::vector<chunk_t>{};
+    while (!c.done())
+        walked.push_back(c.next());
+    CHECK(walked == expected);
+    CHECK(c.next() == chunk_t{});
+
+    auto ranged = std::vector<chunk_t>{};
+    for (auto&& chunk : immer::chunks(v))
+        ranged.push_back(chunk);
+    CHECK(ranged == expected);
+}
+
+} // namespace
+
+TEST_CASE("chunks of a vector")
+{
+    using vector_t = immer::vector<unsigned>;
+    for (auto n : {0u, 1u, 32u, 33u, 1024u, 1025u, 5000u, 40000u})
+        check_chunks(make_test_vector<vector_t>(n));
+}
+
+TEST_CASE("chunks of a flex_vector")
+{
+    using vector_t = immer::flex_vector<unsigned>;
+    auto v         = make_test_vector<vector_t>(5000u);
+    check_chunks(v);
+    check_chunks(v.drop(77));
+    check_chunks(v.take(1999));
+    check_chunks(v.drop(100).take(3000) + v + v.take(33));
+    auto f = vector_t{};
+    for (auto i = 0u; i < 100; ++i)
+        f = f + v.drop(i * 7).take(13);
+    check_chunks(f);
+    check_chunks(f.push_front(42u));
+}
+
+TEST_CASE("resuming a moved cursor")
+{
+    auto v = make_test_vector<immer::flex_vector<unsigned>>(3000u);
+    auto c = immer::chunks(v);
+    auto a = c.next();
+    auto m = std::move(c);
+    auto b = m.next();
+    CHECK((*(a.second - 1) + 1 == *b.first));
+    auto n = static_cast<unsigned>(b.second - b.first) +
+             static_cast<unsigned>(a.second - a.first);
+    while (!m.done()) {
+        auto x = m.next();
+        n += static_cast<unsigned>(x.second - x.first);
+    }
+    CHECK(n == 3000u);
+}
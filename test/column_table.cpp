@@ -0,0 +1,91 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/column_table.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+using table_t = immer::column_table<int, double, std::string>;
+
+namespace {
+
+table_t make(int n)
+{
+    auto t = table_t{}.transient();
+    for (auto i = 0; i < n; ++i)
+        t.push_back(i, i * 0.5, std::to_string(i));
+    return t.persistent();
+}
+
+template <std::size_t I, typename Table>
+double sum(const Table& t)
+{
+    auto r = 0.0;
+    t.template for_each_chunk<I>([&](auto f, auto l) {
+        for (; f != l; ++f)
+            r += *f;
+    });
+    return r;
+}
+
+} // namespace
+
+TEST_CASE("column_table rows")
+{
+    auto t0 = table_t{};
+    auto t1 = t0.push_back(1, 2.0, "a").push_back(std::make_tuple(3, 4.0, "b"));
+    CHECK(t0.empty());
+    CHECK(t1.size() == 2);
+    CHECK(t1.get<0>(1) == 3);
+    CHECK(t1.get<2>(0) == "a");
+    CHECK(t1.row(1) == std::make_tuple(3, 4.0, std::string{"b"}));
+
+    auto t2 = t1.set_row(0, std::make_tuple(5, 6.0, "c"));
+    CHECK(t2.row(0) == std::make_tuple(5, 6.0, std::string{"c"}));
+    CHECK(t1.row(0) == std::make_tuple(1, 2.0, std::string{"a"}));
+
+    auto t3 = t2.erase(0);
+    CHECK(t3.size() == 1);
+    CHECK(t3.get<0>(0) == 3);
+    CHECK(t3 == t1.drop(1));
+    CHECK(t1.take(1).row(0) == t1.row(0));
+}
+
+TEST_CASE("column_table columns")
+{
+    constexpr auto n = 1000;
+    auto t           = make(n);
+    CHECK(t.size() == n);
+    CHECK(sum<0>(t) == n * (n - 1) / 2);
+    CHECK(sum<1>(t) == n * (n - 1) / 4.0);
+
+    SECTION("set touches one column")
+    {
+        auto u = t.set<1>(10, 100.0).update<0>(20, [](int x) { return -x; });
+        CHECK(u.get<1>(10) == 100.0);
+        CHECK(u.get<0>(20) == -20);
+        CHECK(t.get<1>(10) == 5.0);
+        CHECK(u.column<2>().identity() == t.column<2>().identity());
+        CHECK(u.column<1>().identity() != t.column<1>().identity());
+    }
+
+    SECTION("transient")
+    {
+        auto tr = t.transient();
+        for (auto i = 0; i < n; ++i)
+            tr.update<0>(i, [](int x) { return x * 2; });
+        tr.set<2>(0, "zero");
+        auto u = tr.persistent();
+        CHECK(sum<0>(u) == n * (n - 1));
+        CHECK(u.get<2>(0) == "zero");
+        CHECK(t.get<2>(0) == "0");
+        CHECK(sum<0>(t) == n * (n - 1) / 2);
+    }
+}
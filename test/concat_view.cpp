@@ -0,0 +1,93 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/algorithm.hpp>
+#include <immer/concat_view.hpp>
+#include <immer/flex_vector.hpp>
+#include <immer/flex_vector_transient.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+using vector_t = immer::flex_vector<int>;
+using view_t   = immer::concat_view<vector_t>;
+
+vector_t iota_vector(int first, int n)
+{
+    auto v = vector_t{}.transient();
+    for (auto i = 0; i < n; ++i)
+        v.push_back(first + i);
+    return v.persistent();
+}
+
+} // namespace
+
+TEST_CASE("concat view")
+{
+    auto sizes = std::vector<int>{0, 3, 1000, 0, 1, 32, 5000, 7};
+    auto view  = view_t{};
+    auto ref   = std::vector<int>{};
+    for (auto n : sizes) {
+        view = std::move(view) + iota_vector(int(ref.size()), n);
+        ref.resize(ref.size() + n);
+        std::iota(ref.begin(), ref.end(), 0);
+    }
+
+    SECTION("skips the empty pieces")
+    {
+        CHECK(view.size() == ref.size());
+        CHECK(view.pieces().size() == 6);
+        CHECK(view_t{}.empty());
+        CHECK(view_t{vector_t{}}.empty());
+        CHECK(view_t{}.begin() == view_t{}.end());
+    }
+
+    SECTION("iterates the pieces")
+    {
+        CHECK(std::vector<int>(view.begin(), view.end()) == ref);
+    }
+
+    SECTION("accesses by index")
+    {
+        for (auto i = std::size_t{}; i < ref.size(); ++i)
+            CHECK(view[i] == ref[i]);
+        CHECK(view.at(1003) == 1003);
+        CHECK_THROWS_AS(view.at(ref.size()), std::out_of_range);
+    }
+
+    SECTION("algorithms")
+    {
+        CHECK(immer::accumulate(view, 0ll) ==
+              std::accumulate(ref.begin(), ref.end(), 0ll));
+        CHECK(immer::all_of(view, [](int x) { return x >= 0; }));
+        CHECK(!immer::all_of(view, [](int x) { return x < 2000; }));
+    }
+
+    SECTION("materialize")
+    {
+        auto v = view.materialize();
+        CHECK(v.size() == ref.size());
+        CHECK(std::vector<int>(v.begin(), v.end()) == ref);
+        CHECK(view_t{}.materialize().empty());
+    }
+
+    SECTION("persistence")
+    {
+        auto more = view.push_back(iota_vector(int(ref.size()), 10));
+        CHECK(more.size() == ref.size() + 10);
+        CHECK(view.size() == ref.size());
+        auto both = view + view;
+        CHECK(both.size() == 2 * ref.size());
+        CHECK(both[ref.size() + 42] == 42);
+    }
+}
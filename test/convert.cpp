@@ -0,0 +1,96 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/convert.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+TEST_CASE("convert array to vectors")
+{
+    auto a = immer::array<int>{};
+    for (auto i = 0; i < 1000; ++i)
+        a = std::move(a).push_back(i);
+
+    auto v = immer::to_vector(a);
+    CHECK(v.size() == a.size());
+    CHECK(immer::equal(v, a));
+    CHECK(v == immer::vector<int>(a.begin(), a.end()));
+    // the tree is the one push_back builds, so it keeps growing
+    CHECK(v.push_back(1000).back() == 1000);
+
+    auto f = immer::to_flex_vector(a, immer::thread_executor{4});
+    CHECK(immer::equal(f, a));
+    auto g = f + immer::to_flex_vector(immer::array<int>{7, 8});
+    CHECK(g.size() == 1002u);
+    CHECK(g[1001] == 8);
+
+    CHECK(immer::to_vector(immer::array<int>{}).empty());
+}
+
+TEST_CASE("convert moves out of unique arrays")
+{
+    auto a = immer::array<std::string>{};
+    for (auto i = 0; i < 100; ++i)
+        a = std::move(a).push_back(std::string(40, 'a' + i % 26));
+
+    auto copy = a;
+    auto v    = immer::to_vector(copy);
+    CHECK(copy[3] == std::string(40, 'd'));
+
+    auto w = immer::to_vector(std::move(copy));
+    CHECK(v == w);
+    CHECK(w[3] == std::string(40, 'd'));
+    // still shared with `a`, so nothing was moved
+    CHECK(a[3] == std::string(40, 'd'));
+
+    auto u = immer::to_vector(std::move(a));
+    CHECK(u == w);
+}
+
+TEST_CASE("convert flex_vector to vector")
+{
+    auto v = immer::vector<int>{};
+    for (auto i = 0; i < 5000; ++i)
+        v = std::move(v).push_back(i);
+
+    SECTION("regular trees are shared")
+    {
+        auto f = immer::to_flex_vector(v);
+        auto w = immer::to_vector(f);
+        CHECK(w.identity() == v.identity());
+        CHECK(w.push_back(5000).size() == 5001u);
+
+        auto ft = f.take(1500);
+        auto t  = immer::to_vector(ft);
+        CHECK(t.identity() == ft.identity());
+        CHECK(immer::equal(t, ft));
+        CHECK(t.push_back(-1).back() == -1);
+    }
+
+    SECTION("relaxed trees are copied")
+    {
+        auto f = immer::flex_vector<int>{v}.drop(3) + immer::to_flex_vector(v);
+        auto w = immer::to_vector(f);
+        CHECK(w.size() == f.size());
+        CHECK(immer::equal(w, f));
+    }
+}
+
+TEST_CASE("convert vectors to array")
+{
+    auto v = immer::flex_vector<int>{};
+    for (auto i = 0; i < 3000; ++i)
+        v = std::move(v).push_front(i);
+    auto a = immer::to_array(v);
+    CHECK(a.size() == v.size());
+    CHECK(immer::equal(a, v));
+    CHECK(immer::to_array(immer::vector<int>{1, 2}) ==
+          immer::array<int>{1, 2});
+}
@@ -0,0 +1,70 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/counter_map.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("counter_map locals")
+{
+    immer::counter_map<std::string> c{{}, 3};
+    c.add("a", 10);
+    CHECK(c.get("a") == 10);
+
+    {
+        auto l = c.local();
+        l.add("a");
+        l.add("b", 5);
+        CHECK(l.pending() == 2u);
+        // not published yet
+        CHECK(c.get("a") == 10);
+        CHECK(c.get("b") == 0);
+        l.add("a");
+        CHECK(l.pending() == 0u);
+        CHECK(c.get("a") == 12);
+        CHECK(c.get("b") == 5);
+
+        l.add("c", -1);
+        auto moved = std::move(l);
+        CHECK(moved.pending() == 1u);
+    }
+    // flushed when destroyed
+    auto s = c.snapshot();
+    CHECK(s.size() == 3u);
+    CHECK(s["c"] == -1);
+}
+
+TEST_CASE("counter_map concurrent")
+{
+    constexpr auto threads = 8;
+    constexpr auto rounds  = 20000;
+    immer::counter_map<int> c{{}, 100};
+
+    auto workers = std::vector<std::thread>{};
+    for (auto t = 0; t < threads; ++t)
+        workers.emplace_back([&, t] {
+            auto l = c.local();
+            for (auto i = 0; i < rounds; ++i) {
+                l.add(i % 4);
+                l.add(t + 100, 2);
+            }
+        });
+    for (auto& w : workers)
+        w.join();
+
+    auto s = c.snapshot();
+    CHECK(s.size() == 4u + threads);
+    for (auto k = 0; k < 4; ++k)
+        CHECK(s[k] == threads * rounds / 4);
+    for (auto t = 0; t < threads; ++t)
+        CHECK(s[t + 100] == 2 * rounds);
+}
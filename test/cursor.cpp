@@ -0,0 +1,141 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/flex_vector.hpp>
+#include <immer/flex_vector_transient.hpp>
+#include <immer/vector.hpp>
+#include <immer/vector_transient.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+template <typename V>
+V make_test_vector(unsigned n)
+{
+    auto v = V{};
+    for (auto i = 0u; i < n; ++i)
+        v = v.push_back(i);
+    return v;
+}
+
+template <typename V>
+V make_test_flex_vector_front(unsigned n)
+{
+    auto v = V{};
+    for (auto i = n; i > 0;)
+        v = v.push_front(--i);
+    return v;
+}
+
+template <typename V>
+void check_cursor(V p)
+{
+    const auto n = static_cast<unsigned>(p.size());
+
+    SECTION("reads")
+    {
+        auto t = p.transient();
+        auto c = t.cursor_at(0);
+        for (auto i = 0u; i < n; ++i, ++c) {
+            CHECK(c.index() == i);
+            CHECK(c.get() == i);
+        }
+        for (auto i = n; i > 0;) {
+            --c;
+            CHECK(c.get() == --i);
+        }
+    }
+
+    SECTION("updates every k-th element")
+    {
+        auto t = p.transient();
+        auto c = t.cursor_at(1);
+        for (; c.index() < n; c += 3)
+            c.update([](auto x) { return x * 2; });
+        for (auto i = 0u; i < n; ++i)
+            CHECK(t[i] == (i % 3 == 1 ? i * 2 : i));
+        for (auto i = 0u; i < n; ++i)
+            CHECK(p[i] == i);
+    }
+
+    SECTION("sets backwards and seeks")
+    {
+        auto t = p.transient();
+        auto c = t.cursor_at(n - 1);
+        for (auto i = n; i > 1; --i, c -= 1)
+            c.set(i);
+        c.set(1);
+        for (auto i = 0u; i < n; ++i)
+            CHECK(t[i] == i + 1);
+        c.seek(n / 2);
+        CHECK(c.get() == n / 2 + 1);
+        c.set(0);
+        CHECK(t[n / 2] == 0);
+        CHECK(p[n / 2] == n / 2);
+    }
+
+    SECTION("mixes reads and writes")
+    {
+        auto t = p.transient();
+        auto c = t.cursor_at(0);
+        for (auto i = 0u; i < n; ++i, ++c) {
+            CHECK(c.get() == i);
+            if (i % 2)
+                c.set(42);
+            CHECK(c.get() == (i % 2 ? 42u : i));
+        }
+        auto q = t.persistent();
+        for (auto i = 0u; i < n; ++i) {
+            CHECK(q[i] == (i % 2 ? 42u : i));
+            CHECK(p[i] == i);
+        }
+    }
+}
+
+} // namespace
+
+TEST_CASE("vector cursor")
+{
+    check_cursor(make_test_vector<immer::vector<unsigned>>(666u));
+    check_cursor(make_test_vector<immer::vector<unsigned>>(3u));
+}
+
+TEST_CASE("vector cursor small branches")
+{
+    using vector_t =
+        immer::vector<unsigned, immer::default_memory_policy, 3, 2>;
+    check_cursor(make_test_vector<vector_t>(666u));
+}
+
+TEST_CASE("flex_vector cursor")
+{
+    using vector_t = immer::flex_vector<unsigned>;
+    check_cursor(make_test_vector<vector_t>(666u));
+    check_cursor(make_test_flex_vector_front<vector_t>(666u));
+
+    auto v = make_test_flex_vector_front<vector_t>(300u);
+    check_cursor(v + make_test_vector<vector_t>(666u).drop(300u));
+}
+
+TEST_CASE("cursor of strings")
+{
+    auto t = immer::vector<std::string>{}.transient();
+    for (auto i = 0u; i < 100u; ++i)
+        t.push_back(std::to_string(i));
+    auto c = t.cursor_at(10);
+    c.update([](std::string x) { return x + "!"; });
+    ++c;
+    c.set("foo");
+    CHECK(t[10] == "10!");
+    CHECK(t[11] == "foo");
+    CHECK(t[12] == "12");
+}
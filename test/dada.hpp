@@ -217,6 +217,15 @@ struct dadaist_wrapper<V<T, MP>>
     using type = V<dadaist<T>, dadaist_memory_policy<MP>>;
 };
 
+template <template <class, class, class> class V,
+          typename T,
+          typename MP,
+          typename G>
+struct dadaist_wrapper<V<T, MP, G>>
+{
+    using type = V<dadaist<T>, dadaist_memory_policy<MP>, G>;
+};
+
 template <template <class, class, class, class, hbits_t> class V,
           typename T,
           typename E,
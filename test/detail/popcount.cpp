@@ -0,0 +1,32 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/detail/hamts/bits.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+
+using namespace immer::detail::hamts;
+
+TEST_CASE("popcount matches the fallback")
+{
+    CHECK(popcount(std::uint32_t{}) == 0);
+    CHECK(popcount(~std::uint32_t{}) == 32);
+    CHECK(popcount(~std::uint64_t{}) == 64);
+    CHECK(popcount(std::uint16_t{0xffff}) == 16);
+    CHECK(popcount(std::uint8_t{0x81}) == 2);
+
+    auto x = std::uint64_t{0x9e3779b97f4a7c15};
+    for (auto i = 0; i < 1000; ++i) {
+        x = x * 6364136223846793005u + 1442695040888963407u;
+        auto y = static_cast<std::uint32_t>(x >> 17);
+        CHECK(popcount(x) == popcount_fallback(x));
+        CHECK(popcount(y) == popcount_fallback(y));
+    }
+}
@@ -0,0 +1,117 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/edit_session.hpp>
+#include <immer/flex_vector.hpp>
+#include <immer/flex_vector_transient.hpp>
+#include <immer/heap/gc_heap.hpp>
+#include <immer/map.hpp>
+#include <immer/map_transient.hpp>
+#include <immer/set.hpp>
+#include <immer/set_transient.hpp>
+#include <immer/table.hpp>
+#include <immer/table_transient.hpp>
+#include <immer/vector.hpp>
+#include <immer/vector_transient.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+namespace {
+
+struct row
+{
+    int id;
+    std::string name;
+};
+
+using gc_memory = immer::memory_policy<immer::heap_policy<immer::gc_heap>,
+                                       immer::no_refcount_policy,
+                                       immer::default_lock_policy,
+                                       immer::gc_transience_policy,
+                                       false>;
+
+template <typename Memory>
+void test_session()
+{
+    using map_t    = immer::map<std::string,
+                             int,
+                             std::hash<std::string>,
+                             std::equal_to<std::string>,
+                             Memory>;
+    using vector_t = immer::vector<int, Memory>;
+    using flex_t   = immer::flex_vector<int, Memory>;
+    using table_t  = immer::table<row,
+                                 immer::table_key_fn,
+                                 std::hash<int>,
+                                 std::equal_to<int>,
+                                 Memory>;
+
+    auto m  = map_t{}.set("a", 1);
+    auto v1 = vector_t{1, 2, 3};
+    auto v2 = flex_t{4, 5};
+    auto t  = table_t{}.insert({1, "one"});
+
+    auto s  = immer::edit_session<Memory>{};
+    auto tm = s.transient(m);
+    auto t1 = s.transient(v1);
+    auto t2 = s.transient(v2);
+    auto tt = s.transient(t);
+    for (auto i = 0; i < 100; ++i) {
+        t1.push_back(i);
+        t2.push_back(i);
+    }
+    t1.set(0, 42);
+    tm.set("size", int(t1.size()));
+    tt.insert({2, "two"});
+
+    auto r =
+        s.commit(std::move(tm), std::move(t1), std::move(t2), std::move(tt));
+    auto& m2  = std::get<0>(r);
+    auto& v12 = std::get<1>(r);
+    auto& v22 = std::get<2>(r);
+    auto& t_2 = std::get<3>(r);
+
+    CHECK(m.size() == 1);
+    CHECK(v1.size() == 3);
+    CHECK(v2.size() == 2);
+    CHECK(t.size() == 1);
+    CHECK(m2["size"] == 103);
+    CHECK(v12.size() == 103);
+    CHECK(v12[0] == 42);
+    CHECK(v22.size() == 102);
+    CHECK(t_2.size() == 2);
+
+    SECTION("the committed values are not changed by later sessions")
+    {
+        auto t3 = s.transient(v12);
+        t3.set(1, 7);
+        t3.push_back(8);
+        auto t4 = immer::edit_session<Memory>{}.transient(v12);
+        t4.set(2, 9);
+        CHECK(v12[1] == 2);
+        CHECK(v12[2] == 3);
+        CHECK(v12.size() == 103);
+        auto v3 = std::get<0>(s.commit(std::move(t3)));
+        CHECK(v3[1] == 7);
+        CHECK(v3.size() == 104);
+    }
+}
+
+} // namespace
+
+TEST_CASE("edit session with reference counting")
+{
+    test_session<immer::default_memory_policy>();
+}
+
+TEST_CASE("edit session with a garbage collector")
+{
+    test_session<gc_memory>();
+}
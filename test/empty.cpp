@@ -0,0 +1,88 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/array.hpp>
+#include <immer/flex_vector.hpp>
+#include <immer/map.hpp>
+#include <immer/set.hpp>
+#include <immer/vector.hpp>
+#include <immer/vector_transient.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+
+namespace {
+
+struct counting_heap
+{
+    static std::size_t allocations;
+
+    template <typename... Tags>
+    static void* allocate(std::size_t size, Tags...)
+    {
+        ++allocations;
+        return std::malloc(size);
+    }
+
+    template <typename... Tags>
+    static void deallocate(std::size_t, void* data, Tags...)
+    {
+        std::free(data);
+    }
+};
+
+std::size_t counting_heap::allocations = 0;
+
+using memory_t = immer::memory_policy<immer::heap_policy<counting_heap>,
+                                      immer::default_refcount_policy,
+                                      immer::default_lock_policy>;
+
+} // namespace
+
+TEST_CASE("empty containers do not allocate")
+{
+    using vector_t = immer::vector<int, memory_t>;
+    using flex_t   = immer::flex_vector<int, memory_t>;
+    using array_t  = immer::array<int, memory_t>;
+    using map_t =
+        immer::map<int, int, std::hash<int>, std::equal_to<int>, memory_t>;
+    using set_t = immer::set<int, std::hash<int>, std::equal_to<int>, memory_t>;
+
+    counting_heap::allocations = 0;
+    {
+        auto v = vector_t{};
+        auto f = flex_t{};
+        auto a = array_t{};
+        auto m = map_t{};
+        auto s = set_t{};
+        auto t = v.transient();
+        CHECK(v.empty());
+        CHECK(f.empty());
+        CHECK(a.empty());
+        CHECK(m.empty());
+        CHECK(s.empty());
+        CHECK(t.empty());
+        CHECK(f == flex_t{});
+    }
+    CHECK(counting_heap::allocations == 0);
+
+    SECTION("the empty nodes are shared and never freed")
+    {
+        auto v = vector_t{}.push_back(42);
+        auto f = flex_t{}.push_back(42).push_front(1);
+        auto m = map_t{}.set(1, 2);
+        CHECK(counting_heap::allocations > 0);
+        CHECK(v.take(0).empty());
+        CHECK(f.take(0).empty());
+        CHECK(m.erase(1).empty());
+        CHECK(vector_t{}.identity() == flex_t{}.identity());
+    }
+}
@@ -0,0 +1,124 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/algorithm.hpp>
+#include <immer/executor.hpp>
+#include <immer/flex_vector.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+template <typename Executor>
+void check_bulk(const Executor& ex)
+{
+    for (auto n : {0u, 1u, 2u, 7u, 1000u}) {
+        auto hits = std::vector<std::atomic<int>>(n);
+        ex.bulk(n, [&](std::size_t i) { ++hits[i]; });
+        for (auto& h : hits)
+            CHECK(h.load() == 1);
+    }
+
+    std::atomic<std::size_t> ran{0};
+    CHECK_THROWS_AS(ex.bulk(100,
+                            [&](std::size_t i) {
+                                ++ran;
+                                if (i % 10 == 3)
+                                    throw std::runtime_error{"boom"};
+                            }),
+                    std::runtime_error);
+    CHECK(ran.load() >= 4u);
+}
+
+} // namespace
+
+TEST_CASE("sequential_executor")
+{
+    check_bulk(immer::sequential_executor{});
+}
+
+TEST_CASE("thread_executor") { check_bulk(immer::thread_executor{4}); }
+
+TEST_CASE("pool_executor")
+{
+    SECTION("bulk") { check_bulk(immer::pool_executor{4}); }
+
+    SECTION("single thread") { check_bulk(immer::pool_executor{1}); }
+
+    SECTION("uneven tasks are stolen")
+    {
+        immer::pool_executor ex{4};
+        std::atomic<std::size_t> sum{0};
+        std::atomic<bool> busy{true};
+        ex.bulk(64, [&](std::size_t i) {
+            if (i == 0)
+                while (busy.load())
+                    std::this_thread::yield();
+            else if (i == 63)
+                busy = false;
+            sum += i;
+        });
+        CHECK(sum.load() == 63u * 64u / 2u);
+    }
+
+    SECTION("nested and repeated bulks")
+    {
+        immer::pool_executor ex{3};
+        std::atomic<std::size_t> count{0};
+        for (auto round = 0; round < 100; ++round)
+            ex.bulk(8, [&](std::size_t) {
+                ex.bulk(8, [&](std::size_t) { ++count; });
+            });
+        CHECK(count.load() == 100u * 64u);
+    }
+
+    SECTION("bulks from several threads")
+    {
+        immer::pool_executor ex{4};
+        std::atomic<std::size_t> count{0};
+        auto callers = std::vector<std::thread>{};
+        for (auto t = 0; t < 4; ++t)
+            callers.emplace_back([&] {
+                for (auto round = 0; round < 50; ++round)
+                    ex.bulk(16, [&](std::size_t) { ++count; });
+            });
+        for (auto& c : callers)
+            c.join();
+        CHECK(count.load() == 4u * 50u * 16u);
+    }
+
+    SECTION("parallel algorithms")
+    {
+        immer::pool_executor ex{4};
+        auto v  = immer::flex_vector<int>{};
+        for (auto i = 0; i < 100000; ++i)
+            v = std::move(v).push_back(i);
+        auto out = std::vector<int>(v.size());
+        immer::par_copy(v, out.data(), ex);
+        for (auto i = 0u; i < out.size(); ++i)
+            CHECK(out[i] == static_cast<int>(i));
+    }
+}
+
+#if IMMER_HAS_STD_EXECUTION
+// the parallel policies may need linking to a backend like TBB
+TEST_CASE("std_executor")
+{
+    check_bulk(immer::std_executor<std::execution::sequenced_policy>{});
+}
+#endif
+
+#if IMMER_HAS_TBB
+TEST_CASE("tbb_executor") { check_bulk(immer::tbb_executor{}); }
+#endif
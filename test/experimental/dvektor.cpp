@@ -6,7 +6,11 @@
 // See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
 //
 
+#include <immer/algorithm.hpp>
 #include <immer/experimental/dvektor.hpp>
+#include <immer/experimental/dvektor_transient.hpp>
+#include <immer/heap/gc_heap.hpp>
+#include <immer/refcount/no_refcount_policy.hpp>
 
 #include <boost/range/adaptors.hpp>
 
@@ -90,7 +94,7 @@ TEST_CASE("update")
 
     SECTION("assoc further more")
     {
-        auto v = immer::dvektor<unsigned, 4>{};
+        auto v = immer::dvektor<unsigned, default_memory_policy, 4>{};
 
         for (auto i = n; i < 1000u; ++i)
             v = v.push_back(i);
@@ -197,3 +201,77 @@ TEST_CASE("iterator")
         CHECK((i2 - 30) - i2 == -30);
     }
 }
+
+TEST_CASE("for each chunk")
+{
+    auto v = dvektor<unsigned, default_memory_policy, 4>{};
+    for (auto i = 0u; i < 666u; ++i) {
+        CHECK(immer::accumulate(v, 0u) == i * (i - 1) / 2);
+        v = v.push_back(i);
+    }
+
+    SECTION("after updating the middle")
+    {
+        v = v.assoc(300u, 0u);
+        CHECK(immer::accumulate(v, 0u) == 665u * 666u / 2 - 300u);
+        auto chunks = 0u;
+        immer::for_each_chunk(v, [&](auto first, auto last) {
+            CHECK(last - first <= 16);
+            ++chunks;
+        });
+        CHECK(chunks == (666u + 15) / 16);
+    }
+}
+
+TEST_CASE("transient")
+{
+    const auto n = 666u;
+    auto v       = dvektor<unsigned>{};
+    for (auto i = 0u; i < n; ++i)
+        v = v.push_back(i);
+
+    SECTION("push back")
+    {
+        auto t = v.transient();
+        for (auto i = n; i < 2 * n; ++i)
+            t.push_back(i);
+        auto w = t.persistent();
+        CHECK(v.size() == n);
+        CHECK(w.size() == 2 * n);
+        for (auto i = 0u; i < w.size(); ++i)
+            CHECK(w[i] == i);
+    }
+
+    SECTION("set does not change the persistent values")
+    {
+        auto t = v.transient();
+        for (auto i = 0u; i < n; ++i) {
+            t.set(i, i + 1);
+            if (i == n / 2)
+                v = t.persistent();
+        }
+        t.update(0u, [](auto x) { return x * 10; });
+        for (auto i = 0u; i < n; ++i) {
+            CHECK(v[i] == (i <= n / 2 ? i + 1 : i));
+            CHECK(t[i] == (i ? i + 1 : 10u));
+        }
+    }
+}
+
+TEST_CASE("memory policies")
+{
+    using gc_memory = immer::memory_policy<immer::heap_policy<immer::gc_heap>,
+                                           immer::no_refcount_policy,
+                                           immer::default_lock_policy,
+                                           immer::gc_transience_policy,
+                                           false>;
+
+    auto t = dvektor<unsigned, gc_memory>{}.transient();
+    for (auto i = 0u; i < 666u; ++i)
+        t.push_back(i);
+    auto v = std::move(t).persistent();
+    auto u = v.assoc(42u, 0u);
+    CHECK(v[42u] == 42u);
+    CHECK(u[42u] == 0u);
+    CHECK(immer::accumulate(v, 0u) == 665u * 666u / 2);
+}
@@ -19,6 +19,8 @@
 #include <algorithm>
 #include <array>
 #include <numeric>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 #ifndef FLEX_VECTOR_T
@@ -87,6 +89,25 @@ auto make_many_test_flex_vector_front_remainder()
     return many;
 }
 
+TEST_CASE("from range parallel")
+{
+    using vector_t = FLEX_VECTOR_T<unsigned>;
+
+    auto r = std::vector<unsigned>(3000u);
+    std::iota(r.begin(), r.end(), 0u);
+    for (auto n : {0u, 1u, 2u, 33u, 1024u, 1025u, 3000u}) {
+        auto v = vector_t::from_range_parallel(
+            r.begin(), r.begin() + n, immer::thread_executor{3});
+        auto s = vector_t{r.begin(), r.begin() + n};
+        CHECK(v.impl().shift == s.impl().shift);
+        CHECK(v == s);
+        CHECK_VECTOR_EQUALS(v, boost::irange(0u, n));
+        CHECK_VECTOR_EQUALS(v + s,
+                            boost::join(boost::irange(0u, n),
+                                        boost::irange(0u, n)));
+    }
+}
+
 TEST_CASE("set relaxed")
 {
     auto v = make_test_flex_vector_front(0, 666u);
@@ -109,6 +130,53 @@ TEST_CASE("push_front")
     }
 }
 
+TEST_CASE("push_front mixed")
+{
+    const auto n = 666u;
+
+    SECTION("onto regular")
+    {
+        auto v = make_test_flex_vector(n, 2 * n);
+        for (auto i = n; i > 0;) {
+            v = v.push_front(--i);
+            CHECK(v.size() == 2 * n - i);
+            CHECK(v[0] == i);
+        }
+        CHECK_VECTOR_EQUALS(v, boost::irange(0u, 2 * n));
+    }
+
+    SECTION("keeps old versions")
+    {
+        auto vs = std::vector<FLEX_VECTOR_T<unsigned>>{{}};
+        for (auto i = 0u; i < n; ++i)
+            vs.push_back(vs.back().push_front(n - i - 1).push_back(n + i));
+        for (auto i = 0u; i <= n; ++i)
+            CHECK_VECTOR_EQUALS(vs[i], boost::irange(n - i, n + i));
+    }
+
+    SECTION("move")
+    {
+        auto v = FLEX_VECTOR_T<unsigned>{};
+        for (auto i = n; i > 0;)
+            v = std::move(v).push_front(--i);
+        CHECK_VECTOR_EQUALS(v, boost::irange(0u, n));
+    }
+
+    SECTION("concat, take and drop")
+    {
+        auto v = make_test_flex_vector_front(0, n);
+        auto w = v + v;
+        CHECK_VECTOR_EQUALS(
+            w, boost::join(boost::irange(0u, n), boost::irange(0u, n)));
+        for (auto i = 0u; i < n; i += 11) {
+            CHECK_VECTOR_EQUALS(v.take(i), boost::irange(0u, i));
+            CHECK_VECTOR_EQUALS(v.drop(i), boost::irange(i, n));
+            CHECK_VECTOR_EQUALS(v.drop(i).push_front(42u).drop(1),
+                                boost::irange(i, n));
+        }
+    }
+}
+
 TEST_CASE("random_access iteration")
 {
     auto v    = make_test_flex_vector(0, 10);
@@ -172,6 +240,279 @@ TEST_CASE("concat recursive")
     CHECK_VECTOR_EQUALS(v, boost::irange(0u, n));
 }
 
+TEST_CASE("compact")
+{
+    const auto n = 666u;
+
+    SECTION("regular")
+    {
+        auto v = make_test_flex_vector(0, n);
+        auto c = v.compact();
+        CHECK(c.identity() == v.identity());
+    }
+
+    SECTION("relaxed")
+    {
+        auto v = make_flex_vector_concat(0, n);
+        for (auto i = 0u; i < n / 2; i += 7)
+            v = v.erase(i);
+        REQUIRE(v.impl().root->relaxed());
+        auto c = v.compact();
+        CHECK(!c.impl().root->relaxed());
+        CHECK_VECTOR_EQUALS(c, v);
+        CHECK_VECTOR_EQUALS(c.push_back(42u).take(c.size()), v);
+        CHECK_VECTOR_EQUALS(c.compact(), v);
+    }
+}
+
+TEST_CASE("concat all")
+{
+    using vector_t = FLEX_VECTOR_T<unsigned>;
+
+    auto check = [](const std::vector<unsigned>& sizes) {
+        auto parts = std::vector<vector_t>{};
+        auto n     = 0u;
+        for (auto s : sizes) {
+            parts.push_back(s % 2 ? make_test_flex_vector_front(n, n + s)
+                                  : make_test_flex_vector(n, n + s));
+            n += s;
+        }
+        auto v = immer::concat_all(parts);
+        CHECK_VECTOR_EQUALS(v, boost::irange(0u, n));
+        CHECK_VECTOR_EQUALS(immer::par_concat_all(parts,
+                                                  immer::thread_executor{3}),
+                            boost::irange(0u, n));
+        auto first = 0u;
+        for (auto i = 0u; i < sizes.size(); first += sizes[i++])
+            CHECK_VECTOR_EQUALS(parts[i],
+                                boost::irange(first, first + sizes[i]));
+    };
+
+    check({});
+    check({0u});
+    check({5u});
+    check({1u, 0u, 2u, 3u});
+    check(std::vector<unsigned>(300u, 3u));
+    check({100u, 1u, 1u, 500u, 7u, 0u, 66u, 1000u, 3u});
+
+    auto sizes = std::vector<unsigned>{};
+    for (auto i = 0u; i < 200u; ++i)
+        sizes.push_back(i * 7 % 43);
+    check(sizes);
+}
+
+
+TEST_CASE("split")
+{
+    using vector_t = FLEX_VECTOR_T<unsigned>;
+
+    auto n = 1000u;
+    auto v = make_flex_vector_concat(0, n);
+
+    SECTION("at positions")
+    {
+        auto positions = std::vector<std::size_t>{0, 3, 3, 100, 555, 999};
+        auto parts     = immer::split_at(v, positions);
+        REQUIRE(parts.size() == positions.size() + 1);
+        auto first = std::size_t{};
+        for (auto i = std::size_t{}; i < parts.size(); ++i) {
+            auto last = i < positions.size() ? positions[i] : n;
+            CHECK_VECTOR_EQUALS(parts[i], boost::irange(first, last));
+            first = last;
+        }
+        CHECK_VECTOR_EQUALS(immer::concat_all(parts), v);
+        CHECK_VECTOR_EQUALS(v, boost::irange(0u, n));
+    }
+
+    SECTION("beyond the end")
+    {
+        auto parts = immer::split_at(v, std::vector<std::size_t>{500, 2000});
+        REQUIRE(parts.size() == 3);
+        CHECK(parts[0].size() == 500);
+        CHECK(parts[1].size() == 500);
+        CHECK(parts[2].empty());
+        CHECK(immer::split_at(v, std::vector<std::size_t>{}).front() == v);
+    }
+
+    SECTION("in balanced parts")
+    {
+        for (auto k : {1u, 2u, 3u, 7u, 64u, 1000u, 1500u}) {
+            auto parts = immer::split(v, k);
+            REQUIRE(parts.size() == k);
+            auto sizes = std::vector<std::size_t>{};
+            for (auto& p : parts)
+                sizes.push_back(p.size());
+            auto mm = std::minmax_element(sizes.begin(), sizes.end());
+            CHECK(*mm.second - *mm.first <= 1);
+            CHECK_VECTOR_EQUALS(immer::concat_all(parts), v);
+        }
+        CHECK(immer::split(v, 0).empty());
+        CHECK(immer::split(vector_t{}, 3).size() == 3);
+    }
+}
+TEST_CASE("apply patch")
+{
+    using vector_t = FLEX_VECTOR_T<unsigned>;
+    using edit_t   = typename vector_t::edit;
+
+    const auto n = 1000u;
+    auto v       = make_flex_vector_concat(0, n);
+
+    SECTION("insert, erase and replace")
+    {
+        auto edits = std::vector<edit_t>{
+            {0, 0, {42u, 43u}},
+            {5, 6, {100u}},
+            {10, 500, {}},
+            {600, 600, make_test_flex_vector(2000, 2100)},
+            {999, 1000, {}},
+        };
+        auto r = v.apply_patch(edits);
+        auto e = std::vector<unsigned>{42u, 43u};
+        for (auto i = 0u; i < n; ++i) {
+            if (i == 5)
+                e.push_back(100u);
+            else if (i == 600) {
+                for (auto j = 2000u; j < 2100u; ++j)
+                    e.push_back(j);
+                e.push_back(i);
+            } else if (!(i >= 10 && i < 500) && i != 999)
+                e.push_back(i);
+        }
+        CHECK_VECTOR_EQUALS(r, e);
+        CHECK_VECTOR_EQUALS(v, boost::irange(0u, n));
+        CHECK_VECTOR_EQUALS(std::move(v).apply_patch(edits), e);
+    }
+
+    SECTION("no edits")
+    {
+        CHECK(v.apply_patch(std::vector<edit_t>{}) == v);
+        CHECK_VECTOR_EQUALS(
+            vector_t{}.apply_patch(std::vector<edit_t>{{0, 0, {1u, 2u}}}),
+            std::vector<unsigned>({1u, 2u}));
+    }
+
+    SECTION("many small edits")
+    {
+        auto edits = std::vector<edit_t>{};
+        auto e     = std::vector<unsigned>{};
+        for (auto i = 0u; i < n; ++i) {
+            switch (i % 7) {
+            case 0:
+                edits.push_back({i, i + 1, {i * 10}});
+                e.push_back(i * 10);
+                break;
+            case 3:
+                edits.push_back({i, i + 2, {}});
+                ++i;
+                break;
+            case 5:
+                edits.push_back({i, i, {n + i}});
+                e.push_back(n + i);
+                e.push_back(i);
+                break;
+            default:
+                e.push_back(i);
+            }
+        }
+        CHECK_VECTOR_EQUALS(v.apply_patch(edits), e);
+    }
+}
+
+TEST_CASE("sort")
+{
+    using pair_t   = std::pair<unsigned, unsigned>;
+    using vector_t = FLEX_VECTOR_T<pair_t>;
+    auto by_first  = [](const pair_t& a, const pair_t& b) {
+        return a.first < b.first;
+    };
+
+    for (auto n : {0u, 1u, 33u, 666u, 3000u}) {
+        auto v = vector_t{};
+        for (auto i = 0u; i < n; ++i)
+            v = i % 2 ? v.push_front({i * 7919 % 101, i})
+                      : v.push_back({i * 7919 % 101, i});
+        auto expected = std::vector<pair_t>(v.begin(), v.end());
+        std::stable_sort(expected.begin(), expected.end(), by_first);
+
+        auto s = immer::sort(v, by_first);
+        CHECK_VECTOR_EQUALS(s, expected);
+        auto p = immer::par_sort(v, by_first, immer::thread_executor{3});
+        CHECK_VECTOR_EQUALS(p, expected);
+        CHECK(immer::sort(s) == immer::par_sort(v));
+        CHECK(v.size() == n);
+    }
+}
+
+TEST_CASE("sorted lookups")
+{
+    const auto n = 666u;
+    // every even number twice, built relaxed from both ends
+    auto v = FLEX_VECTOR_T<unsigned>{};
+    for (auto i = n / 2; i-- > 0;)
+        v = v.push_front(i * 2).push_front(i * 2);
+    auto s = std::vector<unsigned>(v.begin(), v.end());
+
+    for (auto k = 0u; k <= n + 1; ++k) {
+        CHECK(immer::lower_bound(v, k) - v.begin() ==
+              std::lower_bound(s.begin(), s.end(), k) - s.begin());
+        CHECK(immer::upper_bound(v, k) - v.begin() ==
+              std::upper_bound(s.begin(), s.end(), k) - s.begin());
+    }
+
+    auto r = FLEX_VECTOR_T<unsigned>{s.rbegin(), s.rend()};
+    CHECK(immer::lower_bound(r, 100u, std::greater<>{}) - r.begin() ==
+          std::lower_bound(s.rbegin(), s.rend(), 100u, std::greater<>{}) -
+              s.rbegin());
+    CHECK(immer::lower_bound(FLEX_VECTOR_T<unsigned>{}, 1u) ==
+          FLEX_VECTOR_T<unsigned>{}.end());
+}
+
+TEST_CASE("sorted set operations")
+{
+    using vector_t = FLEX_VECTOR_T<unsigned>;
+
+    auto make = [](std::vector<unsigned> xs) {
+        return vector_t{xs.begin(), xs.end()};
+    };
+    auto range = [](unsigned first, unsigned last, unsigned step = 1) {
+        auto r = std::vector<unsigned>{};
+        for (auto i = first; i < last; i += step)
+            r.push_back(i);
+        return r;
+    };
+    auto check = [](const vector_t& a, const vector_t& b) {
+        auto u = std::vector<unsigned>{};
+        std::set_union(
+            a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(u));
+        CHECK_VECTOR_EQUALS(immer::set_union(a, b), u);
+        auto i = std::vector<unsigned>{};
+        std::set_intersection(
+            a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(i));
+        CHECK_VECTOR_EQUALS(immer::set_intersection(a, b), i);
+    };
+
+    auto empty  = vector_t{};
+    auto evens  = make(range(0, 1000, 2));
+    auto odds   = make(range(1, 1000, 2));
+    auto low    = make(range(0, 300));
+    auto high   = make(range(200, 900));
+    auto thirds = make(range(0, 1000, 3));
+    auto dups   = make({1, 1, 1, 2, 5, 5, 100, 100, 101});
+
+    for (auto& a : {empty, evens, odds, low, high, thirds, dups})
+        for (auto& b : {empty, evens, odds, low, high, thirds, dups})
+            check(a, b);
+
+    CHECK(immer::set_union(low, low).identity() == low.identity());
+    CHECK(immer::set_union(high, make(range(300, 400))).identity() ==
+          high.identity());
+    CHECK(immer::set_intersection(low, make(range(0, 900))).identity() ==
+          low.identity());
+    CHECK(immer::set_union(evens, odds, std::less<unsigned>{}).size() ==
+          1000u);
+}
+
 TEST_CASE("insert")
 {
     SECTION("normal")
@@ -363,6 +704,29 @@ TEST_CASE("equals bugs")
     }
 }
 
+TEST_CASE("equals with different shapes")
+{
+    const auto n = 666u;
+    auto v       = make_test_flex_vector(0, n);
+    auto w       = make_test_flex_vector_front(0, n);
+
+    for (auto i : {1u, 7u, 31u, 33u, 100u, 333u, 600u, 665u}) {
+        auto x = v.take(i) + w.drop(i);
+        CHECK(x == v);
+        CHECK(w == x);
+        CHECK(x != v.set(i, 0));
+        CHECK(w.set(i - 1, n) != x);
+        CHECK(x != w.set(n - 1, 0));
+    }
+
+    auto s = FLEX_VECTOR_T<std::string>{};
+    for (auto i : test_irange(0u, n))
+        s = std::move(s).push_back(std::to_string(i));
+    auto t = s.take(45) + s.drop(45).take(300) + s.drop(345);
+    CHECK(s == t);
+    CHECK(s != t.set(400, "x"));
+}
+
 TEST_CASE("take relaxed")
 {
     const auto n = 666u;
@@ -374,6 +738,28 @@ TEST_CASE("take relaxed")
     }
 }
 
+TEST_CASE("pop_front")
+{
+    const auto n = 666u;
+    auto v       = make_test_flex_vector_front(0, n);
+
+    auto vv = v;
+    for (auto i = 0u; i < n; ++i) {
+        vv = vv.pop_front();
+        CHECK_VECTOR_EQUALS_RANGE(vv, v.begin() + i + 1, v.end());
+    }
+    CHECK(vv.pop_front().empty());
+
+    auto mv = v;
+    for (auto i = 0u; i < n; ++i) {
+        mv = std::move(mv).pop_front().pop_back();
+        if (!mv.empty())
+            CHECK(mv.front() == v[i + 1]);
+        if (mv.size() < 2)
+            break;
+    }
+}
+
 TEST_CASE("drop")
 {
     const auto n = 666u;
@@ -537,6 +923,77 @@ TEST_CASE("adopt regular vector contents")
     }
 }
 
+template <typename V>
+auto diff_ranges(const V& a, const V& b)
+{
+    auto result = std::vector<std::tuple<char, std::size_t, std::size_t>>{};
+    immer::diff(
+        a,
+        b,
+        [&](auto f, auto l) { result.emplace_back('+', f, l); },
+        [&](auto f, auto l) { result.emplace_back('-', f, l); },
+        [&](auto f, auto l) { result.emplace_back('~', f, l); });
+    return result;
+}
+
+template <typename V>
+auto expected_diff_ranges(const V& a, const V& b)
+{
+    auto result = std::vector<std::tuple<char, std::size_t, std::size_t>>{};
+    auto common = std::min(a.size(), b.size());
+    for (auto i = std::size_t{}; i < common;) {
+        if (a[i] == b[i]) {
+            ++i;
+            continue;
+        }
+        auto f = i;
+        while (i < common && a[i] != b[i])
+            ++i;
+        result.emplace_back('~', f, i);
+    }
+    if (a.size() > common)
+        result.emplace_back('-', common, a.size());
+    if (b.size() > common)
+        result.emplace_back('+', common, b.size());
+    return result;
+}
+
+TEST_CASE("diff relaxed")
+{
+    auto v = make_test_flex_vector(0, 666u);
+    auto r = make_test_flex_vector(0, 42u) + v + make_test_flex_vector(0, 300u);
+
+    auto check_diff = [](auto&& a, auto&& b) {
+        CHECK(diff_ranges(a, b) == expected_diff_ranges(a, b));
+        CHECK(diff_ranges(b, a) == expected_diff_ranges(b, a));
+    };
+
+    SECTION("identical") { CHECK(diff_ranges(r, r).empty()); }
+    SECTION("updates") { check_diff(r, r.set(0, 1u).set(500, 1u)); }
+    SECTION("regular vs relaxed") { check_diff(v, r); }
+    SECTION("concat") { check_diff(r, r + v); }
+    SECTION("push front") { check_diff(r, r.push_front(13u)); }
+    SECTION("insert and erase")
+    {
+        check_diff(r, r.insert(100, 13u));
+        check_diff(r, r.erase(666));
+        check_diff(r, r.drop(10));
+        check_diff(r, r.take(800).set(799, 0u));
+    }
+    SECTION("many versions")
+    {
+        auto w = r;
+        for (auto i = 0u; i < 50u; ++i) {
+            auto next = i % 5 == 0   ? w.push_front(i) + v.take(i * 7)
+                        : i % 3 == 0 ? w.erase(i * 11)
+                                     : w.set(i * 13, i);
+            check_diff(w, next);
+            check_diff(r, next);
+            w = next;
+        }
+    }
+}
+
 TEST_CASE("exception safety relaxed")
 {
     using dadaist_vector_t =
@@ -561,6 +1018,24 @@ TEST_CASE("exception safety relaxed")
         IMMER_TRACE_E(d.happenings);
     }
 
+    SECTION("push front")
+    {
+        auto half = n / 2;
+        auto v    = make_test_flex_vector<dadaist_vector_t>(half, n);
+        auto d    = dadaism{};
+        for (auto i = half; v.size() < static_cast<decltype(v.size())>(n);) {
+            auto s = d.next();
+            try {
+                v = v.push_front({i - 1});
+                --i;
+            } catch (dada_error) {
+            }
+            CHECK_VECTOR_EQUALS(v, boost::irange(i, n));
+        }
+        CHECK(d.happenings > 0);
+        IMMER_TRACE_E(d.happenings);
+    }
+
     SECTION("update")
     {
         auto v = make_test_flex_vector_front<dadaist_vector_t>(0, n);
@@ -616,3 +1091,43 @@ TEST_CASE("exception safety relaxed")
         IMMER_TRACE_E(d.happenings);
     }
 }
+
+TEST_CASE("filter relaxed")
+{
+    auto v = make_test_flex_vector(0, 666u);
+    auto r = make_test_flex_vector(0, 42u) + v + make_test_flex_vector(0, 300u);
+
+    auto check_filter = [](auto&& a, auto pred) {
+        auto f = immer::filter(a, pred);
+        auto e = FLEX_VECTOR_T<unsigned>{};
+        for (auto x : a)
+            if (pred(x))
+                e = e.push_back(x);
+        CHECK_VECTOR_EQUALS(f, e);
+        CHECK(f.size() == e.size());
+    };
+
+    check_filter(r, [](unsigned x) { return x % 3 != 0; });
+    check_filter(r, [](unsigned x) { return x != 41 && x != 500; });
+    check_filter(r, [](unsigned x) { return x < 100; });
+    check_filter(r, [](unsigned) { return false; });
+    CHECK(immer::filter(r, [](unsigned) { return true; }).identity() ==
+          r.identity());
+}
+
+TEST_CASE("get_many relaxed")
+{
+    auto v = make_test_flex_vector(0, 666u);
+    auto r = make_test_flex_vector(0, 42u) + v + make_test_flex_vector(0, 300u);
+    r      = r.push_front(7u).insert(500, 13u);
+
+    auto indices = std::vector<std::size_t>{};
+    for (auto i = std::size_t{}; i < r.size(); i += 3)
+        indices.push_back(i);
+    indices.push_back(r.size() - 1);
+    auto out = std::vector<unsigned>{};
+    r.get_many(indices, std::back_inserter(out));
+    REQUIRE(out.size() == indices.size());
+    for (auto i = 0u; i < indices.size(); ++i)
+        CHECK(out[i] == r[indices[i]]);
+}
@@ -0,0 +1,38 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/flex_vector.hpp>
+#include <immer/flex_vector_transient.hpp>
+#include <immer/heap/arena_heap.hpp>
+#include <immer/heap/gc_heap.hpp>
+#include <immer/refcount/no_refcount_policy.hpp>
+#include <immer/transience/arena_transience_policy.hpp>
+#include <immer/vector.hpp>
+#include <immer/vector_transient.hpp>
+
+using arena_memory =
+    immer::memory_policy<immer::heap_policy<immer::arena_heap<immer::gc_heap>>,
+                         immer::no_refcount_policy,
+                         immer::default_lock_policy,
+                         immer::arena_transience_policy,
+                         false>;
+
+template <typename T>
+using test_flex_vector_t = immer::flex_vector<T, arena_memory, 3u>;
+
+template <typename T>
+using test_vector_t = immer::vector<T, arena_memory, 3u>;
+
+template <typename T>
+using test_flex_vector_transient_t =
+    immer::flex_vector_transient<T, arena_memory, 3u>;
+
+#define FLEX_VECTOR_T test_flex_vector_t
+#define FLEX_VECTOR_TRANSIENT_T test_flex_vector_transient_t
+#define VECTOR_T test_vector_t
+#include "generic.ipp"
@@ -78,6 +78,71 @@ TEST_CASE("adopt regular vector contents")
     }
 }
 
+TEST_CASE("push_front")
+{
+    const auto n = 666u;
+
+    SECTION("empty")
+    {
+        auto t = FLEX_VECTOR_TRANSIENT_T<unsigned>{};
+        for (auto i = n; i > 0;) {
+            t.push_front(--i);
+            CHECK(t.size() == n - i);
+            CHECK(t[0] == i);
+        }
+        CHECK_VECTOR_EQUALS(t, boost::irange(0u, n));
+    }
+
+    SECTION("both ends")
+    {
+        auto p = make_test_flex_vector_front(n, 2 * n);
+        auto t = p.transient();
+        for (auto i = 0u; i < n; ++i) {
+            t.push_front(n - i - 1);
+            t.push_back(2 * n + i);
+        }
+        CHECK_VECTOR_EQUALS(t, boost::irange(0u, 3 * n));
+        CHECK_VECTOR_EQUALS(p, boost::irange(n, 2 * n));
+        CHECK_VECTOR_EQUALS(t.persistent(), boost::irange(0u, 3 * n));
+    }
+}
+
+TEST_CASE("compact")
+{
+    const auto n = 666u;
+    auto p       = make_test_flex_vector_front(0, n);
+    auto t       = p.transient();
+    t.drop(n / 3);
+    t.push_front(42u);
+    REQUIRE(t.persistent().impl().root->relaxed());
+    t.compact();
+    auto c = t.persistent();
+    CHECK(!c.impl().root->relaxed());
+    CHECK(c[0] == 42u);
+    CHECK_VECTOR_EQUALS_RANGE(c.drop(1), p.begin() + n / 3, p.end());
+    CHECK_VECTOR_EQUALS(p, boost::irange(0u, n));
+}
+
+TEST_CASE("mutate relaxed chunks in place")
+{
+    const auto n = 666u;
+    auto p       = make_test_flex_vector_front(0, n);
+    auto t       = p.transient();
+
+    auto seen = 0u;
+    t.for_each_chunk_mut([&](auto first, auto last) {
+        for (; first != last; ++first, ++seen) {
+            CHECK(*first == seen);
+            *first += n;
+        }
+    });
+    CHECK(seen == n);
+    t.update_range(100, 300, [](auto x) { return x - n; });
+    for (auto i = 0u; i < n; ++i)
+        CHECK(t[i] == (i >= 100 && i < 300 ? i : i + n));
+    CHECK_VECTOR_EQUALS(p, boost::irange(0u, n));
+}
+
 TEST_CASE("drop move")
 {
     using vector_t = FLEX_VECTOR_T<unsigned>;
@@ -107,6 +172,30 @@ TEST_CASE("drop move")
     CHECK_VECTOR_EQUALS(v, boost::irange(1u, 2u));
 }
 
+TEST_CASE("resize")
+{
+    using vector_t   = FLEX_VECTOR_T<unsigned>;
+    constexpr auto l = std::size_t{1} << vector_t::bits_leaf;
+
+    auto p = make_test_flex_vector_front(0, 5);
+    auto t = p.transient();
+    t.resize(3);
+    CHECK_VECTOR_EQUALS(t, boost::irange(0u, 3u));
+
+    auto n = 100 * l + 7;
+    t.resize(n, 42u);
+    CHECK(t.size() == n);
+    CHECK(t[2] == 2u);
+    CHECK(t[3] == 42u);
+    CHECK(t[n - 1] == 42u);
+    t.set(n / 2, 7u);
+    t.push_back(8u);
+    CHECK(t[n / 2] == 7u);
+    CHECK(t[n / 2 + 1] == 42u);
+    CHECK(t[n] == 8u);
+    CHECK_VECTOR_EQUALS(p, boost::irange(0u, 5u));
+}
+
 TEST_CASE("exception safety relaxed")
 {
     using dadaist_vector_t =
@@ -145,6 +234,38 @@ TEST_CASE("exception safety relaxed")
         IMMER_TRACE_E(t.d.happenings);
     }
 
+    SECTION("push front")
+    {
+        auto half = n / 2;
+        auto t    = as_transient_tester(
+            make_test_flex_vector<dadaist_vector_t>(half, n));
+        auto d = dadaism{};
+        for (auto li = half, i = half; i > 0;) {
+            auto s = d.next();
+            try {
+                if (t.transient)
+                    t.vt.push_front({i - 1});
+                else
+                    t.vp = t.vp.push_front({i - 1});
+                --i;
+            } catch (dada_error) {
+            }
+            if (t.step())
+                li = i;
+            if (t.transient) {
+                CHECK_VECTOR_EQUALS(t.vt, boost::irange(i, n));
+                CHECK_VECTOR_EQUALS(t.vp, boost::irange(li, n));
+            } else {
+                CHECK_VECTOR_EQUALS(t.vp, boost::irange(i, n));
+                CHECK_VECTOR_EQUALS(t.vt, boost::irange(li, n));
+            }
+        }
+        CHECK(d.happenings > 0);
+        CHECK(t.d.happenings > 0);
+        IMMER_TRACE_E(d.happenings);
+        IMMER_TRACE_E(t.d.happenings);
+    }
+
     SECTION("update")
     {
         using boost::irange;
@@ -0,0 +1,92 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/flex_vector.hpp>
+#include <immer/focus.hpp>
+#include <immer/vector.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <random>
+
+namespace {
+
+template <typename V>
+V make_test_vector(unsigned n)
+{
+    auto v = V{};
+    for (auto i = 0u; i < n; ++i)
+        v = v.push_back(i);
+    return v;
+}
+
+template <typename V>
+void check_focus(const V& v)
+{
+    auto f  = immer::focus(v);
+    auto ok = true;
+    REQUIRE(f.size() == v.size());
+    for (auto i = std::size_t{}; i < v.size(); ++i)
+        ok = ok && f[i] == v[i];
+    for (auto i = v.size(); i-- > 0;)
+        ok = ok && f[i] == v[i];
+    auto gen = std::mt19937{42};
+    auto pos = std::size_t{};
+    for (auto i = 0; v.size() && i < 2000; ++i) {
+        // mostly small jumps around the last position, sometimes far
+        pos = gen() % 8 ? (pos + gen() % 70 + v.size() - 35) % v.size()
+                        : gen() % v.size();
+        ok  = ok && f[pos] == v[pos];
+    }
+    CHECK(ok);
+    CHECK_THROWS_AS(f.at(v.size()), std::out_of_range);
+}
+
+} // namespace
+
+TEST_CASE("focus on a vector")
+{
+    using vector_t = immer::vector<unsigned>;
+    for (auto n : {0u, 1u, 32u, 33u, 1024u, 1025u, 5000u, 40000u})
+        check_focus(make_test_vector<vector_t>(n));
+
+    using small_t = immer::vector<unsigned, immer::default_memory_policy, 2, 2>;
+    check_focus(make_test_vector<small_t>(3000u));
+}
+
+TEST_CASE("focus on a flex_vector")
+{
+    using vector_t = immer::flex_vector<unsigned>;
+    auto v         = make_test_vector<vector_t>(5000u);
+    check_focus(v);
+    check_focus(v.drop(77));
+    check_focus(v.take(1999));
+    check_focus(v.drop(100).take(3000) + v + v.take(33));
+    auto f = vector_t{};
+    for (auto i = 0u; i < 100; ++i)
+        f = f + v.drop(i * 7).take(13);
+    check_focus(f);
+    check_focus(f.push_front(42u));
+
+    using small_t =
+        immer::flex_vector<unsigned, immer::default_memory_policy, 2, 2>;
+    auto s = make_test_vector<small_t>(1000u);
+    auto g = small_t{};
+    for (auto i = 0u; i < 60; ++i)
+        g = s.drop(i * 3).take(i + 5) + g;
+    check_focus(g);
+}
+
+TEST_CASE("focus keeps the vector alive")
+{
+    auto f = immer::focus(make_test_vector<immer::vector<unsigned>>(100u));
+    auto& x = f[50];
+    CHECK(f[51] == 51u);
+    CHECK(x == 50u);
+    CHECK(f.vector().size() == 100u);
+}
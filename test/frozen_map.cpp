@@ -0,0 +1,88 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/frozen_map.hpp>
+#include <immer/map.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// the identity hash of small integers only sets the lowest bits
+struct identity_hash
+{
+    std::size_t operator()(unsigned x) const { return x; }
+};
+
+struct bad_hash
+{
+    std::size_t operator()(const std::string&) const { return 42; }
+};
+
+} // namespace
+
+TEST_CASE("freeze empty map")
+{
+    auto f = immer::freeze(immer::map<int, int>{});
+    CHECK(f.empty());
+    CHECK(f.size() == 0);
+    CHECK(f.count(1) == 0);
+    CHECK(f.find(1) == nullptr);
+    CHECK(f[1] == 0);
+    CHECK_THROWS_AS(f.at(1), std::out_of_range);
+    CHECK(immer::frozen_map<int, int>{}.empty());
+}
+
+TEST_CASE("freeze map")
+{
+    auto m = immer::map<unsigned, std::string, identity_hash>{};
+    for (auto i = 0u; i < 10000u; ++i)
+        m = std::move(m).set(i * 3, std::to_string(i));
+
+    auto f = immer::freeze(m);
+    CHECK(f.size() == m.size());
+    for (auto i = 0u; i < 30000u; ++i) {
+        if (i % 3 == 0) {
+            CHECK(f.count(i) == 1);
+            CHECK(f[i] == std::to_string(i / 3));
+            CHECK(f.at(i) == std::to_string(i / 3));
+            REQUIRE(f.find(i));
+            CHECK(*f.find(i) == std::to_string(i / 3));
+        } else {
+            CHECK(f.count(i) == 0);
+            CHECK(f.find(i) == nullptr);
+            CHECK(f[i] == "");
+        }
+    }
+    CHECK(immer::unfreeze(f) == m);
+    CHECK(immer::unfreeze(f).identity() == m.identity());
+
+    auto n = 0u;
+    for (auto& kv : f) {
+        CHECK(f[kv.first] == kv.second);
+        ++n;
+    }
+    CHECK(n == f.size());
+
+    auto g = f;
+    CHECK(g.find(3) == f.find(3));
+}
+
+TEST_CASE("freeze map with colliding keys")
+{
+    auto m = immer::map<std::string, int, bad_hash>{};
+    for (auto i = 0; i < 100; ++i)
+        m = std::move(m).set(std::to_string(i), i);
+    auto f = immer::freeze(m);
+    for (auto i = 0; i < 100; ++i)
+        CHECK(f[std::to_string(i)] == i);
+    CHECK(f.count("x") == 0);
+}
@@ -0,0 +1,116 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/graph.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using graph_t = immer::graph<std::uint32_t>;
+
+// checks that the representation has the same edges as the graph
+void check_csr(const graph_t& g, const graph_t::csr_type& csr)
+{
+    CHECK(csr.size() == g.node_count());
+    CHECK(csr.edge_count() == g.edge_count());
+    CHECK(csr.offsets().size() == g.node_count() + 1);
+    auto i = std::size_t{};
+    for (auto& kv : g.adjacency()) {
+        CHECK(csr.nodes()[i] == kv.first);
+        CHECK(csr.index_of(kv.first) == i);
+        auto s = csr.successors(i);
+        CHECK(static_cast<std::size_t>(s.second - s.first) ==
+              kv.second.size());
+        auto j = std::size_t{};
+        for (auto p = s.first; p != s.second; ++p, ++j)
+            CHECK(csr.nodes()[*p] == kv.second[j]);
+        ++i;
+    }
+}
+
+} // namespace
+
+TEST_CASE("graph edges")
+{
+    auto g = graph_t{}.add_edge(1, 3).add_edge(1, 2).add_edge(4, 1);
+    CHECK(g.node_count() == 4u);
+    CHECK(g.edge_count() == 3u);
+    CHECK(g.has_edge(1, 2));
+    CHECK(g.has_edge(4, 1));
+    CHECK(!g.has_edge(2, 1));
+    CHECK(g.contains(3));
+    CHECK(!g.contains(5));
+    CHECK(g.successors(1) == graph_t::edges_type{2, 3});
+    CHECK(g.successors(5).empty());
+
+    // adding an edge twice does nothing
+    CHECK(g.add_edge(1, 2) == g);
+    CHECK(g.add_edge(1, 2).edge_count() == 3u);
+
+    auto h = g.erase_edge(1, 3).erase_edge(7, 8);
+    CHECK(h.edge_count() == 2u);
+    CHECK(h.contains(3));
+    CHECK(!h.has_edge(1, 3));
+    CHECK(g.has_edge(1, 3));
+    CHECK(h != g);
+
+    auto k = h.add_node(9).add_node(9);
+    CHECK(k.node_count() == 5u);
+    CHECK(k.successors(9).empty());
+}
+
+TEST_CASE("graph to_csr")
+{
+    auto g = graph_t{};
+    CHECK(g.to_csr().size() == 0u);
+
+    auto edges = std::set<std::pair<std::uint32_t, std::uint32_t>>{};
+    auto state = std::uint32_t{12345};
+    for (auto i = 0; i < 20000; ++i) {
+        state     = state * 1103515245u + 12345u;
+        auto from = (state >> 8) % 1000u;
+        state     = state * 1103515245u + 12345u;
+        auto to   = (state >> 8) % 1000u * 7u;
+        g         = std::move(g).add_edge(from, to);
+        edges.insert({from, to});
+    }
+    CHECK(g.edge_count() == edges.size());
+
+    auto csr = g.to_csr(immer::thread_executor{4});
+    check_csr(g, csr);
+    CHECK(csr.reused_rows() == 0u);
+
+    SECTION("same nodes, a few rows change")
+    {
+        auto a = std::uint32_t{};
+        while (g.successors(a).empty())
+            ++a;
+        auto b = g.successors(a)[0];
+        auto h = g.erase_edge(a, b).add_edge(a + 1, b);
+
+        auto next = h.to_csr(csr, immer::thread_executor{4});
+        check_csr(h, next);
+        CHECK(next.reused_rows() == h.node_count() - 2);
+        // the old one is still valid
+        check_csr(g, csr);
+    }
+
+    SECTION("new nodes")
+    {
+        auto h    = g.add_edge(5, 100000);
+        auto next = h.to_csr(csr, immer::sequential_executor{});
+        check_csr(h, next);
+        CHECK(next.reused_rows() == 0u);
+    }
+}
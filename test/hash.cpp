@@ -0,0 +1,138 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#define IMMER_USE_DEFAULT_HASH 1
+
+#include <immer/hash.hpp>
+#include <immer/map.hpp>
+#include <immer/set.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if IMMER_HAS_CPP17
+#include <string_view>
+#endif
+
+namespace {
+
+// the identity, like std::hash<int> is in most standard libraries
+struct identity_hash
+{
+    std::size_t operator()(int x) const { return static_cast<std::size_t>(x); }
+};
+
+// counts how many of `n` hashes land in each of the 32 buckets that the
+// first level of a trie has, and returns the fullest one
+template <typename Fn>
+std::size_t fullest_bucket(std::size_t n, Fn&& hash)
+{
+    auto buckets = std::vector<std::size_t>(32);
+    for (auto i = std::size_t{}; i < n; ++i)
+        ++buckets[hash(i) & 31u];
+    auto r = std::size_t{};
+    for (auto b : buckets)
+        r = std::max(r, b);
+    return r;
+}
+
+} // namespace
+
+TEST_CASE("default hash is the container default")
+{
+    static_assert(std::is_same<immer::map<std::string, int>,
+                               immer::map<std::string,
+                                          int,
+                                          immer::default_hash<std::string>>>::
+                      value,
+                  "");
+    static_assert(
+        std::is_same<immer::set<int>, immer::set<int, immer::default_hash<int>>>::
+            value,
+        "");
+
+    auto m = immer::map<std::string, int>{};
+    for (auto i = 0; i < 1000; ++i)
+        m = std::move(m).set(std::to_string(i), i);
+    for (auto i = 0; i < 1000; ++i)
+        CHECK(m[std::to_string(i)] == i);
+}
+
+TEST_CASE("default hash of strings")
+{
+    auto h = immer::default_hash<std::string>{};
+    CHECK(h("") == h(std::string{}));
+    CHECK(h("hello") == h(std::string{"hel"} + "lo"));
+
+    // every length takes a different path of the algorithm
+    auto seen = std::set<std::size_t>{};
+    auto s    = std::string{};
+    for (auto i = 0; i < 200; ++i) {
+        CHECK(seen.insert(h(s)).second);
+        s += static_cast<char>('a' + i % 26);
+    }
+    // strings differing in a single byte
+    auto base = std::string(100, 'x');
+    for (auto i = 0u; i < base.size(); ++i) {
+        auto t = base;
+        t[i]   = 'y';
+        CHECK(seen.insert(h(t)).second);
+    }
+
+#if IMMER_HAS_CPP17
+    auto hv = immer::default_hash<std::string_view>{};
+    CHECK(hv(std::string_view{"hello world"}) == h("hello world"));
+#endif
+
+    auto fullest = fullest_bucket(
+        3200, [&](std::size_t i) { return h(std::to_string(i)); });
+    CHECK(fullest < 150);
+}
+
+TEST_CASE("default hash of integers and pointers")
+{
+    auto h = immer::default_hash<std::uint64_t>{};
+    CHECK(h(42) == h(42));
+    CHECK(h(42) != h(43));
+
+    // consecutive and aligned integers spread over the first level
+    CHECK(fullest_bucket(3200, h) < 150);
+    CHECK(fullest_bucket(3200, [&](std::size_t i) { return h(i * 64); }) <
+          150);
+
+    auto values = std::vector<double>(3200);
+    auto hp     = immer::default_hash<const double*>{};
+    CHECK(fullest_bucket(3200, [&](std::size_t i) {
+              return hp(&values[i]);
+          }) < 150);
+}
+
+TEST_CASE("mixed hash")
+{
+    auto weak  = identity_hash{};
+    auto mixed = immer::mixed_hash<identity_hash>{};
+    CHECK(fullest_bucket(
+              3200, [&](std::size_t i) { return weak(int(i) * 32); }) == 3200);
+    CHECK(fullest_bucket(3200, [&](std::size_t i) {
+              return mixed(int(i) * 32);
+          }) < 150);
+
+    auto s = immer::set<int, immer::mixed_hash<identity_hash>>{};
+    for (auto i = 0; i < 1000; ++i)
+        s = std::move(s).insert(i * 32);
+    CHECK(s.size() == 1000);
+    CHECK(s.count(320));
+    CHECK(!s.count(321));
+}
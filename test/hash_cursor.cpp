@@ -0,0 +1,112 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/map.hpp>
+#include <immer/set.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstddef>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+// a hash with many collisions, to have collision nodes
+struct bad_hash
+{
+    std::size_t operator()(int x) const { return std::hash<int>{}(x % 100); }
+};
+
+template <typename Container>
+std::vector<typename Container::value_type> all_pages(const Container& c,
+                                                      std::size_t n)
+{
+    auto r   = std::vector<typename Container::value_type>{};
+    auto cur = immer::hash_cursor{};
+    while (!cur.end) {
+        auto size = r.size();
+        cur       = c.resume(cur, n, [&](auto& v) { r.push_back(v); });
+        CHECK(r.size() - size <= n);
+        // the token is all that is kept between the pages
+        cur = immer::hash_cursor::decode(cur.encode());
+    }
+    return r;
+}
+
+} // namespace
+
+TEST_CASE("hash_cursor pages")
+{
+    auto m = immer::map<int, int>{};
+    for (auto i = 0; i < 10000; ++i)
+        m = std::move(m).set(i, i * 2);
+
+    auto pages = all_pages(m, 7);
+    CHECK(pages.size() == m.size());
+    auto keys = std::set<int>{};
+    for (auto& kv : pages) {
+        CHECK(kv.second == kv.first * 2);
+        keys.insert(kv.first);
+    }
+    CHECK(keys.size() == m.size());
+    CHECK(all_pages(m, 100000).size() == m.size());
+    CHECK(all_pages(immer::map<int, int>{}, 3).empty());
+}
+
+TEST_CASE("hash_cursor collisions")
+{
+    auto s = immer::set<int, bad_hash>{};
+    for (auto i = 0; i < 1000; ++i)
+        s = std::move(s).insert(i);
+    auto values = all_pages(s, 3);
+    CHECK(std::set<int>(values.begin(), values.end()).size() == 1000u);
+    CHECK(values.size() == 1000u);
+}
+
+TEST_CASE("hash_cursor on later versions")
+{
+    auto m = immer::map<int, int>{};
+    for (auto i = 0; i < 2000; ++i)
+        m = std::move(m).set(i, 0);
+
+    auto seen = std::multiset<int>{};
+    auto cur  = m.resume({}, 500, [&](auto& kv) { seen.insert(kv.first); });
+    // a new version with some keys removed and others added
+    auto n = m;
+    for (auto i = 0; i < 2000; i += 3)
+        n = std::move(n).erase(i);
+    for (auto i = 2000; i < 3000; ++i)
+        n = std::move(n).set(i, 0);
+    while (!cur.end)
+        cur = n.resume(cur, 100, [&](auto& kv) { seen.insert(kv.first); });
+
+    for (auto i = 0; i < 2000; ++i) {
+        // kept keys are seen once, removed ones at most once
+        if (i % 3)
+            CHECK(seen.count(i) == 1u);
+        else
+            CHECK(seen.count(i) <= 1u);
+    }
+    for (auto i = 2000; i < 3000; ++i)
+        CHECK(seen.count(i) <= 1u);
+}
+
+TEST_CASE("hash_cursor encoding")
+{
+    auto c = immer::hash_cursor{0x0123456789abcdefull, 3, false};
+    CHECK(c.encode() == "0123456789abcdef00000003");
+    CHECK(immer::hash_cursor::decode(c.encode()) == c);
+    auto e = immer::hash_cursor{42, 0, true};
+    CHECK(immer::hash_cursor::decode(e.encode()) == e);
+    CHECK_THROWS_AS(immer::hash_cursor::decode("xyz"), std::invalid_argument);
+    CHECK_THROWS_AS(immer::hash_cursor::decode("0123456789abcdef0000000g"),
+                    std::invalid_argument);
+}
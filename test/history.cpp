@@ -0,0 +1,128 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/flex_vector.hpp>
+#include <immer/history.hpp>
+#include <immer/map.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+
+using vector_t = immer::flex_vector<int>;
+
+vector_t iota(int n)
+{
+    auto v = vector_t{};
+    for (auto i = 0; i < n; ++i)
+        v = std::move(v).push_back(i);
+    return v;
+}
+
+template <typename T>
+std::size_t shared_bytes(const immer::history<T>& h)
+{
+    auto c = immer::memory_stats_collector{};
+    for (auto i = std::size_t{}; i < h.size(); ++i)
+        c.add(h[i]);
+    return c.usage().bytes;
+}
+
+} // namespace
+
+TEST_CASE("keeps the last versions")
+{
+    auto h = immer::history<vector_t>{3};
+    CHECK(h.empty());
+    CHECK(h.retained_bytes() == 0);
+
+    auto v = iota(1000);
+    for (auto i = 0; i < 5; ++i) {
+        v = v.set(i, -1);
+        h.push(v);
+    }
+    CHECK(h.size() == 3);
+    CHECK(h.front()[1] == -1);
+    CHECK(h.front()[2] == -1);
+    CHECK(h.front()[3] == 3);
+    CHECK(h.back()[4] == -1);
+    CHECK(h.retained_bytes() == shared_bytes(h));
+
+    SECTION("the nodes that they share are counted once")
+    {
+        auto one = immer::memory_stats(v).bytes;
+        CHECK(h.retained_bytes() > one);
+        CHECK(h.retained_bytes() < 2 * one);
+    }
+
+    SECTION("undo")
+    {
+        h.pop_back();
+        CHECK(h.size() == 2);
+        CHECK(h.back()[3] == -1);
+        CHECK(h.back()[4] == 4);
+        CHECK(h.retained_bytes() == shared_bytes(h));
+        h.clear();
+        CHECK(h.empty());
+        CHECK(h.retained_bytes() == 0);
+    }
+}
+
+TEST_CASE("evicts the oldest versions over the budget")
+{
+    auto one = immer::memory_stats(iota(1000)).bytes;
+    auto h   = immer::history<vector_t>{100, one * 2};
+    for (auto i = 0; i < 10; ++i)
+        h.push(iota(1000));
+    CHECK(h.size() == 2);
+    CHECK(h.retained_bytes() <= one * 2);
+    CHECK(h.retained_bytes() == shared_bytes(h));
+
+    SECTION("but the newest")
+    {
+        h.set_max_bytes(one / 2);
+        CHECK(h.size() == 1);
+        CHECK(h.retained_bytes() == one);
+        h.push(iota(2000));
+        CHECK(h.size() == 1);
+        CHECK(h.back().size() == 2000);
+    }
+
+    SECTION("the versions that share are kept longer")
+    {
+        auto v = h.back();
+        for (auto i = 0; i < 50; ++i) {
+            v = v.push_back(i);
+            h.push(v);
+        }
+        CHECK(h.size() > 10);
+        CHECK(h.retained_bytes() <= one * 2);
+        CHECK(h.retained_bytes() == shared_bytes(h));
+    }
+}
+
+TEST_CASE("maps and concatenations")
+{
+    using map_t = immer::map<int, int>;
+    auto h      = immer::history<map_t>{4};
+    auto m      = map_t{};
+    for (auto i = 0; i < 1000; ++i) {
+        m = std::move(m).set(i, i);
+        if (i % 100 == 0)
+            h.push(m);
+        CHECK(h.retained_bytes() == shared_bytes(h));
+    }
+
+    auto g = immer::history<vector_t>{2};
+    auto v = iota(100);
+    g.push(v + v);
+    g.push(v + v + v);
+    CHECK(g.retained_bytes() == shared_bytes(g));
+    g.pop_front();
+    CHECK(g.retained_bytes() == shared_bytes(g));
+}
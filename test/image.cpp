@@ -0,0 +1,249 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/flex_vector.hpp>
+#include <immer/heap/gc_heap.hpp>
+#include <immer/image.hpp>
+#include <immer/map.hpp>
+#include <immer/refcount/no_refcount_policy.hpp>
+#include <immer/set.hpp>
+#include <immer/vector.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using gc_memory = immer::memory_policy<immer::heap_policy<immer::gc_heap>,
+                                       immer::no_refcount_policy,
+                                       immer::default_lock_policy,
+                                       immer::gc_transience_policy,
+                                       false>;
+
+using gc_embed_memory =
+    immer::memory_policy<immer::heap_policy<immer::gc_heap>,
+                         immer::no_refcount_policy,
+                         immer::default_lock_policy,
+                         immer::gc_transience_policy,
+                         true>;
+
+using vector_t     = immer::vector<int, gc_memory, 3u, 2u>;
+using flex_t       = immer::flex_vector<int, gc_memory, 3u, 2u>;
+using flex_embed_t = immer::flex_vector<int, gc_embed_memory, 3u, 2u>;
+using map_t =
+    immer::map<int, int, std::hash<int>, std::equal_to<int>, gc_memory, 3u>;
+using set_t = immer::set<int, std::hash<int>, std::equal_to<int>, gc_memory>;
+
+struct colliding_hash
+{
+    std::size_t operator()(int x) const { return x % 3; }
+};
+
+using collision_set_t =
+    immer::set<int, colliding_hash, std::equal_to<int>, gc_memory>;
+
+// every test writes its own file, since tests may run in parallel
+struct image_file
+{
+    std::string path;
+
+    image_file(std::string name)
+        : path{"immer-test-" + name + ".img"}
+    {}
+
+    ~image_file() { std::remove(path.c_str()); }
+
+    void write(const immer::image_writer& out) const
+    {
+        auto stream = std::ofstream{path, std::ios::binary};
+        out.write(stream);
+    }
+};
+
+template <typename Flex>
+Flex make_relaxed(int n)
+{
+    auto v = Flex{};
+    for (auto i = 0; i < n; ++i)
+        v = Flex{i} + v.push_back(i);
+    return v;
+}
+
+} // namespace
+
+TEST_CASE("vector")
+{
+    auto v1 = vector_t{};
+    for (auto i = 0; i < 1000; ++i)
+        v1 = v1.push_back(i);
+    auto v2 = v1.set(500, 42).push_back(13);
+
+    auto file = image_file{"vector"};
+    auto out  = immer::image_writer{};
+    auto id0  = out.add(vector_t{});
+    auto id1  = out.add(v1);
+    auto id2  = out.add(v2);
+    file.write(out);
+
+    immer::image img{file.path};
+    CHECK(img.size() == 3);
+    CHECK(img.root<vector_t>(id0).empty());
+    auto w1 = img.root<vector_t>(id1);
+    auto w2 = img.root<vector_t>(id2);
+    CHECK(w1 == v1);
+    CHECK(w2 == v2);
+    CHECK(img.root<vector_t>(id1).identity() == w1.identity());
+    CHECK(img.root<flex_t>(id2) == flex_t{v2.begin(), v2.end()});
+
+    SECTION("derived versions")
+    {
+        auto w3 = w2.push_back(7).set(0, 5);
+        CHECK(w3.size() == v2.size() + 1);
+        CHECK(w3[0] == 5);
+        CHECK(w3.back() == 7);
+        CHECK(w2 == v2);
+    }
+}
+
+TEST_CASE("flex vector")
+{
+    auto v1 = make_relaxed<flex_t>(200);
+    auto v2 = v1.drop(13) + v1.take(77);
+
+    auto file = image_file{"flex"};
+    auto out  = immer::image_writer{};
+    auto id1  = out.add(v1);
+    auto id2  = out.add(v2);
+    file.write(out);
+
+    immer::image img{file.path};
+    auto w1 = img.root<flex_t>(id1);
+    auto w2 = img.root<flex_t>(id2);
+    CHECK(w1 == v1);
+    CHECK(w2 == v2);
+    CHECK(w1 + w2 == v1 + v2);
+    CHECK_THROWS_AS(img.root<vector_t>(id1), immer::image_error);
+}
+
+TEST_CASE("flex vector with embedded relaxed nodes")
+{
+    auto v = make_relaxed<flex_embed_t>(200);
+
+    auto file = image_file{"flex-embed"};
+    auto out  = immer::image_writer{};
+    auto id   = out.add(v);
+    file.write(out);
+
+    immer::image img{file.path};
+    CHECK(img.root<flex_embed_t>(id) == v);
+}
+
+TEST_CASE("map and set")
+{
+    auto m = map_t{};
+    auto s = set_t{};
+    for (auto i = 0; i < 1000; ++i) {
+        m = m.set(i, i * 2);
+        s = s.insert(i);
+    }
+    auto c = collision_set_t{};
+    for (auto i = 0; i < 30; ++i)
+        c = c.insert(i);
+
+    auto file = image_file{"map"};
+    auto out  = immer::image_writer{};
+    auto idm  = out.add(m);
+    auto ids  = out.add(s);
+    auto idc  = out.add(c);
+    auto ide  = out.add(map_t{});
+    file.write(out);
+
+    immer::image img{file.path};
+    auto n = img.root<map_t>(idm);
+    CHECK(n == m);
+    CHECK(n.size() == 1000);
+    CHECK(n[500] == 1000);
+    CHECK(n.set(2000, 1).size() == 1001);
+    CHECK(n.erase(3).count(3) == 0);
+    CHECK(img.root<set_t>(ids) == s);
+    CHECK(img.root<collision_set_t>(idc) == c);
+    CHECK(img.root<map_t>(ide).empty());
+    CHECK_THROWS_AS(img.root<vector_t>(idm), immer::image_error);
+    CHECK_THROWS_AS(img.root<map_t>(4), immer::image_error);
+}
+
+TEST_CASE("relocation")
+{
+    auto v = make_relaxed<flex_t>(300);
+    auto m = map_t{};
+    for (auto i = 0; i < 300; ++i)
+        m = m.set(i, -i);
+
+    // no image can be mapped at null, so it is always fixed up
+    auto file = image_file{"relocation"};
+    auto out  = immer::image_writer{0};
+    auto idv  = out.add(v);
+    auto idm  = out.add(m);
+    file.write(out);
+
+    immer::image img{file.path};
+    CHECK(img.relocated());
+    CHECK(img.root<flex_t>(idv) == v);
+    CHECK(img.root<map_t>(idm) == m);
+}
+
+TEST_CASE("image in memory")
+{
+    auto v = make_relaxed<flex_t>(300);
+    auto m = map_t{};
+    for (auto i = 0; i < 300; ++i)
+        m = m.set(i, -i);
+
+    auto out = immer::image_writer{};
+    auto idv = out.add(v);
+    auto idm = out.add(m);
+    auto buf = std::ostringstream{};
+    out.write(buf);
+    auto bytes = buf.str();
+
+    // like an image embedded in the program with write_source()
+    auto storage = std::vector<std::max_align_t>(
+        bytes.size() / sizeof(std::max_align_t) + 1);
+    std::memcpy(storage.data(), bytes.data(), bytes.size());
+    immer::image img{storage.data(), bytes.size()};
+    CHECK(img.relocated());
+    CHECK(img.root<flex_t>(idv) == v);
+    CHECK(img.root<map_t>(idm) == m);
+    CHECK(img.root<map_t>(idm).set(1000, 1)[1000] == 1);
+    CHECK_THROWS_AS(
+        (immer::image{reinterpret_cast<char*>(storage.data()) + 1, 64}),
+        immer::image_error);
+
+    auto source = std::ostringstream{};
+    out.write_source(source, "table_image");
+    CHECK(source.str().find("unsigned char table_image[] = {") !=
+          std::string::npos);
+}
+
+TEST_CASE("errors")
+{
+    auto file = image_file{"errors"};
+    CHECK_THROWS_AS(immer::image{file.path}, std::system_error);
+    {
+        auto stream = std::ofstream{file.path, std::ios::binary};
+        stream << "not an image, but long enough to have a header";
+    }
+    CHECK_THROWS_AS(immer::image{file.path}, immer::image_error);
+}
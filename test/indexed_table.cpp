@@ -0,0 +1,158 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/indexed_table.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct task
+{
+    int id;
+    int owner;
+    std::string status;
+
+    bool operator==(const task& x) const
+    {
+        return id == x.id && owner == x.owner && status == x.status;
+    }
+    bool operator!=(const task& x) const { return !(*this == x); }
+};
+
+struct by_owner
+{
+    int operator()(const task& t) const { return t.owner; }
+};
+
+struct by_status
+{
+    const std::string& operator()(const task& t) const { return t.status; }
+};
+
+using store_t = immer::indexed_table<task,
+                                     immer::table_key_fn,
+                                     immer::default_memory_policy,
+                                     immer::index_by<by_owner>,
+                                     immer::index_by<by_status>>;
+
+std::vector<int> ids_by_owner(const store_t& s, int owner)
+{
+    auto r = std::vector<int>{};
+    s.for_each_by<0>(owner, [&](const task& t) { r.push_back(t.id); });
+    std::sort(r.begin(), r.end());
+    return r;
+}
+
+// the indexes always match the ones built from scratch
+void check_indexes(const store_t& s)
+{
+    auto n = std::size_t{};
+    for (auto&& kv : s.index<0>()) {
+        for (auto k : kv.second) {
+            CHECK(s.find(k));
+            CHECK(s[k].owner == kv.first);
+            ++n;
+        }
+    }
+    CHECK(n == s.size());
+    n = 0;
+    for (auto&& kv : s.index<1>()) {
+        CHECK(!kv.second.empty());
+        n += kv.second.size();
+    }
+    CHECK(n == s.size());
+}
+
+} // namespace
+
+TEST_CASE("indexed_table insert and erase")
+{
+    auto s0 = store_t{};
+    auto s1 = s0.insert({1, 10, "open"})
+                  .insert({2, 10, "done"})
+                  .insert({3, 20, "open"});
+    CHECK(s0.empty());
+    CHECK(s1.size() == 3);
+    CHECK(ids_by_owner(s1, 10) == (std::vector<int>{1, 2}));
+    CHECK(ids_by_owner(s1, 20) == (std::vector<int>{3}));
+    CHECK(s1.count_by<1>("open") == 2);
+    CHECK(s1.count_by<1>("late") == 0);
+    check_indexes(s1);
+
+    SECTION("replace")
+    {
+        auto s2 = s1.insert({1, 20, "done"});
+        CHECK(ids_by_owner(s2, 10) == (std::vector<int>{2}));
+        CHECK(ids_by_owner(s2, 20) == (std::vector<int>{1, 3}));
+        CHECK(s2.count_by<1>("open") == 1);
+        CHECK(ids_by_owner(s1, 10) == (std::vector<int>{1, 2}));
+        check_indexes(s2);
+    }
+
+    SECTION("erase")
+    {
+        auto s2 = s1.erase(3).erase(42);
+        CHECK(s2.size() == 2);
+        CHECK(s2.count_by<0>(20) == 0);
+        CHECK(!s2.index<0>().find(20));
+        CHECK(s1.count_by<0>(20) == 1);
+        check_indexes(s2);
+    }
+}
+
+TEST_CASE("indexed_table update")
+{
+    auto s = store_t{}.insert({1, 10, "open"}).insert({2, 10, "open"});
+    s      = s.update(2, [](task t) {
+        t.status = "done";
+        return t;
+    });
+    CHECK(s.count_by<1>("open") == 1);
+    CHECK(s.count_by<1>("done") == 1);
+    s = s.update(5, [](task t) {
+        t.owner = 30;
+        return t;
+    });
+    CHECK(s[5].id == 5);
+    CHECK(ids_by_owner(s, 30) == (std::vector<int>{5}));
+    s = s.update_if_exists(6, [](task t) { return t; });
+    CHECK(s.size() == 3);
+    check_indexes(s);
+}
+
+TEST_CASE("indexed_table transient")
+{
+    auto s0 = store_t{}.insert({1, 10, "open"});
+    auto t  = s0.transient();
+    for (auto i = 2; i < 200; ++i)
+        t.insert({i, i % 7, i % 3 ? "open" : "done"});
+    t.update(1, [](task x) {
+        x.owner = 3;
+        return x;
+    });
+    for (auto i = 100; i < 150; ++i)
+        t.erase(i);
+    auto s1 = t.persistent();
+    CHECK(s0.size() == 1);
+    CHECK(s0.count_by<0>(10) == 1);
+    CHECK(s1.size() == 149);
+    CHECK(s1.count_by<0>(10) == 0);
+    check_indexes(s1);
+
+    auto s2 = store_t{};
+    for (auto&& x : s1)
+        s2 = s2.insert(x);
+    CHECK(s2 == s1);
+    for (auto i = 0; i < 7; ++i)
+        CHECK(s1.count_by<0>(i) == s2.count_by<0>(i));
+}
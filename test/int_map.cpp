@@ -0,0 +1,185 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/algorithm.hpp>
+#include <immer/int_map.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+template <typename Map>
+auto keys_of(const Map& m)
+{
+    auto r = std::vector<typename Map::key_type>{};
+    for (auto& kv : m)
+        r.push_back(kv.first);
+    return r;
+}
+
+template <typename Map, typename Ref>
+bool same(const Map& m, const Ref& ref)
+{
+    return m.size() == ref.size() &&
+           std::equal(m.begin(),
+                      m.end(),
+                      ref.begin(),
+                      ref.end(),
+                      [](auto& a, auto& b) {
+                          return a.first == b.first && a.second == b.second;
+                      });
+}
+
+} // namespace
+
+TEST_CASE("int map basic operations")
+{
+    using map_t = immer::int_map<std::uint64_t, std::string>;
+
+    auto m = map_t{}.set(42, "foo").set(7, "bar").set(1000, "baz");
+    CHECK(m.size() == 3);
+    CHECK(m[42] == "foo");
+    CHECK(m[8] == "");
+    CHECK(m.count(1000) == 1);
+    CHECK(m.count(1001) == 0);
+    CHECK(m.find(0) == nullptr);
+    CHECK_THROWS_AS(m.at(43), std::out_of_range);
+    CHECK(keys_of(m) == std::vector<std::uint64_t>{7, 42, 1000});
+
+    auto n = m.set(42, "qux").update(7, [](std::string x) {
+        return x + "!";
+    });
+    CHECK(n[42] == "qux");
+    CHECK(n[7] == "bar!");
+    CHECK(m[42] == "foo");
+    CHECK(m[7] == "bar");
+
+    auto e = n.erase(42).erase(5);
+    CHECK(e.size() == 2);
+    CHECK(e.count(42) == 0);
+    CHECK(n.size() == 3);
+    CHECK(e.erase(7).erase(1000).empty());
+
+    CHECK(map_t{{1, "a"}, {2, "b"}, {1, "c"}} ==
+          map_t{}.set(2, "b").set(1, "c"));
+    CHECK(map_t{{1, "a"}} != map_t{{1, "b"}});
+    CHECK(map_t{{~std::uint64_t{}, "a"}, {0, "b"}}.begin()->first == 0);
+}
+
+TEST_CASE("int map orders signed keys")
+{
+    using map_t = immer::int_map<int, int>;
+
+    auto m = map_t{{-5, 1}, {3, 2}, {-100, 3}, {0, 4}, {2147483647, 5}};
+    CHECK(keys_of(m) == std::vector<int>{-100, -5, 0, 3, 2147483647});
+    CHECK(keys_of(m.range(-5, 3)) == std::vector<int>{-5, 0});
+    CHECK(keys_of(m.range(-1000, 1000)) == std::vector<int>{-100, -5, 0, 3});
+
+    using small_t = immer::int_map<std::int8_t, int>;
+    auto s        = small_t{};
+    for (auto i = -128; i < 128; i += 3)
+        s = std::move(s).set(static_cast<std::int8_t>(i), i);
+    CHECK(s.size() == 86);
+    CHECK(s.begin()->first == -128);
+    CHECK(s.range(0, 10).size() == 3);
+}
+
+TEST_CASE("int map ranges share subtrees")
+{
+    using map_t = immer::int_map<unsigned, unsigned>;
+
+    auto m = map_t{};
+    for (auto i = 0u; i < 1000u; ++i)
+        m = std::move(m).set(i * 2, i);
+
+    auto r = m.range(100, 300);
+    CHECK(r.size() == 100);
+    CHECK(r.begin()->first == 100);
+    CHECK(r[298] == 149);
+    CHECK(r.count(300) == 0);
+    CHECK(m.range(300, 100).empty());
+    CHECK(m.range(0, 1) == map_t{{0, 0}});
+    CHECK(m.range(0, ~0u) == m);
+    CHECK(m.range(0, ~0u).identity() == m.identity());
+    CHECK(m.range(0, 2048).identity() == m.identity());
+}
+
+TEST_CASE("int map merge")
+{
+    using map_t = immer::int_map<unsigned, int>;
+
+    auto a = map_t{{1, 1}, {2, 2}, {8, 8}};
+    auto b = map_t{{2, 20}, {3, 30}, {1u << 20, 40}};
+    auto m = a.merge(b, [](int x, int y) { return x + y; });
+    CHECK(keys_of(m) == std::vector<unsigned>{1, 2, 3, 8, 1u << 20});
+    CHECK(m[2] == 22);
+    CHECK(m[3] == 30);
+    CHECK(m[8] == 8);
+    CHECK(a.merge(map_t{}, [](int x, int) { return x; }) == a);
+    CHECK(map_t{}.merge(a, [](int x, int) { return x; }) == a);
+    CHECK(a.merge(a, [](int x, int) { return x; }).identity() ==
+          a.identity());
+}
+
+TEST_CASE("int map against a reference")
+{
+    using map_t = immer::int_map<std::uint32_t, int>;
+    using ref_t = std::map<std::uint32_t, int>;
+
+    auto gen      = std::mt19937{42};
+    auto key      = [&] { return gen() % 4 ? gen() % 512 : gen(); };
+    auto m        = map_t{};
+    auto ref      = ref_t{};
+    auto versions = std::vector<std::pair<map_t, ref_t>>{};
+    for (auto i = 0; i < 5000; ++i) {
+        auto k = key();
+        if (gen() % 3) {
+            m      = gen() % 2 ? std::move(m).set(k, i) : m.set(k, i);
+            ref[k] = i;
+        } else {
+            m = gen() % 2 ? std::move(m).erase(k) : m.erase(k);
+            ref.erase(k);
+        }
+        REQUIRE(m.size() == ref.size());
+        if (i % 500 == 0)
+            versions.emplace_back(m, ref);
+    }
+    CHECK(same(m, ref));
+    for (auto& v : versions)
+        CHECK(same(v.first, v.second));
+
+    for (auto i = 0; i < 200; ++i) {
+        auto lo = key();
+        auto hi = key();
+        auto r  = lo < hi ? ref_t{ref.lower_bound(lo), ref.lower_bound(hi)}
+                          : ref_t{};
+        CHECK(same(m.range(lo, hi), r));
+    }
+
+    for (auto& v : versions) {
+        auto merged =
+            v.first.merge(m, [](int x, int y) { return std::max(x, y); });
+        auto r = v.second;
+        for (auto& kv : ref)
+            r[kv.first] = std::max(r[kv.first], kv.second);
+        CHECK(same(merged, r));
+    }
+
+    auto count = std::size_t{};
+    immer::for_each_chunk(m, [&](auto first, auto last) {
+        count += last - first;
+    });
+    CHECK(count == ref.size());
+}
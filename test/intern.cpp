@@ -0,0 +1,132 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/flex_vector.hpp>
+#include <immer/intern.hpp>
+#include <immer/map.hpp>
+#include <immer/set.hpp>
+#include <immer/vector.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+namespace {
+
+template <typename V>
+V make_vector(unsigned n)
+{
+    auto v = V{};
+    for (auto i = 0u; i < n; ++i)
+        v = std::move(v).push_back(i);
+    return v;
+}
+
+} // namespace
+
+TEST_CASE("intern vector")
+{
+    using vector_t = immer::vector<unsigned>;
+    auto table     = immer::intern_table<vector_t>{};
+
+    auto a = make_vector<vector_t>(10000);
+    auto b = make_vector<vector_t>(10000);
+    CHECK(a.impl().root != b.impl().root);
+
+    auto ia = immer::intern(a, table);
+    auto n  = table.size();
+    CHECK(ia == a);
+    CHECK(n > 0);
+
+    auto ib = immer::intern(b, table);
+    CHECK(ib == b);
+    CHECK(ib.impl().root == ia.impl().root);
+    CHECK(ib.impl().tail == ia.impl().tail);
+    CHECK(table.size() == n);
+
+    SECTION("partially equal")
+    {
+        auto c  = b.set(5000, 42u).push_back(7u);
+        auto ic = immer::intern(c, table);
+        CHECK(ic == c);
+        CHECK(ic.impl().root != ia.impl().root);
+        CHECK(table.size() > n);
+        CHECK(table.size() < 2 * n);
+    }
+
+    SECTION("trim")
+    {
+        a  = {};
+        b  = {};
+        ia = {};
+        table.trim();
+        CHECK(table.size() == n);
+        ib = {};
+        table.trim();
+        CHECK(table.size() == 0);
+    }
+}
+
+TEST_CASE("intern flex_vector")
+{
+    using vector_t = immer::flex_vector<unsigned>;
+    auto table     = immer::intern_table<vector_t>{};
+
+    auto base = make_vector<vector_t>(5000);
+    auto a    = base.take(1234) + base.drop(1234);
+    auto b    = base.take(1234) + base.drop(1234);
+    CHECK(a.impl().root != b.impl().root);
+
+    auto ia = immer::intern(a, table);
+    auto ib = immer::intern(b, table);
+    CHECK(ia == base);
+    CHECK(ib == base);
+    CHECK(ia.impl().root == ib.impl().root);
+    CHECK(immer::intern(ib, table).impl().root == ia.impl().root);
+}
+
+TEST_CASE("intern map and set")
+{
+    using map_t = immer::map<std::string, int>;
+    auto table  = immer::intern_table<map_t>{};
+
+    auto a = map_t{};
+    auto b = map_t{};
+    for (auto i = 0; i < 1000; ++i) {
+        a = std::move(a).set(std::to_string(i), i);
+        b = std::move(b).set(std::to_string(999 - i), 999 - i);
+    }
+    CHECK(a.impl().root != b.impl().root);
+
+    auto ia = immer::intern(a, table);
+    auto n  = table.size();
+    auto ib = immer::intern(b, table);
+    CHECK(ia == a);
+    CHECK(ib == b);
+    CHECK(ia.impl().root == ib.impl().root);
+    CHECK(table.size() == n);
+
+    auto c  = b.set("7", 8);
+    auto ic = immer::intern(c, table);
+    CHECK(ic == c);
+    CHECK(ic.impl().root != ia.impl().root);
+
+    using set_t = immer::set<unsigned>;
+    auto stable = immer::intern_table<set_t>{};
+    auto s      = set_t{};
+    auto t      = set_t{};
+    for (auto i = 0u; i < 1000u; ++i) {
+        s = std::move(s).insert(i);
+        t = std::move(t).insert(999u - i);
+    }
+    auto is = immer::intern(s, stable);
+    auto it = immer::intern(t, stable);
+    CHECK(is == s);
+    CHECK(is.impl().root == it.impl().root);
+    CHECK(immer::intern(set_t{}, stable).empty());
+}
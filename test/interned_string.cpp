@@ -0,0 +1,91 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/interned_string.hpp>
+#include <immer/map.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using immer::interned_string;
+
+TEST_CASE("interned strings are shared")
+{
+    auto n = interned_string::interned_count();
+    {
+        auto a = interned_string{"hello"};
+        auto b = interned_string{std::string{"hel"} + "lo"};
+        auto c = interned_string{"world"};
+        CHECK(a == b);
+        CHECK(a != c);
+        CHECK(&a.str() == &b.str());
+        CHECK(a.str() == "hello");
+        CHECK(a.hash() == std::hash<std::string>{}("hello"));
+        CHECK(std::hash<interned_string>{}(a) == a.hash());
+        CHECK(!(c < a));
+        CHECK(a < c);
+        CHECK(interned_string::interned_count() == n + 2);
+
+        auto d = a;
+        a      = c;
+        CHECK(d == b);
+        CHECK(a == c);
+        CHECK(interned_string::interned_count() == n + 2);
+    }
+    CHECK(interned_string::interned_count() == n);
+}
+
+TEST_CASE("empty interned string")
+{
+    auto a = interned_string{};
+    auto b = interned_string{""};
+    CHECK(a == b);
+    CHECK(a.empty());
+    CHECK(a.str().empty());
+    CHECK(a.hash() == std::hash<std::string>{}(""));
+}
+
+TEST_CASE("interned strings as keys")
+{
+    auto m = immer::map<interned_string, int>{};
+    for (auto i = 0; i < 100; ++i)
+        m = m.set(interned_string{std::to_string(i % 10)}, i);
+    CHECK(m.size() == 10);
+    CHECK(m[interned_string{"3"}] == 93);
+    CHECK(!m.find(interned_string{"x"}));
+}
+
+TEST_CASE("concurrent interning")
+{
+    constexpr auto threads = 8;
+    constexpr auto n       = 1000;
+
+    auto n0      = interned_string::interned_count();
+    auto keep    = interned_string{"0"};
+    auto workers = std::vector<std::thread>{};
+    auto results = std::vector<std::vector<interned_string>>(threads);
+    for (auto i = 0; i < threads; ++i)
+        workers.emplace_back([&, i] {
+            for (auto j = 0; j < n; ++j) {
+                auto s = interned_string{std::to_string(j % 50)};
+                if (j % 3 == 0)
+                    results[i].push_back(s);
+            }
+        });
+    for (auto& w : workers)
+        w.join();
+    for (auto& r : results)
+        for (auto j = std::size_t{}; j < r.size(); ++j)
+            CHECK(r[j] == results[0][j]);
+    CHECK(results[0][0] == keep);
+    results.clear();
+    CHECK(interned_string::interned_count() == n0 + 1);
+}
@@ -0,0 +1,145 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/algorithm.hpp>
+#include <immer/interval_map.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using ref_t = std::map<std::pair<int, int>, int>;
+
+template <typename Map>
+bool same(const Map& m, const ref_t& ref)
+{
+    return std::equal(
+        m.begin(), m.end(), ref.begin(), ref.end(), [](auto& a, auto& b) {
+            return a.first == b.first && a.second == b.second;
+        });
+}
+
+} // namespace
+
+TEST_CASE("interval map basic operations")
+{
+    using map_t = immer::interval_map<unsigned, std::string>;
+
+    auto m = map_t{}
+                 .set({0x1000, 0x2000}, "text")
+                 .set({0x2000, 0x3000}, "data")
+                 .set({0x1800, 0x2800}, "mapped");
+    CHECK(m.size() == 3);
+    CHECK(m[{0x2000, 0x3000}] == "data");
+    CHECK(m[{0x2000, 0x2fff}] == "");
+    CHECK(m.count({0x1800, 0x2800}) == 1);
+    CHECK_THROWS_AS(m.at({0, 1}), std::out_of_range);
+
+    auto names = std::vector<std::string>{};
+    m.for_each_containing(0x2400, [&](auto& r) { names.push_back(r.second); });
+    CHECK(names == std::vector<std::string>{"mapped", "data"});
+
+    names.clear();
+    m.for_each_containing(0x2000, [&](auto& r) { names.push_back(r.second); });
+    CHECK(names == std::vector<std::string>{"mapped", "data"});
+
+    names.clear();
+    m.for_each_containing(0x3000, [&](auto& r) { names.push_back(r.second); });
+    CHECK(names.empty());
+
+    names.clear();
+    m.for_each_overlapping(
+        0x0, 0x1801, [&](auto& r) { names.push_back(r.second); });
+    CHECK(names == std::vector<std::string>{"text", "mapped"});
+
+    CHECK(m.overlaps(0x2fff, 0x4000));
+    CHECK(!m.overlaps(0x3000, 0x4000));
+    CHECK(!m.overlaps(0x0, 0x1000));
+
+    auto n = m.erase({0x1800, 0x2800}).update(
+        {0x1000, 0x2000}, [](auto s) { return s + "!"; });
+    CHECK(n.size() == 2);
+    CHECK(n[{0x1000, 0x2000}] == "text!");
+    CHECK(!n.overlaps(0x3000, 0x4000));
+    CHECK(m.size() == 3);
+    CHECK(m[{0x1000, 0x2000}] == "text");
+    CHECK(m.erase({1, 2}) == m);
+    CHECK(map_t{{{1, 2}, "a"}, {{0, 5}, "b"}} ==
+          map_t{}.set({0, 5}, "b").set({1, 2}, "a"));
+}
+
+TEST_CASE("interval map against a reference")
+{
+    using map_t = immer::interval_map<int, int>;
+
+    auto gen      = std::mt19937{42};
+    auto m        = map_t{};
+    auto ref      = ref_t{};
+    auto versions = std::vector<std::pair<map_t, ref_t>>{};
+    auto random_interval = [&] {
+        auto a = static_cast<int>(gen() % 1000);
+        return std::make_pair(a, a + 1 + static_cast<int>(gen() % 50));
+    };
+    for (auto i = 0; i < 5000; ++i) {
+        auto k = random_interval();
+        if (i % 7 == 0 && !ref.empty())
+            k = std::next(ref.begin(), gen() % ref.size())->first;
+        if (gen() % 3) {
+            m      = gen() % 2 ? std::move(m).set(k, i) : m.set(k, i);
+            ref[k] = i;
+        } else {
+            m = gen() % 2 ? std::move(m).erase(k) : m.erase(k);
+            ref.erase(k);
+        }
+        REQUIRE(m.size() == ref.size());
+        if (i % 500 == 0)
+            versions.emplace_back(m, ref);
+    }
+    CHECK(same(m, ref));
+    for (auto& v : versions)
+        CHECK(same(v.first, v.second));
+
+    for (auto i = 0; i < 300; ++i) {
+        auto q        = random_interval();
+        auto expected = std::vector<std::pair<int, int>>{};
+        for (auto& kv : ref)
+            if (kv.first.first < q.second && q.first < kv.first.second)
+                expected.push_back(kv.first);
+        auto found = std::vector<std::pair<int, int>>{};
+        m.for_each_overlapping(
+            q.first, q.second, [&](auto& kv) { found.push_back(kv.first); });
+        CHECK(found == expected);
+        CHECK(m.overlaps(q.first, q.second) == !expected.empty());
+
+        auto p = q.first;
+        expected.clear();
+        for (auto& kv : ref)
+            if (kv.first.first <= p && p < kv.first.second)
+                expected.push_back(kv.first);
+        found.clear();
+        m.for_each_containing(p, [&](auto& kv) { found.push_back(kv.first); });
+        CHECK(found == expected);
+    }
+
+    auto count = std::size_t{};
+    immer::for_each_chunk(m, [&](auto first, auto last) {
+        count += last - first;
+    });
+    CHECK(count == ref.size());
+
+    // erasing everything in order keeps it balanced on the way
+    for (auto& kv : ref)
+        m = std::move(m).erase(kv.first);
+    CHECK(m.empty());
+    CHECK(m.begin() == m.end());
+}
@@ -0,0 +1,144 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/join.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+namespace {
+
+struct bad_hash
+{
+    std::size_t operator()(int x) const { return x / 4; }
+};
+
+template <typename MapA, typename MapB>
+auto naive_join(const MapA& a, const MapB& b)
+{
+    auto r = immer::map<int, int>{};
+    for (auto& kv : a)
+        if (auto y = b.find(kv.first))
+            r = std::move(r).set(kv.first, kv.second * 10 + *y);
+    return r;
+}
+
+template <typename MapA, typename MapB>
+auto naive_left_join(const MapA& a, const MapB& b)
+{
+    auto r = immer::map<int, int>{};
+    for (auto& kv : a) {
+        auto y = b.find(kv.first);
+        r      = std::move(r).set(kv.first, kv.second * 10 + (y ? *y : -1));
+    }
+    return r;
+}
+
+const auto inner = [](int, int x, int y) { return x * 10 + y; };
+const auto outer = [](int, int x, const int* y) {
+    return x * 10 + (y ? *y : -1);
+};
+
+} // namespace
+
+TEST_CASE("join small maps")
+{
+    auto a = immer::map<int, int>{}.set(1, 1).set(2, 2).set(3, 3);
+    auto b = immer::map<int, int>{}.set(2, 5).set(3, 6).set(4, 7);
+
+    auto j = immer::join(a, b, inner);
+    CHECK(j.size() == 2u);
+    CHECK(j[2] == 25);
+    CHECK(j[3] == 36);
+
+    auto l = immer::left_join(a, b, outer);
+    CHECK(l.size() == 3u);
+    CHECK(l[1] == 9);
+    CHECK(l[2] == 25);
+
+    CHECK(immer::join(a, immer::map<int, int>{}, inner).empty());
+    CHECK(immer::left_join(a, immer::map<int, int>{}, outer).size() == 3u);
+    CHECK(immer::join(immer::map<int, int>{}, b, inner).empty());
+}
+
+TEST_CASE("join values of different types")
+{
+    auto a = immer::map<int, std::string>{}.set(1, "one").set(2, "two");
+    auto b = immer::map<int, double>{}.set(2, 2.5);
+    auto j = immer::join(a, b, [](int, const std::string& s, double d) {
+        return s + std::to_string(static_cast<int>(d * 2));
+    });
+    CHECK(j.size() == 1u);
+    CHECK(j[2] == "two5");
+}
+
+TEST_CASE("join large maps")
+{
+    auto a = immer::map<int, int>{}.transient();
+    auto b = immer::map<int, int>{}.transient();
+    for (auto i = 0; i < 100000; ++i) {
+        a.set(i, i % 7);
+        if (i % 3 == 0)
+            b.set(i, i % 5);
+        if (i % 5 == 0)
+            b.set(-i - 1, 1);
+    }
+    auto ma = std::move(a).persistent();
+    auto mb = std::move(b).persistent();
+
+    SECTION("inner")
+    {
+        auto expected = naive_join(ma, mb);
+        CHECK(immer::join(ma, mb, inner, immer::thread_executor{1}) ==
+              expected);
+        CHECK(immer::join(ma, mb, inner, immer::thread_executor{4}) ==
+              expected);
+        CHECK(immer::join(ma, mb, inner) == expected);
+    }
+
+    SECTION("left")
+    {
+        auto expected = naive_left_join(ma, mb);
+        CHECK(immer::left_join(ma, mb, outer, immer::thread_executor{1}) ==
+              expected);
+        CHECK(immer::left_join(ma, mb, outer, immer::thread_executor{4}) ==
+              expected);
+    }
+
+    SECTION("against a small map")
+    {
+        auto small = immer::map<int, int>{}.set(3, 1).set(99999, 2);
+        CHECK(immer::join(ma, small, inner) == naive_join(ma, small));
+        CHECK(immer::join(small, ma, inner) == naive_join(small, ma));
+        CHECK(immer::left_join(ma, small, outer) ==
+              naive_left_join(ma, small));
+    }
+}
+
+TEST_CASE("join maps with collisions")
+{
+    using map_t = immer::map<int, int, bad_hash>;
+    auto a      = map_t{};
+    auto b      = map_t{};
+    for (auto i = 0; i < 20000; ++i) {
+        a = std::move(a).set(i, i % 7);
+        if (i % 3 != 1)
+            b = std::move(b).set(i, i % 5);
+    }
+    auto expected = naive_join(a, b);
+    auto j        = immer::join(a, b, inner, immer::thread_executor{4});
+    CHECK(j.size() == expected.size());
+    for (auto& kv : expected)
+        CHECK(j[kv.first] == kv.second);
+
+    auto l = immer::left_join(a, b, outer, immer::thread_executor{4});
+    CHECK(l.size() == a.size());
+    for (auto& kv : naive_left_join(a, b))
+        CHECK(l[kv.first] == kv.second);
+}
@@ -0,0 +1,210 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/kv_store.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using store_t = immer::kv_store<std::string, int>;
+
+} // namespace
+
+TEST_CASE("kv_store snapshots and commits")
+{
+    store_t s{store_t::map_type{}.set("a", 1)};
+    auto old  = s.snapshot();
+    auto tx   = s.begin();
+    auto a    = tx.find("a");
+    auto none = tx.find("b");
+    REQUIRE(a);
+    CHECK(*a == 1);
+    CHECK(!none);
+    tx.set("b", *a + 1);
+    tx.erase("a");
+    // the writes are only seen by the transaction
+    CHECK(tx.find("b"));
+    CHECK(!s.snapshot().find("b"));
+
+    CHECK(s.commit(tx));
+    auto now = s.snapshot();
+    CHECK(now.version() == 1u);
+    CHECK(tx.snapshot().version() == 1u);
+    CHECK(now.count("a") == 0u);
+    CHECK(*now.find("b") == 2);
+    // old snapshots never change
+    CHECK(old.version() == 0u);
+    CHECK(*old.find("a") == 1);
+    CHECK(old.size() == 1u);
+
+    // a transaction that only reads does not publish anything
+    auto ro = s.begin();
+    (void) ro.find("b");
+    CHECK(ro.read_only());
+    CHECK(s.commit(ro));
+    CHECK(s.snapshot().version() == 1u);
+}
+
+TEST_CASE("kv_store conflicts")
+{
+    store_t s;
+
+    SECTION("on a key that was read")
+    {
+        auto t1 = s.begin();
+        auto t2 = s.begin();
+        (void) t1.find("x");
+        t1.set("y", 1);
+        t2.set("x", 2);
+        CHECK(s.commit(t2));
+        CHECK(!s.commit(t1));
+        CHECK(!s.snapshot().find("y"));
+    }
+
+    SECTION("on a key that was written")
+    {
+        auto t1 = s.begin();
+        auto t2 = s.begin();
+        t1.set("x", 1);
+        t2.set("x", 2);
+        CHECK(s.commit(t2));
+        CHECK(!s.commit(t1));
+        CHECK(*s.snapshot().find("x") == 2);
+    }
+
+    SECTION("not on other keys")
+    {
+        auto t1 = s.begin();
+        auto t2 = s.begin();
+        (void) t1.find("x");
+        t1.set("x", 1);
+        t2.set("y", 2);
+        CHECK(s.commit(t2));
+        CHECK(s.commit(t1));
+        auto now = s.snapshot();
+        CHECK(now.version() == 2u);
+        CHECK(*now.find("x") == 1);
+        CHECK(*now.find("y") == 2);
+    }
+
+    SECTION("not when the values are the same again")
+    {
+        s.transact([](auto& tx) { tx.set("x", 1); });
+        auto t1 = s.begin();
+        (void) t1.find("x");
+        t1.set("y", 1);
+        s.transact([](auto& tx) { tx.set("x", 2); });
+        s.transact([](auto& tx) { tx.set("x", 1); });
+        CHECK(s.commit(t1));
+    }
+}
+
+TEST_CASE("kv_store concurrent transfers")
+{
+    constexpr auto accounts = 8;
+    constexpr auto threads  = 4;
+    constexpr auto rounds   = 500;
+    auto init               = store_t::map_type{};
+    for (auto i = 0; i < accounts; ++i)
+        init = std::move(init).set(std::to_string(i), 100);
+    store_t s{init};
+
+    auto seen = std::vector<store_t::version_type>{};
+    std::atomic<int> wrong{0};
+    std::mutex seen_mx;
+    auto id = s.watch([&](auto& a, auto& b) {
+        std::lock_guard<std::mutex> lock{seen_mx};
+        seen.push_back(b.version());
+        wrong += b.version() <= a.version();
+    });
+
+    auto workers = std::vector<std::thread>{};
+    for (auto t = 0; t < threads; ++t)
+        workers.emplace_back([&, t] {
+            for (auto i = 0; i < rounds; ++i) {
+                auto from = std::to_string((t + i) % accounts);
+                auto to   = std::to_string((t * 3 + i * 5 + 1) % accounts);
+                s.transact([&](auto& tx) {
+                    tx.set(from, *tx.find(from) - 1);
+                    tx.set(to, *tx.find(to) + 1);
+                });
+                // every snapshot has the same total
+                auto snap  = s.snapshot();
+                auto total = 0;
+                for (auto& kv : snap.data())
+                    total += kv.second;
+                wrong += total != accounts * 100;
+            }
+        });
+    for (auto& w : workers)
+        w.join();
+    s.unwatch(id);
+
+    CHECK(wrong == 0);
+    CHECK(s.snapshot().version() == threads * rounds);
+    CHECK(seen.size() == threads * rounds);
+}
+
+TEST_CASE("kv_store changes")
+{
+    store_t s;
+    s.transact([](auto& tx) {
+        tx.set("a", 1);
+        tx.set("b", 2);
+    });
+    auto v1 = s.snapshot();
+    s.transact([](auto& tx) {
+        tx.set("a", 3);
+        tx.erase("b");
+        tx.set("c", 4);
+    });
+    auto v2 = s.snapshot();
+
+    auto added   = std::vector<std::string>{};
+    auto removed = std::vector<std::string>{};
+    auto changed = std::vector<std::string>{};
+    store_t::changes(
+        v1,
+        v2,
+        [&](auto& x) { added.push_back(x.first); },
+        [&](auto& x) { removed.push_back(x.first); },
+        [&](auto& x, auto& y) {
+            CHECK(x.second == 1);
+            CHECK(y.second == 3);
+            changed.push_back(x.first);
+        });
+    CHECK(added == std::vector<std::string>{"c"});
+    CHECK(removed == std::vector<std::string>{"b"});
+    CHECK(changed == std::vector<std::string>{"a"});
+}
+
+TEST_CASE("kv_store checkpoint")
+{
+    store_t s;
+    immer::checkpointer<store_t::map_type> cp;
+    s.transact([](auto& tx) { tx.set("a", 1); });
+    auto out = std::string{};
+    auto r   = s.checkpoint(cp, [&](const char* data, std::size_t size) {
+        out.append(data, size);
+    });
+    CHECK(r.first == 1u);
+    auto info = r.second.get();
+    CHECK(!info.incremental);
+
+    auto stream = std::stringstream{out};
+    immer::input_archive in{stream};
+    CHECK(in.load<store_t::map_type>(info.id) == s.snapshot().data());
+}
@@ -0,0 +1,151 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/list.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct thrower
+{
+    static int budget;
+
+    int value;
+
+    thrower(int v)
+        : value{v}
+    {}
+
+    thrower(const thrower& other)
+        : value{other.value}
+    {
+        if (budget-- == 0)
+            throw std::runtime_error{"copy"};
+    }
+};
+
+int thrower::budget = -1;
+
+} // namespace
+
+TEST_CASE("list basics")
+{
+    auto l = immer::list<int>{};
+    CHECK(l.empty());
+    CHECK(l.begin() == l.end());
+    CHECK(l.pop_front().empty());
+
+    auto a = l.push_front(3).push_front(2).push_front(1);
+    CHECK(a.size() == 3u);
+    CHECK(a.front() == 1);
+    CHECK(a == immer::list<int>{1, 2, 3});
+    CHECK(a != immer::list<int>{1, 2});
+    CHECK(a.pop_front() == immer::list<int>{2, 3});
+    CHECK(a.drop(2) == immer::list<int>{3});
+    CHECK(a.drop(7).empty());
+    CHECK(a.reverse() == immer::list<int>{3, 2, 1});
+    CHECK(std::vector<int>(a.begin(), a.end()) == std::vector<int>{1, 2, 3});
+    CHECK(l.empty());
+}
+
+TEST_CASE("list shares tails")
+{
+    auto tail = immer::list<std::string>{"b", "c"};
+    auto x    = tail.push_front("x");
+    auto y    = tail.push_front("y");
+    CHECK(x.front() == "x");
+    CHECK(y.front() == "y");
+    CHECK(&*x.pop_front().begin() == &*tail.begin());
+    CHECK(&*y.pop_front().begin() == &*tail.begin());
+    CHECK(x.pop_front() == y.pop_front());
+}
+
+TEST_CASE("chunked list")
+{
+    using list_t = immer::chunked_list<int, 4>;
+
+    auto l = list_t{};
+    for (auto i = 0; i < 100; ++i)
+        l = std::move(l).push_front(i);
+    CHECK(l.size() == 100u);
+    auto i = 99;
+    for (auto x : l)
+        CHECK(x == i--);
+    // the values pushed one after the other are in the same cell
+    CHECK(&*l.begin() + 1 == &*l.pop_front().begin());
+    CHECK(&*l.begin() + 3 == &*l.drop(3).begin());
+
+    SECTION("only the first push into a shared cell fills it")
+    {
+        auto tail = l.drop(1);
+        auto a    = tail.push_front(-1);
+        auto b    = tail.push_front(-2);
+        CHECK(a.front() == -1);
+        CHECK(b.front() == -2);
+        CHECK(l.front() == 99);
+        CHECK(a.pop_front() == tail);
+        CHECK(b.pop_front() == tail);
+        CHECK(&*b.pop_front().begin() == &*tail.begin());
+    }
+
+    SECTION("ranges")
+    {
+        auto v = std::vector<int>{};
+        for (auto k = 0; k < 10; ++k)
+            v.push_back(k);
+        auto r = list_t(v.begin(), v.end());
+        CHECK(std::vector<int>(r.begin(), r.end()) == v);
+        CHECK(r.drop(4).front() == 4);
+        CHECK(r.drop(9).front() == 9);
+        CHECK(r.drop(10).empty());
+        // the first cell is full
+        CHECK(r.push_front(-1).pop_front() == r);
+        CHECK(r.reverse().front() == 9);
+    }
+}
+
+TEST_CASE("list destroys long lists without recursion")
+{
+    auto l = immer::list<std::shared_ptr<int>>{};
+    auto p = std::make_shared<int>(42);
+    for (auto i = 0; i < 1000000; ++i)
+        l = std::move(l).push_front(p);
+    CHECK(p.use_count() == 1000001);
+    auto m = l.drop(500000);
+    l      = {};
+    CHECK(p.use_count() == 500001);
+    m = {};
+    CHECK(p.use_count() == 1);
+}
+
+TEST_CASE("list exception safety")
+{
+    using list_t = immer::chunked_list<thrower, 3>;
+
+    auto v = std::vector<thrower>{};
+    for (auto i = 0; i < 10; ++i)
+        v.emplace_back(i);
+    thrower::budget = 7;
+    CHECK_THROWS_AS(list_t(v.begin(), v.end()), std::runtime_error);
+
+    thrower::budget = -1;
+    auto l          = list_t(v.begin(), v.begin() + 2);
+    thrower::budget = 0;
+    CHECK_THROWS_AS(l.push_front(thrower{5}), std::runtime_error);
+    thrower::budget = -1;
+    auto m          = l.push_front(thrower{5}).push_front(thrower{6});
+    CHECK(m.size() == 4u);
+    CHECK(m.front().value == 6);
+    CHECK(m.drop(2).front().value == 0);
+}
@@ -0,0 +1,27 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/map.hpp>
+
+using embed_memory = immer::memory_policy<
+    immer::heap_policy<immer::cpp_heap>,
+    immer::default_refcount_policy,
+    immer::default_lock_policy,
+    immer::get_transience_policy_t<immer::default_refcount_policy>,
+    true,
+    true,
+    true>;
+
+template <typename K,
+          typename T,
+          typename Hash = std::hash<K>,
+          typename Eq   = std::equal_to<K>>
+using test_map_t = immer::map<K, T, Hash, Eq, embed_memory, 3u>;
+
+#define MAP_T test_map_t
+#include "generic.ipp"
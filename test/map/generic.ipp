@@ -122,6 +122,149 @@ TEST_CASE("initializer list and range constructors")
     CHECK(v1 == v2);
 }
 
+TEST_CASE("insert range")
+{
+    SECTION("empty range")
+    {
+        auto v = make_test_map(42);
+        auto r = std::vector<std::pair<unsigned, unsigned>>{};
+        CHECK(v.insert_range(r.begin(), r.end()).identity() == v.identity());
+    }
+
+    SECTION("into empty map with repeated keys")
+    {
+        auto gen  = make_generator();
+        auto vals = std::vector<std::pair<unsigned, unsigned>>{};
+        for (auto i = 0u; i < 3000u; ++i)
+            vals.push_back({gen() % 1000u, i});
+        auto seq = MAP_T<unsigned, unsigned>{};
+        for (auto&& x : vals)
+            seq = seq.insert(x);
+        auto v = MAP_T<unsigned, unsigned>{}.insert_range(vals.begin(),
+                                                          vals.end());
+        CHECK(v.size() == seq.size());
+        CHECK(v == seq);
+    }
+
+    SECTION("over existing map")
+    {
+        auto m    = make_test_map(666u);
+        auto vals = std::vector<std::pair<unsigned, unsigned>>{};
+        for (auto i = 333u; i < 1000u; ++i)
+            vals.push_back({i, i * 2});
+        auto v = m.insert_range(vals.begin(), vals.end());
+        CHECK(m.size() == 666u);
+        CHECK(v.size() == 1000u);
+        for (auto i : test_irange(0u, 333u))
+            CHECK(v.at(i) == i);
+        for (auto i : test_irange(333u, 1000u))
+            CHECK(v.at(i) == i * 2);
+        auto w = std::move(m).insert_range(vals.begin(), vals.end());
+        CHECK(w == v);
+    }
+
+    SECTION("collisions")
+    {
+        auto vals = make_values_with_collisions(1000u);
+        auto m    = make_test_map(
+            std::vector<std::pair<conflictor, unsigned>>(vals.begin(),
+                                                         vals.begin() + 500));
+        for (auto& x : vals)
+            x.second += 1;
+        auto v = m.insert_range(vals.begin() + 250, vals.end());
+        CHECK(v.size() == 1000u);
+        for (auto i : test_irange(0u, 250u))
+            CHECK(v.at(vals[i].first) == vals[i].second - 1);
+        for (auto i : test_irange(250u, 1000u))
+            CHECK(v.at(vals[i].first) == vals[i].second);
+        auto seq = m;
+        for (auto i = 250u; i < 1000u; ++i)
+            seq = seq.insert(vals[i]);
+        CHECK(v == seq);
+    }
+}
+
+TEST_CASE("erase many")
+{
+    SECTION("keys in and out of the map")
+    {
+        auto m    = make_test_map(1000u);
+        auto keys = std::vector<unsigned>{};
+        for (auto i = 0u; i < 2000u; i += 3)
+            keys.push_back(i);
+        keys.push_back(3);
+        auto v = m.erase_many(keys);
+        CHECK(m.size() == 1000u);
+        CHECK(v.size() == 666u);
+        auto seq = m;
+        for (auto k : keys)
+            seq = seq.erase(k);
+        CHECK(v == seq);
+        CHECK(std::move(m).erase_many(keys) == seq);
+    }
+
+    SECTION("nothing to erase")
+    {
+        auto m = make_test_map(100u);
+        CHECK(m.erase_many(std::vector<unsigned>{}).identity() ==
+              m.identity());
+        CHECK(m.erase_many(std::vector<unsigned>{100u, 200u}) == m);
+    }
+
+    SECTION("everything")
+    {
+        auto m    = make_test_map(300u);
+        auto keys = std::vector<unsigned>{};
+        for (auto i = 0u; i < 300u; ++i)
+            keys.push_back(i);
+        auto v = m.erase_many(keys);
+        CHECK(v.empty());
+        CHECK(v == MAP_T<unsigned, unsigned>{});
+        CHECK(v.insert({1u, 1u}).at(1u) == 1u);
+    }
+
+    SECTION("collisions")
+    {
+        auto vals = make_values_with_collisions(1000u);
+        auto m    = make_test_map(vals);
+        auto keys = std::vector<conflictor>{};
+        for (auto i = 0u; i < 1000u; i += 2)
+            keys.push_back(vals[i].first);
+        auto v = m.erase_many(keys);
+        CHECK(v.size() == 500u);
+        for (auto i : test_irange(0u, 1000u))
+            CHECK(v.count(vals[i].first) == i % 2);
+        auto seq = m;
+        for (auto& k : keys)
+            seq = seq.erase(k);
+        CHECK(v == seq);
+    }
+}
+
+TEST_CASE("erase if")
+{
+    auto m = make_test_map(1000u);
+    auto v = m.erase_if([](auto& x) { return x.first % 3 == 0; });
+    CHECK(m.size() == 1000u);
+    CHECK(v.size() == 666u);
+    for (auto i : test_irange(0u, 1000u))
+        CHECK(v.count(i) == (i % 3 != 0));
+    CHECK(m.erase_if([](auto&&) { return false; }).identity() ==
+          m.identity());
+    CHECK(m.erase_if([](auto&&) { return true; }).empty());
+    auto w = std::move(m).erase_if([](auto& x) { return x.second < 500u; });
+    CHECK(w.size() == 500u);
+    CHECK(w.count(499u) == 0);
+    CHECK(w.count(500u) == 1);
+
+    auto vals = make_values_with_collisions(1000u);
+    auto c    = make_test_map(vals).erase_if(
+        [](auto& x) { return x.second % 2 == 0; });
+    CHECK(c.size() == 500u);
+    for (auto i : test_irange(0u, 1000u))
+        CHECK(c.count(vals[i].first) == i % 2);
+}
+
 TEST_CASE("accessor")
 {
     const auto n = 666u;
@@ -187,6 +330,34 @@ TEST_CASE("equals and setting")
 #endif
 }
 
+TEST_CASE("emplace")
+{
+    const auto n = 666u;
+    auto v       = make_test_map(n);
+    auto m       = MAP_T<int, std::string>{};
+    for (auto i = 0; i < 100; ++i)
+        m = m.emplace(i, i % 7, 'a');
+
+    CHECK(m.size() == 100u);
+    CHECK(m[42] == std::string(42 % 7, 'a'));
+    CHECK(m.emplace(42, "foo")[42] == "foo");
+    CHECK(m.emplace(1000)[1000] == "");
+    CHECK(v.emplace(1234, 42u) == v.set(1234, 42));
+    CHECK(v.emplace(42, 43u) == v.set(42, 43));
+    CHECK(std::move(m).emplace(7, 2u, 'b')[7] == "bb");
+
+    SECTION("try_emplace")
+    {
+        CHECK(v.try_emplace(42, 43u).identity() == v.identity());
+        CHECK(v.try_emplace(1234, 42u) == v.set(1234, 42));
+
+        auto w = v;
+        w      = std::move(w).try_emplace(42, 43u);
+        w      = std::move(w).try_emplace(1234, 42u);
+        CHECK(w == v.set(1234, 42));
+    }
+}
+
 #if IMMER_DEBUG_STATS
 TEST_CASE("debug stats")
 {
@@ -312,6 +483,44 @@ TEST_CASE("update_if_exists a lot")
     }
 }
 
+TEST_CASE("update if changed")
+{
+    auto v    = make_test_map(666u);
+    auto same = [](auto&& x) { return x; };
+    auto incr = [](auto&& x) { return x + 1; };
+
+    CHECK(v.set_if_changed(3u, 3u).identity() == v.identity());
+    CHECK(v.update_if_changed(42u, same).identity() == v.identity());
+
+    auto u = v.set_if_changed(3u, 13u);
+    CHECK(u.identity() != v.identity());
+    CHECK(u[3u] == 13u);
+    CHECK(v[3u] == 3u);
+    CHECK(v.update_if_changed(42u, incr)[42u] == 43u);
+
+    // a missing key is always added, even with a default value
+    auto w = v.update_if_changed(1000u, same);
+    CHECK(w.size() == v.size() + 1);
+    CHECK(w.count(1000u));
+    CHECK(v.set_if_changed(1000u, 0u).count(1000u));
+
+    SECTION("move")
+    {
+        auto id = v.identity();
+        v       = std::move(v).set_if_changed(3u, 3u);
+        CHECK(v.identity() == id);
+        v = std::move(v).update_if_changed(42u, same);
+        CHECK(v.identity() == id);
+        for (auto i = 0u; i < 666u; ++i) {
+            v = std::move(v).update_if_changed(i, incr);
+            CHECK(v[i] == i + 1);
+        }
+        v = std::move(v).set_if_changed(1000u, 1u);
+        CHECK(v[1000u] == 1u);
+        CHECK(v.size() == 667u);
+    }
+}
+
 #if !IMMER_IS_LIBGC_TEST
 TEST_CASE("update boxed move string")
 {
@@ -450,6 +659,68 @@ TEST_CASE("exception safety")
         IMMER_TRACE_E(d.happenings);
     }
 
+    SECTION("insert range")
+    {
+        auto v    = dadaist_map_t{};
+        auto vals = std::vector<std::pair<unsigned, dadaist<unsigned>>>{};
+        {
+            auto disable = dadaism::disable();
+            for (auto i = 0u; i < n / 2; ++i)
+                v = std::move(v).set(i, i);
+            for (auto i = n / 4; i < n; ++i)
+                vals.push_back({i, i + 1});
+        }
+        auto d = dadaism{};
+        for (auto done = false; !done;) {
+            try {
+                auto s = d.next();
+                auto r = v.insert_range(vals.begin(), vals.end());
+                done   = true;
+                CHECK(r.size() == n);
+                for (auto i : test_irange(0u, n / 4))
+                    CHECK(r.at(i) == i);
+                for (auto i : test_irange(n / 4, n))
+                    CHECK(r.at(i) == i + 1);
+            } catch (dada_error) {
+            }
+            CHECK(v.size() == n / 2);
+            for (auto i : test_irange(0u, n / 2))
+                CHECK(v.at(i) == i);
+        }
+        CHECK(d.happenings > 0);
+        IMMER_TRACE_E(d.happenings);
+    }
+
+    SECTION("erase many")
+    {
+        auto v    = dadaist_map_t{};
+        auto keys = std::vector<unsigned>{};
+        {
+            auto disable = dadaism::disable();
+            for (auto i = 0u; i < n; ++i)
+                v = std::move(v).set(i, i);
+            for (auto i = 0u; i < n; i += 3)
+                keys.push_back(i);
+        }
+        auto d = dadaism{};
+        for (auto done = false; !done;) {
+            try {
+                auto s = d.next();
+                auto r = v.erase_many(keys);
+                done   = true;
+                CHECK(r.size() == n - keys.size());
+                for (auto i : test_irange(0u, n))
+                    CHECK(r.count(i) == (i % 3 != 0));
+            } catch (dada_error) {
+            }
+            CHECK(v.size() == n);
+            for (auto i : test_irange(0u, n))
+                CHECK(v.at(i) == i);
+        }
+        CHECK(d.happenings > 0);
+        IMMER_TRACE_E(d.happenings);
+    }
+
     SECTION("update_if_exists")
     {
         auto v = dadaist_map_t{};
@@ -803,3 +1074,133 @@ TEST_CASE("diff")
     test_diff(16, 1500, 10, 3);
     test_diff(100, 0, 0, 50);
 }
+
+TEST_CASE("transform values")
+{
+    auto to_string = [](unsigned x) { return std::to_string(x); };
+
+    SECTION("empty")
+    {
+        auto m =
+            immer::transform_values(MAP_T<unsigned, unsigned>{}, to_string);
+        CHECK(m.empty());
+        CHECK(m.set(1u, "1").size() == 1u);
+    }
+
+    SECTION("many")
+    {
+        auto n = make_test_map(1000);
+        auto m = immer::transform_values(n, to_string);
+        static_assert(
+            std::is_same<decltype(m), MAP_T<unsigned, std::string>>::value,
+            "");
+        CHECK(m.size() == n.size());
+        for (auto i = 0u; i < 1000u; ++i)
+            CHECK(m[i] == std::to_string(i));
+        CHECK(m.count(1000u) == 0);
+        CHECK(m.erase(5u).size() == 999u);
+        CHECK(m.set(2000u, "x")[2000u] == "x");
+    }
+
+    SECTION("collisions")
+    {
+        auto vals = make_values_with_collisions(100);
+        auto n    = make_test_map(vals);
+        auto m =
+            immer::transform_values(n, [](unsigned x) { return x * 2.0; });
+        CHECK(m.size() == n.size());
+        for (auto& v : vals)
+            CHECK(m[v.first] == v.second * 2.0);
+        CHECK(m.erase(vals[0].first).size() == 99u);
+    }
+}
+
+TEST_CASE("filter")
+{
+    auto m = make_test_map(1000);
+    auto r = immer::filter(
+        m, [](const std::pair<unsigned, unsigned>& x) { return x.first != 7; });
+    CHECK(r.size() == 999u);
+    CHECK(r.count(7) == 0);
+    CHECK(r[8] == 8);
+    CHECK(r == m.erase(7));
+}
+
+TEST_CASE("find_many")
+{
+    auto m    = make_test_map(3000);
+    auto keys = std::vector<unsigned>{};
+    for (auto i = 0u; i < 500u; ++i)
+        keys.push_back(i * 7);
+    auto out = std::vector<const unsigned*>{};
+    m.find_many(keys, std::back_inserter(out));
+    REQUIRE(out.size() == keys.size());
+    for (auto i = 0u; i < keys.size(); ++i)
+        CHECK(out[i] == m.find(keys[i]));
+
+    SECTION("collisions")
+    {
+        auto vals = make_values_with_collisions(100);
+        auto c    = make_test_map(vals);
+        auto ks   = std::vector<conflictor>{};
+        for (auto& v : vals)
+            ks.push_back(v.first);
+        ks.push_back({0u, 42u});
+        auto res = std::vector<const unsigned*>{};
+        c.find_many(ks, std::back_inserter(res));
+        REQUIRE(res.size() == ks.size());
+        for (auto i = 0u; i < ks.size(); ++i)
+            CHECK(res[i] == c.find(ks[i]));
+    }
+}
+
+TEST_CASE("precomputed hash")
+{
+    using map_t = MAP_T<unsigned, unsigned>;
+    auto h      = typename map_t::hasher{};
+    auto m      = make_test_map(1000);
+    for (auto i = 0u; i < 1100u; ++i)
+        CHECK(m.find_hashed(i, h(i)) == m.find(i));
+
+    auto a = m.insert_hashed({42u, 7u}, h(42u));
+    auto b = m.update_hashed(43u, h(43u), [](auto x) { return x + 1; });
+    auto c = m.insert_hashed({2000u, 1u}, h(2000u));
+    CHECK(a == m.insert({42u, 7u}));
+    CHECK(b == m.update(43u, [](auto x) { return x + 1; }));
+    CHECK(c == m.insert({2000u, 1u}));
+    CHECK(m.size() == 1000u);
+    CHECK(std::move(c).update_hashed(2000u, h(2000u), [](auto x) {
+        return x * 3;
+    })[2000u] == 3u);
+}
+
+TEST_CASE("resume")
+{
+    auto check_pages = [](const auto& m, std::size_t n) {
+        auto count = std::size_t{};
+        auto cur   = immer::hash_cursor{};
+        auto seen  = m;
+        while (!cur.end)
+            cur = m.resume(cur, n, [&](auto& kv) {
+                CHECK(seen.count(kv.first));
+                seen = std::move(seen).erase(kv.first);
+                ++count;
+            });
+        CHECK(count == m.size());
+        CHECK(seen.empty());
+    };
+
+    SECTION("default")
+    {
+        auto m = make_test_map(1000u);
+        check_pages(m, 1);
+        check_pages(m, 33);
+    }
+
+    SECTION("collisions")
+    {
+        auto m = make_test_map(make_values_with_collisions(1000u));
+        check_pages(m, 1);
+        check_pages(m, 33);
+    }
+}
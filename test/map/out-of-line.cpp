@@ -0,0 +1,149 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/algorithm.hpp>
+#include <immer/map.hpp>
+
+#include <string>
+
+// Every value is bigger than the limit, so all of them are boxed.
+using out_of_line_memory = immer::out_of_line_policy<4>;
+
+template <typename K,
+          typename T,
+          typename Hash = std::hash<K>,
+          typename Eq   = std::equal_to<K>>
+using test_map_t = immer::map<K, T, Hash, Eq, out_of_line_memory, 3u>;
+
+#define MAP_T test_map_t
+#include "generic.ipp"
+
+namespace {
+
+struct big
+{
+    static int copies;
+
+    char data[200] = {};
+    unsigned id    = 0;
+
+    big() = default;
+    big(unsigned x)
+        : id{x}
+    {}
+    big(const big& other)
+        : id{other.id}
+    {
+        ++copies;
+    }
+    big& operator=(const big& other) = default;
+
+    bool operator==(const big& other) const { return id == other.id; }
+    bool operator!=(const big& other) const { return id != other.id; }
+};
+
+int big::copies = 0;
+
+} // namespace
+
+TEST_CASE("big values are not copied with the nodes")
+{
+    using map_t = immer::map<unsigned,
+                             big,
+                             std::hash<unsigned>,
+                             std::equal_to<unsigned>,
+                             immer::out_of_line_policy<64>>;
+    static_assert(
+        std::is_same<map_t::iterator::value_type, map_t::value_type>::value,
+        "iterators give the values, not the boxes");
+
+    auto m = map_t{};
+    for (auto i = 0u; i < 1000u; ++i)
+        m = std::move(m).set(i, big{i});
+
+    big::copies = 0;
+    auto m2     = m.set(42u, big{1042});
+    CHECK(big::copies <= 1);
+    CHECK(m2.at(42u).id == 1042u);
+    CHECK(m.at(42u).id == 42u);
+    CHECK(m2.find(7u)->id == 7u);
+
+    big::copies = 0;
+    auto m3 = m2.update(7u, [](const big& x) { return big{x.id + 1}; });
+    CHECK(big::copies <= 1);
+    CHECK(m3[7u].id == 8u);
+
+    auto sum = 0u;
+    for (const auto& kv : m3)
+        sum += kv.second.id - kv.first;
+    CHECK(sum == 1001u);
+}
+
+TEST_CASE("small values stay in the nodes")
+{
+    using map_t = immer::map<unsigned,
+                             unsigned,
+                             std::hash<unsigned>,
+                             std::equal_to<unsigned>,
+                             immer::out_of_line_policy<64>>;
+    static_assert(!map_t::stored_value_t::out_of_line, "");
+    auto m = map_t{}.set(1u, 2u);
+    CHECK(m[1u] == 2u);
+}
+
+TEST_CASE("merging and filtering boxed values")
+{
+    using map_t = immer::map<int,
+                             std::string,
+                             std::hash<int>,
+                             std::equal_to<int>,
+                             immer::out_of_line_policy<8>>;
+    static_assert(map_t::stored_value_t::out_of_line, "");
+
+    auto a = map_t{};
+    auto b = map_t{};
+    for (auto i = 0; i < 100; ++i) {
+        a = std::move(a).set(i, "a" + std::to_string(i));
+        if (i % 2 == 0)
+            b = std::move(b).set(i + 50, "b" + std::to_string(i + 50));
+    }
+
+    SECTION("set_union")
+    {
+        auto u = immer::set_union(a, b);
+        CHECK(u.size() == 125u);
+        CHECK(u[10] == "a10");
+        CHECK(u[60] == "a60");
+        CHECK(u[140] == "b140");
+        CHECK(immer::par_set_union(a, b) == u);
+    }
+
+    SECTION("merge")
+    {
+        auto cat = [](const std::string& x, const std::string& y) {
+            return x + y;
+        };
+        auto m = a.merge(b, cat);
+        CHECK(m.size() == 125u);
+        CHECK(m[10] == "a10");
+        CHECK(m[60] == "a60b60");
+        CHECK(m[61] == "a61");
+        CHECK(m[140] == "b140");
+        CHECK(a.par_merge(b, cat) == m);
+    }
+
+    SECTION("filter")
+    {
+        auto f = immer::filter(a, [](const std::pair<int, std::string>& kv) {
+            return kv.first % 3 == 0 && kv.second[0] == 'a';
+        });
+        CHECK(f.size() == 34u);
+        CHECK(f[33] == "a33");
+        CHECK(f.count(34) == 0u);
+    }
+}
@@ -63,6 +63,48 @@ TEST_CASE("insert")
     CHECK(t.size() == 2);
 }
 
+
+TEST_CASE("insert range")
+{
+    auto t    = MAP_T<int, int>{{1, 1}, {2, 2}}.transient();
+    auto vals = std::vector<std::pair<int, int>>{};
+    for (auto i = 0; i < 1000; ++i)
+        vals.push_back({i % 500, i});
+    t.insert_range(vals.begin(), vals.end());
+    CHECK(t.size() == 500);
+    for (auto i = 0; i < 500; ++i)
+        CHECK(t[i] == i + 500);
+    t.insert({1000, 1});
+    t.insert_range(vals.begin(), vals.begin() + 10);
+    CHECK(t.size() == 501);
+    CHECK(t[3] == 3);
+    CHECK(t[1000] == 1);
+}
+TEST_CASE("erase many and erase if")
+{
+    auto t    = MAP_T<int, int>{}.transient();
+    auto keys = std::vector<int>{};
+    for (auto i = 0; i < 1000; ++i) {
+        t.set(i, i);
+        if (i % 2)
+            keys.push_back(i);
+    }
+    t.erase_many(keys);
+    CHECK(t.size() == 500);
+    CHECK(t.count(1) == 0);
+    CHECK(t[2] == 2);
+    t.erase_if([](auto& x) { return x.first % 4 == 0; });
+    CHECK(t.size() == 250);
+    CHECK(t.count(4) == 0);
+    CHECK(t[6] == 6);
+    t.set(4, 5);
+    t.erase_many(std::vector<int>{6, 7});
+    auto m = t.persistent();
+    CHECK(m.size() == 250);
+    CHECK(m[4] == 5);
+    CHECK(m.count(6) == 0);
+}
+
 TEST_CASE("set")
 {
     auto t = MAP_TRANSIENT_T<std::string, int>{};
@@ -80,6 +122,21 @@ TEST_CASE("set")
     CHECK(t.size() == 2);
 }
 
+TEST_CASE("emplace")
+{
+    auto t = MAP_TRANSIENT_T<std::string, std::string>{};
+
+    t.emplace("foo", 3u, 'a');
+    CHECK(t["foo"] == "aaa");
+    t.emplace("foo", "bar");
+    CHECK(t["foo"] == "bar");
+
+    CHECK(t.try_emplace("baz", 2u, 'b'));
+    CHECK(!t.try_emplace("baz", "qux"));
+    CHECK(t["baz"] == "bb");
+    CHECK(t.size() == 2);
+}
+
 TEST_CASE("update")
 {
     auto t = MAP_TRANSIENT_T<std::string, int>{};
@@ -105,6 +162,38 @@ TEST_CASE("update")
     CHECK(t.size() == 2);
 }
 
+TEST_CASE("get mut")
+{
+    auto m = MAP_T<std::string, int>{{"foo", 12}, {"bar", 42}};
+    auto t = m.transient();
+
+    auto p = t.get_mut("foo");
+    REQUIRE(p != nullptr);
+    *p += 1;
+    CHECK(t["foo"] == 13);
+    CHECK(m["foo"] == 12);
+    CHECK(t.get_mut("manolo") == nullptr);
+    CHECK(t.size() == 2);
+
+    auto q = t.get_mut("foo");
+    CHECK(*q == 13);
+    *q = 7;
+    CHECK(t.persistent()["foo"] == 7);
+    CHECK(m["foo"] == 12);
+
+    auto u = MAP_T<int, int>{}.transient();
+    for (auto i = 0; i < 1000; ++i)
+        u.insert({i, i});
+    auto v = u.persistent();
+    u      = v.transient();
+    for (auto i = 0; i < 1000; ++i)
+        *u.get_mut(i) += 1;
+    for (auto i = 0; i < 1000; ++i) {
+        CHECK(u[i] == i + 1);
+        CHECK(v[i] == i);
+    }
+}
+
 TEST_CASE("erase")
 {
     auto t = MAP_T<std::string, int>{{"foo", 12}, {"bar", 42}}.transient();
@@ -116,3 +205,17 @@ TEST_CASE("erase")
     CHECK(t.count("bar") == 1);
     CHECK(t.size() == 1);
 }
+
+TEST_CASE("precomputed hash")
+{
+    auto t = MAP_TRANSIENT_T<std::string, int>{};
+    auto h = typename MAP_TRANSIENT_T<std::string, int>::hasher{};
+    t.insert_hashed({"foo", 42}, h("foo"));
+    CHECK(t["foo"] == 42);
+    t.update_hashed("foo", h("foo"), [](auto x) { return x + 1; });
+    t.update_hashed("bar", h("bar"), [](auto x) { return x + 1; });
+    CHECK(*t.find_hashed("foo", h("foo")) == 43);
+    CHECK(*t.find_hashed("bar", h("bar")) == 1);
+    CHECK(t.find_hashed("baz", h("baz")) == nullptr);
+    CHECK(t.size() == 2);
+}
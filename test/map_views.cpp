@@ -0,0 +1,110 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/algorithm.hpp>
+#include <immer/map.hpp>
+#include <immer/map_views.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct big
+{
+    long data[16] = {};
+    int n         = 0;
+};
+
+using boxed_map_t = immer::map<int,
+                               big,
+                               std::hash<int>,
+                               std::equal_to<int>,
+                               immer::out_of_line_policy<64>>;
+
+template <typename View>
+std::vector<typename View::value_type> chunks_to_std(const View& v)
+{
+    auto r = std::vector<typename View::value_type>{};
+    immer::for_each_chunk(v, [&](auto f, auto l) {
+        CHECK(l - f > 0);
+        r.insert(r.end(), f, l);
+    });
+    return r;
+}
+
+} // namespace
+
+TEST_CASE("keys and values of a map")
+{
+    auto m = immer::map<std::string, int>{};
+    for (auto i = 0; i < 1000; ++i)
+        m = std::move(m).set(std::to_string(i), i);
+
+    auto ks = immer::keys(m);
+    auto vs = immer::values(m);
+    CHECK(ks.size() == 1000);
+    CHECK(!vs.empty());
+    CHECK(immer::values(immer::map<int, int>{}).empty());
+
+    // the views iterate in the order of the map
+    auto it = m.begin();
+    auto kt = ks.begin();
+    auto vt = vs.begin();
+    for (; it != m.end(); ++it, ++kt, ++vt) {
+        CHECK(&*kt == &it->first);
+        CHECK(&*vt == &it->second);
+    }
+    CHECK(kt == ks.end());
+    CHECK(vt == vs.end());
+
+    CHECK(chunks_to_std(ks) == std::vector<std::string>(ks.begin(), ks.end()));
+    CHECK(chunks_to_std(vs) == std::vector<int>(vs.begin(), vs.end()));
+    CHECK(immer::accumulate(vs, 0) == 999 * 1000 / 2);
+    CHECK(std::count_if(ks.begin(), ks.end(), [](auto& k) {
+              return k.size() == 3;
+          }) == 900);
+}
+
+TEST_CASE("keys and values of a map with boxed values")
+{
+    auto m = boxed_map_t{};
+    for (auto i = 0; i < 500; ++i)
+        m = std::move(m).set(i, big{{}, i * 2});
+
+    auto ks = chunks_to_std(immer::keys(m));
+    std::sort(ks.begin(), ks.end());
+    CHECK(ks.size() == 500);
+    CHECK(ks.front() == 0);
+    CHECK(ks.back() == 499);
+
+    auto sum = 0;
+    immer::for_each(immer::values(m), [&](const big& b) { sum += b.n; });
+    CHECK(sum == 499 * 500);
+}
+
+TEST_CASE("equality of the keys of maps")
+{
+    auto a = immer::map<int, int>{};
+    for (auto i = 0; i < 1000; ++i)
+        a = std::move(a).set(i, i);
+    auto b = a;
+    for (auto i = 0; i < 1000; i += 3)
+        b = std::move(b).set(i, -i);
+
+    CHECK(a != b);
+    CHECK(immer::keys(a) == immer::keys(b));
+    CHECK(immer::keys(a) != immer::keys(b.erase(7)));
+    CHECK(immer::keys(a) != immer::keys(b.erase(7).set(1000, 0)));
+
+    auto c = boxed_map_t{}.set(1, {}).set(2, {});
+    CHECK(immer::keys(c) == immer::keys(boxed_map_t{}.set(2, {}).set(1, {})));
+}
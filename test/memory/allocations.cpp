@@ -0,0 +1,353 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+// Budgets of the allocations of the operations of the containers.  The
+// allocations are counted in front of the heap of the memory policy, so
+// that a free list does not hide them.
+
+#include <immer/flex_vector.hpp>
+#include <immer/flex_vector_transient.hpp>
+#include <immer/heap/cpp_heap.hpp>
+#include <immer/heap/heap_policy.hpp>
+#include <immer/map.hpp>
+#include <immer/map_transient.hpp>
+#include <immer/memory_policy.hpp>
+#include <immer/set.hpp>
+#include <immer/table.hpp>
+#include <immer/vector.hpp>
+#include <immer/vector_transient.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstddef>
+
+namespace {
+
+using immer::cpp_heap;
+
+std::size_t& allocations()
+{
+    static auto count = std::size_t{};
+    return count;
+}
+
+// Heap adaptor that counts the allocations of all the heaps that it is
+// put in front of in the same counter.
+template <typename Base>
+struct counting_heap : Base
+{
+    template <typename... Tags>
+    static void* allocate(std::size_t size, Tags... tags)
+    {
+        auto p = Base::allocate(size, tags...);
+        ++allocations();
+        return p;
+    }
+};
+
+// Puts a `counting_heap` in front of all the heaps of `HeapPolicy`.
+template <typename HeapPolicy>
+struct counting_heap_policy
+{
+    using type = counting_heap<typename HeapPolicy::type>;
+
+    template <std::size_t Size>
+    struct optimized
+    {
+        using type =
+            counting_heap<typename HeapPolicy::template optimized<Size>::type>;
+    };
+};
+
+template <typename HeapPolicy>
+using counted_memory =
+    immer::memory_policy<counting_heap_policy<HeapPolicy>,
+                         immer::refcount_policy,
+                         immer::default_lock_policy>;
+
+using plain_memory = counted_memory<immer::heap_policy<immer::cpp_heap>>;
+using free_list_memory =
+    counted_memory<immer::free_list_heap_policy<immer::cpp_heap>>;
+
+// the edit tokens would come from the heap if they needed to
+using gc_transience_memory =
+    immer::memory_policy<counting_heap_policy<immer::heap_policy<cpp_heap>>,
+                         immer::refcount_policy,
+                         immer::default_lock_policy,
+                         immer::gc_transience_policy,
+                         false,
+                         false>;
+
+// the number of allocations done by `fn()`
+template <typename Fn>
+std::size_t count_allocations(Fn&& fn)
+{
+    auto before = allocations();
+    fn();
+    return allocations() - before;
+}
+
+struct row
+{
+    int id;
+    int value;
+};
+
+template <typename Memory>
+void test_vector_budgets()
+{
+    constexpr auto BL = immer::vector<int, Memory>::bits_leaf;
+    using vector_t    = immer::vector<int, Memory, 5, BL>;
+    constexpr auto n  = std::size_t{1} << 12;
+    // 4096 elements take a root, a level of inner nodes and the leaves
+    constexpr auto depth = std::size_t{3};
+
+    auto v = vector_t{};
+    for (auto i = 0u; i < n; ++i)
+        v = std::move(v).push_back(int(i));
+
+    SECTION("push_back copies the tail, and, when it is full, the spine")
+    {
+        auto a = count_allocations([&] { (void) v.push_back(1); });
+        CHECK(a <= depth + 1);
+    }
+
+    SECTION("moved push_back allocates a leaf every 2^BL elements")
+    {
+        auto x      = v;
+        auto leaves = (n >> BL) + 1;
+        auto a      = count_allocations([&] {
+            x = std::move(x).push_back(0);
+            for (auto i = 1u; i < n; ++i)
+                x = std::move(x).push_back(int(i));
+        });
+        // one new leaf per 2^BL elements, a spine node every 32 leaves,
+        // the copies of the nodes that `v` still shares, and a new root
+        CHECK(a <= leaves + leaves / 32 + depth + 2);
+    }
+
+    SECTION("transient push_back has the same budget")
+    {
+        auto t      = v.transient();
+        auto leaves = (n >> BL) + 1;
+        auto a      = count_allocations([&] {
+            for (auto i = 0u; i < n; ++i)
+                t.push_back(int(i));
+        });
+        CHECK(a <= leaves + leaves / 32 + depth + 2);
+    }
+
+    SECTION("set copies the path")
+    {
+        auto a = count_allocations([&] { (void) v.set(n / 2, 0); });
+        CHECK(a == depth);
+    }
+
+    SECTION("moved and transient set on a unique vector allocate nothing")
+    {
+        // the first set makes the path to the leaf unique
+        auto x = v;
+        x      = std::move(x).set(n / 2, 1);
+        CHECK(count_allocations([&] { x = std::move(x).set(n / 2 + 1, 1); }) ==
+              0);
+        auto t = x.transient();
+        t.set(n / 2, 2);
+        CHECK(count_allocations([&] { t.set(n / 2 + 1, 2); }) == 0);
+    }
+
+    SECTION("reading allocates nothing")
+    {
+        auto a = count_allocations([&] {
+            auto sum = 0;
+            for (auto x : v)
+                sum += x;
+            CHECK(sum != 0);
+            CHECK(v[n / 2] == int(n / 2));
+        });
+        CHECK(a == 0);
+    }
+}
+
+template <typename Memory>
+void test_flex_vector_budgets()
+{
+    using flex_t = immer::flex_vector<int, Memory>;
+    constexpr auto n = std::size_t{1} << 12;
+
+    auto v = flex_t{};
+    for (auto i = 0u; i < n; ++i)
+        v = std::move(v).push_back(int(i));
+
+    SECTION("take and drop copy at most one path each")
+    {
+        CHECK(count_allocations([&] { (void) v.take(n / 2 + 3); }) <= 3);
+        CHECK(count_allocations([&] { (void) v.drop(n / 2 + 3); }) <= 3);
+    }
+
+    SECTION("reading allocates nothing")
+    {
+        CHECK(count_allocations([&] { CHECK(v[n / 2] == int(n / 2)); }) ==
+              0);
+    }
+}
+
+template <typename Memory>
+void test_map_budgets()
+{
+    using map_t      = immer::map<int, int, std::hash<int>, std::equal_to<int>,
+                             Memory>;
+    constexpr auto n = 1000;
+
+    auto m = map_t{};
+    for (auto i = 0; i < n; ++i)
+        m = std::move(m).set(i, i);
+
+    SECTION("update_if_exists on a missing key allocates nothing")
+    {
+        auto inc = [](int x) { return x + 1; };
+        CHECK(count_allocations([&] {
+                  auto r = m.update_if_exists(n + 1, inc);
+                  CHECK(r.identity() == m.identity());
+              }) == 0);
+        auto t = m.transient();
+        CHECK(count_allocations([&] { t.update_if_exists(n + 1, inc); }) ==
+              0);
+    }
+
+    SECTION("erasing a missing key allocates nothing")
+    {
+        CHECK(count_allocations([&] { (void) m.erase(n + 1); }) == 0);
+    }
+
+    SECTION("set copies the path")
+    {
+        // 1000 keys in nodes of 32 children take two levels and few
+        // collisions, each level copies a node and maybe its values
+        CHECK(count_allocations([&] { (void) m.set(n / 2, 0); }) <= 4);
+    }
+
+    SECTION("moved set of an existing key on a unique map allocates nothing")
+    {
+        auto x = m.transient().persistent();
+        x      = std::move(x).set(n / 2, 1);
+        CHECK(count_allocations([&] { x = std::move(x).set(n / 2, 2); }) ==
+              0);
+        CHECK(x[n / 2] == 2);
+    }
+
+    SECTION("lookups allocate nothing")
+    {
+        CHECK(count_allocations([&] {
+                  CHECK(m.count(n / 2) == 1);
+                  CHECK(m.find(n + 1) == nullptr);
+              }) == 0);
+    }
+}
+
+template <typename Memory>
+void test_set_budgets()
+{
+    using set_t = immer::set<int, std::hash<int>, std::equal_to<int>, Memory>;
+
+    auto s = set_t{};
+    for (auto i = 0; i < 1000; ++i)
+        s = std::move(s).insert(i);
+
+    SECTION("lookups and erasing a missing value allocate nothing")
+    {
+        CHECK(count_allocations([&] {
+                  CHECK(s.count(42) == 1);
+                  CHECK(s.erase(2000).identity() == s.identity());
+              }) == 0);
+    }
+
+    SECTION("inserting an existing value copies the path")
+    {
+        // the value replaces the equal one that was there
+        CHECK(count_allocations([&] { (void) s.insert(42); }) <= 4);
+    }
+}
+
+template <typename Memory>
+void test_table_budgets()
+{
+    using table_t = immer::table<row,
+                                 immer::table_key_fn,
+                                 std::hash<int>,
+                                 std::equal_to<int>,
+                                 Memory>;
+
+    auto t = table_t{};
+    for (auto i = 0; i < 1000; ++i)
+        t = std::move(t).insert({i, i});
+
+    SECTION("update_if_exists on a missing key allocates nothing")
+    {
+        CHECK(count_allocations([&] {
+                  (void) t.update_if_exists(2000, [](row r) { return r; });
+              }) == 0);
+    }
+}
+
+} // namespace
+
+TEST_CASE("vector allocations")
+{
+    SECTION("plain heap") { test_vector_budgets<plain_memory>(); }
+    SECTION("free list") { test_vector_budgets<free_list_memory>(); }
+}
+
+TEST_CASE("flex_vector allocations")
+{
+    SECTION("plain heap") { test_flex_vector_budgets<plain_memory>(); }
+    SECTION("free list") { test_flex_vector_budgets<free_list_memory>(); }
+}
+
+TEST_CASE("map allocations")
+{
+    SECTION("plain heap") { test_map_budgets<plain_memory>(); }
+    SECTION("free list") { test_map_budgets<free_list_memory>(); }
+}
+
+TEST_CASE("set allocations")
+{
+    SECTION("plain heap") { test_set_budgets<plain_memory>(); }
+    SECTION("free list") { test_set_budgets<free_list_memory>(); }
+}
+
+TEST_CASE("table allocations")
+{
+    SECTION("plain heap") { test_table_budgets<plain_memory>(); }
+    SECTION("free list") { test_table_budgets<free_list_memory>(); }
+}
+
+TEST_CASE("gc transience owners do not allocate")
+{
+    using vector_t = immer::vector<int, gc_transience_memory>;
+    auto v         = vector_t{}.push_back(1).push_back(2);
+
+    CHECK(count_allocations([&] {
+              auto t  = v.transient();
+              auto t2 = t;
+              t2      = t;
+              (void) t.persistent();
+              (void) std::move(t2).persistent();
+          }) == 0);
+
+    SECTION("copies stop sharing the nodes that they can mutate")
+    {
+        auto t = v.transient();
+        t.push_back(3);
+        auto t2 = t;
+        t.set(2, 4);
+        t2.set(2, 5);
+        CHECK(t[2] == 4);
+        CHECK(t2[2] == 5);
+        CHECK(v.size() == 2);
+    }
+}
@@ -0,0 +1,72 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/algorithm.hpp>
+#include <immer/box.hpp>
+#include <immer/heap/epoch_heap.hpp>
+#include <immer/heap/malloc_heap.hpp>
+#include <immer/vector.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+TEST_CASE("epoch heap defers releasing memory")
+{
+    using heap = immer::epoch_heap<immer::malloc_heap>;
+
+    auto p = heap::allocate(42u);
+    std::memset(p, 42, 42u);
+    {
+        immer::epoch_guard guard;
+        std::thread{[p] { heap::deallocate(42u, p); }}.join();
+        heap::collect();
+        CHECK(static_cast<unsigned char*>(p)[41] == 42);
+    }
+    heap::collect();
+}
+
+TEST_CASE("epoch memory policy readers and writer")
+{
+    using vector_t = immer::vector<int, immer::epoch_memory_policy>;
+    using box_t    = immer::box<vector_t, immer::epoch_memory_policy>;
+
+    constexpr auto versions = 2000;
+    constexpr auto readers  = 4;
+
+    auto latest = box_t{};
+    std::atomic<const vector_t*> current{&latest.get()};
+    std::atomic<bool> done{false};
+    std::atomic<bool> valid{true};
+
+    auto threads = std::vector<std::thread>{};
+    for (auto i = 0; i < readers; ++i)
+        threads.emplace_back([&] {
+            while (!done) {
+                immer::epoch_guard guard;
+                auto& v = *current.load();
+                auto n  = static_cast<long>(v.size());
+                // every version holds 0, 1, ..., n - 1
+                if (immer::accumulate(v, 0l) != n * (n - 1) / 2)
+                    valid = false;
+            }
+        });
+
+    for (auto i = 0; i < versions; ++i) {
+        latest = latest.update([&](auto v) { return v.push_back(i); });
+        current.store(&latest.get());
+    }
+    done = true;
+    for (auto& t : threads)
+        t.join();
+    CHECK(valid);
+    CHECK(latest->size() == versions);
+}
@@ -6,14 +6,23 @@
 // See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
 //
 
+#include <immer/heap/adaptive_free_list_heap.hpp>
 #include <immer/heap/cpp_heap.hpp>
 #include <immer/heap/free_list_heap.hpp>
 #include <immer/heap/gc_heap.hpp>
+#include <immer/heap/heap_policy.hpp>
+#include <immer/heap/hugepage_slab_heap.hpp>
 #include <immer/heap/malloc_heap.hpp>
+#include <immer/heap/size_class_heap.hpp>
+#include <immer/heap/stats_heap.hpp>
 #include <immer/heap/thread_local_free_list_heap.hpp>
+#include <immer/heap/unsafe_free_list_heap.hpp>
 
 #include <catch2/catch_test_macros.hpp>
+#include <algorithm>
 #include <numeric>
+#include <thread>
+#include <vector>
 
 void do_stuff_to(void* buf, std::size_t size)
 {
@@ -94,8 +103,225 @@ TEST_CASE("thread local free list")
         immer::thread_local_free_list_heap<42u, 2, immer::malloc_heap>>();
 }
 
+TEST_CASE("thread local free list returns memory across threads")
+{
+    using heap = immer::thread_local_free_list_heap<42u, 4, immer::malloc_heap>;
+
+    auto ps = std::vector<void*>{};
+    for (auto i = 0u; i < 3u; ++i) {
+        ps.push_back(heap::allocate(42u));
+        do_stuff_to(ps.back(), 42u);
+    }
+    std::thread{[&] {
+        for (auto p : ps)
+            heap::deallocate(42u, p);
+    }}.join();
+    for (auto i = 0u; i < 3u; ++i) {
+        auto p = heap::allocate(42u);
+        CHECK(std::find(ps.begin(), ps.end(), p) != ps.end());
+        do_stuff_to(p, 42u);
+        heap::deallocate(42u, p);
+    }
+}
+
 TEST_CASE("unsafe free_list")
 {
     test_free_list_heap<
         immer::unsafe_free_list_heap<42u, 2, immer::malloc_heap>>();
 }
+
+TEST_CASE("huge page slabs")
+{
+    using heap = immer::hugepage_slab_heap<>;
+
+    SECTION("basic")
+    {
+        auto p = heap::allocate(42u);
+        do_stuff_to(p, 42u);
+        heap::deallocate(42, p);
+    }
+
+    SECTION("reuse")
+    {
+        auto p = heap::allocate(42u);
+        auto q = heap::allocate(42u);
+        CHECK(p != q);
+        heap::deallocate(42, p);
+        CHECK(heap::allocate(40u) == p);
+        heap::deallocate(40, p);
+        heap::deallocate(42, q);
+    }
+
+    SECTION("big objects")
+    {
+        auto size = std::size_t{3} << 20;
+        auto p    = heap::allocate(size);
+        do_stuff_to(p, size);
+        heap::deallocate(size, p);
+    }
+
+    SECTION("base of free lists")
+    {
+        test_free_list_heap<immer::free_list_heap<42u, 2, heap>>();
+    }
+}
+
+TEST_CASE("size class")
+{
+    using heap =
+        immer::size_class_heap<immer::malloc_heap, 256u, 16u, 1024u, 4u>;
+
+    SECTION("basic")
+    {
+        for (auto size : {1u, 16u, 17u, 100u, 256u, 257u, 1000u}) {
+            auto p = heap::allocate(size);
+            do_stuff_to(p, size);
+            heap::deallocate(size, p);
+        }
+    }
+
+    SECTION("reuse within a class")
+    {
+        auto p = heap::allocate(40u);
+        do_stuff_to(p, 40u);
+        heap::deallocate(40u, p);
+
+        auto u = heap::allocate(33u);
+        do_stuff_to(u, 33u);
+        heap::deallocate(33u, u);
+        CHECK(u == p);
+
+        auto v = heap::allocate(20u);
+        CHECK(v != p);
+        heap::deallocate(20u, v);
+    }
+
+    SECTION("many objects across threads")
+    {
+        auto ps = std::vector<void*>{};
+        for (auto i = 0u; i < 100u; ++i) {
+            auto size = 1 + i * 7 % 256u;
+            ps.push_back(heap::allocate(size));
+            do_stuff_to(ps.back(), size);
+        }
+        std::thread{[&] {
+            for (auto i = 0u; i < 100u; ++i)
+                heap::deallocate(1 + i * 7 % 256u, ps[i]);
+        }}.join();
+        for (auto i = 0u; i < 100u; ++i) {
+            auto size = 1 + i * 7 % 256u;
+            ps[i]     = heap::allocate(size);
+            do_stuff_to(ps[i], size);
+        }
+        for (auto i = 0u; i < 100u; ++i)
+            heap::deallocate(1 + i * 7 % 256u, ps[i]);
+    }
+}
+
+TEST_CASE("stats")
+{
+    struct pooled_tag
+    {};
+    struct system_tag
+    {};
+    using system = immer::stats_heap<immer::malloc_heap, system_tag>;
+    using heap   = immer::stats_heap<
+        immer::with_free_list_node<immer::free_list_heap<42u, 2, system>>,
+        pooled_tag>;
+
+    auto c = immer::heap_stats::size_class(42u);
+    CHECK(c == 6u);
+    CHECK(immer::heap_stats::size_class(0u) == 0u);
+    CHECK(immer::heap_stats::size_class(1u) == 0u);
+    CHECK(immer::heap_stats::size_class(64u) == 6u);
+    CHECK(immer::heap_stats::size_class(65u) == 7u);
+
+    auto p = heap::allocate(42u);
+    auto q = heap::allocate(42u);
+    do_stuff_to(p, 42u);
+    std::thread{[&] { heap::deallocate(42u, q); }}.join();
+    heap::deallocate(42u, p);
+    p = heap::allocate(42u);
+    heap::deallocate(42u, p);
+
+    auto pooled = heap::stats();
+    CHECK(pooled.by_size[c].allocations == 3u);
+    CHECK(pooled.by_size[c].deallocations == 3u);
+    CHECK(pooled.by_size[c].live == 0u);
+    CHECK(pooled.by_size[c].high_water == 2u);
+    CHECK(pooled.total.allocations == 3u);
+
+    auto missed = system::stats();
+    CHECK(missed.total.allocations == 2u);
+    CHECK(missed.total.deallocations == 0u);
+    CHECK(missed.total.live == 2u);
+}
+
+TEST_CASE("adaptive free list")
+{
+    struct system_tag
+    {};
+    using system = immer::stats_heap<immer::malloc_heap, system_tag>;
+    using heap   = immer::adaptive_free_list_heap<42u, system>;
+
+    auto config           = immer::adaptive_free_list_config{};
+    config.min_limit      = 0;
+    config.max_limit      = 64;
+    config.window         = 8;
+    config.grow_miss_rate = 0.25;
+    immer::set_adaptive_free_list_config(config);
+
+    auto ps    = std::vector<void*>(8);
+    auto burst = [&] {
+        for (auto& p : ps) {
+            p = heap::allocate(42u);
+            do_stuff_to(p, 42u);
+        }
+        for (auto p : ps)
+            heap::deallocate(42u, p);
+    };
+
+    // a window of misses grows the limit
+    burst();
+    auto s = heap::stats();
+    CHECK(s.misses == 8u);
+    CHECK(s.limit == 8u);
+    CHECK(s.count == 8u);
+
+    // the next burst is served from the free list
+    burst();
+    s = heap::stats();
+    CHECK(s.hits == 8u);
+    CHECK(s.misses == 8u);
+    CHECK(s.count == 8u);
+
+    // the objects that are not used during a whole window, which
+    // starts when the burst is still going, are released
+    for (auto i = 0; i < 16; ++i) {
+        auto p = heap::allocate(42u);
+        heap::deallocate(42u, p);
+    }
+    s = heap::stats();
+    CHECK(s.released == 7u);
+    CHECK(s.limit == 1u);
+    CHECK(s.count == 1u);
+    CHECK(system::stats().total.live == 1u);
+
+    immer::trim_adaptive_free_lists();
+    s = heap::stats();
+    CHECK(s.released == 8u);
+    CHECK(s.count == 0u);
+    CHECK(s.limit == 0u);
+    CHECK(system::stats().total.live == 0u);
+    CHECK(immer::adaptive_free_lists_stats().hits >= s.hits);
+
+    using policy = immer::adaptive_free_list_heap_policy<immer::malloc_heap>;
+    using pooled = policy::optimized<42u>::type;
+    auto p       = pooled::allocate(42u);
+    do_stuff_to(p, 42u);
+    pooled::deallocate(42u, p);
+    CHECK(pooled::allocate(40u) == p);
+    pooled::deallocate(40u, p);
+
+    immer::set_adaptive_free_list_config({});
+}
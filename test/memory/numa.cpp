@@ -0,0 +1,92 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/heap/malloc_heap.hpp>
+#include <immer/heap/numa_heap.hpp>
+#include <immer/map.hpp>
+#include <immer/vector.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <thread>
+
+TEST_CASE("numa heap returns memory to the pool of its node")
+{
+    using heap = immer::numa_heap<64u, 16u, immer::malloc_heap, 4u>;
+
+    void* p = nullptr;
+    {
+        immer::numa_node_guard guard{1u};
+        p = heap::allocate(42u);
+    }
+    std::thread{[p] {
+        immer::numa_node_guard guard{2u};
+        heap::deallocate(42u, p);
+    }}.join();
+    {
+        immer::numa_node_guard guard{2u};
+        auto q = heap::allocate(42u);
+        CHECK(q != p);
+        heap::deallocate(42u, q);
+    }
+    {
+        immer::numa_node_guard guard{1u};
+        auto q = heap::allocate(42u);
+        CHECK(q == p);
+        heap::deallocate(42u, q);
+    }
+}
+
+TEST_CASE("numa guards nest")
+{
+    using heap = immer::numa_heap<64u, 16u, immer::malloc_heap, 4u>;
+
+    void* p = nullptr;
+    {
+        immer::numa_node_guard outer{3u};
+        {
+            immer::numa_node_guard inner{0u};
+            heap::deallocate(8u, heap::allocate(8u));
+        }
+        p = heap::allocate(8u);
+    }
+    heap::deallocate(8u, p);
+    immer::numa_node_guard guard{3u};
+    CHECK(heap::allocate(8u) == p);
+    heap::deallocate(8u, p);
+}
+
+TEST_CASE("numa clone")
+{
+    using memory =
+        immer::memory_policy<immer::numa_heap_policy<immer::malloc_heap>,
+                             immer::default_refcount_policy,
+                             immer::default_lock_policy>;
+
+    SECTION("vector")
+    {
+        using vector_t = immer::vector<int, memory>;
+        auto v         = vector_t{};
+        for (auto i = 0; i < 1000; ++i)
+            v = v.push_back(i);
+        auto r = immer::numa_clone(v, 1u);
+        CHECK(r == v);
+        CHECK(r.identity() != v.identity());
+    }
+
+    SECTION("map")
+    {
+        using map_t = immer::map<int, int, std::hash<int>, std::equal_to<int>,
+                                 memory>;
+        auto m      = map_t{};
+        for (auto i = 0; i < 1000; ++i)
+            m = std::move(m).set(i, i * 2);
+        auto r = immer::numa_clone(m, 1u);
+        CHECK(r == m);
+    }
+}
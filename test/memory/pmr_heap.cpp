@@ -0,0 +1,158 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/heap/pmr_heap.hpp>
+#include <immer/transience/pmr_transience_policy.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#if IMMER_HAS_CPP17
+
+#include <immer/flex_vector.hpp>
+#include <immer/map.hpp>
+#include <immer/vector.hpp>
+#include <immer/vector_transient.hpp>
+
+#include <cstddef>
+#include <memory_resource>
+#include <thread>
+
+namespace {
+
+using memory_t = immer::memory_policy<immer::heap_policy<immer::pmr_heap<>>,
+                                      immer::refcount_policy,
+                                      immer::default_lock_policy,
+                                      immer::pmr_transience_policy>;
+
+using vector_t = immer::vector<int, memory_t>;
+
+// counts the bytes that are taken from the resource and not given back
+struct counting_resource : std::pmr::memory_resource
+{
+    std::pmr::memory_resource* upstream = std::pmr::new_delete_resource();
+    std::ptrdiff_t live                 = 0;
+    std::size_t allocations             = 0;
+
+    void* do_allocate(std::size_t bytes, std::size_t align) override
+    {
+        live += bytes;
+        ++allocations;
+        return upstream->allocate(bytes, align);
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t align) override
+    {
+        live -= bytes;
+        upstream->deallocate(p, bytes, align);
+    }
+
+    bool do_is_equal(const memory_resource& o) const noexcept override
+    {
+        return this == &o;
+    }
+};
+
+} // namespace
+
+TEST_CASE("containers allocate from the current resource")
+{
+    auto a = counting_resource{};
+    auto b = counting_resource{};
+    {
+        auto v = vector_t{};
+        {
+            auto scope = immer::pmr_scope<>{&a};
+            for (auto i = 0; i < 1000; ++i)
+                v = v.push_back(i);
+            CHECK(a.live > 0);
+
+            auto scope2 = immer::pmr_scope<>{&b};
+            v           = v.push_back(1000);
+            CHECK(b.live > 0);
+        }
+        CHECK(immer::pmr_heap<>::current() == std::pmr::get_default_resource());
+
+        // the nodes go back where they came from
+        auto before = a.allocations;
+        v           = v.take(10).push_back(42);
+        CHECK(a.allocations == before);
+        CHECK(v.size() == 11);
+        CHECK(v[10] == 42);
+    }
+    CHECK(a.live == 0);
+    CHECK(b.live == 0);
+
+    // the nodes can be released from another thread
+    {
+        auto v = vector_t{};
+        {
+            auto scope = immer::pmr_scope<>{&a};
+            for (auto i = 0; i < 100; ++i)
+                v = std::move(v).push_back(i);
+        }
+        std::thread{[v = std::move(v)] {}}.join();
+    }
+    CHECK(a.live == 0);
+}
+
+TEST_CASE("transients keep their resource")
+{
+    auto a = counting_resource{};
+    auto t = [&] {
+        auto scope = immer::pmr_scope<>{&a};
+        return vector_t{}.transient();
+    }();
+    for (auto i = 0; i < 1000; ++i)
+        t.push_back(i);
+    CHECK(a.live > 0);
+
+    // the persistent value shares the tail, that is copied
+    auto v      = t.persistent();
+    auto before = a.allocations;
+    t.push_back(1000);
+    t.push_back(1001);
+    CHECK(a.allocations > before);
+    CHECK(v.size() == 1000);
+    CHECK(t.size() == 1002);
+}
+
+TEST_CASE("request scoped containers in a monotonic buffer")
+{
+    using memory =
+        immer::memory_policy<immer::heap_policy<immer::pmr_heap<struct req>>,
+                             immer::refcount_policy,
+                             immer::default_lock_policy,
+                             immer::pmr_transience_policy>;
+
+    auto upstream = counting_resource{};
+    {
+        auto arena = std::pmr::monotonic_buffer_resource{&upstream};
+        auto scope = immer::pmr_scope<struct req>{&arena};
+
+        auto v = immer::flex_vector<int, memory>{};
+        for (auto i = 0; i < 5000; ++i)
+            v = std::move(v).push_back(i);
+        v = v.drop(100) + v.take(100);
+        auto m =
+            immer::map<int, int, std::hash<int>, std::equal_to<int>, memory>{};
+        for (auto i = 0; i < 1000; ++i)
+            m = std::move(m).set(i, i);
+        CHECK(v.size() == 5000);
+        CHECK(m.size() == 1000);
+        CHECK(upstream.live > 0);
+        CHECK(immer::pmr_heap<>::current() == std::pmr::get_default_resource());
+    }
+    // all at once
+    CHECK(upstream.live == 0);
+}
+
+#else
+
+TEST_CASE("pmr heap needs C++17") {}
+
+#endif
@@ -6,12 +6,15 @@
 // See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
 //
 
+#include <immer/refcount/biased_refcount_policy.hpp>
 #include <immer/refcount/no_refcount_policy.hpp>
 #include <immer/refcount/refcount_policy.hpp>
 #include <immer/refcount/unsafe_refcount_policy.hpp>
 
 #include <catch2/catch_test_macros.hpp>
 
+#include <thread>
+
 TEST_CASE("no refcount has no data")
 {
     static_assert(std::is_empty<immer::no_refcount_policy>{}, "");
@@ -50,3 +53,64 @@ TEST_CASE("thread unsafe refcount")
 {
     test_refcount<immer::unsafe_refcount_policy>();
 }
+
+TEST_CASE("biased refcount")
+{
+    test_refcount<immer::biased_refcount_policy>();
+
+    SECTION("copies dropped in another thread")
+    {
+        immer::biased_refcount_policy elem{};
+        elem.inc();
+        elem.inc();
+        CHECK(!elem.unique());
+        auto released = 0;
+        std::thread{[&] {
+            released += elem.dec();
+            released += elem.dec();
+        }}.join();
+        CHECK(released == 0);
+        CHECK(elem.unique());
+        CHECK(elem.dec());
+    }
+
+    SECTION("copies made in another thread")
+    {
+        immer::biased_refcount_policy elem{};
+        auto released = 0;
+        std::thread{[&] {
+            elem.inc();
+            elem.inc();
+            released += elem.dec();
+        }}.join();
+        CHECK(released == 0);
+        CHECK(!elem.dec());
+        CHECK(elem.dec());
+    }
+
+    SECTION("concurrent copies")
+    {
+        immer::biased_refcount_policy elem{};
+        for (auto i = 0; i < 100; ++i)
+            elem.inc();
+        auto released = 0;
+        auto worker   = std::thread{[&] {
+            for (auto i = 0; i < 1000; ++i) {
+                elem.inc();
+                released += elem.dec();
+            }
+            for (auto i = 0; i < 50; ++i)
+                released += elem.dec();
+        }};
+        for (auto i = 0; i < 1000; ++i) {
+            elem.inc();
+            CHECK(!elem.dec());
+        }
+        for (auto i = 0; i < 50; ++i)
+            CHECK(!elem.dec());
+        worker.join();
+        CHECK(released == 0);
+        CHECK(elem.unique());
+        CHECK(elem.dec());
+    }
+}
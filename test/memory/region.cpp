@@ -0,0 +1,151 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/flex_vector.hpp>
+#include <immer/heap/region_heap.hpp>
+#include <immer/map.hpp>
+#include <immer/vector.hpp>
+#include <immer/vector_transient.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+
+struct test_tag
+{};
+
+using heap_t = immer::region_heap<test_tag, 1 << 14>;
+
+using memory_t = immer::memory_policy<immer::heap_policy<heap_t>,
+                                      immer::no_refcount_policy,
+                                      immer::default_lock_policy,
+                                      immer::gc_transience_policy,
+                                      false>;
+
+using vector_t = immer::vector<int, memory_t>;
+using flex_t   = immer::flex_vector<int, memory_t>;
+using map_t    = immer::
+    map<int, int, std::hash<int>, std::equal_to<int>, memory_t>;
+
+template <typename Vector>
+Vector iota(int first, int last)
+{
+    auto v = Vector{};
+    for (auto i = first; i < last; ++i)
+        v = v.push_back(i);
+    return v;
+}
+
+// allocates nodes of the same sizes as the ones that were freed, so that
+// a node that was freed too soon is overwritten
+void reuse_freed()
+{
+    (void) iota<vector_t>(-1000, 0);
+    (void) iota<flex_t>(-1000, 0);
+}
+
+template <typename Vector>
+bool is_iota(const Vector& v, int first)
+{
+    for (auto i = std::size_t{}; i < v.size(); ++i)
+        if (v[i] != first + int(i))
+            return false;
+    return true;
+}
+
+} // namespace
+
+TEST_CASE("collecting frees what the roots do not reach")
+{
+    auto v  = iota<vector_t>(0, 1000);
+    auto id = heap_t::add_root(v);
+    heap_t::collect();
+
+    // the versions in between are garbage
+    (void) iota<vector_t>(0, 1000);
+    CHECK(heap_t::collect() > 0);
+    reuse_freed();
+    CHECK(v.size() == 1000);
+    CHECK(is_iota(v, 0));
+
+    SECTION("a removed root is freed")
+    {
+        heap_t::remove_root(id);
+        CHECK(heap_t::collect() > 0);
+        CHECK(heap_t::collect() == 0);
+    }
+
+    SECTION("a collection that finds no garbage frees nothing")
+    {
+        heap_t::collect();
+        CHECK(heap_t::collect() == 0);
+        heap_t::remove_root(id);
+    }
+}
+
+TEST_CASE("relaxed nodes and hash tries are traced")
+{
+    // the containers that are not registered must not outlive the
+    // collection, not even to be destroyed
+    auto w = [] {
+        auto v = iota<flex_t>(0, 1000);
+        return v.drop(3) + v.take(500);
+    }();
+    auto m = map_t{};
+    for (auto i = 0; i < 1000; ++i)
+        m = m.set(i, i * 2);
+    auto ids = {heap_t::add_root(w), heap_t::add_root(m)};
+
+    CHECK(heap_t::collect() > 0);
+    reuse_freed();
+    for (auto i = 0; i < 1000; ++i)
+        (void) m.set(i, -1);
+
+    CHECK(w.size() == 1497);
+    CHECK(is_iota(w.take(997), 3));
+    CHECK(is_iota(w.drop(997), 0));
+    CHECK(m.size() == 1000);
+    for (auto i = 0; i < 1000; ++i)
+        CHECK(m[i] == i * 2);
+
+    for (auto id : ids)
+        heap_t::remove_root(id);
+    heap_t::collect();
+}
+
+TEST_CASE("collecting in steps")
+{
+    auto ids = std::vector<std::size_t>{};
+    auto vs  = std::vector<vector_t>{};
+    for (auto i = 0; i < 8; ++i) {
+        vs.push_back(iota<vector_t>(i, i + 300));
+        ids.push_back(heap_t::add_root(vs.back()));
+    }
+
+    auto steps = 0;
+    while (!heap_t::collect_step(1)) {
+        ++steps;
+        // containers made during the collection from registered ones
+        auto t = vs[steps % 8].transient();
+        t.push_back(42);
+        vs.push_back(t.persistent());
+    }
+    CHECK(steps >= 8);
+
+    // those made during the collection were kept
+    reuse_freed();
+    for (auto i = std::size_t{8}; i < vs.size(); ++i) {
+        CHECK(vs[i].size() == 301);
+        CHECK(vs[i].back() == 42);
+        CHECK(is_iota(vs[i].take(300), int((i - 7) % 8)));
+    }
+
+    for (auto id : ids)
+        heap_t::remove_root(id);
+    heap_t::collect();
+}
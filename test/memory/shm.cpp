@@ -0,0 +1,95 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/flex_vector.hpp>
+#include <immer/heap/shm_heap.hpp>
+#include <immer/map.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+using map_t  = immer::map<int,
+                         int,
+                         std::hash<int>,
+                         std::equal_to<int>,
+                         immer::shm_memory_policy>;
+using flex_t = immer::flex_vector<int, immer::shm_memory_policy>;
+
+// runs in another process, that only shares the segment with the test
+int reader(const std::string& name, int ready)
+{
+    auto c = char{};
+    if (::read(ready, &c, 1) != 1)
+        return 1;
+    auto segment = immer::shm_segment::open(name);
+    auto m       = segment.load<map_t>(0);
+    auto v       = segment.load<flex_t>(1);
+    if (m.size() != 1000 || m[500] != 1000 || v.size() != 100 || v[7] != 7)
+        return 2;
+    segment.publish(m.set(-1, 1), 2);
+    segment.publish(v.push_front(-1) + v, 3);
+    return 0;
+}
+
+} // namespace
+
+// the segment stays attached until the end, since the empty nodes of
+// the containers are allocated in it, thus there is only one test
+TEST_CASE("containers shared across processes")
+{
+    auto name = "/immer-test-" + std::to_string(::getpid());
+    int fds[2];
+    REQUIRE(::pipe(fds) == 0);
+    auto pid = ::fork();
+    REQUIRE(pid >= 0);
+    if (pid == 0)
+        ::_exit(reader(name, fds[0]));
+
+    static auto segment = immer::shm_segment::create(name, 16 << 20);
+    {
+        auto m = map_t{};
+        auto v = flex_t{};
+        for (auto i = 0; i < 1000; ++i)
+            m = m.set(i, i * 2);
+        for (auto i = 0; i < 100; ++i)
+            v = v.push_back(i);
+        segment.publish(m, 0);
+        segment.publish(v, 1);
+    }
+    REQUIRE(::write(fds[1], "x", 1) == 1);
+    auto status = 0;
+    REQUIRE(::waitpid(pid, &status, 0) == pid);
+    immer::shm_segment::remove(name);
+    CHECK(WIFEXITED(status));
+    CHECK(WEXITSTATUS(status) == 0);
+
+    auto m = segment.load<map_t>(2);
+    CHECK(m.size() == 1001);
+    CHECK(m[-1] == 1);
+    CHECK(m.erase(-1) == segment.load<map_t>(0));
+    auto v = segment.load<flex_t>(3);
+    CHECK(v.size() == 201);
+    CHECK(v[0] == -1);
+    CHECK(v[101] == 0);
+
+    // the nodes freed when replacing a version are reused
+    auto used = segment.used();
+    for (auto i = 0; i < 10; ++i)
+        segment.publish(m.set(i, 0), 4);
+    CHECK(segment.used() - used < 10 * 1024);
+
+    CHECK_THROWS_AS(segment.load<map_t>(5), immer::shm_error);
+    CHECK_THROWS_AS(segment.load<map_t>(16), std::out_of_range);
+    CHECK_THROWS_AS(immer::shm_segment::open(name), immer::shm_error);
+}
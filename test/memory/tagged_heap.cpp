@@ -0,0 +1,88 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/heap/tagged_heap.hpp>
+#include <immer/map.hpp>
+#include <immer/vector.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace {
+
+struct sessions_tag
+{
+    static const char* name() { return "sessions"; }
+};
+
+struct documents_tag
+{
+    static const char* name() { return "documents"; }
+};
+
+struct unnamed_tag
+{};
+
+using sessions_t = immer::map<int,
+                              std::string,
+                              std::hash<int>,
+                              std::equal_to<int>,
+                              immer::tagged_memory_policy<sessions_tag>>;
+
+using documents_t =
+    immer::vector<int, immer::tagged_memory_policy<documents_tag>>;
+
+} // namespace
+
+TEST_CASE("tagged heap attributes memory to tags")
+{
+    CHECK(immer::memory_of<sessions_tag>().live_bytes == 0);
+
+    auto sessions = sessions_t{};
+    for (auto i = 0; i < 1000; ++i)
+        sessions = std::move(sessions).set(i, std::to_string(i));
+
+    auto docs = documents_t{};
+    for (auto i = 0; i < 100000; ++i)
+        docs = std::move(docs).push_back(i);
+
+    auto s = immer::memory_of<sessions_tag>();
+    auto d = immer::memory_of<documents_tag>();
+    CHECK(std::strcmp(s.tag, "sessions") == 0);
+    CHECK(s.live_objects > 0);
+    CHECK(s.live_bytes > 1000 * sizeof(std::pair<int, std::string>));
+    CHECK(s.high_water_bytes >= s.live_bytes);
+    CHECK(s.allocations >= s.live_objects);
+    CHECK(d.live_bytes > 100000 * sizeof(int));
+
+    auto all = immer::memory_by_tag();
+    auto pos = [&](const char* name) {
+        return std::find_if(all.begin(), all.end(), [&](auto& m) {
+            return std::strcmp(m.tag, name) == 0;
+        });
+    };
+    REQUIRE(pos("sessions") != all.end());
+    REQUIRE(pos("documents") != all.end());
+    CHECK(pos("documents") < pos("sessions"));
+
+    docs         = {};
+    auto emptied = immer::memory_of<documents_tag>();
+    CHECK(emptied.live_bytes == 0);
+    CHECK(emptied.live_objects == 0);
+    CHECK(emptied.high_water_bytes == d.high_water_bytes);
+
+    using heap_t = immer::tagged_heap<immer::cpp_heap, unnamed_tag>;
+    auto p       = heap_t::allocate(42u);
+    CHECK(std::strcmp(immer::memory_of<unnamed_tag>().tag, "unnamed") == 0);
+    CHECK(immer::memory_of<unnamed_tag>().live_bytes == 42u);
+    heap_t::deallocate(42u, p);
+    CHECK(immer::memory_of<unnamed_tag>().live_bytes == 0u);
+}
@@ -0,0 +1,148 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/flex_vector.hpp>
+#include <immer/map.hpp>
+#include <immer/memory_stats.hpp>
+#include <immer/set.hpp>
+#include <immer/table.hpp>
+#include <immer/vector.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+
+struct row
+{
+    int id;
+    int value;
+};
+
+} // namespace
+
+TEST_CASE("vector")
+{
+    auto v = immer::vector<int>{};
+    for (auto i = 0; i < 10000; ++i)
+        v = std::move(v).push_back(i);
+    auto s = immer::memory_stats(v);
+
+    CHECK(s.values == v.size());
+    CHECK(s.relaxed_nodes == 0);
+    CHECK(s.relaxed_ratio() == 0);
+    CHECK(s.collision_nodes == 0);
+    CHECK(s.depth == 3);
+    CHECK(s.shared_nodes == 0);
+    CHECK(s.bytes >= v.size() * sizeof(int));
+    // all the leaves but the tail are full
+    CHECK(s.fill_factor() > 0.9);
+    CHECK(s.fill_factor() <= 1);
+
+    SECTION("empty")
+    {
+        auto e = immer::memory_stats(immer::vector<int>{});
+        CHECK(e.values == 0);
+        CHECK(e.leaf_nodes == 1);
+    }
+}
+
+TEST_CASE("flex_vector")
+{
+    auto v = immer::flex_vector<int>{};
+    for (auto i = 0; i < 10000; ++i)
+        v = std::move(v).push_back(i);
+    auto w = v.drop(3) + v;
+
+    auto s = immer::memory_stats(w);
+    CHECK(s.values == w.size());
+    CHECK(s.relaxed_nodes > 0);
+    CHECK(s.relaxed_ratio() > 0);
+    CHECK(s.relaxed_ratio() <= 1);
+
+    SECTION("sharing with the originals")
+    {
+        auto alone = immer::memory_stats(v).bytes +
+                     immer::memory_stats(w).bytes;
+        auto both  = immer::shared_memory_stats(v, w);
+        CHECK(both.bytes < alone);
+        CHECK(both.shared_nodes > 0);
+        // the elements of `w` are mostly in the leaves of `v`
+        CHECK(both.values < v.size() + w.size() / 4);
+    }
+
+    SECTION("sharing within a container")
+    {
+        // both halves of `w` have the leaves of `v`
+        auto once = immer::shared_memory_stats(w);
+        CHECK(once.bytes < s.bytes);
+        CHECK(once.shared_nodes > 0);
+        CHECK(once.values < w.size());
+    }
+
+    SECTION("a container added twice is only counted once")
+    {
+        auto once  = immer::shared_memory_stats(w);
+        auto twice = immer::shared_memory_stats(w, w);
+        CHECK(twice.bytes == once.bytes);
+        CHECK(twice.nodes() == once.nodes());
+        // the root and the tail
+        CHECK(twice.shared_nodes == once.shared_nodes + 2);
+    }
+}
+
+TEST_CASE("map and set")
+{
+    auto m = immer::map<int, int>{};
+    auto t = immer::set<int>{};
+    for (auto i = 0; i < 10000; ++i) {
+        m = std::move(m).set(i, i);
+        t = std::move(t).insert(i);
+    }
+
+    auto s = immer::memory_stats(m);
+    CHECK(s.values == m.size());
+    CHECK(s.leaf_nodes == 0);
+    CHECK(s.relaxed_nodes == 0);
+    CHECK(s.inner_nodes > 0);
+    CHECK(s.depth >= 3);
+    CHECK(s.bytes >= m.size() * sizeof(std::pair<int, int>));
+    CHECK(immer::memory_stats(t).values == t.size());
+
+    SECTION("versions share")
+    {
+        auto m2 = m.set(5, 42);
+        auto c  = immer::memory_stats_collector{};
+        c.add(m);
+        auto before = c.usage();
+        c.add(m2);
+        auto after = c.usage();
+        CHECK(after.inner_nodes - before.inner_nodes <= before.depth);
+        CHECK(after.shared_nodes > 0);
+        CHECK(after.bytes < 2 * before.bytes);
+    }
+}
+
+TEST_CASE("table")
+{
+    auto t = immer::table<row>{};
+    for (auto i = 0; i < 1000; ++i)
+        t = std::move(t).insert({i, i});
+    auto s = immer::memory_stats(t);
+    CHECK(s.values == t.size());
+    CHECK(s.bytes >= t.size() * sizeof(row));
+}
+
+TEST_CASE("mixing containers")
+{
+    auto v = immer::vector<int>{1, 2, 3};
+    auto m = immer::map<int, int>{}.set(1, 2);
+    auto s = immer::shared_memory_stats(v, m);
+    CHECK(s.values == 4);
+    CHECK(s.leaf_nodes >= 1);
+    CHECK(s.inner_nodes >= 2);
+}
@@ -0,0 +1,265 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/flex_vector.hpp>
+#include <immer/map.hpp>
+#include <immer/merkle_cache.hpp>
+#include <immer/set.hpp>
+#include <immer/vector.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+
+namespace {
+
+using vector_t = immer::vector<int, immer::default_memory_policy, 3, 2>;
+using flex_t   = immer::flex_vector<int, immer::default_memory_policy, 3, 2>;
+using map_t    = immer::map<int, int>;
+
+struct colliding_hash
+{
+    std::size_t operator()(int x) const { return x % 3; }
+};
+
+using collision_set_t = immer::set<int, colliding_hash>;
+
+// walks down both containers through the subtrees whose hashes
+// differ, and returns how many of them it found, leaves included
+template <typename Cache, typename C>
+std::size_t count_diverging(Cache& cache,
+                            const C& a,
+                            const C& b,
+                            typename Cache::path_t path = {})
+{
+    auto x = cache.children(a, path);
+    auto y = cache.children(b, path);
+    if (x.size() != y.size())
+        return 1;
+    auto count = std::size_t{};
+    for (auto i = std::size_t{}; i < x.size(); ++i) {
+        if (x[i] != y[i]) {
+            path.push_back(static_cast<std::uint32_t>(i));
+            count += 1 + count_diverging(cache, a, b, path);
+            path.pop_back();
+        }
+    }
+    return count;
+}
+
+} // namespace
+
+TEST_CASE("merkle cache over vector")
+{
+    auto v = vector_t{};
+    for (auto i = 0; i < 1000; ++i)
+        v = std::move(v).push_back(i);
+    auto cache = immer::merkle_cache<vector_t>{};
+
+    auto h = cache.hash(v);
+    CHECK(cache.size() > 0);
+    CHECK(cache.hash(v) == h);
+    CHECK(cache.hash(vector_t{}) != h);
+    CHECK(immer::merkle_cache<vector_t>{}.hash({v.begin(), v.end()}) == h);
+
+    SECTION("updates only rehash the new nodes")
+    {
+        auto size = cache.size();
+        auto v2   = v.set(500, 0);
+        CHECK(cache.hash(v2) != h);
+        CHECK(cache.size() == size + 3);
+        CHECK(cache.hash(v2.set(500, 500)) == h);
+    }
+
+    SECTION("diverging subtrees")
+    {
+        auto v2 = v.set(500, 0);
+        // the three inner nodes and the leaf on the path to the change
+        CHECK(count_diverging(cache, v, v2) == 4);
+        CHECK(count_diverging(cache, v, v) == 0);
+        CHECK(cache.children(v, {}).size() == 2);
+        CHECK(cache.children(v, {1}).empty());
+        CHECK_THROWS_AS(cache.children(v, {2}), std::out_of_range);
+        CHECK_THROWS_AS(cache.children(v, {0, 100}), std::out_of_range);
+    }
+
+    SECTION("trim")
+    {
+        {
+            auto v2 = v.set(500, 0);
+            cache.hash(v2);
+        }
+        auto size = cache.size();
+        cache.trim();
+        CHECK(cache.size() == size - 3);
+        cache.clear();
+        CHECK(cache.size() == 0);
+        CHECK(cache.hash(v) == h);
+    }
+}
+
+TEST_CASE("merkle cache over flex vector")
+{
+    auto v = flex_t{};
+    for (auto i = 0; i < 1000; ++i)
+        v = std::move(v).push_back(i);
+    auto cache = immer::merkle_cache<flex_t>{};
+    auto h     = cache.hash(v);
+    auto v2    = v.take(500) + v.drop(500);
+    CHECK(cache.hash(v2.take(500)) == cache.hash(v.take(500)));
+    CHECK(cache.hash(v2.set(3, 0)) != cache.hash(v2));
+    CHECK(cache.hash(v.push_back(1).take(1000)) == h);
+}
+
+TEST_CASE("merkle cache over map")
+{
+    auto m = map_t{};
+    for (auto i = 0; i < 1000; ++i)
+        m = std::move(m).set(i, i);
+    auto cache = immer::merkle_cache<map_t>{};
+
+    auto h = cache.hash(m);
+    CHECK(cache.hash(m.set(3, 4)) != h);
+    CHECK(cache.hash(m.set(3, 4).set(3, 3)) == h);
+    CHECK(cache.hash(m.set(2000, 0).erase(2000)) == h);
+
+    // maps with the same contents hash the same however they were built
+    auto r = map_t{};
+    for (auto i = 999; i >= 0; --i)
+        r = std::move(r).set(i, i);
+    CHECK(cache.hash(r) == h);
+
+    auto m2 = m.set(500, 0);
+    CHECK(count_diverging(cache, m, m2) > 0);
+    CHECK(count_diverging(cache, m, m2) <= 3);
+    CHECK(count_diverging(cache, m, r) == 0);
+    CHECK(cache.children(m, {}).size() == 1);
+    CHECK_THROWS_AS(cache.children(m, {1}), std::out_of_range);
+}
+
+TEST_CASE("merkle cache over collisions")
+{
+    auto a = collision_set_t{};
+    auto b = collision_set_t{};
+    for (auto i = 0; i < 30; ++i) {
+        a = a.insert(i);
+        b = b.insert(29 - i);
+    }
+    auto cache = immer::merkle_cache<collision_set_t>{};
+    CHECK(cache.hash(a) == cache.hash(b));
+    CHECK(cache.hash(a.erase(7)) != cache.hash(b));
+    CHECK(count_diverging(cache, a, b) == 0);
+}
+
+namespace {
+
+struct counting_equal
+{
+    static std::size_t& calls()
+    {
+        static auto n = std::size_t{};
+        return n;
+    }
+
+    template <typename T>
+    bool operator()(const T& a, const T& b) const
+    {
+        ++calls();
+        return a == b;
+    }
+};
+
+} // namespace
+
+TEST_CASE("merkle cache equality over vector")
+{
+    using cache_t =
+        immer::merkle_cache<vector_t, immer::merkle_hash<int>, counting_equal>;
+    auto v = vector_t{};
+    for (auto i = 0; i < 1000; ++i)
+        v = std::move(v).push_back(i);
+    auto w     = vector_t{v.begin(), v.end()};
+    auto cache = cache_t{};
+
+    counting_equal::calls() = 0;
+    CHECK(cache.equal(v, v));
+    CHECK(counting_equal::calls() == 0);
+    CHECK(cache.equal(v, w));
+    CHECK(!cache.equal(v, w.set(500, 0)));
+    CHECK(!cache.equal(v, w.push_back(0)));
+    CHECK(!cache.equal(v, vector_t{}));
+
+    SECTION("the pairs found equal are remembered")
+    {
+        counting_equal::calls() = 0;
+        CHECK(cache.equal(v, w));
+        CHECK(counting_equal::calls() < 50);
+        // only the path to the change is compared again
+        counting_equal::calls() = 0;
+        CHECK(cache.equal(v.set(10, 3), w.set(10, 3)));
+        CHECK(counting_equal::calls() < 50);
+    }
+
+    SECTION("trim forgets the pairs with released nodes")
+    {
+        {
+            auto x = w.set(500, 0);
+            CHECK(cache.equal(x, x.set(500, 0)));
+        }
+        cache.trim();
+        CHECK(cache.equal(v, w));
+        cache.clear();
+        CHECK(cache.size() == 0);
+        CHECK(cache.equal(v, w));
+    }
+}
+
+TEST_CASE("merkle cache equality over flex vector")
+{
+    auto v = flex_t{};
+    for (auto i = 0; i < 1000; ++i)
+        v = std::move(v).push_back(i);
+    auto cache = immer::merkle_cache<flex_t>{};
+    auto w     = v.take(300) + v.drop(300);
+    auto x     = v.take(7) + v.drop(7);
+
+    CHECK(cache.equal(v, w));
+    CHECK(cache.equal(w, x));
+    CHECK(cache.equal(w.set(600, 1), x.set(600, 1)));
+    CHECK(!cache.equal(w.set(600, 1), x));
+    CHECK(!cache.equal(v, v.take(999)));
+    CHECK(!cache.equal(x, x.set(999, 0)));
+    CHECK(cache.equal(x, x.set(999, 0).set(999, 999)));
+}
+
+TEST_CASE("merkle cache equality over map")
+{
+    auto m = map_t{};
+    for (auto i = 0; i < 1000; ++i)
+        m = std::move(m).set(i, i);
+    auto n = map_t{};
+    for (auto i = 1000; i-- > 0;)
+        n = std::move(n).set(i, i);
+    auto cache = immer::merkle_cache<map_t>{};
+
+    CHECK(cache.equal(m, n));
+    CHECK(cache.equal(m, n.set(3, 4).set(3, 3)));
+    CHECK(!cache.equal(m, n.set(3, 4)));
+    CHECK(!cache.equal(m, n.erase(3)));
+    CHECK(!cache.equal(m.set(-1, 0), n.set(-2, 0)));
+
+    auto s = collision_set_t{};
+    auto t = collision_set_t{};
+    for (auto i = 0; i < 10; ++i) {
+        s = s.insert(i);
+        t = t.insert(9 - i);
+    }
+    auto set_cache = immer::merkle_cache<collision_set_t>{};
+    CHECK(set_cache.equal(s, t));
+    CHECK(!set_cache.equal(s, t.erase(4).insert(10)));
+}
@@ -0,0 +1,101 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/multimap.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace {
+
+template <typename Group>
+std::vector<int> sorted_values(const Group& g)
+{
+    auto r = std::vector<int>{};
+    g.for_each_chunk([&](auto f, auto l) { r.insert(r.end(), f, l); });
+    std::sort(r.begin(), r.end());
+    return r;
+}
+
+} // namespace
+
+TEST_CASE("multimap basic")
+{
+    using mm_t = immer::multimap<std::string, int>;
+    auto m0    = mm_t{};
+    auto m1 =
+        m0.insert("a", 1).insert("a", 2).insert("b", 3).insert("a", 1);
+    CHECK(m0.empty());
+    CHECK(m1.size() == 3);
+    CHECK(m1.key_count() == 2);
+    CHECK(m1.count("a") == 2);
+    CHECK(m1.count("z") == 0);
+    CHECK(m1.contains("a", 2));
+    CHECK(!m1.contains("b", 2));
+    CHECK(m1.equal_range("a").is_small());
+    CHECK(sorted_values(m1.equal_range("a")) == (std::vector<int>{1, 2}));
+    CHECK(m1.equal_range("z").empty());
+
+    auto m2 = m1.erase("a", 1);
+    CHECK(m2.size() == 2);
+    CHECK(sorted_values(m2.equal_range("a")) == (std::vector<int>{2}));
+    CHECK(m1.count("a") == 2);
+    CHECK(m2.erase("a", 2).count("a") == 0);
+    CHECK(m2.erase("a", 2).key_count() == 1);
+    CHECK(m1.erase("a").size() == 1);
+    CHECK(m1.erase("a", 42) == m1);
+}
+
+TEST_CASE("multimap promotion")
+{
+    using mm_t = immer::multimap<int, int, 2>;
+    auto m     = mm_t{};
+    for (auto i = 0; i < 100; ++i)
+        m = m.insert(i % 3, i);
+    CHECK(m.size() == 100);
+    CHECK(!m.equal_range(0).is_small());
+    auto expected = std::vector<int>{};
+    for (auto i = 0; i < 100; i += 3)
+        expected.push_back(i);
+    CHECK(sorted_values(m.equal_range(0)) == expected);
+
+    auto n = 0u;
+    for (auto&& x : m.equal_range(1)) {
+        CHECK(x % 3 == 1);
+        ++n;
+    }
+    CHECK(n == m.count(1));
+
+    // it goes back inline when it shrinks
+    for (auto i = 3; i < 100; i += 3)
+        m = m.erase(0, i);
+    CHECK(m.count(0) == 1);
+    CHECK(m.equal_range(0).is_small());
+    CHECK(sorted_values(m.equal_range(0)) == (std::vector<int>{0}));
+    CHECK(m.key_count() == 3);
+}
+
+TEST_CASE("multimap values with resources")
+{
+    using mm_t = immer::multimap<int, std::string, 3>;
+    auto value = [](int i) {
+        return std::string(40, char('a' + i % 26)) + std::to_string(i);
+    };
+    auto m = mm_t{};
+    for (auto i = 0; i < 50; ++i)
+        m = m.insert(i % 5, value(i));
+    auto copy = m;
+    for (auto i = 0; i < 50; i += 2)
+        m = m.erase(i % 5, value(i));
+    CHECK(m.size() == 25);
+    CHECK(copy.size() == 50);
+    CHECK(m != copy);
+}
@@ -0,0 +1,103 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/ordered_insertion_map.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+template <typename Map>
+std::vector<typename Map::key_type> keys_of(const Map& m)
+{
+    auto r = std::vector<typename Map::key_type>{};
+    for (auto& kv : m)
+        r.push_back(kv.first);
+    return r;
+}
+
+} // namespace
+
+TEST_CASE("ordered insertion map keeps the insertion order")
+{
+    using map_t = immer::ordered_insertion_map<std::string, int>;
+
+    auto m = map_t{}.set("b", 1).set("a", 2).set("c", 3);
+    CHECK(m.size() == 3);
+    CHECK(keys_of(m) == std::vector<std::string>{"b", "a", "c"});
+    CHECK(m["a"] == 2);
+    CHECK(m["z"] == 0);
+    CHECK(m.count("c") == 1);
+    CHECK(m.find("z") == nullptr);
+    CHECK_THROWS_AS(m.at("z"), std::out_of_range);
+
+    // updating a key keeps its place
+    auto n = m.set("b", 10).update("a", [](int x) { return x + 1; });
+    CHECK(keys_of(n) == std::vector<std::string>{"b", "a", "c"});
+    CHECK(n["b"] == 10);
+    CHECK(n["a"] == 3);
+    CHECK(m["b"] == 1);
+
+    // erasing and inserting again puts it at the end
+    auto e = n.erase("b").set("b", 4).erase("c").erase("x");
+    CHECK(keys_of(e) == std::vector<std::string>{"a", "b"});
+    CHECK(e.size() == 2);
+    CHECK(keys_of(n) == std::vector<std::string>{"b", "a", "c"});
+
+    CHECK(map_t{{"x", 1}, {"y", 2}, {"x", 3}} ==
+          map_t{}.set("x", 3).set("y", 2));
+    CHECK(map_t{{"x", 1}, {"y", 2}} != map_t{{"y", 2}, {"x", 1}});
+}
+
+TEST_CASE("ordered insertion map against a reference")
+{
+    using map_t = immer::ordered_insertion_map<int, int>;
+
+    auto gen  = std::mt19937{42};
+    auto m    = map_t{};
+    auto ref  = std::vector<std::pair<int, int>>{};
+    auto find = [&](int k) {
+        return std::find_if(
+            ref.begin(), ref.end(), [&](auto& kv) { return kv.first == k; });
+    };
+    for (auto i = 0; i < 5000; ++i) {
+        auto k = static_cast<int>(gen() % 300);
+        if (gen() % 2) {
+            m       = std::move(m).set(k, i);
+            auto it = find(k);
+            if (it != ref.end())
+                it->second = i;
+            else
+                ref.emplace_back(k, i);
+        } else {
+            m       = std::move(m).erase(k);
+            auto it = find(k);
+            if (it != ref.end())
+                ref.erase(it);
+        }
+        REQUIRE(m.size() == ref.size());
+    }
+    CHECK(std::equal(m.begin(), m.end(), ref.begin(), ref.end()));
+    for (auto& kv : ref)
+        CHECK(m[kv.first] == kv.second);
+
+    // erasing almost everything compacts the log on the way
+    auto old = m;
+    for (auto& kv : ref)
+        if (kv.first % 10)
+            m = std::move(m).erase(kv.first);
+    CHECK(std::all_of(
+        m.begin(), m.end(), [](auto& kv) { return kv.first % 10 == 0; }));
+    CHECK(old.size() == ref.size());
+    CHECK(std::equal(old.begin(), old.end(), ref.begin(), ref.end()));
+}
@@ -0,0 +1,131 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/ordered_map.hpp>
+#include <immer/ordered_map_transient.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+template <typename M, typename R>
+bool same(const M& m, const R& r)
+{
+    return m.size() == r.size() &&
+           std::equal(m.begin(), m.end(), r.begin(), [](auto& a, auto& b) {
+               return a.first == b.first && a.second == b.second;
+           });
+}
+
+} // namespace
+
+TEST_CASE("instantiation")
+{
+    auto m = immer::ordered_map<std::string, int>{};
+    CHECK(m.size() == 0);
+    CHECK(m.empty());
+    CHECK(m.find("foo") == nullptr);
+    CHECK(m["foo"] == 0);
+    CHECK_THROWS_AS(m.at("foo"), std::out_of_range);
+
+    auto m2 = immer::ordered_map<std::string, int>{{"b", 2}, {"a", 1}};
+    CHECK(m2.size() == 2);
+    CHECK(m2.begin()->first == "a");
+    CHECK(m2.at("b") == 2);
+}
+
+TEST_CASE("set, update and erase")
+{
+    using map_t = immer::ordered_map<int,
+                                     std::string,
+                                     std::less<int>,
+                                     immer::default_memory_policy,
+                                     5>;
+    auto rng = std::mt19937{42};
+    auto m   = map_t{};
+    auto r   = std::map<int, std::string>{};
+    for (auto i = 0; i < 5000; ++i) {
+        auto k = int(rng() % 1000);
+        switch (rng() % 4) {
+        case 0:
+            m = m.set(k, std::to_string(i));
+            r[k] = std::to_string(i);
+            break;
+        case 1:
+            m = std::move(m).update(k, [](std::string x) { return x + "!"; });
+            r[k] += "!";
+            break;
+        case 2:
+            m = m.insert({k, "x"});
+            r[k] = "x";
+            break;
+        default:
+            m = m.erase(k);
+            r.erase(k);
+            break;
+        }
+    }
+    CHECK(same(m, r));
+    for (auto i = 0; i < 1000; ++i) {
+        auto it = r.find(i);
+        CHECK(m.count(i) == (it != r.end() ? 1u : 0u));
+        if (it != r.end())
+            CHECK(*m.find(i) == it->second);
+    }
+    CHECK(m.lower_bound(500)->first == r.lower_bound(500)->first);
+    CHECK(m.upper_bound(500)->first == r.upper_bound(500)->first);
+}
+
+TEST_CASE("split and join")
+{
+    auto m = immer::ordered_map<int, int>{};
+    for (auto i = 0; i < 5000; ++i)
+        m = std::move(m).set(i * 2, i);
+
+    auto parts = m.split(1001);
+    CHECK(parts.first.size() == 501);
+    CHECK(parts.second.begin()->first == 1002);
+    CHECK(parts.first.join(parts.second) == m);
+
+    auto r = m.range(100, 200);
+    CHECK(r.size() == 50);
+    CHECK(r.begin()->first == 100);
+    CHECK(r.rbegin()->first == 198);
+    CHECK(r[150] == 75);
+    CHECK(r.count(200) == 0);
+}
+
+TEST_CASE("transient")
+{
+    auto m = immer::ordered_map<int, int>{};
+    for (auto i = 0; i < 100; ++i)
+        m = m.set(i, i);
+
+    auto t = m.transient();
+    for (auto i = 0; i < 1000; ++i)
+        t.update(i % 200, [](int x) { return x + 1; });
+    t.set(-1, -1);
+    t.insert({-2, -2});
+    t.erase(0);
+    CHECK(t.size() == 201);
+    CHECK(t.count(0) == 0);
+    CHECK(*t.find(199) == 5);
+    CHECK(t.lower_bound(-10)->first == -2);
+
+    auto p = t.persistent();
+    t.erase(199);
+    CHECK(p.count(199) == 1);
+    CHECK(p[1] == 6);
+    CHECK(m.size() == 100);
+    CHECK(m[1] == 1);
+}
@@ -0,0 +1,229 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/algorithm.hpp>
+#include <immer/ordered_set.hpp>
+#include <immer/ordered_set_transient.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+template <typename T, immer::detail::btree::count_t B>
+using set_b =
+    immer::ordered_set<T, std::less<T>, immer::default_memory_policy, B>;
+
+template <typename S, typename R>
+bool same(const S& s, const R& r)
+{
+    return s.size() == r.size() && std::equal(s.begin(), s.end(), r.begin());
+}
+
+template <typename T>
+std::set<T> slice(const std::set<T>& r, const T& first, const T& last)
+{
+    return {r.lower_bound(first), r.lower_bound(last)};
+}
+
+template <typename Set, typename Gen>
+void check_against_std(Gen gen)
+{
+    using T = typename Set::value_type;
+    auto rng  = std::mt19937{42};
+    auto s    = Set{};
+    auto r    = std::set<T>{};
+    auto hist = std::vector<std::pair<Set, std::set<T>>>{};
+    for (auto i = 0; i < 5000; ++i) {
+        auto x = gen(rng() % 2000);
+        switch (rng() % 8) {
+        case 0:
+        case 1:
+        case 2:
+        case 3:
+            s = s.insert(x);
+            r.insert(x);
+            break;
+        case 4:
+        case 5:
+            s = s.erase(x);
+            r.erase(x);
+            break;
+        case 6: {
+            s = std::move(s).insert(x);
+            r.insert(x);
+            break;
+        }
+        default: {
+            auto y     = gen(rng() % 2000);
+            auto parts = s.split(x);
+            CHECK(same(parts.first, slice(r, *r.begin(), x)));
+            CHECK(parts.first.size() + parts.second.size() == r.size());
+            CHECK(parts.first.join(parts.second) == s);
+            auto lo = std::min(x, y);
+            auto hi = std::max(x, y);
+            CHECK(same(s.range(lo, hi), slice(r, lo, hi)));
+            auto mid = s.range(lo, hi);
+            auto lhs = s.split(lo).first;
+            auto rhs = s.split(hi).second;
+            CHECK(lhs.join(mid).join(rhs) == s);
+            CHECK(lhs.join(mid.join(rhs)) == s);
+            break;
+        }
+        }
+        CHECK(s.lower_bound(x).index() ==
+              std::size_t(std::distance(r.begin(), r.lower_bound(x))));
+        CHECK(s.upper_bound(x).index() ==
+              std::size_t(std::distance(r.begin(), r.upper_bound(x))));
+        if (i % 101 == 0)
+            hist.push_back({s, r});
+    }
+    CHECK(same(s, r));
+    for (auto& h : hist)
+        CHECK(same(h.first, h.second));
+}
+
+} // namespace
+
+TEST_CASE("instantiation")
+{
+    auto s = immer::ordered_set<int>{};
+    CHECK(s.size() == 0);
+    CHECK(s.empty());
+    CHECK(s.begin() == s.end());
+    CHECK(s.count(42) == 0);
+    CHECK(s.find(42) == nullptr);
+
+    auto s2 = immer::ordered_set<int>{3, 1, 2, 1};
+    CHECK(s2.size() == 3);
+    CHECK(same(s2, std::set<int>{1, 2, 3}));
+}
+
+TEST_CASE("insert and erase keep the order")
+{
+    auto s = immer::ordered_set<int>{};
+    for (auto i = 0; i < 1000; ++i)
+        s = s.insert((i * 7919) % 1000);
+    CHECK(s.size() == 1000);
+    CHECK(std::is_sorted(s.begin(), s.end()));
+    CHECK(*s.begin() == 0);
+    CHECK(*s.rbegin() == 999);
+    CHECK(s.insert(42).identity() == s.identity());
+    CHECK(s.erase(1000).identity() == s.identity());
+
+    auto s2 = s;
+    for (auto i = 0; i < 1000; i += 2)
+        s2 = s2.erase(i);
+    CHECK(s2.size() == 500);
+    CHECK(s.size() == 1000);
+    for (auto i = 0; i < 1000; ++i) {
+        CHECK(s.count(i) == 1);
+        CHECK(s2.count(i) == std::size_t(i % 2));
+    }
+    CHECK(*s2.lower_bound(10) == 11);
+    CHECK(*s2.upper_bound(11) == 13);
+    CHECK(s2.lower_bound(999) == std::prev(s2.end()));
+    CHECK(s2.upper_bound(999) == s2.end());
+}
+
+TEST_CASE("split and join")
+{
+    auto s = immer::ordered_set<int>{};
+    for (auto i = 0; i < 10000; ++i)
+        s = std::move(s).insert(i);
+
+    auto parts = s.split(4321);
+    CHECK(parts.first.size() == 4321);
+    CHECK(parts.second.size() == 10000 - 4321);
+    CHECK(*parts.first.rbegin() == 4320);
+    CHECK(*parts.second.begin() == 4321);
+    CHECK(parts.first.join(parts.second) == s);
+
+    CHECK(s.range(100, 200).size() == 100);
+    CHECK(*s.range(100, 200).begin() == 100);
+    CHECK(s.range(200, 100).empty());
+    CHECK(s.split(-1).first.empty());
+    CHECK(s.split(10000).second.empty());
+
+    auto small = immer::ordered_set<int>{10001, 10002};
+    CHECK(s.join(small).size() == 10002);
+    CHECK(immer::ordered_set<int>{-2, -1}.join(s).size() == 10002);
+    CHECK(s.join({}) == s);
+    CHECK(immer::ordered_set<int>{}.join(s) == s);
+}
+
+TEST_CASE("against std::set")
+{
+    SECTION("tiny nodes")
+    {
+        check_against_std<set_b<int, 4>>([](unsigned x) { return int(x); });
+    }
+    SECTION("odd nodes")
+    {
+        check_against_std<set_b<int, 5>>([](unsigned x) { return int(x); });
+    }
+    SECTION("strings")
+    {
+        check_against_std<set_b<std::string, 7>>(
+            [](unsigned x) { return std::to_string(x); });
+    }
+    SECTION("default nodes")
+    {
+        check_against_std<immer::ordered_set<std::string>>(
+            [](unsigned x) { return std::to_string(x); });
+    }
+}
+
+TEST_CASE("transient")
+{
+    auto s = set_b<int, 4>{};
+    for (auto i = 0; i < 100; ++i)
+        s = s.insert(i);
+
+    auto t = s.transient();
+    for (auto i = 100; i < 500; ++i)
+        t.insert(i);
+    for (auto i = 0; i < 500; i += 3)
+        t.erase(i);
+    CHECK(s.size() == 100);
+    CHECK(t.size() == 500 - 167);
+    CHECK(t.count(3) == 0);
+    CHECK(t.count(4) == 1);
+    CHECK(*t.lower_bound(3) == 4);
+
+    auto p = t.persistent();
+    t.insert(3);
+    t.erase(4);
+    CHECK(p.count(3) == 0);
+    CHECK(p.count(4) == 1);
+    CHECK(std::is_sorted(p.begin(), p.end()));
+    CHECK(same(s, std::set<int>(s.begin(), s.end())));
+    CHECK(s.size() == 100);
+}
+
+TEST_CASE("chunks")
+{
+    auto s   = immer::ordered_set<int>{};
+    auto sum = 0;
+    for (auto i = 0; i < 1000; ++i) {
+        s = s.insert(i);
+        sum += i;
+    }
+    CHECK(immer::accumulate(s, 0) == sum);
+    CHECK(immer::accumulate(s.lower_bound(10), s.lower_bound(20), 0) == 145);
+    auto count = 0;
+    immer::for_each_chunk(s, [&](auto first, auto last) {
+        CHECK(std::is_sorted(first, last));
+        count += last - first;
+    });
+    CHECK(count == 1000);
+}
@@ -0,0 +1,143 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/algorithm.hpp>
+#include <immer/packed_vector.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+
+template <typename V>
+std::vector<typename V::value_type> to_std(const V& v)
+{
+    auto r = std::vector<typename V::value_type>{};
+    immer::for_each_chunk(v, [&](auto first, auto last) {
+        r.insert(r.end(), first, last);
+    });
+    return r;
+}
+
+template <typename V, typename Gen>
+void check_values(Gen gen, std::size_t n)
+{
+    auto expected = std::vector<typename V::value_type>{};
+    auto v        = V{};
+    for (auto i = std::size_t{}; i < n; ++i) {
+        expected.push_back(gen(i));
+        v = std::move(v).push_back(expected.back());
+    }
+    REQUIRE(v.size() == n);
+    for (auto i = std::size_t{}; i < n; ++i)
+        CHECK(v[i] == expected[i]);
+    CHECK(to_std(v) == expected);
+}
+
+} // namespace
+
+TEST_CASE("packed vector")
+{
+    using vector_t = immer::packed_vector<std::uint32_t, 16>;
+
+    auto v = vector_t{};
+    for (auto i = 0u; i < 1000; ++i)
+        v = v.push_back(1000000 + i * 1000 + i % 7);
+
+    CHECK(v.size() == 1000);
+    CHECK(v[0] == 1000000);
+    CHECK(v[999] == 1000000 + 999 * 1000 + 999 % 7);
+    CHECK(v.back() == v[999]);
+    CHECK_THROWS_AS(v.at(1000), std::out_of_range);
+    // the slope is stored and each value only keeps a few bits
+    CHECK(v.packed_bytes() <= v.size() / 16 * 2 * 8);
+
+    SECTION("updates")
+    {
+        auto v2 = v.set(10, 5).set(995, 6).update(500, [](auto x) {
+            return x + 1;
+        });
+        CHECK(v2[10] == 5);
+        CHECK(v2[995] == 6);
+        CHECK(v2[500] == v[500] + 1);
+        CHECK(v2[11] == v[11]);
+        CHECK(v2 != v);
+        CHECK(v2.set(10, v[10]).set(995, v[995]).set(500, v[500]) == v);
+    }
+
+    SECTION("take")
+    {
+        for (auto n : {0u, 1u, 15u, 16u, 17u, 500u, 999u, 1000u, 2000u}) {
+            auto t = v.take(n);
+            CHECK(t.size() == std::min(n, 1000u));
+            for (auto i = 0u; i < t.size(); ++i)
+                CHECK(t[i] == v[i]);
+            CHECK(t.push_back(42).back() == 42);
+        }
+        CHECK(v.take(500).take(100) == v.take(100));
+    }
+
+    SECTION("algorithms")
+    {
+        auto sum      = immer::accumulate(v, std::uint64_t{});
+        auto expected = std::uint64_t{};
+        for (auto i = 0u; i < 1000; ++i)
+            expected += v[i];
+        CHECK(sum == expected);
+        CHECK(immer::all_of(v, [](auto x) { return x >= 1000000; }));
+    }
+}
+
+TEST_CASE("packed vector values")
+{
+    auto rng = std::mt19937_64{42};
+
+    SECTION("random")
+    {
+        check_values<immer::packed_vector<std::uint64_t, 32>>(
+            [&](std::size_t) { return rng(); }, 1000);
+    }
+
+    SECTION("extremes")
+    {
+        using lim = std::numeric_limits<std::int64_t>;
+        check_values<immer::packed_vector<std::int64_t, 8>>(
+            [&](std::size_t i) { return i % 2 ? lim::max() : lim::min(); },
+            100);
+    }
+
+    SECTION("decreasing and negative")
+    {
+        check_values<immer::packed_vector<int, 64>>(
+            [&](std::size_t i) { return 500 - static_cast<int>(i) * 3; },
+            1000);
+    }
+
+    SECTION("small types")
+    {
+        check_values<immer::packed_vector<std::uint8_t, 16>>(
+            [&](std::size_t i) { return static_cast<std::uint8_t>(i * 7); },
+            1000);
+        check_values<immer::packed_vector<std::int16_t, 16>>(
+            [&](std::size_t) { return static_cast<std::int16_t>(rng()); },
+            1000);
+    }
+
+    SECTION("constants compress to nothing")
+    {
+        auto v = immer::packed_vector<std::uint32_t, 16>{};
+        for (auto i = 0; i < 1000; ++i)
+            v = v.push_back(7);
+        CHECK(v.packed_bytes() == 0);
+        CHECK(v[500] == 7);
+    }
+}
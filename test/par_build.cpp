@@ -0,0 +1,169 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/par_build.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstddef>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+TEST_CASE("par_build flex_vector")
+{
+    using vector_t   = immer::flex_vector<unsigned>;
+    constexpr auto n = 1000u;
+    for (auto parts : {0u, 1u, 3u, 16u}) {
+        auto v = immer::par_build<vector_t>(
+            parts,
+            [&](std::size_t i, auto& t) {
+                for (auto j = n * i / parts; j < n * (i + 1) / parts; ++j)
+                    t.push_back(j);
+            },
+            immer::thread_executor{4});
+        CHECK(v.size() == (parts ? n : 0u));
+        for (auto j = 0u; j < v.size(); ++j)
+            CHECK(v[j] == j);
+    }
+}
+
+TEST_CASE("par_build map")
+{
+    using map_t          = immer::map<unsigned, std::size_t>;
+    constexpr auto parts = 7u;
+    auto m               = immer::par_build<map_t>(
+        parts,
+        [&](std::size_t i, auto& t) {
+            for (auto j = 0u; j < 500u; ++j)
+                t.set(static_cast<unsigned>(i * 100 + j), i);
+        },
+        immer::thread_executor{4});
+    CHECK(m.size() == 100u * (parts - 1) + 500u);
+    // overlapping keys keep the value of the last part that set them
+    CHECK(m[0] == 0u);
+    CHECK(m[150] == 1u);
+    CHECK(m[450] == 4u);
+    CHECK(m[1000] == 6u);
+
+    auto seq = immer::par_build<map_t>(
+        parts,
+        [&](std::size_t i, auto& t) {
+            for (auto j = 0u; j < 500u; ++j)
+                t.set(static_cast<unsigned>(i * 100 + j), i);
+        },
+        immer::sequential_executor{});
+    CHECK(seq == m);
+}
+
+namespace {
+
+unsigned parse_unsigned(const char* first, const char* last)
+{
+    return static_cast<unsigned>(std::stoul(std::string(first, last)));
+}
+
+} // namespace
+
+TEST_CASE("par_load flex_vector")
+{
+    using vector_t   = immer::flex_vector<unsigned>;
+    constexpr auto n = 5000u;
+    auto text        = std::string{};
+    for (auto j = 0u; j < n; ++j)
+        text += std::to_string(j) + "\n";
+
+    // small chunks, so that there are several batches, and a missing
+    // delimiter at the end
+    for (auto tail : {true, false}) {
+        auto in =
+            std::istringstream{tail ? text : text.substr(0, text.size() - 1)};
+        auto v = immer::par_load<vector_t>(
+            in,
+            [](const char* f, const char* l, auto& t) {
+                t.push_back(parse_unsigned(f, l));
+            },
+            immer::thread_executor{4},
+            64);
+        CHECK(v.size() == n);
+        for (auto j = 0u; j < v.size(); ++j)
+            CHECK(v[j] == j);
+    }
+
+    auto empty = std::istringstream{};
+    CHECK(immer::par_load<vector_t>(
+              empty, [](const char*, const char*, auto&) {})
+              .empty());
+}
+
+TEST_CASE("par_load map")
+{
+    using map_t = immer::map<unsigned, unsigned>;
+    auto text   = std::string{};
+    for (auto j = 0u; j < 3000u; ++j)
+        text += std::to_string(j % 1000) + " " + std::to_string(j) + ";";
+    auto parse = [](const char* f, const char* l, auto& t) {
+        auto s = std::istringstream{std::string(f, l)};
+        auto k = 0u, v = 0u;
+        s >> k >> v;
+        t.set(k, v);
+    };
+
+    auto in = std::istringstream{text};
+    auto m =
+        immer::par_load<map_t>(in, parse, immer::thread_executor{4}, 100, ';');
+    CHECK(m.size() == 1000u);
+    // the last record with a key wins
+    for (auto k = 0u; k < 1000u; ++k)
+        CHECK(m[k] == k + 2000u);
+
+    auto bad = std::istringstream{"1 1;x;2 2;"};
+    CHECK_THROWS_AS(immer::par_load<map_t>(
+                        bad,
+                        [](const char* f, const char* l, auto& t) {
+                            t.set(parse_unsigned(f, l), 0u);
+                        },
+                        immer::thread_executor{2},
+                        2,
+                        ';'),
+                    std::invalid_argument);
+}
+
+TEST_CASE("group_by")
+{
+    auto events = immer::flex_vector<unsigned>{};
+    for (auto j = 0u; j < 50000u; ++j)
+        events = std::move(events).push_back(j);
+    auto key = [](unsigned x) { return x % 37u; };
+
+    auto check = [&](const auto& groups) {
+        CHECK(groups.size() == 37u);
+        auto total = std::size_t{};
+        for (auto& kv : groups) {
+            auto expected = kv.first;
+            for (auto x : kv.second) {
+                CHECK(x == expected);
+                expected += 37u;
+            }
+            total += kv.second.size();
+        }
+        CHECK(total == events.size());
+    };
+    check(immer::group_by(events, key, immer::thread_executor{4}));
+    check(immer::group_by(events, key, immer::sequential_executor{}));
+
+    using groups_t = immer::map<bool, immer::flex_vector<int>>;
+    auto small     = std::vector<int>{3, 1, 4, 1, 5};
+    auto g         = immer::group_by_into<groups_t>(
+        small, [](int x) { return x > 2; });
+    CHECK(g[true] == immer::flex_vector<int>{3, 4, 5});
+    CHECK(g[false] == immer::flex_vector<int>{1, 1});
+    CHECK(immer::group_by(std::vector<int>{}, [](int x) { return x; })
+              .empty());
+}
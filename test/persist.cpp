@@ -0,0 +1,335 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/flex_vector.hpp>
+#include <immer/map.hpp>
+#include <immer/persist.hpp>
+#include <immer/set.hpp>
+#include <immer/vector.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <sstream>
+#include <string>
+
+namespace {
+
+struct saved
+{
+    std::string data;
+    std::vector<std::size_t> ids;
+};
+
+template <typename... Containers>
+saved save_all(const Containers&... cs)
+{
+    auto out    = immer::output_archive{};
+    auto stream = std::ostringstream{};
+    auto ids    = std::vector<std::size_t>{out.save(cs)...};
+    out.write(stream);
+    return {stream.str(), ids};
+}
+
+template <typename Container>
+saved save_delta(const Container& c, const Container& base)
+{
+    auto out    = immer::output_archive{};
+    auto stream = std::ostringstream{};
+    auto id     = out.save(c, base);
+    out.write(stream);
+    return {stream.str(), {id}};
+}
+
+// replicates versions of a container to a reader that starts with the
+// first one, sending only deltas, and returns the versions it gets
+template <typename Container>
+std::vector<Container> replicate(const std::vector<Container>& versions)
+{
+    auto result = std::vector<Container>{versions[0]};
+    for (auto i = std::size_t{1}; i < versions.size(); ++i) {
+        auto delta  = save_delta(versions[i], versions[i - 1]);
+        auto stream = std::stringstream{delta.data};
+        immer::input_archive in{stream};
+        result.push_back(in.template load<Container>(delta.ids[0],
+                                                     result.back()));
+    }
+    return result;
+}
+
+// counts the bytes that an archive reads from it
+struct counting_source : immer::archive_source
+{
+    std::string data;
+    std::size_t bytes_read = 0;
+
+    counting_source(std::string d)
+        : data{std::move(d)}
+    {}
+
+    std::uint64_t size() override { return data.size(); }
+
+    void read(std::uint64_t offset, void* out, std::size_t size) override
+    {
+        data.copy(static_cast<char*>(out), size, offset);
+        bytes_read += size;
+    }
+};
+
+} // namespace
+
+TEST_CASE("vector")
+{
+    auto v1 = immer::vector<int>{};
+    for (auto i = 0; i < 1000; ++i)
+        v1 = v1.push_back(i);
+    auto v2 = v1.set(500, 42).push_back(13);
+
+    auto out    = immer::output_archive{};
+    auto id0    = out.save(immer::vector<int>{});
+    auto id1    = out.save(v1);
+    auto id2    = out.save(v2);
+    auto stream = std::stringstream{};
+    out.write(stream);
+
+    immer::input_archive in{stream};
+    auto w1 = in.load<immer::vector<int>>(id1);
+    auto w2 = in.load<immer::vector<int>>(id2);
+    CHECK(in.load<immer::vector<int>>(id0).empty());
+    CHECK(w1 == v1);
+    CHECK(w2 == v2);
+    CHECK(in.load<immer::vector<int>>(id1).identity() == w1.identity());
+}
+
+TEST_CASE("flex_vector")
+{
+    auto v = immer::flex_vector<std::string>{};
+    for (auto i = 0; i < 666; ++i)
+        v = v.push_back(std::to_string(i));
+    auto versions = std::vector<immer::flex_vector<std::string>>{
+        v, v.take(300), v.drop(77), v.drop(3) + v.take(500), v.insert(0, "x")};
+
+    auto out    = immer::output_archive{};
+    auto ids    = std::vector<std::size_t>{};
+    auto stream = std::stringstream{};
+    for (auto& x : versions)
+        ids.push_back(out.save(x));
+    out.write(stream);
+
+    immer::input_archive in{stream};
+    for (auto i = std::size_t{}; i < ids.size(); ++i)
+        CHECK(in.load<immer::flex_vector<std::string>>(ids[i]) ==
+              versions[i]);
+}
+
+TEST_CASE("containers outlive the archive")
+{
+    auto m = immer::map<std::string, int>{};
+    for (auto i = 0; i < 500; ++i)
+        m = m.set(std::to_string(i), i);
+    auto saved  = save_all(m, m.erase("7"));
+    auto stream = std::stringstream{saved.data};
+
+    auto loaded = immer::map<std::string, int>{};
+    {
+        immer::input_archive in{stream};
+        loaded = in.load<immer::map<std::string, int>>(saved.ids[1]);
+    }
+    CHECK(loaded == m.erase("7"));
+}
+
+TEST_CASE("versions share their nodes")
+{
+    auto s = immer::set<int>{};
+    for (auto i = 0; i < 10000; ++i)
+        s = s.insert(i);
+    auto t = s.insert(-1);
+
+    auto alone = save_all(t).data.size();
+    auto both  = save_all(s, t);
+    CHECK(both.data.size() < alone + alone / 10);
+
+    auto stream = std::stringstream{both.data};
+    immer::input_archive in{stream};
+    CHECK(in.load<immer::set<int>>(both.ids[0]) == s);
+    CHECK(in.load<immer::set<int>>(both.ids[1]) == t);
+}
+
+TEST_CASE("malformed archives")
+{
+    auto v    = immer::flex_vector<int>{1, 2, 3};
+    auto data = save_all(v).data;
+
+    SECTION("not an archive")
+    {
+        auto stream = std::stringstream{"hello"};
+        CHECK_THROWS_AS(immer::input_archive{stream}, immer::archive_error);
+    }
+
+    SECTION("truncated")
+    {
+        auto stream = std::stringstream{data.substr(0, data.size() - 1)};
+        CHECK_THROWS_AS(immer::input_archive{stream}, immer::archive_error);
+    }
+
+    SECTION("wrong identifier")
+    {
+        auto stream = std::stringstream{data};
+        immer::input_archive in{stream};
+        CHECK_THROWS_AS(in.load<immer::flex_vector<int>>(0),
+                        immer::archive_error);
+        CHECK_THROWS_AS(in.load<immer::flex_vector<int>>(100),
+                        immer::archive_error);
+    }
+
+    SECTION("wrong container")
+    {
+        auto stream = std::stringstream{data};
+        immer::input_archive in{stream};
+        auto id     = save_all(v).ids[0];
+        CHECK_THROWS_AS(in.load<immer::set<int>>(id), immer::archive_error);
+        using other_t =
+            immer::flex_vector<int, immer::default_memory_policy, 4>;
+        CHECK_THROWS_AS(in.load<other_t>(id), immer::archive_error);
+        CHECK(in.load<immer::flex_vector<int>>(id) == v);
+    }
+}
+
+TEST_CASE("deltas")
+{
+    SECTION("vector")
+    {
+        auto v = immer::vector<int>{};
+        for (auto i = 0; i < 10000; ++i)
+            v = v.push_back(i);
+        auto versions = std::vector<immer::vector<int>>{v};
+        for (auto i = 0; i < 10; ++i)
+            versions.push_back(versions.back().push_back(i).set(i * 997, -i));
+        versions.push_back(versions.back().take(5000));
+        versions.push_back(immer::vector<int>{});
+        versions.push_back(versions.back().push_back(1));
+        CHECK(replicate(versions) == versions);
+
+        auto full  = save_all(versions[1]).data.size();
+        auto delta = save_delta(versions[1], versions[0]).data.size();
+        CHECK(delta < full / 20);
+    }
+
+    SECTION("flex_vector")
+    {
+        auto v = immer::flex_vector<std::string>{};
+        for (auto i = 0; i < 1000; ++i)
+            v = v.push_back(std::to_string(i));
+        auto versions = std::vector<immer::flex_vector<std::string>>{
+            v, v.drop(3), v.drop(3) + v.take(500), v.insert(700, "x")};
+        for (auto i = 0; i < 5; ++i)
+            versions.push_back(versions.back().erase(i * 100));
+        CHECK(replicate(versions) == versions);
+    }
+
+    SECTION("map")
+    {
+        auto m = immer::map<std::string, int>{};
+        for (auto i = 0; i < 10000; ++i)
+            m = m.set(std::to_string(i), i);
+        auto versions = std::vector<immer::map<std::string, int>>{m};
+        for (auto i = 0; i < 10; ++i)
+            versions.push_back(versions.back()
+                                   .set(std::to_string(i * 31), -i)
+                                   .erase(std::to_string(i * 7)));
+        versions.push_back(immer::map<std::string, int>{}.set("a", 1));
+        CHECK(replicate(versions) == versions);
+
+        auto full  = save_all(versions[1]).data.size();
+        auto delta = save_delta(versions[1], versions[0]).data.size();
+        CHECK(delta < full / 20);
+    }
+
+    SECTION("the reader must have the base")
+    {
+        auto s = immer::set<int>{};
+        for (auto i = 0; i < 1000; ++i)
+            s = s.insert(i);
+        auto delta = save_delta(s.insert(-1), s);
+
+        auto stream = std::stringstream{delta.data};
+        immer::input_archive in{stream};
+        CHECK_THROWS_AS(in.load<immer::set<int>>(delta.ids[0]),
+                        immer::archive_error);
+        CHECK(in.load<immer::set<int>>(delta.ids[0], s) == s.insert(-1));
+    }
+}
+
+TEST_CASE("sources")
+{
+    auto v = immer::flex_vector<int>{};
+    auto m = immer::map<int, int>{};
+    for (auto i = 0; i < 10000; ++i) {
+        v = v.push_back(i);
+        m = m.set(i, -i);
+    }
+    auto small = v.take(10);
+    auto s     = save_all(v, m, small);
+
+    SECTION("only the records of the loaded nodes are read")
+    {
+        auto source = counting_source{s.data};
+        immer::input_archive in{source};
+        auto index = source.bytes_read;
+        CHECK(in.load<immer::flex_vector<int>>(s.ids[2]) == small);
+        CHECK(source.bytes_read - index < 1000);
+        CHECK(in.load<immer::map<int, int>>(s.ids[1]) == m);
+        CHECK(in.load<immer::flex_vector<int>>(s.ids[0]) == v);
+        // every record was read once
+        CHECK(source.bytes_read == s.data.size());
+    }
+
+    SECTION("trim evicts the nodes that are not used")
+    {
+        auto source = counting_source{s.data};
+        immer::input_archive in{source};
+        auto w = in.load<immer::flex_vector<int>>(s.ids[0]);
+        in.load<immer::map<int, int>>(s.ids[1]);
+        in.trim();
+        auto bytes = source.bytes_read;
+        // the nodes of w are still alive and shared
+        CHECK(in.load<immer::flex_vector<int>>(s.ids[0]).identity() ==
+              w.identity());
+        CHECK(source.bytes_read - bytes < 100);
+        // the ones of the map are read again
+        CHECK(in.load<immer::map<int, int>>(s.ids[1]) == m);
+        CHECK(source.bytes_read > bytes);
+        w = {};
+        in.trim();
+        CHECK(in.load<immer::flex_vector<int>>(s.ids[2]) == small);
+    }
+
+    SECTION("streams")
+    {
+        auto stream = std::stringstream{s.data};
+        auto source = immer::stream_source{stream};
+        immer::input_archive in{source};
+        CHECK(in.load<immer::map<int, int>>(s.ids[1]) == m);
+        CHECK(in.load<immer::flex_vector<int>>(s.ids[0]) == v);
+    }
+
+    SECTION("deltas")
+    {
+        auto v2     = v.set(5000, 0);
+        auto delta  = save_delta(v2, v);
+        auto source = counting_source{delta.data};
+        immer::input_archive in{source};
+        CHECK(in.load<immer::flex_vector<int>>(delta.ids[0], v) == v2);
+        in.trim();
+    }
+
+    SECTION("truncated")
+    {
+        auto source = counting_source{s.data.substr(0, s.data.size() - 1)};
+        CHECK_THROWS_AS(immer::input_archive{source}, immer::archive_error);
+    }
+}
@@ -0,0 +1,109 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/flex_vector.hpp>
+#include <immer/heap/cpp_heap.hpp>
+#include <immer/heap/heap_policy.hpp>
+#include <immer/map.hpp>
+#include <immer/memory_policy.hpp>
+#include <immer/prewarm.hpp>
+#include <immer/set.hpp>
+#include <immer/vector.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstddef>
+#include <string>
+
+namespace {
+
+template <typename Tag>
+struct counting_heap : immer::cpp_heap
+{
+    static std::size_t allocations;
+    static std::size_t live;
+
+    template <typename... Tags>
+    static void* allocate(std::size_t size, Tags... tags)
+    {
+        ++allocations;
+        ++live;
+        return immer::cpp_heap::allocate(size, tags...);
+    }
+
+    template <typename... Tags>
+    static void deallocate(std::size_t size, void* data, Tags... tags)
+    {
+        --live;
+        immer::cpp_heap::deallocate(size, data, tags...);
+    }
+};
+
+template <typename Tag>
+std::size_t counting_heap<Tag>::allocations = 0;
+template <typename Tag>
+std::size_t counting_heap<Tag>::live = 0;
+
+template <typename HeapPolicy>
+using memory_t = immer::memory_policy<HeapPolicy,
+                                      immer::refcount_policy,
+                                      immer::default_lock_policy>;
+
+} // namespace
+
+TEST_CASE("prewarm fills the free lists of the vectors")
+{
+    struct tag
+    {};
+    using heap_t   = counting_heap<tag>;
+    using memory   = memory_t<immer::unsafe_free_list_heap_policy<heap_t, 64>>;
+    using vector_t = immer::vector<int, memory, 2, 2>;
+    using flex_t   = immer::flex_vector<int, memory, 2, 2>;
+
+    immer::prewarm<vector_t>(40);
+    CHECK(heap_t::allocations == 40);
+    CHECK(heap_t::live == 40);
+
+    // the nodes of both vectors have the same size, thus they share
+    // the free list
+    auto v = vector_t{};
+    auto f = flex_t{};
+    for (auto i = 0; i < 30; ++i) {
+        v = std::move(v).push_back(i);
+        f = std::move(f).push_back(i);
+    }
+    CHECK(heap_t::allocations == 40);
+
+    // the free list keeps at most 64 nodes
+    auto live = heap_t::live;
+    immer::prewarm<flex_t>(100);
+    CHECK(heap_t::live > live);
+    CHECK(heap_t::live - live <= 64);
+}
+
+TEST_CASE("prewarm allocates the sizes of the nodes of the maps")
+{
+    struct tag
+    {};
+    using heap_t = counting_heap<tag>;
+    using memory = memory_t<immer::heap_policy<heap_t>>;
+    using map_t  = immer::map<std::string,
+                             int,
+                             std::hash<std::string>,
+                             std::equal_to<std::string>,
+                             memory,
+                             3>;
+    using set_t =
+        immer::set<int, std::hash<int>, std::equal_to<int>, memory, 3>;
+
+    immer::prewarm<map_t>(100);
+    CHECK(heap_t::allocations == 100);
+    immer::prewarm<set_t>(5);
+    CHECK(heap_t::allocations == 105);
+    CHECK(heap_t::live == 0);
+}
@@ -0,0 +1,157 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/priority_queue.hpp>
+#include <immer/priority_queue_transient.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <random>
+#include <vector>
+
+namespace {
+
+template <typename Q>
+std::vector<int> drain(Q q)
+{
+    auto r = std::vector<int>{};
+    while (!q.empty()) {
+        r.push_back(q.top());
+        q = std::move(q).pop();
+    }
+    return r;
+}
+
+struct counted
+{
+    static int alive;
+
+    int v;
+
+    counted(int x)
+        : v{x}
+    {
+        ++alive;
+    }
+    counted(const counted& x)
+        : v{x.v}
+    {
+        ++alive;
+    }
+    ~counted() { --alive; }
+
+    bool operator<(const counted& x) const { return v < x.v; }
+};
+
+int counted::alive = 0;
+
+} // namespace
+
+TEST_CASE("priority_queue push and pop")
+{
+    using queue_t = immer::priority_queue<int>;
+    auto q0       = queue_t{};
+    auto q1       = q0.push(3).push(1).push(4).push(1).push(5);
+    CHECK(q0.empty());
+    CHECK(q1.size() == 5);
+    CHECK(q1.top() == 5);
+    CHECK(q1.pop().top() == 4);
+    CHECK(q1.top() == 5);
+    CHECK(drain(q1) == (std::vector<int>{5, 4, 3, 1, 1}));
+
+    auto m = immer::priority_queue<int, std::greater<int>>{30, 10, 20};
+    CHECK(m.top() == 10);
+    CHECK(drain(m) == (std::vector<int>{10, 20, 30}));
+}
+
+TEST_CASE("priority_queue against std::priority_queue")
+{
+    auto gen = std::mt19937{42};
+    auto q   = immer::priority_queue<int>{};
+    auto ref = std::priority_queue<int>{};
+    auto old = std::vector<std::pair<immer::priority_queue<int>,
+                                     std::vector<int>>>{};
+    for (auto i = 0; i < 5000; ++i) {
+        if (q.empty() || gen() % 3) {
+            auto v = static_cast<int>(gen() % 1000);
+            q      = q.push(v);
+            ref.push(v);
+        } else {
+            CHECK(q.top() == ref.top());
+            q = q.pop();
+            ref.pop();
+        }
+        CHECK(q.size() == ref.size());
+        if (i % 1000 == 0) {
+            auto copy = ref;
+            auto vs   = std::vector<int>{};
+            for (; !copy.empty(); copy.pop())
+                vs.push_back(copy.top());
+            old.emplace_back(q, vs);
+        }
+    }
+    for (auto& x : old)
+        CHECK(drain(x.first) == x.second);
+}
+
+TEST_CASE("priority_queue meld")
+{
+    auto a = immer::priority_queue<int>{};
+    auto b = immer::priority_queue<int>{};
+    for (auto i = 0; i < 100; ++i)
+        (i % 2 ? a : b) = (i % 2 ? a : b).push(i);
+    auto c = a.meld(b);
+    CHECK(c.size() == 100);
+    CHECK(a.size() == 50);
+    CHECK(b.size() == 50);
+    auto expected = std::vector<int>{};
+    for (auto i = 100; i-- > 0;)
+        expected.push_back(i);
+    CHECK(drain(c) == expected);
+    CHECK(drain(a).front() == 99);
+    CHECK(drain(b).front() == 98);
+    CHECK(a.meld({}).size() == a.size());
+    CHECK(immer::priority_queue<int>{}.meld(a).top() == 99);
+}
+
+TEST_CASE("priority_queue transient")
+{
+    auto q0 = immer::priority_queue<int>{}.push(7);
+    auto t  = q0.transient();
+    for (auto i = 0; i < 1000; ++i)
+        t.push(i);
+    t.pop();
+    t.meld(q0);
+    auto q1 = t.persistent();
+    t.push(5000);
+    CHECK(q0.size() == 1);
+    CHECK(q1.size() == 1001);
+    CHECK(q1.top() == 998);
+    CHECK(t.top() == 5000);
+    auto d = drain(q1);
+    CHECK(std::is_sorted(d.rbegin(), d.rend()));
+    CHECK(std::count(d.begin(), d.end(), 7) == 3);
+}
+
+TEST_CASE("priority_queue frees its nodes")
+{
+    {
+        // pushing in increasing order of priority makes a long left
+        // path, that must be released without recursing on it
+        auto q = immer::priority_queue<counted>{};
+        for (auto i = 0; i < 100000; ++i)
+            q = std::move(q).push(counted{i});
+        auto p = q.pop().pop();
+        CHECK(p.top().v == 99997);
+        CHECK(counted::alive > 0);
+    }
+    CHECK(counted::alive == 0);
+}
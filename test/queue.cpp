@@ -0,0 +1,138 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/algorithm.hpp>
+#include <immer/queue.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <deque>
+#include <random>
+#include <vector>
+
+namespace {
+
+template <typename Q>
+std::vector<int> drain(Q q)
+{
+    auto r = std::vector<int>{};
+    while (!q.empty()) {
+        r.push_back(q.front());
+        q = std::move(q).pop();
+    }
+    return r;
+}
+
+struct counted
+{
+    static int alive;
+
+    int v;
+
+    counted(int x)
+        : v{x}
+    {
+        ++alive;
+    }
+    counted(const counted& x)
+        : v{x.v}
+    {
+        ++alive;
+    }
+    ~counted() { --alive; }
+};
+
+int counted::alive = 0;
+
+} // namespace
+
+TEST_CASE("queue push and pop")
+{
+    using queue_t = immer::queue<int>;
+
+    auto q = queue_t{};
+    CHECK(q.empty());
+    q = q.push(1).push(2).push(3);
+    CHECK(q.size() == 3);
+    CHECK(q.front() == 1);
+    CHECK(q.back() == 3);
+
+    auto r = q.pop();
+    CHECK(r.front() == 2);
+    CHECK(r.size() == 2);
+    CHECK(q.front() == 1);
+    CHECK(drain(q) == std::vector<int>{1, 2, 3});
+    CHECK(drain(queue_t{4, 5, 6}) == std::vector<int>{4, 5, 6});
+    CHECK(r == queue_t{2, 3});
+    CHECK(r != q);
+    CHECK(q.pop().pop().pop().empty());
+}
+
+TEST_CASE("queue against std::deque")
+{
+    using queue_t = immer::queue<int>;
+
+    auto gen = std::mt19937{42};
+    auto q   = queue_t{};
+    auto s   = std::deque<int>{};
+    auto old = std::vector<std::pair<queue_t, std::deque<int>>>{};
+    for (auto i = 0; i < 20000; ++i) {
+        if (s.empty() || gen() % 3) {
+            q = std::move(q).push(i);
+            s.push_back(i);
+        } else {
+            q = std::move(q).pop();
+            s.pop_front();
+        }
+        REQUIRE(q.size() == s.size());
+        if (!s.empty()) {
+            REQUIRE(q.front() == s.front());
+            REQUIRE(q.back() == s.back());
+        }
+        if (i % 1000 == 0)
+            old.emplace_back(q, s);
+    }
+    CHECK(std::equal(q.begin(), q.end(), s.begin(), s.end()));
+    CHECK(q[s.size() / 2] == s[s.size() / 2]);
+
+    // the old versions are not affected
+    for (auto& o : old) {
+        CHECK(std::equal(
+            o.first.begin(), o.first.end(), o.second.begin(), o.second.end()));
+        CHECK(o.first.vector() == queue_t::vector_type(o.second.begin(),
+                                                       o.second.end()));
+    }
+
+    auto sum = 0ll;
+    immer::for_each_chunk(q, [&](auto f, auto l) {
+        for (; f != l; ++f)
+            sum += *f;
+    });
+    auto expected = 0ll;
+    for (auto x : s)
+        expected += x;
+    CHECK(sum == expected);
+}
+
+TEST_CASE("queue releases what it pops")
+{
+    {
+        auto q = immer::queue<counted>{};
+        for (auto i = 0; i < 1000; ++i)
+            q = std::move(q).push(i);
+        for (auto i = 0; i < 900; ++i)
+            q = std::move(q).pop();
+        CHECK(q.front().v == 900);
+        // at most a leaf of popped values is kept
+        CHECK(counted::alive - 100 < 64);
+        while (!q.empty())
+            q = std::move(q).pop();
+        CHECK(counted::alive == 0);
+    }
+    CHECK(counted::alive == 0);
+}
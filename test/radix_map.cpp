@@ -0,0 +1,206 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/algorithm.hpp>
+#include <immer/radix_map.hpp>
+#include <immer/radix_map_transient.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+template <typename Map>
+std::vector<std::string> keys_of(const Map& m)
+{
+    auto r = std::vector<std::string>{};
+    for (auto& kv : m)
+        r.push_back(kv.first);
+    return r;
+}
+
+std::string make_key(std::mt19937& gen)
+{
+    // few distinct bytes and short keys, so that they share prefixes and
+    // some are prefixes of others
+    auto r = std::string{};
+    auto n = gen() % 6;
+    for (auto i = 0u; i < n; ++i)
+        r.push_back("ab/\xff"[gen() % 4]);
+    return r;
+}
+
+template <typename Map>
+bool same(const Map& m, const std::map<std::string, int>& ref)
+{
+    return std::equal(
+        m.begin(), m.end(), ref.begin(), ref.end(), [](auto& a, auto& b) {
+            return a.first == b.first && a.second == b.second;
+        });
+}
+
+} // namespace
+
+TEST_CASE("radix map basic operations")
+{
+    using map_t = immer::radix_map<std::string, int>;
+
+    auto m = map_t{}
+                 .set("/api/v1/users", 1)
+                 .set("/api/v1/items", 2)
+                 .set("/api/v2/users", 3)
+                 .set("/api", 4)
+                 .set("", 5);
+    CHECK(m.size() == 5);
+    CHECK(m["/api/v1/items"] == 2);
+    CHECK(m["/api"] == 4);
+    CHECK(m[""] == 5);
+    CHECK(m["/api/v1"] == 0);
+    CHECK(m.count("/api/v2/users") == 1);
+    CHECK(m.count("/api/v2/user") == 0);
+    CHECK(m.count("/api/v2/users/") == 0);
+    CHECK(m.find("/ap") == nullptr);
+    CHECK_THROWS_AS(m.at("/x"), std::out_of_range);
+    CHECK(keys_of(m) == std::vector<std::string>{"",
+                                                 "/api",
+                                                 "/api/v1/items",
+                                                 "/api/v1/users",
+                                                 "/api/v2/users"});
+
+    auto n = m.set("/api", 40).update("/api/v1/items", [](int x) {
+        return x + 1;
+    });
+    CHECK(n["/api"] == 40);
+    CHECK(n["/api/v1/items"] == 3);
+    CHECK(m["/api"] == 4);
+    CHECK(m["/api/v1/items"] == 2);
+
+    auto e = n.erase("/api").erase("").erase("/nope");
+    CHECK(e.size() == 3);
+    CHECK(e.count("/api") == 0);
+    CHECK(e["/api/v2/users"] == 3);
+    CHECK(n.size() == 5);
+
+    CHECK(map_t{{"a", 1}, {"b", 2}, {"a", 3}} ==
+          map_t{}.set("b", 2).set("a", 3));
+    CHECK(map_t{{"a", 1}} != map_t{{"a", 2}});
+}
+
+TEST_CASE("radix map prefix queries")
+{
+    using map_t = immer::radix_map<std::string, int>;
+
+    auto m = map_t{}
+                 .set("/api/v1/users", 1)
+                 .set("/api/v1/items", 2)
+                 .set("/api/v2/users", 3)
+                 .set("/api/v1", 4)
+                 .set("/static", 5);
+
+    CHECK(keys_of(m.with_prefix("/api/v1/")) ==
+          std::vector<std::string>{"/api/v1/items", "/api/v1/users"});
+    CHECK(keys_of(m.with_prefix("/api/v1")) ==
+          std::vector<std::string>{
+              "/api/v1", "/api/v1/items", "/api/v1/users"});
+    CHECK(keys_of(m.with_prefix("/api/v")).size() == 4);
+    CHECK(m.with_prefix("/api/v1/i")["/api/v1/items"] == 2);
+    CHECK(m.with_prefix("/api/v1/i").size() == 1);
+    CHECK(m.with_prefix("/api/v3").empty());
+    CHECK(m.with_prefix("/apx").empty());
+    CHECK(m.with_prefix("/static/x").empty());
+    CHECK(m.with_prefix("") == m);
+
+    // the result is a map in its own right
+    auto v1 = m.with_prefix("/api/v1/").set("/api/v1/orders", 6);
+    CHECK(v1.size() == 3);
+    CHECK(v1["/api/v1/orders"] == 6);
+    CHECK(m.count("/api/v1/orders") == 0);
+}
+
+TEST_CASE("radix map against a reference")
+{
+    using map_t = immer::radix_map<std::string, int>;
+
+    auto gen      = std::mt19937{42};
+    auto m        = map_t{};
+    auto ref      = std::map<std::string, int>{};
+    auto versions = std::vector<std::pair<map_t, std::map<std::string, int>>>{};
+    for (auto i = 0; i < 5000; ++i) {
+        auto k = make_key(gen);
+        if (gen() % 3) {
+            m      = gen() % 2 ? std::move(m).set(k, i) : m.set(k, i);
+            ref[k] = i;
+        } else {
+            m = gen() % 2 ? std::move(m).erase(k) : m.erase(k);
+            ref.erase(k);
+        }
+        REQUIRE(m.size() == ref.size());
+        if (i % 500 == 0)
+            versions.emplace_back(m, ref);
+    }
+    // bytes are compared as unsigned, like std::string does
+    CHECK(same(m, ref));
+    for (auto& v : versions)
+        CHECK(same(v.first, v.second));
+
+    for (auto i = 0; i < 200; ++i) {
+        auto p = make_key(gen);
+        auto r = std::vector<std::string>{};
+        for (auto& kv : ref)
+            if (kv.first.compare(0, p.size(), p) == 0)
+                r.push_back(kv.first);
+        CHECK(keys_of(m.with_prefix(p)) == r);
+    }
+
+    auto count = std::size_t{};
+    immer::for_each_chunk(m, [&](auto first, auto last) {
+        count += last - first;
+    });
+    CHECK(count == ref.size());
+}
+
+TEST_CASE("radix map transient")
+{
+    using map_t = immer::radix_map<std::string, int>;
+
+    auto gen = std::mt19937{7};
+    auto ref = std::map<std::string, int>{};
+    auto old = map_t{{"a", 1}, {"ab", 2}, {"b/", 3}};
+    auto t   = old.transient();
+    for (auto& kv : old)
+        ref.insert(kv);
+    for (auto i = 0; i < 3000; ++i) {
+        auto k = make_key(gen);
+        if (gen() % 3) {
+            t.set(k, i);
+            ref[k] = i;
+        } else {
+            t.erase(k);
+            ref.erase(k);
+        }
+        REQUIRE(t.size() == ref.size());
+    }
+    t.update("zz", [](int x) { return x + 1; });
+    ref["zz"] = 1;
+
+    auto m = t.persistent();
+    CHECK(same(m, ref));
+    CHECK(keys_of(old) == std::vector<std::string>{"a", "ab", "b/"});
+
+    // updating the transient again does not change the persistent one
+    t.set("zz", 5);
+    t.erase("a");
+    CHECK(m["zz"] == 1);
+    CHECK(t.find("zz"));
+    CHECK(*t.find("zz") == 5);
+    CHECK(same(m, ref));
+}
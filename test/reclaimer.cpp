@@ -0,0 +1,90 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/map.hpp>
+#include <immer/reclaimer.hpp>
+#include <immer/vector.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+namespace {
+
+// records the thread that destroys the last copy
+struct tracked
+{
+    std::shared_ptr<std::atomic<std::thread::id>> destroyer;
+
+    tracked() = default;
+    tracked(std::shared_ptr<std::atomic<std::thread::id>> d)
+        : destroyer{std::move(d)}
+    {}
+    tracked(const tracked&) = default;
+    tracked(tracked&&)      = default;
+    tracked& operator=(const tracked&) = default;
+    tracked& operator=(tracked&&) = default;
+
+    ~tracked()
+    {
+        if (destroyer && destroyer.use_count() == 2)
+            destroyer->store(std::this_thread::get_id());
+    }
+};
+
+} // namespace
+
+TEST_CASE("release containers in the reclaimer thread")
+{
+    auto destroyer = std::make_shared<std::atomic<std::thread::id>>();
+    auto v         = immer::vector<tracked>{};
+    for (auto i = 0; i < 1000; ++i)
+        v = v.push_back(tracked{});
+    v = std::move(v).set(500, tracked{destroyer});
+
+    immer::reclaimer r{2};
+    r.release(std::move(v));
+    r.flush();
+    CHECK(destroyer->load() != std::thread::id{});
+    CHECK(destroyer->load() != std::this_thread::get_id());
+}
+
+TEST_CASE("releasing a shared container frees nothing")
+{
+    auto m = immer::map<int, int>{};
+    for (auto i = 0; i < 1000; ++i)
+        m = m.set(i, i);
+    auto copy = m;
+    immer::reclaimer r;
+    r.release(std::move(copy));
+    r.flush();
+    CHECK(m.size() == 1000u);
+    CHECK(m[42] == 42);
+}
+
+TEST_CASE("reclaimer destroys pending values when destroyed")
+{
+    auto destroyer = std::make_shared<std::atomic<std::thread::id>>();
+    {
+        immer::reclaimer r{1};
+        for (auto i = 0; i < 100; ++i)
+            r.release(immer::vector<int>(1000, i));
+        r.release(immer::vector<tracked>{}.push_back(tracked{destroyer}));
+    }
+    CHECK(destroyer->load() != std::thread::id{});
+    CHECK(destroyer->load() != std::this_thread::get_id());
+}
+
+TEST_CASE("release async")
+{
+    auto v = immer::vector<int>(10000, 42);
+    immer::release_async(std::move(v));
+    immer::reclaimer::global().flush();
+}
@@ -0,0 +1,136 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/array.hpp>
+#include <immer/array_transient.hpp>
+#include <immer/box.hpp>
+#include <immer/flex_vector.hpp>
+#include <immer/flex_vector_transient.hpp>
+#include <immer/relocatable.hpp>
+#include <immer/set.hpp>
+#include <immer/set_transient.hpp>
+#include <immer/vector.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstddef>
+#include <memory>
+
+namespace {
+
+// counts the moves of elements that the containers should relocate
+struct counted
+{
+    static std::size_t moves;
+
+    int value;
+
+    counted(int v)
+        : value{v}
+    {}
+    counted(const counted& x)
+        : value{x.value}
+    {}
+    counted(counted&& x) noexcept
+        : value{x.value}
+    {
+        ++moves;
+    }
+    counted& operator=(const counted&) = default;
+    counted& operator=(counted&&)      = default;
+    ~counted() {}
+
+    bool operator==(const counted& x) const { return value == x.value; }
+    bool operator!=(const counted& x) const { return value != x.value; }
+};
+
+std::size_t counted::moves = 0;
+
+// every element collides with all the others
+struct bad_hash
+{
+    std::size_t operator()(const counted&) const { return 42; }
+};
+
+} // namespace
+
+namespace immer {
+template <>
+struct is_trivially_relocatable<counted> : std::true_type
+{};
+} // namespace immer
+
+static_assert(immer::is_trivially_relocatable<int>::value, "");
+static_assert(!immer::is_trivially_relocatable<std::unique_ptr<int>>::value,
+              "");
+static_assert(immer::is_trivially_relocatable<immer::box<int>>::value, "");
+static_assert(immer::is_trivially_relocatable<immer::vector<int>>::value,
+              "");
+
+TEST_CASE("push_front relocates the leaf")
+{
+    const auto n = 666;
+    auto v       = immer::flex_vector<counted>{}.transient();
+    counted::moves = 0;
+    for (auto i = 0; i < n; ++i)
+        v.push_front(counted{i});
+    // each element is moved into the parameter and then into the leaf
+    CHECK(counted::moves <= std::size_t{2 * n});
+    for (auto i = 0; i < n; ++i)
+        CHECK(v[i].value == n - i - 1);
+}
+
+TEST_CASE("drop relocates the leaf")
+{
+    const auto n = 666;
+    auto v       = immer::flex_vector<counted>{}.transient();
+    for (auto i = 0; i < n; ++i)
+        v.push_back(counted{i});
+    counted::moves = 0;
+    for (auto i = 1; i < n; ++i) {
+        v.drop(1);
+        CHECK(v.size() == std::size_t(n - i));
+        CHECK(v[0].value == i);
+    }
+    CHECK(counted::moves == 0);
+}
+
+TEST_CASE("array growth relocates the elements")
+{
+    const auto n = 666;
+    auto v       = immer::array<counted>{}.transient();
+    for (auto i = 0; i < n; ++i)
+        v.push_back(counted{i});
+    counted::moves = 0;
+    for (auto i = n; i < 2 * n; ++i)
+        v.push_back(counted{i});
+    // only the new elements are moved, never the old ones
+    CHECK(counted::moves <= std::size_t{2 * n});
+    for (auto i = 0; i < 2 * n; ++i)
+        CHECK(v[i].value == i);
+}
+
+TEST_CASE("collisions relocate the elements")
+{
+    const auto n = 200;
+    auto s       = immer::set<counted, bad_hash>{}.transient();
+    for (auto i = 0; i < n; ++i)
+        s.insert(counted{i});
+    counted::moves = 0;
+    for (auto i = n; i < 2 * n; ++i)
+        s.insert(counted{i});
+    // the new element is passed down the tree by value a few times
+    CHECK(counted::moves <= std::size_t{4 * n});
+    CHECK(s.size() == std::size_t{2 * n});
+    for (auto i = 0; i < 2 * n; i += 2)
+        s.erase(counted{i});
+    CHECK(counted::moves <= std::size_t{5 * n});
+    CHECK(s.size() == std::size_t{n});
+    for (auto i = 0; i < 2 * n; ++i)
+        CHECK(s.count(counted{i}) == std::size_t(i % 2));
+}
@@ -0,0 +1,159 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/algorithm.hpp>
+#include <immer/flex_vector.hpp>
+#include <immer/heap/arena_heap.hpp>
+#include <immer/heap/cpp_heap.hpp>
+#include <immer/map.hpp>
+#include <immer/repack.hpp>
+#include <immer/set.hpp>
+#include <immer/vector.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstddef>
+#include <string>
+
+namespace {
+
+using heap_t = immer::arena_heap<immer::cpp_heap>;
+using memory = immer::memory_policy<immer::heap_policy<heap_t>,
+                                    immer::refcount_policy,
+                                    immer::default_lock_policy>;
+
+template <typename T>
+using vector_t = immer::vector<T, memory, 3u, 2u>;
+template <typename T>
+using flex_vector_t = immer::flex_vector<T, memory, 3u, 2u>;
+
+// half of the keys collide with each other
+struct bad_hash
+{
+    std::size_t operator()(const std::string& s) const
+    {
+        return s.size() % 2 ? 42 : std::hash<std::string>{}(s);
+    }
+};
+
+using map_t = immer::map<std::string, std::string, bad_hash, std::equal_to<>,
+                         memory>;
+using set_t = immer::set<std::string, std::hash<std::string>,
+                         std::equal_to<std::string>, memory>;
+
+struct arena
+{
+    void* a = heap_t::make_arena();
+    ~arena() { heap_t::release_arena(a); }
+    operator void*() const { return a; }
+};
+
+template <typename Vector>
+bool chunks_ascend(const Vector& v)
+{
+    auto prev = static_cast<const void*>(nullptr);
+    auto ok   = true;
+    immer::for_each_chunk(v, [&](auto fst, auto) {
+        ok   = ok && prev < static_cast<const void*>(fst);
+        prev = fst;
+    });
+    return ok;
+}
+
+} // namespace
+
+TEST_CASE("repack vector")
+{
+    auto ar = arena{};
+    auto v  = vector_t<std::string>{};
+    for (auto i = 0; i < 666; ++i)
+        v = std::move(v).push_back(std::to_string(i));
+    // scatter the leaves with updates
+    for (auto i = 0; i < 666; i += 7)
+        v = std::move(v).set(i, std::to_string(i) + "!");
+
+    auto w = immer::repack(v, ar);
+    CHECK(w == v);
+    CHECK(w.identity() != v.identity());
+    CHECK(chunks_ascend(w));
+
+    auto u = w.push_back("x").set(0, "y");
+    CHECK(u.size() == 667);
+    CHECK(u[0] == "y");
+    CHECK(w[0] == "0!");
+    CHECK(w == v);
+}
+
+TEST_CASE("repack empty and small vectors")
+{
+    auto ar = arena{};
+    CHECK(immer::repack(vector_t<int>{}, ar).empty());
+    auto v = vector_t<int>{1, 2, 3};
+    CHECK(immer::repack(v, ar) == v);
+}
+
+TEST_CASE("repack keeps the sharing of a filled vector")
+{
+    auto ar = arena{};
+    auto v  = vector_t<int>(100000, 42);
+    auto w  = immer::repack(v, ar);
+    CHECK(w == v);
+    CHECK(&w[0] == &w[4]);
+    CHECK(&w[0] != &v[0]);
+}
+
+TEST_CASE("repack flex_vector")
+{
+    auto ar = arena{};
+    auto v  = flex_vector_t<int>{};
+    auto x  = flex_vector_t<int>{};
+    for (auto i = 0; i < 300; ++i) {
+        v = i % 3 ? v.push_back(i) : v.push_front(i);
+        x = x.push_back(-i);
+    }
+    v = v.drop(5) + x;
+    REQUIRE(v.impl().root->relaxed());
+
+    auto w = immer::repack(v, ar);
+    CHECK(w == v);
+    CHECK(chunks_ascend(w));
+    CHECK((w + w).size() == 2 * v.size());
+    CHECK(w.insert(100, -1)[100] == -1);
+}
+
+TEST_CASE("repack map")
+{
+    auto ar = arena{};
+    auto m  = map_t{};
+    for (auto i = 0; i < 1000; ++i)
+        m = std::move(m).set(std::to_string(i), std::to_string(i * 2));
+
+    auto r = immer::repack(m, ar);
+    CHECK(r == m);
+    CHECK(r.size() == m.size());
+    for (auto i = 0; i < 1000; ++i)
+        CHECK(r[std::to_string(i)] == std::to_string(i * 2));
+
+    auto s = r.erase("1").set("2", "x").set("abc", "y");
+    CHECK(s.size() == 1000);
+    CHECK(!s.count("1"));
+    CHECK(s["2"] == "x");
+    CHECK(r["2"] == "4");
+    CHECK(r == m);
+}
+
+TEST_CASE("repack set")
+{
+    auto ar = arena{};
+    auto s  = set_t{};
+    for (auto i = 0; i < 1000; ++i)
+        s = std::move(s).insert(std::to_string(i));
+    auto r = immer::repack(s, ar);
+    CHECK(r == s);
+    CHECK(immer::repack(set_t{}, ar).empty());
+}
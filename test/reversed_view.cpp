@@ -0,0 +1,84 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/algorithm.hpp>
+#include <immer/flex_vector.hpp>
+#include <immer/reversed_view.hpp>
+#include <immer/vector.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+template <typename Vector>
+Vector make_relaxed(int n)
+{
+    auto v = Vector{};
+    for (auto i = 0; i < n; ++i)
+        v = std::move(v).push_front(n - 1 - i);
+    return v;
+}
+
+} // namespace
+
+TEST_CASE("reversed view")
+{
+    auto v = immer::vector<int>{};
+    for (auto i = 0; i < 1000; ++i)
+        v = std::move(v).push_back(i);
+    auto r = immer::reversed(v);
+
+    CHECK(r.size() == 1000u);
+    CHECK(r.front() == 999);
+    CHECK(r.back() == 0);
+    CHECK(r[1] == 998);
+    CHECK(r.at(999) == 0);
+    CHECK_THROWS_AS(r.at(1000), std::out_of_range);
+    CHECK(r.vector() == v);
+
+    auto expected = std::vector<int>(v.rbegin(), v.rend());
+    CHECK(std::vector<int>(r.begin(), r.end()) == expected);
+
+    auto chunks = std::vector<int>{};
+    immer::for_each_chunk(
+        r, [&](auto f, auto l) { chunks.insert(chunks.end(), f, l); });
+    CHECK(chunks == expected);
+
+    auto found = immer::find_if(r, [](int x) { return x % 7 == 0; });
+    REQUIRE(found != r.end());
+    CHECK(*found == 994);
+    CHECK(immer::accumulate(r, 0) == 999 * 1000 / 2);
+    CHECK(immer::reversed(immer::vector<int>{}).empty());
+}
+
+TEST_CASE("reversed view of relaxed trees")
+{
+    using vector_t = immer::flex_vector<std::string>;
+    auto v         = make_relaxed<immer::flex_vector<int>>(3000);
+    auto w = v.drop(17) + v.take(1234) + immer::flex_vector<int>{-1, -2};
+    auto r = immer::reversed(w);
+
+    auto expected = std::vector<int>(w.rbegin(), w.rend());
+    auto chunks   = std::vector<int>{};
+    immer::for_each_chunk(
+        r, [&](auto f, auto l) { chunks.insert(chunks.end(), f, l); });
+    CHECK(chunks == expected);
+
+    auto m = r.materialize();
+    CHECK(m.size() == w.size());
+    CHECK(std::vector<int>(m.begin(), m.end()) == expected);
+    CHECK(immer::reverse(m) == w);
+    CHECK(immer::reverse(w, immer::thread_executor{4}) == m);
+
+    auto s = vector_t{"a", "b", "c"};
+    CHECK(immer::reverse(s) == vector_t{"c", "b", "a"});
+    CHECK(immer::reverse(vector_t{}).empty());
+}
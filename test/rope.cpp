@@ -0,0 +1,119 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/rope.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+using immer::rope;
+
+namespace {
+
+// a rope made of many pieces, so that it has plenty of leaves and
+// relaxed nodes
+std::pair<rope, std::string> make_text(int lines)
+{
+    auto r = rope{};
+    auto s = std::string{};
+    for (auto i = 0; i < lines; ++i) {
+        auto line = "line " + std::to_string(i) + " says hello\n";
+        r         = i % 2 ? r + rope{line} : rope{line} + r;
+        s         = i % 2 ? s + line : line + s;
+    }
+    return {r, s};
+}
+
+} // namespace
+
+TEST_CASE("rope editing")
+{
+    auto r = rope{"hello world"};
+    CHECK(r.size() == 11);
+    CHECK(r.str() == "hello world");
+    CHECK(r.substr(6).str() == "world");
+    CHECK(r.substr(0, 5) == rope{"hello"});
+    CHECK(r.insert(5, rope{","}).str() == "hello, world");
+    CHECK(r.erase(5, 100).str() == "hello");
+    CHECK(r.erase(0, 6).push_back('!').str() == "world!");
+    CHECK(r.str() == "hello world");
+}
+
+TEST_CASE("rope search")
+{
+    auto t = make_text(500);
+    auto r = t.first;
+    auto s = t.second;
+    CHECK(r.str() == s);
+
+    for (auto needle : {"line 1", "hello\nline 4", "says", "99 says", "\n"}) {
+        auto from = std::size_t{};
+        for (auto k = 0; k < 20; ++k) {
+            auto expected = s.find(needle, from);
+            auto found    = r.find(needle, from);
+            CHECK(found == (expected == std::string::npos ? rope::npos
+                                                          : expected));
+            if (found == rope::npos)
+                break;
+            from = found + 1;
+        }
+    }
+    CHECK(r.find("not there") == rope::npos);
+    CHECK(r.find("", 3) == 3);
+    CHECK(r.find('9') == s.find('9'));
+    CHECK(r.find('9', 1000) == s.find('9', 1000));
+    CHECK(r.find('#') == rope::npos);
+    CHECK(r.find(s.substr(s.size() - 30)) == s.size() - 30);
+}
+
+TEST_CASE("rope lines")
+{
+    auto t     = make_text(500);
+    auto r     = t.first;
+    auto s     = t.second;
+    auto index = rope::line_index{0};
+    CHECK(r.line_count(index) == 501);
+
+    auto offset = std::size_t{};
+    for (auto line = 0u; line < 500; ++line) {
+        CHECK(r.line_offset(line, index) == offset);
+        CHECK(r.line_of(offset, index) == line);
+        offset = s.find('\n', offset) + 1;
+    }
+    CHECK(r.line_offset(500, index) == s.size());
+    CHECK(r.line_offset(501, index) == s.size());
+
+    SECTION("after an edit")
+    {
+        auto pos = r.line_offset(100, index);
+        auto r2  = r.insert(pos, rope{"a\nb\n"});
+        CHECK(r2.line_count(index) == 503);
+        CHECK(r2.line_offset(102, index) == pos + 4);
+        CHECK(r2.line_offset(101, index) == pos + 2);
+        CHECK(r.line_offset(101, index) == s.find('\n', pos) + 1);
+    }
+}
+
+TEST_CASE("rope utf8 slices")
+{
+    // "añb€c", with two and three byte code points
+    auto r = rope{"a\xC3\xB1"
+                  "b\xE2\x82\xAC"
+                  "c"};
+    CHECK(r.size() == 8);
+    CHECK(r.utf8_floor(0) == 0);
+    CHECK(r.utf8_floor(2) == 1);
+    CHECK(r.utf8_floor(5) == 4);
+    CHECK(r.utf8_floor(6) == 4);
+    CHECK(r.utf8_floor(7) == 7);
+    CHECK(r.utf8_floor(8) == 8);
+    CHECK(r.utf8_substr(2, 7).str() == "\xC3\xB1"
+                                       "b\xE2\x82\xAC");
+    CHECK(r.utf8_substr(5, 5).empty());
+}
@@ -0,0 +1,29 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/hash_cache.hpp>
+#include <immer/set.hpp>
+
+// the values are embedded with the default heap too, when asked
+using embed_memory = immer::memory_policy<
+    immer::default_heap_policy,
+    immer::default_refcount_policy,
+    immer::default_lock_policy,
+    immer::get_transience_policy_t<immer::default_refcount_policy>,
+    false,
+    true,
+    true>;
+
+template <typename T,
+          typename Hash = std::hash<T>,
+          typename Eq   = std::equal_to<T>>
+using test_set_t =
+    immer::set<T, immer::hash_cache<Hash>, Eq, embed_memory, 3u>;
+
+#define SET_T test_set_t
+#include "generic.ipp"
@@ -418,6 +418,27 @@ TEST_CASE("erase conflicts")
     }
 }
 
+TEST_CASE("erase many and erase if")
+{
+    constexpr auto N = 666u;
+    auto vals        = make_values_with_collisions(N);
+    auto s           = make_test_set(vals);
+    auto gone        = std::vector<conflictor>{};
+    for (auto i = 0u; i < N; i += 3)
+        gone.push_back(vals[i]);
+
+    auto v = s.erase_many(gone);
+    CHECK(s.size() == N);
+    CHECK(v.size() == N - gone.size());
+    for (auto i : test_irange(0u, N))
+        CHECK(v.count(vals[i]) == (i % 3 != 0));
+    CHECK(std::move(s).erase_many(gone) == v);
+
+    auto w = make_test_set(N).erase_if([](auto x) { return x >= 100u; });
+    CHECK(w == make_test_set(100u));
+    CHECK(std::move(w).erase_if([](auto x) { return x % 2; }).size() == 50u);
+}
+
 TEST_CASE("accumulate")
 {
     const auto n = 666u;
@@ -755,3 +776,49 @@ TEST_CASE("diff")
     test_diff(1500, 10, 1000);
     test_diff(16, 1500, 10);
 }
+
+TEST_CASE("filter")
+{
+    auto s = make_test_set(1000);
+
+    CHECK(immer::filter(s, [](unsigned) { return true; }).identity() ==
+          s.identity());
+    CHECK(immer::filter(s, [](unsigned) { return false; }).empty());
+
+    auto r = immer::filter(s, [](unsigned x) { return x % 3 == 0; });
+    CHECK(r.size() == 334u);
+    for (auto i = 0u; i < 1000u; ++i)
+        CHECK(r.count(i) == (i % 3 == 0));
+    CHECK(r.size() ==
+          static_cast<std::size_t>(std::distance(r.begin(), r.end())));
+    CHECK(r.insert(1u).erase(1u) == r);
+
+    SECTION("collisions")
+    {
+        auto vals = make_values_with_collisions(100);
+        auto c    = make_test_set(vals);
+        auto f    = immer::filter(c, [](const conflictor& x) {
+            return x.v2 % 2 == 0;
+        });
+        auto n    = std::count_if(vals.begin(), vals.end(), [](auto& x) {
+            return x.v2 % 2 == 0;
+        });
+        CHECK(f.size() == static_cast<std::size_t>(n));
+        for (auto& v : vals)
+            CHECK(f.count(v) == (v.v2 % 2 == 0));
+    }
+}
+
+TEST_CASE("precomputed hash")
+{
+    using set_t = SET_T<unsigned>;
+    auto h      = typename set_t::hasher{};
+    auto s      = make_test_set(1000);
+    for (auto i = 0u; i < 1100u; ++i)
+        CHECK(s.find_hashed(i, h(i)) == s.find(i));
+
+    auto a = s.insert_hashed(2000u, h(2000u));
+    CHECK(a == s.insert(2000u));
+    CHECK(s.insert_hashed(7u, h(7u)) == s);
+    CHECK(std::move(a).insert_hashed(2001u, h(2001u)).count(2001u) == 1);
+}
@@ -0,0 +1,308 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/algorithm.hpp>
+#include <immer/hash_cache.hpp>
+#include <immer/map.hpp>
+#include <immer/set.hpp>
+#include <immer/table.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <stdexcept>
+
+namespace {
+
+struct colliding_hash
+{
+    std::size_t operator()(int x) const { return x % 7; }
+};
+
+using set_t = immer::set<int>;
+using collision_set_t =
+    immer::set<int, colliding_hash, std::equal_to<int>>;
+using b3_set_t = immer::set<int,
+                            immer::hash_cache<std::hash<int>>,
+                            std::equal_to<int>,
+                            immer::default_memory_policy,
+                            3u>;
+using map_t = immer::map<int, int>;
+
+template <typename Set>
+std::size_t count(const Set& s)
+{
+    return static_cast<std::size_t>(std::distance(s.begin(), s.end()));
+}
+
+template <typename Set>
+Set make_set(std::mt19937& gen, int n, int range)
+{
+    auto s = Set{};
+    for (auto i = 0; i < n; ++i)
+        s = std::move(s).insert(static_cast<int>(gen() % range));
+    return s;
+}
+
+template <typename Set, typename Pred>
+Set slow_filter(const Set& a, Pred pred)
+{
+    auto s = Set{};
+    for (auto& x : a)
+        if (pred(x))
+            s = std::move(s).insert(x);
+    return s;
+}
+
+template <typename Set>
+void check_algebra(const Set& a, const Set& b)
+{
+    auto u = immer::set_union(a, b);
+    auto i = immer::set_intersection(a, b);
+    auto d = immer::set_difference(a, b);
+
+    auto slow_u = a;
+    for (auto& x : b)
+        slow_u = std::move(slow_u).insert(x);
+    CHECK(u == slow_u);
+    CHECK(u.size() == slow_u.size());
+    CHECK(count(u) == u.size());
+
+    auto slow_i = slow_filter(a, [&](int x) { return b.count(x) > 0; });
+    CHECK(i == slow_i);
+    CHECK(count(i) == i.size());
+
+    auto slow_d = slow_filter(a, [&](int x) { return b.count(x) == 0; });
+    CHECK(d == slow_d);
+    CHECK(count(d) == d.size());
+
+    // the results are regular sets
+    CHECK(d.insert(-1000).erase(-1000) == d);
+    for (auto& x : i)
+        CHECK(i.erase(x).size() == i.size() - 1);
+}
+
+template <typename Set>
+void check_random(int n, int range)
+{
+    auto gen = std::mt19937{42};
+    for (auto round = 0; round < 20; ++round) {
+        auto a = make_set<Set>(gen, n, range);
+        auto b = make_set<Set>(gen, n, range);
+        check_algebra(a, b);
+        check_algebra(b, a);
+        check_algebra(a, Set{});
+        check_algebra(Set{}, a);
+    }
+}
+
+} // namespace
+
+TEST_CASE("random sets")
+{
+    check_random<set_t>(200, 400);
+    check_random<set_t>(2000, 100000);
+    check_random<b3_set_t>(500, 1000);
+}
+
+TEST_CASE("collisions")
+{
+    check_random<collision_set_t>(20, 40);
+    check_random<collision_set_t>(200, 400);
+}
+
+TEST_CASE("sharing")
+{
+    auto a = set_t{};
+    for (auto i = 0; i < 10000; ++i)
+        a = std::move(a).insert(i);
+
+    CHECK(immer::set_union(a, a).identity() == a.identity());
+    CHECK(immer::set_intersection(a, a).identity() == a.identity());
+    CHECK(immer::set_difference(a, a).empty());
+
+    // two versions derived from a common one
+    auto b = a.insert(-1).insert(-2).erase(42);
+    auto c = a.insert(-3).erase(42).erase(43);
+    check_algebra(b, c);
+    check_algebra(c, b);
+
+    auto u = immer::set_union(b, c);
+    CHECK(u.size() == 10002);
+    CHECK(immer::set_intersection(b, c).size() == 9998);
+    CHECK(immer::set_difference(b, c).size() == 3);
+    CHECK(immer::set_difference(c, b).size() == 1);
+    CHECK(immer::set_intersection(a, b).size() == 9999);
+    CHECK(immer::set_intersection(b, a).size() == 9999);
+
+    // nothing is copied when nothing is removed
+    auto sub = a.erase(7);
+    CHECK(immer::set_intersection(sub, a).identity() == sub.identity());
+    CHECK(immer::set_difference(sub, b).identity() != sub.identity());
+    CHECK(immer::set_difference(a, set_t{}).identity() == a.identity());
+}
+
+TEST_CASE("map union keeps the first value")
+{
+    auto a = map_t{}.set(1, 10).set(2, 20);
+    auto b = map_t{}.set(2, 200).set(3, 300);
+    auto u = immer::set_union(a, b);
+    CHECK(u.size() == 3);
+    CHECK(u[1] == 10);
+    CHECK(u[2] == 20);
+    CHECK(u[3] == 300);
+
+    auto i = immer::set_intersection(b, a);
+    CHECK(i.size() == 1);
+    CHECK(i[2] == 200);
+    CHECK(immer::set_difference(a, b) == map_t{}.set(1, 10));
+}
+
+TEST_CASE("tables")
+{
+    struct item
+    {
+        int id;
+        int value;
+    };
+    using table_t = immer::table<item>;
+    auto a        = table_t{{1, 10}, {2, 20}};
+    auto b        = table_t{{2, 200}, {3, 300}};
+    CHECK(immer::set_union(a, b).size() == 3);
+    CHECK(immer::set_union(a, b)[2].value == 20);
+    CHECK(immer::set_intersection(b, a)[2].value == 200);
+    CHECK(immer::set_difference(a, b).count(1) == 1);
+    CHECK(immer::set_difference(a, b).size() == 1);
+}
+
+TEST_CASE("map merge")
+{
+    auto max = [](int x, int y) { return std::max(x, y); };
+
+    auto base = map_t{};
+    for (auto i = 0; i < 5000; ++i)
+        base = std::move(base).set(i, i);
+    auto a = base.set(10, 100).set(20, -1).set(-5, 5);
+    auto b = base.set(10, 50).set(20, 200).set(-6, 6).erase(30);
+
+    auto m = a.merge(b, max);
+    CHECK(m.size() == 5002);
+    CHECK(m[10] == 100);
+    CHECK(m[20] == 200);
+    CHECK(m[30] == 30);
+    CHECK(m[-5] == 5);
+    CHECK(m[-6] == 6);
+    CHECK(m == b.merge(a, max));
+    CHECK(a.merge(a, max).identity() == a.identity());
+
+    auto gen   = std::mt19937{13};
+    auto c     = map_t{};
+    auto d     = map_t{};
+    auto slow  = map_t{};
+    for (auto i = 0; i < 3000; ++i) {
+        auto k = static_cast<int>(gen() % 4000);
+        auto v = static_cast<int>(gen() % 100);
+        if (gen() % 2)
+            c = std::move(c).set(k, v);
+        else
+            d = std::move(d).set(k, v);
+    }
+    slow = c;
+    for (auto& kv : d) {
+        auto x = slow.find(kv.first);
+        slow   = std::move(slow).set(kv.first, x ? *x - kv.second : kv.second);
+    }
+    auto md = c.merge(d, [](int x, int y) { return x - y; });
+    CHECK(md == slow);
+    CHECK(md.size() == slow.size());
+}
+
+TEST_CASE("parallel union")
+{
+    auto ex   = immer::thread_executor{4};
+    auto gen  = std::mt19937{7};
+    auto base = make_set<set_t>(gen, 20000, 1000000);
+    auto a    = base;
+    auto b    = base;
+    for (auto i = 0; i < 500; ++i) {
+        a = std::move(a).insert(static_cast<int>(gen() % 2000000));
+        b = std::move(b).insert(static_cast<int>(gen() % 2000000));
+    }
+    auto u = immer::par_set_union(a, b, ex);
+    CHECK(u == immer::set_union(a, b));
+    CHECK(u.size() == immer::set_union(a, b).size());
+    CHECK(immer::par_set_union(a, a, ex).identity() == a.identity());
+    CHECK(immer::par_set_union(a, set_t{}, ex) == a);
+    CHECK(immer::par_set_union(set_t{}, b, ex) == b);
+    CHECK(immer::par_set_union(collision_set_t{1, 8, 15},
+                               collision_set_t{8, 22},
+                               ex) == collision_set_t{1, 8, 15, 22});
+
+    auto m = map_t{};
+    auto n = map_t{};
+    for (auto i = 0; i < 10000; ++i) {
+        m = std::move(m).set(i, i);
+        n = std::move(n).set(i * 2, -i);
+    }
+    auto plus = [](int x, int y) { return x + y; };
+    auto pm   = m.par_merge(n, plus, ex);
+    CHECK(pm == m.merge(n, plus));
+    CHECK(pm.size() == 15000);
+
+    SECTION("exceptions")
+    {
+        auto fail = [](int x, int y) -> int {
+            if (x == 4000)
+                throw std::runtime_error{"conflict"};
+            return x + y;
+        };
+        CHECK_THROWS_AS(m.par_merge(n, fail, ex), std::runtime_error);
+        CHECK_THROWS_AS(m.merge(n, fail), std::runtime_error);
+    }
+}
+
+TEST_CASE("partition by hash")
+{
+    auto gen = std::mt19937{42};
+
+    auto check = [](const auto& s, unsigned log2_parts) {
+        using set_type = std::decay_t<decltype(s)>;
+        using hash_t   = typename set_type::hasher;
+        auto parts     = immer::partition_by_hash(s, log2_parts);
+        REQUIRE(parts.size() == std::size_t{1} << log2_parts);
+        auto mask  = (std::size_t{1} << log2_parts) - 1;
+        auto total = std::size_t{};
+        for (auto i = std::size_t{}; i < parts.size(); ++i) {
+            auto expected = slow_filter(
+                s, [&](int x) { return (hash_t{}(x) & mask) == i; });
+            CHECK(parts[i] == expected);
+            CHECK(parts[i].size() == count(parts[i]));
+            total += parts[i].size();
+        }
+        CHECK(total == s.size());
+        CHECK(immer::join_partitions(parts) == s);
+    };
+
+    for (auto log2_parts : {0u, 1u, 3u, 5u, 6u, 11u}) {
+        check(make_set<set_t>(gen, 3000, 100000), log2_parts);
+        check(make_set<b3_set_t>(gen, 3000, 100000), log2_parts);
+        check(make_set<collision_set_t>(gen, 300, 100000), log2_parts);
+        check(set_t{}, log2_parts);
+        check(set_t{1, 2}, log2_parts);
+    }
+
+    auto m = map_t{};
+    for (auto i = 0; i < 1000; ++i)
+        m = std::move(m).set(i, -i);
+    auto parts = immer::partition_by_hash(m, 4);
+    CHECK(parts.size() == 16);
+    CHECK(immer::join_partitions(parts) == m);
+    CHECK(immer::join_partitions(std::vector<map_t>{}).empty());
+}
@@ -104,3 +104,34 @@ TEST_CASE("erase many from non transient")
         CHECK(t.size() == static_cast<std::size_t>(n - i - 1));
     }
 }
+
+TEST_CASE("erase many at once")
+{
+    auto t    = SET_T<int>{}.transient();
+    auto gone = std::vector<int>{};
+    for (auto i = 0; i < 1000; ++i) {
+        t.insert(i);
+        if (i % 10)
+            gone.push_back(i);
+    }
+    t.erase_many(gone);
+    CHECK(t.size() == 100);
+    CHECK(t.count(10) == 1);
+    CHECK(t.count(11) == 0);
+    t.erase_if([](int x) { return x >= 500; });
+    CHECK(t.size() == 50);
+    CHECK(t.count(490) == 1);
+    CHECK(t.count(500) == 0);
+}
+
+TEST_CASE("precomputed hash")
+{
+    auto t = SET_TRANSIENT_T<std::string>{};
+    auto h = typename SET_TRANSIENT_T<std::string>::hasher{};
+    t.insert_hashed("foo", h("foo"));
+    t.insert_hashed("foo", h("foo"));
+    CHECK(t.size() == 1);
+    CHECK(*t.find_hashed("foo", h("foo")) == "foo");
+    CHECK(t.find_hashed("bar", h("bar")) == nullptr);
+    CHECK(t.persistent() == SET_T<std::string>{"foo"});
+}
@@ -0,0 +1,95 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/sharded_atom_map.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("sharded atom map basics")
+{
+    immer::sharded_atom_map<int, std::string, 8> m;
+    for (auto i = 0; i < 1000; ++i)
+        m.set(i, std::to_string(i));
+    CHECK(m.count(42) == 1u);
+    CHECK(m.count(1000) == 0u);
+    CHECK(m.get(42) == "42");
+    CHECK(m.get(1000) == "");
+
+    m.update(42, [](auto s) { return s + "!"; });
+    m.update(1000, [](auto s) { return s + "?"; });
+    m.erase(7);
+    CHECK(m.get(42) == "42!");
+    CHECK(m.get(1000) == "?");
+    CHECK(m.count(7) == 0u);
+
+    auto s = m.snapshot();
+    CHECK(s.size() == 1000u);
+    CHECK(*s.find(42) == "42!");
+    CHECK(s.find(7) == nullptr);
+    auto total = std::size_t{};
+    for (auto i = 0u; i < m.shard_count; ++i) {
+        CHECK(s.shard(i).size() == m.load_shard(i)->size());
+        CHECK(s.shard(i).size() > 0u);
+        total += s.shard(i).size();
+    }
+    CHECK(total == 1000u);
+
+    m.set(7, "7");
+    CHECK(s.count(7) == 0u);
+}
+
+TEST_CASE("single shard")
+{
+    immer::sharded_atom_map<int, int, 1> m;
+    m.set(1, 2);
+    CHECK(m.get(1) == 2);
+    CHECK(m.snapshot().size() == 1u);
+}
+
+TEST_CASE("concurrent writers and snapshots")
+{
+    constexpr auto threads = 4;
+    constexpr auto n       = 2000;
+
+    immer::sharded_atom_map<int, int> m;
+    std::atomic<int> done{0};
+    auto workers = std::vector<std::thread>{};
+    for (auto i = 0; i < threads; ++i)
+        workers.emplace_back([&, i] {
+            for (auto j = 0; j < n; ++j)
+                m.set(i * n + j, j);
+            ++done;
+        });
+
+    // every writer inserts its keys in order, so a consistent snapshot
+    // has a prefix of the keys of each writer
+    auto consistent = true;
+    while (done.load() < threads) {
+        auto s = m.snapshot();
+        for (auto i = 0; i < threads; ++i) {
+            auto j = 0;
+            while (j < n && s.count(i * n + j))
+                ++j;
+            for (; j < n; ++j)
+                consistent = consistent && !s.count(i * n + j);
+        }
+    }
+    for (auto& w : workers)
+        w.join();
+
+    CHECK(consistent);
+    CHECK(m.snapshot().size() == threads * n);
+    for (auto k = 0; k < threads * n; ++k)
+        CHECK(m.get(k) == k % n);
+}
@@ -0,0 +1,103 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/algorithm.hpp>
+#include <immer/flex_vector.hpp>
+#include <immer/slice_view.hpp>
+#include <immer/vector.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+template <typename V>
+V make_test_vector(unsigned n)
+{
+    auto v = V{};
+    for (auto i = 0u; i < n; ++i)
+        v = v.push_back(i);
+    return v;
+}
+
+template <typename V>
+void check_slice_view(V v)
+{
+    using view_t = immer::slice_view<V>;
+    const auto n = static_cast<unsigned>(v.size());
+
+    for (auto first : {0u, 1u, 31u, 32u, n / 3, n - 1}) {
+        for (auto last : {first, first + 1, n / 2, n - 33, n}) {
+            if (last < first || last > n)
+                continue;
+            auto s = view_t{v, first, last};
+            CHECK(s.size() == last - first);
+            CHECK(s.empty() == (first == last));
+            CHECK(std::equal(s.begin(),
+                             s.end(),
+                             std::next(v.begin(), first),
+                             std::next(v.begin(), last)));
+            for (auto i = 0u; i < s.size(); ++i)
+                CHECK(s[i] == first + i);
+
+            auto chunks = std::vector<unsigned>{};
+            immer::for_each_chunk(s, [&](auto f, auto l) {
+                chunks.insert(chunks.end(), f, l);
+            });
+            CHECK(std::equal(
+                chunks.begin(), chunks.end(), s.begin(), s.end()));
+            auto sum = (last * (last - 1) - first * (first - 1)) / 2;
+            CHECK(immer::accumulate(s, 0u) == sum);
+            CHECK(immer::all_of(s, [&](auto x) { return x >= first; }));
+
+            auto m = s.materialize();
+            CHECK(m.size() == s.size());
+            CHECK(std::equal(m.begin(), m.end(), s.begin(), s.end()));
+        }
+    }
+
+    auto s = view_t{v}.slice(10, n - 10).slice(5, 20);
+    CHECK(s.size() == 15);
+    CHECK(s.front() == 15);
+    CHECK(s.back() == 29);
+    CHECK(*s.rbegin() == 29);
+    CHECK(s.at(3) == 18);
+    CHECK_THROWS_AS(s.at(15), std::out_of_range);
+    CHECK(s.vector().identity() == v.identity());
+}
+
+} // namespace
+
+TEST_CASE("vector slice_view")
+{
+    check_slice_view(make_test_vector<immer::vector<unsigned>>(666u));
+    check_slice_view(make_test_vector<immer::vector<unsigned>>(40u));
+}
+
+TEST_CASE("flex_vector slice_view")
+{
+    using vector_t = immer::flex_vector<unsigned>;
+    auto v         = make_test_vector<vector_t>(666u);
+    check_slice_view(v);
+    check_slice_view(v.take(300) + v.drop(300));
+
+    auto s = immer::slice_view<vector_t>{v, 100, 500};
+    auto m = s.materialize();
+    CHECK(m == v.drop(100).take(400));
+}
+
+TEST_CASE("empty slice_view")
+{
+    auto s = immer::slice_view<immer::vector<int>>{};
+    CHECK(s.empty());
+    CHECK(s.begin() == s.end());
+    CHECK(s.materialize().empty());
+}
@@ -0,0 +1,97 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/small_map.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <unordered_map>
+
+TEST_CASE("small map")
+{
+    auto m = immer::small_map<std::string, int, 4>{};
+    CHECK(m.empty());
+    CHECK(m.is_small());
+    CHECK(m.find("foo") == nullptr);
+    CHECK(m["foo"] == 0);
+    CHECK_THROWS_AS(m.at("foo"), std::out_of_range);
+
+    auto m1 = m.set("foo", 1).set("bar", 2);
+    CHECK(m1.size() == 2);
+    CHECK(m1.is_small());
+    CHECK(m1["foo"] == 1);
+    CHECK(m1.at("bar") == 2);
+    CHECK(m1.set("foo", 3)["foo"] == 3);
+    CHECK(m1.set("foo", 3).size() == 2);
+    CHECK(m1.update("foo", [](int x) { return x + 10; })["foo"] == 11);
+    CHECK(m1.update("baz", [](int x) { return x + 10; })["baz"] == 10);
+    CHECK(m1.erase("foo").count("foo") == 0);
+    CHECK(m1.erase("foo").count("bar") == 1);
+    CHECK(m1.erase("nope") == m1);
+    CHECK(m1 == (immer::small_map<std::string, int, 4>{{"bar", 2},
+                                                       {"foo", 1}}));
+    CHECK(m1 != m1.set("foo", 2));
+}
+
+TEST_CASE("small map promotion")
+{
+    using map_t = immer::small_map<unsigned, unsigned, 8>;
+    auto m      = map_t{};
+    auto ref    = std::unordered_map<unsigned, unsigned>{};
+    for (auto i = 0u; i < 100u; ++i) {
+        m      = m.set(i, i * 2);
+        ref[i] = i * 2;
+        CHECK(m.is_small() == (i < 8u));
+        CHECK(m.size() == ref.size());
+    }
+    for (auto i = 0u; i < 100u; ++i)
+        CHECK(m[i] == i * 2);
+    auto count = 0u;
+    for (auto&& x : m) {
+        CHECK(ref.at(x.first) == x.second);
+        ++count;
+    }
+    CHECK(count == 100u);
+
+    auto small = map_t{};
+    for (auto i = 0u; i < 4u; ++i)
+        small = small.set(i, i * 2);
+    for (auto i = 99u; i >= 4u; --i) {
+        m = m.erase(i);
+        CHECK(m.is_small() == (i <= 4u));
+    }
+    CHECK(m.is_small());
+    CHECK(m == small);
+    CHECK(m.update(7u, [](unsigned x) { return x + 1; })[7u] == 1u);
+}
+
+TEST_CASE("small set")
+{
+    using set_t = immer::small_set<int, 4>;
+    auto s      = set_t{1, 2, 3};
+    CHECK(s.size() == 3);
+    CHECK(s.is_small());
+    CHECK(s.insert(2) == s);
+    CHECK(s.count(2) == 1);
+    CHECK(*s.find(3) == 3);
+    CHECK(s.find(4) == nullptr);
+    CHECK(s.erase(2).count(2) == 0);
+    CHECK(s.erase(2).size() == 2);
+
+    auto b = s.insert(4).insert(5).insert(6);
+    CHECK(!b.is_small());
+    CHECK(b.size() == 6);
+    CHECK(b == (set_t{6, 5, 4, 3, 2, 1}));
+    auto sum = 0;
+    for (auto x : b)
+        sum += x;
+    CHECK(sum == 21);
+    CHECK(b.erase(6).erase(5).erase(4).erase(3).is_small());
+    CHECK(b.erase(6).erase(5).erase(4).erase(3) == (set_t{1, 2}));
+}
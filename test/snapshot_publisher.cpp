@@ -0,0 +1,90 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/map.hpp>
+#include <immer/snapshot_publisher.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct tracked
+{
+    std::shared_ptr<int> alive = std::make_shared<int>(0);
+    int value                  = 0;
+};
+
+} // namespace
+
+TEST_CASE("read, publish and update")
+{
+    immer::snapshot_publisher<immer::map<int, int>> p;
+    CHECK(p.read()->size() == 0u);
+    p.publish(immer::map<int, int>{}.set(1, 1));
+    p.update([](auto m) { return m.set(2, 2); });
+    {
+        auto r = p.read();
+        CHECK(r->size() == 2u);
+        CHECK((*r)[2] == 2);
+        auto nested = p.read();
+        CHECK(&nested.get() == &r.get());
+    }
+    auto copy = p.load();
+    p.update([](auto m) { return m.erase(1); });
+    CHECK(copy.size() == 2u);
+    CHECK(p.load().size() == 1u);
+}
+
+TEST_CASE("old versions live through the grace period")
+{
+    auto first = tracked{};
+    auto alive = std::weak_ptr<int>{first.alive};
+    immer::snapshot_publisher<tracked> p{std::move(first)};
+    auto r = p.read();
+    p.publish(tracked{});
+    p.publish(tracked{});
+    CHECK(!alive.expired());
+    CHECK(r->value == 0);
+    {
+        auto moved = std::move(r);
+    }
+    p.synchronize();
+    CHECK(alive.expired());
+}
+
+TEST_CASE("concurrent readers and writer")
+{
+    using map_t = immer::map<int, int>;
+    immer::snapshot_publisher<map_t> p;
+    std::atomic<bool> done{false};
+    std::atomic<bool> sane{true};
+    auto readers = std::vector<std::thread>{};
+    for (auto i = 0; i < 4; ++i)
+        readers.emplace_back([&] {
+            while (!done.load()) {
+                auto r = p.read();
+                auto n = static_cast<int>(r->size());
+                // every version holds the keys [0, n)
+                if (n && (!r->count(n - 1) || r->at(n - 1) != n - 1))
+                    sane = false;
+            }
+        });
+    for (auto i = 0; i < 1000; ++i)
+        p.update([&](const map_t& m) { return m.set(i, i); });
+    done = true;
+    for (auto& r : readers)
+        r.join();
+    p.synchronize();
+    CHECK(sane);
+    CHECK(p.load().size() == 1000u);
+}
@@ -0,0 +1,156 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/algorithm.hpp>
+#include <immer/hash_cache.hpp>
+#include <immer/map.hpp>
+#include <immer/map_transient.hpp>
+#include <immer/set.hpp>
+#include <immer/set_transient.hpp>
+#include <immer/sorted_collisions.hpp>
+#include <immer/table.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// every key collides with all the others
+struct bad_hash
+{
+    std::size_t operator()(const std::string&) const { return 42; }
+    std::size_t operator()(unsigned) const { return 42; }
+};
+
+using hash_t = immer::sorted_collisions<bad_hash>;
+
+template <typename C>
+bool is_sorted_by_key(const C& c)
+{
+    auto keys = std::vector<std::string>{};
+    for (auto&& x : c)
+        keys.push_back(x.first);
+    return std::is_sorted(keys.begin(), keys.end());
+}
+
+std::vector<std::string> make_keys(unsigned n)
+{
+    auto keys = std::vector<std::string>{};
+    for (auto i = 0u; i < n; ++i)
+        keys.push_back(std::to_string(i));
+    std::shuffle(keys.begin(), keys.end(), std::mt19937{42});
+    return keys;
+}
+
+struct item
+{
+    std::string id;
+    int value;
+
+    bool operator==(const item& other) const
+    {
+        return id == other.id && value == other.value;
+    }
+};
+
+} // namespace
+
+TEST_CASE("sorted collisions in map")
+{
+    using map_t = immer::map<std::string, int, hash_t>;
+    auto keys   = make_keys(300);
+    auto m      = map_t{};
+    for (auto i = 0u; i < keys.size(); ++i)
+        m = m.set(keys[i], int(i));
+    CHECK(m.size() == keys.size());
+    CHECK(is_sorted_by_key(m));
+    for (auto i = 0u; i < keys.size(); ++i) {
+        CHECK(m.count(keys[i]) == 1);
+        CHECK(m[keys[i]] == int(i));
+    }
+    CHECK(m.find("nope") == nullptr);
+    CHECK(m.find("") == nullptr);
+
+    auto m2 = m.set(keys[7], 1000).erase(keys[9]).update(
+        "zzz", [](int x) { return x + 1; });
+    CHECK(is_sorted_by_key(m2));
+    CHECK(m2[keys[7]] == 1000);
+    CHECK(m2.count(keys[9]) == 0);
+    CHECK(m2["zzz"] == 1);
+    CHECK(m2.size() == m.size());
+
+    auto r = map_t{};
+    for (auto i = keys.size(); i-- > 0;)
+        r = std::move(r).set(keys[i], int(i));
+    CHECK(r == m);
+
+    auto t = map_t{}.transient();
+    for (auto i = 0u; i < keys.size(); ++i)
+        t.set(keys[i], int(i));
+    for (auto i = 0u; i < keys.size(); i += 2)
+        t.erase(keys[i]);
+    auto p = t.persistent();
+    CHECK(is_sorted_by_key(p));
+    CHECK(p.size() == keys.size() / 2);
+    for (auto i = 0u; i < keys.size(); ++i)
+        CHECK(p.count(keys[i]) == (i % 2 ? 1u : 0u));
+
+    auto values =
+        immer::transform_values(m, [](int x) { return std::to_string(x); });
+    CHECK(is_sorted_by_key(values));
+    CHECK(values[keys[3]] == "3");
+}
+
+TEST_CASE("sorted collisions in set and table")
+{
+    using set_t = immer::set<unsigned, immer::hash_cache<hash_t>>;
+    auto s = set_t{};
+    for (auto i = 0u; i < 200u; ++i)
+        s = s.insert((i * 7919u) % 200u);
+    CHECK(std::is_sorted(s.begin(), s.end()));
+    for (auto i = 0u; i < 200u; ++i)
+        CHECK(s.count(i) == 1);
+    CHECK(s.count(200u) == 0);
+
+    auto evens = immer::filter(s, [](unsigned x) { return x % 2 == 0; });
+    CHECK(evens.size() == 100u);
+    CHECK(std::is_sorted(evens.begin(), evens.end()));
+    auto u = immer::set_union(evens, s);
+    CHECK(u == s);
+    CHECK(std::is_sorted(u.begin(), u.end()));
+
+    struct item_key
+    {
+        const std::string& operator()(const item& x) const { return x.id; }
+        item operator()(item x, std::string k) const
+        {
+            x.id = std::move(k);
+            return x;
+        }
+    };
+    using table_t = immer::table<item, item_key, hash_t>;
+    auto keys     = make_keys(100);
+    auto t        = table_t{};
+    for (auto& k : keys)
+        t = t.insert({k, 1});
+    t = t.update(keys[5], [](item x) {
+        x.value = 5;
+        return x;
+    });
+    CHECK(t.size() == keys.size());
+    CHECK(t[keys[5]].value == 5);
+    CHECK(t.find("nope") == nullptr);
+    auto ids = std::vector<std::string>{};
+    for (auto& x : t)
+        ids.push_back(x.id);
+    CHECK(std::is_sorted(ids.begin(), ids.end()));
+}
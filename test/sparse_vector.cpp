@@ -0,0 +1,206 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/sparse_vector.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using ref_t = std::map<std::uint64_t, int>;
+
+template <typename It>
+bool equal_to(const std::vector<std::pair<std::uint64_t, int>>& out,
+              It first,
+              It last)
+{
+    return std::equal(
+        out.begin(), out.end(), first, last, [](auto& a, auto& b) {
+            return a.first == b.first && a.second == b.second;
+        });
+}
+
+template <typename SV>
+bool same(const SV& v, const ref_t& ref)
+{
+    if (v.stored() != ref.size())
+        return false;
+    for (auto& kv : ref)
+        if (v[kv.first] != kv.second)
+            return false;
+    auto out = std::vector<std::pair<std::uint64_t, int>>{};
+    v.for_each([&](auto i, auto x) { out.emplace_back(i, x); });
+    return equal_to(out, ref.begin(), ref.end());
+}
+
+} // namespace
+
+TEST_CASE("sparse vector basics")
+{
+    using vec_t = immer::sparse_vector<int>;
+
+    auto v = vec_t{10};
+    CHECK(v.size() == 10);
+    CHECK(v.stored() == 0);
+    CHECK(v[3] == 0);
+    CHECK(v.find(3) == nullptr);
+    CHECK_THROWS_AS(v.at(10), std::out_of_range);
+
+    auto w = v.set(3, 42).set(7, 0);
+    CHECK(w.size() == 10);
+    CHECK(w.stored() == 2);
+    CHECK(w[3] == 42);
+    CHECK(w.at(7) == 0);
+    CHECK(w.find(7) != nullptr);
+    CHECK(v.stored() == 0);
+
+    auto x = w.set(100, 1);
+    CHECK(x.size() == 101);
+    CHECK(x[100] == 1);
+    CHECK(w.size() == 10);
+
+    CHECK(x.update(3, [](int a) { return a + 1; })[3] == 43);
+    CHECK(x.update(5, [](int a) { return a + 1; })[5] == 1);
+    CHECK(x.erase(100).erase(7) == vec_t{101}.set(3, 42));
+    CHECK(x.erase(100).size() == 101);
+    CHECK(x.erase(50).identity() == x.identity());
+}
+
+TEST_CASE("sparse vector of huge size")
+{
+    using vec_t = immer::sparse_vector<std::string>;
+
+    const auto big = std::uint64_t{1} << 40;
+    auto v         = vec_t{big}
+                 .set(0, "first")
+                 .set(big - 1, "last")
+                 .set(big / 2, "middle");
+    CHECK(v.size() == big);
+    CHECK(v.stored() == 3);
+    CHECK(v[big - 1] == "last");
+    CHECK(v[big / 2] == "middle");
+    CHECK(v[big / 2 + 1] == "");
+
+    auto seen = std::vector<std::uint64_t>{};
+    v.for_each([&](auto i, auto&) { seen.push_back(i); });
+    CHECK(seen == (std::vector<std::uint64_t>{0, big / 2, big - 1}));
+
+    seen.clear();
+    v.for_each(1, big - 1, [&](auto i, auto&) { seen.push_back(i); });
+    CHECK(seen == std::vector<std::uint64_t>{big / 2});
+
+    auto w = v.erase(big - 1).erase(big / 2);
+    CHECK(w.stored() == 1);
+    CHECK(w == vec_t{big}.set(0, "first"));
+    CHECK(v.take(big / 2) == vec_t{big / 2}.set(0, "first"));
+    CHECK(v.take(0) == vec_t{});
+
+    const auto max = vec_t::max_size;
+    CHECK(vec_t{}.set(max - 1, "x")[max - 1] == "x");
+    CHECK_THROWS_AS(vec_t{}.set(max, "x"), std::out_of_range);
+}
+
+TEST_CASE("sparse vector moves")
+{
+    using vec_t = immer::sparse_vector<int>;
+
+    auto v = vec_t{}.set(5, 1).set(1000, 2);
+    auto p = v.find(5);
+    v      = std::move(v).set(5, 3);
+    CHECK(v.find(5) == p);
+    CHECK(v[5] == 3);
+
+    auto w = v;
+    auto x = std::move(v).set(5, 4);
+    CHECK(w[5] == 3);
+    CHECK(x[5] == 4);
+    x = std::move(x).update(1000, [](int a) { return a * 10; });
+    CHECK(x[1000] == 20);
+    CHECK(w[1000] == 2);
+}
+
+TEST_CASE("sparse vector against a map")
+{
+    using vec_t = immer::sparse_vector<int>;
+
+    auto gen   = std::mt19937_64{42};
+    auto index = [&] {
+        // mostly clustered, sometimes far away
+        return gen() % 4 ? gen() % 5000 : gen() % (std::uint64_t{1} << 40);
+    };
+
+    auto v        = vec_t{};
+    auto ref      = ref_t{};
+    auto versions = std::vector<std::pair<vec_t, ref_t>>{};
+    for (auto i = 0; i < 4000; ++i) {
+        auto k = index();
+        if (gen() % 3) {
+            auto x = static_cast<int>(gen() % 100);
+            v      = gen() % 2 ? v.set(k, x) : std::move(v).set(k, x);
+            ref[k] = x;
+        } else if (!ref.empty() && gen() % 2) {
+            auto it = ref.lower_bound(k);
+            if (it == ref.end())
+                it = ref.begin();
+            v = v.erase(it->first);
+            ref.erase(it);
+        } else {
+            v = v.erase(k);
+            ref.erase(k);
+        }
+        if (i % 500 == 0)
+            versions.emplace_back(v, ref);
+    }
+    CHECK(same(v, ref));
+    for (auto& x : versions)
+        CHECK(same(x.first, x.second));
+
+    SECTION("range scans")
+    {
+        for (auto i = 0; i < 100; ++i) {
+            auto first = index();
+            auto last  = first + gen() % 10000;
+            auto out   = std::vector<std::pair<std::uint64_t, int>>{};
+            v.for_each(first, last, [&](auto j, auto x) {
+                out.emplace_back(j, x);
+            });
+            CHECK(equal_to(out, ref.lower_bound(first), ref.lower_bound(last)));
+        }
+    }
+
+    SECTION("take")
+    {
+        for (auto i = 0; i < 100; ++i) {
+            auto n = gen() % 2 ? index() : gen() % v.size();
+            auto w = v.take(n);
+            auto r = ref_t{ref.begin(), ref.lower_bound(n)};
+            CHECK(w.size() == std::min<std::uint64_t>(n, v.size()));
+            CHECK(same(w, r));
+        }
+    }
+
+    SECTION("equality")
+    {
+        auto w = vec_t{};
+        for (auto it = ref.rbegin(); it != ref.rend(); ++it)
+            w = w.set(it->first, it->second);
+        if (!ref.count(v.size() - 1))
+            w = w.set(v.size() - 1, 0).erase(v.size() - 1);
+        CHECK(w == v);
+        CHECK(w.set(v.size(), 0) != v);
+        CHECK(w.erase(ref.begin()->first) != v);
+    }
+}
@@ -0,0 +1,155 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/algorithm.hpp>
+#include <immer/executor.hpp>
+#include <immer/map.hpp>
+#include <immer/set.hpp>
+#include <immer/split_range.hpp>
+#include <immer/table.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#if IMMER_HAS_TBB
+#include <tbb/parallel_reduce.h>
+#endif
+
+namespace {
+
+// half of the keys collide with each other
+struct bad_hash
+{
+    std::size_t operator()(int x) const
+    {
+        return x % 2 ? 42 : std::hash<int>{}(x);
+    }
+};
+
+struct row
+{
+    int id;
+    std::string name;
+};
+
+template <typename Range>
+std::size_t count_all(const Range& r)
+{
+    return immer::accumulate(r, std::size_t{}, [](auto acc, auto&&) {
+        return acc + 1;
+    });
+}
+
+// splits down to the pieces that can not be divided any further
+template <typename Range, typename Fn>
+void split_all(Range r, Fn&& fn)
+{
+    while (r.is_divisible()) {
+        auto s = r.split();
+        CHECK(!r.empty());
+        CHECK(!s.empty());
+        split_all(std::move(s), fn);
+    }
+    fn(r);
+}
+
+} // namespace
+
+TEST_CASE("split range of a set")
+{
+    using set_t   = immer::set<int>;
+    using range_t = immer::split_range<set_t>;
+
+    CHECK(range_t{}.empty());
+    CHECK(range_t{set_t{}}.empty());
+    CHECK(!range_t{set_t{}}.is_divisible());
+    CHECK(range_t{set_t{}}.partition(8).empty());
+
+    auto s = set_t{};
+    for (auto i = 0; i < 5000; ++i)
+        s = std::move(s).insert(i);
+
+    auto seen   = std::vector<int>(5000);
+    auto pieces = 0;
+    split_all(range_t{s}, [&](auto& r) {
+        ++pieces;
+        immer::for_each(r, [&](int x) { ++seen[x]; });
+    });
+    CHECK(pieces > 32);
+    for (auto x : seen)
+        CHECK(x == 1);
+
+    auto small = set_t{}.insert(1);
+    CHECK(!range_t{small}.is_divisible());
+    CHECK(count_all(range_t{small}) == 1);
+}
+
+TEST_CASE("split range of a map with collisions")
+{
+    using map_t = immer::map<int, int, bad_hash>;
+
+    auto m = map_t{};
+    for (auto i = 0; i < 1000; ++i)
+        m = std::move(m).set(i, i * 2);
+
+    auto total = std::size_t{};
+    split_all(immer::split_range<map_t>{m}, [&](auto& r) {
+        immer::for_each(r, [&](auto& kv) { CHECK(kv.second == kv.first * 2); });
+        total += count_all(r);
+    });
+    CHECK(total == 1000);
+}
+
+TEST_CASE("partition a split range for an executor")
+{
+    using table_t = immer::table<row>;
+
+    auto t = table_t{};
+    for (auto i = 0; i < 3000; ++i)
+        t = std::move(t).insert({i, std::to_string(i)});
+
+    auto range = immer::split_range<table_t>{t};
+    for (auto n : {1u, 2u, 7u, 64u}) {
+        auto parts = range.partition(n);
+        CHECK(parts.size() == n);
+        auto ex = immer::thread_executor{4};
+        std::atomic<long> sum{0};
+        ex.bulk(parts.size(), [&](std::size_t i) {
+            immer::for_each(parts[i], [&](const row& r) { sum += r.id; });
+        });
+        CHECK(sum.load() == 2999l * 3000 / 2);
+    }
+
+    // a tiny container gives as many parts as it can
+    auto small = table_t{}.insert({1, "a"}).insert({2, "b"});
+    CHECK(immer::split_range<table_t>{small}.partition(10).size() <= 2);
+}
+
+#if IMMER_HAS_TBB
+TEST_CASE("split range with tbb")
+{
+    using set_t = immer::set<int>;
+
+    auto s = set_t{};
+    for (auto i = 0; i < 10000; ++i)
+        s = std::move(s).insert(i);
+
+    auto sum = tbb::parallel_reduce(
+        immer::split_range<set_t>{s},
+        0l,
+        [](const immer::split_range<set_t>& r, long acc) {
+            return immer::accumulate(r, acc);
+        },
+        [](long a, long b) { return a + b; });
+    CHECK(sum == 9999l * 10000 / 2);
+}
+#endif
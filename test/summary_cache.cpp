@@ -0,0 +1,142 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/flex_vector.hpp>
+#include <immer/summary_cache.hpp>
+#include <immer/vector.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <numeric>
+
+namespace {
+
+struct plus_t
+{
+    long operator()(long a, long b) const { return a + b; }
+};
+
+struct min_t
+{
+    int operator()(int a, int b) const { return std::min(a, b); }
+};
+
+template <typename V>
+long slow_sum(const V& v, std::size_t first, std::size_t last)
+{
+    return std::accumulate(v.begin() + first, v.begin() + last, 0l);
+}
+
+} // namespace
+
+TEST_CASE("summary cache over vector")
+{
+    using vector_t = immer::vector<int, immer::default_memory_policy, 3, 2>;
+    auto v         = vector_t{};
+    for (auto i = 0; i < 1000; ++i)
+        v = std::move(v).push_back(i);
+    auto cache = immer::summary_cache<vector_t, long, plus_t>{0};
+
+    CHECK(cache.reduce(vector_t{}) == 0);
+    CHECK(cache.reduce(v) == slow_sum(v, 0, v.size()));
+    CHECK(cache.size() > 0);
+
+    SECTION("ranges")
+    {
+        for (auto f = 0u; f < v.size(); f += 37)
+            for (auto l = f; l <= v.size(); l += 91)
+                CHECK(cache.reduce(v, f, l) == slow_sum(v, f, l));
+    }
+
+    SECTION("updates")
+    {
+        auto size = cache.size();
+        auto v2   = v.set(500, 0).push_back(42);
+        CHECK(cache.reduce(v2) == slow_sum(v2, 0, v2.size()));
+        CHECK(cache.reduce(v) == slow_sum(v, 0, v.size()));
+        CHECK(cache.size() > size);
+        v = {};
+        cache.trim();
+        CHECK(cache.size() <= size);
+        CHECK(cache.reduce(v2) == slow_sum(v2, 0, v2.size()));
+        v2 = {};
+        cache.trim();
+        CHECK(cache.size() == 0);
+    }
+
+    SECTION("move")
+    {
+        auto other = std::move(cache);
+        CHECK(cache.size() == 0);
+        CHECK(other.reduce(v.take(100)) == slow_sum(v, 0, 100));
+    }
+}
+
+TEST_CASE("summary cache over flex_vector")
+{
+    using vector_t =
+        immer::flex_vector<int, immer::default_memory_policy, 3, 2>;
+    auto v = vector_t{};
+    for (auto i = 0; i < 1000; ++i)
+        v = std::move(v).push_front(i);
+    v = v + v.drop(333);
+
+    SECTION("slices and concatenations")
+    {
+        auto cache = immer::summary_cache<vector_t, long, plus_t>{0};
+        for (auto f = 0u; f < v.size(); f += 41) {
+            for (auto l = f; l <= v.size(); l += 103) {
+                auto s = v.drop(f).take(l - f);
+                CHECK(cache.reduce(s) == slow_sum(v, f, l));
+                CHECK(cache.reduce(v, f, l) == slow_sum(v, f, l));
+                auto c = s + v.take(f);
+                CHECK(cache.reduce(c) == slow_sum(c, 0, c.size()));
+            }
+        }
+    }
+
+    SECTION("reuses the summaries")
+    {
+        auto calls = 0;
+        auto count = [&](int a, int b) {
+            ++calls;
+            return std::min(a, b);
+        };
+        auto cache = immer::summary_cache<vector_t, int, decltype(count)>{
+            1 << 30, count};
+        CHECK(cache.reduce(v) == 0);
+        calls  = 0;
+        auto s = v.drop(100).take(1000);
+        CHECK(cache.reduce(s) == *std::min_element(s.begin(), s.end()));
+        // there are less than twenty leaves and inner nodes on the
+        // paths to the edges of the slice, with at most eight summaries
+        // or four elements each
+        CHECK(calls < 200);
+    }
+
+    SECTION("find first prefix")
+    {
+        auto cache = immer::summary_cache<vector_t, long, plus_t>{0};
+        auto total = cache.reduce(v);
+        for (auto k = 1l; k < total; k += total / 97) {
+            auto i = cache.find_first(v, [&](long x) { return x >= k; });
+            CHECK(slow_sum(v, 0, i + 1) >= k);
+            CHECK(slow_sum(v, 0, i) < k);
+        }
+        CHECK(cache.find_first(v, [&](long x) { return x > total; }) ==
+              v.size());
+    }
+
+    SECTION("other monoids")
+    {
+        auto cache = immer::summary_cache<vector_t, int, min_t>{1 << 30};
+        auto s     = v.drop(10).take(20);
+        CHECK(cache.reduce(s) == *std::min_element(s.begin(), s.end()));
+    }
+}
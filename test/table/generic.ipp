@@ -194,6 +194,25 @@ TEST_CASE("find")
     CHECK(v.find(1234) == nullptr);
 }
 
+TEST_CASE("erase many and erase if")
+{
+    auto vals = make_values_with_collisions(1000u);
+    auto t    = make_test_map(vals);
+    auto keys = std::vector<conflictor>{};
+    for (auto i = 0u; i < 1000u; i += 2)
+        keys.push_back(vals[i].first);
+    auto v = t.erase_many(keys);
+    CHECK(v.size() == 500u);
+    for (auto i : test_irange(0u, 1000u))
+        CHECK(v.count(vals[i].first) == i % 2);
+
+    auto w = v.erase_if([](auto& x) { return x.second % 4 == 1; });
+    CHECK(w.size() == 250u);
+    for (auto i : test_irange(0u, 1000u))
+        CHECK(w.count(vals[i].first) == (i % 4 == 3));
+    CHECK(std::move(t).erase_many(keys) == v);
+}
+
 TEST_CASE("equals and insert")
 {
     const auto n = 666u;
@@ -265,6 +284,40 @@ TEST_CASE("accumulate")
     }
 }
 
+TEST_CASE("update if changed")
+{
+    auto v       = make_test_map(666u);
+    auto same    = [](auto&& p) { return p; };
+    auto incr_id = [](auto&& p) {
+        return std::make_pair(p.first, p.second + 1);
+    };
+
+    CHECK(v.insert_if_changed({3u, 3u}).identity() == v.identity());
+    CHECK(v.update_if_changed(42u, same).identity() == v.identity());
+
+    auto u = v.insert_if_changed({3u, 13u});
+    CHECK(u.identity() != v.identity());
+    CHECK(u[3u].second == 13u);
+    CHECK(v[3u].second == 3u);
+    CHECK(v.update_if_changed(42u, incr_id)[42u].second == 43u);
+    CHECK(v.update_if_changed(1000u, same).count(1000u));
+
+    SECTION("move")
+    {
+        auto id = v.identity();
+        v       = std::move(v).insert_if_changed({3u, 3u});
+        CHECK(v.identity() == id);
+        v = std::move(v).update_if_changed(42u, same);
+        CHECK(v.identity() == id);
+        for (auto i = 0u; i < 666u; ++i) {
+            v = std::move(v).update_if_changed(i, incr_id);
+            CHECK(v[i].second == i + 1);
+        }
+        v = std::move(v).insert_if_changed({1000u, 1u});
+        CHECK(v[1000u].second == 1u);
+    }
+}
+
 TEST_CASE("update a lot")
 {
     auto v       = make_test_map(666u);
@@ -576,3 +629,95 @@ TEST_CASE("const map")
     CHECK(it->first == "A");
     CHECK(it->second == 1);
 }
+
+TEST_CASE("transform values")
+{
+    auto t = table_map<uint32_t, uint32_t>{};
+    for (auto i = 0u; i < 1000u; ++i)
+        t = std::move(t).insert({i, i + 1});
+    auto r = immer::transform_values(t, [](const auto& x) {
+        return std::make_pair(x.first, std::to_string(x.second));
+    });
+    CHECK(r.size() == t.size());
+    for (auto i = 0u; i < 1000u; ++i)
+        CHECK(r[i].second == std::to_string(i + 1));
+    CHECK(r.erase(7u).count(7u) == 0);
+}
+
+TEST_CASE("precomputed hash")
+{
+    using table_t = table_map<uint32_t, uint32_t>;
+    auto h        = typename table_t::hasher{};
+    auto t        = make_test_map(1000);
+    for (auto i = 0u; i < 1100u; ++i)
+        CHECK(t.find_hashed(i, h(i)) == t.find(i));
+
+    auto a = t.insert_hashed({42u, 7u}, h(42u));
+    auto b = t.update_hashed(
+        43u, h(43u), [](auto x) { return std::make_pair(x.first, 0u); });
+    CHECK(a == t.insert({42u, 7u}));
+    CHECK(b[43u].second == 0u);
+    CHECK(b.size() == 1000u);
+}
+
+TEST_CASE("upsert many")
+{
+    auto add = [](auto old, auto x) {
+        old.second += x.second;
+        return old;
+    };
+    auto upsert_one = [&](auto t, auto x) {
+        return t.count(x.first) ? t.update(
+                                      x.first,
+                                      [&](auto old) { return add(old, x); })
+                                : t.insert(x);
+    };
+
+    SECTION("sequential semantics")
+    {
+        auto t    = make_test_map(1000);
+        auto vals = std::vector<std::pair<uint32_t, uint32_t>>{};
+        for (auto i = 500u; i < 1500u; ++i)
+            vals.push_back({i, 1u});
+        for (auto i = 1000u; i < 1200u; ++i)
+            vals.push_back({i, 10u});
+        auto expected = t;
+        for (auto&& x : vals)
+            expected = upsert_one(expected, x);
+
+        auto r = t.upsert_many(vals, add);
+        CHECK(r == expected);
+        CHECK(r.size() == 1500u);
+        CHECK(r[700u].second == 701u);
+        CHECK(r[1100u].second == 11u);
+        CHECK(t == make_test_map(1000));
+        CHECK(std::move(t).upsert_many(vals.begin(), vals.end(), add) ==
+              expected);
+    }
+
+    SECTION("keeps the key")
+    {
+        auto t = make_test_map(10).upsert_many(
+            std::vector<std::pair<uint32_t, uint32_t>>{{3u, 0u}},
+            [](auto, auto) { return std::make_pair(42u, 42u); });
+        CHECK(t.size() == 10u);
+        CHECK(t[3u].second == 42u);
+        CHECK(t.count(42u) == 0);
+    }
+
+    SECTION("collisions")
+    {
+        auto vals     = make_values_with_collisions(200);
+        auto t        = make_test_map(vals);
+        auto more     = vals;
+        for (auto& x : more)
+            x.second = 1u;
+        more.push_back({{1000u, 1u}, 5u});
+        auto expected = t;
+        for (auto&& x : more)
+            expected = upsert_one(expected, x);
+        auto r = t.upsert_many(more, add);
+        CHECK(r == expected);
+        CHECK(r.size() == 201u);
+    }
+}
@@ -17,6 +17,7 @@
 #endif
 
 #include <string>
+#include <vector>
 
 struct Item
 {
@@ -92,6 +93,21 @@ TEST_CASE("insert")
     CHECK(t.size() == 3);
 }
 
+TEST_CASE("erase many and erase if")
+{
+    auto t = SETUP_T::table_transient<Item>{};
+    for (auto i = 0; i < 100; ++i)
+        t.insert(Item{std::to_string(i), i});
+    t.erase_many(std::vector<std::string>{"1", "2", "3", "1000"});
+    CHECK(t.size() == 97);
+    CHECK(t.count("2") == 0);
+    CHECK(t["4"].value == 4);
+    t.erase_if([](auto& x) { return x.value >= 50; });
+    CHECK(t.size() == 47);
+    CHECK(t.count("50") == 0);
+    CHECK(t["49"].value == 49);
+}
+
 TEST_CASE("erase")
 {
     auto t = SETUP_T::table<Item>{{"foo", 12}, {"bar", 42}}.transient();
@@ -103,3 +119,40 @@ TEST_CASE("erase")
     CHECK(t.count("bar") == 1);
     CHECK(t.size() == 1);
 }
+
+TEST_CASE("precomputed hash")
+{
+    auto t = SETUP_T::table_transient<Item>{};
+    auto h = typename SETUP_T::table_transient<Item>::hasher{};
+    t.insert_hashed(Item{"foo", 42}, h("foo"));
+    t.update_hashed("foo", h("foo"), [](auto x) {
+        x.value += 1;
+        return x;
+    });
+    CHECK(t.find_hashed("foo", h("foo"))->value == 43);
+    CHECK(t.find_hashed("bar", h("bar")) == nullptr);
+    CHECK(t.size() == 1);
+}
+
+TEST_CASE("upsert many")
+{
+    auto m = SETUP_T::table<Item>{};
+    for (auto i = 0; i < 100; ++i)
+        m = m.insert(Item{std::to_string(i), i});
+    auto vals = std::vector<Item>{};
+    for (auto i = 50; i < 150; ++i)
+        vals.push_back(Item{std::to_string(i), 1000});
+    vals.push_back(Item{"7", 1});
+
+    auto t = m.transient();
+    t.upsert_many(vals, [](Item old, const Item& x) {
+        old.value += x.value;
+        return old;
+    });
+    CHECK(t.size() == 150);
+    CHECK(t["7"].value == 8);
+    CHECK(t["60"].value == 1060);
+    CHECK(t["120"].value == 1000);
+    CHECK(m.size() == 100);
+    CHECK(m["60"].value == 60);
+}
@@ -0,0 +1,204 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#define IMMER_TRACE_HOOKS 1
+
+#include <immer/flex_vector.hpp>
+#include <immer/flex_vector_transient.hpp>
+#include <immer/map.hpp>
+#include <immer/map_transient.hpp>
+#include <immer/trace.hpp>
+#include <immer/vector.hpp>
+#include <immer/vector_transient.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <cstddef>
+
+namespace {
+
+struct calls
+{
+    std::size_t count = 0;
+    std::size_t last  = 0;
+};
+
+calls concat_calls;
+calls collision_calls;
+calls persistent_calls;
+calls release_calls;
+calls miss_calls;
+
+struct bad_hash
+{
+    std::size_t operator()(int x) const { return x % 4; }
+};
+
+struct with_hooks
+{
+    with_hooks()
+    {
+        auto& h = immer::trace_hooks::get();
+        h       = immer::trace_hooks{};
+        for (auto c : {&concat_calls,
+                       &collision_calls,
+                       &persistent_calls,
+                       &release_calls,
+                       &miss_calls})
+            *c = calls{};
+        h.concat_rebalance = [](std::size_t n, std::size_t, unsigned) {
+            ++concat_calls.count;
+            concat_calls.last = n;
+        };
+        h.collision_node = [](std::size_t n) {
+            ++collision_calls.count;
+            collision_calls.last = n;
+        };
+        h.persistent = [](std::size_t n) {
+            ++persistent_calls.count;
+            persistent_calls.last = n;
+        };
+        h.release = [](std::size_t n) {
+            ++release_calls.count;
+            release_calls.last = n;
+        };
+        h.free_list_miss = [](std::size_t n) {
+            ++miss_calls.count;
+            miss_calls.last = n;
+        };
+    }
+
+    ~with_hooks() { immer::trace_hooks::get() = immer::trace_hooks{}; }
+};
+
+} // namespace
+
+TEST_CASE("concat rebalance")
+{
+    auto hooks = with_hooks{};
+    auto v     = immer::flex_vector<int>{};
+    for (auto i = 0; i < 1000; ++i)
+        v = std::move(v).push_back(i);
+    auto w = v.drop(3) + v;
+    CHECK(w.size() == 1997);
+    CHECK(concat_calls.count > 0);
+    CHECK(concat_calls.last > 0);
+}
+
+TEST_CASE("collision nodes")
+{
+    auto hooks = with_hooks{};
+    auto m     = immer::map<int, int, bad_hash>{};
+    for (auto i = 0; i < 8; ++i)
+        m = std::move(m).set(i, i);
+    CHECK(m.size() == 8);
+    CHECK(collision_calls.count > 0);
+    CHECK(collision_calls.last >= 2);
+}
+
+TEST_CASE("persistent")
+{
+    auto hooks = with_hooks{};
+
+    SECTION("vector")
+    {
+        auto t = immer::vector<int>{}.transient();
+        for (auto i = 0; i < 100; ++i)
+            t.push_back(i);
+        auto v = t.persistent();
+        CHECK(persistent_calls.count == 1);
+        CHECK(persistent_calls.last == 100);
+        auto w = std::move(t).persistent();
+        CHECK(persistent_calls.count == 2);
+        CHECK(w == v);
+    }
+
+    SECTION("map")
+    {
+        auto t = immer::map<int, int>{}.transient();
+        for (auto i = 0; i < 10; ++i)
+            t.set(i, i);
+        auto m = std::move(t).persistent();
+        CHECK(persistent_calls.count == 1);
+        CHECK(persistent_calls.last == m.size());
+    }
+}
+
+TEST_CASE("release")
+{
+    auto hooks = with_hooks{};
+    immer::trace_hooks::get().release_threshold = 16;
+
+    SECTION("small vectors are not reported")
+    {
+        { auto v = immer::vector<int>{1, 2, 3}; }
+        CHECK(release_calls.count == 0);
+    }
+
+    SECTION("big vectors are")
+    {
+        {
+            auto v = immer::vector<int>{};
+            for (auto i = 0; i < 10000; ++i)
+                v = std::move(v).push_back(i);
+            CHECK(release_calls.count == 0);
+        }
+        CHECK(release_calls.count == 1);
+        CHECK(release_calls.last > 100);
+    }
+
+    SECTION("and maps")
+    {
+        {
+            auto m = immer::map<int, int>{};
+            for (auto i = 0; i < 10000; ++i)
+                m = std::move(m).set(i, i);
+        }
+        CHECK(release_calls.count == 1);
+        CHECK(release_calls.last > 100);
+    }
+
+    SECTION("with the time that they took")
+    {
+        static auto time_calls = calls{};
+        static auto time       = std::chrono::nanoseconds{};
+        time_calls             = calls{};
+        immer::trace_hooks::get().release_time =
+            [](std::size_t n, std::chrono::nanoseconds t) {
+                ++time_calls.count;
+                time_calls.last = n;
+                time            = t;
+            };
+        {
+            auto v = immer::flex_vector<int>{};
+            for (auto i = 0; i < 10000; ++i)
+                v = std::move(v).push_back(i);
+            v = v.drop(7) + v;
+        }
+        CHECK(time_calls.count == 1);
+        CHECK(time_calls.last == release_calls.last);
+        CHECK(time.count() > 0);
+    }
+}
+
+TEST_CASE("free list miss")
+{
+    auto hooks = with_hooks{};
+    using heap   = immer::unsafe_free_list_heap_policy<immer::cpp_heap>;
+    using memory = immer::
+        memory_policy<heap, immer::refcount_policy, immer::spinlock_policy>;
+    using vector_t = immer::vector<int, memory>;
+    {
+        auto v = vector_t{};
+        for (auto i = 0; i < 1000; ++i)
+            v = std::move(v).push_back(i);
+    }
+    CHECK(miss_calls.count > 0);
+    CHECK(miss_calls.last > 0);
+}
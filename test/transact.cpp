@@ -0,0 +1,105 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/map.hpp>
+#include <immer/transact.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+TEST_CASE("transact two atoms")
+{
+    immer::atom<int> a{1};
+    immer::atom<int> b{2};
+    auto r = immer::transact(
+        a, b, [](int x, int y) { return std::make_pair(x + y, x * y); });
+    CHECK(*std::get<0>(r) == 3);
+    CHECK(*std::get<1>(r) == 2);
+    CHECK(a.load() == 3);
+    CHECK(b.load() == 2);
+
+    auto s = immer::snapshot(a, b);
+    CHECK(std::get<0>(s).get() == 3);
+    CHECK(&std::get<1>(s).get() == &b.load().get());
+}
+
+TEST_CASE("transact three atoms")
+{
+    immer::atom<int> a{1};
+    immer::atom<int> b{2};
+    immer::atom<int> c{3};
+    immer::transact(
+        a, b, c, [](int x, int y, int z) { return std::make_tuple(z, x, y); });
+    CHECK(a.load() == 3);
+    CHECK(b.load() == 1);
+    CHECK(c.load() == 2);
+}
+
+TEST_CASE("transact sees plain writes")
+{
+    immer::atom<int> a{1};
+    immer::atom<int> b{2};
+    auto calls = 0;
+    immer::transact(a, b, [&](int x, int y) {
+        if (calls++ == 0)
+            a.store(10);
+        return std::make_pair(x + 1, y + 1);
+    });
+    CHECK(calls == 2);
+    CHECK(a.load() == 11);
+    CHECK(b.load() == 3);
+}
+
+TEST_CASE("concurrent index and reverse index")
+{
+    using map_t = immer::map<int, int>;
+
+    constexpr auto threads = 4;
+    constexpr auto n       = 200;
+
+    immer::atom<map_t> index;
+    immer::atom<map_t> reverse;
+    std::atomic<bool> done{false};
+    std::atomic<bool> sane{true};
+    auto workers = std::vector<std::thread>{};
+    auto reader  = std::thread{[&] {
+        while (!done.load()) {
+            auto s  = immer::snapshot(index, reverse);
+            auto& m = *std::get<0>(s);
+            auto& r = *std::get<1>(s);
+            if (m.size() != r.size())
+                sane = false;
+            for (auto&& kv : m)
+                if (!r.count(kv.second) || r[kv.second] != kv.first)
+                    sane = false;
+        }
+    }};
+    for (auto i = 0; i < threads; ++i)
+        workers.emplace_back([&, i] {
+            for (auto j = 0; j < n; ++j) {
+                auto k = i * n + j;
+                immer::transact(
+                    index, reverse, [&](const map_t& m, const map_t& r) {
+                        return std::make_pair(m.set(k, -k), r.set(-k, k));
+                    });
+            }
+        });
+    for (auto&& w : workers)
+        w.join();
+    done = true;
+    reader.join();
+
+    CHECK(sane);
+    CHECK(index.load()->size() == threads * n);
+    CHECK(reverse.load()->size() == threads * n);
+}
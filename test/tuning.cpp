@@ -0,0 +1,79 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/flex_vector.hpp>
+#include <immer/map.hpp>
+#include <immer/set.hpp>
+#include <immer/tuning.hpp>
+#include <immer/vector.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>
+#include <cstddef>
+#include <string>
+
+namespace {
+
+using big_t = std::array<char, 1000>;
+
+struct alignas(64) aligned_t
+{
+    int x;
+};
+
+using mp_t = immer::default_memory_policy;
+
+} // namespace
+
+static_assert(immer::node_tuning<std::size_t>::bits == immer::default_bits,
+              "the default target keeps the default branching");
+static_assert(
+    immer::node_tuning<std::size_t>::bits_leaf ==
+        immer::detail::rbts::derive_bits_leaf<std::size_t, mp_t, 5>,
+    "the default target keeps the default leaves");
+static_assert(immer::node_tuning<std::size_t, 1024>::bits == 7, "");
+static_assert(immer::node_tuning<std::size_t, 64>::bits == 3, "");
+static_assert(immer::node_tuning<char>::bits_leaf >
+                  immer::node_tuning<std::size_t>::bits_leaf,
+              "small values get larger leaves");
+static_assert(immer::node_tuning<big_t>::bits_leaf == 0, "");
+static_assert(immer::node_tuning<aligned_t>::bits_leaf == 2, "");
+static_assert(immer::node_tuning<std::pair<int, int>>::champ_bits == 5, "");
+static_assert(immer::node_tuning<char>::champ_bits == 6, "");
+static_assert(immer::node_tuning<big_t>::champ_bits == 3, "");
+
+TEST_CASE("tuned vectors")
+{
+    auto v = immer::tuned_vector<std::size_t, mp_t, 1024>{};
+    auto f = immer::tuned_flex_vector<big_t>{};
+    for (auto i = 0u; i < 1000u; ++i) {
+        v = v.push_back(i);
+        f = f.push_back(big_t{{static_cast<char>(i)}});
+    }
+    CHECK(v.size() == 1000u);
+    CHECK(v[777] == 777u);
+    CHECK(f[42][0] == 42);
+    CHECK((f.take(500) + f.drop(500)) == f);
+}
+
+TEST_CASE("tuned maps and sets")
+{
+    using hash_t = std::hash<int>;
+    using eq_t   = std::equal_to<int>;
+    auto m = immer::tuned_map<int, std::string, hash_t, eq_t, mp_t, 128>{};
+    auto s = immer::tuned_set<char>{};
+    for (auto i = 0; i < 1000; ++i) {
+        m = m.set(i, std::to_string(i));
+        s = s.insert(static_cast<char>(i % 100));
+    }
+    CHECK(m.size() == 1000u);
+    CHECK(m[777] == "777");
+    CHECK(s.size() == 100u);
+    CHECK(s.count(42) == 1u);
+}
@@ -16,7 +16,9 @@
 
 #include <algorithm>
 #include <numeric>
+#include <random>
 #include <string>
+#include <tuple>
 #include <vector>
 
 using namespace std::string_literals;
@@ -102,6 +104,108 @@ TEST_CASE("instantiation")
     }
 }
 
+#ifndef VECTOR_NO_SHARED_FILL
+TEST_CASE("fill shares the full leaves")
+{
+    using vector_t   = VECTOR_T<unsigned>;
+    constexpr auto l = std::size_t{1} << vector_t::bits_leaf;
+    for (auto n : {std::size_t{1}, l, l + 1, 3 * l, 1000 * l + 3}) {
+        auto v = vector_t(n, 42u);
+        CHECK(v.size() == n);
+        CHECK(std::all_of(
+            v.begin(), v.end(), [](unsigned x) { return x == 42u; }));
+        auto chunks = std::vector<const unsigned*>{};
+        immer::for_each_chunk(v, [&](auto f, auto) { chunks.push_back(f); });
+        if (n > 2 * l)
+            CHECK(chunks[0] == chunks[1]);
+        auto w = v.set(n / 2, 7u);
+        CHECK(w[n / 2] == 7u);
+        CHECK(v[n / 2] == 42u);
+        CHECK(std::count(w.begin(), w.end(), 42u) ==
+              static_cast<std::ptrdiff_t>(n - 1));
+    }
+}
+#endif
+
+#ifndef VECTOR_NO_FROM_RANGE_PARALLEL
+TEST_CASE("from range parallel")
+{
+    using vector_t = VECTOR_T<unsigned>;
+    constexpr auto leaf = std::size_t{1} << vector_t::bits_leaf;
+    constexpr auto node = std::size_t{1} << vector_t::bits;
+
+    auto chunk_sizes = [](const vector_t& v) {
+        auto r = std::vector<std::size_t>{};
+        immer::for_each_chunk(
+            v, [&](auto f, auto l) { r.push_back(std::size_t(l - f)); });
+        return r;
+    };
+
+    SECTION("empty range")
+    {
+        auto r = std::vector<unsigned>{};
+        auto v = vector_t::from_range_parallel(r.begin(), r.end());
+        CHECK(v.size() == 0);
+        CHECK(v == vector_t{});
+    }
+
+    SECTION("same shape as sequential construction")
+    {
+        auto ex = immer::thread_executor{4};
+        for (auto n : {std::size_t{1},
+                       leaf,
+                       leaf + 1,
+                       leaf * node,
+                       leaf * node + 1,
+                       leaf * node * node + leaf + 3,
+                       std::size_t{666}}) {
+            auto r = std::vector<unsigned>(n);
+            std::iota(r.begin(), r.end(), 0u);
+            auto v = vector_t::from_range_parallel(r.begin(), r.end(), ex);
+            auto s = vector_t{r.begin(), r.end()};
+            CHECK(v.impl().shift == s.impl().shift);
+            CHECK(v.impl().tail_size() == s.impl().tail_size());
+            CHECK(chunk_sizes(v) == chunk_sizes(s));
+            CHECK_VECTOR_EQUALS(v, boost::irange(0u, unsigned(n)));
+            CHECK(v.push_back(42u).back() == 42u);
+        }
+    }
+
+    SECTION("sequential executor")
+    {
+        auto r = std::vector<unsigned>(1000u);
+        std::iota(r.begin(), r.end(), 0u);
+        auto v = vector_t::from_range_parallel(
+            r.begin(), r.end(), immer::sequential_executor{});
+        CHECK_VECTOR_EQUALS(v, boost::irange(0u, 1000u));
+    }
+
+    SECTION("exception safety")
+    {
+        using dadaist_vector_t = typename dadaist_wrapper<vector_t>::type;
+        auto r = std::vector<dadaist<unsigned>>{};
+        {
+            auto disable = dadaism::disable();
+            for (auto i = 0u; i < 666u; ++i)
+                r.push_back({i});
+        }
+        auto d = dadaism{};
+        for (auto done = false; !done;) {
+            auto s = d.next();
+            try {
+                auto v = dadaist_vector_t::from_range_parallel(
+                    r.begin(), r.end(), immer::sequential_executor{});
+                CHECK_VECTOR_EQUALS(v, boost::irange(0u, 666u));
+                done = true;
+            } catch (dada_error) {
+            }
+        }
+        CHECK(d.happenings > 0);
+        IMMER_TRACE_E(d.happenings);
+    }
+}
+#endif // VECTOR_NO_FROM_RANGE_PARALLEL
+
 TEST_CASE("back and front")
 {
     auto v = VECTOR_T<unsigned>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
@@ -162,6 +266,140 @@ TEST_CASE("push back one element")
     }
 }
 
+namespace {
+
+struct emplaced
+{
+    static unsigned moves;
+
+    unsigned a;
+    std::string b;
+
+    emplaced(unsigned a_, std::string b_)
+        : a{a_}
+        , b{std::move(b_)}
+    {}
+    emplaced(const emplaced&) = default;
+    emplaced(emplaced&& x)
+        : a{x.a}
+        , b{std::move(x.b)}
+    {
+        ++moves;
+    }
+    emplaced& operator=(const emplaced&) = default;
+    emplaced& operator=(emplaced&&)      = default;
+};
+
+unsigned emplaced::moves = 0;
+
+} // namespace
+
+TEST_CASE("emplace back")
+{
+    const auto n = 666u;
+    auto v       = VECTOR_T<emplaced>{};
+    emplaced::moves = 0;
+    for (auto i = 0u; i < n; ++i)
+        v = v.emplace_back(i, std::to_string(i));
+    CHECK(emplaced::moves == 0u);
+    CHECK(v.size() == n);
+    for (auto i = 0u; i < n; ++i) {
+        CHECK(v[i].a == i);
+        CHECK(v[i].b == std::to_string(i));
+    }
+
+    SECTION("rvalue")
+    {
+        auto w = std::move(v).emplace_back(n, "foo");
+        CHECK(w.size() == n + 1);
+        CHECK(w[n].a == n);
+        CHECK(w[n].b == "foo");
+    }
+
+    SECTION("default constructed")
+    {
+        auto w = VECTOR_T<std::string>{}.emplace_back().emplace_back(3u, 'x');
+        CHECK(w.size() == 2u);
+        CHECK(w[0] == "");
+        CHECK(w[1] == "xxx");
+    }
+}
+
+TEST_CASE("append range")
+{
+    const auto n = 666u;
+
+    SECTION("empty range")
+    {
+        const auto v = make_test_vector(0, 42);
+        const auto r = boost::irange(0u, 0u);
+        CHECK_VECTOR_EQUALS(v.append(r.begin(), r.end()),
+                            boost::irange(0u, 42u));
+    }
+
+    SECTION("many sizes")
+    {
+        for (auto i = 0u; i < n; i += 37) {
+            for (auto j = 0u; j < n; j += 41) {
+                const auto v = make_test_vector(0, i);
+                const auto r = boost::irange(i, i + j);
+                auto w       = v.append(r.begin(), r.end());
+                CHECK_VECTOR_EQUALS(v, boost::irange(0u, i));
+                CHECK_VECTOR_EQUALS(w, boost::irange(0u, i + j));
+            }
+        }
+    }
+
+    SECTION("move")
+    {
+        auto v = VECTOR_T<unsigned>{};
+        for (auto i = 0u; i < n;) {
+            const auto r = boost::irange(i, std::min(i + 13u, n));
+            v            = std::move(v).append(r.begin(), r.end());
+            i            = std::min(i + 13u, n);
+            CHECK_VECTOR_EQUALS(v, boost::irange(0u, i));
+        }
+    }
+}
+
+TEST_CASE("set many")
+{
+    const auto n = 666u;
+    const auto v = make_test_vector(0, n);
+
+    SECTION("scattered")
+    {
+        auto ps = std::vector<std::pair<std::size_t, unsigned>>{};
+        for (auto i = 0u; i < n; i += 7)
+            ps.emplace_back(n - i - 1, 42u);
+        auto w = v.set_many(ps.begin(), ps.end());
+        CHECK_VECTOR_EQUALS(v, boost::irange(0u, n));
+        for (auto i = 0u; i < n; ++i)
+            CHECK(w[i] == ((n - i - 1) % 7 == 0 ? 42u : i));
+    }
+
+    SECTION("later pairs win")
+    {
+        auto ps = std::vector<std::pair<std::size_t, unsigned>>{
+            {3, 1u}, {500, 2u}, {3, 3u}};
+        auto w = v.set_many(ps.begin(), ps.end());
+        CHECK(w[3] == 3u);
+        CHECK(w[500] == 2u);
+        CHECK(w[4] == 4u);
+    }
+
+    SECTION("move")
+    {
+        auto ps = std::vector<std::pair<std::size_t, unsigned>>{};
+        for (auto i = 0u; i < n; ++i)
+            ps.emplace_back(i, i + 1);
+        auto w = v;
+        w      = std::move(w).set_many(ps.begin(), ps.end());
+        CHECK_VECTOR_EQUALS(w, boost::irange(1u, n + 1));
+        CHECK_VECTOR_EQUALS(v, boost::irange(0u, n));
+    }
+}
+
 TEST_CASE("update")
 {
     const auto n = 42u;
@@ -222,6 +460,42 @@ TEST_CASE("update")
     }
 }
 
+#ifndef VECTOR_NO_IF_CHANGED
+TEST_CASE("update if changed")
+{
+    auto v = make_test_vector(0, 666u);
+    auto same = [](auto x) { return x; };
+    auto incr = [](auto x) { return x + 1; };
+
+    CHECK(v.set_if_changed(3u, 3u).identity() == v.identity());
+    CHECK(v.set_if_changed(600u, 600u).identity() == v.identity());
+    CHECK(v.update_if_changed(3u, same).identity() == v.identity());
+    CHECK(v.update_if_changed(600u, same).identity() == v.identity());
+
+    auto u = v.set_if_changed(3u, 13u);
+    CHECK(u.identity() != v.identity());
+    CHECK(u[3u] == 13u);
+    CHECK(v[3u] == 3u);
+    auto w = v.update_if_changed(600u, incr);
+    CHECK(w[600u] == 601u);
+    CHECK(v[600u] == 600u);
+
+    SECTION("move")
+    {
+        auto id = v.identity();
+        v       = std::move(v).set_if_changed(3u, 3u);
+        CHECK(v.identity() == id);
+        v = std::move(v).update_if_changed(600u, same);
+        CHECK(v.identity() == id);
+        v = std::move(v).update_if_changed(600u, incr);
+        CHECK(v[600u] == 601u);
+        v = std::move(v).set_if_changed(3u, 13u);
+        CHECK(v[3u] == 13u);
+        CHECK(v[4u] == 4u);
+    }
+}
+#endif // VECTOR_NO_IF_CHANGED
+
 TEST_CASE("iterator")
 {
     const auto n = 666u;
@@ -382,6 +656,86 @@ TEST_CASE("accumulate")
     }
 }
 
+template <typename V>
+auto diff_ranges(const V& a, const V& b)
+{
+    auto result = std::vector<std::tuple<char, std::size_t, std::size_t>>{};
+    immer::diff(
+        a,
+        b,
+        [&](auto f, auto l) { result.emplace_back('+', f, l); },
+        [&](auto f, auto l) { result.emplace_back('-', f, l); },
+        [&](auto f, auto l) { result.emplace_back('~', f, l); });
+    return result;
+}
+
+template <typename V>
+auto expected_diff_ranges(const V& a, const V& b)
+{
+    auto result = std::vector<std::tuple<char, std::size_t, std::size_t>>{};
+    auto common = std::min(a.size(), b.size());
+    for (auto i = std::size_t{}; i < common;) {
+        if (a[i] == b[i]) {
+            ++i;
+            continue;
+        }
+        auto f = i;
+        while (i < common && a[i] != b[i])
+            ++i;
+        result.emplace_back('~', f, i);
+    }
+    if (a.size() > common)
+        result.emplace_back('-', common, a.size());
+    if (b.size() > common)
+        result.emplace_back('+', common, b.size());
+    return result;
+}
+
+TEST_CASE("diff")
+{
+    auto v = make_test_vector(0, 666u);
+
+    SECTION("identical")
+    {
+        CHECK(diff_ranges(v, v).empty());
+        CHECK(diff_ranges(v, make_test_vector(0, 666u)).empty());
+    }
+
+    SECTION("updates")
+    {
+        auto w = v.set(3, 42u).set(4, 43u).set(100, 0u).set(665, 1u);
+        CHECK(diff_ranges(v, w) == expected_diff_ranges(v, w));
+        CHECK(diff_ranges(w, v) == expected_diff_ranges(w, v));
+    }
+
+    SECTION("push and take")
+    {
+        auto w = v.push_back(1u).push_back(2u).set(10, 0u);
+        CHECK(diff_ranges(v, w) == expected_diff_ranges(v, w));
+        CHECK(diff_ranges(w, v) == expected_diff_ranges(w, v));
+        auto t = v.take(42).set(0, 9u);
+        CHECK(diff_ranges(v, t) == expected_diff_ranges(v, t));
+        CHECK(diff_ranges(t, v) == expected_diff_ranges(t, v));
+        auto e = decltype(v){};
+        CHECK(diff_ranges(e, v) == expected_diff_ranges(e, v));
+        CHECK(diff_ranges(v, e) == expected_diff_ranges(v, e));
+    }
+
+    SECTION("many versions")
+    {
+        auto gen = std::default_random_engine{42};
+        auto w   = v;
+        for (auto i = 0u; i < 100u; ++i) {
+            auto idx = std::uniform_int_distribution<std::size_t>{
+                0, w.size() - 1}(gen);
+            auto next = i % 7 == 0 ? w.push_back(i) : w.set(idx, i);
+            CHECK(diff_ranges(w, next) == expected_diff_ranges(w, next));
+            CHECK(diff_ranges(v, next) == expected_diff_ranges(v, next));
+            w = next;
+        }
+    }
+}
+
 TEST_CASE("vector of strings")
 {
     const auto n = 666u;
@@ -456,6 +810,38 @@ TEST_CASE("take")
     }
 }
 
+#ifndef VECTOR_NO_POP_BACK
+TEST_CASE("pop_back")
+{
+    const auto n = 666u;
+    auto v       = make_test_vector(0, n);
+
+    SECTION("persistent")
+    {
+        auto vv = v;
+        for (auto i = 0u; i < n; ++i) {
+            vv = vv.pop_back();
+            CHECK(vv.size() == n - i - 1);
+            CHECK_VECTOR_EQUALS_RANGE(vv, v.begin(), v.end() - i - 1);
+        }
+        CHECK(vv.pop_back().empty());
+        CHECK(v.size() == n);
+    }
+
+    SECTION("move")
+    {
+        auto vv = v;
+        for (auto i = 0u; i < n; ++i) {
+            vv = std::move(vv).pop_back();
+            CHECK(vv.size() == n - i - 1);
+            if (!vv.empty())
+                CHECK(vv.back() == n - i - 2);
+        }
+        CHECK_VECTOR_EQUALS_RANGE(v, v.begin(), v.end());
+    }
+}
+#endif // VECTOR_NO_POP_BACK
+
 TEST_CASE("exception safety")
 {
     constexpr auto n = 666u;
@@ -496,6 +882,26 @@ TEST_CASE("exception safety")
         IMMER_TRACE_E(d.happenings);
     }
 
+    SECTION("append")
+    {
+        auto v = dadaist_vector_t{};
+        auto d = dadaism{};
+        for (auto i = 0u; v.size() < static_cast<decltype(v.size())>(n);) {
+            auto r = std::vector<typename dadaist_vector_t::value_type>{};
+            for (auto j = i; j < std::min(i + 7u, n); ++j)
+                r.push_back({j});
+            auto s = d.next();
+            try {
+                v = v.append(r.begin(), r.end());
+                i = std::min(i + 7u, n);
+            } catch (dada_error) {
+            }
+            CHECK_VECTOR_EQUALS(v, boost::irange(0u, i));
+        }
+        CHECK(d.happenings > 0);
+        IMMER_TRACE_E(d.happenings);
+    }
+
     SECTION("update")
     {
         auto v = make_test_vector<dadaist_vector_t>(0, n);
@@ -570,3 +976,61 @@ TEST_CASE("exception safety")
         IMMER_TRACE_E(d.happenings);
     }
 }
+
+TEST_CASE("filter")
+{
+    auto v    = make_test_vector(0, 666);
+    auto even = [](unsigned x) { return x % 2 == 0; };
+    auto expected = [&](auto pred) {
+        auto r = VECTOR_T<unsigned>{};
+        for (auto x : v)
+            if (pred(x))
+                r = r.push_back(x);
+        return r;
+    };
+
+    SECTION("everything kept")
+    {
+        auto r = immer::filter(v, [](unsigned) { return true; });
+        CHECK(r.identity() == v.identity());
+    }
+
+    SECTION("nothing kept")
+    {
+        CHECK(immer::filter(v, [](unsigned) { return false; }).empty());
+        CHECK(immer::filter(VECTOR_T<unsigned>{}, even).empty());
+    }
+
+    SECTION("some kept")
+    {
+        CHECK_VECTOR_EQUALS(immer::filter(v, even), expected(even));
+        auto few = [](unsigned x) { return x != 3 && x != 600; };
+        CHECK_VECTOR_EQUALS(immer::filter(v, few), expected(few));
+        auto tail = [](unsigned x) { return x != 665; };
+        CHECK_VECTOR_EQUALS(immer::filter(v, tail), expected(tail));
+    }
+}
+
+TEST_CASE("get_many")
+{
+    auto v       = make_test_vector(0, 5000);
+    auto indices = std::vector<std::size_t>{};
+    auto gen     = std::mt19937{3};
+    for (auto i = 0; i < 1000; ++i)
+        indices.push_back(gen() % v.size());
+    indices.push_back(0);
+    indices.push_back(v.size() - 1);
+
+    auto out = std::vector<unsigned>{};
+    v.get_many(indices, std::back_inserter(out));
+    REQUIRE(out.size() == indices.size());
+    for (auto i = 0u; i < indices.size(); ++i)
+        CHECK(out[i] == v[indices[i]]);
+
+    auto small = make_test_vector(0, 3);
+    auto res   = std::vector<unsigned>(3);
+    auto end   = small.get_many(std::vector<std::size_t>{2, 0, 1}, res.begin());
+    CHECK(end == res.end());
+    CHECK(res == std::vector<unsigned>{2, 0, 1});
+    small.get_many(std::vector<std::size_t>{}, res.begin());
+}
@@ -0,0 +1,50 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/vector.hpp>
+#include <immer/vector_transient.hpp>
+
+#include <immer/heap/arena_heap.hpp>
+#include <immer/heap/gc_heap.hpp>
+#include <immer/refcount/no_refcount_policy.hpp>
+#include <immer/transience/arena_transience_policy.hpp>
+
+using arena_memory =
+    immer::memory_policy<immer::heap_policy<immer::arena_heap<immer::gc_heap>>,
+                         immer::no_refcount_policy,
+                         immer::default_lock_policy,
+                         immer::arena_transience_policy,
+                         false>;
+
+template <typename T>
+using test_vector_t = immer::vector<T, arena_memory, 3u>;
+
+template <typename T>
+using test_vector_transient_t = immer::vector_transient<T, arena_memory, 3u>;
+
+#define VECTOR_T test_vector_t
+#define VECTOR_TRANSIENT_T test_vector_transient_t
+
+#include "generic.ipp"
+
+TEST_CASE("construction keeps the nodes of its arena")
+{
+    const auto n = 666u;
+    auto src     = std::vector<unsigned>(n);
+    std::iota(src.begin(), src.end(), 0u);
+
+    auto v = test_vector_t<unsigned>(src.begin(), src.end());
+    auto w = test_vector_t<unsigned>(n, 42u);
+    auto x = test_vector_t<unsigned>{0u, 1u, 2u};
+    auto y = test_vector_t<unsigned>(src.begin(), src.end());
+    CHECK_VECTOR_EQUALS(v, boost::irange(0u, n));
+    CHECK_VECTOR_EQUALS(y, boost::irange(0u, n));
+    CHECK_VECTOR_EQUALS(x, boost::irange(0u, 3u));
+    CHECK(w.size() == n);
+    CHECK(std::all_of(w.begin(), w.end(), [](auto x) { return x == 42u; }));
+}
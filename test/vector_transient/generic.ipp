@@ -12,6 +12,10 @@
 
 #include <catch2/catch_test_macros.hpp>
 
+#include <algorithm>
+#include <utility>
+#include <vector>
+
 #ifndef VECTOR_T
 #error "define the vector template to use in VECTOR_T"
 #endif
@@ -52,6 +56,39 @@ TEST_CASE("protect persistence")
     CHECK(v[0] == 42);
 }
 
+TEST_CASE("append range")
+{
+    const auto n = 666u;
+
+    for (auto i = 0u; i < n; i += 37) {
+        auto p = make_test_vector(0, i);
+        auto t = p.transient();
+        for (auto j = i; j < n;) {
+            const auto r = boost::irange(j, std::min(j + 29u, n));
+            t.append(r.begin(), r.end());
+            j = std::min(j + 29u, n);
+            CHECK_VECTOR_EQUALS(t, boost::irange(0u, j));
+        }
+        CHECK_VECTOR_EQUALS(p, boost::irange(0u, i));
+        CHECK_VECTOR_EQUALS(t.persistent(), boost::irange(0u, n));
+    }
+}
+
+TEST_CASE("set many")
+{
+    const auto n = 666u;
+    auto p       = make_test_vector(0, n);
+    auto t       = p.transient();
+    auto ps      = std::vector<std::pair<std::size_t, unsigned>>{};
+    for (auto i = 0u; i < n; i += 2)
+        ps.emplace_back(i, i + 1);
+    t.set_many(ps.begin(), ps.end());
+    t.set_many(ps.begin(), ps.begin());
+    for (auto i = 0u; i < n; ++i)
+        CHECK(t[i] == (i % 2 ? i : i + 1));
+    CHECK_VECTOR_EQUALS(p, boost::irange(0u, n));
+}
+
 TEST_CASE("push back move")
 {
     using vector_t = VECTOR_T<unsigned>;
@@ -81,6 +118,27 @@ TEST_CASE("push back move")
     CHECK_VECTOR_EQUALS(v, boost::irange(0u, 4u));
 }
 
+TEST_CASE("emplace back")
+{
+    using vector_t = VECTOR_T<std::string>;
+
+    const auto n = 666u;
+    auto t       = vector_t{}.transient();
+    for (auto i = 0u; i < n; ++i)
+        t.emplace_back(i % 7, 'a');
+    t.emplace_back();
+
+    auto v = t.persistent();
+    CHECK(v.size() == n + 1);
+    for (auto i = 0u; i < n; ++i)
+        CHECK(v[i] == std::string(i % 7, 'a'));
+    CHECK(v[n] == "");
+
+    auto w = std::move(v).emplace_back(3u, 'b');
+    CHECK(w.size() == n + 2);
+    CHECK(w[n + 1] == "bbb");
+}
+
 TEST_CASE("set move")
 {
     using vector_t = VECTOR_T<unsigned>;
@@ -137,6 +195,40 @@ TEST_CASE("update move")
     CHECK_VECTOR_EQUALS(v, boost::irange(1u, 2u));
 }
 
+#ifndef VECTOR_TRANSIENT_NO_MUT_CHUNKS
+TEST_CASE("mutate chunks in place")
+{
+    // spans several leaves for any of the tested branchings
+    constexpr auto l = std::size_t{32};
+
+    auto n = static_cast<unsigned>(10 * l + 3);
+    auto p = make_test_vector(0, n);
+    auto t = p.transient();
+
+    auto seen = 0u;
+    t.for_each_chunk_mut([&](auto first, auto last) {
+        for (; first != last; ++first, ++seen) {
+            CHECK(*first == seen);
+            *first *= 2;
+        }
+    });
+    CHECK(seen == n);
+    for (auto i = 0u; i < n; ++i)
+        CHECK(t[i] == i * 2);
+    CHECK_VECTOR_EQUALS(p, boost::irange(0u, n));
+
+    t.update_range(l - 1, 3 * l + 1, [](auto x) { return x + 1; });
+    for (auto i = 0u; i < n; ++i)
+        CHECK(t[i] == i * 2 + (i >= l - 1 && i < 3 * l + 1));
+    t.update_range(5, 5, [](auto x) { return x + 1; });
+    CHECK(t[5] == 10u);
+
+    auto q = t.persistent();
+    CHECK(q[l] == 2 * l + 1);
+    CHECK_VECTOR_EQUALS(p, boost::irange(0u, n));
+}
+#endif // VECTOR_TRANSIENT_NO_MUT_CHUNKS
+
 TEST_CASE("take move")
 {
     using vector_t = VECTOR_T<unsigned>;
@@ -165,6 +257,37 @@ TEST_CASE("take move")
     CHECK_VECTOR_EQUALS(v, boost::irange(0u, 1u));
 }
 
+#ifndef VECTOR_TRANSIENT_NO_RESIZE
+TEST_CASE("resize")
+{
+    using vector_t   = VECTOR_T<unsigned>;
+    constexpr auto l = std::size_t{1} << vector_t::bits_leaf;
+
+    auto p = make_test_vector(0, 5);
+    auto t = p.transient();
+    t.resize(3);
+    CHECK_VECTOR_EQUALS(t, boost::irange(0u, 3u));
+
+    auto n = 100 * l + 7;
+    t.resize(n, 42u);
+    CHECK(t.size() == n);
+    CHECK(t[2] == 2u);
+    CHECK(t[3] == 42u);
+    CHECK(t[n - 1] == 42u);
+    t.set(n / 2, 7u);
+    t.push_back(8u);
+    CHECK(t[n / 2] == 7u);
+    CHECK(t[n / 2 + 1] == 42u);
+    CHECK(t[n] == 8u);
+    CHECK_VECTOR_EQUALS(p, boost::irange(0u, 5u));
+
+    auto q = t.persistent();
+    CHECK(q.size() == n + 1);
+    CHECK(std::count(q.begin(), q.end(), 42u) ==
+          static_cast<std::ptrdiff_t>(n - 4));
+}
+#endif
+
 TEST_CASE("exception safety")
 {
     constexpr auto n = 667u;
@@ -0,0 +1,91 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/flex_vector.hpp>
+#include <immer/flex_vector_transient.hpp>
+#include <immer/vector.hpp>
+#include <immer/vector_transient.hpp>
+#include <immer/views.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <numeric>
+#include <string>
+#include <vector>
+
+namespace v = immer::views;
+
+namespace {
+
+template <typename V>
+V make_test_vector(int n)
+{
+    auto r = V{};
+    for (auto i = 0; i < n; ++i)
+        r = r.push_back(i);
+    return r;
+}
+
+template <typename View>
+std::vector<typename View::value_type> to_std(const View& view)
+{
+    auto r = std::vector<typename View::value_type>{};
+    view.for_each_chunk([&](auto f, auto l) { r.insert(r.end(), f, l); });
+    return r;
+}
+
+} // namespace
+
+TEST_CASE("fused stages")
+{
+    auto vec    = make_test_vector<immer::vector<int>>(10000);
+    auto triple = [](int x) { return x * 3; };
+    auto even   = [](int x) { return x % 2 == 0; };
+    auto p = vec | v::transform(triple) | v::filter(even) | v::drop(5) |
+             v::take(100);
+
+    auto expected = std::vector<int>{};
+    for (auto i = 0; expected.size() < 105; ++i)
+        if (i * 3 % 2 == 0)
+            expected.push_back(i * 3);
+    expected.erase(expected.begin(), expected.begin() + 5);
+
+    CHECK(to_std(p) == expected);
+    CHECK(to_std(p) == expected);
+    auto r = v::into<immer::vector<int>>(p);
+    CHECK(std::vector<int>(r.begin(), r.end()) == expected);
+    CHECK(v::accumulate(p, 0) ==
+          std::accumulate(expected.begin(), expected.end(), 0));
+}
+
+TEST_CASE("take stops the source")
+{
+    auto vec   = make_test_vector<immer::flex_vector<int>>(5000);
+    auto seen  = 0;
+    auto count = [&](int x) {
+        ++seen;
+        return x;
+    };
+    auto p = vec | v::transform(count) | v::take(10);
+    CHECK(!p.for_each_chunk_p([](auto, auto) { return true; }));
+    CHECK(seen < 100);
+    CHECK(to_std(vec | v::take(0)).empty());
+    CHECK(to_std(vec | v::drop(6000)).empty());
+}
+
+TEST_CASE("non trivial elements")
+{
+    auto vec     = make_test_vector<immer::flex_vector<int>>(300);
+    auto to_str  = [](int x) { return std::to_string(x); };
+    auto two_dig = [](const std::string& s) { return s.size() == 2; };
+    auto p = (vec + vec) | v::transform(to_str) | v::filter(two_dig);
+    auto r = v::into<immer::flex_vector<std::string>>(p);
+    CHECK(r.size() == 180u);
+    CHECK(r[0] == "10");
+    CHECK(r[90] == "10");
+}
@@ -0,0 +1,63 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/flex_vector.hpp>
+#include <immer/map.hpp>
+#include <immer/memory_stats.hpp>
+#include <immer/set.hpp>
+#include <immer/vector.hpp>
+#include <immer/warm.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+TEST_CASE("warm visits every node within the budget")
+{
+    auto v = immer::vector<int>{};
+    for (auto i = 0; i < 100000; ++i)
+        v = std::move(v).push_back(i);
+
+    auto f = immer::flex_vector<int>{};
+    for (auto i = 0; i < 200; ++i)
+        f = f + immer::flex_vector<int>(i % 37 + 1, i);
+
+    auto m = immer::map<std::string, int>{};
+    auto s = immer::set<int>{};
+    for (auto i = 0; i < 10000; ++i) {
+        m = std::move(m).set(std::to_string(i), i);
+        s = std::move(s).insert(i);
+    }
+
+    CHECK(immer::warm(v) == immer::memory_stats(v).bytes);
+    CHECK(immer::warm(f) == immer::memory_stats(f).bytes);
+    CHECK(immer::warm(m) == immer::memory_stats(m).bytes);
+    CHECK(immer::warm(s) == immer::memory_stats(s).bytes);
+    CHECK(immer::warm(immer::vector<int>{}) ==
+          immer::memory_stats(immer::vector<int>{}).bytes);
+    CHECK(immer::warm(immer::map<int, int>{}) ==
+          immer::memory_stats(immer::map<int, int>{}).bytes);
+}
+
+TEST_CASE("warm starts with the top levels")
+{
+    auto v = immer::vector<int>{};
+    for (auto i = 0; i < 100000; ++i)
+        v = std::move(v).push_back(i);
+    auto total = immer::memory_stats(v).bytes;
+
+    // only the root fits
+    auto root = immer::warm(v, 1);
+    CHECK(root > 0);
+    CHECK(root < 1024);
+
+    auto some = immer::warm(v, total / 2);
+    CHECK(some >= total / 2);
+    CHECK(some < total);
+    CHECK(immer::warm(v, 0) == 0);
+}
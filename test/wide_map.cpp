@@ -0,0 +1,131 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/wide_map.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+template <typename Map>
+bool same(const Map& m, const std::unordered_map<unsigned, unsigned>& ref)
+{
+    if (m.size() != ref.size())
+        return false;
+    for (auto& kv : ref)
+        if (!m.find(kv.first) || *m.find(kv.first) != kv.second)
+            return false;
+    auto n = std::size_t{};
+    for (auto& kv : m) {
+        auto it = ref.find(kv.first);
+        if (it == ref.end() || it->second != kv.second)
+            return false;
+        ++n;
+    }
+    return n == ref.size();
+}
+
+} // namespace
+
+TEST_CASE("wide map basics")
+{
+    using map_t = immer::wide_map<std::string, int>;
+
+    auto m = map_t{};
+    CHECK(m.empty());
+    CHECK(m.slots().empty());
+    CHECK(m.find("foo") == nullptr);
+    CHECK(m["foo"] == 0);
+    CHECK(m.begin() == m.end());
+    CHECK_THROWS_AS(m.at("foo"), std::out_of_range);
+
+    auto n = m.set("foo", 1).set("bar", 2);
+    CHECK(n.size() == 2);
+    CHECK(n.slots().size() == map_t::slot_count);
+    CHECK(n["foo"] == 1);
+    CHECK(n.at("bar") == 2);
+    CHECK(n.count("baz") == 0);
+    CHECK(m.empty());
+
+    CHECK(n.update("foo", [](int x) { return x + 10; })["foo"] == 11);
+    CHECK(n.update("baz", [](int x) { return x + 10; }).size() == 3);
+    CHECK(n.erase("foo").size() == 1);
+    CHECK(n.erase("baz").identity() == n.identity());
+    CHECK(n.erase("foo").erase("bar") == m);
+    CHECK(n.set("foo", 1) == n);
+    CHECK(n.set("foo", 3) != n);
+}
+
+TEST_CASE("wide map updates rvalues in place")
+{
+    using map_t = immer::wide_map<unsigned, unsigned>;
+
+    auto m = map_t{}.set(1, 1);
+    auto id = m.identity();
+    for (auto i = 0u; i < 1000u; ++i)
+        m = std::move(m).update(i, [](unsigned x) { return x + 1; });
+    if (map_t::memory_policy_type::use_transient_rvalues)
+        CHECK(m.identity() == id);
+    CHECK(m.size() == 1000u);
+    CHECK(m[1] == 2u);
+    CHECK(m[999] == 1u);
+
+    auto c = m;
+    auto n = std::move(m).set(5, 42).erase(6);
+    CHECK(n.identity() != c.identity());
+    CHECK(c[5] == 1u);
+    CHECK(c.count(6) == 1);
+    CHECK(n[5] == 42u);
+    CHECK(n.count(6) == 0);
+}
+
+TEST_CASE("wide map against a reference")
+{
+    using map_t = immer::wide_map<unsigned,
+                                  unsigned,
+                                  std::hash<unsigned>,
+                                  std::equal_to<unsigned>,
+                                  immer::default_memory_policy,
+                                  3u,
+                                  4u>;
+
+    auto gen      = std::mt19937{42};
+    auto m        = map_t{};
+    auto ref      = std::unordered_map<unsigned, unsigned>{};
+    auto versions = std::vector<std::pair<map_t, decltype(ref)>>{};
+    for (auto i = 0u; i < 5000u; ++i) {
+        auto k = static_cast<unsigned>(gen() % 2000);
+        switch (gen() % 4) {
+        case 0:
+            m = m.erase(k);
+            ref.erase(k);
+            break;
+        case 1:
+            m = std::move(m).erase(k);
+            ref.erase(k);
+            break;
+        case 2:
+            m      = m.set(k, i);
+            ref[k] = i;
+            break;
+        default:
+            m = std::move(m).update(k, [](unsigned x) { return x + 1; });
+            ++ref[k];
+        }
+        if (i % 1000 == 0)
+            versions.emplace_back(m, ref);
+    }
+    CHECK(same(m, ref));
+    for (auto& v : versions)
+        CHECK(same(v.first, v.second));
+}
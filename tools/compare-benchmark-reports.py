@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+#
+# immer: immutable data structures for C++
+# Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+#
+# This software is distributed under the Boost Software License, Version 1.0.
+# See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+#
+
+"""Compares two directories of benchmark reports.
+
+Reads the `<target>.json` files that the `html-json` reporter writes in
+both directories and, for every benchmark and parameter round that is
+in both, compares the samples with a one sided Mann-Whitney U test.  A
+benchmark is slower when the test is significant and its median grew by
+more than the threshold, and faster in the opposite case.  Exits with
+status 1 when some benchmark is slower, so that it can gate an upgrade:
+
+    compare-benchmark-reports.py reports/report_<old> reports/report_<new>
+"""
+
+import argparse
+import glob
+import json
+import math
+import os
+import sys
+
+
+def load(directory):
+    """Returns the samples of the reports in `directory`, by target,
+    parameters and benchmark name."""
+    result = {}
+    for path in sorted(glob.glob(os.path.join(directory, "*.json"))):
+        target = os.path.splitext(os.path.basename(path))[0]
+        with open(path) as f:
+            report = json.load(f)
+        for r in report["rounds"]:
+            params = " ".join(
+                "{}={}".format(k, v) for k, v in sorted(r["params"].items())
+            )
+            for b in r["benchmarks"]:
+                result[(target, params, b["name"])] = b["samples"]
+    return result
+
+
+def median(xs):
+    xs = sorted(xs)
+    n = len(xs)
+    return xs[n // 2] if n % 2 else (xs[n // 2 - 1] + xs[n // 2]) / 2
+
+
+def mann_whitney_greater(xs, ys):
+    """The p-value of the hypothesis that the values of `ys` tend to be
+    greater than those of `xs`, with the normal approximation of the
+    distribution of U corrected for ties."""
+    n1, n2 = len(xs), len(ys)
+    values = sorted([(x, 0) for x in xs] + [(y, 1) for y in ys])
+    ranks = [0.0] * len(values)
+    ties = 0.0
+    i = 0
+    while i < len(values):
+        j = i
+        while j + 1 < len(values) and values[j + 1][0] == values[i][0]:
+            j += 1
+        for k in range(i, j + 1):
+            ranks[k] = (i + j) / 2 + 1
+        t = j - i + 1
+        ties += t**3 - t
+        i = j + 1
+    r2 = sum(r for r, (_, g) in zip(ranks, values) if g == 1)
+    u = r2 - n2 * (n2 + 1) / 2
+    n = n1 + n2
+    var = n1 * n2 / 12 * ((n + 1) - ties / (n * (n - 1)))
+    if var <= 0:
+        return 1.0
+    z = (u - n1 * n2 / 2 - 0.5) / math.sqrt(var)
+    return 0.5 * math.erfc(z / math.sqrt(2))
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__.splitlines()[0],
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+    )
+    parser.add_argument("baseline", help="directory of the baseline reports")
+    parser.add_argument("current", help="directory of the reports to check")
+    parser.add_argument(
+        "--alpha",
+        type=float,
+        default=0.01,
+        help="significance level of the test (default: %(default)s)",
+    )
+    parser.add_argument(
+        "--threshold",
+        type=float,
+        default=0.05,
+        help="relative change of the median that is ignored "
+        "(default: %(default)s)",
+    )
+    parser.add_argument(
+        "--all",
+        action="store_true",
+        help="show every benchmark, not only the ones that changed",
+    )
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    current = load(args.current)
+    if not baseline or not current:
+        sys.exit("no .json reports in {}".format(
+            args.baseline if not baseline else args.current))
+
+    rows = []
+    slower = 0
+    for key in sorted(baseline):
+        if key not in current:
+            print("missing: {} {} {}".format(*key), file=sys.stderr)
+            continue
+        xs, ys = baseline[key], current[key]
+        if len(xs) < 2 or len(ys) < 2:
+            continue
+        mx, my = median(xs), median(ys)
+        change = my / mx - 1 if mx else 0.0
+        if (mann_whitney_greater(xs, ys) < args.alpha
+                and change > args.threshold):
+            verdict = "slower"
+            slower += 1
+        elif (mann_whitney_greater(ys, xs) < args.alpha
+              and change < -args.threshold):
+            verdict = "faster"
+        else:
+            verdict = ""
+        if verdict or args.all:
+            rows.append(key + (mx, my, change, verdict))
+
+    header = ("target", "params", "benchmark", "baseline", "current",
+              "change", "")
+    cells = [header] + [
+        (t, p, b, "{:.1f}ns".format(mx), "{:.1f}ns".format(my),
+         "{:+.1%}".format(c), v)
+        for t, p, b, mx, my, c, v in rows
+    ]
+    widths = [max(len(row[i]) for row in cells) for i in range(len(header))]
+    for row in cells:
+        print("  ".join(c.ljust(w) for c, w in zip(row, widths)).rstrip())
+    print("\n{} of {} benchmarks slower".format(
+        slower, len(set(baseline) & set(current))))
+    sys.exit(1 if slower else 0)
+
+
+if __name__ == "__main__":
+    main()